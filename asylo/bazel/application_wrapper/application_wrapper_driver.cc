@@ -16,9 +16,21 @@
  *
  */
 
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+
 #include "asylo/bazel/application_wrapper/application_wrapper_driver_main.h"
 #include "asylo/client.h"
+#include "asylo/enclave.pb.h"
 #include "asylo/enclave_manager.h"
+#include "asylo/platform/core/generic_enclave_client.h"
+#include "asylo/platform/primitives/sgx/loader.pb.h"
+#include "asylo/platform/primitives/untrusted_primitives.h"
+#include "asylo/platform/primitives/util/exit_log.h"
+#include "asylo/platform/primitives/util/exit_metrics.h"
 #include "asylo/util/logging.h"
 #include "asylo/util/statusor.h"
 
@@ -31,6 +43,58 @@ constexpr char kSectionName[] = "enclave";
 // The name to use for the whole-application wrapper enclave.
 constexpr char kEnclaveName[] = "application_enclave";
 
+// The environment variable naming the file to write the exit call metrics of
+// the application enclave to. If set, exit call metrics are collected from the
+// moment the enclave is loaded, and written before it is destroyed.
+constexpr char kExitMetricsFileVariable[] = "ASYLO_EXIT_METRICS_FILE";
+
+// Loads the application enclave from the ELF section |kSectionName| of the
+// calling process in debug mode, optionally with exit call metrics.
+class ApplicationEnclaveLoader : public EnclaveLoader {
+ public:
+  explicit ApplicationEnclaveLoader(bool exit_metrics)
+      : exit_metrics_(exit_metrics) {}
+
+ private:
+  EnclaveLoadConfig GetEnclaveLoadConfig() const override {
+    EnclaveLoadConfig load_config;
+    SgxLoadConfig *sgx_config = load_config.MutableExtension(sgx_load_config);
+    sgx_config->mutable_embedded_enclave_config()->set_section_name(
+        kSectionName);
+    sgx_config->set_debug(true);
+    load_config.set_exit_metrics(exit_metrics_);
+    return load_config;
+  }
+
+  const bool exit_metrics_;
+};
+
+// Writes the exit call metrics of the enclave of |client| to |path|, one line
+// of tab-separated values per exit selector and system call, after a header
+// line naming the columns.
+void WriteExitMetrics(EnclaveClient *client, const std::string &path) {
+  auto generic_client = dynamic_cast<GenericEnclaveClient *>(client);
+  auto dispatch_table =
+      generic_client ? dynamic_cast<primitives::LoggingDispatchTable *>(
+                           generic_client->GetPrimitiveClient()
+                               ->exit_call_provider())
+                     : nullptr;
+  if (!dispatch_table || !dispatch_table->metrics()) {
+    LOG(ERROR) << "Exit call metrics are not available";
+    return;
+  }
+
+  std::ofstream output(path);
+  output << "selector\tsysno\tcount\terrors\tinput_bytes\toutput_bytes\t"
+            "total_latency_ns\n";
+  for (const auto &stats : dispatch_table->metrics()->Snapshot()) {
+    output << stats.selector << "\t" << stats.sysno << "\t" << stats.count
+           << "\t" << stats.error_count << "\t" << stats.input_bytes << "\t"
+           << stats.output_bytes << "\t" << stats.total_latency_ns << "\n";
+  }
+  LOG_IF(ERROR, !output) << "Failed to write exit call metrics to " << path;
+}
+
 }  // namespace
 }  // namespace asylo
 
@@ -42,11 +106,19 @@ int main(int argc, char *argv[]) {
       << "Failed to configure EnclaveManager: " << status;
 
   // Create a loader for the application enclave.
-  asylo::SgxEmbeddedLoader loader(asylo::kSectionName, /*debug=*/true);
+  const char *exit_metrics_file = std::getenv(asylo::kExitMetricsFileVariable);
+  asylo::ApplicationEnclaveLoader loader(
+      /*exit_metrics=*/exit_metrics_file != nullptr);
 
   // Run the application driver workflow.
+  std::function<void(asylo::EnclaveClient *)> before_destroy;
+  if (exit_metrics_file) {
+    before_destroy = [exit_metrics_file](asylo::EnclaveClient *client) {
+      asylo::WriteExitMetrics(client, exit_metrics_file);
+    };
+  }
   auto main_return = asylo::ApplicationWrapperDriverMain(
-      loader, asylo::kEnclaveName, argc, argv);
+      loader, asylo::kEnclaveName, argc, argv, before_destroy);
   LOG_IF(FATAL, !main_return.ok())
       << "Failed to run the whole-application wrapper: "
       << main_return.status();
@@ -28,9 +28,9 @@
 
 namespace asylo {
 
-StatusOr<int> ApplicationWrapperDriverMain(const EnclaveLoader &loader,
-                                           const std::string &enclave_name,
-                                           int argc, char *argv[]) {
+StatusOr<int> ApplicationWrapperDriverMain(
+    const EnclaveLoader &loader, const std::string &enclave_name, int argc,
+    char *argv[], const std::function<void(EnclaveClient *)> &before_destroy) {
   // Retrieve the EnclaveManager instance.
   EnclaveManager *manager;
   ASYLO_ASSIGN_OR_RETURN(manager, EnclaveManager::Instance());
@@ -64,6 +64,9 @@ StatusOr<int> ApplicationWrapperDriverMain(const EnclaveLoader &loader,
                   "EnclaveOutput does not have a main_return_value extension");
   }
   int main_return = output.GetExtension(main_return_value);
+  if (before_destroy) {
+    before_destroy(client);
+  }
 
   // Destroy the enclave.
   destroy_enclave.release();
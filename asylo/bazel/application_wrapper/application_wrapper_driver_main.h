@@ -19,6 +19,7 @@
 #ifndef ASYLO_BAZEL_APPLICATION_WRAPPER_APPLICATION_WRAPPER_DRIVER_MAIN_H_
 #define ASYLO_BAZEL_APPLICATION_WRAPPER_APPLICATION_WRAPPER_DRIVER_MAIN_H_
 
+#include <functional>
 #include <string>
 
 #include "asylo/enclave.pb.h"
@@ -34,12 +35,15 @@ namespace asylo {
 // The core logic of the whole-application wrapper driver. Loads the application
 // enclave from |loader|, runs the enclave with the given command-line
 // arguments, and destroys the enclave after main() returns. Returns the
-// main_return_value from the enclave's output.
+// main_return_value from the enclave's output. If |before_destroy| is set, it
+// is called with the client of the enclave once main() returns successfully,
+// right before the enclave is destroyed.
 //
 // Assumes that EnclaveManager has already been configured.
-StatusOr<int> ApplicationWrapperDriverMain(const EnclaveLoader &loader,
-                                           const std::string &enclave_name,
-                                           int argc, char *argv[]);
+StatusOr<int> ApplicationWrapperDriverMain(
+    const EnclaveLoader &loader, const std::string &enclave_name, int argc,
+    char *argv[],
+    const std::function<void(EnclaveClient *)> &before_destroy = nullptr);
 
 }  // namespace asylo
 
@@ -51,6 +51,7 @@ using ::testing::_;
 using ::testing::DoAll;
 using ::testing::HasSubstr;
 using ::testing::InSequence;
+using ::testing::InvokeWithoutArgs;
 using ::testing::Return;
 using ::testing::SetArgPointee;
 using ::testing::StrictMock;
@@ -103,6 +104,35 @@ TEST_F(ApplicationWrapperDriverMainTest,
               IsOkAndHolds(0));
 }
 
+// Tests that ApplicationWrapperDriverMain() calls |before_destroy| with the
+// created client after EnterAndRun() and before DestroyEnclave().
+TEST_F(ApplicationWrapperDriverMainTest, CallsBeforeDestroyBeforeDestroying) {
+  EnclaveOutput enclave_output;
+  enclave_output.SetExtension(main_return_value, 0);
+
+  EnclaveClient *destroyed_client = nullptr;
+  EXPECT_CALL(*client_, EnterAndInitialize(_));
+  EXPECT_CALL(*client_, EnterAndRun(_, _))
+      .WillOnce(
+          DoAll(SetArgPointee<1>(enclave_output), Return(Status::OkStatus())));
+  EXPECT_CALL(*client_, EnterAndFinalize(_))
+      .WillOnce(InvokeWithoutArgs([&destroyed_client]() {
+        EXPECT_NE(destroyed_client, nullptr);
+        return Status::OkStatus();
+      }));
+  EXPECT_CALL(*client_, DestroyEnclave());
+
+  char *arg = nullptr;
+  EnclaveClient *expected_client = client_;
+  EXPECT_THAT(ApplicationWrapperDriverMain(
+                  Loader(), "before_destroy", /*argc=*/0, /*argv=*/&arg,
+                  [&destroyed_client](EnclaveClient *client) {
+                    destroyed_client = client;
+                  }),
+              IsOkAndHolds(0));
+  EXPECT_EQ(destroyed_client, expected_client);
+}
+
 // Tests that ApplicationWrapperDriverMain() returns the same status as
 // LoadEnclave() if the LoadEnclave() call fails.
 TEST_F(ApplicationWrapperDriverMainTest, ForwardsFailureStatusFromLoadEnclave) {
@@ -346,10 +346,53 @@ def backend_sign_enclave_with_untrusted_key(
         **kwargs
     )
 
+# Assertion authorities an enclave may link, by name. Each authority registers
+# itself with the identity framework when linked, so an enclave only carries
+# the authorities it depends on.
+ASYLO_ASSERTION_AUTHORITIES = {
+    "null": [
+        "/identity/attestation/null:null_assertion_generator",
+        "/identity/attestation/null:null_assertion_verifier",
+        "/identity/attestation/null:null_identity_expectation_matcher",
+    ],
+    "sgx_age_remote": [
+        "/identity/attestation/sgx:sgx_age_remote_assertion_generator",
+        "/identity/attestation/sgx:sgx_age_remote_assertion_verifier",
+        "/identity/platform/sgx:sgx_identity_expectation_matcher",
+    ],
+    "sgx_local": [
+        "/identity/attestation/sgx:sgx_local_assertion_generator",
+        "/identity/attestation/sgx:sgx_local_assertion_verifier",
+        "/identity/platform/sgx:sgx_identity_expectation_matcher",
+    ],
+}
+
+def assertion_authority_deps(authorities):
+    """Returns the dependencies linking the named assertion authorities.
+
+    Args:
+      authorities: Names of assertion authorities, which are keys of
+        ASYLO_ASSERTION_AUTHORITIES.
+
+    Returns:
+      A list of labels without duplicates.
+    """
+    asylo = internal.package()
+    deps = []
+    for authority in authorities:
+        if authority not in ASYLO_ASSERTION_AUTHORITIES:
+            fail("Unknown assertion authority: " + authority)
+        for dep in ASYLO_ASSERTION_AUTHORITIES[authority]:
+            if asylo + dep not in deps:
+                deps.append(asylo + dep)
+    return deps
+
 def cc_unsigned_enclave(
         name,
         backends = backend_tools.should_be_all_backends,
         name_by_backend = {},
+        assertion_authorities = [],
+        gc_sections = True,
         **kwargs):
     """Creates a C++ unsigned enclave target in all or any backend.
 
@@ -361,8 +404,21 @@ def cc_unsigned_enclave(
         targets. See enclave_info.bzl:all_backends documentation for details.
       name_by_backend: An optional dictionary from backend label to backend-
         specific target label.
+      assertion_authorities: Names of the assertion authorities, which are keys
+        of ASYLO_ASSERTION_AUTHORITIES, to link into the enclave in addition to
+        the ones its dependencies link. Optional.
+      gc_sections: Whether the linker drops the code and data the enclave does
+        not reach. Disabling this keeps every linked object in the enclave,
+        which adds to the pages measured at load time. Defaults to True.
       **kwargs: Remainder arguments to the backend rule.
     """
+    kwargs = dict(kwargs)
+    if assertion_authorities:
+        kwargs["deps"] = kwargs.get("deps", []) + assertion_authority_deps(
+            assertion_authorities,
+        )
+    if not gc_sections:
+        kwargs["features"] = kwargs.get("features", []) + ["-gc_sections"]
     enclave_rule = cc_backend_unsigned_enclave
 
     asylo = "asylo"
@@ -426,6 +482,43 @@ def debug_sign_enclave(name, **kwargs):
     """
     sign_enclave_with_untrusted_key(name, **kwargs)
 
+def enclave_size_report(name, enclave, top_symbols = 50, **kwargs):
+    """Reports what takes up the pages of an enclave.
+
+    The report lists the size of the code, read-only data and writable data of
+    the enclave, a lower bound on the number of 4 KiB pages they occupy, and
+    the largest symbols with their sizes. It is written to <name>.txt.
+
+    Args:
+      name: The rule name.
+      enclave: The label of an unsigned or signed enclave target.
+      top_symbols: How many of the largest symbols to list. Optional.
+      **kwargs: genrule arguments, like tags and testonly.
+    """
+    # Sums the sizes, in the second column of nm output, by symbol type.
+    totals_awk = (
+        "$$3 ~ /^[Tt]$$/ { text += $$2 } " +
+        "$$3 ~ /^[Rr]$$/ { rodata += $$2 } " +
+        "$$3 ~ /^[DdBb]$$/ { data += $$2 } " +
+        "END { " +
+        "printf \"text:   %d bytes\\n\", text; " +
+        "printf \"rodata: %d bytes\\n\", rodata; " +
+        "printf \"data:   %d bytes\\n\", data; " +
+        "printf \"pages:  %d\\n\", int((text + rodata + data + 4095) / 4096) }"
+    )
+    native.genrule(
+        name = name,
+        srcs = [enclave],
+        outs = [name + ".txt"],
+        cmd = ("$(NM) --print-size --size-sort --radix=d -C $(SRCS) > $@.nm && " +
+               "awk '" + totals_awk + "' $@.nm > $@ && " +
+               "echo >> $@ && echo 'Largest symbols:' >> $@ && " +
+               "sort -k2,2nr $@.nm | awk 'NR <= " + str(top_symbols) + "' " +
+               ">> $@ && rm $@.nm"),
+        toolchains = ["@bazel_tools//tools/cpp:current_cc_toolchain"],
+        **kwargs
+    )
+
 # The section to embed the application enclave in.
 _APPLICATION_WRAPPER_ENCLAVE_SECTION = "enclave"
 
@@ -16,7 +16,7 @@
 
 """Repository rule implementations for WORKSPACE to use."""
 
-load("@bazel_tools//tools/build_defs/repo:http.bzl", "http_archive")
+load("@bazel_tools//tools/build_defs/repo:http.bzl", "http_archive", "http_file")
 load("//asylo/bazel:installation_path.bzl", "installation_path")
 
 # website-docs-metadata
@@ -135,6 +135,17 @@ def asylo_testonly_deps():
             strip_prefix = "redis-5.0.7",
         )
 
+    # speedtest1, the SQLite performance benchmark, which is not part of the
+    # SQLite amalgamation. Only needed if benchmarking the secure SQLite VFS.
+    # Taken from the release tag of the SQLite version below, and not pinned
+    # to a digest.
+    if not native.existing_rule("org_sqlite_speedtest1"):
+        http_file(
+            name = "org_sqlite_speedtest1",
+            downloaded_file_path = "speedtest1.c",
+            urls = ["https://raw.githubusercontent.com/sqlite/sqlite/version-3.30.1/test/speedtest1.c"],
+        )
+
 def _instantiate_crosstool_impl(repository_ctx):
     """Instantiates the Asylo crosstool template with the installation path.
 
@@ -345,6 +356,16 @@ cc_library(
         urls = ["https://github.com/madler/zlib/archive/v1.2.11.tar.gz"],
     )
 
+    # SQLite, for the SQLite VFS backed by secure storage.
+    if not native.existing_rule("org_sqlite"):
+        http_archive(
+            name = "org_sqlite",
+            build_file = "@com_google_asylo//asylo/distrib:sqlite.BUILD",
+            urls = ["https://www.sqlite.org/2019/sqlite-autoconf-3300100.tar.gz"],
+            sha256 = "8c5a50db089bd2a1b08dbc5b00d2027602ca7ff238ba7658fabca454d4298e60",
+            strip_prefix = "sqlite-autoconf-3300100",
+        )
+
     # Libcurl for Intel PCS client
     if not native.existing_rule("com_github_curl_curl"):
         http_archive(
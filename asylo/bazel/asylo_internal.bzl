@@ -39,6 +39,10 @@ def internal_embed_enclaves(name, elf_file, enclaves, **kwargs):
     Each enclave is embedded in a new ELF section that does not get loaded into
     memory automatically when the elf file is run.
 
+    When objcopy supports it, the sections are page-aligned within the file, so
+    that the SGX loader can create the enclaves straight from a mapping of the
+    file without copying them.
+
     If the original binary already has a section with the same name as one of
     the given section names, objcopy (and the bazel invocation) will fail with
     an error message stating that the file is in the wrong format.
@@ -55,6 +59,7 @@ def internal_embed_enclaves(name, elf_file, enclaves, **kwargs):
     """
     genrule_name = name + "_rule"
     objcopy_flags = []
+    alignment_flags = []
     for section_name, enclave_file in enclaves.items():
         if len(section_name) == 0:
             fail("Section names must be non-empty")
@@ -67,13 +72,22 @@ def internal_embed_enclaves(name, elf_file, enclaves, **kwargs):
                 enclave_file = enclave_file,
             ),
         ]
+        alignment_flags += [
+            "--set-section-alignment",
+            "\"{section_name}\"=4096".format(section_name = section_name),
+        ]
 
     native.genrule(
         name = genrule_name,
         srcs = enclaves.values() + [elf_file],
         outs = [name],
         output_to_bindir = 1,
-        cmd = "$(OBJCOPY) {objcopy_flags} $(location {elf_file}) $@".format(
+        # objcopy only aligns sections that already exist, so the alignment is
+        # set in a second pass.
+        cmd = ("$(OBJCOPY) {objcopy_flags} $(location {elf_file}) $@ && " +
+               "if $(OBJCOPY) --help | grep -q -- --set-section-alignment; " +
+               "then $(OBJCOPY) {alignment_flags} $@; fi").format(
+            alignment_flags = " ".join(alignment_flags),
             objcopy_flags = " ".join(objcopy_flags),
             elf_file = elf_file,
         ),
@@ -20,12 +20,25 @@ package com.asylo.client;
 
 import com.asylo.EnclaveInput;
 import com.asylo.EnclaveOutput;
+import com.google.protobuf.CodedOutputStream;
 import com.google.protobuf.ExtensionRegistry;
+import com.google.protobuf.InvalidProtocolBufferException;
+import java.io.IOException;
+import java.nio.ByteBuffer;
 import java.util.Objects;
 
 /** EnclaveClient class which provides methods for invoking enclave's entry points. */
 public class EnclaveClient extends AutoCloseablePointer {
 
+  private static final int INITIAL_BUFFER_SIZE = 4096;
+
+  // Per-thread direct buffers that carry serialized messages across the JNI boundary without
+  // copying them through intermediate byte arrays. They grow as needed and are reused.
+  private static final ThreadLocal<ByteBuffer> inputBuffer =
+      ThreadLocal.withInitial(() -> ByteBuffer.allocateDirect(INITIAL_BUFFER_SIZE));
+  private static final ThreadLocal<ByteBuffer> outputBuffer =
+      ThreadLocal.withInitial(() -> ByteBuffer.allocateDirect(INITIAL_BUFFER_SIZE));
+
   /**
    * Enclave clients are created in native using JNI APIs.
    *
@@ -67,9 +80,70 @@ public class EnclaveClient extends AutoCloseablePointer {
     Objects.requireNonNull(enclaveInput);
     Objects.requireNonNull(registry);
 
-    return enterAndRun(getPointer(), enclaveInput, registry);
+    ByteBuffer input = threadInputBuffer(enclaveInput.getSerializedSize());
+    try {
+      CodedOutputStream stream = CodedOutputStream.newInstance(input);
+      enclaveInput.writeTo(stream);
+      stream.flush();
+    } catch (IOException e) {
+      throw new EnclaveException("Failed to serialize EnclaveInput", e);
+    }
+    input.flip();
+
+    ByteBuffer output = enterAndRunSerialized(input);
+    try {
+      return EnclaveOutput.parseFrom(output, registry);
+    } catch (InvalidProtocolBufferException e) {
+      throw new EnclaveException("Failed to deserialize EnclaveOutput", e);
+    }
+  }
+
+  /**
+   * Enters the enclave and invokes its execution entry point with an already serialized {@link
+   * EnclaveInput}, for callers that produce and consume the messages in serialized form.
+   *
+   * @param serializedInput A serialized {@link EnclaveInput}, read from its position to its limit.
+   *     The position of the buffer is not changed.
+   * @return A read-only buffer holding the serialized {@link EnclaveOutput}. The buffer is owned
+   *     by the calling thread and is only valid until its next call into an enclave.
+   * @throws EnclaveException if any exception occurs in native execution.
+   */
+  public ByteBuffer enterAndRunSerialized(ByteBuffer serializedInput) {
+    Objects.requireNonNull(serializedInput);
+
+    ByteBuffer input = serializedInput;
+    if (!input.isDirect()) {
+      input = threadInputBuffer(serializedInput.remaining());
+      input.put(serializedInput.duplicate());
+      input.flip();
+    }
+
+    ByteBuffer output = outputBuffer.get();
+    int size =
+        enterAndRunDirect(getPointer(), input, input.position(), input.remaining(), output);
+    if (size < 0) {
+      output = ByteBuffer.allocateDirect(-size);
+      outputBuffer.set(output);
+      size = takePendingOutput(output);
+    }
+    output.clear();
+    output.limit(size);
+    return output.asReadOnlyBuffer();
   }
 
-  private native EnclaveOutput enterAndRun(
-      long pointer, EnclaveInput enclaveInput, ExtensionRegistry registry);
+  // Returns this thread's input buffer, cleared and with room for at least |size| bytes.
+  private static ByteBuffer threadInputBuffer(int size) {
+    ByteBuffer input = inputBuffer.get();
+    if (input.capacity() < size) {
+      input = ByteBuffer.allocateDirect(size);
+      inputBuffer.set(input);
+    }
+    input.clear();
+    return input;
+  }
+
+  private native int enterAndRunDirect(
+      long pointer, ByteBuffer input, int offset, int length, ByteBuffer output);
+
+  private static native int takePendingOutput(ByteBuffer output);
 }
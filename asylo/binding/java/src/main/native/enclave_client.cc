@@ -18,29 +18,74 @@
 
 #include "asylo/binding/java/src/main/native/enclave_client.h"
 
+#include <cstring>
+#include <string>
+
+#include "absl/strings/string_view.h"
 #include "asylo/binding/java/src/main/native/jni_utils.h"
 #include "asylo/client.h"
 
-// Executes the enclave with given input and return the result.
-JNIEXPORT jobject JNICALL Java_com_asylo_client_EnclaveClient_enterAndRun(
-    JNIEnv *env, jobject this_object, jlong client_pointer,
-    jobject enclave_input, jobject registry) {
+namespace {
+
+// Serialized output of the last enclave call on this thread. Threads are
+// long-lived and the buffer keeps its capacity across calls.
+std::string *PendingOutput() {
+  static thread_local std::string *pending_output = new std::string();
+  return pending_output;
+}
+
+// Copies the pending output into the direct buffer |output|. Returns the
+// output size, or its negation if |output| is too small to hold it, in which
+// case the output stays pending for a call to takePendingOutput.
+jint CopyPendingOutput(JNIEnv *env, jobject output) {
+  std::string *pending_output = PendingOutput();
+  jint size = static_cast<jint>(pending_output->size());
+  void *address = env->GetDirectBufferAddress(output);
+  if (!address) {
+    asylo::jni::ThrowEnclaveException(env, "Output buffer is not direct");
+    return 0;
+  }
+  if (env->GetDirectBufferCapacity(output) < size) {
+    return -size;
+  }
+  memcpy(address, pending_output->data(), size);
+  return size;
+}
+
+}  // namespace
+
+// Executes the enclave with the serialized input held in the direct buffer
+// |input| and copies the serialized output to the direct buffer |output|.
+JNIEXPORT jint JNICALL Java_com_asylo_client_EnclaveClient_enterAndRunDirect(
+    JNIEnv *env, jobject this_object, jlong client_pointer, jobject input,
+    jint offset, jint length, jobject output) {
   asylo::EnclaveClient *client =
       reinterpret_cast<asylo::EnclaveClient *>(client_pointer);
 
-  asylo::EnclaveInput enclave_native_input;
-  bool converted = asylo::jni::ConvertJavaToNativeProto(env, enclave_input,
-                                                        &enclave_native_input);
-  if (!converted) {
-    return nullptr;
+  const char *address =
+      static_cast<const char *>(env->GetDirectBufferAddress(input));
+  if (!address) {
+    asylo::jni::ThrowEnclaveException(env, "Input buffer is not direct");
+    return 0;
+  }
+  if (offset < 0 || length < 0 ||
+      env->GetDirectBufferCapacity(input) - offset < length) {
+    asylo::jni::ThrowEnclaveException(env, "Input range is out of bounds");
+    return 0;
   }
 
-  asylo::EnclaveOutput output;
-
-  asylo::Status status = client->EnterAndRun(enclave_native_input, &output);
+  asylo::Status status = client->EnterAndRunSerialized(
+      absl::string_view(address + offset, length), PendingOutput());
   if (!status.ok()) {
     asylo::jni::ThrowEnclaveException(env, status);
+    return 0;
   }
+  return CopyPendingOutput(env, output);
+}
 
-  return asylo::jni::ConvertNativeToJavaProto(env, &output, registry);
+// Copies the output of the last enclave call on this thread, which did not fit
+// in the buffer that call was given, to the direct buffer |output|.
+JNIEXPORT jint JNICALL Java_com_asylo_client_EnclaveClient_takePendingOutput(
+    JNIEnv *env, jclass clazz, jobject output) {
+  return CopyPendingOutput(env, output);
 }
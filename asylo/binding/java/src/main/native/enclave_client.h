@@ -26,12 +26,20 @@ extern "C" {
 #endif
 /*
  * Class:     com_asylo_client_EnclaveClient
- * Method:    enterAndRun
+ * Method:    enterAndRunDirect
  * Signature:
- * (JLcom/asylo/EnclaveInput;Lcom/google/protobuf/ExtensionRegistry;)Lcom/asylo/EnclaveOutput;
+ * (JLjava/nio/ByteBuffer;IILjava/nio/ByteBuffer;)I
  */
-JNIEXPORT jobject JNICALL Java_com_asylo_client_EnclaveClient_enterAndRun(
-    JNIEnv *, jobject, jlong, jobject, jobject);
+JNIEXPORT jint JNICALL Java_com_asylo_client_EnclaveClient_enterAndRunDirect(
+    JNIEnv *, jobject, jlong, jobject, jint, jint, jobject);
+
+/*
+ * Class:     com_asylo_client_EnclaveClient
+ * Method:    takePendingOutput
+ * Signature: (Ljava/nio/ByteBuffer;)I
+ */
+JNIEXPORT jint JNICALL Java_com_asylo_client_EnclaveClient_takePendingOutput(
+    JNIEnv *, jclass, jobject);
 
 #ifdef __cplusplus
 }
@@ -36,4 +36,9 @@ public class EnclaveClientTest {
     EnclaveInput input = EnclaveInput.newBuilder().build();
     assertThrows(NullPointerException.class, () -> enclaveClient.enterAndRun(input, null));
   }
+
+  @Test
+  public void testEnterAndRunSerializedNullCheck() {
+    assertThrows(NullPointerException.class, () -> enclaveClient.enterAndRunSerialized(null));
+  }
 }
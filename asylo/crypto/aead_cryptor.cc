@@ -18,6 +18,7 @@
 #include "asylo/crypto/aead_cryptor.h"
 
 #include <cstddef>
+#include <cstring>
 #include <memory>
 
 #include "absl/memory/memory.h"
@@ -100,24 +101,56 @@ Status AeadCryptor::Seal(ByteContainerView plaintext,
                          absl::Span<uint8_t> nonce,
                          absl::Span<uint8_t> ciphertext,
                          size_t *ciphertext_size) {
-  if (plaintext.size() > max_message_size_) {
-    return Status(error::GoogleError::INVALID_ARGUMENT,
-                  absl::StrCat("Plaintext size ", plaintext.size(),
-                               " exceeds maximum message size (",
-                               max_message_size_, " bytes)"));
-  }
-  if (number_of_sealed_messages_ >= max_sealed_messages_) {
-    return Status(error::GoogleError::FAILED_PRECONDITION,
-                  absl::StrCat("Reached maximum number of sealed messages (",
-                               max_sealed_messages_, ")"));
-  }
-  nonce_generator_->NextNonce(nonce);
+  ASYLO_RETURN_IF_ERROR(CheckCanSeal(plaintext.size()));
+  ASYLO_RETURN_IF_ERROR(nonce_generator_->NextNonce(nonce));
   ASYLO_RETURN_IF_ERROR(key_->Seal(plaintext, associated_data, nonce,
                                    ciphertext, ciphertext_size));
   number_of_sealed_messages_++;
   return Status::OkStatus();
 }
 
+Status AeadCryptor::SealInPlace(absl::Span<uint8_t> buffer,
+                                size_t plaintext_size,
+                                ByteContainerView associated_data,
+                                absl::Span<uint8_t> nonce,
+                                size_t *ciphertext_size) {
+  ASYLO_RETURN_IF_ERROR(CheckCanSeal(plaintext_size));
+  ASYLO_RETURN_IF_ERROR(nonce_generator_->NextNonce(nonce));
+  ASYLO_RETURN_IF_ERROR(key_->SealInPlace(buffer, plaintext_size,
+                                          associated_data, nonce,
+                                          ciphertext_size));
+  number_of_sealed_messages_++;
+  return Status::OkStatus();
+}
+
+Status AeadCryptor::SealV(absl::Span<const ByteContainerView> plaintext,
+                          ByteContainerView associated_data,
+                          absl::Span<uint8_t> nonce,
+                          absl::Span<uint8_t> ciphertext,
+                          size_t *ciphertext_size) {
+  size_t plaintext_size = 0;
+  for (const ByteContainerView &fragment : plaintext) {
+    plaintext_size += fragment.size();
+  }
+  ASYLO_RETURN_IF_ERROR(CheckCanSeal(plaintext_size));
+  if (ciphertext.size() < plaintext_size) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  absl::StrCat("Plaintext size ", plaintext_size,
+                               " exceeds ciphertext buffer size (",
+                               ciphertext.size(), " bytes)"));
+  }
+
+  uint8_t *next = ciphertext.data();
+  for (const ByteContainerView &fragment : plaintext) {
+    if (fragment.size() > 0) {
+      memcpy(next, fragment.data(), fragment.size());
+      next += fragment.size();
+    }
+  }
+  return SealInPlace(ciphertext, plaintext_size, associated_data, nonce,
+                     ciphertext_size);
+}
+
 Status AeadCryptor::Open(ByteContainerView ciphertext,
                          ByteContainerView associated_data,
                          ByteContainerView nonce, absl::Span<uint8_t> plaintext,
@@ -126,6 +159,13 @@ Status AeadCryptor::Open(ByteContainerView ciphertext,
                     plaintext_size);
 }
 
+Status AeadCryptor::OpenInPlace(absl::Span<uint8_t> buffer,
+                                ByteContainerView associated_data,
+                                ByteContainerView nonce,
+                                size_t *plaintext_size) {
+  return key_->OpenInPlace(buffer, associated_data, nonce, plaintext_size);
+}
+
 AeadCryptor::AeadCryptor(
     std::unique_ptr<AeadKey> key, size_t max_message_size,
     uint64_t max_sealed_messages,
@@ -136,4 +176,19 @@ AeadCryptor::AeadCryptor(
       nonce_generator_(std::move(nonce_generator)),
       number_of_sealed_messages_(0) {}
 
+Status AeadCryptor::CheckCanSeal(size_t plaintext_size) const {
+  if (plaintext_size > max_message_size_) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  absl::StrCat("Plaintext size ", plaintext_size,
+                               " exceeds maximum message size (",
+                               max_message_size_, " bytes)"));
+  }
+  if (number_of_sealed_messages_ >= max_sealed_messages_) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  absl::StrCat("Reached maximum number of sealed messages (",
+                               max_sealed_messages_, ")"));
+  }
+  return Status::OkStatus();
+}
+
 }  // namespace asylo
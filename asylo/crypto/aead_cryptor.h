@@ -131,11 +131,69 @@ class AeadCryptor {
               ByteContainerView nonce, absl::Span<uint8_t> plaintext,
               size_t *plaintext_size);
 
+  /// Implements the AEAD Seal operation in place.
+  ///
+  /// The plaintext is read from the first `plaintext_size` bytes of `buffer`
+  /// and overwritten with the authenticated ciphertext. `buffer.size()` must be
+  /// greater than or equal to `plaintext_size` + MaxSealOverhead(), so that the
+  /// buffer has room for the tag. The same constraints as for Seal() apply
+  /// otherwise.
+  ///
+  /// \param[in,out] buffer The plaintext, overwritten with its sealed
+  ///                 ciphertext.
+  /// \param plaintext_size The size of the plaintext at the start of `buffer`.
+  /// \param associated_data The authenticated data for the Seal() operation.
+  /// \param[out] nonce The generated nonce.
+  /// \param[out] ciphertext_size The size of the ciphertext.
+  /// \return The resulting status of the Seal() operation.
+  Status SealInPlace(absl::Span<uint8_t> buffer, size_t plaintext_size,
+                     ByteContainerView associated_data,
+                     absl::Span<uint8_t> nonce, size_t *ciphertext_size);
+
+  /// Implements the AEAD Seal operation over the concatenation of several
+  /// plaintext fragments.
+  ///
+  /// The fragments are gathered into `ciphertext` and sealed in place, so no
+  /// intermediate copy of the plaintext is made. The fragments must not overlap
+  /// `ciphertext`. The same constraints as for Seal() apply to the
+  /// concatenated plaintext.
+  ///
+  /// \param plaintext The fragments of the secret that will be sealed.
+  /// \param associated_data The authenticated data for the Seal() operation.
+  /// \param[out] nonce The generated nonce.
+  /// \param[out] ciphertext The sealed ciphertext of the concatenated
+  ///             fragments.
+  /// \param[out] ciphertext_size The size of `ciphertext`.
+  /// \return The resulting status of the Seal() operation.
+  Status SealV(absl::Span<const ByteContainerView> plaintext,
+               ByteContainerView associated_data, absl::Span<uint8_t> nonce,
+               absl::Span<uint8_t> ciphertext, size_t *ciphertext_size);
+
+  /// Implements the AEAD Open operation in place.
+  ///
+  /// The authenticated ciphertext in `buffer` is overwritten with the
+  /// plaintext, starting at the beginning of `buffer`. The same constraints as
+  /// for Open() apply otherwise.
+  ///
+  /// \param[in,out] buffer The sealed ciphertext, overwritten with the
+  ///                 plaintext.
+  /// \param associated_data The authenticated data for the Open() operation.
+  /// \param nonce The nonce used to seal the ciphertext.
+  /// \param[out] plaintext_size The size of the plaintext.
+  /// \return The resulting status of the Open() operation.
+  Status OpenInPlace(absl::Span<uint8_t> buffer,
+                     ByteContainerView associated_data, ByteContainerView nonce,
+                     size_t *plaintext_size);
+
  private:
   AeadCryptor(std::unique_ptr<AeadKey> key, size_t max_message_size,
               uint64_t max_sealed_messages,
               std::unique_ptr<NonceGeneratorInterface> nonce_generator);
 
+  // Returns a non-OK Status if a plaintext of |plaintext_size| bytes may not
+  // be sealed.
+  Status CheckCanSeal(size_t plaintext_size) const;
+
   // The AeadKey used for Seal() and Open().
   const std::unique_ptr<AeadKey> key_;
 
@@ -128,6 +128,95 @@ TEST_P(AeadCryptorTest, OpenTest) {
             ByteContainerView(actual_plaintext));
 }
 
+TEST_P(AeadCryptorTest, InPlaceEndToEndTest) {
+  AeadTestVector test_vector = GetParam().test_vector;
+  std::unique_ptr<AeadCryptor> cryptor;
+  ASYLO_ASSERT_OK_AND_ASSIGN(cryptor, GetParam().factory(test_vector.key));
+
+  std::vector<uint8_t> buffer(test_vector.plaintext.cbegin(),
+                              test_vector.plaintext.cend());
+  buffer.resize(buffer.size() + cryptor->MaxSealOverhead());
+  std::vector<uint8_t> actual_nonce(cryptor->NonceSize());
+  size_t actual_ciphertext_size;
+  ASYLO_ASSERT_OK(cryptor->SealInPlace(
+      absl::MakeSpan(buffer), test_vector.plaintext.size(), test_vector.aad,
+      absl::MakeSpan(actual_nonce), &actual_ciphertext_size));
+  buffer.resize(actual_ciphertext_size);
+
+  // The in-place ciphertext opens like any other.
+  CleansingVector<uint8_t> actual_plaintext(buffer.size());
+  size_t actual_plaintext_size;
+  ASYLO_ASSERT_OK(cryptor->Open(buffer, test_vector.aad, actual_nonce,
+                                absl::MakeSpan(actual_plaintext),
+                                &actual_plaintext_size));
+  actual_plaintext.resize(actual_plaintext_size);
+  EXPECT_EQ(ByteContainerView(test_vector.plaintext),
+            ByteContainerView(actual_plaintext));
+
+  ASYLO_ASSERT_OK(cryptor->OpenInPlace(absl::MakeSpan(buffer), test_vector.aad,
+                                       actual_nonce, &actual_plaintext_size));
+  buffer.resize(actual_plaintext_size);
+  EXPECT_EQ(ByteContainerView(test_vector.plaintext),
+            ByteContainerView(buffer));
+}
+
+TEST_P(AeadCryptorTest, InPlaceOpenTest) {
+  AeadTestVector test_vector = GetParam().test_vector;
+  std::unique_ptr<AeadCryptor> cryptor;
+  ASYLO_ASSERT_OK_AND_ASSIGN(cryptor, GetParam().factory(test_vector.key));
+
+  std::vector<uint8_t> buffer(test_vector.authenticated_ciphertext.cbegin(),
+                              test_vector.authenticated_ciphertext.cend());
+  size_t actual_plaintext_size;
+  ASYLO_ASSERT_OK(cryptor->OpenInPlace(absl::MakeSpan(buffer), test_vector.aad,
+                                       test_vector.nonce,
+                                       &actual_plaintext_size));
+  buffer.resize(actual_plaintext_size);
+  EXPECT_EQ(ByteContainerView(test_vector.plaintext),
+            ByteContainerView(buffer));
+}
+
+TEST_P(AeadCryptorTest, SealVTest) {
+  AeadTestVector test_vector = GetParam().test_vector;
+  std::unique_ptr<AeadCryptor> cryptor;
+  ASYLO_ASSERT_OK_AND_ASSIGN(cryptor, GetParam().factory(test_vector.key));
+
+  // Split the plaintext into an empty fragment and two uneven halves.
+  ByteContainerView plaintext(test_vector.plaintext);
+  size_t split = plaintext.size() / 3;
+  std::vector<ByteContainerView> fragments = {
+      ByteContainerView(plaintext.data(), 0),
+      ByteContainerView(plaintext.data(), split),
+      ByteContainerView(plaintext.data() + split, plaintext.size() - split)};
+
+  std::vector<uint8_t> actual_ciphertext(plaintext.size() +
+                                         cryptor->MaxSealOverhead());
+  std::vector<uint8_t> actual_nonce(cryptor->NonceSize());
+  size_t actual_ciphertext_size;
+  ASYLO_ASSERT_OK(cryptor->SealV(fragments, test_vector.aad,
+                                 absl::MakeSpan(actual_nonce),
+                                 absl::MakeSpan(actual_ciphertext),
+                                 &actual_ciphertext_size));
+  actual_ciphertext.resize(actual_ciphertext_size);
+
+  CleansingVector<uint8_t> actual_plaintext(actual_ciphertext.size());
+  size_t actual_plaintext_size;
+  ASYLO_ASSERT_OK(cryptor->Open(actual_ciphertext, test_vector.aad,
+                                actual_nonce, absl::MakeSpan(actual_plaintext),
+                                &actual_plaintext_size));
+  actual_plaintext.resize(actual_plaintext_size);
+  EXPECT_EQ(plaintext, ByteContainerView(actual_plaintext));
+
+  // A ciphertext buffer too small to hold the plaintext is rejected before any
+  // fragment is copied.
+  std::vector<uint8_t> short_ciphertext(plaintext.size() - 1);
+  EXPECT_THAT(cryptor->SealV(fragments, test_vector.aad,
+                             absl::MakeSpan(actual_nonce),
+                             absl::MakeSpan(short_ciphertext),
+                             &actual_ciphertext_size),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
 INSTANTIATE_TEST_SUITE_P(
     AllTests, AeadCryptorTest,
     ::testing::Values(
@@ -20,12 +20,12 @@
 
 #include <openssl/aead.h>
 #include <memory>
+#include <utility>
 
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "asylo/crypto/algorithms.pb.h"
 #include "asylo/crypto/util/bssl_util.h"
-#include "asylo/util/cleanup.h"
 #include "asylo/util/status_macros.h"
 
 namespace asylo {
@@ -81,7 +81,7 @@ StatusOr<std::unique_ptr<AeadKey>> AeadKey::CreateAesGcmKey(
                   absl::StrCat("Invalid AES-GCM key length: ", key.size(),
                                " (must be 16 or 32 bytes)"));
   }
-  return absl::WrapUnique<AeadKey>(new AeadKey(scheme, key));
+  return Create(scheme, key);
 }
 
 StatusOr<std::unique_ptr<AeadKey>> AeadKey::CreateAesGcmSivKey(
@@ -92,7 +92,20 @@ StatusOr<std::unique_ptr<AeadKey>> AeadKey::CreateAesGcmSivKey(
                   absl::StrCat("Invalid AES-GCM-SIV key length: ", key.size(),
                                " (must be 16 or 32 bytes)"));
   }
-  return absl::WrapUnique<AeadKey>(new AeadKey(scheme, key));
+  return Create(scheme, key);
+}
+
+StatusOr<std::unique_ptr<AeadKey>> AeadKey::Create(AeadScheme scheme,
+                                                   ByteContainerView key) {
+  auto aead_key = absl::WrapUnique<AeadKey>(new AeadKey(scheme));
+  if (EVP_AEAD_CTX_init(aead_key->context_.get(), aead_key->aead_, key.data(),
+                        key.size(), EVP_AEAD_max_tag_len(aead_key->aead_),
+                        /*impl=*/nullptr) != 1) {
+    return Status(
+        error::GoogleError::INTERNAL,
+        absl::StrCat("EVP_AEAD_CTX_init failed: ", BsslLastErrorString()));
+  }
+  return std::move(aead_key);
 }
 
 AeadScheme AeadKey::GetAeadScheme() const { return aead_scheme_; }
@@ -104,26 +117,62 @@ size_t AeadKey::MaxSealOverhead() const { return max_seal_overhead_; }
 Status AeadKey::Seal(ByteContainerView plaintext,
                      ByteContainerView associated_data, ByteContainerView nonce,
                      absl::Span<uint8_t> ciphertext, size_t *ciphertext_size) {
+  return SealInternal(plaintext.data(), plaintext.size(), associated_data,
+                      nonce, ciphertext.data(), ciphertext.size(),
+                      ciphertext_size);
+}
+
+Status AeadKey::Open(ByteContainerView ciphertext,
+                     ByteContainerView associated_data, ByteContainerView nonce,
+                     absl::Span<uint8_t> plaintext, size_t *plaintext_size) {
+  return OpenInternal(ciphertext.data(), ciphertext.size(), associated_data,
+                      nonce, plaintext.data(), plaintext.size(),
+                      plaintext_size);
+}
+
+Status AeadKey::SealInPlace(absl::Span<uint8_t> buffer, size_t plaintext_size,
+                            ByteContainerView associated_data,
+                            ByteContainerView nonce, size_t *ciphertext_size) {
+  if (plaintext_size > buffer.size()) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  absl::StrCat("Plaintext size ", plaintext_size,
+                               " exceeds buffer size (", buffer.size(),
+                               " bytes)"));
+  }
+  return SealInternal(buffer.data(), plaintext_size, associated_data, nonce,
+                      buffer.data(), buffer.size(), ciphertext_size);
+}
+
+Status AeadKey::OpenInPlace(absl::Span<uint8_t> buffer,
+                            ByteContainerView associated_data,
+                            ByteContainerView nonce, size_t *plaintext_size) {
+  return OpenInternal(buffer.data(), buffer.size(), associated_data, nonce,
+                      buffer.data(), buffer.size(), plaintext_size);
+}
+
+AeadKey::AeadKey(AeadScheme aead_scheme)
+    : aead_(GetEvpAead(aead_scheme)),
+      aead_scheme_(aead_scheme),
+      max_seal_overhead_(EVP_AEAD_max_overhead(aead_)),
+      nonce_size_(EVP_AEAD_nonce_length(aead_)) {}
+
+Status AeadKey::CheckNonce(ByteContainerView nonce) const {
   if (nonce.size() != nonce_size_) {
     return Status(error::GoogleError::INVALID_ARGUMENT,
                   absl::StrCat("Invalid nonce length: ", nonce.size(),
                                " (must be ", nonce_size_, " bytes)"));
   }
+  return Status::OkStatus();
+}
 
-  EVP_AEAD_CTX context;
-  Cleanup cleanup_context([&context]() { EVP_AEAD_CTX_cleanup(&context); });
-
-  if (EVP_AEAD_CTX_init(&context, aead_, key_.data(), key_.size(),
-                        EVP_AEAD_max_tag_len(aead_),
-                        /*impl=*/nullptr) != 1) {
-    return Status(
-        error::GoogleError::INTERNAL,
-        absl::StrCat("EVP_AEAD_CTX_init failed: ", BsslLastErrorString()));
-  }
+Status AeadKey::SealInternal(const uint8_t *in, size_t in_size,
+                             ByteContainerView associated_data,
+                             ByteContainerView nonce, uint8_t *out,
+                             size_t max_out_size, size_t *out_size) {
+  ASYLO_RETURN_IF_ERROR(CheckNonce(nonce));
 
-  if (EVP_AEAD_CTX_seal(&context, ciphertext.data(), ciphertext_size,
-                        ciphertext.size(), nonce.data(), nonce.size(),
-                        plaintext.data(), plaintext.size(),
+  if (EVP_AEAD_CTX_seal(context_.get(), out, out_size, max_out_size,
+                        nonce.data(), nonce.size(), in, in_size,
                         associated_data.data(), associated_data.size()) != 1) {
     return Status(
         error::GoogleError::INTERNAL,
@@ -133,28 +182,14 @@ Status AeadKey::Seal(ByteContainerView plaintext,
   return Status::OkStatus();
 }
 
-Status AeadKey::Open(ByteContainerView ciphertext,
-                     ByteContainerView associated_data, ByteContainerView nonce,
-                     absl::Span<uint8_t> plaintext, size_t *plaintext_size) {
-  if (nonce.size() != nonce_size_) {
-    return Status(error::GoogleError::INVALID_ARGUMENT,
-                  absl::StrCat("Invalid nonce length: ", nonce.size(),
-                               " (must be ", nonce_size_, " bytes)"));
-  }
-
-  EVP_AEAD_CTX context;
-  Cleanup cleanup_context([&context]() { EVP_AEAD_CTX_cleanup(&context); });
-  if (EVP_AEAD_CTX_init(&context, aead_, key_.data(), key_.size(),
-                        EVP_AEAD_max_tag_len(aead_),
-                        /*impl=*/nullptr) != 1) {
-    return Status(
-        error::GoogleError::INTERNAL,
-        absl::StrCat("EVP_AEAD_CTX_init failed: ", BsslLastErrorString()));
-  }
+Status AeadKey::OpenInternal(const uint8_t *in, size_t in_size,
+                             ByteContainerView associated_data,
+                             ByteContainerView nonce, uint8_t *out,
+                             size_t max_out_size, size_t *out_size) {
+  ASYLO_RETURN_IF_ERROR(CheckNonce(nonce));
 
-  if (EVP_AEAD_CTX_open(&context, plaintext.data(), plaintext_size,
-                        plaintext.size(), nonce.data(), nonce.size(),
-                        ciphertext.data(), ciphertext.size(),
+  if (EVP_AEAD_CTX_open(context_.get(), out, out_size, max_out_size,
+                        nonce.data(), nonce.size(), in, in_size,
                         associated_data.data(), associated_data.size()) != 1) {
     return Status(
         error::GoogleError::INTERNAL,
@@ -164,11 +199,4 @@ Status AeadKey::Open(ByteContainerView ciphertext,
   return Status::OkStatus();
 }
 
-AeadKey::AeadKey(AeadScheme aead_scheme, ByteContainerView key)
-    : aead_(GetEvpAead(aead_scheme)),
-      aead_scheme_(aead_scheme),
-      key_(key.cbegin(), key.cend()),
-      max_seal_overhead_(EVP_AEAD_max_overhead(aead_)),
-      nonce_size_(EVP_AEAD_nonce_length(aead_)) {}
-
 }  // namespace asylo
@@ -24,15 +24,17 @@
 #include <memory>
 #include <vector>
 
+#include "absl/types/span.h"
 #include "asylo/crypto/algorithms.pb.h"
 #include "asylo/crypto/util/byte_container_view.h"
-#include "asylo/util/cleansing_types.h"
 #include "asylo/util/status.h"
 #include "asylo/util/statusor.h"
 
 namespace asylo {
 
 // Key used for AEAD (Authenticated Encryption with Associated Data) operations.
+// The AEAD context is initialized once when the key is created, and is shared
+// by all Seal() and Open() operations with the key.
 class AeadKey {
  public:
   // Creates an instance of AeadKey using |key| with AES-GCM. |key| must be
@@ -72,8 +74,49 @@ class AeadKey {
               ByteContainerView nonce, absl::Span<uint8_t> plaintext,
               size_t *plaintext_size);
 
+  // Implements the AEAD Seal operation in place. The plaintext is read from the
+  // first |plaintext_size| bytes of |buffer| and overwritten with the
+  // authenticated ciphertext, whose size is returned through
+  // |ciphertext_size|. |buffer|.size() must be at least |plaintext_size| +
+  // MaxSealOverhead(). |nonce|.size() must be the same as the value returned by
+  // NonceSize().
+  Status SealInPlace(absl::Span<uint8_t> buffer, size_t plaintext_size,
+                     ByteContainerView associated_data, ByteContainerView nonce,
+                     size_t *ciphertext_size);
+
+  // Implements the AEAD Open operation in place. The authenticated ciphertext
+  // in |buffer| is overwritten with the plaintext, starting at the beginning of
+  // |buffer|, and the size of the plaintext is returned through
+  // |plaintext_size|. |nonce|.size() must be the same as the value returned by
+  // NonceSize().
+  Status OpenInPlace(absl::Span<uint8_t> buffer,
+                     ByteContainerView associated_data, ByteContainerView nonce,
+                     size_t *plaintext_size);
+
  private:
-  AeadKey(AeadScheme scheme, ByteContainerView key);
+  explicit AeadKey(AeadScheme scheme);
+
+  // Creates an instance of AeadKey using |key| with |scheme|, which must be
+  // supported.
+  static StatusOr<std::unique_ptr<AeadKey>> Create(AeadScheme scheme,
+                                                   ByteContainerView key);
+
+  // Returns a non-OK status if |nonce| has an invalid size.
+  Status CheckNonce(ByteContainerView nonce) const;
+
+  // Seals the |in_size| bytes at |in| into at most |max_out_size| bytes at
+  // |out|, which may be equal to |in|.
+  Status SealInternal(const uint8_t *in, size_t in_size,
+                      ByteContainerView associated_data,
+                      ByteContainerView nonce, uint8_t *out,
+                      size_t max_out_size, size_t *out_size);
+
+  // Opens the |in_size| bytes at |in| into at most |max_out_size| bytes at
+  // |out|, which may be equal to |in|.
+  Status OpenInternal(const uint8_t *in, size_t in_size,
+                      ByteContainerView associated_data,
+                      ByteContainerView nonce, uint8_t *out,
+                      size_t max_out_size, size_t *out_size);
 
   // The object that encapsulates the AEAD algorithm.
   const EVP_AEAD *const aead_;
@@ -81,8 +124,10 @@ class AeadKey {
   // The Asylo enum representation of the AEAD algorithm used by this object.
   const AeadScheme aead_scheme_;
 
-  // The AEAD key.
-  const CleansingVector<uint8_t> key_;
+  // The AEAD context, initialized with the AEAD key. BoringSSL does not modify
+  // the context in Seal and Open operations, so it is safe to share between
+  // concurrent operations.
+  bssl::ScopedEVP_AEAD_CTX context_;
 
   // The max size of the spatial overhead for this object's Seal() operation.
   const size_t max_seal_overhead_;
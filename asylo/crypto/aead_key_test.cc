@@ -154,6 +154,35 @@ TEST_P(AeadKeyTest, AeadKeyTestVector) {
             ByteContainerView(actual_plaintext));
 }
 
+// Verifies that the in-place Seal and Open methods conform to vectors from the
+// spec.
+TEST_P(AeadKeyTest, AeadKeyTestVectorInPlace) {
+  std::vector<uint8_t> buffer(test_vector_.plaintext.cbegin(),
+                              test_vector_.plaintext.cend());
+  buffer.resize(buffer.size() + test_key_->MaxSealOverhead());
+  size_t actual_ciphertext_size;
+  ASYLO_ASSERT_OK(test_key_->SealInPlace(
+      absl::MakeSpan(buffer), test_vector_.plaintext.size(), test_vector_.aad,
+      test_vector_.nonce, &actual_ciphertext_size));
+  buffer.resize(actual_ciphertext_size);
+  EXPECT_EQ(ByteContainerView(test_vector_.authenticated_ciphertext),
+            ByteContainerView(buffer));
+
+  size_t actual_plaintext_size;
+  ASYLO_ASSERT_OK(test_key_->OpenInPlace(absl::MakeSpan(buffer),
+                                         test_vector_.aad, test_vector_.nonce,
+                                         &actual_plaintext_size));
+  buffer.resize(actual_plaintext_size);
+  EXPECT_EQ(ByteContainerView(test_vector_.plaintext),
+            ByteContainerView(buffer));
+
+  // A plaintext size exceeding the buffer is rejected.
+  EXPECT_THAT(test_key_->SealInPlace(absl::MakeSpan(buffer), buffer.size() + 1,
+                                     test_vector_.aad, test_vector_.nonce,
+                                     &actual_ciphertext_size),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
 // Verifies that Seal returns a non-OK Status with invalid inputs.
 TEST_P(AeadKeyTest, AeadKeyTestInvalidInputSeal) {
   std::vector<uint8_t> actual_ciphertext(test_vector_.plaintext.size() +
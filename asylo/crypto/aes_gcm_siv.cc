@@ -19,8 +19,11 @@
 #include "asylo/crypto/aes_gcm_siv.h"
 
 #include <openssl/rand.h>
+#include <openssl/sha.h>
 #include <string>
+#include <utility>
 
+#include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "asylo/crypto/util/bssl_util.h"
 #include "asylo/util/status.h"
@@ -37,4 +40,25 @@ Status AesGcmSivNonceGenerator::NextNonce(
   return Status::OkStatus();
 }
 
+StatusOr<std::unique_ptr<AesGcmSivKeyedCryptor>> AesGcmSivKeyedCryptor::Create(
+    ByteContainerView key, size_t message_size_limit,
+    std::unique_ptr<NonceGenerator<kAesGcmSivNonceSize>> nonce_generator) {
+  if (!nonce_generator) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "NonceGenerator must not be null");
+  }
+
+  std::unique_ptr<AeadKey> aead_key;
+  ASYLO_ASSIGN_OR_RETURN(aead_key, AeadKey::CreateAesGcmSivKey(key));
+
+  std::vector<uint8_t> key_id(SHA256_DIGEST_LENGTH);
+  if (nonce_generator->uses_key_id()) {
+    ::SHA256(key.data(), key.size(), key_id.data());
+  }
+
+  return absl::WrapUnique(new AesGcmSivKeyedCryptor(
+      std::move(aead_key), std::move(key_id), message_size_limit,
+      std::move(nonce_generator)));
+}
+
 }  // namespace asylo
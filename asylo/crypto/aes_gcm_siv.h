@@ -22,12 +22,16 @@
 #include <openssl/evp.h>
 #include <openssl/sha.h>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "absl/base/macros.h"
 #include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "asylo/crypto/aead_key.h"
 #include "asylo/crypto/nonce_generator.h"
 #include "asylo/crypto/util/bssl_util.h"
+#include "asylo/crypto/util/byte_container_view.h"
 #include "asylo/crypto/util/bytes.h"
 #include "asylo/util/logging.h"
 #include "asylo/util/cleansing_types.h"
@@ -149,8 +153,8 @@ class AesGcmSivCryptor {
     UnsafeBytes<kAesGcmSivNonceSize> nonce_copy;
     std::vector<uint8_t> key_id(SHA256_DIGEST_LENGTH);
     if (nonce_generator_->uses_key_id()) {
-      SHA256(reinterpret_cast<const uint8_t *>(key.data()), key.size(),
-             key_id.data());
+      ::SHA256(reinterpret_cast<const uint8_t *>(key.data()), key.size(),
+               key_id.data());
     }
     ASYLO_RETURN_IF_ERROR(nonce_generator_->NextNonce(key_id, &nonce_copy));
     nonce->resize(nonce_copy.size());
@@ -341,6 +345,170 @@ class AesGcmSivCryptor {
   std::unique_ptr<NonceGenerator<kAesGcmSivNonceSize>> nonce_generator_;
 };
 
+/// An AES GCM SIV cryptor bound to a single key. Unlike AesGcmSivCryptor, which
+/// takes the key on every call and expands it each time, this cryptor expands
+/// the key and computes the key id passed to the NonceGenerator once, when it
+/// is created. It is meant for sealing many messages under the same key.
+///
+/// The Seal() and Open() methods accept the same byte containers as the
+/// corresponding methods of AesGcmSivCryptor, and produce the same output for
+/// the same key, nonce and inputs. If the NonceGenerator is thread-safe, then
+/// the cryptor is also thread-safe.
+///
+/// \deprecated Do not use. This class will be removed in a future release.
+class AesGcmSivKeyedCryptor {
+ public:
+  /// Creates a cryptor for `key` that enforces the input `message_size_limit`
+  /// and utilizes `nonce_generator` to generate nonces.
+  ///
+  /// \param key The encryption key, which must be 16 or 32 bytes in size.
+  /// \param message_size_limit Maximum message size supported by this cryptor.
+  /// \param nonce_generator A NonceGenerator that is used by the cryptor for
+  ///        generating nonces.
+  /// \return The cryptor, or a non-OK Status if `key` has an invalid size.
+  static StatusOr<std::unique_ptr<AesGcmSivKeyedCryptor>> Create(
+      ByteContainerView key, size_t message_size_limit,
+      std::unique_ptr<NonceGenerator<kAesGcmSivNonceSize>> nonce_generator);
+
+  AesGcmSivKeyedCryptor(const AesGcmSivKeyedCryptor &other) = delete;
+  AesGcmSivKeyedCryptor &operator=(const AesGcmSivKeyedCryptor &other) =
+      delete;
+
+  /// Implements AEAD Authenticated Encryption (a.k.a.\ seal) functionality
+  /// with the key of this cryptor.
+  ///
+  /// \param additional_data Authenticated data for the seal operation.
+  ///        `additional_data` must be a container with 1-byte `value_type`.
+  /// \param plaintext The plaintext to be encrypted. `plaintext` must be a
+  ///        container with 1-byte `value_type`.
+  /// \param[out] nonce Nonce used in this sealing operation. `nonce` must be a
+  ///             pointer to a resizable container with 1-byte `value_type`.
+  /// \param[out] ciphertext The ciphertext generated by the
+  ///             authenticated-encryption operation. `ciphertext` must be a
+  ///             resizable container with 1-byte `value_type`.
+  /// \return A non-OK Status if an error is encountered.
+  template <typename ContainerU, typename ContainerV, typename ContainerW,
+            typename ContainerX>
+  Status Seal(const ContainerU &additional_data, const ContainerV &plaintext,
+              ContainerW *nonce, ContainerX *ciphertext) {
+    static_assert(
+        sizeof(typename ContainerW::value_type) == 1,
+        "Template parameter ContainerW is not a valid byte container");
+    static_assert(
+        sizeof(typename ContainerX::value_type) == 1,
+        "Template parameter ContainerX is not a valid byte container");
+
+    if (additional_data.size() + plaintext.size() > message_size_limit_) {
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    "Message size is too large");
+    }
+
+    // Keep a local copy of the nonce so that an entity outside this function
+    // would not be able to change its value while it is being used.
+    UnsafeBytes<kAesGcmSivNonceSize> nonce_copy;
+    ASYLO_RETURN_IF_ERROR(nonce_generator_->NextNonce(key_id_, &nonce_copy));
+    nonce->resize(nonce_copy.size());
+
+    // Since the Bytes template class provides a fake resize method that does
+    // not actually change the size of the container, make sure that *|nonce|
+    // actually has the correct size.
+    if (nonce->size() != nonce_copy.size()) {
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    "Could not resize *|nonce| to correct size");
+    }
+    std::copy(nonce_copy.cbegin(), nonce_copy.cend(), nonce->begin());
+
+    std::vector<uint8_t> tmp_ciphertext(plaintext.size() +
+                                        key_->MaxSealOverhead());
+    size_t ciphertext_length = 0;
+    ASYLO_RETURN_IF_ERROR(
+        key_->Seal(plaintext, additional_data, nonce_copy,
+                   absl::MakeSpan(tmp_ciphertext), &ciphertext_length));
+
+    ciphertext->resize(ciphertext_length);
+    if (ciphertext->size() != ciphertext_length) {
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    "Could not resize *|ciphertext| to correct size");
+    }
+    std::copy(tmp_ciphertext.cbegin(),
+              tmp_ciphertext.cbegin() + ciphertext_length, ciphertext->begin());
+    return Status::OkStatus();
+  }
+
+  /// Implements AEAD Authenticated Decryption (a.k.a.\ open) functionality
+  /// with the key of this cryptor.
+  ///
+  /// \param additional_data Authenticated data for the open operation.
+  ///        `additional_data` must be a container with 1-byte `value_type`.
+  /// \param ciphertext The ciphertext to be decrypted. `ciphertext` must
+  ///        be a container with 1-byte `value_type`.
+  /// \param nonce Nonce used in this open operation. `nonce` must be a
+  ///        container with 1-byte `value_type`.
+  /// \param[out] plaintext The plaintext generated by the
+  ///             authenticated-decryption operation. `plaintext` must be a
+  ///             resizable, self-cleansing container with 1-byte `value_type`.
+  /// \return A non-OK Status if error encountered.
+  template <typename ContainerU, typename ContainerV, typename ContainerW,
+            typename ContainerX>
+  Status Open(const ContainerU &additional_data, const ContainerV &ciphertext,
+              const ContainerW &nonce, ContainerX *plaintext) {
+    static_assert(
+        sizeof(typename ContainerX::value_type) == 1,
+        "Template parameter ContainerX is not a valid byte container");
+    using PlaintextContainerT =
+        typename std::remove_reference<decltype(*plaintext)>::type;
+    using PlaintextValueT = typename PlaintextContainerT::value_type;
+    static_assert(std::is_same<typename PlaintextContainerT::allocator_type,
+                               CleansingAllocator<PlaintextValueT>>::value,
+                  "Ciphertext container must be self-cleansing");
+
+    if (nonce.size() != kAesGcmSivNonceSize) {
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    "|nonce| has incorrect length");
+    }
+
+    // Keep a local copy of the nonce so that an entity outside this function
+    // would not be able to change its value while it is being used.
+    UnsafeBytes<kAesGcmSivNonceSize> nonce_copy;
+    std::copy(nonce.cbegin(), nonce.cend(), nonce_copy.begin());
+
+    // The plaintext is sensitive, so the temporary storage is self-cleansing.
+    CleansingVector<uint8_t> tmp_plaintext(ciphertext.size());
+    size_t plaintext_length = 0;
+    ASYLO_RETURN_IF_ERROR(
+        key_->Open(ciphertext, additional_data, nonce_copy,
+                   absl::MakeSpan(tmp_plaintext), &plaintext_length));
+
+    plaintext->resize(plaintext_length);
+    if (plaintext->size() != plaintext_length) {
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    "Could not resize *|plaintext| to correct size");
+    }
+    std::copy(tmp_plaintext.cbegin(), tmp_plaintext.cbegin() + plaintext_length,
+              plaintext->begin());
+    return Status::OkStatus();
+  }
+
+ private:
+  AesGcmSivKeyedCryptor(
+      std::unique_ptr<AeadKey> key, std::vector<uint8_t> key_id,
+      size_t message_size_limit,
+      std::unique_ptr<NonceGenerator<kAesGcmSivNonceSize>> nonce_generator)
+      : key_(std::move(key)),
+        key_id_(std::move(key_id)),
+        message_size_limit_(message_size_limit),
+        nonce_generator_(std::move(nonce_generator)) {}
+
+  const std::unique_ptr<AeadKey> key_;
+
+  // SHA-256 digest of the key passed to the NonceGenerator, or all zeros if the
+  // NonceGenerator does not use key ids.
+  const std::vector<uint8_t> key_id_;
+
+  const size_t message_size_limit_;
+  const std::unique_ptr<NonceGenerator<kAesGcmSivNonceSize>> nonce_generator_;
+};
+
 }  // namespace asylo
 
 #endif  // ASYLO_CRYPTO_AES_GCM_SIV_H_
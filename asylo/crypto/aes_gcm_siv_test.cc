@@ -24,6 +24,7 @@
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include "absl/memory/memory.h"
 #include "absl/strings/escaping.h"
 #include "asylo/crypto/nonce_generator.h"
 #include "asylo/crypto/util/byte_container_view.h"
@@ -35,6 +36,8 @@
 namespace asylo {
 namespace {
 
+using ::testing::Not;
+
 // Test vector with a 128-bit key from the AES GCM SIV spec
 // (https://tools.ietf.org/html/draft-irtf-cfrg-gcmsiv-05).
 const char plaintext1_hex[] =
@@ -134,6 +137,105 @@ TEST(AesGcmSivTest, AesGcmSivTestVectors) {
   EXPECT_EQ(plaintext2, tmp_plaintext2);
 }
 
+// Verifies that AesGcmSivKeyedCryptor conforms to the test vectors from the
+// AES GCM SIV spec.
+TEST(AesGcmSivTest, KeyedCryptorTestVectors) {
+  const struct {
+    const char *plaintext_hex;
+    const char *key_hex;
+    const char *nonce_hex;
+    const char *ciphertext_hex;
+  } kVectors[] = {
+      {plaintext1_hex, key1_hex, nonce1_hex, ciphertext1_hex},
+      {plaintext2_hex, key2_hex, nonce2_hex, ciphertext2_hex},
+  };
+
+  for (const auto &vector : kVectors) {
+    std::string plaintext_bytes = absl::HexStringToBytes(vector.plaintext_hex);
+    CleansingString plaintext(plaintext_bytes.begin(), plaintext_bytes.end());
+    std::string key = absl::HexStringToBytes(vector.key_hex);
+    std::string nonce = absl::HexStringToBytes(vector.nonce_hex);
+    std::string ciphertext = absl::HexStringToBytes(vector.ciphertext_hex);
+
+    auto cryptor_result = AesGcmSivKeyedCryptor::Create(
+        key, kMessageSizeLimit, absl::make_unique<FixedNonceGenerator>(nonce));
+    ASYLO_ASSERT_OK(cryptor_result);
+    std::unique_ptr<AesGcmSivKeyedCryptor> cryptor =
+        std::move(cryptor_result).ValueOrDie();
+
+    // Seal twice to check that the cached key state is reusable.
+    for (int i = 0; i < 2; i++) {
+      std::string tmp_nonce;
+      std::string tmp_ciphertext;
+      ASSERT_THAT(cryptor->Seal(std::string(), plaintext, &tmp_nonce,
+                                &tmp_ciphertext),
+                  IsOk());
+      EXPECT_EQ(tmp_nonce, nonce);
+      EXPECT_EQ(tmp_ciphertext, ciphertext);
+    }
+
+    CleansingString tmp_plaintext;
+    ASSERT_THAT(
+        cryptor->Open(std::string(), ciphertext, nonce, &tmp_plaintext),
+        IsOk());
+    EXPECT_EQ(tmp_plaintext, plaintext);
+  }
+}
+
+// Verifies that AesGcmSivKeyedCryptor and AesGcmSivCryptor interoperate.
+TEST(AesGcmSivTest, KeyedCryptorMatchesCryptor) {
+  std::vector<uint8_t> key(32, 0x5a);
+  std::string aad = "additional data";
+  CleansingVector<uint8_t> plaintext(100, 0xa5);
+
+  auto cryptor_result = AesGcmSivKeyedCryptor::Create(
+      key, kMessageSizeLimit, absl::make_unique<AesGcmSivNonceGenerator>());
+  ASYLO_ASSERT_OK(cryptor_result);
+  std::unique_ptr<AesGcmSivKeyedCryptor> keyed_cryptor =
+      std::move(cryptor_result).ValueOrDie();
+  AesGcmSivCryptor cryptor(kMessageSizeLimit, new AesGcmSivNonceGenerator());
+
+  std::vector<uint8_t> nonce;
+  std::vector<uint8_t> ciphertext;
+  ASSERT_THAT(keyed_cryptor->Seal(aad, plaintext, &nonce, &ciphertext),
+              IsOk());
+  CleansingVector<uint8_t> decrypted;
+  ASSERT_THAT(cryptor.Open(key, aad, ciphertext, nonce, &decrypted), IsOk());
+  EXPECT_EQ(decrypted, plaintext);
+
+  ASSERT_THAT(cryptor.Seal(key, aad, plaintext, &nonce, &ciphertext), IsOk());
+  decrypted.clear();
+  ASSERT_THAT(keyed_cryptor->Open(aad, ciphertext, nonce, &decrypted),
+              IsOk());
+  EXPECT_EQ(decrypted, plaintext);
+
+  // Tampering with the ciphertext makes Open() fail.
+  ciphertext[0] ^= 1;
+  EXPECT_THAT(keyed_cryptor->Open(aad, ciphertext, nonce, &decrypted),
+              Not(IsOk()));
+}
+
+// Verifies that AesGcmSivKeyedCryptor rejects invalid keys and messages that
+// exceed the size limit.
+TEST(AesGcmSivTest, KeyedCryptorErrors) {
+  EXPECT_THAT(AesGcmSivKeyedCryptor::Create(
+                  std::string(24, 'k'), kMessageSizeLimit,
+                  absl::make_unique<AesGcmSivNonceGenerator>())
+                  .status(),
+              Not(IsOk()));
+
+  auto cryptor_result = AesGcmSivKeyedCryptor::Create(
+      std::string(16, 'k'), /*message_size_limit=*/8,
+      absl::make_unique<AesGcmSivNonceGenerator>());
+  ASYLO_ASSERT_OK(cryptor_result);
+  std::string nonce;
+  std::string ciphertext;
+  EXPECT_THAT(cryptor_result.ValueOrDie()->Seal(std::string(4, 'a'),
+                                                std::string(5, 'p'), &nonce,
+                                                &ciphertext),
+              Not(IsOk()));
+}
+
 constexpr size_t kPlaintextSize = 23;
 constexpr size_t kAdditionalDataSize = 15;
 
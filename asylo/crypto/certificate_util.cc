@@ -18,16 +18,20 @@
 
 #include "asylo/crypto/certificate_util.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <utility>
+#include <vector>
 
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
+#include "asylo/crypto/verified_certificate_cache.h"
 #include "asylo/crypto/x509_certificate.h"
 #include "asylo/identity/attestation/sgx/internal/attestation_key_certificate_impl.h"
 #include "asylo/util/proto_enum_util.h"
 #include "asylo/util/status_macros.h"
+#include "asylo/util/work_stealing_executor.h"
 
 namespace asylo {
 
@@ -150,18 +154,62 @@ StatusOr<CertificateInterfaceVector> CreateCertificateChain(
 
 Status VerifyCertificateChain(CertificateInterfaceSpan certificate_chain,
                               const VerificationConfig &verification_config) {
+  return VerifyCertificateChain(certificate_chain, verification_config,
+                                /*executor=*/nullptr);
+}
+
+Status VerifyCertificateChain(CertificateInterfaceSpan certificate_chain,
+                              const VerificationConfig &verification_config,
+                              WorkStealingExecutor *executor) {
+  return VerifyCertificateChain(certificate_chain, verification_config,
+                                executor, /*cache=*/nullptr);
+}
+
+Status VerifyCertificateChain(CertificateInterfaceSpan certificate_chain,
+                              const VerificationConfig &verification_config,
+                              WorkStealingExecutor *executor,
+                              VerifiedCertificateCache *cache) {
   if (certificate_chain.empty()) {
     return Status(error::GoogleError::INVALID_ARGUMENT,
                   "Certificate chain must include at least one certificate");
   }
 
+  // Verifies the certificate at index |i| with its issuer certificate. In the
+  // certificate list, the issuer is the certificate next in the list after the
+  // certificate being verified. The root certificate should be self-signed.
+  const size_t root_index = certificate_chain.size() - 1;
+  auto verify_certificate = [certificate_chain, root_index,
+                             &verification_config, cache](size_t i) {
+    const CertificateInterface *subject = certificate_chain[i].get();
+    const CertificateInterface *issuer =
+        certificate_chain[std::min(i + 1, root_index)].get();
+    if (cache != nullptr) {
+      return cache->Verify(*subject, *issuer, verification_config);
+    }
+    return subject->Verify(*issuer, verification_config);
+  };
+
+  // With an executor, all signatures are verified in parallel up front. The
+  // results are still checked in chain order below, so the first failure is
+  // reported exactly as by a sequential verification.
+  std::vector<Status> statuses;
+  if (executor != nullptr) {
+    statuses.resize(certificate_chain.size());
+    executor->ParallelFor(
+        0, certificate_chain.size(), /*grain=*/1,
+        [&statuses, &verify_certificate](size_t i) {
+          statuses[i] = verify_certificate(i);
+        });
+  }
+  auto certificate_status = [executor, &statuses,
+                             &verify_certificate](size_t i) {
+    return executor != nullptr ? statuses[i] : verify_certificate(i);
+  };
+
   // For each certificate in the chain (except the root), verifies the
-  // certificate with the issuer certificate. In the certificate list, the
-  // issuer is the certificate next in the list after the certificate being
-  // verified.
+  // certificate with the issuer certificate.
   int64_t ca_count = 0;
-  for (int i = 0; i < certificate_chain.size() - 1; i++) {
-    const CertificateInterface *subject = certificate_chain[i].get();
+  for (size_t i = 0; i < root_index; i++) {
     const CertificateInterface *issuer = certificate_chain[i + 1].get();
     if (verification_config.max_pathlen) {
       absl::optional<int64_t> max_pathlength = issuer->CertPathLength();
@@ -179,17 +227,14 @@ Status VerifyCertificateChain(CertificateInterfaceSpan certificate_chain,
       ca_count++;
     }
 
-    Status status = subject->Verify(*issuer, verification_config);
+    Status status = certificate_status(i);
     if (!status.ok()) {
       return status.WithPrependedContext(
           absl::StrCat("Failed to verify certificate at index ", i));
     }
   }
 
-  const CertificateInterface *root = certificate_chain.rbegin()->get();
-
-  // Root certificate should be self-signed.
-  Status status = root->Verify(*root, verification_config);
+  Status status = certificate_status(root_index);
   if (!status.ok()) {
     return status.WithPrependedContext("Failed to verify root certificate");
   }
@@ -33,6 +33,9 @@
 
 namespace asylo {
 
+class VerifiedCertificateCache;
+class WorkStealingExecutor;
+
 // A map from a CertificateFormat to the factory function to use when creating
 // CertificateInterface objects.
 using CertificateFactoryMap = absl::flat_hash_map<
@@ -103,6 +106,22 @@ StatusOr<CertificateInterfaceVector> CreateCertificateChain(
 Status VerifyCertificateChain(CertificateInterfaceSpan certificate_chain,
                               const VerificationConfig &verification_config);
 
+// Verifies |certificate_chain| as above, but verifies the signatures of all
+// certificates in parallel on the workers of |executor|. Returns the same
+// status as the sequential verification.
+Status VerifyCertificateChain(CertificateInterfaceSpan certificate_chain,
+                              const VerificationConfig &verification_config,
+                              WorkStealingExecutor *executor);
+
+// Verifies |certificate_chain| as above, but skips the signature checks of any
+// certificate whose verification with its issuer is found in |cache|, and
+// records successful verifications in |cache|. |executor| may be null to verify
+// sequentially, and |cache| may be null to verify every certificate.
+Status VerifyCertificateChain(CertificateInterfaceSpan certificate_chain,
+                              const VerificationConfig &verification_config,
+                              WorkStealingExecutor *executor,
+                              VerifiedCertificateCache *cache);
+
 // Parses PEM-encoded certificate |pem_cert| into Certificate protobuf.
 // Returns a non-OK Status if |pem_cert| is not X.509 PEM encoded.
 StatusOr<Certificate> GetCertificateFromPem(absl::string_view pem_cert);
@@ -25,15 +25,18 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "absl/memory/memory.h"
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "asylo/crypto/certificate.pb.h"
 #include "asylo/crypto/certificate_interface.h"
 #include "asylo/crypto/fake_certificate.h"
 #include "asylo/crypto/fake_certificate.pb.h"
+#include "asylo/crypto/verified_certificate_cache.h"
 #include "asylo/test/util/proto_matchers.h"
 #include "asylo/test/util/status_matchers.h"
 #include "asylo/util/proto_parse_util.h"
+#include "asylo/util/work_stealing_executor.h"
 
 namespace asylo {
 namespace {
@@ -741,6 +744,91 @@ TEST(CertificateUtilTest, VerifyCertificateChainCaValuesSet) {
   ASYLO_EXPECT_OK(VerifyCertificateChain(absl::MakeConstSpan(chain), config));
 }
 
+TEST(CertificateUtilTest, VerifyCertificateChainWithExecutorMatchesSequential) {
+  // A valid chain, a chain with a mismatched signature, and a chain exceeding
+  // the path length of an intermediate certificate.
+  std::vector<CertificateInterfaceVector> chains(3);
+  for (CertificateInterfaceVector &chain : chains) {
+    chain.emplace_back(absl::make_unique<FakeCertificate>(
+        kEndUserKey, kIntermediateKey, /*is_ca=*/absl::nullopt,
+        /*pathlength=*/absl::nullopt, /*subject_name=*/absl::nullopt));
+  }
+  chains[1][0] = absl::make_unique<FakeCertificate>(
+      kEndUserKey, kExtraIntermediateKey, /*is_ca=*/absl::nullopt,
+      /*pathlength=*/absl::nullopt, /*subject_name=*/absl::nullopt);
+  chains[2][0] = absl::make_unique<FakeCertificate>(
+      kEndUserKey, kExtraIntermediateKey, /*is_ca=*/absl::nullopt,
+      /*pathlength=*/absl::nullopt, /*subject_name=*/absl::nullopt);
+  chains[2].emplace_back(absl::make_unique<FakeCertificate>(
+      kExtraIntermediateKey, kIntermediateKey, /*is_ca=*/absl::nullopt,
+      /*pathlength=*/absl::nullopt, /*subject_name=*/absl::nullopt));
+  for (CertificateInterfaceVector &chain : chains) {
+    chain.emplace_back(absl::make_unique<FakeCertificate>(
+        kIntermediateKey, kRootKey, /*is_ca=*/absl::nullopt, /*pathlength=*/0,
+        /*subject_name=*/absl::nullopt));
+    chain.emplace_back(absl::make_unique<FakeCertificate>(
+        kRootKey, kRootKey, /*is_ca=*/absl::nullopt, /*pathlength=*/1,
+        /*subject_name=*/absl::nullopt));
+  }
+
+  WorkStealingExecutor executor(/*num_workers=*/2);
+  VerificationConfig config(/*all_fields=*/true);
+  for (const CertificateInterfaceVector &chain : chains) {
+    EXPECT_EQ(
+        VerifyCertificateChain(absl::MakeConstSpan(chain), config, &executor),
+        VerifyCertificateChain(absl::MakeConstSpan(chain), config));
+  }
+  ASYLO_EXPECT_OK(VerifyCertificateChain(absl::MakeConstSpan(chains[0]),
+                                         config, &executor));
+  EXPECT_THAT(
+      VerifyCertificateChain(absl::MakeConstSpan(chains[1]), config, &executor),
+      StatusIs(error::GoogleError::UNAUTHENTICATED));
+  EXPECT_THAT(
+      VerifyCertificateChain(absl::MakeConstSpan(chains[2]), config, &executor),
+      StatusIs(error::GoogleError::UNAUTHENTICATED));
+}
+
+TEST(CertificateUtilTest, VerifyCertificateChainWithCacheSkipsVerifiedLinks) {
+  CertificateInterfaceVector valid_chain;
+  valid_chain.emplace_back(absl::make_unique<FakeCertificate>(
+      kEndUserKey, kIntermediateKey, /*is_ca=*/absl::nullopt,
+      /*pathlength=*/absl::nullopt, /*subject_name=*/absl::nullopt));
+  valid_chain.emplace_back(absl::make_unique<FakeCertificate>(
+      kIntermediateKey, kRootKey, /*is_ca=*/absl::nullopt,
+      /*pathlength=*/absl::nullopt, /*subject_name=*/absl::nullopt));
+  valid_chain.emplace_back(absl::make_unique<FakeCertificate>(
+      kRootKey, kRootKey, /*is_ca=*/absl::nullopt,
+      /*pathlength=*/absl::nullopt, /*subject_name=*/absl::nullopt));
+
+  CertificateInterfaceVector invalid_chain;
+  invalid_chain.emplace_back(absl::make_unique<FakeCertificate>(
+      kEndUserKey, kExtraIntermediateKey, /*is_ca=*/absl::nullopt,
+      /*pathlength=*/absl::nullopt, /*subject_name=*/absl::nullopt));
+  invalid_chain.emplace_back(absl::make_unique<FakeCertificate>(
+      kIntermediateKey, kRootKey, /*is_ca=*/absl::nullopt,
+      /*pathlength=*/absl::nullopt, /*subject_name=*/absl::nullopt));
+  invalid_chain.emplace_back(absl::make_unique<FakeCertificate>(
+      kRootKey, kRootKey, /*is_ca=*/absl::nullopt,
+      /*pathlength=*/absl::nullopt, /*subject_name=*/absl::nullopt));
+
+  VerifiedCertificateCache cache(/*capacity=*/16,
+                                 /*lifetime=*/absl::InfiniteDuration());
+  VerificationConfig config(/*all_fields=*/true);
+  ASYLO_EXPECT_OK(VerifyCertificateChain(absl::MakeConstSpan(valid_chain),
+                                         config, /*executor=*/nullptr, &cache));
+  EXPECT_EQ(cache.hits(), 0);
+  EXPECT_EQ(cache.size(), valid_chain.size());
+
+  ASYLO_EXPECT_OK(VerifyCertificateChain(absl::MakeConstSpan(valid_chain),
+                                         config, /*executor=*/nullptr, &cache));
+  EXPECT_EQ(cache.hits(), valid_chain.size());
+
+  // Cached links of the chain do not hide a link that fails to verify.
+  EXPECT_THAT(VerifyCertificateChain(absl::MakeConstSpan(invalid_chain),
+                                     config, /*executor=*/nullptr, &cache),
+              StatusIs(error::GoogleError::UNAUTHENTICATED));
+}
+
 TEST(CertificateUtilTest, CreateCertificateInterfaceMissingFormat) {
   FakeCertificateProto cert_proto;
   cert_proto.set_subject_key(kRootKey);
@@ -0,0 +1,372 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Microbenchmarks for the primitives in asylo/crypto. The benchmarks are linked
+// into a test target, so they run natively and inside an enclave. They are only
+// executed when selected with --benchmarks, for example:
+//
+//   bazel run //asylo/crypto:crypto_benchmark -- --benchmarks=all
+//   bazel run //asylo/crypto:crypto_benchmark_enclave -- --benchmarks=all
+
+#include <openssl/nid.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "asylo/crypto/aead_cryptor.h"
+#include "asylo/crypto/aes_gcm_siv.h"
+#include "asylo/crypto/algorithms.pb.h"
+#include "asylo/crypto/asn1.h"
+#include "asylo/crypto/bignum_util.h"
+#include "asylo/crypto/certificate.pb.h"
+#include "asylo/crypto/certificate_interface.h"
+#include "asylo/crypto/certificate_util.h"
+#include "asylo/crypto/ecdsa_p256_sha256_signing_key.h"
+#include "asylo/crypto/rsa_oaep_encryption_key.h"
+#include "asylo/crypto/sha256_hash.h"
+#include "asylo/crypto/x509_certificate.h"
+#include "asylo/platform/crypto/gcmlib/gcm_cryptor.h"
+#include "asylo/util/cleansing_types.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/status.h"
+#include <benchmark/benchmark.h>
+
+namespace asylo {
+namespace {
+
+constexpr size_t kAesKeySize = 32;
+constexpr size_t kAesGcmSivMessageSizeLimit = 1 << 20;
+
+// Message sizes, in bytes, used by the benchmarks of symmetric primitives.
+void MessageSizes(benchmark::internal::Benchmark *benchmark) {
+  benchmark->RangeMultiplier(16)->Range(16, 64 * 1024);
+}
+
+// Returns a pseudo-random message of |size| bytes. The content of the message
+// does not influence the cost of any benchmarked operation.
+std::vector<uint8_t> MakeMessage(size_t size) {
+  std::vector<uint8_t> message(size);
+  for (size_t i = 0; i < size; i++) {
+    message[i] = static_cast<uint8_t>(i * 131 + 7);
+  }
+  return message;
+}
+
+void SetBytesProcessed(benchmark::State &state, size_t bytes_per_iteration) {
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(bytes_per_iteration));
+}
+
+std::unique_ptr<AeadCryptor> CreateAeadCryptor(AeadScheme scheme) {
+  std::vector<uint8_t> key = MakeMessage(kAesKeySize);
+  StatusOr<std::unique_ptr<AeadCryptor>> cryptor_result =
+      scheme == AES256_GCM ? AeadCryptor::CreateAesGcmCryptor(key)
+                           : AeadCryptor::CreateAesGcmSivCryptor(key);
+  ASYLO_CHECK_OK(cryptor_result.status());
+  return std::move(cryptor_result).ValueOrDie();
+}
+
+void BM_AeadCryptorSeal(benchmark::State &state, AeadScheme scheme) {
+  std::unique_ptr<AeadCryptor> cryptor = CreateAeadCryptor(scheme);
+  std::vector<uint8_t> plaintext = MakeMessage(state.range(0));
+  std::vector<uint8_t> nonce(cryptor->NonceSize());
+  std::vector<uint8_t> ciphertext(plaintext.size() +
+                                  cryptor->MaxSealOverhead());
+  size_t ciphertext_size;
+  for (auto _ : state) {
+    ASYLO_CHECK_OK(cryptor->Seal(plaintext, /*associated_data=*/"",
+                                 absl::MakeSpan(nonce),
+                                 absl::MakeSpan(ciphertext),
+                                 &ciphertext_size));
+    benchmark::DoNotOptimize(ciphertext.data());
+  }
+  SetBytesProcessed(state, plaintext.size());
+}
+BENCHMARK_CAPTURE(BM_AeadCryptorSeal, aes256_gcm, AES256_GCM)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_AeadCryptorSeal, aes256_gcm_siv, AES256_GCM_SIV)
+    ->Apply(MessageSizes);
+
+void BM_AeadCryptorOpen(benchmark::State &state, AeadScheme scheme) {
+  std::unique_ptr<AeadCryptor> cryptor = CreateAeadCryptor(scheme);
+  std::vector<uint8_t> plaintext = MakeMessage(state.range(0));
+  std::vector<uint8_t> nonce(cryptor->NonceSize());
+  std::vector<uint8_t> ciphertext(plaintext.size() +
+                                  cryptor->MaxSealOverhead());
+  size_t ciphertext_size;
+  ASYLO_CHECK_OK(cryptor->Seal(plaintext, /*associated_data=*/"",
+                               absl::MakeSpan(nonce),
+                               absl::MakeSpan(ciphertext), &ciphertext_size));
+  ciphertext.resize(ciphertext_size);
+  size_t plaintext_size;
+  for (auto _ : state) {
+    ASYLO_CHECK_OK(cryptor->Open(ciphertext, /*associated_data=*/"", nonce,
+                                 absl::MakeSpan(plaintext), &plaintext_size));
+    benchmark::DoNotOptimize(plaintext.data());
+  }
+  SetBytesProcessed(state, plaintext.size());
+}
+BENCHMARK_CAPTURE(BM_AeadCryptorOpen, aes256_gcm, AES256_GCM)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_AeadCryptorOpen, aes256_gcm_siv, AES256_GCM_SIV)
+    ->Apply(MessageSizes);
+
+void BM_AesGcmSivCryptorSeal(benchmark::State &state) {
+  AesGcmSivCryptor cryptor(kAesGcmSivMessageSizeLimit,
+                           new AesGcmSivNonceGenerator());
+  CleansingVector<uint8_t> key(kAesKeySize, 0x42);
+  std::vector<uint8_t> plaintext = MakeMessage(state.range(0));
+  std::vector<uint8_t> nonce;
+  std::vector<uint8_t> ciphertext;
+  for (auto _ : state) {
+    ASYLO_CHECK_OK(cryptor.Seal(key, std::string(), plaintext, &nonce,
+                                &ciphertext));
+  }
+  SetBytesProcessed(state, plaintext.size());
+}
+BENCHMARK(BM_AesGcmSivCryptorSeal)->Apply(MessageSizes);
+
+void BM_AesGcmSivKeyedCryptorSeal(benchmark::State &state) {
+  CleansingVector<uint8_t> key(kAesKeySize, 0x42);
+  auto cryptor_result = AesGcmSivKeyedCryptor::Create(
+      key, kAesGcmSivMessageSizeLimit,
+      absl::make_unique<AesGcmSivNonceGenerator>());
+  ASYLO_CHECK_OK(cryptor_result.status());
+  std::unique_ptr<AesGcmSivKeyedCryptor> cryptor =
+      std::move(cryptor_result).ValueOrDie();
+  std::vector<uint8_t> plaintext = MakeMessage(state.range(0));
+  std::vector<uint8_t> nonce;
+  std::vector<uint8_t> ciphertext;
+  for (auto _ : state) {
+    ASYLO_CHECK_OK(cryptor->Seal(std::string(), plaintext, &nonce,
+                                 &ciphertext));
+  }
+  SetBytesProcessed(state, plaintext.size());
+}
+BENCHMARK(BM_AesGcmSivKeyedCryptorSeal)->Apply(MessageSizes);
+
+void BM_GcmCryptorEncryptBlock(benchmark::State &state) {
+  using platform::crypto::gcmlib::GcmCryptor;
+  using platform::crypto::gcmlib::GcmCryptorKey;
+  using platform::crypto::gcmlib::kTokenLength;
+
+  GcmCryptorKey key(MakeMessage(kAesKeySize).data(), kAesKeySize);
+  std::unique_ptr<GcmCryptor> cryptor =
+      GcmCryptor::Create(state.range(0), key);
+  CHECK(cryptor != nullptr);
+  std::vector<uint8_t> plaintext = MakeMessage(state.range(0));
+  std::vector<uint8_t> ciphertext(plaintext.size());
+  uint8_t token[kTokenLength];
+  for (auto _ : state) {
+    CHECK(cryptor->EncryptBlock(plaintext.data(), token, ciphertext.data()));
+  }
+  SetBytesProcessed(state, plaintext.size());
+}
+BENCHMARK(BM_GcmCryptorEncryptBlock)->Arg(512)->Arg(4096)->Arg(64 * 1024);
+
+void BM_GcmCryptorDecryptBlock(benchmark::State &state) {
+  using platform::crypto::gcmlib::GcmCryptor;
+  using platform::crypto::gcmlib::GcmCryptorKey;
+  using platform::crypto::gcmlib::kTokenLength;
+
+  GcmCryptorKey key(MakeMessage(kAesKeySize).data(), kAesKeySize);
+  std::unique_ptr<GcmCryptor> cryptor =
+      GcmCryptor::Create(state.range(0), key);
+  CHECK(cryptor != nullptr);
+  std::vector<uint8_t> plaintext = MakeMessage(state.range(0));
+  std::vector<uint8_t> ciphertext(plaintext.size());
+  uint8_t token[kTokenLength];
+  CHECK(cryptor->EncryptBlock(plaintext.data(), token, ciphertext.data()));
+  for (auto _ : state) {
+    CHECK(cryptor->DecryptBlock(ciphertext.data(), token, plaintext.data()));
+  }
+  SetBytesProcessed(state, plaintext.size());
+}
+BENCHMARK(BM_GcmCryptorDecryptBlock)->Arg(512)->Arg(4096)->Arg(64 * 1024);
+
+void BM_Sha256Hash(benchmark::State &state) {
+  std::vector<uint8_t> message = MakeMessage(state.range(0));
+  Sha256Hash hash;
+  std::vector<uint8_t> digest;
+  for (auto _ : state) {
+    hash.Init();
+    hash.Update(message);
+    ASYLO_CHECK_OK(hash.CumulativeHash(&digest));
+  }
+  SetBytesProcessed(state, message.size());
+}
+BENCHMARK(BM_Sha256Hash)->Apply(MessageSizes);
+
+std::unique_ptr<EcdsaP256Sha256SigningKey> CreateEcdsaSigningKey() {
+  auto signing_key_result = EcdsaP256Sha256SigningKey::Create();
+  ASYLO_CHECK_OK(signing_key_result.status());
+  return std::move(signing_key_result).ValueOrDie();
+}
+
+void BM_EcdsaP256Sha256Sign(benchmark::State &state) {
+  std::unique_ptr<EcdsaP256Sha256SigningKey> signing_key =
+      CreateEcdsaSigningKey();
+  std::vector<uint8_t> message = MakeMessage(256);
+  std::vector<uint8_t> signature;
+  for (auto _ : state) {
+    ASYLO_CHECK_OK(signing_key->Sign(message, &signature));
+  }
+}
+BENCHMARK(BM_EcdsaP256Sha256Sign);
+
+void BM_EcdsaP256Sha256Verify(benchmark::State &state) {
+  std::unique_ptr<EcdsaP256Sha256SigningKey> signing_key =
+      CreateEcdsaSigningKey();
+  auto verifying_key_result = signing_key->GetVerifyingKey();
+  ASYLO_CHECK_OK(verifying_key_result.status());
+  std::unique_ptr<VerifyingKey> verifying_key =
+      std::move(verifying_key_result).ValueOrDie();
+  std::vector<uint8_t> message = MakeMessage(256);
+  std::vector<uint8_t> signature;
+  ASYLO_CHECK_OK(signing_key->Sign(message, &signature));
+  for (auto _ : state) {
+    ASYLO_CHECK_OK(verifying_key->Verify(message, signature));
+  }
+}
+BENCHMARK(BM_EcdsaP256Sha256Verify);
+
+std::unique_ptr<RsaOaepDecryptionKey> CreateRsaDecryptionKey() {
+  auto decryption_key_result =
+      RsaOaepDecryptionKey::CreateRsa3072OaepDecryptionKey(SHA256);
+  ASYLO_CHECK_OK(decryption_key_result.status());
+  return std::move(decryption_key_result).ValueOrDie();
+}
+
+void BM_RsaOaepEncrypt(benchmark::State &state) {
+  std::unique_ptr<RsaOaepDecryptionKey> decryption_key =
+      CreateRsaDecryptionKey();
+  auto encryption_key_result = decryption_key->GetEncryptionKey();
+  ASYLO_CHECK_OK(encryption_key_result.status());
+  std::unique_ptr<AsymmetricEncryptionKey> encryption_key =
+      std::move(encryption_key_result).ValueOrDie();
+  std::vector<uint8_t> plaintext = MakeMessage(kAesKeySize);
+  std::vector<uint8_t> ciphertext;
+  for (auto _ : state) {
+    ASYLO_CHECK_OK(encryption_key->Encrypt(plaintext, &ciphertext));
+  }
+}
+BENCHMARK(BM_RsaOaepEncrypt);
+
+void BM_RsaOaepDecrypt(benchmark::State &state) {
+  std::unique_ptr<RsaOaepDecryptionKey> decryption_key =
+      CreateRsaDecryptionKey();
+  auto encryption_key_result = decryption_key->GetEncryptionKey();
+  ASYLO_CHECK_OK(encryption_key_result.status());
+  std::vector<uint8_t> ciphertext;
+  ASYLO_CHECK_OK(encryption_key_result.ValueOrDie()->Encrypt(
+      MakeMessage(kAesKeySize), &ciphertext));
+  CleansingVector<uint8_t> plaintext;
+  for (auto _ : state) {
+    ASYLO_CHECK_OK(decryption_key->Decrypt(ciphertext, &plaintext));
+  }
+}
+BENCHMARK(BM_RsaOaepDecrypt);
+
+// A two-certificate chain made of a leaf certificate and the self-signed root
+// that issued it, both with ECDSA P-256 keys.
+struct TestCertificateChain {
+  std::unique_ptr<X509Certificate> leaf;
+  std::unique_ptr<X509Certificate> root;
+};
+
+X509Name CreateName(absl::string_view common_name) {
+  X509NameEntry entry;
+  entry.field = ObjectId::CreateFromNumericId(NID_commonName).ValueOrDie();
+  entry.value = std::string(common_name);
+  return {entry};
+}
+
+// Returns a certificate for |subject_key| issued by |issuer_key|.
+std::unique_ptr<X509Certificate> CreateCertificate(
+    const SigningKey &issuer_key, absl::string_view issuer,
+    const SigningKey &subject_key, absl::string_view subject, bool is_ca) {
+  auto subject_public_key_result = subject_key.GetVerifyingKey();
+  ASYLO_CHECK_OK(subject_public_key_result.status());
+  auto subject_public_key_der_result =
+      subject_public_key_result.ValueOrDie()->SerializeToDer();
+  ASYLO_CHECK_OK(subject_public_key_der_result.status());
+
+  X509CertificateBuilder builder;
+  builder.serial_number = std::move(BignumFromInteger(1)).ValueOrDie();
+  builder.issuer = CreateName(issuer);
+  builder.validity.emplace();
+  builder.validity->not_before =
+      absl::FromUnixSeconds(absl::ToUnixSeconds(absl::Now()));
+  builder.validity->not_after = builder.validity->not_before + absl::Hours(24);
+  builder.subject = CreateName(subject);
+  builder.subject_public_key_der =
+      std::move(subject_public_key_der_result).ValueOrDie();
+  builder.basic_constraints = BasicConstraints{is_ca, absl::nullopt};
+
+  auto certificate_result = builder.SignAndBuild(issuer_key);
+  ASYLO_CHECK_OK(certificate_result.status());
+  return std::move(certificate_result).ValueOrDie();
+}
+
+TestCertificateChain CreateCertificateChain() {
+  std::unique_ptr<EcdsaP256Sha256SigningKey> root_key =
+      CreateEcdsaSigningKey();
+  std::unique_ptr<EcdsaP256Sha256SigningKey> leaf_key =
+      CreateEcdsaSigningKey();
+  TestCertificateChain chain;
+  chain.root = CreateCertificate(*root_key, "Benchmark root", *root_key,
+                                 "Benchmark root", /*is_ca=*/true);
+  chain.leaf = CreateCertificate(*root_key, "Benchmark root", *leaf_key,
+                                 "Benchmark leaf", /*is_ca=*/false);
+  return chain;
+}
+
+void BM_X509CertificateCreateFromDer(benchmark::State &state) {
+  TestCertificateChain chain = CreateCertificateChain();
+  auto certificate_result =
+      chain.leaf->ToCertificateProto(Certificate::X509_DER);
+  ASYLO_CHECK_OK(certificate_result.status());
+  std::string der = certificate_result.ValueOrDie().data();
+  for (auto _ : state) {
+    auto parsed_result = X509Certificate::CreateFromDer(der);
+    ASYLO_CHECK_OK(parsed_result.status());
+  }
+}
+BENCHMARK(BM_X509CertificateCreateFromDer);
+
+void BM_VerifyCertificateChain(benchmark::State &state) {
+  TestCertificateChain test_chain = CreateCertificateChain();
+  CertificateInterfaceVector chain;
+  chain.push_back(std::move(test_chain.leaf));
+  chain.push_back(std::move(test_chain.root));
+  VerificationConfig config(/*all_fields=*/true);
+  for (auto _ : state) {
+    ASYLO_CHECK_OK(VerifyCertificateChain(chain, config));
+  }
+}
+BENCHMARK(BM_VerifyCertificateChain);
+
+}  // namespace
+}  // namespace asylo
@@ -0,0 +1,228 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/crypto/der_reader.h"
+
+#include <cstddef>
+
+namespace asylo {
+namespace {
+
+// Identifier octet bits denoting a tag number encoded in subsequent octets.
+constexpr uint8_t kHighTagNumber = 0x1f;
+
+// Maximum number of length octets accepted in the long form. Elements longer
+// than 4 GiB cannot occur in the certificates read with DerReader.
+constexpr size_t kMaxLengthOctets = 4;
+
+// Number of SEQUENCE fields between the serial number and the unique
+// identifiers of a TBSCertificate: signature, issuer, validity, subject and
+// subjectPublicKeyInfo.
+constexpr int kTbsCertificateSequenceFields = 5;
+
+// Identifier octets of the primitive, context-specific tags [1] and [2] of
+// the unique identifiers of a TBSCertificate.
+constexpr uint8_t kIssuerUniqueIdTag = 0x81;
+constexpr uint8_t kSubjectUniqueIdTag = 0x82;
+
+Status MalformedError(const char *message) {
+  return Status(error::GoogleError::INVALID_ARGUMENT,
+                absl::StrCat("Malformed DER: ", message));
+}
+
+}  // namespace
+
+Status DerReader::ReadAnyElement(uint8_t *tag, ByteContainerView *contents) {
+  if (remaining_.size() < 2) {
+    return MalformedError("truncated element header");
+  }
+  if ((remaining_[0] & kHighTagNumber) == kHighTagNumber) {
+    return MalformedError("unsupported high tag number");
+  }
+
+  size_t header_size = 2;
+  size_t length = remaining_[1];
+  if (length & 0x80) {
+    // Long form. DER forbids the indefinite form (no length octets) and
+    // requires the shortest encoding of the length.
+    size_t num_length_octets = length & 0x7f;
+    if (num_length_octets == 0 || num_length_octets > kMaxLengthOctets) {
+      return MalformedError("unsupported length encoding");
+    }
+    if (remaining_.size() < header_size + num_length_octets) {
+      return MalformedError("truncated element length");
+    }
+    if (remaining_[header_size] == 0) {
+      return MalformedError("length has leading zeros");
+    }
+    length = 0;
+    for (size_t i = 0; i < num_length_octets; i++) {
+      length = (length << 8) | remaining_[header_size + i];
+    }
+    if (length < 0x80) {
+      return MalformedError("short length in long form");
+    }
+    header_size += num_length_octets;
+  }
+  if (remaining_.size() - header_size < length) {
+    return MalformedError("truncated element contents");
+  }
+
+  *tag = remaining_[0];
+  *contents = ByteContainerView(remaining_.data() + header_size, length);
+  remaining_ = ByteContainerView(remaining_.data() + header_size + length,
+                                 remaining_.size() - header_size - length);
+  return Status::OkStatus();
+}
+
+Status DerReader::ReadElement(uint8_t tag, ByteContainerView *contents) {
+  if (!PeekTag(tag)) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  empty() ? absl::StrCat("Expected an element with tag 0x",
+                                         absl::Hex(tag), ", found end of input")
+                          : absl::StrCat("Expected an element with tag 0x",
+                                         absl::Hex(tag), ", found tag 0x",
+                                         absl::Hex(remaining_.front())));
+  }
+  uint8_t unused_tag;
+  return ReadAnyElement(&unused_tag, contents);
+}
+
+Status DerReader::ReadOptionalElement(uint8_t tag, ByteContainerView *contents,
+                                      bool *present) {
+  *present = PeekTag(tag);
+  return *present ? ReadElement(tag, contents) : Status::OkStatus();
+}
+
+Status DerReader::SkipElement(uint8_t tag) {
+  ByteContainerView unused_contents(nullptr, 0);
+  return ReadElement(tag, &unused_contents);
+}
+
+Status DerReader::ReadUint64(uint8_t tag, uint64_t *value) {
+  DerReader copy = *this;
+  ByteContainerView contents(nullptr, 0);
+  ASYLO_RETURN_IF_ERROR(copy.ReadElement(tag, &contents));
+  if (contents.empty()) {
+    return MalformedError("empty integer");
+  }
+  // DER forbids leading octets that only extend the sign.
+  if (contents.size() > 1 &&
+      ((contents[0] == 0x00 && (contents[1] & 0x80) == 0) ||
+       (contents[0] == 0xff && (contents[1] & 0x80) != 0))) {
+    return MalformedError("integer is not minimally encoded");
+  }
+  if (contents[0] & 0x80) {
+    return Status(error::GoogleError::OUT_OF_RANGE,
+                  "Expected a non-negative integer");
+  }
+
+  size_t offset = contents[0] == 0x00 ? 1 : 0;
+  if (contents.size() - offset > sizeof(uint64_t)) {
+    return Status(error::GoogleError::OUT_OF_RANGE,
+                  "Integer value does not fit in 64 bits");
+  }
+  uint64_t result = 0;
+  for (size_t i = offset; i < contents.size(); i++) {
+    result = (result << 8) | contents[i];
+  }
+  *value = result;
+  *this = copy;
+  return Status::OkStatus();
+}
+
+Status FindX509Extension(ByteContainerView certificate, ByteContainerView oid,
+                         ByteContainerView *value) {
+  // Certificate ::= SEQUENCE {
+  //     tbsCertificate       TBSCertificate,
+  //     signatureAlgorithm   AlgorithmIdentifier,
+  //     signatureValue       BIT STRING }
+  ByteContainerView certificate_contents(nullptr, 0);
+  ByteContainerView tbs_certificate(nullptr, 0);
+  DerReader certificate_reader(certificate);
+  ASYLO_RETURN_IF_ERROR(
+      certificate_reader.ReadElement(kDerSequence, &certificate_contents));
+  ASYLO_RETURN_IF_ERROR(DerReader(certificate_contents)
+                            .ReadElement(kDerSequence, &tbs_certificate));
+
+  // TBSCertificate ::= SEQUENCE {
+  //     version         [0]  EXPLICIT Version DEFAULT v1,
+  //     serialNumber         CertificateSerialNumber,
+  //     signature            AlgorithmIdentifier,
+  //     issuer               Name,
+  //     validity             Validity,
+  //     subject              Name,
+  //     subjectPublicKeyInfo SubjectPublicKeyInfo,
+  //     issuerUniqueID  [1]  IMPLICIT UniqueIdentifier OPTIONAL,
+  //     subjectUniqueID [2]  IMPLICIT UniqueIdentifier OPTIONAL,
+  //     extensions      [3]  EXPLICIT Extensions OPTIONAL }
+  //
+  // The unique identifiers are primitive BIT STRINGs with context-specific
+  // tags.
+  DerReader tbs_reader(tbs_certificate);
+  bool present;
+  ByteContainerView field(nullptr, 0);
+  ASYLO_RETURN_IF_ERROR(
+      tbs_reader.ReadOptionalElement(DerContextTag(0), &field, &present));
+  ASYLO_RETURN_IF_ERROR(tbs_reader.SkipElement(kDerInteger));
+  for (int i = 0; i < kTbsCertificateSequenceFields; i++) {
+    ASYLO_RETURN_IF_ERROR(tbs_reader.SkipElement(kDerSequence));
+  }
+  for (uint8_t unique_id_tag : {kIssuerUniqueIdTag, kSubjectUniqueIdTag}) {
+    ASYLO_RETURN_IF_ERROR(
+        tbs_reader.ReadOptionalElement(unique_id_tag, &field, &present));
+  }
+  ByteContainerView extensions_field(nullptr, 0);
+  ASYLO_RETURN_IF_ERROR(tbs_reader.ReadOptionalElement(
+      DerContextTag(3), &extensions_field, &present));
+  if (!present) {
+    return Status(error::GoogleError::NOT_FOUND,
+                  "Certificate does not contain extensions");
+  }
+
+  // Extensions ::= SEQUENCE SIZE (1..MAX) OF Extension
+  //
+  // Extension ::= SEQUENCE {
+  //     extnID      OBJECT IDENTIFIER,
+  //     critical    BOOLEAN DEFAULT FALSE,
+  //     extnValue   OCTET STRING }
+  ByteContainerView extensions(nullptr, 0);
+  ASYLO_RETURN_IF_ERROR(
+      DerReader(extensions_field).ReadElement(kDerSequence, &extensions));
+  DerReader extensions_reader(extensions);
+  while (!extensions_reader.empty()) {
+    ByteContainerView extension(nullptr, 0);
+    ByteContainerView extension_oid(nullptr, 0);
+    ASYLO_RETURN_IF_ERROR(
+        extensions_reader.ReadElement(kDerSequence, &extension));
+    DerReader extension_reader(extension);
+    ASYLO_RETURN_IF_ERROR(
+        extension_reader.ReadElement(kDerObjectId, &extension_oid));
+    if (extension_oid != oid) {
+      continue;
+    }
+    ByteContainerView critical(nullptr, 0);
+    ASYLO_RETURN_IF_ERROR(
+        extension_reader.ReadOptionalElement(kDerBoolean, &critical, &present));
+    return extension_reader.ReadElement(kDerOctetString, value);
+  }
+  return Status(error::GoogleError::NOT_FOUND,
+                "Certificate does not contain the extension");
+}
+
+}  // namespace asylo
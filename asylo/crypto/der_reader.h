@@ -0,0 +1,130 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_CRYPTO_DER_READER_H_
+#define ASYLO_CRYPTO_DER_READER_H_
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "absl/strings/str_cat.h"
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/util/status.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+
+// DER identifier octets of the ASN.1 types read with DerReader.
+constexpr uint8_t kDerBoolean = 0x01;
+constexpr uint8_t kDerInteger = 0x02;
+constexpr uint8_t kDerBitString = 0x03;
+constexpr uint8_t kDerOctetString = 0x04;
+constexpr uint8_t kDerObjectId = 0x06;
+constexpr uint8_t kDerEnumerated = 0x0a;
+constexpr uint8_t kDerSequence = 0x30;
+constexpr uint8_t kDerSet = 0x31;
+
+// Returns the identifier octet of the constructed, context-specific tag
+// [|number|], as used for the EXPLICIT fields of X.509 certificates.
+constexpr uint8_t DerContextTag(uint8_t number) { return 0xa0 | number; }
+
+// A non-owning reader of a series of DER-encoded elements. Reading an element
+// only yields a view of its contents within the input, so that nested
+// structures can be walked lazily, by reading the contents of a constructed
+// element with another DerReader, without copying data or allocating memory.
+// Only computing the message of a failed read allocates.
+//
+// DerReader only supports single-octet identifiers, that is, tag numbers below
+// 31, and checks that lengths are encoded as required by DER. The input must
+// outlive the reader and all views returned by it.
+//
+// Unless noted otherwise, methods return an INVALID_ARGUMENT error if the next
+// element is malformed or does not have the expected tag. A failed read does
+// not consume any input.
+class DerReader {
+ public:
+  explicit DerReader(ByteContainerView der) : remaining_(der) {}
+
+  // Returns true if all elements have been read.
+  bool empty() const { return remaining_.empty(); }
+
+  // Returns true if there is a next element and it has the identifier octet
+  // |tag|.
+  bool PeekTag(uint8_t tag) const {
+    return !remaining_.empty() && remaining_.front() == tag;
+  }
+
+  // Reads the next element, which must have the identifier octet |tag|, and
+  // sets |contents| to its contents.
+  Status ReadElement(uint8_t tag, ByteContainerView *contents);
+
+  // Reads the next element, whatever its tag, and sets |tag| and |contents| to
+  // its identifier octet and contents.
+  Status ReadAnyElement(uint8_t *tag, ByteContainerView *contents);
+
+  // Reads the next element if it has the identifier octet |tag|, as for an
+  // OPTIONAL field. Sets |present| to whether the element was read.
+  Status ReadOptionalElement(uint8_t tag, ByteContainerView *contents,
+                             bool *present);
+
+  // Skips the next element, which must have the identifier octet |tag|.
+  Status SkipElement(uint8_t tag);
+
+  // Reads the next element, which must be an INTEGER or ENUMERATED with the
+  // identifier octet |tag|, into |value|. Returns an OUT_OF_RANGE error if the
+  // value is negative or does not fit in an IntT.
+  template <typename IntT>
+  Status ReadUnsigned(uint8_t tag, IntT *value) {
+    static_assert(std::is_unsigned<IntT>::value,
+                  "ReadUnsigned() requires an unsigned integer type");
+    DerReader copy = *this;
+    uint64_t wide_value;
+    ASYLO_RETURN_IF_ERROR(copy.ReadUint64(tag, &wide_value));
+    if (wide_value > std::numeric_limits<IntT>::max()) {
+      return Status(error::GoogleError::OUT_OF_RANGE,
+                    absl::StrCat("Integer value ", wide_value,
+                                 " is too large for the expected type"));
+    }
+    *value = static_cast<IntT>(wide_value);
+    *this = copy;
+    return Status::OkStatus();
+  }
+
+ private:
+  // Reads an INTEGER or ENUMERATED that fits in a uint64_t.
+  Status ReadUint64(uint8_t tag, uint64_t *value);
+
+  // Input not yet read.
+  ByteContainerView remaining_;
+};
+
+// Finds the extension identified by the OBJECT IDENTIFIER with encoded
+// contents |oid| in the DER-encoded X.509 |certificate|, and sets |value| to a
+// view of the contents of its extnValue OCTET STRING. Returns a NOT_FOUND error
+// if |certificate| is well-formed up to its extensions but does not contain the
+// extension.
+//
+// Only the structure of the certificate is checked, not its signature or the
+// contents of the fields before the extensions.
+Status FindX509Extension(ByteContainerView certificate, ByteContainerView oid,
+                         ByteContainerView *value);
+
+}  // namespace asylo
+
+#endif  // ASYLO_CRYPTO_DER_READER_H_
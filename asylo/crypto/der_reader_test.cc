@@ -0,0 +1,174 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/crypto/der_reader.h"
+
+#include <cstdint>
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/strings/escaping.h"
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/test/util/status_matchers.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Eq;
+
+// A self-signed X.509 certificate with a critical basic constraints extension,
+// an extension with OID 1.2.840.113741.1.13.1 and value 30:03:02:01:05, and a
+// subject key identifier extension.
+constexpr char kCertificateHex[] =
+    "308201523081f9a003020102020101300a06082a8648ce3d040302300f310d300b060355"
+    "04030c0454657374301e170d3236313031343036353133385a170d333631303131303635"
+    "3133385a300f310d300b06035504030c04546573743059301306072a8648ce3d02010608"
+    "2a8648ce3d030107034200045d2f855bb7b4d05daa406b48ffe90e3131587f67e8c66810"
+    "f28a23f94cdab9367ccf868d3ced769069ebc6587ac475b30d127e14283d53eef58f277c"
+    "e8c0926aa3463044300f0603551d130101ff040530030101ff301206092a864886f84d01"
+    "0d0104053003020105301d0603551d0e04160414a3544bca020f20d928728e2872953c10"
+    "21b38e07300a06082a8648ce3d0403020348003045022100d91cf355a491f73279c5d8ad"
+    "18aa27ba5faf0cb1ff625e3ec944a5a2005ab2ad0220482325b9be57d063bd3deca8a781"
+    "97e46edbec7c0724c12ffae62757a7dcd516";
+
+// Encoded contents of the OBJECT IDENTIFIERs 1.2.840.113741.1.13.1 and
+// 2.5.29.19 (basic constraints).
+constexpr char kSgxExtensionsOidHex[] = "2a864886f84d010d01";
+constexpr char kBasicConstraintsOidHex[] = "551d13";
+
+// Encoded contents of the OBJECT IDENTIFIER 1.2.3.4.
+constexpr char kUnusedOidHex[] = "2a0304";
+
+std::string HexToBytes(absl::string_view hex) {
+  return absl::HexStringToBytes(hex);
+}
+
+TEST(DerReaderTest, ReadsNestedElements) {
+  // SEQUENCE { INTEGER 5, SEQUENCE { OCTET STRING aabb }, BOOLEAN TRUE }
+  std::string der = HexToBytes("300c02010530040402aabb0101ff");
+  DerReader reader(der);
+  ByteContainerView contents(nullptr, 0);
+  ASYLO_ASSERT_OK(reader.ReadElement(kDerSequence, &contents));
+  EXPECT_TRUE(reader.empty());
+
+  DerReader sequence(contents);
+  uint8_t integer;
+  ASYLO_ASSERT_OK(sequence.ReadUnsigned(kDerInteger, &integer));
+  EXPECT_THAT(integer, Eq(5));
+  EXPECT_TRUE(sequence.PeekTag(kDerSequence));
+  ByteContainerView inner(nullptr, 0);
+  ASYLO_ASSERT_OK(sequence.ReadElement(kDerSequence, &inner));
+  ByteContainerView octets(nullptr, 0);
+  ASYLO_ASSERT_OK(DerReader(inner).ReadElement(kDerOctetString, &octets));
+  EXPECT_THAT(octets, Eq(ByteContainerView(HexToBytes("aabb"))));
+
+  bool present;
+  ASYLO_ASSERT_OK(
+      sequence.ReadOptionalElement(kDerInteger, &contents, &present));
+  EXPECT_FALSE(present);
+  ASYLO_ASSERT_OK(
+      sequence.ReadOptionalElement(kDerBoolean, &contents, &present));
+  EXPECT_TRUE(present);
+  EXPECT_TRUE(sequence.empty());
+}
+
+TEST(DerReaderTest, ReadsLongFormLength) {
+  std::string der = HexToBytes("048180") + std::string(0x80, 'a');
+  DerReader reader(der);
+  ByteContainerView contents(nullptr, 0);
+  ASYLO_ASSERT_OK(reader.ReadElement(kDerOctetString, &contents));
+  EXPECT_THAT(contents.size(), Eq(0x80));
+  EXPECT_TRUE(reader.empty());
+}
+
+TEST(DerReaderTest, RejectsMalformedElements) {
+  for (const char *hex : {
+           "04",          // Truncated header.
+           "0403aabb",    // Truncated contents.
+           "0480aabb",    // Indefinite length.
+           "048102aabb",  // Long form for a short length.
+           "04820002aa",  // Length with a leading zero.
+           "1f0100",      // High tag number.
+       }) {
+    std::string der = HexToBytes(hex);
+    DerReader reader(der);
+    uint8_t tag;
+    ByteContainerView contents(nullptr, 0);
+    EXPECT_THAT(reader.ReadAnyElement(&tag, &contents),
+                StatusIs(error::GoogleError::INVALID_ARGUMENT))
+        << hex;
+    EXPECT_FALSE(reader.empty());
+  }
+}
+
+TEST(DerReaderTest, ReadUnsignedChecksRange) {
+  uint16_t value;
+  std::string der = HexToBytes("020200ff");
+  ASYLO_ASSERT_OK(DerReader(der).ReadUnsigned(kDerInteger, &value));
+  EXPECT_THAT(value, Eq(0xff));
+
+  der = HexToBytes("0a0101");
+  ASYLO_ASSERT_OK(DerReader(der).ReadUnsigned(kDerEnumerated, &value));
+  EXPECT_THAT(value, Eq(1));
+
+  // Negative, too large for a uint16_t, not minimally encoded, and with the
+  // wrong tag.
+  der = HexToBytes("0201ff");
+  EXPECT_THAT(DerReader(der).ReadUnsigned(kDerInteger, &value),
+              StatusIs(error::GoogleError::OUT_OF_RANGE));
+  der = HexToBytes("0203010000");
+  EXPECT_THAT(DerReader(der).ReadUnsigned(kDerInteger, &value),
+              StatusIs(error::GoogleError::OUT_OF_RANGE));
+  der = HexToBytes("02020001");
+  EXPECT_THAT(DerReader(der).ReadUnsigned(kDerInteger, &value),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  der = HexToBytes("0101ff");
+  DerReader reader(der);
+  EXPECT_THAT(reader.ReadUnsigned(kDerInteger, &value),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  EXPECT_TRUE(reader.PeekTag(kDerBoolean));
+}
+
+TEST(DerReaderTest, FindX509ExtensionFindsExtensionValue) {
+  std::string certificate = HexToBytes(kCertificateHex);
+  std::string oid = HexToBytes(kSgxExtensionsOidHex);
+  ByteContainerView value(nullptr, 0);
+  ASYLO_ASSERT_OK(FindX509Extension(certificate, oid, &value));
+  EXPECT_THAT(value, Eq(ByteContainerView(HexToBytes("3003020105"))));
+
+  // An extension with a critical field.
+  oid = HexToBytes(kBasicConstraintsOidHex);
+  ASYLO_ASSERT_OK(FindX509Extension(certificate, oid, &value));
+  EXPECT_THAT(value, Eq(ByteContainerView(HexToBytes("30030101ff"))));
+}
+
+TEST(DerReaderTest, FindX509ExtensionReportsMissingExtension) {
+  std::string certificate = HexToBytes(kCertificateHex);
+  std::string oid = HexToBytes(kUnusedOidHex);
+  ByteContainerView value(nullptr, 0);
+  EXPECT_THAT(FindX509Extension(certificate, oid, &value),
+              StatusIs(error::GoogleError::NOT_FOUND));
+
+  certificate.resize(certificate.size() / 2);
+  EXPECT_THAT(FindX509Extension(certificate, oid, &value),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace asylo
@@ -32,7 +32,13 @@
 #include <openssl/pem.h>
 #include <openssl/x509.h>
 
+#ifndef __ASYLO__
+#include <pthread.h>
+#endif  // __ASYLO__
+
+#include <atomic>
 #include <cstdint>
+#include <iterator>
 #include <utility>
 #include <vector>
 
@@ -49,12 +55,26 @@
 #include "asylo/util/proto_enum_util.h"
 #include "asylo/util/status.h"
 #include "asylo/util/status_macros.h"
+#include "asylo/util/work_stealing_executor.h"
 
 namespace asylo {
 namespace {
 
 constexpr int32_t kSignatureParamSize = 32;
 
+// Precomputed nonces are only valid for the current generation, which
+// DiscardPrecomputedNonces() advances.
+std::atomic<uint64_t> precomputed_nonce_generation(0);
+
+#ifndef __ASYLO__
+// Registers DiscardPrecomputedNonces() to run in the child of each fork.
+bool RegisterForkHandler() {
+  return pthread_atfork(
+             /*prepare=*/nullptr, /*parent=*/nullptr,
+             &EcdsaP256Sha256SigningKey::DiscardPrecomputedNonces) == 0;
+}
+#endif  // __ASYLO__
+
 // Returns an EC_KEY containing the public key corresponding to |private_key|.
 StatusOr<bssl::UniquePtr<EC_KEY>> CreatePublicKeyFromPrivateKey(
     const EC_KEY *private_key) {
@@ -474,13 +494,17 @@ Status EcdsaP256Sha256SigningKey::Sign(ByteContainerView message,
   std::vector<uint8_t> digest;
   ASYLO_RETURN_IF_ERROR(DoSha256Hash(message, &digest));
 
-  signature->resize(ECDSA_size(private_key_.get()));
-  uint32_t signature_size = 0;
-  if (!ECDSA_sign(/*type=*/0, digest.data(), digest.size(), signature->data(),
-                  &signature_size, private_key_.get())) {
+  bssl::UniquePtr<ECDSA_SIG> ecdsa_sig;
+  ASYLO_ASSIGN_OR_RETURN(ecdsa_sig, SignDigest(digest));
+
+  uint8_t *signature_data;
+  size_t signature_size;
+  if (!ECDSA_SIG_to_bytes(&signature_data, &signature_size,
+                          ecdsa_sig.get())) {
     return Status(error::GoogleError::INTERNAL, BsslLastErrorString());
   }
-  signature->resize(signature_size);
+  signature->assign(signature_data, signature_data + signature_size);
+  OPENSSL_free(signature_data);
   return Status::OkStatus();
 }
 
@@ -489,11 +513,9 @@ Status EcdsaP256Sha256SigningKey::Sign(ByteContainerView message,
   std::vector<uint8_t> digest;
   ASYLO_RETURN_IF_ERROR(DoSha256Hash(message, &digest));
 
-  bssl::UniquePtr<ECDSA_SIG> ecdsa_sig(
-      ECDSA_do_sign(digest.data(), digest.size(), private_key_.get()));
-  if (ecdsa_sig == nullptr) {
-    return Status(error::GoogleError::INTERNAL, BsslLastErrorString());
-  }
+  bssl::UniquePtr<ECDSA_SIG> ecdsa_sig;
+  ASYLO_ASSIGN_OR_RETURN(ecdsa_sig, SignDigest(digest));
+
   const BIGNUM *r_bignum;
   const BIGNUM *s_bignum;
   ECDSA_SIG_get0(ecdsa_sig.get(), &r_bignum, &s_bignum);
@@ -551,9 +573,193 @@ StatusOr<EccP256CurvePoint> EcdsaP256Sha256SigningKey::GetPublicKeyPoint()
   return public_key;
 }
 
+Status EcdsaP256Sha256SigningKey::PrecomputeNonces(
+    size_t count, WorkStealingExecutor *executor) {
+  const BN_MONT_CTX *order_mont;
+  uint64_t generation;
+  {
+    absl::MutexLock lock(&nonce_mu_);
+    DropStaleNoncesLocked();
+    generation = nonce_generation_;
+    if (!order_mont_) {
+      bssl::UniquePtr<BN_CTX> context(BN_CTX_new());
+      bssl::UniquePtr<BN_MONT_CTX> mont(BN_MONT_CTX_new());
+      if (!context || !mont ||
+          !BN_MONT_CTX_set(
+              mont.get(),
+              EC_GROUP_get0_order(EC_KEY_get0_group(private_key_.get())),
+              context.get())) {
+        return Status(error::GoogleError::INTERNAL, BsslLastErrorString());
+      }
+      order_mont_ = std::move(mont);
+    }
+    // |order_mont_| is never replaced once set, so it can be used after the
+    // lock is released.
+    order_mont = order_mont_.get();
+  }
+
+  std::vector<PrecomputedNonce> nonces(count);
+  std::vector<Status> statuses(count);
+  auto create_nonce = [this, order_mont, &nonces, &statuses](size_t i) {
+    statuses[i] = CreatePrecomputedNonce(order_mont, &nonces[i]);
+  };
+  if (executor) {
+    executor->ParallelFor(0, count, /*grain=*/1, create_nonce);
+  } else {
+    for (size_t i = 0; i < count; i++) {
+      create_nonce(i);
+    }
+  }
+  for (const Status &status : statuses) {
+    ASYLO_RETURN_IF_ERROR(status);
+  }
+
+  absl::MutexLock lock(&nonce_mu_);
+  DropStaleNoncesLocked();
+  // Nonces precomputed across a discard may be shared with another process.
+  if (nonce_generation_ != generation) {
+    return Status::OkStatus();
+  }
+  nonces_.insert(nonces_.end(), std::make_move_iterator(nonces.begin()),
+                 std::make_move_iterator(nonces.end()));
+  return Status::OkStatus();
+}
+
+size_t EcdsaP256Sha256SigningKey::precomputed_nonce_count() const {
+  absl::MutexLock lock(&nonce_mu_);
+  DropStaleNoncesLocked();
+  return nonces_.size();
+}
+
+void EcdsaP256Sha256SigningKey::DiscardPrecomputedNonces() {
+  precomputed_nonce_generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void EcdsaP256Sha256SigningKey::DropStaleNoncesLocked() const {
+  uint64_t generation =
+      precomputed_nonce_generation.load(std::memory_order_acquire);
+  if (generation != nonce_generation_) {
+    nonces_.clear();
+    nonce_generation_ = generation;
+  }
+}
+
 EcdsaP256Sha256SigningKey::EcdsaP256Sha256SigningKey(
     bssl::UniquePtr<EC_KEY> private_key, bssl::UniquePtr<EC_KEY> public_key)
     : private_key_(std::move(private_key)),
-      public_key_(std::move(public_key)) {}
+      public_key_(std::move(public_key)),
+      nonce_generation_(
+          precomputed_nonce_generation.load(std::memory_order_acquire)) {
+#ifndef __ASYLO__
+  static const bool fork_handler_registered = RegisterForkHandler();
+  (void)fork_handler_registered;
+#endif  // __ASYLO__
+}
+
+Status EcdsaP256Sha256SigningKey::CreatePrecomputedNonce(
+    const BN_MONT_CTX *order_mont, PrecomputedNonce *nonce) const {
+  const EC_GROUP *group = EC_KEY_get0_group(private_key_.get());
+  const BIGNUM *order = EC_GROUP_get0_order(group);
+  bssl::UniquePtr<BN_CTX> context(BN_CTX_new());
+  bssl::UniquePtr<BIGNUM> k(BN_new());
+  bssl::UniquePtr<BIGNUM> k_inverse(BN_new());
+  bssl::UniquePtr<BIGNUM> order_minus_two(BN_new());
+  bssl::UniquePtr<BIGNUM> x(BN_new());
+  bssl::UniquePtr<EC_POINT> point(EC_POINT_new(group));
+  nonce->r.reset(BN_new());
+  nonce->k_inverse_mont.reset(BN_new());
+  nonce->k_inverse_r_d.reset(BN_new());
+  if (!context || !k || !k_inverse || !order_minus_two || !x || !point ||
+      !nonce->r || !nonce->k_inverse_mont || !nonce->k_inverse_r_d) {
+    return Status(error::GoogleError::INTERNAL, BsslLastErrorString());
+  }
+
+  // Multiplications of the generator use the precomputed tables of the curve
+  // implementation.
+  do {
+    if (!BN_rand_range_ex(k.get(), /*min_inclusive=*/1, order) ||
+        !EC_POINT_mul(group, point.get(), k.get(), /*q=*/nullptr,
+                      /*m=*/nullptr, context.get()) ||
+        !EC_POINT_get_affine_coordinates_GFp(group, point.get(), x.get(),
+                                             /*y=*/nullptr, context.get()) ||
+        !BN_nnmod(nonce->r.get(), x.get(), order, context.get())) {
+      return Status(error::GoogleError::INTERNAL, BsslLastErrorString());
+    }
+  } while (BN_is_zero(nonce->r.get()));
+
+  // The order is prime, so k^-1 = k^(n - 2) mod n, which is computed in
+  // constant time. A Montgomery multiplication of a value in Montgomery form by
+  // a value in plain form yields the plain product.
+  if (!BN_copy(order_minus_two.get(), order) ||
+      !BN_sub_word(order_minus_two.get(), 2) ||
+      !BN_mod_exp_mont_consttime(k_inverse.get(), k.get(),
+                                 order_minus_two.get(), order, context.get(),
+                                 order_mont) ||
+      !BN_to_montgomery(nonce->k_inverse_mont.get(), k_inverse.get(),
+                        order_mont, context.get()) ||
+      !BN_mod_mul_montgomery(nonce->k_inverse_r_d.get(),
+                             nonce->k_inverse_mont.get(), nonce->r.get(),
+                             order_mont, context.get()) ||
+      !BN_to_montgomery(nonce->k_inverse_r_d.get(), nonce->k_inverse_r_d.get(),
+                        order_mont, context.get()) ||
+      !BN_mod_mul_montgomery(nonce->k_inverse_r_d.get(),
+                             nonce->k_inverse_r_d.get(),
+                             EC_KEY_get0_private_key(private_key_.get()),
+                             order_mont, context.get())) {
+    return Status(error::GoogleError::INTERNAL, BsslLastErrorString());
+  }
+  return Status::OkStatus();
+}
+
+StatusOr<bssl::UniquePtr<ECDSA_SIG>> EcdsaP256Sha256SigningKey::SignDigest(
+    const std::vector<uint8_t> &digest) const {
+  PrecomputedNonce nonce;
+  const BN_MONT_CTX *order_mont = nullptr;
+  {
+    absl::MutexLock lock(&nonce_mu_);
+    DropStaleNoncesLocked();
+    if (!nonces_.empty()) {
+      nonce = std::move(nonces_.back());
+      nonces_.pop_back();
+      order_mont = order_mont_.get();
+    }
+  }
+
+  if (order_mont) {
+    // A SHA256 digest is as long as the group order, so it only needs to be
+    // reduced, not truncated.
+    const BIGNUM *order =
+        EC_GROUP_get0_order(EC_KEY_get0_group(private_key_.get()));
+    bssl::UniquePtr<BN_CTX> context(BN_CTX_new());
+    bssl::UniquePtr<BIGNUM> digest_bignum(
+        BN_bin2bn(digest.data(), digest.size(), /*ret=*/nullptr));
+    bssl::UniquePtr<BIGNUM> z(BN_new());
+    bssl::UniquePtr<BIGNUM> s(BN_new());
+    bssl::UniquePtr<ECDSA_SIG> ecdsa_sig(ECDSA_SIG_new());
+    if (!context || !digest_bignum || !z || !s || !ecdsa_sig ||
+        !BN_nnmod(z.get(), digest_bignum.get(), order, context.get()) ||
+        !BN_mod_mul_montgomery(s.get(), nonce.k_inverse_mont.get(), z.get(),
+                               order_mont, context.get()) ||
+        !BN_mod_add_quick(s.get(), s.get(), nonce.k_inverse_r_d.get(),
+                          order)) {
+      return Status(error::GoogleError::INTERNAL, BsslLastErrorString());
+    }
+
+    // A zero s is astronomically unlikely, but is not a valid signature.
+    if (!BN_is_zero(s.get())) {
+      if (!ECDSA_SIG_set0(ecdsa_sig.get(), nonce.r.release(), s.release())) {
+        return Status(error::GoogleError::INTERNAL, BsslLastErrorString());
+      }
+      return std::move(ecdsa_sig);
+    }
+  }
+
+  bssl::UniquePtr<ECDSA_SIG> ecdsa_sig(
+      ECDSA_do_sign(digest.data(), digest.size(), private_key_.get()));
+  if (ecdsa_sig == nullptr) {
+    return Status(error::GoogleError::INTERNAL, BsslLastErrorString());
+  }
+  return std::move(ecdsa_sig);
+}
 
 }  // namespace asylo
@@ -20,12 +20,18 @@
 #define ASYLO_CRYPTO_ECDSA_P256_SHA256_SIGNING_KEY_H_
 
 #include <openssl/base.h>
+#include <openssl/bn.h>
 #include <openssl/ec.h>
+#include <openssl/ecdsa.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
 #include "asylo/crypto/keys.pb.h"
 #include "asylo/crypto/signing_key.h"
 #include "asylo/crypto/util/byte_container_view.h"
@@ -135,16 +141,72 @@ class EcdsaP256Sha256SigningKey : public SigningKey {
 
   StatusOr<EccP256CurvePoint> GetPublicKeyPoint() const;
 
+  // Precomputes |count| signing nonces and adds them to a pool drawn from by
+  // Sign(). The nonces are computed in parallel on |executor| if it is
+  // non-null. Signing with a precomputed nonce only takes a modular
+  // multiplication and addition, which makes it much cheaper than a regular
+  // signature. Each nonce is used for exactly one signature, and Sign() falls
+  // back to a regular signature once the pool is empty, so a long-lived key
+  // should refill the pool off its signing path.
+  Status PrecomputeNonces(size_t count, WorkStealingExecutor *executor);
+
+  // Returns the number of precomputed nonces left in the pool.
+  size_t precomputed_nonce_count() const;
+
+  // Discards the precomputed nonces of every EcdsaP256Sha256SigningKey, and
+  // those being precomputed, so that the parent and the child of a fork never
+  // sign with the same nonce, which would reveal the private key. Must be
+  // called in an enclave restored from a snapshot of another before it signs.
+  // Called automatically in the child of fork() on hosts.
+  static void DiscardPrecomputedNonces();
+
  private:
+  // A precomputed nonce k, stored as the values derived from it that do not
+  // depend on the message: r = x(k * G) mod n, k^-1 mod n in Montgomery form
+  // and k^-1 * r * dA mod n, where dA is the private key. The signature of a
+  // digest z is then (r, k^-1 * z + k^-1 * r * dA mod n).
+  struct PrecomputedNonce {
+    bssl::UniquePtr<BIGNUM> r;
+    bssl::UniquePtr<BIGNUM> k_inverse_mont;
+    bssl::UniquePtr<BIGNUM> k_inverse_r_d;
+  };
+
   EcdsaP256Sha256SigningKey(bssl::UniquePtr<EC_KEY> private_key,
                             bssl::UniquePtr<EC_KEY> public_key);
 
+  // Creates a fresh precomputed nonce in |nonce|, using the Montgomery
+  // context |order_mont| for the group order.
+  Status CreatePrecomputedNonce(const BN_MONT_CTX *order_mont,
+                                PrecomputedNonce *nonce) const;
+
+  // Drops the pooled nonces if DiscardPrecomputedNonces() was called since
+  // they were precomputed.
+  void DropStaleNoncesLocked() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(nonce_mu_);
+
+  // Signs the SHA256 |digest| of a message, using a precomputed nonce if one is
+  // available.
+  StatusOr<bssl::UniquePtr<ECDSA_SIG>> SignDigest(
+      const std::vector<uint8_t> &digest) const;
+
   // An ECDSA P256 private key.
   bssl::UniquePtr<EC_KEY> private_key_;
 
   // An ECDSA P256 public key that can verify signatures produced by
   // private_key_.
   bssl::UniquePtr<EC_KEY> public_key_;
+
+  mutable absl::Mutex nonce_mu_;
+
+  // Montgomery context for the group order, created by the first call to
+  // PrecomputeNonces().
+  bssl::UniquePtr<BN_MONT_CTX> order_mont_ ABSL_GUARDED_BY(nonce_mu_);
+
+  // Precomputed nonces not yet used by Sign().
+  mutable std::vector<PrecomputedNonce> nonces_ ABSL_GUARDED_BY(nonce_mu_);
+
+  // Generation of DiscardPrecomputedNonces() calls |nonces_| were
+  // precomputed in.
+  mutable uint64_t nonce_generation_ ABSL_GUARDED_BY(nonce_mu_);
 };
 
 }  // namespace asylo
@@ -46,6 +46,7 @@
 #include "asylo/test/util/status_matchers.h"
 #include "asylo/test/util/string_matchers.h"
 #include "asylo/util/cleansing_types.h"
+#include "asylo/util/work_stealing_executor.h"
 
 ABSL_FLAG(std::string, serialized_signing_key, "",
           "Hex-encoded DER-format SigningKey");
@@ -329,6 +330,35 @@ TEST_P(EcdsaP256Sha256VerifyingKeyTest, VerifyWithIncorrectSignatureFails) {
               Not(IsOk()));
 }
 
+// Verify that BatchVerify() returns the status of each verification in order,
+// with and without an executor.
+TEST_P(EcdsaP256Sha256VerifyingKeyTest, BatchVerifyReturnsStatusPerItem) {
+  std::string valid_signature(absl::HexStringToBytes(kTestSignatureHex));
+  std::string invalid_signature(absl::HexStringToBytes(kInvalidSignatureHex));
+  std::string valid_message(absl::HexStringToBytes(kTestMessageHex));
+
+  std::vector<SignedMessageView> items;
+  for (int i = 0; i < 16; i++) {
+    items.push_back({valid_message,
+                     i % 3 == 0 ? invalid_signature : valid_signature});
+  }
+
+  WorkStealingExecutor executor(/*num_workers=*/2);
+  std::vector<WorkStealingExecutor *> executors = {nullptr, &executor};
+  for (WorkStealingExecutor *batch_executor : executors) {
+    std::vector<Status> statuses =
+        verifying_key_->BatchVerify(items, batch_executor);
+    ASSERT_EQ(statuses.size(), items.size());
+    for (size_t i = 0; i < statuses.size(); i++) {
+      if (i % 3 == 0) {
+        EXPECT_THAT(statuses[i], Not(IsOk()));
+      } else {
+        ASYLO_EXPECT_OK(statuses[i]);
+      }
+    }
+  }
+}
+
 // Verify that Verify() with Signature overload does not verify a signature with
 // an incorrect signature scheme.
 TEST_P(EcdsaP256Sha256VerifyingKeyTest,
@@ -694,6 +724,53 @@ TEST_F(EcdsaP256Sha256SigningKeyTest, SignAndVerifySignatureOverloads) {
   EXPECT_THAT(verifying_key->Verify(message, signature), Not(IsOk()));
 }
 
+// Verifies that signatures made with precomputed nonces verify, and that
+// Sign() falls back to regular signatures once the pool is drained.
+TEST_F(EcdsaP256Sha256SigningKeyTest, SignWithPrecomputedNonces) {
+  constexpr size_t kNumNonces = 8;
+  WorkStealingExecutor executor(/*num_workers=*/2);
+  ASYLO_ASSERT_OK(signing_key_->PrecomputeNonces(kNumNonces / 2, nullptr));
+  ASYLO_ASSERT_OK(signing_key_->PrecomputeNonces(kNumNonces / 2, &executor));
+  EXPECT_EQ(signing_key_->precomputed_nonce_count(), kNumNonces);
+
+  std::unique_ptr<VerifyingKey> verifying_key;
+  ASYLO_ASSERT_OK_AND_ASSIGN(verifying_key, signing_key_->GetVerifyingKey());
+
+  std::string message(absl::HexStringToBytes(kTestMessageHex));
+  for (size_t i = 0; i < kNumNonces + 2; i++) {
+    std::vector<uint8_t> der_signature;
+    ASYLO_ASSERT_OK(signing_key_->Sign(message, &der_signature));
+    ASYLO_EXPECT_OK(verifying_key->Verify(message, der_signature));
+
+    Signature signature;
+    ASYLO_ASSERT_OK(signing_key_->Sign(message, &signature));
+    ASYLO_EXPECT_OK(verifying_key->Verify(message, signature));
+    signature.mutable_ecdsa_signature()->mutable_s()->back() ^= 1;
+    EXPECT_THAT(verifying_key->Verify(message, signature), Not(IsOk()));
+  }
+  EXPECT_EQ(signing_key_->precomputed_nonce_count(), 0);
+}
+
+// Verifies that discarding precomputed nonces empties the pool, and that it
+// can be refilled afterwards.
+TEST_F(EcdsaP256Sha256SigningKeyTest, DiscardPrecomputedNonces) {
+  ASYLO_ASSERT_OK(signing_key_->PrecomputeNonces(4, nullptr));
+  EXPECT_EQ(signing_key_->precomputed_nonce_count(), 4);
+
+  EcdsaP256Sha256SigningKey::DiscardPrecomputedNonces();
+  EXPECT_EQ(signing_key_->precomputed_nonce_count(), 0);
+
+  ASYLO_ASSERT_OK(signing_key_->PrecomputeNonces(2, nullptr));
+  EXPECT_EQ(signing_key_->precomputed_nonce_count(), 2);
+  std::unique_ptr<VerifyingKey> verifying_key;
+  ASYLO_ASSERT_OK_AND_ASSIGN(verifying_key, signing_key_->GetVerifyingKey());
+  std::string message(absl::HexStringToBytes(kTestMessageHex));
+  std::vector<uint8_t> signature;
+  ASYLO_ASSERT_OK(signing_key_->Sign(message, &signature));
+  ASYLO_EXPECT_OK(verifying_key->Verify(message, signature));
+  EXPECT_EQ(signing_key_->precomputed_nonce_count(), 1);
+}
+
 // Verify that SerializeToDer() and CreateFromDer() from a serialized key are
 // working correctly, and that an EcdsaP256Sha256SigningKey restored from a
 // serialized version of another EcdsaP256Sha256SigningKey can verify a
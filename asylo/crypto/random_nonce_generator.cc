@@ -20,7 +20,13 @@
 
 #include <openssl/rand.h>
 
+#ifndef __ASYLO__
+#include <pthread.h>
+#endif  // __ASYLO__
+
+#include <atomic>
 #include <cstdint>
+#include <cstring>
 #include <memory>
 
 #include "absl/memory/memory.h"
@@ -33,14 +39,77 @@ namespace {
 
 constexpr size_t kAesGcmNonceSize = 12;
 
+// Number of random bytes each thread draws from RAND_bytes() at once. Each
+// draw costs about as much as one for a single nonce, regardless of its size.
+constexpr size_t kRandomBufferSize = 4096;
+
+// Bytes buffered by a thread are only valid for the current generation, which
+// DiscardBufferedBytes() advances.
+std::atomic<uint64_t> buffer_generation(0);
+
+// Random bytes buffered by each thread, of which the last |available| bytes are
+// yet to be handed out. Trivially constructible, so the thread-local instance
+// needs no initialization guard.
+struct ThreadRandomBuffer {
+  uint8_t bytes[kRandomBufferSize];
+  size_t available;
+  uint64_t generation;
+};
+
+thread_local ThreadRandomBuffer thread_buffer;
+
+#ifndef __ASYLO__
+// Registers DiscardBufferedBytes() to run in the child of each fork.
+bool RegisterForkHandler() {
+  return pthread_atfork(/*prepare=*/nullptr, /*parent=*/nullptr,
+                        &RandomNonceGenerator::DiscardBufferedBytes) == 0;
+}
+#endif  // __ASYLO__
+
+// Fills |out| with |size| random bytes from the buffer of the calling thread,
+// refilling it if needed. Requests larger than the buffer bypass it.
+Status BufferedRandomBytes(uint8_t *out, size_t size) {
+  if (size > kRandomBufferSize) {
+    if (RAND_bytes(out, size) != 1) {
+      return Status(error::GoogleError::INTERNAL,
+                    absl::StrCat("RAND_bytes failed: ", BsslLastErrorString()));
+    }
+    return Status::OkStatus();
+  }
+  ThreadRandomBuffer *buffer = &thread_buffer;
+  uint64_t generation = buffer_generation.load(std::memory_order_acquire);
+  if (buffer->generation != generation || buffer->available < size) {
+    buffer->available = 0;
+    if (RAND_bytes(buffer->bytes, kRandomBufferSize) != 1) {
+      return Status(error::GoogleError::INTERNAL,
+                    absl::StrCat("RAND_bytes failed: ", BsslLastErrorString()));
+    }
+    buffer->available = kRandomBufferSize;
+    buffer->generation = generation;
+  }
+  uint8_t *bytes = buffer->bytes + kRandomBufferSize - buffer->available;
+  memcpy(out, bytes, size);
+  memset(bytes, 0, size);
+  buffer->available -= size;
+  return Status::OkStatus();
+}
+
 }  // namespace
 
 std::unique_ptr<RandomNonceGenerator>
 RandomNonceGenerator::CreateAesGcmNonceGenerator() {
+#ifndef __ASYLO__
+  static const bool fork_handler_registered = RegisterForkHandler();
+  (void)fork_handler_registered;
+#endif  // __ASYLO__
   return absl::WrapUnique<RandomNonceGenerator>(
       new RandomNonceGenerator(kAesGcmNonceSize));
 }
 
+void RandomNonceGenerator::DiscardBufferedBytes() {
+  buffer_generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
 size_t RandomNonceGenerator::NonceSize() const { return nonce_size_; }
 
 Status RandomNonceGenerator::NextNonce(absl::Span<uint8_t> nonce) {
@@ -49,11 +118,7 @@ Status RandomNonceGenerator::NextNonce(absl::Span<uint8_t> nonce) {
                   absl::StrCat("Invalid vector parameter size: ", nonce.size(),
                                " (vector size must be >= ", nonce_size_, ")"));
   }
-  if (RAND_bytes(nonce.data(), nonce_size_) != 1) {
-    return Status(error::GoogleError::INTERNAL,
-                  absl::StrCat("RAND_bytes failed: ", BsslLastErrorString()));
-  }
-  return Status::OkStatus();
+  return BufferedRandomBytes(nonce.data(), nonce_size_);
 }
 
 RandomNonceGenerator::RandomNonceGenerator(size_t size) : nonce_size_(size) {}
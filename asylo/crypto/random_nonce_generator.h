@@ -31,11 +31,22 @@ namespace asylo {
 // RandomNonceGenerator generates nonces whose size is configured at
 // construction. The generated nonces are uniformly distributed over the set of
 // all nonces of the chosen size.
+//
+// Each thread draws random bytes for its nonces from RAND_bytes() in large
+// chunks, which it buffers and hands out once each. Buffered bytes are
+// discarded in the child of a fork, so that the two processes never generate
+// the same nonces.
 class RandomNonceGenerator : public NonceGeneratorInterface {
  public:
   // Creates a NonceGenerator compliant with the standard for AES-GCM nonces.
   static std::unique_ptr<RandomNonceGenerator> CreateAesGcmNonceGenerator();
 
+  // Discards the random bytes buffered by all threads. Must be called in an
+  // enclave restored from a snapshot of another before it generates nonces,
+  // since the bytes buffered in the snapshot were also handed out by the
+  // original.
+  static void DiscardBufferedBytes();
+
   // From NonceGeneratorInterface.
 
   size_t NonceSize() const override;
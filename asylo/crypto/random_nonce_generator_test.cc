@@ -18,7 +18,12 @@
 
 #include "asylo/crypto/random_nonce_generator.h"
 
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include <memory>
+#include <string>
+#include <vector>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -37,6 +42,9 @@ constexpr size_t kBadNonceSize = 11;
 constexpr size_t kNoncePartSize = 4;
 constexpr size_t kNumberOfGeneratedNonces = 21;
 
+// Enough nonces to refill the buffer of random bytes several times.
+constexpr size_t kNumberOfBufferedNonces = 2000;
+
 // Tests that NonceSize() returns the correct nonce size for each factory.
 TEST(RandomNonceGeneratorTest, RandomNonceGeneratorNonceSize) {
   std::unique_ptr<RandomNonceGenerator> nonce_generator =
@@ -74,6 +82,55 @@ TEST(RandomNonceGeneratorTest, RandomNonceGeneratorGeneratesNoCollisions) {
   }
 }
 
+// Tests that whole nonces do not repeat across refills of the buffered random
+// bytes. A collision of two 96-bit nonces out of kNumberOfBufferedNonces has a
+// probability of about 2^-75.
+TEST(RandomNonceGeneratorTest, RandomNonceGeneratorNoncesAreNotReused) {
+  std::unique_ptr<RandomNonceGenerator> nonce_generator =
+      RandomNonceGenerator::CreateAesGcmNonceGenerator();
+  std::vector<uint8_t> nonce(kAesGcmNonceSize);
+  absl::flat_hash_set<std::string> generated_nonces;
+  for (size_t i = 0; i < kNumberOfBufferedNonces; i++) {
+    if (i == kNumberOfBufferedNonces / 2) {
+      RandomNonceGenerator::DiscardBufferedBytes();
+    }
+    ASYLO_ASSERT_OK(nonce_generator->NextNonce(absl::MakeSpan(nonce)));
+    EXPECT_TRUE(generated_nonces.emplace(nonce.cbegin(), nonce.cend()).second);
+  }
+}
+
+// Tests that the child of a fork does not generate the nonces its parent does
+// from the random bytes buffered before the fork.
+TEST(RandomNonceGeneratorTest, RandomNonceGeneratorForkedNoncesDiffer) {
+  std::unique_ptr<RandomNonceGenerator> nonce_generator =
+      RandomNonceGenerator::CreateAesGcmNonceGenerator();
+  std::vector<uint8_t> nonce(kAesGcmNonceSize);
+  ASYLO_ASSERT_OK(nonce_generator->NextNonce(absl::MakeSpan(nonce)));
+
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  pid_t pid = fork();
+  ASSERT_NE(pid, -1);
+  if (pid == 0) {
+    close(fds[0]);
+    bool ok = nonce_generator->NextNonce(absl::MakeSpan(nonce)).ok() &&
+              write(fds[1], nonce.data(), nonce.size()) ==
+                  static_cast<ssize_t>(nonce.size());
+    _exit(ok ? 0 : 1);
+  }
+  close(fds[1]);
+  std::vector<uint8_t> child_nonce(kAesGcmNonceSize);
+  ASSERT_EQ(read(fds[0], child_nonce.data(), child_nonce.size()),
+            static_cast<ssize_t>(child_nonce.size()));
+  close(fds[0]);
+  int wstatus;
+  ASSERT_EQ(waitpid(pid, &wstatus, 0), pid);
+  EXPECT_TRUE(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+
+  ASYLO_ASSERT_OK(nonce_generator->NextNonce(absl::MakeSpan(nonce)));
+  EXPECT_NE(nonce, child_nonce);
+}
+
 // Tests that NextNonce() returns a non-OK Status if it is given a nonce with
 // an invalid size.
 TEST(RandomNonceGeneratorTest, RandomNonceGeneratorIncorrectNonceSize) {
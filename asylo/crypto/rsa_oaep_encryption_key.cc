@@ -35,6 +35,7 @@
 #include "asylo/crypto/util/byte_container_view.h"
 #include "asylo/util/proto_enum_util.h"
 #include "asylo/util/status_macros.h"
+#include "asylo/util/work_stealing_executor.h"
 
 namespace asylo {
 namespace {
@@ -106,11 +107,12 @@ class RsaOaepOperation {
   using InitFunc = decltype(&EVP_PKEY_encrypt_init);
   using CryptoFunc = decltype(&EVP_PKEY_encrypt);
 
-  // Performs an BoringSSL EVP key crypto operation using an BoringSSL RSA
-  // object.
-  template <typename AllocatorT>
-  Status operator()(RSA *rsa, HashAlgorithm hash_alg, ByteContainerView input,
-                    std::vector<uint8_t, AllocatorT> *output) const {
+  // Creates a BoringSSL EVP key context for this operation with |rsa|, set up
+  // for OAEP padding with |hash_alg|. The context holds a reference to |rsa|,
+  // whose Montgomery and CRT values BoringSSL computes on first use and then
+  // keeps for all later operations.
+  StatusOr<bssl::UniquePtr<EVP_PKEY_CTX>> CreateContext(
+      RSA *rsa, HashAlgorithm hash_alg) const {
     const EVP_MD *md;
     ASYLO_ASSIGN_OR_RETURN(md, GetBoringSslHash(hash_alg));
 
@@ -134,6 +136,19 @@ class RsaOaepOperation {
     if (EVP_PKEY_CTX_set_rsa_oaep_md(ctx.get(), md) != 1) {
       return Status(error::GoogleError::INTERNAL, BsslLastErrorString());
     }
+    return std::move(ctx);
+  }
+
+  // Performs this operation with a copy of |context|, a context created by
+  // CreateContext(). |context| itself is not modified, so concurrent calls may
+  // share it.
+  template <typename AllocatorT>
+  Status operator()(EVP_PKEY_CTX *context, ByteContainerView input,
+                    std::vector<uint8_t, AllocatorT> *output) const {
+    bssl::UniquePtr<EVP_PKEY_CTX> ctx(EVP_PKEY_CTX_dup(context));
+    if (ctx == nullptr) {
+      return Status(error::GoogleError::INTERNAL, BsslLastErrorString());
+    }
 
     size_t out_len = 0;
     if (crypto_func_(ctx.get(), /*out=*/nullptr, &out_len, input.data(),
@@ -270,8 +285,12 @@ StatusOr<std::unique_ptr<RsaOaepEncryptionKey>> RsaOaepEncryptionKey::Create(
                   "Public key is invalid");
   }
 
+  bssl::UniquePtr<EVP_PKEY_CTX> context;
+  ASYLO_ASSIGN_OR_RETURN(
+      context, RsaOaepOperation::kEncrypt.CreateContext(public_key.get(),
+                                                        hash_alg));
   return absl::WrapUnique<RsaOaepEncryptionKey>(
-      new RsaOaepEncryptionKey(std::move(public_key), hash_alg));
+      new RsaOaepEncryptionKey(std::move(public_key), std::move(context)));
 }
 
 const RSA *RsaOaepEncryptionKey::GetRsaPublicKey() const {
@@ -294,21 +313,19 @@ StatusOr<std::string> RsaOaepEncryptionKey::SerializeToDer() const {
 
 Status RsaOaepEncryptionKey::Encrypt(ByteContainerView plaintext,
                                      std::vector<uint8_t> *ciphertext) const {
-  return RsaOaepOperation::kEncrypt(public_key_.get(), hash_alg_, plaintext,
-                                    ciphertext);
+  return RsaOaepOperation::kEncrypt(context_.get(), plaintext, ciphertext);
 }
 
-RsaOaepEncryptionKey::RsaOaepEncryptionKey(bssl::UniquePtr<RSA> public_key,
-                                           HashAlgorithm hash_alg)
-    : public_key_(std::move(public_key)), hash_alg_(hash_alg) {}
+RsaOaepEncryptionKey::RsaOaepEncryptionKey(
+    bssl::UniquePtr<RSA> public_key, bssl::UniquePtr<EVP_PKEY_CTX> context)
+    : public_key_(std::move(public_key)), context_(std::move(context)) {}
 
 StatusOr<std::unique_ptr<RsaOaepDecryptionKey>>
 RsaOaepDecryptionKey::CreateRsa3072OaepDecryptionKey(HashAlgorithm hash_alg) {
   ASYLO_RETURN_IF_ERROR(CheckHashAlgorithm(hash_alg));
   bssl::UniquePtr<RSA> private_key(RSA_new());
   ASYLO_ASSIGN_OR_RETURN(private_key, CreateRsaKey(/*number_of_bits=*/3072));
-  return absl::WrapUnique<RsaOaepDecryptionKey>(
-      new RsaOaepDecryptionKey(std::move(private_key), hash_alg));
+  return Create(std::move(private_key), hash_alg);
 }
 
 StatusOr<std::unique_ptr<RsaOaepDecryptionKey>>
@@ -323,8 +340,7 @@ RsaOaepDecryptionKey::CreateFromDer(ByteContainerView serialized_key,
   }
   ASYLO_RETURN_IF_ERROR(CheckKeySize(RSA_bits(private_key.get())));
 
-  return absl::WrapUnique<RsaOaepDecryptionKey>(
-      new RsaOaepDecryptionKey(std::move(private_key), hash_alg));
+  return Create(std::move(private_key), hash_alg);
 }
 
 AsymmetricEncryptionScheme RsaOaepDecryptionKey::GetEncryptionScheme() const {
@@ -354,12 +370,53 @@ RsaOaepDecryptionKey::GetEncryptionKey() const {
 
 Status RsaOaepDecryptionKey::Decrypt(
     ByteContainerView ciphertext, CleansingVector<uint8_t> *plaintext) const {
-  return RsaOaepOperation::kDecrypt(private_key_.get(), hash_alg_, ciphertext,
-                                    plaintext);
+  return RsaOaepOperation::kDecrypt(context_.get(), ciphertext, plaintext);
+}
+
+Status RsaOaepDecryptionKey::DecryptMany(
+    absl::Span<const ByteContainerView> ciphertexts,
+    WorkStealingExecutor *executor,
+    std::vector<CleansingVector<uint8_t>> *plaintexts) const {
+  plaintexts->clear();
+  plaintexts->resize(ciphertexts.size());
+  std::vector<Status> statuses(ciphertexts.size());
+  auto decrypt = [&](size_t i) {
+    statuses[i] = Decrypt(ciphertexts[i], &(*plaintexts)[i]);
+  };
+  if (executor == nullptr) {
+    for (size_t i = 0; i < ciphertexts.size(); ++i) {
+      decrypt(i);
+    }
+  } else {
+    executor->ParallelFor(0, ciphertexts.size(), /*grain=*/1, decrypt);
+  }
+
+  for (size_t i = 0; i < statuses.size(); ++i) {
+    if (!statuses[i].ok()) {
+      plaintexts->clear();
+      return Status(statuses[i].CanonicalCode(),
+                    absl::StrCat("Failed to decrypt ciphertext ", i, ": ",
+                                 statuses[i].error_message()));
+    }
+  }
+  return Status::OkStatus();
+}
+
+StatusOr<std::unique_ptr<RsaOaepDecryptionKey>> RsaOaepDecryptionKey::Create(
+    bssl::UniquePtr<RSA> private_key, HashAlgorithm hash_alg) {
+  bssl::UniquePtr<EVP_PKEY_CTX> context;
+  ASYLO_ASSIGN_OR_RETURN(
+      context, RsaOaepOperation::kDecrypt.CreateContext(private_key.get(),
+                                                        hash_alg));
+  return absl::WrapUnique<RsaOaepDecryptionKey>(new RsaOaepDecryptionKey(
+      std::move(private_key), hash_alg, std::move(context)));
 }
 
-RsaOaepDecryptionKey::RsaOaepDecryptionKey(bssl::UniquePtr<RSA> private_key,
-                                           HashAlgorithm hash_alg)
-    : private_key_(std::move(private_key)), hash_alg_(hash_alg) {}
+RsaOaepDecryptionKey::RsaOaepDecryptionKey(
+    bssl::UniquePtr<RSA> private_key, HashAlgorithm hash_alg,
+    bssl::UniquePtr<EVP_PKEY_CTX> context)
+    : private_key_(std::move(private_key)),
+      hash_alg_(hash_alg),
+      context_(std::move(context)) {}
 
 }  // namespace asylo
@@ -20,6 +20,7 @@
 #define ASYLO_CRYPTO_RSA_OAEP_ENCRYPTION_KEY_H_
 
 #include <openssl/base.h>
+#include <openssl/evp.h>
 #include <openssl/rsa.h>
 
 #include <cstdint>
@@ -27,11 +28,14 @@
 #include <string>
 #include <vector>
 
+#include "absl/types/span.h"
 #include "asylo/crypto/algorithms.pb.h"
 #include "asylo/crypto/asymmetric_encryption_key.h"
 #include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/util/cleansing_types.h"
 #include "asylo/util/status.h"
 #include "asylo/util/statusor.h"
+#include "asylo/util/work_stealing_executor.h"
 
 namespace asylo {
 
@@ -84,13 +88,15 @@ class RsaOaepEncryptionKey : public AsymmetricEncryptionKey {
                  std::vector<uint8_t> *ciphertext) const override;
 
  private:
-  RsaOaepEncryptionKey(bssl::UniquePtr<RSA> public_key, HashAlgorithm hash_alg);
+  RsaOaepEncryptionKey(bssl::UniquePtr<RSA> public_key,
+                       bssl::UniquePtr<EVP_PKEY_CTX> context);
 
   // An RSA public key.
   bssl::UniquePtr<RSA> public_key_;
 
-  // The hash algorithm to use with the OAEP algorithm.
-  HashAlgorithm hash_alg_;
+  // An encryption context for |public_key_| set up for OAEP padding, which
+  // each call to Encrypt() copies.
+  bssl::UniquePtr<EVP_PKEY_CTX> context_;
 };
 
 // An implementation of the AsymmetricDecryptionKey interface that uses RSA-OAEP
@@ -120,15 +126,36 @@ class RsaOaepDecryptionKey : public AsymmetricDecryptionKey {
   Status Decrypt(ByteContainerView ciphertext,
                  CleansingVector<uint8_t> *plaintext) const override;
 
+  // Decrypts each of |ciphertexts| into the element of |plaintexts| at the same
+  // index. The decryptions run in parallel on |executor|, or in sequence on
+  // the calling thread if |executor| is null. If any decryption fails, returns
+  // an error naming the first ciphertext that failed and leaves |plaintexts|
+  // empty.
+  Status DecryptMany(absl::Span<const ByteContainerView> ciphertexts,
+                     WorkStealingExecutor *executor,
+                     std::vector<CleansingVector<uint8_t>> *plaintexts) const;
+
  private:
+  // Creates a decryption key from |private_key|, using |hash_alg| for OAEP
+  // padding.
+  static StatusOr<std::unique_ptr<RsaOaepDecryptionKey>> Create(
+      bssl::UniquePtr<RSA> private_key, HashAlgorithm hash_alg);
+
   RsaOaepDecryptionKey(bssl::UniquePtr<RSA> private_key,
-                       HashAlgorithm hash_alg);
+                       HashAlgorithm hash_alg,
+                       bssl::UniquePtr<EVP_PKEY_CTX> context);
 
   // An RSA private key.
   bssl::UniquePtr<RSA> private_key_;
 
   // The hash algorithm to use with the OAEP algorithm.
   HashAlgorithm hash_alg_;
+
+  // A decryption context for |private_key_| set up for OAEP padding, which
+  // each call to Decrypt() copies. The computed Montgomery and CRT values and
+  // blinding state of the key are kept in |private_key_| and shared by all
+  // copies.
+  bssl::UniquePtr<EVP_PKEY_CTX> context_;
 };
 
 }  // namespace asylo
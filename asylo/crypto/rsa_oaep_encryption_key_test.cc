@@ -31,6 +31,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
 #include "asylo/crypto/algorithms.pb.h"
 #include "asylo/crypto/asymmetric_encryption_key.h"
 #include "asylo/crypto/keys.pb.h"
@@ -41,6 +42,7 @@
 #include "asylo/util/proto_parse_util.h"
 #include "asylo/util/status.h"
 #include "asylo/util/status_macros.h"
+#include "asylo/util/work_stealing_executor.h"
 
 namespace asylo {
 namespace {
@@ -48,8 +50,10 @@ namespace {
 using ::testing::ElementsAreArray;
 using ::testing::Eq;
 using ::testing::HasSubstr;
+using ::testing::IsEmpty;
 using ::testing::IsTrue;
 using ::testing::NotNull;
+using ::testing::SizeIs;
 using ::testing::Test;
 
 constexpr char kPlaintext[] = "secret message";
@@ -366,6 +370,73 @@ TEST(RsaOaepEncryptionKeyTest, DecryptInvalidInputFails) {
               StatusIs(error::GoogleError::INTERNAL));
 }
 
+// Encrypts |count| distinct plaintexts with |encryption_key|, returning the
+// plaintexts through |plaintexts|.
+std::vector<std::vector<uint8_t>> EncryptMany(
+    const AsymmetricEncryptionKey &encryption_key, int count,
+    std::vector<std::string> *plaintexts) {
+  std::vector<std::vector<uint8_t>> ciphertexts(count);
+  for (int i = 0; i < count; ++i) {
+    plaintexts->push_back(absl::StrCat(kPlaintext, i));
+    EXPECT_THAT(encryption_key.Encrypt(plaintexts->back(), &ciphertexts[i]),
+                IsOk());
+  }
+  return ciphertexts;
+}
+
+TEST(RsaOaepEncryptionKeyTest, DecryptManySuccess) {
+  std::unique_ptr<RsaOaepDecryptionKey> decryption_key;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      decryption_key, CreateDecryptionKeyFromTestDer(HashAlgorithm::SHA256));
+  std::unique_ptr<AsymmetricEncryptionKey> encryption_key;
+  ASYLO_ASSERT_OK_AND_ASSIGN(encryption_key,
+                             decryption_key->GetEncryptionKey());
+
+  std::vector<std::string> expected_plaintexts;
+  std::vector<std::vector<uint8_t>> ciphertexts =
+      EncryptMany(*encryption_key, /*count=*/8, &expected_plaintexts);
+  std::vector<ByteContainerView> ciphertext_views(ciphertexts.begin(),
+                                                  ciphertexts.end());
+
+  WorkStealingExecutor executor(/*num_workers=*/3);
+  std::vector<WorkStealingExecutor *> executors = {&executor, nullptr};
+  for (WorkStealingExecutor *maybe_executor : executors) {
+    std::vector<CleansingVector<uint8_t>> plaintexts;
+    ASYLO_ASSERT_OK(decryption_key->DecryptMany(ciphertext_views,
+                                                maybe_executor, &plaintexts));
+    ASSERT_THAT(plaintexts, SizeIs(expected_plaintexts.size()));
+    for (size_t i = 0; i < plaintexts.size(); ++i) {
+      EXPECT_THAT(CopyToByteContainer<std::string>(
+                      {plaintexts[i].data(), plaintexts[i].size()}),
+                  Eq(expected_plaintexts[i]));
+    }
+  }
+}
+
+TEST(RsaOaepEncryptionKeyTest, DecryptManyInvalidInputFails) {
+  std::unique_ptr<RsaOaepDecryptionKey> decryption_key;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      decryption_key, CreateDecryptionKeyFromTestDer(HashAlgorithm::SHA256));
+  std::unique_ptr<AsymmetricEncryptionKey> encryption_key;
+  ASYLO_ASSERT_OK_AND_ASSIGN(encryption_key,
+                             decryption_key->GetEncryptionKey());
+
+  std::vector<std::string> expected_plaintexts;
+  std::vector<std::vector<uint8_t>> ciphertexts =
+      EncryptMany(*encryption_key, /*count=*/4, &expected_plaintexts);
+  // Flip a bit to make one ciphertext invalid.
+  ciphertexts[2][0] ^= 1;
+  std::vector<ByteContainerView> ciphertext_views(ciphertexts.begin(),
+                                                  ciphertexts.end());
+
+  WorkStealingExecutor executor(/*num_workers=*/2);
+  std::vector<CleansingVector<uint8_t>> plaintexts;
+  EXPECT_THAT(
+      decryption_key->DecryptMany(ciphertext_views, &executor, &plaintexts),
+      StatusIs(error::GoogleError::INTERNAL, HasSubstr("ciphertext 2")));
+  EXPECT_THAT(plaintexts, IsEmpty());
+}
+
 TEST(RsaOaepEncryptionKeyTest, CreateRsa3072OaepDecryptionKeySuccess) {
   std::unique_ptr<AsymmetricDecryptionKey> decryption_key;
   ASYLO_ASSERT_OK_AND_ASSIGN(
@@ -0,0 +1,452 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/crypto/sha256_multi_buffer.h"
+
+#include <cpuid.h>
+#include <immintrin.h>
+#include <openssl/sha.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace asylo {
+namespace {
+
+static_assert(kSha256DigestLength == SHA256_DIGEST_LENGTH,
+              "Unexpected SHA-256 digest length.");
+
+// Size of a SHA-256 message block, in bytes.
+constexpr size_t kBlockSize = 64;
+
+// Number of messages hashed together by the AVX2 implementation.
+constexpr size_t kAvx2Lanes = 8;
+
+// SHA-256 initial hash value, from FIPS 180-4 section 5.3.3.
+constexpr uint32_t kInitialState[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+                                       0xa54ff53a, 0x510e527f, 0x9b05688c,
+                                       0x1f83d9ab, 0x5be0cd19};
+
+// SHA-256 round constants, from FIPS 180-4 section 4.2.2.
+alignas(16) constexpr uint32_t kRoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+uint32_t LoadBigEndian32(const uint8_t *data) {
+  uint32_t word;
+  memcpy(&word, data, sizeof(word));
+  return __builtin_bswap32(word);
+}
+
+void StoreBigEndian32(uint32_t word, uint8_t *data) {
+  word = __builtin_bswap32(word);
+  memcpy(data, &word, sizeof(word));
+}
+
+// A message made of a prefix followed by a body, together with the SHA-256
+// padding, split into blocks.
+class PaddedMessage {
+ public:
+  PaddedMessage(ByteContainerView prefix, ByteContainerView body)
+      : prefix_(prefix),
+        body_(body),
+        length_(prefix.size() + body.size()),
+        block_count_((length_ + sizeof(uint64_t)) / kBlockSize + 1) {}
+
+  size_t block_count() const { return block_count_; }
+
+  // Returns the |index|th block of the padded message. Blocks that lie within
+  // the body are read in place. Other blocks are assembled in |scratch|, which
+  // must hold kBlockSize bytes.
+  const uint8_t *Block(size_t index, uint8_t *scratch) const {
+    const size_t begin = index * kBlockSize;
+    const size_t end = begin + kBlockSize;
+    if (begin >= prefix_.size() && end <= length_) {
+      return body_.data() + (begin - prefix_.size());
+    }
+
+    memset(scratch, 0, kBlockSize);
+    if (begin < prefix_.size()) {
+      memcpy(scratch, prefix_.data() + begin,
+             std::min(prefix_.size(), end) - begin);
+    }
+    const size_t body_begin = std::max(begin, prefix_.size());
+    const size_t body_end = std::min(end, length_);
+    if (body_begin < body_end) {
+      memcpy(scratch + (body_begin - begin),
+             body_.data() + (body_begin - prefix_.size()),
+             body_end - body_begin);
+    }
+    if (length_ >= begin && length_ < end) {
+      scratch[length_ - begin] = 0x80;
+    }
+    if (index + 1 == block_count_) {
+      const uint64_t length_bits = static_cast<uint64_t>(length_) * 8;
+      StoreBigEndian32(static_cast<uint32_t>(length_bits >> 32),
+                       scratch + kBlockSize - 8);
+      StoreBigEndian32(static_cast<uint32_t>(length_bits),
+                       scratch + kBlockSize - 4);
+    }
+    return scratch;
+  }
+
+ private:
+  const ByteContainerView prefix_;
+  const ByteContainerView body_;
+  const size_t length_;
+  const size_t block_count_;
+};
+
+bool CpuSupportsShaNi() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+    return false;
+  }
+  // Bits 9 and 19 of ECX are set => machine supports SSSE3 and SSE4.1.
+  if (!(ecx & (1 << 9)) || !(ecx & (1 << 19))) {
+    return false;
+  }
+  if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+    return false;
+  }
+  // Bit 29 of EBX is set => machine supports the SHA extensions.
+  return !!(ebx & (1 << 29));
+}
+
+bool CpuSupportsAvx2() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+    return false;
+  }
+  // Bits 27 and 28 of ECX are set => the OS uses XSAVE and machine supports
+  // AVX.
+  if (!(ecx & (1 << 27)) || !(ecx & (1 << 28))) {
+    return false;
+  }
+  // Bits 1 and 2 of XCR0 are set => the OS saves the SSE and AVX state.
+  uint32_t xcr0_low, xcr0_high;
+  __asm__ volatile("xgetbv" : "=a"(xcr0_low), "=d"(xcr0_high) : "c"(0));
+  if ((xcr0_low & 0x6) != 0x6) {
+    return false;
+  }
+  if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+    return false;
+  }
+  // Bit 5 of EBX is set => machine supports AVX2.
+  return !!(ebx & (1 << 5));
+}
+
+void HashGeneric(ByteContainerView prefix, ByteContainerView body,
+                 uint8_t *digest) {
+  SHA256_CTX context;
+  SHA256_Init(&context);
+  SHA256_Update(&context, prefix.data(), prefix.size());
+  SHA256_Update(&context, body.data(), body.size());
+  SHA256_Final(digest, &context);
+}
+
+// Hashes |kStreams| messages of the same number of blocks with the SHA
+// extensions. SHA256RNDS2 has a long latency, so interleaving the rounds of
+// independent messages keeps the SHA unit busy. The state is kept in the ABEF
+// and CDGH word order expected by SHA256RNDS2 throughout.
+template <size_t kStreams>
+__attribute__((target("sha,sse4.1"))) void HashShaNi(
+    const PaddedMessage *messages, uint8_t *const *digests) {
+  const __m128i byte_swap =
+      _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+  __m128i abcd = _mm_loadu_si128(reinterpret_cast<const __m128i *>(
+      &kInitialState[0]));
+  __m128i efgh = _mm_loadu_si128(reinterpret_cast<const __m128i *>(
+      &kInitialState[4]));
+  abcd = _mm_shuffle_epi32(abcd, 0xb1);  // CDAB
+  efgh = _mm_shuffle_epi32(efgh, 0x1b);  // EFGH
+  __m128i state0[kStreams];
+  __m128i state1[kStreams];
+  for (size_t j = 0; j < kStreams; j++) {
+    state0[j] = _mm_alignr_epi8(abcd, efgh, 8);     // ABEF
+    state1[j] = _mm_blend_epi16(efgh, abcd, 0xf0);  // CDGH
+  }
+
+  alignas(16) uint8_t scratch[kStreams][kBlockSize];
+  for (size_t block_index = 0; block_index < messages[0].block_count();
+       block_index++) {
+    __m128i saved_state0[kStreams];
+    __m128i saved_state1[kStreams];
+    // |schedule| holds four consecutive groups of four message schedule words
+    // of each message. Group i + 4 replaces group i once rounds 4i to 4i + 3
+    // are done.
+    __m128i schedule[kStreams][4];
+    for (size_t j = 0; j < kStreams; j++) {
+      saved_state0[j] = state0[j];
+      saved_state1[j] = state1[j];
+      const uint8_t *block = messages[j].Block(block_index, scratch[j]);
+      for (int i = 0; i < 4; i++) {
+        schedule[j][i] = _mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + 16 * i)),
+            byte_swap);
+      }
+    }
+
+    for (int i = 0; i < 16; i++) {
+      const __m128i round_constants = _mm_load_si128(
+          reinterpret_cast<const __m128i *>(&kRoundConstants[4 * i]));
+      for (size_t j = 0; j < kStreams; j++) {
+        __m128i words = _mm_add_epi32(schedule[j][i % 4], round_constants);
+        state1[j] = _mm_sha256rnds2_epu32(state1[j], state0[j], words);
+        words = _mm_shuffle_epi32(words, 0x0e);
+        state0[j] = _mm_sha256rnds2_epu32(state0[j], state1[j], words);
+      }
+      if (i < 12) {
+        for (size_t j = 0; j < kStreams; j++) {
+          __m128i next = _mm_sha256msg1_epu32(schedule[j][i % 4],
+                                              schedule[j][(i + 1) % 4]);
+          next = _mm_add_epi32(next, _mm_alignr_epi8(schedule[j][(i + 3) % 4],
+                                                     schedule[j][(i + 2) % 4],
+                                                     4));
+          schedule[j][i % 4] =
+              _mm_sha256msg2_epu32(next, schedule[j][(i + 3) % 4]);
+        }
+      }
+    }
+
+    for (size_t j = 0; j < kStreams; j++) {
+      state0[j] = _mm_add_epi32(state0[j], saved_state0[j]);
+      state1[j] = _mm_add_epi32(state1[j], saved_state1[j]);
+    }
+  }
+
+  for (size_t j = 0; j < kStreams; j++) {
+    const __m128i feba = _mm_shuffle_epi32(state0[j], 0x1b);
+    const __m128i dchg = _mm_shuffle_epi32(state1[j], 0xb1);
+    abcd = _mm_shuffle_epi8(_mm_blend_epi16(feba, dchg, 0xf0), byte_swap);
+    efgh = _mm_shuffle_epi8(_mm_alignr_epi8(dchg, feba, 8), byte_swap);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(digests[j]), abcd);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(digests[j] + 16), efgh);
+  }
+}
+
+template <int kBits>
+__attribute__((target("avx2"))) inline __m256i RotateRight(__m256i x) {
+  return _mm256_or_si256(_mm256_srli_epi32(x, kBits),
+                         _mm256_slli_epi32(x, 32 - kBits));
+}
+
+__attribute__((target("avx2"))) inline __m256i Xor3(__m256i x, __m256i y,
+                                                     __m256i z) {
+  return _mm256_xor_si256(_mm256_xor_si256(x, y), z);
+}
+
+// Hashes up to kAvx2Lanes messages at once, one per 32-bit lane. The ith
+// message is made of |prefix| and |bodies[i]|. Lanes of messages that have
+// fewer blocks than others, or that are unused, compress zero blocks whose
+// result is discarded.
+__attribute__((target("avx2"))) void HashAvx2(ByteContainerView prefix,
+                                              const ByteContainerView *bodies,
+                                              size_t count,
+                                              uint8_t *const *digests) {
+  __m256i state[8];
+  for (int i = 0; i < 8; i++) {
+    state[i] = _mm256_set1_epi32(kInitialState[i]);
+  }
+  size_t block_count = 0;
+  for (size_t lane = 0; lane < count; lane++) {
+    block_count = std::max(block_count,
+                           PaddedMessage(prefix, bodies[lane]).block_count());
+  }
+
+  alignas(32) uint32_t words[16][kAvx2Lanes];
+  alignas(32) int32_t active[kAvx2Lanes];
+  uint8_t scratch[kBlockSize];
+  for (size_t block_index = 0; block_index < block_count; block_index++) {
+    // Transpose the blocks of each message into the lanes of the schedule.
+    for (size_t lane = 0; lane < kAvx2Lanes; lane++) {
+      active[lane] = 0;
+      if (lane < count) {
+        const PaddedMessage message(prefix, bodies[lane]);
+        if (block_index < message.block_count()) {
+          active[lane] = -1;
+          const uint8_t *block = message.Block(block_index, scratch);
+          for (int t = 0; t < 16; t++) {
+            words[t][lane] = LoadBigEndian32(block + 4 * t);
+          }
+        }
+      }
+      if (!active[lane]) {
+        for (int t = 0; t < 16; t++) {
+          words[t][lane] = 0;
+        }
+      }
+    }
+
+    __m256i schedule[16];
+    for (int t = 0; t < 16; t++) {
+      schedule[t] =
+          _mm256_load_si256(reinterpret_cast<const __m256i *>(words[t]));
+    }
+    __m256i a = state[0], b = state[1], c = state[2], d = state[3];
+    __m256i e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int t = 0; t < 64; t++) {
+      if (t >= 16) {
+        const __m256i w15 = schedule[(t - 15) % 16];
+        const __m256i w2 = schedule[(t - 2) % 16];
+        const __m256i sigma0 = Xor3(RotateRight<7>(w15), RotateRight<18>(w15),
+                                    _mm256_srli_epi32(w15, 3));
+        const __m256i sigma1 = Xor3(RotateRight<17>(w2), RotateRight<19>(w2),
+                                    _mm256_srli_epi32(w2, 10));
+        schedule[t % 16] = _mm256_add_epi32(
+            _mm256_add_epi32(schedule[t % 16], sigma0),
+            _mm256_add_epi32(schedule[(t - 7) % 16], sigma1));
+      }
+      const __m256i big_sigma1 =
+          Xor3(RotateRight<6>(e), RotateRight<11>(e), RotateRight<25>(e));
+      const __m256i choice =
+          _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+      const __m256i temp1 = _mm256_add_epi32(
+          _mm256_add_epi32(_mm256_add_epi32(h, big_sigma1),
+                           _mm256_add_epi32(choice, schedule[t % 16])),
+          _mm256_set1_epi32(kRoundConstants[t]));
+      const __m256i big_sigma0 =
+          Xor3(RotateRight<2>(a), RotateRight<13>(a), RotateRight<22>(a));
+      const __m256i majority = _mm256_or_si256(
+          _mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+      const __m256i temp2 = _mm256_add_epi32(big_sigma0, majority);
+      h = g;
+      g = f;
+      f = e;
+      e = _mm256_add_epi32(d, temp1);
+      d = c;
+      c = b;
+      b = a;
+      a = _mm256_add_epi32(temp1, temp2);
+    }
+
+    const __m256i mask =
+        _mm256_load_si256(reinterpret_cast<const __m256i *>(active));
+    const __m256i compressed[8] = {a, b, c, d, e, f, g, h};
+    for (int i = 0; i < 8; i++) {
+      state[i] = _mm256_blendv_epi8(
+          state[i], _mm256_add_epi32(state[i], compressed[i]), mask);
+    }
+  }
+
+  alignas(32) uint32_t output[8][kAvx2Lanes];
+  for (int i = 0; i < 8; i++) {
+    _mm256_store_si256(reinterpret_cast<__m256i *>(output[i]), state[i]);
+  }
+  for (size_t lane = 0; lane < count; lane++) {
+    for (int i = 0; i < 8; i++) {
+      StoreBigEndian32(output[i][lane], digests[lane] + 4 * i);
+    }
+  }
+}
+
+}  // namespace
+
+bool Sha256MultiBufferIsSupported(
+    Sha256MultiBufferImplementation implementation) {
+  static const bool sha_ni_supported = CpuSupportsShaNi();
+  static const bool avx2_supported = CpuSupportsAvx2();
+  switch (implementation) {
+    case Sha256MultiBufferImplementation::kGeneric:
+      return true;
+    case Sha256MultiBufferImplementation::kShaNi:
+      return sha_ni_supported;
+    case Sha256MultiBufferImplementation::kAvx2:
+      return avx2_supported;
+  }
+  return false;
+}
+
+Sha256MultiBufferImplementation Sha256MultiBufferDefaultImplementation() {
+  static const Sha256MultiBufferImplementation implementation = [] {
+    if (Sha256MultiBufferIsSupported(Sha256MultiBufferImplementation::kShaNi)) {
+      return Sha256MultiBufferImplementation::kShaNi;
+    }
+    if (Sha256MultiBufferIsSupported(Sha256MultiBufferImplementation::kAvx2)) {
+      return Sha256MultiBufferImplementation::kAvx2;
+    }
+    return Sha256MultiBufferImplementation::kGeneric;
+  }();
+  return implementation;
+}
+
+Status Sha256MultiBuffer(ByteContainerView prefix,
+                         absl::Span<const ByteContainerView> messages,
+                         absl::Span<uint8_t *const> digests) {
+  return Sha256MultiBuffer(Sha256MultiBufferDefaultImplementation(), prefix,
+                           messages, digests);
+}
+
+Status Sha256MultiBuffer(Sha256MultiBufferImplementation implementation,
+                         ByteContainerView prefix,
+                         absl::Span<const ByteContainerView> messages,
+                         absl::Span<uint8_t *const> digests) {
+  if (messages.size() != digests.size()) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Number of messages and digests differ");
+  }
+  if (!Sha256MultiBufferIsSupported(implementation)) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "SHA-256 implementation is not supported by the CPU");
+  }
+
+  switch (implementation) {
+    case Sha256MultiBufferImplementation::kGeneric:
+      for (size_t i = 0; i < messages.size(); i++) {
+        HashGeneric(prefix, messages[i], digests[i]);
+      }
+      break;
+    case Sha256MultiBufferImplementation::kShaNi:
+      // Hash pairs of consecutive messages of the same number of blocks
+      // together, and the other messages alone.
+      for (size_t i = 0; i < messages.size();) {
+        const PaddedMessage pair[2] = {
+            PaddedMessage(prefix, messages[i]),
+            PaddedMessage(prefix, messages[std::min(i + 1,
+                                                    messages.size() - 1)])};
+        if (i + 1 < messages.size() &&
+            pair[0].block_count() == pair[1].block_count()) {
+          HashShaNi<2>(pair, &digests[i]);
+          i += 2;
+        } else {
+          HashShaNi<1>(pair, &digests[i]);
+          i++;
+        }
+      }
+      break;
+    case Sha256MultiBufferImplementation::kAvx2:
+      for (size_t first = 0; first < messages.size(); first += kAvx2Lanes) {
+        const size_t count = std::min(kAvx2Lanes, messages.size() - first);
+        HashAvx2(prefix, &messages[first], count, &digests[first]);
+      }
+      break;
+  }
+  return Status::OkStatus();
+}
+
+}  // namespace asylo
@@ -0,0 +1,72 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_CRYPTO_SHA256_MULTI_BUFFER_H_
+#define ASYLO_CRYPTO_SHA256_MULTI_BUFFER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/types/span.h"
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+
+// Length of a SHA-256 digest, in bytes.
+constexpr size_t kSha256DigestLength = 32;
+
+// Implementations of multi-buffer SHA-256 hashing.
+enum class Sha256MultiBufferImplementation {
+  // Hashes one message at a time with BoringSSL.
+  kGeneric,
+  // Hashes one message at a time with the SHA extensions.
+  kShaNi,
+  // Hashes eight messages at a time, one per 32-bit lane of AVX2 registers.
+  kAvx2,
+};
+
+// Returns true if |implementation| is supported by the CPU.
+bool Sha256MultiBufferIsSupported(
+    Sha256MultiBufferImplementation implementation);
+
+// Returns the fastest implementation supported by the CPU, which is used by
+// Sha256MultiBuffer unless another one is requested.
+Sha256MultiBufferImplementation Sha256MultiBufferDefaultImplementation();
+
+// Computes the SHA-256 digests of many independent messages. The ith message
+// is the concatenation of |prefix| and |messages[i]|, and its digest is written
+// to the kSha256DigestLength bytes at |digests[i]|. The prefix lets callers
+// compute domain-separated hashes without copying their inputs.
+//
+// Hashing is fastest when the messages are of equal length. Returns an
+// INVALID_ARGUMENT error if |messages| and |digests| are not of the same size.
+Status Sha256MultiBuffer(ByteContainerView prefix,
+                         absl::Span<const ByteContainerView> messages,
+                         absl::Span<uint8_t *const> digests);
+
+// As above, but hashes the messages with |implementation|. Returns a
+// FAILED_PRECONDITION error if |implementation| is not supported by the CPU.
+Status Sha256MultiBuffer(Sha256MultiBufferImplementation implementation,
+                         ByteContainerView prefix,
+                         absl::Span<const ByteContainerView> messages,
+                         absl::Span<uint8_t *const> digests);
+
+}  // namespace asylo
+
+#endif  // ASYLO_CRYPTO_SHA256_MULTI_BUFFER_H_
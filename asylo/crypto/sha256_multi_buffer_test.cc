@@ -0,0 +1,169 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/crypto/sha256_multi_buffer.h"
+
+#include <openssl/sha.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/strings/escaping.h"
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/logging.h"
+
+namespace asylo {
+namespace {
+
+// Test vector from
+// http://csrc.nist.gov/groups/ST/toolkit/documents/Examples/SHA256.pdf.
+constexpr char kTestVector[] =
+    "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+constexpr char kResult[] =
+    "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1";
+
+// Returns the SHA-256 digest of |prefix| followed by |message|, computed by
+// BoringSSL.
+std::string ExpectedDigest(const std::string &prefix,
+                           const std::string &message) {
+  std::string data = prefix + message;
+  std::string digest(kSha256DigestLength, '\0');
+  SHA256(reinterpret_cast<const uint8_t *>(data.data()), data.size(),
+         reinterpret_cast<uint8_t *>(&digest[0]));
+  return digest;
+}
+
+// Hashes |messages| prefixed with |prefix| and compares the digests with
+// those computed by BoringSSL.
+void CheckDigests(Sha256MultiBufferImplementation implementation,
+                  const std::string &prefix,
+                  const std::vector<std::string> &messages) {
+  std::vector<ByteContainerView> views;
+  std::vector<std::string> digests(messages.size(),
+                                   std::string(kSha256DigestLength, '\0'));
+  std::vector<uint8_t *> digest_pointers;
+  for (size_t i = 0; i < messages.size(); i++) {
+    views.emplace_back(messages[i]);
+    digest_pointers.push_back(reinterpret_cast<uint8_t *>(&digests[i][0]));
+  }
+  ASSERT_THAT(Sha256MultiBuffer(implementation, prefix, views,
+                                digest_pointers),
+              IsOk());
+  for (size_t i = 0; i < messages.size(); i++) {
+    EXPECT_EQ(absl::BytesToHexString(digests[i]),
+              absl::BytesToHexString(ExpectedDigest(prefix, messages[i])))
+        << "prefix size " << prefix.size() << ", message size "
+        << messages[i].size();
+  }
+}
+
+class Sha256MultiBufferTest
+    : public ::testing::TestWithParam<Sha256MultiBufferImplementation> {
+ protected:
+  // Returns true if the implementation under test can run on this machine.
+  bool IsSupported() {
+    if (!Sha256MultiBufferIsSupported(GetParam())) {
+      LOG(INFO) << "Skipping test, implementation not supported by the CPU";
+      return false;
+    }
+    return true;
+  }
+};
+
+TEST_P(Sha256MultiBufferTest, TestVector) {
+  if (!IsSupported()) {
+    return;
+  }
+  std::string digest(kSha256DigestLength, '\0');
+  uint8_t *digest_pointer = reinterpret_cast<uint8_t *>(&digest[0]);
+  ByteContainerView message(kTestVector);
+  ASSERT_THAT(Sha256MultiBuffer(GetParam(), /*prefix=*/"",
+                                absl::MakeConstSpan(&message, 1),
+                                absl::MakeConstSpan(&digest_pointer, 1)),
+              IsOk());
+  EXPECT_EQ(absl::BytesToHexString(digest), kResult);
+}
+
+// Covers every position of the padding relative to the block boundaries, with
+// and without a prefix, and with a prefix spanning a block boundary.
+TEST_P(Sha256MultiBufferTest, AllLengthsMatchBoringSsl) {
+  if (!IsSupported()) {
+    return;
+  }
+  std::vector<std::string> messages;
+  for (size_t size = 0; size < 200; size++) {
+    std::string message(size, '\0');
+    for (size_t i = 0; i < size; i++) {
+      message[i] = static_cast<char>(size * 31 + i);
+    }
+    messages.push_back(message);
+  }
+  CheckDigests(GetParam(), /*prefix=*/"", messages);
+  CheckDigests(GetParam(), /*prefix=*/std::string(1, '\x01'), messages);
+  CheckDigests(GetParam(), /*prefix=*/std::string(70, '\xab'), messages);
+}
+
+TEST_P(Sha256MultiBufferTest, EqualLengthBatches) {
+  if (!IsSupported()) {
+    return;
+  }
+  for (size_t count : {1, 7, 8, 9, 17}) {
+    std::vector<std::string> messages;
+    for (size_t i = 0; i < count; i++) {
+      messages.push_back(std::string(64, static_cast<char>(i)));
+    }
+    CheckDigests(GetParam(), /*prefix=*/std::string(1, '\x01'), messages);
+  }
+}
+
+TEST_P(Sha256MultiBufferTest, EmptyBatch) {
+  if (!IsSupported()) {
+    return;
+  }
+  EXPECT_THAT(Sha256MultiBuffer(GetParam(), /*prefix=*/"", {}, {}), IsOk());
+}
+
+TEST_P(Sha256MultiBufferTest, MismatchedDigestCountFails) {
+  if (!IsSupported()) {
+    return;
+  }
+  ByteContainerView message(kTestVector);
+  EXPECT_THAT(Sha256MultiBuffer(GetParam(), /*prefix=*/"",
+                                absl::MakeConstSpan(&message, 1), {}),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    AllImplementations, Sha256MultiBufferTest,
+    ::testing::Values(Sha256MultiBufferImplementation::kGeneric,
+                      Sha256MultiBufferImplementation::kShaNi,
+                      Sha256MultiBufferImplementation::kAvx2));
+
+TEST(Sha256MultiBufferDefaultTest, DefaultImplementationIsSupported) {
+  EXPECT_TRUE(
+      Sha256MultiBufferIsSupported(Sha256MultiBufferDefaultImplementation()));
+  CheckDigests(Sha256MultiBufferDefaultImplementation(), /*prefix=*/"",
+               {"", "abc", kTestVector});
+}
+
+}  // namespace
+}  // namespace asylo
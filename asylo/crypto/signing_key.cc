@@ -19,6 +19,7 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "absl/strings/str_format.h"
 #include "asylo/crypto/algorithms.pb.h"
@@ -28,6 +29,7 @@
 #include "asylo/util/proto_enum_util.h"
 #include "asylo/util/status_macros.h"
 #include "asylo/util/statusor.h"
+#include "asylo/util/work_stealing_executor.h"
 
 namespace asylo {
 
@@ -58,6 +60,24 @@ StatusOr<AsymmetricSigningKeyProto> VerifyingKey::SerializeToKeyProto(
   return key_proto;
 }
 
+std::vector<Status> VerifyingKey::BatchVerify(
+    absl::Span<const SignedMessageView> items,
+    WorkStealingExecutor *executor) const {
+  std::vector<Status> statuses(items.size());
+  auto verify_item = [this, items, &statuses](size_t i) {
+    statuses[i] = Verify(items[i].message, items[i].signature);
+  };
+  if (executor == nullptr) {
+    for (size_t i = 0; i < items.size(); i++) {
+      verify_item(i);
+    }
+  } else {
+    // Each verification is expensive enough to be scheduled on its own.
+    executor->ParallelFor(0, items.size(), /*grain=*/1, verify_item);
+  }
+  return statuses;
+}
+
 StatusOr<AsymmetricSigningKeyProto> SigningKey::SerializeToKeyProto(
     AsymmetricKeyEncoding encoding) const {
   AsymmetricSigningKeyProto key_proto;
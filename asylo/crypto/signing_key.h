@@ -23,7 +23,9 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
+#include "absl/types/span.h"
 #include "asylo/crypto/algorithms.pb.h"
 #include "asylo/crypto/keys.pb.h"
 #include "asylo/crypto/util/byte_container_view.h"
@@ -33,6 +35,15 @@
 
 namespace asylo {
 
+class WorkStealingExecutor;
+
+// A message and a signature over it, verified as one item of a call to
+// VerifyingKey::BatchVerify().
+struct SignedMessageView {
+  ByteContainerView message;
+  ByteContainerView signature;
+};
+
 // VerifyingKey abstracts a verifying key from an asymmetric key-pair.
 class VerifyingKey {
  public:
@@ -65,6 +76,15 @@ class VerifyingKey {
                         ByteContainerView signature) const = 0;
   virtual Status Verify(ByteContainerView message,
                         const Signature &signature) const = 0;
+
+  // Verifies each of |items| as Verify() does, and returns the status of each
+  // verification in the order of |items|. If |executor| is not null, the
+  // verifications are spread across its workers, which requires Verify() to be
+  // safe to call concurrently. Otherwise they run on the calling thread.
+  // Batching also lets all items share the public key as parsed once, instead
+  // of parsing it again for each signature.
+  std::vector<Status> BatchVerify(absl::Span<const SignedMessageView> items,
+                                  WorkStealingExecutor *executor) const;
 };
 
 // SigningKey abstracts a signing key from an asymmetric key-pair.
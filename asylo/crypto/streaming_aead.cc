@@ -0,0 +1,343 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/crypto/streaming_aead.h"
+
+#include <openssl/digest.h>
+#include <openssl/hkdf.h>
+#include <openssl/rand.h>
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "asylo/crypto/util/bssl_util.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace {
+
+// Size of the random nonce prefix stored in the stream header. The segment
+// nonce appends a 4-byte segment index and a 1-byte last segment flag.
+constexpr size_t kNoncePrefixSize = 7;
+constexpr size_t kSegmentNonceSize = kNoncePrefixSize + sizeof(uint32_t) + 1;
+
+// Returns the key size of |scheme|, or 0 if |scheme| is not supported.
+size_t KeySize(AeadScheme scheme) {
+  switch (scheme) {
+    case AES128_GCM:
+    case AES128_GCM_SIV:
+      return 16;
+    case AES256_GCM:
+    case AES256_GCM_SIV:
+      return 32;
+    default:
+      return 0;
+  }
+}
+
+// Creates an AeadKey using |key| with |scheme|.
+StatusOr<std::unique_ptr<AeadKey>> CreateAeadKey(AeadScheme scheme,
+                                                 ByteContainerView key) {
+  if (scheme == AES128_GCM_SIV || scheme == AES256_GCM_SIV) {
+    return AeadKey::CreateAesGcmSivKey(key);
+  }
+  return AeadKey::CreateAesGcmKey(key);
+}
+
+// Returns the nonce of the segment at |index| of a stream with the nonce
+// prefix |nonce_prefix|.
+std::vector<uint8_t> SegmentNonce(const std::vector<uint8_t> &nonce_prefix,
+                                  uint32_t index, bool is_last) {
+  std::vector<uint8_t> nonce(nonce_prefix);
+  nonce.reserve(kSegmentNonceSize);
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    nonce.push_back(static_cast<uint8_t>(index >> shift));
+  }
+  nonce.push_back(is_last ? 1 : 0);
+  return nonce;
+}
+
+}  // namespace
+
+StatusOr<std::unique_ptr<StreamingAead>> StreamingAead::Create(
+    AeadScheme scheme, ByteContainerView key, size_t ciphertext_segment_size) {
+  if (KeySize(scheme) == 0) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  absl::StrCat("Unsupported AEAD scheme: ",
+                               AeadScheme_Name(scheme)));
+  }
+  if (key.size() != KeySize(scheme)) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  absl::StrCat("Key size ", key.size(), " is invalid for ",
+                               AeadScheme_Name(scheme)));
+  }
+  std::unique_ptr<AeadKey> aead_key;
+  ASYLO_ASSIGN_OR_RETURN(aead_key, CreateAeadKey(scheme, key));
+  if (aead_key->NonceSize() != kSegmentNonceSize) {
+    return Status(error::GoogleError::INTERNAL,
+                  absl::StrCat("Unexpected nonce size ",
+                               aead_key->NonceSize()));
+  }
+  size_t segment_overhead = aead_key->MaxSealOverhead();
+  if (ciphertext_segment_size <= segment_overhead) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  absl::StrCat("Ciphertext segment size ",
+                               ciphertext_segment_size,
+                               " does not exceed the segment overhead (",
+                               segment_overhead, " bytes)"));
+  }
+  return absl::WrapUnique(new StreamingAead(
+      scheme, key, ciphertext_segment_size, segment_overhead));
+}
+
+StreamingAead::StreamingAead(AeadScheme scheme, ByteContainerView key,
+                             size_t ciphertext_segment_size,
+                             size_t segment_overhead)
+    : scheme_(scheme),
+      key_(key.begin(), key.end()),
+      ciphertext_segment_size_(ciphertext_segment_size),
+      segment_overhead_(segment_overhead) {}
+
+size_t StreamingAead::HeaderSize() const {
+  // The header holds its own size, the salt and the nonce prefix.
+  return 1 + key_.size() + kNoncePrefixSize;
+}
+
+size_t StreamingAead::PlaintextSegmentSize() const {
+  return ciphertext_segment_size_ - segment_overhead_;
+}
+
+size_t StreamingAead::CiphertextSize(size_t plaintext_size) const {
+  // An empty stream still has an empty last segment.
+  size_t segments = plaintext_size == 0
+                        ? 1
+                        : (plaintext_size - 1) / PlaintextSegmentSize() + 1;
+  return HeaderSize() + plaintext_size + segments * segment_overhead_;
+}
+
+StatusOr<std::unique_ptr<SealStream>> StreamingAead::NewSealStream(
+    ByteContainerView associated_data) const {
+  std::vector<uint8_t> header(HeaderSize());
+  header[0] = static_cast<uint8_t>(header.size());
+  if (RAND_bytes(header.data() + 1, header.size() - 1) != 1) {
+    return Status(error::GoogleError::INTERNAL,
+                  absl::StrCat("RAND_bytes failed: ", BsslLastErrorString()));
+  }
+  ByteContainerView salt(header.data() + 1, key_.size());
+  std::vector<uint8_t> nonce_prefix(header.end() - kNoncePrefixSize,
+                                    header.end());
+
+  std::unique_ptr<AeadKey> stream_key;
+  ASYLO_ASSIGN_OR_RETURN(stream_key, DeriveStreamKey(salt, associated_data));
+  return absl::WrapUnique(
+      new SealStream(std::move(stream_key), std::move(header),
+                     std::move(nonce_prefix), PlaintextSegmentSize()));
+}
+
+StatusOr<std::unique_ptr<OpenStream>> StreamingAead::NewOpenStream(
+    ByteContainerView header, ByteContainerView associated_data) const {
+  if (header.size() != HeaderSize() || header[0] != HeaderSize()) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Invalid stream header");
+  }
+  ByteContainerView salt(header.data() + 1, key_.size());
+  std::vector<uint8_t> nonce_prefix(header.end() - kNoncePrefixSize,
+                                    header.end());
+
+  std::unique_ptr<AeadKey> stream_key;
+  ASYLO_ASSIGN_OR_RETURN(stream_key, DeriveStreamKey(salt, associated_data));
+  return absl::WrapUnique(new OpenStream(std::move(stream_key),
+                                         std::move(nonce_prefix),
+                                         ciphertext_segment_size_));
+}
+
+StatusOr<std::unique_ptr<AeadKey>> StreamingAead::DeriveStreamKey(
+    ByteContainerView salt, ByteContainerView associated_data) const {
+  CleansingVector<uint8_t> stream_key(key_.size());
+  if (HKDF(stream_key.data(), stream_key.size(), EVP_sha256(), key_.data(),
+           key_.size(), salt.data(), salt.size(), associated_data.data(),
+           associated_data.size()) != 1) {
+    return Status(error::GoogleError::INTERNAL,
+                  absl::StrCat("HKDF failed: ", BsslLastErrorString()));
+  }
+  return CreateAeadKey(scheme_, stream_key);
+}
+
+SealStream::SealStream(std::unique_ptr<AeadKey> key,
+                       std::vector<uint8_t> header,
+                       std::vector<uint8_t> nonce_prefix,
+                       size_t plaintext_segment_size)
+    : key_(std::move(key)),
+      header_(std::move(header)),
+      nonce_prefix_(std::move(nonce_prefix)),
+      plaintext_segment_size_(plaintext_segment_size),
+      next_segment_(0),
+      finished_(false) {
+  buffer_.reserve(plaintext_segment_size_);
+}
+
+Status SealStream::Write(ByteContainerView plaintext,
+                         std::vector<uint8_t> *ciphertext) {
+  if (finished_) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Stream is finished");
+  }
+  const uint8_t *data = plaintext.data();
+  size_t size = plaintext.size();
+
+  // A full segment is only sealed once more plaintext follows it, since the
+  // last segment is sealed differently.
+  while (buffer_.size() + size > plaintext_segment_size_) {
+    if (buffer_.empty()) {
+      // Seal whole segments directly from the input.
+      ASYLO_RETURN_IF_ERROR(SealSegment(data, plaintext_segment_size_,
+                                        /*is_last=*/false, ciphertext));
+      data += plaintext_segment_size_;
+      size -= plaintext_segment_size_;
+      continue;
+    }
+    size_t fill = plaintext_segment_size_ - buffer_.size();
+    buffer_.insert(buffer_.end(), data, data + fill);
+    data += fill;
+    size -= fill;
+    ASYLO_RETURN_IF_ERROR(SealSegment(buffer_.data(), buffer_.size(),
+                                      /*is_last=*/false, ciphertext));
+    buffer_.clear();
+  }
+  buffer_.insert(buffer_.end(), data, data + size);
+  return Status::OkStatus();
+}
+
+Status SealStream::Finish(std::vector<uint8_t> *ciphertext) {
+  if (finished_) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Stream is finished");
+  }
+  ASYLO_RETURN_IF_ERROR(SealSegment(buffer_.data(), buffer_.size(),
+                                    /*is_last=*/true, ciphertext));
+  buffer_.clear();
+  finished_ = true;
+  return Status::OkStatus();
+}
+
+Status SealStream::SealSegment(const uint8_t *plaintext, size_t size,
+                               bool is_last,
+                               std::vector<uint8_t> *ciphertext) {
+  if (next_segment_ == std::numeric_limits<uint32_t>::max()) {
+    return Status(error::GoogleError::OUT_OF_RANGE,
+                  "Stream has too many segments");
+  }
+  size_t offset = ciphertext->size();
+  ciphertext->resize(offset + size + key_->MaxSealOverhead());
+  size_t ciphertext_size;
+  Status status = key_->Seal(
+      ByteContainerView(plaintext, size), /*associated_data=*/"",
+      SegmentNonce(nonce_prefix_, next_segment_, is_last),
+      absl::MakeSpan(*ciphertext).subspan(offset), &ciphertext_size);
+  if (!status.ok()) {
+    ciphertext->resize(offset);
+    return status;
+  }
+  ciphertext->resize(offset + ciphertext_size);
+  next_segment_++;
+  return Status::OkStatus();
+}
+
+OpenStream::OpenStream(std::unique_ptr<AeadKey> key,
+                       std::vector<uint8_t> nonce_prefix,
+                       size_t ciphertext_segment_size)
+    : key_(std::move(key)),
+      nonce_prefix_(std::move(nonce_prefix)),
+      ciphertext_segment_size_(ciphertext_segment_size),
+      next_segment_(0),
+      finished_(false) {
+  buffer_.reserve(ciphertext_segment_size_);
+}
+
+Status OpenStream::Write(ByteContainerView ciphertext,
+                         std::vector<uint8_t> *plaintext) {
+  if (finished_) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Stream is finished");
+  }
+  const uint8_t *data = ciphertext.data();
+  size_t size = ciphertext.size();
+
+  while (buffer_.size() + size > ciphertext_segment_size_) {
+    if (buffer_.empty()) {
+      ASYLO_RETURN_IF_ERROR(
+          OpenSegment(next_segment_, /*is_last=*/false,
+                      ByteContainerView(data, ciphertext_segment_size_),
+                      plaintext));
+      data += ciphertext_segment_size_;
+      size -= ciphertext_segment_size_;
+    } else {
+      size_t fill = ciphertext_segment_size_ - buffer_.size();
+      buffer_.insert(buffer_.end(), data, data + fill);
+      data += fill;
+      size -= fill;
+      ASYLO_RETURN_IF_ERROR(
+          OpenSegment(next_segment_, /*is_last=*/false, buffer_, plaintext));
+      buffer_.clear();
+    }
+    next_segment_++;
+  }
+  buffer_.insert(buffer_.end(), data, data + size);
+  return Status::OkStatus();
+}
+
+Status OpenStream::Finish(std::vector<uint8_t> *plaintext) {
+  if (finished_) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Stream is finished");
+  }
+  ASYLO_RETURN_IF_ERROR(
+      OpenSegment(next_segment_, /*is_last=*/true, buffer_, plaintext));
+  buffer_.clear();
+  finished_ = true;
+  return Status::OkStatus();
+}
+
+Status OpenStream::OpenSegment(uint32_t index, bool is_last,
+                               ByteContainerView segment,
+                               std::vector<uint8_t> *plaintext) const {
+  if (segment.size() > ciphertext_segment_size_ ||
+      (!is_last && segment.size() != ciphertext_segment_size_)) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  absl::StrCat("Invalid size of segment ", index, ": ",
+                               segment.size(), " bytes"));
+  }
+  size_t offset = plaintext->size();
+  plaintext->resize(offset + segment.size());
+  size_t plaintext_size;
+  Status status =
+      key_->Open(segment, /*associated_data=*/"",
+                 SegmentNonce(nonce_prefix_, index, is_last),
+                 absl::MakeSpan(*plaintext).subspan(offset), &plaintext_size);
+  if (!status.ok()) {
+    plaintext->resize(offset);
+    return status;
+  }
+  plaintext->resize(offset + plaintext_size);
+  return Status::OkStatus();
+}
+
+}  // namespace asylo
@@ -0,0 +1,176 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_CRYPTO_STREAMING_AEAD_H_
+#define ASYLO_CRYPTO_STREAMING_AEAD_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "asylo/crypto/aead_key.h"
+#include "asylo/crypto/algorithms.pb.h"
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/util/cleansing_types.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+
+class SealStream;
+class OpenStream;
+
+// Streaming AEAD in the segmented STREAM construction, which encrypts payloads
+// of any size incrementally, with memory bounded by the segment size.
+//
+// A stream consists of a header followed by a sequence of segments. Each
+// stream is sealed under its own key, derived with HKDF-SHA256 from the key of
+// the StreamingAead, a random salt stored in the header, and the associated
+// data of the stream. Each segment is sealed with AeadKey under a nonce made
+// of a random prefix stored in the header, the index of the segment and a flag
+// marking the last segment. This authenticates the order of the segments and
+// detects truncation of the stream.
+//
+// All segments but the last one have a ciphertext size of exactly
+// CiphertextSegmentSize() bytes, so segment i starts at offset HeaderSize() +
+// i * CiphertextSegmentSize() of the stream, and can be opened on its own.
+class StreamingAead {
+ public:
+  // Creates a StreamingAead using |key| with |scheme|, which must be one of the
+  // AES-GCM or AES-GCM-SIV schemes. |key| must have the key size of |scheme|.
+  // |ciphertext_segment_size| must exceed the overhead of sealing a segment.
+  static StatusOr<std::unique_ptr<StreamingAead>> Create(
+      AeadScheme scheme, ByteContainerView key, size_t ciphertext_segment_size);
+
+  // Returns the size of the header of a stream.
+  size_t HeaderSize() const;
+
+  // Returns the size of a ciphertext segment, other than the last one.
+  size_t CiphertextSegmentSize() const { return ciphertext_segment_size_; }
+
+  // Returns the size of the plaintext of a segment, other than the last one.
+  size_t PlaintextSegmentSize() const;
+
+  // Returns the size of a stream sealing |plaintext_size| bytes.
+  size_t CiphertextSize(size_t plaintext_size) const;
+
+  // Starts sealing a new stream bound to |associated_data|.
+  StatusOr<std::unique_ptr<SealStream>> NewSealStream(
+      ByteContainerView associated_data) const;
+
+  // Starts opening the stream with the header |header| and associated data
+  // |associated_data|.
+  StatusOr<std::unique_ptr<OpenStream>> NewOpenStream(
+      ByteContainerView header, ByteContainerView associated_data) const;
+
+ private:
+  StreamingAead(AeadScheme scheme, ByteContainerView key,
+                size_t ciphertext_segment_size, size_t segment_overhead);
+
+  // Derives the key of the stream with the salt |salt| and associated data
+  // |associated_data|.
+  StatusOr<std::unique_ptr<AeadKey>> DeriveStreamKey(
+      ByteContainerView salt, ByteContainerView associated_data) const;
+
+  const AeadScheme scheme_;
+  const CleansingVector<uint8_t> key_;
+  const size_t ciphertext_segment_size_;
+  const size_t segment_overhead_;
+};
+
+// Seals a stream incrementally. Plaintext is buffered until it fills a
+// segment, so a SealStream holds at most one segment of plaintext.
+class SealStream {
+ public:
+  // Returns the header of the stream, which must precede its segments.
+  const std::vector<uint8_t> &header() const { return header_; }
+
+  // Seals |plaintext|, appending the ciphertext of every segment it completes
+  // to |ciphertext|.
+  Status Write(ByteContainerView plaintext, std::vector<uint8_t> *ciphertext);
+
+  // Seals the buffered plaintext as the last segment of the stream, and
+  // appends its ciphertext to |ciphertext|. The stream cannot be written to
+  // afterwards.
+  Status Finish(std::vector<uint8_t> *ciphertext);
+
+ private:
+  friend class StreamingAead;
+
+  SealStream(std::unique_ptr<AeadKey> key, std::vector<uint8_t> header,
+             std::vector<uint8_t> nonce_prefix, size_t plaintext_segment_size);
+
+  // Seals the |size| bytes at |plaintext| as the next segment, and appends its
+  // ciphertext to |ciphertext|.
+  Status SealSegment(const uint8_t *plaintext, size_t size, bool is_last,
+                     std::vector<uint8_t> *ciphertext);
+
+  const std::unique_ptr<AeadKey> key_;
+  const std::vector<uint8_t> header_;
+  const std::vector<uint8_t> nonce_prefix_;
+  const size_t plaintext_segment_size_;
+
+  // Plaintext not sealed yet, which is at most one segment.
+  CleansingVector<uint8_t> buffer_;
+  uint32_t next_segment_;
+  bool finished_;
+};
+
+// Opens a stream, either incrementally or one segment at a time.
+class OpenStream {
+ public:
+  // Opens |ciphertext|, which continues the segments of the stream, and
+  // appends the plaintext of every segment it completes to |plaintext|.
+  // Ciphertext is buffered until it fills a segment, and a full segment is
+  // only opened once ciphertext following it has been written, so that the
+  // last segment of the stream can be told apart.
+  Status Write(ByteContainerView ciphertext, std::vector<uint8_t> *plaintext);
+
+  // Opens the buffered ciphertext as the last segment of the stream, and
+  // appends its plaintext to |plaintext|. Fails if the stream was truncated.
+  // The stream cannot be written to afterwards.
+  Status Finish(std::vector<uint8_t> *plaintext);
+
+  // Opens |segment| as the segment at |index| of the stream, whose last segment
+  // it is if |is_last| is true, and appends its plaintext to |plaintext|. The
+  // segment starts at offset StreamingAead::HeaderSize() + |index| *
+  // StreamingAead::CiphertextSegmentSize() of the stream. Independent of
+  // Write() and Finish().
+  Status OpenSegment(uint32_t index, bool is_last, ByteContainerView segment,
+                     std::vector<uint8_t> *plaintext) const;
+
+ private:
+  friend class StreamingAead;
+
+  OpenStream(std::unique_ptr<AeadKey> key, std::vector<uint8_t> nonce_prefix,
+             size_t ciphertext_segment_size);
+
+  const std::unique_ptr<AeadKey> key_;
+  const std::vector<uint8_t> nonce_prefix_;
+  const size_t ciphertext_segment_size_;
+
+  // Ciphertext not opened yet, which is at most one segment.
+  std::vector<uint8_t> buffer_;
+  uint32_t next_segment_;
+  bool finished_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_CRYPTO_STREAMING_AEAD_H_
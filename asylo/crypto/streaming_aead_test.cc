@@ -0,0 +1,256 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/crypto/streaming_aead.h"
+
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "asylo/crypto/algorithms.pb.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Not;
+using ::testing::TestWithParam;
+
+constexpr size_t kCiphertextSegmentSize = 64;
+constexpr char kAssociatedData[] = "stream associated data";
+
+// Returns |size| bytes of non-constant plaintext.
+std::vector<uint8_t> MakePlaintext(size_t size) {
+  std::vector<uint8_t> plaintext(size);
+  for (size_t i = 0; i < size; i++) {
+    plaintext[i] = static_cast<uint8_t>(i * 7 + 3);
+  }
+  return plaintext;
+}
+
+class StreamingAeadTest : public TestWithParam<AeadScheme> {
+ protected:
+  void SetUp() override {
+    std::vector<uint8_t> key(GetParam() == AES128_GCM ||
+                                     GetParam() == AES128_GCM_SIV
+                                 ? 16
+                                 : 32,
+                             0x42);
+    auto aead_result =
+        StreamingAead::Create(GetParam(), key, kCiphertextSegmentSize);
+    ASSERT_THAT(aead_result.status(), IsOk());
+    aead_ = std::move(aead_result).ValueOrDie();
+  }
+
+  // Seals |plaintext| as a stream, writing it |chunk_size| bytes at a time.
+  std::vector<uint8_t> Seal(const std::vector<uint8_t> &plaintext,
+                            size_t chunk_size) {
+    auto seal_result = aead_->NewSealStream(kAssociatedData);
+    EXPECT_THAT(seal_result.status(), IsOk());
+    std::unique_ptr<SealStream> stream = std::move(seal_result).ValueOrDie();
+    std::vector<uint8_t> ciphertext = stream->header();
+    for (size_t offset = 0; offset < plaintext.size(); offset += chunk_size) {
+      size_t size = std::min(chunk_size, plaintext.size() - offset);
+      EXPECT_THAT(stream->Write(ByteContainerView(plaintext.data() + offset,
+                                                  size),
+                                &ciphertext),
+                  IsOk());
+    }
+    EXPECT_THAT(stream->Finish(&ciphertext), IsOk());
+    return ciphertext;
+  }
+
+  // Opens the stream |ciphertext|, writing it |chunk_size| bytes at a time.
+  Status Open(const std::vector<uint8_t> &ciphertext, size_t chunk_size,
+              std::vector<uint8_t> *plaintext) {
+    if (ciphertext.size() < aead_->HeaderSize()) {
+      return Status(error::GoogleError::INVALID_ARGUMENT, "Short stream");
+    }
+    auto open_result = aead_->NewOpenStream(
+        ByteContainerView(ciphertext.data(), aead_->HeaderSize()),
+        kAssociatedData);
+    if (!open_result.ok()) {
+      return open_result.status();
+    }
+    std::unique_ptr<OpenStream> stream = std::move(open_result).ValueOrDie();
+    for (size_t offset = aead_->HeaderSize(); offset < ciphertext.size();
+         offset += chunk_size) {
+      size_t size = std::min(chunk_size, ciphertext.size() - offset);
+      Status status = stream->Write(
+          ByteContainerView(ciphertext.data() + offset, size), plaintext);
+      if (!status.ok()) {
+        return status;
+      }
+    }
+    return stream->Finish(plaintext);
+  }
+
+  std::unique_ptr<StreamingAead> aead_;
+};
+
+TEST_P(StreamingAeadTest, RoundTripsAnySizeAndChunking) {
+  const size_t segment = aead_->PlaintextSegmentSize();
+  for (size_t size : {size_t{0}, size_t{1}, segment - 1, segment,
+                      segment + 1, 3 * segment, 5 * segment + 17}) {
+    std::vector<uint8_t> plaintext = MakePlaintext(size);
+    for (size_t chunk_size : {size_t{1}, size_t{7}, segment, size_t{1000}}) {
+      std::vector<uint8_t> ciphertext = Seal(plaintext, chunk_size);
+      EXPECT_EQ(ciphertext.size(), aead_->CiphertextSize(size));
+
+      for (size_t open_chunk_size : {size_t{1}, kCiphertextSegmentSize,
+                                     size_t{1000}}) {
+        std::vector<uint8_t> opened;
+        ASSERT_THAT(Open(ciphertext, open_chunk_size, &opened), IsOk())
+            << "size " << size << ", chunk size " << chunk_size;
+        EXPECT_EQ(opened, plaintext);
+      }
+    }
+  }
+}
+
+TEST_P(StreamingAeadTest, OpensSegmentsInAnyOrder) {
+  const size_t segment = aead_->PlaintextSegmentSize();
+  std::vector<uint8_t> plaintext = MakePlaintext(3 * segment + 5);
+  std::vector<uint8_t> ciphertext = Seal(plaintext, plaintext.size());
+
+  auto open_result = aead_->NewOpenStream(
+      ByteContainerView(ciphertext.data(), aead_->HeaderSize()),
+      kAssociatedData);
+  ASSERT_THAT(open_result.status(), IsOk());
+  std::unique_ptr<OpenStream> stream = std::move(open_result).ValueOrDie();
+
+  for (uint32_t index : {3, 1, 0, 2}) {
+    size_t offset = aead_->HeaderSize() + index * kCiphertextSegmentSize;
+    size_t size = std::min(kCiphertextSegmentSize, ciphertext.size() - offset);
+    std::vector<uint8_t> opened;
+    ASSERT_THAT(stream->OpenSegment(index, /*is_last=*/index == 3,
+                                    ByteContainerView(ciphertext.data() +
+                                                          offset,
+                                                      size),
+                                    &opened),
+                IsOk());
+    std::vector<uint8_t> expected(
+        plaintext.begin() + index * segment,
+        plaintext.begin() + std::min(plaintext.size(), (index + 1) * segment));
+    EXPECT_EQ(opened, expected);
+  }
+
+  // A segment opened at the wrong position fails.
+  std::vector<uint8_t> opened;
+  EXPECT_THAT(stream->OpenSegment(
+                  1, /*is_last=*/false,
+                  ByteContainerView(ciphertext.data() + aead_->HeaderSize(),
+                                    kCiphertextSegmentSize),
+                  &opened),
+              Not(IsOk()));
+  EXPECT_TRUE(opened.empty());
+}
+
+TEST_P(StreamingAeadTest, DetectsTruncation) {
+  const size_t segment = aead_->PlaintextSegmentSize();
+  std::vector<uint8_t> plaintext = MakePlaintext(3 * segment);
+  std::vector<uint8_t> ciphertext = Seal(plaintext, plaintext.size());
+
+  // Dropping the last segment leaves a full segment that was not sealed as the
+  // last one.
+  ciphertext.resize(ciphertext.size() - kCiphertextSegmentSize);
+  std::vector<uint8_t> opened;
+  EXPECT_THAT(Open(ciphertext, kCiphertextSegmentSize, &opened), Not(IsOk()));
+
+  // Only the header is left.
+  ciphertext.resize(aead_->HeaderSize());
+  opened.clear();
+  EXPECT_THAT(Open(ciphertext, kCiphertextSegmentSize, &opened), Not(IsOk()));
+}
+
+TEST_P(StreamingAeadTest, DetectsTampering) {
+  std::vector<uint8_t> plaintext = MakePlaintext(200);
+  std::vector<uint8_t> ciphertext = Seal(plaintext, plaintext.size());
+  for (size_t offset : {size_t{1}, aead_->HeaderSize(),
+                        aead_->HeaderSize() + kCiphertextSegmentSize + 3,
+                        ciphertext.size() - 1}) {
+    std::vector<uint8_t> tampered = ciphertext;
+    tampered[offset] ^= 0x01;
+    std::vector<uint8_t> opened;
+    EXPECT_THAT(Open(tampered, kCiphertextSegmentSize, &opened), Not(IsOk()))
+        << "offset " << offset;
+  }
+}
+
+TEST_P(StreamingAeadTest, BindsAssociatedData) {
+  std::vector<uint8_t> ciphertext = Seal(MakePlaintext(100), 100);
+  auto open_result = aead_->NewOpenStream(
+      ByteContainerView(ciphertext.data(), aead_->HeaderSize()),
+      "other associated data");
+  ASSERT_THAT(open_result.status(), IsOk());
+  std::unique_ptr<OpenStream> stream = std::move(open_result).ValueOrDie();
+  std::vector<uint8_t> opened;
+  ASSERT_THAT(
+      stream->Write(ByteContainerView(ciphertext.data() + aead_->HeaderSize(),
+                                      ciphertext.size() - aead_->HeaderSize()),
+                    &opened),
+      Not(IsOk()));
+}
+
+TEST_P(StreamingAeadTest, FinishedStreamsRejectWrites) {
+  auto seal_result = aead_->NewSealStream(kAssociatedData);
+  ASSERT_THAT(seal_result.status(), IsOk());
+  std::unique_ptr<SealStream> stream = std::move(seal_result).ValueOrDie();
+  std::vector<uint8_t> ciphertext;
+  ASSERT_THAT(stream->Finish(&ciphertext), IsOk());
+  EXPECT_THAT(stream->Write("data", &ciphertext),
+              StatusIs(error::GoogleError::FAILED_PRECONDITION));
+  EXPECT_THAT(stream->Finish(&ciphertext),
+              StatusIs(error::GoogleError::FAILED_PRECONDITION));
+}
+
+INSTANTIATE_TEST_SUITE_P(AllTests, StreamingAeadTest,
+                         ::testing::Values(AES128_GCM, AES256_GCM,
+                                           AES128_GCM_SIV, AES256_GCM_SIV));
+
+TEST(StreamingAeadCreateTest, RejectsInvalidParameters) {
+  std::vector<uint8_t> key(16);
+  EXPECT_THAT(StreamingAead::Create(UNKNOWN_AEAD_SCHEME, key, 64).status(),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  EXPECT_THAT(StreamingAead::Create(AES256_GCM, key, 64).status(),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  EXPECT_THAT(StreamingAead::Create(AES128_GCM, key, 16).status(),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+TEST(StreamingAeadCreateTest, RejectsInvalidHeader) {
+  std::vector<uint8_t> key(16);
+  auto aead_result = StreamingAead::Create(AES128_GCM, key, 64);
+  ASSERT_THAT(aead_result.status(), IsOk());
+  std::unique_ptr<StreamingAead> aead = std::move(aead_result).ValueOrDie();
+  std::vector<uint8_t> header(aead->HeaderSize());
+  EXPECT_THAT(aead->NewOpenStream(header, "").status(),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  header.pop_back();
+  header[0] = header.size();
+  EXPECT_THAT(aead->NewOpenStream(header, "").status(),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace asylo
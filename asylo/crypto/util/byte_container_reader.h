@@ -105,6 +105,20 @@ class ByteContainerReader {
     return Status::OkStatus();
   }
 
+  // Sets |output| to a view of the next |size| bytes, without copying them.
+  // The view refers to the source buffer, so it is only valid for as long as
+  // the source buffer is. Returns INVALID_ARGUMENT if |size| is larger than the
+  // number of bytes remaining.
+  Status ReadView(size_t size, ByteContainerView *output) {
+    if (size > BytesRemaining()) {
+      return CreateReadTooLargeStatus(size);
+    }
+
+    *output = ByteContainerView(source_.data() + offset_, size);
+    offset_ += size;
+    return Status::OkStatus();
+  }
+
  private:
   Status CreateReadTooLargeStatus(size_t size) const {
     return Status(error::GoogleError::INVALID_ARGUMENT,
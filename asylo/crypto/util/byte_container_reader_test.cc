@@ -120,6 +120,28 @@ TYPED_TEST(ByteContainerReadSingleTests, ReadRawTooManyBytes) {
   EXPECT_THAT(reader.BytesRemaining(), Eq(kSize));
 }
 
+TYPED_TEST(ByteContainerReadSingleTests, ReadView) {
+  const TypeParam kInput = TrivialRandomObject<TypeParam>();
+  ByteContainerReader reader(ByteContainerView(&kInput, sizeof(kInput)));
+
+  ByteContainerView output(nullptr, 0);
+  ASSERT_THAT(reader.ReadView(sizeof(kInput), &output), IsOk());
+  EXPECT_THAT(output.data(), Eq(reinterpret_cast<const uint8_t *>(&kInput)));
+  EXPECT_THAT(output.size(), Eq(sizeof(kInput)));
+  EXPECT_THAT(reader.BytesRemaining(), Eq(0));
+}
+
+TYPED_TEST(ByteContainerReadSingleTests, ReadViewTooManyBytes) {
+  const TypeParam kInput = TrivialRandomObject<TypeParam>();
+  const size_t kSize = sizeof(kInput) - 1;
+  ByteContainerReader reader(ByteContainerView(&kInput, kSize));
+
+  ByteContainerView output(nullptr, 0);
+  ASSERT_THAT(reader.ReadView(sizeof(TypeParam), &output),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  EXPECT_THAT(reader.BytesRemaining(), Eq(kSize));
+}
+
 template <typename T>
 class ByteContainerReadMultipleTests : public Test {};
 using ContainerTypes =
@@ -0,0 +1,145 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/crypto/verified_certificate_cache.h"
+
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "asylo/crypto/certificate.pb.h"
+#include "asylo/crypto/sha256_hash.h"
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/util/status_macros.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+namespace {
+
+// Appends the SHA256 digest of |certificate| to |key|. The digest covers the
+// certificate as encoded in the first format it supports. Returns false if it
+// supports no format.
+bool AppendCertificateDigest(const CertificateInterface &certificate,
+                             std::string *key) {
+  for (int format = Certificate::CertificateFormat_MIN;
+       format <= Certificate::CertificateFormat_MAX; format++) {
+    if (format == Certificate::UNKNOWN ||
+        !Certificate::CertificateFormat_IsValid(format)) {
+      continue;
+    }
+    StatusOr<Certificate> encoded = certificate.ToCertificateProto(
+        static_cast<Certificate::CertificateFormat>(format));
+    if (!encoded.ok()) {
+      continue;
+    }
+
+    Sha256Hash hash;
+    uint8_t format_byte = static_cast<uint8_t>(format);
+    hash.Update(ByteContainerView(&format_byte, sizeof(format_byte)));
+    hash.Update(encoded.ValueOrDie().data());
+    std::vector<uint8_t> digest;
+    if (!hash.CumulativeHash(&digest).ok()) {
+      return false;
+    }
+    key->append(digest.begin(), digest.end());
+    return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+Status VerifiedCertificateCache::Verify(const CertificateInterface &subject,
+                                        const CertificateInterface &issuer,
+                                        const VerificationConfig &config) {
+  std::string key;
+  if (capacity_ > 0) {
+    key = VerificationKey(subject, issuer, config);
+  }
+  if (key.empty()) {
+    return subject.Verify(issuer, config);
+  }
+
+  {
+    absl::MutexLock lock(&mu_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      if (absl::Now() < it->second->expiry) {
+        entries_.splice(entries_.begin(), entries_, it->second);
+        hits_++;
+        return Status::OkStatus();
+      }
+      entries_.erase(it->second);
+      index_.erase(it);
+    }
+  }
+
+  // Verify without holding the lock, so that concurrent verifications of
+  // different certificates proceed in parallel.
+  ASYLO_RETURN_IF_ERROR(subject.Verify(issuer, config));
+
+  absl::MutexLock lock(&mu_);
+  absl::Time expiry = absl::Now() + lifetime_;
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    it->second->expiry = expiry;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return Status::OkStatus();
+  }
+  if (index_.size() >= capacity_) {
+    auto last = std::prev(entries_.end());
+    index_.erase(last->key);
+    entries_.erase(last);
+  }
+  entries_.push_front(Entry{key, expiry});
+  index_.emplace(std::move(key), entries_.begin());
+  return Status::OkStatus();
+}
+
+void VerifiedCertificateCache::Clear() {
+  absl::MutexLock lock(&mu_);
+  index_.clear();
+  entries_.clear();
+}
+
+size_t VerifiedCertificateCache::size() const {
+  absl::MutexLock lock(&mu_);
+  return index_.size();
+}
+
+size_t VerifiedCertificateCache::hits() const {
+  absl::MutexLock lock(&mu_);
+  return hits_;
+}
+
+std::string VerifiedCertificateCache::VerificationKey(
+    const CertificateInterface &subject, const CertificateInterface &issuer,
+    const VerificationConfig &config) {
+  std::string key;
+  if (!AppendCertificateDigest(subject, &key) ||
+      !AppendCertificateDigest(issuer, &key)) {
+    return "";
+  }
+  key.push_back(config.issuer_ca ? '1' : '0');
+  key.push_back(config.max_pathlen ? '1' : '0');
+  key.push_back(config.issuer_key_usage ? '1' : '0');
+  return key;
+}
+
+}  // namespace asylo
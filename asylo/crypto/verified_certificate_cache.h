@@ -0,0 +1,108 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_CRYPTO_VERIFIED_CERTIFICATE_CACHE_H_
+#define ASYLO_CRYPTO_VERIFIED_CERTIFICATE_CACHE_H_
+
+#include <cstddef>
+#include <list>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "asylo/crypto/certificate_interface.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+
+// A bounded cache of successful certificate verifications. Each entry records
+// that a subject certificate was verified with an issuer certificate under a
+// given VerificationConfig, keyed on the SHA256 digests of both certificates.
+// Lets repeated verifications of the same certificate chains, such as those
+// presented by returning peers, skip all signature verifications.
+//
+// Entries expire after a fixed lifetime, and the least recently used entry is
+// evicted when the cache is full. Only successful verifications are cached.
+// The cache does not track revocation, so Clear() must be called whenever the
+// set of revoked certificates known to the caller changes.
+//
+// This class is thread-safe.
+class VerifiedCertificateCache {
+ public:
+  // Creates a cache of up to |capacity| verifications, each of which is trusted
+  // for |lifetime| after it was made. A cache with a capacity of 0 caches
+  // nothing.
+  VerifiedCertificateCache(size_t capacity, absl::Duration lifetime)
+      : capacity_(capacity), lifetime_(lifetime) {}
+
+  VerifiedCertificateCache(const VerifiedCertificateCache &) = delete;
+  VerifiedCertificateCache &operator=(const VerifiedCertificateCache &) =
+      delete;
+
+  // Verifies |subject| with |issuer| as subject.Verify(issuer, config) does.
+  // Returns an OK status without verifying again if the same verification
+  // succeeded within the lifetime of the cache.
+  Status Verify(const CertificateInterface &subject,
+                const CertificateInterface &issuer,
+                const VerificationConfig &config);
+
+  // Removes all verifications from the cache.
+  void Clear();
+
+  // Returns the number of cached verifications.
+  size_t size() const;
+
+  // Returns the number of calls to Verify() answered from the cache.
+  size_t hits() const;
+
+ private:
+  struct Entry {
+    std::string key;
+    absl::Time expiry;
+  };
+
+  // Returns the key of the verification of |subject| with |issuer| under
+  // |config|, or an empty string if either certificate cannot be digested.
+  static std::string VerificationKey(const CertificateInterface &subject,
+                                     const CertificateInterface &issuer,
+                                     const VerificationConfig &config);
+
+  // Maximum number of cached verifications.
+  const size_t capacity_;
+
+  // Time for which a verification is trusted.
+  const absl::Duration lifetime_;
+
+  mutable absl::Mutex mu_;
+
+  // Cached verifications in the order of their use, most recently used first.
+  std::list<Entry> entries_ ABSL_GUARDED_BY(mu_);
+
+  // Cached verifications keyed on their key.
+  absl::flat_hash_map<std::string, std::list<Entry>::iterator> index_
+      ABSL_GUARDED_BY(mu_);
+
+  // Number of verifications answered from the cache.
+  size_t hits_ ABSL_GUARDED_BY(mu_) = 0;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_CRYPTO_VERIFIED_CERTIFICATE_CACHE_H_
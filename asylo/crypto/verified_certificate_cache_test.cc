@@ -0,0 +1,120 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/crypto/verified_certificate_cache.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "asylo/crypto/certificate_interface.h"
+#include "asylo/crypto/fake_certificate.h"
+#include "asylo/test/util/status_matchers.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Not;
+
+constexpr char kRootKey[] = "Root key";
+constexpr char kIntermediateKey[] = "Intermediate key";
+constexpr char kOtherKey[] = "Other key";
+
+FakeCertificate CreateCertificate(const char *subject_key,
+                                  const char *issuer_key) {
+  return FakeCertificate(subject_key, issuer_key, /*is_ca=*/absl::nullopt,
+                         /*pathlength=*/absl::nullopt,
+                         /*subject_name=*/absl::nullopt);
+}
+
+TEST(VerifiedCertificateCacheTest, RepeatedVerificationHitsCache) {
+  VerifiedCertificateCache cache(/*capacity=*/4, absl::InfiniteDuration());
+  FakeCertificate root = CreateCertificate(kRootKey, kRootKey);
+  FakeCertificate intermediate = CreateCertificate(kIntermediateKey, kRootKey);
+  VerificationConfig config(/*all_fields=*/true);
+
+  ASYLO_EXPECT_OK(cache.Verify(intermediate, root, config));
+  EXPECT_EQ(cache.hits(), 0);
+  ASYLO_EXPECT_OK(cache.Verify(intermediate, root, config));
+  EXPECT_EQ(cache.hits(), 1);
+  EXPECT_EQ(cache.size(), 1);
+
+  // A different configuration is a different verification.
+  VerificationConfig other_config(/*all_fields=*/false);
+  ASYLO_EXPECT_OK(cache.Verify(intermediate, root, other_config));
+  EXPECT_EQ(cache.hits(), 1);
+  EXPECT_EQ(cache.size(), 2);
+}
+
+TEST(VerifiedCertificateCacheTest, FailedVerificationIsNotCached) {
+  VerifiedCertificateCache cache(/*capacity=*/4, absl::InfiniteDuration());
+  FakeCertificate root = CreateCertificate(kRootKey, kRootKey);
+  FakeCertificate other = CreateCertificate(kIntermediateKey, kOtherKey);
+  VerificationConfig config(/*all_fields=*/true);
+
+  EXPECT_THAT(cache.Verify(other, root, config), Not(IsOk()));
+  EXPECT_THAT(cache.Verify(other, root, config), Not(IsOk()));
+  EXPECT_EQ(cache.hits(), 0);
+  EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(VerifiedCertificateCacheTest, ExpiredVerificationIsRepeated) {
+  VerifiedCertificateCache cache(/*capacity=*/4, absl::ZeroDuration());
+  FakeCertificate root = CreateCertificate(kRootKey, kRootKey);
+  VerificationConfig config(/*all_fields=*/true);
+
+  ASYLO_EXPECT_OK(cache.Verify(root, root, config));
+  ASYLO_EXPECT_OK(cache.Verify(root, root, config));
+  EXPECT_EQ(cache.hits(), 0);
+}
+
+TEST(VerifiedCertificateCacheTest, EvictsLeastRecentlyUsed) {
+  VerifiedCertificateCache cache(/*capacity=*/2, absl::InfiniteDuration());
+  FakeCertificate root = CreateCertificate(kRootKey, kRootKey);
+  FakeCertificate intermediate = CreateCertificate(kIntermediateKey, kRootKey);
+  FakeCertificate other = CreateCertificate(kOtherKey, kRootKey);
+  VerificationConfig config(/*all_fields=*/true);
+
+  ASYLO_EXPECT_OK(cache.Verify(root, root, config));
+  ASYLO_EXPECT_OK(cache.Verify(intermediate, root, config));
+  ASYLO_EXPECT_OK(cache.Verify(root, root, config));
+  EXPECT_EQ(cache.hits(), 1);
+
+  // Evicts the verification of |intermediate|, which was used least recently.
+  ASYLO_EXPECT_OK(cache.Verify(other, root, config));
+  EXPECT_EQ(cache.size(), 2);
+  ASYLO_EXPECT_OK(cache.Verify(root, root, config));
+  EXPECT_EQ(cache.hits(), 2);
+  ASYLO_EXPECT_OK(cache.Verify(intermediate, root, config));
+  EXPECT_EQ(cache.hits(), 2);
+}
+
+TEST(VerifiedCertificateCacheTest, ClearRemovesAllVerifications) {
+  VerifiedCertificateCache cache(/*capacity=*/4, absl::InfiniteDuration());
+  FakeCertificate root = CreateCertificate(kRootKey, kRootKey);
+  VerificationConfig config(/*all_fields=*/true);
+
+  ASYLO_EXPECT_OK(cache.Verify(root, root, config));
+  cache.Clear();
+  EXPECT_EQ(cache.size(), 0);
+  ASYLO_EXPECT_OK(cache.Verify(root, root, config));
+  EXPECT_EQ(cache.hits(), 0);
+}
+
+}  // namespace
+}  // namespace asylo
@@ -0,0 +1,204 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/crypto/x25519_key_pool.h"
+
+#include <openssl/curve25519.h>
+#include <openssl/mem.h>
+
+#ifndef __ASYLO__
+#include <pthread.h>
+#endif  // __ASYLO__
+
+#include <atomic>
+#include <memory>
+
+#include "asylo/util/thread.h"
+
+namespace asylo {
+namespace {
+
+static_assert(X25519_PUBLIC_VALUE_LEN == 32 && X25519_PRIVATE_KEY_LEN == 32,
+              "Unexpected X25519 key sizes");
+
+// Capacity of the process-wide pool.
+constexpr size_t kDefaultCapacity = 32;
+
+// Pooled key pairs are only valid for the current generation, which
+// DiscardPooledKeys() advances.
+std::atomic<uint64_t> pool_generation(0);
+
+// The process-wide pool, once GetInstance() has created it.
+std::atomic<X25519KeyPool *> global_pool(nullptr);
+
+}  // namespace
+
+#ifndef __ASYLO__
+bool X25519KeyPool::RegisterForkHandlers() {
+  return pthread_atfork(&X25519KeyPool::LockBeforeFork,
+                        &X25519KeyPool::UnlockInParent,
+                        &X25519KeyPool::UnlockInChild) == 0;
+}
+
+void X25519KeyPool::LockBeforeFork() {
+  X25519KeyPool *pool = global_pool.load(std::memory_order_acquire);
+  if (pool) {
+    pool->state_->mu.Lock();
+  }
+}
+
+void X25519KeyPool::UnlockInParent() {
+  X25519KeyPool *pool = global_pool.load(std::memory_order_acquire);
+  if (pool) {
+    pool->state_->mu.Unlock();
+  }
+}
+
+void X25519KeyPool::UnlockInChild() {
+  DiscardPooledKeys();
+  UnlockInParent();
+}
+#endif  // __ASYLO__
+
+constexpr size_t X25519KeyPool::kKeySize;
+
+X25519KeyPool::State::State(size_t capacity)
+    : capacity(capacity),
+      generation(pool_generation.load(std::memory_order_acquire)) {
+  keys.reserve(capacity);
+}
+
+void X25519KeyPool::State::DropStaleKeysLocked() {
+  uint64_t current = pool_generation.load(std::memory_order_acquire);
+  if (current == generation) {
+    return;
+  }
+  for (KeyPair &pair : keys) {
+    OPENSSL_cleanse(&pair, sizeof(pair));
+  }
+  keys.clear();
+  generation = current;
+  // The refill thread was started by the parent of a fork and does not exist
+  // in this process. It is detached, so there is nothing to release.
+  refilling = false;
+}
+
+void X25519KeyPool::State::AddKeyPairLocked(const KeyPair &pair,
+                                            uint64_t pair_generation) {
+  if (generation == pair_generation && keys.size() < capacity &&
+      pool_generation.load(std::memory_order_acquire) == pair_generation) {
+    keys.push_back(pair);
+  }
+}
+
+X25519KeyPool::X25519KeyPool(size_t capacity, RefillPolicy refill_policy)
+    : refill_policy_(refill_policy), state_(std::make_shared<State>(capacity)) {
+#ifndef __ASYLO__
+  static const bool fork_handlers_registered = RegisterForkHandlers();
+  (void)fork_handlers_registered;
+#endif  // __ASYLO__
+}
+
+X25519KeyPool::~X25519KeyPool() {
+  absl::MutexLock lock(&state_->mu);
+  state_->stopping = true;
+  state_->refill_cv.Signal();
+}
+
+X25519KeyPool *X25519KeyPool::GetInstance() {
+  static X25519KeyPool *pool = [] {
+#ifdef __ASYLO__
+    constexpr RefillPolicy kRefillPolicy = RefillPolicy::kThreadUntilFull;
+#else   // __ASYLO__
+    constexpr RefillPolicy kRefillPolicy = RefillPolicy::kBackgroundThread;
+#endif  // __ASYLO__
+    auto *pool = new X25519KeyPool(kDefaultCapacity, kRefillPolicy);
+    global_pool.store(pool, std::memory_order_release);
+    return pool;
+  }();
+  return pool;
+}
+
+void X25519KeyPool::TakeKeyPair(std::vector<uint8_t> *public_key,
+                                CleansingVector<uint8_t> *private_key) {
+  KeyPair pair;
+  bool pooled = false;
+  {
+    absl::MutexLock lock(&state_->mu);
+    state_->DropStaleKeysLocked();
+    if (!state_->keys.empty()) {
+      pair = state_->keys.back();
+      OPENSSL_cleanse(&state_->keys.back(), sizeof(KeyPair));
+      state_->keys.pop_back();
+      pooled = true;
+    }
+    if (state_->keys.size() <= state_->capacity / 2 && !state_->stopping) {
+      if (!state_->refilling) {
+        state_->refilling = true;
+        Thread::StartDetached(
+            &X25519KeyPool::Refill, state_, state_->generation,
+            refill_policy_ == RefillPolicy::kThreadUntilFull);
+      } else {
+        state_->refill_cv.Signal();
+      }
+    }
+  }
+  if (!pooled) {
+    X25519_keypair(pair.public_key, pair.private_key);
+  }
+  public_key->assign(pair.public_key, pair.public_key + kKeySize);
+  private_key->assign(pair.private_key, pair.private_key + kKeySize);
+  OPENSSL_cleanse(&pair, sizeof(pair));
+}
+
+void X25519KeyPool::DiscardPooledKeys() {
+  pool_generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
+size_t X25519KeyPool::size() {
+  absl::MutexLock lock(&state_->mu);
+  state_->DropStaleKeysLocked();
+  return state_->keys.size();
+}
+
+void X25519KeyPool::Refill(std::shared_ptr<State> state, uint64_t generation,
+                           bool exit_when_full) {
+  absl::MutexLock lock(&state->mu);
+  while (!state->stopping && state->generation == generation) {
+    if (state->keys.size() >= state->capacity) {
+      if (exit_when_full) {
+        break;
+      }
+      state->refill_cv.Wait(&state->mu);
+      continue;
+    }
+    // Generate each pair without holding the lock, so that takers are not held
+    // up by the refill.
+    KeyPair pair;
+    state->mu.Unlock();
+    X25519_keypair(pair.public_key, pair.private_key);
+    state->mu.Lock();
+    state->AddKeyPairLocked(pair, generation);
+    OPENSSL_cleanse(&pair, sizeof(pair));
+  }
+  if (state->generation == generation) {
+    state->refilling = false;
+  }
+}
+
+}  // namespace asylo
@@ -0,0 +1,153 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_CRYPTO_X25519_KEY_POOL_H_
+#define ASYLO_CRYPTO_X25519_KEY_POOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "asylo/util/cleansing_types.h"
+
+namespace asylo {
+
+// A pool of pre-generated, single-use X25519 key pairs, so that key exchanges
+// such as EKEP handshakes do not generate their ephemeral key pair on the
+// critical path of connection setup.
+//
+// Key pairs are kept in memory that is cleansed as soon as a pair is taken out
+// of the pool, and each pair is handed out exactly once. When the number of
+// pooled pairs drops below half of the capacity, the pool is refilled one pair
+// at a time as set by its RefillPolicy. If the pool is empty, TakeKeyPair()
+// generates a pair inline.
+//
+// X25519KeyPool is thread-safe.
+class X25519KeyPool {
+ public:
+  // How the pool is refilled.
+  enum class RefillPolicy {
+    // A detached background thread, started with the first TakeKeyPair() call,
+    // fills the pool up while connections are idle. The thread exits once the
+    // pool is destroyed.
+    kBackgroundThread,
+    // Like kBackgroundThread, but the thread exits as soon as the pool is full
+    // and a new one is started the next time the pool drops below half of its
+    // capacity. This keeps no thread, and so no TCS of an enclave, busy while
+    // the pool is idle.
+    kThreadUntilFull,
+  };
+
+  // Creates a pool holding up to |capacity| key pairs, refilled as set by
+  // |refill_policy|. The pool starts empty.
+  X25519KeyPool(size_t capacity, RefillPolicy refill_policy);
+
+  X25519KeyPool(const X25519KeyPool &other) = delete;
+  X25519KeyPool &operator=(const X25519KeyPool &other) = delete;
+
+  // Stops the refill thread, without waiting for it to exit.
+  ~X25519KeyPool();
+
+  // Returns the process-wide pool, which is never destroyed. Inside an enclave
+  // its refill thread only runs until the pool is full.
+  static X25519KeyPool *GetInstance();
+
+  // Sets |public_key| and |private_key| to a key pair that has never been
+  // handed out before.
+  void TakeKeyPair(std::vector<uint8_t> *public_key,
+                   CleansingVector<uint8_t> *private_key);
+
+  // Discards the key pairs pooled by every X25519KeyPool, and those being
+  // generated, so that the parent and the child of a fork never hand out the
+  // same key pair. Must only be called in the child of a fork, where the
+  // refill threads of the parent do not exist. Called automatically in the
+  // child of fork() on hosts.
+  static void DiscardPooledKeys();
+
+  // Returns the number of key pairs currently in the pool.
+  size_t size() ABSL_LOCKS_EXCLUDED(state_->mu);
+
+ private:
+  // Sizes of X25519 keys, as defined by RFC 7748.
+  static constexpr size_t kKeySize = 32;
+
+  struct KeyPair {
+    uint8_t public_key[kKeySize];
+    uint8_t private_key[kKeySize];
+  };
+
+  // The state of a pool, shared with its refill thread so that the thread may
+  // outlive the pool.
+  struct State {
+    explicit State(size_t capacity);
+
+    // Drops the pooled key pairs and forgets the refill thread if
+    // DiscardPooledKeys() was called since they were generated.
+    void DropStaleKeysLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu);
+
+    // Adds |pair| to the pool if it has room and |pair_generation|, the
+    // generation |pair| was generated in, is still current.
+    void AddKeyPairLocked(const KeyPair &pair, uint64_t pair_generation)
+        ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu);
+
+    const size_t capacity;
+
+    absl::Mutex mu;
+    absl::CondVar refill_cv;
+
+    // Pooled key pairs, taken from the back. Slots are cleansed when taken.
+    CleansingVector<KeyPair> keys ABSL_GUARDED_BY(mu);
+
+    // Generation of DiscardPooledKeys() calls |keys| were generated in.
+    uint64_t generation ABSL_GUARDED_BY(mu);
+
+    bool stopping ABSL_GUARDED_BY(mu) = false;
+
+    // Whether a refill thread of |generation| runs.
+    bool refilling ABSL_GUARDED_BY(mu) = false;
+  };
+
+#ifndef __ASYLO__
+  // Registers the fork handlers below with pthread_atfork().
+  static bool RegisterForkHandlers();
+
+  // Holds the lock of the process-wide pool across fork(), so that the child
+  // does not inherit it locked by the refill thread.
+  static void LockBeforeFork();
+  static void UnlockInParent();
+
+  // Releases the lock of the process-wide pool and discards the pooled keys.
+  static void UnlockInChild();
+#endif  // __ASYLO__
+
+  // Body of the refill thread, which fills the pool with key pairs of
+  // |generation| until it is stopped or the generation changes, or if
+  // |exit_when_full| is set, until the pool is full.
+  static void Refill(std::shared_ptr<State> state, uint64_t generation,
+                     bool exit_when_full);
+
+  const RefillPolicy refill_policy_;
+  const std::shared_ptr<State> state_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_CRYPTO_X25519_KEY_POOL_H_
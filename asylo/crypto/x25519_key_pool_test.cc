@@ -0,0 +1,166 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/crypto/x25519_key_pool.h"
+
+#include <openssl/curve25519.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/container/flat_hash_set.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "asylo/util/cleansing_types.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Eq;
+using ::testing::SizeIs;
+
+constexpr size_t kCapacity = 8;
+
+constexpr X25519KeyPool::RefillPolicy kBackgroundThread =
+    X25519KeyPool::RefillPolicy::kBackgroundThread;
+constexpr X25519KeyPool::RefillPolicy kThreadUntilFull =
+    X25519KeyPool::RefillPolicy::kThreadUntilFull;
+
+// Enough key pairs to drain the pool several times.
+constexpr size_t kNumberOfKeyPairs = 100;
+
+// Waits for the refill thread of |pool| to fill it up.
+bool WaitUntilFull(X25519KeyPool *pool) {
+  absl::Time deadline = absl::Now() + absl::Seconds(30);
+  while (pool->size() < kCapacity) {
+    if (absl::Now() > deadline) {
+      return false;
+    }
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  return true;
+}
+
+// Tests that every key pair handed out is a valid X25519 key pair.
+TEST(X25519KeyPoolTest, KeyPairsAreValid) {
+  X25519KeyPool pool(kCapacity, kBackgroundThread);
+  for (size_t i = 0; i < kNumberOfKeyPairs; ++i) {
+    std::vector<uint8_t> public_key;
+    CleansingVector<uint8_t> private_key;
+    pool.TakeKeyPair(&public_key, &private_key);
+    ASSERT_THAT(public_key, SizeIs(X25519_PUBLIC_VALUE_LEN));
+    ASSERT_THAT(private_key, SizeIs(X25519_PRIVATE_KEY_LEN));
+    std::vector<uint8_t> expected_public_key(X25519_PUBLIC_VALUE_LEN);
+    X25519_public_from_private(expected_public_key.data(), private_key.data());
+    EXPECT_THAT(public_key, Eq(expected_public_key));
+  }
+}
+
+// Tests that no key pair is handed out twice, whether it comes from the pool
+// or is generated inline.
+TEST(X25519KeyPoolTest, KeyPairsAreNotReused) {
+  X25519KeyPool pool(kCapacity, kBackgroundThread);
+  absl::flat_hash_set<std::string> public_keys;
+  for (size_t i = 0; i < kNumberOfKeyPairs; ++i) {
+    std::vector<uint8_t> public_key;
+    CleansingVector<uint8_t> private_key;
+    pool.TakeKeyPair(&public_key, &private_key);
+    EXPECT_TRUE(
+        public_keys.emplace(public_key.begin(), public_key.end()).second);
+  }
+}
+
+// Tests that the pool refills in the background once key pairs are taken.
+TEST(X25519KeyPoolTest, PoolRefills) {
+  X25519KeyPool pool(kCapacity, kBackgroundThread);
+  EXPECT_THAT(pool.size(), Eq(0));
+
+  std::vector<uint8_t> public_key;
+  CleansingVector<uint8_t> private_key;
+  pool.TakeKeyPair(&public_key, &private_key);
+  ASSERT_TRUE(WaitUntilFull(&pool));
+
+  for (size_t i = 0; i < kCapacity; ++i) {
+    pool.TakeKeyPair(&public_key, &private_key);
+  }
+  ASSERT_TRUE(WaitUntilFull(&pool));
+}
+
+// Tests that a pool whose refill thread exits once the pool is full starts a
+// new one each time it is drained.
+TEST(X25519KeyPoolTest, PoolRefillsUntilFull) {
+  X25519KeyPool pool(kCapacity, kThreadUntilFull);
+  std::vector<uint8_t> public_key;
+  CleansingVector<uint8_t> private_key;
+  for (int round = 0; round < 3; ++round) {
+    for (size_t i = 0; i < kCapacity; ++i) {
+      pool.TakeKeyPair(&public_key, &private_key);
+    }
+    ASSERT_TRUE(WaitUntilFull(&pool));
+  }
+}
+
+// Tests that a pool can be destroyed while its refill thread is running.
+TEST(X25519KeyPoolTest, DestroyedWhileRefilling) {
+  for (size_t i = 0; i < kNumberOfKeyPairs; ++i) {
+    X25519KeyPool pool(kCapacity, i % 2 ? kBackgroundThread : kThreadUntilFull);
+    std::vector<uint8_t> public_key;
+    CleansingVector<uint8_t> private_key;
+    pool.TakeKeyPair(&public_key, &private_key);
+  }
+}
+
+// Tests that the child of a fork does not hand out the key pairs its parent
+// pooled before the fork.
+TEST(X25519KeyPoolTest, ForkedKeyPairsDiffer) {
+  X25519KeyPool *pool = X25519KeyPool::GetInstance();
+  std::vector<uint8_t> public_key;
+  CleansingVector<uint8_t> private_key;
+  pool->TakeKeyPair(&public_key, &private_key);
+  ASSERT_TRUE(WaitUntilFull(pool));
+
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  pid_t pid = fork();
+  ASSERT_NE(pid, -1);
+  if (pid == 0) {
+    close(fds[0]);
+    pool->TakeKeyPair(&public_key, &private_key);
+    bool ok = write(fds[1], public_key.data(), public_key.size()) ==
+              static_cast<ssize_t>(public_key.size());
+    _exit(ok ? 0 : 1);
+  }
+  close(fds[1]);
+  std::vector<uint8_t> child_public_key(X25519_PUBLIC_VALUE_LEN);
+  ASSERT_EQ(read(fds[0], child_public_key.data(), child_public_key.size()),
+            static_cast<ssize_t>(child_public_key.size()));
+  close(fds[0]);
+  int wstatus;
+  ASSERT_EQ(waitpid(pid, &wstatus, 0), pid);
+  EXPECT_TRUE(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+
+  pool->TakeKeyPair(&public_key, &private_key);
+  EXPECT_NE(public_key, child_public_key);
+}
+
+}  // namespace
+}  // namespace asylo
@@ -26,9 +26,11 @@
 #include <unistd.h>
 
 #include <array>
+#include <atomic>
 #include <cerrno>
 #include <cstdint>
 #include <string>
+#include <utility>
 
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
@@ -80,9 +82,7 @@ StatusOr<std::string> GetPerBootUuid() {
   return std::string(uuid.data(), uuid.size());
 }
 
-}  // namespace
-
-StatusOr<std::string> GetAttestationDomain() {
+StatusOr<std::string> ComputeAttestationDomain() {
   std::string boot_uuid;
   ASYLO_ASSIGN_OR_RETURN(boot_uuid, GetPerBootUuid());
 
@@ -105,4 +105,27 @@ StatusOr<std::string> GetAttestationDomain() {
                      kAttestationDomainSize);
 }
 
+}  // namespace
+
+StatusOr<std::string> GetAttestationDomain() {
+  // The boot UUID does not change while the process runs, so the domain is
+  // derived once. Failures are not cached and are retried on the next call.
+  static std::atomic<const std::string *> cached_domain(nullptr);
+
+  const std::string *domain = cached_domain.load(std::memory_order_acquire);
+  if (domain) {
+    return *domain;
+  }
+
+  std::string computed_domain;
+  ASYLO_ASSIGN_OR_RETURN(computed_domain, ComputeAttestationDomain());
+  const std::string *new_domain = new std::string(std::move(computed_domain));
+  if (!cached_domain.compare_exchange_strong(domain, new_domain,
+                                             std::memory_order_acq_rel)) {
+    // Another thread cached the domain first.
+    delete new_domain;
+  }
+  return *cached_domain.load(std::memory_order_acquire);
+}
+
 }  // namespace asylo
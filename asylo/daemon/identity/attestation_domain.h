@@ -35,7 +35,8 @@ constexpr size_t kAttestationDomainNameSize = 16;
 // attestation domain can use the cheaper, symmetric-key-based local attestation
 // to verify each other's identity.
 //
-// Note that the attestation domain value may change per boot.
+// Note that the attestation domain value may change per boot. It is computed
+// once per process and cached after the first successful call.
 StatusOr<std::string> GetAttestationDomain();
 
 }  // namespace asylo
@@ -0,0 +1,158 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/daemon/verification/assertion_verification_service_impl.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "asylo/grpc/auth/enclave_auth_context.h"
+#include "asylo/identity/attestation/enclave_assertion_verifier.h"
+#include "asylo/identity/enclave_assertion_authority.h"
+#include "asylo/identity/init.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+namespace {
+
+// Returns the initialized verifier registered for |description|, or nullptr if
+// there is none.
+const EnclaveAssertionVerifier *FindVerifier(
+    const AssertionDescription &description) {
+  StatusOr<std::string> authority_id_result =
+      EnclaveAssertionAuthority::GenerateAuthorityId(
+          description.identity_type(), description.authority_type());
+  if (!authority_id_result.ok()) {
+    return nullptr;
+  }
+  Status status = InitializeDeferredEnclaveAssertionAuthority(description);
+  LOG_IF(ERROR, !status.ok())
+      << "Failed to initialize assertion authority for "
+      << description.ShortDebugString() << ": " << status;
+  auto it = AssertionVerifierMap::GetValue(authority_id_result.ValueOrDie());
+  if (it == AssertionVerifierMap::value_end() || !it->IsInitialized()) {
+    return nullptr;
+  }
+  return &*it;
+}
+
+}  // namespace
+
+AssertionVerificationServiceImpl::AssertionVerificationServiceImpl(
+    std::unique_ptr<sgx::SgxPcsClient> pcs_client)
+    : pcs_client_(std::move(pcs_client)) {}
+
+::grpc::Status AssertionVerificationServiceImpl::VerifyAssertion(
+    ::grpc::ServerContext *context, const VerifyAssertionRequest *request,
+    VerifyAssertionResponse *response) {
+  ::grpc::Status grpc_status = CheckPeer(context);
+  if (!grpc_status.ok()) {
+    return grpc_status;
+  }
+
+  const AssertionDescription &description =
+      request->assertion().description();
+  const EnclaveAssertionVerifier *verifier = FindVerifier(description);
+  if (verifier == nullptr) {
+    return ::grpc::Status(
+        ::grpc::StatusCode::NOT_FOUND,
+        absl::StrCat("No verifier for assertions of ",
+                     description.ShortDebugString()));
+  }
+
+  Status status =
+      verifier->Verify(request->user_data(), request->assertion(),
+                       response->mutable_peer_identity());
+  if (!status.ok()) {
+    response->Clear();
+    return status.ToOtherStatus<::grpc::Status>();
+  }
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status AssertionVerificationServiceImpl::GetPckCrl(
+    ::grpc::ServerContext *context, const GetPckCrlRequest *request,
+    GetPckCrlResponse *response) {
+  ::grpc::Status grpc_status = CheckCollateralRequest(context);
+  if (!grpc_status.ok()) {
+    return grpc_status;
+  }
+
+  StatusOr<sgx::GetCrlResult> result =
+      pcs_client_->GetCrl(request->sgx_ca_type());
+  if (!result.ok()) {
+    Status status = result.status();
+    return status.ToOtherStatus<::grpc::Status>();
+  }
+  *response->mutable_pck_crl() = std::move(result.ValueOrDie().pck_crl);
+  *response->mutable_issuer_cert_chain() =
+      std::move(result.ValueOrDie().issuer_cert_chain);
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status AssertionVerificationServiceImpl::GetTcbInfo(
+    ::grpc::ServerContext *context, const GetTcbInfoRequest *request,
+    GetTcbInfoResponse *response) {
+  ::grpc::Status grpc_status = CheckCollateralRequest(context);
+  if (!grpc_status.ok()) {
+    return grpc_status;
+  }
+
+  StatusOr<sgx::GetTcbInfoResult> result =
+      pcs_client_->GetTcbInfo(request->fmspc());
+  if (!result.ok()) {
+    Status status = result.status();
+    return status.ToOtherStatus<::grpc::Status>();
+  }
+  *response->mutable_tcb_info() = std::move(result.ValueOrDie().tcb_info);
+  *response->mutable_issuer_cert_chain() =
+      std::move(result.ValueOrDie().issuer_cert_chain);
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status AssertionVerificationServiceImpl::CheckPeer(
+    ::grpc::ServerContext *context) {
+  StatusOr<EnclaveAuthContext> auth_context_result =
+      EnclaveAuthContext::CreateFromAuthContext(*context->auth_context());
+  if (!auth_context_result.ok()) {
+    LOG(ERROR) << "CreateFromAuthContext failed: "
+               << auth_context_result.status();
+    return ::grpc::Status(::grpc::StatusCode::PERMISSION_DENIED,
+                          "Peer did not authenticate with an enclave identity");
+  }
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status AssertionVerificationServiceImpl::CheckCollateralRequest(
+    ::grpc::ServerContext *context) const {
+  ::grpc::Status grpc_status = CheckPeer(context);
+  if (!grpc_status.ok()) {
+    return grpc_status;
+  }
+  if (pcs_client_ == nullptr) {
+    return ::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION,
+                          "No collateral source configured");
+  }
+  return ::grpc::Status::OK;
+}
+
+}  // namespace asylo
@@ -0,0 +1,81 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_DAEMON_VERIFICATION_ASSERTION_VERIFICATION_SERVICE_IMPL_H_
+#define ASYLO_DAEMON_VERIFICATION_ASSERTION_VERIFICATION_SERVICE_IMPL_H_
+
+#include <memory>
+
+#include "asylo/daemon/verification/assertion_verification.grpc.pb.h"
+#include "asylo/daemon/verification/assertion_verification.pb.h"
+#include "asylo/identity/provisioning/sgx/internal/sgx_pcs_client.h"
+#include "include/grpcpp/server_context.h"
+#include "include/grpcpp/support/status.h"
+
+namespace asylo {
+
+// AssertionVerificationServiceImpl verifies assertions for authenticated local
+// enclaves with the assertion verifiers registered in the process, and serves
+// SGX collateral from an SgxPcsClient.
+//
+// The registered verifiers are shared by all callers, so the platforms and
+// certificate chains they cache are verified once for all the enclaves on the
+// host. Verifiers with a deferred configuration are initialized on their first
+// use, as they are by EKEP.
+//
+// This service requires that the peer authenticates with an enclave identity.
+// The gRPC server's credentials configuration should enforce which identities
+// are accepted.
+class AssertionVerificationServiceImpl
+    : public AssertionVerification::Service {
+ public:
+  // Creates a service that serves collateral from |pcs_client|, which is
+  // expected to cache its responses, such as a CachingSgxPcsClient. If
+  // |pcs_client| is null, the collateral RPCs return FAILED_PRECONDITION.
+  explicit AssertionVerificationServiceImpl(
+      std::unique_ptr<sgx::SgxPcsClient> pcs_client = nullptr);
+
+  // Verifies the assertion in |request| with the registered verifier matching
+  // its description. Returns NOT_FOUND if no initialized verifier matches it,
+  // and the error of the verifier if the assertion does not verify.
+  ::grpc::Status VerifyAssertion(::grpc::ServerContext *context,
+                                 const VerifyAssertionRequest *request,
+                                 VerifyAssertionResponse *response) override;
+
+  ::grpc::Status GetPckCrl(::grpc::ServerContext *context,
+                           const GetPckCrlRequest *request,
+                           GetPckCrlResponse *response) override;
+
+  ::grpc::Status GetTcbInfo(::grpc::ServerContext *context,
+                            const GetTcbInfoRequest *request,
+                            GetTcbInfoResponse *response) override;
+
+ private:
+  // Returns OK if the caller described in |context| authenticated with an
+  // enclave identity, and PERMISSION_DENIED otherwise.
+  static ::grpc::Status CheckPeer(::grpc::ServerContext *context);
+
+  // Returns OK if the caller described in |context| may be served collateral.
+  ::grpc::Status CheckCollateralRequest(::grpc::ServerContext *context) const;
+
+  const std::unique_ptr<sgx::SgxPcsClient> pcs_client_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_DAEMON_VERIFICATION_ASSERTION_VERIFICATION_SERVICE_IMPL_H_
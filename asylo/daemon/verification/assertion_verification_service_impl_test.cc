@@ -0,0 +1,219 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/daemon/verification/assertion_verification_service_impl.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "asylo/daemon/verification/assertion_verification.grpc.pb.h"
+#include "asylo/daemon/verification/assertion_verification.pb.h"
+#include "asylo/grpc/auth/enclave_channel_credentials.h"
+#include "asylo/grpc/auth/enclave_server_credentials.h"
+#include "asylo/grpc/auth/null_credentials_options.h"
+#include "asylo/identity/attestation/enclave_assertion_generator.h"
+#include "asylo/identity/descriptions.h"
+#include "asylo/identity/enclave_assertion_authority.h"
+#include "asylo/identity/enclave_assertion_authority_config.pb.h"
+#include "asylo/identity/init.h"
+#include "asylo/identity/provisioning/sgx/internal/mock_sgx_pcs_client.h"
+#include "asylo/test/util/enclave_assertion_authority_configs.h"
+#include "asylo/test/util/proto_matchers.h"
+#include "asylo/test/util/status_matchers.h"
+#include "include/grpcpp/grpcpp.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Return;
+
+constexpr char kAddress[] = "[::1]";
+constexpr char kUserData[] = "user data";
+constexpr char kTcbInfoJson[] = "{\"tcbInfo\":{}}";
+
+const int64_t kDeadlineMicros = absl::Seconds(5) / absl::Microseconds(1);
+
+class AssertionVerificationServiceImplTest : public ::testing::Test {
+ protected:
+  static void SetUpTestSuite() {
+    std::vector<EnclaveAssertionAuthorityConfig> authority_configs = {
+        GetNullAssertionAuthorityTestConfig()};
+    ASSERT_THAT(InitializeEnclaveAssertionAuthorities(
+                    authority_configs.cbegin(), authority_configs.cend()),
+                IsOk());
+  }
+
+  void TearDown() override {
+    if (server_) {
+      server_->Shutdown();
+    }
+  }
+
+  // Starts a server hosting |service_| with |server_credentials| and connects
+  // a stub to it with |channel_credentials|.
+  void SetUpServerAndStub(
+      const std::shared_ptr<::grpc::ServerCredentials> &server_credentials,
+      const std::shared_ptr<::grpc::ChannelCredentials> &channel_credentials) {
+    ::grpc::ServerBuilder builder;
+    builder.RegisterService(service_.get());
+    int port = 0;
+    builder.AddListeningPort(absl::StrCat(kAddress, ":", port),
+                             server_credentials, &port);
+    server_ = builder.BuildAndStart();
+    ASSERT_NE(port, 0);
+
+    std::shared_ptr<::grpc::Channel> channel = ::grpc::CreateChannel(
+        absl::StrCat(kAddress, ":", port), channel_credentials);
+    gpr_timespec absolute_deadline =
+        gpr_time_add(gpr_now(GPR_CLOCK_REALTIME),
+                     gpr_time_from_micros(kDeadlineMicros, GPR_TIMESPAN));
+    ASSERT_TRUE(channel->WaitForConnected(absolute_deadline));
+    stub_ = AssertionVerification::NewStub(channel);
+  }
+
+  // Starts a server with null credentials, which authenticate both peers with
+  // the null identity.
+  void SetUpNullServerAndStub() {
+    SetUpServerAndStub(
+        EnclaveServerCredentials(BidirectionalNullCredentialsOptions()),
+        EnclaveChannelCredentials(BidirectionalNullCredentialsOptions()));
+  }
+
+  // Generates a null assertion over |user_data|.
+  static Assertion MakeNullAssertion(const std::string &user_data) {
+    AssertionRequest request;
+    SetNullAssertionDescription(request.mutable_description());
+    std::string authority_id =
+        EnclaveAssertionAuthority::GenerateAuthorityId(
+            request.description().identity_type(),
+            request.description().authority_type())
+            .ValueOrDie();
+    Assertion assertion;
+    auto it = AssertionGeneratorMap::GetValue(authority_id);
+    EXPECT_NE(it, AssertionGeneratorMap::value_end());
+    EXPECT_THAT(it->Generate(user_data, request, &assertion), IsOk());
+    return assertion;
+  }
+
+  std::unique_ptr<AssertionVerificationServiceImpl> service_;
+  std::unique_ptr<::grpc::Server> server_;
+  std::unique_ptr<AssertionVerification::Stub> stub_;
+};
+
+TEST_F(AssertionVerificationServiceImplTest, VerifyAssertionReturnsIdentity) {
+  service_ = absl::make_unique<AssertionVerificationServiceImpl>();
+  SetUpNullServerAndStub();
+
+  VerifyAssertionRequest request;
+  request.set_user_data(kUserData);
+  *request.mutable_assertion() = MakeNullAssertion(kUserData);
+  VerifyAssertionResponse response;
+  ::grpc::ClientContext context;
+  ASSERT_TRUE(stub_->VerifyAssertion(&context, request, &response).ok());
+
+  EnclaveIdentityDescription expected_description;
+  SetNullIdentityDescription(&expected_description);
+  EXPECT_THAT(response.peer_identity().description(),
+              EqualsProto(expected_description));
+}
+
+TEST_F(AssertionVerificationServiceImplTest,
+       VerifyAssertionOverOtherUserDataFails) {
+  service_ = absl::make_unique<AssertionVerificationServiceImpl>();
+  SetUpNullServerAndStub();
+
+  VerifyAssertionRequest request;
+  request.set_user_data("other user data");
+  *request.mutable_assertion() = MakeNullAssertion(kUserData);
+  VerifyAssertionResponse response;
+  ::grpc::ClientContext context;
+  EXPECT_EQ(stub_->VerifyAssertion(&context, request, &response).error_code(),
+            ::grpc::StatusCode::INVALID_ARGUMENT);
+  EXPECT_FALSE(response.has_peer_identity());
+}
+
+TEST_F(AssertionVerificationServiceImplTest,
+       VerifyAssertionWithoutVerifierFails) {
+  service_ = absl::make_unique<AssertionVerificationServiceImpl>();
+  SetUpNullServerAndStub();
+
+  VerifyAssertionRequest request;
+  request.set_user_data(kUserData);
+  *request.mutable_assertion() = MakeNullAssertion(kUserData);
+  request.mutable_assertion()->mutable_description()->set_authority_type(
+      "Unknown Authority");
+  VerifyAssertionResponse response;
+  ::grpc::ClientContext context;
+  EXPECT_EQ(stub_->VerifyAssertion(&context, request, &response).error_code(),
+            ::grpc::StatusCode::NOT_FOUND);
+}
+
+TEST_F(AssertionVerificationServiceImplTest,
+       UnauthenticatedCallerIsRejected) {
+  service_ = absl::make_unique<AssertionVerificationServiceImpl>();
+  SetUpServerAndStub(::grpc::InsecureServerCredentials(),
+                     ::grpc::InsecureChannelCredentials());
+
+  VerifyAssertionRequest request;
+  request.set_user_data(kUserData);
+  *request.mutable_assertion() = MakeNullAssertion(kUserData);
+  VerifyAssertionResponse response;
+  ::grpc::ClientContext context;
+  EXPECT_EQ(stub_->VerifyAssertion(&context, request, &response).error_code(),
+            ::grpc::StatusCode::PERMISSION_DENIED);
+}
+
+TEST_F(AssertionVerificationServiceImplTest, GetTcbInfoServesCollateral) {
+  auto pcs_client = absl::make_unique<sgx::MockSgxPcsClient>();
+  sgx::GetTcbInfoResult result;
+  result.tcb_info.set_tcb_info_json(kTcbInfoJson);
+  EXPECT_CALL(*pcs_client, GetTcbInfo).WillOnce(Return(result));
+  service_ = absl::make_unique<AssertionVerificationServiceImpl>(
+      std::move(pcs_client));
+  SetUpNullServerAndStub();
+
+  GetTcbInfoRequest request;
+  request.mutable_fmspc()->set_value("fmspc0");
+  GetTcbInfoResponse response;
+  ::grpc::ClientContext context;
+  ASSERT_TRUE(stub_->GetTcbInfo(&context, request, &response).ok());
+  EXPECT_EQ(response.tcb_info().tcb_info_json(), kTcbInfoJson);
+}
+
+TEST_F(AssertionVerificationServiceImplTest,
+       CollateralWithoutPcsClientFails) {
+  service_ = absl::make_unique<AssertionVerificationServiceImpl>();
+  SetUpNullServerAndStub();
+
+  GetPckCrlRequest request;
+  request.set_sgx_ca_type(sgx::PROCESSOR);
+  GetPckCrlResponse response;
+  ::grpc::ClientContext context;
+  EXPECT_EQ(stub_->GetPckCrl(&context, request, &response).error_code(),
+            ::grpc::StatusCode::FAILED_PRECONDITION);
+}
+
+}  // namespace
+}  // namespace asylo
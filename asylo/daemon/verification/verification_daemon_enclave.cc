@@ -0,0 +1,79 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <memory>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "asylo/daemon/verification/assertion_verification.pb.h"
+#include "asylo/daemon/verification/assertion_verification_service_impl.h"
+#include "asylo/enclave.pb.h"
+#include "asylo/grpc/auth/enclave_server_credentials.h"
+#include "asylo/grpc/auth/sgx_local_credentials_options.h"
+#include "asylo/grpc/util/enclave_server.h"
+#include "asylo/identity/provisioning/sgx/internal/caching_sgx_pcs_client.h"
+#include "asylo/identity/provisioning/sgx/internal/sgx_pcs_client.h"
+#include "asylo/identity/provisioning/sgx/internal/sgx_pcs_client_impl.h"
+#include "asylo/platform/core/trusted_global_state.h"
+#include "asylo/trusted_application.h"
+#include "asylo/util/http_fetcher_impl.h"
+#include "asylo/util/status_macros.h"
+#include "asylo/util/statusor.h"
+#include "include/grpcpp/impl/codegen/service_type.h"
+
+namespace asylo {
+namespace {
+
+// Creates the verification service from the verification_daemon_config
+// extension of the enclave config. The service verifies assertions with the
+// assertion authorities configured for the enclave.
+StatusOr<std::unique_ptr<::grpc::Service>> CreateVerificationService() {
+  const EnclaveConfig *config;
+  ASYLO_ASSIGN_OR_RETURN(config, GetEnclaveConfig());
+  const VerificationDaemonConfig &daemon_config =
+      config->GetExtension(verification_daemon_config);
+
+  std::unique_ptr<sgx::SgxPcsClient> pcs_client;
+  if (daemon_config.has_pcs_api_key()) {
+    std::unique_ptr<sgx::SgxPcsClient> client;
+    ASYLO_ASSIGN_OR_RETURN(
+        client, sgx::SgxPcsClientImpl::CreateWithoutPpidEncryptionKey(
+                    absl::make_unique<HttpFetcherImpl>(),
+                    daemon_config.pcs_api_key()));
+    sgx::CachingSgxPcsClientOptions options;
+    options.cache_directory = daemon_config.collateral_cache_directory();
+    pcs_client =
+        sgx::CachingSgxPcsClient::Create(std::move(client), std::move(options));
+  }
+  return std::unique_ptr<::grpc::Service>(
+      absl::make_unique<AssertionVerificationServiceImpl>(
+          std::move(pcs_client)));
+}
+
+}  // namespace
+
+// Hosts the assertion verification service for the enclaves on the host. Only
+// enclaves on the same machine that authenticate with SGX local attestation can
+// reach the service.
+TrustedApplication *BuildTrustedApplication() {
+  return new EnclaveServer(
+      CreateVerificationService,
+      EnclaveServerCredentials(BidirectionalSgxLocalCredentialsOptions()));
+}
+
+}  // namespace asylo
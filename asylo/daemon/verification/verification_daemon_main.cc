@@ -0,0 +1,147 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "asylo/client.h"
+#include "asylo/daemon/verification/assertion_verification.pb.h"
+#include "asylo/enclave.pb.h"
+#include "asylo/grpc/util/enclave_server.pb.h"
+#include "asylo/identity/enclave_assertion_authority_config.pb.h"
+#include "asylo/identity/enclave_assertion_authority_configs.h"
+#include "asylo/platform/primitives/sgx/loader.pb.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/status.h"
+#include "asylo/util/status_macros.h"
+#include "asylo/util/statusor.h"
+
+ABSL_FLAG(std::string, enclave_path, "",
+          "Path to the verification daemon enclave");
+
+ABSL_FLAG(bool, debug, false, "Whether to run the enclave in debug mode");
+
+ABSL_FLAG(std::string, host, "localhost",
+          "The host the verification service listens on");
+
+// Default value 0 is used to indicate that the system should choose an
+// available port.
+ABSL_FLAG(int32_t, port, 0, "The port the verification service listens on");
+
+ABSL_FLAG(std::string, pcs_api_key, "",
+          "API key for Intel PCS. If empty, no collateral is served");
+
+ABSL_FLAG(std::string, collateral_cache_directory, "",
+          "Directory holding the on-disk collateral cache");
+
+ABSL_FLAG(absl::Duration, server_lifetime, absl::InfiniteDuration(),
+          "The amount of time to run the verification service before exiting");
+
+namespace {
+
+constexpr char kEnclaveName[] = "verification_daemon";
+
+asylo::StatusOr<asylo::EnclaveLoadConfig> CreateLoadConfig() {
+  asylo::EnclaveLoadConfig load_config;
+  load_config.set_name(kEnclaveName);
+
+  asylo::EnclaveConfig *config = load_config.mutable_config();
+  asylo::ServerConfig *server_config =
+      config->MutableExtension(asylo::server_input_config);
+  server_config->set_host(absl::GetFlag(FLAGS_host));
+  server_config->set_port(absl::GetFlag(FLAGS_port));
+
+  asylo::VerificationDaemonConfig *daemon_config =
+      config->MutableExtension(asylo::verification_daemon_config);
+  if (!absl::GetFlag(FLAGS_pcs_api_key).empty()) {
+    daemon_config->set_pcs_api_key(absl::GetFlag(FLAGS_pcs_api_key));
+  }
+  daemon_config->set_collateral_cache_directory(
+      absl::GetFlag(FLAGS_collateral_cache_directory));
+
+  // SGX local attestation authenticates the callers of the service. Intel ECDSA
+  // QE assertions are the ones the service verifies. Its authority is only
+  // initialized once the first such assertion is verified, so that the daemon
+  // also starts on hosts without the quoting libraries.
+  ASYLO_ASSIGN_OR_RETURN(*config->add_enclave_assertion_authority_configs(),
+                         asylo::CreateSgxLocalAssertionAuthorityConfig());
+  asylo::EnclaveAssertionAuthorityConfig *ecdsa_config =
+      config->add_enclave_assertion_authority_configs();
+  ASYLO_ASSIGN_OR_RETURN(
+      *ecdsa_config,
+      asylo::experimental::
+          CreateSgxIntelEcdsaQeRemoteAssertionAuthorityConfig());
+  ecdsa_config->set_initialize_on_first_use(true);
+
+  asylo::SgxLoadConfig *sgx_config =
+      load_config.MutableExtension(asylo::sgx_load_config);
+  sgx_config->mutable_file_enclave_config()->set_enclave_path(
+      absl::GetFlag(FLAGS_enclave_path));
+  sgx_config->set_debug(absl::GetFlag(FLAGS_debug));
+  return load_config;
+}
+
+// Loads the verification daemon enclave and returns the port its service
+// listens on.
+asylo::StatusOr<int> StartVerificationDaemon() {
+  ASYLO_RETURN_IF_ERROR(
+      asylo::EnclaveManager::Configure(asylo::EnclaveManagerOptions()));
+  asylo::EnclaveManager *manager;
+  ASYLO_ASSIGN_OR_RETURN(manager, asylo::EnclaveManager::Instance());
+
+  asylo::EnclaveLoadConfig load_config;
+  ASYLO_ASSIGN_OR_RETURN(load_config, CreateLoadConfig());
+  ASYLO_RETURN_IF_ERROR(manager->LoadEnclave(load_config));
+
+  asylo::EnclaveInput input;
+  asylo::EnclaveOutput output;
+  ASYLO_RETURN_IF_ERROR(
+      manager->GetClient(kEnclaveName)->EnterAndRun(input, &output));
+  return output.GetExtension(asylo::server_output_config).port();
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  absl::ParseCommandLine(argc, argv);
+  LOG_IF(QFATAL, absl::GetFlag(FLAGS_enclave_path).empty())
+      << "--enclave_path cannot be empty";
+
+  asylo::StatusOr<int> port_result = StartVerificationDaemon();
+  LOG_IF(QFATAL, !port_result.ok())
+      << "Failed to start the verification daemon: " << port_result.status();
+  std::cout << "Verification service listening on "
+            << absl::GetFlag(FLAGS_host) << ":" << port_result.ValueOrDie()
+            << std::endl;
+
+  absl::SleepFor(absl::GetFlag(FLAGS_server_lifetime));
+
+  asylo::EnclaveManager *manager =
+      asylo::EnclaveManager::Instance().ValueOrDie();
+  asylo::EnclaveFinal final_input;
+  asylo::Status status =
+      manager->DestroyEnclave(manager->GetClient(kEnclaveName), final_input);
+  LOG_IF(ERROR, !status.ok())
+      << "Failed to destroy the verification daemon enclave: " << status;
+  return 0;
+}
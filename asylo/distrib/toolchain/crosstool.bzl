@@ -616,6 +616,10 @@ def _impl(ctx):
                             "-D__ASYLO__",
                             "-DCOMPILER_GCC3",
                             "-D__LINUX_ERRNO_EXTENSIONS__",
+                            # RDTSC traps in SGX1 enclaves. Make the absl cycle
+                            # clock read clock_gettime(), which is served from
+                            # the host time page, instead.
+                            "-DABSL_USE_UNSCALED_CYCLECLOCK=0",
                         ],
                     ),
                 ],
@@ -766,6 +770,9 @@ def _impl(ctx):
                         flags = [
                             "-fprofile-generate=%{fdo_instrument_path}",
                             "-fno-data-sections",
+                            # Lets trusted code write the profile when the
+                            # enclave is finalized.
+                            "-DASYLO_PROFILE_INSTRUMENTED",
                         ],
                         expand_if_available = "fdo_instrument_path",
                     ),
@@ -1390,24 +1397,86 @@ def _impl(ctx):
         ],
     )
 
+    # Link-time optimization across libraries, enabled with
+    # --features=thin_lto. GCC has no ThinLTO; its partitioned (WHOPR) LTO, the
+    # default with -flto, is the counterpart. Objects also carry regular code so
+    # that archives indexed by a plain ar still link.
+    thin_lto_feature = feature(
+        name = "thin_lto",
+        flag_sets = [
+            flag_set(
+                actions = [ACTION_NAMES.c_compile, ACTION_NAMES.cpp_compile],
+                flag_groups = [
+                    flag_group(flags = ["-flto", "-ffat-lto-objects"]),
+                ],
+            ),
+            flag_set(
+                actions = [
+                    ACTION_NAMES.cpp_link_executable,
+                    ACTION_NAMES.cpp_link_dynamic_library,
+                    ACTION_NAMES.cpp_link_nodeps_dynamic_library,
+                ],
+                flag_groups = [
+                    flag_group(flags = ["-flto", "-fuse-linker-plugin"]),
+                ],
+            ),
+        ],
+    )
+
     dynamic_linking_mode_feature = feature(name = "dynamic_linking_mode")
     mostly_static_linking_mode_feature = feature(name = "mostly_static_linking_mode")
 
-    # Features to specify various levels of LVI mitgation, as provided by Intel.
-    # https://software.intel.com/security-software-guidance/insights/deep-dive-load-value-injection#applysgxmitigation
-    lvi_all_loads_mitigation_feature = feature(
-        name = "lvi_all_loads_mitigation",
+    # Places every function and data object in a section of its own in all
+    # compilation modes, and lets the linker drop the sections that nothing
+    # reachable from the exported symbols refers to. SGX load time grows with
+    # the number of measured pages, so this keeps the unused parts of the
+    # runtime out of the enclave. Targets opt out with features =
+    # ["-gc_sections"].
+    gc_sections_feature = feature(
+        name = "gc_sections",
+        enabled = True,
         flag_sets = [
             flag_set(
                 actions = [
-                    ACTION_NAMES.assemble,
-                    ACTION_NAMES.preprocess_assemble,
                     ACTION_NAMES.c_compile,
                     ACTION_NAMES.cpp_compile,
-                    ACTION_NAMES.cpp_header_parsing,
-                    ACTION_NAMES.cpp_module_compile,
                     ACTION_NAMES.cpp_module_codegen,
+                    ACTION_NAMES.lto_backend,
+                ],
+                flag_groups = [
+                    flag_group(
+                        flags = ["-ffunction-sections", "-fdata-sections"],
+                    ),
                 ],
+            ),
+            flag_set(
+                actions = all_link_actions,
+                flag_groups = [flag_group(flags = ["-Wl,--gc-sections"])],
+            ),
+        ],
+    )
+
+    # Features to specify various levels of LVI mitgation, as provided by Intel.
+    # https://software.intel.com/security-software-guidance/insights/deep-dive-load-value-injection#applysgxmitigation
+    # The mitigation flags are also passed to links, since with thin_lto code
+    # is generated and assembled at link time.
+    lvi_mitigation_actions = [
+        ACTION_NAMES.assemble,
+        ACTION_NAMES.preprocess_assemble,
+        ACTION_NAMES.c_compile,
+        ACTION_NAMES.cpp_compile,
+        ACTION_NAMES.cpp_header_parsing,
+        ACTION_NAMES.cpp_module_compile,
+        ACTION_NAMES.cpp_module_codegen,
+        ACTION_NAMES.cpp_link_executable,
+        ACTION_NAMES.cpp_link_dynamic_library,
+        ACTION_NAMES.cpp_link_nodeps_dynamic_library,
+    ]
+    lvi_all_loads_mitigation_feature = feature(
+        name = "lvi_all_loads_mitigation",
+        flag_sets = [
+            flag_set(
+                actions = lvi_mitigation_actions,
                 flag_groups = [
                     flag_group(
                         flags = [
@@ -1428,15 +1497,7 @@ def _impl(ctx):
         name = "lvi_control_flow_mitigation",
         flag_sets = [
             flag_set(
-                actions = [
-                    ACTION_NAMES.assemble,
-                    ACTION_NAMES.preprocess_assemble,
-                    ACTION_NAMES.c_compile,
-                    ACTION_NAMES.cpp_compile,
-                    ACTION_NAMES.cpp_header_parsing,
-                    ACTION_NAMES.cpp_module_compile,
-                    ACTION_NAMES.cpp_module_codegen,
-                ],
+                actions = lvi_mitigation_actions,
                 flag_groups = [
                     flag_group(
                         flags = [
@@ -1486,6 +1547,7 @@ def _impl(ctx):
         fdo_optimize_feature,
         autofdo_feature,
         lipo_feature,
+        thin_lto_feature,
         user_compile_flags_feature,
         sysroot_feature,
         unfiltered_compile_flags_feature,
@@ -1500,6 +1562,7 @@ def _impl(ctx):
         static_linking_mode_feature,
         dynamic_linking_mode_feature,
         mostly_static_linking_mode_feature,
+        gc_sections_feature,
         lvi_all_loads_mitigation_feature,
         lvi_control_flow_mitigation_feature,
         lvi_no_auto_mitigation_feature,
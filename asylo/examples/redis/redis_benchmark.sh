@@ -0,0 +1,162 @@
+#!/bin/bash
+#
+# Copyright 2020 Asylo authors
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+# Runs redis-benchmark against a native Redis server and against Redis servers
+# inside enclaves, once without pipelining and once with pipelined requests,
+# and prints the throughput and latency percentiles of every test, along with
+# the number of enclave exits of each enclave run.
+#
+# The first five arguments are the paths to the native server, the SGX
+# simulation and SGX hardware enclave servers, redis-benchmark and redis-cli.
+# The remaining arguments are passed to every run of redis-benchmark. The
+# following environment variables configure the runs:
+#
+#   MODES      Servers to run, among "native", "sgx_sim" and "sgx_hw". Defaults
+#              to "native sgx_sim".
+#   PIPELINES  Numbers of pipelined requests to run with. Defaults to "1 16".
+#   REQUESTS   Number of requests of each test. Defaults to 100000.
+#   TESTS      Tests to run. Defaults to "set,get,incr,lpush,lpop".
+#   OUTPUT_DIR Directory to keep the output of every run in. Defaults to a
+#              temporary directory that is removed afterwards.
+
+set -e
+
+readonly NATIVE_SERVER="$(realpath "$1")"
+readonly SGX_SIM_SERVER="$(realpath "$2")"
+readonly SGX_HW_SERVER="$(realpath "$3")"
+readonly BENCHMARK="$(realpath "$4")"
+readonly CLI="$(realpath "$5")"
+shift 5
+
+readonly MODES="${MODES:-native sgx_sim}"
+readonly PIPELINES="${PIPELINES:-1 16}"
+readonly REQUESTS="${REQUESTS:-100000}"
+readonly TESTS="${TESTS:-set,get,incr,lpush,lpop}"
+
+# The path of a unix domain socket is limited to 108 bytes, which the work
+# directory may exceed.
+readonly SOCKET="/tmp/redis_benchmark_$$.sock"
+
+# Seconds to wait for a server to accept connections.
+readonly STARTUP_TIMEOUT=60
+
+if [[ -n "${OUTPUT_DIR}" ]]; then
+  WORK_DIR="${OUTPUT_DIR}"
+  mkdir -p "${WORK_DIR}"
+else
+  WORK_DIR="$(mktemp -d)"
+  trap 'rm -rf "${WORK_DIR}"' EXIT
+fi
+
+# Starts the server $2 in the run directory $1, exporting its exit call metrics
+# to $1/exits.tsv, and waits until it accepts connections.
+function start_server() {
+  local run_dir="$1"
+  local server="$2"
+  rm -f "${SOCKET}"
+  (cd "${run_dir}" &&
+    ASYLO_EXIT_METRICS_FILE="${run_dir}/exits.tsv" exec "${server}" \
+      --port 0 --unixsocket "${SOCKET}" --save "" --appendonly no \
+      > "${run_dir}/server.txt" 2>&1) &
+  SERVER_PID=$!
+  for ((i = 0; i < STARTUP_TIMEOUT * 10; ++i)); do
+    if [[ "$("${CLI}" -s "${SOCKET}" ping 2> /dev/null)" == "PONG" ]]; then
+      return
+    fi
+    sleep 0.1
+  done
+  echo "Server ${server} did not start, see ${run_dir}/server.txt" >&2
+  kill "${SERVER_PID}"
+  exit 1
+}
+
+# Shuts down the server started last and waits for it to exit.
+function stop_server() {
+  "${CLI}" -s "${SOCKET}" shutdown nosave > /dev/null 2>&1 || true
+  wait "${SERVER_PID}" || true
+  rm -f "${SOCKET}"
+}
+
+# Prints the throughput and the 50th, 99th and 99.9th latency percentiles of
+# every test in the redis-benchmark output $3, prefixed by mode $1 and pipeline
+# depth $2.
+function report_benchmark() {
+  tr '\r' '\n' < "$3" | awk -v mode="$1" -v pipeline="$2" '
+    /====== / {
+      sub(/.*====== /, "")
+      sub(/ ======.*/, "")
+      test = $0
+      p50 = p99 = p999 = ""
+    }
+    /% <= / {
+      percent = $1 + 0
+      if (p50 == "" && percent >= 50) p50 = $3
+      if (p99 == "" && percent >= 99) p99 = $3
+      if (p999 == "" && percent >= 99.9) p999 = $3
+    }
+    /requests per second/ {
+      printf "%-8s %-8s %-10s %12s %8s %8s %8s\n", mode, pipeline, test, $1,
+          p50, p99, p999
+    }'
+}
+
+# Prints the total number and mean latency of the enclave exits recorded in $3,
+# and the number of exits per request, prefixed by mode $1 and pipeline depth
+# $2.
+function report_exits() {
+  if [[ ! -f "$3" ]]; then
+    return
+  fi
+  local num_tests
+  num_tests="$(echo "${TESTS}" | tr ',' '\n' | wc -l)"
+  awk -v mode="$1" -v pipeline="$2" \
+      -v requests="$((REQUESTS * num_tests))" '
+    NR > 1 {
+      count += $3
+      latency_ns += $7
+    }
+    END {
+      printf "%-8s %-8s exits: %d (%.2f per request, %.2f us each)\n", mode,
+          pipeline, count, count / requests,
+          count ? latency_ns / count / 1000 : 0
+    }' "$3"
+}
+
+printf "%-8s %-8s %-10s %12s %8s %8s %8s\n" mode pipeline test "ops/s" \
+  "p50 ms" "p99 ms" "p99.9 ms"
+for mode in ${MODES}; do
+  case "${mode}" in
+    native) server="${NATIVE_SERVER}" ;;
+    sgx_sim) server="${SGX_SIM_SERVER}" ;;
+    sgx_hw) server="${SGX_HW_SERVER}" ;;
+    *)
+      echo "Unknown mode ${mode}" >&2
+      exit 1
+      ;;
+  esac
+  for pipeline in ${PIPELINES}; do
+    run_dir="${WORK_DIR}/${mode}_p${pipeline}"
+    mkdir -p "${run_dir}"
+    rm -f "${run_dir}/exits.tsv"
+    start_server "${run_dir}" "${server}"
+    "${BENCHMARK}" -s "${SOCKET}" -n "${REQUESTS}" -P "${pipeline}" \
+      -t "${TESTS}" "$@" > "${run_dir}/benchmark.txt" 2>&1
+    stop_server
+    report_benchmark "${mode}" "${pipeline}" "${run_dir}/benchmark.txt"
+    report_exits "${mode}" "${pipeline}" "${run_dir}/exits.tsv"
+  done
+done
@@ -18,15 +18,19 @@
 
 #include "asylo/grpc/auth/core/client_ekep_handshaker.h"
 
-#include <openssl/curve25519.h>
 #include <openssl/rand.h>
 
 #include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
 
 #include <google/protobuf/io/zero_copy_stream_impl_lite.h>
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
 #include "asylo/crypto/sha256_hash.h"
+#include "asylo/crypto/x25519_key_pool.h"
 #include "asylo/util/logging.h"
 #include "asylo/grpc/auth/core/ekep_crypto.h"
 #include "asylo/grpc/auth/core/ekep_error_space.h"
@@ -57,6 +61,11 @@ ClientEkepHandshaker::ClientEkepHandshaker(const EkepHandshakerOptions &options)
       available_record_protocols_({ALTSRP_AES128_GCM}),
       available_ekep_versions_({"EKEP v1"}),
       additional_authenticated_data_(options.additional_authenticated_data),
+      session_cache_(options.session_cache),
+      session_cache_key_(options.session_cache_key),
+      max_protected_frame_size_(options.max_protected_frame_size),
+      concurrent_assertions_(options.concurrent_assertions),
+      session_resumed_(false),
       selected_cipher_suite_(UNKNOWN_HANDSHAKE_CIPHER),
       selected_record_protocol_(UNKNOWN_RECORD_PROTOCOL),
       expected_message_type_(SERVER_PRECOMMIT),
@@ -219,6 +228,9 @@ Status ClientEkepHandshaker::HandleServerPrecommit(
                                ProtoEnumValueName(record_protocol)));
   }
 
+  SetMaxProtectedFrameSize(NegotiateMaxProtectedFrameSize(
+      max_protected_frame_size_, server_precommit.max_protected_frame_size()));
+
   // Verify that the server sent an adequately-sized challenge.
   if (server_precommit.challenge().size() != kEkepChallengeSize) {
     return Status(Abort::PROTOCOL_ERROR,
@@ -226,6 +238,30 @@ Status ClientEkepHandshaker::HandleServerPrecommit(
                                server_precommit.challenge().size()));
   }
 
+  // In a resumed handshake, no assertions are exchanged. The server is instead
+  // authenticated by its possession of the resumption secret, and by the
+  // identities that were stored with the session ticket.
+  if (server_precommit.session_resumed()) {
+    if (!offered_session_.has_value()) {
+      return Status(Abort::PROTOCOL_ERROR,
+                    "Server resumed a session that was not offered");
+    }
+    if (offered_session_->state.cipher_suite != selected_cipher_suite_ ||
+        offered_session_->state.record_protocol != selected_record_protocol_) {
+      return Status(Abort::PROTOCOL_ERROR,
+                    "Server resumed a session with different parameters");
+    }
+    if (!server_precommit.server_requests().empty() ||
+        !server_precommit.server_offers().empty()) {
+      return Status(Abort::PROTOCOL_ERROR,
+                    "Server exchanged assertions in a resumed session");
+    }
+    session_resumed_ = true;
+    return WriteClientId(server_precommit.server_requests().cbegin(),
+                         server_precommit.server_requests().cend(), output);
+  }
+  offered_session_.reset();
+
   // Verify that the server requested a non-empty subset of the assertions that
   // were offered by the client.
   if (server_precommit.server_requests().empty()) {
@@ -288,6 +324,8 @@ Status ClientEkepHandshaker::HandleServerId(const google::protobuf::Message &mes
     return Status(Abort::INTERNAL_ERROR, "Failed to generate context");
   }
 
+  // Match each assertion to an expected description before verifying any of
+  // them, so that the verifications are independent of each other.
   for (const Assertion &assertion : server_id.assertions()) {
     auto desc_it = FindAssertionDescription(expected_peer_assertions_,
                                             assertion.description());
@@ -296,20 +334,31 @@ Status ClientEkepHandshaker::HandleServerId(const google::protobuf::Message &mes
                     "Server provided an assertion that was not previously "
                     "offered");
     }
+    expected_peer_assertions_.erase(desc_it);
+  }
 
-    EnclaveIdentity identity;
-    // Note that assertion verifiers were verified during creation of the
-    // handshaker so there is no need to check whether the call to
-    // GetEnclaveAssertionVerifier() returns nullptr.
-    Status status =
-        GetEnclaveAssertionVerifier(assertion.description())
-            ->Verify(/*user_data=*/ekep_context, assertion, &identity);
+  std::vector<EnclaveIdentity> identities(server_id.assertions_size());
+  std::vector<std::function<Status()>> tasks;
+  tasks.reserve(identities.size());
+  for (int i = 0; i < server_id.assertions_size(); ++i) {
+    tasks.emplace_back([&server_id, &ekep_context, &identities, i] {
+      const Assertion &assertion = server_id.assertions(i);
+      // Note that assertion verifiers were verified during creation of the
+      // handshaker so there is no need to check whether the call to
+      // GetEnclaveAssertionVerifier() returns nullptr.
+      return GetEnclaveAssertionVerifier(assertion.description())
+          ->Verify(/*user_data=*/ekep_context, assertion, &identities[i]);
+    });
+  }
+  for (const Status &status :
+       RunAssertionTasks(tasks, concurrent_assertions_)) {
     if (!status.ok()) {
       LOG(ERROR) << "Assertion could not be verified: " << status;
       return Status(Abort::BAD_ASSERTION, "Assertion could not be verified");
     }
+  }
+  for (const EnclaveIdentity &identity : identities) {
     AddPeerIdentity(identity);
-    expected_peer_assertions_.erase(desc_it);
   }
 
   if (!expected_peer_assertions_.empty()) {
@@ -327,9 +376,32 @@ Status ClientEkepHandshaker::HandleServerId(const google::protobuf::Message &mes
   // and the server's public key.
   std::string transcript_hash;
   ASYLO_RETURN_IF_ERROR(GetTranscriptHash(&transcript_hash));
-  return DeriveSecrets(selected_cipher_suite_, transcript_hash,
-                       server_public_key, dh_private_key_, &master_secret_,
-                       &authenticator_secret_);
+  if (session_resumed_) {
+    for (const EnclaveIdentity &identity :
+         offered_session_->state.peer_identities.identities()) {
+      AddPeerIdentity(identity);
+    }
+    ASYLO_RETURN_IF_ERROR(DeriveResumedSecrets(
+        selected_cipher_suite_, transcript_hash, server_public_key,
+        dh_private_key_, offered_session_->state.resumption_secret,
+        &master_secret_, &authenticator_secret_));
+  } else {
+    ASYLO_RETURN_IF_ERROR(DeriveSecrets(
+        selected_cipher_suite_, transcript_hash, server_public_key,
+        dh_private_key_, &master_secret_, &authenticator_secret_));
+  }
+
+  // The resumption secret is bound to the same transcript as the EKEP secrets,
+  // which is also the one used by the server.
+  if (session_cache_) {
+    Status status = DeriveResumptionSecret(selected_cipher_suite_,
+                                           transcript_hash, master_secret_,
+                                           &resumption_secret_);
+    if (!status.ok()) {
+      LOG(WARNING) << "Failed to derive resumption secret: " << status;
+    }
+  }
+  return Status::OkStatus();
 }
 
 Status ClientEkepHandshaker::HandleServerFinish(const google::protobuf::Message &message,
@@ -360,7 +432,9 @@ Status ClientEkepHandshaker::HandleServerFinish(const google::protobuf::Message
                   "Server handshake authenticator value is incorrect");
   }
 
-  return WriteClientFinish(output);
+  ASYLO_RETURN_IF_ERROR(WriteClientFinish(output));
+  StoreSessionTicket(server_finish);
+  return Status::OkStatus();
 }
 
 Status ClientEkepHandshaker::WriteClientPrecommit(std::string *output) {
@@ -385,6 +459,20 @@ Status ClientEkepHandshaker::WriteClientPrecommit(std::string *output) {
         additional_authenticated_data_);
   }
 
+  if (max_protected_frame_size_ != 0) {
+    client_precommit.set_max_protected_frame_size(max_protected_frame_size_);
+  }
+
+  // Offer to resume a previous session with the server. Tickets are single-use,
+  // so the entry is removed from the cache whether or not the server accepts
+  // it.
+  if (session_cache_) {
+    offered_session_ = session_cache_->Take(session_cache_key_);
+    if (offered_session_.has_value()) {
+      client_precommit.set_session_ticket(offered_session_->ticket);
+    }
+  }
+
   std::vector<uint8_t> challenge(kEkepChallengeSize);
   if (RAND_bytes(challenge.data(), kEkepChallengeSize) != 1) {
     return Status(Abort::INTERNAL_ERROR, "Internal error");
@@ -428,13 +516,12 @@ Status ClientEkepHandshaker::WriteClientId(
     google::protobuf::RepeatedPtrField<AssertionRequest>::const_iterator requests_first,
     google::protobuf::RepeatedPtrField<AssertionRequest>::const_iterator requests_last,
     std::string *output) {
-  // Generate an ephemeral Diffie-Hellman key-pair for the negotiated cipher
+  // Take a fresh ephemeral Diffie-Hellman key-pair for the negotiated cipher
   // suite.
   switch (selected_cipher_suite_) {
     case CURVE25519_SHA256:
-      dh_public_key_.resize(X25519_PUBLIC_VALUE_LEN);
-      dh_private_key_.resize(X25519_PRIVATE_KEY_LEN);
-      X25519_keypair(dh_public_key_.data(), dh_private_key_.data());
+      X25519KeyPool::GetInstance()->TakeKeyPair(&dh_public_key_,
+                                                &dh_private_key_);
       break;
     default:
       LOG(ERROR) << "Client handshaker has bad cipher suite configuration";
@@ -462,15 +549,22 @@ Status ClientEkepHandshaker::WriteClientId(
     return Status(Abort::INTERNAL_ERROR, "Assertion generation failed");
   }
 
+  std::vector<std::function<Status()>> tasks;
   for (auto it = requests_first; it != requests_last; ++it) {
+    // The assertions are added up front so that each task fills in its own,
+    // and the assertions appear in the same order as their requests.
+    Assertion *assertion = client_id.add_assertions();
     const AssertionRequest &request = *it;
-
-    // Note that assertion generators were verified during creation of the
-    // handshaker so there is no need to check whether the call to
-    // GetEnclaveAssertionGenerator() returns nullptr.
-    Status status =
-        GetEnclaveAssertionGenerator(request.description())
-            ->Generate(ekep_context, request, client_id.add_assertions());
+    tasks.emplace_back([&ekep_context, &request, assertion] {
+      // Note that assertion generators were verified during creation of the
+      // handshaker so there is no need to check whether the call to
+      // GetEnclaveAssertionGenerator() returns nullptr.
+      return GetEnclaveAssertionGenerator(request.description())
+          ->Generate(ekep_context, request, assertion);
+    });
+  }
+  for (const Status &status :
+       RunAssertionTasks(tasks, concurrent_assertions_)) {
     if (!status.ok()) {
       LOG(ERROR) << "Assertion generation failed: " << status;
       return Status(Abort::INTERNAL_ERROR, "Assertion generation failed");
@@ -541,4 +635,22 @@ bool ClientEkepHandshaker::SetSelectedRecordProtocol(
   return true;
 }
 
+void ClientEkepHandshaker::StoreSessionTicket(
+    const ServerFinish &server_finish) {
+  if (!session_cache_ || server_finish.session_ticket().empty() ||
+      resumption_secret_.empty()) {
+    return;
+  }
+
+  EkepSessionState state;
+  state.cipher_suite = selected_cipher_suite_;
+  state.record_protocol = selected_record_protocol_;
+  state.resumption_secret = resumption_secret_;
+  state.peer_identities = peer_identities();
+  session_cache_->Insert(
+      session_cache_key_, server_finish.session_ticket(),
+      absl::Seconds(server_finish.session_ticket_lifetime_seconds()),
+      std::move(state));
+}
+
 }  // namespace asylo
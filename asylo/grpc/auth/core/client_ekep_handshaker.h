@@ -26,8 +26,10 @@
 
 #include <google/protobuf/io/zero_copy_stream.h>
 #include <google/protobuf/message.h>
+#include "absl/types/optional.h"
 #include "asylo/grpc/auth/core/ekep_handshaker.h"
 #include "asylo/grpc/auth/core/ekep_handshaker_util.h"
+#include "asylo/grpc/auth/core/ekep_session_tickets.h"
 #include "asylo/util/cleansing_types.h"
 
 namespace asylo {
@@ -87,6 +89,7 @@ class ClientEkepHandshaker final : public EkepHandshaker {
   // Validates the ServerFinish handshake message contained in |message|. If
   // validation succeeds, writes the ClientFinish message to |output| and
   // updates the handshake transcript with the outgoing ClientFinish frame.
+  // Stores any session ticket from the server in the session cache.
   Status HandleServerFinish(const google::protobuf::Message &message,
                             std::string *output);
 
@@ -106,6 +109,10 @@ class ClientEkepHandshaker final : public EkepHandshaker {
   // transcript.
   Status WriteClientFinish(std::string *output);
 
+  // Stores the session ticket from |server_finish|, if any, in the session
+  // cache.
+  void StoreSessionTicket(const ServerFinish &server_finish);
+
   // Sets the handshaker's selected EKEP version to |ekep_version|. Returns
   // false if |ekep_version| is not a valid EKEP version for this handshaker.
   bool SetSelectedEkepVersion(const std::string &ekep_version);
@@ -140,6 +147,27 @@ class ClientEkepHandshaker final : public EkepHandshaker {
   // Additional data that is authenticated during the handshake.
   const std::string additional_authenticated_data_;
 
+  // Cache of session tickets and the key of the server's entry, or nullptr if
+  // session resumption is disabled.
+  const std::shared_ptr<EkepClientSessionCache> session_cache_;
+  const std::string session_cache_key_;
+
+  // The maximum record protocol frame size advertised by this handshaker, or
+  // zero if it does not advertise one.
+  const size_t max_protected_frame_size_;
+
+  // Whether assertions are generated and verified concurrently.
+  const bool concurrent_assertions_;
+
+  // The session the client offered to resume in its ClientPrecommit. This
+  // field is cleared after validation of the ServerPrecommit message if the
+  // server did not resume the session.
+  absl::optional<EkepClientSessionCache::Entry> offered_session_;
+
+  // Whether the server resumed |offered_session_|. This field is populated
+  // after validation of the ServerPrecommit message.
+  bool session_resumed_;
+
   // Assertions expected from the peer. This field is populated after validation
   // of the ServerPrecommit message.
   std::vector<AssertionDescription> expected_peer_assertions_;
@@ -165,6 +193,11 @@ class ClientEkepHandshaker final : public EkepHandshaker {
   CleansingVector<uint8_t> authenticator_secret_;
   CleansingVector<uint8_t> master_secret_;
 
+  // The secret for resuming this session in a later handshake. This field is
+  // populated after validation of the ServerId message, if the client has a
+  // session cache.
+  CleansingVector<uint8_t> resumption_secret_;
+
   // A snapshot of the transcript to which the server's assertions are bound:
   //   hash(ClientPrecommit || ServerPrecommit || ClientId)
   std::string server_assertion_transcript_;
@@ -45,6 +45,8 @@ constexpr size_t kEkepSecretSize =
 
 constexpr char kEkepHkdfSalt[] = "EKEP Handshake v1";
 constexpr char kEkepHkdfSaltRecordProtocol[] = "EKEP Record Protocol v1";
+constexpr char kEkepHkdfSaltResumedHandshake[] = "EKEP Resumed Handshake v1";
+constexpr char kEkepHkdfSaltResumption[] = "EKEP Resumption v1";
 constexpr char kServerAuthenticatedText[] = "EKEP Handshake v1: Server Finish";
 constexpr char kClientAuthenticatedText[] = "EKEP Handshake v1: Client Finish";
 
@@ -78,14 +80,17 @@ Status Hmac(const HandshakeCipher &ciphersuite, ByteContainerView key,
   return Status::OkStatus();
 }
 
-}  // namespace
-
-Status DeriveSecrets(const HandshakeCipher &ciphersuite,
-                     ByteContainerView transcript_hash,
-                     ByteContainerView peer_dh_public_key,
-                     ByteContainerView self_dh_private_key,
-                     CleansingVector<uint8_t> *master_secret,
-                     CleansingVector<uint8_t> *authenticator_secret) {
+// Derives the EKEP master and authenticator secrets from the Diffie-Hellman
+// shared secret, followed by |additional_key_material|, using HKDF with the
+// given |salt|. See DeriveSecrets() for a description of the other arguments.
+Status DeriveHandshakeSecrets(const HandshakeCipher &ciphersuite,
+                              const std::string &salt,
+                              ByteContainerView transcript_hash,
+                              ByteContainerView peer_dh_public_key,
+                              ByteContainerView self_dh_private_key,
+                              ByteContainerView additional_key_material,
+                              CleansingVector<uint8_t> *master_secret,
+                              CleansingVector<uint8_t> *authenticator_secret) {
   const EVP_MD *digest = nullptr;
   CleansingVector<uint8_t> shared_secret;
 
@@ -122,8 +127,10 @@ Status DeriveSecrets(const HandshakeCipher &ciphersuite,
           "Ciphersuite not supported: " + ProtoEnumValueName(ciphersuite));
   }
 
+  shared_secret.insert(shared_secret.end(), additional_key_material.cbegin(),
+                       additional_key_material.cend());
+
   // Derive the master and authenticator secrets using HKDF.
-  std::string salt(kEkepHkdfSalt);
   CleansingVector<uint8_t> output_key;
   output_key.resize(kEkepSecretSize);
   if (!HKDF(output_key.data(), kEkepSecretSize, digest, shared_secret.data(),
@@ -145,6 +152,67 @@ Status DeriveSecrets(const HandshakeCipher &ciphersuite,
   return Status::OkStatus();
 }
 
+}  // namespace
+
+Status DeriveSecrets(const HandshakeCipher &ciphersuite,
+                     ByteContainerView transcript_hash,
+                     ByteContainerView peer_dh_public_key,
+                     ByteContainerView self_dh_private_key,
+                     CleansingVector<uint8_t> *master_secret,
+                     CleansingVector<uint8_t> *authenticator_secret) {
+  return DeriveHandshakeSecrets(
+      ciphersuite, kEkepHkdfSalt, transcript_hash, peer_dh_public_key,
+      self_dh_private_key, /*additional_key_material=*/"", master_secret,
+      authenticator_secret);
+}
+
+Status DeriveResumedSecrets(const HandshakeCipher &ciphersuite,
+                            ByteContainerView transcript_hash,
+                            ByteContainerView peer_dh_public_key,
+                            ByteContainerView self_dh_private_key,
+                            ByteContainerView resumption_secret,
+                            CleansingVector<uint8_t> *master_secret,
+                            CleansingVector<uint8_t> *authenticator_secret) {
+  if (resumption_secret.size() != kEkepResumptionSecretSize) {
+    return Status(Abort::INTERNAL_ERROR,
+                  absl::StrCat("Resumption secret has incorrect size: ",
+                               resumption_secret.size()));
+  }
+  return DeriveHandshakeSecrets(ciphersuite, kEkepHkdfSaltResumedHandshake,
+                                transcript_hash, peer_dh_public_key,
+                                self_dh_private_key, resumption_secret,
+                                master_secret, authenticator_secret);
+}
+
+Status DeriveResumptionSecret(const HandshakeCipher &ciphersuite,
+                              ByteContainerView transcript_hash,
+                              ByteContainerView master_secret,
+                              CleansingVector<uint8_t> *resumption_secret) {
+  resumption_secret->clear();
+  const EVP_MD *digest = nullptr;
+  switch (ciphersuite) {
+    case CURVE25519_SHA256:
+      digest = EVP_sha256();
+      break;
+    default:
+      return Status(
+          Abort::BAD_HANDSHAKE_CIPHER,
+          "Ciphersuite not supported: " + ProtoEnumValueName(ciphersuite));
+  }
+
+  std::string salt(kEkepHkdfSaltResumption);
+  resumption_secret->resize(kEkepResumptionSecretSize);
+  if (!HKDF(resumption_secret->data(), resumption_secret->size(), digest,
+            master_secret.data(), master_secret.size(),
+            reinterpret_cast<const uint8_t *>(salt.data()), salt.size(),
+            transcript_hash.data(), transcript_hash.size())) {
+    LOG(ERROR) << "HKDF failed: " << BsslLastErrorString();
+    resumption_secret->clear();
+    return Status(Abort::INTERNAL_ERROR, "Internal error");
+  }
+  return Status::OkStatus();
+}
+
 Status DeriveRecordProtocolKey(const HandshakeCipher &ciphersuite,
                                const RecordProtocol &record_protocol,
                                ByteContainerView transcript_hash,
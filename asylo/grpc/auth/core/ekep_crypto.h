@@ -32,6 +32,7 @@ namespace asylo {
 
 constexpr size_t kEkepMasterSecretSize = 64;
 constexpr size_t kEkepAuthenticatorSecretSize = 64;
+constexpr size_t kEkepResumptionSecretSize = 64;
 constexpr size_t kAltsRecordProtocolAes128GcmKeySize = 16;
 
 // Derives EKEP secrets based on the selected |ciphersuite| and the input
@@ -55,6 +56,42 @@ Status DeriveSecrets(const HandshakeCipher &ciphersuite,
                      CleansingVector<uint8_t> *master_secret,
                      CleansingVector<uint8_t> *authenticator_secret);
 
+// Derives EKEP secrets for a resumed handshake. Behaves like DeriveSecrets(),
+// except that |resumption_secret|, which was derived at the end of the resumed
+// session's handshake, is mixed into the key material. As a result, the
+// handshake authenticators computed from |authenticator_secret| prove that
+// both participants hold the resumption secret.
+//
+// Note that |self_dh_private_key| and |resumption_secret| are
+// ByteContainerViews. The caller should take care to pass them using
+// self-cleansing containers.
+//
+// Returns the same errors as DeriveSecrets(). Additionally returns
+// INTERNAL_ERROR if |resumption_secret| has an invalid size.
+Status DeriveResumedSecrets(const HandshakeCipher &ciphersuite,
+                            ByteContainerView transcript_hash,
+                            ByteContainerView peer_dh_public_key,
+                            ByteContainerView self_dh_private_key,
+                            ByteContainerView resumption_secret,
+                            CleansingVector<uint8_t> *master_secret,
+                            CleansingVector<uint8_t> *authenticator_secret);
+
+// Derives the resumption secret of a session using HKDF initialized with the
+// hash function from |ciphersuite|, the input key material |master_secret|,
+// and |transcript_hash|. On success, writes the secret to |resumption_secret|.
+// The resumption secret is independent of all other keys derived from
+// |master_secret|, and can be used to resume the session in a later handshake.
+//
+// Note that |master_secret| is a ByteContainerView. The caller should take care
+// to pass their master secret using a self-cleansing container.
+//
+// If the ciphersuite is unsupported, returns BAD_HANDSHAKE_CIPHER.
+// Returns INTERNAL_ERROR on other errors.
+Status DeriveResumptionSecret(const HandshakeCipher &ciphersuite,
+                              ByteContainerView transcript_hash,
+                              ByteContainerView master_secret,
+                              CleansingVector<uint8_t> *resumption_secret);
+
 // Derives a record protocol key for the given |record_protocol| using HKDF
 // initialized with the hash function from |ciphersuite| and the input key
 // material |master_secret|. On success, writes the record protocol key to
@@ -185,6 +185,121 @@ TEST(EkepCryptoTest, DeriveSecretsWithCurve25519Sha256) {
   EXPECT_EQ(*actual_authenticator_secret, expected_authenticator_secret);
 }
 
+// Verify that both participants of a resumed handshake derive the same secrets
+// only if they hold the same resumption secret, and that those secrets differ
+// from the ones of a full handshake.
+TEST(EkepCryptoTest, DeriveResumedSecretsWithCurve25519Sha256) {
+  UnsafeBytes<SHA256_DIGEST_LENGTH> transcript_hash;
+  ASYLO_ASSERT_OK(
+      SetTrivialObjectFromHexString(kTestTranscriptHash, &transcript_hash));
+
+  uint8_t client_public_key[X25519_PUBLIC_VALUE_LEN];
+  CleansingVector<uint8_t> client_private_key(X25519_PRIVATE_KEY_LEN);
+  X25519_keypair(client_public_key, client_private_key.data());
+  uint8_t server_public_key[X25519_PUBLIC_VALUE_LEN];
+  CleansingVector<uint8_t> server_private_key(X25519_PRIVATE_KEY_LEN);
+  X25519_keypair(server_public_key, server_private_key.data());
+
+  SafeBytes<kEkepResumptionSecretSize> resumption_secret =
+      TrivialRandomObject<SafeBytes<kEkepResumptionSecretSize>>();
+  SafeBytes<kEkepResumptionSecretSize> other_resumption_secret =
+      TrivialRandomObject<SafeBytes<kEkepResumptionSecretSize>>();
+
+  CleansingVector<uint8_t> client_master_secret;
+  CleansingVector<uint8_t> client_authenticator_secret;
+  ASYLO_ASSERT_OK(DeriveResumedSecrets(
+      CURVE25519_SHA256, transcript_hash, server_public_key,
+      client_private_key, resumption_secret, &client_master_secret,
+      &client_authenticator_secret));
+
+  CleansingVector<uint8_t> server_master_secret;
+  CleansingVector<uint8_t> server_authenticator_secret;
+  ASYLO_ASSERT_OK(DeriveResumedSecrets(
+      CURVE25519_SHA256, transcript_hash, client_public_key,
+      server_private_key, resumption_secret, &server_master_secret,
+      &server_authenticator_secret));
+  EXPECT_EQ(client_master_secret, server_master_secret);
+  EXPECT_EQ(client_authenticator_secret, server_authenticator_secret);
+
+  CleansingVector<uint8_t> other_master_secret;
+  CleansingVector<uint8_t> other_authenticator_secret;
+  ASYLO_ASSERT_OK(DeriveResumedSecrets(
+      CURVE25519_SHA256, transcript_hash, client_public_key,
+      server_private_key, other_resumption_secret, &other_master_secret,
+      &other_authenticator_secret));
+  EXPECT_NE(client_master_secret, other_master_secret);
+  EXPECT_NE(client_authenticator_secret, other_authenticator_secret);
+
+  CleansingVector<uint8_t> full_master_secret;
+  CleansingVector<uint8_t> full_authenticator_secret;
+  ASYLO_ASSERT_OK(DeriveSecrets(CURVE25519_SHA256, transcript_hash,
+                                client_public_key, server_private_key,
+                                &full_master_secret,
+                                &full_authenticator_secret));
+  EXPECT_NE(client_master_secret, full_master_secret);
+  EXPECT_NE(client_authenticator_secret, full_authenticator_secret);
+}
+
+// Verify that DeriveResumedSecrets fails and returns INTERNAL_ERROR when passed
+// a resumption secret that has an invalid size.
+TEST(EkepCryptoTest, DeriveResumedSecretsBadResumptionSecretSize) {
+  std::string transcript_hash;
+  SafeBytes<X25519_PUBLIC_VALUE_LEN> peer_dh_public_key =
+      TrivialRandomObject<SafeBytes<X25519_PUBLIC_VALUE_LEN>>();
+  SafeBytes<X25519_PRIVATE_KEY_LEN> self_dh_private_key =
+      TrivialRandomObject<SafeBytes<X25519_PRIVATE_KEY_LEN>>();
+  CleansingVector<uint8_t> resumption_secret(kEkepResumptionSecretSize - 1);
+  CleansingVector<uint8_t> authenticator_secret;
+  CleansingVector<uint8_t> master_secret;
+
+  EXPECT_THAT(DeriveResumedSecrets(CURVE25519_SHA256, transcript_hash,
+                                   peer_dh_public_key, self_dh_private_key,
+                                   resumption_secret, &master_secret,
+                                   &authenticator_secret),
+              StatusIs(Abort::INTERNAL_ERROR));
+}
+
+// Verify that DeriveResumptionSecret fails and returns BAD_HANDSHAKE_CIPHER
+// when passed an unsupported ciphersuite.
+TEST(EkepCryptoTest, DeriveResumptionSecretBadCiphersuite) {
+  std::string transcript_hash;
+  CleansingVector<uint8_t> master_secret;
+  CleansingVector<uint8_t> resumption_secret;
+
+  EXPECT_THAT(DeriveResumptionSecret(UNKNOWN_HANDSHAKE_CIPHER, transcript_hash,
+                                     master_secret, &resumption_secret),
+              StatusIs(Abort::BAD_HANDSHAKE_CIPHER));
+}
+
+// Verify that DeriveResumptionSecret is deterministic and bound to the
+// transcript.
+TEST(EkepCryptoTest, DeriveResumptionSecretWithCurve25519Sha256) {
+  UnsafeBytes<SHA256_DIGEST_LENGTH> transcript_hash;
+  ASYLO_ASSERT_OK(
+      SetTrivialObjectFromHexString(kTestTranscriptHash, &transcript_hash));
+  SafeBytes<kEkepMasterSecretSize> master_secret;
+  ASYLO_ASSERT_OK(
+      SetTrivialObjectFromHexString(kTestMasterSecret, &master_secret));
+
+  CleansingVector<uint8_t> resumption_secret;
+  ASYLO_ASSERT_OK(DeriveResumptionSecret(CURVE25519_SHA256, transcript_hash,
+                                         master_secret, &resumption_secret));
+  EXPECT_EQ(resumption_secret.size(), kEkepResumptionSecretSize);
+
+  CleansingVector<uint8_t> same_resumption_secret;
+  ASYLO_ASSERT_OK(DeriveResumptionSecret(CURVE25519_SHA256, transcript_hash,
+                                         master_secret,
+                                         &same_resumption_secret));
+  EXPECT_EQ(resumption_secret, same_resumption_secret);
+
+  CleansingVector<uint8_t> other_resumption_secret;
+  ASYLO_ASSERT_OK(DeriveResumptionSecret(CURVE25519_SHA256,
+                                         /*transcript_hash=*/"",
+                                         master_secret,
+                                         &other_resumption_secret));
+  EXPECT_NE(resumption_secret, other_resumption_secret);
+}
+
 // Verify that DeriveRecordProtocolKey fails and returns BAD_HANDSHAKE_CIPHER
 // when passed an unsupported ciphersuite.
 TEST(EkepCryptoTest, DeriveRecordProtocolKeyBadCiphersuite) {
@@ -21,6 +21,7 @@
 #include <cstdint>
 #include <memory>
 
+#include <google/protobuf/arena.h>
 #include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 #include <google/protobuf/io/zero_copy_stream_impl_lite.h>
@@ -32,6 +33,7 @@
 #include "asylo/util/logging.h"
 #include "asylo/grpc/auth/core/ekep_crypto.h"
 #include "asylo/grpc/auth/core/ekep_error_space.h"
+#include "asylo/util/cleanup.h"
 #include "asylo/util/proto_enum_util.h"
 #include "asylo/util/status.h"
 #include "asylo/util/status_macros.h"
@@ -39,24 +41,25 @@
 namespace asylo {
 namespace {
 
-// Creates and returns a handshake message of type |message_type|.
-std::unique_ptr<google::protobuf::Message> CreateHandshakeMessage(
-    HandshakeMessageType message_type) {
+// Creates a handshake message of type |message_type| on |arena| and returns a
+// pointer to it. The message is owned by |arena|.
+google::protobuf::Message *CreateHandshakeMessage(HandshakeMessageType message_type,
+                                        google::protobuf::Arena *arena) {
   switch (message_type) {
     case CLIENT_PRECOMMIT:
-      return absl::make_unique<ClientPrecommit>();
+      return google::protobuf::Arena::CreateMessage<ClientPrecommit>(arena);
     case SERVER_PRECOMMIT:
-      return absl::make_unique<ServerPrecommit>();
+      return google::protobuf::Arena::CreateMessage<ServerPrecommit>(arena);
     case CLIENT_ID:
-      return absl::make_unique<ClientId>();
+      return google::protobuf::Arena::CreateMessage<ClientId>(arena);
     case SERVER_ID:
-      return absl::make_unique<ServerId>();
+      return google::protobuf::Arena::CreateMessage<ServerId>(arena);
     case CLIENT_FINISH:
-      return absl::make_unique<ClientFinish>();
+      return google::protobuf::Arena::CreateMessage<ClientFinish>(arena);
     case SERVER_FINISH:
-      return absl::make_unique<ServerFinish>();
+      return google::protobuf::Arena::CreateMessage<ServerFinish>(arena);
     case ABORT:
-      return absl::make_unique<Abort>();
+      return google::protobuf::Arena::CreateMessage<Abort>(arena);
     default:
       return nullptr;
   }
@@ -95,8 +98,11 @@ EkepHandshaker::Result EkepHandshaker::NextHandshakeStep(
 
     result = StartHandshake(outgoing_bytes);
   } else {
-    // Process bytes from the peer.
-    input_stream_.AddBuffer(incoming_bytes, incoming_bytes_size);
+    // Process bytes from the peer in place. Only the bytes that are left over
+    // once this step is done are copied into the stream, since the caller may
+    // release |incoming_bytes| after this call returns.
+    input_stream_.AddBorrowedBuffer(incoming_bytes, incoming_bytes_size);
+    Cleanup own_incoming_bytes([this] { input_stream_.OwnBorrowedBuffers(); });
 
     do {
       result = DecodeAndHandleFrame(outgoing_bytes);
@@ -242,8 +248,18 @@ StatusOr<CleansingVector<uint8_t>> EkepHandshaker::GetRecordProtocolKey() {
   return record_protocol_key_;
 }
 
+StatusOr<size_t> EkepHandshaker::GetMaxProtectedFrameSize() {
+  if (!IsHandshakeCompleted()) {
+    return Status(asylo::error::GoogleError::FAILED_PRECONDITION,
+                  "Cannot retrieve max protected frame size before handshake "
+                  "is complete");
+  }
+
+  return max_protected_frame_size_;
+}
+
 EkepHandshaker::EkepHandshaker(int max_frame_size)
-    : max_frame_size_(max_frame_size) {
+    : max_frame_size_(max_frame_size), max_protected_frame_size_(0) {
   peer_identities_ = absl::make_unique<EnclaveIdentities>();
 }
 
@@ -279,12 +295,14 @@ EkepHandshaker::Result EkepHandshaker::DecodeAndHandleFrame(
     input_stream_.Rewind();
     return Result::NOT_ENOUGH_DATA;
   }
-  std::unique_ptr<google::protobuf::Message> message =
-      CreateHandshakeMessage(message_type);
+  // The message and all of its fields are allocated on an arena that is freed
+  // in one step once the frame has been handled.
+  google::protobuf::Arena arena;
+  google::protobuf::Message *message = CreateHandshakeMessage(message_type, &arena);
 
   // There are enough bytes to parse the frame message. Any errors that occur
   // during deserialization are fatal.
-  status = ParseFrameMessage(message_size, &input_stream_, message.get());
+  status = ParseFrameMessage(message_size, &input_stream_, message);
   if (!status.ok()) {
     if (message_type == ABORT) {
       // The peer sent an Abort message that could not be parsed. There is not
@@ -300,7 +318,7 @@ EkepHandshaker::Result EkepHandshaker::DecodeAndHandleFrame(
   VLOG(2) << message->DebugString();
 
   if (message_type == ABORT) {
-    const Abort *abort_message = dynamic_cast<const Abort *>(message.get());
+    const Abort *abort_message = dynamic_cast<const Abort *>(message);
     LOG_IF(DFATAL, !abort_message) << "dynamic_cast from google::protobuf::Message * "
                                    << "to Abort * failed";
     HandleAbortMessage(abort_message);
@@ -337,6 +355,10 @@ void EkepHandshaker::SetRecordProtocol(RecordProtocol record_protocol) {
   record_protocol_ = record_protocol;
 }
 
+void EkepHandshaker::SetMaxProtectedFrameSize(size_t max_protected_frame_size) {
+  max_protected_frame_size_ = max_protected_frame_size;
+}
+
 Status EkepHandshaker::DeriveAndSetRecordProtocolKey(
     HandshakeCipher cipher_suite, RecordProtocol record_protocol,
     ByteContainerView master_secret) {
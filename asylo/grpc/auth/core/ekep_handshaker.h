@@ -154,6 +154,13 @@ class EkepHandshaker {
   // GoogleError::FAILED_PRECONDITION.
   StatusOr<CleansingVector<uint8_t>> GetRecordProtocolKey();
 
+  // Returns the negotiated maximum size of a record protocol frame, given that
+  // the handshake has successfully completed. A return value of zero indicates
+  // that the participants did not negotiate a frame size and use the default
+  // frame size of the record protocol. If the handshake has not yet completed,
+  // returns GoogleError::FAILED_PRECONDITION.
+  StatusOr<size_t> GetMaxProtectedFrameSize();
+
  protected:
   enum class HandshakeState {
     NOT_STARTED = 0,
@@ -198,9 +205,16 @@ class EkepHandshaker {
   // Adds an identity to the list of peer identities.
   void AddPeerIdentity(const EnclaveIdentity &identity);
 
+  // Returns the peer identities added so far.
+  const EnclaveIdentities &peer_identities() const { return *peer_identities_; }
+
   // Sets the record protocol to use after the handshake completes.
   void SetRecordProtocol(RecordProtocol record_protocol);
 
+  // Sets the maximum record protocol frame size to use after the handshake
+  // completes.
+  void SetMaxProtectedFrameSize(size_t max_protected_frame_size);
+
   // Derives and sets the record protocol key using the given |cipher_suite|,
   // |record_protocol|, |master_secret|, and the current handshake transcript.
   Status DeriveAndSetRecordProtocolKey(HandshakeCipher cipher_suite,
@@ -286,6 +300,10 @@ class EkepHandshaker {
 
   // The key used in the record protocol.
   CleansingVector<uint8_t> record_protocol_key_;
+
+  // The maximum record protocol frame size, or zero for the record protocol's
+  // default.
+  size_t max_protected_frame_size_;
 };
 
 }  // namespace asylo
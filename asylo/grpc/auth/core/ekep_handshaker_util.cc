@@ -18,6 +18,9 @@
 
 #include "asylo/grpc/auth/core/ekep_handshaker_util.h"
 
+#include <algorithm>
+#include <future>
+
 #include <google/protobuf/util/message_differencer.h>
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
@@ -25,9 +28,36 @@
 #include "asylo/identity/attestation/enclave_assertion_generator.h"
 #include "asylo/identity/attestation/enclave_assertion_verifier.h"
 #include "asylo/identity/enclave_assertion_authority.h"
+#include "asylo/identity/init.h"
+#include "asylo/util/logging.h"
 #include "asylo/util/status.h"
+#include "asylo/util/thread_pool.h"
 
 namespace asylo {
+namespace {
+
+// Initializes the authorities for |description| if their initialization was
+// deferred to their first use. Failures are logged, and surface to the caller
+// as errors from the uninitialized authority.
+void InitializeDeferredAuthority(const AssertionDescription &description) {
+  Status status = InitializeDeferredEnclaveAssertionAuthority(description);
+  if (!status.ok()) {
+    LOG(ERROR) << status;
+  }
+}
+
+// The number of threads that run assertion tasks concurrently.
+constexpr int kNumAssertionTaskThreads = 4;
+
+// Returns the process-wide pool that runs concurrent assertion tasks. It is
+// separate from the pool that runs handshake steps, since handshake steps wait
+// for these tasks. The pool is started on first use and is never destroyed.
+ThreadPool *AssertionTaskPool() {
+  static ThreadPool *pool = new ThreadPool(kNumAssertionTaskThreads);
+  return pool;
+}
+
+}  // namespace
 
 const EnclaveAssertionGenerator *GetEnclaveAssertionGenerator(
     const AssertionDescription &description) {
@@ -35,6 +65,7 @@ const EnclaveAssertionGenerator *GetEnclaveAssertionGenerator(
       EnclaveAssertionAuthority::GenerateAuthorityId(
           description.identity_type(), description.authority_type())
           .ValueOrDie();
+  InitializeDeferredAuthority(description);
   auto it = AssertionGeneratorMap::GetValue(authority_id);
   return (it == AssertionGeneratorMap::value_end()) ? nullptr : &*it;
 }
@@ -45,6 +76,7 @@ const EnclaveAssertionVerifier *GetEnclaveAssertionVerifier(
       EnclaveAssertionAuthority::GenerateAuthorityId(
           description.identity_type(), description.authority_type())
           .ValueOrDie();
+  InitializeDeferredAuthority(description);
   auto it = AssertionVerifierMap::GetValue(authority_id);
   return (it == AssertionVerifierMap::value_end()) ? nullptr : &*it;
 }
@@ -62,6 +94,15 @@ Status EkepHandshakerOptions::Validate() const {
                   "max_frame_size");
   }
 
+  if (max_protected_frame_size != 0 &&
+      (max_protected_frame_size < kEkepMinProtectedFrameSize ||
+       max_protected_frame_size > kEkepMaxProtectedFrameSize)) {
+    return Status(asylo::error::GoogleError::INVALID_ARGUMENT,
+                  absl::StrCat("max_protected_frame_size must be between ",
+                               kEkepMinProtectedFrameSize, " and ",
+                               kEkepMaxProtectedFrameSize));
+  }
+
   if (self_assertions.empty()) {
     return Status(asylo::error::GoogleError::INVALID_ARGUMENT,
                   "Must supply at least one self assertion");
@@ -123,6 +164,40 @@ std::vector<AssertionDescription>::const_iterator FindAssertionDescription(
       });
 }
 
+size_t NegotiateMaxProtectedFrameSize(size_t self_max_protected_frame_size,
+                                      size_t peer_max_protected_frame_size) {
+  if (self_max_protected_frame_size == 0 ||
+      peer_max_protected_frame_size == 0) {
+    return 0;
+  }
+  return std::max(
+      kEkepMinProtectedFrameSize,
+      std::min(self_max_protected_frame_size, peer_max_protected_frame_size));
+}
+
+std::vector<Status> RunAssertionTasks(
+    const std::vector<std::function<Status()>> &tasks, bool concurrent) {
+  std::vector<Status> results(tasks.size());
+  if (!concurrent || tasks.size() < 2) {
+    for (size_t i = 0; i < tasks.size(); ++i) {
+      results[i] = tasks[i]();
+    }
+    return results;
+  }
+
+  std::vector<std::future<Status>> pending;
+  pending.reserve(tasks.size() - 1);
+  for (size_t i = 1; i < tasks.size(); ++i) {
+    pending.push_back(
+        AssertionTaskPool()->Submit([&tasks, i] { return tasks[i](); }));
+  }
+  results[0] = tasks[0]();
+  for (size_t i = 1; i < tasks.size(); ++i) {
+    results[i] = pending[i - 1].get();
+  }
+  return results;
+}
+
 bool MakeEkepContextBlob(const std::string &public_key,
                          const std::string &transcript_hash,
                          std::string *ekep_context) {
@@ -19,9 +19,12 @@
 #ifndef ASYLO_GRPC_AUTH_CORE_EKEP_HANDSHAKER_UTIL_H_
 #define ASYLO_GRPC_AUTH_CORE_EKEP_HANDSHAKER_UTIL_H_
 
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "asylo/grpc/auth/core/ekep_session_tickets.h"
 #include "asylo/identity/attestation/enclave_assertion_generator.h"
 #include "asylo/identity/attestation/enclave_assertion_verifier.h"
 #include "asylo/identity/identity.pb.h"
@@ -29,6 +32,11 @@
 
 namespace asylo {
 
+// Bounds on the maximum record protocol frame size that an EKEP participant
+// may advertise. These match the limits of the ALTS record protocol.
+constexpr size_t kEkepMinProtectedFrameSize = 1024;
+constexpr size_t kEkepMaxProtectedFrameSize = 16 * 1024 * 1024;
+
 // Configuration options for an EKEP handshake. These options can be validated
 // by calling Validate(). See the comment above Validate() for restrictions on
 // field values.
@@ -45,6 +53,30 @@ struct EkepHandshakerOptions {
   // Additional data presented by the EKEP participant during the handshake.
   std::string additional_authenticated_data;
 
+  // Issuer of session tickets. If set on a server, the server issues a session
+  // ticket at the end of each handshake, and accepts valid tickets from clients
+  // in place of their assertions.
+  std::shared_ptr<EkepSessionTicketIssuer> session_ticket_issuer;
+
+  // Cache of session tickets. If set on a client, the client attempts to
+  // resume the session stored under session_cache_key, and stores the tickets
+  // issued by the server under that key.
+  std::shared_ptr<EkepClientSessionCache> session_cache;
+  std::string session_cache_key;
+
+  // The largest record protocol frame, in bytes, that the EKEP participant is
+  // willing to send and receive after the handshake. The frame size used by a
+  // session is the smaller of the values advertised by the two participants. If
+  // zero, the participant does not advertise a frame size, and the session uses
+  // the default frame size of the record protocol.
+  size_t max_protected_frame_size = 0;
+
+  // Whether the EKEP participant generates and verifies the assertions of a
+  // single handshake message concurrently, one thread per assertion, when more
+  // than one assertion is exchanged. Enclaves that cannot spare a thread for
+  // each assertion should disable this.
+  bool concurrent_assertions = true;
+
   // Validates the handshaker options. All of the following conditions must
   // hold, otherwise returns INVALID_ARGUMENT:
   //   * max_frame_size is non-zero and does not exceed
@@ -57,6 +89,8 @@ struct EkepHandshakerOptions {
   //   appropriate assertion-verification library available
   //   * The size of additional_authenticated_data is less than or equal to
   //   max_frame_size
+  //   * max_protected_frame_size is either zero or between
+  //   kEkepMinProtectedFrameSize and kEkepMaxProtectedFrameSize
   Status Validate() const;
 };
 
@@ -81,6 +115,23 @@ std::vector<AssertionDescription>::const_iterator FindAssertionDescription(
     const std::vector<AssertionDescription> &list,
     const AssertionDescription &description);
 
+// Returns the maximum record protocol frame size for a session in which this
+// participant advertised |self_max_protected_frame_size| and the peer
+// advertised |peer_max_protected_frame_size|. Returns zero, indicating the
+// record protocol's default, unless both participants advertised a size. A
+// non-zero result is never smaller than kEkepMinProtectedFrameSize.
+size_t NegotiateMaxProtectedFrameSize(size_t self_max_protected_frame_size,
+                                      size_t peer_max_protected_frame_size);
+
+// Runs each function in |tasks| and returns the resulting statuses, in the
+// same order as |tasks|. If |concurrent| is true and there is more than one
+// task, every task but the first runs on a shared pool of threads while the
+// calling thread runs the first, and the call returns once all of them have
+// finished.
+// Otherwise, the tasks run one after another on the calling thread.
+std::vector<Status> RunAssertionTasks(
+    const std::vector<std::function<Status()>> &tasks, bool concurrent);
+
 // Creates a unique EKEP context blob consisting of |public_key| and
 // |transcript_hash| and writes it to |ekep_context|. Returns true on success.
 bool MakeEkepContextBlob(const std::string &public_key,
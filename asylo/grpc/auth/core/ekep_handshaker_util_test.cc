@@ -18,8 +18,15 @@
 
 #include "asylo/grpc/auth/core/ekep_handshaker_util.h"
 
+#include <functional>
+#include <string>
+#include <vector>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
 #include "asylo/grpc/auth/core/ekep_handshaker.h"
 #include "asylo/identity/attestation/null/null_identity_util.h"
 #include "asylo/identity/descriptions.h"
@@ -29,6 +36,7 @@
 namespace asylo {
 namespace {
 
+using ::testing::ElementsAre;
 using ::testing::Not;
 
 const char kBadAuthorityType[] = "unknown authority";
@@ -94,6 +102,37 @@ TEST_F(EkepHandshakerUtilTest, ValidateBadFrameSize) {
   EXPECT_THAT(options.Validate(), Not(IsOk()));
 }
 
+// Verify that Validate accepts a maximum protected frame size of zero or within
+// the record protocol's limits, and rejects any other size.
+TEST_F(EkepHandshakerUtilTest, ValidateMaxProtectedFrameSize) {
+  EkepHandshakerOptions options = default_options_;
+  EXPECT_EQ(options.max_protected_frame_size, 0);
+
+  options.max_protected_frame_size = kEkepMinProtectedFrameSize;
+  EXPECT_THAT(options.Validate(), IsOk());
+
+  options.max_protected_frame_size = kEkepMaxProtectedFrameSize;
+  EXPECT_THAT(options.Validate(), IsOk());
+
+  options.max_protected_frame_size = kEkepMinProtectedFrameSize - 1;
+  EXPECT_THAT(options.Validate(), Not(IsOk()));
+
+  options.max_protected_frame_size = kEkepMaxProtectedFrameSize + 1;
+  EXPECT_THAT(options.Validate(), Not(IsOk()));
+}
+
+// Verify that the negotiated frame size is the smaller of the two advertised
+// sizes, and that it falls back to the default unless both sides advertise one.
+TEST_F(EkepHandshakerUtilTest, NegotiateMaxProtectedFrameSize) {
+  EXPECT_EQ(NegotiateMaxProtectedFrameSize(0, 0), 0);
+  EXPECT_EQ(NegotiateMaxProtectedFrameSize(1 << 20, 0), 0);
+  EXPECT_EQ(NegotiateMaxProtectedFrameSize(0, 1 << 20), 0);
+  EXPECT_EQ(NegotiateMaxProtectedFrameSize(1 << 20, 1 << 16), 1 << 16);
+  EXPECT_EQ(NegotiateMaxProtectedFrameSize(1 << 16, 1 << 20), 1 << 16);
+  EXPECT_EQ(NegotiateMaxProtectedFrameSize(1 << 20, 1),
+            kEkepMinProtectedFrameSize);
+}
+
 // Verify that Validate fails on a set of options with additional authenticated
 // data that is larger than half the maximum frame size.
 TEST_F(EkepHandshakerUtilTest, ValidateBadAadSize) {
@@ -148,5 +187,48 @@ TEST_F(EkepHandshakerUtilTest, ValidateInvalidAcceptedPeerAssertions) {
   EXPECT_THAT(options.Validate(), Not(IsOk()));
 }
 
+// Verify that RunAssertionTasks returns the status of each task in the order
+// of the tasks, whether or not the tasks run concurrently.
+TEST_F(EkepHandshakerUtilTest, RunAssertionTasksPreservesOrder) {
+  std::vector<std::function<Status()>> tasks;
+  for (int i = 0; i < 4; ++i) {
+    tasks.emplace_back([i] {
+      return Status(error::GoogleError::INTERNAL, absl::StrCat(i));
+    });
+  }
+
+  for (bool concurrent : {false, true}) {
+    std::vector<std::string> messages;
+    for (const Status &status : RunAssertionTasks(tasks, concurrent)) {
+      messages.emplace_back(status.error_message());
+    }
+    EXPECT_THAT(messages, ElementsAre("0", "1", "2", "3"));
+  }
+
+  EXPECT_TRUE(RunAssertionTasks({}, /*concurrent=*/true).empty());
+}
+
+// Verify that RunAssertionTasks runs the tasks concurrently when asked to. The
+// first task only succeeds if the second task runs while it is waiting.
+TEST_F(EkepHandshakerUtilTest, RunAssertionTasksRunsConcurrently) {
+  absl::Notification second_task_ran;
+  std::vector<std::function<Status()>> tasks = {
+      [&second_task_ran] {
+        return second_task_ran.WaitForNotificationWithTimeout(
+                   absl::Seconds(10))
+                   ? Status::OkStatus()
+                   : Status(error::GoogleError::DEADLINE_EXCEEDED,
+                            "Tasks did not run concurrently");
+      },
+      [&second_task_ran] {
+        second_task_ran.Notify();
+        return Status::OkStatus();
+      }};
+
+  for (const Status &status : RunAssertionTasks(tasks, /*concurrent=*/true)) {
+    EXPECT_THAT(status, IsOk());
+  }
+}
+
 }  // namespace
 }  // namespace asylo
@@ -0,0 +1,212 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "asylo/grpc/auth/core/ekep_session_tickets.h"
+
+#include <openssl/mem.h>
+#include <openssl/rand.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace {
+
+constexpr size_t kTicketKeySize = 32;
+constexpr size_t kTicketIdSize = 16;
+constexpr char kTicketAssociatedData[] = "EKEP Session Ticket v1";
+
+// Minimum number of redeemed ticket identifiers that are kept before expired
+// identifiers are pruned.
+constexpr size_t kMinPruneThreshold = 1024;
+
+// Overwrites the contents of |str|, which holds secret data.
+void CleanseString(std::string *str) {
+  if (!str->empty()) {
+    OPENSSL_cleanse(&(*str)[0], str->size());
+  }
+}
+
+}  // namespace
+
+StatusOr<std::unique_ptr<EkepSessionTicketIssuer>>
+EkepSessionTicketIssuer::Create(absl::Duration ticket_lifetime) {
+  if (ticket_lifetime <= absl::ZeroDuration()) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Session ticket lifetime must be positive");
+  }
+
+  CleansingVector<uint8_t> key(kTicketKeySize);
+  if (RAND_bytes(key.data(), key.size()) != 1) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Failed to generate session ticket key");
+  }
+  std::unique_ptr<AeadCryptor> cryptor;
+  ASYLO_ASSIGN_OR_RETURN(cryptor, AeadCryptor::CreateAesGcmSivCryptor(key));
+  return absl::WrapUnique(
+      new EkepSessionTicketIssuer(ticket_lifetime, std::move(cryptor)));
+}
+
+EkepSessionTicketIssuer::EkepSessionTicketIssuer(
+    absl::Duration ticket_lifetime, std::unique_ptr<AeadCryptor> cryptor)
+    : ticket_lifetime_(ticket_lifetime),
+      cryptor_(std::move(cryptor)),
+      prune_threshold_(kMinPruneThreshold) {}
+
+StatusOr<std::string> EkepSessionTicketIssuer::IssueTicket(
+    const EkepSessionState &state) {
+  std::vector<uint8_t> ticket_id(kTicketIdSize);
+  if (RAND_bytes(ticket_id.data(), ticket_id.size()) != 1) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Failed to generate session ticket identifier");
+  }
+
+  SessionTicketContents contents;
+  contents.set_ticket_id(ticket_id.data(), ticket_id.size());
+  contents.set_expiration_time_micros(
+      absl::ToUnixMicros(absl::Now() + ticket_lifetime_));
+  contents.set_cipher_suite(state.cipher_suite);
+  contents.set_record_protocol(state.record_protocol);
+  contents.set_resumption_secret(state.resumption_secret.data(),
+                                 state.resumption_secret.size());
+  *contents.mutable_peer_identities() = state.peer_identities;
+
+  CleansingVector<uint8_t> plaintext(contents.ByteSizeLong());
+  bool serialized =
+      contents.SerializeToArray(plaintext.data(), plaintext.size());
+  CleanseString(contents.mutable_resumption_secret());
+  if (!serialized) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Failed to serialize session ticket");
+  }
+
+  absl::MutexLock lock(&mu_);
+  size_t nonce_size = cryptor_->NonceSize();
+  std::vector<uint8_t> ticket(nonce_size + plaintext.size() +
+                              cryptor_->MaxSealOverhead());
+  size_t ciphertext_size;
+  ASYLO_RETURN_IF_ERROR(cryptor_->Seal(
+      plaintext, kTicketAssociatedData,
+      absl::MakeSpan(ticket.data(), nonce_size),
+      absl::MakeSpan(ticket.data() + nonce_size, ticket.size() - nonce_size),
+      &ciphertext_size));
+  return std::string(reinterpret_cast<const char *>(ticket.data()),
+                     nonce_size + ciphertext_size);
+}
+
+StatusOr<EkepSessionState> EkepSessionTicketIssuer::RedeemTicket(
+    ByteContainerView ticket) {
+  absl::MutexLock lock(&mu_);
+  size_t nonce_size = cryptor_->NonceSize();
+  if (ticket.size() < nonce_size) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Session ticket is malformed");
+  }
+
+  ByteContainerView nonce(ticket.data(), nonce_size);
+  ByteContainerView ciphertext(ticket.data() + nonce_size,
+                               ticket.size() - nonce_size);
+  CleansingVector<uint8_t> plaintext(ciphertext.size());
+  size_t plaintext_size;
+  if (!cryptor_
+           ->Open(ciphertext, kTicketAssociatedData, nonce,
+                  absl::MakeSpan(plaintext), &plaintext_size)
+           .ok()) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Session ticket could not be opened");
+  }
+
+  SessionTicketContents contents;
+  if (!contents.ParseFromArray(plaintext.data(), plaintext_size)) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Session ticket could not be parsed");
+  }
+
+  EkepSessionState state;
+  state.cipher_suite = contents.cipher_suite();
+  state.record_protocol = contents.record_protocol();
+  state.resumption_secret.assign(contents.resumption_secret().cbegin(),
+                                 contents.resumption_secret().cend());
+  CleanseString(contents.mutable_resumption_secret());
+  state.peer_identities = contents.peer_identities();
+
+  absl::Time now = absl::Now();
+  absl::Time expiration =
+      absl::FromUnixMicros(contents.expiration_time_micros());
+  if (expiration <= now) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Session ticket has expired");
+  }
+
+  if (redeemed_tickets_.size() >= prune_threshold_) {
+    PruneRedeemedTickets(now);
+  }
+  if (!redeemed_tickets_.emplace(contents.ticket_id(), expiration).second) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Session ticket was already redeemed");
+  }
+  return std::move(state);
+}
+
+void EkepSessionTicketIssuer::PruneRedeemedTickets(absl::Time now) {
+  for (auto it = redeemed_tickets_.begin(); it != redeemed_tickets_.end();) {
+    if (it->second <= now) {
+      redeemed_tickets_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+  prune_threshold_ = std::max(kMinPruneThreshold, 2 * redeemed_tickets_.size());
+}
+
+void EkepClientSessionCache::Insert(const std::string &key, std::string ticket,
+                                    absl::Duration lifetime,
+                                    EkepSessionState state) {
+  lifetime = std::min(lifetime, max_ticket_lifetime_);
+  if (lifetime <= absl::ZeroDuration()) {
+    return;
+  }
+
+  Entry entry;
+  entry.ticket = std::move(ticket);
+  entry.expiration = absl::Now() + lifetime;
+  entry.state = std::move(state);
+
+  absl::MutexLock lock(&mu_);
+  entries_[key] = std::move(entry);
+}
+
+absl::optional<EkepClientSessionCache::Entry> EkepClientSessionCache::Take(
+    const std::string &key) {
+  absl::MutexLock lock(&mu_);
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return absl::nullopt;
+  }
+  Entry entry = std::move(it->second);
+  entries_.erase(it);
+  if (entry.expiration <= absl::Now()) {
+    return absl::nullopt;
+  }
+  return std::move(entry);
+}
+
+}  // namespace asylo
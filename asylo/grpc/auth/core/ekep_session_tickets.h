@@ -0,0 +1,139 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef ASYLO_GRPC_AUTH_CORE_EKEP_SESSION_TICKETS_H_
+#define ASYLO_GRPC_AUTH_CORE_EKEP_SESSION_TICKETS_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "asylo/crypto/aead_cryptor.h"
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/grpc/auth/core/handshake.pb.h"
+#include "asylo/identity/identity.pb.h"
+#include "asylo/util/cleansing_types.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+
+// The state of an EKEP session that is needed to resume it without attesting
+// again.
+struct EkepSessionState {
+  // The cipher suite and record protocol negotiated for the session.
+  HandshakeCipher cipher_suite = UNKNOWN_HANDSHAKE_CIPHER;
+  RecordProtocol record_protocol = UNKNOWN_RECORD_PROTOCOL;
+
+  // The resumption secret derived at the end of the session's handshake.
+  CleansingVector<uint8_t> resumption_secret;
+
+  // The peer identities that were authenticated in the session's handshake.
+  EnclaveIdentities peer_identities;
+};
+
+// EkepSessionTicketIssuer issues and redeems the session tickets of an EKEP
+// server. A ticket is an EkepSessionState sealed, together with its expiration
+// time and a random identifier, under a key that is generated by the issuer and
+// never leaves it. Each ticket can be redeemed only once before it expires,
+// which prevents a captured ticket from being replayed.
+//
+// EkepSessionTicketIssuer is thread-safe.
+class EkepSessionTicketIssuer {
+ public:
+  // Creates an issuer of tickets that are valid for |ticket_lifetime|, which
+  // must be positive.
+  static StatusOr<std::unique_ptr<EkepSessionTicketIssuer>> Create(
+      absl::Duration ticket_lifetime);
+
+  // Returns the lifetime of tickets issued by this object.
+  absl::Duration ticket_lifetime() const { return ticket_lifetime_; }
+
+  // Returns a new ticket for |state|.
+  StatusOr<std::string> IssueTicket(const EkepSessionState &state);
+
+  // Returns the session state stored in |ticket|. Returns INVALID_ARGUMENT if
+  // |ticket| was not issued by this object, and FAILED_PRECONDITION if it has
+  // expired or was already redeemed.
+  StatusOr<EkepSessionState> RedeemTicket(ByteContainerView ticket);
+
+ private:
+  EkepSessionTicketIssuer(absl::Duration ticket_lifetime,
+                          std::unique_ptr<AeadCryptor> cryptor);
+
+  // Removes identifiers of expired tickets from |redeemed_tickets_|.
+  void PruneRedeemedTickets(absl::Time now)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const absl::Duration ticket_lifetime_;
+
+  absl::Mutex mu_;
+
+  // The cryptor used to seal and open tickets.
+  const std::unique_ptr<AeadCryptor> cryptor_ ABSL_GUARDED_BY(mu_);
+
+  // Identifiers of redeemed tickets that have not expired yet, mapped to their
+  // expiration time.
+  absl::flat_hash_map<std::string, absl::Time> redeemed_tickets_
+      ABSL_GUARDED_BY(mu_);
+
+  // Size of |redeemed_tickets_| at which it is next pruned.
+  size_t prune_threshold_ ABSL_GUARDED_BY(mu_);
+};
+
+// EkepClientSessionCache holds the session tickets received by an EKEP client,
+// keyed by an identifier of the server, such as its address. Since servers only
+// accept a ticket once, entries are removed when they are taken for use.
+//
+// EkepClientSessionCache is thread-safe.
+class EkepClientSessionCache {
+ public:
+  // A session ticket and the state of the session it resumes.
+  struct Entry {
+    std::string ticket;
+    absl::Time expiration;
+    EkepSessionState state;
+  };
+
+  // Creates a cache that holds tickets for at most |max_ticket_lifetime|, even
+  // if the server allows them to be used for longer.
+  explicit EkepClientSessionCache(absl::Duration max_ticket_lifetime)
+      : max_ticket_lifetime_(max_ticket_lifetime) {}
+
+  // Stores |ticket|, which resumes a session with |state| and is valid for
+  // |lifetime|, under |key|. Replaces any ticket previously stored under |key|.
+  void Insert(const std::string &key, std::string ticket,
+              absl::Duration lifetime, EkepSessionState state);
+
+  // Removes the entry stored under |key| and returns it, unless it has
+  // expired. Returns absl::nullopt if there is no usable entry.
+  absl::optional<Entry> Take(const std::string &key);
+
+ private:
+  const absl::Duration max_ticket_lifetime_;
+
+  absl::Mutex mu_;
+  absl::flat_hash_map<std::string, Entry> entries_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_GRPC_AUTH_CORE_EKEP_SESSION_TICKETS_H_
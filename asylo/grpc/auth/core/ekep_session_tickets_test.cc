@@ -0,0 +1,172 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "asylo/grpc/auth/core/ekep_session_tickets.h"
+
+#include <memory>
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "asylo/grpc/auth/core/handshake.pb.h"
+#include "asylo/test/util/proto_matchers.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Ne;
+
+class EkepSessionTicketsTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    state_.cipher_suite = CURVE25519_SHA256;
+    state_.record_protocol = ALTSRP_AES128_GCM;
+    state_.resumption_secret.assign(64, 0x5a);
+    EnclaveIdentity *identity = state_.peer_identities.add_identities();
+    identity->mutable_description()->set_authority_type("Peer authority");
+    identity->set_identity("Peer identity");
+  }
+
+  EkepSessionState state_;
+};
+
+TEST_F(EkepSessionTicketsTest, CreateRejectsNonPositiveLifetime) {
+  EXPECT_THAT(EkepSessionTicketIssuer::Create(absl::ZeroDuration()).status(),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  EXPECT_THAT(EkepSessionTicketIssuer::Create(-absl::Seconds(1)).status(),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+TEST_F(EkepSessionTicketsTest, RedeemReturnsIssuedState) {
+  std::unique_ptr<EkepSessionTicketIssuer> issuer;
+  ASYLO_ASSERT_OK_AND_ASSIGN(issuer,
+                             EkepSessionTicketIssuer::Create(absl::Hours(1)));
+  std::string ticket;
+  ASYLO_ASSERT_OK_AND_ASSIGN(ticket, issuer->IssueTicket(state_));
+
+  EkepSessionState redeemed;
+  ASYLO_ASSERT_OK_AND_ASSIGN(redeemed, issuer->RedeemTicket(ticket));
+  EXPECT_THAT(redeemed.cipher_suite, Eq(state_.cipher_suite));
+  EXPECT_THAT(redeemed.record_protocol, Eq(state_.record_protocol));
+  EXPECT_THAT(redeemed.resumption_secret, Eq(state_.resumption_secret));
+  EXPECT_THAT(redeemed.peer_identities, EqualsProto(state_.peer_identities));
+}
+
+TEST_F(EkepSessionTicketsTest, TicketsAreUnique) {
+  std::unique_ptr<EkepSessionTicketIssuer> issuer;
+  ASYLO_ASSERT_OK_AND_ASSIGN(issuer,
+                             EkepSessionTicketIssuer::Create(absl::Hours(1)));
+  std::string ticket1;
+  ASYLO_ASSERT_OK_AND_ASSIGN(ticket1, issuer->IssueTicket(state_));
+  std::string ticket2;
+  ASYLO_ASSERT_OK_AND_ASSIGN(ticket2, issuer->IssueTicket(state_));
+  EXPECT_THAT(ticket1, Ne(ticket2));
+  ASYLO_EXPECT_OK(issuer->RedeemTicket(ticket1));
+  ASYLO_EXPECT_OK(issuer->RedeemTicket(ticket2));
+}
+
+TEST_F(EkepSessionTicketsTest, RedeemRejectsReplayedTicket) {
+  std::unique_ptr<EkepSessionTicketIssuer> issuer;
+  ASYLO_ASSERT_OK_AND_ASSIGN(issuer,
+                             EkepSessionTicketIssuer::Create(absl::Hours(1)));
+  std::string ticket;
+  ASYLO_ASSERT_OK_AND_ASSIGN(ticket, issuer->IssueTicket(state_));
+
+  ASYLO_ASSERT_OK(issuer->RedeemTicket(ticket));
+  EXPECT_THAT(issuer->RedeemTicket(ticket).status(),
+              StatusIs(error::GoogleError::FAILED_PRECONDITION));
+}
+
+TEST_F(EkepSessionTicketsTest, RedeemRejectsExpiredTicket) {
+  std::unique_ptr<EkepSessionTicketIssuer> issuer;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      issuer, EkepSessionTicketIssuer::Create(absl::Milliseconds(1)));
+  std::string ticket;
+  ASYLO_ASSERT_OK_AND_ASSIGN(ticket, issuer->IssueTicket(state_));
+
+  absl::SleepFor(absl::Milliseconds(10));
+  EXPECT_THAT(issuer->RedeemTicket(ticket).status(),
+              StatusIs(error::GoogleError::FAILED_PRECONDITION));
+}
+
+TEST_F(EkepSessionTicketsTest, RedeemRejectsForeignAndTamperedTickets) {
+  std::unique_ptr<EkepSessionTicketIssuer> issuer;
+  ASYLO_ASSERT_OK_AND_ASSIGN(issuer,
+                             EkepSessionTicketIssuer::Create(absl::Hours(1)));
+  std::unique_ptr<EkepSessionTicketIssuer> other_issuer;
+  ASYLO_ASSERT_OK_AND_ASSIGN(other_issuer,
+                             EkepSessionTicketIssuer::Create(absl::Hours(1)));
+  std::string ticket;
+  ASYLO_ASSERT_OK_AND_ASSIGN(ticket, issuer->IssueTicket(state_));
+
+  EXPECT_THAT(other_issuer->RedeemTicket(ticket).status(),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  EXPECT_THAT(issuer->RedeemTicket("short").status(),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+
+  std::string tampered = ticket;
+  tampered.back() ^= 1;
+  EXPECT_THAT(issuer->RedeemTicket(tampered).status(),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+
+  // Failed attempts do not consume the ticket.
+  ASYLO_EXPECT_OK(issuer->RedeemTicket(ticket));
+}
+
+TEST_F(EkepSessionTicketsTest, ClientCacheTakeRemovesEntry) {
+  EkepClientSessionCache cache(absl::Hours(1));
+  EXPECT_FALSE(cache.Take("server").has_value());
+
+  cache.Insert("server", "ticket", absl::Minutes(5), state_);
+  EXPECT_FALSE(cache.Take("other server").has_value());
+
+  absl::optional<EkepClientSessionCache::Entry> entry = cache.Take("server");
+  ASSERT_TRUE(entry.has_value());
+  EXPECT_THAT(entry->ticket, Eq("ticket"));
+  EXPECT_THAT(entry->state.resumption_secret, Eq(state_.resumption_secret));
+  EXPECT_THAT(entry->state.peer_identities,
+              EqualsProto(state_.peer_identities));
+  EXPECT_FALSE(cache.Take("server").has_value());
+}
+
+TEST_F(EkepSessionTicketsTest, ClientCacheReplacesEntry) {
+  EkepClientSessionCache cache(absl::Hours(1));
+  cache.Insert("server", "old ticket", absl::Minutes(5), state_);
+  cache.Insert("server", "new ticket", absl::Minutes(5), state_);
+
+  absl::optional<EkepClientSessionCache::Entry> entry = cache.Take("server");
+  ASSERT_TRUE(entry.has_value());
+  EXPECT_THAT(entry->ticket, Eq("new ticket"));
+}
+
+TEST_F(EkepSessionTicketsTest, ClientCacheDropsExpiredEntries) {
+  EkepClientSessionCache cache(absl::Milliseconds(1));
+  cache.Insert("server", "ticket", absl::Hours(1), state_);
+  absl::SleepFor(absl::Milliseconds(10));
+  EXPECT_FALSE(cache.Take("server").has_value());
+
+  cache.Insert("server", "ticket", absl::ZeroDuration(), state_);
+  EXPECT_FALSE(cache.Take("server").has_value());
+}
+
+}  // namespace
+}  // namespace asylo
@@ -21,8 +21,11 @@
 #include <iterator>
 #include <utility>
 
+#include "asylo/grpc/auth/core/ekep_session_tickets.h"
 #include "asylo/grpc/auth/core/enclave_security_connector.h"
 #include "asylo/grpc/auth/enclave_credentials_options.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/statusor.h"
 #include "src/core/lib/channel/channel_args.h"
 #include "src/core/lib/gprpp/ref_counted_ptr.h"
 #include "src/core/lib/security/credentials/credentials.h"
@@ -53,7 +56,13 @@ grpc_enclave_channel_credentials::grpc_enclave_channel_credentials(
       accepted_peer_assertions(
           std::make_move_iterator(options.accepted_peer_assertions.begin()),
           std::make_move_iterator(options.accepted_peer_assertions.end())),
-      peer_acl(std::move(options.peer_acl)) {}
+      peer_acl(std::move(options.peer_acl)),
+      max_protected_frame_size(options.max_protected_frame_size) {
+  if (options.session_ticket_lifetime > absl::ZeroDuration()) {
+    session_cache = std::make_shared<asylo::EkepClientSessionCache>(
+        options.session_ticket_lifetime);
+  }
+}
 
 grpc_enclave_server_credentials::grpc_enclave_server_credentials(
     asylo::EnclaveCredentialsOptions options)
@@ -65,4 +74,17 @@ grpc_enclave_server_credentials::grpc_enclave_server_credentials(
       accepted_peer_assertions(
           std::make_move_iterator(options.accepted_peer_assertions.begin()),
           std::make_move_iterator(options.accepted_peer_assertions.end())),
-      peer_acl(std::move(options.peer_acl)) {}
+      peer_acl(std::move(options.peer_acl)),
+      max_protected_frame_size(options.max_protected_frame_size) {
+  if (options.session_ticket_lifetime > absl::ZeroDuration()) {
+    asylo::StatusOr<std::unique_ptr<asylo::EkepSessionTicketIssuer>>
+        issuer_result = asylo::EkepSessionTicketIssuer::Create(
+            options.session_ticket_lifetime);
+    if (issuer_result.ok()) {
+      session_ticket_issuer = std::move(issuer_result).ValueOrDie();
+    } else {
+      LOG(ERROR) << "Session resumption is disabled: "
+                 << issuer_result.status();
+    }
+  }
+}
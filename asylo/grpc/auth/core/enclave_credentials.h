@@ -19,10 +19,13 @@
 #ifndef ASYLO_GRPC_AUTH_CORE_ENCLAVE_CREDENTIALS_H_
 #define ASYLO_GRPC_AUTH_CORE_ENCLAVE_CREDENTIALS_H_
 
+#include <cstddef>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "absl/types/optional.h"
+#include "asylo/grpc/auth/core/ekep_session_tickets.h"
 #include "asylo/grpc/auth/enclave_credentials_options.h"
 #include "asylo/identity/identity.pb.h"
 #include "asylo/identity/identity_acl.pb.h"
@@ -58,6 +61,14 @@ struct grpc_enclave_channel_credentials final
 
   // Optional ACL enforced on the server's identity.
   absl::optional<asylo::IdentityAclPredicate> peer_acl;
+
+  // Session tickets received from servers, keyed by target, or nullptr if
+  // session resumption is disabled.
+  std::shared_ptr<asylo::EkepClientSessionCache> session_cache;
+
+  // The largest record protocol frame advertised to servers, or zero for the
+  // record protocol's default.
+  size_t max_protected_frame_size;
 };
 
 struct grpc_enclave_server_credentials final : public grpc_server_credentials {
@@ -81,6 +92,13 @@ struct grpc_enclave_server_credentials final : public grpc_server_credentials {
 
   // Optional ACL enforced on the client's identity.
   absl::optional<asylo::IdentityAclPredicate> peer_acl;
+
+  // Issuer of session tickets, or nullptr if session resumption is disabled.
+  std::shared_ptr<asylo::EkepSessionTicketIssuer> session_ticket_issuer;
+
+  // The largest record protocol frame advertised to clients, or zero for the
+  // record protocol's default.
+  size_t max_protected_frame_size;
 };
 
 #endif  // ASYLO_GRPC_AUTH_CORE_ENCLAVE_CREDENTIALS_H_
@@ -21,6 +21,7 @@
 #include <algorithm>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <google/protobuf/io/coded_stream.h>
@@ -31,6 +32,7 @@
 #include "asylo/grpc/auth/core/client_ekep_handshaker.h"
 #include "asylo/grpc/auth/core/ekep_handshaker.h"
 #include "asylo/grpc/auth/core/ekep_handshaker_util.h"
+#include "asylo/grpc/auth/core/ekep_session_tickets.h"
 #include "asylo/grpc/auth/core/handshake.pb.h"
 #include "asylo/grpc/auth/core/server_ekep_handshaker.h"
 #include "asylo/identity/delegating_identity_expectation_matcher.h"
@@ -39,10 +41,13 @@
 #include "asylo/identity/identity_acl_evaluator.h"
 #include "asylo/util/cleansing_types.h"
 #include "asylo/util/statusor.h"
+#include "asylo/util/thread_pool.h"
 #include "include/grpc/support/log.h"
 #include "src/core/lib/gpr/string.h"
+#include "src/core/lib/iomgr/exec_ctx.h"
 #include "src/core/lib/surface/api_trace.h"
 #include "src/core/tsi/alts/frame_protector/alts_frame_protector.h"
+#include "src/core/tsi/alts/zero_copy_frame_protector/alts_zero_copy_grpc_protector.h"
 #include "src/core/tsi/transport_security.h"
 #include "src/core/tsi/transport_security_interface.h"
 
@@ -51,6 +56,16 @@ namespace {
 
 constexpr int kEnclavePeerPropertyCount = 4;
 
+// The number of threads that run handshake steps off the gRPC poller threads.
+constexpr int kNumHandshakeThreads = 4;
+
+// Returns the process-wide pool that runs handshake steps. The pool is started
+// on first use and is never destroyed.
+ThreadPool *HandshakeThreadPool() {
+  static ThreadPool *pool = new ThreadPool(kNumHandshakeThreads);
+  return pool;
+}
+
 }  // namespace
 
 // --- tsi_handshaker_result implementation. ---
@@ -61,19 +76,25 @@ class TsiEnclaveHandshakerResult {
   TsiEnclaveHandshakerResult(
       bool is_client, RecordProtocol record_protocol,
       const CleansingVector<uint8_t> &record_protocol_key,
+      size_t max_protected_frame_size,
       std::unique_ptr<EnclaveIdentities> peer_identities,
       std::string unused_bytes)
       : is_client_(is_client),
         record_protocol_(record_protocol),
         record_protocol_key_(record_protocol_key),
+        max_protected_frame_size_(max_protected_frame_size),
+        frame_size_(0),
         peer_identities_(std::move(peer_identities)),
         unused_bytes_(std::move(unused_bytes)) {}
 
   // Creates a frame protector that uses a max frame size of
   // |max_output_protected_frame_size|, if non-null, and places the result in
-  // |protector|.
+  // |protector|. The frame size is capped by the size negotiated during the
+  // handshake, if any.
   tsi_result CreateFrameProtector(size_t *max_output_protected_frame_size,
                                   tsi_frame_protector **protector) {
+    max_output_protected_frame_size =
+        GetMaxFrameSize(max_output_protected_frame_size);
     switch (record_protocol_) {
       case ALTSRP_AES128_GCM:
         return alts_create_frame_protector(
@@ -85,6 +106,26 @@ class TsiEnclaveHandshakerResult {
     }
   }
 
+  // Creates a zero-copy frame protector that operates directly on gRPC slice
+  // buffers, and places the result in |protector|. The frame size is selected
+  // as in CreateFrameProtector().
+  tsi_result CreateZeroCopyGrpcProtector(
+      size_t *max_output_protected_frame_size,
+      tsi_zero_copy_grpc_protector **protector) {
+    max_output_protected_frame_size =
+        GetMaxFrameSize(max_output_protected_frame_size);
+    switch (record_protocol_) {
+      case ALTSRP_AES128_GCM:
+        return alts_zero_copy_grpc_protector_create(
+            record_protocol_key_.data(), record_protocol_key_.size(),
+            /*is_rekey=*/false, is_client_, /*is_integrity_only=*/false,
+            /*enable_extra_copy=*/false, max_output_protected_frame_size,
+            protector);
+      default:
+        return TSI_INTERNAL_ERROR;
+    }
+  }
+
   // Sets |bytes| to the unused bytes from the handshake, if any, and sets
   // |bytes_size| to the number of unused bytes.
   tsi_result GetUnusedBytes(const unsigned char **bytes, size_t *bytes_size) {
@@ -153,6 +194,22 @@ class TsiEnclaveHandshakerResult {
   }
 
  private:
+  // Returns the frame size to pass to a frame protector given the frame size
+  // |requested| by gRPC, which may be null. If a frame size was negotiated
+  // during the handshake, caps |requested| by it, or defaults to it if
+  // |requested| is null. The frame protector writes back the size it uses.
+  size_t *GetMaxFrameSize(size_t *requested) {
+    if (max_protected_frame_size_ == 0) {
+      return requested;
+    }
+    if (requested == nullptr) {
+      frame_size_ = max_protected_frame_size_;
+      return &frame_size_;
+    }
+    *requested = std::min(*requested, max_protected_frame_size_);
+    return requested;
+  }
+
   // True if this is a client handshaker result. Required for configuration of
   // the frame protector.
   bool is_client_;
@@ -163,6 +220,13 @@ class TsiEnclaveHandshakerResult {
   // The record protocol key to use for frame protection.
   CleansingVector<uint8_t> record_protocol_key_;
 
+  // The record protocol frame size negotiated during the handshake, or zero to
+  // use the default frame size of the record protocol.
+  size_t max_protected_frame_size_;
+
+  // Storage for the frame size used when gRPC does not request one.
+  size_t frame_size_;
+
   // The peer's enclave identities.
   std::unique_ptr<EnclaveIdentities> peer_identities_;
 
@@ -195,6 +259,16 @@ tsi_result enclave_handshaker_result_create_frame_protector(
                                             protector);
 }
 
+tsi_result enclave_handshaker_result_create_zero_copy_grpc_protector(
+    const tsi_handshaker_result *self, size_t *max_output_protected_frame_size,
+    tsi_zero_copy_grpc_protector **protector) {
+  const tsi_enclave_handshaker_result *result =
+      reinterpret_cast<const tsi_enclave_handshaker_result *>(self);
+
+  return result->impl->CreateZeroCopyGrpcProtector(
+      max_output_protected_frame_size, protector);
+}
+
 tsi_result enclave_handshaker_result_get_unused_bytes(
     const tsi_handshaker_result *self, const unsigned char **bytes,
     size_t *bytes_size) {
@@ -212,7 +286,7 @@ void enclave_handshaker_result_destroy(tsi_handshaker_result *self) {
 
 const tsi_handshaker_result_vtable handshaker_result_vtable = {
     enclave_handshaker_result_extract_peer,
-    nullptr /* create_zero_copy_grpc_protector */,
+    enclave_handshaker_result_create_zero_copy_grpc_protector,
     enclave_handshaker_result_create_frame_protector,
     enclave_handshaker_result_get_unused_bytes,
     enclave_handshaker_result_destroy,
@@ -257,22 +331,12 @@ void enclave_handshaker_destroy(tsi_handshaker *self) {
   delete (impl);
 }
 
-tsi_result enclave_handshaker_next(
+// Runs the next step of the handshake of |self| on the calling thread. The
+// arguments have the same meaning as those of tsi_handshaker_next().
+tsi_result enclave_handshaker_next_step(
     tsi_handshaker *self, const unsigned char *received_bytes,
     size_t received_bytes_size, const unsigned char **bytes_to_send,
-    size_t *bytes_to_send_size, tsi_handshaker_result **handshaker_result,
-    tsi_handshaker_on_next_done_cb cb, void *user_data) {
-  if ((received_bytes_size > 0 && !received_bytes) || !bytes_to_send ||
-      !bytes_to_send_size || !handshaker_result) {
-    return TSI_INVALID_ARGUMENT;
-  }
-  gpr_log(GPR_INFO,
-          "enclave_handshaker_next(self=%p, received_bytes=%p, "
-          "received_bytes_size=%zu, bytes_to_send=%p, bytes_to_send_size=%p "
-          "handshaker_result=%p, cb=%p, user_data=%p)",
-          self, received_bytes, received_bytes_size, bytes_to_send,
-          bytes_to_send_size, handshaker_result, cb, user_data);
-
+    size_t *bytes_to_send_size, tsi_handshaker_result **handshaker_result) {
   tsi_enclave_handshaker *tsi_handshaker =
       reinterpret_cast<tsi_enclave_handshaker *>(self);
   EkepHandshaker *handshaker = tsi_handshaker->handshaker.get();
@@ -322,6 +386,15 @@ tsi_result enclave_handshaker_next(
         return TSI_INTERNAL_ERROR;
       }
 
+      StatusOr<size_t> frame_size_result =
+          handshaker->GetMaxProtectedFrameSize();
+      if (!frame_size_result.ok()) {
+        gpr_log(
+            GPR_ERROR, "Failed to retrieve max protected frame size: %s",
+            std::string(frame_size_result.status().error_message()).c_str());
+        return TSI_INTERNAL_ERROR;
+      }
+
       StatusOr<std::unique_ptr<EnclaveIdentities>> identities_result =
           handshaker->GetPeerIdentities();
       if (!identities_result.ok()) {
@@ -344,7 +417,8 @@ tsi_result enclave_handshaker_next(
       tsi_result result = enclave_handshaker_result_create(
           absl::make_unique<TsiEnclaveHandshakerResult>(
               tsi_handshaker->is_client, record_protocol_result.ValueOrDie(),
-              key_result.ValueOrDie(), std::move(identities),
+              key_result.ValueOrDie(), frame_size_result.ValueOrDie(),
+              std::move(identities),
               unused_bytes_result.ValueOrDie()),
           handshaker_result);
       if (result == TSI_OK) {
@@ -358,6 +432,52 @@ tsi_result enclave_handshaker_next(
   }
 }
 
+tsi_result enclave_handshaker_next(
+    tsi_handshaker *self, const unsigned char *received_bytes,
+    size_t received_bytes_size, const unsigned char **bytes_to_send,
+    size_t *bytes_to_send_size, tsi_handshaker_result **handshaker_result,
+    tsi_handshaker_on_next_done_cb cb, void *user_data) {
+  if ((received_bytes_size > 0 && !received_bytes) || !bytes_to_send ||
+      !bytes_to_send_size || !handshaker_result) {
+    return TSI_INVALID_ARGUMENT;
+  }
+  gpr_log(GPR_INFO,
+          "enclave_handshaker_next(self=%p, received_bytes=%p, "
+          "received_bytes_size=%zu, bytes_to_send=%p, bytes_to_send_size=%p "
+          "handshaker_result=%p, cb=%p, user_data=%p)",
+          self, received_bytes, received_bytes_size, bytes_to_send,
+          bytes_to_send_size, handshaker_result, cb, user_data);
+
+  if (!cb) {
+    return enclave_handshaker_next_step(self, received_bytes,
+                                        received_bytes_size, bytes_to_send,
+                                        bytes_to_send_size, handshaker_result);
+  }
+
+  // A handshake step may generate or verify assertions, which can take a long
+  // time, for instance when it calls out to a remote attestation service. Run
+  // the step on the handshake thread pool so that it does not block the gRPC
+  // poller thread that received the peer's bytes, and report the outcome
+  // through |cb|. The caller keeps |self| alive until |cb| has been invoked.
+  std::string received;
+  if (received_bytes_size > 0) {
+    received.assign(reinterpret_cast<const char *>(received_bytes),
+                    received_bytes_size);
+  }
+  HandshakeThreadPool()->Schedule([self, received, cb, user_data] {
+    grpc_core::ExecCtx exec_ctx;
+    const unsigned char *bytes_to_send = nullptr;
+    size_t bytes_to_send_size = 0;
+    tsi_handshaker_result *handshaker_result = nullptr;
+    tsi_result result = enclave_handshaker_next_step(
+        self, reinterpret_cast<const unsigned char *>(received.data()),
+        received.size(), &bytes_to_send, &bytes_to_send_size,
+        &handshaker_result);
+    cb(result, user_data, bytes_to_send, bytes_to_send_size, handshaker_result);
+  });
+  return TSI_ASYNC;
+}
+
 const tsi_handshaker_vtable handshaker_vtable = {
     nullptr /* get_bytes_to_send_to_peer -- deprecated */,
     nullptr /* process_bytes_from_peer   -- deprecated */,
@@ -407,14 +527,20 @@ tsi_result tsi_enclave_handshaker_create(
     absl::Span<asylo::AssertionDescription> accepted_peer_assertions,
     absl::string_view additional_authenticated_data,
     const absl::optional<asylo::IdentityAclPredicate> &peer_acl,
-    tsi_handshaker **handshaker) {
+    std::shared_ptr<asylo::EkepClientSessionCache> session_cache,
+    absl::string_view session_cache_key,
+    std::shared_ptr<asylo::EkepSessionTicketIssuer> session_ticket_issuer,
+    size_t max_protected_frame_size, tsi_handshaker **handshaker) {
   GRPC_API_TRACE(
       "tsi_enclave_handshaker_create(is_client=%d, self_assertions=%p, "
       "accepted_peer_assertions=%p, additional_authenticated_data=%p, "
-      "peer_acl=%d, handshaker=%p)",
-      6,
+      "peer_acl=%d, session_cache=%p, session_ticket_issuer=%p, "
+      "max_protected_frame_size=%zu, handshaker=%p)",
+      9,
       (is_client, self_assertions.data(), accepted_peer_assertions.data(),
-       additional_authenticated_data.data(), peer_acl.has_value(), handshaker));
+       additional_authenticated_data.data(), peer_acl.has_value(),
+       session_cache.get(), session_ticket_issuer.get(),
+       max_protected_frame_size, handshaker));
 
   // Convert arguments to handshaker options.
   asylo::EkepHandshakerOptions options;
@@ -423,6 +549,13 @@ tsi_result tsi_enclave_handshaker_create(
   options.self_assertions = {self_assertions.cbegin(), self_assertions.cend()};
   options.accepted_peer_assertions = {accepted_peer_assertions.cbegin(),
                                       accepted_peer_assertions.cend()};
+  options.max_protected_frame_size = max_protected_frame_size;
+  if (is_client) {
+    options.session_cache = std::move(session_cache);
+    options.session_cache_key = std::string(session_cache_key);
+  } else {
+    options.session_ticket_issuer = std::move(session_ticket_issuer);
+  }
 
   if (!options.additional_authenticated_data.empty()) {
     gpr_log(GPR_DEBUG, "additional authenticated data: %s",
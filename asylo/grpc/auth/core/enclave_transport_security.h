@@ -19,9 +19,13 @@
 #ifndef ASYLO_GRPC_AUTH_CORE_ENCLAVE_TRANSPORT_SECURITY_H_
 #define ASYLO_GRPC_AUTH_CORE_ENCLAVE_TRANSPORT_SECURITY_H_
 
+#include <cstddef>
+#include <memory>
+
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
+#include "asylo/grpc/auth/core/ekep_session_tickets.h"
 #include "asylo/identity/identity.pb.h"
 #include "asylo/identity/identity_acl.pb.h"
 #include "src/core/tsi/transport_security_interface.h"
@@ -47,11 +51,21 @@
 //   the handshake
 //   * |peer_acl| is the ACL evaluated using the authenticated peer's
 //   identities.
+//   * |session_cache| and |session_cache_key| optionally enable session
+//   resumption for a client, using the tickets stored under the given key
+//   * |session_ticket_issuer| optionally enables session resumption for a
+//   server
+//   * |max_protected_frame_size| is the largest record protocol frame that the
+//   handshaker advertises to the peer, or zero to use the record protocol's
+//   default frame size
 tsi_result tsi_enclave_handshaker_create(
     bool is_client, absl::Span<asylo::AssertionDescription> self_assertions,
     absl::Span<asylo::AssertionDescription> accepted_peer_assertions,
     absl::string_view additional_authenticated_data,
     const absl::optional<asylo::IdentityAclPredicate> &peer_acl,
-    tsi_handshaker **handshaker);
+    std::shared_ptr<asylo::EkepClientSessionCache> session_cache,
+    absl::string_view session_cache_key,
+    std::shared_ptr<asylo::EkepSessionTicketIssuer> session_ticket_issuer,
+    size_t max_protected_frame_size, tsi_handshaker **handshaker);
 
 #endif  // ASYLO_GRPC_AUTH_CORE_ENCLAVE_TRANSPORT_SECURITY_H_
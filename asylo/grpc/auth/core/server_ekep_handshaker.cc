@@ -18,12 +18,17 @@
 
 #include "asylo/grpc/auth/core/server_ekep_handshaker.h"
 
-#include <openssl/curve25519.h>
 #include <openssl/rand.h>
 
+#include <functional>
+#include <utility>
+#include <vector>
+
 #include <google/protobuf/io/zero_copy_stream_impl_lite.h>
 #include "absl/memory/memory.h"
+#include "absl/time/time.h"
 #include "asylo/crypto/sha256_hash.h"
+#include "asylo/crypto/x25519_key_pool.h"
 #include "asylo/util/logging.h"
 #include "asylo/grpc/auth/core/ekep_crypto.h"
 #include "asylo/grpc/auth/core/ekep_error_space.h"
@@ -33,6 +38,7 @@
 #include "asylo/util/cleansing_types.h"
 #include "asylo/util/proto_enum_util.h"
 #include "asylo/util/status_macros.h"
+#include "asylo/util/statusor.h"
 
 namespace asylo {
 namespace {
@@ -63,6 +69,9 @@ ServerEkepHandshaker::ServerEkepHandshaker(const EkepHandshakerOptions &options)
       available_record_protocols_({ALTSRP_AES128_GCM}),
       available_ekep_versions_({"EKEP v1"}),
       additional_authenticated_data_(options.additional_authenticated_data),
+      session_ticket_issuer_(options.session_ticket_issuer),
+      max_protected_frame_size_(options.max_protected_frame_size),
+      concurrent_assertions_(options.concurrent_assertions),
       selected_cipher_suite_(UNKNOWN_HANDSHAKE_CIPHER),
       selected_record_protocol_(UNKNOWN_RECORD_PROTOCOL),
       expected_message_type_(CLIENT_PRECOMMIT),
@@ -224,12 +233,21 @@ Status ServerEkepHandshaker::HandleClientPrecommit(
     return Status(Abort::BAD_RECORD_PROTOCOL, "No compatible record_protocol");
   }
 
+  SetMaxProtectedFrameSize(NegotiateMaxProtectedFrameSize(
+      max_protected_frame_size_, client_precommit.max_protected_frame_size()));
+
   // Verify that the client sent an adequately-sized challenge.
   if (client_precommit.challenge().size() != kEkepChallengeSize) {
     return Status(Abort::PROTOCOL_ERROR,
                   "Received a challenge with incorrect size");
   }
 
+  // A resumed handshake skips the exchange of assertions, so there is nothing
+  // to offer or request.
+  if (RedeemSessionTicket(client_precommit)) {
+    return WriteServerPrecommit(output);
+  }
+
   for (const AssertionOffer &offer : client_precommit.client_offers()) {
     const AssertionDescription &offer_desc = offer.description();
     // Request any assertion that the peer offered and that this handshaker is
@@ -289,6 +307,8 @@ Status ServerEkepHandshaker::HandleClientId(const google::protobuf::Message &mes
     return Status(Abort::INTERNAL_ERROR, "Failed to generate context");
   }
 
+  // Match each assertion to an expected description before verifying any of
+  // them, so that the verifications are independent of each other.
   for (const Assertion &assertion : client_id.assertions()) {
     auto desc_it = FindAssertionDescription(expected_peer_assertions_,
                                             assertion.description());
@@ -297,19 +317,31 @@ Status ServerEkepHandshaker::HandleClientId(const google::protobuf::Message &mes
                     "Client provided an assertion that was not previously "
                     "requested");
     }
+    expected_peer_assertions_.erase(desc_it);
+  }
 
-    EnclaveIdentity identity;
-    // Note that assertion verifiers were verified during creation of the
-    // handshaker so there is no need to check whether the call to
-    // GetEnclaveAssertionVerifier() returns nullptr.
-    Status status = GetEnclaveAssertionVerifier(assertion.description())
-                        ->Verify(ekep_context, assertion, &identity);
+  std::vector<EnclaveIdentity> identities(client_id.assertions_size());
+  std::vector<std::function<Status()>> tasks;
+  tasks.reserve(identities.size());
+  for (int i = 0; i < client_id.assertions_size(); ++i) {
+    tasks.emplace_back([&client_id, &ekep_context, &identities, i] {
+      const Assertion &assertion = client_id.assertions(i);
+      // Note that assertion verifiers were verified during creation of the
+      // handshaker so there is no need to check whether the call to
+      // GetEnclaveAssertionVerifier() returns nullptr.
+      return GetEnclaveAssertionVerifier(assertion.description())
+          ->Verify(ekep_context, assertion, &identities[i]);
+    });
+  }
+  for (const Status &status :
+       RunAssertionTasks(tasks, concurrent_assertions_)) {
     if (!status.ok()) {
       LOG(ERROR) << "Assertion could not be verified: " << status;
       return Status(Abort::BAD_ASSERTION, "Assertion could not be verified");
     }
+  }
+  for (const EnclaveIdentity &identity : identities) {
     AddPeerIdentity(identity);
-    expected_peer_assertions_.erase(desc_it);
   }
 
   if (!expected_peer_assertions_.empty()) {
@@ -318,6 +350,15 @@ Status ServerEkepHandshaker::HandleClientId(const google::protobuf::Message &mes
                   "Client did not provide all expected assertions");
   }
 
+  // In a resumed handshake, the client is authenticated by the identities from
+  // its session ticket.
+  if (resumed_session_.has_value()) {
+    for (const EnclaveIdentity &identity :
+         resumed_session_->peer_identities.identities()) {
+      AddPeerIdentity(identity);
+    }
+  }
+
   std::copy(client_id.dh_public_key().cbegin(),
             client_id.dh_public_key().cend(),
             std::back_inserter(client_public_key_));
@@ -362,6 +403,13 @@ Status ServerEkepHandshaker::WriteServerPrecommit(std::string *output) {
       selected_ekep_version_);
   server_precommit.set_selected_cipher_suite(selected_cipher_suite_);
   server_precommit.set_selected_record_protocol(selected_record_protocol_);
+  if (resumed_session_.has_value()) {
+    server_precommit.set_session_resumed(true);
+  }
+
+  if (max_protected_frame_size_ != 0) {
+    server_precommit.set_max_protected_frame_size(max_protected_frame_size_);
+  }
 
   if (!additional_authenticated_data_.empty()) {
     server_precommit.mutable_options()->set_data(
@@ -403,13 +451,12 @@ Status ServerEkepHandshaker::WriteServerPrecommit(std::string *output) {
 }
 
 Status ServerEkepHandshaker::WriteServerId(std::string *output) {
-  // Generate an ephemeral Diffie-Hellman key-pair for the negotiated cipher
+  // Take a fresh ephemeral Diffie-Hellman key-pair for the negotiated cipher
   // suite.
   switch (selected_cipher_suite_) {
     case CURVE25519_SHA256:
-      dh_public_key_.resize(X25519_PUBLIC_VALUE_LEN);
-      dh_private_key_.resize(X25519_PRIVATE_KEY_LEN);
-      X25519_keypair(dh_public_key_.data(), dh_private_key_.data());
+      X25519KeyPool::GetInstance()->TakeKeyPair(&dh_public_key_,
+                                                &dh_private_key_);
       break;
     default:
       LOG(ERROR) << "Server handshaker has bad cipher suite configuration";
@@ -438,13 +485,22 @@ Status ServerEkepHandshaker::WriteServerId(std::string *output) {
 
   // Generate all assertions that the client requested and that the server
   // offered.
+  std::vector<std::function<Status()>> tasks;
+  tasks.reserve(promised_assertions_.size());
   for (const AssertionRequest &request : promised_assertions_) {
-    // Note that assertion generators were verified during creation of the
-    // handshaker so there is no need to check whether the call to
-    // GetEnclaveAssertionGenerator() returns nullptr.
-    Status status =
-        GetEnclaveAssertionGenerator(request.description())
-            ->Generate(ekep_context, request, server_id.add_assertions());
+    // The assertions are added up front so that each task fills in its own,
+    // and the assertions appear in the same order as their requests.
+    Assertion *assertion = server_id.add_assertions();
+    tasks.emplace_back([&ekep_context, &request, assertion] {
+      // Note that assertion generators were verified during creation of the
+      // handshaker so there is no need to check whether the call to
+      // GetEnclaveAssertionGenerator() returns nullptr.
+      return GetEnclaveAssertionGenerator(request.description())
+          ->Generate(ekep_context, request, assertion);
+    });
+  }
+  for (const Status &status :
+       RunAssertionTasks(tasks, concurrent_assertions_)) {
     if (!status.ok()) {
       LOG(ERROR) << "Assertion generation failed: " << status;
       return Status(Abort::INTERNAL_ERROR, "Assertion generation failed");
@@ -466,9 +522,16 @@ Status ServerEkepHandshaker::WriteServerFinish(std::string *output) {
   std::string transcript_hash;
   ASYLO_RETURN_IF_ERROR(GetTranscriptHash(&transcript_hash));
 
-  ASYLO_RETURN_IF_ERROR(DeriveSecrets(selected_cipher_suite_, transcript_hash,
-                                      client_public_key_, dh_private_key_,
-                                      &master_secret_, &authenticator_secret_));
+  if (resumed_session_.has_value()) {
+    ASYLO_RETURN_IF_ERROR(DeriveResumedSecrets(
+        selected_cipher_suite_, transcript_hash, client_public_key_,
+        dh_private_key_, resumed_session_->resumption_secret, &master_secret_,
+        &authenticator_secret_));
+  } else {
+    ASYLO_RETURN_IF_ERROR(DeriveSecrets(
+        selected_cipher_suite_, transcript_hash, client_public_key_,
+        dh_private_key_, &master_secret_, &authenticator_secret_));
+  }
 
   CleansingVector<uint8_t> authenticator;
   ASYLO_RETURN_IF_ERROR(ComputeServerHandshakeAuthenticator(
@@ -477,10 +540,64 @@ Status ServerEkepHandshaker::WriteServerFinish(std::string *output) {
   ServerFinish server_finish;
   server_finish.set_handshake_authenticator(authenticator.data(),
                                             authenticator.size());
+  if (session_ticket_issuer_) {
+    IssueSessionTicket(transcript_hash, &server_finish);
+  }
 
   return WriteFrameAndUpdateTranscript(SERVER_FINISH, server_finish, output);
 }
 
+bool ServerEkepHandshaker::RedeemSessionTicket(
+    const ClientPrecommit &client_precommit) {
+  if (!session_ticket_issuer_ || client_precommit.session_ticket().empty()) {
+    return false;
+  }
+
+  StatusOr<EkepSessionState> state_result =
+      session_ticket_issuer_->RedeemTicket(client_precommit.session_ticket());
+  if (!state_result.ok()) {
+    LOG(INFO) << "Falling back to a full handshake: "
+              << state_result.status();
+    return false;
+  }
+  EkepSessionState state = std::move(state_result).ValueOrDie();
+  if (state.cipher_suite != selected_cipher_suite_ ||
+      state.record_protocol != selected_record_protocol_) {
+    LOG(INFO) << "Falling back to a full handshake: session ticket does not "
+              << "match the selected cipher suite and record protocol";
+    return false;
+  }
+
+  resumed_session_ = std::move(state);
+  return true;
+}
+
+void ServerEkepHandshaker::IssueSessionTicket(ByteContainerView transcript_hash,
+                                              ServerFinish *server_finish) {
+  EkepSessionState state;
+  state.cipher_suite = selected_cipher_suite_;
+  state.record_protocol = selected_record_protocol_;
+  state.peer_identities = peer_identities();
+  Status status = DeriveResumptionSecret(selected_cipher_suite_,
+                                         transcript_hash, master_secret_,
+                                         &state.resumption_secret);
+  if (!status.ok()) {
+    LOG(WARNING) << "Failed to derive resumption secret: " << status;
+    return;
+  }
+
+  StatusOr<std::string> ticket_result =
+      session_ticket_issuer_->IssueTicket(state);
+  if (!ticket_result.ok()) {
+    LOG(WARNING) << "Failed to issue session ticket: "
+                 << ticket_result.status();
+    return;
+  }
+  server_finish->set_session_ticket(std::move(ticket_result).ValueOrDie());
+  server_finish->set_session_ticket_lifetime_seconds(absl::ToInt64Seconds(
+      session_ticket_issuer_->ticket_lifetime()));
+}
+
 bool ServerEkepHandshaker::SetSelectedEkepVersion(
     const google::protobuf::RepeatedPtrField<EkepVersion> &ekep_versions) {
   // Choose the first compatible EKEP version available.
@@ -26,8 +26,11 @@
 
 #include <google/protobuf/io/zero_copy_stream.h>
 #include <google/protobuf/message.h>
+#include "absl/types/optional.h"
+#include "asylo/crypto/util/byte_container_view.h"
 #include "asylo/grpc/auth/core/ekep_handshaker.h"
 #include "asylo/grpc/auth/core/ekep_handshaker_util.h"
+#include "asylo/grpc/auth/core/ekep_session_tickets.h"
 #include "asylo/util/cleansing_types.h"
 
 namespace asylo {
@@ -100,6 +103,17 @@ class ServerEkepHandshaker final : public EkepHandshaker {
   // transcript.
   Status WriteServerFinish(std::string *output);
 
+  // Attempts to redeem the session ticket in |client_precommit| for resuming a
+  // session with the selected cipher suite and record protocol. Returns true
+  // if the session can be resumed, or false if the handshaker must fall back
+  // to a full handshake.
+  bool RedeemSessionTicket(const ClientPrecommit &client_precommit);
+
+  // Issues a ticket for resuming the current session and adds it to
+  // |server_finish|. A failure to issue a ticket does not fail the handshake.
+  void IssueSessionTicket(ByteContainerView transcript_hash,
+                          ServerFinish *server_finish);
+
   // Sets the handshaker's selected EKEP version to first compatible EKEP
   // version in |ekep_versions|. Returns false if there is no compatible EKEP
   // version in |ekep_versions|.
@@ -136,6 +150,21 @@ class ServerEkepHandshaker final : public EkepHandshaker {
   // Additional data that is authenticated during the handshake.
   const std::string additional_authenticated_data_;
 
+  // Issuer of session tickets, or nullptr if session resumption is disabled.
+  const std::shared_ptr<EkepSessionTicketIssuer> session_ticket_issuer_;
+
+  // The maximum record protocol frame size advertised by this handshaker, or
+  // zero if it does not advertise one.
+  const size_t max_protected_frame_size_;
+
+  // Whether assertions are generated and verified concurrently.
+  const bool concurrent_assertions_;
+
+  // The state of the session that is being resumed. This field is populated
+  // after validation of the ClientPrecommit message, if the client presented a
+  // valid session ticket.
+  absl::optional<EkepSessionState> resumed_session_;
+
   // Assertions requested by the client that the server is willing to offer.
   // This field is populated after validation of the ClientPrecommit message.
   std::vector<AssertionRequest> promised_assertions_;
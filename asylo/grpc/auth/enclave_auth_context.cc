@@ -18,15 +18,90 @@
 
 #include "asylo/grpc/auth/enclave_auth_context.h"
 
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "asylo/grpc/auth/core/enclave_grpc_security_constants.h"
 #include "asylo/identity/identity_acl_evaluator.h"
 #include "asylo/util/status.h"
+#include "asylo/util/status_macros.h"
 #include "src/core/lib/security/context/security_context.h"
 #include "src/core/tsi/transport_security_interface.h"
 
 namespace asylo {
+namespace {
+
+// Maximum number of peers whose state is cached by GetPeerState().
+constexpr size_t kMaxCachedPeers = 128;
+
+// Maximum number of ACL results memoized per peer.
+constexpr size_t kMaxCachedAcls = 64;
+
+// Returns a deterministic serialization of |acl|, which identifies it in the
+// ACL results of a peer.
+std::string AclFingerprint(const IdentityAclPredicate &acl) {
+  std::string fingerprint;
+  {
+    google::protobuf::io::StringOutputStream string_stream(&fingerprint);
+    google::protobuf::io::CodedOutputStream coded_stream(&string_stream);
+    coded_stream.SetSerializationDeterministic(true);
+    acl.SerializeToCodedStream(&coded_stream);
+  }
+  return fingerprint;
+}
+
+}  // namespace
+
+struct EnclaveAuthContext::PeerState {
+  // Result of evaluating an ACL against the peer's identities.
+  struct AclResult {
+    bool matched;
+    std::string explanation;
+  };
+
+  explicit PeerState(const EnclaveIdentities &peer_identities)
+      : identities(peer_identities.identities().begin(),
+                   peer_identities.identities().end()) {}
+
+  const std::vector<EnclaveIdentity> identities;
+
+  absl::Mutex mu;
+  absl::flat_hash_map<std::string, AclResult> acl_results ABSL_GUARDED_BY(mu);
+};
+
+StatusOr<std::shared_ptr<EnclaveAuthContext::PeerState>>
+EnclaveAuthContext::GetPeerState(absl::string_view serialized_identities) {
+  static absl::Mutex *const mu = new absl::Mutex();
+  static auto *const peers =
+      new absl::flat_hash_map<std::string, std::shared_ptr<PeerState>>();
+
+  absl::MutexLock lock(mu);
+  auto it = peers->find(serialized_identities);
+  if (it != peers->end()) {
+    return it->second;
+  }
+  EnclaveIdentities identities;
+  if (!identities.ParseFromArray(serialized_identities.data(),
+                                 serialized_identities.size())) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Ill-formed peer identity in auth context");
+  }
+  if (peers->size() >= kMaxCachedPeers) {
+    peers->clear();
+  }
+  auto peer = std::make_shared<PeerState>(identities);
+  peers->emplace(std::string(serialized_identities), peer);
+  return peer;
+}
 
 StatusOr<EnclaveAuthContext> EnclaveAuthContext::CreateFromServerContext(
     const ::grpc::ServerContext &server_context) {
@@ -40,7 +115,7 @@ StatusOr<EnclaveAuthContext> EnclaveAuthContext::CreateFromAuthContext(
                   "Peer is not authenticated");
   }
 
-  EnclaveIdentities identities;
+  std::shared_ptr<PeerState> peer;
   uint32_t record_protocol = 0;
   for (auto it = auth_context.begin(); it != auth_context.end(); ++it) {
     ::grpc::AuthProperty auth_property = *it;
@@ -63,11 +138,10 @@ StatusOr<EnclaveAuthContext> EnclaveAuthContext::CreateFromAuthContext(
           &record_protocol);
     } else if (auth_property.first ==
                auth_context.GetPeerIdentityPropertyName()) {
-      if (!identities.ParseFromArray(auth_property.second.data(),
-                                     auth_property.second.length())) {
-        return Status(error::GoogleError::INVALID_ARGUMENT,
-                      "Ill-formed peer identity in auth context");
-      }
+      ASYLO_ASSIGN_OR_RETURN(
+          peer, GetPeerState(absl::string_view(
+                    auth_property.second.data(),
+                    auth_property.second.length())));
     } else if (auth_property.first ==
                GRPC_TRANSPORT_SECURITY_TYPE_PROPERTY_NAME) {
       if (auth_property.second != GRPC_ENCLAVE_TRANSPORT_SECURITY_TYPE) {
@@ -87,15 +161,22 @@ StatusOr<EnclaveAuthContext> EnclaveAuthContext::CreateFromAuthContext(
     }
   }
 
-  return EnclaveAuthContext(std::move(identities),
+  if (!peer) {
+    peer = std::make_shared<PeerState>(EnclaveIdentities());
+  }
+  return EnclaveAuthContext(std::move(peer),
                             static_cast<RecordProtocol>(record_protocol));
 }
 
-EnclaveAuthContext::EnclaveAuthContext(EnclaveIdentities identities,
+EnclaveAuthContext::EnclaveAuthContext(std::shared_ptr<PeerState> peer,
                                        RecordProtocol record_protocol)
-    : identities_(
-          {identities.identities().begin(), identities.identities().end()}),
-      record_protocol_(record_protocol) {}
+    : peer_(std::move(peer)), record_protocol_(record_protocol) {}
+
+const std::vector<EnclaveIdentity> &EnclaveAuthContext::identities() const {
+  static const std::vector<EnclaveIdentity> *const kNoIdentities =
+      new std::vector<EnclaveIdentity>();
+  return peer_ ? peer_->identities : *kNoIdentities;
+}
 
 RecordProtocol EnclaveAuthContext::GetRecordProtocol() const {
   return record_protocol_;
@@ -108,15 +189,16 @@ bool EnclaveAuthContext::HasEnclaveIdentity(
 
 StatusOr<const EnclaveIdentity *> EnclaveAuthContext::FindEnclaveIdentity(
     const EnclaveIdentityDescription &description) const {
+  const std::vector<EnclaveIdentity> &peer_identities = identities();
   auto it = std::find_if(
-      identities_.cbegin(), identities_.cend(),
+      peer_identities.cbegin(), peer_identities.cend(),
       [&description](const EnclaveIdentity &identity) -> bool {
         return identity.description().identity_type() ==
                    description.identity_type() &&
                identity.description().authority_type() ==
                    description.authority_type();
       });
-  if (it == identities_.cend()) {
+  if (it == peer_identities.cend()) {
     return Status(error::GoogleError::NOT_FOUND, "No matching identity");
   }
   return &*it;
@@ -129,8 +211,39 @@ StatusOr<bool> EnclaveAuthContext::EvaluateAcl(
 
 StatusOr<bool> EnclaveAuthContext::EvaluateAcl(const IdentityAclPredicate &acl,
                                                std::string *explanation) const {
-  return EvaluateIdentityAcl(identities_, acl, matcher_,
-                             /*explanation=*/explanation);
+  if (!peer_) {
+    return EvaluateIdentityAcl(identities(), acl, matcher_,
+                               /*explanation=*/explanation);
+  }
+
+  std::string fingerprint = AclFingerprint(acl);
+  {
+    absl::MutexLock lock(&peer_->mu);
+    auto it = peer_->acl_results.find(fingerprint);
+    if (it != peer_->acl_results.end()) {
+      if (explanation != nullptr && !it->second.matched) {
+        *explanation = it->second.explanation;
+      }
+      return it->second.matched;
+    }
+  }
+
+  // Evaluate without holding the lock. Concurrent first calls for the same ACL
+  // may evaluate it more than once, which is harmless. Errors are not cached.
+  PeerState::AclResult result;
+  ASYLO_ASSIGN_OR_RETURN(
+      result.matched, EvaluateIdentityAcl(peer_->identities, acl, matcher_,
+                                          &result.explanation));
+  if (explanation != nullptr && !result.matched) {
+    *explanation = result.explanation;
+  }
+
+  bool matched = result.matched;
+  absl::MutexLock lock(&peer_->mu);
+  if (peer_->acl_results.size() < kMaxCachedAcls) {
+    peer_->acl_results.emplace(std::move(fingerprint), std::move(result));
+  }
+  return matched;
 }
 
 StatusOr<bool> EnclaveAuthContext::EvaluateAcl(
@@ -19,9 +19,11 @@
 #ifndef ASYLO_GRPC_AUTH_ENCLAVE_AUTH_CONTEXT_H_
 #define ASYLO_GRPC_AUTH_ENCLAVE_AUTH_CONTEXT_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "absl/strings/string_view.h"
 #include "asylo/grpc/auth/core/handshake.pb.h"
 #include "asylo/identity/delegating_identity_expectation_matcher.h"
 #include "asylo/identity/identity.pb.h"
@@ -83,6 +85,9 @@ class EnclaveAuthContext {
 
   /// Evaluates the peer's identities against `acl`.
   ///
+  /// Results are memoized per peer and ACL, so repeated evaluations of the
+  /// same ACL for connections from the same peer do not re-match identities.
+  ///
   /// \param acl The ACL against which to evaluate the peer's identities.
   /// \return A bool indicating whether the peer's identities match `acl`, or a
   ///         non-OK Status if an error occurred while evaluating the ACL.
@@ -122,13 +127,29 @@ class EnclaveAuthContext {
       std::string *explanation) const;
 
  private:
-  // Creates an EnclaveAuthContext for the given peer's |identities| and the
-  // session |record_protocol|.
-  EnclaveAuthContext(EnclaveIdentities identities,
+  // Parsed identities of a peer and the memoized results of ACLs evaluated
+  // against them. Shared by all auth contexts whose peer identity property is
+  // byte-for-byte identical.
+  struct PeerState;
+
+  // Creates an EnclaveAuthContext for the given |peer| and the session
+  // |record_protocol|.
+  EnclaveAuthContext(std::shared_ptr<PeerState> peer,
                      RecordProtocol record_protocol);
 
-  // Enclave identities held by the authenticated peer.
-  std::vector<EnclaveIdentity> identities_;
+  // Returns the state of the peer whose identity property is
+  // |serialized_identities|, from a process-wide cache if possible. Auth
+  // contexts are created per call, so the cache is what lets calls on the same
+  // connection, or from the same peer, share parsed identities and ACL
+  // results.
+  static StatusOr<std::shared_ptr<PeerState>> GetPeerState(
+      absl::string_view serialized_identities);
+
+  // Returns the enclave identities held by the authenticated peer.
+  const std::vector<EnclaveIdentity> &identities() const;
+
+  // State of the authenticated peer, or nullptr if there is none.
+  std::shared_ptr<PeerState> peer_;
 
   // Secure transport record protocol.
   RecordProtocol record_protocol_;
@@ -18,6 +18,7 @@
 
 #include "asylo/grpc/auth/enclave_auth_context.h"
 
+#include <atomic>
 #include <string>
 
 #include <google/protobuf/io/coded_stream.h>
@@ -52,11 +53,15 @@ using ::testing::HasSubstr;
 using ::testing::IsEmpty;
 using ::testing::Not;
 
+// Number of calls to TestIdentityExpectationMatcher::MatchAndExplain().
+std::atomic<int> match_count(0);
+
 class TestIdentityExpectationMatcher : public NamedIdentityExpectationMatcher {
  public:
   StatusOr<bool> MatchAndExplain(const EnclaveIdentity &identity,
                                  const EnclaveIdentityExpectation &expectation,
                                  std::string *explanation) const override {
+    ++match_count;
     if (identity.identity() != expectation.match_spec()) {
       if (explanation != nullptr) {
         *explanation = kIdentityMismatchError;
@@ -360,5 +365,36 @@ TEST_F(EnclaveAuthContextTest, EvaluateAclSuccess) {
   }
 }
 
+// Verify that EvaluateAcl() results are memoized across auth contexts of the
+// same peer.
+TEST_F(EnclaveAuthContextTest, EvaluateAclMemoized) {
+  EnclaveAuthContext auth_context1;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      auth_context1,
+      EnclaveAuthContext::CreateFromAuthContext(*secure_auth_context_));
+  EnclaveAuthContext auth_context2;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      auth_context2,
+      EnclaveAuthContext::CreateFromAuthContext(*secure_auth_context_));
+
+  // Use a match spec not used by other tests, so that its result is not
+  // memoized yet.
+  IdentityAclPredicate acl;
+  EnclaveIdentityExpectation *expectation = acl.mutable_expectation();
+  *expectation->mutable_reference_identity()->mutable_description() =
+      good_identity_description_;
+  expectation->set_match_spec("EvaluateAclMemoized");
+
+  int initial_match_count = match_count;
+  for (const EnclaveAuthContext *auth_context :
+       {&auth_context1, &auth_context1, &auth_context2}) {
+    std::string explanation;
+    ASSERT_THAT(auth_context->EvaluateAcl(acl, &explanation),
+                IsOkAndHolds(false));
+    EXPECT_THAT(explanation, HasSubstr(kIdentityMismatchError));
+  }
+  EXPECT_EQ(match_count, initial_match_count + 1);
+}
+
 }  // namespace
 }  // namespace asylo
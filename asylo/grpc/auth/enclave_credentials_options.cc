@@ -17,6 +17,8 @@
  */
 #include "asylo/grpc/auth/enclave_credentials_options.h"
 
+#include <algorithm>
+
 #include "asylo/identity/identity_acl.pb.h"
 
 namespace asylo {
@@ -40,6 +42,10 @@ EnclaveCredentialsOptions &EnclaveCredentialsOptions::Add(
                          additional.self_assertions.end());
   accepted_peer_assertions.insert(additional.accepted_peer_assertions.begin(),
                                   additional.accepted_peer_assertions.end());
+  session_ticket_lifetime =
+      std::max(session_ticket_lifetime, additional.session_ticket_lifetime);
+  max_protected_frame_size =
+      std::max(max_protected_frame_size, additional.max_protected_frame_size);
   if (additional.peer_acl.has_value()) {
     if (peer_acl.has_value()) {
       peer_acl = CombineIdentityAclPredicates(peer_acl.value(),
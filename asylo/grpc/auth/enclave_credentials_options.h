@@ -19,8 +19,10 @@
 #ifndef ASYLO_GRPC_AUTH_ENCLAVE_CREDENTIALS_OPTIONS_H_
 #define ASYLO_GRPC_AUTH_ENCLAVE_CREDENTIALS_OPTIONS_H_
 
+#include <cstddef>
 #include <string>
 
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "asylo/identity/assertion_description_util.h"
 #include "asylo/identity/identity.pb.h"
@@ -53,6 +55,22 @@ struct EnclaveCredentialsOptions {
   /// authenticated peer's identities will cause gRPC channel establishment to
   /// fail.
   absl::optional<IdentityAclPredicate> peer_acl;
+
+  /// The lifetime of session tickets, which let a client reconnect to the same
+  /// server without attesting again. If positive, server credentials issue
+  /// tickets that are valid for this long, and channel credentials use the
+  /// tickets they receive for at most this long. Session resumption is
+  /// disabled if this is zero, which is the default.
+  absl::Duration session_ticket_lifetime = absl::ZeroDuration();
+
+  /// The largest record protocol frame, in bytes, that the credential holder
+  /// is willing to send and receive. Each side of a channel advertises this
+  /// size during the handshake, and the channel uses the smaller of the two.
+  /// Larger frames reduce the per-frame cost of bulk transfers. If zero, which
+  /// is the default, no size is advertised and the channel uses the record
+  /// protocol's default frame size. Non-zero values must be between 1 KiB and
+  /// 16 MiB.
+  size_t max_protected_frame_size = 0;
 };
 
 }  // namespace asylo
@@ -20,6 +20,7 @@
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include "absl/time/time.h"
 #include "asylo/grpc/auth/null_credentials_options.h"
 #include "asylo/grpc/auth/sgx_local_credentials_options.h"
 #include "asylo/identity/descriptions.h"
@@ -151,5 +152,29 @@ TEST_F(EnclaveCredentialsOptionsTest, CombineIdentityAclPredicates) {
   EXPECT_THAT(lhs.Add(rhs).peer_acl, Optional(EqualsProto(combined)));
 }
 
+TEST_F(EnclaveCredentialsOptionsTest, CombineSessionTicketLifetimes) {
+  EnclaveCredentialsOptions lhs = BidirectionalSgxLocalCredentialsOptions();
+  EXPECT_EQ(lhs.session_ticket_lifetime, absl::ZeroDuration());
+
+  EnclaveCredentialsOptions rhs = BidirectionalSgxLocalCredentialsOptions();
+  rhs.session_ticket_lifetime = absl::Hours(1);
+  EXPECT_EQ(lhs.Add(rhs).session_ticket_lifetime, absl::Hours(1));
+
+  rhs.session_ticket_lifetime = absl::Minutes(1);
+  EXPECT_EQ(lhs.Add(rhs).session_ticket_lifetime, absl::Hours(1));
+}
+
+TEST_F(EnclaveCredentialsOptionsTest, CombineMaxProtectedFrameSizes) {
+  EnclaveCredentialsOptions lhs = BidirectionalSgxLocalCredentialsOptions();
+  EXPECT_EQ(lhs.max_protected_frame_size, 0);
+
+  EnclaveCredentialsOptions rhs = BidirectionalSgxLocalCredentialsOptions();
+  rhs.max_protected_frame_size = 1 << 20;
+  EXPECT_EQ(lhs.Add(rhs).max_protected_frame_size, 1 << 20);
+
+  rhs.max_protected_frame_size = 1 << 14;
+  EXPECT_EQ(lhs.Add(rhs).max_protected_frame_size, 1 << 20);
+}
+
 }  // namespace
 }  // namespace asylo
@@ -0,0 +1,248 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Benchmarks of the enclave gRPC credentials. Each benchmark runs against a
+// server in the same process for each kind of credentials, including insecure
+// credentials as a baseline. The benchmarks are linked into a test target, so
+// they run natively, where SGX local attestation uses a fake enclave, and
+// inside an enclave in simulation mode. They are only executed when selected
+// with --benchmarks, for example:
+//
+//   bazel run //asylo/grpc/auth/test:handshake_benchmark -- --benchmarks=all
+//   bazel run //asylo/grpc/auth/test:handshake_benchmark_enclave -- \
+//       --benchmarks=BM_Handshake
+//
+// BM_Handshake reports the real time and the CPU time of the whole process per
+// handshake, and the p50 and p99 handshake latencies in microseconds. Each
+// benchmark thread acts as an independent client, so runs with more threads
+// measure concurrent handshakes against one server. BM_Rpc reports steady-state
+// unary RPC throughput over channels that have already completed a handshake.
+//
+// SGX AGE remote credentials are not covered, since they need an Assertion
+// Generator Enclave service that is not available to a self-contained test.
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "asylo/grpc/auth/enclave_channel_credentials.h"
+#include "asylo/grpc/auth/enclave_server_credentials.h"
+#include "asylo/grpc/auth/null_credentials_options.h"
+#include "asylo/grpc/auth/sgx_local_credentials_options.h"
+#include "asylo/grpc/util/grpc_server_launcher.h"
+#include "asylo/identity/enclave_assertion_authority_config.pb.h"
+#include "asylo/identity/init.h"
+#include "asylo/test/grpc/messenger_client_impl.h"
+#include "asylo/test/grpc/messenger_server_impl.h"
+#include "asylo/test/util/enclave_assertion_authority_configs.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/status.h"
+#include <benchmark/benchmark.h>
+#include "include/grpcpp/grpcpp.h"
+
+#ifndef __ASYLO__
+#include "asylo/identity/platform/sgx/internal/fake_enclave.h"
+#endif  // __ASYLO__
+
+namespace asylo {
+namespace {
+
+constexpr char kAddress[] = "[::1]";
+constexpr char kInput[] = "benchmark";
+constexpr absl::Duration kConnectTimeout = absl::Seconds(10);
+
+// The credentials used by both ends of a benchmarked connection.
+enum class CredentialsType { kInsecure, kNull, kSgxLocal };
+
+std::shared_ptr<::grpc::ChannelCredentials> CreateChannelCredentials(
+    CredentialsType type) {
+  switch (type) {
+    case CredentialsType::kNull:
+      return EnclaveChannelCredentials(BidirectionalNullCredentialsOptions());
+    case CredentialsType::kSgxLocal:
+      return EnclaveChannelCredentials(
+          BidirectionalSgxLocalCredentialsOptions());
+    case CredentialsType::kInsecure:
+    default:
+      return ::grpc::InsecureChannelCredentials();
+  }
+}
+
+std::shared_ptr<::grpc::ServerCredentials> CreateServerCredentials(
+    CredentialsType type) {
+  switch (type) {
+    case CredentialsType::kNull:
+      return EnclaveServerCredentials(BidirectionalNullCredentialsOptions());
+    case CredentialsType::kSgxLocal:
+      return EnclaveServerCredentials(
+          BidirectionalSgxLocalCredentialsOptions());
+    case CredentialsType::kInsecure:
+    default:
+      return ::grpc::InsecureServerCredentials();
+  }
+}
+
+// Initializes the null and SGX local assertion authorities, and outside of an
+// enclave also enters a fake enclave for SGX local attestation to use. Runs
+// once per process.
+void InitializeAuthorities() {
+  static const bool initialized = [] {
+#ifndef __ASYLO__
+    sgx::FakeEnclave *enclave = new sgx::FakeEnclave();
+    enclave->SetRandomIdentity();
+    sgx::FakeEnclave::EnterEnclave(*enclave);
+#endif  // __ASYLO__
+    std::vector<EnclaveAssertionAuthorityConfig> authority_configs = {
+        GetNullAssertionAuthorityTestConfig(),
+        GetSgxLocalAssertionAuthorityTestConfig()};
+    Status status = InitializeEnclaveAssertionAuthorities(
+        authority_configs.cbegin(), authority_configs.cend());
+    LOG_IF(FATAL, !status.ok())
+        << "Failed to initialize assertion authorities: " << status;
+    return true;
+  }();
+  (void)initialized;
+}
+
+// Returns the address of a server that hosts a MessengerServer1 with
+// credentials of |type|. The server is started on first use and is shared by
+// all benchmarks and threads for the rest of the process.
+const std::string &GetServerAddress(CredentialsType type) {
+  static absl::Mutex mu(absl::kConstInit);
+  static auto *addresses = new std::vector<std::string>(3);
+  absl::MutexLock lock(&mu);
+  std::string &address = (*addresses)[static_cast<int>(type)];
+  if (!address.empty()) {
+    return address;
+  }
+
+  InitializeAuthorities();
+  auto *launcher = new GrpcServerLauncher("HandshakeBenchmark");
+  int port = 0;
+  Status status = launcher->RegisterService(
+      absl::make_unique<test::MessengerServer1>());
+  if (status.ok()) {
+    status = launcher->AddListeningPort(absl::StrCat(kAddress, ":0"),
+                                        CreateServerCredentials(type), &port);
+  }
+  if (status.ok()) {
+    status = launcher->Start();
+  }
+  LOG_IF(FATAL, !status.ok()) << "Failed to start server: " << status;
+  address = absl::StrCat(kAddress, ":", port);
+  return address;
+}
+
+// Creates a channel to |address| that does not share a connection with any
+// other channel, so that connecting it always performs a new handshake.
+std::shared_ptr<::grpc::Channel> CreateUnsharedChannel(
+    const std::string &address,
+    const std::shared_ptr<::grpc::ChannelCredentials> &credentials) {
+  ::grpc::ChannelArguments args;
+  args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+  return ::grpc::CreateCustomChannel(address, credentials, args);
+}
+
+bool WaitForConnected(const std::shared_ptr<::grpc::Channel> &channel) {
+  return channel->WaitForConnected(
+      absl::ToChronoTime(absl::Now() + kConnectTimeout));
+}
+
+// Returns the |fraction| quantile of |values|, which is reordered.
+double Quantile(std::vector<double> *values, double fraction) {
+  if (values->empty()) {
+    return 0.0;
+  }
+  size_t index = std::min(values->size() - 1,
+                          static_cast<size_t>(fraction * values->size()));
+  std::nth_element(values->begin(), values->begin() + index, values->end());
+  return (*values)[index];
+}
+
+void BM_Handshake(benchmark::State &state, CredentialsType type) {
+  const std::string &address = GetServerAddress(type);
+  std::shared_ptr<::grpc::ChannelCredentials> credentials =
+      CreateChannelCredentials(type);
+  std::vector<double> latencies_us;
+  for (auto _ : state) {
+    absl::Time start = absl::Now();
+    std::shared_ptr<::grpc::Channel> channel =
+        CreateUnsharedChannel(address, credentials);
+    if (!WaitForConnected(channel)) {
+      state.SkipWithError("Channel failed to connect");
+      break;
+    }
+    latencies_us.push_back(absl::ToDoubleMicroseconds(absl::Now() - start));
+  }
+  state.counters["p50_us"] = benchmark::Counter(
+      Quantile(&latencies_us, 0.50), benchmark::Counter::kAvgThreads);
+  state.counters["p99_us"] = benchmark::Counter(
+      Quantile(&latencies_us, 0.99), benchmark::Counter::kAvgThreads);
+}
+
+void BM_Rpc(benchmark::State &state, CredentialsType type) {
+  std::shared_ptr<::grpc::Channel> channel = CreateUnsharedChannel(
+      GetServerAddress(type), CreateChannelCredentials(type));
+  if (!WaitForConnected(channel)) {
+    state.SkipWithError("Channel failed to connect");
+    return;
+  }
+  test::MessengerClient1 client(channel);
+  for (auto _ : state) {
+    StatusOr<std::string> result = client.Hello(kInput);
+    if (!result.ok()) {
+      state.SkipWithError("RPC failed");
+      break;
+    }
+  }
+  state.counters["rpcs_per_second"] = benchmark::Counter(
+      state.iterations(), benchmark::Counter::kIsRate);
+}
+
+BENCHMARK_CAPTURE(BM_Handshake, insecure, CredentialsType::kInsecure)
+    ->ThreadRange(1, 16)
+    ->UseRealTime()
+    ->MeasureProcessCPUTime();
+BENCHMARK_CAPTURE(BM_Handshake, null, CredentialsType::kNull)
+    ->ThreadRange(1, 16)
+    ->UseRealTime()
+    ->MeasureProcessCPUTime();
+BENCHMARK_CAPTURE(BM_Handshake, sgx_local, CredentialsType::kSgxLocal)
+    ->ThreadRange(1, 16)
+    ->UseRealTime()
+    ->MeasureProcessCPUTime();
+
+BENCHMARK_CAPTURE(BM_Rpc, insecure, CredentialsType::kInsecure)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_Rpc, null, CredentialsType::kNull)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_Rpc, sgx_local, CredentialsType::kSgxLocal)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace asylo
@@ -18,6 +18,9 @@
 
 #include "asylo/grpc/auth/util/multi_buffer_input_stream.h"
 
+#include <utility>
+
+#include "absl/memory/memory.h"
 #include "asylo/util/logging.h"
 
 namespace asylo {
@@ -36,8 +39,8 @@ bool MultiBufferInputStream::Next(const void **data, int *size) {
     return false;
   }
 
-  std::vector<char> *buffer = current_->get();
-  if (buffer->size() == offset_) {
+  const Buffer *buffer = current_->get();
+  if (buffer->size == offset_) {
     // Advance to the next buffer, if one exists.
     if (++current_ == buffers_.cend()) {
       // Don't let the caller back up.
@@ -48,12 +51,12 @@ bool MultiBufferInputStream::Next(const void **data, int *size) {
     offset_ = 0;
   }
 
-  *data = buffer->data() + offset_;
-  *size = buffer->size() - offset_;
+  *data = buffer->data + offset_;
+  *size = buffer->size - offset_;
 
-  last_returned_size_ = buffer->size() - offset_;
+  last_returned_size_ = buffer->size - offset_;
   bytes_read_ += last_returned_size_;
-  offset_ = buffer->size();
+  offset_ = buffer->size;
 
   return true;
 }
@@ -92,7 +95,7 @@ bool MultiBufferInputStream::Skip(int count) {
   last_returned_size_ = 0;
 
   while (count > 0) {
-    if (current_->get()->size() == offset_) {
+    if (current_->get()->size == offset_) {
       // Advance to the next buffer, if one exists.
       if (++current_ == buffers_.cend()) {
         return false;
@@ -100,7 +103,7 @@ bool MultiBufferInputStream::Skip(int count) {
       offset_ = 0;
     }
 
-    int bytes_remaining = current_->get()->size() - offset_;
+    int bytes_remaining = current_->get()->size - offset_;
     int bytes_to_skip = (count <= bytes_remaining) ? count : bytes_remaining;
 
     offset_ += bytes_to_skip;
@@ -113,16 +116,39 @@ bool MultiBufferInputStream::Skip(int count) {
 int64_t MultiBufferInputStream::ByteCount() const { return bytes_read_; }
 
 void MultiBufferInputStream::AddBuffer(const char *data, size_t size) {
-  std::vector<char> *buffer = new std::vector<char>(data, data + size);
-  buffers_.emplace_back(std::unique_ptr<std::vector<char>>(buffer));
+  auto buffer = absl::make_unique<Buffer>();
+  buffer->storage.assign(data, data + size);
+  buffer->data = buffer->storage.data();
+  buffer->size = size;
+  AddBuffer(std::move(buffer));
+}
+
+void MultiBufferInputStream::AddBorrowedBuffer(const char *data, size_t size) {
+  auto buffer = absl::make_unique<Buffer>();
+  buffer->data = data;
+  buffer->size = size;
+  AddBuffer(std::move(buffer));
+}
+
+void MultiBufferInputStream::OwnBorrowedBuffers() {
+  for (const std::unique_ptr<Buffer> &buffer : buffers_) {
+    if (buffer->storage.empty() && buffer->size > 0) {
+      buffer->storage.assign(buffer->data, buffer->data + buffer->size);
+      buffer->data = buffer->storage.data();
+    }
+  }
+}
+
+void MultiBufferInputStream::AddBuffer(std::unique_ptr<Buffer> buffer) {
+  // Update the stream size.
+  size_ += buffer->size;
+
+  buffers_.emplace_back(std::move(buffer));
 
   // Adjust the current_ pointer in case it was pointing at the end of the list.
   if (current_ == buffers_.cend()) {
     current_--;
   }
-
-  // Update the stream size.
-  size_ += size;
 }
 
 void MultiBufferInputStream::TrimFront() {
@@ -135,7 +161,7 @@ void MultiBufferInputStream::TrimFront() {
     // The entire stream has been consumed.
     offset_ = 0;
     trim_offset_ = 0;
-  } else if (current_->get()->size() == offset_) {
+  } else if (current_->get()->size == offset_) {
     // The current buffer has been entirely consumed. Remove it.
     current_++;
     buffers_.pop_front();
@@ -175,12 +201,12 @@ std::string MultiBufferInputStream::RemainingBytes() const {
   }
 
   // The first buffer may be partially consumed.
-  std::vector<char> *buffer = it->get();
-  contents.append(buffer->data() + offset_, buffer->size() - offset_);
+  const Buffer *buffer = it->get();
+  contents.append(buffer->data + offset_, buffer->size - offset_);
 
   while (++it != buffers_.cend()) {
     buffer = it->get();
-    contents.append(buffer->data(), buffer->size());
+    contents.append(buffer->data, buffer->size);
   }
   return contents;
 }
@@ -49,7 +49,9 @@ using google::protobuf::io::ZeroCopyInputStream;
 // Unlike most ZeroCopyInputStream implementations, MultiBufferInputStream's
 // constructor does not accept parameters that initialize the stream contents.
 // Instead, buffers are added to the stream via the AddBuffer() method. This is
-// the only time that data is copied.
+// the only time that data is copied. A caller that processes its data before
+// returning can avoid even that copy by lending its buffers to the stream
+// through AddBorrowedBuffer() and calling OwnBorrowedBuffers() when done.
 //
 // This class is thread-compatible.
 class MultiBufferInputStream : public ZeroCopyInputStream {
@@ -66,6 +68,17 @@ class MultiBufferInputStream : public ZeroCopyInputStream {
   // Adds a new buffer containing |size| bytes from |data| to the stream.
   void AddBuffer(const char *data, size_t size);
 
+  // Adds a buffer of |size| bytes at |data| to the stream without copying it.
+  // The caller must keep the bytes alive and unchanged until the next call to
+  // OwnBorrowedBuffers().
+  void AddBorrowedBuffer(const char *data, size_t size);
+
+  // Copies the contents of every borrowed buffer that is still part of the
+  // stream into storage owned by the stream, after which the caller may release
+  // the borrowed bytes. Buffers that were trimmed from the stream are never
+  // copied, so a caller that consumes all borrowed data copies nothing.
+  void OwnBorrowedBuffers();
+
   // Trims the first ByteCount() bytes from the front of the stream. All
   // unconsumed data in the stream is unaffected. After calling TrimFront(),
   // ByteCount() will return 0 until more data is consumed through a call to
@@ -91,7 +104,18 @@ class MultiBufferInputStream : public ZeroCopyInputStream {
   int RemainingByteCount() const;
 
  private:
-  using BufferList = std::list<std::unique_ptr<std::vector<char>>>;
+  // A buffer of the stream. Its |size| bytes at |data| are either borrowed
+  // from the caller of AddBorrowedBuffer() or held in |storage|.
+  struct Buffer {
+    const char *data;
+    int size;
+    std::vector<char> storage;
+  };
+
+  using BufferList = std::list<std::unique_ptr<Buffer>>;
+
+  // Adds |buffer| to the end of the stream.
+  void AddBuffer(std::unique_ptr<Buffer> buffer);
 
   BufferList buffers_;
 
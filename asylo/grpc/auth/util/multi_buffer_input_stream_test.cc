@@ -0,0 +1,121 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/grpc/auth/util/multi_buffer_input_stream.h"
+
+#include <algorithm>
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace asylo {
+namespace {
+
+// Reads |count| bytes from |stream| into a string.
+std::string ReadBytes(MultiBufferInputStream *stream, int count) {
+  std::string result;
+  const void *data;
+  int size;
+  while (count > 0 && stream->Next(&data, &size)) {
+    int used = std::min(size, count);
+    result.append(static_cast<const char *>(data), used);
+    stream->BackUp(size - used);
+    count -= used;
+  }
+  return result;
+}
+
+// Verify that owned and borrowed buffers are read as one contiguous stream.
+TEST(MultiBufferInputStreamTest, ReadsOwnedAndBorrowedBuffers) {
+  std::string borrowed = "def";
+  MultiBufferInputStream stream;
+  stream.AddBuffer("abc", 3);
+  stream.AddBorrowedBuffer(borrowed.data(), borrowed.size());
+  stream.AddBuffer("ghi", 3);
+
+  EXPECT_EQ(stream.RemainingByteCount(), 9);
+  EXPECT_EQ(ReadBytes(&stream, 9), "abcdefghi");
+  EXPECT_EQ(stream.RemainingByteCount(), 0);
+}
+
+// Verify that a borrowed buffer is read in place rather than copied.
+TEST(MultiBufferInputStreamTest, BorrowedBufferIsNotCopied) {
+  std::string borrowed = "abcdef";
+  MultiBufferInputStream stream;
+  stream.AddBorrowedBuffer(borrowed.data(), borrowed.size());
+
+  const void *data;
+  int size;
+  ASSERT_TRUE(stream.Next(&data, &size));
+  EXPECT_EQ(data, borrowed.data());
+  EXPECT_EQ(size, borrowed.size());
+}
+
+// Verify that OwnBorrowedBuffers() copies the unconsumed bytes of a borrowed
+// buffer, so that they survive the release of the borrowed memory.
+TEST(MultiBufferInputStreamTest, OwnBorrowedBuffersKeepsUnconsumedBytes) {
+  std::string borrowed = "abcdef";
+  MultiBufferInputStream stream;
+  stream.AddBorrowedBuffer(borrowed.data(), borrowed.size());
+
+  EXPECT_EQ(ReadBytes(&stream, 2), "ab");
+  stream.TrimFront();
+  stream.OwnBorrowedBuffers();
+  borrowed.assign(borrowed.size(), 'x');
+
+  EXPECT_EQ(stream.RemainingBytes(), "cdef");
+  EXPECT_EQ(ReadBytes(&stream, 4), "cdef");
+}
+
+// Verify that a rewound stream rereads consumed bytes from owned copies of
+// borrowed buffers.
+TEST(MultiBufferInputStreamTest, RewindAfterOwningBorrowedBuffers) {
+  std::string first = "abc";
+  std::string second = "def";
+  MultiBufferInputStream stream;
+  stream.AddBorrowedBuffer(first.data(), first.size());
+  stream.AddBorrowedBuffer(second.data(), second.size());
+
+  EXPECT_EQ(ReadBytes(&stream, 4), "abcd");
+  stream.OwnBorrowedBuffers();
+  first.clear();
+  second.clear();
+
+  stream.Rewind();
+  EXPECT_EQ(ReadBytes(&stream, 6), "abcdef");
+}
+
+// Verify that buffers trimmed from the stream are not copied by
+// OwnBorrowedBuffers().
+TEST(MultiBufferInputStreamTest, FullyConsumedBorrowedBufferIsDropped) {
+  std::string borrowed = "abc";
+  MultiBufferInputStream stream;
+  stream.AddBorrowedBuffer(borrowed.data(), borrowed.size());
+
+  EXPECT_EQ(ReadBytes(&stream, 3), "abc");
+  stream.TrimFront();
+  stream.OwnBorrowedBuffers();
+  EXPECT_EQ(stream.RemainingByteCount(), 0);
+  EXPECT_EQ(stream.RemainingBytes(), "");
+
+  stream.AddBuffer("de", 2);
+  EXPECT_EQ(ReadBytes(&stream, 2), "de");
+}
+
+}  // namespace
+}  // namespace asylo
@@ -0,0 +1,113 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <memory>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "asylo/grpc/auth/enclave_server_credentials.h"
+#include "asylo/grpc/auth/null_credentials_options.h"
+#include "asylo/grpc/benchmark/benchmark_server_config.pb.h"
+#include "asylo/grpc/benchmark/benchmark_service_impl.h"
+#include "asylo/grpc/util/grpc_server_launcher.h"
+#include "asylo/grpc/util/grpc_server_options.h"
+#include "asylo/trusted_application.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/status.h"
+#include "asylo/util/status_macros.h"
+#include "include/grpcpp/security/server_credentials.h"
+
+namespace asylo {
+namespace {
+
+// An enclave that runs a BenchmarkServiceImpl through a GrpcServerLauncher. We
+// override the methods of TrustedApplication as follows:
+//
+// * Initialize starts the gRPC server.
+// * Run retrieves the server port.
+// * Finalize shuts down the server.
+class BenchmarkServerEnclave final : public TrustedApplication {
+ public:
+  Status Initialize(const EnclaveConfig &enclave_config) override;
+
+  Status Run(const EnclaveInput &enclave_input,
+             EnclaveOutput *enclave_output) override;
+
+  Status Finalize(const EnclaveFinal &enclave_final) override;
+
+ private:
+  // The launcher of the server hosting the benchmark service.
+  std::unique_ptr<GrpcServerLauncher> launcher_;
+
+  // The server's selected port.
+  int selected_port_ = 0;
+};
+
+Status BenchmarkServerEnclave::Initialize(const EnclaveConfig &enclave_config) {
+  const BenchmarkServerConfig &config =
+      enclave_config.GetExtension(benchmark_server_config);
+  if (!config.has_server_address()) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Expected a server address in the benchmark server config");
+  }
+  if (launcher_) {
+    return Status(error::GoogleError::ALREADY_EXISTS,
+                  "Server is already started");
+  }
+
+  std::shared_ptr<::grpc::ServerCredentials> server_credentials =
+      config.enclave_credentials()
+          ? EnclaveServerCredentials(BidirectionalNullCredentialsOptions())
+          : ::grpc::InsecureServerCredentials();
+
+  launcher_ = absl::make_unique<GrpcServerLauncher>(
+      "BenchmarkServer",
+      GrpcServerOptions::ForThreadBudget(config.thread_budget()));
+  ASYLO_RETURN_IF_ERROR(
+      launcher_->RegisterService(absl::make_unique<BenchmarkServiceImpl>()));
+  ASYLO_RETURN_IF_ERROR(launcher_->AddListeningPort(
+      absl::StrCat(config.server_address(), ":", config.port()),
+      server_credentials, &selected_port_));
+  return launcher_->Start();
+}
+
+Status BenchmarkServerEnclave::Run(const EnclaveInput &enclave_input,
+                                   EnclaveOutput *enclave_output) {
+  enclave_output->SetExtension(benchmark_server_port, selected_port_);
+  return Status::OkStatus();
+}
+
+Status BenchmarkServerEnclave::Finalize(const EnclaveFinal &enclave_final) {
+  if (!launcher_) {
+    return Status::OkStatus();
+  }
+  LOG(INFO) << "Server shutting down";
+  Status status = launcher_->Shutdown();
+  launcher_.reset();
+  return status;
+}
+
+}  // namespace
+
+// Registers an instance of BenchmarkServerEnclave as the TrustedApplication.
+// See trusted_application.h for more information.
+TrustedApplication *BuildTrustedApplication() {
+  return new BenchmarkServerEnclave;
+}
+
+}  // namespace asylo
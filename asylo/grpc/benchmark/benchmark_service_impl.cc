@@ -0,0 +1,62 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/grpc/benchmark/benchmark_service_impl.h"
+
+#include <string>
+
+namespace asylo {
+namespace {
+
+// Fills the payload of |response| with the number of bytes |request| asks for.
+::grpc::Status FillResponse(const BenchmarkRequest &request,
+                            BenchmarkResponse *response) {
+  if (request.response_size() < 0) {
+    return ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT,
+                          "Negative response size");
+  }
+  response->mutable_payload()->assign(request.response_size(), '\0');
+  return ::grpc::Status::OK;
+}
+
+}  // namespace
+
+::grpc::Status BenchmarkServiceImpl::UnaryCall(::grpc::ServerContext *context,
+                                               const BenchmarkRequest *request,
+                                               BenchmarkResponse *response) {
+  return FillResponse(*request, response);
+}
+
+::grpc::Status BenchmarkServiceImpl::StreamingCall(
+    ::grpc::ServerContext *context,
+    ::grpc::ServerReaderWriter<BenchmarkResponse, BenchmarkRequest> *stream) {
+  BenchmarkRequest request;
+  BenchmarkResponse response;
+  while (stream->Read(&request)) {
+    ::grpc::Status status = FillResponse(request, &response);
+    if (!status.ok()) {
+      return status;
+    }
+    if (!stream->Write(response)) {
+      break;
+    }
+  }
+  return ::grpc::Status::OK;
+}
+
+}  // namespace asylo
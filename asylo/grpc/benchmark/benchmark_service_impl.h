@@ -0,0 +1,44 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_GRPC_BENCHMARK_BENCHMARK_SERVICE_IMPL_H_
+#define ASYLO_GRPC_BENCHMARK_BENCHMARK_SERVICE_IMPL_H_
+
+#include "asylo/grpc/benchmark/benchmark_service.grpc.pb.h"
+#include "include/grpcpp/grpcpp.h"
+
+namespace asylo {
+
+// A BenchmarkService that answers each request with a response of the size it
+// asks for, without doing any other work, so that benchmarks against it
+// measure the cost of the RPCs themselves.
+class BenchmarkServiceImpl final : public BenchmarkService::Service {
+ private:
+  ::grpc::Status UnaryCall(::grpc::ServerContext *context,
+                           const BenchmarkRequest *request,
+                           BenchmarkResponse *response) override;
+
+  ::grpc::Status StreamingCall(
+      ::grpc::ServerContext *context,
+      ::grpc::ServerReaderWriter<BenchmarkResponse, BenchmarkRequest> *stream)
+      override;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_GRPC_BENCHMARK_BENCHMARK_SERVICE_IMPL_H_
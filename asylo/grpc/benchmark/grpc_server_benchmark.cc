@@ -0,0 +1,351 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Benchmarks of RPCs against a gRPC server running inside an enclave. The
+// server is launched with GrpcServerLauncher in a benchmark server enclave,
+// once with insecure credentials and once with enclave credentials using null
+// assertions, which run the EKEP handshake. Clients run in the host process,
+// one channel per benchmark thread, so runs with more threads measure
+// concurrent clients. The benchmarks only run when selected with --benchmarks,
+// for example:
+//
+//   bazel run //asylo/grpc/benchmark:grpc_server_benchmark_sgx_sim -- \
+//       --benchmarks=BM_Unary/.*/1024
+//
+// Each benchmark is run with 0 B to 256 KiB of payload in both directions,
+// as unary RPCs and as a ping-pong over a bidirectional stream. Besides the
+// real and process CPU time per RPC, each reports the following counters:
+//
+//   * qps: RPCs completed per second, over all threads.
+//   * p50_us, p99_us, p999_us: RPC latency percentiles, in microseconds.
+//   * cpu_us_per_rpc: CPU time of the whole process per RPC, in microseconds.
+//     This includes the clients, which run outside of the enclave.
+//   * exits_per_rpc: Enclave exits made by the server per RPC.
+
+#include <time.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "asylo/client.h"
+#include "asylo/enclave.pb.h"
+#include "asylo/grpc/auth/enclave_channel_credentials.h"
+#include "asylo/grpc/auth/null_credentials_options.h"
+#include "asylo/grpc/benchmark/benchmark_server_config.pb.h"
+#include "asylo/grpc/benchmark/benchmark_service.grpc.pb.h"
+#include "asylo/identity/enclave_assertion_authority_config.pb.h"
+#include "asylo/identity/enclave_assertion_authority_configs.h"
+#include "asylo/identity/init.h"
+#include "asylo/platform/core/generic_enclave_client.h"
+#include "asylo/platform/primitives/sgx/loader.pb.h"
+#include "asylo/platform/primitives/untrusted_primitives.h"
+#include "asylo/platform/primitives/util/exit_log.h"
+#include "asylo/platform/primitives/util/exit_metrics.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/status.h"
+#include <benchmark/benchmark.h>
+#include "include/grpcpp/grpcpp.h"
+
+ABSL_FLAG(std::string, server_enclave_path, "",
+          "The path to the benchmark server enclave");
+
+ABSL_FLAG(int32_t, server_thread_budget, 0,
+          "The number of threads the server may use, or 0 for the default "
+          "gRPC threading options");
+
+namespace asylo {
+namespace {
+
+constexpr char kAddress[] = "[::1]";
+constexpr absl::Duration kConnectTimeout = absl::Seconds(10);
+
+// The credentials used by both ends of a benchmarked connection.
+enum class CredentialsType { kInsecure, kEkep };
+
+std::shared_ptr<::grpc::ChannelCredentials> CreateChannelCredentials(
+    CredentialsType type) {
+  switch (type) {
+    case CredentialsType::kEkep:
+      return EnclaveChannelCredentials(BidirectionalNullCredentialsOptions());
+    case CredentialsType::kInsecure:
+    default:
+      return ::grpc::InsecureChannelCredentials();
+  }
+}
+
+// A benchmark server enclave and the address of its server.
+struct Server {
+  EnclaveClient *client;
+  std::string address;
+};
+
+// Returns the benchmark server running with credentials of |type|. The server
+// enclave is loaded on first use and is shared by all benchmarks and threads
+// for the rest of the process.
+const Server &GetServer(CredentialsType type) {
+  static absl::Mutex mu(absl::kConstInit);
+  static auto *servers = new std::vector<Server>(2);
+  absl::MutexLock lock(&mu);
+  Server &server = (*servers)[static_cast<int>(type)];
+  if (server.client) {
+    return server;
+  }
+
+  static const bool initialized = [] {
+    LOG_IF(FATAL, !EnclaveManager::Configure(EnclaveManagerOptions()).ok())
+        << "Failed to configure EnclaveManager";
+    std::vector<EnclaveAssertionAuthorityConfig> authority_configs = {
+        CreateNullAssertionAuthorityConfig()};
+    Status status = InitializeEnclaveAssertionAuthorities(
+        authority_configs.cbegin(), authority_configs.cend());
+    LOG_IF(FATAL, !status.ok())
+        << "Failed to initialize assertion authorities: " << status;
+    return true;
+  }();
+  (void)initialized;
+
+  const std::string name = type == CredentialsType::kEkep
+                               ? "benchmark_server_ekep"
+                               : "benchmark_server_insecure";
+  EnclaveLoadConfig load_config;
+  load_config.set_name(name);
+  load_config.set_exit_metrics(true);
+  EnclaveConfig *config = load_config.mutable_config();
+  *config->add_enclave_assertion_authority_configs() =
+      CreateNullAssertionAuthorityConfig();
+  BenchmarkServerConfig *server_config =
+      config->MutableExtension(benchmark_server_config);
+  server_config->set_server_address(kAddress);
+  server_config->set_port(0);
+  server_config->set_enclave_credentials(type == CredentialsType::kEkep);
+  server_config->set_thread_budget(absl::GetFlag(FLAGS_server_thread_budget));
+  SgxLoadConfig *sgx_config = load_config.MutableExtension(sgx_load_config);
+  sgx_config->mutable_file_enclave_config()->set_enclave_path(
+      absl::GetFlag(FLAGS_server_enclave_path));
+  sgx_config->set_debug(true);
+
+  EnclaveManager *manager = EnclaveManager::Instance().ValueOrDie();
+  Status status = manager->LoadEnclave(load_config);
+  LOG_IF(FATAL, !status.ok()) << "Failed to load " << name << ": " << status;
+  EnclaveClient *client = manager->GetClient(name);
+  EnclaveOutput output;
+  status = client->EnterAndRun(EnclaveInput(), &output);
+  LOG_IF(FATAL, !status.ok() || !output.HasExtension(benchmark_server_port))
+      << "Failed to get the port of " << name << ": " << status;
+
+  server.client = client;
+  server.address = absl::StrCat(kAddress, ":",
+                                output.GetExtension(benchmark_server_port));
+  return server;
+}
+
+// Returns the number of exit calls made by the enclave of |client| so far.
+uint64_t CountExits(EnclaveClient *client) {
+  auto dispatch_table = dynamic_cast<primitives::LoggingDispatchTable *>(
+      dynamic_cast<GenericEnclaveClient *>(client)
+          ->GetPrimitiveClient()
+          ->exit_call_provider());
+  uint64_t count = 0;
+  for (const auto &stats : dispatch_table->metrics()->Snapshot()) {
+    count += stats.count;
+  }
+  return count;
+}
+
+// Returns the CPU time used by the whole process so far.
+absl::Duration ProcessCpuTime() {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return absl::DurationFromTimespec(ts);
+}
+
+// Creates a connected channel to |server| that does not share a connection
+// with any other channel. Returns nullptr if the channel fails to connect.
+std::shared_ptr<::grpc::Channel> Connect(const Server &server,
+                                         CredentialsType type) {
+  ::grpc::ChannelArguments args;
+  args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+  std::shared_ptr<::grpc::Channel> channel = ::grpc::CreateCustomChannel(
+      server.address, CreateChannelCredentials(type), args);
+  if (!channel->WaitForConnected(
+          absl::ToChronoTime(absl::Now() + kConnectTimeout))) {
+    return nullptr;
+  }
+  return channel;
+}
+
+// Returns the |fraction| quantile of |values|, which is reordered.
+double Quantile(std::vector<double> *values, double fraction) {
+  if (values->empty()) {
+    return 0.0;
+  }
+  size_t index = std::min(values->size() - 1,
+                          static_cast<size_t>(fraction * values->size()));
+  std::nth_element(values->begin(), values->begin() + index, values->end());
+  return (*values)[index];
+}
+
+// Measures the RPCs of one benchmark thread. Thread 0 also samples the exits
+// of the server enclave and the CPU time of the process from the first RPC of
+// the benchmark, once every thread has connected, to the end of the benchmark.
+class RpcRecorder {
+ public:
+  RpcRecorder(benchmark::State *state, const Server &server)
+      : state_(state), server_(server) {}
+
+  // Records the start of an RPC.
+  void Start() {
+    if (state_->thread_index == 0 && !started_) {
+      exits_at_start_ = CountExits(server_.client);
+      cpu_at_start_ = ProcessCpuTime();
+    }
+    started_ = true;
+    rpc_start_ = absl::Now();
+  }
+
+  // Records the end of the RPC started last.
+  void Stop() {
+    latencies_us_.push_back(
+        absl::ToDoubleMicroseconds(absl::Now() - rpc_start_));
+  }
+
+  // Sets the counters of the benchmark once its loop has finished.
+  void Report() {
+    benchmark::State &state = *state_;
+    state.counters["qps"] =
+        benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+    state.counters["p50_us"] = benchmark::Counter(
+        Quantile(&latencies_us_, 0.50), benchmark::Counter::kAvgThreads);
+    state.counters["p99_us"] = benchmark::Counter(
+        Quantile(&latencies_us_, 0.99), benchmark::Counter::kAvgThreads);
+    state.counters["p999_us"] = benchmark::Counter(
+        Quantile(&latencies_us_, 0.999), benchmark::Counter::kAvgThreads);
+    if (state.thread_index == 0 && started_) {
+      double rpcs = static_cast<double>(state.iterations()) * state.threads;
+      state.counters["cpu_us_per_rpc"] = absl::ToDoubleMicroseconds(
+          (ProcessCpuTime() - cpu_at_start_) / rpcs);
+      state.counters["exits_per_rpc"] =
+          (CountExits(server_.client) - exits_at_start_) / rpcs;
+    }
+  }
+
+ private:
+  benchmark::State *state_;
+  const Server &server_;
+  bool started_ = false;
+  uint64_t exits_at_start_ = 0;
+  absl::Duration cpu_at_start_;
+  absl::Time rpc_start_;
+  std::vector<double> latencies_us_;
+};
+
+// Creates a request carrying |size| bytes and asking for as many in return.
+BenchmarkRequest CreateRequest(int64_t size) {
+  BenchmarkRequest request;
+  request.mutable_payload()->assign(size, '\0');
+  request.set_response_size(size);
+  return request;
+}
+
+void BM_Unary(benchmark::State &state, CredentialsType type) {
+  const Server &server = GetServer(type);
+  std::shared_ptr<::grpc::Channel> channel = Connect(server, type);
+  if (!channel) {
+    state.SkipWithError("Channel failed to connect");
+    return;
+  }
+  std::unique_ptr<BenchmarkService::Stub> stub =
+      BenchmarkService::NewStub(channel);
+  const BenchmarkRequest request = CreateRequest(state.range(0));
+  BenchmarkResponse response;
+  RpcRecorder recorder(&state, server);
+  for (auto _ : state) {
+    ::grpc::ClientContext context;
+    recorder.Start();
+    ::grpc::Status status = stub->UnaryCall(&context, request, &response);
+    recorder.Stop();
+    if (!status.ok()) {
+      state.SkipWithError("RPC failed");
+      break;
+    }
+  }
+  recorder.Report();
+}
+
+void BM_Streaming(benchmark::State &state, CredentialsType type) {
+  const Server &server = GetServer(type);
+  std::shared_ptr<::grpc::Channel> channel = Connect(server, type);
+  if (!channel) {
+    state.SkipWithError("Channel failed to connect");
+    return;
+  }
+  std::unique_ptr<BenchmarkService::Stub> stub =
+      BenchmarkService::NewStub(channel);
+  ::grpc::ClientContext context;
+  std::unique_ptr<
+      ::grpc::ClientReaderWriter<BenchmarkRequest, BenchmarkResponse>>
+      stream = stub->StreamingCall(&context);
+  const BenchmarkRequest request = CreateRequest(state.range(0));
+  BenchmarkResponse response;
+  RpcRecorder recorder(&state, server);
+  for (auto _ : state) {
+    recorder.Start();
+    bool ok = stream->Write(request) && stream->Read(&response);
+    recorder.Stop();
+    if (!ok) {
+      state.SkipWithError("Stream failed");
+      break;
+    }
+  }
+  stream->WritesDone();
+  ::grpc::Status status = stream->Finish();
+  LOG_IF(ERROR, !status.ok())
+      << "Stream finished with an error: " << status.error_message();
+  recorder.Report();
+}
+
+// Runs |benchmark| with every payload size on 1 to 16 client threads.
+void ApplyBenchmarkArguments(benchmark::internal::Benchmark *benchmark) {
+  benchmark->Arg(0)
+      ->Arg(1 << 10)
+      ->Arg(16 << 10)
+      ->Arg(256 << 10)
+      ->ThreadRange(1, 16)
+      ->UseRealTime()
+      ->MeasureProcessCPUTime();
+}
+
+BENCHMARK_CAPTURE(BM_Unary, insecure, CredentialsType::kInsecure)
+    ->Apply(ApplyBenchmarkArguments);
+BENCHMARK_CAPTURE(BM_Unary, ekep, CredentialsType::kEkep)
+    ->Apply(ApplyBenchmarkArguments);
+BENCHMARK_CAPTURE(BM_Streaming, insecure, CredentialsType::kInsecure)
+    ->Apply(ApplyBenchmarkArguments);
+BENCHMARK_CAPTURE(BM_Streaming, ekep, CredentialsType::kEkep)
+    ->Apply(ApplyBenchmarkArguments);
+
+}  // namespace
+}  // namespace asylo
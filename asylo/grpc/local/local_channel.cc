@@ -0,0 +1,499 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/grpc/local/local_channel.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "asylo/grpc/auth/core/client_ekep_handshaker.h"
+#include "asylo/grpc/auth/core/ekep_handshaker.h"
+#include "asylo/grpc/auth/core/ekep_handshaker_util.h"
+#include "asylo/grpc/auth/core/handshake.pb.h"
+#include "asylo/grpc/auth/core/server_ekep_handshaker.h"
+#include "asylo/grpc/local/local_channel_platform.h"
+#include "asylo/identity/delegating_identity_expectation_matcher.h"
+#include "asylo/identity/identity_acl_evaluator.h"
+#include "asylo/util/cleansing_types.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace {
+
+// Size of the header of a record, which holds the size of the sealed record
+// that follows it.
+constexpr size_t kRecordHeaderSize = 4;
+
+// Size of the size prefix of an EKEP frame.
+constexpr size_t kFrameSizePrefixSize = 4;
+
+// Number of times Wait() polls the doorbell before going to sleep.
+constexpr int kSpinIterations = 4096;
+
+// Longest sleep of a thread waiting for the handshake, so that it notices the
+// deadline.
+constexpr absl::Duration kHandshakePollInterval = absl::Milliseconds(10);
+
+void StoreLittleEndian32(uint32_t value, uint8_t *bytes) {
+  for (int i = 0; i < 4; i++) {
+    bytes[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+uint32_t LoadLittleEndian32(const uint8_t *bytes) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; i++) {
+    value |= static_cast<uint32_t>(bytes[i]) << (8 * i);
+  }
+  return value;
+}
+
+// Returns a status for a peer that closed the channel before the handshake
+// completed.
+Status PeerClosedDuringHandshake() {
+  return Status(error::GoogleError::UNAVAILABLE,
+                "Peer closed the local channel during the handshake");
+}
+
+Status HandshakeDeadlineExceeded() {
+  return Status(error::GoogleError::DEADLINE_EXCEEDED,
+                "Local channel handshake timed out");
+}
+
+}  // namespace
+
+StatusOr<std::unique_ptr<LocalChannel>> LocalChannel::Connect(
+    void *region, size_t ring_capacity, LocalChannelSide side,
+    const EnclaveCredentialsOptions &options, absl::Duration timeout) {
+  if (!LocalChannelRegion::IsValidRingCapacity(ring_capacity)) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  absl::StrCat("Invalid local channel ring capacity: ",
+                               ring_capacity));
+  }
+  if (!internal::IsValidLocalChannelMemory(
+          region, LocalChannelRegion::Size(ring_capacity))) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Local channel region must be in untrusted memory");
+  }
+  auto *channel_region = reinterpret_cast<LocalChannelRegion *>(region);
+  if (channel_region->magic.load(std::memory_order_acquire) !=
+      LocalChannelRegion::kMagic) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Local channel region is not initialized");
+  }
+
+  std::unique_ptr<LocalChannel> channel = absl::WrapUnique(
+      new LocalChannel(channel_region, ring_capacity, side));
+  ASYLO_RETURN_IF_ERROR(channel->Handshake(options, timeout));
+  return std::move(channel);
+}
+
+LocalChannel::LocalChannel(LocalChannelRegion *region, size_t ring_capacity,
+                           LocalChannelSide side)
+    : region_(region), ring_capacity_(ring_capacity), side_(side) {
+  LocalChannelSide peer = PeerOf(side);
+  out_.ring = region_->ring(side);
+  out_.data = region_->ring_data(side, ring_capacity);
+  out_.index = out_.ring->tail.load(std::memory_order_relaxed);
+  in_.ring = region_->ring(peer);
+  in_.data = region_->ring_data(peer, ring_capacity);
+  in_.index = in_.ring->head.load(std::memory_order_relaxed);
+}
+
+LocalChannel::~LocalChannel() { Close(); }
+
+Status LocalChannel::Handshake(const EnclaveCredentialsOptions &options,
+                               absl::Duration timeout) {
+  EkepHandshakerOptions handshaker_options;
+  handshaker_options.self_assertions = {options.self_assertions.cbegin(),
+                                        options.self_assertions.cend()};
+  handshaker_options.accepted_peer_assertions = {
+      options.accepted_peer_assertions.cbegin(),
+      options.accepted_peer_assertions.cend()};
+  handshaker_options.additional_authenticated_data =
+      options.additional_authenticated_data;
+  handshaker_options.max_protected_frame_size =
+      options.max_protected_frame_size;
+  ASYLO_RETURN_IF_ERROR(handshaker_options.Validate());
+
+  bool is_client = side_ == LocalChannelSide::kInitiator;
+  std::unique_ptr<EkepHandshaker> handshaker =
+      is_client ? ClientEkepHandshaker::Create(handshaker_options)
+                : ServerEkepHandshaker::Create(handshaker_options);
+  if (!handshaker) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Failed to create EKEP handshaker");
+  }
+
+  absl::Time deadline = absl::Now() + timeout;
+  std::string outgoing;
+  EkepHandshaker::Result result = EkepHandshaker::Result::NOT_ENOUGH_DATA;
+  if (is_client) {
+    result = handshaker->NextHandshakeStep(nullptr, 0, &outgoing);
+  }
+
+  // The peer starts sending records as soon as its side of the handshake
+  // completes, so the handshake reads frames by their size prefix and never
+  // consumes bytes past the last frame.
+  uint8_t frame_prefix[kFrameSizePrefixSize];
+  size_t frame_prefix_size = 0;
+  size_t frame_remaining = 0;
+  std::vector<uint8_t> incoming;
+  while (true) {
+    size_t written = 0;
+    while (written < outgoing.size()) {
+      int32_t token = WaitToken();
+      if (PeerClosed()) {
+        return PeerClosedDuringHandshake();
+      }
+      size_t size = std::min(WritableBytes(), outgoing.size() - written);
+      if (size == 0) {
+        if (absl::Now() >= deadline) {
+          return HandshakeDeadlineExceeded();
+        }
+        Wait(token, std::min(deadline - absl::Now(), kHandshakePollInterval));
+        continue;
+      }
+      CopyToRing(reinterpret_cast<const uint8_t *>(outgoing.data()) + written,
+                 size);
+      PublishWrite();
+      written += size;
+    }
+    outgoing.clear();
+
+    if (result == EkepHandshaker::Result::COMPLETED) {
+      break;
+    }
+    if (result == EkepHandshaker::Result::ABORTED) {
+      return Status(error::GoogleError::UNAUTHENTICATED,
+                    "Local channel handshake aborted");
+    }
+
+    int32_t token = WaitToken();
+    size_t readable = ReadableBytes();
+    incoming.clear();
+    if (frame_prefix_size < kFrameSizePrefixSize) {
+      size_t size =
+          std::min(readable, kFrameSizePrefixSize - frame_prefix_size);
+      CopyFromRing(0, frame_prefix + frame_prefix_size, size);
+      frame_prefix_size += size;
+      incoming.assign(frame_prefix + frame_prefix_size - size,
+                      frame_prefix + frame_prefix_size);
+      if (frame_prefix_size == kFrameSizePrefixSize) {
+        frame_remaining = LoadLittleEndian32(frame_prefix);
+      }
+    }
+    if (frame_prefix_size == kFrameSizePrefixSize) {
+      size_t size = std::min(readable - incoming.size(), frame_remaining);
+      size_t offset = incoming.size();
+      incoming.resize(offset + size);
+      CopyFromRing(offset, incoming.data() + offset, size);
+      frame_remaining -= size;
+      if (frame_remaining == 0) {
+        frame_prefix_size = 0;
+      }
+    }
+    if (incoming.empty()) {
+      if (PeerClosed() && ReadableBytes() == 0) {
+        return PeerClosedDuringHandshake();
+      }
+      if (absl::Now() >= deadline) {
+        return HandshakeDeadlineExceeded();
+      }
+      Wait(token, std::min(deadline - absl::Now(), kHandshakePollInterval));
+      continue;
+    }
+    ConsumeRead(incoming.size());
+    result = handshaker->NextHandshakeStep(
+        reinterpret_cast<const char *>(incoming.data()), incoming.size(),
+        &outgoing);
+  }
+
+  RecordProtocol record_protocol;
+  ASYLO_ASSIGN_OR_RETURN(record_protocol, handshaker->GetRecordProtocol());
+  if (record_protocol != ALTSRP_AES128_GCM) {
+    return Status(error::GoogleError::UNIMPLEMENTED,
+                  absl::StrCat("Unsupported record protocol: ",
+                               RecordProtocol_Name(record_protocol)));
+  }
+  CleansingVector<uint8_t> key;
+  ASYLO_ASSIGN_OR_RETURN(key, handshaker->GetRecordProtocolKey());
+  ASYLO_ASSIGN_OR_RETURN(key_, AeadKey::CreateAesGcmKey(key));
+
+  std::unique_ptr<EnclaveIdentities> identities;
+  ASYLO_ASSIGN_OR_RETURN(identities, handshaker->GetPeerIdentities());
+  peer_identities_ = std::move(*identities);
+  if (options.peer_acl.has_value()) {
+    DelegatingIdentityExpectationMatcher matcher;
+    std::string explanation;
+    bool matched;
+    ASYLO_ASSIGN_OR_RETURN(
+        matched,
+        EvaluateIdentityAcl({peer_identities_.identities().begin(),
+                             peer_identities_.identities().end()},
+                            options.peer_acl.value(), matcher, &explanation));
+    if (!matched) {
+      return Status(error::GoogleError::PERMISSION_DENIED,
+                    absl::StrCat("Peer identities did not match the ACL: ",
+                                 explanation));
+    }
+  }
+
+  // A record and its header must fit into half of a ring, so that a writer
+  // does not wait for the reader to drain the ring completely.
+  size_t overhead = kRecordHeaderSize + key_->MaxSealOverhead();
+  size_t frame_size;
+  ASYLO_ASSIGN_OR_RETURN(frame_size, handshaker->GetMaxProtectedFrameSize());
+  max_record_size_ = frame_size == 0 ? kDefaultMaxRecordSize
+                                     : std::min(kDefaultMaxRecordSize,
+                                                frame_size - overhead);
+  max_record_size_ = std::min(max_record_size_, ring_capacity_ / 2 - overhead);
+  seal_buffer_.resize(max_record_size_ + overhead);
+  return Status::OkStatus();
+}
+
+Status LocalChannel::Write(ByteContainerView data) {
+  while (!data.empty()) {
+    int32_t token = WaitToken();
+    size_t written;
+    ASYLO_ASSIGN_OR_RETURN(written, TryWrite(data));
+    if (written == 0) {
+      Wait(token, absl::InfiniteDuration());
+      continue;
+    }
+    data = ByteContainerView(data.data() + written, data.size() - written);
+  }
+  return Status::OkStatus();
+}
+
+StatusOr<size_t> LocalChannel::Read(absl::Span<uint8_t> buffer) {
+  while (read_buffer_offset_ == read_buffer_.size()) {
+    read_buffer_.clear();
+    read_buffer_offset_ = 0;
+    int32_t token = WaitToken();
+    size_t read;
+    ASYLO_ASSIGN_OR_RETURN(read, TryRead(&read_buffer_, buffer.size()));
+    if (read == 0) {
+      Wait(token, absl::InfiniteDuration());
+    }
+  }
+  size_t size =
+      std::min(buffer.size(), read_buffer_.size() - read_buffer_offset_);
+  memcpy(buffer.data(), read_buffer_.data() + read_buffer_offset_, size);
+  read_buffer_offset_ += size;
+  return size;
+}
+
+StatusOr<size_t> LocalChannel::TryWrite(ByteContainerView data) {
+  if (closed_) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Local channel is closed");
+  }
+  if (PeerClosed()) {
+    return Status(error::GoogleError::UNAVAILABLE,
+                  "Peer closed the local channel");
+  }
+  size_t overhead = key_->MaxSealOverhead();
+  size_t written = 0;
+  while (written < data.size()) {
+    size_t plaintext_size = std::min(data.size() - written, max_record_size_);
+    size_t record_size = kRecordHeaderSize + plaintext_size + overhead;
+    if (WritableBytes() < record_size) {
+      break;
+    }
+    StoreLittleEndian32(static_cast<uint32_t>(plaintext_size + overhead),
+                        seal_buffer_.data());
+    size_t ciphertext_size;
+    ASYLO_RETURN_IF_ERROR(key_->Seal(
+        ByteContainerView(data.data() + written, plaintext_size),
+        ByteContainerView(seal_buffer_.data(), kRecordHeaderSize),
+        RecordNonce(side_, write_sequence_),
+        absl::MakeSpan(seal_buffer_.data() + kRecordHeaderSize,
+                       plaintext_size + overhead),
+        &ciphertext_size));
+    if (ciphertext_size != plaintext_size + overhead) {
+      return Status(error::GoogleError::INTERNAL,
+                    "Unexpected size of a sealed record");
+    }
+    CopyToRing(seal_buffer_.data(), record_size);
+    write_sequence_++;
+    written += plaintext_size;
+  }
+  if (written > 0) {
+    PublishWrite();
+  }
+  return written;
+}
+
+StatusOr<size_t> LocalChannel::TryRead(std::vector<uint8_t> *plaintext,
+                                       size_t max_size) {
+  // Check for the end of the stream before looking for records, so that no
+  // record published before the peer closed the channel is missed.
+  bool peer_closed = PeerClosed();
+  size_t overhead = key_->MaxSealOverhead();
+  size_t consumed = 0;
+  size_t appended = 0;
+  while (appended < max_size) {
+    size_t readable = ReadableBytes() - consumed;
+    if (readable < kRecordHeaderSize) {
+      break;
+    }
+    uint8_t header[kRecordHeaderSize];
+    CopyFromRing(consumed, header, kRecordHeaderSize);
+    size_t ciphertext_size = LoadLittleEndian32(header);
+    if (ciphertext_size < overhead ||
+        ciphertext_size > max_record_size_ + overhead) {
+      return Status(error::GoogleError::DATA_LOSS,
+                    "Invalid local channel record size");
+    }
+    if (readable < kRecordHeaderSize + ciphertext_size) {
+      break;
+    }
+    open_buffer_.resize(ciphertext_size);
+    CopyFromRing(consumed + kRecordHeaderSize, open_buffer_.data(),
+                 ciphertext_size);
+    size_t plaintext_size;
+    if (!key_->OpenInPlace(absl::MakeSpan(open_buffer_),
+                           ByteContainerView(header, kRecordHeaderSize),
+                           RecordNonce(PeerOf(side_), read_sequence_),
+                           &plaintext_size)
+             .ok()) {
+      return Status(error::GoogleError::DATA_LOSS,
+                    "Failed to open local channel record");
+    }
+    plaintext->insert(plaintext->end(), open_buffer_.begin(),
+                      open_buffer_.begin() + plaintext_size);
+    read_sequence_++;
+    consumed += kRecordHeaderSize + ciphertext_size;
+    appended += plaintext_size;
+  }
+  if (consumed > 0) {
+    ConsumeRead(consumed);
+  } else if (peer_closed && ReadableBytes() == 0) {
+    return Status(error::GoogleError::OUT_OF_RANGE,
+                  "Peer closed the local channel");
+  }
+  return appended;
+}
+
+int32_t LocalChannel::WaitToken() const {
+  return region_->doorbell(side_)->sequence.load(std::memory_order_seq_cst);
+}
+
+void LocalChannel::Wait(int32_t token, absl::Duration timeout) {
+  LocalChannelRegion::Doorbell *doorbell = region_->doorbell(side_);
+  for (int i = 0; i < kSpinIterations; i++) {
+    if (doorbell->sequence.load(std::memory_order_acquire) != token) {
+      return;
+    }
+    __builtin_ia32_pause();
+  }
+  if (timeout <= absl::ZeroDuration()) {
+    return;
+  }
+  // A zero futex timeout waits indefinitely.
+  int64_t timeout_us = 0;
+  if (timeout != absl::InfiniteDuration()) {
+    timeout_us = std::max<int64_t>(1, absl::ToInt64Microseconds(timeout));
+  }
+  doorbell->waiters.fetch_add(1, std::memory_order_seq_cst);
+  if (doorbell->sequence.load(std::memory_order_seq_cst) == token) {
+    internal::LocalChannelWait(
+        reinterpret_cast<int32_t *>(&doorbell->sequence), token, timeout_us);
+  }
+  doorbell->waiters.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void LocalChannel::Interrupt() { Ring(side_); }
+
+void LocalChannel::Close() {
+  if (closed_) {
+    return;
+  }
+  closed_ = true;
+  region_->closed_flag(side_)->store(1, std::memory_order_release);
+  Ring(PeerOf(side_));
+}
+
+size_t LocalChannel::WritableBytes() const {
+  uint64_t used = out_.index - out_.ring->head.load(std::memory_order_acquire);
+  return used > ring_capacity_ ? 0 : ring_capacity_ - used;
+}
+
+size_t LocalChannel::ReadableBytes() const {
+  uint64_t available =
+      in_.ring->tail.load(std::memory_order_acquire) - in_.index;
+  return std::min<uint64_t>(available, ring_capacity_);
+}
+
+void LocalChannel::CopyToRing(const uint8_t *data, size_t size) {
+  size_t position = out_.index & (ring_capacity_ - 1);
+  size_t first = std::min(size, ring_capacity_ - position);
+  memcpy(out_.data + position, data, first);
+  memcpy(out_.data, data + first, size - first);
+  out_.index += size;
+}
+
+void LocalChannel::CopyFromRing(size_t offset, uint8_t *data,
+                                size_t size) const {
+  size_t position = (in_.index + offset) & (ring_capacity_ - 1);
+  size_t first = std::min(size, ring_capacity_ - position);
+  memcpy(data, in_.data + position, first);
+  memcpy(data + first, in_.data, size - first);
+}
+
+void LocalChannel::PublishWrite() {
+  out_.ring->tail.store(out_.index, std::memory_order_release);
+  Ring(PeerOf(side_));
+}
+
+void LocalChannel::ConsumeRead(size_t size) {
+  in_.index += size;
+  in_.ring->head.store(in_.index, std::memory_order_release);
+  Ring(PeerOf(side_));
+}
+
+void LocalChannel::Ring(LocalChannelSide side) {
+  LocalChannelRegion::Doorbell *doorbell = region_->doorbell(side);
+  doorbell->sequence.fetch_add(1, std::memory_order_seq_cst);
+  if (doorbell->waiters.load(std::memory_order_seq_cst) != 0) {
+    internal::LocalChannelWake(
+        reinterpret_cast<int32_t *>(&doorbell->sequence));
+  }
+}
+
+std::vector<uint8_t> LocalChannel::RecordNonce(LocalChannelSide writer,
+                                               uint64_t sequence) const {
+  std::vector<uint8_t> nonce(key_->NonceSize(), 0);
+  for (int i = 0; i < 8; i++) {
+    nonce[i] = static_cast<uint8_t>(sequence >> (8 * i));
+  }
+  nonce[8] = static_cast<uint8_t>(writer);
+  return nonce;
+}
+
+bool LocalChannel::PeerClosed() const {
+  return region_->closed_flag(PeerOf(side_))->load(std::memory_order_acquire) !=
+         0;
+}
+
+}  // namespace asylo
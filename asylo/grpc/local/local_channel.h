@@ -0,0 +1,190 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_GRPC_LOCAL_LOCAL_CHANNEL_H_
+#define ASYLO_GRPC_LOCAL_LOCAL_CHANNEL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "asylo/crypto/aead_key.h"
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/grpc/auth/enclave_credentials_options.h"
+#include "asylo/grpc/local/local_channel_region.h"
+#include "asylo/identity/identity.pb.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+
+// A secure byte stream between two enclaves on the same host, carried over a
+// LocalChannelRegion in untrusted shared memory instead of a socket. Moving a
+// record through the channel costs a copy on each end, and no host call unless
+// the receiving end is asleep.
+//
+// Each end authenticates with an EKEP handshake run over the rings, configured
+// by the same EnclaveCredentialsOptions as enclave gRPC credentials, typically
+// BidirectionalSgxLocalCredentialsOptions(). The stream is then cut into
+// records sealed with AES-GCM under the record protocol key derived by the
+// handshake. The nonce of a record is its sequence number in its direction, so
+// replayed, reordered, dropped or modified records fail to open.
+//
+// A LocalChannel may be used by one reading thread and one writing thread at a
+// time.
+class LocalChannel {
+ public:
+  // Largest plaintext carried by a record, unless the handshake negotiated a
+  // smaller maximum protected frame size.
+  static constexpr size_t kDefaultMaxRecordSize = 16 * 1024;
+
+  // Connects |side| of the channel whose region, initialized by the host with
+  // LocalChannelRegion::Initialize() for rings of |ring_capacity| bytes, is at
+  // |region|. Blocks until the handshake with the other end completes, fails,
+  // or does not complete within |timeout|. The peer must be accepted by
+  // |options|, including its peer_acl.
+  static StatusOr<std::unique_ptr<LocalChannel>> Connect(
+      void *region, size_t ring_capacity, LocalChannelSide side,
+      const EnclaveCredentialsOptions &options,
+      absl::Duration timeout = absl::InfiniteDuration());
+
+  LocalChannel(const LocalChannel &other) = delete;
+  LocalChannel &operator=(const LocalChannel &other) = delete;
+
+  // Closes the channel.
+  ~LocalChannel();
+
+  // Returns the identities the peer authenticated with.
+  const EnclaveIdentities &peer_identities() const { return peer_identities_; }
+
+  // Returns the largest plaintext carried by a single record.
+  size_t max_record_size() const { return max_record_size_; }
+
+  // Writes all of |data|, blocking while the ring to the peer is full.
+  Status Write(ByteContainerView data);
+
+  // Reads at least one byte into |buffer|, blocking until the peer writes.
+  // Returns the number of bytes read, or OUT_OF_RANGE once the peer has closed
+  // the channel and all of its data has been read.
+  StatusOr<size_t> Read(absl::Span<uint8_t> buffer);
+
+  // Seals as much of |data| as fits into the ring to the peer, in complete
+  // records. Returns the number of bytes of |data| written, which is zero if
+  // the ring is full.
+  StatusOr<size_t> TryWrite(ByteContainerView data);
+
+  // Opens the records buffered in the ring from the peer, appending their
+  // plaintext to |plaintext| until it grows by at least |max_size| bytes.
+  // Returns the number of bytes appended, which is zero if no complete record
+  // is buffered, or OUT_OF_RANGE once the peer has closed the channel and all
+  // of its data has been read.
+  StatusOr<size_t> TryRead(std::vector<uint8_t> *plaintext, size_t max_size);
+
+  // Returns a token to pass to Wait(). A caller takes the token, then checks
+  // its conditions with TryRead() and TryWrite(), and waits with the token if
+  // neither made progress, so that progress made in between is not missed.
+  int32_t WaitToken() const;
+
+  // Waits until the peer reads or writes, Interrupt() is called, or |timeout|
+  // elapses, whichever comes first, unless one of these happened since |token|
+  // was taken. Spins for a short while before going to sleep.
+  void Wait(int32_t token, absl::Duration timeout);
+
+  // Wakes a thread in Wait() on this end.
+  void Interrupt();
+
+  // Stops writing to the peer, which reads the buffered data and then sees the
+  // end of the stream. Idempotent.
+  void Close();
+
+ private:
+  // Index tracking of one ring, owned by one end.
+  struct RingView {
+    LocalChannelRegion::Ring *ring;
+    uint8_t *data;
+    // The index owned by this end: the tail of the ring it writes or the head
+    // of the ring it reads.
+    uint64_t index;
+  };
+
+  LocalChannel(LocalChannelRegion *region, size_t ring_capacity,
+               LocalChannelSide side);
+
+  // Runs the handshake over the rings.
+  Status Handshake(const EnclaveCredentialsOptions &options,
+                   absl::Duration timeout);
+
+  // Returns the number of bytes that can be written to the peer.
+  size_t WritableBytes() const;
+
+  // Returns the number of bytes the peer has written and this end has not
+  // consumed.
+  size_t ReadableBytes() const;
+
+  // Copies |size| bytes at |data| to the ring to the peer, which must have
+  // room for them, without publishing them.
+  void CopyToRing(const uint8_t *data, size_t size);
+
+  // Copies |size| bytes starting |offset| bytes past the head of the ring from
+  // the peer to |data|.
+  void CopyFromRing(size_t offset, uint8_t *data, size_t size) const;
+
+  // Publishes the bytes copied to the ring to the peer, or consumes |size|
+  // bytes from the ring from the peer, and rings the doorbell of the peer.
+  void PublishWrite();
+  void ConsumeRead(size_t size);
+
+  // Rings the doorbell of |side|.
+  void Ring(LocalChannelSide side);
+
+  // Returns the nonce of record |sequence| written by |writer|.
+  std::vector<uint8_t> RecordNonce(LocalChannelSide writer,
+                                   uint64_t sequence) const;
+
+  // Returns true if the peer has closed the channel.
+  bool PeerClosed() const;
+
+  LocalChannelRegion *const region_;
+  const size_t ring_capacity_;
+  const LocalChannelSide side_;
+
+  RingView out_;
+  RingView in_;
+  bool closed_ = false;
+
+  EnclaveIdentities peer_identities_;
+  size_t max_record_size_ = 0;
+  std::unique_ptr<AeadKey> key_;
+  uint64_t write_sequence_ = 0;
+  uint64_t read_sequence_ = 0;
+
+  // Trusted copies of the record being sealed and of the record being opened.
+  std::vector<uint8_t> seal_buffer_;
+  std::vector<uint8_t> open_buffer_;
+
+  // Plaintext opened by Read() that did not fit into the caller's buffer.
+  std::vector<uint8_t> read_buffer_;
+  size_t read_buffer_offset_ = 0;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_GRPC_LOCAL_LOCAL_CHANNEL_H_
@@ -0,0 +1,98 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/grpc/local/local_channel_memory.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "asylo/util/posix_error_space.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+namespace {
+
+Status InvalidRingCapacity(size_t ring_capacity) {
+  return Status(
+      error::GoogleError::INVALID_ARGUMENT,
+      absl::StrCat("Invalid local channel ring capacity: ", ring_capacity));
+}
+
+}  // namespace
+
+StatusOr<std::unique_ptr<LocalChannelMemory>> LocalChannelMemory::Create(
+    size_t ring_capacity) {
+  if (!LocalChannelRegion::IsValidRingCapacity(ring_capacity)) {
+    return InvalidRingCapacity(ring_capacity);
+  }
+  int fd = memfd_create("asylo-local-channel", MFD_CLOEXEC);
+  if (fd < 0) {
+    return Status(static_cast<error::PosixError>(errno), "memfd_create failed");
+  }
+  size_t size = LocalChannelRegion::Size(ring_capacity);
+  if (ftruncate(fd, size) != 0) {
+    Status status(static_cast<error::PosixError>(errno), "ftruncate failed");
+    close(fd);
+    return status;
+  }
+  void *region =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, /*offset=*/0);
+  if (region == MAP_FAILED) {
+    Status status(static_cast<error::PosixError>(errno), "mmap failed");
+    close(fd);
+    return status;
+  }
+  LocalChannelRegion::Initialize(region, ring_capacity);
+  return absl::WrapUnique(new LocalChannelMemory(fd, region, ring_capacity));
+}
+
+StatusOr<std::unique_ptr<LocalChannelMemory>> LocalChannelMemory::Map(
+    int fd, size_t ring_capacity) {
+  if (!LocalChannelRegion::IsValidRingCapacity(ring_capacity)) {
+    close(fd);
+    return InvalidRingCapacity(ring_capacity);
+  }
+  size_t size = LocalChannelRegion::Size(ring_capacity);
+  struct stat stat_buffer;
+  if (fstat(fd, &stat_buffer) != 0 ||
+      static_cast<size_t>(stat_buffer.st_size) < size) {
+    close(fd);
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "File is too small for a local channel region");
+  }
+  void *region =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, /*offset=*/0);
+  if (region == MAP_FAILED) {
+    Status status(static_cast<error::PosixError>(errno), "mmap failed");
+    close(fd);
+    return status;
+  }
+  return absl::WrapUnique(new LocalChannelMemory(fd, region, ring_capacity));
+}
+
+LocalChannelMemory::~LocalChannelMemory() {
+  munmap(region_, LocalChannelRegion::Size(ring_capacity_));
+  close(fd_);
+}
+
+}  // namespace asylo
@@ -0,0 +1,70 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_GRPC_LOCAL_LOCAL_CHANNEL_MEMORY_H_
+#define ASYLO_GRPC_LOCAL_LOCAL_CHANNEL_MEMORY_H_
+
+#include <cstddef>
+#include <memory>
+
+#include "asylo/grpc/local/local_channel_region.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+
+// Untrusted shared memory holding a LocalChannelRegion, allocated by the host
+// application connecting two enclaves. The memory is backed by a memfd, so the
+// region can also connect enclaves in different processes, by passing fd() to
+// the other process and mapping it there with Map().
+class LocalChannelMemory {
+ public:
+  // Allocates and initializes a region with rings of |ring_capacity| bytes.
+  static StatusOr<std::unique_ptr<LocalChannelMemory>> Create(
+      size_t ring_capacity);
+
+  // Maps the region of rings of |ring_capacity| bytes created by Create() in
+  // another process and backed by |fd|, which the returned object takes.
+  static StatusOr<std::unique_ptr<LocalChannelMemory>> Map(
+      int fd, size_t ring_capacity);
+
+  LocalChannelMemory(const LocalChannelMemory &other) = delete;
+  LocalChannelMemory &operator=(const LocalChannelMemory &other) = delete;
+
+  // Unmaps the region. The enclaves must not use it anymore.
+  ~LocalChannelMemory();
+
+  // Returns the region, to pass to LocalChannel::Connect() in an enclave.
+  void *region() const { return region_; }
+
+  size_t ring_capacity() const { return ring_capacity_; }
+
+  // Returns the memfd backing the region.
+  int fd() const { return fd_; }
+
+ private:
+  LocalChannelMemory(int fd, void *region, size_t ring_capacity)
+      : fd_(fd), region_(region), ring_capacity_(ring_capacity) {}
+
+  const int fd_;
+  void *const region_;
+  const size_t ring_capacity_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_GRPC_LOCAL_LOCAL_CHANNEL_MEMORY_H_
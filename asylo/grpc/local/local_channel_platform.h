@@ -0,0 +1,46 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_GRPC_LOCAL_LOCAL_CHANNEL_PLATFORM_H_
+#define ASYLO_GRPC_LOCAL_LOCAL_CHANNEL_PLATFORM_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace asylo {
+namespace internal {
+
+// Operations on the untrusted memory of a local channel that differ between an
+// enclave and the host. This lets the same channel implementation run in both,
+// the latter mostly for tests.
+
+// Returns true if the |size| bytes at |memory| may be used as the region of a
+// local channel. Inside an enclave, the bytes must lie outside of it.
+bool IsValidLocalChannelMemory(const void *memory, size_t size);
+
+// Waits for at most |timeout_us| microseconds while |*word| holds |expected|.
+// May return early.
+void LocalChannelWait(int32_t *word, int32_t expected, int64_t timeout_us);
+
+// Wakes the threads waiting on |word|.
+void LocalChannelWake(int32_t *word);
+
+}  // namespace internal
+}  // namespace asylo
+
+#endif  // ASYLO_GRPC_LOCAL_LOCAL_CHANNEL_PLATFORM_H_
@@ -0,0 +1,42 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "asylo/grpc/local/local_channel_platform.h"
+#include "asylo/platform/common/futex.h"
+
+namespace asylo {
+namespace internal {
+
+bool IsValidLocalChannelMemory(const void *memory, size_t size) {
+  return memory != nullptr && size > 0;
+}
+
+void LocalChannelWait(int32_t *word, int32_t expected, int64_t timeout_us) {
+  sys_futex_wait(word, expected, timeout_us);
+}
+
+void LocalChannelWake(int32_t *word) {
+  sys_futex_wake(word, std::numeric_limits<int32_t>::max());
+}
+
+}  // namespace internal
+}  // namespace asylo
@@ -0,0 +1,144 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_GRPC_LOCAL_LOCAL_CHANNEL_REGION_H_
+#define ASYLO_GRPC_LOCAL_LOCAL_CHANNEL_REGION_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace asylo {
+
+// The two ends of a local channel. The initiator starts the handshake.
+enum class LocalChannelSide { kInitiator = 0, kResponder = 1 };
+
+// Layout of the untrusted shared memory connecting the two ends of a local
+// channel, which are enclaves running on the same host. The region holds one
+// single-producer, single-consumer byte ring for each direction, and one
+// doorbell for each side, which the peer of that side rings after making data
+// or space available to it.
+//
+// The region is laid out as a LocalChannelRegion followed by the data of the
+// ring written by the initiator and then the data of the ring written by the
+// responder, each of the ring capacity. The region is position independent, so
+// two processes may map it at different addresses.
+//
+// Both ends must treat the region as attacker-controlled. Each end keeps its
+// own copy of the ring capacity and of the ring indices it owns, and only
+// reads the indices owned by the peer, which it clamps to the capacity. A
+// corrupted region can therefore stall the channel or garble its bytes, which
+// the record protocol of LocalChannel detects, but cannot make an end access
+// memory outside the region.
+struct LocalChannelRegion {
+  // Value of |magic| in an initialized region.
+  static constexpr uint64_t kMagic = 0x6c61636f6c796c61;
+
+  // Smallest and largest supported ring capacities.
+  static constexpr size_t kMinRingCapacity = 4096;
+  static constexpr size_t kMaxRingCapacity = size_t{1} << 30;
+
+  static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t),
+                "std::atomic<int32_t> is not lock free.");
+
+  // Indices of one ring, counting bytes written and consumed since the ring
+  // was initialized. Each index has a cache line of its own, as the two ends
+  // write them concurrently.
+  struct Ring {
+    alignas(64) std::atomic<uint64_t> tail;
+    alignas(64) std::atomic<uint64_t> head;
+  };
+
+  // Doorbell of one side. The peer bumps |sequence| and, if |waiters| is
+  // non-zero, wakes the side with a futex wake on the sequence word.
+  struct alignas(64) Doorbell {
+    std::atomic<int32_t> sequence;
+    std::atomic<int32_t> waiters;
+  };
+
+  // Returns true if |ring_capacity| is a power of two within the supported
+  // bounds.
+  static bool IsValidRingCapacity(size_t ring_capacity) {
+    return ring_capacity >= kMinRingCapacity &&
+           ring_capacity <= kMaxRingCapacity &&
+           (ring_capacity & (ring_capacity - 1)) == 0;
+  }
+
+  // Returns the size of a region with rings of |ring_capacity| bytes.
+  static size_t Size(size_t ring_capacity) {
+    return sizeof(LocalChannelRegion) + 2 * ring_capacity;
+  }
+
+  // Initializes the region at |memory|, of at least Size(|ring_capacity|)
+  // bytes, for rings of |ring_capacity| bytes, which must be valid. Called by
+  // the host once, before either end connects.
+  static LocalChannelRegion *Initialize(void *memory, size_t ring_capacity) {
+    LocalChannelRegion *region = new (memory) LocalChannelRegion;
+    region->ring_capacity = ring_capacity;
+    for (int i = 0; i < 2; i++) {
+      region->rings[i].tail.store(0, std::memory_order_relaxed);
+      region->rings[i].head.store(0, std::memory_order_relaxed);
+      region->doorbells[i].sequence.store(0, std::memory_order_relaxed);
+      region->doorbells[i].waiters.store(0, std::memory_order_relaxed);
+      region->closed[i].store(0, std::memory_order_relaxed);
+    }
+    region->magic.store(kMagic, std::memory_order_release);
+    return region;
+  }
+
+  // Returns the ring written by |side|.
+  Ring *ring(LocalChannelSide side) { return &rings[static_cast<int>(side)]; }
+
+  // Returns the data of the ring written by |side|, given the |ring_capacity|
+  // the region was initialized with.
+  uint8_t *ring_data(LocalChannelSide side, size_t ring_capacity) {
+    return reinterpret_cast<uint8_t *>(this + 1) +
+           static_cast<int>(side) * ring_capacity;
+  }
+
+  // Returns the doorbell rung to notify |side|.
+  Doorbell *doorbell(LocalChannelSide side) {
+    return &doorbells[static_cast<int>(side)];
+  }
+
+  // Returns the flag |side| sets once it stops writing.
+  std::atomic<uint32_t> *closed_flag(LocalChannelSide side) {
+    return &closed[static_cast<int>(side)];
+  }
+
+  std::atomic<uint64_t> magic;
+
+  // Ring capacity set by the host, for diagnostics only. The ends use the
+  // capacity they were configured with.
+  uint64_t ring_capacity;
+
+  std::atomic<uint32_t> closed[2];
+  Doorbell doorbells[2];
+  Ring rings[2];
+};
+
+// Returns the side at the other end of the channel from |side|.
+inline LocalChannelSide PeerOf(LocalChannelSide side) {
+  return side == LocalChannelSide::kInitiator ? LocalChannelSide::kResponder
+                                              : LocalChannelSide::kInitiator;
+}
+
+}  // namespace asylo
+
+#endif  // ASYLO_GRPC_LOCAL_LOCAL_CHANNEL_REGION_H_
@@ -0,0 +1,178 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/grpc/local/local_channel.h"
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/time/time.h"
+#include "asylo/grpc/auth/enclave_credentials_options.h"
+#include "asylo/grpc/auth/null_credentials_options.h"
+#include "asylo/grpc/local/local_channel_memory.h"
+#include "asylo/grpc/local/local_channel_region.h"
+#include "asylo/identity/enclave_assertion_authority_config.pb.h"
+#include "asylo/identity/init.h"
+#include "asylo/test/util/enclave_assertion_authority_configs.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::ElementsAreArray;
+
+constexpr size_t kRingCapacity = 64 * 1024;
+
+class LocalChannelTest : public ::testing::Test {
+ protected:
+  static void SetUpTestSuite() {
+    std::vector<EnclaveAssertionAuthorityConfig> configs = {
+        GetNullAssertionAuthorityTestConfig()};
+    ASYLO_ASSERT_OK(InitializeEnclaveAssertionAuthorities(configs.cbegin(),
+                                                          configs.cend()));
+  }
+
+  void SetUp() override {
+    ASYLO_ASSERT_OK_AND_ASSIGN(memory_,
+                               LocalChannelMemory::Create(kRingCapacity));
+  }
+
+  // Connects both ends of the channel in |memory_|.
+  void ConnectBothEnds(std::unique_ptr<LocalChannel> *initiator,
+                       std::unique_ptr<LocalChannel> *responder) {
+    StatusOr<std::unique_ptr<LocalChannel>> responder_result;
+    std::thread responder_thread([this, &responder_result] {
+      responder_result = LocalChannel::Connect(
+          memory_->region(), kRingCapacity, LocalChannelSide::kResponder,
+          BidirectionalNullCredentialsOptions());
+    });
+    StatusOr<std::unique_ptr<LocalChannel>> initiator_result =
+        LocalChannel::Connect(memory_->region(), kRingCapacity,
+                              LocalChannelSide::kInitiator,
+                              BidirectionalNullCredentialsOptions());
+    responder_thread.join();
+    ASYLO_ASSERT_OK(initiator_result);
+    ASYLO_ASSERT_OK(responder_result);
+    *initiator = std::move(initiator_result).ValueOrDie();
+    *responder = std::move(responder_result).ValueOrDie();
+  }
+
+  std::unique_ptr<LocalChannelMemory> memory_;
+};
+
+// Verifies that data larger than the rings is carried in both directions.
+TEST_F(LocalChannelTest, TransfersDataBothWays) {
+  std::unique_ptr<LocalChannel> initiator;
+  std::unique_ptr<LocalChannel> responder;
+  ASSERT_NO_FATAL_FAILURE(ConnectBothEnds(&initiator, &responder));
+
+  std::vector<uint8_t> request(4 * kRingCapacity + 17);
+  for (size_t i = 0; i < request.size(); i++) {
+    request[i] = static_cast<uint8_t>(i * 31);
+  }
+  std::thread writer([&initiator, &request] {
+    ASYLO_EXPECT_OK(initiator->Write(request));
+  });
+  std::vector<uint8_t> received(request.size());
+  size_t offset = 0;
+  while (offset < received.size()) {
+    size_t size;
+    ASYLO_ASSERT_OK_AND_ASSIGN(
+        size, responder->Read(absl::MakeSpan(received).subspan(offset)));
+    offset += size;
+  }
+  writer.join();
+  EXPECT_THAT(received, ElementsAreArray(request));
+
+  std::vector<uint8_t> response = {1, 2, 3};
+  ASYLO_ASSERT_OK(responder->Write(response));
+  std::vector<uint8_t> buffer(16);
+  EXPECT_THAT(initiator->Read(absl::MakeSpan(buffer)), IsOkAndHolds(3));
+}
+
+// Verifies that the reader sees the end of the stream after the buffered data
+// once the writer closes the channel.
+TEST_F(LocalChannelTest, ReadsEndOfStreamAfterClose) {
+  std::unique_ptr<LocalChannel> initiator;
+  std::unique_ptr<LocalChannel> responder;
+  ASSERT_NO_FATAL_FAILURE(ConnectBothEnds(&initiator, &responder));
+
+  std::vector<uint8_t> data = {4, 5};
+  ASYLO_ASSERT_OK(initiator->Write(data));
+  initiator->Close();
+
+  std::vector<uint8_t> buffer(16);
+  EXPECT_THAT(responder->Read(absl::MakeSpan(buffer)), IsOkAndHolds(2));
+  EXPECT_THAT(responder->Read(absl::MakeSpan(buffer)),
+              StatusIs(error::GoogleError::OUT_OF_RANGE));
+  EXPECT_THAT(responder->TryWrite(data),
+              StatusIs(error::GoogleError::UNAVAILABLE));
+}
+
+// Verifies that a record modified in the ring fails to open.
+TEST_F(LocalChannelTest, RejectsModifiedRecord) {
+  std::unique_ptr<LocalChannel> initiator;
+  std::unique_ptr<LocalChannel> responder;
+  ASSERT_NO_FATAL_FAILURE(ConnectBothEnds(&initiator, &responder));
+
+  std::vector<uint8_t> data(100, 7);
+  ASYLO_ASSERT_OK(initiator->Write(data));
+
+  auto *region = reinterpret_cast<LocalChannelRegion *>(memory_->region());
+  uint64_t tail = region->ring(LocalChannelSide::kInitiator)->tail.load();
+  region->ring_data(LocalChannelSide::kInitiator,
+                    kRingCapacity)[(tail - 1) % kRingCapacity] ^= 1;
+
+  std::vector<uint8_t> plaintext;
+  EXPECT_THAT(responder->TryRead(&plaintext, data.size()),
+              StatusIs(error::GoogleError::DATA_LOSS));
+  EXPECT_TRUE(plaintext.empty());
+}
+
+// Verifies that the handshake times out without a peer.
+TEST_F(LocalChannelTest, HandshakeTimesOutWithoutPeer) {
+  EXPECT_THAT(LocalChannel::Connect(memory_->region(), kRingCapacity,
+                                    LocalChannelSide::kInitiator,
+                                    BidirectionalNullCredentialsOptions(),
+                                    absl::Milliseconds(50)),
+              StatusIs(error::GoogleError::DEADLINE_EXCEEDED));
+}
+
+// Verifies that a channel cannot be connected through memory that was not
+// initialized as a region, or with an invalid ring capacity.
+TEST_F(LocalChannelTest, RejectsInvalidRegion) {
+  std::vector<uint8_t> memory(LocalChannelRegion::Size(kRingCapacity), 0);
+  EXPECT_THAT(LocalChannel::Connect(memory.data(), kRingCapacity,
+                                    LocalChannelSide::kInitiator,
+                                    BidirectionalNullCredentialsOptions()),
+              StatusIs(error::GoogleError::FAILED_PRECONDITION));
+  EXPECT_THAT(LocalChannel::Connect(memory_->region(), kRingCapacity + 1,
+                                    LocalChannelSide::kInitiator,
+                                    BidirectionalNullCredentialsOptions()),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace asylo
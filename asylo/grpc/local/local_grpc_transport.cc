@@ -0,0 +1,392 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/grpc/local/local_grpc_transport.h"
+
+#include <cstring>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "asylo/util/status_macros.h"
+#include "include/grpc/grpc.h"
+#include "include/grpc/support/alloc.h"
+#include "include/grpc/support/string_util.h"
+#include "src/core/ext/transport/chttp2/transport/chttp2_transport.h"
+#include "src/core/lib/channel/channel_args.h"
+#include "src/core/lib/iomgr/endpoint.h"
+#include "src/core/lib/iomgr/exec_ctx.h"
+#include "src/core/lib/iomgr/resource_quota.h"
+#include "src/core/lib/slice/slice_internal.h"
+#include "src/core/lib/surface/channel.h"
+#include "src/core/lib/surface/server.h"
+#include "src/cpp/client/create_channel_internal.h"
+
+namespace asylo {
+namespace {
+
+// Largest amount of plaintext handed to gRPC by a single read.
+constexpr size_t kMaxReadSize = 64 * 1024;
+
+// A grpc_endpoint over a LocalChannel. Reads and writes that cannot complete
+// right away are completed by a thread of the endpoint, which waits on the
+// doorbell of the channel while an operation is pending, and on a condition
+// variable otherwise.
+struct LocalEndpoint {
+  LocalEndpoint(std::unique_ptr<LocalChannel> local_channel,
+                const grpc_channel_args *args, std::string peer_name);
+  ~LocalEndpoint();
+
+  // Runs the thread of the endpoint until the endpoint is destroyed.
+  void Serve();
+
+  // Makes progress on the pending operations, with |mu| held. Returns the
+  // callbacks to run, with their errors.
+  void Progress(std::vector<std::pair<grpc_closure *, grpc_error *>> *done)
+      EXCLUSIVE_LOCKS_REQUIRED(mu);
+
+  // Attempts to complete the pending read or write. Returns true and sets
+  // |error| if the operation completed.
+  bool TryRead(grpc_error **error) EXCLUSIVE_LOCKS_REQUIRED(mu);
+  bool TryWrite(grpc_error **error) EXCLUSIVE_LOCKS_REQUIRED(mu);
+
+  // Returns true if the thread has work to do other than waiting for an
+  // operation.
+  bool HasWork() const EXCLUSIVE_LOCKS_REQUIRED(mu) {
+    return destroyed || read_cb != nullptr || write_cb != nullptr;
+  }
+
+  grpc_endpoint base;
+  const std::unique_ptr<LocalChannel> channel;
+  grpc_resource_user *resource_user;
+  const std::string peer;
+
+  absl::Mutex mu;
+  grpc_slice_buffer *read_slices GUARDED_BY(mu) = nullptr;
+  grpc_closure *read_cb GUARDED_BY(mu) = nullptr;
+  grpc_closure *write_cb GUARDED_BY(mu) = nullptr;
+  std::vector<uint8_t> write_data GUARDED_BY(mu);
+  size_t write_offset GUARDED_BY(mu) = 0;
+  std::vector<uint8_t> read_data GUARDED_BY(mu);
+  grpc_error *shutdown_error GUARDED_BY(mu) = GRPC_ERROR_NONE;
+  bool destroyed GUARDED_BY(mu) = false;
+
+  // Set if the endpoint was destroyed by a callback run by its own thread,
+  // which then deletes the endpoint once it exits.
+  bool delete_on_exit GUARDED_BY(mu) = false;
+  std::thread thread;
+};
+
+grpc_error *StatusToGrpcError(const Status &status) {
+  return GRPC_ERROR_CREATE_FROM_COPIED_STRING(status.ToString().c_str());
+}
+
+LocalEndpoint *FromBase(grpc_endpoint *ep) {
+  return reinterpret_cast<LocalEndpoint *>(ep);
+}
+
+void EndpointRead(grpc_endpoint *ep, grpc_slice_buffer *slices,
+                  grpc_closure *cb, bool /*urgent*/) {
+  LocalEndpoint *endpoint = FromBase(ep);
+  grpc_slice_buffer_reset_and_unref_internal(slices);
+  grpc_error *error = GRPC_ERROR_NONE;
+  {
+    absl::MutexLock lock(&endpoint->mu);
+    if (endpoint->shutdown_error != GRPC_ERROR_NONE) {
+      error = GRPC_ERROR_REF(endpoint->shutdown_error);
+    } else {
+      endpoint->read_slices = slices;
+      endpoint->read_cb = cb;
+      if (!endpoint->TryRead(&error)) {
+        endpoint->channel->Interrupt();
+        return;
+      }
+    }
+  }
+  grpc_core::ExecCtx::Run(DEBUG_LOCATION, cb, error);
+}
+
+void EndpointWrite(grpc_endpoint *ep, grpc_slice_buffer *slices,
+                   grpc_closure *cb, void * /*arg*/) {
+  LocalEndpoint *endpoint = FromBase(ep);
+  grpc_error *error = GRPC_ERROR_NONE;
+  {
+    absl::MutexLock lock(&endpoint->mu);
+    if (endpoint->shutdown_error != GRPC_ERROR_NONE) {
+      error = GRPC_ERROR_REF(endpoint->shutdown_error);
+    } else {
+      endpoint->write_data.clear();
+      endpoint->write_offset = 0;
+      for (size_t i = 0; i < slices->count; i++) {
+        const uint8_t *data = GRPC_SLICE_START_PTR(slices->slices[i]);
+        size_t size = GRPC_SLICE_LENGTH(slices->slices[i]);
+        endpoint->write_data.insert(endpoint->write_data.end(), data,
+                                    data + size);
+      }
+      endpoint->write_cb = cb;
+      if (!endpoint->TryWrite(&error)) {
+        endpoint->channel->Interrupt();
+        return;
+      }
+    }
+  }
+  grpc_core::ExecCtx::Run(DEBUG_LOCATION, cb, error);
+}
+
+// The endpoint has no file descriptor for gRPC pollers to watch.
+void EndpointAddToPollset(grpc_endpoint * /*ep*/, grpc_pollset * /*pollset*/) {}
+
+void EndpointAddToPollsetSet(grpc_endpoint * /*ep*/,
+                             grpc_pollset_set * /*pollset*/) {}
+
+void EndpointDeleteFromPollsetSet(grpc_endpoint * /*ep*/,
+                                  grpc_pollset_set * /*pollset*/) {}
+
+void EndpointShutdown(grpc_endpoint *ep, grpc_error *why) {
+  LocalEndpoint *endpoint = FromBase(ep);
+  {
+    absl::MutexLock lock(&endpoint->mu);
+    if (endpoint->shutdown_error == GRPC_ERROR_NONE) {
+      endpoint->shutdown_error = why;
+      why = GRPC_ERROR_NONE;
+    }
+  }
+  GRPC_ERROR_UNREF(why);
+  grpc_resource_user_shutdown(endpoint->resource_user);
+  endpoint->channel->Interrupt();
+}
+
+void EndpointDestroy(grpc_endpoint *ep) {
+  LocalEndpoint *endpoint = FromBase(ep);
+  bool own_thread = std::this_thread::get_id() == endpoint->thread.get_id();
+  {
+    absl::MutexLock lock(&endpoint->mu);
+    endpoint->destroyed = true;
+    endpoint->delete_on_exit = own_thread;
+  }
+  endpoint->channel->Interrupt();
+  if (own_thread) {
+    endpoint->thread.detach();
+    return;
+  }
+  endpoint->thread.join();
+  delete endpoint;
+}
+
+grpc_resource_user *EndpointGetResourceUser(grpc_endpoint *ep) {
+  return FromBase(ep)->resource_user;
+}
+
+char *EndpointGetPeer(grpc_endpoint *ep) {
+  return gpr_strdup(FromBase(ep)->peer.c_str());
+}
+
+int EndpointGetFd(grpc_endpoint * /*ep*/) { return -1; }
+
+bool EndpointCanTrackErr(grpc_endpoint * /*ep*/) { return false; }
+
+const grpc_endpoint_vtable kLocalEndpointVtable = {
+    EndpointRead,
+    EndpointWrite,
+    EndpointAddToPollset,
+    EndpointAddToPollsetSet,
+    EndpointDeleteFromPollsetSet,
+    EndpointShutdown,
+    EndpointDestroy,
+    EndpointGetResourceUser,
+    EndpointGetPeer,
+    EndpointGetFd,
+    EndpointCanTrackErr,
+};
+
+LocalEndpoint::LocalEndpoint(std::unique_ptr<LocalChannel> local_channel,
+                             const grpc_channel_args *args,
+                             std::string peer_name)
+    : channel(std::move(local_channel)), peer(std::move(peer_name)) {
+  base.vtable = &kLocalEndpointVtable;
+  grpc_resource_quota *quota = grpc_resource_quota_from_channel_args(args);
+  resource_user = grpc_resource_user_create(quota, peer.c_str());
+  grpc_resource_quota_unref_internal(quota);
+  thread = std::thread([this] { Serve(); });
+}
+
+LocalEndpoint::~LocalEndpoint() {
+  GRPC_ERROR_UNREF(shutdown_error);
+  grpc_resource_user_unref(resource_user);
+}
+
+void LocalEndpoint::Serve() {
+  while (true) {
+    std::vector<std::pair<grpc_closure *, grpc_error *>> done;
+    mu.LockWhen(absl::Condition(this, &LocalEndpoint::HasWork));
+    if (destroyed) {
+      bool delete_self = delete_on_exit;
+      mu.Unlock();
+      if (delete_self) {
+        delete this;
+      }
+      return;
+    }
+    int32_t token = channel->WaitToken();
+    Progress(&done);
+    mu.Unlock();
+
+    if (done.empty()) {
+      channel->Wait(token, absl::InfiniteDuration());
+      continue;
+    }
+    grpc_core::ApplicationCallbackExecCtx callback_exec_ctx;
+    grpc_core::ExecCtx exec_ctx;
+    for (const auto &callback : done) {
+      grpc_core::ExecCtx::Run(DEBUG_LOCATION, callback.first, callback.second);
+    }
+  }
+}
+
+void LocalEndpoint::Progress(
+    std::vector<std::pair<grpc_closure *, grpc_error *>> *done) {
+  grpc_error *error = GRPC_ERROR_NONE;
+  if (shutdown_error != GRPC_ERROR_NONE) {
+    channel->Close();
+    if (read_cb) {
+      done->emplace_back(read_cb, GRPC_ERROR_REF(shutdown_error));
+      read_cb = nullptr;
+    }
+    if (write_cb) {
+      done->emplace_back(write_cb, GRPC_ERROR_REF(shutdown_error));
+      write_cb = nullptr;
+    }
+    return;
+  }
+  if (read_cb) {
+    grpc_closure *cb = read_cb;
+    if (TryRead(&error)) {
+      done->emplace_back(cb, error);
+    }
+  }
+  if (write_cb) {
+    grpc_closure *cb = write_cb;
+    if (TryWrite(&error)) {
+      done->emplace_back(cb, error);
+    }
+  }
+}
+
+bool LocalEndpoint::TryRead(grpc_error **error) {
+  read_data.clear();
+  StatusOr<size_t> result = channel->TryRead(&read_data, kMaxReadSize);
+  if (result.ok() && result.ValueOrDie() == 0) {
+    return false;
+  }
+  if (!result.ok()) {
+    *error = result.status().error_code() == error::GoogleError::OUT_OF_RANGE
+                 ? GRPC_ERROR_CREATE_FROM_STATIC_STRING("Local channel closed")
+                 : StatusToGrpcError(result.status());
+  } else {
+    grpc_slice_buffer_add(read_slices,
+                          grpc_slice_from_copied_buffer(
+                              reinterpret_cast<const char *>(read_data.data()),
+                              read_data.size()));
+    *error = GRPC_ERROR_NONE;
+  }
+  read_slices = nullptr;
+  read_cb = nullptr;
+  return true;
+}
+
+bool LocalEndpoint::TryWrite(grpc_error **error) {
+  StatusOr<size_t> result = channel->TryWrite(ByteContainerView(
+      write_data.data() + write_offset, write_data.size() - write_offset));
+  if (!result.ok()) {
+    *error = StatusToGrpcError(result.status());
+  } else {
+    write_offset += result.ValueOrDie();
+    if (write_offset < write_data.size()) {
+      return false;
+    }
+    *error = GRPC_ERROR_NONE;
+  }
+  write_cb = nullptr;
+  return true;
+}
+
+}  // namespace
+
+std::shared_ptr<::grpc::Channel> CreateLocalGrpcChannel(
+    std::unique_ptr<LocalChannel> channel,
+    const ::grpc::ChannelArguments &args) {
+  grpc_init();
+  grpc_core::ExecCtx exec_ctx;
+
+  grpc_channel_args channel_args;
+  args.SetChannelArgs(&channel_args);
+  grpc_arg authority_arg = grpc_channel_arg_string_create(
+      const_cast<char *>(GRPC_ARG_DEFAULT_AUTHORITY),
+      const_cast<char *>("localhost"));
+  const grpc_channel_args *final_args =
+      grpc_channel_args_find(&channel_args, GRPC_ARG_DEFAULT_AUTHORITY)
+          ? grpc_channel_args_copy(&channel_args)
+          : grpc_channel_args_copy_and_add(&channel_args, &authority_arg, 1);
+
+  auto *endpoint =
+      new LocalEndpoint(std::move(channel), final_args, "asylo-local:server");
+  grpc_transport *transport = grpc_create_chttp2_transport(
+      final_args, &endpoint->base, /*is_client=*/true);
+  grpc_channel *c_channel = grpc_channel_create(
+      "asylo-local", final_args, GRPC_CLIENT_DIRECT_CHANNEL, transport);
+  grpc_channel_args_destroy(final_args);
+  grpc_chttp2_transport_start_reading(transport, nullptr, nullptr);
+  grpc_core::ExecCtx::Get()->Flush();
+
+  if (c_channel == nullptr) {
+    c_channel = grpc_lame_client_channel_create(
+        "asylo-local", GRPC_STATUS_INTERNAL,
+        "Failed to create a channel over a local channel");
+  }
+  std::shared_ptr<::grpc::Channel> result = ::grpc::CreateChannelInternal(
+      "", c_channel,
+      std::vector<std::unique_ptr<
+          ::grpc::experimental::ClientInterceptorFactoryInterface>>());
+  grpc_shutdown();
+  return result;
+}
+
+Status AddLocalGrpcConnection(::grpc::Server *server,
+                              std::unique_ptr<LocalChannel> channel) {
+  if (server == nullptr || channel == nullptr) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Server and channel must not be null");
+  }
+  grpc_core::ExecCtx exec_ctx;
+  grpc_server *c_server = server->c_server();
+  const grpc_channel_args *server_args = grpc_server_get_channel_args(c_server);
+  auto *endpoint =
+      new LocalEndpoint(std::move(channel), server_args, "asylo-local:client");
+  grpc_transport *transport = grpc_create_chttp2_transport(
+      server_args, &endpoint->base, /*is_client=*/false);
+  grpc_server_setup_transport(c_server, transport, nullptr, server_args,
+                              nullptr);
+  grpc_chttp2_transport_start_reading(transport, nullptr, nullptr);
+  return Status::OkStatus();
+}
+
+}  // namespace asylo
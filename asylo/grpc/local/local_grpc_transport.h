@@ -0,0 +1,54 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_GRPC_LOCAL_LOCAL_GRPC_TRANSPORT_H_
+#define ASYLO_GRPC_LOCAL_LOCAL_GRPC_TRANSPORT_H_
+
+#include <memory>
+
+#include "asylo/grpc/local/local_channel.h"
+#include "asylo/util/status.h"
+#include "include/grpcpp/channel.h"
+#include "include/grpcpp/server.h"
+#include "include/grpcpp/support/channel_arguments.h"
+
+namespace asylo {
+
+// gRPC over a LocalChannel. Each LocalChannel carries a single HTTP/2
+// connection, with the same framing as over TCP but without the kernel
+// network stack or socket host calls. The channel is already authenticated
+// and encrypted by LocalChannel, so gRPC sees an insecure connection, and the
+// auth context of a call does not hold the peer identities. Servers that
+// authorize calls can use LocalChannel::peer_identities() of the channel the
+// connection was added with instead.
+
+// Returns a gRPC channel whose only connection is carried by |channel|, the
+// initiator end of a connected LocalChannel. The gRPC channel does not
+// reconnect, and fails its calls once the local channel is closed.
+std::shared_ptr<::grpc::Channel> CreateLocalGrpcChannel(
+    std::unique_ptr<LocalChannel> channel,
+    const ::grpc::ChannelArguments &args = ::grpc::ChannelArguments());
+
+// Serves the connection carried by |channel|, the responder end of a connected
+// LocalChannel, with |server|, which must have been started.
+Status AddLocalGrpcConnection(::grpc::Server *server,
+                              std::unique_ptr<LocalChannel> channel);
+
+}  // namespace asylo
+
+#endif  // ASYLO_GRPC_LOCAL_LOCAL_GRPC_TRANSPORT_H_
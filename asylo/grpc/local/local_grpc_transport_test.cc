@@ -0,0 +1,86 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/grpc/local/local_grpc_transport.h"
+
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "asylo/grpc/auth/null_credentials_options.h"
+#include "asylo/grpc/local/local_channel.h"
+#include "asylo/grpc/local/local_channel_memory.h"
+#include "asylo/identity/enclave_assertion_authority_config.pb.h"
+#include "asylo/identity/init.h"
+#include "asylo/test/grpc/messenger_client_impl.h"
+#include "asylo/test/grpc/messenger_server_impl.h"
+#include "asylo/test/util/enclave_assertion_authority_configs.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/statusor.h"
+#include "include/grpcpp/server_builder.h"
+
+namespace asylo {
+namespace {
+
+constexpr size_t kRingCapacity = 64 * 1024;
+
+// Verifies that gRPC calls are served over a local channel.
+TEST(LocalGrpcTransportTest, ServesCallsOverLocalChannel) {
+  std::vector<EnclaveAssertionAuthorityConfig> configs = {
+      GetNullAssertionAuthorityTestConfig()};
+  ASYLO_ASSERT_OK(
+      InitializeEnclaveAssertionAuthorities(configs.cbegin(), configs.cend()));
+
+  // The memory must outlive the server, which owns the responder.
+  std::unique_ptr<LocalChannelMemory> memory;
+  ASYLO_ASSERT_OK_AND_ASSIGN(memory, LocalChannelMemory::Create(kRingCapacity));
+  test::MessengerServer1 service;
+  ::grpc::ServerBuilder builder;
+  builder.RegisterService(&service);
+  std::unique_ptr<::grpc::Server> server = builder.BuildAndStart();
+  ASSERT_NE(server, nullptr);
+
+  StatusOr<std::unique_ptr<LocalChannel>> responder;
+  std::thread responder_thread([&memory, &responder] {
+    responder = LocalChannel::Connect(memory->region(), kRingCapacity,
+                                      LocalChannelSide::kResponder,
+                                      BidirectionalNullCredentialsOptions());
+  });
+  std::unique_ptr<LocalChannel> initiator;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      initiator, LocalChannel::Connect(memory->region(), kRingCapacity,
+                                       LocalChannelSide::kInitiator,
+                                       BidirectionalNullCredentialsOptions()));
+  responder_thread.join();
+  ASYLO_ASSERT_OK(responder);
+  ASYLO_ASSERT_OK(AddLocalGrpcConnection(
+      server.get(), std::move(responder).ValueOrDie()));
+
+  test::MessengerClient1 client(CreateLocalGrpcChannel(std::move(initiator)));
+  for (int i = 0; i < 3; i++) {
+    EXPECT_THAT(client.Hello("local"),
+                IsOkAndHolds(test::MessengerServer1::ResponseString("local")));
+  }
+  server->Shutdown();
+}
+
+}  // namespace
+}  // namespace asylo
@@ -25,6 +25,7 @@
 #include "absl/strings/str_cat.h"
 #include "asylo/util/logging.h"
 #include "asylo/grpc/util/enclave_server.pb.h"
+#include "asylo/grpc/util/grpc_server_options.h"
 #include "asylo/trusted_application.h"
 #include "asylo/util/mutex_guarded.h"
 #include "asylo/util/status.h"
@@ -50,6 +51,10 @@ namespace asylo {
 // if the EnclaveConfig specified a port of 0 (indicates that the operating
 // system should select an available port).
 //
+// The server's threads are bounded by the threading options of the
+// server_input_config extension, so that they do not exhaust the enclave's
+// thread control structures.
+//
 // The server is shut down during Finalize(). To ensure proper server shutdown,
 // users of this class are expected to trigger enclave finalization by calling
 // EnclaveManager::DestroyEnclave() at some point during lifetime of their
@@ -91,6 +96,7 @@ class EnclaveServer final : public TrustedApplication {
     }
     host_ = config_server_proto.host();
     port_ = config_server_proto.port();
+    options_ = GrpcServerOptions::FromServerConfig(config_server_proto);
 
     LOG(INFO) << "gRPC server configured with address: " << host_ << ":"
               << port_;
@@ -127,6 +133,7 @@ class EnclaveServer final : public TrustedApplication {
   StatusOr<std::unique_ptr<::grpc::Server>> CreateServer() {
     int port;
     ::grpc::ServerBuilder builder;
+    options_.ApplyTo("EnclaveServer", &builder);
     builder.AddListeningPort(absl::StrCat(host_, ":", port_), credentials_,
                              &port);
     if (service_ == nullptr) {
@@ -182,6 +189,9 @@ class EnclaveServer final : public TrustedApplication {
   std::string host_;
   int port_;
 
+  // The threading and resource options of the server.
+  GrpcServerOptions options_;
+
   std::unique_ptr<::grpc::Service> service_;
   GrpcServiceFactory service_factory_;
   std::shared_ptr<::grpc::ServerCredentials> credentials_;
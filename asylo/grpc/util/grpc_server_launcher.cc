@@ -48,6 +48,17 @@ Status GrpcServerLauncher::AddListeningPort(
   return Status::OkStatus();
 }
 
+StatusOr<std::unique_ptr<::grpc::ServerCompletionQueue>>
+GrpcServerLauncher::AddCompletionQueue() {
+  absl::MutexLock lock(&mu_);
+  if (state_ != State::NOT_LAUNCHED) {
+    return MakeStatus(
+        error::GoogleError::FAILED_PRECONDITION,
+        "Cannot add completion queues after the server has started");
+  }
+  return builder_.AddCompletionQueue();
+}
+
 Status GrpcServerLauncher::Start() {
   absl::MutexLock lock(&mu_);
   if (state_ != State::NOT_LAUNCHED) {
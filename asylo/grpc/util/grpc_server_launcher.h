@@ -25,7 +25,10 @@
 
 #include "absl/strings/str_cat.h"
 #include "absl/synchronization/mutex.h"
+#include "asylo/grpc/util/grpc_server_options.h"
 #include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+#include "include/grpcpp/completion_queue.h"
 #include "include/grpcpp/impl/codegen/service_type.h"
 #include "include/grpcpp/security/server_credentials.h"
 #include "include/grpcpp/server.h"
@@ -36,8 +39,9 @@ namespace asylo {
 // The GrpcServerLauncher class is a helper class designed to simplify launching
 // a gRPC server that hosts multiple services that listen on different ports.
 // The expected usage of this class is as follows:
-//   // Create a launcher instance.
-//   GrpcServerLauncher launcher("my launcher");
+//   // Create a launcher instance, optionally bounding its threads.
+//   GrpcServerLauncher launcher("my launcher",
+//                               GrpcServerOptions::ForThreadBudget(16));
 //
 //   // Register one or more services, ports, and credentials.
 //   launcher.RegisterService(...);
@@ -85,10 +89,18 @@ class GrpcServerLauncher {
  public:
   enum class State { NOT_LAUNCHED, LAUNCHED, TERMINATED };
 
-  GrpcServerLauncher(std::string name)
-      : name_{std::move(name)}, state_{State::NOT_LAUNCHED} {}
+  // Creates a launcher for a server named |name|, whose threading and
+  // resource usage is configured by |options|.
+  GrpcServerLauncher(std::string name,
+                     const GrpcServerOptions &options = GrpcServerOptions())
+      : name_{std::move(name)}, state_{State::NOT_LAUNCHED} {
+    options.ApplyTo(name_, &builder_);
+  }
 
   // Registers a gRPC service with the server. Takes ownership of |service|.
+  // Synchronous and callback services are driven by the server itself. Async
+  // services are driven by the caller through completion queues obtained from
+  // AddCompletionQueue().
   Status RegisterService(std::unique_ptr<::grpc::Service> service);
 
   // Adds a listening port and associated credentials to the server. If
@@ -102,6 +114,12 @@ class GrpcServerLauncher {
                           std::shared_ptr<::grpc::ServerCredentials> creds,
                           int *selected_port = nullptr);
 
+  // Adds a completion queue for async services to the server. The caller
+  // must poll the returned queue, and shut it down after the server has shut
+  // down.
+  StatusOr<std::unique_ptr<::grpc::ServerCompletionQueue>>
+  AddCompletionQueue();
+
   // Starts the gRPC server.
   Status Start();
 
@@ -179,6 +179,48 @@ TEST_F(GrpcServerLauncherTest, ModifyAfterStart) {
   EXPECT_THAT(launcher_.Wait(), IsOk());
 }
 
+// Verifies that a server with bounded threads serves RPCs.
+TEST_F(GrpcServerLauncherTest, BoundedThreads) {
+  GrpcServerLauncher launcher("BoundedThreads",
+                              GrpcServerOptions::ForThreadBudget(8));
+  ASSERT_THAT(
+      launcher.RegisterService(absl::make_unique<test::MessengerServer1>()),
+      IsOk());
+  int port;
+  ASSERT_THAT(
+      launcher.AddListeningPort(server_address_,
+                                ::grpc::InsecureServerCredentials(), &port),
+      IsOk());
+  ASSERT_THAT(launcher.Start(), IsOk());
+  server_address_ = absl::StrCat(kLocalhostAddress, ":", port);
+  ASSERT_TRUE(ConnectChannel());
+
+  test::MessengerClient1 messenger_client1(channel_);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_THAT(messenger_client1.Hello(kMessengerClientName), IsOk());
+  }
+  EXPECT_THAT(launcher.Shutdown(), IsOk());
+}
+
+// Verifies that completion queues can only be added before the server starts.
+TEST_F(GrpcServerLauncherTest, AddCompletionQueue) {
+  auto cq_result = launcher_.AddCompletionQueue();
+  ASSERT_THAT(cq_result, IsOk());
+  std::unique_ptr<::grpc::ServerCompletionQueue> cq =
+      std::move(cq_result).ValueOrDie();
+  ASSERT_NE(cq, nullptr);
+
+  ASSERT_THAT(LaunchServer(), IsOk());
+  EXPECT_THAT(launcher_.AddCompletionQueue(), Not(IsOk()));
+
+  EXPECT_THAT(launcher_.Shutdown(), IsOk());
+  cq->Shutdown();
+  void *tag;
+  bool ok;
+  while (cq->Next(&tag, &ok)) {
+  }
+}
+
 // Verifies the pre-launch state of the server launcher.
 TEST_F(GrpcServerLauncherTest, PreLaunchState) {
   GrpcServerLauncher launcher("PreLaunchState");
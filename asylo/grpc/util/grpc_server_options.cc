@@ -0,0 +1,106 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/grpc/util/grpc_server_options.h"
+
+#include <algorithm>
+
+#include "include/grpcpp/resource_quota.h"
+
+namespace asylo {
+namespace {
+
+// Number of server threads per completion queue that ForThreadBudget() aims
+// for before adding another completion queue.
+constexpr int kThreadsPerCq = 4;
+
+// Maximum number of completion queues used by ForThreadBudget().
+constexpr int kMaxCqs = 4;
+
+}  // namespace
+
+constexpr int GrpcServerOptions::kReservedThreads;
+
+GrpcServerOptions GrpcServerOptions::ForThreadBudget(int thread_budget) {
+  GrpcServerOptions options;
+  if (thread_budget <= 0) {
+    return options;
+  }
+  int server_threads = std::max(1, thread_budget - kReservedThreads);
+  options.num_cqs =
+      std::min(kMaxCqs, std::max(1, server_threads / kThreadsPerCq));
+  options.min_pollers = 1;
+  options.max_pollers = std::max(1, server_threads / options.num_cqs);
+  options.max_threads = server_threads;
+  return options;
+}
+
+GrpcServerOptions GrpcServerOptions::FromServerConfig(
+    const ServerConfig &config) {
+  GrpcServerOptions options = ForThreadBudget(config.thread_budget());
+  if (config.has_num_cqs()) {
+    options.num_cqs = config.num_cqs();
+  }
+  if (config.has_min_pollers()) {
+    options.min_pollers = config.min_pollers();
+  }
+  if (config.has_max_pollers()) {
+    options.max_pollers = config.max_pollers();
+  }
+  if (config.has_cq_timeout_ms()) {
+    options.cq_timeout_ms = config.cq_timeout_ms();
+  }
+  if (config.has_max_threads()) {
+    options.max_threads = config.max_threads();
+  }
+  if (config.has_resource_quota_bytes()) {
+    options.resource_quota_bytes = config.resource_quota_bytes();
+  }
+  return options;
+}
+
+void GrpcServerOptions::ApplyTo(const std::string &name,
+                                ::grpc::ServerBuilder *builder) const {
+  if (num_cqs > 0) {
+    builder->SetSyncServerOption(::grpc::ServerBuilder::NUM_CQS, num_cqs);
+  }
+  if (min_pollers > 0) {
+    builder->SetSyncServerOption(::grpc::ServerBuilder::MIN_POLLERS,
+                                 min_pollers);
+  }
+  if (max_pollers > 0) {
+    builder->SetSyncServerOption(::grpc::ServerBuilder::MAX_POLLERS,
+                                 max_pollers);
+  }
+  if (cq_timeout_ms > 0) {
+    builder->SetSyncServerOption(::grpc::ServerBuilder::CQ_TIMEOUT_MSEC,
+                                 cq_timeout_ms);
+  }
+  if (max_threads > 0 || resource_quota_bytes > 0) {
+    ::grpc::ResourceQuota quota(name);
+    if (max_threads > 0) {
+      quota.SetMaxThreads(max_threads);
+    }
+    if (resource_quota_bytes > 0) {
+      quota.Resize(resource_quota_bytes);
+    }
+    builder->SetResourceQuota(quota);
+  }
+}
+
+}  // namespace asylo
@@ -0,0 +1,75 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_GRPC_UTIL_GRPC_SERVER_OPTIONS_H_
+#define ASYLO_GRPC_UTIL_GRPC_SERVER_OPTIONS_H_
+
+#include <cstdint>
+#include <string>
+
+#include "asylo/grpc/util/enclave_server.pb.h"
+#include "include/grpcpp/server_builder.h"
+
+namespace asylo {
+
+// Threading and resource options for a synchronous gRPC server. A value of
+// zero leaves the corresponding gRPC default in place.
+//
+// gRPC's synchronous server runs handlers on the threads polling its server
+// completion queues, and by default creates new polling threads without bound
+// as load increases. Inside an enclave every such thread occupies a thread
+// control structure (TCS), so an unbounded server can exhaust the enclave's
+// TCS and block. The options below bound the number of server threads.
+struct GrpcServerOptions {
+  // Number of threads reserved by ForThreadBudget() for gRPC's internal
+  // threads (timers, executor) and the thread that owns the server.
+  static constexpr int kReservedThreads = 4;
+
+  // Returns options that keep the server's threads within |thread_budget|
+  // threads, after setting aside kReservedThreads. Returns default options if
+  // |thread_budget| is not positive.
+  static GrpcServerOptions ForThreadBudget(int thread_budget);
+
+  // Returns the options set in |config|. Fields not set in |config| are sized
+  // with ForThreadBudget() from the thread_budget field of |config|.
+  static GrpcServerOptions FromServerConfig(const ServerConfig &config);
+
+  // Applies these options to |builder|. |name| identifies the server's
+  // resource quota.
+  void ApplyTo(const std::string &name, ::grpc::ServerBuilder *builder) const;
+
+  // Number of server completion queues.
+  int num_cqs = 0;
+
+  // Minimum and maximum number of threads polling each completion queue.
+  int min_pollers = 0;
+  int max_pollers = 0;
+
+  // Timeout of each completion queue poll, in milliseconds.
+  int cq_timeout_ms = 0;
+
+  // Maximum number of threads used by the server across all completion queues.
+  int max_threads = 0;
+
+  // Memory limit of the server's resource quota, in bytes.
+  int64_t resource_quota_bytes = 0;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_GRPC_UTIL_GRPC_SERVER_OPTIONS_H_
@@ -0,0 +1,70 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/grpc/util/grpc_server_options.h"
+
+#include <algorithm>
+
+#include <gtest/gtest.h>
+#include "asylo/grpc/util/enclave_server.pb.h"
+
+namespace asylo {
+namespace {
+
+// Verifies that a non-positive budget leaves gRPC's defaults in place.
+TEST(GrpcServerOptionsTest, NoBudget) {
+  GrpcServerOptions options = GrpcServerOptions::ForThreadBudget(0);
+  EXPECT_EQ(options.num_cqs, 0);
+  EXPECT_EQ(options.max_pollers, 0);
+  EXPECT_EQ(options.max_threads, 0);
+}
+
+// Verifies that the pollers of all completion queues fit within the budget.
+TEST(GrpcServerOptionsTest, StaysWithinBudget) {
+  for (int budget = 1; budget <= 64; ++budget) {
+    GrpcServerOptions options = GrpcServerOptions::ForThreadBudget(budget);
+    int server_threads =
+        std::max(1, budget - GrpcServerOptions::kReservedThreads);
+    EXPECT_GE(options.num_cqs, 1);
+    EXPECT_GE(options.max_pollers, options.min_pollers);
+    EXPECT_LE(options.num_cqs * options.max_pollers, server_threads);
+    EXPECT_EQ(options.max_threads, server_threads);
+  }
+}
+
+// Verifies that fields set in a ServerConfig override the sized defaults.
+TEST(GrpcServerOptionsTest, FromServerConfig) {
+  ServerConfig config;
+  GrpcServerOptions options = GrpcServerOptions::FromServerConfig(config);
+  EXPECT_EQ(options.max_threads,
+            config.thread_budget() - GrpcServerOptions::kReservedThreads);
+
+  config.set_thread_budget(0);
+  config.set_num_cqs(3);
+  config.set_max_pollers(5);
+  config.set_resource_quota_bytes(1 << 20);
+  options = GrpcServerOptions::FromServerConfig(config);
+  EXPECT_EQ(options.num_cqs, 3);
+  EXPECT_EQ(options.min_pollers, 0);
+  EXPECT_EQ(options.max_pollers, 5);
+  EXPECT_EQ(options.max_threads, 0);
+  EXPECT_EQ(options.resource_quota_bytes, 1 << 20);
+}
+
+}  // namespace
+}  // namespace asylo
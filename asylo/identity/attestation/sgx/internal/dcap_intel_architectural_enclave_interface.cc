@@ -172,14 +172,36 @@ Status Quote3ErrorToStatus(quote3_error_t quote3_error) {
   }
 }
 
+// Returns whether |quote3_error| indicates that the quoting enclave was
+// reloaded or changed, so that any cached QE state is stale.
+bool IsQeStateLost(quote3_error_t quote3_error) {
+  switch (quote3_error) {
+    case SGX_QL_ENCLAVE_LOST:
+    case SGX_QL_ENCLAVE_LOAD_ERROR:
+    case SGX_QL_INTERFACE_UNAVAILABLE:
+    case SGX_QL_ERROR_REPORT:
+    case SGX_QL_INVALID_REPORT:
+    case SGX_QL_ATT_KEY_NOT_INITIALIZED:
+      return true;
+    default:
+      return false;
+  }
+}
+
 }  // namespace
 
 DcapIntelArchitecturalEnclaveInterface::DcapIntelArchitecturalEnclaveInterface(
     std::unique_ptr<DcapLibraryInterface> dcap_library)
-    : dcap_library_(std::move(dcap_library)) {}
+    : dcap_library_(std::move(dcap_library)), qe_cache_(QeCache()) {}
 
 Status DcapIntelArchitecturalEnclaveInterface::SetEnclaveDir(
     const std::string &path) {
+  // A different directory may hold a different QE.
+  {
+    auto qe_cache = qe_cache_.Lock();
+    qe_cache->targetinfo.reset();
+    qe_cache->quote_size.reset();
+  }
   return Quote3ErrorToStatus(dcap_library_->QeSetEnclaveDirpath(path.c_str()));
 }
 
@@ -246,33 +268,104 @@ Status DcapIntelArchitecturalEnclaveInterface::PceSignReport(
 }
 
 StatusOr<Targetinfo> DcapIntelArchitecturalEnclaveInterface::GetQeTargetinfo() {
+  {
+    auto qe_cache = qe_cache_.ReaderLock();
+    if (qe_cache->targetinfo.has_value()) {
+      return qe_cache->targetinfo.value();
+    }
+  }
+
   Targetinfo target_info;
   quote3_error_t result = dcap_library_->QeGetTargetInfo(
       CheckedPointerCast<sgx_target_info_t *>(&target_info));
-  if (result == SGX_QL_SUCCESS) {
-    return target_info;
+  if (result != SGX_QL_SUCCESS) {
+    return HandleQuote3Result(result);
   }
-  return Quote3ErrorToStatus(result);
+
+  auto qe_cache = qe_cache_.Lock();
+  if (qe_cache->keep_warm) {
+    qe_cache->targetinfo = target_info;
+  }
+  return target_info;
 }
 
 StatusOr<std::vector<uint8_t>>
 DcapIntelArchitecturalEnclaveInterface::GetQeQuote(const Report &report) {
+  uint32_t quote_size;
+  ASYLO_ASSIGN_OR_RETURN(quote_size, GetQuoteSize());
+  return GetQeQuoteWithSize(report, quote_size);
+}
+
+Status DcapIntelArchitecturalEnclaveInterface::EnableKeepWarm() {
+  ASYLO_RETURN_IF_ERROR(Quote3ErrorToStatus(
+      dcap_library_->QeSetEnclaveLoadPolicy(SGX_QL_PERSISTENT)));
+  qe_cache_.Lock()->keep_warm = true;
+  return Status::OkStatus();
+}
+
+StatusOr<std::vector<std::vector<uint8_t>>>
+DcapIntelArchitecturalEnclaveInterface::GetQeQuotes(
+    absl::Span<const Report> reports) {
+  std::vector<std::vector<uint8_t>> quotes;
+  if (reports.empty()) {
+    return quotes;
+  }
+
+  uint32_t quote_size;
+  ASYLO_ASSIGN_OR_RETURN(quote_size, GetQuoteSize());
+  quotes.reserve(reports.size());
+  for (const Report &report : reports) {
+    std::vector<uint8_t> quote;
+    ASYLO_ASSIGN_OR_RETURN(quote, GetQeQuoteWithSize(report, quote_size));
+    quotes.push_back(std::move(quote));
+  }
+  return quotes;
+}
+
+StatusOr<uint32_t> DcapIntelArchitecturalEnclaveInterface::GetQuoteSize() {
+  {
+    auto qe_cache = qe_cache_.ReaderLock();
+    if (qe_cache->quote_size.has_value()) {
+      return qe_cache->quote_size.value();
+    }
+  }
+
   uint32_t quote_size;
   quote3_error_t result = dcap_library_->QeGetQuoteSize(&quote_size);
   if (result != SGX_QL_SUCCESS) {
-    return Quote3ErrorToStatus(result);
+    return HandleQuote3Result(result);
   }
 
+  auto qe_cache = qe_cache_.Lock();
+  if (qe_cache->keep_warm) {
+    qe_cache->quote_size = quote_size;
+  }
+  return quote_size;
+}
+
+StatusOr<std::vector<uint8_t>>
+DcapIntelArchitecturalEnclaveInterface::GetQeQuoteWithSize(
+    const Report &report, uint32_t quote_size) {
   std::vector<uint8_t> quote(quote_size);
-  result = dcap_library_->QeGetQuote(
+  quote3_error_t result = dcap_library_->QeGetQuote(
       CheckedPointerCast<const sgx_report_t *>(&report), quote_size,
       quote.data());
   if (result != SGX_QL_SUCCESS) {
-    return Quote3ErrorToStatus(result);
+    return HandleQuote3Result(result);
   }
 
   return quote;
 }
 
+Status DcapIntelArchitecturalEnclaveInterface::HandleQuote3Result(
+    quote3_error_t result) {
+  if (IsQeStateLost(result)) {
+    auto qe_cache = qe_cache_.Lock();
+    qe_cache->targetinfo.reset();
+    qe_cache->quote_size.reset();
+  }
+  return Quote3ErrorToStatus(result);
+}
+
 }  // namespace sgx
 }  // namespace asylo
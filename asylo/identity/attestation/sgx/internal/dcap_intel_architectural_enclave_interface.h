@@ -25,13 +25,16 @@
 #include <string>
 #include <vector>
 
+#include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "asylo/crypto/algorithms.pb.h"
 #include "asylo/crypto/util/bytes.h"
 #include "asylo/identity/attestation/sgx/internal/dcap_library_interface.h"
 #include "asylo/identity/attestation/sgx/internal/intel_architectural_enclave_interface.h"
 #include "asylo/identity/platform/sgx/internal/identity_key_management_structs.h"
+#include "asylo/util/mutex_guarded.h"
 #include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
 
 namespace asylo {
 namespace sgx {
@@ -72,8 +75,44 @@ class DcapIntelArchitecturalEnclaveInterface
 
   StatusOr<std::vector<uint8_t>> GetQeQuote(const Report &report) override;
 
+  // Keeps the quoting enclave loaded between quotes, and caches its Targetinfo
+  // and quote size. This avoids reloading the QE and querying it again for
+  // the first quote after an idle period.
+  //
+  // The cache is dropped whenever the DCAP library reports that the QE was
+  // lost, could not be loaded or rejected a report. These failures are how a
+  // TCB recovery or a QE reload shows up. After such a failure, callers must
+  // get a fresh Targetinfo with GetQeTargetinfo() and regenerate their report.
+  Status EnableKeepWarm();
+
+  // Generates a quote for each report in |reports| and returns them in the
+  // same order. The quote size is queried once for the whole batch. Fails
+  // if any of the quotes cannot be generated.
+  StatusOr<std::vector<std::vector<uint8_t>>> GetQeQuotes(
+      absl::Span<const Report> reports);
+
  private:
+  // State of the quoting enclave that is cached in keep-warm mode.
+  struct QeCache {
+    bool keep_warm = false;
+    absl::optional<Targetinfo> targetinfo;
+    absl::optional<uint32_t> quote_size;
+  };
+
+  // Returns the QE quote size, from |qe_cache_| if possible.
+  StatusOr<uint32_t> GetQuoteSize();
+
+  // Generates a quote of |quote_size| bytes for |report|.
+  StatusOr<std::vector<uint8_t>> GetQeQuoteWithSize(const Report &report,
+                                                    uint32_t quote_size);
+
+  // Converts |result| to a Status, and drops the QE cache if |result|
+  // indicates that the cached QE state may be stale.
+  Status HandleQuote3Result(quote3_error_t result);
+
   std::unique_ptr<DcapLibraryInterface> dcap_library_;
+
+  MutexGuarded<QeCache> qe_cache_;
 };
 
 }  // namespace sgx
@@ -56,6 +56,7 @@ namespace {
 
 using ::testing::_;
 using ::testing::DoAll;
+using ::testing::ElementsAre;
 using ::testing::Eq;
 using ::testing::Not;
 using ::testing::NotNull;
@@ -68,6 +69,8 @@ class MockDcapLibraryInterface : public DcapLibraryInterface {
  public:
   MOCK_METHOD(quote3_error_t, QeSetEnclaveDirpath, (const char *),
               (const, override));
+  MOCK_METHOD(quote3_error_t, QeSetEnclaveLoadPolicy,
+              (sgx_ql_request_policy_t policy), (const, override));
   MOCK_METHOD(sgx_pce_error_t, PceGetTarget,
               (sgx_target_info_t * p_pce_target, sgx_isv_svn_t *p_pce_isv_svn),
               (const, override));
@@ -301,6 +304,75 @@ TEST_F(DcapIntelArchitecturalEnclaveInterfaceTests, GetQeQuoteFailure) {
               StatusIs(error::GoogleError::PERMISSION_DENIED));
 }
 
+TEST_F(DcapIntelArchitecturalEnclaveInterfaceTests,
+       EnableKeepWarmSetsPersistentLoadPolicy) {
+  EXPECT_CALL(*dcap_library_, QeSetEnclaveLoadPolicy(SGX_QL_PERSISTENT))
+      .WillOnce(Return(SGX_QL_SUCCESS));
+  ASYLO_EXPECT_OK(dcap_.EnableKeepWarm());
+}
+
+TEST_F(DcapIntelArchitecturalEnclaveInterfaceTests, EnableKeepWarmFailure) {
+  EXPECT_CALL(*dcap_library_, QeSetEnclaveLoadPolicy(SGX_QL_PERSISTENT))
+      .WillOnce(Return(SGX_QL_UNSUPPORTED_LOADING_POLICY));
+  EXPECT_THAT(dcap_.EnableKeepWarm(), Not(IsOk()));
+}
+
+TEST_F(DcapIntelArchitecturalEnclaveInterfaceTests,
+       KeepWarmCachesQeTargetinfo) {
+  const Targetinfo kExpectedTargetinfo = TrivialRandomObject<Targetinfo>();
+  EXPECT_CALL(*dcap_library_, QeSetEnclaveLoadPolicy(SGX_QL_PERSISTENT))
+      .WillOnce(Return(SGX_QL_SUCCESS));
+  EXPECT_CALL(*dcap_library_, QeGetTargetInfo(NotNull()))
+      .WillOnce(DoAll(
+          SetArgBuffer<0>(&kExpectedTargetinfo, sizeof(kExpectedTargetinfo)),
+          Return(SGX_QL_SUCCESS)));
+
+  ASYLO_ASSERT_OK(dcap_.EnableKeepWarm());
+  EXPECT_THAT(dcap_.GetQeTargetinfo(), IsOkAndHolds(kExpectedTargetinfo));
+  EXPECT_THAT(dcap_.GetQeTargetinfo(), IsOkAndHolds(kExpectedTargetinfo));
+}
+
+TEST_F(DcapIntelArchitecturalEnclaveInterfaceTests,
+       KeepWarmCacheIsDroppedWhenQeIsLost) {
+  const Targetinfo kExpectedTargetinfo = TrivialRandomObject<Targetinfo>();
+  constexpr uint32_t kFakeQuoteSize = 32;  // size is arbitrary
+  EXPECT_CALL(*dcap_library_, QeSetEnclaveLoadPolicy(SGX_QL_PERSISTENT))
+      .WillOnce(Return(SGX_QL_SUCCESS));
+  EXPECT_CALL(*dcap_library_, QeGetTargetInfo(NotNull()))
+      .Times(2)
+      .WillRepeatedly(DoAll(
+          SetArgBuffer<0>(&kExpectedTargetinfo, sizeof(kExpectedTargetinfo)),
+          Return(SGX_QL_SUCCESS)));
+  EXPECT_CALL(*dcap_library_, QeGetQuoteSize(NotNull()))
+      .WillOnce(
+          DoAll(SetArgPointee<0>(kFakeQuoteSize), Return(SGX_QL_SUCCESS)));
+  EXPECT_CALL(*dcap_library_, QeGetQuote(NotNull(), kFakeQuoteSize, NotNull()))
+      .WillOnce(Return(SGX_QL_ENCLAVE_LOST));
+
+  ASYLO_ASSERT_OK(dcap_.EnableKeepWarm());
+  ASYLO_ASSERT_OK(dcap_.GetQeTargetinfo());
+  EXPECT_THAT(dcap_.GetQeQuote(Report{}), Not(IsOk()));
+  EXPECT_THAT(dcap_.GetQeTargetinfo(), IsOkAndHolds(kExpectedTargetinfo));
+}
+
+TEST_F(DcapIntelArchitecturalEnclaveInterfaceTests,
+       GetQeQuotesQueriesQuoteSizeOnce) {
+  const std::vector<Report> kReports = {TrivialRandomObject<Report>(),
+                                        TrivialRandomObject<Report>()};
+  std::vector<uint8_t> quote(123);  // arbitrary quote size
+  std::iota(quote.begin(), quote.end(), 0);
+  EXPECT_CALL(*dcap_library_, QeGetQuoteSize(NotNull()))
+      .WillOnce(DoAll(SetArgPointee<0>(quote.size()), Return(SGX_QL_SUCCESS)));
+  EXPECT_CALL(*dcap_library_, QeGetQuote(NotNull(), quote.size(), NotNull()))
+      .Times(kReports.size())
+      .WillRepeatedly(
+          DoAll(SetArgContainer<2>(quote), Return(SGX_QL_SUCCESS)));
+
+  std::vector<std::vector<uint8_t>> quotes;
+  ASYLO_ASSERT_OK_AND_ASSIGN(quotes, dcap_.GetQeQuotes(kReports));
+  EXPECT_THAT(quotes, ElementsAre(quote, quote));
+}
+
 }  // namespace
 }  // namespace sgx
 }  // namespace asylo
@@ -41,6 +41,11 @@ class DcapLibraryInterface {
   // enumeration to indicate status.
   virtual quote3_error_t QeSetEnclaveDirpath(const char *dirpath) const = 0;
 
+  // Wraps sgx_qe_set_enclave_load_policy. Returns a value from the
+  // `quote3_error_t` enumeration to indicate status.
+  virtual quote3_error_t QeSetEnclaveLoadPolicy(
+      sgx_ql_request_policy_t policy) const = 0;
+
   // Wraps sgx_pce_get_target. Returns a value from the `sgx_pce_error_t`
   // enumeration to indicate status.
   virtual sgx_pce_error_t PceGetTarget(sgx_target_info_t *p_pce_target,
@@ -34,6 +34,13 @@ quote3_error_t EnclaveDcapLibraryInterface::QeSetEnclaveDirpath(
   return SGX_QL_INTERFACE_UNAVAILABLE;
 }
 
+quote3_error_t EnclaveDcapLibraryInterface::QeSetEnclaveLoadPolicy(
+    sgx_ql_request_policy_t policy) const {
+  // This API is not required inside of enclaves. The untrusted process that
+  // hosts the quoting enclave controls how long it stays loaded.
+  return SGX_QL_INTERFACE_UNAVAILABLE;
+}
+
 sgx_pce_error_t EnclaveDcapLibraryInterface::PceGetTarget(
     sgx_target_info_t *p_pce_target, sgx_isv_svn_t *p_pce_isv_svn) const {
   // This API is not required inside of enclaves.
@@ -38,6 +38,9 @@ class EnclaveDcapLibraryInterface : public DcapLibraryInterface {
 
   quote3_error_t QeSetEnclaveDirpath(const char *dirpath) const override;
 
+  quote3_error_t QeSetEnclaveLoadPolicy(
+      sgx_ql_request_policy_t policy) const override;
+
   sgx_pce_error_t PceGetTarget(sgx_target_info_t *p_pce_target,
                                sgx_isv_svn_t *p_pce_isv_svn) const override;
 
@@ -34,6 +34,11 @@ quote3_error_t HostDcapLibraryInterface::QeSetEnclaveDirpath(
   return sgx_qe_set_enclave_dirpath(dirpath);
 }
 
+quote3_error_t HostDcapLibraryInterface::QeSetEnclaveLoadPolicy(
+    sgx_ql_request_policy_t policy) const {
+  return sgx_qe_set_enclave_load_policy(policy);
+}
+
 sgx_pce_error_t HostDcapLibraryInterface::PceGetTarget(
     sgx_target_info_t *p_pce_target, sgx_isv_svn_t *p_pce_isv_svn) const {
   return sgx_pce_get_target(p_pce_target, p_pce_isv_svn);
@@ -30,11 +30,24 @@
 namespace asylo {
 namespace sgx {
 
-StatusOr<IntelQeQuote> ParseDcapPackedQuote(ByteContainerView packed_quote) {
+namespace {
+
+// Returns the object of type T that |view| holds. T must be a packed structure,
+// so that it can be read from any offset in a packed quote.
+template <typename T>
+const T *ViewAs(ByteContainerView view) {
+  static_assert(alignof(T) == 1, "T must be packed");
+  return reinterpret_cast<const T *>(view.data());
+}
+
+}  // namespace
+
+StatusOr<IntelQeQuoteView> IntelQeQuoteView::Create(
+    ByteContainerView packed_quote) {
   ByteContainerReader reader(packed_quote);
-  IntelQeQuote quote;
-  ASYLO_RETURN_IF_ERROR(reader.ReadSingle(&quote.header));
-  ASYLO_RETURN_IF_ERROR(reader.ReadSingle(&quote.body));
+  ByteContainerView signed_data(packed_quote.data(), 0);
+  ASYLO_RETURN_IF_ERROR(reader.ReadView(
+      sizeof(IntelQeQuoteHeader) + sizeof(ReportBody), &signed_data));
 
   // |signature_size| is called "Quote Signature Data Len" in the Intel SGX
   // ECDSA QuoteGenReference API doc. It's the length of the "Quote Signature
@@ -48,20 +61,22 @@ StatusOr<IntelQeQuote> ParseDcapPackedQuote(ByteContainerView packed_quote) {
                       reader.BytesRemaining(), signature_size));
   }
 
-  ASYLO_RETURN_IF_ERROR(reader.ReadSingle(&quote.signature));
+  ByteContainerView signature(packed_quote.data(), 0);
+  ASYLO_RETURN_IF_ERROR(
+      reader.ReadView(sizeof(IntelEcdsaP256QuoteSignature), &signature));
 
   uint16_t authn_data_size = 0;
   ASYLO_RETURN_IF_ERROR(reader.ReadSingle(&authn_data_size));
-  quote.qe_authn_data.reserve(authn_data_size);
-  ASYLO_RETURN_IF_ERROR(
-      reader.ReadMultiple(authn_data_size, &quote.qe_authn_data));
-  ASYLO_RETURN_IF_ERROR(reader.ReadSingle(&quote.cert_data.qe_cert_data_type));
+  ByteContainerView qe_authn_data(packed_quote.data(), 0);
+  ASYLO_RETURN_IF_ERROR(reader.ReadView(authn_data_size, &qe_authn_data));
+
+  uint16_t qe_cert_data_type = 0;
+  ASYLO_RETURN_IF_ERROR(reader.ReadSingle(&qe_cert_data_type));
 
   uint32_t cert_data_size = 0;
   ASYLO_RETURN_IF_ERROR(reader.ReadSingle(&cert_data_size));
-  quote.cert_data.qe_cert_data.reserve(cert_data_size);
-  ASYLO_RETURN_IF_ERROR(
-      reader.ReadMultiple(cert_data_size, &quote.cert_data.qe_cert_data));
+  ByteContainerView qe_cert_data(packed_quote.data(), 0);
+  ASYLO_RETURN_IF_ERROR(reader.ReadView(cert_data_size, &qe_cert_data));
 
   if (reader.BytesRemaining() != 0) {
     return Status(
@@ -70,9 +85,47 @@ StatusOr<IntelQeQuote> ParseDcapPackedQuote(ByteContainerView packed_quote) {
                         reader.BytesRemaining()));
   }
 
+  return IntelQeQuoteView(signed_data,
+                          ViewAs<IntelEcdsaP256QuoteSignature>(signature),
+                          qe_authn_data, qe_cert_data_type, qe_cert_data);
+}
+
+IntelQeQuoteView::IntelQeQuoteView(
+    ByteContainerView signed_data,
+    const IntelEcdsaP256QuoteSignature *signature,
+    ByteContainerView qe_authn_data, uint16_t qe_cert_data_type,
+    ByteContainerView qe_cert_data)
+    : header_(ViewAs<IntelQeQuoteHeader>(signed_data)),
+      body_(ViewAs<ReportBody>(ByteContainerView(
+          signed_data.data() + sizeof(IntelQeQuoteHeader),
+          signed_data.size() - sizeof(IntelQeQuoteHeader)))),
+      signed_data_(signed_data),
+      signature_(signature),
+      qe_authn_data_(qe_authn_data),
+      qe_cert_data_type_(qe_cert_data_type),
+      qe_cert_data_(qe_cert_data) {}
+
+IntelQeQuote IntelQeQuoteView::ToIntelQeQuote() const {
+  IntelQeQuote quote;
+  quote.header = header();
+  quote.body = body();
+  quote.signature = signature();
+  quote.qe_authn_data.assign(qe_authn_data_.begin(), qe_authn_data_.end());
+  quote.cert_data.qe_cert_data_type = qe_cert_data_type_;
+  quote.cert_data.qe_cert_data.assign(qe_cert_data_.begin(),
+                                      qe_cert_data_.end());
   return quote;
 }
 
+StatusOr<IntelQeQuote> ParseDcapPackedQuote(ByteContainerView packed_quote) {
+  StatusOr<IntelQeQuoteView> view_result =
+      IntelQeQuoteView::Create(packed_quote);
+  if (!view_result.ok()) {
+    return view_result.status();
+  }
+  return view_result.ValueOrDie().ToIntelQeQuote();
+}
+
 std::vector<uint8_t> PackDcapQuote(const IntelQeQuote &quote) {
   const uint16_t kSizeOfQeAuthData = quote.qe_authn_data.size();
   const uint32_t kSizeOfQeCertData = quote.cert_data.qe_cert_data.size();
@@ -98,7 +151,7 @@ std::vector<uint8_t> PackDcapQuote(const IntelQeQuote &quote) {
 }
 
 StatusOr<Assertion> PackedQuoteToAssertion(ByteContainerView packed_quote) {
-  ASYLO_RETURN_IF_ERROR(ParseDcapPackedQuote(packed_quote));
+  ASYLO_RETURN_IF_ERROR(IntelQeQuoteView::Create(packed_quote).status());
 
   Assertion assertion;
   SetSgxIntelEcdsaQeRemoteAssertionDescription(assertion.mutable_description());
@@ -122,7 +175,8 @@ StatusOr<std::vector<uint8_t>> AssertionToPackedQuote(
                                assertion.description().authority_type()));
   }
 
-  ASYLO_RETURN_IF_ERROR(ParseDcapPackedQuote(assertion.assertion()));
+  ASYLO_RETURN_IF_ERROR(
+      IntelQeQuoteView::Create(assertion.assertion()).status());
 
   return std::vector<uint8_t>{assertion.assertion().begin(),
                               assertion.assertion().end()};
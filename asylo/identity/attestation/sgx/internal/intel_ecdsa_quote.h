@@ -114,6 +114,50 @@ struct IntelQeQuote {
   IntelCertData cert_data;
 };
 
+// A read-only view of a quote that was generated by the Intel DCAP library. The
+// view refers to the packed quote bytes instead of copying them, so those bytes
+// must outlive the view and any fields obtained from it. Like
+// ParseDcapPackedQuote, creating a view checks only that the byte layout is
+// correct, and does not perform any semantic validation of the quote.
+class IntelQeQuoteView {
+ public:
+  // Creates a view of |packed_quote|.
+  static StatusOr<IntelQeQuoteView> Create(ByteContainerView packed_quote);
+
+  const IntelQeQuoteHeader &header() const { return *header_; }
+
+  const ReportBody &body() const { return *body_; }
+
+  // Returns the bytes that are signed by |signature().body_signature|, that
+  // is, the header followed by the body.
+  ByteContainerView signed_data() const { return signed_data_; }
+
+  const IntelEcdsaP256QuoteSignature &signature() const { return *signature_; }
+
+  ByteContainerView qe_authn_data() const { return qe_authn_data_; }
+
+  uint16_t qe_cert_data_type() const { return qe_cert_data_type_; }
+
+  ByteContainerView qe_cert_data() const { return qe_cert_data_; }
+
+  // Copies the viewed quote into an IntelQeQuote.
+  IntelQeQuote ToIntelQeQuote() const;
+
+ private:
+  IntelQeQuoteView(ByteContainerView signed_data,
+                   const IntelEcdsaP256QuoteSignature *signature,
+                   ByteContainerView qe_authn_data, uint16_t qe_cert_data_type,
+                   ByteContainerView qe_cert_data);
+
+  const IntelQeQuoteHeader *header_;
+  const ReportBody *body_;
+  ByteContainerView signed_data_;
+  const IntelEcdsaP256QuoteSignature *signature_;
+  ByteContainerView qe_authn_data_;
+  uint16_t qe_cert_data_type_;
+  ByteContainerView qe_cert_data_;
+};
+
 // Parses a |packed_quote| that was generated by the Intel DCAP library, which
 // generates quotes into a contiguous byte buffer. The output is a structured,
 // verifiable quote. This function does not perform any semantic validation of
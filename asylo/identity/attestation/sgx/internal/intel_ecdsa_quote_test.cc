@@ -110,6 +110,44 @@ TEST_F(IntelEcdsaQuoteTest, ParseQuoteFailsDueToInputBufferBeingTooSmall) {
   } while (!packed_quote.empty());
 }
 
+TEST_F(IntelEcdsaQuoteTest, ViewReferencesPackedQuote) {
+  const IntelQeQuote kExpectedQuote = CreateRandomValidQuote();
+  const std::vector<uint8_t> packed_quote = PackDcapQuote(kExpectedQuote);
+
+  auto view_result = IntelQeQuoteView::Create(packed_quote);
+  ASYLO_ASSERT_OK(view_result);
+  const IntelQeQuoteView &view = view_result.ValueOrDie();
+  EXPECT_THAT(view.header(), TrivialObjectEq(kExpectedQuote.header));
+  EXPECT_THAT(view.body(), TrivialObjectEq(kExpectedQuote.body));
+  EXPECT_THAT(view.signature(), TrivialObjectEq(kExpectedQuote.signature));
+  EXPECT_THAT(view.qe_authn_data(),
+              ElementsAreArray(kExpectedQuote.qe_authn_data));
+  EXPECT_THAT(view.qe_cert_data_type(),
+              Eq(kExpectedQuote.cert_data.qe_cert_data_type));
+  EXPECT_THAT(view.qe_cert_data(),
+              ElementsAreArray(kExpectedQuote.cert_data.qe_cert_data));
+
+  // The signed data is the header and body at the start of the packed quote.
+  EXPECT_THAT(view.signed_data().data(), Eq(packed_quote.data()));
+  EXPECT_THAT(view.signed_data().size(),
+              Eq(sizeof(kExpectedQuote.header) + sizeof(kExpectedQuote.body)));
+  EXPECT_THAT(reinterpret_cast<const uint8_t *>(&view.signature()),
+              Eq(packed_quote.data() + view.signed_data().size() +
+                 sizeof(uint32_t)));
+
+  ExpectQuoteEquals(view.ToIntelQeQuote(), kExpectedQuote);
+}
+
+TEST_F(IntelEcdsaQuoteTest, CreateViewFailsDueToInputBufferBeingTooSmall) {
+  std::vector<uint8_t> packed_quote =
+      PackDcapQuote(CreateRandomValidQuote());
+  do {
+    packed_quote.pop_back();
+    EXPECT_THAT(IntelQeQuoteView::Create(packed_quote),
+                StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  } while (!packed_quote.empty());
+}
+
 TEST_F(IntelEcdsaQuoteTest, RoundTripPackUnpackPack) {
   auto packed_quote = PackDcapQuote(CreateRandomValidQuote());
 
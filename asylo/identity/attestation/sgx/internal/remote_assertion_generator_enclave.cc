@@ -18,6 +18,7 @@
 
 #include "asylo/identity/attestation/sgx/internal/remote_assertion_generator_enclave.h"
 
+#include <cstddef>
 #include <memory>
 #include <utility>
 
@@ -40,9 +41,17 @@
 
 namespace asylo {
 namespace sgx {
+namespace {
+
+// Number of signing nonces precomputed for a new attestation key, which lets
+// the first assertions signed by the key skip the costly part of signing.
+constexpr size_t kAttestationKeyPrecomputedNonces = 64;
+
+}  // namespace
 
 RemoteAssertionGeneratorEnclave::RemoteAssertionGeneratorEnclave()
     : attestation_key_certs_pair_(AttestationKeyCertsPair()),
+      standby_attestation_key_(nullptr),
       server_service_pair_(ServerServicePair()),
       verification_config_(/*all_fields=*/true) {}
 
@@ -89,8 +98,11 @@ Status RemoteAssertionGeneratorEnclave::Run(const EnclaveInput &input,
           enclave_input.generate_key_and_csr_input(),
           enclave_output->mutable_generate_key_and_csr_output());
     case RemoteAssertionGeneratorEnclaveInput::kUpdateCertsInput:
-      return UpdateCerts(enclave_input.update_certs_input(),
-                         enclave_output->mutable_update_certs_output());
+      ASYLO_RETURN_IF_ERROR(
+          UpdateCerts(enclave_input.update_certs_input(),
+                      enclave_output->mutable_update_certs_output()));
+      ReplenishStandbyAttestationKey();
+      return Status::OkStatus();
     case RemoteAssertionGeneratorEnclaveInput::kGetEnclaveIdentityInput:
       SetSelfSgxIdentity(enclave_output->mutable_get_enclave_identity_output()
                              ->mutable_sgx_identity());
@@ -178,7 +190,7 @@ Status RemoteAssertionGeneratorEnclave::GeneratePceInfoSgxHardwareReport(
 Status RemoteAssertionGeneratorEnclave::GenerateKeyAndCsr(
     const GenerateKeyAndCsrInput &input, GenerateKeyAndCsrOutput *output) {
   std::unique_ptr<EcdsaP256Sha256SigningKey> signing_key;
-  ASYLO_ASSIGN_OR_RETURN(signing_key, EcdsaP256Sha256SigningKey::Create());
+  ASYLO_ASSIGN_OR_RETURN(signing_key, TakeStandbyAttestationKey());
   std::unique_ptr<VerifyingKey> verifying_key;
   ASYLO_ASSIGN_OR_RETURN(verifying_key, signing_key->GetVerifyingKey());
 
@@ -252,6 +264,37 @@ Status RemoteAssertionGeneratorEnclave::UpdateCerts(
   return Status::OkStatus();
 }
 
+StatusOr<std::unique_ptr<EcdsaP256Sha256SigningKey>>
+RemoteAssertionGeneratorEnclave::TakeStandbyAttestationKey() {
+  std::unique_ptr<EcdsaP256Sha256SigningKey> signing_key =
+      std::move(*standby_attestation_key_.Lock());
+  if (signing_key) {
+    return std::move(signing_key);
+  }
+  ASYLO_ASSIGN_OR_RETURN(signing_key, EcdsaP256Sha256SigningKey::Create());
+  ASYLO_RETURN_IF_ERROR(signing_key->PrecomputeNonces(
+      kAttestationKeyPrecomputedNonces, /*executor=*/nullptr));
+  return std::move(signing_key);
+}
+
+void RemoteAssertionGeneratorEnclave::ReplenishStandbyAttestationKey() {
+  if (*standby_attestation_key_.ReaderLock()) {
+    return;
+  }
+  StatusOr<std::unique_ptr<EcdsaP256Sha256SigningKey>> signing_key_result =
+      TakeStandbyAttestationKey();
+  if (!signing_key_result.ok()) {
+    LOG(WARNING) << "Failed to generate standby attestation key: "
+                 << signing_key_result.status();
+    return;
+  }
+  auto standby_attestation_key_locked = standby_attestation_key_.Lock();
+  if (!*standby_attestation_key_locked) {
+    *standby_attestation_key_locked =
+        std::move(signing_key_result).ValueOrDie();
+  }
+}
+
 }  // namespace sgx
 
 TrustedApplication *BuildTrustedApplication() {
@@ -24,6 +24,7 @@
 
 #include "asylo/crypto/certificate.pb.h"
 #include "asylo/crypto/certificate_interface.h"
+#include "asylo/crypto/ecdsa_p256_sha256_signing_key.h"
 #include "asylo/crypto/signing_key.h"
 #include "asylo/enclave.pb.h"
 #include "asylo/identity/attestation/sgx/internal/remote_assertion_generator_enclave.pb.h"
@@ -77,7 +78,8 @@ class RemoteAssertionGeneratorEnclave final : public TrustedApplication {
       const GeneratePceInfoSgxHardwareReportInput &input,
       GeneratePceInfoSgxHardwareReportOutput *output);
 
-  // Generates a new value for |attestation_key_|. If TARGETINFO is specified in
+  // Generates a new value for |attestation_key_|, taking the standby
+  // attestation key if there is one. If TARGETINFO is specified in
   // |input|, this method also generates an SGX hardware REPORT that is suitable
   // for use in the PCE's SignReport protocol. This function can also be used to
   // generate certificate signing requests for certificate authorities.
@@ -95,9 +97,24 @@ class RemoteAssertionGeneratorEnclave final : public TrustedApplication {
   // generated by GenerateKeyAndCsr.
   Status UpdateCerts(const UpdateCertsInput &input, UpdateCertsOutput *output);
 
+  // Returns the standby attestation key and clears it, or generates a new
+  // attestation key if there is no standby key.
+  StatusOr<std::unique_ptr<EcdsaP256Sha256SigningKey>>
+  TakeStandbyAttestationKey();
+
+  // Generates a standby attestation key, unless there is one already. Called
+  // after a key rotation completes, so that the next rotation does not wait
+  // for key generation.
+  void ReplenishStandbyAttestationKey();
+
   // A guarded struct that holds attestation key and certificates.
   MutexGuarded<AttestationKeyCertsPair> attestation_key_certs_pair_;
 
+  // An attestation key that is ready to be used by the next key rotation, or
+  // nullptr.
+  MutexGuarded<std::unique_ptr<EcdsaP256Sha256SigningKey>>
+      standby_attestation_key_;
+
   // A guarded struct that holds remote assertion generator server and remote
   // assertion generator service.
   MutexGuarded<ServerServicePair> server_service_pair_;
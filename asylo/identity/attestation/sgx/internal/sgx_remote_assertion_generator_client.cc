@@ -18,6 +18,11 @@
 
 #include "asylo/identity/attestation/sgx/internal/sgx_remote_assertion_generator_client.h"
 
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
 #include "asylo/util/status.h"
 #include "include/grpcpp/client_context.h"
 
@@ -25,11 +30,12 @@ namespace asylo {
 
 SgxRemoteAssertionGeneratorClient::SgxRemoteAssertionGeneratorClient(
     const std::shared_ptr<::grpc::ChannelInterface> &channel)
-    : stub_(SgxRemoteAssertionGenerator::NewStub(channel)) {}
+    : stub_(SgxRemoteAssertionGenerator::NewStub(channel)),
+      certificate_chains_(nullptr) {}
 
 SgxRemoteAssertionGeneratorClient::SgxRemoteAssertionGeneratorClient(
     std::unique_ptr<SgxRemoteAssertionGenerator::StubInterface> stub)
-    : stub_(std::move(stub)) {}
+    : stub_(std::move(stub)), certificate_chains_(nullptr) {}
 
 StatusOr<sgx::RemoteAssertion>
 SgxRemoteAssertionGeneratorClient::GenerateSgxRemoteAssertion(
@@ -49,4 +55,63 @@ SgxRemoteAssertionGeneratorClient::GenerateSgxRemoteAssertion(
   return response.assertion();
 }
 
+StatusOr<std::vector<sgx::RemoteAssertion>>
+SgxRemoteAssertionGeneratorClient::GenerateSgxRemoteAssertions(
+    absl::Span<const ByteContainerView> user_data) {
+  ::grpc::ClientContext context;
+
+  std::shared_ptr<const CertificateChains> known_certificate_chains =
+      *certificate_chains_.ReaderLock();
+  GenerateSgxRemoteAssertionsRequest request;
+  for (ByteContainerView data : user_data) {
+    request.add_user_data(data.data(), data.size());
+  }
+  if (known_certificate_chains != nullptr) {
+    request.set_known_certificate_chains_digest(
+        known_certificate_chains->digest);
+  }
+  GenerateSgxRemoteAssertionsResponse response;
+
+  ::grpc::Status status =
+      stub_->GenerateSgxRemoteAssertions(&context, request, &response);
+  if (!status.ok()) {
+    return Status(status);
+  }
+
+  if (response.assertions_size() != request.user_data_size()) {
+    return Status(error::GoogleError::INTERNAL,
+                  absl::StrCat("Expected ", request.user_data_size(),
+                               " assertions but received ",
+                               response.assertions_size()));
+  }
+
+  std::shared_ptr<const CertificateChains> certificate_chains;
+  if (known_certificate_chains != nullptr &&
+      !response.certificate_chains_digest().empty() &&
+      response.certificate_chains_digest() ==
+          known_certificate_chains->digest &&
+      response.certificate_chains().empty()) {
+    certificate_chains = std::move(known_certificate_chains);
+  } else {
+    certificate_chains = std::make_shared<const CertificateChains>(
+        CertificateChains{response.certificate_chains_digest(),
+                          std::vector<CertificateChain>(
+                              response.certificate_chains().begin(),
+                              response.certificate_chains().end())});
+    if (!certificate_chains->digest.empty()) {
+      *certificate_chains_.Lock() = certificate_chains;
+    }
+  }
+
+  std::vector<sgx::RemoteAssertion> assertions;
+  assertions.reserve(response.assertions_size());
+  for (sgx::RemoteAssertion &assertion : *response.mutable_assertions()) {
+    for (const CertificateChain &chain : certificate_chains->chains) {
+      *assertion.add_certificate_chains() = chain;
+    }
+    assertions.push_back(std::move(assertion));
+  }
+  return assertions;
+}
+
 }  // namespace asylo
@@ -20,10 +20,15 @@
 #define ASYLO_IDENTITY_ATTESTATION_SGX_INTERNAL_SGX_REMOTE_ASSERTION_GENERATOR_CLIENT_H_
 
 #include <memory>
+#include <string>
+#include <vector>
 
+#include "absl/types/span.h"
+#include "asylo/crypto/certificate.pb.h"
 #include "asylo/crypto/util/byte_container_view.h"
 #include "asylo/identity/attestation/sgx/internal/remote_assertion.pb.h"
 #include "asylo/identity/attestation/sgx/internal/sgx_remote_assertion_generator.grpc.pb.h"
+#include "asylo/util/mutex_guarded.h"
 #include "asylo/util/statusor.h"
 #include "include/grpcpp/grpcpp.h"
 
@@ -48,8 +53,29 @@ class SgxRemoteAssertionGeneratorClient {
   StatusOr<sgx::RemoteAssertion> GenerateSgxRemoteAssertion(
       ByteContainerView user_data);
 
+  // Requests one SGX remote assertion for each element of |user_data| from the
+  // remote server in a single RPC. The returned assertions are in the same
+  // order as |user_data|.
+  //
+  // The client remembers the certificate chains from the last response, so
+  // that the server does not resend them while they do not change.
+  StatusOr<std::vector<sgx::RemoteAssertion>> GenerateSgxRemoteAssertions(
+      absl::Span<const ByteContainerView> user_data);
+
  private:
+  // Certificate chains received from the remote server.
+  struct CertificateChains {
+    // The digest that identifies |chains|.
+    std::string digest;
+
+    std::vector<CertificateChain> chains;
+  };
+
   std::unique_ptr<SgxRemoteAssertionGenerator::StubInterface> stub_;
+
+  // The certificate chains from the last GenerateSgxRemoteAssertions response,
+  // or nullptr if there are none.
+  MutexGuarded<std::shared_ptr<const CertificateChains>> certificate_chains_;
 };
 
 }  // namespace asylo
@@ -18,6 +18,8 @@
 
 #include "asylo/identity/attestation/sgx/internal/sgx_remote_assertion_generator_client.h"
 
+#include <string>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "absl/memory/memory.h"
@@ -36,10 +38,23 @@ namespace {
 
 using ::testing::_;
 using ::testing::DoAll;
+using ::testing::ElementsAre;
 using ::testing::Return;
 using ::testing::SetArgPointee;
 
 constexpr char kUserData[] = "Foo Bar Baz";
+constexpr char kOtherUserData[] = "Qux Quux";
+constexpr char kCertificateChainsDigest[] = "digest";
+
+// Returns an assertion without certificate chains that is bound to
+// |user_data|.
+sgx::RemoteAssertion MakeAssertionWithoutCertificateChains(
+    const std::string &user_data) {
+  sgx::RemoteAssertion assertion;
+  assertion.set_payload(user_data);
+  assertion.set_signature("signature");
+  return assertion;
+}
 
 // Tests that the SgxRemoteAssertionGeneratorClient correctly propagates the
 // result from a successful GenerateSgxRemoteAssertion RPC.
@@ -98,5 +113,89 @@ TEST(SgxRemoteAssertionGeneratorClientTest, GenerateSgxRemoteAssertionFails) {
               StatusIs(error::GoogleError::PERMISSION_DENIED));
 }
 
+// Tests that the SgxRemoteAssertionGeneratorClient attaches the certificate
+// chains to every assertion from a GenerateSgxRemoteAssertions RPC, and reuses
+// them when the server does not resend them.
+TEST(SgxRemoteAssertionGeneratorClientTest,
+     GenerateSgxRemoteAssertionsReusesCertificateChains) {
+  auto mock_stub =
+      absl::make_unique<MockSgxRemoteAssertionGeneratorStub>();
+
+  CertificateChain certificate_chain;
+  Certificate &certificate = *certificate_chain.add_certificates();
+  certificate.set_format(Certificate::X509_DER);
+  certificate.set_data("certificate data");
+
+  GenerateSgxRemoteAssertionsRequest first_request;
+  first_request.add_user_data(kUserData);
+  first_request.add_user_data(kOtherUserData);
+  GenerateSgxRemoteAssertionsResponse first_response;
+  *first_response.add_assertions() =
+      MakeAssertionWithoutCertificateChains(kUserData);
+  *first_response.add_assertions() =
+      MakeAssertionWithoutCertificateChains(kOtherUserData);
+  first_response.set_certificate_chains_digest(kCertificateChainsDigest);
+  *first_response.add_certificate_chains() = certificate_chain;
+
+  GenerateSgxRemoteAssertionsRequest second_request;
+  second_request.add_user_data(kOtherUserData);
+  second_request.set_known_certificate_chains_digest(kCertificateChainsDigest);
+  GenerateSgxRemoteAssertionsResponse second_response;
+  *second_response.add_assertions() =
+      MakeAssertionWithoutCertificateChains(kOtherUserData);
+  second_response.set_certificate_chains_digest(kCertificateChainsDigest);
+
+  EXPECT_CALL(*mock_stub,
+              GenerateSgxRemoteAssertions(_, EqualsProto(first_request), _))
+      .WillOnce(DoAll(SetArgPointee<2>(first_response),
+                      Return(::grpc::Status::OK)));
+  EXPECT_CALL(*mock_stub,
+              GenerateSgxRemoteAssertions(_, EqualsProto(second_request), _))
+      .WillOnce(DoAll(SetArgPointee<2>(second_response),
+                      Return(::grpc::Status::OK)));
+
+  SgxRemoteAssertionGeneratorClient client(
+      std::unique_ptr<SgxRemoteAssertionGenerator::StubInterface>(
+          std::move(mock_stub)));
+
+  sgx::RemoteAssertion expected_assertion =
+      MakeAssertionWithoutCertificateChains(kUserData);
+  *expected_assertion.add_certificate_chains() = certificate_chain;
+  sgx::RemoteAssertion expected_other_assertion =
+      MakeAssertionWithoutCertificateChains(kOtherUserData);
+  *expected_other_assertion.add_certificate_chains() = certificate_chain;
+
+  auto result = client.GenerateSgxRemoteAssertions({kUserData, kOtherUserData});
+  ASSERT_THAT(result, IsOk());
+  EXPECT_THAT(result.ValueOrDie(),
+              ElementsAre(EqualsProto(expected_assertion),
+                          EqualsProto(expected_other_assertion)));
+
+  result = client.GenerateSgxRemoteAssertions({kOtherUserData});
+  ASSERT_THAT(result, IsOk());
+  EXPECT_THAT(result.ValueOrDie(),
+              ElementsAre(EqualsProto(expected_other_assertion)));
+}
+
+// Tests that the SgxRemoteAssertionGeneratorClient rejects a
+// GenerateSgxRemoteAssertions response with the wrong number of assertions.
+TEST(SgxRemoteAssertionGeneratorClientTest,
+     GenerateSgxRemoteAssertionsWithMissingAssertionsFails) {
+  auto mock_stub =
+      absl::make_unique<MockSgxRemoteAssertionGeneratorStub>();
+
+  GenerateSgxRemoteAssertionsResponse response;
+  *response.add_assertions() = MakeAssertionWithoutCertificateChains(kUserData);
+
+  EXPECT_CALL(*mock_stub, GenerateSgxRemoteAssertions(_, _, _))
+      .WillOnce(DoAll(SetArgPointee<2>(response), Return(::grpc::Status::OK)));
+
+  SgxRemoteAssertionGeneratorClient client(
+      std::unique_ptr<SgxRemoteAssertionGenerator::StubInterface>(
+          std::move(mock_stub)));
+  EXPECT_THAT(client.GenerateSgxRemoteAssertions({kUserData, kOtherUserData}),
+              StatusIs(error::GoogleError::INTERNAL));
+}
+
 }  // namespace
 }  // namespace asylo
@@ -18,16 +18,21 @@
 
 #include "asylo/identity/attestation/sgx/internal/sgx_remote_assertion_generator_impl.h"
 
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <vector>
 
+#include "absl/strings/str_cat.h"
+#include "asylo/crypto/sha256_hash.h"
 #include "asylo/grpc/auth/enclave_auth_context.h"
 #include "asylo/identity/attestation/sgx/internal/remote_assertion_util.h"
 #include "asylo/identity/descriptions.h"
 #include "asylo/identity/platform/sgx/sgx_identity_util.h"
-#include "asylo/util/mutex_guarded.h"
+#include "asylo/util/read_mostly_guarded.h"
 #include "asylo/util/status.h"
 #include "asylo/util/status_macros.h"
+#include "asylo/util/statusor.h"
 #include "include/grpcpp/support/status.h"
 
 namespace asylo {
@@ -50,22 +55,33 @@ Status ExtractSgxIdentity(const EnclaveAuthContext &auth_context,
   return Status::OkStatus();
 }
 
-}  // namespace
+// Returns a SHA-256 digest over the serialized |certificate_chains|.
+StatusOr<std::string> DigestCertificateChains(
+    const std::vector<CertificateChain> &certificate_chains) {
+  Sha256Hash hash;
+  std::string serialized;
+  for (const CertificateChain &chain : certificate_chains) {
+    if (!chain.SerializeToString(&serialized)) {
+      return Status(error::GoogleError::INTERNAL,
+                    "Failed to serialize certificate chain");
+    }
+    // Prefix each chain with its length so that the digest identifies the
+    // sequence of chains unambiguously.
+    hash.Update(absl::StrCat(serialized.size(), ":"));
+    hash.Update(serialized);
+  }
+  std::vector<uint8_t> digest;
+  ASYLO_RETURN_IF_ERROR(hash.CumulativeHash(&digest));
+  return std::string(digest.begin(), digest.end());
+}
 
-SgxRemoteAssertionGeneratorImpl::SgxRemoteAssertionGeneratorImpl()
-    : signing_key_(nullptr),
-      certificate_chains_(std::vector<CertificateChain>()) {}
+}  // namespace
 
-SgxRemoteAssertionGeneratorImpl::SgxRemoteAssertionGeneratorImpl(
-    std::unique_ptr<SigningKey> signing_key,
-    const std::vector<CertificateChain> &certificate_chains)
-    : signing_key_(std::move(signing_key)),
-      certificate_chains_(certificate_chains) {}
+constexpr int SgxRemoteAssertionGeneratorImpl::kMaxAssertionsPerRequest;
 
-::grpc::Status SgxRemoteAssertionGeneratorImpl::GenerateSgxRemoteAssertion(
-    ::grpc::ServerContext *context,
-    const GenerateSgxRemoteAssertionRequest *request,
-    GenerateSgxRemoteAssertionResponse *response) {
+::grpc::Status SgxRemoteAssertionGeneratorImpl::GetPeerIdentityAndSigningState(
+    ::grpc::ServerContext *context, SgxIdentity *sgx_identity,
+    std::shared_ptr<const SigningState> *signing_state) {
   StatusOr<EnclaveAuthContext> auth_context_result =
       EnclaveAuthContext::CreateFromAuthContext(*context->auth_context());
   if (!auth_context_result.ok()) {
@@ -77,22 +93,46 @@ SgxRemoteAssertionGeneratorImpl::SgxRemoteAssertionGeneratorImpl(
   }
   EnclaveAuthContext auth_context = auth_context_result.ValueOrDie();
 
-  SgxIdentity sgx_identity;
-  Status status = ExtractSgxIdentity(auth_context, &sgx_identity);
+  Status status = ExtractSgxIdentity(auth_context, sgx_identity);
   if (!status.ok()) {
     return status.ToOtherStatus<::grpc::Status>();
   }
-  auto signing_key_locked = signing_key_.ReaderLock();
 
-  if (*signing_key_locked == nullptr) {
+  *signing_state = *signing_state_.ReaderLock();
+  if (*signing_state == nullptr) {
     return ::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION,
                           "No attestation key available");
   }
+  return ::grpc::Status::OK;
+}
+
+SgxRemoteAssertionGeneratorImpl::SgxRemoteAssertionGeneratorImpl()
+    : signing_state_(nullptr) {}
+
+SgxRemoteAssertionGeneratorImpl::SgxRemoteAssertionGeneratorImpl(
+    std::unique_ptr<SigningKey> signing_key,
+    const std::vector<CertificateChain> &certificate_chains)
+    : signing_state_(nullptr) {
+  UpdateSigningKeyAndCertificateChains(std::move(signing_key),
+                                       certificate_chains);
+}
 
-  auto certificate_chains_locked = certificate_chains_.ReaderLock();
-  status = MakeRemoteAssertion(request->user_data(), sgx_identity,
-                               **signing_key_locked, *certificate_chains_locked,
-                               response->mutable_assertion());
+::grpc::Status SgxRemoteAssertionGeneratorImpl::GenerateSgxRemoteAssertion(
+    ::grpc::ServerContext *context,
+    const GenerateSgxRemoteAssertionRequest *request,
+    GenerateSgxRemoteAssertionResponse *response) {
+  SgxIdentity sgx_identity;
+  std::shared_ptr<const SigningState> signing_state;
+  ::grpc::Status grpc_status =
+      GetPeerIdentityAndSigningState(context, &sgx_identity, &signing_state);
+  if (!grpc_status.ok()) {
+    return grpc_status;
+  }
+
+  Status status = MakeRemoteAssertion(request->user_data(), sgx_identity,
+                                      *signing_state->signing_key,
+                                      signing_state->certificate_chains,
+                                      response->mutable_assertion());
   if (!status.ok()) {
     LOG(ERROR) << "MakeRemoteAssertion failed: " << status;
     return ::grpc::Status(::grpc::StatusCode::INTERNAL,
@@ -101,13 +141,70 @@ SgxRemoteAssertionGeneratorImpl::SgxRemoteAssertionGeneratorImpl(
   return ::grpc::Status::OK;
 }
 
+::grpc::Status SgxRemoteAssertionGeneratorImpl::GenerateSgxRemoteAssertions(
+    ::grpc::ServerContext *context,
+    const GenerateSgxRemoteAssertionsRequest *request,
+    GenerateSgxRemoteAssertionsResponse *response) {
+  if (request->user_data_size() > kMaxAssertionsPerRequest) {
+    return ::grpc::Status(
+        ::grpc::StatusCode::INVALID_ARGUMENT,
+        absl::StrCat("Cannot generate more than ", kMaxAssertionsPerRequest,
+                     " assertions in one request"));
+  }
+
+  SgxIdentity sgx_identity;
+  std::shared_ptr<const SigningState> signing_state;
+  ::grpc::Status grpc_status =
+      GetPeerIdentityAndSigningState(context, &sgx_identity, &signing_state);
+  if (!grpc_status.ok()) {
+    return grpc_status;
+  }
+
+  // The certificate chains are shared by all assertions, so they are returned
+  // alongside the assertions rather than in each of them.
+  const std::vector<CertificateChain> no_certificate_chains;
+  for (const std::string &user_data : request->user_data()) {
+    Status status = MakeRemoteAssertion(user_data, sgx_identity,
+                                        *signing_state->signing_key,
+                                        no_certificate_chains,
+                                        response->add_assertions());
+    if (!status.ok()) {
+      LOG(ERROR) << "MakeRemoteAssertion failed: " << status;
+      response->Clear();
+      return ::grpc::Status(::grpc::StatusCode::INTERNAL,
+                            "Failed to generate SGX remote assertions");
+    }
+  }
+
+  const std::string &digest = signing_state->certificate_chains_digest;
+  response->set_certificate_chains_digest(digest);
+  if (digest.empty() || digest != request->known_certificate_chains_digest()) {
+    for (const CertificateChain &chain : signing_state->certificate_chains) {
+      *response->add_certificate_chains() = chain;
+    }
+  }
+  return ::grpc::Status::OK;
+}
+
 void SgxRemoteAssertionGeneratorImpl::UpdateSigningKeyAndCertificateChains(
     std::unique_ptr<SigningKey> signing_key,
     const std::vector<CertificateChain> &certificate_chains) {
-  auto signing_key_locked = signing_key_.Lock();
-  auto certificate_chains_locked = certificate_chains_.Lock();
-  *signing_key_locked = std::move(signing_key);
-  *certificate_chains_locked = certificate_chains;
+  std::shared_ptr<const SigningState> signing_state;
+  if (signing_key != nullptr) {
+    StatusOr<std::string> digest_result =
+        DigestCertificateChains(certificate_chains);
+    if (!digest_result.ok()) {
+      LOG(ERROR) << "Failed to digest certificate chains: "
+                 << digest_result.status();
+    }
+    signing_state = std::make_shared<const SigningState>(
+        SigningState{std::move(signing_key), certificate_chains,
+                     digest_result.ok() ? digest_result.ValueOrDie() : ""});
+  }
+
+  // The previous state is destroyed outside of the lock, once the last
+  // request using it completes.
+  signing_state_.Lock()->swap(signing_state);
 }
 
 }  // namespace asylo
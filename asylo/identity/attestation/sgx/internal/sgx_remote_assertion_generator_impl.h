@@ -20,12 +20,14 @@
 #define ASYLO_IDENTITY_ATTESTATION_SGX_INTERNAL_SGX_REMOTE_ASSERTION_GENERATOR_IMPL_H_
 
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "asylo/crypto/certificate.pb.h"
 #include "asylo/crypto/signing_key.h"
 #include "asylo/identity/attestation/sgx/internal/sgx_remote_assertion_generator.grpc.pb.h"
-#include "asylo/util/mutex_guarded.h"
+#include "asylo/identity/platform/sgx/sgx_identity.pb.h"
+#include "asylo/util/read_mostly_guarded.h"
 #include "asylo/util/status.h"
 #include "include/grpcpp/server_context.h"
 
@@ -40,6 +42,10 @@ namespace asylo {
 class SgxRemoteAssertionGeneratorImpl
     : public SgxRemoteAssertionGenerator::Service {
  public:
+  // The maximum number of assertions generated by a single
+  // GenerateSgxRemoteAssertions call.
+  static constexpr int kMaxAssertionsPerRequest = 256;
+
   SgxRemoteAssertionGeneratorImpl();
 
   // Creates a service that signs assertions with |signing_key| and uses
@@ -58,19 +64,50 @@ class SgxRemoteAssertionGeneratorImpl
       const GenerateSgxRemoteAssertionRequest *request,
       GenerateSgxRemoteAssertionResponse *response) override;
 
-  // Updates |signing_key_| and |certificate_chains_| with |signing_key| and
-  // |certificate_chains| respectively.
+  // Generates an SGX remote assertion for each user-data value in |request|,
+  // under the same conditions as GenerateSgxRemoteAssertion(). The certificate
+  // chains are written to |response| once, and only if the caller does not
+  // already have them. Returns an INVALID_ARGUMENT error if |request| contains
+  // more than kMaxAssertionsPerRequest user-data values.
+  ::grpc::Status GenerateSgxRemoteAssertions(
+      ::grpc::ServerContext *context,
+      const GenerateSgxRemoteAssertionsRequest *request,
+      GenerateSgxRemoteAssertionsResponse *response) override;
+
+  // Atomically replaces the signing key and certificate chains with
+  // |signing_key| and |certificate_chains|. Assertions that are being generated
+  // concurrently complete with the previous key, and the update does not wait
+  // for them.
   void UpdateSigningKeyAndCertificateChains(
       std::unique_ptr<SigningKey> signing_key,
       const std::vector<CertificateChain> &certificate_chains);
 
  private:
-  // The key used to sign attestations.
-  MutexGuarded<std::unique_ptr<SigningKey>> signing_key_;
+  // An attestation key and the certificate chains that certify it.
+  struct SigningState {
+    // The key used to sign attestations.
+    std::unique_ptr<SigningKey> signing_key;
+
+    // Certificate chains that serve to prove the authenticity of signatures
+    // produced by |signing_key|.
+    std::vector<CertificateChain> certificate_chains;
+
+    // A SHA-256 digest of |certificate_chains|, or an empty string if the
+    // digest could not be computed.
+    std::string certificate_chains_digest;
+  };
+
+  // Extracts the SGX identity of the caller described in |context| to
+  // |sgx_identity| and gets the current signing state in |signing_state|.
+  ::grpc::Status GetPeerIdentityAndSigningState(
+      ::grpc::ServerContext *context, SgxIdentity *sgx_identity,
+      std::shared_ptr<const SigningState> *signing_state);
 
-  // Certificate chains that serve to prove the authenticity of signatures
-  // produced by |signing_key_|.
-  MutexGuarded<std::vector<CertificateChain>> certificate_chains_;
+  // The current signing state, or nullptr if there is no attestation key.
+  // Requests hold a reference to the state they started with. Every request
+  // reads the pointer while it is replaced only on key updates, so readers
+  // never contend with each other.
+  ReadMostlyGuarded<std::shared_ptr<const SigningState>> signing_state_;
 };
 
 }  // namespace asylo
@@ -33,6 +33,7 @@
 #include "asylo/crypto/ecdsa_p256_sha256_signing_key.h"
 #include "asylo/crypto/keys.pb.h"
 #include "asylo/crypto/signing_key.h"
+#include "asylo/crypto/util/byte_container_view.h"
 #include "asylo/grpc/auth/enclave_channel_credentials.h"
 #include "asylo/grpc/auth/enclave_server_credentials.h"
 #include "asylo/grpc/auth/null_credentials_options.h"
@@ -270,6 +271,58 @@ TEST_F(SgxRemoteAssertionGeneratorImplTest,
       VerifyRemoteAssertion(assertion, certificate_chains_, *verifying_key_));
 }
 
+TEST_F(SgxRemoteAssertionGeneratorImplTest,
+       GenerateSgxRemoteAssertionsSucceeds) {
+  // Configure the server and the peer to use bidirectional authentication based
+  // on SGX local attestation. Each assertion in the batch should be a valid
+  // remote assertion, including when the certificate chains are not resent.
+  std::shared_ptr<::grpc::ServerCredentials> server_credentials =
+      EnclaveServerCredentials(BidirectionalSgxLocalCredentialsOptions());
+  std::unique_ptr<SgxRemoteAssertionGeneratorImpl> service;
+  ASYLO_ASSERT_OK_AND_ASSIGN(service, CreateServiceWithKeyAndCertificate());
+  SetUpServer(service.get(), server_credentials);
+
+  std::shared_ptr<::grpc::Channel> channel = ::grpc::CreateChannel(
+      server_address_,
+      EnclaveChannelCredentials(BidirectionalSgxLocalCredentialsOptions()));
+  gpr_timespec absolute_deadline =
+      gpr_time_add(gpr_now(GPR_CLOCK_REALTIME),
+                   gpr_time_from_micros(kDeadlineMicros, GPR_TIMESPAN));
+  ASSERT_TRUE(channel->WaitForConnected(absolute_deadline));
+
+  SgxRemoteAssertionGeneratorClient client(channel);
+  const std::vector<ByteContainerView> user_data(3, kUserData);
+  for (int i = 0; i < 2; ++i) {
+    std::vector<RemoteAssertion> assertions;
+    ASYLO_ASSERT_OK_AND_ASSIGN(assertions,
+                               client.GenerateSgxRemoteAssertions(user_data));
+    ASSERT_EQ(assertions.size(), user_data.size());
+    for (const RemoteAssertion &assertion : assertions) {
+      EXPECT_NO_FATAL_FAILURE(VerifyRemoteAssertion(
+          assertion, certificate_chains_, *verifying_key_));
+    }
+  }
+}
+
+TEST_F(SgxRemoteAssertionGeneratorImplTest,
+       GenerateSgxRemoteAssertionsWithTooManyUserDataFails) {
+  std::shared_ptr<::grpc::ServerCredentials> server_credentials =
+      EnclaveServerCredentials(BidirectionalSgxLocalCredentialsOptions());
+  std::unique_ptr<SgxRemoteAssertionGeneratorImpl> service;
+  ASYLO_ASSERT_OK_AND_ASSIGN(service, CreateServiceWithKeyAndCertificate());
+  SetUpServer(service.get(), server_credentials);
+
+  std::shared_ptr<::grpc::Channel> channel = ::grpc::CreateChannel(
+      server_address_,
+      EnclaveChannelCredentials(BidirectionalSgxLocalCredentialsOptions()));
+  SgxRemoteAssertionGeneratorClient client(channel);
+  const std::vector<ByteContainerView> user_data(
+      SgxRemoteAssertionGeneratorImpl::kMaxAssertionsPerRequest + 1,
+      kUserData);
+  EXPECT_THAT(client.GenerateSgxRemoteAssertions(user_data),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
 TEST_F(SgxRemoteAssertionGeneratorImplTest,
        UpdateSigningKeyAndCertificateChainsOnNoKeyServerSucceeds) {
   // Configure the server and the peer to use bidirectional authentication based
@@ -21,12 +21,16 @@
 #include <math.h>
 
 #include <algorithm>
+#include <cstdint>
 #include <iterator>
 #include <string>
+#include <vector>
 
 #include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "asylo/crypto/algorithms.pb.h"
 #include "asylo/crypto/certificate.pb.h"
 #include "asylo/crypto/certificate_interface.h"
@@ -36,6 +40,7 @@
 #include "asylo/crypto/sha256_hash.h"
 #include "asylo/crypto/sha256_hash.pb.h"
 #include "asylo/crypto/util/byte_container_util.h"
+#include "asylo/crypto/util/byte_container_view.h"
 #include "asylo/crypto/util/bytes.h"
 #include "asylo/crypto/util/trivial_object_util.h"
 #include "asylo/crypto/x509_certificate.h"
@@ -69,6 +74,14 @@
 namespace asylo {
 namespace {
 
+// The time for which a verified platform is trusted without verifying its
+// quoting enclave and PCK certificate chain again.
+constexpr absl::Duration kVerifiedPlatformLifetime = absl::Hours(1);
+
+// The maximum number of verified platforms that are cached per verifier. The
+// cache is cleared when it is full.
+constexpr size_t kMaxVerifiedPlatforms = 64;
+
 StatusOr<std::unique_ptr<EcdsaP256Sha256VerifyingKey>>
 ToEcdsaP256Sha256VerifyingKey(UnsafeBytes<64> big_endian_key_bytes) {
   EccP256CurvePoint public_key_point;
@@ -90,35 +103,35 @@ Status CheckDescription(const AssertionDescription &description) {
 }
 
 StatusOr<CertificateChain> GetPckCertificateChainFromCertData(
-    const std::vector<uint8_t> &cert_data) {
+    ByteContainerView cert_data) {
   return GetCertificateChainFromPem(absl::string_view(
       reinterpret_cast<const char *>(cert_data.data()), cert_data.size()));
 }
 
-Status VerifyQuoteHeader(const sgx::IntelQeQuote &quote) {
-  if (quote.header.version != intel::sgx::qvl::constants::QUOTE_VERSION) {
+Status VerifyQuoteHeader(const sgx::IntelQeQuoteView &quote) {
+  if (quote.header().version != intel::sgx::qvl::constants::QUOTE_VERSION) {
     return Status(error::GoogleError::INVALID_ARGUMENT,
                   absl::StrFormat("Invalid quote version '%d'. Expected '%d'",
-                                  quote.header.version,
+                                  quote.header().version,
                                   intel::sgx::qvl::constants::QUOTE_VERSION));
   }
 
-  if (quote.header.algorithm !=
+  if (quote.header().algorithm !=
       intel::sgx::qvl::constants::ECDSA_256_WITH_P256_CURVE) {
     return Status(
         error::GoogleError::INVALID_ARGUMENT,
         absl::StrFormat("Invalid quote algorithm '%d'. Expected '%d'",
-                        quote.header.algorithm,
+                        quote.header().algorithm,
                         intel::sgx::qvl::constants::ECDSA_256_WITH_P256_CURVE));
   }
 
-  if (!quote.header.qe_vendor_id.Equals(
+  if (!quote.header().qe_vendor_id.Equals(
           intel::sgx::qvl::constants::INTEL_QE_VENDOR_ID)) {
     return Status(
         error::GoogleError::INVALID_ARGUMENT,
         absl::StrFormat(
             "Invalid vendor ID '%s'. Expected '%s'",
-            ConvertTrivialObjectToHexString(quote.header.qe_vendor_id),
+            ConvertTrivialObjectToHexString(quote.header().qe_vendor_id),
             ConvertTrivialObjectToHexString(
                 intel::sgx::qvl::constants::INTEL_QE_VENDOR_ID)));
   }
@@ -128,36 +141,35 @@ Status VerifyQuoteHeader(const sgx::IntelQeQuote &quote) {
 
 Status VerifyQuoteBodySignature(
     const AdditionalAuthenticatedDataGenerator &aad_generator,
-    const std::string &user_data, const sgx::IntelQeQuote &quote) {
+    const std::string &user_data, const sgx::IntelQeQuoteView &quote) {
   UnsafeBytes<kAdditionalAuthenticatedDataSize> expected_auth_data;
   ASYLO_ASSIGN_OR_RETURN(expected_auth_data, aad_generator.Generate(user_data));
-  if (!expected_auth_data.Equals(quote.body.reportdata.data)) {
+  if (!expected_auth_data.Equals(quote.body().reportdata.data)) {
     return Status(error::GoogleError::INVALID_ARGUMENT,
                   "Authenticated quote data does not match expected user data");
   }
 
   std::unique_ptr<EcdsaP256Sha256VerifyingKey> verifying_key;
-  ASYLO_ASSIGN_OR_RETURN(
-      verifying_key, ToEcdsaP256Sha256VerifyingKey(quote.signature.public_key));
+  ASYLO_ASSIGN_OR_RETURN(verifying_key, ToEcdsaP256Sha256VerifyingKey(
+                                            quote.signature().public_key));
 
   Signature signature;
   ASYLO_ASSIGN_OR_RETURN(signature,
                          sgx::CreateSignatureFromPckEcdsaP256Sha256Signature(
-                             quote.signature.body_signature));
+                             quote.signature().body_signature));
 
-  return verifying_key->Verify(
-      {&quote, sizeof(quote.header) + sizeof(quote.body)}, signature);
+  return verifying_key->Verify(quote.signed_data(), signature);
 }
 
 Status VerifyQeReportDataMatchesQuoteSigningKey(
-    const sgx::IntelQeQuote &quote) {
+    const sgx::IntelQeQuoteView &quote) {
   // The provisioning certification enclave certifies the quoting enclave's
   // signing key by signing the QE's report data. The report data contains a
   // hash of the quote signing key, creating a chain from the quote up to the
   // Intel root.
   Sha256Hash sha256;
-  sha256.Update(quote.signature.public_key);
-  sha256.Update(quote.qe_authn_data);
+  sha256.Update(quote.signature().public_key);
+  sha256.Update(quote.qe_authn_data());
 
   std::vector<uint8_t> report_data;
   ASYLO_RETURN_IF_ERROR(sha256.CumulativeHash(&report_data));
@@ -167,7 +179,7 @@ Status VerifyQeReportDataMatchesQuoteSigningKey(
   constexpr uint8_t kDefaultValue = 0;
   report_data.resize(sgx::kReportdataSize, kDefaultValue);
 
-  if (!quote.signature.qe_report.reportdata.data.Equals(report_data)) {
+  if (!quote.signature().qe_report.reportdata.data.Equals(report_data)) {
     return Status(error::GoogleError::INVALID_ARGUMENT,
                   "Quoting enclave report data does not match quote signing "
                   "key and authenticated data");
@@ -177,7 +189,7 @@ Status VerifyQeReportDataMatchesQuoteSigningKey(
 }
 
 Status VerifyPckSignatureFromPckCertChain(
-    const std::vector<uint8_t> &cert_data,
+    ByteContainerView cert_data,
     const sgx::IntelEcdsaP256QuoteSignature &signature) {
   CertificateChain pck_cert_chain;
   ASYLO_ASSIGN_OR_RETURN(pck_cert_chain,
@@ -203,25 +215,26 @@ Status VerifyPckSignatureFromPckCertChain(
       qe_report_signature);
 }
 
-Status VerifyPckSignatureOverQuotingEnclave(const sgx::IntelQeQuote &quote) {
-  switch (quote.cert_data.qe_cert_data_type) {
+Status VerifyPckSignatureOverQuotingEnclave(
+    const sgx::IntelQeQuoteView &quote) {
+  switch (quote.qe_cert_data_type()) {
     case PCK_CERT_CHAIN:
-      return VerifyPckSignatureFromPckCertChain(quote.cert_data.qe_cert_data,
-                                                quote.signature);
+      return VerifyPckSignatureFromPckCertChain(quote.qe_cert_data(),
+                                                quote.signature());
   }
   return Status(
       error::GoogleError::UNIMPLEMENTED,
       absl::StrFormat("Verification not supported for QE cert data type %d",
-                      quote.cert_data.qe_cert_data_type));
+                      quote.qe_cert_data_type()));
 }
 
 Status VerifyPckCertificateChain(
-    const sgx::IntelQeQuote &quote,
+    const sgx::IntelQeQuoteView &quote,
     const std::vector<std::unique_ptr<CertificateInterface>>
         &trusted_root_certificates) {
   CertificateChain pck_cert_chain;
-  ASYLO_ASSIGN_OR_RETURN(pck_cert_chain, GetPckCertificateChainFromCertData(
-                                             quote.cert_data.qe_cert_data));
+  ASYLO_ASSIGN_OR_RETURN(
+      pck_cert_chain, GetPckCertificateChainFromCertData(quote.qe_cert_data()));
 
   CertificateInterfaceVector certificate_chain;
   ASYLO_ASSIGN_OR_RETURN(
@@ -250,50 +263,51 @@ Status VerifyPckCertificateChain(
   return Status::OkStatus();
 }
 
-Status ParseAndAppendPeerMachineConfigurationFromPckCertChain(
-    const sgx::IntelCertData &cert_data, SgxIdentity *identity) {
+StatusOr<sgx::MachineConfiguration> ParseMachineConfigurationFromPckCertChain(
+    ByteContainerView cert_data) {
   CertificateChain pck_cert_chain;
-  ASYLO_ASSIGN_OR_RETURN(pck_cert_chain, GetPckCertificateChainFromCertData(
-                                             cert_data.qe_cert_data));
+  ASYLO_ASSIGN_OR_RETURN(pck_cert_chain,
+                         GetPckCertificateChainFromCertData(cert_data));
 
   std::unique_ptr<X509Certificate> pck_cert;
   ASYLO_ASSIGN_OR_RETURN(pck_cert, X509Certificate::Create(
                                        *pck_cert_chain.certificates().begin()));
 
-  ASYLO_ASSIGN_OR_RETURN(
-      *identity->mutable_machine_configuration(),
-      sgx::ExtractMachineConfigurationFromPckCert(pck_cert.get()));
-
-  return Status::OkStatus();
+  return sgx::ExtractMachineConfigurationFromPckCert(pck_cert.get());
 }
 
-Status ParseEnclaveIdentityFromQuote(const sgx::ReportBody &report_body,
-                                     const sgx::IntelCertData &cert_data,
-                                     EnclaveIdentity *enclave_identity) {
-  SgxIdentity identity = ParseSgxIdentityFromHardwareReport(report_body);
-
-  switch (cert_data.qe_cert_data_type) {
-    case PCK_CERT_CHAIN: {
-      ASYLO_RETURN_IF_ERROR(
-          ParseAndAppendPeerMachineConfigurationFromPckCertChain(cert_data,
-                                                                 &identity));
-      ASYLO_ASSIGN_OR_RETURN(*enclave_identity, SerializeSgxIdentity(identity));
-      return Status::OkStatus();
-    }
+StatusOr<sgx::MachineConfiguration> ParseMachineConfigurationFromCertData(
+    uint16_t cert_data_type, ByteContainerView cert_data) {
+  switch (cert_data_type) {
+    case PCK_CERT_CHAIN:
+      return ParseMachineConfigurationFromPckCertChain(cert_data);
   }
 
   return Status(error::GoogleError::UNIMPLEMENTED,
                 absl::StrFormat("Extracting peer machine identity not "
                                 "supported for QE cert data type %d",
-                                cert_data.qe_cert_data_type));
+                                cert_data_type));
+}
+
+Status ParseEnclaveIdentityFromQuote(const sgx::ReportBody &report_body,
+                                     uint16_t cert_data_type,
+                                     ByteContainerView cert_data,
+                                     EnclaveIdentity *enclave_identity) {
+  SgxIdentity identity = ParseSgxIdentityFromHardwareReport(report_body);
+  ASYLO_ASSIGN_OR_RETURN(
+      *identity.mutable_machine_configuration(),
+      ParseMachineConfigurationFromCertData(cert_data_type, cert_data));
+  ASYLO_ASSIGN_OR_RETURN(*enclave_identity, SerializeSgxIdentity(identity));
+  return Status::OkStatus();
 }
 
 Status VerifyQeIdentityMatchesExpectation(
-    const sgx::IntelQeQuote &quote,
+    const sgx::IntelQeQuoteView &quote,
     const IdentityAclPredicate &qe_expectation) {
   EnclaveIdentity qe_identity;
   ASYLO_RETURN_IF_ERROR(ParseEnclaveIdentityFromQuote(
-      quote.signature.qe_report, quote.cert_data, &qe_identity));
+      quote.signature().qe_report, quote.qe_cert_data_type(),
+      quote.qe_cert_data(), &qe_identity));
 
   std::string explanation;
   SgxIdentityExpectationMatcher matcher;
@@ -312,6 +326,31 @@ Status VerifyQeIdentityMatchesExpectation(
   return Status::OkStatus();
 }
 
+// Returns a digest over all parts of |quote| that are checked by
+// SgxIntelEcdsaQeRemoteAssertionVerifier::VerifyPlatform().
+StatusOr<std::string> GetPlatformKey(const sgx::IntelQeQuoteView &quote) {
+  Sha256Hash sha256;
+  sha256.Update(quote.signature().public_key);
+  sha256.Update(ByteContainerView(&quote.signature().qe_report,
+                                  sizeof(quote.signature().qe_report)));
+  sha256.Update(quote.signature().qe_report_signature);
+
+  // The variable-length fields are prefixed with their sizes, so that the
+  // digest identifies their boundaries unambiguously.
+  uint64_t size = quote.qe_authn_data().size();
+  sha256.Update(ByteContainerView(&size, sizeof(size)));
+  sha256.Update(quote.qe_authn_data());
+  uint16_t cert_data_type = quote.qe_cert_data_type();
+  sha256.Update(ByteContainerView(&cert_data_type, sizeof(cert_data_type)));
+  size = quote.qe_cert_data().size();
+  sha256.Update(ByteContainerView(&size, sizeof(size)));
+  sha256.Update(quote.qe_cert_data());
+
+  std::vector<uint8_t> digest;
+  ASYLO_RETURN_IF_ERROR(sha256.CumulativeHash(&digest));
+  return std::string(digest.begin(), digest.end());
+}
+
 }  // namespace
 
 SgxIntelEcdsaQeRemoteAssertionVerifier::SgxIntelEcdsaQeRemoteAssertionVerifier()
@@ -394,25 +433,64 @@ Status SgxIntelEcdsaQeRemoteAssertionVerifier::Verify(
   ASYLO_RETURN_IF_ERROR(CheckInitialization(__func__));
   ASYLO_RETURN_IF_ERROR(CheckDescription(assertion.description()));
 
-  sgx::IntelQeQuote quote;
-  ASYLO_ASSIGN_OR_RETURN(
-      quote, asylo::sgx::ParseDcapPackedQuote(assertion.assertion()));
+  // |quote| refers to the bytes of |assertion|, which outlives it.
+  StatusOr<sgx::IntelQeQuoteView> quote_result =
+      sgx::IntelQeQuoteView::Create(assertion.assertion());
+  if (!quote_result.ok()) {
+    return quote_result.status();
+  }
+  const sgx::IntelQeQuoteView &quote = quote_result.ValueOrDie();
 
   auto members_view = members_.ReaderLock();
   ASYLO_RETURN_IF_ERROR(VerifyQuoteHeader(quote));
   ASYLO_RETURN_IF_ERROR(
       VerifyQuoteBodySignature(*members_view->aad_generator, user_data, quote));
+
+  SgxIdentity identity = ParseSgxIdentityFromHardwareReport(quote.body());
+  ASYLO_ASSIGN_OR_RETURN(*identity.mutable_machine_configuration(),
+                         VerifyPlatform(*members_view, quote));
+  ASYLO_ASSIGN_OR_RETURN(*peer_identity, SerializeSgxIdentity(identity));
+
+  return Status::OkStatus();
+}
+
+StatusOr<sgx::MachineConfiguration>
+SgxIntelEcdsaQeRemoteAssertionVerifier::VerifyPlatform(
+    const Members &members, const sgx::IntelQeQuoteView &quote) const {
+  std::string platform_key;
+  ASYLO_ASSIGN_OR_RETURN(platform_key, GetPlatformKey(quote));
+
+  absl::Time now = absl::Now();
+  {
+    auto verified_platforms_view = verified_platforms_.ReaderLock();
+    auto it = verified_platforms_view->find(platform_key);
+    if (it != verified_platforms_view->end() && now < it->second.expiration) {
+      return it->second.machine_configuration;
+    }
+  }
+
   ASYLO_RETURN_IF_ERROR(VerifyQeReportDataMatchesQuoteSigningKey(quote));
   ASYLO_RETURN_IF_ERROR(VerifyPckSignatureOverQuotingEnclave(quote));
   ASYLO_RETURN_IF_ERROR(
-      VerifyPckCertificateChain(quote, members_view->root_certificates));
+      VerifyPckCertificateChain(quote, members.root_certificates));
   ASYLO_RETURN_IF_ERROR(VerifyQeIdentityMatchesExpectation(
-      quote, members_view->qe_identity_expectation));
+      quote, members.qe_identity_expectation));
 
-  ASYLO_RETURN_IF_ERROR(ParseEnclaveIdentityFromQuote(
-      quote.body, quote.cert_data, peer_identity));
+  sgx::MachineConfiguration machine_configuration;
+  ASYLO_ASSIGN_OR_RETURN(
+      machine_configuration,
+      ParseMachineConfigurationFromCertData(quote.qe_cert_data_type(),
+                                            quote.qe_cert_data()));
 
-  return Status::OkStatus();
+  auto verified_platforms_view = verified_platforms_.Lock();
+  if (verified_platforms_view->size() >= kMaxVerifiedPlatforms) {
+    verified_platforms_view->clear();
+  }
+  VerifiedPlatform &verified_platform =
+      (*verified_platforms_view)[platform_key];
+  verified_platform.machine_configuration = std::move(machine_configuration);
+  verified_platform.expiration = now + kVerifiedPlatformLifetime;
+  return verified_platform.machine_configuration;
 }
 
 Status SgxIntelEcdsaQeRemoteAssertionVerifier::CheckInitialization(
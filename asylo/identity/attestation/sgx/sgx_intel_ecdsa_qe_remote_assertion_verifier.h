@@ -25,6 +25,8 @@
 #include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/time/time.h"
 #include "asylo/crypto/certificate_interface.h"
 #include "asylo/identity/additional_authenticated_data_generator.h"
 #include "asylo/identity/attestation/enclave_assertion_verifier.h"
@@ -33,6 +35,7 @@
 #include "asylo/identity/identity.pb.h"
 #include "asylo/identity/identity_acl.pb.h"
 #include "asylo/identity/platform/sgx/internal/code_identity_constants.h"
+#include "asylo/identity/platform/sgx/machine_configuration.pb.h"
 #include "asylo/identity/platform/sgx/sgx_identity.pb.h"
 #include "asylo/platform/common/static_map.h"
 #include "asylo/util/mutex_guarded.h"
@@ -40,6 +43,11 @@
 #include "asylo/util/statusor.h"
 
 namespace asylo {
+namespace sgx {
+
+class IntelQeQuoteView;
+
+}  // namespace sgx
 
 /// Implementation of `EnclaveAssertionVerifier` that verifiers assertions
 /// generated by the Intel ECDSA quoting enclave. These assertions attest,
@@ -85,9 +93,31 @@ class SgxIntelEcdsaQeRemoteAssertionVerifier : public EnclaveAssertionVerifier {
     IdentityAclPredicate qe_identity_expectation;
   };
 
+  // A platform whose quoting enclave and PCK certificate chain were verified
+  // by a previous call to Verify().
+  struct VerifiedPlatform {
+    // The machine configuration from the platform's PCK certificate.
+    sgx::MachineConfiguration machine_configuration;
+
+    // The time after which the platform must be verified again.
+    absl::Time expiration;
+  };
+
   Status CheckInitialization(absl::string_view caller) const;
 
+  // Verifies the parts of |quote| that are the same for all quotes from one
+  // platform: the QE report, the PCK signature over it, the PCK certificate
+  // chain and the QE identity. Returns the machine configuration from the PCK
+  // certificate on success. Results are cached in |verified_platforms_|.
+  StatusOr<sgx::MachineConfiguration> VerifyPlatform(
+      const Members &members, const sgx::IntelQeQuoteView &quote) const;
+
   MutexGuarded<Members> members_;
+
+  // Platforms that were verified recently, keyed by a digest of the QE- and
+  // PCK-related parts of their quotes.
+  mutable MutexGuarded<absl::flat_hash_map<std::string, VerifiedPlatform>>
+      verified_platforms_;
 };
 
 }  // namespace asylo
@@ -66,6 +66,7 @@ namespace {
 using ::testing::Eq;
 using ::testing::HasSubstr;
 using ::testing::IsTrue;
+using ::testing::Not;
 using ::testing::Test;
 
 // clang-format off
@@ -629,5 +630,55 @@ TEST_F(SgxIntelEcdsaQeRemoteAssertionVerifierTest, VerifySuccess) {
             quote.body.isvsvn);
 }
 
+TEST_F(SgxIntelEcdsaQeRemoteAssertionVerifierTest,
+       VerifySucceedsRepeatedlyForSamePlatform) {
+  SgxIntelEcdsaQeRemoteAssertionVerifier verifier;
+  ASYLO_ASSERT_OK(verifier.Initialize(valid_config_));
+
+  Assertion assertion = CreateAssertion(GenerateValidQuote("important data"));
+  EnclaveIdentity first_identity;
+  ASYLO_ASSERT_OK(
+      verifier.Verify("important data", assertion, &first_identity));
+
+  // The second verification uses the cached platform verification result, and
+  // must produce the same peer identity.
+  EnclaveIdentity second_identity;
+  ASYLO_ASSERT_OK(
+      verifier.Verify("important data", assertion, &second_identity));
+  EXPECT_THAT(second_identity, EqualsProto(first_identity));
+}
+
+TEST_F(SgxIntelEcdsaQeRemoteAssertionVerifierTest,
+       VerifyChecksQuoteBodyForVerifiedPlatform) {
+  SgxIntelEcdsaQeRemoteAssertionVerifier verifier;
+  ASYLO_ASSERT_OK(verifier.Initialize(valid_config_));
+
+  sgx::IntelQeQuote quote = GenerateValidQuote("user data");
+  EnclaveIdentity identity;
+  ASYLO_ASSERT_OK(verifier.Verify("user data", CreateAssertion(quote),
+                                  &identity));
+
+  quote.signature.body_signature[0] ^= 1;
+  EXPECT_THAT(
+      verifier.Verify("user data", CreateAssertion(quote), &identity),
+      Not(IsOk()));
+}
+
+TEST_F(SgxIntelEcdsaQeRemoteAssertionVerifierTest,
+       VerifyChecksQeReportSignatureForChangedPlatform) {
+  SgxIntelEcdsaQeRemoteAssertionVerifier verifier;
+  ASYLO_ASSERT_OK(verifier.Initialize(valid_config_));
+
+  sgx::IntelQeQuote quote = GenerateValidQuote("user data");
+  EnclaveIdentity identity;
+  ASYLO_ASSERT_OK(verifier.Verify("user data", CreateAssertion(quote),
+                                  &identity));
+
+  quote.signature.qe_report_signature[0] ^= 1;
+  EXPECT_THAT(
+      verifier.Verify("user data", CreateAssertion(quote), &identity),
+      Not(IsOk()));
+}
+
 }  // namespace
 }  // namespace asylo
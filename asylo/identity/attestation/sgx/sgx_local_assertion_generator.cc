@@ -18,7 +18,9 @@
 
 #include "asylo/identity/attestation/sgx/sgx_local_assertion_generator.h"
 
+#include <memory>
 #include <string>
+#include <utility>
 
 #include "asylo/crypto/sha256_hash.h"
 #include "asylo/crypto/util/bytes.h"
@@ -31,12 +33,19 @@
 #include "asylo/util/status_macros.h"
 
 namespace asylo {
+namespace {
+
+// The maximum number of TARGETINFO structures cached by a generator.
+constexpr size_t kMaxCachedTargetinfos = 64;
+
+}  // namespace
 
 const char *const SgxLocalAssertionGenerator::kAuthorityType =
     sgx::kSgxLocalAssertionAuthority;
 
 SgxLocalAssertionGenerator::SgxLocalAssertionGenerator()
-    : members_(Members()) {}
+    : members_(Members()),
+      hardware_interface_(sgx::HardwareInterface::CreateDefault()) {}
 
 Status SgxLocalAssertionGenerator::Initialize(const std::string &config) {
   auto members_view = members_.Lock();
@@ -145,9 +154,8 @@ Status SgxLocalAssertionGenerator::Generate(const std::string &user_data,
   // architecture, and was copied into the request byte-for-byte. Since the
   // LocalAssertionGenerator runs inside an SGX enclave, it is safe to restore
   // the TARGETINFO structure directly from the request.
-  sgx::AlignedTargetinfoPtr tinfo;
-  ASYLO_RETURN_IF_ERROR(SetTrivialObjectFromBinaryString<sgx::Targetinfo>(
-      additional_info.targetinfo(), tinfo.get()));
+  std::shared_ptr<const sgx::AlignedTargetinfoPtr> tinfo;
+  ASYLO_ASSIGN_OR_RETURN(tinfo, GetTargetinfo(additional_info.targetinfo()));
 
   // The REPORTDATA is a user-provided input to the hardware report that is
   // included in the report's MAC. Use a SHA256 hash of |user_data| as the
@@ -166,9 +174,8 @@ Status SgxLocalAssertionGenerator::Generate(const std::string &user_data,
   // Generate a REPORT that is bound to the provided |user_data| and is targeted
   // at the enclave described in the request.
   sgx::Report report;
-  ASYLO_ASSIGN_OR_RETURN(
-      report,
-      sgx::HardwareInterface::CreateDefault()->GetReport(*tinfo, *reportdata));
+  ASYLO_ASSIGN_OR_RETURN(report,
+                         hardware_interface_->GetReport(**tinfo, *reportdata));
 
   // As explained above, the REPORT structure can be copied byte-for-byte into
   // the report field of the assertion because the layout and endianness of the
@@ -206,6 +213,28 @@ SgxLocalAssertionGenerator::ParseAdditionalInfo(
   return additional_info;
 }
 
+StatusOr<std::shared_ptr<const sgx::AlignedTargetinfoPtr>>
+SgxLocalAssertionGenerator::GetTargetinfo(const std::string &targetinfo) const {
+  {
+    absl::MutexLock lock(&targetinfos_mu_);
+    auto it = targetinfos_.find(targetinfo);
+    if (it != targetinfos_.end()) {
+      return it->second;
+    }
+  }
+
+  auto tinfo = std::make_shared<sgx::AlignedTargetinfoPtr>();
+  ASYLO_RETURN_IF_ERROR(SetTrivialObjectFromBinaryString<sgx::Targetinfo>(
+      targetinfo, tinfo->get()));
+
+  absl::MutexLock lock(&targetinfos_mu_);
+  if (targetinfos_.size() >= kMaxCachedTargetinfos) {
+    targetinfos_.clear();
+  }
+  auto result = targetinfos_.emplace(targetinfo, std::move(tinfo));
+  return result.first->second;
+}
+
 // Static registration of the LocalAssertionGenerator library.
 SET_STATIC_MAP_VALUE_OF_DERIVED_TYPE(AssertionGeneratorMap,
                                      SgxLocalAssertionGenerator);
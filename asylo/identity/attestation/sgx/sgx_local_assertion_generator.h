@@ -19,8 +19,15 @@
 #ifndef ASYLO_IDENTITY_ATTESTATION_SGX_SGX_LOCAL_ASSERTION_GENERATOR_H_
 #define ASYLO_IDENTITY_ATTESTATION_SGX_SGX_LOCAL_ASSERTION_GENERATOR_H_
 
+#include <memory>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
 #include "asylo/identity/attestation/enclave_assertion_generator.h"
 #include "asylo/identity/attestation/sgx/internal/local_assertion.pb.h"
+#include "asylo/identity/platform/sgx/internal/hardware_interface.h"
+#include "asylo/identity/platform/sgx/internal/identity_key_management_structs.h"
 #include "asylo/util/mutex_guarded.h"
 
 namespace asylo {
@@ -68,6 +75,13 @@ class SgxLocalAssertionGenerator final : public EnclaveAssertionGenerator {
   StatusOr<sgx::LocalAssertionRequestAdditionalInfo> ParseAdditionalInfo(
       const AssertionRequest &request) const;
 
+  // Returns the TARGETINFO structure for the serialized TARGETINFO |targetinfo|
+  // from an assertion request. Parsed structures are cached, so that a
+  // generator that repeatedly targets the same verifiers only has to issue the
+  // EREPORT for each assertion.
+  StatusOr<std::shared_ptr<const sgx::AlignedTargetinfoPtr>> GetTargetinfo(
+      const std::string &targetinfo) const;
+
   // The identity type handled by this generator.
   static constexpr EnclaveIdentityType kIdentityType = CODE_IDENTITY;
 
@@ -87,6 +101,18 @@ class SgxLocalAssertionGenerator final : public EnclaveAssertionGenerator {
   };
 
   MutexGuarded<Members> members_;
+
+  // The interface used to issue EREPORTs.
+  const std::unique_ptr<sgx::HardwareInterface> hardware_interface_;
+
+  // TARGETINFO structures from previous assertion requests, keyed by their
+  // serialization.
+  mutable absl::flat_hash_map<std::string,
+                              std::shared_ptr<const sgx::AlignedTargetinfoPtr>>
+      targetinfos_ ABSL_GUARDED_BY(targetinfos_mu_);
+
+  // A mutex that guards the targetinfos_ member.
+  mutable absl::Mutex targetinfos_mu_;
 };
 
 }  // namespace asylo
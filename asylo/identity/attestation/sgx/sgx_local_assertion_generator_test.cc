@@ -417,5 +417,42 @@ TEST_F(SgxLocalAssertionGeneratorTest, GenerateSuccess) {
       << expected_identity.DebugString();
 }
 
+// Verify that Generate() produces verifiable assertions for a target that it
+// generated assertions for before, including after many other targets.
+TEST_F(SgxLocalAssertionGeneratorTest, GenerateRepeatedlyForCachedTarget) {
+  SgxLocalAssertionGenerator generator;
+  EXPECT_THAT(generator.Initialize(config_), IsOk());
+
+  AssertionRequest self_request;
+  sgx::Targetinfo targetinfo;
+  sgx::SetTargetinfoFromSelfIdentity(&targetinfo);
+  ASSERT_TRUE(MakeAssertionRequest(
+      absl::string_view(reinterpret_cast<const char *>(&targetinfo),
+                        sizeof(targetinfo)),
+      kLocalAttestationDomain1, &self_request));
+
+  for (int i = 0; i < 100; i++) {
+    Assertion assertion;
+    if (i % 10 == 0) {
+      ASSERT_THAT(generator.Generate(kUserData, self_request, &assertion),
+                  IsOk());
+
+      sgx::AlignedReportPtr report;
+      sgx::LocalAssertion local_assertion;
+      ASSERT_TRUE(local_assertion.ParseFromString(assertion.assertion()));
+      ASSERT_THAT(SetTrivialObjectFromBinaryString<sgx::Report>(
+                      local_assertion.report(), report.get()),
+                  IsOk());
+      EXPECT_THAT(sgx::VerifyHardwareReport(*report), IsOk());
+    } else {
+      AssertionRequest other_request;
+      ASSERT_TRUE(MakeAssertionRequestWithRandomTarget(kLocalAttestationDomain1,
+                                                       &other_request));
+      ASSERT_THAT(generator.Generate(kUserData, other_request, &assertion),
+                  IsOk());
+    }
+  }
+}
+
 }  // namespace
 }  // namespace asylo
@@ -20,6 +20,7 @@
 
 #include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/synchronization/mutex.h"
@@ -36,6 +37,14 @@
 
 namespace asylo {
 
+namespace {
+
+// The maximum number of report keys cached by a verifier. The KEYID of reports
+// only changes when the platform is reset, so a handful of entries suffices.
+constexpr size_t kMaxCachedReportKeys = 8;
+
+}  // namespace
+
 const char *const SgxLocalAssertionVerifier::authority_type_ =
     sgx::kSgxLocalAssertionAuthority;
 
@@ -60,6 +69,18 @@ Status SgxLocalAssertionVerifier::Initialize(const std::string &config) {
 
   attestation_domain_ = authority_config.attestation_domain();
 
+  // The request contains a dump of the raw TARGETINFO structure, which
+  // specifies the verifier as the target for the requested assertion. Note that
+  // since the layout and endianness of the TARGETINFO structure is defined by
+  // the Intel SGX architecture, it is safe to exchange the raw bytes of the
+  // structure. An SGX enclave that receives the request can reconstruct the
+  // original structure directly from the byte field in the AssertionRequest
+  // proto. The TARGETINFO only depends on the identity of this enclave, so it
+  // is computed once.
+  sgx::Targetinfo targetinfo;
+  sgx::SetTargetinfoFromSelfIdentity(&targetinfo);
+  targetinfo_ = ConvertTrivialObjectToBinaryString(targetinfo);
+
   absl::MutexLock lock(&initialized_mu_);
   initialized_ = true;
 
@@ -90,18 +111,7 @@ Status SgxLocalAssertionVerifier::CreateAssertionRequest(
 
   sgx::LocalAssertionRequestAdditionalInfo additional_info;
   additional_info.set_local_attestation_domain(attestation_domain_);
-
-  // The request contains a dump of the raw TARGETINFO structure, which
-  // specifies the verifier as the target for the requested assertion. Note that
-  // since the layout and endianness of the TARGETINFO structure is defined by
-  // the Intel SGX architecture, it is safe to exchange the raw bytes of the
-  // structure. An SGX enclave that receives the request can reconstruct the
-  // original structure directly from the byte field in the AssertionRequest
-  // proto.
-  sgx::Targetinfo targetinfo;
-  sgx::SetTargetinfoFromSelfIdentity(&targetinfo);
-  additional_info.set_targetinfo(
-      ConvertTrivialObjectToBinaryString(targetinfo));
+  additional_info.set_targetinfo(targetinfo_);
 
   if (!additional_info.SerializeToString(
           request->mutable_additional_information())) {
@@ -161,7 +171,9 @@ Status SgxLocalAssertionVerifier::Verify(const std::string &user_data,
   sgx::Report report;
   ASYLO_RETURN_IF_ERROR(SetTrivialObjectFromBinaryString<sgx::Report>(
       local_assertion.report(), &report));
-  ASYLO_RETURN_IF_ERROR(sgx::VerifyHardwareReport(report));
+  sgx::HardwareKey report_key;
+  ASYLO_ASSIGN_OR_RETURN(report_key, GetReportKey(report));
+  ASYLO_RETURN_IF_ERROR(sgx::VerifyHardwareReportWithKey(report, report_key));
 
   // Next, verify that the REPORT is cryptographically-bound to the provided
   // |user_data|. This is done by re-constructing the expected REPORTDATA (a
@@ -190,6 +202,28 @@ Status SgxLocalAssertionVerifier::Verify(const std::string &user_data,
   return Status::OkStatus();
 }
 
+StatusOr<sgx::HardwareKey> SgxLocalAssertionVerifier::GetReportKey(
+    const sgx::Report &report) const {
+  std::string keyid = ConvertTrivialObjectToBinaryString(report.keyid);
+  {
+    absl::MutexLock lock(&report_keys_mu_);
+    auto it = report_keys_.find(keyid);
+    if (it != report_keys_.end()) {
+      return it->second;
+    }
+  }
+
+  sgx::HardwareKey report_key;
+  ASYLO_ASSIGN_OR_RETURN(report_key, sgx::GetReportKey(report.keyid));
+
+  absl::MutexLock lock(&report_keys_mu_);
+  if (report_keys_.size() >= kMaxCachedReportKeys) {
+    report_keys_.clear();
+  }
+  report_keys_.emplace(std::move(keyid), report_key);
+  return report_key;
+}
+
 // Static registration of the LocalAssertionVerifier library.
 SET_STATIC_MAP_VALUE_OF_DERIVED_TYPE(AssertionVerifierMap,
                                      SgxLocalAssertionVerifier);
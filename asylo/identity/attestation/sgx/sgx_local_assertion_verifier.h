@@ -19,8 +19,12 @@
 #ifndef ASYLO_IDENTITY_ATTESTATION_SGX_SGX_LOCAL_ASSERTION_VERIFIER_H_
 #define ASYLO_IDENTITY_ATTESTATION_SGX_SGX_LOCAL_ASSERTION_VERIFIER_H_
 
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
 #include "absl/synchronization/mutex.h"
 #include "asylo/identity/attestation/enclave_assertion_verifier.h"
+#include "asylo/identity/platform/sgx/internal/identity_key_management_structs.h"
 
 namespace asylo {
 
@@ -61,6 +65,10 @@ class SgxLocalAssertionVerifier final : public EnclaveAssertionVerifier {
                 EnclaveIdentity *peer_identity) const override;
 
  private:
+  // Returns the report key for |report|. Report keys are retrieved from the
+  // hardware once per KEYID and cached for subsequent reports.
+  StatusOr<sgx::HardwareKey> GetReportKey(const sgx::Report &report) const;
+
   // The identity type handled by this verifier.
   static constexpr EnclaveIdentityType identity_type_ = CODE_IDENTITY;
 
@@ -70,11 +78,22 @@ class SgxLocalAssertionVerifier final : public EnclaveAssertionVerifier {
   // The attestation domain to which the enclave belongs.
   std::string attestation_domain_;
 
+  // The serialized TARGETINFO of this enclave, which is sent in every
+  // assertion request.
+  std::string targetinfo_;
+
   // Indicates whether this verifier has been initialized.
   bool initialized_ ABSL_GUARDED_BY(initialized_mu_);
 
   // A mutex that guards the initialized_ member.
   mutable absl::Mutex initialized_mu_;
+
+  // Report keys retrieved so far, keyed by KEYID.
+  mutable absl::flat_hash_map<std::string, sgx::HardwareKey> report_keys_
+      ABSL_GUARDED_BY(report_keys_mu_);
+
+  // A mutex that guards the report_keys_ member.
+  mutable absl::Mutex report_keys_mu_;
 };
 
 }  // namespace asylo
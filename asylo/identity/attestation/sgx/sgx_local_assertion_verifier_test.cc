@@ -397,5 +397,47 @@ TEST_F(SgxLocalAssertionVerifierTest, VerifySuccess) {
       << sgx::FormatProto(sgx::GetSelfIdentity()->sgx_identity);
 }
 
+// Verify that Verify() keeps verifying assertions once the report key has been
+// cached, and that the cached key still rejects tampered reports.
+TEST_F(SgxLocalAssertionVerifierTest, VerifyRepeatedlyWithCachedReportKey) {
+  SgxLocalAssertionVerifier verifier;
+  ASYLO_ASSERT_OK(verifier.Initialize(config_));
+
+  Assertion assertion;
+  SetAssertionDescription(assertion.mutable_description());
+
+  Sha256Hash hash;
+  hash.Update(kUserData);
+  sgx::AlignedReportdataPtr reportdata;
+  *reportdata = TrivialZeroObject<sgx::Reportdata>();
+  std::vector<uint8_t> digest;
+  ASYLO_ASSERT_OK(hash.CumulativeHash(&digest));
+  reportdata->data.replace(/*pos=*/0, digest);
+
+  sgx::AlignedTargetinfoPtr targetinfo;
+  sgx::SetTargetinfoFromSelfIdentity(targetinfo.get());
+
+  sgx::Report report;
+  ASYLO_ASSERT_OK_AND_ASSIGN(report,
+                             hardware_->GetReport(*targetinfo, *reportdata));
+  sgx::LocalAssertion local_assertion;
+  local_assertion.set_report(reinterpret_cast<const char *>(&report),
+                             sizeof(report));
+  ASSERT_TRUE(local_assertion.SerializeToString(assertion.mutable_assertion()));
+
+  for (int i = 0; i < 3; i++) {
+    EnclaveIdentity identity;
+    ASYLO_EXPECT_OK(verifier.Verify(kUserData, assertion, &identity));
+  }
+
+  report.mac[0] ^= 1;
+  local_assertion.set_report(reinterpret_cast<const char *>(&report),
+                             sizeof(report));
+  ASSERT_TRUE(local_assertion.SerializeToString(assertion.mutable_assertion()));
+
+  EnclaveIdentity identity;
+  EXPECT_THAT(verifier.Verify(kUserData, assertion, &identity), Not(IsOk()));
+}
+
 }  // namespace
 }  // namespace asylo
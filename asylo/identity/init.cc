@@ -18,19 +18,92 @@
 
 #include "asylo/identity/init.h"
 
+#include <algorithm>
+#include <atomic>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
 #include "asylo/identity/attestation/enclave_assertion_generator.h"
 #include "asylo/identity/attestation/enclave_assertion_verifier.h"
 #include "asylo/identity/enclave_assertion_authority.h"
 #include "asylo/identity/enclave_assertion_authority_config.pb.h"
 #include "asylo/identity/identity.pb.h"
 #include "asylo/identity/init_internal.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/mutex_guarded.h"
 #include "asylo/util/status.h"
 #include "asylo/util/status_macros.h"
+#include "asylo/util/thread.h"
 
 namespace asylo {
+namespace {
+
+// Configs of authorities that are initialized on first use, keyed by authority
+// identifier.
+using DeferredConfigMap = absl::flat_hash_map<
+    std::string, std::vector<EnclaveAssertionAuthorityConfig>>;
+
+// The configs of a single authority, in the order they are applied.
+using AuthorityConfigs = std::vector<const EnclaveAssertionAuthorityConfig *>;
+
+MutexGuarded<DeferredConfigMap> *GetDeferredConfigs() {
+  static auto *deferred_configs =
+      new MutexGuarded<DeferredConfigMap>(DeferredConfigMap());
+  return deferred_configs;
+}
+
+// Returns whether both a generator and a verifier are registered for
+// |authority_id|. Logs a warning for each of them that is missing.
+bool HasMatchingAuthorities(const std::string &authority_id,
+                            const AssertionDescription &description) {
+  bool ok = true;
+  if (AssertionGeneratorMap::GetValue(authority_id) ==
+      AssertionGeneratorMap::value_end()) {
+    ok = false;
+    LOG(WARNING) << "Config for " << description.ShortDebugString()
+                 << " does not match any known assertion generator";
+  }
+  if (AssertionVerifierMap::GetValue(authority_id) ==
+      AssertionVerifierMap::value_end()) {
+    ok = false;
+    LOG(WARNING) << "Config for " << description.ShortDebugString()
+                 << " does not match any known assertion verifier";
+  }
+  return ok;
+}
+
+// Initializes the generator and the verifier registered for |authority_id|, if
+// any, with |config|. Returns whether both were initialized.
+bool InitializeAuthorities(const std::string &authority_id,
+                           const EnclaveAssertionAuthorityConfig &config) {
+  bool ok = true;
+
+  auto generator_it = AssertionGeneratorMap::GetValue(authority_id);
+  if (generator_it != AssertionGeneratorMap::value_end()) {
+    if (!internal::TryInitialize(config.config(), generator_it).ok()) {
+      ok = false;
+    }
+  } else {
+    ok = false;
+  }
+
+  auto verifier_it = AssertionVerifierMap::GetValue(authority_id);
+  if (verifier_it != AssertionVerifierMap::value_end()) {
+    if (!internal::TryInitialize(config.config(), verifier_it).ok()) {
+      ok = false;
+    }
+  } else {
+    ok = false;
+  }
+
+  return ok;
+}
+
+}  // namespace
 
 Status InitializeEnclaveAssertionVerifier(
     const EnclaveAssertionAuthorityConfig &config) {
@@ -68,4 +141,117 @@ Status InitializeEnclaveAssertionGenerator(
   return internal::TryInitialize(config.config(), generator_it);
 }
 
+Status InitializeDeferredEnclaveAssertionAuthority(
+    const AssertionDescription &description) {
+  std::string authority_id;
+  ASYLO_ASSIGN_OR_RETURN(
+      authority_id,
+      EnclaveAssertionAuthority::GenerateAuthorityId(
+          description.identity_type(), description.authority_type()));
+
+  MutexGuarded<DeferredConfigMap> *deferred_configs = GetDeferredConfigs();
+  if (!deferred_configs->ReaderLock()->contains(authority_id)) {
+    return Status::OkStatus();
+  }
+
+  // The lock is held during initialization, so that concurrent first uses of
+  // the authority wait for it to be initialized.
+  auto locked_configs = deferred_configs->Lock();
+  auto it = locked_configs->find(authority_id);
+  if (it == locked_configs->end()) {
+    return Status::OkStatus();
+  }
+
+  bool ok = true;
+  for (const EnclaveAssertionAuthorityConfig &config : it->second) {
+    if (!InitializeAuthorities(authority_id, config)) {
+      ok = false;
+    }
+  }
+  locked_configs->erase(it);
+
+  return ok ? Status::OkStatus()
+            : Status(error::GoogleError::INTERNAL,
+                     absl::StrCat("Failed to initialize assertion authorities "
+                                  "for ",
+                                  description.ShortDebugString()));
+}
+
+namespace internal {
+
+Status InitializeEnclaveAssertionAuthorities(
+    absl::Span<const EnclaveAssertionAuthorityConfig *const> configs,
+    int num_threads) {
+  std::atomic<bool> ok(true);
+
+  // Group the eager configs by authority, in order of first appearance, so
+  // that each authority is initialized on a single thread.
+  std::vector<std::pair<std::string, AuthorityConfigs>> eager_authorities;
+  absl::flat_hash_map<std::string, size_t> eager_authority_indices;
+
+  for (const EnclaveAssertionAuthorityConfig *config : configs) {
+    const AssertionDescription &description = config->description();
+    StatusOr<std::string> authority_id_result =
+        EnclaveAssertionAuthority::GenerateAuthorityId(
+            description.identity_type(), description.authority_type());
+    if (!authority_id_result.ok()) {
+      ok = false;
+      LOG(ERROR) << authority_id_result.status();
+      continue;
+    }
+
+    std::string authority_id = authority_id_result.ValueOrDie();
+    if (!HasMatchingAuthorities(authority_id, description)) {
+      ok = false;
+    }
+
+    if (config->initialize_on_first_use()) {
+      (*GetDeferredConfigs()->Lock())[authority_id].push_back(*config);
+      continue;
+    }
+
+    auto index_it = eager_authority_indices.find(authority_id);
+    if (index_it == eager_authority_indices.end()) {
+      index_it = eager_authority_indices
+                     .emplace(authority_id, eager_authorities.size())
+                     .first;
+      eager_authorities.emplace_back(std::move(authority_id),
+                                     AuthorityConfigs());
+    }
+    eager_authorities[index_it->second].second.push_back(config);
+  }
+
+  std::atomic<size_t> next_authority(0);
+  auto initialize_authorities = [&eager_authorities, &next_authority, &ok]() {
+    for (size_t i = next_authority++; i < eager_authorities.size();
+         i = next_authority++) {
+      for (const EnclaveAssertionAuthorityConfig *config :
+           eager_authorities[i].second) {
+        if (!InitializeAuthorities(eager_authorities[i].first, *config)) {
+          ok = false;
+        }
+      }
+    }
+  };
+
+  size_t num_workers = std::min<size_t>(std::max(num_threads, 1),
+                                        eager_authorities.size());
+  std::vector<Thread> workers;
+  for (size_t i = 1; i < num_workers; ++i) {
+    workers.emplace_back(initialize_authorities);
+  }
+  initialize_authorities();
+  for (Thread &worker : workers) {
+    worker.Join();
+  }
+
+  return ok ? Status::OkStatus()
+            : Status(
+                  error::GoogleError::INTERNAL,
+                  "One or more errors occurred while attempting to initialize "
+                  "assertion generators and assertion verifiers");
+}
+
+}  // namespace internal
+
 }  // namespace asylo
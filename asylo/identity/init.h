@@ -20,12 +20,13 @@
 #define ASYLO_IDENTITY_INIT_H_
 
 #include <string>
+#include <vector>
 
-#include "asylo/util/logging.h"
 #include "asylo/identity/attestation/enclave_assertion_generator.h"
 #include "asylo/identity/attestation/enclave_assertion_verifier.h"
 #include "asylo/identity/enclave_assertion_authority.h"
 #include "asylo/identity/enclave_assertion_authority_config.pb.h"
+#include "asylo/identity/identity.pb.h"
 #include "asylo/identity/init_internal.h"
 #include "asylo/util/status.h"
 
@@ -55,6 +56,18 @@ Status InitializeEnclaveAssertionVerifier(
 Status InitializeEnclaveAssertionGenerator(
     const EnclaveAssertionAuthorityConfig &config);
 
+// Initializes the EnclaveAssertionGenerator and EnclaveAssertionVerifier that
+// match |description| with the configs that were deferred to their first use
+// by |InitializeEnclaveAssertionAuthorities|. The deferred configs are used at
+// most once. Returns an ok status if there are no deferred configs for
+// |description|.
+//
+// This function will return a non-ok status if any of the following occurs:
+//   * The authority identifier could not be generated from |description|
+//   * The authority could not be initialized with a deferred config
+Status InitializeDeferredEnclaveAssertionAuthority(
+    const AssertionDescription &description);
+
 // Initializes EnclaveAssertionGenerators and EnclaveAssertionVerifiers that
 // have been statically-registered into the program static maps using the
 // configs provided in the range [|configs_begin|, |configs_end|). If a config
@@ -63,6 +76,13 @@ Status InitializeEnclaveAssertionGenerator(
 // to this function and |InitializeEnclaveAssertionGenerator| and
 // |InitializeEnclaveAssertionVerifier|.
 //
+// Authorities whose config sets |initialize_on_first_use| are not initialized
+// by this function. Their configs are kept until the authority is first looked
+// up, see |InitializeDeferredEnclaveAssertionAuthority|. The remaining
+// authorities are initialized on up to |num_threads| threads, including the
+// calling thread. Configs for the same authority are always applied in order
+// on a single thread.
+//
 // ConfigIteratorT must be an iterator type that satisfies the following
 // constraints:
 //   * It provides a dereference operator, which returns an immutable reference
@@ -80,54 +100,14 @@ Status InitializeEnclaveAssertionGenerator(
 // will have no effect.
 template <class ConfigIteratorT>
 Status InitializeEnclaveAssertionAuthorities(ConfigIteratorT configs_begin,
-                                             ConfigIteratorT configs_end) {
-  bool ok = true;
-
-  // Initialize assertion authorities with provided configs.
+                                             ConfigIteratorT configs_end,
+                                             int num_threads = 1) {
+  std::vector<const EnclaveAssertionAuthorityConfig *> configs;
   for (auto it = configs_begin; it != configs_end; ++it) {
     const EnclaveAssertionAuthorityConfig &config = *it;
-
-    const AssertionDescription &description = config.description();
-    StatusOr<std::string> authority_id_result =
-        EnclaveAssertionAuthority::GenerateAuthorityId(
-            description.identity_type(), description.authority_type());
-    if (!authority_id_result.ok()) {
-      ok = false;
-      LOG(ERROR) << authority_id_result.status();
-      continue;
-    }
-
-    std::string authority_id = authority_id_result.ValueOrDie();
-
-    auto generator_it = AssertionGeneratorMap::GetValue(authority_id);
-    if (generator_it != AssertionGeneratorMap::value_end()) {
-      if (!internal::TryInitialize(config.config(), generator_it).ok()) {
-        ok = false;
-      }
-    } else {
-      ok = false;
-      LOG(WARNING) << "Config for " << description.ShortDebugString()
-                   << " does not match any known assertion generator";
-    }
-
-    auto verifier_it = AssertionVerifierMap::GetValue(authority_id);
-    if (verifier_it != AssertionVerifierMap::value_end()) {
-      if (!internal::TryInitialize(config.config(), verifier_it).ok()) {
-        ok = false;
-      }
-    } else {
-      ok = false;
-      LOG(WARNING) << "Config for " << description.ShortDebugString()
-                   << " does not match any known assertion verifier";
-    }
+    configs.push_back(&config);
   }
-
-
-  return ok ? Status::OkStatus()
-            : Status(
-                  error::GoogleError::INTERNAL,
-                  "One or more errors occurred while attempting to initialize "
-                  "assertion generators and assertion verifiers");
+  return internal::InitializeEnclaveAssertionAuthorities(configs, num_threads);
 }
 
 }  // namespace asylo
@@ -21,6 +21,8 @@
 
 #include <string>
 
+#include "absl/types/span.h"
+#include "asylo/identity/enclave_assertion_authority_config.pb.h"
 #include "asylo/util/logging.h"
 #include "asylo/util/status.h"
 
@@ -45,6 +47,13 @@ Status TryInitialize(const std::string &config, IteratorT authority_it) {
   return status;
 }
 
+// Initializes the authorities for |configs| as described for
+// InitializeEnclaveAssertionAuthorities(), using up to |num_threads| threads
+// for the authorities that are not deferred to their first use.
+Status InitializeEnclaveAssertionAuthorities(
+    absl::Span<const EnclaveAssertionAuthorityConfig *const> configs,
+    int num_threads);
+
 }  // namespace internal
 }  // namespace asylo
 
@@ -36,6 +36,18 @@ constexpr char kTestConfig[] = R"proto(
   config: "The office was underappreciated. Let me back"
 )proto";
 
+constexpr char kTestDeferredConfig[] = R"proto(
+  description: { identity_type: NULL_IDENTITY authority_type: "Any" }
+  config: "Out of sight, out of mind"
+  initialize_on_first_use: true
+)proto";
+
+constexpr char kTestInvalidDeferredConfig[] = R"proto(
+  description: { identity_type: CODE_IDENTITY authority_type: "foobar" }
+  config: "Not now"
+  initialize_on_first_use: true
+)proto";
+
 constexpr char kTestInvalidConfig[] = R"proto(
   description: { identity_type: CODE_IDENTITY authority_type: "foobar" }
   config: "I miss my desk chair"
@@ -94,6 +106,54 @@ TEST(InitTest, InitializeFailsWithNonMatchingConfigs) {
       Not(IsOk()));
 }
 
+// Verify that InitializeEnclaveAssertionAuthorities succeeds when initializing
+// authorities on several threads.
+TEST(InitTest, InitializeSucceedsWithConfigsOnMultipleThreads) {
+  std::vector<EnclaveAssertionAuthorityConfig> configs = {
+      ParseTextProtoOrDie(kTestConfig), ParseTextProtoOrDie(kTestConfig)};
+
+  EXPECT_THAT(InitializeEnclaveAssertionAuthorities(
+                  configs.begin(), configs.end(), /*num_threads=*/4),
+              IsOk());
+}
+
+// Verify that InitializeEnclaveAssertionAuthorities fails on several threads
+// when one of the configs does not match any assertion authority.
+TEST(InitTest, InitializeFailsWithNonMatchingConfigsOnMultipleThreads) {
+  std::vector<EnclaveAssertionAuthorityConfig> configs = {
+      ParseTextProtoOrDie(kTestConfig),
+      ParseTextProtoOrDie(kTestInvalidConfig)};
+
+  EXPECT_THAT(InitializeEnclaveAssertionAuthorities(
+                  configs.begin(), configs.end(), /*num_threads=*/4),
+              Not(IsOk()));
+}
+
+// Verify that configs deferred to their first use are applied by
+// InitializeDeferredEnclaveAssertionAuthority, and only once.
+TEST(InitTest, InitializeDeferredAuthoritySucceeds) {
+  std::vector<EnclaveAssertionAuthorityConfig> configs = {
+      ParseTextProtoOrDie(kTestDeferredConfig)};
+  const AssertionDescription &description = configs.front().description();
+
+  ASSERT_THAT(
+      InitializeEnclaveAssertionAuthorities(configs.begin(), configs.end()),
+      IsOk());
+  EXPECT_THAT(InitializeDeferredEnclaveAssertionAuthority(description), IsOk());
+  EXPECT_THAT(InitializeDeferredEnclaveAssertionAuthority(description), IsOk());
+}
+
+// Verify that InitializeEnclaveAssertionAuthorities still fails for a deferred
+// config that does not match any assertion authority.
+TEST(InitTest, InitializeFailsWithNonMatchingDeferredConfigs) {
+  std::vector<EnclaveAssertionAuthorityConfig> configs = {
+      ParseTextProtoOrDie(kTestInvalidDeferredConfig)};
+
+  EXPECT_THAT(
+      InitializeEnclaveAssertionAuthorities(configs.begin(), configs.end()),
+      Not(IsOk()));
+}
+
 TEST(InitTest, InitializeEnclaveAssertionVerifierSuccess) {
   EnclaveAssertionAuthorityConfig config = ParseTextProtoOrDie(kTestConfig);
   ASYLO_EXPECT_OK(InitializeEnclaveAssertionVerifier(config));
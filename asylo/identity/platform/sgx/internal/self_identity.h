@@ -20,6 +20,7 @@
 #define ASYLO_IDENTITY_PLATFORM_SGX_INTERNAL_SELF_IDENTITY_H_
 
 #include "asylo/crypto/util/bytes.h"
+#include "asylo/identity/identity.pb.h"
 #include "asylo/identity/platform/sgx/internal/identity_key_management_structs.h"
 #include "asylo/identity/platform/sgx/sgx_identity.pb.h"
 
@@ -41,10 +42,19 @@ struct SelfIdentity {
 
   // Protobuf represenation of the enclave identity.
   SgxIdentity sgx_identity;
+
+  // |sgx_identity| serialized into an EnclaveIdentity, as used in assertions
+  // and sealed secret headers.
+  EnclaveIdentity identity;
+
+  // SHA-256 digest of the serialized code identity of |sgx_identity|.
+  UnsafeBytes<SHA256_DIGEST_LENGTH> code_identity_hash;
 };
 
 // Returns a pointer to a SelfIdentity object that holds identity of the current
-// enclave. The ownership of the object remains with the callee.
+// enclave. The ownership of the object remains with the callee. Inside an
+// enclave, the object is populated once and is immutable afterwards, so it may
+// be shared by any number of threads.
 const SelfIdentity *GetSelfIdentity();
 
 }  // namespace sgx
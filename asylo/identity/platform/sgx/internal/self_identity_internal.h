@@ -22,6 +22,10 @@
 // Note: This is an internal header; it must not be included in any files other
 // than self_identity.cc and fake_self_identity.cc.
 
+#include <openssl/sha.h>
+
+#include <string>
+
 #include "asylo/crypto/util/trivial_object_util.h"
 #include "asylo/util/logging.h"
 #include "asylo/identity/platform/sgx/internal/hardware_interface.h"
@@ -54,6 +58,14 @@ SelfIdentity::SelfIdentity() {
   isvsvn = report.body.isvsvn;
 
   sgx_identity = ParseSgxIdentityFromHardwareReport(report.body);
+
+  // The identity parsed from the hardware report is always valid.
+  Status status = SerializeSgxIdentity(sgx_identity, &identity);
+  CHECK(status.ok()) << status;
+
+  std::string code_identity = sgx_identity.code_identity().SerializeAsString();
+  SHA256(reinterpret_cast<const uint8_t *>(code_identity.data()),
+         code_identity.size(), code_identity_hash.data());
 }
 
 }  // namespace sgx
@@ -71,32 +71,6 @@ std::string WithAppendedExplanations(
   return absl::StrCat(current, " and ", absl::StrJoin(explanations, " and "));
 }
 
-// Retrieves the report key associated with |keyid| for the current enclave and
-// writes it to |key|.
-StatusOr<HardwareKey> GetReportKey(
-    const UnsafeBytes<kKeyrequestKeyidSize> &keyid) {
-  // Set KEYREQUEST to request the REPORT_KEY with the KEYID value specified in
-  // the report to be verified.
-  AlignedKeyrequestPtr request;
-
-  // Zero-out the KEYREQUEST. SGX hardware requires that the reserved fields of
-  // KEYREQUEST be set to zero.
-  *request = TrivialZeroObject<Keyrequest>();
-
-  request->keyname = KeyrequestKeyname::REPORT_KEY;
-  request->keyid = keyid;
-
-  // The following fields of KEYREQUEST are ignored by the SGX hardware. These
-  // are just initialized to some sane values.
-  request->keypolicy = kKeypolicyMrenclaveBitMask;
-  request->isvsvn = 0;
-  request->cpusvn.fill(0);
-  request->attributemask.Clear();
-  request->miscmask = 0;
-
-  return HardwareInterface::CreateDefault()->GetKey(*request);
-}
-
 StatusOr<bool> MatchIdentityToExpectation(const CodeIdentity &identity,
                                           const CodeIdentity &expected,
                                           const CodeIdentityMatchSpec &spec,
@@ -321,6 +295,87 @@ StatusOr<bool> MatchIdentityToExpectation(
   return explanations.empty() && code_identity_match_result;
 }
 
+StatusOr<CompiledSgxIdentityExpectation> CompiledSgxIdentityExpectation::Create(
+    const SgxIdentityExpectation &expectation) {
+  if (!IsValidExpectation(expectation)) {
+    return Status(::asylo::error::GoogleError::INVALID_ARGUMENT,
+                  "Expectation parameter is invalid");
+  }
+  return CompiledSgxIdentityExpectation(expectation);
+}
+
+CompiledSgxIdentityExpectation::CompiledSgxIdentityExpectation(
+    const SgxIdentityExpectation &expectation)
+    : expectation_(expectation) {
+  const SgxIdentity &reference = expectation.reference_identity();
+  const CodeIdentity &code_identity = reference.code_identity();
+  const CodeIdentityMatchSpec &code_spec =
+      expectation.match_spec().code_identity_match_spec();
+  const MachineConfigurationMatchSpec &machine_config_spec =
+      expectation.match_spec().machine_configuration_match_spec();
+
+  is_mrenclave_match_required_ = code_spec.is_mrenclave_match_required();
+  is_mrsigner_match_required_ = code_spec.is_mrsigner_match_required();
+  is_cpu_svn_match_required_ = machine_config_spec.is_cpu_svn_match_required();
+  is_sgx_type_match_required_ =
+      machine_config_spec.is_sgx_type_match_required();
+
+  mrenclave_ = code_identity.mrenclave().hash();
+  mrsigner_ = code_identity.signer_assigned_identity().mrsigner().hash();
+  cpu_svn_ = reference.machine_configuration().cpu_svn().value();
+  sgx_type_ = reference.machine_configuration().sgx_type();
+  isvprodid_ = code_identity.signer_assigned_identity().isvprodid();
+  isvsvn_ = code_identity.signer_assigned_identity().isvsvn();
+
+  miscselect_match_mask_ = code_spec.miscselect_match_mask();
+  masked_miscselect_ = miscselect_match_mask_ & code_identity.miscselect();
+  flags_match_mask_ = code_spec.attributes_match_mask().flags();
+  masked_flags_ = flags_match_mask_ & code_identity.attributes().flags();
+  xfrm_match_mask_ = code_spec.attributes_match_mask().xfrm();
+  masked_xfrm_ = xfrm_match_mask_ & code_identity.attributes().xfrm();
+}
+
+StatusOr<bool> CompiledSgxIdentityExpectation::Match(
+    const SgxIdentity &identity, std::string *explanation) const {
+  // Invalid identities and failed matches are rare, so defer to the uncompiled
+  // match for the error and explanation.
+  if (!IsValidSgxIdentity(identity) ||
+      !IsIdentityCompatibleWithMatchSpec(identity, expectation_.match_spec()) ||
+      !Matches(identity)) {
+    return MatchIdentityToExpectation(identity, expectation_, explanation);
+  }
+  if (explanation != nullptr) {
+    explanation->clear();
+  }
+  return true;
+}
+
+bool CompiledSgxIdentityExpectation::Matches(
+    const SgxIdentity &identity) const {
+  const CodeIdentity &code_identity = identity.code_identity();
+  const SignerAssignedIdentity &signer_assigned_identity =
+      code_identity.signer_assigned_identity();
+  const MachineConfiguration &machine_config =
+      identity.machine_configuration();
+
+  return (miscselect_match_mask_ & code_identity.miscselect()) ==
+             masked_miscselect_ &&
+         (flags_match_mask_ & code_identity.attributes().flags()) ==
+             masked_flags_ &&
+         (xfrm_match_mask_ & code_identity.attributes().xfrm()) ==
+             masked_xfrm_ &&
+         signer_assigned_identity.isvprodid() == isvprodid_ &&
+         signer_assigned_identity.isvsvn() >= isvsvn_ &&
+         (!is_mrsigner_match_required_ ||
+          signer_assigned_identity.mrsigner().hash() == mrsigner_) &&
+         (!is_mrenclave_match_required_ ||
+          code_identity.mrenclave().hash() == mrenclave_) &&
+         (!is_cpu_svn_match_required_ ||
+          machine_config.cpu_svn().value() == cpu_svn_) &&
+         (!is_sgx_type_match_required_ ||
+          machine_config.sgx_type() == sgx_type_);
+}
+
 Status SetExpectation(const SgxIdentityMatchSpec &match_spec,
                       const SgxIdentity &identity,
                       SgxIdentityExpectation *expectation) {
@@ -444,40 +499,32 @@ Status SetDefaultLocalSelfSgxExpectation(SgxIdentityExpectation *expectation) {
   SgxIdentityMatchSpec match_spec;
   SetDefaultLocalSgxMatchSpec(&match_spec);
 
-  SgxIdentity self_identity;
-  SetSelfSgxIdentity(&self_identity);
-
-  return SetExpectation(match_spec, self_identity, expectation);
+  return SetExpectation(match_spec, GetSelfIdentity()->sgx_identity,
+                        expectation);
 }
 
 Status SetStrictLocalSelfSgxExpectation(SgxIdentityExpectation *expectation) {
   SgxIdentityMatchSpec match_spec;
   SetStrictLocalSgxMatchSpec(&match_spec);
 
-  SgxIdentity self_identity;
-  SetSelfSgxIdentity(&self_identity);
-
-  return SetExpectation(match_spec, self_identity, expectation);
+  return SetExpectation(match_spec, GetSelfIdentity()->sgx_identity,
+                        expectation);
 }
 
 Status SetDefaultRemoteSelfSgxExpectation(SgxIdentityExpectation *expectation) {
   SgxIdentityMatchSpec match_spec;
   SetDefaultRemoteSgxMatchSpec(&match_spec);
 
-  SgxIdentity self_identity;
-  SetSelfSgxIdentity(&self_identity);
-
-  return SetExpectation(match_spec, self_identity, expectation);
+  return SetExpectation(match_spec, GetSelfIdentity()->sgx_identity,
+                        expectation);
 }
 
 Status SetStrictRemoteSelfSgxExpectation(SgxIdentityExpectation *expectation) {
   SgxIdentityMatchSpec match_spec;
   SetStrictRemoteSgxMatchSpec(&match_spec);
 
-  SgxIdentity self_identity;
-  SetSelfSgxIdentity(&self_identity);
-
-  return SetExpectation(match_spec, self_identity, expectation);
+  return SetExpectation(match_spec, GetSelfIdentity()->sgx_identity,
+                        expectation);
 }
 
 Status ParseSgxIdentity(const EnclaveIdentity &generic_identity,
@@ -598,10 +645,38 @@ void SetTargetinfoFromSelfIdentity(Targetinfo *tinfo) {
   tinfo->miscselect = self_identity->miscselect;
 }
 
+StatusOr<HardwareKey> GetReportKey(
+    const UnsafeBytes<kKeyrequestKeyidSize> &keyid) {
+  // Set KEYREQUEST to request the REPORT_KEY with the KEYID value specified in
+  // the report to be verified.
+  AlignedKeyrequestPtr request;
+
+  // Zero-out the KEYREQUEST. SGX hardware requires that the reserved fields of
+  // KEYREQUEST be set to zero.
+  *request = TrivialZeroObject<Keyrequest>();
+
+  request->keyname = KeyrequestKeyname::REPORT_KEY;
+  request->keyid = keyid;
+
+  // The following fields of KEYREQUEST are ignored by the SGX hardware. These
+  // are just initialized to some sane values.
+  request->keypolicy = kKeypolicyMrenclaveBitMask;
+  request->isvsvn = 0;
+  request->cpusvn.fill(0);
+  request->attributemask.Clear();
+  request->miscmask = 0;
+
+  return HardwareInterface::CreateDefault()->GetKey(*request);
+}
+
 Status VerifyHardwareReport(const Report &report) {
   HardwareKey report_key;
   ASYLO_ASSIGN_OR_RETURN(report_key, GetReportKey(report.keyid));
+  return VerifyHardwareReportWithKey(report, report_key);
+}
 
+Status VerifyHardwareReportWithKey(const Report &report,
+                                   const HardwareKey &report_key) {
   // Compute the report MAC. SGX uses CMAC to MAC the contents of the report.
   // The last two fields (KEYID and MAC) from the REPORT struct are not
   // included in the MAC computation.
@@ -19,8 +19,10 @@
 #ifndef ASYLO_IDENTITY_PLATFORM_SGX_INTERNAL_SGX_IDENTITY_UTIL_INTERNAL_H_
 #define ASYLO_IDENTITY_PLATFORM_SGX_INTERNAL_SGX_IDENTITY_UTIL_INTERNAL_H_
 
+#include <cstdint>
 #include <string>
 
+#include "asylo/crypto/util/bytes.h"
 #include "asylo/identity/identity.pb.h"
 #include "asylo/identity/platform/sgx/code_identity.pb.h"
 #include "asylo/identity/platform/sgx/internal/code_identity_constants.h"
@@ -39,6 +41,55 @@ StatusOr<bool> MatchIdentityToExpectation(
     const SgxIdentity &identity, const SgxIdentityExpectation &expectation,
     std::string *explanation);
 
+// An SgxIdentityExpectation preprocessed for repeated matching. The fields
+// that the match spec requires to match are extracted from the reference
+// identity and pre-masked, so that a successful match is a handful of
+// comparisons. Matching gives the same result as MatchIdentityToExpectation();
+// explanations of failed matches are produced by that function.
+class CompiledSgxIdentityExpectation {
+ public:
+  // Compiles |expectation|. Returns an INVALID_ARGUMENT error if
+  // |expectation| is invalid.
+  static StatusOr<CompiledSgxIdentityExpectation> Create(
+      const SgxIdentityExpectation &expectation);
+
+  // Matches |identity| to the compiled expectation. Returns true if the match
+  // is successful, else returns false and populates |explanation| with an
+  // explanation of why the match failed.
+  StatusOr<bool> Match(const SgxIdentity &identity,
+                       std::string *explanation) const;
+
+  // Returns the expectation that was compiled.
+  const SgxIdentityExpectation &expectation() const { return expectation_; }
+
+ private:
+  explicit CompiledSgxIdentityExpectation(
+      const SgxIdentityExpectation &expectation);
+
+  // Returns whether a valid |identity| that is compatible with the match spec
+  // matches the compiled expectation.
+  bool Matches(const SgxIdentity &identity) const;
+
+  SgxIdentityExpectation expectation_;
+
+  bool is_mrenclave_match_required_;
+  bool is_mrsigner_match_required_;
+  bool is_cpu_svn_match_required_;
+  bool is_sgx_type_match_required_;
+  std::string mrenclave_;
+  std::string mrsigner_;
+  std::string cpu_svn_;
+  int sgx_type_;
+  uint32_t isvprodid_;
+  uint32_t isvsvn_;
+  uint32_t miscselect_match_mask_;
+  uint32_t masked_miscselect_;
+  uint64_t flags_match_mask_;
+  uint64_t masked_flags_;
+  uint64_t xfrm_match_mask_;
+  uint64_t masked_xfrm_;
+};
+
 // Sets |expectation| based on |identity| and |match_spec|, checking the
 // validity of both components.
 Status SetExpectation(const SgxIdentityMatchSpec &match_spec,
@@ -135,9 +186,20 @@ Status SerializeSgxExpectation(const SgxIdentityExpectation &sgx_expectation,
 // this TARGETINFO are targeted at this enclave.
 void SetTargetinfoFromSelfIdentity(Targetinfo *tinfo);
 
+// Retrieves the report key associated with |keyid| for the current enclave.
+// The key only depends on |keyid| and on the identity of the current enclave,
+// so callers that verify many reports may cache it.
+StatusOr<HardwareKey> GetReportKey(
+    const UnsafeBytes<kKeyrequestKeyidSize> &keyid);
+
 // Verifies the hardware report |report|.
 Status VerifyHardwareReport(const Report &report);
 
+// Verifies the hardware report |report| using |report_key|, which must be the
+// report key retrieved with GetReportKey() for |report|.keyid.
+Status VerifyHardwareReportWithKey(const Report &report,
+                                   const HardwareKey &report_key);
+
 }  // namespace sgx
 }  // namespace asylo
 
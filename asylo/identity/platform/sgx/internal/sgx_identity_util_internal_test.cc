@@ -24,6 +24,7 @@
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include "asylo/crypto/sha256_hash.h"
 #include "asylo/crypto/sha256_hash.pb.h"
 #include "asylo/crypto/sha256_hash_util.h"
 #include "asylo/crypto/util/bytes.h"
@@ -767,6 +768,51 @@ TEST_F(SgxIdentityUtilInternalTest, SgxIdentityMatchInvalidExpectation) {
                        "Expectation parameter is invalid"));
 }
 
+// Make sure that a compiled expectation gives the same results and
+// explanations as MatchIdentityToExpectation().
+TEST_F(SgxIdentityUtilInternalTest, CompiledExpectationMatchesUncompiled) {
+  for (int i = 0; i < kNumRandomParseTrials; i++) {
+    SgxIdentityExpectation expectation = GetRandomValidSgxExpectation();
+    CompiledSgxIdentityExpectation compiled =
+        CompiledSgxIdentityExpectation::Create(expectation).ValueOrDie();
+
+    // Random identities rarely match, so also try the reference identity and
+    // variants of it that differ in a single field.
+    std::vector<SgxIdentity> identities(4, expectation.reference_identity());
+    identities[1] = GetRandomValidSgxIdentity();
+    CodeIdentity *code_identity = identities[2].mutable_code_identity();
+    code_identity->set_miscselect(code_identity->miscselect() ^
+                                  (1u << (i % 32)));
+    SignerAssignedIdentity *signer_assigned_identity =
+        identities[3]
+            .mutable_code_identity()
+            ->mutable_signer_assigned_identity();
+    signer_assigned_identity->set_isvsvn(signer_assigned_identity->isvsvn() +
+                                         (i % 3) - 1);
+
+    for (const SgxIdentity &identity : identities) {
+      std::string expected_explanation;
+      StatusOr<bool> expected_result = MatchIdentityToExpectation(
+          identity, expectation, &expected_explanation);
+      std::string explanation;
+      StatusOr<bool> result = compiled.Match(identity, &explanation);
+      ASSERT_EQ(result.ok(), expected_result.ok());
+      if (result.ok()) {
+        EXPECT_EQ(result.ValueOrDie(), expected_result.ValueOrDie());
+        EXPECT_EQ(explanation, expected_explanation);
+      }
+    }
+  }
+}
+
+// Make sure that an invalid expectation cannot be compiled.
+TEST_F(SgxIdentityUtilInternalTest, CompiledExpectationInvalidExpectation) {
+  EXPECT_THAT(
+      CompiledSgxIdentityExpectation::Create(SgxIdentityExpectation()),
+      StatusIs(::asylo::error::GoogleError::INVALID_ARGUMENT,
+               "Expectation parameter is invalid"));
+}
+
 // Make sure that enclave identity match fails with appropriate status if the
 // target identity is invalid.
 TEST_F(SgxIdentityUtilInternalTest, SgxIdentityMatchInvalidIdentity) {
@@ -1206,6 +1252,21 @@ TEST_F(SgxIdentityUtilInternalTest, SetTargetinfoFromSelfIdentity) {
             TrivialZeroObject<UnsafeBytes<sizeof(tinfo->reserved2)>>());
 }
 
+TEST_F(SgxIdentityUtilInternalTest, SelfIdentitySerializedForms) {
+  const SelfIdentity *self_identity = GetSelfIdentity();
+
+  SgxIdentity parsed_identity;
+  ASYLO_ASSERT_OK(ParseSgxIdentity(self_identity->identity, &parsed_identity));
+  EXPECT_THAT(parsed_identity, EqualsProto(self_identity->sgx_identity));
+
+  Sha256Hash hash;
+  hash.Update(self_identity->sgx_identity.code_identity().SerializeAsString());
+  std::vector<uint8_t> digest;
+  ASYLO_ASSERT_OK(hash.CumulativeHash(&digest));
+  EXPECT_EQ(self_identity->code_identity_hash,
+            UnsafeBytes<SHA256_DIGEST_LENGTH>(digest));
+}
+
 TEST_F(SgxIdentityUtilInternalTest, VerifyHardwareReportPositive) {
   AlignedTargetinfoPtr tinfo;
   SetTargetinfoFromSelfIdentity(tinfo.get());
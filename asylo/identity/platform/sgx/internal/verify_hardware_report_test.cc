@@ -62,6 +62,36 @@ TEST(VerifyHardwareReportTest, VerifyHardwareReportFailsWhenTargetIsNotSelf) {
   ASSERT_THAT(VerifyHardwareReport(report), Not(IsOk()));
 }
 
+// Verify that VerifyHardwareReportWithKey() accepts reports MACed with the
+// given report key, which can be reused across reports with the same KEYID.
+TEST(VerifyHardwareReportTest, VerifyHardwareReportWithKeyReusesReportKey) {
+  AlignedTargetinfoPtr targetinfo;
+  SetTargetinfoFromSelfIdentity(targetinfo.get());
+
+  AlignedReportdataPtr reportdata;
+  reportdata->data = TrivialRandomObject<UnsafeBytes<kReportdataSize>>();
+
+  Report report;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      report,
+      HardwareInterface::CreateDefault()->GetReport(*targetinfo, *reportdata));
+  HardwareKey report_key;
+  ASYLO_ASSERT_OK_AND_ASSIGN(report_key, GetReportKey(report.keyid));
+  ASYLO_ASSERT_OK(VerifyHardwareReportWithKey(report, report_key));
+
+  reportdata->data = TrivialRandomObject<UnsafeBytes<kReportdataSize>>();
+  Report other_report;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      other_report,
+      HardwareInterface::CreateDefault()->GetReport(*targetinfo, *reportdata));
+  ASSERT_EQ(other_report.keyid, report.keyid);
+  ASYLO_ASSERT_OK(VerifyHardwareReportWithKey(other_report, report_key));
+
+  other_report.body.reportdata.data[0] ^= 1;
+  ASSERT_THAT(VerifyHardwareReportWithKey(other_report, report_key),
+              Not(IsOk()));
+}
+
 }  // namespace
 }  // namespace sgx
 }  // namespace asylo
@@ -24,6 +24,12 @@
 #include "asylo/util/status_macros.h"
 
 namespace asylo {
+namespace {
+
+// Maximum number of compiled expectations cached by a matcher.
+constexpr size_t kMaxCompiledExpectations = 64;
+
+}  // namespace
 
 StatusOr<bool> SgxIdentityExpectationMatcher::MatchAndExplain(
     const EnclaveIdentity &identity,
@@ -36,12 +42,47 @@ StatusOr<bool> SgxIdentityExpectationMatcher::MatchAndExplain(
 
   // If this call fails, then |expectation|.reference_identity() either does not
   // have the correct description, or is malformed.
+  std::shared_ptr<const sgx::CompiledSgxIdentityExpectation> compiled;
+  ASYLO_ASSIGN_OR_RETURN(compiled, GetCompiledExpectation(expectation));
+
+  return compiled->Match(sgx_identity, explanation);
+}
+
+StatusOr<std::shared_ptr<const sgx::CompiledSgxIdentityExpectation>>
+SgxIdentityExpectationMatcher::GetCompiledExpectation(
+    const EnclaveIdentityExpectation &expectation) const {
+  // The key covers the whole reference identity, including its description,
+  // so that a cached expectation is only used for the exact expectation that
+  // was parsed.
+  std::pair<std::string, std::string> key(
+      expectation.reference_identity().SerializeAsString(),
+      expectation.match_spec());
+  {
+    absl::MutexLock lock(&mu_);
+    auto it = compiled_expectations_.find(key);
+    if (it != compiled_expectations_.end()) {
+      return it->second;
+    }
+  }
+
   SgxIdentityExpectation sgx_identity_expectation;
   ASYLO_RETURN_IF_ERROR(
       sgx::ParseSgxExpectation(expectation, &sgx_identity_expectation));
+  StatusOr<sgx::CompiledSgxIdentityExpectation> compiled_result =
+      sgx::CompiledSgxIdentityExpectation::Create(sgx_identity_expectation);
+  if (!compiled_result.ok()) {
+    return compiled_result.status();
+  }
+  auto shared_compiled =
+      std::make_shared<const sgx::CompiledSgxIdentityExpectation>(
+          std::move(compiled_result).ValueOrDie());
 
-  return sgx::MatchIdentityToExpectation(sgx_identity, sgx_identity_expectation,
-                                         explanation);
+  absl::MutexLock lock(&mu_);
+  if (compiled_expectations_.size() >= kMaxCompiledExpectations) {
+    compiled_expectations_.clear();
+  }
+  compiled_expectations_.emplace(std::move(key), shared_compiled);
+  return shared_compiled;
 }
 
 EnclaveIdentityDescription SgxIdentityExpectationMatcher::Description() const {
@@ -19,16 +19,25 @@
 #ifndef ASYLO_IDENTITY_PLATFORM_SGX_SGX_IDENTITY_EXPECTATION_MATCHER_H_
 #define ASYLO_IDENTITY_PLATFORM_SGX_SGX_IDENTITY_EXPECTATION_MATCHER_H_
 
+#include <memory>
 #include <string>
+#include <utility>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
 #include "asylo/identity/identity.pb.h"
 #include "asylo/identity/named_identity_expectation_matcher.h"
+#include "asylo/identity/platform/sgx/internal/sgx_identity_util_internal.h"
 #include "asylo/util/statusor.h"
 
 namespace asylo {
 
 /// `SgxIdentityExpectationMatcher` is capable of matching SGX identities with
 /// SGX identity expectations.
+///
+/// Expectations are parsed and compiled once, and the compiled form is reused
+/// by later matches against the same expectation.
 class SgxIdentityExpectationMatcher final
     : public NamedIdentityExpectationMatcher {
  public:
@@ -52,6 +61,20 @@ class SgxIdentityExpectationMatcher final
   /// \return A description of the enclave identities/enclave identity
   ///         expectations this matcher is able to match.
   EnclaveIdentityDescription Description() const override;
+
+ private:
+  // Returns the compiled form of |expectation|, compiling it if it is not
+  // cached.
+  StatusOr<std::shared_ptr<const sgx::CompiledSgxIdentityExpectation>>
+  GetCompiledExpectation(const EnclaveIdentityExpectation &expectation) const;
+
+  // Compiled expectations, keyed by the serialized reference identity and the
+  // match spec of the generic expectation.
+  mutable absl::Mutex mu_;
+  mutable absl::flat_hash_map<
+      std::pair<std::string, std::string>,
+      std::shared_ptr<const sgx::CompiledSgxIdentityExpectation>>
+      compiled_expectations_ ABSL_GUARDED_BY(mu_);
 };
 
 }  // namespace asylo
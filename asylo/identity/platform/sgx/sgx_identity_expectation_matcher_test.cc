@@ -107,6 +107,40 @@ TEST(SgxIdentityExpectationMatcherTest, MatchAndExplain) {
   }
 }
 
+// Tests that an SgxIdentityExpectationMatcher that has already matched an
+// expectation gives the same results when the expectation is matched again.
+TEST(SgxIdentityExpectationMatcherTest, RepeatedMatches) {
+  EnclaveIdentityExpectation expectation;
+  SgxIdentityExpectation sgx_identity_expectation;
+  ASYLO_ASSERT_OK(sgx::SetRandomValidGenericExpectation(
+      &expectation, &sgx_identity_expectation));
+
+  SgxIdentity sgx_identity = sgx_identity_expectation.reference_identity();
+  sgx_identity.mutable_code_identity()->set_miscselect(
+      ~sgx_identity.code_identity().miscselect());
+  sgx_identity_expectation.mutable_match_spec()
+      ->mutable_code_identity_match_spec()
+      ->set_miscselect_match_mask(~0u);
+  ASYLO_ASSERT_OK(
+      sgx::SerializeSgxExpectation(sgx_identity_expectation, &expectation));
+  EnclaveIdentity mismatched_identity;
+  ASYLO_ASSERT_OK(
+      sgx::SerializeSgxIdentity(sgx_identity, &mismatched_identity));
+
+  SgxIdentityExpectationMatcher matcher;
+  for (int i = 0; i < 3; ++i) {
+    std::string explanation;
+    EXPECT_THAT(matcher.MatchAndExplain(expectation.reference_identity(),
+                                        expectation, &explanation),
+                IsOkAndHolds(true));
+    EXPECT_THAT(explanation, IsEmpty());
+    EXPECT_THAT(
+        matcher.MatchAndExplain(mismatched_identity, expectation, &explanation),
+        IsOkAndHolds(false));
+    EXPECT_THAT(explanation, Not(IsEmpty()));
+  }
+}
+
 // Tests that SgxIdentityExpectationMatcher returns a non-OK status when
 // invoked with invalid SGX identity.
 TEST(SgxIdentityExpectationMatcherTest, MatchInvalidIdentity) {
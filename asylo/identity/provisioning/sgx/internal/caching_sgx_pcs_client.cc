@@ -0,0 +1,412 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include "asylo/identity/provisioning/sgx/internal/caching_sgx_pcs_client.h"
+
+#include <openssl/asn1.h>
+#include <openssl/bio.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/notification.h"
+#include "asylo/crypto/sha256_hash.h"
+#include "asylo/crypto/util/bssl_util.h"
+#include "asylo/identity/provisioning/sgx/internal/tcb_info_from_json.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/proto_parse_util.h"
+#include "asylo/util/status.h"
+#include "asylo/util/time_conversions.h"
+
+namespace asylo {
+namespace sgx {
+namespace {
+
+// Converts |asn1_time| to an absl::Time.
+StatusOr<absl::Time> AbslTimeFromAsn1Time(const ASN1_TIME &asn1_time) {
+  bssl::UniquePtr<ASN1_TIME> unix_epoch(ASN1_TIME_new());
+  if (!unix_epoch || ASN1_TIME_set(unix_epoch.get(), 0) == nullptr) {
+    return Status(error::GoogleError::INTERNAL, BsslLastErrorString());
+  }
+  int num_days;
+  int num_seconds;
+  if (ASN1_TIME_diff(&num_days, &num_seconds, unix_epoch.get(), &asn1_time) !=
+      1) {
+    return Status(error::GoogleError::INTERNAL, BsslLastErrorString());
+  }
+  return absl::UnixEpoch() + num_days * absl::Hours(24) +
+         absl::Seconds(num_seconds);
+}
+
+// Returns the "nextUpdate" time of |crl|.
+StatusOr<absl::Time> CrlNextUpdate(const CertificateRevocationList &crl) {
+  bssl::UniquePtr<X509_CRL> x509_crl;
+  switch (crl.format()) {
+    case CertificateRevocationList::X509_DER: {
+      const uint8_t *data =
+          reinterpret_cast<const uint8_t *>(crl.data().data());
+      x509_crl.reset(d2i_X509_CRL(/*out=*/nullptr, &data, crl.data().size()));
+      break;
+    }
+    case CertificateRevocationList::X509_PEM: {
+      bssl::UniquePtr<BIO> bio(
+          BIO_new_mem_buf(crl.data().data(), crl.data().size()));
+      if (!bio) {
+        return Status(error::GoogleError::INTERNAL, BsslLastErrorString());
+      }
+      x509_crl.reset(PEM_read_bio_X509_CRL(bio.get(), /*x=*/nullptr,
+                                           /*cb=*/nullptr, /*u=*/nullptr));
+      break;
+    }
+    default:
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    "Unsupported CRL format");
+  }
+  if (!x509_crl) {
+    return Status(error::GoogleError::INVALID_ARGUMENT, BsslLastErrorString());
+  }
+  const ASN1_TIME *next_update = X509_CRL_get0_nextUpdate(x509_crl.get());
+  if (next_update == nullptr) {
+    return Status(error::GoogleError::NOT_FOUND, "CRL has no nextUpdate");
+  }
+  return AbslTimeFromAsn1Time(*next_update);
+}
+
+// Returns the "nextUpdate" time of |tcb_info|.
+StatusOr<absl::Time> TcbInfoNextUpdate(const SignedTcbInfo &tcb_info) {
+  TcbInfo parsed;
+  ASYLO_ASSIGN_OR_RETURN(parsed, TcbInfoFromJson(tcb_info.tcb_info_json()));
+  return ConvertTime<absl::Time>(parsed.impl().next_update());
+}
+
+}  // namespace
+
+struct CachingSgxPcsClient::Flight {
+  absl::Notification done;
+  StatusOr<CachedSgxPcsResponse> result;
+};
+
+std::unique_ptr<CachingSgxPcsClient> CachingSgxPcsClient::Create(
+    std::unique_ptr<SgxPcsClient> client, CachingSgxPcsClientOptions options) {
+  return absl::WrapUnique(
+      new CachingSgxPcsClient(std::move(client), std::move(options)));
+}
+
+CachingSgxPcsClient::CachingSgxPcsClient(std::unique_ptr<SgxPcsClient> client,
+                                         CachingSgxPcsClientOptions options)
+    : client_(std::move(client)),
+      options_(std::move(options)),
+      refresh_thread_(&CachingSgxPcsClient::RefreshLoop, this) {}
+
+CachingSgxPcsClient::~CachingSgxPcsClient() {
+  {
+    absl::MutexLock lock(&mu_);
+    stopping_ = true;
+  }
+  refresh_thread_.Join();
+}
+
+StatusOr<GetPckCertificateResult> CachingSgxPcsClient::GetPckCertificate(
+    const Ppid &ppid, const CpuSvn &cpu_svn, const PceSvn &pce_svn,
+    const PceId &pce_id) {
+  std::string key = absl::StrCat(
+      "pck_certificate:", absl::BytesToHexString(ppid.value()), ":",
+      absl::BytesToHexString(cpu_svn.value()), ":", pce_svn.value(), ":",
+      pce_id.value());
+  CachedSgxPcsResponse response;
+  ASYLO_ASSIGN_OR_RETURN(
+      response,
+      Get(key, [this, ppid, cpu_svn, pce_svn,
+                pce_id]() -> StatusOr<CachedSgxPcsResponse> {
+        GetPckCertificateResult result;
+        ASYLO_ASSIGN_OR_RETURN(result, client_->GetPckCertificate(
+                                           ppid, cpu_svn, pce_svn, pce_id));
+        CachedSgxPcsResponse response;
+        *response.mutable_pck_cert() = std::move(result.pck_cert);
+        *response.mutable_tcbm() = std::move(result.tcbm);
+        *response.mutable_issuer_cert_chain() =
+            std::move(result.issuer_cert_chain);
+        SetExpiry(options_.pck_certificate_lifetime, &response);
+        return response;
+      }));
+
+  GetPckCertificateResult result;
+  result.pck_cert = std::move(*response.mutable_pck_cert());
+  result.tcbm = std::move(*response.mutable_tcbm());
+  result.issuer_cert_chain = std::move(*response.mutable_issuer_cert_chain());
+  return result;
+}
+
+StatusOr<GetPckCertificatesResult> CachingSgxPcsClient::GetPckCertificates(
+    const Ppid &ppid, const PceId &pce_id) {
+  std::string key =
+      absl::StrCat("pck_certificates:", absl::BytesToHexString(ppid.value()),
+                   ":", pce_id.value());
+  CachedSgxPcsResponse response;
+  ASYLO_ASSIGN_OR_RETURN(
+      response,
+      Get(key, [this, ppid, pce_id]() -> StatusOr<CachedSgxPcsResponse> {
+        GetPckCertificatesResult result;
+        ASYLO_ASSIGN_OR_RETURN(result,
+                               client_->GetPckCertificates(ppid, pce_id));
+        CachedSgxPcsResponse response;
+        *response.mutable_pck_certs() = std::move(result.pck_certs);
+        *response.mutable_issuer_cert_chain() =
+            std::move(result.issuer_cert_chain);
+        SetExpiry(options_.pck_certificate_lifetime, &response);
+        return response;
+      }));
+
+  GetPckCertificatesResult result;
+  result.pck_certs = std::move(*response.mutable_pck_certs());
+  result.issuer_cert_chain = std::move(*response.mutable_issuer_cert_chain());
+  return result;
+}
+
+StatusOr<GetCrlResult> CachingSgxPcsClient::GetCrl(SgxCaType sgx_ca_type) {
+  std::string key = absl::StrCat("crl:", sgx_ca_type);
+  CachedSgxPcsResponse response;
+  ASYLO_ASSIGN_OR_RETURN(
+      response,
+      Get(key, [this, sgx_ca_type]() -> StatusOr<CachedSgxPcsResponse> {
+        GetCrlResult result;
+        ASYLO_ASSIGN_OR_RETURN(result, client_->GetCrl(sgx_ca_type));
+        CachedSgxPcsResponse response;
+        SetExpiry(CrlNextUpdate(result.pck_crl), &response);
+        *response.mutable_pck_crl() = std::move(result.pck_crl);
+        *response.mutable_issuer_cert_chain() =
+            std::move(result.issuer_cert_chain);
+        return response;
+      }));
+
+  GetCrlResult result;
+  result.pck_crl = std::move(*response.mutable_pck_crl());
+  result.issuer_cert_chain = std::move(*response.mutable_issuer_cert_chain());
+  return result;
+}
+
+StatusOr<GetTcbInfoResult> CachingSgxPcsClient::GetTcbInfo(const Fmspc &fmspc) {
+  std::string key =
+      absl::StrCat("tcb_info:", absl::BytesToHexString(fmspc.value()));
+  CachedSgxPcsResponse response;
+  ASYLO_ASSIGN_OR_RETURN(
+      response,
+      Get(key, [this, fmspc]() -> StatusOr<CachedSgxPcsResponse> {
+        GetTcbInfoResult result;
+        ASYLO_ASSIGN_OR_RETURN(result, client_->GetTcbInfo(fmspc));
+        CachedSgxPcsResponse response;
+        SetExpiry(TcbInfoNextUpdate(result.tcb_info), &response);
+        *response.mutable_tcb_info() = std::move(result.tcb_info);
+        *response.mutable_issuer_cert_chain() =
+            std::move(result.issuer_cert_chain);
+        return response;
+      }));
+
+  GetTcbInfoResult result;
+  result.tcb_info = std::move(*response.mutable_tcb_info());
+  result.issuer_cert_chain = std::move(*response.mutable_issuer_cert_chain());
+  return result;
+}
+
+StatusOr<CachedSgxPcsResponse> CachingSgxPcsClient::Get(
+    const std::string &key, const Fetcher &fetch) {
+  absl::optional<CachedSgxPcsResponse> cached = Lookup(key);
+  if (!cached.has_value()) {
+    return Fetch(key, fetch);
+  }
+
+  absl::Time now = options_.clock();
+  StatusOr<absl::Time> expiry_result =
+      ConvertTime<absl::Time>(cached->expiry());
+  absl::Time expiry =
+      expiry_result.ok() ? expiry_result.ValueOrDie() : absl::InfinitePast();
+  if (now >= expiry) {
+    return Fetch(key, fetch);
+  }
+  if (now >= expiry - options_.refresh_margin) {
+    ScheduleRefresh(key, fetch);
+  }
+  return std::move(cached).value();
+}
+
+StatusOr<CachedSgxPcsResponse> CachingSgxPcsClient::Fetch(
+    const std::string &key, const Fetcher &fetch) {
+  std::shared_ptr<Flight> flight;
+  bool leader = false;
+  {
+    absl::MutexLock lock(&mu_);
+    auto it = flights_.find(key);
+    if (it == flights_.end()) {
+      it = flights_.emplace(key, std::make_shared<Flight>()).first;
+      leader = true;
+    }
+    flight = it->second;
+  }
+
+  if (!leader) {
+    flight->done.WaitForNotification();
+    return flight->result;
+  }
+
+  flight->result = fetch();
+  if (flight->result.ok()) {
+    Store(key, flight->result.ValueOrDie());
+  }
+  {
+    absl::MutexLock lock(&mu_);
+    flights_.erase(key);
+  }
+  flight->done.Notify();
+  return flight->result;
+}
+
+absl::optional<CachedSgxPcsResponse> CachingSgxPcsClient::Lookup(
+    const std::string &key) {
+  {
+    absl::MutexLock lock(&mu_);
+    auto it = responses_.find(key);
+    if (it != responses_.end()) {
+      return it->second;
+    }
+  }
+  if (options_.cache_directory.empty()) {
+    return absl::nullopt;
+  }
+
+  // Parse the cache file in place rather than streaming it into a buffer.
+  StatusOr<CachedSgxPcsResponse> response =
+      ParseBinaryProtoFromFile<CachedSgxPcsResponse>(CachePath(key));
+  if (!response.ok()) {
+    return absl::nullopt;
+  }
+  absl::MutexLock lock(&mu_);
+  responses_.emplace(key, response.ValueOrDie());
+  return std::move(response).ValueOrDie();
+}
+
+void CachingSgxPcsClient::Store(const std::string &key,
+                                const CachedSgxPcsResponse &response) {
+  {
+    absl::MutexLock lock(&mu_);
+    responses_[key] = response;
+  }
+  if (options_.cache_directory.empty()) {
+    return;
+  }
+
+  // Write to a temporary file first, so that other processes sharing the
+  // cache directory never read a partially written response.
+  std::string path = CachePath(key);
+  std::string temp_path =
+      absl::StrCat(path, ".tmp.", absl::ToUnixNanos(absl::Now()));
+  {
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    if (!file || !response.SerializeToOstream(&file)) {
+      LOG(WARNING) << "Failed to write PCS cache file " << temp_path;
+      std::remove(temp_path.c_str());
+      return;
+    }
+  }
+  if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+    LOG(WARNING) << "Failed to write PCS cache file " << path;
+    std::remove(temp_path.c_str());
+  }
+}
+
+std::string CachingSgxPcsClient::CachePath(const std::string &key) const {
+  Sha256Hash hash;
+  hash.Update(key);
+  std::vector<uint8_t> digest;
+  hash.CumulativeHash(&digest);
+  return absl::StrCat(
+      options_.cache_directory, "/",
+      absl::BytesToHexString(absl::string_view(
+          reinterpret_cast<const char *>(digest.data()), digest.size())));
+}
+
+void CachingSgxPcsClient::SetExpiry(absl::Duration lifetime,
+                                    CachedSgxPcsResponse *response) const {
+  // Conversion of a finite time in range cannot fail.
+  *response->mutable_expiry() =
+      ConvertTime<google::protobuf::Timestamp>(options_.clock() + lifetime)
+          .ValueOrDie();
+}
+
+void CachingSgxPcsClient::SetExpiry(const StatusOr<absl::Time> &next_update,
+                                    CachedSgxPcsResponse *response) const {
+  if (!next_update.ok() || next_update.ValueOrDie() <= options_.clock()) {
+    if (!next_update.ok()) {
+      LOG(WARNING) << "Cannot determine next update of PCS response: "
+                   << next_update.status();
+    }
+    SetExpiry(options_.default_lifetime, response);
+    return;
+  }
+  SetExpiry(next_update.ValueOrDie() - options_.clock(), response);
+}
+
+void CachingSgxPcsClient::ScheduleRefresh(const std::string &key,
+                                          const Fetcher &fetch) {
+  absl::MutexLock lock(&mu_);
+  if (stopping_ || !refreshing_.insert(key).second) {
+    return;
+  }
+  refresh_queue_.emplace_back(key, fetch);
+}
+
+void CachingSgxPcsClient::RefreshLoop() {
+  auto has_work = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return stopping_ || !refresh_queue_.empty();
+  };
+  while (true) {
+    std::pair<std::string, Fetcher> refresh;
+    {
+      absl::MutexLock lock(&mu_);
+      mu_.Await(absl::Condition(&has_work));
+      if (stopping_) {
+        return;
+      }
+      refresh = std::move(refresh_queue_.front());
+      refresh_queue_.pop_front();
+    }
+
+    // On failure, the cached response is still served until it expires.
+    StatusOr<CachedSgxPcsResponse> result =
+        Fetch(refresh.first, refresh.second);
+    if (!result.ok()) {
+      LOG(WARNING) << "Failed to refresh cached PCS response: "
+                   << result.status();
+    }
+
+    absl::MutexLock lock(&mu_);
+    refreshing_.erase(refresh.first);
+  }
+}
+
+}  // namespace sgx
+}  // namespace asylo
@@ -0,0 +1,178 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#ifndef ASYLO_IDENTITY_PROVISIONING_SGX_INTERNAL_CACHING_SGX_PCS_CLIENT_H_
+#define ASYLO_IDENTITY_PROVISIONING_SGX_INTERNAL_CACHING_SGX_PCS_CLIENT_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "asylo/identity/platform/sgx/machine_configuration.pb.h"
+#include "asylo/identity/provisioning/sgx/internal/caching_sgx_pcs_client.pb.h"
+#include "asylo/identity/provisioning/sgx/internal/platform_provisioning.pb.h"
+#include "asylo/identity/provisioning/sgx/internal/sgx_pcs_client.h"
+#include "asylo/identity/provisioning/sgx/internal/sgx_pcs_client.pb.h"
+#include "asylo/util/statusor.h"
+#include "asylo/util/thread.h"
+
+namespace asylo {
+namespace sgx {
+
+struct CachingSgxPcsClientOptions {
+  // Directory holding the on-disk tier of the cache, which survives restarts
+  // and can be shared by processes on the same host. If empty, responses are
+  // only cached in memory.
+  std::string cache_directory;
+
+  // Time for which PCK certificates are cached. PCK certificates carry no
+  // update time of their own.
+  absl::Duration pck_certificate_lifetime = absl::Hours(24);
+
+  // Time for which CRLs and TCB infos are cached if their next update time is
+  // unavailable or has already passed.
+  absl::Duration default_lifetime = absl::Hours(1);
+
+  // Cached responses that expire within this duration are refreshed in the
+  // background when they are served.
+  absl::Duration refresh_margin = absl::Minutes(30);
+
+  // Source of the current time.
+  std::function<absl::Time()> clock = [] { return absl::Now(); };
+};
+
+// An SgxPcsClient that caches the responses of another SgxPcsClient, so that
+// hosts provisioned in bulk do not query Intel PCS for the same data over and
+// over again.
+//
+// Responses are cached in memory and, optionally, on disk. CRLs and TCB infos
+// are cached until their "nextUpdate" time, and PCK certificates for a fixed
+// lifetime. Responses close to expiry are refreshed on a background thread,
+// while the cached response is still served. Concurrent identical requests
+// that miss the cache share a single request to the wrapped client. Errors are
+// not cached.
+//
+// This class is thread-safe.
+class CachingSgxPcsClient : public SgxPcsClient {
+ public:
+  // Creates a CachingSgxPcsClient that caches the responses of |client|.
+  static std::unique_ptr<CachingSgxPcsClient> Create(
+      std::unique_ptr<SgxPcsClient> client,
+      CachingSgxPcsClientOptions options = CachingSgxPcsClientOptions());
+
+  // Waits for the refresh in progress, if any, to finish. Pending refreshes
+  // are dropped.
+  ~CachingSgxPcsClient() override;
+
+  CachingSgxPcsClient(const CachingSgxPcsClient &other) = delete;
+  CachingSgxPcsClient &operator=(const CachingSgxPcsClient &other) = delete;
+
+  // From SgxPcsClient.
+
+  StatusOr<GetPckCertificateResult> GetPckCertificate(
+      const Ppid &ppid, const CpuSvn &cpu_svn, const PceSvn &pce_svn,
+      const PceId &pce_id) override;
+
+  StatusOr<GetPckCertificatesResult> GetPckCertificates(
+      const Ppid &ppid, const PceId &pce_id) override;
+
+  StatusOr<GetCrlResult> GetCrl(SgxCaType sgx_ca_type) override;
+
+  StatusOr<GetTcbInfoResult> GetTcbInfo(const Fmspc &fmspc) override;
+
+ private:
+  // Fetches a response from the wrapped client.
+  using Fetcher = std::function<StatusOr<CachedSgxPcsResponse>()>;
+
+  // A request to the wrapped client that concurrent callers wait on.
+  struct Flight;
+
+  CachingSgxPcsClient(std::unique_ptr<SgxPcsClient> client,
+                      CachingSgxPcsClientOptions options);
+
+  // Returns the response cached under |key|, fetching it with |fetch| if it is
+  // not cached or has expired.
+  StatusOr<CachedSgxPcsResponse> Get(const std::string &key,
+                                     const Fetcher &fetch);
+
+  // Fetches the response for |key| with |fetch| and caches it. Callers that
+  // fetch the same |key| concurrently share one call of |fetch|.
+  StatusOr<CachedSgxPcsResponse> Fetch(const std::string &key,
+                                       const Fetcher &fetch);
+
+  // Returns the response cached under |key| in memory or on disk, if any.
+  absl::optional<CachedSgxPcsResponse> Lookup(const std::string &key);
+
+  // Caches |response| under |key| in memory and on disk.
+  void Store(const std::string &key, const CachedSgxPcsResponse &response);
+
+  // Returns the path of the file caching the response for |key|.
+  std::string CachePath(const std::string &key) const;
+
+  // Sets the expiry of |response| to |lifetime| from now.
+  void SetExpiry(absl::Duration lifetime,
+                 CachedSgxPcsResponse *response) const;
+
+  // Sets the expiry of |response| to |next_update| if that is still to come,
+  // and to the default lifetime from now otherwise.
+  void SetExpiry(const StatusOr<absl::Time> &next_update,
+                 CachedSgxPcsResponse *response) const;
+
+  // Queues a background refresh of |key| with |fetch|, unless one is already
+  // queued or in progress.
+  void ScheduleRefresh(const std::string &key, const Fetcher &fetch);
+
+  // Body of the background refresh thread.
+  void RefreshLoop();
+
+  const std::unique_ptr<SgxPcsClient> client_;
+  const CachingSgxPcsClientOptions options_;
+
+  absl::Mutex mu_;
+
+  // Responses cached in memory, keyed on their request.
+  absl::flat_hash_map<std::string, CachedSgxPcsResponse> responses_
+      ABSL_GUARDED_BY(mu_);
+
+  // Requests to the wrapped client in progress.
+  absl::flat_hash_map<std::string, std::shared_ptr<Flight>> flights_
+      ABSL_GUARDED_BY(mu_);
+
+  // Keys with a refresh queued or in progress, and the queued refreshes.
+  absl::flat_hash_set<std::string> refreshing_ ABSL_GUARDED_BY(mu_);
+  std::deque<std::pair<std::string, Fetcher>> refresh_queue_
+      ABSL_GUARDED_BY(mu_);
+  bool stopping_ ABSL_GUARDED_BY(mu_) = false;
+
+  Thread refresh_thread_;
+};
+
+}  // namespace sgx
+}  // namespace asylo
+
+#endif  // ASYLO_IDENTITY_PROVISIONING_SGX_INTERNAL_CACHING_SGX_PCS_CLIENT_H_
@@ -0,0 +1,202 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include "asylo/identity/provisioning/sgx/internal/caching_sgx_pcs_client.h"
+
+#include <stdlib.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/flags/flag.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "asylo/identity/provisioning/sgx/internal/mock_sgx_pcs_client.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/test/util/test_flags.h"
+#include "asylo/util/status.h"
+#include "asylo/util/thread.h"
+
+namespace asylo {
+namespace sgx {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Invoke;
+using ::testing::Return;
+
+// Returns a CRL response whose contents are |data|. The CRL cannot be parsed,
+// so it is cached for the default lifetime.
+GetCrlResult CrlResult(const std::string &data) {
+  GetCrlResult result;
+  result.pck_crl.set_format(CertificateRevocationList::X509_DER);
+  result.pck_crl.set_data(data);
+  return result;
+}
+
+class CachingSgxPcsClientTest : public ::testing::Test {
+ protected:
+  CachingSgxPcsClientTest() : now_(absl::FromUnixSeconds(1600000000)) {
+    options_.default_lifetime = absl::Hours(1);
+    options_.refresh_margin = absl::Minutes(10);
+    options_.clock = [this] {
+      absl::MutexLock lock(&mu_);
+      return now_;
+    };
+  }
+
+  // Creates a CachingSgxPcsClient wrapping a new mock client, which is stored
+  // in |mock_client_|.
+  std::unique_ptr<CachingSgxPcsClient> CreateClient() {
+    auto mock_client = absl::make_unique<MockSgxPcsClient>();
+    mock_client_ = mock_client.get();
+    return CachingSgxPcsClient::Create(std::move(mock_client), options_);
+  }
+
+  void AdvanceClock(absl::Duration duration) {
+    absl::MutexLock lock(&mu_);
+    now_ += duration;
+  }
+
+  CachingSgxPcsClientOptions options_;
+  MockSgxPcsClient *mock_client_ = nullptr;
+
+ private:
+  absl::Mutex mu_;
+  absl::Time now_ ABSL_GUARDED_BY(mu_);
+};
+
+TEST_F(CachingSgxPcsClientTest, CachesResponses) {
+  auto client = CreateClient();
+  EXPECT_CALL(*mock_client_, GetCrl(PROCESSOR))
+      .WillOnce(Return(CrlResult("processor")));
+  EXPECT_CALL(*mock_client_, GetCrl(PLATFORM))
+      .WillOnce(Return(CrlResult("platform")));
+
+  for (int i = 0; i < 3; ++i) {
+    GetCrlResult result;
+    ASYLO_ASSERT_OK_AND_ASSIGN(result, client->GetCrl(PROCESSOR));
+    EXPECT_THAT(result.pck_crl.data(), Eq("processor"));
+    ASYLO_ASSERT_OK_AND_ASSIGN(result, client->GetCrl(PLATFORM));
+    EXPECT_THAT(result.pck_crl.data(), Eq("platform"));
+  }
+}
+
+TEST_F(CachingSgxPcsClientTest, DoesNotCacheErrors) {
+  auto client = CreateClient();
+  EXPECT_CALL(*mock_client_, GetCrl(PROCESSOR))
+      .WillOnce(Return(Status(error::GoogleError::UNAVAILABLE, "down")))
+      .WillOnce(Return(CrlResult("processor")));
+
+  EXPECT_THAT(client->GetCrl(PROCESSOR),
+              StatusIs(error::GoogleError::UNAVAILABLE));
+  ASYLO_EXPECT_OK(client->GetCrl(PROCESSOR));
+}
+
+TEST_F(CachingSgxPcsClientTest, RefetchesExpiredResponses) {
+  auto client = CreateClient();
+  EXPECT_CALL(*mock_client_, GetCrl(PROCESSOR))
+      .WillOnce(Return(CrlResult("old")))
+      .WillOnce(Return(CrlResult("new")));
+
+  GetCrlResult result;
+  ASYLO_ASSERT_OK_AND_ASSIGN(result, client->GetCrl(PROCESSOR));
+  EXPECT_THAT(result.pck_crl.data(), Eq("old"));
+
+  AdvanceClock(options_.default_lifetime);
+  ASYLO_ASSERT_OK_AND_ASSIGN(result, client->GetCrl(PROCESSOR));
+  EXPECT_THAT(result.pck_crl.data(), Eq("new"));
+}
+
+TEST_F(CachingSgxPcsClientTest, RefreshesResponsesCloseToExpiry) {
+  auto client = CreateClient();
+  absl::Notification refreshed;
+  EXPECT_CALL(*mock_client_, GetCrl(PROCESSOR))
+      .WillOnce(Return(CrlResult("old")))
+      .WillOnce(Invoke([&refreshed](SgxCaType) -> StatusOr<GetCrlResult> {
+        refreshed.Notify();
+        return CrlResult("new");
+      }));
+  ASYLO_ASSERT_OK(client->GetCrl(PROCESSOR));
+
+  // The cached response is served while it is refreshed.
+  AdvanceClock(options_.default_lifetime - options_.refresh_margin / 2);
+  GetCrlResult result;
+  ASYLO_ASSERT_OK_AND_ASSIGN(result, client->GetCrl(PROCESSOR));
+  EXPECT_THAT(result.pck_crl.data(), Eq("old"));
+  refreshed.WaitForNotification();
+}
+
+TEST_F(CachingSgxPcsClientTest, SharesConcurrentFetches) {
+  constexpr int kNumThreads = 8;
+
+  auto client = CreateClient();
+  absl::Notification release;
+  EXPECT_CALL(*mock_client_, GetCrl(PROCESSOR))
+      .WillOnce(Invoke([&release](SgxCaType) -> StatusOr<GetCrlResult> {
+        release.WaitForNotification();
+        return CrlResult("processor");
+      }));
+
+  std::vector<Thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&client] {
+      StatusOr<GetCrlResult> result = client->GetCrl(PROCESSOR);
+      ASYLO_ASSERT_OK(result);
+      EXPECT_THAT(result.ValueOrDie().pck_crl.data(), Eq("processor"));
+    });
+  }
+  release.Notify();
+  for (auto &thread : threads) {
+    thread.Join();
+  }
+}
+
+TEST_F(CachingSgxPcsClientTest, PersistsResponsesOnDisk) {
+  std::string cache_directory = absl::StrCat(
+      absl::GetFlag(FLAGS_test_tmpdir), "/caching_sgx_pcs_client_XXXXXX");
+  ASSERT_NE(mkdtemp(&cache_directory[0]), nullptr);
+  options_.cache_directory = cache_directory;
+  Fmspc fmspc;
+  fmspc.set_value("abcdef");
+  GetTcbInfoResult tcb_info;
+  tcb_info.tcb_info.set_tcb_info_json("{}");
+  tcb_info.tcb_info.set_signature("signature");
+
+  auto client = CreateClient();
+  EXPECT_CALL(*mock_client_, GetTcbInfo).WillOnce(Return(tcb_info));
+  ASYLO_ASSERT_OK(client->GetTcbInfo(fmspc));
+
+  // A new client finds the response in the cache directory.
+  client = CreateClient();
+  EXPECT_CALL(*mock_client_, GetTcbInfo).Times(0);
+  GetTcbInfoResult result;
+  ASYLO_ASSERT_OK_AND_ASSIGN(result, client->GetTcbInfo(fmspc));
+  EXPECT_THAT(result.tcb_info.signature(), Eq("signature"));
+}
+
+}  // namespace
+}  // namespace sgx
+}  // namespace asylo
@@ -19,11 +19,12 @@
 #include "asylo/identity/provisioning/sgx/internal/pck_certificate_util.h"
 
 #include <endian.h>
+#include <openssl/obj.h>
 
 #include <array>
 #include <cstddef>
 #include <cstdint>
-#include <functional>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <tuple>
@@ -35,7 +36,9 @@
 #include "absl/base/call_once.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/functional/function_ref.h"
 #include "absl/hash/hash.h"
+#include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
@@ -45,6 +48,7 @@
 #include "asylo/crypto/certificate.pb.h"
 #include "asylo/crypto/certificate_interface.h"
 #include "asylo/crypto/certificate_util.h"
+#include "asylo/crypto/der_reader.h"
 #include "asylo/crypto/util/byte_container_view.h"
 #include "asylo/crypto/x509_certificate.h"
 #include "asylo/util/logging.h"
@@ -68,18 +72,6 @@ enum class SgxTypeRaw : uint8_t {
   kStandard = 0,
 };
 
-// Whether an extension is required or optional.
-enum class Optionality { REQUIRED, OPTIONAL };
-
-// Information needed to read a particular extension.
-struct ReadInfo {
-  // The function used to read the ASN.1 value.
-  std::function<Status(const Asn1Value &)> read_function;
-
-  // Whether the extension is required or optional.
-  Optionality optionality;
-};
-
 // Returns an OBJECT IDENTIFIER for |oid_string|. Crashes the program on
 // failure.
 ObjectId CreateOidOrDie(const std::string &oid_string);
@@ -147,19 +139,30 @@ const SgxOidsStruct &GetSgxOids() {
   return *oids;
 }
 
-// If |asn1| is an OCTET STRING with size |expected_size|, returns its octets.
-// Otherwise, returns an error.
-StatusOr<std::vector<uint8_t>> ReadOctetStringWithSize(const Asn1Value &asn1,
-                                                       size_t expected_size) {
-  std::vector<uint8_t> bytes;
-  ASYLO_ASSIGN_OR_RETURN(bytes, asn1.GetOctetString());
-  if (bytes.size() != expected_size) {
+// Returns a view of the encoded contents of |oid|.
+ByteContainerView EncodedOid(const ObjectId &oid) {
+  const ASN1_OBJECT &object = oid.GetBsslObject();
+  return ByteContainerView(OBJ_get0_data(&object), OBJ_length(&object));
+}
+
+// Returns the OID string of |oid| for use in error messages.
+std::string OidStringForError(const ObjectId &oid) {
+  auto oid_string_result = oid.GetOidString();
+  return oid_string_result.ok() ? oid_string_result.ValueOrDie()
+                                : "<could not print OID>";
+}
+
+// Reads an OCTET STRING with size |expected_size| from |reader| into |bytes|.
+Status ReadOctetStringWithSize(DerReader *reader, size_t expected_size,
+                               ByteContainerView *bytes) {
+  ASYLO_RETURN_IF_ERROR(reader->ReadElement(kDerOctetString, bytes));
+  if (bytes->size() != expected_size) {
     return Status(
         error::GoogleError::INVALID_ARGUMENT,
         absl::StrFormat("Expected a container of size %d, found size %d",
-                        expected_size, bytes.size()));
+                        expected_size, bytes->size()));
   }
-  return bytes;
+  return Status::OkStatus();
 }
 
 // Returns a schema for a sequence of (OID, ANY) pairs with a minimum length of
@@ -173,42 +176,60 @@ const Asn1Schema<std::vector<std::tuple<ObjectId, Asn1Value>>>
   return *kSchema;
 }
 
-// For each (OID, ASN.1 value) pair in |sequence|, ReadOidAnySequence() calls
-// the function in |read_infos| corresponding to the OID on the ASN.1 value.
-// ReadOidAnySequence() fails if:
+// Reads the contents of a DER-encoded sequence of (OID, value) pairs from
+// |sequence|, and calls |read_value| with the index of each OID in |oids| and a
+// reader positioned at the corresponding value, which |read_value| must read
+// entirely. All the OIDs in |oids| are required. ReadOidValueSequence() fails
+// if:
 //
 //   * Any OID appears more than once in |sequence|.
-//   * Any OID in |sequence| is not a key in |read_infos|.
-//   * Any of the calls to the functions in |read_infos| returns a non-OK
-//     status.
-//   * An OID in |read_infos| is marked as REQUIRED but is not found in
-//     |sequence|.
-Status ReadOidAnySequence(
-    absl::flat_hash_map<ObjectId, ReadInfo> read_infos,
-    const std::vector<std::tuple<ObjectId, Asn1Value>> &sequence) {
-  absl::flat_hash_set<ObjectId> found_oids;
+//   * Any OID in |sequence| is not in |oids|.
+//   * Any of the calls to |read_value| returns a non-OK status.
+//   * An OID in |oids| is not found in |sequence|.
+//
+// The sequence is walked in place, so that reading it does not allocate
+// memory unless it is invalid.
+Status ReadOidValueSequence(
+    ByteContainerView sequence, absl::Span<const ObjectId *const> oids,
+    absl::FunctionRef<Status(size_t, DerReader *)> read_value) {
+  CHECK_LE(oids.size(), 32);
+  uint32_t found_oids = 0;
   std::vector<std::string> errors;
-  for (auto pair : sequence) {
-    ObjectId oid;
-    Asn1Value asn1;
-    std::tie(oid, asn1) = std::move(pair);
-    auto oid_string_result = oid.GetOidString();
-    std::string oid_string = oid_string_result.ok()
-                                 ? oid_string_result.ValueOrDie()
-                                 : "<could not print OID>";
-    if (!found_oids.insert(oid).second) {
-      errors.push_back(absl::StrCat("Found repeated OID: ", oid_string));
+  DerReader reader(sequence);
+  while (!reader.empty()) {
+    ByteContainerView pair(nullptr, 0);
+    ByteContainerView oid(nullptr, 0);
+    ASYLO_RETURN_IF_ERROR(reader.ReadElement(kDerSequence, &pair));
+    DerReader pair_reader(pair);
+    ASYLO_RETURN_IF_ERROR(pair_reader.ReadElement(kDerObjectId, &oid));
+
+    size_t index = 0;
+    while (index < oids.size() && EncodedOid(*oids[index]) != oid) {
+      ++index;
+    }
+    if (index == oids.size()) {
+      errors.push_back(absl::StrCat(
+          "Unexpected OID with encoding ",
+          absl::BytesToHexString(absl::string_view(
+              reinterpret_cast<const char *>(oid.data()), oid.size()))));
       continue;
     }
-    const auto it = read_infos.find(oid);
-    if (it == read_infos.end()) {
-      auto oid_string_result = oid.GetOidString();
-      errors.push_back(absl::StrCat("Unexpected OID: ", oid_string));
+    if (found_oids & (uint32_t{1} << index)) {
+      errors.push_back(absl::StrCat("Found repeated OID: ",
+                                    OidStringForError(*oids[index])));
       continue;
     }
-    Status read_status = it->second.read_function(asn1).WithPrependedContext(
-        absl::StrFormat("Error reading value for OID %s: ", oid_string));
+    found_oids |= uint32_t{1} << index;
+
+    Status read_status = read_value(index, &pair_reader);
+    if (read_status.ok() && !pair_reader.empty()) {
+      read_status = Status(error::GoogleError::INVALID_ARGUMENT,
+                           "Found unexpected data after the value");
+    }
     if (!read_status.ok()) {
+      read_status = read_status.WithPrependedContext(
+          absl::StrFormat("Error reading value for OID %s: ",
+                          OidStringForError(*oids[index])));
       if (read_status.CanonicalCode() == error::GoogleError::INVALID_ARGUMENT) {
         errors.push_back(std::string(read_status.error_message()));
       } else {
@@ -216,17 +237,10 @@ Status ReadOidAnySequence(
       }
     }
   }
-  for (auto pair : read_infos) {
-    ObjectId oid;
-    ReadInfo read_info;
-    std::tie(oid, read_info) = std::move(pair);
-    if (read_info.optionality == Optionality::REQUIRED &&
-        !found_oids.contains(oid)) {
-      auto oid_string_result = oid.GetOidString();
-      errors.push_back(oid_string_result.ok()
-                           ? absl::StrCat("Missing extension with OID ",
-                                          oid_string_result.ValueOrDie())
-                           : "Missing extension");
+  for (size_t index = 0; index < oids.size(); ++index) {
+    if (!(found_oids & (uint32_t{1} << index))) {
+      errors.push_back(absl::StrCat("Missing extension with OID ",
+                                    OidStringForError(*oids[index])));
     }
   }
   return errors.empty()
@@ -251,47 +265,43 @@ Status ValidateSgxExtensions(const SgxExtensions &extensions) {
   return Status::OkStatus();
 }
 
-// Reads |asn1| as a TCB ASN.1 value into |tcb| and |cpu_svn|.
-Status ReadTcb(const Asn1Value &asn1, Tcb *tcb, CpuSvn *cpu_svn) {
-  absl::flat_hash_map<ObjectId, ReadInfo> read_functions(
-      {{GetSgxOids().pce_svn,
-        {[tcb](const Asn1Value &asn1) {
-           uint16_t pce_svn;
-           ASYLO_ASSIGN_OR_RETURN(pce_svn, asn1.GetIntegerAsInt<uint16_t>());
-           tcb->mutable_pce_svn()->set_value(pce_svn);
-           return Status::OkStatus();
-         },
-         Optionality::REQUIRED}},
-       {GetSgxOids().cpu_svn,
-        {[cpu_svn](const Asn1Value &asn1) {
-           std::vector<uint8_t> cpu_svn_bytes;
-           ASYLO_ASSIGN_OR_RETURN(cpu_svn_bytes,
-                                  ReadOctetStringWithSize(asn1, kCpusvnSize));
-           cpu_svn->set_value(cpu_svn_bytes.data(), cpu_svn_bytes.size());
-           return Status::OkStatus();
-         },
-         Optionality::REQUIRED}}});
-  ObjectId oid;
+// Reads a TCB value from |reader| into |tcb| and |cpu_svn|.
+Status ReadTcb(DerReader *reader, Tcb *tcb, CpuSvn *cpu_svn) {
+  ByteContainerView sequence(nullptr, 0);
+  ASYLO_RETURN_IF_ERROR(reader->ReadElement(kDerSequence, &sequence));
+
+  // The TCB components come first, followed by the PCE SVN and the CPU SVN.
+  constexpr size_t kPceSvnIndex = kTcbComponentsSize;
+  constexpr size_t kCpuSvnIndex = kTcbComponentsSize + 1;
+  const ObjectId *oids[kTcbComponentsSize + 2];
   for (int i = 0; i < kTcbComponentsSize; ++i) {
-    read_functions.insert({GetSgxOids().sgx_tcb_comp_svns[i],
-                           {[tcb, i](const Asn1Value &asn1) {
-                              // Read as a uint8_t and cast to disallow negative
-                              // values.
-                              uint8_t component;
-                              ASYLO_ASSIGN_OR_RETURN(
-                                  component, asn1.GetIntegerAsInt<uint8_t>());
-                              (*tcb->mutable_components())[i] =
-                                  *reinterpret_cast<char *>(&component);
-                              return Status::OkStatus();
-                            },
-                            Optionality::REQUIRED}});
+    oids[i] = &GetSgxOids().sgx_tcb_comp_svns[i];
   }
+  oids[kPceSvnIndex] = &GetSgxOids().pce_svn;
+  oids[kCpuSvnIndex] = &GetSgxOids().cpu_svn;
 
-  std::vector<std::tuple<ObjectId, Asn1Value>> sequence;
-  ASYLO_ASSIGN_OR_RETURN(sequence, OidAnySequenceSchema().Read(asn1));
   // Ensure that tcb.components has a slot for each TCB component.
   tcb->mutable_components()->resize(kTcbComponentsSize);
-  return ReadOidAnySequence(read_functions, sequence);
+  return ReadOidValueSequence(
+      sequence, oids, [tcb, cpu_svn](size_t index, DerReader *value) {
+        if (index == kPceSvnIndex) {
+          uint16_t pce_svn;
+          ASYLO_RETURN_IF_ERROR(value->ReadUnsigned(kDerInteger, &pce_svn));
+          tcb->mutable_pce_svn()->set_value(pce_svn);
+        } else if (index == kCpuSvnIndex) {
+          ByteContainerView cpu_svn_bytes(nullptr, 0);
+          ASYLO_RETURN_IF_ERROR(
+              ReadOctetStringWithSize(value, kCpusvnSize, &cpu_svn_bytes));
+          cpu_svn->set_value(cpu_svn_bytes.data(), cpu_svn_bytes.size());
+        } else {
+          // Read as a uint8_t and cast to disallow negative values.
+          uint8_t component;
+          ASYLO_RETURN_IF_ERROR(value->ReadUnsigned(kDerInteger, &component));
+          (*tcb->mutable_components())[index] =
+              *reinterpret_cast<char *>(&component);
+        }
+        return Status::OkStatus();
+      });
 }
 
 // Writes |tcb| and |cpu_svn| to a TCB ASN.1 value.
@@ -342,23 +352,40 @@ Status ValidatePckCertificateInfo(
   return Status::OkStatus();
 }
 
-StatusOr<SgxExtensions> ExtractSgxExtensions(const X509Certificate &pck_cert) {
-  auto pck_extensions_result = pck_cert.GetOtherExtensions();
-  if (!pck_extensions_result.ok()) {
-    return pck_extensions_result.status().WithPrependedContext(
-        "PCK certificate does not contain extensions");
+// Extracts the SGX extensions from the DER-encoded PCK certificate
+// |pck_cert_der|, without parsing the rest of the certificate.
+StatusOr<SgxExtensions> ExtractSgxExtensionsFromDer(
+    ByteContainerView pck_cert_der) {
+  ByteContainerView extensions_der(nullptr, 0);
+  Status status = FindX509Extension(
+      pck_cert_der, EncodedOid(GetSgxExtensionsOid()), &extensions_der);
+  if (status.CanonicalCode() == error::GoogleError::NOT_FOUND) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "PCK certificate does not contain SGX extensions");
   }
-  std::vector<X509Extension> pck_extensions =
-      std::move(pck_extensions_result).ValueOrDie();
-
-  for (const X509Extension &extension : pck_extensions) {
-    if (extension.oid == GetSgxExtensionsOid()) {
-      return ReadSgxExtensions(extension.value);
-    }
+  if (!status.ok()) {
+    return status.WithPrependedContext("PCK certificate is malformed");
   }
+  return ReadSgxExtensionsFromDer(extensions_der);
+}
 
-  return Status(error::GoogleError::INVALID_ARGUMENT,
-                "PCK certificate does not contain SGX extensions");
+StatusOr<SgxExtensions> ExtractSgxExtensions(const X509Certificate &pck_cert) {
+  Certificate pck_cert_der;
+  ASYLO_ASSIGN_OR_RETURN(pck_cert_der,
+                         pck_cert.ToCertificateProto(Certificate::X509_DER));
+  return ExtractSgxExtensionsFromDer(pck_cert_der.data());
+}
+
+// Extracts the SGX extensions from |pck_certificate|. A DER-encoded
+// certificate is read in place.
+StatusOr<SgxExtensions> ExtractSgxExtensions(
+    const Certificate &pck_certificate) {
+  if (pck_certificate.format() == Certificate::X509_DER) {
+    return ExtractSgxExtensionsFromDer(pck_certificate.data());
+  }
+  std::unique_ptr<X509Certificate> pck_cert;
+  ASYLO_ASSIGN_OR_RETURN(pck_cert, X509Certificate::Create(pck_certificate));
+  return ExtractSgxExtensions(*pck_cert);
 }
 
 }  // namespace
@@ -366,56 +393,61 @@ StatusOr<SgxExtensions> ExtractSgxExtensions(const X509Certificate &pck_cert) {
 const ObjectId &GetSgxExtensionsOid() { return GetSgxOids().sgx_extensions; }
 
 StatusOr<SgxExtensions> ReadSgxExtensions(const Asn1Value &extensions_asn1) {
-  std::vector<std::tuple<ObjectId, Asn1Value>> sequence;
-  ASYLO_ASSIGN_OR_RETURN(sequence,
-                         OidAnySequenceSchema().Read(extensions_asn1));
+  std::vector<uint8_t> extensions_der;
+  ASYLO_ASSIGN_OR_RETURN(extensions_der, extensions_asn1.SerializeToDer());
+  return ReadSgxExtensionsFromDer(extensions_der);
+}
+
+StatusOr<SgxExtensions> ReadSgxExtensionsFromDer(
+    ByteContainerView extensions_der) {
+  ByteContainerView sequence(nullptr, 0);
+  DerReader reader(extensions_der);
+  ASYLO_RETURN_IF_ERROR(reader.ReadElement(kDerSequence, &sequence));
+  if (!reader.empty()) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Found unexpected data after the SGX extensions");
+  }
+
+  enum Index { kPpid, kTcb, kPceId, kFmspc, kSgxType, kNumIndices };
+  const ObjectId *oids[kNumIndices] = {
+      &GetSgxOids().ppid, &GetSgxOids().tcb, &GetSgxOids().pce_id,
+      &GetSgxOids().fmspc, &GetSgxOids().sgx_type};
+
   SgxExtensions extensions;
-  absl::flat_hash_set<ObjectId> sequence_oids;
-  ASYLO_RETURN_IF_ERROR(ReadOidAnySequence(
-      {{GetSgxOids().ppid,
-        {[&extensions](const Asn1Value &asn1) {
-           std::vector<uint8_t> ppid_bytes;
-           ASYLO_ASSIGN_OR_RETURN(ppid_bytes,
-                                  ReadOctetStringWithSize(asn1, kPpidSize));
-           extensions.ppid.set_value(ppid_bytes.data(), ppid_bytes.size());
-           return Status::OkStatus();
-         },
-         Optionality::REQUIRED}},
-       {GetSgxOids().tcb,
-        {[&extensions](const Asn1Value &asn1) {
-           return ReadTcb(asn1, &extensions.tcb, &extensions.cpu_svn);
-         },
-         Optionality::REQUIRED}},
-       {GetSgxOids().pce_id,
-        {[&extensions](const Asn1Value &asn1) {
-           std::vector<uint8_t> pce_id_bytes;
-           ASYLO_ASSIGN_OR_RETURN(
-               pce_id_bytes, ReadOctetStringWithSize(asn1, sizeof(uint16_t)));
-           extensions.pce_id.set_value(
-               le16toh(*reinterpret_cast<uint16_t *>(pce_id_bytes.data())));
-           return Status::OkStatus();
-         },
-         Optionality::REQUIRED}},
-       {GetSgxOids().fmspc,
-        {[&extensions](const Asn1Value &asn1) {
-           std::vector<uint8_t> fmspc_bytes;
-           ASYLO_ASSIGN_OR_RETURN(fmspc_bytes,
-                                  ReadOctetStringWithSize(asn1, kFmspcSize));
-           extensions.fmspc.set_value(fmspc_bytes.data(), fmspc_bytes.size());
-           return Status::OkStatus();
-         },
-         Optionality::REQUIRED}},
-       {GetSgxOids().sgx_type,
-        {[&extensions](const Asn1Value &asn1) {
-           using UnderlyingType = std::underlying_type<SgxTypeRaw>::type;
-           UnderlyingType raw;
-           ASYLO_ASSIGN_OR_RETURN(raw,
-                                  asn1.GetEnumeratedAsInt<UnderlyingType>());
-           ASYLO_ASSIGN_OR_RETURN(extensions.sgx_type, FromRawSgxType(raw));
-           return Status::OkStatus();
-         },
-      Optionality::REQUIRED}}},
-      sequence));
+  ASYLO_RETURN_IF_ERROR(ReadOidValueSequence(
+      sequence, oids, [&extensions](size_t index, DerReader *value) {
+        ByteContainerView bytes(nullptr, 0);
+        switch (index) {
+          case kPpid:
+            ASYLO_RETURN_IF_ERROR(
+                ReadOctetStringWithSize(value, kPpidSize, &bytes));
+            extensions.ppid.set_value(bytes.data(), bytes.size());
+            break;
+          case kTcb:
+            return ReadTcb(value, &extensions.tcb, &extensions.cpu_svn);
+          case kPceId: {
+            uint16_t pce_id_little_endian;
+            ASYLO_RETURN_IF_ERROR(ReadOctetStringWithSize(
+                value, sizeof(pce_id_little_endian), &bytes));
+            memcpy(&pce_id_little_endian, bytes.data(), bytes.size());
+            extensions.pce_id.set_value(le16toh(pce_id_little_endian));
+            break;
+          }
+          case kFmspc:
+            ASYLO_RETURN_IF_ERROR(
+                ReadOctetStringWithSize(value, kFmspcSize, &bytes));
+            extensions.fmspc.set_value(bytes.data(), bytes.size());
+            break;
+          case kSgxType: {
+            using UnderlyingType = std::underlying_type<SgxTypeRaw>::type;
+            UnderlyingType raw;
+            ASYLO_RETURN_IF_ERROR(value->ReadUnsigned(kDerEnumerated, &raw));
+            ASYLO_ASSIGN_OR_RETURN(extensions.sgx_type, FromRawSgxType(raw));
+            break;
+          }
+        }
+        return Status::OkStatus();
+      }));
   return extensions;
 }
 
@@ -500,21 +532,15 @@ StatusOr<MachineConfiguration> ExtractMachineConfigurationFromPckCert(
 }
 
 StatusOr<CpuSvn> ExtractCpuSvnFromPckCert(const Certificate &pck_certificate) {
-  std::unique_ptr<X509Certificate> pck_cert;
-  ASYLO_ASSIGN_OR_RETURN(pck_cert, X509Certificate::Create(pck_certificate));
-
   SgxExtensions sgx_extensions;
-  ASYLO_ASSIGN_OR_RETURN(sgx_extensions, ExtractSgxExtensions(*pck_cert));
+  ASYLO_ASSIGN_OR_RETURN(sgx_extensions, ExtractSgxExtensions(pck_certificate));
 
   return sgx_extensions.cpu_svn;
 }
 
 StatusOr<PceSvn> ExtractPceSvnFromPckCert(const Certificate &pck_certificate) {
-  std::unique_ptr<X509Certificate> pck_cert;
-  ASYLO_ASSIGN_OR_RETURN(pck_cert, X509Certificate::Create(pck_certificate));
-
   SgxExtensions sgx_extensions;
-  ASYLO_ASSIGN_OR_RETURN(sgx_extensions, ExtractSgxExtensions(*pck_cert));
+  ASYLO_ASSIGN_OR_RETURN(sgx_extensions, ExtractSgxExtensions(pck_certificate));
 
   return sgx_extensions.tcb.pce_svn();
 }
@@ -22,6 +22,7 @@
 #include "absl/types/optional.h"
 #include "asylo/crypto/asn1.h"
 #include "asylo/crypto/certificate_interface.h"
+#include "asylo/crypto/util/byte_container_view.h"
 #include "asylo/identity/platform/sgx/machine_configuration.pb.h"
 #include "asylo/identity/provisioning/sgx/internal/pck_certificates.pb.h"
 #include "asylo/identity/provisioning/sgx/internal/platform_provisioning.pb.h"
@@ -60,6 +61,11 @@ const ObjectId &GetSgxExtensionsOid();
 // Reads the SGX-specific extension data in |extensions_asn1|.
 StatusOr<SgxExtensions> ReadSgxExtensions(const Asn1Value &extensions_asn1);
 
+// Reads the SGX-specific extension data in the DER-encoded |extensions_der|.
+// The data is parsed in place, without building intermediate ASN.1 objects.
+StatusOr<SgxExtensions> ReadSgxExtensionsFromDer(
+    ByteContainerView extensions_der);
+
 // Writes the SGX-specific extension data in |extensions| to an Asn1Value. This
 // is only intended to be used for testing.
 StatusOr<Asn1Value> WriteSgxExtensions(const SgxExtensions &extensions);
@@ -23,12 +23,14 @@
 #include <cstdint>
 #include <cstring>
 #include <functional>
+#include <string>
+#include <utility>
+#include <vector>
 
-#include "google/protobuf/struct.pb.h"
-#include <google/protobuf/util/json_util.h>
 #include "absl/memory/memory.h"
-#include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/string_view.h"
 #include "asylo/crypto/certificate.pb.h"
 #include "asylo/crypto/certificate_util.h"
 #include "asylo/identity/platform/sgx/internal/identity_key_management_structs.h"
@@ -39,7 +41,8 @@
 #include "asylo/util/error_codes.h"
 #include "asylo/util/function_deleter.h"
 #include "asylo/util/hex_util.h"
-#include "asylo/util/proto_struct_util.h"
+#include "asylo/util/json_reader.h"
+#include "asylo/util/logging.h"
 #include "asylo/util/status.h"
 #include "asylo/util/status_macros.h"
 #include "asylo/util/url_util.h"
@@ -55,98 +58,115 @@ constexpr uint32_t kPcesvnSize = 2;
 // Size of the RawTcb in bytes.
 constexpr uint32_t kRawTcbSize = kCpusvnSize + kPcesvnSize;
 
-// Parses a Certificate proto from JSON string |cert_json|.
-StatusOr<Certificate> CertificateFromJsonValue(
-    const google::protobuf::Value &cert_json) {
-  const std::string *cert_str;
-  ASYLO_ASSIGN_OR_RETURN(cert_str, JsonGetString(cert_json));
+// Parses a Certificate proto from the URL-encoded PEM string |cert_str|.
+StatusOr<Certificate> CertificateFromJsonString(const std::string &cert_str) {
   std::string cert_str_unescaped;
-  ASYLO_ASSIGN_OR_RETURN(cert_str_unescaped, UrlDecode(*cert_str));
+  ASYLO_ASSIGN_OR_RETURN(cert_str_unescaped, UrlDecode(cert_str));
   return GetCertificateFromPem(cert_str_unescaped);
 }
 
-// Parses a RawTcb proto from JSON string |raw_tcb_json|.
-StatusOr<RawTcb> RawTcbFromJsonValue(
-    const google::protobuf::Value &raw_tcb_json) {
-  const std::string *raw_tcb_hex;
-  ASYLO_ASSIGN_OR_RETURN(raw_tcb_hex, JsonGetString(raw_tcb_json));
-  if (!IsHexEncoded(*raw_tcb_hex)) {
-    return Status(error::GoogleError::INVALID_ARGUMENT,
-                  "Raw TCB JSON is not a hex-encoded string.");
-  }
-  std::string raw_tcb = absl::HexStringToBytes(*raw_tcb_hex);
-  if (raw_tcb.size() != kRawTcbSize) {
+// Parses a RawTcb proto from the hex-encoded string |raw_tcb_hex|.
+StatusOr<RawTcb> RawTcbFromJsonString(const std::string &raw_tcb_hex) {
+  if (raw_tcb_hex.size() != 2 * kRawTcbSize) {
     return Status(error::GoogleError::INVALID_ARGUMENT,
                   absl::StrCat("Raw TCB JSON does not represents a ",
                                kRawTcbSize, "-byte value."));
   }
+  uint8_t raw_tcb[kRawTcbSize];
+  if (!HexToBytesBuffer(raw_tcb_hex, raw_tcb)) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Raw TCB JSON is not a hex-encoded string.");
+  }
   RawTcb raw_tcb_proto;
-  raw_tcb_proto.mutable_cpu_svn()->set_value(raw_tcb.data(), kCpusvnSize);
-  raw_tcb_proto.mutable_pce_svn()->set_value(le16toh(
-      *reinterpret_cast<const uint16_t *>(raw_tcb.data() + kCpusvnSize)));
+  raw_tcb_proto.mutable_cpu_svn()->set_value(
+      reinterpret_cast<const char *>(raw_tcb), kCpusvnSize);
+  uint16_t pce_svn;
+  memcpy(&pce_svn, raw_tcb + kCpusvnSize, sizeof(pce_svn));
+  raw_tcb_proto.mutable_pce_svn()->set_value(le16toh(pce_svn));
   return raw_tcb_proto;
 }
 
-// Parses PckCertificateInfo proto from |pck_cert_json|.
-StatusOr<PckCertificates::PckCertificateInfo> PckCertificateInfoFromJsonValue(
-    const google::protobuf::Value &pck_cert_json) {
-  const google::protobuf::Struct *pck_cert_object;
-  ASYLO_ASSIGN_OR_RETURN(pck_cert_object, JsonGetObject(pck_cert_json));
+// Reads a PckCertificateInfo proto from the JSON object at the current
+// position of |reader|.
+StatusOr<PckCertificates::PckCertificateInfo> ReadPckCertificateInfo(
+    JsonReader *reader) {
   PckCertificates::PckCertificateInfo pck_cert_proto;
+  bool has_tcb = false;
+  bool has_tcbm = false;
+  bool has_cert = false;
+  std::vector<std::string> unrecognized_fields;
+
+  ASYLO_RETURN_IF_ERROR(reader->BeginObject());
+  std::string field_name;
+  bool has_field;
+  while (true) {
+    ASYLO_ASSIGN_OR_RETURN(has_field, reader->NextField(&field_name));
+    if (!has_field) {
+      break;
+    }
+    if (field_name == "tcb") {
+      absl::string_view tcb_json;
+      ASYLO_ASSIGN_OR_RETURN(tcb_json, reader->ReadRawValue());
+      ASYLO_ASSIGN_OR_RETURN(*pck_cert_proto.mutable_tcb_level(),
+                             TcbFromJson(std::string(tcb_json)));
+      has_tcb = true;
+    } else if (field_name == "tcbm") {
+      std::string tcbm_hex;
+      ASYLO_ASSIGN_OR_RETURN(tcbm_hex, reader->ReadString());
+      ASYLO_ASSIGN_OR_RETURN(*pck_cert_proto.mutable_tcbm(),
+                             RawTcbFromJsonString(tcbm_hex));
+      has_tcbm = true;
+    } else if (field_name == "cert") {
+      std::string cert_str;
+      ASYLO_ASSIGN_OR_RETURN(cert_str, reader->ReadString());
+      ASYLO_ASSIGN_OR_RETURN(*pck_cert_proto.mutable_cert(),
+                             CertificateFromJsonString(cert_str));
+      has_cert = true;
+    } else {
+      ASYLO_RETURN_IF_ERROR(reader->SkipValue());
+      unrecognized_fields.push_back(field_name);
+    }
+  }
 
-  const google::protobuf::Value *tcb_json;
-  ASYLO_ASSIGN_OR_RETURN(tcb_json, JsonObjectGetField(*pck_cert_object, "tcb"));
-  std::string tcb_json_str;
-  ASYLO_RETURN_IF_ERROR(
-      Status(google::protobuf::util::MessageToJsonString(*tcb_json, &tcb_json_str)));
-  ASYLO_ASSIGN_OR_RETURN(*pck_cert_proto.mutable_tcb_level(),
-                         TcbFromJson(tcb_json_str));
-
-  const google::protobuf::Value *tcbm_json;
-  ASYLO_ASSIGN_OR_RETURN(tcbm_json,
-                         JsonObjectGetField(*pck_cert_object, "tcbm"));
-  ASYLO_ASSIGN_OR_RETURN(*pck_cert_proto.mutable_tcbm(),
-                         RawTcbFromJsonValue(*tcbm_json));
-
-  const google::protobuf::Value *cert_json;
-  ASYLO_ASSIGN_OR_RETURN(cert_json,
-                         JsonObjectGetField(*pck_cert_object, "cert"));
-  ASYLO_ASSIGN_OR_RETURN(*pck_cert_proto.mutable_cert(),
-                         CertificateFromJsonValue(*cert_json));
-
-  // We only expect three fields in |pck_cert_json|: "tcb", "tcbm", and "cert".
-  // Log warning if there exist additional fields.
-  if (pck_cert_object->fields().size() > 3) {
-    std::string json_string;
-    if (!google::protobuf::util::MessageToJsonString(pck_cert_json, &json_string).ok()) {
-      json_string = "PCK Certificate JSON";
+  for (const auto &field : {std::make_pair(has_tcb, "tcb"),
+                            std::make_pair(has_tcbm, "tcbm"),
+                            std::make_pair(has_cert, "cert")}) {
+    if (!field.first) {
+      return Status(
+          error::GoogleError::INVALID_ARGUMENT,
+          absl::StrCat("JSON object does not have a ", field.second, " field"));
     }
-    LOG(WARNING) << absl::StrCat("Encountered unrecognized fields in ",
-                                 json_string);
   }
-  return pck_cert_proto;
-}
 
-// Parses PckCertificates proto from |pck_certs_json|.
-StatusOr<PckCertificates> PckCertificatesFromJsonValue(
-    const google::protobuf::Value &pck_certs_json) {
-  const google::protobuf::ListValue *pck_certs_array;
-  ASYLO_ASSIGN_OR_RETURN(pck_certs_array, JsonGetArray(pck_certs_json));
-  PckCertificates pck_certs;
-  for (const auto &pck_cert_json : pck_certs_array->values()) {
-    ASYLO_ASSIGN_OR_RETURN(*pck_certs.add_certs(),
-                           PckCertificateInfoFromJsonValue(pck_cert_json));
+  // We only expect three fields in each PCK certificate JSON object: "tcb",
+  // "tcbm", and "cert". Log warning if there exist additional fields.
+  if (!unrecognized_fields.empty()) {
+    LOG(WARNING) << absl::StrCat(
+        "Encountered unrecognized fields in PCK Certificate JSON: ",
+        absl::StrJoin(unrecognized_fields, ", "));
   }
-  return pck_certs;
+  return pck_cert_proto;
 }
 
 }  // namespace
 
 StatusOr<PckCertificates> PckCertificatesFromJson(const std::string &json_str) {
-  google::protobuf::Value pck_certs_json;
-  ASYLO_RETURN_IF_ERROR(
-      Status(google::protobuf::util::JsonStringToMessage(json_str, &pck_certs_json)));
-  return PckCertificatesFromJsonValue(pck_certs_json);
+  // The PCK certificates are read one at a time, so that no tree of the whole
+  // JSON array, which may be several megabytes long, is ever built.
+  JsonReader reader(json_str);
+  PckCertificates pck_certs;
+  ASYLO_RETURN_IF_ERROR(reader.BeginArray());
+  bool has_element;
+  while (true) {
+    ASYLO_ASSIGN_OR_RETURN(has_element, reader.NextElement());
+    if (!has_element) {
+      break;
+    }
+    ASYLO_ASSIGN_OR_RETURN(*pck_certs.add_certs(),
+                           ReadPckCertificateInfo(&reader));
+  }
+  ASYLO_RETURN_IF_ERROR(reader.ExpectEnd());
+  return pck_certs;
 }
 
 }  // namespace sgx
@@ -24,7 +24,7 @@
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
-#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "asylo/crypto/algorithms.pb.h"
 #include "asylo/crypto/certificate_util.h"
@@ -243,8 +243,7 @@ StatusOr<std::string> EncryptPpid(const AsymmetricEncryptionKey *enc_key,
   }
   std::vector<uint8_t> ppid_encrypted;
   ASYLO_RETURN_IF_ERROR(enc_key->Encrypt(ppid.value(), &ppid_encrypted));
-  return absl::BytesToHexString(absl::string_view(
-      reinterpret_cast<char *>(ppid_encrypted.data()), ppid_encrypted.size()));
+  return BytesToHex(ppid_encrypted);
 }
 
 }  // namespace
@@ -296,7 +295,7 @@ StatusOr<GetPckCertificateResult> SgxPcsClientImpl::GetPckCertificate(
   std::string pce_id_hex = Uint16ToLittleEndianHexString(pce_id.value());
   const FieldValueList arguments = {
       {"encrypted_ppid", encrypted_ppid},
-      {"cpusvn", absl::BytesToHexString(cpu_svn.value())},
+      {"cpusvn", BytesToHex(cpu_svn.value())},
       {"pcesvn", pce_svn_hex},
       {"pceid", pce_id_hex},
   };
@@ -344,7 +343,7 @@ StatusOr<GetCrlResult> SgxPcsClientImpl::GetCrl(SgxCaType sgx_ca_type) {
 StatusOr<GetTcbInfoResult> SgxPcsClientImpl::GetTcbInfo(const Fmspc &fmspc) {
   ASYLO_RETURN_IF_ERROR(ValidateFmspc(fmspc));
   const FieldValueList arguments = {
-      {"fmspc", absl::BytesToHexString(fmspc.value())},
+      {"fmspc", BytesToHex(fmspc.value())},
   };
   const std::string url_to_fetch = CreateUrl(kPcsPath,
                                              /*command=*/"tcb", arguments);
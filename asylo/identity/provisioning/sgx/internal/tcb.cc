@@ -21,6 +21,7 @@
 #include <endian.h>
 
 #include <cstdint>
+#include <cstring>
 
 #include "google/protobuf/timestamp.pb.h"
 #include <google/protobuf/util/message_differencer.h>
@@ -430,20 +431,23 @@ StatusOr<PartialOrder> CompareTcbs(TcbType tcb_type, const Tcb &lhs,
 }
 
 StatusOr<asylo::sgx::RawTcb> ParseRawTcbHex(absl::string_view raw_tcb_hex) {
-  if (!IsHexEncoded(raw_tcb_hex)) {
+  if (raw_tcb_hex.size() != 2 * kRawTcbSize) {
     return Status(error::GoogleError::INVALID_ARGUMENT,
-                  "Value is not a valid hex-encoded string");
+                  absl::StrCat("Value has invalid size: ",
+                               raw_tcb_hex.size() / 2, " bytes (expected ",
+                               kRawTcbSize, " bytes)"));
   }
-  std::string raw_tcb = absl::HexStringToBytes(raw_tcb_hex);
-  if (raw_tcb.size() != kRawTcbSize) {
+  uint8_t raw_tcb[kRawTcbSize];
+  if (!HexToBytesBuffer(raw_tcb_hex, raw_tcb)) {
     return Status(error::GoogleError::INVALID_ARGUMENT,
-                  absl::StrCat("Value has invalid size: ", raw_tcb.size(),
-                               " bytes (expected ", kRawTcbSize, " bytes)"));
+                  "Value is not a valid hex-encoded string");
   }
   RawTcb raw_tcb_proto;
-  raw_tcb_proto.mutable_cpu_svn()->set_value(raw_tcb.data(), kCpusvnSize);
-  const uint16_t pce_svn = le16toh(
-      *reinterpret_cast<const uint16_t *>(&raw_tcb.data()[kCpusvnSize]));
+  raw_tcb_proto.mutable_cpu_svn()->set_value(
+      reinterpret_cast<const char *>(raw_tcb), kCpusvnSize);
+  uint16_t pce_svn;
+  memcpy(&pce_svn, &raw_tcb[kCpusvnSize], sizeof(pce_svn));
+  pce_svn = le16toh(pce_svn);
   raw_tcb_proto.mutable_pce_svn()->set_value(pce_svn);
   return raw_tcb_proto;
 }
@@ -29,6 +29,7 @@
 
 #include "google/protobuf/struct.pb.h"
 #include "google/protobuf/timestamp.pb.h"
+#include <google/protobuf/arena.h>
 #include <google/protobuf/repeated_field.h>
 #include <google/protobuf/util/json_util.h>
 #include <google/protobuf/util/message_differencer.h>
@@ -37,7 +38,6 @@
 #include "absl/container/flat_hash_map.h"
 #include "absl/hash/hash.h"
 #include "absl/strings/ascii.h"
-#include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
@@ -312,20 +312,20 @@ StatusOr<TcbLevel> TcbLevelFromJson(
 StatusOr<Fmspc> FmspcFromJson(const google::protobuf::Value &fmspc_json) {
   const std::string *fmspc_hex_string;
   ASYLO_ASSIGN_OR_RETURN(fmspc_hex_string, JsonGetString(fmspc_json));
-  if (!IsHexEncoded(*fmspc_hex_string)) {
+  if (fmspc_hex_string->size() != 2 * kFmspcSize) {
     return Status(error::GoogleError::INVALID_ARGUMENT,
-                  "FMSPC JSON is not a hex encoding string");
+                  absl::StrCat("FMSPC JSON does not represent a ", kFmspcSize,
+                               "-byte value"));
   }
 
-  std::string fmspc_bytes = absl::HexStringToBytes(*fmspc_hex_string);
-  if (fmspc_bytes.size() != kFmspcSize) {
+  uint8_t fmspc_bytes[kFmspcSize];
+  if (!HexToBytesBuffer(*fmspc_hex_string, fmspc_bytes)) {
     return Status(error::GoogleError::INVALID_ARGUMENT,
-                  absl::StrCat("FMSPC JSON does not represent a ", kFmspcSize,
-                               "-byte value"));
+                  "FMSPC JSON is not a hex encoding string");
   }
 
   Fmspc fmspc;
-  fmspc.set_value(fmspc_bytes);
+  fmspc.set_value(reinterpret_cast<const char *>(fmspc_bytes), kFmspcSize);
   return fmspc;
 }
 
@@ -335,21 +335,21 @@ StatusOr<PceId> PceIdFromJson(const google::protobuf::Value &pce_id_json) {
 
   const std::string *pce_id_hex_string;
   ASYLO_ASSIGN_OR_RETURN(pce_id_hex_string, JsonGetString(pce_id_json));
-  if (!IsHexEncoded(*pce_id_hex_string)) {
+  if (pce_id_hex_string->size() != 2 * kPceIdNumBytes) {
     return Status(error::GoogleError::INVALID_ARGUMENT,
-                  "PCE ID JSON is not a hex encoding string");
+                  absl::StrCat("PCE ID JSON does not represent a ",
+                               kPceIdNumBytes, "-byte value"));
   }
 
-  std::string pce_id_bytes = absl::HexStringToBytes(*pce_id_hex_string);
-  if (pce_id_bytes.size() != kPceIdNumBytes) {
+  uint16_t pce_id_value;
+  if (!HexToBytesBuffer(*pce_id_hex_string,
+                        reinterpret_cast<uint8_t *>(&pce_id_value))) {
     return Status(error::GoogleError::INVALID_ARGUMENT,
-                  absl::StrCat("PCE ID JSON does not represent a ",
-                               kPceIdNumBytes, "-byte value"));
+                  "PCE ID JSON is not a hex encoding string");
   }
 
   PceId pce_id;
-  pce_id.set_value(
-      le16toh(*reinterpret_cast<const uint16_t *>(pce_id_bytes.data())));
+  pce_id.set_value(le16toh(pce_id_value));
   return pce_id;
 }
 
@@ -494,19 +494,25 @@ StatusOr<TcbInfo> TcbInfoFromJsonV1and2(
 }  // namespace
 
 StatusOr<Tcb> TcbFromJson(const std::string &json_string) {
-  google::protobuf::Value tcb_json;
-  ASYLO_RETURN_IF_ERROR(
-      Status(google::protobuf::util::JsonStringToMessage(json_string, &tcb_json)));
-  return TcbFromJsonValue(tcb_json);
+  // The JSON tree is only needed during conversion, so it is allocated on an
+  // arena and freed at once.
+  google::protobuf::Arena arena;
+  auto *tcb_json =
+      google::protobuf::Arena::CreateMessage<google::protobuf::Value>(&arena);
+  ASYLO_RETURN_IF_ERROR(Status(
+      google::protobuf::util::JsonStringToMessage(json_string, tcb_json)));
+  return TcbFromJsonValue(*tcb_json);
 }
 
 StatusOr<TcbInfo> TcbInfoFromJson(const std::string &json_string) {
-  google::protobuf::Value tcb_info_json;
-  ASYLO_RETURN_IF_ERROR(
-      Status(google::protobuf::util::JsonStringToMessage(json_string, &tcb_info_json)));
+  google::protobuf::Arena arena;
+  auto *tcb_info_json =
+      google::protobuf::Arena::CreateMessage<google::protobuf::Value>(&arena);
+  ASYLO_RETURN_IF_ERROR(Status(
+      google::protobuf::util::JsonStringToMessage(json_string, tcb_info_json)));
 
   const google::protobuf::Struct *tcb_info_object;
-  ASYLO_ASSIGN_OR_RETURN(tcb_info_object, JsonGetObject(tcb_info_json));
+  ASYLO_ASSIGN_OR_RETURN(tcb_info_object, JsonGetObject(*tcb_info_json));
 
   const google::protobuf::Value *version_json;
   ASYLO_ASSIGN_OR_RETURN(version_json,
@@ -0,0 +1,176 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include "asylo/identity/provisioning/sgx/internal/tcb_info_index.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "asylo/identity/provisioning/sgx/internal/tcb_info_from_json.h"
+#include "asylo/util/proto_enum_util.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace sgx {
+namespace {
+
+// Maximum number of indices kept by GetOrCreateFromJson(). There is one TCB
+// info per FMSPC, and a cache holding stale TCB infos is cleared when full.
+constexpr size_t kMaxCachedIndices = 64;
+
+}  // namespace
+
+StatusOr<std::unique_ptr<const TcbInfoIndex>> TcbInfoIndex::Create(
+    TcbInfo tcb_info) {
+  ASYLO_RETURN_IF_ERROR(ValidateTcbInfo(tcb_info));
+  const TcbInfoImpl &impl = tcb_info.impl();
+  TcbType tcb_type =
+      impl.has_tcb_type() ? impl.tcb_type() : TcbType::TCB_TYPE_0;
+  if (tcb_type != TcbType::TCB_TYPE_0) {
+    return Status(
+        error::GoogleError::INVALID_ARGUMENT,
+        absl::StrCat("Unknown TCB type: ", ProtoEnumValueName(tcb_type)));
+  }
+  return absl::WrapUnique<const TcbInfoIndex>(
+      new TcbInfoIndex(std::move(tcb_info)));
+}
+
+StatusOr<std::shared_ptr<const TcbInfoIndex>>
+TcbInfoIndex::GetOrCreateFromJson(const std::string &tcb_info_json) {
+  static absl::Mutex *mu = new absl::Mutex;
+  static auto *indices =
+      new absl::flat_hash_map<std::string,
+                              std::shared_ptr<const TcbInfoIndex>>;
+  {
+    absl::MutexLock lock(mu);
+    auto it = indices->find(tcb_info_json);
+    if (it != indices->end()) {
+      return it->second;
+    }
+  }
+
+  TcbInfo tcb_info;
+  ASYLO_ASSIGN_OR_RETURN(tcb_info, TcbInfoFromJson(tcb_info_json));
+  std::unique_ptr<const TcbInfoIndex> index;
+  ASYLO_ASSIGN_OR_RETURN(index, Create(std::move(tcb_info)));
+
+  absl::MutexLock lock(mu);
+  if (indices->size() >= kMaxCachedIndices) {
+    indices->clear();
+  }
+  // Another thread may have indexed the same TCB info in the meantime. Either
+  // index is equally good.
+  return indices->emplace(tcb_info_json, std::move(index)).first->second;
+}
+
+bool TcbInfoIndex::Contains(const Tcb &tcb) const {
+  if (!ValidateTcb(tcb).ok()) {
+    return false;
+  }
+  CompactTcb compact = Compact(tcb);
+  auto it = std::lower_bound(sorted_levels_.begin(), sorted_levels_.end(),
+                             compact, &LexicographicLess);
+  return it != sorted_levels_.end() && !LexicographicLess(compact, *it);
+}
+
+StatusOr<const TcbLevel *> TcbInfoIndex::FindTcbLevel(const Tcb &tcb) const {
+  ASYLO_RETURN_IF_ERROR(ValidateTcb(tcb));
+  CompactTcb compact = Compact(tcb);
+  for (size_t i = 0; i < levels_.size(); ++i) {
+    if (LessOrEqual(levels_[i], compact)) {
+      return &tcb_info_.impl().tcb_levels(i);
+    }
+  }
+  return nullptr;
+}
+
+StatusOr<PartialOrder> TcbInfoIndex::Compare(const Tcb &lhs,
+                                             const Tcb &rhs) const {
+  ASYLO_RETURN_IF_ERROR(ValidateTcb(lhs));
+  ASYLO_RETURN_IF_ERROR(ValidateTcb(rhs));
+  CompactTcb compact_lhs = Compact(lhs);
+  CompactTcb compact_rhs = Compact(rhs);
+  bool less_or_equal = LessOrEqual(compact_lhs, compact_rhs);
+  bool greater_or_equal = LessOrEqual(compact_rhs, compact_lhs);
+  if (less_or_equal && greater_or_equal) {
+    return PartialOrder::kEqual;
+  } else if (less_or_equal) {
+    return PartialOrder::kLess;
+  } else if (greater_or_equal) {
+    return PartialOrder::kGreater;
+  }
+  return PartialOrder::kIncomparable;
+}
+
+TcbInfoIndex::TcbInfoIndex(TcbInfo tcb_info) : tcb_info_(std::move(tcb_info)) {
+  levels_.reserve(tcb_info_.impl().tcb_levels_size());
+  for (const TcbLevel &level : tcb_info_.impl().tcb_levels()) {
+    levels_.push_back(Compact(level.tcb()));
+  }
+  sorted_levels_ = levels_;
+  std::sort(sorted_levels_.begin(), sorted_levels_.end(), &LexicographicLess);
+}
+
+TcbInfoIndex::CompactTcb TcbInfoIndex::Compact(const Tcb &tcb) {
+  CompactTcb compact;
+  memcpy(compact.components, tcb.components().data(), kTcbComponentsSize);
+  compact.pce_svn = tcb.pce_svn().value();
+  return compact;
+}
+
+bool TcbInfoIndex::LessOrEqual(const CompactTcb &lhs, const CompactTcb &rhs) {
+  if (lhs.pce_svn > rhs.pce_svn) {
+    return false;
+  }
+#ifdef __SSE2__
+  // Each component of |lhs| is less than or equal to the one of |rhs| exactly
+  // if the component-wise maximum of both is |rhs|.
+  __m128i lhs_components =
+      _mm_load_si128(reinterpret_cast<const __m128i *>(lhs.components));
+  __m128i rhs_components =
+      _mm_load_si128(reinterpret_cast<const __m128i *>(rhs.components));
+  __m128i max = _mm_max_epu8(lhs_components, rhs_components);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(max, rhs_components)) == 0xffff;
+#else
+  for (int i = 0; i < kTcbComponentsSize; ++i) {
+    if (lhs.components[i] > rhs.components[i]) {
+      return false;
+    }
+  }
+  return true;
+#endif
+}
+
+bool TcbInfoIndex::LexicographicLess(const CompactTcb &lhs,
+                                     const CompactTcb &rhs) {
+  int order = memcmp(lhs.components, rhs.components, kTcbComponentsSize);
+  return order != 0 ? order < 0 : lhs.pce_svn < rhs.pce_svn;
+}
+
+}  // namespace sgx
+}  // namespace asylo
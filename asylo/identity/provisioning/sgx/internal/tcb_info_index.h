@@ -0,0 +1,107 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#ifndef ASYLO_IDENTITY_PROVISIONING_SGX_INTERNAL_TCB_INFO_INDEX_H_
+#define ASYLO_IDENTITY_PROVISIONING_SGX_INTERNAL_TCB_INFO_INDEX_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "asylo/identity/provisioning/sgx/internal/tcb.h"
+#include "asylo/identity/provisioning/sgx/internal/tcb.pb.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+namespace sgx {
+
+// An immutable, preprocessed view of a TCB info for fast TCB lookups.
+//
+// The TCB levels are compacted into fixed-size arrays, so that comparing a TCB
+// against a level takes a handful of vector instructions instead of a walk
+// over protobuf fields, and exact lookups are binary searches over a sorted
+// array.
+//
+// Instances are thread-safe and are meant to be shared by all verifiers of the
+// same TCB info. See GetOrCreateFromJson().
+class TcbInfoIndex {
+ public:
+  // Creates a TcbInfoIndex for |tcb_info|. Returns an error if |tcb_info| is
+  // not valid according to ValidateTcbInfo() or has an unknown TCB type.
+  static StatusOr<std::unique_ptr<const TcbInfoIndex>> Create(
+      TcbInfo tcb_info);
+
+  // Returns a TcbInfoIndex for the TCB info encoded in |tcb_info_json|, as
+  // accepted by TcbInfoFromJson(). Indices are cached per process, so the JSON
+  // of a TCB info is only parsed the first time it is seen.
+  static StatusOr<std::shared_ptr<const TcbInfoIndex>> GetOrCreateFromJson(
+      const std::string &tcb_info_json);
+
+  TcbInfoIndex(const TcbInfoIndex &other) = delete;
+  TcbInfoIndex &operator=(const TcbInfoIndex &other) = delete;
+
+  // Returns the indexed TCB info.
+  const TcbInfo &tcb_info() const { return tcb_info_; }
+
+  // Returns whether |tcb| is one of the TCB levels of the TCB info.
+  bool Contains(const Tcb &tcb) const;
+
+  // Returns the first TCB level of the TCB info that is less than or equal to
+  // |tcb|, or nullptr if there is none. Since Intel lists TCB levels from the
+  // highest to the lowest, this is the TCB level that determines the status of
+  // a platform at |tcb|. Returns an error if |tcb| is invalid.
+  StatusOr<const TcbLevel *> FindTcbLevel(const Tcb &tcb) const;
+
+  // Returns the same result as CompareTcbs() for the TCB type of the TCB info.
+  // Returns an error if |lhs| or |rhs| is invalid.
+  StatusOr<PartialOrder> Compare(const Tcb &lhs, const Tcb &rhs) const;
+
+ private:
+  // A TCB in fixed-size form.
+  struct CompactTcb {
+    alignas(16) uint8_t components[kTcbComponentsSize];
+    uint32_t pce_svn;
+  };
+
+  explicit TcbInfoIndex(TcbInfo tcb_info);
+
+  // Converts |tcb|, which must be valid, to a CompactTcb.
+  static CompactTcb Compact(const Tcb &tcb);
+
+  // Returns whether |lhs| is less than or equal to |rhs| under TCB type 0.
+  static bool LessOrEqual(const CompactTcb &lhs, const CompactTcb &rhs);
+
+  // Returns whether |lhs| precedes |rhs| in lexicographic order. Used to sort
+  // |sorted_levels_|.
+  static bool LexicographicLess(const CompactTcb &lhs, const CompactTcb &rhs);
+
+  const TcbInfo tcb_info_;
+
+  // The TCB levels in the order of the TCB info.
+  std::vector<CompactTcb> levels_;
+
+  // The TCB levels in lexicographic order.
+  std::vector<CompactTcb> sorted_levels_;
+};
+
+}  // namespace sgx
+}  // namespace asylo
+
+#endif  // ASYLO_IDENTITY_PROVISIONING_SGX_INTERNAL_TCB_INFO_INDEX_H_
@@ -0,0 +1,206 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include "asylo/identity/provisioning/sgx/internal/tcb_info_index.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/text_format.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "asylo/identity/provisioning/sgx/internal/tcb.h"
+#include "asylo/identity/provisioning/sgx/internal/tcb.pb.h"
+#include "asylo/test/util/proto_matchers.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+namespace sgx {
+namespace {
+
+using ::testing::Eq;
+using ::testing::IsNull;
+using ::testing::Not;
+using ::testing::NotNull;
+
+// A TCB info with two TCB levels that differ in their PCE SVN.
+constexpr char kTcbInfo[] = R"proto(
+  impl {
+    version: 2
+    issue_date { seconds: 1582230020 nanos: 0 }
+    next_update { seconds: 1584735620 nanos: 0 }
+    fmspc { value: "\x01\x23\x45\x67\x89\xab" }
+    pce_id { value: 0 }
+    tcb_type: TCB_TYPE_0
+    tcb_evaluation_data_number: 2
+    tcb_levels {
+      tcb {
+        components: "\x05\x05\x05\x05\x05\x05\x05\x05\x05\x05\x05\x05\x05\x05\x05\x05"
+        pce_svn { value: 7 }
+      }
+      tcb_date { seconds: 1582230020 nanos: 0 }
+      status { known_status: UP_TO_DATE }
+    }
+    tcb_levels {
+      tcb {
+        components: "\x05\x05\x05\x05\x05\x05\x05\x05\x05\x05\x05\x05\x05\x05\x05\x05"
+        pce_svn { value: 6 }
+      }
+      tcb_date { seconds: 1582230020 nanos: 0 }
+      status { known_status: OUT_OF_DATE }
+    }
+  }
+)proto";
+
+constexpr char kTcbInfoJson[] = R"json({
+      "version": 1,
+      "issueDate": "2020-02-20T20:20:20Z",
+      "nextUpdate": "2020-03-20T20:20:20Z",
+      "fmspc": "0123456789ab",
+      "pceId": "0000",
+      "tcbLevels": [{
+        "tcb": {
+          "sgxtcbcomp01svn": 0,
+          "sgxtcbcomp02svn": 1,
+          "sgxtcbcomp03svn": 2,
+          "sgxtcbcomp04svn": 3,
+          "sgxtcbcomp05svn": 4,
+          "sgxtcbcomp06svn": 5,
+          "sgxtcbcomp07svn": 6,
+          "sgxtcbcomp08svn": 7,
+          "sgxtcbcomp09svn": 8,
+          "sgxtcbcomp10svn": 9,
+          "sgxtcbcomp11svn": 10,
+          "sgxtcbcomp12svn": 11,
+          "sgxtcbcomp13svn": 12,
+          "sgxtcbcomp14svn": 13,
+          "sgxtcbcomp15svn": 14,
+          "sgxtcbcomp16svn": 15,
+          "pcesvn": 2
+        },
+        "status": "UpToDate"
+      }]
+    })json";
+
+// Returns a Tcb with all components set to |component| except for the one at
+// |index|, which is set to |indexed_component|.
+Tcb MakeTcb(uint8_t component, int index, uint8_t indexed_component,
+            uint32_t pce_svn) {
+  Tcb tcb;
+  std::string components(kTcbComponentsSize, component);
+  components[index] = indexed_component;
+  tcb.set_components(components);
+  tcb.mutable_pce_svn()->set_value(pce_svn);
+  return tcb;
+}
+
+std::unique_ptr<const TcbInfoIndex> CreateIndex() {
+  TcbInfo tcb_info;
+  CHECK(google::protobuf::TextFormat::ParseFromString(kTcbInfo, &tcb_info));
+  return TcbInfoIndex::Create(tcb_info).ValueOrDie();
+}
+
+TEST(TcbInfoIndexTest, CreateFailsOnInvalidTcbInfo) {
+  EXPECT_THAT(TcbInfoIndex::Create(TcbInfo()),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+TEST(TcbInfoIndexTest, TcbInfoReturnsInputTcbInfo) {
+  TcbInfo tcb_info;
+  ASSERT_TRUE(google::protobuf::TextFormat::ParseFromString(kTcbInfo,
+                                                            &tcb_info));
+  std::unique_ptr<const TcbInfoIndex> index;
+  ASYLO_ASSERT_OK_AND_ASSIGN(index, TcbInfoIndex::Create(tcb_info));
+  EXPECT_THAT(index->tcb_info(), EqualsProto(tcb_info));
+}
+
+TEST(TcbInfoIndexTest, Contains) {
+  std::unique_ptr<const TcbInfoIndex> index = CreateIndex();
+  EXPECT_TRUE(index->Contains(MakeTcb(5, 0, 5, 7)));
+  EXPECT_TRUE(index->Contains(MakeTcb(5, 0, 5, 6)));
+  EXPECT_FALSE(index->Contains(MakeTcb(5, 0, 5, 8)));
+  EXPECT_FALSE(index->Contains(MakeTcb(5, 15, 6, 7)));
+  EXPECT_FALSE(index->Contains(Tcb()));
+}
+
+TEST(TcbInfoIndexTest, FindTcbLevel) {
+  std::unique_ptr<const TcbInfoIndex> index = CreateIndex();
+  const auto &tcb_levels = index->tcb_info().impl().tcb_levels();
+  const TcbLevel *tcb_level;
+
+  ASYLO_ASSERT_OK_AND_ASSIGN(tcb_level,
+                             index->FindTcbLevel(MakeTcb(9, 0, 5, 9)));
+  EXPECT_THAT(tcb_level, Eq(&tcb_levels[0]));
+  ASYLO_ASSERT_OK_AND_ASSIGN(tcb_level,
+                             index->FindTcbLevel(MakeTcb(5, 0, 5, 6)));
+  EXPECT_THAT(tcb_level, Eq(&tcb_levels[1]));
+  ASYLO_ASSERT_OK_AND_ASSIGN(tcb_level,
+                             index->FindTcbLevel(MakeTcb(9, 3, 4, 7)));
+  EXPECT_THAT(tcb_level, IsNull());
+  ASYLO_ASSERT_OK_AND_ASSIGN(tcb_level,
+                             index->FindTcbLevel(MakeTcb(5, 0, 5, 5)));
+  EXPECT_THAT(tcb_level, IsNull());
+
+  EXPECT_THAT(index->FindTcbLevel(Tcb()),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+TEST(TcbInfoIndexTest, CompareMatchesCompareTcbs) {
+  std::unique_ptr<const TcbInfoIndex> index = CreateIndex();
+  std::vector<Tcb> tcbs;
+  for (int i = 0; i < kTcbComponentsSize; i += 5) {
+    for (uint8_t indexed_component : {0, 5, 200}) {
+      for (uint32_t pce_svn : {0, 5, 10}) {
+        tcbs.push_back(MakeTcb(5, i, indexed_component, pce_svn));
+      }
+    }
+  }
+  for (const Tcb &lhs : tcbs) {
+    for (const Tcb &rhs : tcbs) {
+      PartialOrder expected;
+      ASYLO_ASSERT_OK_AND_ASSIGN(expected,
+                                 CompareTcbs(TcbType::TCB_TYPE_0, lhs, rhs));
+      EXPECT_THAT(index->Compare(lhs, rhs), IsOkAndHolds(expected));
+    }
+  }
+}
+
+TEST(TcbInfoIndexTest, GetOrCreateFromJsonSharesIndices) {
+  std::shared_ptr<const TcbInfoIndex> first;
+  ASYLO_ASSERT_OK_AND_ASSIGN(first,
+                             TcbInfoIndex::GetOrCreateFromJson(kTcbInfoJson));
+  ASSERT_THAT(first, NotNull());
+  EXPECT_THAT(first->tcb_info().impl().tcb_levels_size(), Eq(1));
+
+  std::shared_ptr<const TcbInfoIndex> second;
+  ASYLO_ASSERT_OK_AND_ASSIGN(second,
+                             TcbInfoIndex::GetOrCreateFromJson(kTcbInfoJson));
+  EXPECT_THAT(second, Eq(first));
+}
+
+TEST(TcbInfoIndexTest, GetOrCreateFromJsonFailsOnInvalidJson) {
+  EXPECT_THAT(TcbInfoIndex::GetOrCreateFromJson("{"), Not(IsOk()));
+}
+
+}  // namespace
+}  // namespace sgx
+}  // namespace asylo
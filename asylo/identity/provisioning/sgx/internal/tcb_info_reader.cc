@@ -19,6 +19,7 @@
 #include "asylo/identity/provisioning/sgx/internal/tcb_info_reader.h"
 
 #include <functional>
+#include <memory>
 #include <utility>
 
 #include "absl/container/flat_hash_set.h"
@@ -31,6 +32,7 @@
 #include "asylo/identity/provisioning/sgx/internal/platform_provisioning.pb.h"
 #include "asylo/identity/provisioning/sgx/internal/tcb.h"
 #include "asylo/identity/provisioning/sgx/internal/tcb.pb.h"
+#include "asylo/identity/provisioning/sgx/internal/tcb_info_index.h"
 #include "asylo/util/proto_enum_util.h"
 #include "asylo/util/status_macros.h"
 #include "asylo/util/statusor.h"
@@ -45,22 +47,26 @@ constexpr int kConfigIdByteIndexForTcbType0 = 6;
 }  // namespace
 
 StatusOr<TcbInfoReader> TcbInfoReader::Create(TcbInfo tcb_info) {
-  ASYLO_RETURN_IF_ERROR(ValidateTcbInfo(tcb_info));
-  absl::flat_hash_set<Tcb, absl::Hash<Tcb>, MessageEqual> tcb_levels;
-  for (const TcbLevel &tcb_level : tcb_info.impl().tcb_levels()) {
-    tcb_levels.insert(tcb_level.tcb());
-  }
-  return TcbInfoReader(std::move(tcb_info), std::move(tcb_levels));
+  std::unique_ptr<const TcbInfoIndex> index;
+  ASYLO_ASSIGN_OR_RETURN(index, TcbInfoIndex::Create(std::move(tcb_info)));
+  return TcbInfoReader(std::move(index));
+}
+
+TcbInfoReader TcbInfoReader::Create(std::shared_ptr<const TcbInfoIndex> index) {
+  return TcbInfoReader(std::move(index));
 }
 
-const TcbInfo &TcbInfoReader::GetTcbInfo() const { return tcb_info_; }
+const TcbInfo &TcbInfoReader::GetTcbInfo() const {
+  return index_ ? index_->tcb_info() : TcbInfo::default_instance();
+}
 
 StatusOr<ConfigurationId> TcbInfoReader::GetConfigurationId(
     const CpuSvn &cpu_svn) const {
   ASYLO_RETURN_IF_ERROR(ValidateCpuSvn(cpu_svn));
   ConfigurationId config_id;
-  switch (tcb_info_.impl().has_tcb_type() ? tcb_info_.impl().tcb_type()
-                                          : TcbType::TCB_TYPE_0) {
+  const TcbInfoImpl &tcb_info_impl = GetTcbInfo().impl();
+  switch (tcb_info_impl.has_tcb_type() ? tcb_info_impl.tcb_type()
+                                       : TcbType::TCB_TYPE_0) {
     case TcbType::TCB_TYPE_0:
       config_id.set_value(cpu_svn.value()[kConfigIdByteIndexForTcbType0]);
       break;
@@ -68,7 +74,7 @@ StatusOr<ConfigurationId> TcbInfoReader::GetConfigurationId(
       return Status(
           error::GoogleError::INVALID_ARGUMENT,
           absl::StrCat("Unknown TCB type: ",
-                       ProtoEnumValueName(tcb_info_.impl().tcb_type())));
+                       ProtoEnumValueName(tcb_info_impl.tcb_type())));
   }
   return config_id;
 }
@@ -79,7 +85,7 @@ StatusOr<ProvisioningConsistency> TcbInfoReader::GetConsistencyWith(
   bool tcb_info_missing_level = !std::all_of(
       pck_certificates.certs().begin(), pck_certificates.certs().end(),
       [this](const PckCertificates::PckCertificateInfo &cert_info) {
-        return tcb_levels_.contains(cert_info.tcb_level());
+        return index_ && index_->Contains(cert_info.tcb_level());
       });
 
   absl::flat_hash_set<Tcb, absl::Hash<Tcb>, MessageEqual>
@@ -88,10 +94,11 @@ StatusOr<ProvisioningConsistency> TcbInfoReader::GetConsistencyWith(
   for (const auto &cert_info : pck_certificates.certs()) {
     tcbs_from_certificates.insert(cert_info.tcb_level());
   }
+  const auto &tcb_levels = GetTcbInfo().impl().tcb_levels();
   bool certificates_missing_level =
-      !std::all_of(tcb_levels_.begin(), tcb_levels_.end(),
-                   [&tcbs_from_certificates](const Tcb &tcb) {
-                     return tcbs_from_certificates.contains(tcb);
+      !std::all_of(tcb_levels.begin(), tcb_levels.end(),
+                   [&tcbs_from_certificates](const TcbLevel &tcb_level) {
+                     return tcbs_from_certificates.contains(tcb_level.tcb());
                    });
 
   if (tcb_info_missing_level) {
@@ -109,10 +116,8 @@ StatusOr<ProvisioningConsistency> TcbInfoReader::GetConsistencyWith(
   }
 }
 
-TcbInfoReader::TcbInfoReader(
-    TcbInfo tcb_info,
-    absl::flat_hash_set<Tcb, absl::Hash<Tcb>, MessageEqual> tcb_levels)
-    : tcb_info_(std::move(tcb_info)), tcb_levels_(std::move(tcb_levels)) {}
+TcbInfoReader::TcbInfoReader(std::shared_ptr<const TcbInfoIndex> index)
+    : index_(std::move(index)) {}
 
 }  // namespace sgx
 }  // namespace asylo
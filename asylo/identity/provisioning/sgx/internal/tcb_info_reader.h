@@ -19,15 +19,14 @@
 #ifndef ASYLO_IDENTITY_PROVISIONING_SGX_INTERNAL_TCB_INFO_READER_H_
 #define ASYLO_IDENTITY_PROVISIONING_SGX_INTERNAL_TCB_INFO_READER_H_
 
+#include <memory>
 #include <string>
 
-#include "absl/container/flat_hash_set.h"
-#include "absl/hash/hash.h"
 #include "asylo/identity/platform/sgx/machine_configuration.pb.h"
-#include "asylo/identity/provisioning/sgx/internal/container_util.h"
 #include "asylo/identity/provisioning/sgx/internal/pck_certificates.pb.h"
 #include "asylo/identity/provisioning/sgx/internal/platform_provisioning.pb.h"
 #include "asylo/identity/provisioning/sgx/internal/tcb.pb.h"
+#include "asylo/identity/provisioning/sgx/internal/tcb_info_index.h"
 #include "asylo/util/statusor.h"
 
 namespace asylo {
@@ -64,6 +63,10 @@ class TcbInfoReader {
   // |tcb_info| is not valid according to ValidateTcbInfo().
   static StatusOr<TcbInfoReader> Create(TcbInfo tcb_info);
 
+  // Creates a new TcbInfoReader based on the TCB info indexed by |index|,
+  // which must not be null. Readers created from the same index share it.
+  static TcbInfoReader Create(std::shared_ptr<const TcbInfoIndex> index);
+
   // Returns the TCB info that this TcbInfoReader represents.
   const TcbInfo &GetTcbInfo() const;
 
@@ -81,15 +84,11 @@ class TcbInfoReader {
       const PckCertificates &pck_certificates) const;
 
  private:
-  TcbInfoReader(
-      TcbInfo tcb_info,
-      absl::flat_hash_set<Tcb, absl::Hash<Tcb>, MessageEqual> tcb_levels);
-
-  // The TCB info that this TcbInfoReader was created with.
-  TcbInfo tcb_info_;
+  explicit TcbInfoReader(std::shared_ptr<const TcbInfoIndex> index);
 
-  // The TCB levels from the TCB info.
-  absl::flat_hash_set<Tcb, absl::Hash<Tcb>, MessageEqual> tcb_levels_;
+  // The index of the TCB info that this TcbInfoReader was created with. Null
+  // for a default-constructed TcbInfoReader.
+  std::shared_ptr<const TcbInfoIndex> index_;
 };
 
 }  // namespace sgx
@@ -19,31 +19,86 @@
 #include "asylo/identity/sealing/sgx/sgx_local_secret_sealer.h"
 
 #include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "absl/base/attributes.h"
 #include "absl/memory/memory.h"
+#include "absl/types/span.h"
 #include "asylo/crypto/aead_cryptor.h"
 #include "asylo/crypto/algorithms.pb.h"
 #include "asylo/crypto/util/byte_container_util.h"
 #include "asylo/crypto/util/byte_container_view.h"
 #include "asylo/crypto/util/bytes.h"
+#include "asylo/crypto/util/trivial_object_util.h"
 #include "asylo/identity/identity_acl.pb.h"
 #include "asylo/identity/platform/sgx/code_identity.pb.h"
 #include "asylo/identity/platform/sgx/internal/identity_key_management_structs.h"
+#include "asylo/identity/platform/sgx/internal/secs_attributes.h"
+#include "asylo/identity/platform/sgx/internal/self_identity.h"
 #include "asylo/identity/platform/sgx/sgx_identity.pb.h"
 #include "asylo/identity/platform/sgx/sgx_identity_util.h"
 #include "asylo/identity/sealing/sgx/internal/local_secret_sealer_helpers.h"
+#include "asylo/util/compression.h"
 #include "asylo/util/status_macros.h"
 
 namespace asylo {
 
 constexpr size_t kAes256GcmSivKeySize = 32;
 
+constexpr int SgxLocalSecretSealer::kMaxCachedCryptors;
+
+namespace {
+
+// The key request parameters that determine a sealing key, in a fixed layout
+// so that they can be used as a cache key.
+struct KeyCacheTag {
+  int32_t aead_scheme;
+  uint16_t keypolicy;
+  uint16_t isvsvn;
+  UnsafeBytes<sgx::kCpusvnSize> cpusvn;
+  uint64_t attributes_flags;
+  uint64_t attributes_xfrm;
+  uint32_t miscmask;
+} ABSL_ATTRIBUTE_PACKED;
+
+// Returns the cache key for the cryptor for |aead_scheme| and
+// |sgx_expectation|.
+std::string GetKeyCacheKey(AeadScheme aead_scheme,
+                           const SgxIdentityExpectation &sgx_expectation) {
+  const SgxIdentityMatchSpec &match_spec = sgx_expectation.match_spec();
+  const sgx::CodeIdentityMatchSpec &code_identity_match_spec =
+      match_spec.code_identity_match_spec();
+  sgx::SecsAttributeSet attribute_mask(
+      code_identity_match_spec.attributes_match_mask());
+
+  KeyCacheTag tag = TrivialZeroObject<KeyCacheTag>();
+  tag.aead_scheme = aead_scheme;
+  tag.keypolicy = sgx::internal::ConvertMatchSpecToKeypolicy(match_spec);
+  tag.isvsvn = sgx_expectation.reference_identity()
+                   .code_identity()
+                   .signer_assigned_identity()
+                   .isvsvn();
+  tag.cpusvn = UnsafeBytes<sgx::kCpusvnSize>(
+      sgx_expectation.reference_identity()
+          .machine_configuration()
+          .cpu_svn()
+          .value());
+  tag.attributes_flags = attribute_mask.flags;
+  tag.attributes_xfrm = attribute_mask.xfrm;
+  tag.miscmask = code_identity_match_spec.miscselect_match_mask();
+  return std::string(reinterpret_cast<const char *>(&tag), sizeof(tag));
+}
+
+}  // namespace
+
 std::unique_ptr<SgxLocalSecretSealer>
 SgxLocalSecretSealer::CreateMrenclaveSecretSealer() {
   // This always returns OK because the DEFAULT match spec options are valid.
   auto expectation_status = CreateSgxIdentityExpectation(
-      GetSelfSgxIdentity(), SgxIdentityMatchSpecOptions::DEFAULT);
+      sgx::GetSelfIdentity()->sgx_identity,
+      SgxIdentityMatchSpecOptions::DEFAULT);
   CHECK(expectation_status.ok())
       << "Failed to create default self identity expectation";
   SgxIdentityExpectation expectation = expectation_status.ValueOrDie();
@@ -66,7 +121,8 @@ std::unique_ptr<SgxLocalSecretSealer>
 SgxLocalSecretSealer::CreateMrsignerSecretSealer() {
   // This always returns OK because the DEFAULT match spec options are valid.
   auto expectation_status = CreateSgxIdentityExpectation(
-      GetSelfSgxIdentity(), SgxIdentityMatchSpecOptions::DEFAULT);
+      sgx::GetSelfIdentity()->sgx_identity,
+      SgxIdentityMatchSpecOptions::DEFAULT);
   CHECK(expectation_status.ok())
       << "Failed to create default self identity expectation";
   SgxIdentityExpectation expectation = expectation_status.ValueOrDie();
@@ -97,8 +153,7 @@ Status SgxLocalSecretSealer::SetDefaultHeader(
   info->set_sealing_root_name(RootName());
   info->set_aead_scheme(AeadScheme::AES256_GCM_SIV);
 
-  ASYLO_ASSIGN_OR_RETURN(*header->add_author(),
-                         SerializeSgxIdentity(GetSelfSgxIdentity()));
+  *header->add_author() = sgx::GetSelfIdentity()->identity;
   ASYLO_ASSIGN_OR_RETURN(*header->mutable_client_acl()->mutable_expectation(),
                          SerializeSgxIdentityExpectation(default_client_acl_));
   return Status::OkStatus();
@@ -124,35 +179,11 @@ Status SgxLocalSecretSealer::Seal(
     const SealedSecretHeader &header,
     ByteContainerView additional_authenticated_data, ByteContainerView secret,
     SealedSecret *sealed_secret) {
-  AeadScheme aead_scheme;
-  SgxIdentityExpectation sgx_expectation;
-  ASYLO_RETURN_IF_ERROR(
-      sgx::internal::ParseKeyGenerationParamsFromSealedSecretHeader(
-          header, &aead_scheme, &sgx_expectation));
-
-  if (!header.SerializeToString(
-          sealed_secret->mutable_sealed_secret_header())) {
-    return Status(error::GoogleError::INTERNAL,
-                  "Header serialization to string failed");
-  }
-  sealed_secret->set_additional_authenticated_data(
-      reinterpret_cast<const char *>(additional_authenticated_data.data()),
-      additional_authenticated_data.size());
-
-  std::string final_additional_data;
-  SerializeByteContainers(&final_additional_data,
-                          sealed_secret->sealed_secret_header(),
-                          additional_authenticated_data);
-
-  CleansingVector<uint8_t> key;
-  ASYLO_RETURN_IF_ERROR(sgx::internal::GenerateCryptorKey(
-      aead_scheme, "default_key_id", sgx_expectation, kAes256GcmSivKeySize,
-      &key));
-
-  std::unique_ptr<AeadCryptor> cryptor;
-  ASYLO_ASSIGN_OR_RETURN(cryptor, sgx::internal::MakeCryptor(aead_scheme, key));
-  return sgx::internal::Seal(cryptor.get(), secret, final_additional_data,
-                             sealed_secret);
+  std::vector<SealedSecret> sealed_secrets;
+  ASYLO_RETURN_IF_ERROR(SealMany(header, additional_authenticated_data,
+                                 {secret}, &sealed_secrets));
+  *sealed_secret = std::move(sealed_secrets.front());
+  return Status::OkStatus();
 }
 
 Status SgxLocalSecretSealer::Unseal(const SealedSecret &sealed_secret,
@@ -174,6 +205,100 @@ Status SgxLocalSecretSealer::Unseal(const SealedSecret &sealed_secret,
                           sealed_secret.sealed_secret_header(),
                           sealed_secret.additional_authenticated_data());
 
+  std::shared_ptr<GuardedCryptor> cryptor;
+  ASYLO_ASSIGN_OR_RETURN(cryptor, GetCryptor(aead_scheme, sgx_expectation));
+  if (header.compression() == UNCOMPRESSED) {
+    return sgx::internal::Open(cryptor->Lock()->get(), sealed_secret,
+                               final_additional_data, secret);
+  }
+
+  CleansingVector<uint8_t> compressed;
+  ASYLO_RETURN_IF_ERROR(sgx::internal::Open(cryptor->Lock()->get(),
+                                            sealed_secret,
+                                            final_additional_data,
+                                            &compressed));
+  size_t max_secret_size;
+  ASYLO_ASSIGN_OR_RETURN(max_secret_size,
+                         AeadCryptor::MaxMessageSize(aead_scheme));
+  return Decompress(compressed, max_secret_size, secret);
+}
+
+Status SgxLocalSecretSealer::SealMany(
+    const SealedSecretHeader &header,
+    ByteContainerView additional_authenticated_data,
+    absl::Span<const ByteContainerView> secrets,
+    std::vector<SealedSecret> *sealed_secrets) {
+  AeadScheme aead_scheme;
+  SgxIdentityExpectation sgx_expectation;
+  ASYLO_RETURN_IF_ERROR(
+      sgx::internal::ParseKeyGenerationParamsFromSealedSecretHeader(
+          header, &aead_scheme, &sgx_expectation));
+
+  std::string serialized_header;
+  if (!header.SerializeToString(&serialized_header)) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Header serialization to string failed");
+  }
+
+  std::string final_additional_data;
+  SerializeByteContainers(&final_additional_data, serialized_header,
+                          additional_authenticated_data);
+
+  if (header.compression() != UNCOMPRESSED &&
+      header.compression() != DEFLATE) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Unsupported secret compression");
+  }
+
+  std::shared_ptr<GuardedCryptor> cryptor;
+  ASYLO_ASSIGN_OR_RETURN(cryptor, GetCryptor(aead_scheme, sgx_expectation));
+
+  std::vector<SealedSecret> results(secrets.size());
+  CleansingVector<uint8_t> compressed;
+  auto locked_cryptor = cryptor->Lock();
+  for (size_t i = 0; i < secrets.size(); ++i) {
+    results[i].set_sealed_secret_header(serialized_header);
+    results[i].set_additional_authenticated_data(
+        reinterpret_cast<const char *>(additional_authenticated_data.data()),
+        additional_authenticated_data.size());
+    ByteContainerView plaintext = secrets[i];
+    if (header.compression() == DEFLATE) {
+      ASYLO_RETURN_IF_ERROR(Compress(secrets[i], &compressed));
+      plaintext = compressed;
+    }
+    ASYLO_RETURN_IF_ERROR(sgx::internal::Seal(
+        locked_cryptor->get(), plaintext, final_additional_data,
+        &results[i]));
+  }
+  *sealed_secrets = std::move(results);
+  return Status::OkStatus();
+}
+
+Status SgxLocalSecretSealer::UnsealMany(
+    absl::Span<const SealedSecret> sealed_secrets,
+    std::vector<CleansingVector<uint8_t>> *secrets) {
+  std::vector<CleansingVector<uint8_t>> results(sealed_secrets.size());
+  for (size_t i = 0; i < sealed_secrets.size(); ++i) {
+    ASYLO_RETURN_IF_ERROR(Unseal(sealed_secrets[i], &results[i]));
+  }
+  *secrets = std::move(results);
+  return Status::OkStatus();
+}
+
+void SgxLocalSecretSealer::ClearKeyCache() { cryptor_cache_.Lock()->clear(); }
+
+StatusOr<std::shared_ptr<SgxLocalSecretSealer::GuardedCryptor>>
+SgxLocalSecretSealer::GetCryptor(
+    AeadScheme aead_scheme, const SgxIdentityExpectation &sgx_expectation) {
+  std::string cache_key = GetKeyCacheKey(aead_scheme, sgx_expectation);
+  {
+    auto cache = cryptor_cache_.ReaderLock();
+    auto it = cache->find(cache_key);
+    if (it != cache->end()) {
+      return it->second;
+    }
+  }
+
   CleansingVector<uint8_t> key;
   ASYLO_RETURN_IF_ERROR(sgx::internal::GenerateCryptorKey(
       aead_scheme, "default_key_id", sgx_expectation, kAes256GcmSivKeySize,
@@ -181,8 +306,17 @@ Status SgxLocalSecretSealer::Unseal(const SealedSecret &sealed_secret,
 
   std::unique_ptr<AeadCryptor> cryptor;
   ASYLO_ASSIGN_OR_RETURN(cryptor, sgx::internal::MakeCryptor(aead_scheme, key));
-  return sgx::internal::Open(cryptor.get(), sealed_secret,
-                             final_additional_data, secret);
+
+  auto cache = cryptor_cache_.Lock();
+  if (cache->size() >= kMaxCachedCryptors) {
+    cache->clear();
+  }
+  // If another thread cached a cryptor for the same parameters in the
+  // meantime, use that one.
+  return cache
+      ->emplace(std::move(cache_key),
+                std::make_shared<GuardedCryptor>(std::move(cryptor)))
+      .first->second;
 }
 
 }  // namespace asylo
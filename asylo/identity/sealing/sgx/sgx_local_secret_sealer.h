@@ -20,7 +20,13 @@
 #define ASYLO_IDENTITY_SEALING_SGX_SGX_LOCAL_SECRET_SEALER_H_
 
 #include <memory>
+#include <string>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/types/span.h"
+#include "asylo/crypto/aead_cryptor.h"
+#include "asylo/crypto/algorithms.pb.h"
 #include "asylo/crypto/util/byte_container_view.h"
 #include "asylo/identity/identity.pb.h"
 #include "asylo/identity/platform/sgx/code_identity.pb.h"
@@ -28,6 +34,7 @@
 #include "asylo/identity/sealing/sealed_secret.pb.h"
 #include "asylo/identity/sealing/secret_sealer.h"
 #include "asylo/util/cleansing_types.h"
+#include "asylo/util/mutex_guarded.h"
 #include "asylo/util/status.h"
 
 namespace asylo {
@@ -105,6 +112,12 @@ namespace asylo {
 /// generated default header. A sealer in either MRENCLAVE or MRSIGNER
 /// configuration can unseal secrets that are sealed by a sealer in either
 /// configuration.
+///
+/// A sealer caches the cryptors it derives, keyed by the parameters of the
+/// hardware key request. Sealing or unsealing many secrets that share a header
+/// policy therefore derives the sealing key only once. Since the ISVSVN and
+/// CPUSVN from the header are part of the key request, a header with a
+/// different SVN policy uses a different cache entry.
 class SgxLocalSecretSealer : public SecretSealer {
  public:
   /// Creates an SgxLocalSecretSealer that seals secrets to the MRENCLAVE part
@@ -139,13 +152,64 @@ class SgxLocalSecretSealer : public SecretSealer {
   Status Unseal(const SealedSecret &sealed_secret,
                 CleansingVector<uint8_t> *secret) override;
 
+  /// Seals each of `secrets` with `header` and `additional_authenticated_data`.
+  ///
+  /// This is equivalent to calling Seal() for each secret, but parses and
+  /// serializes `header` only once. On success, `sealed_secrets` holds one
+  /// sealed secret for each element of `secrets`, in the same order.
+  ///
+  /// \param header The header to use for all of the secrets.
+  /// \param additional_authenticated_data The additional authenticated data
+  ///        bound to all of the secrets.
+  /// \param secrets The secrets to seal.
+  /// \param[out] sealed_secrets The sealed secrets.
+  /// \return A non-OK Status if any of the secrets could not be sealed.
+  Status SealMany(const SealedSecretHeader &header,
+                  ByteContainerView additional_authenticated_data,
+                  absl::Span<const ByteContainerView> secrets,
+                  std::vector<SealedSecret> *sealed_secrets);
+
+  /// Unseals each of `sealed_secrets`.
+  ///
+  /// On success, `secrets` holds one secret for each element of
+  /// `sealed_secrets`, in the same order.
+  ///
+  /// \param sealed_secrets The secrets to unseal.
+  /// \param[out] secrets The unsealed secrets.
+  /// \return A non-OK Status if any of the secrets could not be unsealed.
+  Status UnsealMany(absl::Span<const SealedSecret> sealed_secrets,
+                    std::vector<CleansingVector<uint8_t>> *secrets);
+
+  /// Drops all cached cryptors. Subsequent calls derive their keys again.
+  void ClearKeyCache();
+
  private:
+  // A cryptor that is shared by the callers that use the same key request
+  // parameters. The cryptor counts the messages it seals, so it is only used
+  // while its lock is held.
+  using GuardedCryptor = MutexGuarded<std::unique_ptr<AeadCryptor>>;
+
+  // The maximum number of cryptors that are cached. The cache is cleared when
+  // it reaches this size.
+  static constexpr int kMaxCachedCryptors = 64;
+
   // Instantiates LocalSecretSealer that sets client_acl in the default sealed
   // secret header per |default_client_acl|.
   SgxLocalSecretSealer(const SgxIdentityExpectation &default_client_acl);
 
+  // Returns the cryptor for |aead_scheme| and |sgx_expectation|, deriving its
+  // key if it is not cached.
+  StatusOr<std::shared_ptr<GuardedCryptor>> GetCryptor(
+      AeadScheme aead_scheme, const SgxIdentityExpectation &sgx_expectation);
+
   // The default client ACL for this SecretSealer.
   SgxIdentityExpectation default_client_acl_;
+
+  // A map from the key request parameters to the cryptor that uses the
+  // derived key.
+  MutexGuarded<
+      absl::flat_hash_map<std::string, std::shared_ptr<GuardedCryptor>>>
+      cryptor_cache_;
 };
 
 }  // namespace asylo
@@ -23,6 +23,8 @@
 #include <sys/types.h>
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 #include <google/protobuf/text_format.h>
@@ -715,6 +717,95 @@ TEST_F(SgxLocalSecretSealerTest,
   }
 }
 
+// Verify that SealMany() and UnsealMany() round-trip a batch of secrets.
+TEST_F(SgxLocalSecretSealerTest, SealManyUnsealManySuccess) {
+  const std::vector<std::string> kSecrets = {"first", "second", "third"};
+  std::vector<ByteContainerView> secrets(kSecrets.begin(), kSecrets.end());
+  std::string input_aad(kTestAad);
+
+  std::unique_ptr<SgxLocalSecretSealer> sealer =
+      SgxLocalSecretSealer::CreateMrenclaveSecretSealer();
+  SealedSecretHeader header;
+  PrepareSealedSecretHeader(*sealer, &header);
+
+  std::vector<SealedSecret> sealed_secrets;
+  ASSERT_THAT(sealer->SealMany(header, input_aad, secrets, &sealed_secrets),
+              IsOk());
+  ASSERT_EQ(sealed_secrets.size(), kSecrets.size());
+
+  std::vector<CleansingVector<uint8_t>> output_secrets;
+  ASSERT_THAT(sealer->UnsealMany(sealed_secrets, &output_secrets), IsOk());
+  ASSERT_EQ(output_secrets.size(), kSecrets.size());
+  for (size_t i = 0; i < kSecrets.size(); ++i) {
+    EXPECT_EQ(ByteContainerView(output_secrets[i]),
+              ByteContainerView(kSecrets[i]));
+  }
+}
+
+// Verify that a secret sealed with DEFLATE compression is unsealed to the
+// original secret, and is sealed into less ciphertext than the secret.
+TEST_F(SgxLocalSecretSealerTest, SealUnsealCompressedSuccess) {
+  const std::string kSecret(4096, 'a');
+  std::string input_aad(kTestAad);
+
+  std::unique_ptr<SgxLocalSecretSealer> sealer =
+      SgxLocalSecretSealer::CreateMrenclaveSecretSealer();
+  SealedSecretHeader header;
+  PrepareSealedSecretHeader(*sealer, &header);
+  header.set_compression(DEFLATE);
+
+  SealedSecret sealed_secret;
+  ASSERT_THAT(sealer->Seal(header, input_aad, kSecret, &sealed_secret),
+              IsOk());
+  EXPECT_LT(sealed_secret.secret_ciphertext().size(), kSecret.size());
+
+  CleansingVector<uint8_t> output_secret;
+  ASSERT_THAT(sealer->Unseal(sealed_secret, &output_secret), IsOk());
+  EXPECT_EQ(ByteContainerView(output_secret), ByteContainerView(kSecret));
+}
+
+// Verify that UnsealMany() fails if any of the secrets cannot be unsealed.
+TEST_F(SgxLocalSecretSealerTest, UnsealManyFailsIfAnySecretIsCorrupted) {
+  const std::vector<std::string> kSecrets = {"first", "second"};
+  std::vector<ByteContainerView> secrets(kSecrets.begin(), kSecrets.end());
+
+  std::unique_ptr<SgxLocalSecretSealer> sealer =
+      SgxLocalSecretSealer::CreateMrsignerSecretSealer();
+  SealedSecretHeader header;
+  PrepareSealedSecretHeader(*sealer, &header);
+
+  std::vector<SealedSecret> sealed_secrets;
+  ASSERT_THAT(sealer->SealMany(header, kTestAad, secrets, &sealed_secrets),
+              IsOk());
+  sealed_secrets[1].set_additional_authenticated_data("corrupted");
+
+  std::vector<CleansingVector<uint8_t>> output_secrets;
+  EXPECT_THAT(sealer->UnsealMany(sealed_secrets, &output_secrets),
+              Not(IsOk()));
+}
+
+// Verify that a sealer still unseals its secrets after its key cache is
+// cleared.
+TEST_F(SgxLocalSecretSealerTest, UnsealSucceedsAfterClearKeyCache) {
+  CleansingVector<uint8_t> input_secret(kTestSecret,
+                                        kTestSecret + kTestSecretSize);
+  std::string input_aad(kTestAad);
+
+  std::unique_ptr<SgxLocalSecretSealer> sealer =
+      SgxLocalSecretSealer::CreateMrenclaveSecretSealer();
+  SealedSecretHeader header;
+  PrepareSealedSecretHeader(*sealer, &header);
+
+  SealedSecret sealed_secret;
+  ASSERT_THAT(sealer->Seal(header, input_aad, input_secret, &sealed_secret),
+              IsOk());
+
+  sealer->ClearKeyCache();
+  CleansingVector<uint8_t> output_secret;
+  ASSERT_THAT(sealer->Unseal(sealed_secret, &output_secret), IsOk());
+  EXPECT_EQ(input_secret, output_secret);
+}
+
 // Verifies that sealed secrets contained in local-secret-sealer-generated
 // golden data can be unsealed correctly.
 TEST_F(SgxLocalSecretSealerTest, BackwardCompatibility) {
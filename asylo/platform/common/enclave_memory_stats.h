@@ -0,0 +1,79 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#ifndef ASYLO_PLATFORM_COMMON_ENCLAVE_MEMORY_STATS_H_
+#define ASYLO_PLATFORM_COMMON_ENCLAVE_MEMORY_STATS_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/types/optional.h"
+
+namespace asylo {
+
+// Stack usage of one TCS of an enclave.
+struct EnclaveStackStats {
+  // Size of the stack in bytes.
+  uint64_t size = 0;
+
+  // Largest number of bytes of the stack used since the TCS was first entered.
+  uint64_t peak_used = 0;
+};
+
+// EPC usage and paging counters of the host, as reported by the SGX driver.
+// Each counter is absent if the driver does not expose it.
+struct EpcPagingStats {
+  // Number of EPC pages of the host, and number of those not in use.
+  absl::optional<uint64_t> total_pages;
+  absl::optional<uint64_t> free_pages;
+
+  // Number of EPC pages the driver marked as candidates for eviction to
+  // regular memory, and number of evicted pages loaded back into the EPC. Both
+  // grow with paging pressure.
+  absl::optional<uint64_t> marked_old_pages;
+  absl::optional<uint64_t> loaded_back_pages;
+};
+
+// Memory usage of an enclave, meant to size its heap and stacks. Values other
+// than |epc| are reported by the enclave and are only as trustworthy as any
+// other enclave output.
+struct EnclaveMemoryStats {
+  // Size of the enclave heap in bytes.
+  uint64_t heap_size = 0;
+
+  // Bytes of the heap currently in use by the allocator, and the largest such
+  // value since the enclave was loaded.
+  uint64_t heap_used = 0;
+  uint64_t heap_peak_used = 0;
+
+  // Bytes in blocks currently allocated from the heap, and bytes in free blocks
+  // kept by the allocator within |heap_used|.
+  uint64_t heap_allocated_bytes = 0;
+  uint64_t heap_free_bytes = 0;
+
+  // Stack usage of each TCS entered so far.
+  std::vector<EnclaveStackStats> stacks;
+
+  // EPC counters of the host, read outside the enclave.
+  EpcPagingStats epc;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_COMMON_ENCLAVE_MEMORY_STATS_H_
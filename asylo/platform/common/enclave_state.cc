@@ -18,45 +18,40 @@
 
 #include "asylo/platform/common/enclave_state.h"
 
+#include <atomic>
+
 #include "absl/strings/str_cat.h"
-#include "asylo/platform/core/trusted_spin_lock.h"
-#include "asylo/util/lock_guard.h"
 #include "asylo/util/status.h"
 
 namespace asylo {
 namespace {
 
-// lock to protect enclave state.
-TrustedSpinLock global_enclave_state_lock(/*is_recursive=*/false);
-
-// Enclave state.
-static EnclaveState global_enclave_state
-    ABSL_GUARDED_BY(global_enclave_state_lock) = EnclaveState::kUninitialized;
+// Enclave state. Every Run call reads it, so it is an atomic rather than being
+// guarded by a lock. Transitions are made with release stores so that a
+// thread observing a state also observes the writes made before entering it.
+std::atomic<EnclaveState> global_enclave_state{EnclaveState::kUninitialized};
 
 }  // namespace
 
 Status VerifyAndSetState(const EnclaveState &expected_state,
-                         const EnclaveState &new_state)
-    ABSL_LOCKS_EXCLUDED(global_enclave_state_lock) {
-  LockGuard lock(&global_enclave_state_lock);
-  if (global_enclave_state != expected_state) {
+                         const EnclaveState &new_state) {
+  EnclaveState state = expected_state;
+  if (!global_enclave_state.compare_exchange_strong(
+          state, new_state, std::memory_order_acq_rel,
+          std::memory_order_acquire)) {
     return Status(error::GoogleError::FAILED_PRECONDITION,
-                  ::absl::StrCat("Enclave is in state: ", global_enclave_state,
+                  ::absl::StrCat("Enclave is in state: ", state,
                                  " expected state: ", expected_state));
   }
-  global_enclave_state = new_state;
   return Status::OkStatus();
 }
 
-EnclaveState GetState() ABSL_LOCKS_EXCLUDED(global_enclave_state_lock) {
-  LockGuard lock(&global_enclave_state_lock);
-  return global_enclave_state;
+EnclaveState GetState() {
+  return global_enclave_state.load(std::memory_order_acquire);
 }
 
-void SetState(const EnclaveState &state)
-    ABSL_LOCKS_EXCLUDED(global_enclave_state_lock) {
-  LockGuard lock(&global_enclave_state_lock);
-  global_enclave_state = state;
+void SetState(const EnclaveState &state) {
+  global_enclave_state.store(state, std::memory_order_release);
 }
 
 }  // namespace asylo
@@ -0,0 +1,83 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_COMMON_ENCLAVE_THREAD_STATS_H_
+#define ASYLO_PLATFORM_COMMON_ENCLAVE_THREAD_STATS_H_
+
+#include <atomic>
+#include <cstdint>
+
+namespace asylo {
+
+// Thread and enclave transition counters of an enclave, kept in untrusted
+// memory so that the host can read them at any time without entering the
+// enclave. Some counters are maintained by the trusted runtime and the others
+// by the untrusted client, as noted below. All counters are updated with
+// relaxed atomic operations, so a set of values read together is not
+// necessarily a consistent snapshot.
+//
+// Values maintained by trusted code are reported by the enclave and are only
+// as trustworthy as any other enclave output read from untrusted memory.
+struct EnclaveThreadStats {
+  static_assert(sizeof(std::atomic<int64_t>) == sizeof(int64_t),
+                "std::atomic<int64_t> is not lock free.");
+
+  // Maintained by the trusted ThreadManager.
+
+  // Number of threads created with pthread_create() waiting for a donated
+  // thread to run them.
+  std::atomic<int64_t> queued_threads{0};
+
+  // Number of pthreads bound to a donated thread, including threads that
+  // returned and are waiting to be joined.
+  std::atomic<int64_t> running_threads{0};
+
+  // Number of donated threads in the enclave thread pool, and number of those
+  // parked waiting for a pthread to run.
+  std::atomic<int64_t> pool_threads{0};
+  std::atomic<int64_t> parked_pool_threads{0};
+
+  // Maintained by the untrusted client.
+
+  // Number of host threads currently inside the enclave, each occupying a
+  // TCS. Includes threads that are in the middle of an exit call.
+  std::atomic<int64_t> active_tcs{0};
+
+  // Number of host threads currently donated to the enclave to run pthreads.
+  std::atomic<int64_t> donated_tcs{0};
+
+  // Total number of enclave calls and exit calls.
+  std::atomic<uint64_t> ecalls{0};
+  std::atomic<uint64_t> ocalls{0};
+
+  // Number of thread donations that found no free TCS and had to wait for
+  // one, and total time spent waiting in nanoseconds.
+  std::atomic<uint64_t> tcs_waits{0};
+  std::atomic<uint64_t> tcs_wait_ns{0};
+
+  // Maintained by the trusted exception handlers.
+
+  // Number of CPUID and RDTSC instructions that trapped inside the enclave
+  // and were emulated.
+  std::atomic<uint64_t> emulated_cpuid{0};
+  std::atomic<uint64_t> emulated_rdtsc{0};
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_COMMON_ENCLAVE_THREAD_STATS_H_
@@ -0,0 +1,72 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/common/enclave_trace.h"
+
+namespace asylo {
+namespace enclave_trace_internal {
+
+std::atomic<EnclaveTraceBuffer *> trace_buffer{nullptr};
+
+namespace {
+
+// Clock used to timestamp events, published before |trace_buffer|.
+std::atomic<bool (*)(int64_t *nanos)> trace_clock{nullptr};
+
+// Index of the ring assigned to the next thread recording an event.
+std::atomic<uint32_t> next_ring{0};
+
+// Ring assigned to this thread in |buffer|. Kept in trusted memory, so the
+// host cannot redirect the writes of a thread.
+thread_local struct {
+  EnclaveTraceBuffer *buffer = nullptr;
+  EnclaveTraceRing *ring = nullptr;
+} thread_ring;
+
+}  // namespace
+
+void Record(EnclaveTraceBuffer *buffer, EnclaveTraceEvent event,
+            uint64_t arg0, uint64_t arg1) {
+  if (!buffer->enabled.load(std::memory_order_relaxed)) {
+    return;
+  }
+  if (thread_ring.buffer != buffer) {
+    uint32_t index = next_ring.fetch_add(1, std::memory_order_relaxed);
+    thread_ring.ring = &buffer->rings[index % EnclaveTraceBuffer::kRings];
+    thread_ring.buffer = buffer;
+  }
+  bool (*clock)(int64_t *nanos) = trace_clock.load(std::memory_order_relaxed);
+  int64_t timestamp;
+  if (!clock || !clock(&timestamp)) {
+    timestamp = 0;
+  }
+  WriteEnclaveTraceRecord(thread_ring.ring, event, timestamp, arg0, arg1);
+}
+
+}  // namespace enclave_trace_internal
+
+void SetEnclaveTraceBuffer(EnclaveTraceBuffer *buffer,
+                           bool (*clock)(int64_t *nanos)) {
+  using enclave_trace_internal::trace_buffer;
+  trace_buffer.store(nullptr, std::memory_order_release);
+  enclave_trace_internal::trace_clock.store(clock, std::memory_order_relaxed);
+  enclave_trace_internal::next_ring.store(0, std::memory_order_relaxed);
+  trace_buffer.store(buffer, std::memory_order_release);
+}
+
+}  // namespace asylo
@@ -0,0 +1,59 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_COMMON_ENCLAVE_TRACE_H_
+#define ASYLO_PLATFORM_COMMON_ENCLAVE_TRACE_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "asylo/platform/common/enclave_trace_buffer.h"
+
+namespace asylo {
+
+// Records enclave events to |buffer|, an EnclaveTraceBuffer in untrusted
+// memory, using |clock| to timestamp them. |clock| must not leave the enclave
+// and returns false if no timestamp is available, in which case events are
+// recorded with a zero timestamp. Passing a null |buffer| stops recording.
+void SetEnclaveTraceBuffer(EnclaveTraceBuffer *buffer,
+                           bool (*clock)(int64_t *nanos));
+
+namespace enclave_trace_internal {
+
+extern std::atomic<EnclaveTraceBuffer *> trace_buffer;
+
+void Record(EnclaveTraceBuffer *buffer, EnclaveTraceEvent event,
+            uint64_t arg0, uint64_t arg1);
+
+}  // namespace enclave_trace_internal
+
+// Records |event| with payload |arg0| and |arg1| if a trace buffer is
+// registered and enabled by the host. Costs a single atomic load when no
+// buffer is registered.
+inline void TraceEnclaveEvent(EnclaveTraceEvent event, uint64_t arg0 = 0,
+                              uint64_t arg1 = 0) {
+  EnclaveTraceBuffer *buffer =
+      enclave_trace_internal::trace_buffer.load(std::memory_order_acquire);
+  if (buffer) {
+    enclave_trace_internal::Record(buffer, event, arg0, arg1);
+  }
+}
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_COMMON_ENCLAVE_TRACE_H_
@@ -0,0 +1,214 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_COMMON_ENCLAVE_TRACE_BUFFER_H_
+#define ASYLO_PLATFORM_COMMON_ENCLAVE_TRACE_BUFFER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace asylo {
+
+// Identifiers of the events recorded in an EnclaveTraceBuffer, with the
+// meaning of the two payload words of each. Events never carry enclave
+// addresses, since the buffer is readable by the host.
+enum class EnclaveTraceEvent : uint16_t {
+  kNone = 0,
+
+  // Entry into and return from an enclave call: selector, and the status code
+  // returned (end only).
+  kEnclaveCallBegin = 1,
+  kEnclaveCallEnd = 2,
+
+  // Exit call made from the enclave: selector, and the size of the results
+  // returned by the host (end only).
+  kUntrustedCallBegin = 3,
+  kUntrustedCallEnd = 4,
+
+  // A pthread mutex found locked by another thread (no payload), then the
+  // number of spins of the last attempt before the thread went to sleep or
+  // acquired the mutex.
+  kMutexContended = 5,
+  kMutexSleep = 6,
+  kMutexAcquired = 7,
+
+  // Reads and writes through the IOManager: file descriptor, and the byte
+  // count requested (begin) or returned (end).
+  kIoReadBegin = 8,
+  kIoReadEnd = 9,
+  kIoWriteBegin = 10,
+  kIoWriteEnd = 11,
+
+  // Block decryption and encryption in secure files: file descriptor, and
+  // the number of bytes requested (begin) or processed (end).
+  kAeadDecryptBegin = 12,
+  kAeadDecryptEnd = 13,
+  kAeadEncryptBegin = 14,
+  kAeadEncryptEnd = 15,
+
+  // First identifier available to application-defined events.
+  kUser = 0x8000,
+};
+
+// A single trace event. |header| holds the sequence number of the record in
+// its ring in the upper 48 bits and the event identifier in the lower 16, and
+// is zero while the record is being written.
+struct EnclaveTraceRecord {
+  std::atomic<uint64_t> header{0};
+  std::atomic<int64_t> timestamp{0};
+  std::atomic<uint64_t> arg0{0};
+  std::atomic<uint64_t> arg1{0};
+};
+
+// A ring of trace records written by a single enclave thread. The writer
+// overwrites the oldest records once the ring is full.
+struct EnclaveTraceRing {
+  static constexpr size_t kRecords = 256;
+
+  // Number of records ever written to the ring.
+  std::atomic<uint64_t> head{0};
+  EnclaveTraceRecord records[kRecords];
+};
+
+// Fixed-size binary trace of enclave hot-path events, kept in untrusted memory
+// so that the host can drain it without entering the enclave. Each enclave
+// thread writes to a ring of its own, so recording an event takes no lock and
+// no exit. Threads beyond the number of rings share rings with earlier ones,
+// in which case concurrent writes to the same slot may lose records but never
+// produce a record mixing two events.
+//
+// The contents are written by the enclave and are only as trustworthy as any
+// other enclave output read from untrusted memory.
+struct EnclaveTraceBuffer {
+  static constexpr size_t kRings = 64;
+
+  static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+                "std::atomic<uint64_t> is not lock free.");
+
+  // Set by the host to start and stop recording.
+  std::atomic<bool> enabled{false};
+  EnclaveTraceRing rings[kRings];
+};
+
+// Publishes an event to |ring|. Must not be called concurrently on the same
+// ring if records are not to be lost.
+inline void WriteEnclaveTraceRecord(EnclaveTraceRing *ring,
+                                    EnclaveTraceEvent event, int64_t timestamp,
+                                    uint64_t arg0, uint64_t arg1) {
+  uint64_t sequence = ring->head.fetch_add(1, std::memory_order_relaxed) + 1;
+  EnclaveTraceRecord *record =
+      &ring->records[(sequence - 1) % EnclaveTraceRing::kRecords];
+  record->header.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  record->timestamp.store(timestamp, std::memory_order_relaxed);
+  record->arg0.store(arg0, std::memory_order_relaxed);
+  record->arg1.store(arg1, std::memory_order_relaxed);
+  record->header.store((sequence << 16) | static_cast<uint16_t>(event),
+                       std::memory_order_release);
+}
+
+// A trace event read back from an EnclaveTraceBuffer.
+struct EnclaveTraceEntry {
+  // Index of the ring the event was read from, which identifies the thread
+  // that recorded it.
+  size_t ring;
+  EnclaveTraceEvent event;
+  int64_t timestamp;
+  uint64_t arg0;
+  uint64_t arg1;
+};
+
+// Drains events from an EnclaveTraceBuffer on the host. Events are returned
+// at most once, in recording order within each ring. Must not be used from
+// more than one thread at a time.
+class EnclaveTraceReader {
+ public:
+  explicit EnclaveTraceReader(const EnclaveTraceBuffer *buffer)
+      : buffer_(buffer), next_(EnclaveTraceBuffer::kRings, 1), lost_(0) {}
+
+  // Appends the events recorded since the last call to |entries|. Returns the
+  // number of events appended.
+  size_t Drain(std::vector<EnclaveTraceEntry> *entries) {
+    size_t drained = 0;
+    for (size_t i = 0; i < EnclaveTraceBuffer::kRings; i++) {
+      const EnclaveTraceRing &ring = buffer_->rings[i];
+      uint64_t head = ring.head.load(std::memory_order_acquire);
+      if (head >= next_[i] + EnclaveTraceRing::kRecords) {
+        uint64_t oldest = head - EnclaveTraceRing::kRecords + 1;
+        lost_ += oldest - next_[i];
+        next_[i] = oldest;
+      }
+      for (; next_[i] <= head; next_[i]++) {
+        EnclaveTraceEntry entry;
+        ReadResult result = ReadRecord(ring, i, next_[i], &entry);
+        if (result == ReadResult::kPending) {
+          // Picked up by a later call once the writer publishes it.
+          break;
+        }
+        if (result == ReadResult::kOk) {
+          entries->push_back(entry);
+          drained++;
+        } else {
+          lost_++;
+        }
+      }
+    }
+    return drained;
+  }
+
+  // Returns the number of events overwritten or torn before they could be
+  // drained.
+  uint64_t lost() const { return lost_; }
+
+ private:
+  enum class ReadResult { kOk, kPending, kLost };
+
+  // Reads the record with sequence number |sequence| from |ring|. Returns
+  // kPending if the record has not been published yet, and kLost if it was
+  // overwritten by a later one.
+  static ReadResult ReadRecord(const EnclaveTraceRing &ring, size_t index,
+                               uint64_t sequence, EnclaveTraceEntry *entry) {
+    const EnclaveTraceRecord &record =
+        ring.records[(sequence - 1) % EnclaveTraceRing::kRecords];
+    uint64_t expected = sequence & ((uint64_t{1} << 48) - 1);
+    uint64_t header = record.header.load(std::memory_order_acquire);
+    if ((header >> 16) != expected) {
+      return header != 0 && (header >> 16) > expected ? ReadResult::kLost
+                                                      : ReadResult::kPending;
+    }
+    entry->ring = index;
+    entry->event = static_cast<EnclaveTraceEvent>(header & 0xffff);
+    entry->timestamp = record.timestamp.load(std::memory_order_relaxed);
+    entry->arg0 = record.arg0.load(std::memory_order_relaxed);
+    entry->arg1 = record.arg1.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return record.header.load(std::memory_order_relaxed) == header
+               ? ReadResult::kOk
+               : ReadResult::kLost;
+  }
+
+  const EnclaveTraceBuffer *buffer_;
+  std::vector<uint64_t> next_;
+  uint64_t lost_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_COMMON_ENCLAVE_TRACE_BUFFER_H_
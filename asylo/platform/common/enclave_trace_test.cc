@@ -0,0 +1,153 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/common/enclave_trace.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "asylo/platform/common/enclave_trace_buffer.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Eq;
+using ::testing::SizeIs;
+
+bool FakeClock(int64_t *nanos) {
+  static std::atomic<int64_t> now{0};
+  *nanos = ++now;
+  return true;
+}
+
+class EnclaveTraceTest : public ::testing::Test {
+ protected:
+  EnclaveTraceTest() : buffer_(new EnclaveTraceBuffer), reader_(buffer_.get()) {
+    buffer_->enabled = true;
+    SetEnclaveTraceBuffer(buffer_.get(), FakeClock);
+  }
+
+  ~EnclaveTraceTest() override { SetEnclaveTraceBuffer(nullptr, nullptr); }
+
+  std::unique_ptr<EnclaveTraceBuffer> buffer_;
+  EnclaveTraceReader reader_;
+};
+
+TEST_F(EnclaveTraceTest, DrainsRecordedEventsOnce) {
+  TraceEnclaveEvent(EnclaveTraceEvent::kIoReadBegin, 3, 100);
+  TraceEnclaveEvent(EnclaveTraceEvent::kIoReadEnd, 3, 42);
+
+  std::vector<EnclaveTraceEntry> entries;
+  EXPECT_THAT(reader_.Drain(&entries), Eq(2));
+  ASSERT_THAT(entries, SizeIs(2));
+  EXPECT_THAT(entries[0].event, Eq(EnclaveTraceEvent::kIoReadBegin));
+  EXPECT_THAT(entries[0].arg0, Eq(3));
+  EXPECT_THAT(entries[0].arg1, Eq(100));
+  EXPECT_THAT(entries[1].event, Eq(EnclaveTraceEvent::kIoReadEnd));
+  EXPECT_THAT(entries[1].arg1, Eq(42));
+  EXPECT_LT(entries[0].timestamp, entries[1].timestamp);
+  EXPECT_THAT(entries[0].ring, Eq(entries[1].ring));
+
+  EXPECT_THAT(reader_.Drain(&entries), Eq(0));
+  EXPECT_THAT(reader_.lost(), Eq(0));
+}
+
+TEST_F(EnclaveTraceTest, DisabledBufferRecordsNothing) {
+  buffer_->enabled = false;
+  TraceEnclaveEvent(EnclaveTraceEvent::kUser);
+
+  std::vector<EnclaveTraceEntry> entries;
+  EXPECT_THAT(reader_.Drain(&entries), Eq(0));
+}
+
+TEST_F(EnclaveTraceTest, CountsOverwrittenEvents) {
+  constexpr int kEvents = EnclaveTraceRing::kRecords + 10;
+  for (int i = 0; i < kEvents; i++) {
+    TraceEnclaveEvent(EnclaveTraceEvent::kUser, i);
+  }
+
+  std::vector<EnclaveTraceEntry> entries;
+  EXPECT_THAT(reader_.Drain(&entries), Eq(EnclaveTraceRing::kRecords));
+  EXPECT_THAT(reader_.lost(), Eq(10));
+  EXPECT_THAT(entries.front().arg0, Eq(10));
+  EXPECT_THAT(entries.back().arg0, Eq(kEvents - 1));
+}
+
+TEST_F(EnclaveTraceTest, ThreadsWriteToSeparateRings) {
+  constexpr int kThreads = 4;
+  constexpr int kEvents = 100;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; i++) {
+    threads.emplace_back([i] {
+      for (int j = 0; j < kEvents; j++) {
+        TraceEnclaveEvent(EnclaveTraceEvent::kUser, i, j);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  std::vector<EnclaveTraceEntry> entries;
+  EXPECT_THAT(reader_.Drain(&entries), Eq(kThreads * kEvents));
+  std::vector<size_t> ring_of_thread(kThreads, EnclaveTraceBuffer::kRings);
+  for (const EnclaveTraceEntry &entry : entries) {
+    size_t &ring = ring_of_thread[entry.arg0];
+    if (ring == EnclaveTraceBuffer::kRings) {
+      ring = entry.ring;
+    }
+    EXPECT_THAT(entry.ring, Eq(ring));
+  }
+}
+
+TEST_F(EnclaveTraceTest, ConcurrentDrainSeesCompleteEvents) {
+  constexpr uint64_t kEvents = 100000;
+  std::atomic<bool> done(false);
+  std::thread writer([&done] {
+    for (uint64_t i = 0; i < kEvents; i++) {
+      TraceEnclaveEvent(EnclaveTraceEvent::kUser, i, ~i);
+    }
+    done = true;
+  });
+
+  std::vector<EnclaveTraceEntry> entries;
+  uint64_t seen = 0;
+  int inconsistent = 0;
+  bool last_drain = false;
+  while (!last_drain) {
+    last_drain = done;
+    entries.clear();
+    seen += reader_.Drain(&entries);
+    for (const EnclaveTraceEntry &entry : entries) {
+      if (entry.arg1 != ~entry.arg0) {
+        inconsistent++;
+      }
+    }
+  }
+  writer.join();
+
+  EXPECT_THAT(inconsistent, Eq(0));
+  EXPECT_THAT(seen + reader_.lost(), Eq(kEvents));
+}
+
+}  // namespace
+}  // namespace asylo
@@ -0,0 +1,54 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_COMMON_HOST_INFO_GENERATIONS_H_
+#define ASYLO_PLATFORM_COMMON_HOST_INFO_GENERATIONS_H_
+
+#include <atomic>
+#include <cstdint>
+
+namespace asylo {
+
+// Counters, in untrusted memory, which the host increments whenever facts
+// about the host cached by the enclave may have changed. The enclave checks
+// the counters without leaving the enclave, and queries the host again for
+// facts cached under an older value.
+//
+// The counters are no more trustworthy than the host calls returning the
+// facts, since the host controls both.
+struct HostInfoGenerations {
+  static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+                "std::atomic<uint64_t> is not lock free.");
+
+  HostInfoGenerations() : interfaces(0), system(0) {}
+
+  HostInfoGenerations(const HostInfoGenerations &other) = delete;
+  HostInfoGenerations &operator=(const HostInfoGenerations &other) = delete;
+
+  // Incremented when the network interfaces or their addresses change, which
+  // invalidates the result of getifaddrs().
+  std::atomic<uint64_t> interfaces;
+
+  // Incremented when system information or the user database may have
+  // changed, which invalidates the results of uname() and getpwuid().
+  std::atomic<uint64_t> system;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_COMMON_HOST_INFO_GENERATIONS_H_
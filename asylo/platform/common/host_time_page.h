@@ -0,0 +1,94 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_COMMON_HOST_TIME_PAGE_H_
+#define ASYLO_PLATFORM_COMMON_HOST_TIME_PAGE_H_
+
+#include <atomic>
+#include <cstdint>
+
+namespace asylo {
+
+// A snapshot of the host clocks, periodically written by an untrusted thread
+// and read by trusted code without leaving the enclave. Writes are published
+// with a sequence lock: the writer makes the sequence odd while it updates the
+// clocks and even again once done, and readers retry until they observe the
+// same even sequence before and after reading the clocks.
+//
+// The page lives in untrusted memory, so its contents are no more trustworthy
+// than the result of a host call for the same clocks. A reader which fails to
+// get a consistent snapshot after a bounded number of attempts gives up, so a
+// corrupted page cannot make trusted code spin forever.
+class HostTimePage {
+ public:
+  // Number of attempts Read() makes to get a consistent snapshot.
+  static constexpr int kMaxReadAttempts = 16;
+
+  static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+                "std::atomic<uint64_t> is not lock free.");
+
+  HostTimePage() : sequence_(0), monotonic_nanos_(0), realtime_nanos_(0) {}
+
+  HostTimePage(const HostTimePage &other) = delete;
+  HostTimePage &operator=(const HostTimePage &other) = delete;
+
+  // Publishes new clock values. Must only be called by a single writer.
+  void Update(int64_t monotonic_nanos, int64_t realtime_nanos) {
+    uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    monotonic_nanos_.store(monotonic_nanos, std::memory_order_relaxed);
+    realtime_nanos_.store(realtime_nanos, std::memory_order_relaxed);
+    sequence_.store(sequence + 2, std::memory_order_release);
+  }
+
+  // Reads a consistent snapshot of the clocks. Returns false if the page has
+  // never been updated or no consistent snapshot could be read. Otherwise sets
+  // |generation| to a value which changes with every update.
+  bool Read(int64_t *monotonic_nanos, int64_t *realtime_nanos,
+            uint64_t *generation) const {
+    for (int i = 0; i < kMaxReadAttempts; i++) {
+      uint64_t before = sequence_.load(std::memory_order_acquire);
+      if (before == 0) {
+        return false;
+      }
+      if (before & 1) {
+        continue;
+      }
+      int64_t monotonic = monotonic_nanos_.load(std::memory_order_relaxed);
+      int64_t realtime = realtime_nanos_.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (sequence_.load(std::memory_order_relaxed) == before) {
+        *monotonic_nanos = monotonic;
+        *realtime_nanos = realtime;
+        *generation = before;
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  std::atomic<uint64_t> sequence_;
+  std::atomic<int64_t> monotonic_nanos_;
+  std::atomic<int64_t> realtime_nanos_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_COMMON_HOST_TIME_PAGE_H_
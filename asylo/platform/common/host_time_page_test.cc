@@ -0,0 +1,89 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/common/host_time_page.h"
+
+#include <atomic>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+namespace asylo {
+namespace {
+
+TEST(HostTimePageTest, ReadFailsBeforeFirstUpdate) {
+  HostTimePage page;
+  int64_t monotonic, realtime;
+  uint64_t generation;
+  EXPECT_FALSE(page.Read(&monotonic, &realtime, &generation));
+}
+
+TEST(HostTimePageTest, ReadReturnsLatestUpdate) {
+  HostTimePage page;
+  int64_t monotonic, realtime;
+  uint64_t first, second;
+
+  page.Update(10, 20);
+  ASSERT_TRUE(page.Read(&monotonic, &realtime, &first));
+  EXPECT_EQ(monotonic, 10);
+  EXPECT_EQ(realtime, 20);
+
+  page.Update(11, 21);
+  ASSERT_TRUE(page.Read(&monotonic, &realtime, &second));
+  EXPECT_EQ(monotonic, 11);
+  EXPECT_EQ(realtime, 21);
+  EXPECT_NE(first, second);
+}
+
+TEST(HostTimePageTest, ConcurrentReadsAreConsistent) {
+  constexpr int64_t kUpdates = 100000;
+
+  HostTimePage page;
+  page.Update(0, 0);
+  std::atomic<bool> done(false);
+  std::thread writer([&page, &done] {
+    for (int64_t i = 1; i <= kUpdates; i++) {
+      page.Update(i, -i);
+    }
+    done = true;
+  });
+
+  int64_t last = 0;
+  int inconsistent = 0;
+  int backwards = 0;
+  while (!done) {
+    int64_t monotonic, realtime;
+    uint64_t generation;
+    if (!page.Read(&monotonic, &realtime, &generation)) {
+      continue;
+    }
+    if (realtime != -monotonic) {
+      inconsistent++;
+    }
+    if (monotonic < last) {
+      backwards++;
+    }
+    last = monotonic;
+  }
+  writer.join();
+  EXPECT_EQ(inconsistent, 0);
+  EXPECT_EQ(backwards, 0);
+}
+
+}  // namespace
+}  // namespace asylo
@@ -0,0 +1,131 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/core/client_registry.h"
+
+#include <thread>
+#include <utility>
+
+#include "absl/memory/memory.h"
+
+namespace asylo {
+
+class ClientRegistry::ReadGuard {
+ public:
+  explicit ReadGuard(const ClientRegistry *registry)
+      : count_(&registry->readers_[ThreadIndex() % kNumReaderCounts].value) {
+    // Sequentially consistent, so that an update which observes no lookup in
+    // progress after publishing a snapshot cannot race with a lookup which
+    // still reads the previous one.
+    count_->fetch_add(1, std::memory_order_seq_cst);
+  }
+
+  ~ReadGuard() { count_->fetch_sub(1, std::memory_order_release); }
+
+  ReadGuard(const ReadGuard &other) = delete;
+  ReadGuard &operator=(const ReadGuard &other) = delete;
+
+ private:
+  // Returns an index assigned to the calling thread on its first lookup.
+  static uint32_t ThreadIndex() {
+    static std::atomic<uint32_t> next_index{0};
+    thread_local uint32_t index =
+        next_index.fetch_add(1, std::memory_order_relaxed);
+    return index;
+  }
+
+  std::atomic<uint32_t> *const count_;
+};
+
+constexpr int ClientRegistry::kNumReaderCounts;
+
+ClientRegistry::ClientRegistry() : snapshot_(new Snapshot) {}
+
+ClientRegistry::~ClientRegistry() {
+  delete snapshot_.load(std::memory_order_relaxed);
+}
+
+EnclaveClient *ClientRegistry::Find(absl::string_view name) const {
+  ReadGuard guard(this);
+  const Snapshot *snapshot = snapshot_.load(std::memory_order_seq_cst);
+  auto it = snapshot->client_by_name.find(name);
+  return it == snapshot->client_by_name.end() ? nullptr : it->second;
+}
+
+absl::string_view ClientRegistry::FindName(const EnclaveClient *client) const {
+  ReadGuard guard(this);
+  const Snapshot *snapshot = snapshot_.load(std::memory_order_seq_cst);
+  auto it = snapshot->name_by_client.find(client);
+  return it == snapshot->name_by_client.end() ? absl::string_view()
+                                              : *it->second;
+}
+
+void ClientRegistry::Insert(absl::string_view name, EnclaveClient *client) {
+  auto snapshot =
+      absl::make_unique<Snapshot>(*snapshot_.load(std::memory_order_relaxed));
+  auto it = snapshot->client_by_name.find(name);
+  if (it != snapshot->client_by_name.end()) {
+    snapshot->name_by_client.erase(it->second);
+    snapshot->client_by_name.erase(it);
+  }
+  auto old_name = snapshot->name_by_client.find(client);
+  if (old_name != snapshot->name_by_client.end()) {
+    snapshot->client_by_name.erase(*old_name->second);
+    snapshot->name_by_client.erase(old_name);
+  }
+  snapshot->client_by_name.emplace(std::string(name), client);
+  snapshot->name_by_client.emplace(
+      client, std::make_shared<const std::string>(name));
+  Publish(std::move(snapshot));
+}
+
+void ClientRegistry::Rename(const EnclaveClient *client,
+                            absl::string_view new_name) {
+  const Snapshot *current = snapshot_.load(std::memory_order_relaxed);
+  auto it = current->name_by_client.find(client);
+  if (it == current->name_by_client.end()) {
+    return;
+  }
+  Insert(new_name, current->client_by_name.at(*it->second));
+}
+
+void ClientRegistry::Erase(const EnclaveClient *client) {
+  const Snapshot *current = snapshot_.load(std::memory_order_relaxed);
+  auto it = current->name_by_client.find(client);
+  if (it == current->name_by_client.end()) {
+    return;
+  }
+  auto snapshot = absl::make_unique<Snapshot>(*current);
+  snapshot->client_by_name.erase(*it->second);
+  snapshot->name_by_client.erase(client);
+  Publish(std::move(snapshot));
+}
+
+void ClientRegistry::Publish(std::unique_ptr<Snapshot> snapshot) {
+  std::unique_ptr<const Snapshot> previous(
+      snapshot_.exchange(snapshot.release(), std::memory_order_seq_cst));
+  // Lookups starting from now read the new snapshot, so each count drains as
+  // the lookups already in progress complete.
+  for (ReaderCount &count : readers_) {
+    while (count.value.load(std::memory_order_seq_cst) != 0) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+}  // namespace asylo
@@ -0,0 +1,103 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_CORE_CLIENT_REGISTRY_H_
+#define ASYLO_PLATFORM_CORE_CLIENT_REGISTRY_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+
+namespace asylo {
+
+class EnclaveClient;
+
+// A two-way map between enclave names and clients which is read without
+// locks.
+//
+// Lookups read an immutable snapshot of the map published through an atomic
+// pointer, so they never wait for updates, nor for each other beyond touching
+// one of a few reader counters. An update copies the current snapshot,
+// publishes the modified copy, and waits until no lookup may still read the
+// previous snapshot before freeing it. Updates must be serialized by the
+// caller, and are expected to be much rarer than lookups.
+//
+// The registry does not own the clients.
+class ClientRegistry {
+ public:
+  ClientRegistry();
+  ~ClientRegistry();
+
+  ClientRegistry(const ClientRegistry &other) = delete;
+  ClientRegistry &operator=(const ClientRegistry &other) = delete;
+
+  // Returns the client registered under |name|, or nullptr if there is none.
+  EnclaveClient *Find(absl::string_view name) const;
+
+  // Returns the name |client| is registered under, or an empty string if it is
+  // not registered. The returned view remains valid until |client| is removed
+  // or renamed.
+  absl::string_view FindName(const EnclaveClient *client) const;
+
+  // Registers |client| under |name|, replacing any client registered under
+  // |name| before.
+  void Insert(absl::string_view name, EnclaveClient *client);
+
+  // Registers |client| under |new_name| instead of its current name. Has no
+  // effect if |client| is not registered.
+  void Rename(const EnclaveClient *client, absl::string_view new_name);
+
+  // Removes |client| from the registry. Has no effect if |client| is not
+  // registered.
+  void Erase(const EnclaveClient *client);
+
+ private:
+  struct Snapshot {
+    absl::flat_hash_map<std::string, EnclaveClient *> client_by_name;
+
+    // Names are shared between snapshots, so that a name returned by
+    // FindName() outlives the snapshot it was read from.
+    absl::flat_hash_map<const EnclaveClient *,
+                        std::shared_ptr<const std::string>>
+        name_by_client;
+  };
+
+  // Number of lookups in progress, striped over a few cache lines by thread.
+  struct alignas(64) ReaderCount {
+    std::atomic<uint32_t> value{0};
+  };
+  static constexpr int kNumReaderCounts = 16;
+
+  // Marks a lookup in progress on the calling thread for its lifetime.
+  class ReadGuard;
+
+  // Publishes |snapshot| and frees the previous snapshot once no lookup reads
+  // it anymore.
+  void Publish(std::unique_ptr<Snapshot> snapshot);
+
+  std::atomic<const Snapshot *> snapshot_;
+  mutable ReaderCount readers_[kNumReaderCounts];
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_CORE_CLIENT_REGISTRY_H_
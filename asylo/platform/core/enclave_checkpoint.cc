@@ -0,0 +1,150 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/core/enclave_checkpoint.h"
+
+#include <openssl/rand.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "asylo/crypto/aead_cryptor.h"
+#include "asylo/crypto/util/bssl_util.h"
+#include "asylo/identity/sealing/sealed_secret.pb.h"
+#include "asylo/identity/sealing/sgx/sgx_local_secret_sealer.h"
+#include "asylo/util/cleansing_types.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace {
+
+// Size of the AES256-GCM-SIV key the state is encrypted with.
+constexpr size_t kCheckpointKeySize = 32;
+
+// Maximum size of the plaintext of a chunk. Like the chunks of a fork
+// snapshot, each chunk has its own nonce and stays well below the message
+// size limit of AES-GCM-SIV.
+constexpr size_t kCheckpointChunkSize = 8 << 20;
+
+constexpr char kCheckpointKeyName[] = "Enclave checkpoint key";
+constexpr char kCheckpointKeyVersion[] = "1";
+constexpr char kCheckpointKeyPurpose[] = "AES256-GCM-SIV checkpoint key";
+
+// Returns the data chunk |index| of |num_chunks| is authenticated with, so
+// that chunks can be neither reordered nor moved between checkpoints of
+// different lengths.
+std::string ChunkAssociatedData(size_t index, size_t num_chunks) {
+  return absl::StrCat(index, "/", num_chunks);
+}
+
+// Returns the data the checkpoint key is sealed with, binding the number of
+// chunks and the version of the checkpoint to its key.
+std::string KeyAssociatedData(size_t num_chunks, uint64_t version) {
+  return absl::StrCat(num_chunks, "@", version);
+}
+
+}  // namespace
+
+Status SealCheckpoint(ByteContainerView state, uint64_t version,
+                      EnclaveCheckpoint *checkpoint) {
+  checkpoint->Clear();
+  checkpoint->set_version(version);
+
+  CleansingVector<uint8_t> key(kCheckpointKeySize);
+  if (!RAND_bytes(key.data(), key.size())) {
+    return Status(error::GoogleError::INTERNAL,
+                  absl::StrCat("Can not generate the checkpoint key: ",
+                               BsslLastErrorString()));
+  }
+  std::unique_ptr<AeadCryptor> cryptor;
+  ASYLO_ASSIGN_OR_RETURN(cryptor, AeadCryptor::CreateAesGcmSivCryptor(key));
+
+  size_t num_chunks =
+      (state.size() + kCheckpointChunkSize - 1) / kCheckpointChunkSize;
+  std::vector<uint8_t> ciphertext;
+  for (size_t i = 0; i < num_chunks; i++) {
+    size_t offset = i * kCheckpointChunkSize;
+    ByteContainerView plaintext(
+        state.data() + offset,
+        std::min(kCheckpointChunkSize, state.size() - offset));
+    ciphertext.resize(plaintext.size() + cryptor->MaxSealOverhead());
+    std::vector<uint8_t> nonce(cryptor->NonceSize());
+    size_t ciphertext_size;
+    ASYLO_RETURN_IF_ERROR(cryptor->Seal(
+        plaintext, ChunkAssociatedData(i, num_chunks), absl::MakeSpan(nonce),
+        absl::MakeSpan(ciphertext), &ciphertext_size));
+
+    EnclaveCheckpointChunk *chunk = checkpoint->add_chunks();
+    chunk->set_ciphertext(ciphertext.data(), ciphertext_size);
+    chunk->set_nonce(nonce.data(), nonce.size());
+  }
+
+  std::unique_ptr<SgxLocalSecretSealer> sealer =
+      SgxLocalSecretSealer::CreateMrenclaveSecretSealer();
+  SealedSecretHeader header;
+  ASYLO_RETURN_IF_ERROR(sealer->SetDefaultHeader(&header));
+  header.set_secret_name(kCheckpointKeyName);
+  header.set_secret_version(kCheckpointKeyVersion);
+  header.set_secret_purpose(kCheckpointKeyPurpose);
+  return sealer->Seal(header, KeyAssociatedData(num_chunks, version), key,
+                      checkpoint->mutable_sealed_key());
+}
+
+StatusOr<std::string> OpenCheckpoint(const EnclaveCheckpoint &checkpoint,
+                                     uint64_t *version) {
+  size_t num_chunks = checkpoint.chunks_size();
+  if (checkpoint.sealed_key().additional_authenticated_data() !=
+      KeyAssociatedData(num_chunks, checkpoint.version())) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Checkpoint chunks or version do not match its key");
+  }
+
+  std::unique_ptr<SgxLocalSecretSealer> sealer =
+      SgxLocalSecretSealer::CreateMrenclaveSecretSealer();
+  CleansingVector<uint8_t> key;
+  ASYLO_RETURN_IF_ERROR(sealer->Unseal(checkpoint.sealed_key(), &key));
+  std::unique_ptr<AeadCryptor> cryptor;
+  ASYLO_ASSIGN_OR_RETURN(cryptor, AeadCryptor::CreateAesGcmSivCryptor(key));
+
+  std::string state;
+  for (size_t i = 0; i < num_chunks; i++) {
+    const EnclaveCheckpointChunk &chunk = checkpoint.chunks(i);
+    if (chunk.ciphertext().size() >
+        kCheckpointChunkSize + cryptor->MaxSealOverhead()) {
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    "Checkpoint chunk is too large");
+    }
+    size_t offset = state.size();
+    state.resize(offset + chunk.ciphertext().size());
+    size_t plaintext_size;
+    ASYLO_RETURN_IF_ERROR(cryptor->Open(
+        chunk.ciphertext(), ChunkAssociatedData(i, num_chunks), chunk.nonce(),
+        absl::MakeSpan(reinterpret_cast<uint8_t *>(&state[offset]),
+                       chunk.ciphertext().size()),
+        &plaintext_size));
+    state.resize(offset + plaintext_size);
+  }
+  *version = checkpoint.version();
+  return state;
+}
+
+}  // namespace asylo
@@ -0,0 +1,54 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_CORE_ENCLAVE_CHECKPOINT_H_
+#define ASYLO_PLATFORM_CORE_ENCLAVE_CHECKPOINT_H_
+
+// Encryption of the checkpoints of trusted applications. Only available to
+// trusted code.
+
+#include <cstdint>
+#include <string>
+
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/platform/core/enclave_checkpoint.pb.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+
+// Encrypts |state| into |checkpoint| under a fresh key, which is sealed to the
+// MRENCLAVE of the calling enclave together with |version|.
+Status SealCheckpoint(ByteContainerView state, uint64_t version,
+                      EnclaveCheckpoint *checkpoint);
+
+// Decrypts the state of |checkpoint| and sets |version| to the version it was
+// sealed with. Fails unless the checkpoint was sealed by an enclave with the
+// same MRENCLAVE as the calling enclave, on the same host, and its contents
+// were not modified since.
+//
+// There is no rollback protection: any checkpoint the enclave ever sealed
+// opens, including one older than the latest. Callers that must not restore
+// stale state compare |version| against a counter of their own, kept where
+// the host cannot roll it back.
+StatusOr<std::string> OpenCheckpoint(const EnclaveCheckpoint &checkpoint,
+                                     uint64_t *version);
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_CORE_ENCLAVE_CHECKPOINT_H_
@@ -19,8 +19,11 @@
 #ifndef ASYLO_PLATFORM_CORE_ENCLAVE_CLIENT_H_
 #define ASYLO_PLATFORM_CORE_ENCLAVE_CLIENT_H_
 
+#include <string>
+
 #include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
 #include "asylo/enclave.pb.h"  // IWYU pragma: export
 #include "asylo/platform/core/shared_name.h"
 #include "asylo/util/status.h"  // IWYU pragma: export
@@ -49,6 +52,45 @@ class EnclaveClient {
   virtual Status EnterAndRun(const EnclaveInput &input,
                              EnclaveOutput *output) = 0;
 
+  /// Enters the enclave and invokes its execution entry point with an input
+  /// that is already serialized. Callers that make the same call repeatedly
+  /// can serialize its input once instead of on every call.
+  ///
+  /// \param serialized_input A serialized EnclaveInput message.
+  /// \param[out] output A nullable pointer to a protobuf message that can store
+  ///                    a response message.
+  virtual Status EnterAndRunSerialized(absl::string_view serialized_input,
+                                       EnclaveOutput *output) {
+    EnclaveInput input;
+    if (!input.ParseFromArray(serialized_input.data(),
+                              serialized_input.size())) {
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    "Failed to parse EnclaveInput");
+    }
+    return EnterAndRun(input, output);
+  }
+
+  /// Enters the enclave and invokes its execution entry point with an input
+  /// that is already serialized, and stores the serialized EnclaveOutput in
+  /// `serialized_output` instead of parsing it. This suits callers, such as
+  /// language bindings, that hand the output on in serialized form.
+  ///
+  /// \param serialized_input A serialized EnclaveInput message.
+  /// \param[out] serialized_output The serialized EnclaveOutput message. Its
+  ///                               capacity is reused across calls.
+  /// \return The status carried by the EnclaveOutput, or the error that
+  ///         prevented the enclave from producing one.
+  virtual Status EnterAndRunSerialized(absl::string_view serialized_input,
+                                       std::string *serialized_output) {
+    EnclaveOutput output;
+    Status status = EnterAndRunSerialized(serialized_input, &output);
+    if (!output.SerializeToString(serialized_output)) {
+      return Status(error::GoogleError::INTERNAL,
+                    "Failed to serialize EnclaveOutput");
+    }
+    return status;
+  }
+
   /// Returns the name of the enclave.
   ///
   /// \return The name of the enclave.
@@ -67,6 +109,21 @@ class EnclaveClient {
   // Enters the enclave and invokes its initialization entry point.
   virtual Status EnterAndInitialize(const EnclaveConfig &config) = 0;
 
+  // Enters the enclave and invokes its initialization entry point with an
+  // already serialized EnclaveConfig. Lets a caller initializing many enclaves
+  // with the same config serialize it once. The default implementation parses
+  // |serialized_config| and calls EnterAndInitialize().
+  virtual Status EnterAndInitializeSerialized(
+      absl::string_view serialized_config) {
+    EnclaveConfig config;
+    if (!config.ParseFromArray(serialized_config.data(),
+                               serialized_config.size())) {
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    "Failed to parse EnclaveConfig");
+    }
+    return EnterAndInitialize(config);
+  }
+
   // Enters the enclave and invokes its finalization entry point.
   virtual Status EnterAndFinalize(const EnclaveFinal &final_input) = 0;
 
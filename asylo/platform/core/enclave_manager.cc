@@ -19,28 +19,61 @@
 #include "asylo/platform/core/enclave_manager.h"
 
 #include <stdint.h>
+#include <sys/stat.h>
 #include <sys/ucontext.h>
 #include <time.h>
-
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <future>
 #include <thread>
+#include <vector>
 
+#include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "asylo/enclave.pb.h"
 #include "asylo/util/logging.h"
 #include "asylo/platform/common/time_util.h"
+#include "asylo/platform/core/enclave_startup_profile.pb.h"
 #include "asylo/platform/core/generic_enclave_client.h"
 #include "asylo/platform/primitives/enclave_loader.h"
 #include "asylo/platform/primitives/extent.h"
+#include "asylo/platform/primitives/sgx/cpu_affinity.h"
+#include "asylo/platform/primitives/sgx/epc_info.h"
 #include "asylo/platform/primitives/sgx/loader.pb.h"
 #include "asylo/platform/primitives/sgx/untrusted_sgx.h"
+#include "asylo/util/posix_error_space.h"
 #include "asylo/util/status.h"
 #include "asylo/util/status_macros.h"
 #include "asylo/util/statusor.h"
+#include "asylo/util/thread_pool.h"
 
 namespace asylo {
 namespace {
 
+// The maximum number of enclaves that LoadEnclaves() loads at the same time.
+constexpr int kMaxConcurrentEnclaveLoads = 8;
+
+// Maximum number of enclaves DestroyEnclaves() finalizes and destroys at once.
+constexpr int kMaxConcurrentEnclaveDestroys = 8;
+
+// EPC the SGX runtime allocates for each TCS besides its stack: the TCS page,
+// two SSA frames and the thread data page.
+constexpr uint64_t kEpcBytesPerTcs = 4 * 4096;
+
+// Returns the bytes of EPC an enclave of |footprint| occupies.
+uint64_t FootprintBytes(const EnclaveFootprint &footprint) {
+  return footprint.image_size() + footprint.heap_size() +
+         footprint.tcs_count() * (footprint.stack_size() + kEpcBytesPerTcs);
+}
+
 // Returns the value of a monotonic clock as a number of nanoseconds.
 int64_t MonotonicClock() {
   struct timespec ts;
@@ -57,6 +90,16 @@ int64_t RealTimeClock() {
   return TimeSpecToNanoseconds(&ts);
 }
 
+// Appends a phase named |name| that started at |start|, a value of
+// MonotonicClock(), and ends now to |profile|.
+EnclaveStartupPhase *AddStartupPhase(const char *name, int64_t start,
+                                     EnclaveStartupProfile *profile) {
+  EnclaveStartupPhase *phase = profile->add_phases();
+  phase->set_name(name);
+  phase->set_duration_ns(MonotonicClock() - start);
+  return phase;
+}
+
 // Sleeps for a interval specified in nanoseconds.
 void Sleep(int64_t nanoseconds) {
   struct timespec req;
@@ -108,34 +151,69 @@ Status EnclaveManager::DestroyEnclave(EnclaveClient *client,
 
   client->ReleaseMemory();
 
-  absl::WriterMutexLock lock(&client_table_lock_);
-  const auto &name = name_by_client_[client];
-  client_by_name_.erase(name);
-  name_by_client_.erase(client);
-  load_config_by_client_.erase(client);
+  {
+    absl::WriterMutexLock lock(&client_table_lock_);
+    std::string name(client_registry_.FindName(client));
+    client_registry_.Erase(client);
+    client_by_name_.erase(name);
+    load_config_by_client_.erase(client);
+    startup_profile_by_client_.erase(client);
+  }
+
+  {
+    absl::MutexLock lock(&epc_lock_);
+    auto it = footprint_by_client_.find(client);
+    if (it != footprint_by_client_.end()) {
+      epc_used_bytes_ -= it->second;
+      footprint_by_client_.erase(it);
+    }
+  }
 
   return finalize_status;
 }
 
-EnclaveClient *EnclaveManager::GetClient(absl::string_view name) const {
-  absl::ReaderMutexLock lock(&client_table_lock_);
-  auto it = client_by_name_.find(name);
-  if (it == client_by_name_.end()) {
-    return nullptr;
-  } else {
-    return it->second.get();
+std::vector<Status> EnclaveManager::DestroyEnclaves(
+    const std::vector<EnclaveClient *> &clients,
+    const EnclaveFinal &final_input, bool skip_finalize) {
+  std::vector<Status> statuses;
+  if (clients.empty()) {
+    return statuses;
+  }
+  ThreadPool pool(std::min(static_cast<int>(clients.size()),
+                           kMaxConcurrentEnclaveDestroys));
+  std::vector<std::future<Status>> pending;
+  pending.reserve(clients.size());
+  for (EnclaveClient *client : clients) {
+    pending.push_back(
+        pool.Submit([this, client, &final_input, skip_finalize] {
+          return DestroyEnclave(client, final_input, skip_finalize);
+        }));
   }
+  statuses.reserve(clients.size());
+  for (auto &status : pending) {
+    statuses.push_back(status.get());
+  }
+  return statuses;
+}
+
+EnclaveClient *EnclaveManager::GetClient(absl::string_view name) const {
+  return client_registry_.Find(name);
 }
 
 const absl::string_view EnclaveManager::GetName(
     const EnclaveClient *client) const {
+  return client_registry_.FindName(client);
+}
+
+StatusOr<EnclaveStartupProfile> EnclaveManager::GetStartupProfile(
+    const EnclaveClient *client) const {
   absl::ReaderMutexLock lock(&client_table_lock_);
-  auto it = name_by_client_.find(client);
-  if (it == name_by_client_.end()) {
-    return absl::string_view();
-  } else {
-    return it->second;
+  auto it = startup_profile_by_client_.find(client);
+  if (it == startup_profile_by_client_.end()) {
+    return Status(error::GoogleError::NOT_FOUND,
+                  "No startup profile recorded for the enclave");
   }
+  return it->second;
 }
 
 EnclaveLoadConfig EnclaveManager::GetLoadConfigFromClient(
@@ -225,22 +303,16 @@ Status EnclaveManager::LoadFakeEnclave(absl::string_view name,
                                        const EnclaveConfig &config,
                                        void *base_address,
                                        const size_t enclave_size) {
-  // Check whether a client with this name already exists.
-  {
-    absl::ReaderMutexLock lock(&client_table_lock_);
-    if (client_by_name_.find(name) != client_by_name_.end()) {
-      Status status(error::GoogleError::ALREADY_EXISTS,
-                    absl::StrCat("Name already exists: ", name));
-      LOG(ERROR) << "LoadEnclave failed: " << status;
-      return status;
-    }
-  }
+  // Reserve the name so that no other enclave is bound to it while this one
+  // is loaded.
+  ASYLO_RETURN_IF_ERROR(ReserveName(name));
 
   // Attempt to load the enclave.
   StatusOr<std::unique_ptr<EnclaveClient>> result =
       loader.LoadEnclave(name, base_address, enclave_size, config);
   if (!result.ok()) {
     LOG(ERROR) << "LoadEnclave failed: " << result.status();
+    ReleaseName(name);
     return result.status();
   }
 
@@ -248,8 +320,9 @@ Status EnclaveManager::LoadFakeEnclave(absl::string_view name,
   EnclaveClient *client = result.ValueOrDie().get();
   {
     absl::WriterMutexLock lock(&client_table_lock_);
+    loading_names_.erase(name);
     client_by_name_.emplace(name, std::move(result).ValueOrDie());
-    name_by_client_.emplace(client, name);
+    client_registry_.Insert(name, client);
   }
 
   Status status = client->EnterAndInitialize(config);
@@ -263,14 +336,25 @@ Status EnclaveManager::LoadFakeEnclave(absl::string_view name,
     }
     {
       absl::WriterMutexLock lock(&client_table_lock_);
+      client_registry_.Erase(client);
       client_by_name_.erase(name);
-      name_by_client_.erase(client);
     }
   }
   return status;
 }
 
 Status EnclaveManager::LoadEnclave(const EnclaveLoadConfig &load_config) {
+  if (load_config.has_pool_name()) {
+    return LoadEnclaveFromPool(load_config);
+  }
+  return LoadEnclaveWithSerializedConfig(load_config, nullptr);
+}
+
+Status EnclaveManager::LoadEnclaveWithSerializedConfig(
+    const EnclaveLoadConfig &load_config, std::string *serialized_config,
+    bool fill_pool) {
+  int64_t load_start = MonotonicClock();
+
   EnclaveConfig config;
   if (load_config.has_config()) {
     config = load_config.config();
@@ -280,6 +364,7 @@ Status EnclaveManager::LoadEnclave(const EnclaveLoadConfig &load_config) {
   }
 
   void *base_address = nullptr;
+  EnclaveLoadConfig placed_load_config = load_config;
   if (load_config.HasExtension(sgx_load_config)) {
     SgxLoadConfig sgx_config = load_config.GetExtension(sgx_load_config);
     primitives::SgxEnclaveClient::SetForkedEnclaveLoader(
@@ -288,6 +373,16 @@ Status EnclaveManager::LoadEnclave(const EnclaveLoadConfig &load_config) {
       SgxLoadConfig::ForkConfig fork_config = sgx_config.fork_config();
       base_address = reinterpret_cast<void *>(fork_config.base_address());
     }
+    // Assign NUMA nodes round-robin to enclaves asking to be spread across
+    // nodes without choosing one.
+    const auto &affinity_config = sgx_config.cpu_affinity_config();
+    if (affinity_config.spread_across_numa_nodes() &&
+        affinity_config.cpus_size() == 0 && affinity_config.numa_node() < 0) {
+      sgx_config.mutable_cpu_affinity_config()->set_numa_node(
+          numa_node_assignments_.fetch_add(1, std::memory_order_relaxed) %
+          primitives::CpuAffinity::NumNumaNodes());
+      *placed_load_config.MutableExtension(sgx_load_config) = sgx_config;
+    }
   }
 
   std::string name = load_config.name();
@@ -297,24 +392,36 @@ Status EnclaveManager::LoadEnclave(const EnclaveLoadConfig &load_config) {
     // that points to the enclave in the parent process.
     RemoveEnclaveReference(name);
   }
-  // Check whether a client with this name already exists.
-  {
-    absl::ReaderMutexLock lock(&client_table_lock_);
-    if (client_by_name_.find(name) != client_by_name_.end()) {
-      Status status(error::GoogleError::ALREADY_EXISTS,
-                    absl::StrCat("Name already exists: ", name));
-      LOG(ERROR) << "LoadEnclave failed: " << status;
+  // Reserve the name so that no other enclave is bound to it while this one
+  // is loaded.
+  ASYLO_RETURN_IF_ERROR(ReserveName(name));
+  uint64_t footprint = 0;
+  if (load_config.has_footprint()) {
+    footprint = FootprintBytes(load_config.footprint());
+    Status status = AdmitEnclave(footprint, fill_pool);
+    if (!status.ok()) {
+      ReleaseName(name);
       return status;
     }
   }
-  std::shared_ptr<primitives::Client> primitive_client;
-  ASYLO_ASSIGN_OR_RETURN(primitive_client,
-                         asylo::primitives::LoadEnclave(load_config));
+  EnclaveStartupProfile startup_profile;
+  startup_profile.set_enclave_name(name);
+  int64_t phase_start = MonotonicClock();
+  StatusOr<std::shared_ptr<primitives::Client>> primitive_client =
+      asylo::primitives::LoadEnclave(placed_load_config);
+  AddStartupPhase("backend_load", phase_start, &startup_profile);
+  if (!primitive_client.ok()) {
+    ReleaseName(name);
+    ReleaseFootprint(footprint);
+    return primitive_client.status();
+  }
 
   StatusOr<std::unique_ptr<EnclaveClient>> result =
-      GenericEnclaveClient::Create(name, primitive_client);
+      GenericEnclaveClient::Create(name, primitive_client.ValueOrDie());
   if (!result.ok()) {
     LOG(ERROR) << "LoadEnclave failed: " << result.status();
+    ReleaseName(name);
+    ReleaseFootprint(footprint);
     return result.status();
   }
 
@@ -322,15 +429,36 @@ Status EnclaveManager::LoadEnclave(const EnclaveLoadConfig &load_config) {
   EnclaveClient *client = result.ValueOrDie().get();
   {
     absl::WriterMutexLock lock(&client_table_lock_);
+    loading_names_.erase(name);
     client_by_name_.emplace(name, std::move(result).ValueOrDie());
-    name_by_client_.emplace(client, name);
+    client_registry_.Insert(name, client);
 
     if (config.enable_fork()) {
-      load_config_by_client_.emplace(client, load_config);
+      load_config_by_client_.emplace(client, placed_load_config);
     }
   }
 
-  Status status = client->EnterAndInitialize(config);
+  phase_start = MonotonicClock();
+  Status status;
+  if (!serialized_config) {
+    status = client->EnterAndInitialize(config);
+  } else if (!serialized_config->empty() ||
+             config.SerializeToString(serialized_config)) {
+    status = client->EnterAndInitializeSerialized(*serialized_config);
+  } else {
+    serialized_config->clear();
+    status = Status(error::GoogleError::INVALID_ARGUMENT,
+                    "Failed to serialize EnclaveConfig");
+  }
+  EnclaveStartupPhase *initialize_phase =
+      AddStartupPhase("initialize", phase_start, &startup_profile);
+  if (status.ok() && load_config.has_checkpoint_path()) {
+    phase_start = MonotonicClock();
+    status = RestoreEnclaveCheckpoint(
+        static_cast<GenericEnclaveClient *>(client),
+        load_config.checkpoint_path());
+    AddStartupPhase("restore_checkpoint", phase_start, &startup_profile);
+  }
   // If initialization fails, don't keep the enclave registered. GetClient will
   // return a nullptr rather than an enclave in a bad state.
   if (!status.ok()) {
@@ -341,19 +469,433 @@ Status EnclaveManager::LoadEnclave(const EnclaveLoadConfig &load_config) {
     }
     {
       absl::WriterMutexLock lock(&client_table_lock_);
+      client_registry_.Erase(client);
       client_by_name_.erase(name);
-      name_by_client_.erase(client);
       load_config_by_client_.erase(client);
     }
+    ReleaseFootprint(footprint);
+    return status;
+  }
+
+  *initialize_phase->mutable_phases() =
+      static_cast<GenericEnclaveClient *>(client)
+          ->trusted_startup_profile()
+          .phases();
+  startup_profile.set_total_duration_ns(MonotonicClock() - load_start);
+  {
+    absl::WriterMutexLock lock(&client_table_lock_);
+    startup_profile_by_client_[client] = std::move(startup_profile);
+  }
+  if (footprint > 0) {
+    absl::MutexLock lock(&epc_lock_);
+    footprint_by_client_.emplace(client, footprint);
+  }
+  return status;
+}
+
+std::vector<Status> EnclaveManager::LoadEnclaves(
+    const std::vector<EnclaveLoadConfig> &load_configs) {
+  std::vector<Status> statuses;
+  if (load_configs.empty()) {
+    return statuses;
+  }
+  ThreadPool pool(std::min(static_cast<int>(load_configs.size()),
+                           kMaxConcurrentEnclaveLoads));
+  std::vector<std::future<Status>> pending;
+  pending.reserve(load_configs.size());
+  for (size_t i = 0; i < load_configs.size(); i++) {
+    pending.push_back(pool.Submit(
+        [this, &load_configs, i] { return LoadEnclave(load_configs[i]); }));
+  }
+  statuses.reserve(load_configs.size());
+  for (auto &status : pending) {
+    statuses.push_back(status.get());
+  }
+  return statuses;
+}
+
+Status EnclaveManager::CreateEnclavePool(const EnclaveLoadConfig &load_config,
+                                         int pool_size) {
+  if (load_config.name().empty()) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "An enclave pool must have a name");
+  }
+  if (load_config.has_pool_name()) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Pooled enclaves cannot be taken from another pool");
+  }
+  if (pool_size <= 0) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Enclave pool size must be positive");
+  }
+
+  absl::MutexLock lock(&pool_table_lock_);
+  if (pool_by_name_.contains(load_config.name())) {
+    return Status(
+        error::GoogleError::ALREADY_EXISTS,
+        absl::StrCat("Enclave pool already exists: ", load_config.name()));
+  }
+  auto pool = absl::make_unique<EnclavePool>();
+  pool->load_config = load_config;
+  pool->size = pool_size;
+  EnclavePool *pool_ptr = pool.get();
+  pool->filler = std::thread(&EnclaveManager::FillEnclavePool, this, pool_ptr);
+  pool_by_name_.emplace(load_config.name(), std::move(pool));
+  return Status::OkStatus();
+}
+
+Status EnclaveManager::DestroyEnclavePool(absl::string_view pool_name) {
+  std::unique_ptr<EnclavePool> pool;
+  {
+    absl::MutexLock lock(&pool_table_lock_);
+    auto it = pool_by_name_.find(pool_name);
+    if (it == pool_by_name_.end()) {
+      return Status(error::GoogleError::NOT_FOUND,
+                    absl::StrCat("No enclave pool named ", pool_name));
+    }
+    pool = std::move(it->second);
+    pool_by_name_.erase(it);
+  }
+
+  {
+    absl::MutexLock lock(&pool->mu);
+    pool->stopping = true;
+  }
+  pool->filler.join();
+
+  // The filler has exited, so |pool->ready| is no longer modified.
+  Status status;
+  std::deque<std::string> ready;
+  {
+    absl::MutexLock lock(&pool->mu);
+    ready.swap(pool->ready);
+  }
+  std::vector<EnclaveClient *> clients;
+  clients.reserve(ready.size());
+  for (const std::string &name : ready) {
+    clients.push_back(GetClient(name));
+  }
+  std::vector<Status> statuses = DestroyEnclaves(clients, EnclaveFinal());
+  for (const Status &destroy_status : statuses) {
+    if (status.ok()) {
+      status = destroy_status;
+    }
   }
   return status;
 }
 
+void EnclaveManager::FillEnclavePool(EnclavePool *pool) {
+  auto needs_enclave = [pool]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(pool->mu) {
+    return pool->stopping ||
+           (!pool->load_failed && pool->ready.size() < pool->size);
+  };
+
+  // Every enclave in the pool is initialized with the same config, so it is
+  // serialized by the first load and reused by the rest.
+  std::string serialized_config;
+  absl::MutexLock lock(&pool->mu);
+  while (true) {
+    pool->mu.Await(absl::Condition(&needs_enclave));
+    if (pool->stopping) {
+      return;
+    }
+    EnclaveLoadConfig load_config = pool->load_config;
+    load_config.set_name(
+        absl::StrCat(pool->load_config.name(), "#", pool->next_id++));
+
+    // Enclaves are loaded without holding the pool lock so that LoadEnclave()
+    // calls taking from the pool are not blocked behind a load.
+    pool->mu.Unlock();
+    Status status = LoadEnclaveWithSerializedConfig(
+        load_config, &serialized_config, /*fill_pool=*/true);
+    pool->mu.Lock();
+
+    if (!status.ok()) {
+      LOG(ERROR) << "Failed to load an enclave into pool "
+                 << pool->load_config.name() << ": " << status;
+      pool->load_failed = true;
+    } else {
+      pool->ready.push_back(load_config.name());
+    }
+  }
+}
+
+Status EnclaveManager::LoadEnclaveFromPool(
+    const EnclaveLoadConfig &load_config) {
+  if (GetClient(load_config.name())) {
+    Status status(error::GoogleError::ALREADY_EXISTS,
+                  absl::StrCat("Name already exists: ", load_config.name()));
+    LOG(ERROR) << "LoadEnclave failed: " << status;
+    return status;
+  }
+
+  std::string pooled_name;
+  EnclaveLoadConfig pool_load_config;
+  {
+    absl::MutexLock lock(&pool_table_lock_);
+    auto it = pool_by_name_.find(load_config.pool_name());
+    if (it == pool_by_name_.end()) {
+      return Status(
+          error::GoogleError::NOT_FOUND,
+          absl::StrCat("No enclave pool named ", load_config.pool_name()));
+    }
+    EnclavePool *pool = it->second.get();
+    absl::MutexLock pool_lock(&pool->mu);
+    if (!pool->ready.empty()) {
+      pooled_name = std::move(pool->ready.front());
+      pool->ready.pop_front();
+    }
+    pool->load_failed = false;
+    pool_load_config = pool->load_config;
+  }
+
+  if (pooled_name.empty()) {
+    pool_load_config.set_name(load_config.name());
+    return LoadEnclave(pool_load_config);
+  }
+
+  // The name may have been bound since it was checked above. Do not leave the
+  // pooled enclave behind under its internal name.
+  Status status = RenameEnclave(pooled_name, load_config.name());
+  if (!status.ok()) {
+    Status destroy_status =
+        DestroyEnclave(GetClient(pooled_name), EnclaveFinal());
+    LOG_IF(ERROR, !destroy_status.ok())
+        << "Failed to destroy pooled enclave " << pooled_name << ": "
+        << destroy_status;
+  }
+  return status;
+}
+
+Status EnclaveManager::CheckpointEnclave(EnclaveClient *client,
+                                         const std::string &path) {
+  auto *generic_client = dynamic_cast<GenericEnclaveClient *>(client);
+  if (!generic_client) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Only enclaves loaded from an EnclaveLoadConfig support "
+                  "checkpoints");
+  }
+  std::string checkpoint;
+  ASYLO_RETURN_IF_ERROR(generic_client->EnterAndCheckpoint(&checkpoint));
+
+  // Write to a temporary file first, so that an enclave never restores a
+  // partially written checkpoint.
+  std::string temp_path = absl::StrCat(path, ".tmp.", getpid(), ".",
+                                       absl::ToUnixNanos(absl::Now()));
+  {
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    if (!file || !file.write(checkpoint.data(), checkpoint.size()) ||
+        !file.flush()) {
+      std::remove(temp_path.c_str());
+      return Status(error::GoogleError::INTERNAL,
+                    absl::StrCat("Failed to write checkpoint file ", temp_path));
+    }
+  }
+  if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+    Status status(static_cast<error::PosixError>(errno),
+                  absl::StrCat("Failed to write checkpoint file ", path));
+    std::remove(temp_path.c_str());
+    return status;
+  }
+  return Status::OkStatus();
+}
+
+Status EnclaveManager::RestoreEnclaveCheckpoint(GenericEnclaveClient *client,
+                                                const std::string &path) {
+  struct stat file_stat;
+  if (stat(path.c_str(), &file_stat) != 0) {
+    if (errno == ENOENT) {
+      // No checkpoint was written yet, so the enclave starts from scratch.
+      return Status::OkStatus();
+    }
+    return Status(static_cast<error::PosixError>(errno),
+                  absl::StrCat("Failed to read checkpoint file ", path));
+  }
+
+  std::string checkpoint(file_stat.st_size, '\0');
+  std::ifstream file(path, std::ios::binary);
+  if (!file || !file.read(&checkpoint[0], checkpoint.size())) {
+    return Status(error::GoogleError::INTERNAL,
+                  absl::StrCat("Failed to read checkpoint file ", path));
+  }
+  return client->EnterAndRestoreCheckpoint(checkpoint);
+}
+
+Status EnclaveManager::SetEpcBudget(const EpcBudget &budget) {
+  EpcBudget resolved_budget = budget;
+  if (resolved_budget.capacity_bytes == 0) {
+    ASYLO_ASSIGN_OR_RETURN(resolved_budget.capacity_bytes,
+                           primitives::GetEpcSize());
+  }
+  absl::MutexLock lock(&epc_lock_);
+  has_epc_budget_ = true;
+  epc_budget_ = resolved_budget;
+  return Status::OkStatus();
+}
+
+void EnclaveManager::ClearEpcBudget() {
+  absl::MutexLock lock(&epc_lock_);
+  has_epc_budget_ = false;
+}
+
+EpcUsage EnclaveManager::GetEpcUsage() const {
+  absl::MutexLock lock(&epc_lock_);
+  EpcUsage usage;
+  if (has_epc_budget_) {
+    usage.capacity_bytes = epc_budget_.capacity_bytes;
+  }
+  usage.used_bytes = epc_used_bytes_;
+  usage.num_enclaves = footprint_by_client_.size();
+  usage.num_queued = epc_num_queued_;
+  usage.num_rejected = epc_num_rejected_;
+  usage.num_evicted = epc_num_evicted_;
+  return usage;
+}
+
+Status EnclaveManager::AdmitEnclave(uint64_t footprint, bool fill_pool) {
+  auto fits = [this, footprint]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(epc_lock_) {
+    return !has_epc_budget_ ||
+           epc_used_bytes_ + footprint <= epc_budget_.capacity_bytes;
+  };
+  auto reject = [this, footprint]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(epc_lock_) {
+    epc_num_rejected_++;
+    return Status(
+        error::GoogleError::RESOURCE_EXHAUSTED,
+        absl::StrCat("Enclave footprint of ", footprint,
+                     " bytes does not fit in the EPC budget, ",
+                     epc_used_bytes_, " of ", epc_budget_.capacity_bytes,
+                     " bytes are in use"));
+  };
+
+  absl::MutexLock lock(&epc_lock_);
+  if (!fits()) {
+    // Waiting or evicting cannot make room for an enclave larger than the
+    // budget, and filling a pool must not push other enclaves out.
+    if (fill_pool || footprint > epc_budget_.capacity_bytes) {
+      return reject();
+    }
+    switch (epc_budget_.policy) {
+      case EpcAdmissionPolicy::kReject:
+        return reject();
+      case EpcAdmissionPolicy::kQueue:
+        epc_num_queued_++;
+        if (!epc_lock_.AwaitWithTimeout(absl::Condition(&fits),
+                                        epc_budget_.queue_timeout)) {
+          epc_num_rejected_++;
+          return Status(error::GoogleError::DEADLINE_EXCEEDED,
+                        "Timed out waiting for room in the EPC budget");
+        }
+        break;
+      case EpcAdmissionPolicy::kEvictIdle: {
+        uint64_t needed =
+            epc_used_bytes_ + footprint - epc_budget_.capacity_bytes;
+        // Enclaves are destroyed without holding the EPC lock, which they
+        // take to release their footprint.
+        epc_lock_.Unlock();
+        uint64_t num_evicted = EvictIdleEnclaves(needed);
+        epc_lock_.Lock();
+        epc_num_evicted_ += num_evicted;
+        if (!fits()) {
+          return reject();
+        }
+        break;
+      }
+    }
+  }
+  epc_used_bytes_ += footprint;
+  return Status::OkStatus();
+}
+
+void EnclaveManager::ReleaseFootprint(uint64_t footprint) {
+  if (footprint == 0) {
+    return;
+  }
+  absl::MutexLock lock(&epc_lock_);
+  epc_used_bytes_ -= footprint;
+}
+
+uint64_t EnclaveManager::EvictIdleEnclaves(uint64_t needed) {
+  std::vector<std::string> names;
+  uint64_t freed = 0;
+  {
+    absl::MutexLock lock(&pool_table_lock_);
+    for (auto &entry : pool_by_name_) {
+      EnclavePool *pool = entry.second.get();
+      if (freed >= needed) {
+        break;
+      }
+      if (!pool->load_config.has_footprint()) {
+        continue;
+      }
+      uint64_t footprint = FootprintBytes(pool->load_config.footprint());
+      absl::MutexLock pool_lock(&pool->mu);
+      while (freed < needed && !pool->ready.empty()) {
+        names.push_back(std::move(pool->ready.front()));
+        pool->ready.pop_front();
+        freed += footprint;
+        // Keep the filler from loading the evicted enclaves back until an
+        // enclave is taken from the pool.
+        pool->load_failed = true;
+      }
+    }
+  }
+
+  std::vector<EnclaveClient *> clients;
+  clients.reserve(names.size());
+  for (const std::string &name : names) {
+    clients.push_back(GetClient(name));
+  }
+  std::vector<Status> statuses = DestroyEnclaves(clients, EnclaveFinal());
+  for (size_t i = 0; i < names.size(); i++) {
+    LOG_IF(ERROR, !statuses[i].ok()) << "Failed to destroy evicted enclave "
+                                     << names[i] << ": " << statuses[i];
+  }
+  return names.size();
+}
+
+Status EnclaveManager::RenameEnclave(absl::string_view old_name,
+                                     absl::string_view new_name) {
+  absl::WriterMutexLock lock(&client_table_lock_);
+  if (client_by_name_.contains(new_name) || loading_names_.contains(new_name)) {
+    return Status(error::GoogleError::ALREADY_EXISTS,
+                  absl::StrCat("Name already exists: ", new_name));
+  }
+  auto it = client_by_name_.find(old_name);
+  if (it == client_by_name_.end()) {
+    return Status(error::GoogleError::NOT_FOUND,
+                  absl::StrCat("No enclave named ", old_name));
+  }
+  std::unique_ptr<EnclaveClient> client = std::move(it->second);
+  client_by_name_.erase(it);
+  client->name_ = std::string(new_name);
+  client_registry_.Rename(client.get(), new_name);
+  client_by_name_.emplace(std::string(new_name), std::move(client));
+  return Status::OkStatus();
+}
+
+Status EnclaveManager::ReserveName(absl::string_view name) {
+  absl::WriterMutexLock lock(&client_table_lock_);
+  if (client_by_name_.contains(name) ||
+      !loading_names_.emplace(name).second) {
+    Status status(error::GoogleError::ALREADY_EXISTS,
+                  absl::StrCat("Name already exists: ", name));
+    LOG(ERROR) << "LoadEnclave failed: " << status;
+    return status;
+  }
+  return Status::OkStatus();
+}
+
+void EnclaveManager::ReleaseName(absl::string_view name) {
+  absl::WriterMutexLock lock(&client_table_lock_);
+  loading_names_.erase(name);
+}
+
 void EnclaveManager::RemoveEnclaveReference(absl::string_view name) {
   absl::WriterMutexLock lock(&client_table_lock_);
   EnclaveClient *client = client_by_name_[name].get();
+  client_registry_.Erase(client);
   client_by_name_.erase(name);
-  name_by_client_.erase(client);
+  startup_profile_by_client_.erase(client);
 }
 
 primitives::Client *LoadEnclaveInChildProcess(absl::string_view enclave_name,
@@ -22,18 +22,26 @@
 // Declares the enclave client API, providing types and methods for loading,
 // accessing, and finalizing enclaves.
 
+#include <atomic>
+#include <cstdint>
+#include <deque>
 #include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "absl/types/variant.h"
 #include "asylo/enclave.pb.h"  // IWYU pragma: export
+#include "asylo/platform/core/client_registry.h"
 #include "asylo/platform/core/enclave_client.h"
 #include "asylo/platform/core/enclave_config_util.h"
+#include "asylo/platform/core/enclave_startup_profile.pb.h"
 #include "asylo/platform/core/shared_resource_manager.h"
 #include "asylo/platform/primitives/untrusted_primitives.h"
 #include "asylo/platform/primitives/util/message.h"
@@ -42,11 +50,65 @@
 
 namespace asylo {
 class EnclaveLoader;
+class GenericEnclaveClient;
 
 /// Enclave Manager configuration.
 /// \deprecated EnclaveManager no longer needs to be configured.
 class EnclaveManagerOptions {};
 
+/// How EnclaveManager handles a load whose footprint does not fit in the
+/// remaining enclave page cache (EPC) budget.
+enum class EpcAdmissionPolicy {
+  /// Fails the load with a RESOURCE_EXHAUSTED error.
+  kReject,
+
+  /// Waits for other enclaves to be destroyed, up to the queue timeout of the
+  /// budget, then fails the load with a DEADLINE_EXCEEDED error.
+  kQueue,
+
+  /// Destroys ready enclaves of enclave pools to make room, then fails the
+  /// load with a RESOURCE_EXHAUSTED error if it still does not fit.
+  kEvictIdle,
+};
+
+/// A limit on the EPC occupied by the enclaves of an EnclaveManager.
+///
+/// Enclaves whose EnclaveLoadConfig sets a `footprint` are admitted only if
+/// their footprint fits in the budget. Overcommitting the EPC makes the SGX
+/// driver page enclave memory out, which slows every enclave on the host.
+struct EpcBudget {
+  /// Bytes of EPC the enclaves may occupy. If zero, the EPC size reported by
+  /// the processor.
+  uint64_t capacity_bytes = 0;
+
+  /// What to do with a load that does not fit.
+  EpcAdmissionPolicy policy = EpcAdmissionPolicy::kReject;
+
+  /// How long a load may wait for room under EpcAdmissionPolicy::kQueue.
+  absl::Duration queue_timeout = absl::InfiniteDuration();
+};
+
+/// EPC accounting of an EnclaveManager.
+struct EpcUsage {
+  /// Capacity of the budget in bytes, or zero if no budget is set.
+  uint64_t capacity_bytes = 0;
+
+  /// Bytes occupied by the loaded enclaves that declared a footprint.
+  uint64_t used_bytes = 0;
+
+  /// Number of loaded enclaves that declared a footprint.
+  size_t num_enclaves = 0;
+
+  /// Number of loads that waited for room.
+  uint64_t num_queued = 0;
+
+  /// Number of loads that failed for lack of room.
+  uint64_t num_rejected = 0;
+
+  /// Number of pooled enclaves destroyed to make room.
+  uint64_t num_evicted = 0;
+};
+
 /// A manager object responsible for creating and managing enclave instances.
 ///
 /// EnclaveManager is a singleton class that tracks the status of enclaves
@@ -110,7 +172,47 @@ class EnclaveManager {
   ///  LoadEnclave(load_config);
   /// ```
   /// \param load_config Backend configuration options to load an enclave
-  Status LoadEnclave(const EnclaveLoadConfig &load_config);
+  Status LoadEnclave(const EnclaveLoadConfig &load_config)
+      ABSL_LOCKS_EXCLUDED(client_table_lock_);
+
+  /// Loads several enclaves concurrently.
+  ///
+  /// Each enclave is loaded as by LoadEnclave(const EnclaveLoadConfig &) on a
+  /// bounded pool of threads, so at most a fixed number of loads are in
+  /// progress at once. A failure to load one enclave does not affect the
+  /// others.
+  ///
+  /// \param load_configs Backend configuration options of the enclaves to load.
+  /// \return The status of each load, in the order of |load_configs|.
+  std::vector<Status> LoadEnclaves(
+      const std::vector<EnclaveLoadConfig> &load_configs)
+      ABSL_LOCKS_EXCLUDED(client_table_lock_);
+
+  /// Creates a pool of identical, initialized enclaves.
+  ///
+  /// Loads and initializes |pool_size| enclaves from |load_config| on a
+  /// background thread and keeps that many ready. A later call to
+  /// LoadEnclave() with `pool_name` set to `load_config.name()` binds a ready
+  /// enclave to the requested name instead of loading a new one, and the pool
+  /// loads a replacement in the background. If no enclave is ready, that call
+  /// loads one from the pool's load config in the calling thread.
+  ///
+  /// Ready enclaves are registered under internal names of the form
+  /// `<pool name>#<n>`, which is also the name passed to the enclave when it is
+  /// initialized.
+  ///
+  /// \param load_config Configuration to load the pooled enclaves with. Its
+  ///                    `name` is the name of the pool.
+  /// \param pool_size The number of enclaves to keep ready.
+  Status CreateEnclavePool(const EnclaveLoadConfig &load_config, int pool_size)
+      ABSL_LOCKS_EXCLUDED(pool_table_lock_);
+
+  /// Stops replenishing a pool and destroys its ready enclaves. Enclaves
+  /// already taken from the pool are not affected.
+  ///
+  /// \param pool_name The name of a pool created by CreateEnclavePool().
+  Status DestroyEnclavePool(absl::string_view pool_name)
+      ABSL_LOCKS_EXCLUDED(pool_table_lock_);
 
   /// Loads an enclave.
   ///
@@ -200,6 +302,25 @@ class EnclaveManager {
                         bool skip_finalize = false)
       ABSL_LOCKS_EXCLUDED(client_table_lock_);
 
+  /// Destroys several enclaves concurrently.
+  ///
+  /// Each enclave is destroyed as by DestroyEnclave() on a bounded pool of
+  /// threads, so that a slow finalizer does not delay the destruction of the
+  /// other enclaves, for instance when a process shuts down or replaces its
+  /// enclaves with a new version. Lookups of other enclaves proceed while the
+  /// enclaves are destroyed.
+  ///
+  /// \param clients Clients attached to the enclaves to destroy. Null clients
+  ///                are skipped.
+  /// \param final_input Input to pass each enclave's finalizer.
+  /// \param skip_finalize If true, the enclaves are destroyed without invoking
+  ///                      their Finalize methods.
+  /// \return The status of each destruction, in the order of |clients|.
+  std::vector<Status> DestroyEnclaves(
+      const std::vector<EnclaveClient *> &clients,
+      const EnclaveFinal &final_input, bool skip_finalize = false)
+      ABSL_LOCKS_EXCLUDED(client_table_lock_);
+
   /// Fetches the shared resource manager object.
   ///
   /// \return The SharedResourceManager instance.
@@ -214,6 +335,48 @@ class EnclaveManager {
     return &shared_resource_manager_;
   }
 
+  /// Fetches the timings of loading and initializing an enclave.
+  ///
+  /// The profile covers the backend load, the initialization entry call and,
+  /// for enclaves reporting them, the initialization phases inside the
+  /// enclave, such as logging, assertion authority and user initialization.
+  ///
+  /// \param client A client to an enclave loaded by this manager.
+  /// \return The startup profile of the enclave, or a NOT_FOUND error if no
+  ///         profile was recorded for `client`.
+  StatusOr<EnclaveStartupProfile> GetStartupProfile(
+      const EnclaveClient *client) const
+      ABSL_LOCKS_EXCLUDED(client_table_lock_);
+
+  /// Writes a checkpoint of the state of an enclave to a file.
+  ///
+  /// The TrustedApplication of the enclave saves its state, which is
+  /// encrypted under a key sealed to the MRENCLAVE of the enclave. An enclave
+  /// loaded later from an EnclaveLoadConfig whose `checkpoint_path` names the
+  /// file restores the state, even from another process. The file is replaced
+  /// atomically.
+  ///
+  /// \param client A client to an enclave loaded by this manager.
+  /// \param path The file to write the checkpoint to.
+  Status CheckpointEnclave(EnclaveClient *client, const std::string &path);
+
+  /// Limits the EPC of the enclaves loaded from now on.
+  ///
+  /// Enclaves already loaded count against the budget but are not destroyed
+  /// if they exceed it.
+  ///
+  /// \param budget The budget to enforce.
+  /// \return An UNAVAILABLE error if `budget` leaves the capacity to the
+  ///         processor and the EPC size cannot be read.
+  Status SetEpcBudget(const EpcBudget &budget) ABSL_LOCKS_EXCLUDED(epc_lock_);
+
+  /// Admits every enclave regardless of its footprint, and wakes up loads
+  /// waiting for room.
+  void ClearEpcBudget() ABSL_LOCKS_EXCLUDED(epc_lock_);
+
+  /// Returns the EPC accounting of the loaded enclaves.
+  EpcUsage GetEpcUsage() const ABSL_LOCKS_EXCLUDED(epc_lock_);
+
   /// Get the load config of an enclave. This should only be used during fork
   /// in order to load an enclave with the same load config as the parent.
   EnclaveLoadConfig GetLoadConfigFromClient(EnclaveClient *client)
@@ -235,6 +398,86 @@ class EnclaveManager {
                          const size_t enclave_size = 0)
       ABSL_LOCKS_EXCLUDED(client_table_lock_);
 
+  // A pool of initialized enclaves created by CreateEnclavePool().
+  struct EnclavePool {
+    // Load config of the pooled enclaves. Its name is the name of the pool.
+    EnclaveLoadConfig load_config;
+
+    // Number of enclaves to keep ready.
+    size_t size;
+
+    // Thread loading enclaves into the pool.
+    std::thread filler;
+
+    absl::Mutex mu;
+
+    // Registered names of the enclaves ready to be handed out.
+    std::deque<std::string> ready ABSL_GUARDED_BY(mu);
+
+    // Suffix of the registered name of the next enclave to load.
+    uint64_t next_id ABSL_GUARDED_BY(mu) = 0;
+
+    // Set when loading an enclave failed. The filler waits for the next
+    // enclave to be taken before trying again.
+    bool load_failed ABSL_GUARDED_BY(mu) = false;
+
+    // Set when the pool is destroyed.
+    bool stopping ABSL_GUARDED_BY(mu) = false;
+  };
+
+  // Loads an enclave as LoadEnclave() does. If |serialized_config| is non-null
+  // and non-empty it must hold the serialized EnclaveConfig derived from
+  // |load_config|, and it is passed to the enclave as is. If it is non-null
+  // and empty, the serialized config is stored in it for later loads with the
+  // same |load_config|. If |fill_pool|, the enclave is only admitted if its
+  // footprint fits in the EPC budget right away.
+  Status LoadEnclaveWithSerializedConfig(const EnclaveLoadConfig &load_config,
+                                         std::string *serialized_config,
+                                         bool fill_pool = false)
+      ABSL_LOCKS_EXCLUDED(client_table_lock_);
+
+  // Restores the checkpoint in the file at |path|, if it exists, into the
+  // enclave of |client|.
+  Status RestoreEnclaveCheckpoint(GenericEnclaveClient *client,
+                                  const std::string &path);
+
+  // Charges |footprint| bytes to the EPC budget, waiting for room or evicting
+  // pooled enclaves as the policy of the budget says. If |fill_pool|, fails
+  // unless the footprint fits right away.
+  Status AdmitEnclave(uint64_t footprint, bool fill_pool)
+      ABSL_LOCKS_EXCLUDED(epc_lock_, pool_table_lock_);
+
+  // Returns |footprint| bytes charged by AdmitEnclave() to the budget.
+  void ReleaseFootprint(uint64_t footprint) ABSL_LOCKS_EXCLUDED(epc_lock_);
+
+  // Destroys ready enclaves of enclave pools until at least |needed| bytes of
+  // footprint are freed or no ready enclave is left. Returns the number of
+  // enclaves destroyed.
+  uint64_t EvictIdleEnclaves(uint64_t needed)
+      ABSL_LOCKS_EXCLUDED(epc_lock_, pool_table_lock_);
+
+  // Loads enclaves into |pool| until it is stopped.
+  void FillEnclavePool(EnclavePool *pool) ABSL_LOCKS_EXCLUDED(pool->mu);
+
+  // Binds an enclave from the pool named by the `pool_name` field of
+  // |load_config| to the name in |load_config|, or loads a new one if none is
+  // ready.
+  Status LoadEnclaveFromPool(const EnclaveLoadConfig &load_config)
+      ABSL_LOCKS_EXCLUDED(pool_table_lock_, client_table_lock_);
+
+  // Binds the enclave registered as |old_name| to |new_name|.
+  Status RenameEnclave(absl::string_view old_name, absl::string_view new_name)
+      ABSL_LOCKS_EXCLUDED(client_table_lock_);
+
+  // Reserves |name| for an enclave being loaded. Returns an error if an
+  // enclave is already bound to or being loaded under |name|.
+  Status ReserveName(absl::string_view name)
+      ABSL_LOCKS_EXCLUDED(client_table_lock_);
+
+  // Releases a reservation made by ReserveName() for a load that failed.
+  void ReleaseName(absl::string_view name)
+      ABSL_LOCKS_EXCLUDED(client_table_lock_);
+
   // Deletes an enclave client reference that points to an enclave that no
   // longer exists. This should only happen during fork.
   void RemoveEnclaveReference(absl::string_view name)
@@ -249,18 +492,53 @@ class EnclaveManager {
   // Value synchronized to CLOCK_REALTIME by the worker loop.
   std::atomic<int64_t> clock_realtime_;
 
-  // A mutex guarding |client_by_name_|, |name_by_client_|, and
-  // |loader_by_client_| tables.
+  // Number of enclaves assigned a NUMA node to spread enclaves across nodes.
+  std::atomic<uint32_t> numa_node_assignments_{0};
+
+  // A mutex guarding |client_by_name_|, |load_config_by_client_|,
+  // |startup_profile_by_client_| tables, |loading_names_| and updates of
+  // |client_registry_|. It is held only to look up and update the tables,
+  // never while an enclave is loaded, initialized or destroyed.
   mutable absl::Mutex client_table_lock_;
 
+  // Names and clients of the registered enclaves, which GetClient() and
+  // GetName() read without taking |client_table_lock_|.
+  ClientRegistry client_registry_;
+
+  // Names reserved for enclaves being loaded but not yet registered.
+  absl::flat_hash_set<std::string> loading_names_
+      ABSL_GUARDED_BY(client_table_lock_);
+
   absl::flat_hash_map<std::string, std::unique_ptr<EnclaveClient>>
       client_by_name_ ABSL_GUARDED_BY(client_table_lock_);
-  absl::flat_hash_map<const EnclaveClient *, std::string> name_by_client_
-      ABSL_GUARDED_BY(client_table_lock_);
 
   absl::flat_hash_map<const EnclaveClient *, EnclaveLoadConfig>
       load_config_by_client_ ABSL_GUARDED_BY(client_table_lock_);
 
+  absl::flat_hash_map<const EnclaveClient *, EnclaveStartupProfile>
+      startup_profile_by_client_ ABSL_GUARDED_BY(client_table_lock_);
+
+  // A mutex guarding |pool_by_name_|.
+  absl::Mutex pool_table_lock_;
+
+  absl::flat_hash_map<std::string, std::unique_ptr<EnclavePool>> pool_by_name_
+      ABSL_GUARDED_BY(pool_table_lock_);
+
+  // A mutex guarding the EPC budget and accounting. Never held while an
+  // enclave is loaded or destroyed.
+  mutable absl::Mutex epc_lock_;
+
+  bool has_epc_budget_ ABSL_GUARDED_BY(epc_lock_) = false;
+  EpcBudget epc_budget_ ABSL_GUARDED_BY(epc_lock_);
+  uint64_t epc_used_bytes_ ABSL_GUARDED_BY(epc_lock_) = 0;
+  uint64_t epc_num_queued_ ABSL_GUARDED_BY(epc_lock_) = 0;
+  uint64_t epc_num_rejected_ ABSL_GUARDED_BY(epc_lock_) = 0;
+  uint64_t epc_num_evicted_ ABSL_GUARDED_BY(epc_lock_) = 0;
+
+  // Footprint charged to the budget by each enclave that declared one.
+  absl::flat_hash_map<const EnclaveClient *, uint64_t> footprint_by_client_
+      ABSL_GUARDED_BY(epc_lock_);
+
   // Mutex guarding the static state of this class.
   static absl::Mutex mu_;
 
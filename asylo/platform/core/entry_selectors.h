@@ -35,6 +35,14 @@ static constexpr uint64_t kSelectorAsyloRun = primitives::kSelectorUser + 1;
 // Enclave finalization entry point selector.
 static constexpr uint64_t kSelectorAsyloFini = primitives::kSelectorUser + 2;
 
+// Enclave checkpoint entry point selector.
+static constexpr uint64_t kSelectorAsyloCheckpoint =
+    primitives::kSelectorUser + 3;
+
+// Enclave checkpoint restoration entry point selector.
+static constexpr uint64_t kSelectorAsyloRestoreCheckpoint =
+    primitives::kSelectorUser + 4;
+
 }  // namespace asylo
 
 #endif  // ASYLO_PLATFORM_CORE_ENTRY_SELECTORS_H_
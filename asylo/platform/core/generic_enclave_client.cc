@@ -20,7 +20,10 @@
 
 #include <cstddef>
 #include <memory>
+#include <string>
 
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
 #include "absl/strings/string_view.h"
 #include "asylo/enclave.pb.h"  // IWYU pragma: export
 #include "asylo/platform/core/entry_selectors.h"
@@ -33,6 +36,38 @@
 #include "asylo/util/status_macros.h"
 
 namespace asylo {
+namespace {
+
+using google::protobuf::internal::WireFormatLite;
+
+// Returns the status carried by the serialized EnclaveOutput |output|. Only
+// the status field is decoded; all other fields, including user extensions,
+// are skipped over.
+Status ParseOutputStatus(primitives::Extent output) {
+  google::protobuf::io::CodedInputStream input(output.As<uint8_t>(),
+                                               output.size());
+  const uint32_t status_tag =
+      WireFormatLite::MakeTag(EnclaveOutput::kStatusFieldNumber,
+                              WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+  StatusProto status_proto;
+  while (uint32_t tag = input.ReadTag()) {
+    bool parsed;
+    if (tag == status_tag) {
+      parsed = WireFormatLite::ReadMessage(&input, &status_proto);
+    } else {
+      parsed = WireFormatLite::SkipField(&input, tag);
+    }
+    if (!parsed) {
+      return Status(error::GoogleError::INTERNAL,
+                    "Failed to deserialize EnclaveOutput");
+    }
+  }
+  Status status;
+  status.RestoreFrom(status_proto);
+  return status;
+}
+
+}  // namespace
 
 std::unique_ptr<GenericEnclaveClient> GenericEnclaveClient::Create(
     const absl::string_view name,
@@ -57,27 +92,20 @@ Status GenericEnclaveClient::Initialize(const char *name, size_t name_len,
 
   ASYLO_RETURN_IF_ERROR(
       primitive_client_->EnclaveCall(kSelectorAsyloInit, &in, &out));
-  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(out, 1);
+  ASYLO_RETURN_IF_TOO_FEW_READER_ARGUMENTS(out, 1);
   auto output_extent = out.next();
   *output_len = output_extent.size();
   output->reset(new char[*output_len]);
   memcpy(output->get(), output_extent.As<char>(), *output_len);
-  return Status::OkStatus();
-}
 
-Status GenericEnclaveClient::Run(const char *input, size_t input_len,
-                                 std::unique_ptr<char[]> *output,
-                                 size_t *output_len) {
-  primitives::MessageWriter in;
-  in.PushByReference(primitives::Extent{input, input_len});
-  primitives::MessageReader out;
-  ASYLO_RETURN_IF_ERROR(
-      primitive_client_->EnclaveCall(kSelectorAsyloRun, &in, &out));
-  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(out, 1);
-  auto output_extent = out.next();
-  *output_len = output_extent.size();
-  output->reset(new char[*output_len]);
-  memcpy(output->get(), output_extent.As<char>(), *output_len);
+  // Enclaves built against an older runtime do not report a startup profile.
+  if (out.hasNext()) {
+    auto profile_extent = out.next();
+    if (!trusted_startup_profile_.ParseFromArray(profile_extent.data(),
+                                                 profile_extent.size())) {
+      trusted_startup_profile_.Clear();
+    }
+  }
   return Status::OkStatus();
 }
 
@@ -89,7 +117,7 @@ Status GenericEnclaveClient::Finalize(const char *input, size_t input_len,
   primitives::MessageReader out;
   ASYLO_RETURN_IF_ERROR(
       primitive_client_->EnclaveCall(kSelectorAsyloFini, &in, &out));
-  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(out, 1);
+  ASYLO_RETURN_IF_TOO_FEW_READER_ARGUMENTS(out, 1);
   auto output_extent = out.next();
   *output_len = output_extent.size();
   output->reset(new char[*output_len]);
@@ -103,13 +131,17 @@ Status GenericEnclaveClient::EnterAndInitialize(const EnclaveConfig &config) {
     return Status(error::GoogleError::INVALID_ARGUMENT,
                   "Failed to serialize EnclaveConfig");
   }
+  return EnterAndInitializeSerialized(buf);
+}
 
+Status GenericEnclaveClient::EnterAndInitializeSerialized(
+    absl::string_view serialized_config) {
   std::unique_ptr<char[]> output;
   size_t output_len = 0;
   std::string enclave_name(get_name());
-  ASYLO_RETURN_IF_ERROR(Initialize(enclave_name.c_str(),
-                                   enclave_name.size() + 1, buf.data(),
-                                   buf.size(), &output, &output_len));
+  ASYLO_RETURN_IF_ERROR(Initialize(
+      enclave_name.c_str(), enclave_name.size() + 1, serialized_config.data(),
+      serialized_config.size(), &output, &output_len));
 
   // Enclave entry-point was successfully invoked. |output| is guaranteed to
   // have a value.
@@ -125,31 +157,50 @@ Status GenericEnclaveClient::EnterAndInitialize(const EnclaveConfig &config) {
 
 Status GenericEnclaveClient::EnterAndRun(const EnclaveInput &input,
                                          EnclaveOutput *output) {
-  std::string buf;
-  if (!input.SerializeToString(&buf)) {
+  // Threads are long-lived and the buffer keeps its capacity across calls.
+  static thread_local std::string *buf = new std::string();
+  if (!input.SerializeToString(buf)) {
     return Status(error::GoogleError::INVALID_ARGUMENT,
                   "Failed to serialize EnclaveInput");
   }
+  return EnterAndRunSerialized(*buf, output);
+}
 
-  std::unique_ptr<char[]> output_buf;
-  size_t output_len = 0;
-  ASYLO_RETURN_IF_ERROR(Run(buf.data(), buf.size(), &output_buf, &output_len));
+Status GenericEnclaveClient::EnterAndRunSerialized(
+    absl::string_view serialized_input, EnclaveOutput *output) {
+  primitives::MessageWriter in;
+  in.PushByReference(
+      primitives::Extent{serialized_input.data(), serialized_input.size()});
+  primitives::MessageReader out;
+  ASYLO_RETURN_IF_ERROR(
+      primitive_client_->EnclaveCall(kSelectorAsyloRun, &in, &out));
+  ASYLO_RETURN_IF_TOO_FEW_READER_ARGUMENTS(out, 1);
+  auto output_extent = out.next();
 
-  // Enclave entry-point was successfully invoked. |output_buf| is guaranteed to
-  // have a value.
-  EnclaveOutput local_output;
-  local_output.ParseFromArray(output_buf.get(), output_len);
+  // Enclave entry-point was successfully invoked. Parse its output in place
+  // rather than through an intermediate copy.
+  static thread_local EnclaveOutput *scratch_output = new EnclaveOutput();
+  EnclaveOutput *local_output = output ? output : scratch_output;
+  local_output->ParseFromArray(output_extent.data(), output_extent.size());
   Status status;
-  status.RestoreFrom(local_output.status());
-
-  // Set the output parameter if necessary.
-  if (output) {
-    *output = local_output;
-  }
-
+  status.RestoreFrom(local_output->status());
   return status;
 }
 
+Status GenericEnclaveClient::EnterAndRunSerialized(
+    absl::string_view serialized_input, std::string *serialized_output) {
+  primitives::MessageWriter in;
+  in.PushByReference(
+      primitives::Extent{serialized_input.data(), serialized_input.size()});
+  primitives::MessageReader out;
+  ASYLO_RETURN_IF_ERROR(
+      primitive_client_->EnclaveCall(kSelectorAsyloRun, &in, &out));
+  ASYLO_RETURN_IF_TOO_FEW_READER_ARGUMENTS(out, 1);
+  auto output_extent = out.next();
+  serialized_output->assign(output_extent.As<char>(), output_extent.size());
+  return ParseOutputStatus(output_extent);
+}
+
 Status GenericEnclaveClient::EnterAndFinalize(const EnclaveFinal &final_input) {
   std::string buf;
   if (!final_input.SerializeToString(&buf)) {
@@ -171,6 +222,26 @@ Status GenericEnclaveClient::EnterAndFinalize(const EnclaveFinal &final_input) {
   return status;
 }
 
+Status GenericEnclaveClient::EnterAndCheckpoint(std::string *checkpoint) {
+  primitives::MessageWriter in;
+  primitives::MessageReader out;
+  ASYLO_RETURN_IF_ERROR(
+      primitive_client_->EnclaveCall(kSelectorAsyloCheckpoint, &in, &out));
+  ASYLO_RETURN_IF_TOO_FEW_READER_ARGUMENTS(out, 1);
+  auto output_extent = out.next();
+  checkpoint->assign(output_extent.As<char>(), output_extent.size());
+  return Status::OkStatus();
+}
+
+Status GenericEnclaveClient::EnterAndRestoreCheckpoint(
+    absl::string_view checkpoint) {
+  primitives::MessageWriter in;
+  in.PushByReference(primitives::Extent{checkpoint.data(), checkpoint.size()});
+  primitives::MessageReader out;
+  return primitive_client_->EnclaveCall(kSelectorAsyloRestoreCheckpoint, &in,
+                                        &out);
+}
+
 Status GenericEnclaveClient::DestroyEnclave() {
   return primitive_client_->Destroy();
 }
@@ -19,8 +19,13 @@
 #ifndef ASYLO_PLATFORM_CORE_GENERIC_ENCLAVE_CLIENT_H_
 #define ASYLO_PLATFORM_CORE_GENERIC_ENCLAVE_CLIENT_H_
 
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
 #include "asylo/enclave.pb.h"  // IWYU pragma: export
 #include "asylo/platform/core/enclave_client.h"
+#include "asylo/platform/core/enclave_startup_profile.pb.h"
 #include "asylo/platform/primitives/untrusted_primitives.h"
 #include "asylo/util/status.h"  // IWYU pragma: export
 
@@ -33,12 +38,39 @@ class GenericEnclaveClient : public EnclaveClient {
       const absl::string_view name,
       const std::shared_ptr<primitives::Client> primitive_client);
 
+  // Serializes |input| into a buffer reused by the calls of the current
+  // thread.
   Status EnterAndRun(const EnclaveInput &input, EnclaveOutput *output) override;
 
+  // Parses the output of the enclave directly into |output|, or into a message
+  // reused by the calls of the current thread if |output| is null.
+  Status EnterAndRunSerialized(absl::string_view serialized_input,
+                               EnclaveOutput *output) override;
+
+  // Copies the output of the enclave to |serialized_output| as is, decoding
+  // only its status field.
+  Status EnterAndRunSerialized(absl::string_view serialized_input,
+                               std::string *serialized_output) override;
+
+  // Enters the enclave to checkpoint the state of its TrustedApplication, and
+  // stores the serialized EnclaveCheckpoint in |checkpoint|.
+  Status EnterAndCheckpoint(std::string *checkpoint);
+
+  // Enters the enclave to restore the state of its TrustedApplication from the
+  // serialized EnclaveCheckpoint |checkpoint|.
+  Status EnterAndRestoreCheckpoint(absl::string_view checkpoint);
+
   std::shared_ptr<primitives::Client> GetPrimitiveClient() const {
     return primitive_client_;
   }
 
+  // Returns the timings of the initialization phases inside the enclave, as
+  // reported by the enclave. Empty if the enclave is not initialized or does
+  // not report them.
+  const EnclaveStartupPhase &trusted_startup_profile() const {
+    return trusted_startup_profile_;
+  }
+
  protected:
   explicit GenericEnclaveClient(absl::string_view name)
       : EnclaveClient(name) {}
@@ -48,6 +80,8 @@ class GenericEnclaveClient : public EnclaveClient {
 
  private:
   Status EnterAndInitialize(const EnclaveConfig &config) override;
+  Status EnterAndInitializeSerialized(
+      absl::string_view serialized_config) override;
   Status EnterAndFinalize(const EnclaveFinal &final_input) override;
   Status DestroyEnclave() override;
 
@@ -60,14 +94,6 @@ class GenericEnclaveClient : public EnclaveClient {
                     size_t input_len, std::unique_ptr<char[]> *output,
                     size_t *output_len);
 
-  // Enters the enclave and invokes the execution entry-point. If the ecall
-  // fails, or the enclave does not return any output, returns a non-OK status.
-  // In this case, the caller cannot make any assumptions about the contents of
-  // |output|. Otherwise, |output| points to a buffer of length *|output_len|
-  // that contains output from the enclave.
-  Status Run(const char *input, size_t input_len,
-             std::unique_ptr<char[]> *output, size_t *output_len);
-
   // Enters the enclave and invokes the finalization entry-point. If the ecall
   // fails, or the enclave does not return any output, returns a non-OK status.
   // In this case, the caller cannot make any assumptions about the contents of
@@ -77,6 +103,9 @@ class GenericEnclaveClient : public EnclaveClient {
                   std::unique_ptr<char[]> *output, size_t *output_len);
 
   void ReleaseMemory() override { primitive_client_->ReleaseMemory(); }
+
+  // Timings reported by the enclave's initialization entry-point.
+  EnclaveStartupPhase trusted_startup_profile_;
 };
 
 }  // namespace asylo
@@ -24,20 +24,20 @@
 
 namespace asylo {
 
-Status SharedResourceManager::InstallResource(ResourceHandle *handle) {
+Status SharedResourceManager::InstallResource(ResourceEntry *entry) {
   mu_.AssertHeld();
-  auto it = shared_resources_.find(handle->resource_name);
+  auto it = shared_resources_.find(entry->resource_name);
   if (it != shared_resources_.end()) {
-    // If we're not able to insert the resource, destroy the handle wrapper but
+    // If we're not able to insert the resource, destroy the entry wrapper but
     // do not destroy the wrapped resource.
-    std::string name = handle->resource_name.name();
-    handle->release();
-    delete handle;
+    std::string name = entry->resource_name.name();
+    entry->release();
+    delete entry;
     return Status(error::GoogleError::ALREADY_EXISTS,
                   absl::StrCat("Cannot install resource \"", name,
                                "\": Resource already exists."));
   }
-  shared_resources_[handle->resource_name] = absl::WrapUnique(handle);
+  shared_resources_[entry->resource_name] = absl::WrapUnique(entry);
   return Status::OkStatus();
 }
 
@@ -47,11 +47,34 @@ bool SharedResourceManager::ReleaseResource(const SharedName &name) {
   if (it == shared_resources_.end()) {
     return false;
   }
-  it->second->reference_count--;
-  if (it->second->reference_count == 0) {
+  if (it->second->reference_count.fetch_sub(1, std::memory_order_acq_rel) ==
+      1) {
     shared_resources_.erase(it);
   }
   return true;
 }
 
+void SharedResourceManager::ReleaseReference(ResourceEntry *entry) {
+  // Release references other than the last one without locking. The caller
+  // holds a reference, so the entry cannot be disposed of in the meantime.
+  int count = entry->reference_count.load(std::memory_order_relaxed);
+  while (count > 1) {
+    if (entry->reference_count.compare_exchange_weak(
+            count, count - 1, std::memory_order_acq_rel,
+            std::memory_order_relaxed)) {
+      return;
+    }
+  }
+
+  // The count may still be incremented by a concurrent acquisition by name,
+  // which holds the lock, so check again once holding it.
+  absl::MutexLock lock(&mu_);
+  if (entry->reference_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    auto it = shared_resources_.find(entry->resource_name);
+    if (it != shared_resources_.end() && it->second.get() == entry) {
+      shared_resources_.erase(it);
+    }
+  }
+}
+
 }  // namespace asylo
@@ -19,7 +19,9 @@
 #ifndef ASYLO_PLATFORM_CORE_SHARED_RESOURCE_MANAGER_H_
 #define ASYLO_PLATFORM_CORE_SHARED_RESOURCE_MANAGER_H_
 
+#include <atomic>
 #include <memory>
+#include <utility>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/synchronization/mutex.h"
@@ -33,7 +35,86 @@ namespace asylo {
 /// A manager object responsible for reference-counted untrusted resources which
 /// are shared between trusted and untrusted code.
 class SharedResourceManager {
+ private:
+  struct ResourceEntry;
+
  public:
+  /// A reference to an acquired resource.
+  ///
+  /// A handle holds one reference to a resource, which it releases when it is
+  /// destroyed. The resource is resolved by name once, when the handle is
+  /// acquired, so that callers can cache the handle and access the resource
+  /// without locking or looking it up again. Copying a handle acquires another
+  /// reference with an atomic increment, and destroying it releases the
+  /// reference with an atomic decrement, only taking the lock of the manager
+  /// to dispose of the resource once it is no longer referenced. A handle must
+  /// not outlive the SharedResourceManager it was acquired from.
+  template <typename T>
+  class ResourceHandle {
+   public:
+    /// Constructs a handle referencing no resource.
+    ResourceHandle() : manager_(nullptr), entry_(nullptr), resource_(nullptr) {}
+
+    ResourceHandle(const ResourceHandle &other)
+        : manager_(other.manager_),
+          entry_(other.entry_),
+          resource_(other.resource_) {
+      if (entry_) {
+        entry_->reference_count.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    ResourceHandle(ResourceHandle &&other) noexcept
+        : manager_(other.manager_),
+          entry_(other.entry_),
+          resource_(other.resource_) {
+      other.manager_ = nullptr;
+      other.entry_ = nullptr;
+      other.resource_ = nullptr;
+    }
+
+    ResourceHandle &operator=(ResourceHandle other) noexcept {
+      std::swap(manager_, other.manager_);
+      std::swap(entry_, other.entry_);
+      std::swap(resource_, other.resource_);
+      return *this;
+    }
+
+    ~ResourceHandle() { reset(); }
+
+    /// Releases the referenced resource, if any.
+    void reset() {
+      if (entry_) {
+        manager_->ReleaseReference(entry_);
+      }
+      manager_ = nullptr;
+      entry_ = nullptr;
+      resource_ = nullptr;
+    }
+
+    /// Returns the referenced resource, or nullptr if the handle references no
+    /// resource.
+    T *get() const { return resource_; }
+
+    T &operator*() const { return *resource_; }
+    T *operator->() const { return resource_; }
+
+    /// Returns true if the handle references a resource.
+    explicit operator bool() const { return entry_ != nullptr; }
+
+   private:
+    friend class SharedResourceManager;
+
+    ResourceHandle(SharedResourceManager *manager, ResourceEntry *entry)
+        : manager_(manager),
+          entry_(entry),
+          resource_(static_cast<T *>(entry->get())) {}
+
+    SharedResourceManager *manager_;
+    ResourceEntry *entry_;
+    T *resource_;
+  };
+
   /// Registers a shared resource and passes ownership to the
   /// SharedResourceManager.
   ///
@@ -86,10 +167,26 @@ class SharedResourceManager {
     if (it == shared_resources_.end()) {
       return nullptr;
     }
-    it->second->reference_count++;
+    it->second->reference_count.fetch_add(1, std::memory_order_relaxed);
     return static_cast<T *>(it->second->get());
   }
 
+  /// Acquires a handle to a named resource.
+  ///
+  /// Acquires a named resource as AcquireResource does, and returns a handle
+  /// holding the acquired reference. Returns a handle referencing no resource
+  /// if the named resource does not exist.
+  template <typename T>
+  ResourceHandle<T> AcquireResourceHandle(const SharedName &name) {
+    absl::MutexLock lock(&mu_);
+    auto it = shared_resources_.find(name);
+    if (it == shared_resources_.end()) {
+      return ResourceHandle<T>();
+    }
+    it->second->reference_count.fetch_add(1, std::memory_order_relaxed);
+    return ResourceHandle<T>(this, it->second.get());
+  }
+
   /// Releases a named resource.
   ///
   /// Releases a named resource by decrementing its reference count. Removes it
@@ -99,30 +196,34 @@ class SharedResourceManager {
   bool ReleaseResource(const SharedName &name);
 
  private:
-  // Implements a handle wrapping a pointer to a shared resource. This is
+  // Implements an entry wrapping a pointer to a shared resource. This is
   // provided to allow different resource types to implement their own cleanup
   // strategy via an appropriate virtual destructor implementation.
-  struct ResourceHandle {
-    ResourceHandle(const SharedName &name)
+  struct ResourceEntry {
+    ResourceEntry(const SharedName &name)
         : resource_name(name), reference_count(1) {}
-    virtual ~ResourceHandle() = default;
+    virtual ~ResourceEntry() = default;
 
     // Fetches a raw pointer to the managed resource.
     virtual void *get() = 0;
 
     // Releases the resource from the wrapper. After this call, the lifetime of
-    // the resource if no longer managed by the ResourceHandle.
+    // the resource if no longer managed by the ResourceEntry.
     virtual void release() = 0;
 
     SharedName resource_name;
-    int reference_count;
+
+    // Only modified without holding |mu_| when copying a ResourceHandle or
+    // releasing a reference other than the last one, so that the count never
+    // drops to zero without holding |mu_|.
+    std::atomic<int> reference_count;
   };
 
   // A resource owned by the EnclaveManager.
   template <typename T, typename Deleter>
-  struct ManagedResource : public ResourceHandle {
+  struct ManagedResource : public ResourceEntry {
     ManagedResource(const SharedName &name, T *pointer)
-        : ResourceHandle(name), resource(pointer) {}
+        : ResourceEntry(name), resource(pointer) {}
     void *get() override { return static_cast<void *>(resource.get()); }
     void release() override { resource.release(); }
     std::unique_ptr<T, Deleter> resource;
@@ -130,21 +231,26 @@ class SharedResourceManager {
 
   // A handle for a resource that is not owned by the EnclaveManager.
   template <typename T>
-  struct UnmanagedResource : public ResourceHandle {
+  struct UnmanagedResource : public ResourceEntry {
     UnmanagedResource(const SharedName &name, T *pointer)
-        : ResourceHandle(name), resource(pointer) {}
+        : ResourceEntry(name), resource(pointer) {}
     void *get() override { return static_cast<void *>(resource); }
     void release() override {}
     T *resource;
   };
 
   // Installs a entry into shared_resources_. Returns failure and deletes the
-  // passed resource handle if the provided name is already in use.
-  Status InstallResource(ResourceHandle *handle)
+  // passed resource entry if the provided name is already in use.
+  Status InstallResource(ResourceEntry *entry)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
+  // Releases a reference to |entry| held by a ResourceHandle, and removes the
+  // entry from the resource table if it is no longer referenced. Only takes
+  // |mu_| to release the last reference.
+  void ReleaseReference(ResourceEntry *entry) ABSL_LOCKS_EXCLUDED(mu_);
+
   absl::Mutex mu_;
-  absl::flat_hash_map<SharedName, std::unique_ptr<ResourceHandle>,
+  absl::flat_hash_map<SharedName, std::unique_ptr<ResourceEntry>,
                       SharedName::Hash, SharedName::Eq>
       shared_resources_;
 };
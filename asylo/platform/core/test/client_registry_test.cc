@@ -0,0 +1,130 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/core/client_registry.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "asylo/platform/core/enclave_client.h"
+
+namespace asylo {
+namespace {
+
+// An enclave client which is only compared by address.
+class FakeClient : public EnclaveClient {
+ public:
+  FakeClient() : EnclaveClient("fake") {}
+
+  Status EnterAndRun(const EnclaveInput &input,
+                     EnclaveOutput *output) override {
+    return Status::OkStatus();
+  }
+
+ private:
+  Status EnterAndInitialize(const EnclaveConfig &config) override {
+    return Status::OkStatus();
+  }
+  Status EnterAndFinalize(const EnclaveFinal &final_input) override {
+    return Status::OkStatus();
+  }
+  Status DestroyEnclave() override { return Status::OkStatus(); }
+};
+
+TEST(ClientRegistryTest, FindsClientsByNameAndNamesByClient) {
+  ClientRegistry registry;
+  FakeClient first;
+  FakeClient second;
+  registry.Insert("first", &first);
+  registry.Insert("second", &second);
+
+  EXPECT_EQ(registry.Find("first"), &first);
+  EXPECT_EQ(registry.Find("second"), &second);
+  EXPECT_EQ(registry.Find("third"), nullptr);
+  EXPECT_EQ(registry.FindName(&first), "first");
+  EXPECT_EQ(registry.FindName(&second), "second");
+
+  registry.Erase(&first);
+  EXPECT_EQ(registry.Find("first"), nullptr);
+  EXPECT_EQ(registry.FindName(&first), "");
+  EXPECT_EQ(registry.Find("second"), &second);
+}
+
+TEST(ClientRegistryTest, RenamesClients) {
+  ClientRegistry registry;
+  FakeClient client;
+  registry.Insert("old", &client);
+  registry.Rename(&client, "new");
+
+  EXPECT_EQ(registry.Find("old"), nullptr);
+  EXPECT_EQ(registry.Find("new"), &client);
+  EXPECT_EQ(registry.FindName(&client), "new");
+}
+
+TEST(ClientRegistryTest, NamesOutliveUnrelatedUpdates) {
+  ClientRegistry registry;
+  FakeClient client;
+  FakeClient other;
+  registry.Insert("client", &client);
+  absl::string_view name = registry.FindName(&client);
+  for (int i = 0; i < 100; i++) {
+    registry.Insert(absl::StrCat("other", i), &other);
+  }
+  EXPECT_EQ(name, "client");
+}
+
+// Ensure lookups of a stable entry keep succeeding while other entries are
+// updated concurrently.
+TEST(ClientRegistryTest, LookupsProceedDuringUpdates) {
+  constexpr int kNumReaders = 4;
+  constexpr int kNumUpdates = 1000;
+  ClientRegistry registry;
+  FakeClient stable;
+  FakeClient churning;
+  registry.Insert("stable", &stable);
+
+  std::atomic<bool> done(false);
+  std::atomic<int> failures(0);
+  std::vector<std::thread> readers;
+  for (int i = 0; i < kNumReaders; i++) {
+    readers.emplace_back([&registry, &stable, &done, &failures] {
+      while (!done.load(std::memory_order_relaxed)) {
+        if (registry.Find("stable") != &stable ||
+            registry.FindName(&stable) != "stable") {
+          failures.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+    });
+  }
+  for (int i = 0; i < kNumUpdates; i++) {
+    registry.Insert(absl::StrCat("churning", i), &churning);
+    registry.Erase(&churning);
+  }
+  done.store(true, std::memory_order_relaxed);
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(failures.load(), 0);
+}
+
+}  // namespace
+}  // namespace asylo
@@ -16,13 +16,27 @@
  *
  */
 
+#include <cstdio>
 #include <string>
+#include <vector>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include "absl/flags/flag.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "asylo/enclave.pb.h"
+#include "asylo/enclave_manager.h"
+#include "asylo/platform/core/enclave_startup_profile.pb.h"
 #include "asylo/platform/core/test/proto_test.pb.h"
+#include "asylo/platform/primitives/sgx/loader.pb.h"
 #include "asylo/test/util/enclave_test.h"
 #include "asylo/test/util/status_matchers.h"
+#include "asylo/test/util/test_flags.h"
+#include "asylo/util/status_macros.h"
+#include "asylo/util/statusor.h"
 
 namespace asylo {
 namespace {
@@ -32,7 +46,75 @@ namespace {
 // compares the transferred fields to the expected example values. Finally, the
 // |output| protobuf is populated with example data inside the enclave, and then
 // validated outside the enclave in the test driver.
-class ClientApiTest : public EnclaveTest {};
+class ClientApiTest : public EnclaveTest {
+ protected:
+  // Returns a load config for another instance of the test enclave.
+  EnclaveLoadConfig TestEnclaveLoadConfig(absl::string_view name) {
+    EnclaveLoadConfig load_config;
+    load_config.set_name(name.data(), name.size());
+    *load_config.mutable_config() = config_;
+    SgxLoadConfig *sgx_config = load_config.MutableExtension(sgx_load_config);
+    sgx_config->mutable_file_enclave_config()->set_enclave_path(
+        absl::GetFlag(FLAGS_enclave_path));
+    sgx_config->set_debug(true);
+    return load_config;
+  }
+
+  // Returns a load config for an instance of the test enclave that declares
+  // a footprint of 2 MiB.
+  EnclaveLoadConfig FootprintLoadConfig(absl::string_view name) {
+    EnclaveLoadConfig load_config = TestEnclaveLoadConfig(name);
+    load_config.mutable_footprint()->set_heap_size(kFootprintBytes);
+    return load_config;
+  }
+
+  static constexpr uint64_t kFootprintBytes = 2 << 20;
+
+  // Enters |client| with the fields the test enclave validates, replacing its
+  // checkpoint state with |new_state| if it is not empty. Returns the output
+  // of the enclave.
+  static StatusOr<EnclaveApiTest> Enter(EnclaveClient *client,
+                                        absl::string_view new_state) {
+    EnclaveInput enclave_input;
+    EnclaveApiTest *input_test =
+        enclave_input.MutableExtension(enclave_api_test_input);
+    input_test->set_test_string("test string");
+    input_test->set_test_int(1);
+    input_test->add_test_repeated("test repeated 1");
+    input_test->add_test_repeated("test repeated 2");
+    if (!new_state.empty()) {
+      input_test->set_checkpoint_state(new_state.data(), new_state.size());
+    }
+    EnclaveOutput enclave_output;
+    ASYLO_RETURN_IF_ERROR(client->EnterAndRun(enclave_input, &enclave_output));
+    return enclave_output.GetExtension(enclave_api_test_output);
+  }
+
+  // Like Enter(), but returns the checkpoint state the enclave reports.
+  static StatusOr<std::string> EnterWithState(EnclaveClient *client,
+                                              absl::string_view new_state) {
+    EnclaveApiTest output;
+    ASYLO_ASSIGN_OR_RETURN(output, Enter(client, new_state));
+    return output.checkpoint_state();
+  }
+
+  // Returns the version of the checkpoint |client| was restored from.
+  static StatusOr<uint64_t> RestoredVersion(EnclaveClient *client) {
+    EnclaveApiTest output;
+    ASYLO_ASSIGN_OR_RETURN(output, Enter(client, ""));
+    return output.checkpoint_version();
+  }
+
+  // A budget with room for one enclave of FootprintLoadConfig().
+  static EpcBudget OneEnclaveBudget(EpcAdmissionPolicy policy) {
+    EpcBudget budget;
+    budget.capacity_bytes = 3 << 20;
+    budget.policy = policy;
+    return budget;
+  }
+};
+
+constexpr uint64_t ClientApiTest::kFootprintBytes;
 
 TEST_F(ClientApiTest, InputOutputTest) {
   EnclaveInput enclave_input;
@@ -58,5 +140,268 @@ TEST_F(ClientApiTest, InputOutputTest) {
   EXPECT_EQ(output_test.test_repeated(1), "output repeated 2");
 }
 
+TEST_F(ClientApiTest, SerializedInputTest) {
+  EnclaveInput enclave_input;
+  EnclaveApiTest *input_test =
+      enclave_input.MutableExtension(enclave_api_test_input);
+  input_test->set_test_string("test string");
+  input_test->set_test_int(1);
+  input_test->add_test_repeated("test repeated 1");
+  input_test->add_test_repeated("test repeated 2");
+  std::string serialized_input;
+  ASSERT_TRUE(enclave_input.SerializeToString(&serialized_input));
+
+  // Reusing the output message must not accumulate the outputs of earlier
+  // calls.
+  EnclaveOutput enclave_output;
+  for (int i = 0; i < 3; i++) {
+    EXPECT_THAT(
+        client_->EnterAndRunSerialized(serialized_input, &enclave_output),
+        IsOk());
+    ASSERT_TRUE(enclave_output.HasExtension(enclave_api_test_output));
+    const EnclaveApiTest &output_test =
+        enclave_output.GetExtension(enclave_api_test_output);
+    EXPECT_EQ(output_test.test_string(), "output string");
+    EXPECT_EQ(output_test.test_repeated_size(), 2);
+  }
+  EnclaveOutput *no_output = nullptr;
+  EXPECT_THAT(client_->EnterAndRunSerialized(serialized_input, no_output),
+              IsOk());
+  EXPECT_THAT(client_->EnterAndRunSerialized("\xff", no_output),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+TEST_F(ClientApiTest, StartupProfile) {
+  EnclaveManager *manager = EnclaveManager::Instance().ValueOrDie();
+  auto profile_result = manager->GetStartupProfile(client_);
+  ASSERT_THAT(profile_result, IsOk());
+  const EnclaveStartupProfile &profile = profile_result.ValueOrDie();
+
+  EXPECT_EQ(profile.enclave_name(), client_->get_name());
+  ASSERT_EQ(profile.phases_size(), 2);
+  EXPECT_EQ(profile.phases(0).name(), "backend_load");
+  EXPECT_EQ(profile.phases(1).name(), "initialize");
+  EXPECT_GE(profile.total_duration_ns(),
+            profile.phases(0).duration_ns() + profile.phases(1).duration_ns());
+
+  // The enclave reports its own initialization phases.
+  ASSERT_EQ(profile.phases(1).phases_size(), 1);
+  const EnclaveStartupPhase &trusted_phase = profile.phases(1).phases(0);
+  EXPECT_EQ(trusted_phase.name(), "trusted_initialize");
+  ASSERT_GT(trusted_phase.phases_size(), 0);
+  EXPECT_EQ(trusted_phase.phases(trusted_phase.phases_size() - 1).name(),
+            "user_initialize");
+}
+
+TEST_F(ClientApiTest, EnclavePool) {
+  EnclaveManager *manager = EnclaveManager::Instance().ValueOrDie();
+
+  EnclaveLoadConfig pool_config =
+      TestEnclaveLoadConfig("enclave_api_test_pool");
+  ASSERT_THAT(manager->CreateEnclavePool(pool_config, /*pool_size=*/1),
+              IsOk());
+  EXPECT_THAT(manager->CreateEnclavePool(pool_config, /*pool_size=*/1),
+              StatusIs(error::GoogleError::ALREADY_EXISTS));
+
+  // Take more enclaves than the pool holds, so that at least one of them is
+  // loaded in the calling thread.
+  for (int i = 0; i < 3; i++) {
+    EnclaveLoadConfig load_config;
+    load_config.set_name(absl::StrCat("pooled_enclave_", i));
+    load_config.set_pool_name(pool_config.name());
+    ASSERT_THAT(manager->LoadEnclave(load_config), IsOk());
+
+    EnclaveClient *client = manager->GetClient(load_config.name());
+    ASSERT_NE(client, nullptr);
+    EXPECT_EQ(client->get_name(), load_config.name());
+    EXPECT_EQ(manager->GetName(client), load_config.name());
+
+    EnclaveInput enclave_input;
+    EnclaveApiTest *input_test =
+        enclave_input.MutableExtension(enclave_api_test_input);
+    input_test->set_test_string("test string");
+    input_test->set_test_int(1);
+    input_test->add_test_repeated("test repeated 1");
+    input_test->add_test_repeated("test repeated 2");
+    EnclaveOutput enclave_output;
+    EXPECT_THAT(client->EnterAndRun(enclave_input, &enclave_output), IsOk());
+    EXPECT_THAT(manager->DestroyEnclave(client, EnclaveFinal()), IsOk());
+  }
+
+  EXPECT_THAT(manager->DestroyEnclavePool(pool_config.name()), IsOk());
+  EXPECT_THAT(manager->DestroyEnclavePool(pool_config.name()),
+              StatusIs(error::GoogleError::NOT_FOUND));
+
+  EnclaveLoadConfig load_config;
+  load_config.set_name("unpooled_enclave");
+  load_config.set_pool_name(pool_config.name());
+  EXPECT_THAT(manager->LoadEnclave(load_config),
+              StatusIs(error::GoogleError::NOT_FOUND));
+}
+
+TEST_F(ClientApiTest, LoadEnclaves) {
+  EnclaveManager *manager = EnclaveManager::Instance().ValueOrDie();
+
+  // The last two configs share a name, so exactly one of them loads.
+  std::vector<EnclaveLoadConfig> load_configs = {
+      TestEnclaveLoadConfig("parallel_enclave_0"),
+      TestEnclaveLoadConfig("parallel_enclave_1"),
+      TestEnclaveLoadConfig("parallel_enclave_2"),
+      TestEnclaveLoadConfig("parallel_enclave_2")};
+  std::vector<Status> statuses = manager->LoadEnclaves(load_configs);
+  ASSERT_EQ(statuses.size(), load_configs.size());
+  EXPECT_THAT(statuses[0], IsOk());
+  EXPECT_THAT(statuses[1], IsOk());
+  EXPECT_NE(statuses[2].ok(), statuses[3].ok());
+
+  for (int i = 0; i < 3; i++) {
+    EnclaveClient *client =
+        manager->GetClient(absl::StrCat("parallel_enclave_", i));
+    ASSERT_NE(client, nullptr);
+    EXPECT_THAT(manager->DestroyEnclave(client, EnclaveFinal()), IsOk());
+  }
+}
+
+TEST_F(ClientApiTest, EpcBudgetRejectsEnclavesThatDoNotFit) {
+  EnclaveManager *manager = EnclaveManager::Instance().ValueOrDie();
+  ASSERT_THAT(manager->SetEpcBudget(
+                  OneEnclaveBudget(EpcAdmissionPolicy::kReject)),
+              IsOk());
+  EpcUsage before = manager->GetEpcUsage();
+
+  ASSERT_THAT(manager->LoadEnclave(FootprintLoadConfig("epc_enclave_0")),
+              IsOk());
+  EXPECT_EQ(manager->GetEpcUsage().used_bytes,
+            before.used_bytes + kFootprintBytes);
+  EXPECT_THAT(manager->LoadEnclave(FootprintLoadConfig("epc_enclave_1")),
+              StatusIs(error::GoogleError::RESOURCE_EXHAUSTED));
+  EXPECT_EQ(manager->GetClient("epc_enclave_1"), nullptr);
+
+  // Enclaves without a footprint are admitted regardless of the budget.
+  EXPECT_THAT(manager->LoadEnclave(TestEnclaveLoadConfig("epc_enclave_2")),
+              IsOk());
+
+  EpcUsage after = manager->GetEpcUsage();
+  EXPECT_EQ(after.capacity_bytes, 3 << 20);
+  EXPECT_EQ(after.num_enclaves, before.num_enclaves + 1);
+  EXPECT_EQ(after.num_rejected, before.num_rejected + 1);
+
+  for (const char *name : {"epc_enclave_0", "epc_enclave_2"}) {
+    EXPECT_THAT(manager->DestroyEnclave(manager->GetClient(name),
+                                        EnclaveFinal()),
+                IsOk());
+  }
+  EXPECT_EQ(manager->GetEpcUsage().used_bytes, before.used_bytes);
+  manager->ClearEpcBudget();
+}
+
+TEST_F(ClientApiTest, EpcBudgetQueueTimesOut) {
+  EnclaveManager *manager = EnclaveManager::Instance().ValueOrDie();
+  EpcBudget budget = OneEnclaveBudget(EpcAdmissionPolicy::kQueue);
+  budget.queue_timeout = absl::Milliseconds(100);
+  ASSERT_THAT(manager->SetEpcBudget(budget), IsOk());
+  EpcUsage before = manager->GetEpcUsage();
+
+  ASSERT_THAT(manager->LoadEnclave(FootprintLoadConfig("epc_enclave_0")),
+              IsOk());
+  EXPECT_THAT(manager->LoadEnclave(FootprintLoadConfig("epc_enclave_1")),
+              StatusIs(error::GoogleError::DEADLINE_EXCEEDED));
+  EXPECT_EQ(manager->GetEpcUsage().num_queued, before.num_queued + 1);
+
+  EXPECT_THAT(manager->DestroyEnclave(manager->GetClient("epc_enclave_0"),
+                                      EnclaveFinal()),
+              IsOk());
+  EXPECT_THAT(manager->LoadEnclave(FootprintLoadConfig("epc_enclave_1")),
+              IsOk());
+  EXPECT_THAT(manager->DestroyEnclave(manager->GetClient("epc_enclave_1"),
+                                      EnclaveFinal()),
+              IsOk());
+  manager->ClearEpcBudget();
+}
+
+TEST_F(ClientApiTest, EpcBudgetEvictsIdlePooledEnclaves) {
+  EnclaveManager *manager = EnclaveManager::Instance().ValueOrDie();
+  ASSERT_THAT(manager->SetEpcBudget(
+                  OneEnclaveBudget(EpcAdmissionPolicy::kEvictIdle)),
+              IsOk());
+  EpcUsage before = manager->GetEpcUsage();
+
+  EnclaveLoadConfig pool_config = FootprintLoadConfig("epc_enclave_pool");
+  ASSERT_THAT(manager->CreateEnclavePool(pool_config, /*pool_size=*/1),
+              IsOk());
+  while (manager->GetEpcUsage().num_enclaves == before.num_enclaves) {
+    absl::SleepFor(absl::Milliseconds(10));
+  }
+
+  ASSERT_THAT(manager->LoadEnclave(FootprintLoadConfig("epc_enclave_0")),
+              IsOk());
+  EpcUsage after = manager->GetEpcUsage();
+  EXPECT_EQ(after.num_evicted, before.num_evicted + 1);
+  EXPECT_EQ(after.num_enclaves, before.num_enclaves + 1);
+
+  EXPECT_THAT(manager->DestroyEnclave(manager->GetClient("epc_enclave_0"),
+                                      EnclaveFinal()),
+              IsOk());
+  EXPECT_THAT(manager->DestroyEnclavePool(pool_config.name()), IsOk());
+  manager->ClearEpcBudget();
+}
+
+TEST_F(ClientApiTest, CheckpointSurvivesReload) {
+  EnclaveManager *manager = EnclaveManager::Instance().ValueOrDie();
+  const std::string path =
+      absl::StrCat(absl::GetFlag(FLAGS_test_tmpdir), "/enclave_api_checkpoint");
+  std::remove(path.c_str());
+
+  EnclaveLoadConfig load_config = TestEnclaveLoadConfig("checkpoint_enclave");
+  load_config.set_checkpoint_path(path);
+  ASSERT_THAT(manager->LoadEnclave(load_config), IsOk());
+  EnclaveClient *client = manager->GetClient("checkpoint_enclave");
+  EXPECT_THAT(EnterWithState(client, ""), IsOkAndHolds("initial state"));
+  EXPECT_THAT(EnterWithState(client, "checkpointed state"),
+              IsOkAndHolds("checkpointed state"));
+  ASSERT_THAT(manager->CheckpointEnclave(client, path), IsOk());
+  ASSERT_THAT(manager->DestroyEnclave(client, EnclaveFinal()), IsOk());
+
+  ASSERT_THAT(manager->LoadEnclave(load_config), IsOk());
+  client = manager->GetClient("checkpoint_enclave");
+  EXPECT_THAT(EnterWithState(client, ""), IsOkAndHolds("checkpointed state"));
+  EXPECT_THAT(manager->DestroyEnclave(client, EnclaveFinal()), IsOk());
+}
+
+// Tests that an older checkpoint still restores, with its own version, so that
+// the application is the one to detect a rollback.
+TEST_F(ClientApiTest, CheckpointVersionIsRestored) {
+  EnclaveManager *manager = EnclaveManager::Instance().ValueOrDie();
+  const std::string old_path = absl::StrCat(absl::GetFlag(FLAGS_test_tmpdir),
+                                            "/enclave_api_old_checkpoint");
+  const std::string new_path = absl::StrCat(absl::GetFlag(FLAGS_test_tmpdir),
+                                            "/enclave_api_new_checkpoint");
+
+  EnclaveLoadConfig load_config =
+      TestEnclaveLoadConfig("versioned_checkpoint_enclave");
+  ASSERT_THAT(manager->LoadEnclave(load_config), IsOk());
+  EnclaveClient *client = manager->GetClient("versioned_checkpoint_enclave");
+  EXPECT_THAT(RestoredVersion(client), IsOkAndHolds(0u));
+  EXPECT_THAT(EnterWithState(client, "old state"), IsOkAndHolds("old state"));
+  ASSERT_THAT(manager->CheckpointEnclave(client, old_path), IsOk());
+  EXPECT_THAT(EnterWithState(client, "new state"), IsOkAndHolds("new state"));
+  ASSERT_THAT(manager->CheckpointEnclave(client, new_path), IsOk());
+  ASSERT_THAT(manager->DestroyEnclave(client, EnclaveFinal()), IsOk());
+
+  load_config.set_checkpoint_path(old_path);
+  ASSERT_THAT(manager->LoadEnclave(load_config), IsOk());
+  client = manager->GetClient("versioned_checkpoint_enclave");
+  EXPECT_THAT(EnterWithState(client, ""), IsOkAndHolds("old state"));
+  EXPECT_THAT(RestoredVersion(client), IsOkAndHolds(1u));
+  ASSERT_THAT(manager->DestroyEnclave(client, EnclaveFinal()), IsOk());
+
+  load_config.set_checkpoint_path(new_path);
+  ASSERT_THAT(manager->LoadEnclave(load_config), IsOk());
+  client = manager->GetClient("versioned_checkpoint_enclave");
+  EXPECT_THAT(EnterWithState(client, ""), IsOkAndHolds("new state"));
+  EXPECT_THAT(RestoredVersion(client), IsOkAndHolds(2u));
+  EXPECT_THAT(manager->DestroyEnclave(client, EnclaveFinal()), IsOk());
+}
+
 }  // namespace
 }  // namespace asylo
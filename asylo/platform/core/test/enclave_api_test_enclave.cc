@@ -46,15 +46,41 @@ class EnclaveApi : public EnclaveTestCase {
       return Status(error::GoogleError::INVALID_ARGUMENT,
                     "Field(s) of user_input doesn't match the value set");
     }
+    if (input_test.has_checkpoint_state()) {
+      checkpoint_state_ = input_test.checkpoint_state();
+    }
     EnclaveApiTest output_test;
     output_test.set_test_string("output string");
     output_test.set_test_int(1);
     output_test.add_test_repeated("output repeated 1");
     output_test.add_test_repeated("output repeated 2");
+    output_test.set_checkpoint_state(checkpoint_state_);
+    output_test.set_checkpoint_version(restored_version_);
     output->MutableExtension(enclave_api_test_output)->CopyFrom(output_test);
 
     return Status::OkStatus();
   }
+
+  Status SaveCheckpoint(std::string *state, uint64_t *version) override {
+    *state = checkpoint_state_;
+    *version = ++saved_version_;
+    return Status::OkStatus();
+  }
+
+  Status RestoreCheckpoint(const std::string &state,
+                           uint64_t version) override {
+    checkpoint_state_ = state;
+    restored_version_ = version;
+    saved_version_ = version;
+    return Status::OkStatus();
+  }
+
+ private:
+  std::string checkpoint_state_ = "initial state";
+  // Version of the last checkpoint saved or restored.
+  uint64_t saved_version_ = 0;
+  // Version of the checkpoint restored at load, if any.
+  uint64_t restored_version_ = 0;
 };
 
 TrustedApplication *BuildTrustedApplication() { return new EnclaveApi; }
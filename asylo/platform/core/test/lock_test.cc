@@ -22,6 +22,7 @@
 #include <gtest/gtest.h>
 #include "asylo/platform/core/trusted_mutex.h"
 #include "asylo/platform/core/trusted_spin_lock.h"
+#include "asylo/platform/core/trusted_ticket_lock.h"
 
 namespace asylo {
 namespace {
@@ -108,5 +109,49 @@ TYPED_TEST(LockTest, NonRecursiveManyThreadsTest) {
   EXPECT_EQ(shared_counter, 0);
 }
 
+// TrustedTicketLock hands the lock over in FIFO order, so it is exercised
+// with fewer threads than the other implementations to keep the test fast on
+// machines with fewer cores than threads.
+TEST(TicketLockTest, RecursiveTest) {
+  TrustedTicketLock lock(/*is_recursive=*/true);
+  EXPECT_FALSE(lock.Owned());
+  lock.Lock();
+  EXPECT_TRUE(lock.Owned());
+  EXPECT_TRUE(lock.LockDepthIsOne());
+  EXPECT_TRUE(lock.TryLock());
+  EXPECT_FALSE(lock.LockDepthIsOne());
+  lock.Unlock();
+  lock.Unlock();
+  EXPECT_FALSE(lock.Owned());
+  ASSERT_TRUE(lock.TryLock());
+  lock.Unlock();
+}
+
+TEST(TicketLockTest, ManyThreadsTest) {
+  constexpr int kThreads = 4;
+  TrustedTicketLock lock(/*is_recursive=*/false);
+  int shared_counter = 0;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; i++) {
+    threads.emplace_back([&]() {
+      for (int i = 0; i < 4 * 1024; i++) {
+        lock.Lock();
+        EXPECT_FALSE(lock.TryLock());
+        EXPECT_EQ(shared_counter, 0);
+        shared_counter++;
+        EXPECT_EQ(shared_counter, 1);
+        shared_counter--;
+        lock.Unlock();
+      }
+    });
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(shared_counter, 0);
+}
+
 }  // namespace
 }  // namespace asylo
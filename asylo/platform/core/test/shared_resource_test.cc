@@ -16,6 +16,9 @@
  *
  */
 
+#include <thread>
+#include <vector>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "asylo/platform/core/enclave_manager.h"
@@ -119,5 +122,50 @@ TEST(EnclaveResourcesTest, CustomDeleter) {
   EXPECT_EQ(a_string_resource, "custom cleanup strategy was invoked");
 }
 
+TEST(EnclaveResourcesTest, ResourceHandleLifeCycle) {
+  EnclaveManager::Configure(EnclaveManagerOptions());
+  SharedResourceManager *resources =
+      EnclaveManager::Instance().ValueOrDie()->shared_resources();
+
+  const SharedName name(kUnspecifiedName, "handle resource");
+  EXPECT_FALSE(resources->AcquireResourceHandle<TestResource>(name));
+
+  bool is_resource_alive;
+  auto *resource = new TestResource(&is_resource_alive);
+  resource->value = "handle resource";
+  ASSERT_TRUE(resources->RegisterManagedResource(name, resource).ok());
+
+  {
+    SharedResourceManager::ResourceHandle<TestResource> handle =
+        resources->AcquireResourceHandle<TestResource>(name);
+    ASSERT_TRUE(handle);
+    EXPECT_EQ(handle.get(), resource);
+
+    // Drop the reference taken at registration. The handle keeps the resource
+    // alive.
+    EXPECT_TRUE(resources->ReleaseResource(name));
+    EXPECT_TRUE(is_resource_alive);
+
+    // Copy and release the handle concurrently.
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; i++) {
+      threads.emplace_back([handle] {
+        for (int j = 0; j < 1000; j++) {
+          SharedResourceManager::ResourceHandle<TestResource> copy = handle;
+          EXPECT_EQ(copy->value, "handle resource");
+        }
+      });
+    }
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+    EXPECT_TRUE(is_resource_alive);
+  }
+
+  // Releasing the last handle disposes of the resource.
+  EXPECT_FALSE(is_resource_alive);
+  EXPECT_FALSE(resources->ReleaseResource(name));
+}
+
 }  // namespace
 }  // namespace asylo
@@ -19,25 +19,38 @@
 #include "asylo/platform/core/trusted_application.h"
 
 #include <sys/ucontext.h>
+#include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cerrno>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <string>
 #include <utility>
 
+#include <google/protobuf/arena.h>
 #include "absl/memory/memory.h"
+#include "asylo/crypto/util/byte_container_view.h"
 #include "asylo/util/logging.h"
 #include "asylo/identity/init.h"
 #include "asylo/platform/common/enclave_state.h"
+#include "asylo/platform/common/time_util.h"
+#include "asylo/platform/core/enclave_checkpoint.h"
+#include "asylo/platform/core/enclave_checkpoint.pb.h"
+#include "asylo/platform/core/enclave_startup_profile.pb.h"
 #include "asylo/platform/core/entry_selectors.h"
 #include "asylo/platform/core/shared_name_kind.h"
 #include "asylo/platform/core/trusted_global_state.h"
+#include "asylo/platform/posix/io/buffered_writer.h"
 #include "asylo/platform/posix/io/io_manager.h"
 #include "asylo/platform/posix/io/native_paths.h"
 #include "asylo/platform/posix/io/random_devices.h"
+#include "asylo/platform/posix/memory/arena_scope.h"
 #include "asylo/platform/posix/threading/thread_manager.h"
 #include "asylo/platform/primitives/extent.h"
 #include "asylo/platform/primitives/primitive_status.h"
@@ -47,6 +60,7 @@
 #include "asylo/platform/primitives/util/status_conversions.h"
 #include "asylo/platform/primitives/util/status_serializer.h"
 #include "asylo/util/posix_error_space.h"
+#include "asylo/util/proto_parse_util.h"
 #include "asylo/util/status.h"
 #include "asylo/util/status_macros.h"
 
@@ -58,6 +72,12 @@ using ::asylo::primitives::PrimitiveStatus;
 using ::asylo::primitives::TrustedPrimitives;
 using google::protobuf::RepeatedPtrField;
 
+#ifdef ASYLO_PROFILE_INSTRUMENTED
+// Writes the profile counters of a -fprofile-generate build. Provided by
+// libgcov.
+extern "C" void __gcov_dump();
+#endif  // ASYLO_PROFILE_INSTRUMENTED
+
 namespace asylo {
 namespace {
 
@@ -72,6 +92,38 @@ void LogError(const Status &status) {
   }
 }
 
+// Returns the value of a monotonic clock as a number of nanoseconds.
+int64_t MonotonicClock() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return TimeSpecToNanoseconds(&ts);
+}
+
+// Records the time from its construction to its destruction as a phase named
+// |name| nested in |parent|.
+class ScopedStartupPhase {
+ public:
+  ScopedStartupPhase(const char *name, EnclaveStartupPhase *parent)
+      : phase_(parent->add_phases()), start_(MonotonicClock()) {
+    phase_->set_name(name);
+  }
+
+  ~ScopedStartupPhase() { phase_->set_duration_ns(MonotonicClock() - start_); }
+
+  EnclaveStartupPhase *phase() const { return phase_; }
+
+ private:
+  EnclaveStartupPhase *phase_;
+  int64_t start_;
+};
+
+// Timings of the enclave initialization phases, reported to the host by the
+// initialization entry handler.
+EnclaveStartupPhase *GetStartupProfile() {
+  static EnclaveStartupPhase *startup_profile = new EnclaveStartupPhase();
+  return startup_profile;
+}
+
 // Validates that the address-range [|address|, |address| + |size|) is fully
 // contained in enclave trusted memory.
 PrimitiveStatus VerifyTrustedAddressRange(void *address, size_t size) {
@@ -83,6 +135,92 @@ PrimitiveStatus VerifyTrustedAddressRange(void *address, size_t size) {
   return PrimitiveStatus::OkStatus();
 }
 
+// Block size of the arena serving each Run call, or 0 if Run calls allocate
+// from the shared heap. Set before the enclave enters the running state.
+size_t run_arena_block_size = 0;
+
+// Messages and output buffer reused by the Run calls made on a thread, so that
+// a steady stream of calls does not allocate them anew for every call.
+struct RunBuffers {
+  EnclaveInput input;
+  EnclaveOutput output;
+  std::string serialized_output;
+};
+
+// Number of Run calls in progress on the calling thread that use its
+// RunBuffers messages. A Run call nested in an exit call of another one must
+// not overwrite the messages of the outer call.
+thread_local int run_buffers_depth = 0;
+
+// Returns the RunBuffers of the calling thread. Enclave threads are never
+// destroyed, so the buffers are never released.
+RunBuffers *GetRunBuffers() {
+  static thread_local RunBuffers *buffers = nullptr;
+  if (!buffers) {
+    SharedHeapScope shared_heap;
+    buffers = new RunBuffers();
+  }
+  return buffers;
+}
+
+// Parses |input| into |enclave_input|, invokes the Run entry point of the
+// application with |enclave_output| and serializes the latter to |output|.
+// The application and |output| allocate from the shared heap, even within an
+// ArenaScope. Returns 0 on success and 1 if the output cannot be serialized.
+int RunApplication(const char *input, size_t input_len,
+                   EnclaveInput *enclave_input, EnclaveOutput *enclave_output,
+                   std::string *output) {
+  enclave_output->Clear();
+  Status status;
+  if (!enclave_input->ParseFromArray(input, input_len)) {
+    status = Status(error::GoogleError::INVALID_ARGUMENT,
+                    "Failed to parse EnclaveInput");
+  } else if (GetState() != EnclaveState::kRunning) {
+    status = Status(error::GoogleError::FAILED_PRECONDITION,
+                    "Enclave not in state RUNNING");
+  } else {
+    // Invoke the enclave entry-point.
+    SharedHeapScope shared_heap;
+    status = GetApplicationInstance()->Run(*enclave_input, enclave_output);
+  }
+  status.SaveTo(enclave_output->mutable_status());
+
+  SharedHeapScope shared_heap;
+  if (!enclave_output->SerializeToString(output)) {
+    LogError(Status(error::GoogleError::INTERNAL,
+                    "Failed to serialize EnclaveOutput"));
+    return 1;
+  }
+  return 0;
+}
+
+// Runs the application on |input| and serializes its output to |output|. Uses
+// the RunBuffers messages of the calling thread unless the call runs in an
+// arena or is nested in another Run call.
+int RunEnclave(const char *input, size_t input_len, std::string *output) {
+  if (run_arena_block_size > 0) {
+    // Every allocation made by RunApplication outside of the application is
+    // released by the time it returns, so they all come from the arena.
+    ArenaScope arena(run_arena_block_size);
+    EnclaveInput enclave_input;
+    EnclaveOutput enclave_output;
+    return RunApplication(input, input_len, &enclave_input, &enclave_output,
+                          output);
+  }
+  if (run_buffers_depth > 0) {
+    EnclaveInput enclave_input;
+    EnclaveOutput enclave_output;
+    return RunApplication(input, input_len, &enclave_input, &enclave_output,
+                          output);
+  }
+  RunBuffers *buffers = GetRunBuffers();
+  ++run_buffers_depth;
+  int result = RunApplication(input, input_len, &buffers->input,
+                              &buffers->output, output);
+  --run_buffers_depth;
+  return result;
+}
+
 // Handler installed by the runtime to initialize the enclave.
 PrimitiveStatus Initialize(void *context, MessageReader *in,
                            MessageWriter *out) {
@@ -109,6 +247,11 @@ PrimitiveStatus Initialize(void *context, MessageReader *in,
   }
   if (!result) {
     out->PushByCopy(Extent{output, output_len});
+    // Hosts that do not read the startup profile ignore the second item.
+    std::string startup_profile;
+    if (GetStartupProfile()->SerializeToString(&startup_profile)) {
+      out->PushByCopy(Extent{startup_profile.data(), startup_profile.size()});
+    }
   }
   free(output);
   return PrimitiveStatus(result);
@@ -118,19 +261,18 @@ PrimitiveStatus Initialize(void *context, MessageReader *in,
 PrimitiveStatus Run(void *context, MessageReader *in, MessageWriter *out) {
   ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 1);
   auto input_extent = in->next();
-  char *output = nullptr;
-  size_t output_len = 0;
+  // The output is pushed by reference: the runtime copies it out of the
+  // enclave before any other Run call on this thread can overwrite it.
+  std::string *output = &GetRunBuffers()->serialized_output;
   int result = 0;
   try {
-    result = asylo::__asylo_user_run(input_extent.As<char>(),
-                                     input_extent.size(), &output, &output_len);
+    result = RunEnclave(input_extent.As<char>(), input_extent.size(), output);
   } catch (...) {
     TrustedPrimitives::BestEffortAbort("Uncaught exception in enclave");
   }
   if (!result) {
-    out->PushByCopy(Extent{output, output_len});
+    out->PushByReference(Extent{output->data(), output->size()});
   }
-  free(output);
   return PrimitiveStatus(result);
 }
 
@@ -155,6 +297,77 @@ PrimitiveStatus Finalize(void *context, MessageReader *in, MessageWriter *out) {
   return PrimitiveStatus(result);
 }
 
+// Saves the state of the application to |serialized_checkpoint|, a serialized
+// EnclaveCheckpoint.
+Status CheckpointApplication(std::string *serialized_checkpoint) {
+  if (GetState() != EnclaveState::kRunning) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Enclave not in state RUNNING");
+  }
+  std::string state;
+  uint64_t version = 0;
+  ASYLO_RETURN_IF_ERROR(
+      GetApplicationInstance()->SaveCheckpoint(&state, &version));
+  EnclaveCheckpoint checkpoint;
+  ASYLO_RETURN_IF_ERROR(SealCheckpoint(state, version, &checkpoint));
+  if (!checkpoint.SerializeToString(serialized_checkpoint)) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Failed to serialize EnclaveCheckpoint");
+  }
+  return Status::OkStatus();
+}
+
+// Restores the state of the application from the serialized EnclaveCheckpoint
+// |serialized_checkpoint|.
+Status RestoreApplication(Extent serialized_checkpoint) {
+  if (GetState() != EnclaveState::kRunning) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Enclave not in state RUNNING");
+  }
+  EnclaveCheckpoint checkpoint;
+  if (!checkpoint.ParseFromArray(serialized_checkpoint.data(),
+                                 serialized_checkpoint.size())) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Failed to parse EnclaveCheckpoint");
+  }
+  std::string state;
+  uint64_t version;
+  ASYLO_ASSIGN_OR_RETURN(state, OpenCheckpoint(checkpoint, &version));
+  return GetApplicationInstance()->RestoreCheckpoint(state, version);
+}
+
+// Handler installed by the runtime to checkpoint the state of the application.
+PrimitiveStatus Checkpoint(void *context, MessageReader *in,
+                           MessageWriter *out) {
+  ASYLO_RETURN_IF_READER_NOT_EMPTY(*in);
+  std::string checkpoint;
+  Status status;
+  try {
+    status = CheckpointApplication(&checkpoint);
+  } catch (...) {
+    TrustedPrimitives::BestEffortAbort("Uncaught exception in enclave");
+  }
+  if (status.ok()) {
+    out->PushByCopy(Extent{checkpoint.data(), checkpoint.size()});
+  }
+  return primitives::MakePrimitiveStatus(status);
+}
+
+// Handler installed by the runtime to restore the state of the application
+// from a checkpoint.
+PrimitiveStatus RestoreCheckpoint(void *context, MessageReader *in,
+                                  MessageWriter *out) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 1);
+  auto checkpoint_extent = in->next();
+  Status status;
+  try {
+    status = RestoreApplication(checkpoint_extent);
+  } catch (...) {
+    TrustedPrimitives::BestEffortAbort("Uncaught exception in enclave");
+  }
+  return primitives::MakePrimitiveStatus(status);
+}
+
 }  // namespace
 
 
@@ -169,21 +382,30 @@ Status VerifyOutputArguments(char **output, size_t *output_len) {
   return Status::OkStatus();
 }
 
-// Application instance returned by BuildTrustedApplication.
-static TrustedApplication *global_trusted_application = nullptr;
+// Application instance returned by BuildTrustedApplication. Published once
+// with a release store, so that every Run call after the first reads it with
+// an acquire load instead of taking |get_application_lock|.
+static std::atomic<TrustedApplication *> global_trusted_application{nullptr};
 
-// A mutex that avoids race condition when getting |global_trusted_application|.
+// A mutex that serializes building |global_trusted_application|.
 static absl::Mutex get_application_lock;
 
 // Initialize IO subsystem.
 static void InitializeIO(const EnclaveConfig &config);
 
 TrustedApplication *GetApplicationInstance() {
+  TrustedApplication *application =
+      global_trusted_application.load(std::memory_order_acquire);
+  if (application) {
+    return application;
+  }
   absl::MutexLock lock(&get_application_lock);
-  if (!global_trusted_application) {
-    global_trusted_application = BuildTrustedApplication();
+  application = global_trusted_application.load(std::memory_order_relaxed);
+  if (!application) {
+    application = BuildTrustedApplication();
+    global_trusted_application.store(application, std::memory_order_release);
   }
-  return global_trusted_application;
+  return application;
 }
 
 Status InitializeEnvironmentVariables(
@@ -200,24 +422,39 @@ Status InitializeEnvironmentVariables(
   return Status::OkStatus();
 }
 
-Status TrustedApplication::InitializeInternal(const EnclaveConfig &config) {
-  InitializeIO(config);
-  Status status =
-      InitializeEnvironmentVariables(config.environment_variables());
-  const char *log_directory = config.logging_config().log_directory().c_str();
-  int vlog_level = config.logging_config().vlog_level();
-  if(!InitLogging(log_directory, GetEnclaveName().c_str(), vlog_level)) {
-    fprintf(stderr, "Initialization of enclave logging failed\n");
+Status TrustedApplication::InitializeInternal(
+    const EnclaveConfig &config, EnclaveStartupPhase *startup_phase) {
+  {
+    ScopedStartupPhase phase("io", startup_phase);
+    InitializeIO(config);
+  }
+  Status status;
+  {
+    ScopedStartupPhase phase("environment_variables", startup_phase);
+    status = InitializeEnvironmentVariables(config.environment_variables());
+  }
+  {
+    ScopedStartupPhase phase("logging", startup_phase);
+    const char *log_directory =
+        config.logging_config().log_directory().c_str();
+    int vlog_level = config.logging_config().vlog_level();
+    if(!InitLogging(log_directory, GetEnclaveName().c_str(), vlog_level)) {
+      fprintf(stderr, "Initialization of enclave logging failed\n");
+    }
   }
   if (!status.ok()) {
     LOG(WARNING) << "Initialization of enclave environment variables failed: "
                  << status;
   }
   SetEnclaveConfig(config);
-  // This call can fail, but it should not stop the enclave from running.
-  status = InitializeEnclaveAssertionAuthorities(
-      config.enclave_assertion_authority_configs().begin(),
-      config.enclave_assertion_authority_configs().end());
+  {
+    ScopedStartupPhase phase("assertion_authorities", startup_phase);
+    // This call can fail, but it should not stop the enclave from running.
+    status = InitializeEnclaveAssertionAuthorities(
+        config.enclave_assertion_authority_configs().begin(),
+        config.enclave_assertion_authority_configs().end(),
+        config.assertion_authority_initialization_threads());
+  }
   if (!status.ok()) {
     LOG(WARNING) << "Initialization of enclave assertion authorities failed: "
                  << status;
@@ -225,6 +462,7 @@ Status TrustedApplication::InitializeInternal(const EnclaveConfig &config) {
 
   ASYLO_RETURN_IF_ERROR(VerifyAndSetState(EnclaveState::kInternalInitializing,
                                           EnclaveState::kUserInitializing));
+  ScopedStartupPhase phase("user_initialize", startup_phase);
   return Initialize(config);
 }
 
@@ -243,6 +481,17 @@ void InitializeIO(const EnclaveConfig &config) {
   if (config.stderr_fd() >= 0) {
     io_manager.RegisterHostFileDescriptor(config.stderr_fd());
   }
+  if (config.stdio_buffer_size() > 0) {
+    int64_t interval_nanos =
+        static_cast<int64_t>(config.stdio_flush_interval_ms()) * 1000000;
+    for (int fd : {STDOUT_FILENO, STDERR_FILENO}) {
+      io_manager.EnableWriteBuffering(fd, config.stdio_buffer_size(),
+                                      interval_nanos);
+    }
+  }
+  if (config.enable_local_pipes()) {
+    io_manager.EnableLocalPipes();
+  }
 
   // Register handler for / so paths without other handlers are forwarded on to
   // the host system. Paths are registered without the trailing slash, so an
@@ -277,12 +526,18 @@ int __asylo_user_init(const char *name, const char *config, size_t config_len,
 
   StatusSerializer<StatusProto> status_serializer(output, output_len);
 
-  EnclaveConfig enclave_config;
-  if (!enclave_config.ParseFromArray(config, config_len)) {
+  // The config can be large, so parse it onto an arena that is released in one
+  // step once initialization completes.
+  google::protobuf::Arena config_arena;
+  StatusOr<EnclaveConfig *> config_result =
+      ParseBinaryProtoOnArena<EnclaveConfig>(
+          ByteContainerView(config, config_len), &config_arena);
+  if (!config_result.ok()) {
     status = Status(error::GoogleError::INVALID_ARGUMENT,
                     "Failed to parse EnclaveConfig");
     return status_serializer.Serialize(status);
   }
+  const EnclaveConfig &enclave_config = *config_result.ValueOrDie();
 
   status = VerifyAndSetState(EnclaveState::kUninitialized,
                              EnclaveState::kInternalInitializing);
@@ -292,13 +547,24 @@ int __asylo_user_init(const char *name, const char *config, size_t config_len,
 
   SetEnclaveName(name);
   // Invoke the enclave entry-point.
-  status = GetApplicationInstance()->InitializeInternal(enclave_config);
+  EnclaveStartupPhase *startup_profile = GetStartupProfile();
+  startup_profile->Clear();
+  {
+    ScopedStartupPhase phase("trusted_initialize", startup_profile);
+    status = GetApplicationInstance()->InitializeInternal(enclave_config,
+                                                          phase.phase());
+  }
   if (!status.ok()) {
     SetState(EnclaveState::kUninitialized);
     return status_serializer.Serialize(status);
   }
 
+  run_arena_block_size = std::max(enclave_config.run_arena_block_size(), 0);
   SetState(EnclaveState::kRunning);
+
+  // Donate the configured thread pool now that threads may enter the enclave.
+  ThreadManager::GetInstance()->StartThreadPool(
+      enclave_config.thread_pool_size());
   return status_serializer.Serialize(status);
 }
 
@@ -309,26 +575,19 @@ int __asylo_user_run(const char *input, size_t input_len, char **output,
     return 1;
   }
 
-  EnclaveOutput enclave_output;
-  StatusSerializer<EnclaveOutput> status_serializer(
-      &enclave_output, enclave_output.mutable_status(), output, output_len);
-
-  EnclaveInput enclave_input;
-  if (!enclave_input.ParseFromArray(input, input_len)) {
-    status = Status(error::GoogleError::INVALID_ARGUMENT,
-                    "Failed to parse EnclaveInput");
-    return status_serializer.Serialize(status);
+  std::string serialized_output;
+  if (RunEnclave(input, input_len, &serialized_output)) {
+    return 1;
   }
-
-  if (GetState() != EnclaveState::kRunning) {
-    status = Status(error::GoogleError::FAILED_PRECONDITION,
-                    "Enclave not in state RUNNING");
-    return status_serializer.Serialize(status);
+  *output_len = serialized_output.size();
+  *output = static_cast<char *>(malloc(*output_len));
+  if (!*output && *output_len > 0) {
+    LogError(Status(error::GoogleError::RESOURCE_EXHAUSTED,
+                    "Failed to allocate EnclaveOutput buffer"));
+    return 1;
   }
-
-  // Invoke the enclave entry-point.
-  status = GetApplicationInstance()->Run(enclave_input, &enclave_output);
-  return status_serializer.Serialize(status);
+  memcpy(*output, serialized_output.data(), *output_len);
+  return 0;
 }
 
 int __asylo_user_fini(const char *input, size_t input_len, char **output,
@@ -354,6 +613,12 @@ int __asylo_user_fini(const char *input, size_t input_len, char **output,
 
   // Invoke the enclave entry-point.
   status = GetApplicationInstance()->Finalize(enclave_final);
+  io::BufferedWriter::FlushAll();
+#ifdef ASYLO_PROFILE_INSTRUMENTED
+  // Enclave destructors are not run by every backend, so write the profile of
+  // an instrumented build while host file I/O is still available.
+  __gcov_dump();
+#endif  // ASYLO_PROFILE_INSTRUMENTED
 
   ThreadManager *thread_manager = ThreadManager::GetInstance();
   thread_manager->Finalize();
@@ -391,6 +656,20 @@ extern "C" PrimitiveStatus asylo_enclave_init() {
     TrustedPrimitives::BestEffortAbort("Could not register entry handler");
   }
 
+  // Register the enclave checkpoint entry handlers.
+  EntryHandler checkpoint_handler{asylo::Checkpoint};
+  if (!TrustedPrimitives::RegisterEntryHandler(asylo::kSelectorAsyloCheckpoint,
+                                               checkpoint_handler)
+           .ok()) {
+    TrustedPrimitives::BestEffortAbort("Could not register entry handler");
+  }
+  EntryHandler restore_checkpoint_handler{asylo::RestoreCheckpoint};
+  if (!TrustedPrimitives::RegisterEntryHandler(
+           asylo::kSelectorAsyloRestoreCheckpoint, restore_checkpoint_handler)
+           .ok()) {
+    TrustedPrimitives::BestEffortAbort("Could not register entry handler");
+  }
+
   return PrimitiveStatus::OkStatus();
 }
 
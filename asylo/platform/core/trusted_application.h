@@ -21,9 +21,11 @@
 
 // Defines a high-level interface for constructing enclave applications.
 
+#include <cstdint>
 #include <string>
 
 #include "asylo/enclave.pb.h"
+#include "asylo/platform/core/enclave_startup_profile.pb.h"
 #include "asylo/platform/core/entry_points.h"
 #include "asylo/util/status.h"
 
@@ -70,7 +72,8 @@ namespace asylo {
 class TrustedApplication {
  public:
   /// \private
-  Status InitializeInternal(const EnclaveConfig &config);
+  Status InitializeInternal(const EnclaveConfig &config,
+                            EnclaveStartupPhase *startup_phase);
 
   /// Implements enclave initialization entry-point.
   ///
@@ -100,6 +103,47 @@ class TrustedApplication {
     return Status::OkStatus();
   }
 
+  /// Saves the state of the application, such as caches and indexes, so that
+  /// a later instance of the enclave can start warm.
+  ///
+  /// Invoked by EnclaveManager::CheckpointEnclave(). The runtime encrypts
+  /// `state` under a key sealed to the MRENCLAVE of the enclave, so that only
+  /// an enclave built from the same code on the same host can restore it.
+  /// Other entries may run concurrently, so the application is responsible
+  /// for saving a consistent state.
+  ///
+  /// The checkpoint is not protected against rollback: the host may later
+  /// supply any checkpoint the enclave saved, including an older one. The
+  /// `version` is authenticated along with `state` and handed back to
+  /// RestoreCheckpoint(), so that an application which must not restore stale
+  /// state can number its checkpoints and check them against a counter kept
+  /// where the host cannot roll it back.
+  ///
+  /// \param[out] state The serialized state of the application.
+  /// \param[out] version The version of `state`, initially zero.
+  /// \return OK status or error
+  /// \anchor save_checkpoint
+  virtual Status SaveCheckpoint(std::string *state, uint64_t *version) {
+    return Status(error::GoogleError::UNIMPLEMENTED,
+                  "The enclave does not support checkpoints");
+  }
+
+  /// Restores a state saved by SaveCheckpoint().
+  ///
+  /// Invoked after Initialize() if the enclave is loaded from an
+  /// EnclaveLoadConfig naming a checkpoint. If it fails, the enclave is
+  /// destroyed.
+  ///
+  /// \param state The state saved by SaveCheckpoint().
+  /// \param version The version SaveCheckpoint() gave `state`.
+  /// \return OK status or error
+  /// \anchor restore_checkpoint
+  virtual Status RestoreCheckpoint(const std::string &state,
+                                   uint64_t version) {
+    return Status(error::GoogleError::UNIMPLEMENTED,
+                  "The enclave does not support checkpoints");
+  }
+
   /// Trivial destructor.
   ///
   /// Trivial destructor. Note that classes derived from of TrustedApplication
@@ -0,0 +1,97 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/core/trusted_ticket_lock.h"
+
+#include <atomic>
+
+#include "asylo/platform/primitives/trusted_primitives.h"
+
+namespace asylo {
+
+void TrustedTicketLock::Lock() {
+  if (is_recursive_ && owner_ == enc_thread_self()) {
+    recursive_lock_count_++;
+    return;
+  }
+
+  const uint32_t ticket =
+      AtomicIncrement(&next_ticket_, std::memory_order_relaxed);
+  while (true) {
+    // Tickets are compared by their difference so that wrap-around of the
+    // 32-bit counters is harmless.
+    const uint32_t ahead =
+        ticket - __atomic_load_n(&now_serving_, __ATOMIC_ACQUIRE);
+    if (ahead == 0) {
+      break;
+    }
+    for (uint32_t i = 0; i < ahead; i++) {
+      enc_pause();
+    }
+  }
+  owner_ = enc_thread_self();
+  recursive_lock_count_ = 1;
+}
+
+bool TrustedTicketLock::Owned() const { return owner_ == enc_thread_self(); }
+
+bool TrustedTicketLock::TryLock() {
+  if (is_recursive_ && owner_ == enc_thread_self()) {
+    recursive_lock_count_++;
+    return true;
+  }
+
+  // The lock is free only if every ticket drawn so far has been served. In
+  // that case, claim the next ticket, which is also the one being served. A
+  // stale read of |now_serving_| can only make the exchange fail, which is a
+  // safe spurious failure.
+  uint32_t ticket = __atomic_load_n(&now_serving_, __ATOMIC_RELAXED);
+  if (next_ticket_ != ticket) {
+    return false;
+  }
+  if (AtomicCompareExchange(&next_ticket_, &ticket, ticket + 1,
+                            /*weak=*/false, std::memory_order_acquire,
+                            std::memory_order_relaxed)) {
+    owner_ = enc_thread_self();
+    recursive_lock_count_ = 1;
+    return true;
+  }
+  return false;
+}
+
+void TrustedTicketLock::Unlock() {
+  // It is a fatal error to attempt to unlock a ticket lock the calling thread
+  // does not own.
+  if (owner_ != enc_thread_self()) {
+    primitives::TrustedPrimitives::DebugPuts(
+        "TrustedTicketLock::Unlock called by thread that does not own it.");
+    return;
+  }
+
+  recursive_lock_count_--;
+  if (recursive_lock_count_ == 0) {
+    owner_ = kInvalidThread;
+    // Only the owner writes |now_serving_|, so a plain increment published
+    // with release semantics hands the lock to the next ticket.
+    AtomicStore(&now_serving_, now_serving_ + 1, std::memory_order_release);
+  }
+}
+
+bool TrustedTicketLock::LockDepthIsOne() { return recursive_lock_count_ == 1; }
+
+}  // namespace asylo
@@ -0,0 +1,106 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_CORE_TRUSTED_TICKET_LOCK_H_
+#define ASYLO_PLATFORM_CORE_TRUSTED_TICKET_LOCK_H_
+
+#include <cstdint>
+
+#include "asylo/platform/core/atomic.h"
+#include "asylo/platform/primitives/trusted_runtime.h"
+
+namespace asylo {
+
+// A fair spin lock implementation depending on only trusted resources, with
+// the same interface as TrustedSpinLock.
+//
+// Each thread calling Lock() draws a ticket and waits for it to be served, so
+// contending threads acquire the lock in FIFO order and none can be starved.
+// Waiters back off in proportion to their distance from the head of the queue,
+// which limits traffic on the lock's cache line.
+//
+// Because the lock is handed over in ticket order, a waiter that is descheduled
+// by the host stalls every thread queued behind it. Prefer TrustedSpinLock for
+// locks that may be contended by more threads than there are cores.
+//
+// The 'alignas' aligns the object to the cache line size and pads the object
+// to the same cache line size.
+class alignas(kCacheLineSize) TrustedTicketLock {
+ public:
+  // Initializes an unlocked ticket lock. If |is_recursive| is true, then the
+  // lock may 1) be locked more than once by the caller and 2) does not become
+  // free until it is unlocked a corresponding number of times.
+  constexpr explicit TrustedTicketLock(bool is_recursive)
+      : next_ticket_(0),
+        now_serving_(0),
+        owner_(kInvalidThread),
+        is_recursive_(is_recursive),
+        recursive_lock_count_(0) {}
+
+  ~TrustedTicketLock() = default;
+
+  // If this lock is not already held, block until the calling thread is able to
+  // acquire it. If configured as a recursive lock, a TrustedTicketLock may be
+  // acquired multiple times, in which case it must be unlocked a corresponding
+  // number of times before becoming free.
+  void Lock();
+
+  // Returns true if the calling thread is the owner of the lock.
+  bool Owned() const;
+
+  // Tries to acquire the lock without blocking. Returns true if the lock was
+  // acquired, otherwise false. Fails whenever another thread holds or is
+  // waiting for the lock.
+  bool TryLock();
+
+  // Releases the lock, which must be held by the calling thread. If the lock is
+  // configured as a recursive lock and was locked multiple times, then it must
+  // be unlocked a corresponding number of times before being released.
+  void Unlock();
+
+  // IMPORTANT: Only safe to call from a thread which currently holds the lock.
+  // Returns true if the next unlock will release the lock. See
+  // TrustedSpinLock::LockDepthIsOne.
+  bool LockDepthIsOne();
+
+ private:
+  // The ticket handed to the next thread calling Lock(). The lock is free when
+  // it equals |now_serving_|.
+  volatile uint32_t next_ticket_;
+
+  // The ticket of the thread that holds or is about to hold the lock. Only
+  // written by the lock owner.
+  volatile uint32_t now_serving_;
+
+  // The enc_thread_self() value of the thread that owns the lock, or zero if
+  // the lock is unlocked.
+  volatile uint64_t owner_;
+
+  // True if this lock has been configured as a recursive lock.
+  const bool is_recursive_;
+
+  // The number of times this lock has been locked recursively.
+  uint64_t recursive_lock_count_;
+};
+
+static_assert(sizeof(TrustedTicketLock) == kCacheLineSize,
+              "TrustedTicketLock must be sizeof a cache line.");
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_CORE_TRUSTED_TICKET_LOCK_H_
@@ -18,6 +18,7 @@
 
 #include "asylo/platform/crypto/gcmlib/gcm_cryptor.h"
 
+#include <openssl/aead.h>
 #include <openssl/aes.h>
 #include <openssl/cmac.h>
 #include <openssl/err.h>
@@ -27,6 +28,8 @@
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <utility>
+#include <vector>
 
 #include "absl/memory/memory.h"
 #include "absl/synchronization/mutex.h"
@@ -92,7 +95,8 @@ GcmCryptor::GcmCryptor(size_t block_length, const GcmCryptorKey &gcm_key,
     : kBlockLength(block_length),
       kGcmKey(gcm_key),
       kCmacKey(cmac_key),
-      key_id_counter_(0) {}
+      key_id_counter_(0),
+      next_key_context_(0) {}
 
 std::unique_ptr<GcmCryptor> GcmCryptor::Create(
     size_t block_length, const GcmCryptorKey &master_key) {
@@ -144,126 +148,188 @@ std::unique_ptr<GcmCryptor> GcmCryptor::Create(
 
 bool GcmCryptor::EncryptBlock(const uint8_t *plaintext_data, uint8_t *token,
                               uint8_t *ciphertext_data) {
+  return EncryptBlocks(1, &plaintext_data, &token, &ciphertext_data);
+}
+
+bool GcmCryptor::DecryptBlock(const uint8_t *ciphertext_data,
+                              const uint8_t *token, uint8_t *plaintext_data) {
+  return DecryptBlocks(1, &ciphertext_data, &token, &plaintext_data);
+}
+
+bool GcmCryptor::EncryptBlocks(size_t count,
+                               const uint8_t *const *plaintext_data,
+                               uint8_t *const *token,
+                               uint8_t *const *ciphertext_data) {
   if (plaintext_data == nullptr || token == nullptr ||
       ciphertext_data == nullptr) {
-    LOG(ERROR) << "Invalid input to GcmCryptor::EncryptBlock.";
+    LOG(ERROR) << "Invalid input to GcmCryptor::EncryptBlocks.";
     return false;
   }
+  for (size_t i = 0; i < count; i++) {
+    if (plaintext_data[i] == nullptr || token[i] == nullptr ||
+        ciphertext_data[i] == nullptr) {
+      LOG(ERROR) << "Invalid input to GcmCryptor::EncryptBlocks.";
+      return false;
+    }
+  }
 
-  absl::MutexLock lock(&mu_);
-
-  if (1 != RAND_bytes(next_token_.nonce, kNonceLength)) {
+  // Generate nonces for all blocks at once.
+  std::vector<uint8_t> nonces(count * kNonceLength);
+  if (1 != RAND_bytes(nonces.data(), nonces.size())) {
     LOG(ERROR)
-        << "Failed to generate random nonce for GcmCryptor::EncryptBlock: "
+        << "Failed to generate random nonce for GcmCryptor::EncryptBlocks: "
         << BsslLastErrorString();
     return false;
   }
 
-  if (key_id_counter_ % kKeyIdCycle == 0) {
-    key_id_counter_ = 0;
+  absl::MutexLock lock(&mu_);
+
+  for (size_t i = 0; i < count; i++) {
+    if (key_id_counter_ % kKeyIdCycle == 0) {
+      key_id_counter_ = 0;
+
+      if (1 != RAND_bytes(next_token_.key_id, kKeyIdLength)) {
+        LOG(ERROR)
+            << "Failed to generate random token for GcmCryptor::EncryptBlocks: "
+            << BsslLastErrorString();
+        return false;
+      }
+
+      encrypt_context_ = CreateKeyContext(next_token_.key_id);
+      if (!encrypt_context_) {
+        return false;
+      }
+
+      // Blocks are commonly read back shortly after they are written, so make
+      // the new key available to decryption as well.
+      CacheKeyContext(encrypt_context_);
+    }
+
+    // Increment the key reuse counter only if the key was successfully
+    // generated.
+    key_id_counter_++;
+
+    memcpy(next_token_.nonce, nonces.data() + i * kNonceLength, kNonceLength);
 
-    if (1 != RAND_bytes(next_token_.key_id, kKeyIdLength)) {
-      LOG(ERROR)
-          << "Failed to generate random token for GcmCryptor::EncryptBlock: "
-          << BsslLastErrorString();
+    size_t ciphertext_length;
+    size_t max_ciphertext_length = kBlockLength + kTagLength;
+    if (!EVP_AEAD_CTX_seal(encrypt_context_->context.get(), ciphertext_data[i],
+                           &ciphertext_length, max_ciphertext_length,
+                           next_token_.nonce, kNonceLength, plaintext_data[i],
+                           kBlockLength, nullptr, 0)) {
+      LOG(ERROR) << "EVP_AEAD_CTX_seal failed: " << BsslLastErrorString();
       return false;
     }
 
-    if (!GenerateDerivedGcmKey(next_token_.key_id, &next_derived_key_)) {
-      LOG(ERROR) << "Failed to derive key for GcmCryptor::EncryptBlock: "
-                 << BsslLastErrorString();
+    if (ciphertext_length != max_ciphertext_length) {
+      LOG(ERROR) << "EVP_AEAD_CTX_seal failed to encrypt complete plaintext, "
+                 << "expected ciphertext_length = " << max_ciphertext_length
+                 << ", encountered ciphertext_length = " << ciphertext_length;
       return false;
     }
+
+    memcpy(token[i], next_token_.data(), kTokenLength);
   }
 
-  // Increment the key reuse counter only if the key was successfully generated.
-  key_id_counter_++;
+  return true;
+}
 
-  EVP_AEAD_CTX context;
-  if (!EVP_AEAD_CTX_init(
-          &context, EVP_aead_aes_256_gcm(),
-          reinterpret_cast<const uint8_t *>(next_derived_key_.data()),
-          kKeyLength, kTagLength, nullptr)) {
-    LOG(ERROR) << "EVP_AEAD_CTX_init failed: " << BsslLastErrorString();
-    EVP_AEAD_CTX_cleanup(&context);
+bool GcmCryptor::DecryptBlocks(size_t count,
+                               const uint8_t *const *ciphertext_data,
+                               const uint8_t *const *token,
+                               uint8_t *const *plaintext_data) {
+  if (ciphertext_data == nullptr || token == nullptr ||
+      plaintext_data == nullptr) {
+    LOG(ERROR) << "Invalid input to GcmCryptor::DecryptBlocks.";
     return false;
   }
 
-  size_t ciphertext_length;
-  size_t max_ciphertext_length = kBlockLength + kTagLength;
-  if (!EVP_AEAD_CTX_seal(&context, ciphertext_data, &ciphertext_length,
-                         max_ciphertext_length, next_token_.nonce, kNonceLength,
-                         plaintext_data, kBlockLength, nullptr, 0)) {
-    LOG(ERROR) << "EVP_AEAD_CTX_seal failed: " << BsslLastErrorString();
-    EVP_AEAD_CTX_cleanup(&context);
-    return false;
-  }
+  std::shared_ptr<const KeyContext> context;
+  for (size_t i = 0; i < count; i++) {
+    if (ciphertext_data[i] == nullptr || token[i] == nullptr ||
+        plaintext_data[i] == nullptr) {
+      LOG(ERROR) << "Invalid input to GcmCryptor::DecryptBlocks.";
+      return false;
+    }
 
-  if (ciphertext_length != max_ciphertext_length) {
-    LOG(ERROR) << "EVP_AEAD_CTX_seal failed to encrypt complete plaintext, "
-               << "expected ciphertext_length = " << max_ciphertext_length
-               << ", encountered ciphertext_length = " << ciphertext_length;
-    EVP_AEAD_CTX_cleanup(&context);
-    return false;
-  }
+    const Token *tok = reinterpret_cast<const Token *>(token[i]);
+
+    if (!context || memcmp(context->key_id, tok->key_id, kKeyIdLength) != 0) {
+      context = GetKeyContext(tok->key_id);
+      if (!context) {
+        return false;
+      }
+    }
+
+    size_t plaintext_length;
+    if (!EVP_AEAD_CTX_open(context->context.get(), plaintext_data[i],
+                           &plaintext_length, kBlockLength, tok->nonce,
+                           kNonceLength, ciphertext_data[i],
+                           kBlockLength + kTagLength, nullptr, 0)) {
+      LOG(ERROR) << "EVP_AEAD_CTX_open failed: " << BsslLastErrorString();
+      return false;
+    }
 
-  memcpy(token, next_token_.data(), kTokenLength);
+    if (plaintext_length != kBlockLength) {
+      LOG(ERROR) << "EVP_AEAD_CTX_open failed to decrypt complete ciphertext, "
+                 << "expected plaintext_length = " << kBlockLength
+                 << ", encountered plaintext_length = " << plaintext_length;
+      return false;
+    }
+  }
 
-  EVP_AEAD_CTX_cleanup(&context);
   return true;
 }
 
-bool GcmCryptor::DecryptBlock(const uint8_t *ciphertext_data,
-                              const uint8_t *token, uint8_t *plaintext_data) {
-  if (ciphertext_data == nullptr || token == nullptr ||
-      plaintext_data == nullptr) {
-    LOG(ERROR) << "Invalid input to GcmCryptor::DecryptBlock.";
-    return false;
+bool GcmCryptor::GenerateDerivedGcmKey(const uint8_t *key_id,
+                                       GcmCryptorKey *dk) {
+  return GenerateDerivedKey(kGcmKey, key_id, dk);
+}
+
+std::shared_ptr<const GcmCryptor::KeyContext> GcmCryptor::GetKeyContext(
+    const uint8_t *key_id) {
+  {
+    absl::MutexLock lock(&context_mu_);
+    for (const auto &context : key_contexts_) {
+      if (context && memcmp(context->key_id, key_id, kKeyIdLength) == 0) {
+        return context;
+      }
+    }
   }
 
-  const Token *tok = reinterpret_cast<const Token *>(token);
+  // Derive the key outside of the lock, so that decryption of blocks with
+  // cached keys does not wait for it.
+  std::shared_ptr<const KeyContext> context = CreateKeyContext(key_id);
+  if (context) {
+    CacheKeyContext(context);
+  }
+  return context;
+}
 
+std::shared_ptr<const GcmCryptor::KeyContext> GcmCryptor::CreateKeyContext(
+    const uint8_t *key_id) {
   GcmCryptorKey derived_key;
-  if (!GenerateDerivedGcmKey(tok->key_id, &derived_key)) {
-    LOG(ERROR) << "Failed to derive key for GcmCryptor::DecryptBlock: "
+  if (!GenerateDerivedGcmKey(key_id, &derived_key)) {
+    LOG(ERROR) << "Failed to derive key for GcmCryptor: "
                << BsslLastErrorString();
-    return false;
+    return nullptr;
   }
 
-  EVP_AEAD_CTX context;
-  if (!EVP_AEAD_CTX_init(&context, EVP_aead_aes_256_gcm(),
+  auto context = std::make_shared<KeyContext>();
+  if (!EVP_AEAD_CTX_init(context->context.get(), EVP_aead_aes_256_gcm(),
                          reinterpret_cast<const uint8_t *>(derived_key.data()),
                          kKeyLength, kTagLength, nullptr)) {
     LOG(ERROR) << "EVP_AEAD_CTX_init failed: " << BsslLastErrorString();
-    EVP_AEAD_CTX_cleanup(&context);
-    return false;
-  }
-
-  size_t plaintext_length;
-  if (!EVP_AEAD_CTX_open(&context, plaintext_data, &plaintext_length,
-                         kBlockLength, tok->nonce, kNonceLength,
-                         ciphertext_data, kBlockLength + kTagLength, nullptr,
-                         0)) {
-    LOG(ERROR) << "EVP_AEAD_CTX_open failed: " << BsslLastErrorString();
-    EVP_AEAD_CTX_cleanup(&context);
-    return false;
-  }
-
-  if (plaintext_length != kBlockLength) {
-    LOG(ERROR) << "EVP_AEAD_CTX_open failed to decrypt complete ciphertext, "
-               << "expected plaintext_length = " << kBlockLength
-               << ", encountered plaintext_length = " << plaintext_length;
-    EVP_AEAD_CTX_cleanup(&context);
-    return false;
+    return nullptr;
   }
-
-  EVP_AEAD_CTX_cleanup(&context);
-  return true;
+  memcpy(context->key_id, key_id, kKeyIdLength);
+  return context;
 }
 
-bool GcmCryptor::GenerateDerivedGcmKey(const uint8_t *key_id,
-                                       GcmCryptorKey *dk) {
-  return GenerateDerivedKey(kGcmKey, key_id, dk);
+void GcmCryptor::CacheKeyContext(std::shared_ptr<const KeyContext> context) {
+  absl::MutexLock lock(&context_mu_);
+  key_contexts_[next_key_context_] = std::move(context);
+  next_key_context_ = (next_key_context_ + 1) % kKeyContextCacheSize;
 }
 
 bool GcmCryptor::GetAuthTag(uint8_t out[16], const uint8_t *in,
@@ -287,13 +353,13 @@ GcmCryptor *GcmCryptorRegistry::GetGcmCryptor(size_t block_length,
                                               const GcmCryptorKey &key) {
   absl::MutexLock lock(&mu_);
 
-  auto it = cryptor_registry_.find(key);
-  if (it != cryptor_registry_.end()) {
+  auto &cryptors = cryptor_registry_[block_length];
+  auto it = cryptors.find(key);
+  if (it != cryptors.end()) {
     return it->second.get();
   }
 
-  auto result =
-      cryptor_registry_.emplace(key, GcmCryptor::Create(block_length, key));
+  auto result = cryptors.emplace(key, GcmCryptor::Create(block_length, key));
   return result.first->second.get();
 }
 
@@ -19,6 +19,7 @@
 #ifndef ASYLO_PLATFORM_CRYPTO_GCMLIB_GCM_CRYPTOR_H_
 #define ASYLO_PLATFORM_CRYPTO_GCMLIB_GCM_CRYPTOR_H_
 
+#include <openssl/aead.h>
 #include <openssl/evp.h>
 
 #include <memory>
@@ -49,6 +50,13 @@ constexpr size_t kKeyIdLength = 32;
 using GcmCryptorKey = SafeBytes<kKeyLength>;
 
 // GcmCryptor implements AES-GCM encryption and decryption.
+//
+// Encryption and decryption are delegated to BoringSSL, which selects its
+// AES-NI, PCLMULQDQ and VAES code paths from the CPU features it detects when
+// it is loaded. The per-block cost is kept close to that of the AEAD itself by
+// caching the AEAD contexts of recently used derived keys, so that blocks
+// encrypted with the same derived key share the key derivation and the
+// expansion of the AES key schedule and of the GHASH key.
 class GcmCryptor {
  public:
   // Initializes the cryptor with the specified 32 byte key.
@@ -68,6 +76,18 @@ class GcmCryptor {
   bool DecryptBlock(const uint8_t *ciphertext_data, const uint8_t *token,
                     uint8_t *plaintext_data);
 
+  // Encrypts |count| plaintext blocks as EncryptBlock does, writing the
+  // ciphertext of |plaintext_data[i]| to |ciphertext_data[i]| and its token to
+  // |token[i]|. Returns false if any block fails to encrypt.
+  bool EncryptBlocks(size_t count, const uint8_t *const *plaintext_data,
+                     uint8_t *const *token, uint8_t *const *ciphertext_data);
+
+  // Decrypts |count| ciphertext blocks as DecryptBlock does. Returns false if
+  // any block fails to decrypt.
+  bool DecryptBlocks(size_t count, const uint8_t *const *ciphertext_data,
+                     const uint8_t *const *token,
+                     uint8_t *const *plaintext_data);
+
   // Generates auth tag, in particular CMAC, for the specified data. Returns
   // true on success, false on failure.
   bool GetAuthTag(uint8_t out[16], const uint8_t *in, size_t in_len) const;
@@ -76,6 +96,9 @@ class GcmCryptor {
   static constexpr size_t kNonceLength = 12;
   static constexpr size_t kKeyIdCycle = 256;
 
+  // Number of derived key contexts kept in the cache.
+  static constexpr size_t kKeyContextCacheSize = 16;
+
   struct Token {
     uint8_t nonce[kNonceLength];
     uint8_t key_id[kKeyIdLength];
@@ -84,18 +107,49 @@ class GcmCryptor {
     uint8_t *data() { return nonce; }
   };
 
+  // An AEAD context initialized with the derived key identified by |key_id|.
+  // The context is not modified once initialized, so it may be used for
+  // concurrent encryption and decryption.
+  struct KeyContext {
+    uint8_t key_id[kKeyIdLength];
+    bssl::ScopedEVP_AEAD_CTX context;
+  };
+
   GcmCryptor(size_t block_length, const GcmCryptorKey &gcm_key,
              const GcmCryptorKey &cmac_key);
   bool GenerateDerivedGcmKey(const uint8_t *key_id, GcmCryptorKey *dk);
 
+  // Returns a context for the derived key identified by |key_id|, from the
+  // cache of contexts if available. Returns nullptr on failure.
+  std::shared_ptr<const KeyContext> GetKeyContext(const uint8_t *key_id)
+      ABSL_LOCKS_EXCLUDED(context_mu_);
+
+  // Derives the key identified by |key_id| and returns a new context for it,
+  // without adding it to the cache. Returns nullptr on failure.
+  std::shared_ptr<const KeyContext> CreateKeyContext(const uint8_t *key_id);
+
+  // Adds |context| to the cache of contexts, replacing the least recently
+  // added one if the cache is full.
+  void CacheKeyContext(std::shared_ptr<const KeyContext> context)
+      ABSL_LOCKS_EXCLUDED(context_mu_);
+
   const size_t kBlockLength;
   const GcmCryptorKey kGcmKey;
   const GcmCryptorKey kCmacKey;
   Token next_token_ ABSL_GUARDED_BY(mu_);
   uint64_t key_id_counter_;
-  GcmCryptorKey next_derived_key_ ABSL_GUARDED_BY(mu_);
+
+  // Context for the derived key identified by |next_token_.key_id|.
+  std::shared_ptr<const KeyContext> encrypt_context_ ABSL_GUARDED_BY(mu_);
   absl::Mutex mu_;
 
+  // Cache of contexts of recently used derived keys, replaced in round-robin
+  // order starting at |next_key_context_|.
+  std::shared_ptr<const KeyContext> key_contexts_[kKeyContextCacheSize]
+      ABSL_GUARDED_BY(context_mu_);
+  size_t next_key_context_ ABSL_GUARDED_BY(context_mu_);
+  absl::Mutex context_mu_;
+
   GcmCryptor(const GcmCryptor &) = delete;
   GcmCryptor &operator=(const GcmCryptor &) = delete;
 };
@@ -109,7 +163,8 @@ class GcmCryptorRegistry {
     return *instance;
   }
 
-  // Accessor to the instance of GCM cryptor associated with a given key.
+  // Accessor to the instance of GCM cryptor associated with a given block
+  // length and key.
   GcmCryptor *GetGcmCryptor(size_t block_length, const GcmCryptorKey &key)
       ABSL_LOCKS_EXCLUDED(mu_);
 
@@ -140,8 +195,11 @@ class GcmCryptorRegistry {
   // primitives interface where system calls might not be available, so we use
   // std::unordered_map instead of absl::flat_hash_map to prevent unsafe system
   // calls made by absl based containers.
-  std::unordered_map<GcmCryptorKey, std::unique_ptr<GcmCryptor>,
-                     SafeBytesHasher>
+  // Cryptors are keyed on the block length first, since the same key may be
+  // used for files with different block lengths.
+  std::unordered_map<
+      size_t, std::unordered_map<GcmCryptorKey, std::unique_ptr<GcmCryptor>,
+                                 SafeBytesHasher>>
       cryptor_registry_ ABSL_GUARDED_BY(mu_);
   absl::Mutex mu_;
 };
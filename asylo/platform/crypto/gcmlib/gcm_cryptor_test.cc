@@ -20,6 +20,8 @@
 
 #include <openssl/rand.h>
 
+#include <vector>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "asylo/crypto/util/bytes.h"
@@ -195,6 +197,98 @@ TEST(GcmCryptorTest, DecryptWithAlteredCiphertextFails) {
       decryptor->DecryptBlock(encryptor_buffer, token, decryptor_buffer));
 }
 
+// Tests batched encryption and decryption of blocks spanning several derived
+// keys, and interoperability with single block decryption.
+TEST(GcmCryptorTest, EncryptDecryptBlocksSuccess) {
+  constexpr size_t kBlockCount = 600;
+  std::vector<uint8_t> plaintext(kBlockCount * kBlockLength);
+  std::vector<uint8_t> ciphertext(kBlockCount * (kBlockLength + kTagLength));
+  std::vector<uint8_t> tokens(kBlockCount * kTokenLength);
+  std::vector<uint8_t> decrypted(kBlockCount * kBlockLength);
+  GcmCryptorKey key;
+  ASSERT_EQ(RAND_bytes(key.data(), key.size()), 1);
+  auto encryptor = GcmCryptor::Create(kBlockLength, key);
+  auto decryptor = GcmCryptor::Create(kBlockLength, key);
+  ASSERT_EQ(RAND_bytes(plaintext.data(), plaintext.size()), 1);
+
+  std::vector<const uint8_t *> plaintext_blocks;
+  std::vector<uint8_t *> ciphertext_blocks;
+  std::vector<uint8_t *> token_blocks;
+  std::vector<uint8_t *> decrypted_blocks;
+  for (size_t i = 0; i < kBlockCount; i++) {
+    plaintext_blocks.push_back(plaintext.data() + i * kBlockLength);
+    ciphertext_blocks.push_back(ciphertext.data() +
+                                i * (kBlockLength + kTagLength));
+    token_blocks.push_back(tokens.data() + i * kTokenLength);
+    decrypted_blocks.push_back(decrypted.data() + i * kBlockLength);
+  }
+
+  ASSERT_TRUE(encryptor->EncryptBlocks(kBlockCount, plaintext_blocks.data(),
+                                       token_blocks.data(),
+                                       ciphertext_blocks.data()));
+
+  std::vector<const uint8_t *> const_ciphertext_blocks(
+      ciphertext_blocks.begin(), ciphertext_blocks.end());
+  std::vector<const uint8_t *> const_token_blocks(token_blocks.begin(),
+                                                  token_blocks.end());
+  ASSERT_TRUE(decryptor->DecryptBlocks(
+      kBlockCount, const_ciphertext_blocks.data(), const_token_blocks.data(),
+      decrypted_blocks.data()));
+  EXPECT_EQ(plaintext, decrypted);
+
+  uint8_t decryptor_buffer[kBlockLength];
+  ASSERT_TRUE(decryptor->DecryptBlock(ciphertext_blocks[kBlockCount - 1],
+                                      token_blocks[kBlockCount - 1],
+                                      decryptor_buffer));
+  EXPECT_EQ(memcmp(plaintext_blocks[kBlockCount - 1], decryptor_buffer,
+                   kBlockLength),
+            0);
+
+  // Altering any single block fails the whole batch.
+  ++ciphertext_blocks[kBlockCount / 2][0];
+  EXPECT_FALSE(decryptor->DecryptBlocks(
+      kBlockCount, const_ciphertext_blocks.data(), const_token_blocks.data(),
+      decrypted_blocks.data()));
+}
+
+// Tests decryption of blocks encrypted with more derived keys than a cryptor
+// caches contexts for, in an order alternating between derived keys.
+TEST(GcmCryptorTest, DecryptAcrossManyDerivedKeysSuccess) {
+  constexpr size_t kKeyCount = 20;
+  constexpr size_t kBlockCount = kKeyCount * kKeyIdCycle;
+  std::vector<uint8_t> plaintext(kBlockCount * kBlockLength);
+  std::vector<uint8_t> ciphertext(kBlockCount * (kBlockLength + kTagLength));
+  std::vector<uint8_t> tokens(kBlockCount * kTokenLength);
+  GcmCryptorKey key;
+  ASSERT_EQ(RAND_bytes(key.data(), key.size()), 1);
+  auto encryptor = GcmCryptor::Create(kBlockLength, key);
+  auto decryptor = GcmCryptor::Create(kBlockLength, key);
+  ASSERT_EQ(RAND_bytes(plaintext.data(), plaintext.size()), 1);
+
+  for (size_t i = 0; i < kBlockCount; i++) {
+    ASSERT_TRUE(encryptor->EncryptBlock(
+        plaintext.data() + i * kBlockLength, tokens.data() + i * kTokenLength,
+        ciphertext.data() + i * (kBlockLength + kTagLength)));
+  }
+
+  // Visit the blocks so that consecutive blocks use different derived keys,
+  // from both the encrypting and a fresh cryptor.
+  uint8_t decryptor_buffer[kBlockLength];
+  for (GcmCryptor *cryptor : {encryptor.get(), decryptor.get()}) {
+    for (size_t j = 0; j < kKeyIdCycle; j += 51) {
+      for (size_t k = 0; k < kKeyCount; k++) {
+        size_t i = k * kKeyIdCycle + j;
+        ASSERT_TRUE(cryptor->DecryptBlock(
+            ciphertext.data() + i * (kBlockLength + kTagLength),
+            tokens.data() + i * kTokenLength, decryptor_buffer));
+        EXPECT_EQ(memcmp(plaintext.data() + i * kBlockLength,
+                         decryptor_buffer, kBlockLength),
+                  0);
+      }
+    }
+  }
+}
+
 // Tests GCM cryptor registry returns consistent instance of GCM cryptor.
 TEST(GcmCryptorTest, GetGcmCryptorIsConsistent) {
   GcmCryptorKey key;
@@ -209,5 +303,20 @@ TEST(GcmCryptorTest, GetGcmCryptorIsConsistent) {
   EXPECT_EQ(c1, c2);
 }
 
+// Tests GCM cryptor registry distinguishes cryptors by block length.
+TEST(GcmCryptorTest, GetGcmCryptorIsPerBlockLength) {
+  GcmCryptorKey key;
+  ASSERT_EQ(RAND_bytes(key.data(), key.size()), 1);
+  GcmCryptor *c1 =
+      GcmCryptorRegistry::GetInstance().GetGcmCryptor(kBlockLength, key);
+  GcmCryptor *c2 =
+      GcmCryptorRegistry::GetInstance().GetGcmCryptor(4 * kBlockLength, key);
+
+  EXPECT_NE(c1, nullptr);
+  EXPECT_NE(c2, nullptr);
+
+  EXPECT_NE(c1, c2);
+}
+
 }  // namespace
 }  // namespace asylo
@@ -0,0 +1,155 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_HOST_CALL_EPOLL_EVENT_RING_H_
+#define ASYLO_PLATFORM_HOST_CALL_EPOLL_EVENT_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "asylo/platform/system_call/type_conversions/kernel_types.h"
+
+namespace asylo {
+namespace host_call {
+
+// A single-producer, single-consumer ring of epoll events shared between an
+// untrusted thread polling a host epoll instance and the enclave. The
+// untrusted thread pushes the events returned by the host epoll_wait, and the
+// enclave pops them without an enclave transition. Events are stored in the
+// kernel representation, with the data field holding the opaque key assigned
+// by the enclave when the file descriptor was registered.
+//
+// The ring lives in untrusted memory, so its contents must be treated as
+// attacker-controlled by trusted code. Indices are reduced modulo a capacity
+// fixed at compile time and the number of available events is clamped to the
+// capacity, so a corrupted ring cannot make the consumer access memory outside
+// the ring object itself. Popped events are copied out before they are
+// interpreted.
+class EpollEventRing {
+ public:
+  // Maximum number of events buffered in the ring.
+  static constexpr size_t kCapacity = 256;
+
+  static_assert((kCapacity & (kCapacity - 1)) == 0,
+                "kCapacity must be a power of two.");
+  static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t),
+                "std::atomic<int32_t> is not lock free.");
+
+  EpollEventRing()
+      : head_(0), tail_(0), sequence_(0), waiters_(0), closed_(0), error_(0) {}
+
+  EpollEventRing(const EpollEventRing &other) = delete;
+  EpollEventRing &operator=(const EpollEventRing &other) = delete;
+
+  // Producer interface.
+
+  // Returns the number of events that can be pushed without overwriting
+  // events not yet popped.
+  size_t Space() const {
+    return kCapacity - (tail_.load(std::memory_order_relaxed) -
+                        head_.load(std::memory_order_acquire));
+  }
+
+  // Appends the first |count| events of |events|, where |count| must not
+  // exceed Space(), and bumps the sequence word. Returns true if a consumer
+  // may be waiting on the sequence word and must be woken up.
+  bool Push(const struct klinux_epoll_event *events, size_t count) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count; i++) {
+      events_[(tail + i) % kCapacity] = events[i];
+    }
+    tail_.store(tail + count, std::memory_order_release);
+    sequence_.fetch_add(1, std::memory_order_seq_cst);
+    return waiters_.load(std::memory_order_seq_cst) != 0;
+  }
+
+  // Marks the ring as failed with the host |error|, which stops the consumer
+  // from relying on it.
+  void Fail(int32_t error) {
+    error_.store(error, std::memory_order_relaxed);
+    Close();
+  }
+
+  // Consumer interface.
+
+  // Copies up to |max_events| buffered events to |events|, and returns the
+  // number of events copied.
+  size_t Pop(struct klinux_epoll_event *events, size_t max_events) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    uint64_t available = tail_.load(std::memory_order_acquire) - head;
+    if (available > kCapacity) {
+      available = kCapacity;
+    }
+    size_t count = available < max_events ? available : max_events;
+    for (size_t i = 0; i < count; i++) {
+      events[i] = events_[(head + i) % kCapacity];
+    }
+    head_.store(head + count, std::memory_order_release);
+    return count;
+  }
+
+  // Returns true if the ring has buffered events.
+  bool HasEvents() const {
+    return tail_.load(std::memory_order_acquire) !=
+           head_.load(std::memory_order_relaxed);
+  }
+
+  // Returns the current value of the sequence word, which changes every time
+  // events are pushed or the ring is closed.
+  int32_t sequence() const { return sequence_.load(std::memory_order_seq_cst); }
+
+  // Returns the sequence word, suitable for a futex wait.
+  int32_t *sequence_word() { return reinterpret_cast<int32_t *>(&sequence_); }
+
+  // Registers and unregisters a consumer about to wait on the sequence word.
+  // A consumer must register, then check HasEvents() and IsClosed() again
+  // before waiting, so that a concurrent push is not missed.
+  void AddWaiter() { waiters_.fetch_add(1, std::memory_order_seq_cst); }
+  void RemoveWaiter() { waiters_.fetch_sub(1, std::memory_order_relaxed); }
+
+  // Shared interface.
+
+  // Signals the producer to stop. Returns true if a consumer may be waiting on
+  // the sequence word and must be woken up.
+  bool Close() {
+    closed_.store(1, std::memory_order_release);
+    sequence_.fetch_add(1, std::memory_order_seq_cst);
+    return waiters_.load(std::memory_order_seq_cst) != 0;
+  }
+
+  // Returns true if the ring has been closed.
+  bool IsClosed() const { return closed_.load(std::memory_order_acquire); }
+
+  // Returns the host errno which made the producer fail, or 0.
+  int32_t error() const { return error_.load(std::memory_order_relaxed); }
+
+ private:
+  struct klinux_epoll_event events_[kCapacity];
+  std::atomic<uint64_t> head_;
+  std::atomic<uint64_t> tail_;
+  std::atomic<int32_t> sequence_;
+  std::atomic<int32_t> waiters_;
+  std::atomic<uint32_t> closed_;
+  std::atomic<int32_t> error_;
+};
+
+}  // namespace host_call
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_HOST_CALL_EPOLL_EVENT_RING_H_
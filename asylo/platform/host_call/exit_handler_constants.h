@@ -139,9 +139,54 @@ static constexpr uint64_t kSysFutexWakeHandler =
 static constexpr uint64_t kLocalLifetimeAllocHandler =
     primitives::kSelectorHostCall + 30;
 
+// Exit handler constant for |BatchHandler|.
+static constexpr uint64_t kBatchHandler = primitives::kSelectorHostCall + 31;
+
+// Exit handler constant for |EpollEventRingStartHandler|.
+static constexpr uint64_t kEpollEventRingStartHandler =
+    primitives::kSelectorHostCall + 32;
+
+// Exit handler constant for |EpollEventRingStopHandler|.
+static constexpr uint64_t kEpollEventRingStopHandler =
+    primitives::kSelectorHostCall + 33;
+
+// Exit handler constant for |IoUringHandler|.
+static constexpr uint64_t kIoUringHandler = primitives::kSelectorHostCall + 34;
+
+// Exit handler constant for |WritevHandler|.
+static constexpr uint64_t kWritevHandler = primitives::kSelectorHostCall + 35;
+
+// Exit handler constant for |ReadvHandler|.
+static constexpr uint64_t kReadvHandler = primitives::kSelectorHostCall + 36;
+
+// Exit handler constant for |SendMmsgHandler|.
+static constexpr uint64_t kSendMmsgHandler =
+    primitives::kSelectorHostCall + 37;
+
+// Exit handler constant for |RecvMmsgHandler|.
+static constexpr uint64_t kRecvMmsgHandler =
+    primitives::kSelectorHostCall + 38;
+
+// Exit handler constant for |PollSetHandler|.
+static constexpr uint64_t kPollSetHandler = primitives::kSelectorHostCall + 39;
+
+// Exit handler constant for |InotifyReadBatchHandler|.
+static constexpr uint64_t kInotifyReadBatchHandler =
+    primitives::kSelectorHostCall + 40;
+
+// Exit handler constant for |PReadvHandler|.
+static constexpr uint64_t kPReadvHandler = primitives::kSelectorHostCall + 41;
+
+// Exit handler constant for |PWritevHandler|.
+static constexpr uint64_t kPWritevHandler = primitives::kSelectorHostCall + 42;
+
+// Exit handler constant for |Accept4BatchHandler|.
+static constexpr uint64_t kAccept4BatchHandler =
+    primitives::kSelectorHostCall + 43;
+
 // Assert that the largest host call handler lies in
 // [kSelectorHostCall, kSelectorRemote).
-static_assert(kLocalLifetimeAllocHandler < primitives::kSelectorRemote,
+static_assert(kAccept4BatchHandler < primitives::kSelectorRemote,
               "Cannot have host call handler constant spill over into "
               "|kSelectorRemote|.");
 
@@ -0,0 +1,61 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_HOST_CALL_HOST_CALL_RESULT_H_
+#define ASYLO_PLATFORM_HOST_CALL_HOST_CALL_RESULT_H_
+
+#include <errno.h>
+
+#include <cstdint>
+
+#include "absl/base/optimization.h"
+#include "asylo/platform/system_call/type_conversions/types_functions.h"
+
+namespace asylo {
+namespace host_call {
+
+// Host calls returning a scalar which is non-negative on success and -1 with
+// errno set on failure report their outcome in a single result word, as the
+// Linux system call ABI does: a non-negative word is the return value of a
+// successful call, and a negative word is the negated kLinux errno of a failed
+// call. The enclave then only reads and translates an errno when a call fails.
+
+// Returns the result word of a host call which returned |result| with the host
+// errno |klinux_errno|. A failure which left no errno is reported as EIO.
+inline int64_t EncodeHostCallResult(int64_t result, int klinux_errno) {
+  if (result >= 0) {
+    return result;
+  }
+  return klinux_errno > 0 ? -static_cast<int64_t>(klinux_errno)
+                          : -static_cast<int64_t>(kLinux_EIO);
+}
+
+// Returns the return value of a host call from its result word |word|, which
+// is -1 with errno set if the call failed.
+inline int64_t DecodeHostCallResult(int64_t word) {
+  if (ABSL_PREDICT_TRUE(word >= 0)) {
+    return word;
+  }
+  errno = FromkLinuxErrorNumber(static_cast<int>(-word));
+  return -1;
+}
+
+}  // namespace host_call
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_HOST_CALL_HOST_CALL_RESULT_H_
@@ -0,0 +1,111 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_HOST_CALL_IO_URING_ABI_H_
+#define ASYLO_PLATFORM_HOST_CALL_IO_URING_ABI_H_
+
+#include <cstdint>
+
+namespace asylo {
+namespace host_call {
+
+// Kernel io_uring ABI, as defined by linux/io_uring.h. The definitions are
+// duplicated here since the enclave toolchain does not provide Linux headers.
+// Only the fields and constants used by the enclave are named.
+
+// A submission queue entry.
+struct klinux_io_uring_sqe {
+  uint8_t opcode;
+  uint8_t flags;
+  uint16_t ioprio;
+  int32_t fd;
+  uint64_t off;
+  uint64_t addr;
+  uint32_t len;
+  uint32_t op_flags;
+  uint64_t user_data;
+  uint16_t buf_index;
+  uint16_t personality;
+  int32_t splice_fd_in;
+  uint64_t pad[2];
+};
+
+static_assert(sizeof(klinux_io_uring_sqe) == 64,
+              "klinux_io_uring_sqe does not match the kernel layout.");
+
+// A completion queue entry.
+struct klinux_io_uring_cqe {
+  uint64_t user_data;
+  int32_t res;
+  uint32_t flags;
+};
+
+static_assert(sizeof(klinux_io_uring_cqe) == 16,
+              "klinux_io_uring_cqe does not match the kernel layout.");
+
+// Operation codes.
+constexpr uint8_t kLinuxIoUringOpNop = 0;
+constexpr uint8_t kLinuxIoUringOpRead = 22;
+constexpr uint8_t kLinuxIoUringOpWrite = 23;
+constexpr uint8_t kLinuxIoUringOpSend = 26;
+constexpr uint8_t kLinuxIoUringOpRecv = 27;
+
+// Submission queue flags set by the kernel.
+constexpr uint32_t kLinuxIoUringSqNeedWakeup = 1U << 0;
+
+// io_uring_enter flags.
+constexpr uint32_t kLinuxIoUringEnterGetEvents = 1U << 0;
+constexpr uint32_t kLinuxIoUringEnterSqWakeup = 1U << 1;
+
+// Location of the rings of an io_uring instance mapped into untrusted memory,
+// as reported by the host to the enclave. All pointers refer to untrusted
+// memory shared with the kernel.
+struct IoUringQueues {
+  uint32_t *sq_head;
+  uint32_t *sq_tail;
+  uint32_t *sq_flags;
+  uint32_t *sq_array;
+  klinux_io_uring_sqe *sqes;
+  uint32_t sq_entries;
+
+  uint32_t *cq_head;
+  uint32_t *cq_tail;
+  klinux_io_uring_cqe *cqes;
+  uint32_t cq_entries;
+
+  // Non-zero if a kernel thread polls the submission queue, in which case
+  // submitting entries does not require io_uring_enter.
+  uint32_t sq_polling;
+};
+
+// Operations of the io_uring host call handler.
+enum IoUringHostOperation : int32_t {
+  // Expects [uint32_t entries] and returns [int result, int errno, uint64_t
+  // instance, IoUringQueues queues].
+  kIoUringSetup = 0,
+  // Expects [uint64_t instance, uint32_t to_submit, uint32_t min_complete,
+  // uint32_t flags] and returns [int result, int errno].
+  kIoUringEnter = 1,
+  // Expects [uint64_t instance] and returns [int result].
+  kIoUringDestroy = 2,
+};
+
+}  // namespace host_call
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_HOST_CALL_IO_URING_ABI_H_
@@ -20,6 +20,11 @@
 
 #include <ifaddrs.h>
 
+#include <cstring>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
 #include "asylo/platform/system_call/type_conversions/types_functions.h"
 #include "asylo/util/status_macros.h"
 
@@ -464,5 +469,80 @@ bool DeserializeInotifyEvents(const char *buf, size_t buf_len,
   return true;
 }
 
+size_t CoalesceInotifyEvents(char *buf, size_t buf_len) {
+  // Mask of the last event kept for each watched object, or 0 if that event
+  // carried a cookie. Names are viewed in the kept events, which are not moved
+  // again once written.
+  absl::flat_hash_map<std::pair<int32_t, absl::string_view>, uint32_t>
+      last_masks;
+  size_t in = 0;
+  size_t out = 0;
+  while (buf_len - in >= sizeof(struct inotify_event)) {
+    struct inotify_event event;
+    memcpy(&event, buf + in, sizeof(event));
+    size_t event_len = sizeof(struct inotify_event) + event.len;
+    if (event_len > buf_len - in) {
+      break;
+    }
+    const char *name = buf + in + sizeof(struct inotify_event);
+    size_t name_len = strnlen(name, event.len);
+    auto it = last_masks.find(
+        std::make_pair(event.wd, absl::string_view(name, name_len)));
+    if (event.cookie == 0 && it != last_masks.end() &&
+        it->second == event.mask) {
+      in += event_len;
+      continue;
+    }
+
+    struct klinux_inotify_event klinux_event;
+    klinux_event.klinux_wd = event.wd;
+    klinux_event.klinux_mask = TokLinuxInotifyEventMask(event.mask);
+    klinux_event.klinux_cookie = event.cookie;
+    klinux_event.klinux_len = event.len;
+    char *kept_name = buf + out + sizeof(klinux_event);
+    memmove(kept_name, name, event.len);
+    memcpy(buf + out, &klinux_event, sizeof(klinux_event));
+
+    uint32_t last_mask = event.cookie == 0 ? event.mask : 0;
+    if (it != last_masks.end()) {
+      it->second = last_mask;
+    } else {
+      last_masks.emplace(
+          std::make_pair(event.wd, absl::string_view(kept_name, name_len)),
+          last_mask);
+    }
+    in += event_len;
+    out += event_len;
+  }
+  return out;
+}
+
+bool FromkLinuxInotifyEvents(char *buf, size_t buf_len) {
+  static_assert(
+      sizeof(struct inotify_event) == sizeof(struct klinux_inotify_event),
+      "inotify_event and klinux_inotify_event differ in size.");
+  size_t offset = 0;
+  while (offset < buf_len) {
+    struct klinux_inotify_event klinux_event;
+    if (buf_len - offset < sizeof(klinux_event)) {
+      return false;
+    }
+    memcpy(&klinux_event, buf + offset, sizeof(klinux_event));
+    offset += sizeof(klinux_event);
+    if (klinux_event.klinux_len > buf_len - offset) {
+      return false;
+    }
+
+    struct inotify_event event;
+    event.wd = klinux_event.klinux_wd;
+    event.mask = FromkLinuxInotifyEventMask(klinux_event.klinux_mask);
+    event.cookie = klinux_event.klinux_cookie;
+    event.len = klinux_event.klinux_len;
+    memcpy(buf + offset - sizeof(event), &event, sizeof(event));
+    offset += event.len;
+  }
+  return true;
+}
+
 }  // namespace host_call
 }  // namespace asylo
@@ -84,6 +84,19 @@ bool SerializenotifyEvents(const char *buf, size_t buf_len, char **out,
 bool DeserializeInotifyEvents(const char *buf, size_t buf_len,
                               std::queue<struct inotify_event *> *events);
 
+// Converts the inotify events in |buf|, as returned by a host read of
+// |buf_len| bytes, to klinux_inotify_event records in place and returns the
+// number of bytes left holding them. An event is dropped if the last event
+// kept for the same watch descriptor and name is identical to it, so that
+// bursts of events on the same object collapse into one. Events carrying a
+// cookie are never dropped.
+size_t CoalesceInotifyEvents(char *buf, size_t buf_len);
+
+// Converts the klinux_inotify_event records in |buf|, as produced by
+// CoalesceInotifyEvents, to inotify_event structs in place. Returns false if
+// the records do not exactly fill the |buf_len| bytes of the buffer.
+bool FromkLinuxInotifyEvents(char *buf, size_t buf_len);
+
 }  // namespace host_call
 }  // namespace asylo
 
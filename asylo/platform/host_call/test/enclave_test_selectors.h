@@ -153,6 +153,11 @@ constexpr uint64_t kTestRaise = kHostLibCSelector + 11;
 constexpr uint64_t kTestGetSockOpt = kHostLibCSelector + 12;
 constexpr uint64_t kTestGetAddrInfo = kHostLibCSelector + 13;
 constexpr uint64_t kTestClockGettime = kHostLibCSelector + 14;
+constexpr uint64_t kTestWritev = kHostLibCSelector + 15;
+constexpr uint64_t kTestReadv = kHostLibCSelector + 16;
+constexpr uint64_t kTestSendMmsg = kHostLibCSelector + 17;
+constexpr uint64_t kTestRecvMmsg = kHostLibCSelector + 18;
+constexpr uint64_t kTestPollSet = kHostLibCSelector + 19;
 
 }  // namespace host_call
 }  // namespace asylo
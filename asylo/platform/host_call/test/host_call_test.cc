@@ -754,6 +754,109 @@ TEST_F(HostCallTest, TestRename) {
   EXPECT_NE(access(newpath.c_str(), F_OK), -1);
 }
 
+// Tests enc_untrusted_writev() by writing two buffers to a pipe from inside
+// the enclave, and verifying that they are read back in order on the host.
+TEST_F(HostCallTest, TestWritev) {
+  int fds[2];
+  ASSERT_THAT(pipe(fds), Eq(0));
+
+  constexpr char kBuf1[] = "first";
+  constexpr char kBuf2[] = "second";
+  MessageWriter in;
+  in.Push<int>(/*value=fd=*/fds[1]);
+  in.PushByReference(Extent{kBuf1, strlen(kBuf1)});
+  in.PushByReference(Extent{kBuf2, strlen(kBuf2)});
+  MessageReader out;
+  ASYLO_ASSERT_OK(client_->EnclaveCall(kTestWritev, &in, &out));
+  ASSERT_THAT(out, SizeIs(1));
+  EXPECT_THAT(out.next<ssize_t>(), Eq(strlen(kBuf1) + strlen(kBuf2)));
+
+  char read_buf[32] = {};
+  EXPECT_THAT(read(fds[0], read_buf, sizeof(read_buf)),
+              Eq(strlen(kBuf1) + strlen(kBuf2)));
+  EXPECT_THAT(read_buf, StrEq("firstsecond"));
+  close(fds[0]);
+  close(fds[1]);
+}
+
+// Tests enc_untrusted_readv() by reading from a pipe into two buffers inside
+// the enclave, and verifying that the data is scattered across them in order.
+TEST_F(HostCallTest, TestReadv) {
+  int fds[2];
+  ASSERT_THAT(pipe(fds), Eq(0));
+  constexpr char kData[] = "firstsecond";
+  ASSERT_THAT(write(fds[1], kData, strlen(kData)), Eq(strlen(kData)));
+
+  MessageWriter in;
+  in.Push<int>(/*value=fd=*/fds[0]);
+  in.Push<size_t>(/*value=len1=*/5);
+  in.Push<size_t>(/*value=len2=*/6);
+  MessageReader out;
+  ASYLO_ASSERT_OK(client_->EnclaveCall(kTestReadv, &in, &out));
+  ASSERT_THAT(out, SizeIs(3));
+  EXPECT_THAT(out.next<ssize_t>(), Eq(strlen(kData)));
+  auto buf1 = out.next();
+  auto buf2 = out.next();
+  EXPECT_THAT(std::string(buf1.As<char>(), buf1.size()), StrEq("first"));
+  EXPECT_THAT(std::string(buf2.As<char>(), buf2.size()), StrEq("second"));
+  close(fds[0]);
+  close(fds[1]);
+}
+
+// Tests enc_untrusted_sendmmsg() by sending two datagrams in a single host call
+// from inside the enclave, and verifying that both are received on the host.
+TEST_F(HostCallTest, TestSendMmsg) {
+  int fds[2];
+  ASSERT_THAT(socketpair(AF_UNIX, SOCK_DGRAM, 0, fds), Eq(0));
+
+  constexpr char kMsg1[] = "first";
+  constexpr char kMsg2[] = "second";
+  MessageWriter in;
+  in.Push<int>(/*value=sockfd=*/fds[1]);
+  in.PushByReference(Extent{kMsg1, strlen(kMsg1)});
+  in.PushByReference(Extent{kMsg2, strlen(kMsg2)});
+  MessageReader out;
+  ASYLO_ASSERT_OK(client_->EnclaveCall(kTestSendMmsg, &in, &out));
+  ASSERT_THAT(out, SizeIs(3));
+  EXPECT_THAT(out.next<int>(), Eq(2));
+  EXPECT_THAT(out.next<uint32_t>(), Eq(strlen(kMsg1)));
+  EXPECT_THAT(out.next<uint32_t>(), Eq(strlen(kMsg2)));
+
+  char read_buf[32] = {};
+  EXPECT_THAT(recv(fds[0], read_buf, sizeof(read_buf), 0), Eq(strlen(kMsg1)));
+  EXPECT_THAT(read_buf, StrEq(kMsg1));
+  memset(read_buf, 0, sizeof(read_buf));
+  EXPECT_THAT(recv(fds[0], read_buf, sizeof(read_buf), 0), Eq(strlen(kMsg2)));
+  EXPECT_THAT(read_buf, StrEq(kMsg2));
+  close(fds[0]);
+  close(fds[1]);
+}
+
+// Tests enc_untrusted_recvmmsg() by receiving two datagrams sent from the host
+// in a single host call from inside the enclave.
+TEST_F(HostCallTest, TestRecvMmsg) {
+  int fds[2];
+  ASSERT_THAT(socketpair(AF_UNIX, SOCK_DGRAM, 0, fds), Eq(0));
+  constexpr char kMsg1[] = "first";
+  constexpr char kMsg2[] = "second";
+  ASSERT_THAT(send(fds[1], kMsg1, strlen(kMsg1), 0), Eq(strlen(kMsg1)));
+  ASSERT_THAT(send(fds[1], kMsg2, strlen(kMsg2), 0), Eq(strlen(kMsg2)));
+
+  MessageWriter in;
+  in.Push<int>(/*value=sockfd=*/fds[0]);
+  in.Push<size_t>(/*value=len=*/32);
+  MessageReader out;
+  ASYLO_ASSERT_OK(client_->EnclaveCall(kTestRecvMmsg, &in, &out));
+  ASSERT_THAT(out, SizeIs(3));
+  EXPECT_THAT(out.next<int>(), Eq(2));
+  auto msg1 = out.next();
+  auto msg2 = out.next();
+  EXPECT_THAT(std::string(msg1.As<char>(), msg1.size()), StrEq(kMsg1));
+  EXPECT_THAT(std::string(msg2.As<char>(), msg2.size()), StrEq(kMsg2));
+  close(fds[0]);
+  close(fds[1]);
+}
+
 // Tests enc_untrusted_read() by making a host call from inside the enclave and
 // verifying that what is read on untrusted side is identical to what is read
 // from inside the enclave for a provided file.
@@ -2407,6 +2510,30 @@ TEST_F(HostCallTest, TestPoll) {
   EXPECT_THAT(fds_out[1].revents, Eq(fds_expected[1].revents));
 }
 
+// Tests PollSet by polling both ends of a pipe from inside the enclave, before
+// and after data is written to it, and after shrinking the set.
+TEST_F(HostCallTest, TestPollSet) {
+  int pipe_fds[2];
+  ASSERT_THAT(pipe(pipe_fds), Eq(0));
+
+  MessageWriter in;
+  in.Push<int>(/*value=read_fd=*/pipe_fds[0]);
+  in.Push<int>(/*value=write_fd=*/pipe_fds[1]);
+  MessageReader out;
+  ASYLO_ASSERT_OK(client_->EnclaveCall(kTestPollSet, &in, &out));
+  ASSERT_THAT(out, SizeIs(8));
+  EXPECT_THAT(out.next<int>(), Eq(1));
+  EXPECT_THAT(out.next<short>(), Eq(0));
+  EXPECT_THAT(out.next<short>(), Eq(POLLOUT));
+  EXPECT_THAT(out.next<int>(), Eq(2));
+  EXPECT_THAT(out.next<short>(), Eq(POLLIN));
+  EXPECT_THAT(out.next<short>(), Eq(POLLOUT));
+  EXPECT_THAT(out.next<int>(), Eq(1));
+  EXPECT_THAT(out.next<short>(), Eq(POLLIN));
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+}
+
 // Tests enc_untrusted_utime() by updating the access and modification times of
 // a file from inside the enclave and verifying on the host that stat reflects
 // the updated access and modification times.
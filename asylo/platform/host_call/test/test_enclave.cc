@@ -18,18 +18,21 @@
 
 #include <errno.h>
 #include <netdb.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/statfs.h>
 #include <sys/un.h>
 #include <sys/wait.h>
 
+#include <memory>
 #include <vector>
 
 #include "absl/base/macros.h"
 #include "asylo/platform/host_call/test/enclave_test_selectors.h"
 #include "asylo/platform/host_call/trusted/host_call_dispatcher.h"
 #include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/platform/host_call/trusted/poll_set.h"
 #include "asylo/platform/primitives/primitive_status.h"
 #include "asylo/platform/primitives/trusted_primitives.h"
 #include "asylo/platform/primitives/trusted_runtime.h"
@@ -226,6 +229,42 @@ PrimitiveStatus TestWrite(void *context, MessageReader *in,
   return PrimitiveStatus::OkStatus();
 }
 
+PrimitiveStatus TestWritev(void *context, MessageReader *in,
+                           MessageWriter *out) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 3);
+  int fd = in->next<int>();
+  const auto buf1 = in->next();
+  const auto buf2 = in->next();
+
+  struct iovec iov[2];
+  iov[0].iov_base = const_cast<char *>(buf1.As<char>());
+  iov[0].iov_len = buf1.size();
+  iov[1].iov_base = const_cast<char *>(buf2.As<char>());
+  iov[1].iov_len = buf2.size();
+  out->Push<int64_t>(enc_untrusted_writev(fd, iov, 2));
+  return PrimitiveStatus::OkStatus();
+}
+
+PrimitiveStatus TestReadv(void *context, MessageReader *in,
+                          MessageWriter *out) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 3);
+  int fd = in->next<int>();
+  size_t len1 = in->next<size_t>();
+  size_t len2 = in->next<size_t>();
+  std::unique_ptr<char[]> buf1(new char[len1]);
+  std::unique_ptr<char[]> buf2(new char[len2]);
+
+  struct iovec iov[2];
+  iov[0].iov_base = buf1.get();
+  iov[0].iov_len = len1;
+  iov[1].iov_base = buf2.get();
+  iov[1].iov_len = len2;
+  out->Push<int64_t>(enc_untrusted_readv(fd, iov, 2));
+  out->PushByCopy(Extent{buf1.get(), len1});
+  out->PushByCopy(Extent{buf2.get(), len2});
+  return PrimitiveStatus::OkStatus();
+}
+
 PrimitiveStatus TestSymlink(void *context, MessageReader *in,
                             MessageWriter *out) {
   ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 2);
@@ -400,6 +439,58 @@ PrimitiveStatus TestRecvMsg(void *context, MessageReader *in,
   return primitives::PrimitiveStatus::OkStatus();
 }
 
+PrimitiveStatus TestSendMmsg(void *context, MessageReader *in,
+                             MessageWriter *out) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 3);
+  int sockfd = in->next<int>();
+  const auto msg1 = in->next();
+  const auto msg2 = in->next();
+
+  struct iovec msg_iov[2];
+  msg_iov[0].iov_base = const_cast<char *>(msg1.As<char>());
+  msg_iov[0].iov_len = msg1.size();
+  msg_iov[1].iov_base = const_cast<char *>(msg2.As<char>());
+  msg_iov[1].iov_len = msg2.size();
+
+  struct mmsghdr msgvec[2];
+  memset(msgvec, 0, sizeof(msgvec));
+  for (int i = 0; i < 2; ++i) {
+    msgvec[i].msg_hdr.msg_iov = &msg_iov[i];
+    msgvec[i].msg_hdr.msg_iovlen = 1;
+  }
+  out->Push<int>(enc_untrusted_sendmmsg(sockfd, msgvec, 2, /*flags=*/0));
+  out->Push<uint32_t>(msgvec[0].msg_len);
+  out->Push<uint32_t>(msgvec[1].msg_len);
+  return PrimitiveStatus::OkStatus();
+}
+
+PrimitiveStatus TestRecvMmsg(void *context, MessageReader *in,
+                             MessageWriter *out) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 2);
+  int sockfd = in->next<int>();
+  size_t len = in->next<size_t>();
+
+  std::unique_ptr<char[]> buf1(new char[len]);
+  std::unique_ptr<char[]> buf2(new char[len]);
+  struct iovec msg_iov[2];
+  msg_iov[0].iov_base = buf1.get();
+  msg_iov[0].iov_len = len;
+  msg_iov[1].iov_base = buf2.get();
+  msg_iov[1].iov_len = len;
+
+  struct mmsghdr msgvec[2];
+  memset(msgvec, 0, sizeof(msgvec));
+  for (int i = 0; i < 2; ++i) {
+    msgvec[i].msg_hdr.msg_iov = &msg_iov[i];
+    msgvec[i].msg_hdr.msg_iovlen = 1;
+  }
+  out->Push<int>(enc_untrusted_recvmmsg(sockfd, msgvec, 2, /*flags=*/0,
+                                        /*timeout=*/nullptr));
+  out->PushByCopy(Extent{buf1.get(), msgvec[0].msg_len});
+  out->PushByCopy(Extent{buf2.get(), msgvec[1].msg_len});
+  return PrimitiveStatus::OkStatus();
+}
+
 PrimitiveStatus TestFcntl(void *context, MessageReader *in,
                           MessageWriter *out) {
   ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 3);
@@ -956,6 +1047,41 @@ PrimitiveStatus TestPoll(void *context, MessageReader *in, MessageWriter *out) {
   return PrimitiveStatus::OkStatus();
 }
 
+PrimitiveStatus TestPollSet(void *context, MessageReader *in,
+                            MessageWriter *out) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 2);
+  int read_fd = in->next<int>();
+  int write_fd = in->next<int>();
+
+  PollSet poll_set;
+  if (!poll_set.Resize(2)) {
+    return {error::GoogleError::RESOURCE_EXHAUSTED,
+            "TestPollSet: Couldn't allocate the poll set"};
+  }
+  poll_set.Set(0, read_fd, POLLIN);
+  poll_set.Set(1, write_fd, POLLOUT);
+  out->Push<int>(poll_set.Poll(/*timeout=*/0));
+  out->Push<short>(poll_set.revents(0));
+  out->Push<short>(poll_set.revents(1));
+
+  // Poll the unchanged entries again once the pipe has data to read.
+  if (enc_untrusted_write(write_fd, "x", 1) != 1) {
+    return {error::GoogleError::INTERNAL,
+            "TestPollSet: Couldn't write to the pipe"};
+  }
+  poll_set.Set(0, read_fd, POLLIN);
+  poll_set.Set(1, write_fd, POLLOUT);
+  out->Push<int>(poll_set.Poll(/*timeout=*/0));
+  out->Push<short>(poll_set.revents(0));
+  out->Push<short>(poll_set.revents(1));
+
+  // Shrink the set to the read end only.
+  poll_set.Resize(1);
+  out->Push<int>(poll_set.Poll(/*timeout=*/0));
+  out->Push<short>(poll_set.revents(0));
+  return PrimitiveStatus::OkStatus();
+}
+
 PrimitiveStatus TestUtime(void *context, MessageReader *in,
                           MessageWriter *out) {
   ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 2);
@@ -1210,6 +1336,17 @@ extern "C" PrimitiveStatus asylo_enclave_init() {
   ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
       asylo::host_call::kTestClockGettime,
       EntryHandler{asylo::host_call::TestClockGettime}));
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      asylo::host_call::kTestWritev,
+      EntryHandler{asylo::host_call::TestWritev}));
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      asylo::host_call::kTestReadv, EntryHandler{asylo::host_call::TestReadv}));
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      asylo::host_call::kTestSendMmsg,
+      EntryHandler{asylo::host_call::TestSendMmsg}));
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      asylo::host_call::kTestRecvMmsg,
+      EntryHandler{asylo::host_call::TestRecvMmsg}));
   ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
       asylo::host_call::kTestBind, EntryHandler{asylo::host_call::TestBind}));
   ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
@@ -1236,6 +1373,9 @@ extern "C" PrimitiveStatus asylo_enclave_init() {
       EntryHandler{asylo::host_call::TestGetAddrInfo}));
   ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
       asylo::host_call::kTestPoll, EntryHandler{asylo::host_call::TestPoll}));
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      asylo::host_call::kTestPollSet,
+      EntryHandler{asylo::host_call::TestPollSet}));
   ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
       asylo::host_call::kTestUtime, EntryHandler{asylo::host_call::TestUtime}));
   ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
@@ -19,11 +19,14 @@
 #include <errno.h>
 
 #include "asylo/platform/host_call/exit_handler_constants.h"
+#include "asylo/platform/host_call/host_call_result.h"
 #include "asylo/platform/host_call/trusted/host_call_dispatcher.h"
 #include "asylo/platform/host_call/trusted/host_calls.h"
 #include "asylo/platform/primitives/trusted_primitives.h"
 #include "asylo/platform/system_call/type_conversions/types_functions.h"
 
+using ::asylo::host_call::BlockingNonSystemCallDispatcher;
+using ::asylo::host_call::DecodeHostCallResult;
 using ::asylo::host_call::NonSystemCallDispatcher;
 using ::asylo::primitives::MessageReader;
 using ::asylo::primitives::MessageWriter;
@@ -47,19 +50,14 @@ int enc_untrusted_sys_futex_wait(int32_t *futex, int32_t expected,
   input.Push<uint64_t>(reinterpret_cast<uint64_t>(futex));
   input.Push<int32_t>(expected);
   input.Push<int64_t>(timeout_microsec);
-  const auto status = NonSystemCallDispatcher(
+  const auto status = BlockingNonSystemCallDispatcher(
       ::asylo::host_call::kSysFutexWaitHandler, &input, &output);
-  CheckStatusAndParamCount(status, output, "enc_untrusted_sys_futex_wait", 2);
-  int result = output.next<int>();
-  int klinux_errno = output.next<int>();
+  CheckStatusAndParamCount(status, output, "enc_untrusted_sys_futex_wait", 1);
 
   // If FUTEX_WAIT successfully causes the thread to be suspended in the kernel,
-  // it returns a zero when the caller is woken up. Otherwise, it returns the
-  // appropriate errno.
-  if (result != 0) {
-    errno = FromkLinuxErrorNumber(klinux_errno);
-  }
-  return result;
+  // it returns a zero when the caller is woken up. Otherwise, it returns -1
+  // with errno set.
+  return DecodeHostCallResult(output.next<int64_t>());
 }
 
 int enc_untrusted_sys_futex_wake(int32_t *futex, int32_t num) {
@@ -75,13 +73,8 @@ int enc_untrusted_sys_futex_wake(int32_t *futex, int32_t num) {
   input.Push<int32_t>(num);
   const auto status = NonSystemCallDispatcher(
       ::asylo::host_call::kSysFutexWakeHandler, &input, &output);
-  CheckStatusAndParamCount(status, output, "enc_untrusted_sys_futex_wake", 2);
-  int result = output.next<int>();
-  int klinux_errno = output.next<int>();
-  if (result == -1) {
-    errno = FromkLinuxErrorNumber(klinux_errno);
-  }
-  return result;
+  CheckStatusAndParamCount(status, output, "enc_untrusted_sys_futex_wake", 1);
+  return DecodeHostCallResult(output.next<int64_t>());
 }
 
 int32_t *enc_untrusted_create_wait_queue() {
@@ -123,6 +116,12 @@ void enc_untrusted_enable_waiting(int32_t *const queue) {
   enc_untrusted_wait_queue_set_value(queue, kWaitQueueEnabled);
 }
 
+bool enc_untrusted_is_waiting_enabled(int32_t *const queue) {
+  int32_t value;
+  TrustedPrimitives::UntrustedLocalMemcpy(&value, queue, sizeof(int32_t));
+  return value == kWaitQueueEnabled;
+}
+
 void enc_untrusted_wait_queue_set_value(int32_t *const queue, int32_t value) {
   TrustedPrimitives::UntrustedLocalMemcpy(queue, &value, sizeof(int32_t));
 }
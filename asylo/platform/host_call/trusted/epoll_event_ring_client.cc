@@ -0,0 +1,127 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/host_call/trusted/epoll_event_ring_client.h"
+
+#include <cstring>
+#include <limits>
+
+#include "asylo/platform/host_call/exit_handler_constants.h"
+#include "asylo/platform/host_call/trusted/host_call_dispatcher.h"
+#include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/platform/primitives/trusted_primitives.h"
+#include "asylo/platform/system_call/type_conversions/types_functions.h"
+
+namespace asylo {
+namespace host_call {
+
+using primitives::Extent;
+using primitives::MessageReader;
+using primitives::MessageWriter;
+using primitives::TrustedPrimitives;
+
+std::unique_ptr<EpollEventRingClient> EpollEventRingClient::Create(int epfd) {
+  MessageWriter input;
+  MessageReader output;
+  input.Push<int>(epfd);
+  const auto status =
+      NonSystemCallDispatcher(kEpollEventRingStartHandler, &input, &output);
+  if (!status.ok() || output.size() != 1) {
+    return nullptr;
+  }
+  auto *ring = reinterpret_cast<EpollEventRing *>(output.next<uintptr_t>());
+  if (!ring) {
+    return nullptr;
+  }
+  if (!TrustedPrimitives::IsOutsideEnclave(ring, sizeof(EpollEventRing))) {
+    TrustedPrimitives::BestEffortAbort(
+        "EpollEventRingClient: epoll event ring should be in untrusted local "
+        "memory.");
+  }
+  return std::unique_ptr<EpollEventRingClient>(new EpollEventRingClient(ring));
+}
+
+EpollEventRingClient::~EpollEventRingClient() {
+  if (ring_) {
+    std::vector<struct epoll_event> events;
+    Stop(&events);
+  }
+}
+
+int EpollEventRingClient::Pop(struct epoll_event *events, int max_events) {
+  struct klinux_epoll_event klinux_events[EpollEventRing::kCapacity];
+  int count = 0;
+  while (count < max_events) {
+    size_t batch = static_cast<size_t>(max_events - count);
+    if (batch > EpollEventRing::kCapacity) {
+      batch = EpollEventRing::kCapacity;
+    }
+    size_t popped = ring_->Pop(klinux_events, batch);
+    for (size_t i = 0; i < popped; i++) {
+      if (FromkLinuxEpollEvent(&klinux_events[i], &events[count])) {
+        count++;
+      }
+    }
+    if (popped < batch) {
+      break;
+    }
+  }
+  return count;
+}
+
+void EpollEventRingClient::Wait(int64_t timeout_microsec) {
+  int32_t sequence = ring_->sequence();
+  ring_->AddWaiter();
+  if (!ring_->HasEvents() && !ring_->IsClosed()) {
+    enc_untrusted_sys_futex_wait(ring_->sequence_word(), sequence,
+                                 timeout_microsec);
+  }
+  ring_->RemoveWaiter();
+}
+
+void EpollEventRingClient::Close() {
+  if (ring_->Close()) {
+    enc_untrusted_sys_futex_wake(ring_->sequence_word(),
+                                 std::numeric_limits<int32_t>::max());
+  }
+}
+
+void EpollEventRingClient::Stop(std::vector<struct epoll_event> *events) {
+  MessageWriter input;
+  MessageReader output;
+  input.Push<uintptr_t>(reinterpret_cast<uintptr_t>(ring_));
+  ring_ = nullptr;
+  const auto status =
+      NonSystemCallDispatcher(kEpollEventRingStopHandler, &input, &output);
+  CheckStatusAndParamCount(status, output, "EpollEventRingClient::Stop", 2);
+  output.next<int>();
+  Extent leftover = output.next();
+  size_t count = leftover.size() / sizeof(struct klinux_epoll_event);
+  const auto *klinux_events = leftover.As<struct klinux_epoll_event>();
+  for (size_t i = 0; i < count; i++) {
+    struct klinux_epoll_event klinux_event;
+    memcpy(&klinux_event, &klinux_events[i], sizeof(klinux_event));
+    struct epoll_event event;
+    if (FromkLinuxEpollEvent(&klinux_event, &event)) {
+      events->push_back(event);
+    }
+  }
+}
+
+}  // namespace host_call
+}  // namespace asylo
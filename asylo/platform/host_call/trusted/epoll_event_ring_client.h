@@ -0,0 +1,80 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_HOST_CALL_TRUSTED_EPOLL_EVENT_RING_CLIENT_H_
+#define ASYLO_PLATFORM_HOST_CALL_TRUSTED_EPOLL_EVENT_RING_CLIENT_H_
+
+#include <sys/epoll.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "asylo/platform/host_call/epoll_event_ring.h"
+
+namespace asylo {
+namespace host_call {
+
+// Trusted view of an EpollEventRing filled by an untrusted thread polling a
+// host epoll instance. Events collected by the thread are popped without
+// leaving the enclave; only waiting for events and stopping the thread
+// require an enclave exit.
+class EpollEventRingClient {
+ public:
+  // Starts an untrusted thread collecting the events of the host epoll
+  // instance |epfd|. Returns nullptr if the host could not start one.
+  static std::unique_ptr<EpollEventRingClient> Create(int epfd);
+
+  // Stops the untrusted thread, discarding any events still in the ring.
+  ~EpollEventRingClient();
+
+  EpollEventRingClient(const EpollEventRingClient &other) = delete;
+  EpollEventRingClient &operator=(const EpollEventRingClient &other) = delete;
+
+  // Copies up to |max_events| collected events to |events|, converted to the
+  // enclave representation, and returns the number of events copied. The data
+  // field of each event holds the key the file descriptor was registered with.
+  int Pop(struct epoll_event *events, int max_events);
+
+  // Blocks until the ring has events or is closed, or |timeout_microsec|
+  // microseconds have passed, with 0 meaning no timeout. May return early.
+  void Wait(int64_t timeout_microsec);
+
+  // Returns true if the ring was closed, either by Close() or because the
+  // untrusted thread failed.
+  bool IsClosed() const { return ring_->IsClosed(); }
+
+  // Closes the ring and wakes up all threads blocked in Wait(). The ring
+  // memory stays valid until Stop() is called.
+  void Close();
+
+  // Stops the untrusted thread and frees the ring, appending the events still
+  // buffered in it to |events|. No other method may be called afterwards.
+  void Stop(std::vector<struct epoll_event> *events);
+
+ private:
+  explicit EpollEventRingClient(EpollEventRing *ring) : ring_(ring) {}
+
+  // The ring, in untrusted memory, or nullptr once stopped.
+  EpollEventRing *ring_;
+};
+
+}  // namespace host_call
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_HOST_CALL_TRUSTED_EPOLL_EVENT_RING_CLIENT_H_
@@ -0,0 +1,146 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include "asylo/platform/host_call/trusted/host_call_batch.h"
+
+#include <errno.h>
+
+#include <string>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "asylo/platform/host_call/exit_handler_constants.h"
+#include "asylo/platform/primitives/trusted_primitives.h"
+#include "asylo/platform/system_call/type_conversions/types_functions.h"
+
+namespace asylo {
+namespace host_call {
+
+using primitives::Extent;
+using primitives::MessageReader;
+using primitives::MessageWriter;
+using primitives::PrimitiveStatus;
+using primitives::TrustedPrimitives;
+
+size_t HostCallBatch::Add(uint64_t exit_selector, MessageWriter input) {
+  calls_.emplace_back();
+  Call &call = calls_.back();
+  call.selector = exit_selector;
+  call.input = std::move(input);
+  call.sysno = -1;
+  return calls_.size() - 1;
+}
+
+size_t HostCallBatch::AddSerializedSystemCall(
+    int sysno, const system_call::ParameterList &parameters) {
+  Extent request;
+  PrimitiveStatus status =
+      system_call::SerializeRequest(sysno, parameters, &request);
+  if (!status.ok()) {
+    TrustedPrimitives::BestEffortAbort(
+        "host_call_batch.cc: Encountered serialization error when "
+        "serializing syscall parameters.");
+  }
+
+  MessageWriter input;
+  input.PushByReference(request);
+  size_t index = Add(kSystemCallHandler, std::move(input));
+  Call &call = calls_[index];
+  call.sysno = sysno;
+  call.request.reset(request.As<uint8_t>());
+  call.parameters = parameters;
+  return index;
+}
+
+PrimitiveStatus HostCallBatch::Dispatch() {
+  // The batch is serialized as the number of calls, followed by the selector,
+  // the number of input extents and the input extents of each call.
+  MessageWriter input;
+  input.Push<uint64_t>(calls_.size());
+  for (const Call &call : calls_) {
+    input.Push<uint64_t>(call.selector);
+    input.Push<uint64_t>(call.input.size());
+    call.input.Serialize(
+        [&input](Extent extent) { input.PushByReference(extent); });
+  }
+
+  MessageReader output;
+  PrimitiveStatus status =
+      TrustedPrimitives::UntrustedCall(kBatchHandler, &input, &output);
+  if (!status.ok()) {
+    return status;
+  }
+
+  // The response holds the error code, the error message, the number of output
+  // extents and the output extents of each call. It is produced by the host, so
+  // every size and count is checked before it is used.
+  const PrimitiveStatus truncated{error::GoogleError::DATA_LOSS,
+                                  "Malformed response to host call batch."};
+  size_t remaining = output.size();
+  for (Call &call : calls_) {
+    if (remaining < 3) {
+      return truncated;
+    }
+    remaining -= 3;
+    Extent error_code = output.next();
+    Extent error_message = output.next();
+    Extent num_extents = output.next();
+    if (error_code.size() != sizeof(int) ||
+        num_extents.size() != sizeof(uint64_t) ||
+        *num_extents.As<uint64_t>() > remaining) {
+      return truncated;
+    }
+    remaining -= *num_extents.As<uint64_t>();
+    call.status = PrimitiveStatus{*error_code.As<int>(),
+                                  error_message.As<char>(),
+                                  error_message.size()};
+    call.output.Deserialize(*num_extents.As<uint64_t>(),
+                            [&output](size_t i) { return output.next(); });
+  }
+  return PrimitiveStatus::OkStatus();
+}
+
+int64_t HostCallBatch::SystemCallResult(size_t index) {
+  Call &call = calls_[index];
+  if (!call.status.ok() || call.output.size() != 1) {
+    std::string message = absl::StrCat(
+        "Host call batch: system call ", call.sysno, " failed.");
+    TrustedPrimitives::BestEffortAbort(message.c_str());
+  }
+
+  uint64_t result;
+  int klinux_errno;
+  Extent response = call.output.next();
+  PrimitiveStatus status = system_call::DeserializeResponse(
+      call.sysno, call.parameters, response, &result, &klinux_errno);
+  if (!status.ok()) {
+    TrustedPrimitives::BestEffortAbort(
+        "host_call_batch.cc: Error deserializing system call response.");
+  }
+
+  // As in enc_untrusted_syscall(), a return value of -1 is only a failure if it
+  // is accompanied by a non-zero errno.
+  if (static_cast<int64_t>(result) == -1 && klinux_errno != 0) {
+    errno = FromkLinuxErrorNumber(klinux_errno);
+  }
+  return result;
+}
+
+}  // namespace host_call
+}  // namespace asylo
@@ -0,0 +1,135 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#ifndef ASYLO_PLATFORM_HOST_CALL_TRUSTED_HOST_CALL_BATCH_H_
+#define ASYLO_PLATFORM_HOST_CALL_TRUSTED_HOST_CALL_BATCH_H_
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "asylo/platform/primitives/primitive_status.h"
+#include "asylo/platform/primitives/util/message.h"
+#include "asylo/platform/system_call/serialize.h"
+
+namespace asylo {
+namespace host_call {
+
+// A sequence of independent host calls executed on the untrusted side in a
+// single enclave exit. Calls are run in the order they were added, and every
+// call is run regardless of whether the calls before it succeeded, so a batch
+// must only contain calls whose order of completion does not matter to the
+// caller beyond that sequence.
+//
+// Example:
+//
+//   HostCallBatch batch;
+//   size_t first = batch.AddSystemCall(system_call::kSYS_close, fd0);
+//   size_t second = batch.AddSystemCall(system_call::kSYS_close, fd1);
+//   if (batch.Dispatch().ok()) {
+//     int result = batch.SystemCallResult(first);
+//     ...
+//   }
+class HostCallBatch {
+ public:
+  HostCallBatch() = default;
+
+  HostCallBatch(const HostCallBatch &other) = delete;
+  HostCallBatch &operator=(const HostCallBatch &other) = delete;
+
+  // Adds a host call to the exit handler |exit_selector| with arguments
+  // |input|, and returns the index of the call in the batch.
+  size_t Add(uint64_t exit_selector, primitives::MessageWriter input);
+
+  // Adds the system call |sysno| with arguments |args|, and returns the index
+  // of the call in the batch. Pointer arguments must remain valid until the
+  // result is retrieved with SystemCallResult().
+  template <typename... Args>
+  size_t AddSystemCall(int sysno, Args... args) {
+    system_call::ParameterList parameters = {{ToParameter(args)...}};
+    return AddSerializedSystemCall(sysno, parameters);
+  }
+
+  // Returns the number of host calls in the batch.
+  size_t size() const { return calls_.size(); }
+
+  // Returns true if the batch contains no host calls.
+  bool empty() const { return calls_.empty(); }
+
+  // Executes all host calls in the batch in a single enclave exit. Returns an
+  // error if the batch could not be executed, in which case none of the calls
+  // may have been run. The results of individual calls are reported by
+  // status(), output() and SystemCallResult().
+  primitives::PrimitiveStatus Dispatch();
+
+  // Returns the status of the host call at |index|.
+  const primitives::PrimitiveStatus &status(size_t index) const {
+    return calls_[index].status;
+  }
+
+  // Returns the output of the host call at |index|.
+  primitives::MessageReader *output(size_t index) {
+    return &calls_[index].output;
+  }
+
+  // Returns the return value of the system call at |index|, copying its output
+  // parameters back and setting errno as enc_untrusted_syscall() would. Aborts
+  // if the system call could not be executed.
+  int64_t SystemCallResult(size_t index);
+
+ private:
+  struct MallocDeleter {
+    void operator()(uint8_t *buffer) { free(buffer); }
+  };
+
+  struct Call {
+    uint64_t selector;
+    primitives::MessageWriter input;
+
+    // Serialized request and parameters of a system call, if this host call is
+    // a system call.
+    int sysno;
+    std::unique_ptr<uint8_t, MallocDeleter> request;
+    system_call::ParameterList parameters;
+
+    primitives::PrimitiveStatus status;
+    primitives::MessageReader output;
+  };
+
+  template <typename T>
+  static uint64_t ToParameter(T *value) {
+    return reinterpret_cast<uint64_t>(value);
+  }
+
+  template <typename T>
+  static uint64_t ToParameter(T value) {
+    return static_cast<uint64_t>(value);
+  }
+
+  size_t AddSerializedSystemCall(int sysno,
+                                 const system_call::ParameterList &parameters);
+
+  std::vector<Call> calls_;
+};
+
+}  // namespace host_call
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_HOST_CALL_TRUSTED_HOST_CALL_BATCH_H_
@@ -22,10 +22,74 @@
 #include "asylo/platform/primitives/extent.h"
 #include "asylo/platform/primitives/trusted_primitives.h"
 #include "asylo/platform/primitives/util/message.h"
+#include "asylo/platform/system_call/message.h"
+#include "asylo/platform/system_call/sysno.h"
 #include "asylo/util/status_macros.h"
 
 namespace asylo {
 namespace host_call {
+namespace {
+
+// Returns true if the system call in |request| may block for a long time.
+bool IsBlockingSystemCall(const uint8_t* request, size_t request_size) {
+  if (request_size < sizeof(system_call::MessageHeader)) {
+    return false;
+  }
+  system_call::MessageReader reader({request, request_size});
+  switch (reader.sysno()) {
+    case system_call::kSYS_epoll_pwait:
+    case system_call::kSYS_epoll_wait:
+    case system_call::kSYS_flock:
+    case system_call::kSYS_nanosleep:
+    case system_call::kSYS_poll:
+    case system_call::kSYS_select:
+    case system_call::kSYS_wait4:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Makes the exit call |exit_selector|, letting the backend release the
+// resources of the calling thread if |blocking|.
+primitives::PrimitiveStatus DispatchUntrustedCall(
+    uint64_t exit_selector, primitives::MessageWriter* input,
+    primitives::MessageReader* output, bool blocking) {
+  if (blocking) {
+    return primitives::TrustedPrimitives::UntrustedBlockingCall(exit_selector,
+                                                                input, output);
+  }
+  return primitives::TrustedPrimitives::UntrustedCall(exit_selector, input,
+                                                      output);
+}
+
+// Validates |input| and the host call return value in |output| around the exit
+// call |exit_selector|.
+primitives::PrimitiveStatus DispatchNonSystemCall(
+    uint64_t exit_selector, primitives::MessageWriter* input,
+    primitives::MessageReader* output, bool blocking) {
+  if (!input) {
+    return primitives::PrimitiveStatus{
+        error::GoogleError::FAILED_PRECONDITION,
+        "NonSystemCallDispatcher: Null input provided. Need a valid request to "
+        "dispatch the host call"};
+  }
+
+  ASYLO_RETURN_IF_ERROR(
+      DispatchUntrustedCall(exit_selector, input, output, blocking));
+
+  // Output should at least contain the host call return value.
+  if (output->empty()) {
+    return primitives::PrimitiveStatus{
+        error::GoogleError::DATA_LOSS,
+        "No response received for the host call, or response lost while "
+        "crossing the enclave boundary."};
+  }
+
+  return primitives::PrimitiveStatus::OkStatus();
+}
+
+}  // namespace
 
 primitives::PrimitiveStatus SystemCallDispatcher(const uint8_t* request_buffer,
                                                  size_t request_size,
@@ -44,8 +108,9 @@ primitives::PrimitiveStatus SystemCallDispatcher(const uint8_t* request_buffer,
   primitives::MessageWriter input;
   input.PushByReference(primitives::Extent{request_buffer, request_size});
   primitives::MessageReader output;
-  ASYLO_RETURN_IF_ERROR(primitives::TrustedPrimitives::UntrustedCall(
-      kSystemCallHandler, &input, &output));
+  ASYLO_RETURN_IF_ERROR(DispatchUntrustedCall(
+      kSystemCallHandler, &input, &output,
+      IsBlockingSystemCall(request_buffer, request_size)));
 
   // The output should only contain the serialized response.
   ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(output, 1);
@@ -69,25 +134,15 @@ primitives::PrimitiveStatus SystemCallDispatcher(const uint8_t* request_buffer,
 primitives::PrimitiveStatus NonSystemCallDispatcher(
     uint64_t exit_selector, primitives::MessageWriter* input,
     primitives::MessageReader* output) {
-  if (!input) {
-    return primitives::PrimitiveStatus{
-        error::GoogleError::FAILED_PRECONDITION,
-        "NonSystemCallDispatcher: Null input provided. Need a valid request to "
-        "dispatch the host call"};
-  }
-
-  ASYLO_RETURN_IF_ERROR(primitives::TrustedPrimitives::UntrustedCall(
-      exit_selector, input, output));
-
-  // Output should at least contain the host call return value.
-  if (output->empty()) {
-    return primitives::PrimitiveStatus{
-        error::GoogleError::DATA_LOSS,
-        "No response received for the host call, or response lost while "
-        "crossing the enclave boundary."};
-  }
+  return DispatchNonSystemCall(exit_selector, input, output,
+                               /*blocking=*/false);
+}
 
-  return primitives::PrimitiveStatus::OkStatus();
+primitives::PrimitiveStatus BlockingNonSystemCallDispatcher(
+    uint64_t exit_selector, primitives::MessageWriter* input,
+    primitives::MessageReader* output) {
+  return DispatchNonSystemCall(exit_selector, input, output,
+                               /*blocking=*/true);
 }
 
 }  // namespace host_call
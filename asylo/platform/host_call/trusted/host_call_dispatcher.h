@@ -49,6 +49,13 @@ primitives::PrimitiveStatus NonSystemCallDispatcher(
     uint64_t exit_selector, primitives::MessageWriter* input,
     primitives::MessageReader* output);
 
+// Like NonSystemCallDispatcher, for host calls which may block for a long time,
+// during which the backend may release the resources the calling thread holds
+// inside the enclave.
+primitives::PrimitiveStatus BlockingNonSystemCallDispatcher(
+    uint64_t exit_selector, primitives::MessageWriter* input,
+    primitives::MessageReader* output);
+
 }  // namespace host_call
 }  // namespace asylo
 
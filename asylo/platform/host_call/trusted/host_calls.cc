@@ -28,10 +28,13 @@
 #include <algorithm>
 
 #include "asylo/platform/host_call/exit_handler_constants.h"
+#include "asylo/platform/host_call/host_call_result.h"
 #include "asylo/platform/host_call/serializer_functions.h"
 #include "asylo/platform/primitives/trusted_primitives.h"
 #include "asylo/platform/system_call/type_conversions/types_functions.h"
 
+using ::asylo::host_call::BlockingNonSystemCallDispatcher;
+using ::asylo::host_call::DecodeHostCallResult;
 using ::asylo::host_call::NonSystemCallDispatcher;
 using ::asylo::primitives::Extent;
 using ::asylo::primitives::MessageReader;
@@ -69,6 +72,89 @@ namespace {
 // getpwuid.
 struct passwd global_passwd;
 
+// Maximum number of iovec entries passed to the host, UIO_MAXIOV on Linux.
+constexpr int kMaxIovecCount = 1024;
+
+// Pushes the number of entries of |iov| followed by an extent per entry, so
+// that the data is copied once, straight into the host message.
+void PushIovecs(const struct iovec *iov, int iovcnt, MessageWriter *input) {
+  input->Push<uint64_t>(iovcnt);
+  for (int i = 0; i < iovcnt; ++i) {
+    input->PushByReference(Extent{iov[i].iov_base, iov[i].iov_len});
+  }
+}
+
+// Maximum number of messages passed to the host by sendmmsg and recvmmsg,
+// UIO_MAXIOV on Linux. Larger batches are truncated, as on Linux.
+constexpr unsigned int kMaxMmsgCount = 1024;
+
+// Copies |data| into the buffers of |iov|, never beyond their capacity.
+// Returns the number of bytes copied.
+size_t ScatterToIovecs(Extent data, const struct iovec *iov, size_t iovcnt) {
+  size_t total_bytes = data.size();
+  size_t bytes_copied = 0;
+  for (size_t i = 0; i < iovcnt && bytes_copied < total_bytes; ++i) {
+    size_t bytes_to_copy =
+        std::min(iov[i].iov_len, total_bytes - bytes_copied);
+    memcpy(iov[i].iov_base, data.As<char>() + bytes_copied, bytes_to_copy);
+    bytes_copied += bytes_to_copy;
+  }
+  return bytes_copied;
+}
+
+// Writes |iov| at |offset| of |fd| through the host pwritev2() with kernel
+// RWF_* flags |klinux_flags|. |name| names the host call in error messages.
+ssize_t PWritevOnHost(int fd, const struct iovec *iov, int iovcnt,
+                      off_t offset, int klinux_flags, const char *name) {
+  if (iovcnt < 0 || iovcnt > kMaxIovecCount) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  MessageWriter input;
+  input.Push(fd);
+  input.Push<int64_t>(offset);
+  input.Push(klinux_flags);
+  PushIovecs(iov, iovcnt, &input);
+  MessageReader output;
+
+  const auto status = NonSystemCallDispatcher(
+      ::asylo::host_call::kPWritevHandler, &input, &output);
+  CheckStatusAndParamCount(status, output, name, 1);
+  return DecodeHostCallResult(output.next<int64_t>());
+}
+
+// Reads into |iov| from |offset| of |fd| through the host preadv2() with
+// kernel RWF_* flags |klinux_flags|. |name| names the host call in error
+// messages.
+ssize_t PReadvOnHost(int fd, const struct iovec *iov, int iovcnt, off_t offset,
+                     int klinux_flags, const char *name) {
+  if (iovcnt < 0 || iovcnt > kMaxIovecCount) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  MessageWriter input;
+  input.Push(fd);
+  input.Push<int64_t>(offset);
+  input.Push(klinux_flags);
+  input.Push<uint64_t>(iovcnt);
+  for (int i = 0; i < iovcnt; ++i) {
+    input.Push<uint64_t>(iov[i].iov_len);
+  }
+  MessageReader output;
+
+  const auto status = NonSystemCallDispatcher(
+      ::asylo::host_call::kPReadvHandler, &input, &output);
+  CheckStatusAndParamCount(status, output, name, 2);
+
+  ssize_t result = DecodeHostCallResult(output.next<int64_t>());
+  if (result == -1) {
+    return result;
+  }
+  return ScatterToIovecs(output.next(), iov, iovcnt);
+}
+
 size_t CalculateTotalMessageSize(const struct msghdr *msg) {
   size_t total_message_size = 0;
   for (int i = 0; i < msg->msg_iovlen; ++i) {
@@ -148,31 +234,38 @@ int enc_untrusted_access(const char *path_name, int mode) {
 }
 
 pid_t enc_untrusted_getpid() {
-  return EnsureInitializedAndDispatchSyscall(asylo::system_call::kSYS_getpid);
+  return EnsureInitializedAndDispatchScalarSyscall(
+      asylo::system_call::kSYS_getpid);
 }
 
 pid_t enc_untrusted_getppid() {
-  return EnsureInitializedAndDispatchSyscall(asylo::system_call::kSYS_getppid);
+  return EnsureInitializedAndDispatchScalarSyscall(
+      asylo::system_call::kSYS_getppid);
 }
 
 pid_t enc_untrusted_setsid() {
-  return EnsureInitializedAndDispatchSyscall(asylo::system_call::kSYS_setsid);
+  return EnsureInitializedAndDispatchScalarSyscall(
+      asylo::system_call::kSYS_setsid);
 }
 
 uid_t enc_untrusted_getuid() {
-  return EnsureInitializedAndDispatchSyscall(asylo::system_call::kSYS_getuid);
+  return EnsureInitializedAndDispatchScalarSyscall(
+      asylo::system_call::kSYS_getuid);
 }
 
 gid_t enc_untrusted_getgid() {
-  return EnsureInitializedAndDispatchSyscall(asylo::system_call::kSYS_getgid);
+  return EnsureInitializedAndDispatchScalarSyscall(
+      asylo::system_call::kSYS_getgid);
 }
 
 uid_t enc_untrusted_geteuid() {
-  return EnsureInitializedAndDispatchSyscall(asylo::system_call::kSYS_geteuid);
+  return EnsureInitializedAndDispatchScalarSyscall(
+      asylo::system_call::kSYS_geteuid);
 }
 
 gid_t enc_untrusted_getegid() {
-  return EnsureInitializedAndDispatchSyscall(asylo::system_call::kSYS_getegid);
+  return EnsureInitializedAndDispatchScalarSyscall(
+      asylo::system_call::kSYS_getegid);
 }
 
 int enc_untrusted_kill(pid_t pid, int sig) {
@@ -182,8 +275,8 @@ int enc_untrusted_kill(pid_t pid, int sig) {
     return -1;
   }
 
-  return EnsureInitializedAndDispatchSyscall(asylo::system_call::kSYS_kill, pid,
-                                             klinux_sig);
+  return EnsureInitializedAndDispatchScalarSyscall(
+      asylo::system_call::kSYS_kill, pid, klinux_sig);
 }
 
 int enc_untrusted_link(const char *oldpath, const char *newpath) {
@@ -192,8 +285,8 @@ int enc_untrusted_link(const char *oldpath, const char *newpath) {
 }
 
 off_t enc_untrusted_lseek(int fd, off_t offset, int whence) {
-  return EnsureInitializedAndDispatchSyscall(asylo::system_call::kSYS_lseek, fd,
-                                             offset, whence);
+  return EnsureInitializedAndDispatchScalarSyscall(
+      asylo::system_call::kSYS_lseek, fd, offset, whence);
 }
 
 int enc_untrusted_mkdir(const char *pathname, mode_t mode) {
@@ -251,8 +344,8 @@ int enc_untrusted_truncate(const char *path, off_t length) {
 }
 
 int enc_untrusted_ftruncate(int fd, off_t length) {
-  return EnsureInitializedAndDispatchSyscall(asylo::system_call::kSYS_ftruncate,
-                                             fd, length);
+  return EnsureInitializedAndDispatchScalarSyscall(
+      asylo::system_call::kSYS_ftruncate, fd, length);
 }
 
 int enc_untrusted_rmdir(const char *path) {
@@ -277,13 +370,13 @@ int enc_untrusted_socket(int domain, int type, int protocol) {
 }
 
 int enc_untrusted_listen(int sockfd, int backlog) {
-  return EnsureInitializedAndDispatchSyscall(asylo::system_call::kSYS_listen,
-                                             sockfd, backlog);
+  return EnsureInitializedAndDispatchScalarSyscall(
+      asylo::system_call::kSYS_listen, sockfd, backlog);
 }
 
 int enc_untrusted_shutdown(int sockfd, int how) {
-  return EnsureInitializedAndDispatchSyscall(asylo::system_call::kSYS_shutdown,
-                                             sockfd, how);
+  return EnsureInitializedAndDispatchScalarSyscall(
+      asylo::system_call::kSYS_shutdown, sockfd, how);
 }
 
 ssize_t enc_untrusted_send(int sockfd, const void *buf, size_t len, int flags) {
@@ -358,8 +451,8 @@ int enc_untrusted_chown(const char *pathname, uid_t owner, gid_t group) {
 }
 
 int enc_untrusted_fchown(int fd, uid_t owner, gid_t group) {
-  return EnsureInitializedAndDispatchSyscall(asylo::system_call::kSYS_fchown,
-                                             fd, owner, group);
+  return EnsureInitializedAndDispatchScalarSyscall(
+      asylo::system_call::kSYS_fchown, fd, owner, group);
 }
 
 int enc_untrusted_setsockopt(int sockfd, int level, int optname,
@@ -370,8 +463,8 @@ int enc_untrusted_setsockopt(int sockfd, int level, int optname,
 }
 
 int enc_untrusted_flock(int fd, int operation) {
-  return EnsureInitializedAndDispatchSyscall(asylo::system_call::kSYS_flock, fd,
-                                             TokLinuxFLockOperation(operation));
+  return EnsureInitializedAndDispatchScalarSyscall(
+      asylo::system_call::kSYS_flock, fd, TokLinuxFLockOperation(operation));
 }
 
 int enc_untrusted_wait(int *wstatus) {
@@ -385,7 +478,7 @@ int enc_untrusted_wait(int *wstatus) {
 }
 
 int enc_untrusted_inotify_init1(int flags) {
-  return EnsureInitializedAndDispatchSyscall(
+  return EnsureInitializedAndDispatchScalarSyscall(
       asylo::system_call::kSYS_inotify_init1, TokLinuxInotifyFlag(flags));
 }
 
@@ -397,13 +490,13 @@ int enc_untrusted_inotify_add_watch(int fd, const char *pathname,
 }
 
 int enc_untrusted_inotify_rm_watch(int fd, int wd) {
-  return EnsureInitializedAndDispatchSyscall(
+  return EnsureInitializedAndDispatchScalarSyscall(
       asylo::system_call::kSYS_inotify_rm_watch, fd, wd);
 }
 
 mode_t enc_untrusted_umask(mode_t mask) {
-  return EnsureInitializedAndDispatchSyscall(asylo::system_call::kSYS_umask,
-                                             mask);
+  return EnsureInitializedAndDispatchScalarSyscall(
+      asylo::system_call::kSYS_umask, mask);
 }
 
 int enc_untrusted_chmod(const char *path_name, mode_t mode) {
@@ -412,12 +505,12 @@ int enc_untrusted_chmod(const char *path_name, mode_t mode) {
 }
 
 int enc_untrusted_fchmod(int fd, mode_t mode) {
-  return EnsureInitializedAndDispatchSyscall(asylo::system_call::kSYS_fchmod,
-                                             fd, mode);
+  return EnsureInitializedAndDispatchScalarSyscall(
+      asylo::system_call::kSYS_fchmod, fd, mode);
 }
 
 int enc_untrusted_sched_yield() {
-  return EnsureInitializedAndDispatchSyscall(
+  return EnsureInitializedAndDispatchScalarSyscall(
       asylo::system_call::kSYS_sched_yield);
 }
 
@@ -451,6 +544,65 @@ int enc_untrusted_pwrite64(int fd, const void *buf, size_t count,
                                              fd, buf, count, offset);
 }
 
+void *enc_untrusted_mmap(void *addr, size_t length, int prot, int flags, int fd,
+                         off_t offset) {
+  int64_t result = EnsureInitializedAndDispatchScalarSyscall(
+      asylo::system_call::kSYS_mmap, reinterpret_cast<uint64_t>(addr),
+      static_cast<uint64_t>(length), TokLinuxMmapProtection(prot),
+      TokLinuxMmapFlag(flags), fd, offset);
+  if (result == -1) {
+    return MAP_FAILED;
+  }
+
+  // A mapping that overlaps the enclave would let the host alias trusted
+  // memory through the file.
+  void *mapping = reinterpret_cast<void *>(result);
+  if (!TrustedPrimitives::IsOutsideEnclave(mapping, length)) {
+    TrustedPrimitives::BestEffortAbort(
+        "enc_untrusted_mmap: mapping returned by the host overlaps the "
+        "enclave.");
+  }
+  return mapping;
+}
+
+int enc_untrusted_munmap(void *addr, size_t length) {
+  return EnsureInitializedAndDispatchScalarSyscall(
+      asylo::system_call::kSYS_munmap, reinterpret_cast<uint64_t>(addr),
+      static_cast<uint64_t>(length));
+}
+
+int enc_untrusted_msync(void *addr, size_t length, int flags) {
+  return EnsureInitializedAndDispatchScalarSyscall(
+      asylo::system_call::kSYS_msync, reinterpret_cast<uint64_t>(addr),
+      static_cast<uint64_t>(length), TokLinuxMsyncFlag(flags));
+}
+
+ssize_t enc_untrusted_getrandom(void *buf, size_t buflen, unsigned int flags) {
+  return EnsureInitializedAndDispatchSyscall(asylo::system_call::kSYS_getrandom,
+                                             buf, buflen, flags);
+}
+
+ssize_t enc_untrusted_sendfile(int out_fd, int in_fd, off_t *offset,
+                               size_t count) {
+  return EnsureInitializedAndDispatchSyscall(asylo::system_call::kSYS_sendfile,
+                                             out_fd, in_fd, offset, count);
+}
+
+ssize_t enc_untrusted_splice(int fd_in, off_t *off_in, int fd_out,
+                             off_t *off_out, size_t len, unsigned int flags) {
+  return EnsureInitializedAndDispatchSyscall(asylo::system_call::kSYS_splice,
+                                             fd_in, off_in, fd_out, off_out,
+                                             len, flags);
+}
+
+ssize_t enc_untrusted_copy_file_range(int fd_in, off_t *off_in, int fd_out,
+                                      off_t *off_out, size_t len,
+                                      unsigned int flags) {
+  return EnsureInitializedAndDispatchSyscall(
+      asylo::system_call::kSYS_copy_file_range, fd_in, off_in, fd_out, off_out,
+      len, flags);
+}
+
 int enc_untrusted_isatty(int fd) {
   MessageWriter input;
   input.Push(fd);
@@ -477,18 +629,11 @@ int enc_untrusted_usleep(useconds_t usec) {
   asylo::primitives::PrimitiveStatus status =
       asylo::host_call::NonSystemCallDispatcher(
           asylo::host_call::kUSleepHandler, &input, &output);
-  CheckStatusAndParamCount(status, output, "enc_untrusted_usleep", 2);
-
-  int result = output.next<int>();
-  int klinux_errno = output.next<int>();
+  CheckStatusAndParamCount(status, output, "enc_untrusted_usleep", 1);
 
   // usleep() returns 0 on success. On error, -1 is returned, with errno set to
   // indicate the cause of the error.
-  if (result == -1) {
-    errno = FromkLinuxErrorNumber(klinux_errno);
-  }
-
-  return result;
+  return DecodeHostCallResult(output.next<int64_t>());
 }
 
 int enc_untrusted_fstat(int fd, struct stat *statbuf) {
@@ -621,8 +766,8 @@ int64_t enc_untrusted_sysconf(int name) {
 }
 
 int enc_untrusted_close(int fd) {
-  return EnsureInitializedAndDispatchSyscall(asylo::system_call::kSYS_close,
-                                             fd);
+  return EnsureInitializedAndDispatchScalarSyscall(
+      asylo::system_call::kSYS_close, fd);
 }
 
 void *enc_untrusted_realloc(void *ptr, size_t size) {
@@ -652,8 +797,8 @@ uint32_t enc_untrusted_sleep(uint32_t seconds) {
   input.Push<uint32_t>(seconds);
   MessageReader output;
   asylo::primitives::PrimitiveStatus status =
-      asylo::host_call::NonSystemCallDispatcher(asylo::host_call::kSleepHandler,
-                                                &input, &output);
+      asylo::host_call::BlockingNonSystemCallDispatcher(
+          asylo::host_call::kSleepHandler, &input, &output);
   CheckStatusAndParamCount(status, output, "enc_untrusted_sleep", 2);
 
   // Returns sleep's return value directly since it doesn't set errno.
@@ -762,19 +907,15 @@ int enc_untrusted_connect(int sockfd, const struct sockaddr *addr,
 }
 
 ssize_t enc_untrusted_sendmsg(int sockfd, const struct msghdr *msg, int flags) {
-  size_t total_message_size = CalculateTotalMessageSize(msg);
-  std::unique_ptr<char[]> msg_iov_buffer(new char[total_message_size]);
-  size_t copied_bytes = 0;
-  for (int i = 0; i < msg->msg_iovlen; ++i) {
-    memcpy(msg_iov_buffer.get() + copied_bytes, msg->msg_iov[i].iov_base,
-           msg->msg_iov[i].iov_len);
-    copied_bytes += msg->msg_iov[i].iov_len;
+  if (msg->msg_iovlen > kMaxIovecCount) {
+    errno = EMSGSIZE;
+    return -1;
   }
 
   MessageWriter input;
   input.Push(sockfd);
   input.PushByReference(Extent{msg->msg_name, msg->msg_namelen});
-  input.PushByReference(Extent{msg_iov_buffer.get(), total_message_size});
+  PushIovecs(msg->msg_iov, msg->msg_iovlen, &input);
   input.PushByReference(Extent{msg->msg_control, msg->msg_controllen});
   input.Push(msg->msg_flags);
   input.Push(flags);
@@ -782,16 +923,91 @@ ssize_t enc_untrusted_sendmsg(int sockfd, const struct msghdr *msg, int flags) {
 
   const auto status = NonSystemCallDispatcher(
       ::asylo::host_call::kSendMsgHandler, &input, &output);
-  CheckStatusAndParamCount(status, output, "enc_untrusted_sendmsg", 2);
+  CheckStatusAndParamCount(status, output, "enc_untrusted_sendmsg", 1);
 
-  ssize_t result = output.next<ssize_t>();
-  int klinux_errno = output.next<int>();
   // sendmsg() returns the number of characters sent. On error, -1 is returned,
   // with errno set to indicate the cause of the error.
+  return DecodeHostCallResult(output.next<int64_t>());
+}
+
+ssize_t enc_untrusted_writev(int fd, const struct iovec *iov, int iovcnt) {
+  if (iovcnt < 0 || iovcnt > kMaxIovecCount) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  MessageWriter input;
+  input.Push(fd);
+  PushIovecs(iov, iovcnt, &input);
+  MessageReader output;
+
+  const auto status = NonSystemCallDispatcher(
+      ::asylo::host_call::kWritevHandler, &input, &output);
+  CheckStatusAndParamCount(status, output, "enc_untrusted_writev", 1);
+  return DecodeHostCallResult(output.next<int64_t>());
+}
+
+ssize_t enc_untrusted_readv(int fd, const struct iovec *iov, int iovcnt) {
+  if (iovcnt < 0 || iovcnt > kMaxIovecCount) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  MessageWriter input;
+  input.Push(fd);
+  input.Push<uint64_t>(iovcnt);
+  for (int i = 0; i < iovcnt; ++i) {
+    input.Push<uint64_t>(iov[i].iov_len);
+  }
+  MessageReader output;
+
+  const auto status = NonSystemCallDispatcher(
+      ::asylo::host_call::kReadvHandler, &input, &output);
+  CheckStatusAndParamCount(status, output, "enc_untrusted_readv", 2);
+
+  ssize_t result = DecodeHostCallResult(output.next<int64_t>());
   if (result == -1) {
-    errno = FromkLinuxErrorNumber(klinux_errno);
+    return result;
   }
-  return result;
+
+  // Scatter the received bytes straight from the host message into |iov|,
+  // never trusting the host to return more than was asked for.
+  return ScatterToIovecs(output.next(), iov, iovcnt);
+}
+
+ssize_t enc_untrusted_pwritev(int fd, const struct iovec *iov, int iovcnt,
+                              off_t offset) {
+  if (offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  return PWritevOnHost(fd, iov, iovcnt, offset, /*klinux_flags=*/0,
+                       "enc_untrusted_pwritev");
+}
+
+ssize_t enc_untrusted_preadv(int fd, const struct iovec *iov, int iovcnt,
+                             off_t offset) {
+  if (offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  return PReadvOnHost(fd, iov, iovcnt, offset, /*klinux_flags=*/0,
+                      "enc_untrusted_preadv");
+}
+
+ssize_t enc_untrusted_preadv2(int fd, const struct iovec *iov, int iovcnt,
+                              off_t offset, int flags) {
+  // An offset of -1 reads from the current file offset, as on Linux.
+  if (offset < -1) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (flags & ~(RWF_HIPRI | RWF_DSYNC | RWF_SYNC | RWF_NOWAIT)) {
+    errno = EOPNOTSUPP;
+    return -1;
+  }
+  return PReadvOnHost(fd, iov, iovcnt, offset, TokLinuxRwfFlag(flags),
+                      "enc_untrusted_preadv2");
 }
 
 ssize_t enc_untrusted_recvmsg(int sockfd, struct msghdr *msg, int flags) {
@@ -807,7 +1023,7 @@ ssize_t enc_untrusted_recvmsg(int sockfd, struct msghdr *msg, int flags) {
 
   MessageReader output;
 
-  const auto status = NonSystemCallDispatcher(
+  const auto status = BlockingNonSystemCallDispatcher(
       ::asylo::host_call::kRecvMsgHandler, &input, &output);
   CheckStatusAndParamCount(status, output, "enc_untrusted_recvmsg", 2,
                            /*match_exact_params=*/false);
@@ -831,16 +1047,7 @@ ssize_t enc_untrusted_recvmsg(int sockfd, struct msghdr *msg, int flags) {
 
   // A single buffer is passed from the untrusted side, copy it into the
   // scattered buffers inside the enclave.
-  auto msg_iov_extent = output.next();
-  size_t total_bytes = msg_iov_extent.size();
-  size_t bytes_copied = 0;
-  for (int i = 0; i < msg->msg_iovlen && bytes_copied < total_bytes; ++i) {
-    size_t bytes_to_copy =
-        std::min(msg->msg_iov[i].iov_len, total_bytes - bytes_copied);
-    memcpy(msg->msg_iov[i].iov_base, msg_iov_extent.As<char>() + bytes_copied,
-           bytes_to_copy);
-    bytes_copied += bytes_to_copy;
-  }
+  ScatterToIovecs(output.next(), msg->msg_iov, msg->msg_iovlen);
 
   auto msg_control_extent = output.next();
   // The returned |msg_controllen| should not exceed the buffer size.
@@ -852,6 +1059,119 @@ ssize_t enc_untrusted_recvmsg(int sockfd, struct msghdr *msg, int flags) {
   return result;
 }
 
+int enc_untrusted_sendmmsg(int sockfd, struct mmsghdr *msgvec,
+                           unsigned int vlen, int flags) {
+  vlen = std::min(vlen, kMaxMmsgCount);
+  for (unsigned int i = 0; i < vlen; ++i) {
+    if (msgvec[i].msg_hdr.msg_iovlen > kMaxIovecCount) {
+      errno = EMSGSIZE;
+      return -1;
+    }
+  }
+
+  // All messages go to the host in a single exit, each buffer as an extent
+  // copied straight into the host message.
+  MessageWriter input;
+  input.Push(sockfd);
+  input.Push(flags);
+  input.Push<uint64_t>(vlen);
+  for (unsigned int i = 0; i < vlen; ++i) {
+    const struct msghdr &msg = msgvec[i].msg_hdr;
+    input.PushByReference(Extent{msg.msg_name, msg.msg_namelen});
+    PushIovecs(msg.msg_iov, msg.msg_iovlen, &input);
+    input.PushByReference(Extent{msg.msg_control, msg.msg_controllen});
+  }
+  MessageReader output;
+
+  const auto status = NonSystemCallDispatcher(
+      ::asylo::host_call::kSendMmsgHandler, &input, &output);
+  CheckStatusAndParamCount(status, output, "enc_untrusted_sendmmsg", 3);
+
+  int result = output.next<int>();
+  int klinux_errno = output.next<int>();
+  // sendmmsg() returns the number of messages sent. On error, -1 is returned,
+  // with errno set to indicate the cause of the error.
+  if (result == -1) {
+    errno = FromkLinuxErrorNumber(klinux_errno);
+    return result;
+  }
+
+  auto msg_len_extent = output.next();
+  if (result < 0 || static_cast<unsigned int>(result) > vlen ||
+      msg_len_extent.size() != result * sizeof(uint32_t)) {
+    TrustedPrimitives::BestEffortAbort(
+        "enc_untrusted_sendmmsg: Malformed result from the host.");
+  }
+  const uint32_t *msg_len = msg_len_extent.As<uint32_t>();
+  for (int i = 0; i < result; ++i) {
+    msgvec[i].msg_len = msg_len[i];
+  }
+  return result;
+}
+
+int enc_untrusted_recvmmsg(int sockfd, struct mmsghdr *msgvec,
+                           unsigned int vlen, int flags,
+                           struct timespec *timeout) {
+  vlen = std::min(vlen, kMaxMmsgCount);
+
+  MessageWriter input;
+  input.Push(sockfd);
+  input.Push(flags);
+  input.PushByReference(
+      Extent{timeout, timeout ? sizeof(struct timespec) : 0});
+  input.Push<uint64_t>(vlen);
+  for (unsigned int i = 0; i < vlen; ++i) {
+    const struct msghdr &msg = msgvec[i].msg_hdr;
+    input.Push<uint64_t>(msg.msg_namelen);
+    input.Push<uint64_t>(CalculateTotalMessageSize(&msg));
+    input.Push<uint64_t>(msg.msg_controllen);
+  }
+  MessageReader output;
+
+  const auto status = NonSystemCallDispatcher(
+      ::asylo::host_call::kRecvMmsgHandler, &input, &output);
+  CheckStatusAndParamCount(status, output, "enc_untrusted_recvmmsg", 2,
+                           /*match_exact_params=*/false);
+
+  int result = output.next<int>();
+  int klinux_errno = output.next<int>();
+  // recvmmsg() returns the number of messages received. On error, -1 is
+  // returned, with errno set to indicate the cause of the error.
+  if (result == -1) {
+    errno = FromkLinuxErrorNumber(klinux_errno);
+    return result;
+  }
+  if (result < 0 || static_cast<unsigned int>(result) > vlen ||
+      output.size() != 2 + 4 * static_cast<size_t>(result)) {
+    TrustedPrimitives::BestEffortAbort(
+        "enc_untrusted_recvmmsg: Malformed result from the host.");
+  }
+
+  // Each received message comes back as its name, data, control message and
+  // flags, copied into the enclave buffers without exceeding their sizes.
+  for (int i = 0; i < result; ++i) {
+    struct msghdr *msg = &msgvec[i].msg_hdr;
+    auto msg_name_extent = output.next();
+    if (msg_name_extent.size() <= msg->msg_namelen) {
+      msg->msg_namelen = msg_name_extent.size();
+    }
+    memcpy(msg->msg_name, msg_name_extent.As<char>(), msg->msg_namelen);
+
+    msgvec[i].msg_len =
+        ScatterToIovecs(output.next(), msg->msg_iov, msg->msg_iovlen);
+
+    auto msg_control_extent = output.next();
+    if (msg_control_extent.size() <= msg->msg_controllen) {
+      msg->msg_controllen = msg_control_extent.size();
+    }
+    memcpy(msg->msg_control, msg_control_extent.As<char>(),
+           msg->msg_controllen);
+
+    msg->msg_flags = output.next<int>();
+  }
+  return result;
+}
+
 int enc_untrusted_getsockname(int sockfd, struct sockaddr *addr,
                               socklen_t *addrlen) {
   if (!addr || !addrlen) {
@@ -897,7 +1217,7 @@ int enc_untrusted_accept(int sockfd, struct sockaddr *addr,
   MessageWriter input;
   input.Push<int>(sockfd);
   MessageReader output;
-  const auto status = NonSystemCallDispatcher(
+  const auto status = BlockingNonSystemCallDispatcher(
       ::asylo::host_call::kAcceptHandler, &input, &output);
   CheckStatusAndParamCount(status, output, "enc_untrusted_accept", 3);
 
@@ -919,6 +1239,49 @@ int enc_untrusted_accept(int sockfd, struct sockaddr *addr,
   return result;
 }
 
+int enc_untrusted_accept4_batch(int sockfd, int flags, int max_connections,
+                                int *fds, struct sockaddr_storage *addrs,
+                                socklen_t *addrlens) {
+  if (max_connections <= 0 || !fds || !addrs || !addrlens) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (flags & ~(SOCK_NONBLOCK | SOCK_CLOEXEC)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  MessageWriter input;
+  input.Push<int>(sockfd);
+  input.Push<int>(TokLinuxSocketType(flags));
+  input.Push<int>(max_connections);
+  MessageReader output;
+  const auto status = NonSystemCallDispatcher(
+      ::asylo::host_call::kAccept4BatchHandler, &input, &output);
+  CheckStatusAndParamCount(status, output, "enc_untrusted_accept4_batch", 1,
+                           /*match_exact_params=*/false);
+
+  int64_t result = DecodeHostCallResult(output.next<int64_t>());
+  if (result == -1) {
+    return -1;
+  }
+  if (result == 0 || result > max_connections ||
+      output.size() != 1 + 2 * static_cast<size_t>(result)) {
+    TrustedPrimitives::BestEffortAbort(
+        "enc_untrusted_accept4_batch: Unexpected number of connections");
+  }
+  for (int i = 0; i < result; ++i) {
+    fds[i] = output.next<int>();
+    auto klinux_sockaddr_buf = output.next();
+    addrlens[i] = sizeof(addrs[i]);
+    FromkLinuxSockAddr(klinux_sockaddr_buf.As<struct klinux_sockaddr>(),
+                       klinux_sockaddr_buf.size(),
+                       reinterpret_cast<struct sockaddr *>(&addrs[i]),
+                       &addrlens[i], TrustedPrimitives::BestEffortAbort);
+  }
+  return result;
+}
+
 int enc_untrusted_getpeername(int sockfd, struct sockaddr *addr,
                               socklen_t *addrlen) {
   if (!addr || !addrlen) {
@@ -968,7 +1331,7 @@ ssize_t enc_untrusted_recvfrom(int sockfd, void *buf, size_t len, int flags,
   input.Push<uint64_t>(len);
   input.Push<int>(klinux_flags);
   MessageReader output;
-  const auto status = NonSystemCallDispatcher(
+  const auto status = BlockingNonSystemCallDispatcher(
       ::asylo::host_call::kRecvFromHandler, &input, &output);
   CheckStatusAndParamCount(status, output, "enc_untrusted_recvfrom", 4);
 
@@ -1033,8 +1396,8 @@ int enc_untrusted_gettimeofday(struct timeval *tv, struct timezone *tz) {
 }
 
 int enc_untrusted_fsync(int fd) {
-  return EnsureInitializedAndDispatchSyscall(asylo::system_call::kSYS_fsync,
-                                             fd);
+  return EnsureInitializedAndDispatchScalarSyscall(
+      asylo::system_call::kSYS_fsync, fd);
 }
 
 int enc_untrusted_raise(int sig) {
@@ -1049,14 +1412,8 @@ int enc_untrusted_raise(int sig) {
   MessageReader output;
   const auto status = NonSystemCallDispatcher(::asylo::host_call::kRaiseHandler,
                                               &input, &output);
-  CheckStatusAndParamCount(status, output, "enc_untrusted_raise", 2);
-
-  int result = output.next<int>();
-  int klinux_errno = output.next<int>();
-  if (result != 0) {
-    errno = FromkLinuxErrorNumber(klinux_errno);
-  }
-  return result;
+  CheckStatusAndParamCount(status, output, "enc_untrusted_raise", 1);
+  return DecodeHostCallResult(output.next<int64_t>());
 }
 
 int enc_untrusted_getsockopt(int sockfd, int level, int optname, void *optval,
@@ -1192,11 +1549,9 @@ void enc_freeaddrinfo(struct addrinfo *res) {
 
 int enc_untrusted_poll(struct pollfd *fds, nfds_t nfds, int timeout) {
   auto klinux_fds = absl::make_unique<struct klinux_pollfd[]>(nfds);
-  for (int i = 0; i < nfds; ++i) {
-    if (!TokLinuxPollfd(&fds[i], &klinux_fds[i])) {
-      errno = EFAULT;
-      return -1;
-    }
+  if (!TokLinuxPollfdArray(fds, klinux_fds.get(), nfds)) {
+    errno = EFAULT;
+    return -1;
   }
 
   int result = EnsureInitializedAndDispatchSyscall(
@@ -1207,17 +1562,15 @@ int enc_untrusted_poll(struct pollfd *fds, nfds_t nfds, int timeout) {
     return result;
   }
 
-  for (int i = 0; i < nfds; ++i) {
-    if (!FromkLinuxPollfd(&klinux_fds[i], &fds[i])) {
-      errno = EFAULT;
-      return -1;
-    }
+  if (!FromkLinuxPollfdArray(klinux_fds.get(), fds, nfds)) {
+    errno = EFAULT;
+    return -1;
   }
   return result;
 }
 
 int enc_untrusted_epoll_create(int size) {
-  return EnsureInitializedAndDispatchSyscall(
+  return EnsureInitializedAndDispatchScalarSyscall(
       asylo::system_call::kSYS_epoll_create, size);
 }
 
@@ -1439,11 +1792,9 @@ int enc_untrusted_epoll_wait(int epfd, struct epoll_event *events,
         "supplied.");
   }
 
-  for (int i = 0; i < result; i++) {
-    if (!FromkLinuxEpollEvent(&klinux_events.get()[i], &events[i])) {
-      errno = EBADE;
-      return -1;
-    }
+  if (!FromkLinuxEpollEventArray(klinux_events.get(), events, result)) {
+    errno = EBADE;
+    return -1;
   }
   return result;
 }
@@ -1623,6 +1974,34 @@ int enc_untrusted_inotify_read(int fd, size_t count, char **serialized_events,
   return result;
 }
 
+ssize_t enc_untrusted_inotify_read_batch(int fd, void *buf, size_t count) {
+  if (!TrustedPrimitives::IsOutsideEnclave(buf, count)) {
+    TrustedPrimitives::BestEffortAbort(
+        "enc_untrusted_inotify_read_batch: buffer should be in untrusted "
+        "memory.");
+  }
+  MessageWriter input;
+  MessageReader output;
+  input.Push<int>(fd);
+  input.Push<uintptr_t>(reinterpret_cast<uintptr_t>(buf));
+  input.Push<uint64_t>(count);
+
+  const auto status = NonSystemCallDispatcher(
+      ::asylo::host_call::kInotifyReadBatchHandler, &input, &output);
+  CheckStatusAndParamCount(status, output, "enc_untrusted_inotify_read_batch",
+                           1);
+  ssize_t result = DecodeHostCallResult(output.next<int64_t>());
+  if (result < 0) {
+    return -1;
+  }
+  if (static_cast<size_t>(result) > count) {
+    TrustedPrimitives::BestEffortAbort(
+        "enc_untrusted_inotify_read_batch: result found to be greater than "
+        "the buffer size.");
+  }
+  return result;
+}
+
 int enc_untrusted_ioctl1(int fd, uint64_t request) {
   return EnsureInitializedAndDispatchSyscall(asylo::system_call::kSYS_ioctl, fd,
                                              request);
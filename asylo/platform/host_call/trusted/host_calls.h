@@ -30,7 +30,9 @@
 #include <poll.h>
 #include <sched.h>
 #include <sys/epoll.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #include <cstdarg>
 #include <cstddef>
@@ -41,10 +43,9 @@
 #include "asylo/platform/system_call/sysno.h"
 #include "asylo/platform/system_call/system_call.h"
 
-// Ensures that the host call library is initialized, then dispatches the
-// syscall to enc_untrusted_syscall.
-template <class... Ts>
-int64_t EnsureInitializedAndDispatchSyscall(int sysno, Ts... args) {
+// Installs the host call system call dispatcher and error handler if they
+// have not been installed yet.
+inline void EnsureSyscallDispatcherInitialized() {
   if (!enc_is_syscall_dispatcher_set()) {
     enc_set_dispatch_syscall(asylo::host_call::SystemCallDispatcher);
   }
@@ -52,9 +53,25 @@ int64_t EnsureInitializedAndDispatchSyscall(int sysno, Ts... args) {
     enc_set_error_handler(
         asylo::primitives::TrustedPrimitives::BestEffortAbort);
   }
+}
+
+// Ensures that the host call library is initialized, then dispatches the
+// syscall to enc_untrusted_syscall.
+template <class... Ts>
+int64_t EnsureInitializedAndDispatchSyscall(int sysno, Ts... args) {
+  EnsureSyscallDispatcherInitialized();
   return enc_untrusted_syscall(sysno, args...);
 }
 
+// Like EnsureInitializedAndDispatchSyscall, for system calls whose parameters
+// are all scalar inputs. The request is laid out at compile time, skipping the
+// system call metadata lookups of the generic path.
+template <class... Ts>
+int64_t EnsureInitializedAndDispatchScalarSyscall(int sysno, Ts... args) {
+  EnsureSyscallDispatcherInitialized();
+  return asylo::system_call::UntrustedScalarSyscall(sysno, args...);
+}
+
 // Verifies the return status of the host call and checks if the expected number
 // of parameters are received on the MessageReader.
 void CheckStatusAndParamCount(const asylo::primitives::PrimitiveStatus &status,
@@ -133,6 +150,20 @@ ssize_t enc_untrusted_llistxattr(const char *path, char *list, size_t size);
 ssize_t enc_untrusted_flistxattr(int fd, char *list, size_t size);
 int enc_untrusted_pread64(int fd, void *buf, size_t count, off_t offset);
 int enc_untrusted_pwrite64(int fd, const void *buf, size_t count, off_t offset);
+// Maps a host file into untrusted memory. Returns the address of the mapping,
+// which is checked to lie outside the enclave, or MAP_FAILED on failure.
+void *enc_untrusted_mmap(void *addr, size_t length, int prot, int flags, int fd,
+                         off_t offset);
+int enc_untrusted_munmap(void *addr, size_t length);
+int enc_untrusted_msync(void *addr, size_t length, int flags);
+ssize_t enc_untrusted_getrandom(void *buf, size_t buflen, unsigned int flags);
+ssize_t enc_untrusted_sendfile(int out_fd, int in_fd, off_t *offset,
+                               size_t count);
+ssize_t enc_untrusted_splice(int fd_in, off_t *off_in, int fd_out,
+                             off_t *off_out, size_t len, unsigned int flags);
+ssize_t enc_untrusted_copy_file_range(int fd_in, off_t *off_in, int fd_out,
+                                      off_t *off_out, size_t len,
+                                      unsigned int flags);
 int enc_untrusted_wait(int *wstatus);
 int enc_untrusted_close(int fd);
 int enc_untrusted_nanosleep(const struct timespec *req, struct timespec *rem);
@@ -168,10 +199,33 @@ int64_t enc_untrusted_sysconf(int name);
 void *enc_untrusted_realloc(void *ptr, size_t size);
 uint32_t enc_untrusted_sleep(uint32_t seconds);
 ssize_t enc_untrusted_sendmsg(int sockfd, const struct msghdr *msg, int flags);
+ssize_t enc_untrusted_writev(int fd, const struct iovec *iov, int iovcnt);
+ssize_t enc_untrusted_readv(int fd, const struct iovec *iov, int iovcnt);
+ssize_t enc_untrusted_pwritev(int fd, const struct iovec *iov, int iovcnt,
+                              off_t offset);
+ssize_t enc_untrusted_preadv(int fd, const struct iovec *iov, int iovcnt,
+                             off_t offset);
+ssize_t enc_untrusted_preadv2(int fd, const struct iovec *iov, int iovcnt,
+                              off_t offset, int flags);
 ssize_t enc_untrusted_recvmsg(int sockfd, struct msghdr *msg, int flags);
+int enc_untrusted_sendmmsg(int sockfd, struct mmsghdr *msgvec,
+                           unsigned int vlen, int flags);
+int enc_untrusted_recvmmsg(int sockfd, struct mmsghdr *msgvec,
+                           unsigned int vlen, int flags,
+                           struct timespec *timeout);
 int enc_untrusted_getsockname(int sockfd, struct sockaddr *addr,
                               socklen_t *addrlen);
 int enc_untrusted_accept(int sockfd, struct sockaddr *addr, socklen_t *addrlen);
+
+// Accepts up to |max_connections| connections on |sockfd| with accept4(2)
+// |flags| in a single host call, blocking as accept4 would for the first
+// connection only. Writes the host file descriptors of the connections to
+// |fds| and their peer addresses to |addrs| and |addrlens|, each of which
+// must hold |max_connections| entries. Returns the number of connections
+// accepted, or -1 with errno set if none was.
+int enc_untrusted_accept4_batch(int sockfd, int flags, int max_connections,
+                                int *fds, struct sockaddr_storage *addrs,
+                                socklen_t *addrlens);
 int enc_untrusted_getpeername(int sockfd, struct sockaddr *addr,
                               socklen_t *addrlen);
 ssize_t enc_untrusted_recvfrom(int sockfd, void *buf, size_t len, int flags,
@@ -199,6 +253,12 @@ void enc_untrusted_openlog(const char *ident, int option, int facility);
 int enc_untrusted_inotify_read(int fd, size_t count, char **serialized_events,
                                size_t *serialized_events_len);
 
+// Reads up to |count| bytes of inotify events from the host inotify instance
+// |fd| into |buf|, which must lie in untrusted memory, and coalesces them in
+// place with host_call::CoalesceInotifyEvents. Returns the number of bytes
+// holding klinux_inotify_event records in |buf|, or -1 with errno set.
+ssize_t enc_untrusted_inotify_read_batch(int fd, void *buf, size_t count);
+
 // Untrusted futex host calls, where the futex word |*futex| lies in the
 // untrusted local memory. Callers must not assume access to the untrusted futex
 // word.
@@ -234,6 +294,10 @@ void enc_untrusted_disable_waiting(int32_t *const queue);
 // Enable waiting on the given |queue|.
 void enc_untrusted_enable_waiting(int32_t *const queue);
 
+// Returns true if waiting is enabled on the given |queue|. The queue lives in
+// untrusted memory, so the result is only a hint.
+bool enc_untrusted_is_waiting_enabled(int32_t *const queue);
+
 // Set the |queue| state to a specific |value|.
 void enc_untrusted_wait_queue_set_value(int32_t *const queue, int32_t value);
 
@@ -0,0 +1,186 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/host_call/trusted/io_uring_client.h"
+
+#include <errno.h>
+
+#include <atomic>
+#include <cstring>
+
+#include "asylo/platform/host_call/exit_handler_constants.h"
+#include "asylo/platform/host_call/trusted/host_call_dispatcher.h"
+#include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/platform/primitives/trusted_primitives.h"
+#include "asylo/platform/system_call/type_conversions/types_functions.h"
+
+namespace asylo {
+namespace host_call {
+
+using primitives::MessageReader;
+using primitives::MessageWriter;
+using primitives::TrustedPrimitives;
+
+namespace {
+
+// Upper bounds on the ring sizes accepted from the host, matching the limits
+// of the kernel.
+constexpr uint32_t kMaxSqEntries = 32768;
+constexpr uint32_t kMaxCqEntries = 2 * kMaxSqEntries;
+
+bool IsValidRingSize(uint32_t entries, uint32_t max_entries) {
+  return entries != 0 && entries <= max_entries &&
+         (entries & (entries - 1)) == 0;
+}
+
+// Aborts unless every part of |queues| lies in untrusted memory.
+void ValidateQueues(const IoUringQueues &queues) {
+  bool valid =
+      IsValidRingSize(queues.sq_entries, kMaxSqEntries) &&
+      IsValidRingSize(queues.cq_entries, kMaxCqEntries) &&
+      TrustedPrimitives::IsOutsideEnclave(queues.sq_head, sizeof(uint32_t)) &&
+      TrustedPrimitives::IsOutsideEnclave(queues.sq_tail, sizeof(uint32_t)) &&
+      TrustedPrimitives::IsOutsideEnclave(queues.sq_flags, sizeof(uint32_t)) &&
+      TrustedPrimitives::IsOutsideEnclave(
+          queues.sq_array, queues.sq_entries * sizeof(uint32_t)) &&
+      TrustedPrimitives::IsOutsideEnclave(
+          queues.sqes, queues.sq_entries * sizeof(klinux_io_uring_sqe)) &&
+      TrustedPrimitives::IsOutsideEnclave(queues.cq_head, sizeof(uint32_t)) &&
+      TrustedPrimitives::IsOutsideEnclave(queues.cq_tail, sizeof(uint32_t)) &&
+      TrustedPrimitives::IsOutsideEnclave(
+          queues.cqes, queues.cq_entries * sizeof(klinux_io_uring_cqe));
+  if (!valid) {
+    TrustedPrimitives::BestEffortAbort(
+        "IoUringClient: io_uring rings should be in untrusted local memory.");
+  }
+}
+
+}  // namespace
+
+std::unique_ptr<IoUringClient> IoUringClient::Create(uint32_t entries) {
+  MessageWriter input;
+  MessageReader output;
+  input.Push<int32_t>(kIoUringSetup);
+  input.Push<uint32_t>(entries);
+  const auto status = NonSystemCallDispatcher(kIoUringHandler, &input, &output);
+  CheckStatusAndParamCount(status, output, "IoUringClient::Create", 4);
+  int result = output.next<int>();
+  int klinux_errno = output.next<int>();
+  uint64_t instance = output.next<uint64_t>();
+  IoUringQueues queues = output.next<IoUringQueues>();
+  if (result != 0) {
+    errno = FromkLinuxErrorNumber(klinux_errno);
+    return nullptr;
+  }
+  ValidateQueues(queues);
+  // The initial indices are owned by the kernel until the first submission,
+  // and are normally zero.
+  std::unique_ptr<IoUringClient> client(new IoUringClient(instance, queues));
+  client->sq_tail_ = __atomic_load_n(queues.sq_tail, __ATOMIC_ACQUIRE);
+  client->cq_head_ = __atomic_load_n(queues.cq_head, __ATOMIC_ACQUIRE);
+  return client;
+}
+
+IoUringClient::~IoUringClient() {
+  MessageWriter input;
+  MessageReader output;
+  input.Push<int32_t>(kIoUringDestroy);
+  input.Push<uint64_t>(instance_);
+  const auto status = NonSystemCallDispatcher(kIoUringHandler, &input, &output);
+  CheckStatusAndParamCount(status, output, "IoUringClient::~IoUringClient", 1);
+}
+
+bool IoUringClient::Queue(const klinux_io_uring_sqe &sqe) {
+  uint32_t head = __atomic_load_n(queues_.sq_head, __ATOMIC_ACQUIRE);
+  if (sq_tail_ - head >= queues_.sq_entries) {
+    return false;
+  }
+  uint32_t index = sq_tail_ & (queues_.sq_entries - 1);
+  memcpy(&queues_.sqes[index], &sqe, sizeof(sqe));
+  queues_.sq_array[index] = index;
+  sq_tail_++;
+  unsubmitted_++;
+  // Publish the entry. A kernel polling thread picks it up from here.
+  __atomic_store_n(queues_.sq_tail, sq_tail_, __ATOMIC_RELEASE);
+  return true;
+}
+
+int IoUringClient::Submit(bool wait) {
+  uint32_t to_submit = 0;
+  uint32_t flags = wait ? kLinuxIoUringEnterGetEvents : 0;
+  if (sq_polling()) {
+    // The tail update must be visible before the wakeup flag is read, or a
+    // polling thread going to sleep could miss the new entries.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (unsubmitted_ != 0 &&
+        (__atomic_load_n(queues_.sq_flags, __ATOMIC_RELAXED) &
+         kLinuxIoUringSqNeedWakeup)) {
+      flags |= kLinuxIoUringEnterSqWakeup;
+    }
+  } else {
+    to_submit = unsubmitted_;
+  }
+  unsubmitted_ = 0;
+  if (to_submit == 0 && flags == 0) {
+    return 0;
+  }
+  return Enter(to_submit, wait ? 1 : 0, flags) < 0 ? -1 : 0;
+}
+
+int IoUringClient::Reap(klinux_io_uring_cqe *cqes, int max_cqes) {
+  uint32_t tail = __atomic_load_n(queues_.cq_tail, __ATOMIC_ACQUIRE);
+  uint32_t available = tail - cq_head_;
+  if (available > queues_.cq_entries) {
+    available = queues_.cq_entries;
+  }
+  int count = 0;
+  while (count < max_cqes && static_cast<uint32_t>(count) < available) {
+    uint32_t index = (cq_head_ + count) & (queues_.cq_entries - 1);
+    memcpy(&cqes[count], &queues_.cqes[index], sizeof(klinux_io_uring_cqe));
+    count++;
+  }
+  cq_head_ += count;
+  __atomic_store_n(queues_.cq_head, cq_head_, __ATOMIC_RELEASE);
+  return count;
+}
+
+int IoUringClient::Wait() {
+  return Enter(0, 1, kLinuxIoUringEnterGetEvents) < 0 ? -1 : 0;
+}
+
+int IoUringClient::Enter(uint32_t to_submit, uint32_t min_complete,
+                         uint32_t flags) {
+  MessageWriter input;
+  MessageReader output;
+  input.Push<int32_t>(kIoUringEnter);
+  input.Push<uint64_t>(instance_);
+  input.Push<uint32_t>(to_submit);
+  input.Push<uint32_t>(min_complete);
+  input.Push<uint32_t>(flags);
+  const auto status = NonSystemCallDispatcher(kIoUringHandler, &input, &output);
+  CheckStatusAndParamCount(status, output, "IoUringClient::Enter", 2);
+  int result = output.next<int>();
+  int klinux_errno = output.next<int>();
+  if (result < 0) {
+    errno = FromkLinuxErrorNumber(klinux_errno);
+  }
+  return result;
+}
+
+}  // namespace host_call
+}  // namespace asylo
@@ -0,0 +1,106 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_HOST_CALL_TRUSTED_IO_URING_CLIENT_H_
+#define ASYLO_PLATFORM_HOST_CALL_TRUSTED_IO_URING_CLIENT_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "asylo/platform/host_call/io_uring_abi.h"
+
+namespace asylo {
+namespace host_call {
+
+// Trusted side of an io_uring instance set up by the host. Submission entries
+// are written and completions are read directly in the rings shared with the
+// kernel, in untrusted memory. Exits are only needed to call io_uring_enter:
+// to submit entries when the kernel does not poll the submission queue, to
+// wake the kernel polling thread up when it sleeps, and to block waiting for
+// completions.
+//
+// The rings are untrusted. Their location is validated once at creation and
+// kept in trusted memory, ring indices are reduced modulo the ring sizes, and
+// completions are copied out before they are interpreted. A misbehaving host
+// can only drop, delay or forge completions, which callers must tolerate.
+//
+// This class is not thread-safe, except for Wait().
+class IoUringClient {
+ public:
+  // Sets up an io_uring instance on the host with room for |entries|
+  // submission entries. Returns nullptr and sets errno on failure.
+  static std::unique_ptr<IoUringClient> Create(uint32_t entries);
+
+  // Tears the host instance down. Entries still in flight may complete into
+  // their buffers afterwards, so callers must only destroy a client once it
+  // has no entries in flight.
+  ~IoUringClient();
+
+  IoUringClient(const IoUringClient &other) = delete;
+  IoUringClient &operator=(const IoUringClient &other) = delete;
+
+  // Returns the number of entries of the submission and completion queues.
+  uint32_t sq_entries() const { return queues_.sq_entries; }
+  uint32_t cq_entries() const { return queues_.cq_entries; }
+
+  // Returns true if a kernel thread polls the submission queue.
+  bool sq_polling() const { return queues_.sq_polling != 0; }
+
+  // Appends |sqe| to the submission queue. Returns false if the queue is full.
+  bool Queue(const klinux_io_uring_sqe &sqe);
+
+  // Submits the queued entries, leaving the enclave only if needed. If
+  // |wait| is set, also blocks until at least one completion is available.
+  // Returns 0 on success, or -1 with errno set.
+  int Submit(bool wait);
+
+  // Copies up to |max_cqes| available completions to |cqes| without leaving
+  // the enclave, and returns the number of completions copied.
+  int Reap(klinux_io_uring_cqe *cqes, int max_cqes);
+
+  // Blocks until at least one completion is available. Unlike the other
+  // members, may be called concurrently with them. Returns 0 on success, or -1
+  // with errno set.
+  int Wait();
+
+ private:
+  IoUringClient(uint64_t instance, const IoUringQueues &queues)
+      : instance_(instance),
+        queues_(queues),
+        sq_tail_(0),
+        cq_head_(0),
+        unsubmitted_(0) {}
+
+  // Calls io_uring_enter on the host instance.
+  int Enter(uint32_t to_submit, uint32_t min_complete, uint32_t flags);
+
+  // Host handle of the instance.
+  const uint64_t instance_;
+  // Trusted copy of the location of the rings.
+  const IoUringQueues queues_;
+  // Trusted copies of the indices owned by the enclave.
+  uint32_t sq_tail_;
+  uint32_t cq_head_;
+  // Number of entries queued since the last io_uring_enter.
+  uint32_t unsubmitted_;
+};
+
+}  // namespace host_call
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_HOST_CALL_TRUSTED_IO_URING_CLIENT_H_
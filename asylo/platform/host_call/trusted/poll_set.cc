@@ -0,0 +1,128 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/host_call/trusted/poll_set.h"
+
+#include <errno.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "asylo/platform/host_call/exit_handler_constants.h"
+#include "asylo/platform/host_call/host_call_result.h"
+#include "asylo/platform/host_call/trusted/host_call_dispatcher.h"
+#include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/platform/primitives/trusted_primitives.h"
+#include "asylo/platform/primitives/util/message.h"
+#include "asylo/platform/system_call/type_conversions/types_functions.h"
+
+namespace asylo {
+namespace host_call {
+
+using primitives::MessageReader;
+using primitives::MessageWriter;
+using primitives::TrustedPrimitives;
+
+namespace {
+
+// Smallest number of entries allocated for a poll set.
+constexpr size_t kMinCapacity = 16;
+
+}  // namespace
+
+PollSet::~PollSet() {
+  if (fds_) {
+    TrustedPrimitives::UntrustedLocalFree(fds_);
+  }
+}
+
+bool PollSet::Resize(size_t nfds) {
+  if (nfds > capacity_) {
+    size_t capacity = std::max({nfds, 2 * capacity_, kMinCapacity});
+    size_t size = capacity * sizeof(struct klinux_pollfd);
+    struct klinux_pollfd *fds = static_cast<struct klinux_pollfd *>(
+        TrustedPrimitives::UntrustedLocalAlloc(size));
+    if (!fds) {
+      return false;
+    }
+    if (!TrustedPrimitives::IsOutsideEnclave(fds, size)) {
+      TrustedPrimitives::BestEffortAbort(
+          "PollSet: pollfd array should be in untrusted local memory.");
+    }
+    if (!entries_.empty()) {
+      TrustedPrimitives::UntrustedLocalMemcpy(
+          fds, entries_.data(), entries_.size() * sizeof(struct klinux_pollfd));
+    }
+    if (fds_) {
+      TrustedPrimitives::UntrustedLocalFree(fds_);
+    }
+    fds_ = fds;
+    capacity_ = capacity;
+  }
+
+  struct klinux_pollfd unused = {};
+  unused.klinux_fd = -1;
+  for (size_t i = entries_.size(); i < nfds; ++i) {
+    fds_[i] = unused;
+  }
+  entries_.resize(nfds, unused);
+  return true;
+}
+
+void PollSet::Set(size_t index, int host_fd, short events) {
+  struct klinux_pollfd entry = {};
+  entry.klinux_fd = host_fd;
+  entry.klinux_events = TokLinuxPollEvent(events);
+  if (entry.klinux_fd == entries_[index].klinux_fd &&
+      entry.klinux_events == entries_[index].klinux_events) {
+    return;
+  }
+  entries_[index] = entry;
+  fds_[index] = entry;
+}
+
+int PollSet::Poll(int timeout) {
+  MessageWriter input;
+  MessageReader output;
+  input.Push<uintptr_t>(reinterpret_cast<uintptr_t>(fds_));
+  input.Push<uint64_t>(entries_.size());
+  input.Push<int>(timeout);
+  const auto status = NonSystemCallDispatcher(kPollSetHandler, &input, &output);
+  CheckStatusAndParamCount(status, output, "PollSet::Poll", 1);
+
+  int64_t result = DecodeHostCallResult(output.next<int64_t>());
+  if (result < 0) {
+    return -1;
+  }
+  if (static_cast<size_t>(result) > entries_.size()) {
+    TrustedPrimitives::BestEffortAbort(
+        "PollSet::Poll: result found to be greater than the number of "
+        "entries.");
+  }
+  return result;
+}
+
+short PollSet::revents(size_t index) const {
+  int16_t klinux_revents;
+  memcpy(&klinux_revents, &fds_[index].klinux_revents, sizeof(klinux_revents));
+  return FromkLinuxPollEvent(klinux_revents);
+}
+
+}  // namespace host_call
+}  // namespace asylo
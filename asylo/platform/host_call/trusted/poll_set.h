@@ -0,0 +1,82 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_HOST_CALL_TRUSTED_POLL_SET_H_
+#define ASYLO_PLATFORM_HOST_CALL_TRUSTED_POLL_SET_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "asylo/platform/system_call/type_conversions/kernel_types.h"
+
+namespace asylo {
+namespace host_call {
+
+// A set of host file descriptors polled repeatedly. The kernel pollfd array of
+// the set lives in untrusted memory and is kept across calls: entries are only
+// written when they change, and the host polls the array in place, so revents
+// are read straight from shared memory instead of being serialized back.
+//
+// The array contents must be treated as attacker-controlled. The set keeps a
+// trusted copy of the entries it wrote and never reads them back; only revents
+// are read from the array. Not thread-safe.
+class PollSet {
+ public:
+  PollSet() : fds_(nullptr), capacity_(0) {}
+  ~PollSet();
+
+  PollSet(const PollSet &other) = delete;
+  PollSet &operator=(const PollSet &other) = delete;
+
+  // Sets the number of entries to |nfds|. Entries added by growing the set
+  // poll no file descriptor until set. Returns false if no untrusted memory
+  // could be allocated, in which case the set is unchanged.
+  bool Resize(size_t nfds);
+
+  // Returns the number of entries in the set.
+  size_t size() const { return entries_.size(); }
+
+  // Sets entry |index| to poll |host_fd| for |events|, given in the enclave
+  // representation. Writes to untrusted memory only if the entry changed.
+  void Set(size_t index, int host_fd, short events);
+
+  // Returns the host file descriptor polled by entry |index|.
+  int host_fd(size_t index) const { return entries_[index].klinux_fd; }
+
+  // Polls the entries of the set on the host. Returns the host poll result, or
+  // -1 with errno set on failure.
+  int Poll(int timeout);
+
+  // Returns the revents reported for entry |index| by the last successful
+  // Poll(), in the enclave representation.
+  short revents(size_t index) const;
+
+ private:
+  // Trusted copy of the entries last written to |fds_|.
+  std::vector<struct klinux_pollfd> entries_;
+
+  // Kernel pollfd array in untrusted memory, with room for |capacity_|
+  // entries.
+  struct klinux_pollfd *fds_;
+  size_t capacity_;
+};
+
+}  // namespace host_call
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_HOST_CALL_TRUSTED_POLL_SET_H_
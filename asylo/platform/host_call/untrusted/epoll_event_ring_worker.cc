@@ -0,0 +1,131 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/host_call/untrusted/epoll_event_ring_worker.h"
+
+#include <errno.h>
+#include <sys/epoll.h>
+
+#include <chrono>
+#include <limits>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "asylo/platform/common/futex.h"
+
+namespace asylo {
+namespace host_call {
+namespace {
+
+static_assert(sizeof(struct epoll_event) == sizeof(struct klinux_epoll_event),
+              "Host epoll events do not match the kernel representation.");
+
+// Time the worker blocks in epoll_wait before checking whether it was stopped.
+constexpr int kPollTimeoutMs = 10;
+
+// Time the worker sleeps when the ring is full, waiting for the enclave to
+// consume events. Events stay pending in the host epoll instance meanwhile.
+constexpr std::chrono::microseconds kFullRingSleep(50);
+
+struct Registry {
+  absl::Mutex mutex;
+  absl::flat_hash_map<EpollEventRing *, std::unique_ptr<EpollEventRingWorker>>
+      workers ABSL_GUARDED_BY(mutex);
+};
+
+Registry *GetRegistry() {
+  static Registry *registry = new Registry;
+  return registry;
+}
+
+void WakeConsumers(EpollEventRing *ring) {
+  sys_futex_wake(ring->sequence_word(), std::numeric_limits<int32_t>::max());
+}
+
+}  // namespace
+
+EpollEventRing *EpollEventRingWorker::Start(int epfd) {
+  std::unique_ptr<EpollEventRingWorker> worker(new EpollEventRingWorker(epfd));
+  EpollEventRing *ring = &worker->ring_;
+  worker->thread_ = std::thread(&EpollEventRingWorker::Run, worker.get());
+  Registry *registry = GetRegistry();
+  absl::MutexLock lock(&registry->mutex);
+  registry->workers[ring] = std::move(worker);
+  return ring;
+}
+
+bool EpollEventRingWorker::Stop(
+    EpollEventRing *ring, std::vector<struct klinux_epoll_event> *events) {
+  std::unique_ptr<EpollEventRingWorker> worker;
+  {
+    Registry *registry = GetRegistry();
+    absl::MutexLock lock(&registry->mutex);
+    auto it = registry->workers.find(ring);
+    if (it == registry->workers.end()) {
+      return false;
+    }
+    worker = std::move(it->second);
+    registry->workers.erase(it);
+  }
+  if (worker->ring_.Close()) {
+    WakeConsumers(&worker->ring_);
+  }
+  worker->thread_.join();
+  struct klinux_epoll_event buffer[EpollEventRing::kCapacity];
+  size_t count = worker->ring_.Pop(buffer, EpollEventRing::kCapacity);
+  events->insert(events->end(), buffer, buffer + count);
+  return true;
+}
+
+EpollEventRingWorker::EpollEventRingWorker(int epfd) : epfd_(epfd) {}
+
+EpollEventRingWorker::~EpollEventRingWorker() {
+  ring_.Close();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void EpollEventRingWorker::Run() {
+  struct klinux_epoll_event events[EpollEventRing::kCapacity];
+  while (!ring_.IsClosed()) {
+    size_t space = ring_.Space();
+    if (space == 0) {
+      std::this_thread::sleep_for(kFullRingSleep);
+      continue;
+    }
+    int result =
+        epoll_wait(epfd_, reinterpret_cast<struct epoll_event *>(events),
+                   static_cast<int>(space), kPollTimeoutMs);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      ring_.Fail(errno);
+      WakeConsumers(&ring_);
+      return;
+    }
+    if (result > 0 && ring_.Push(events, result)) {
+      WakeConsumers(&ring_);
+    }
+  }
+}
+
+}  // namespace host_call
+}  // namespace asylo
@@ -0,0 +1,66 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_HOST_CALL_UNTRUSTED_EPOLL_EVENT_RING_WORKER_H_
+#define ASYLO_PLATFORM_HOST_CALL_UNTRUSTED_EPOLL_EVENT_RING_WORKER_H_
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "asylo/platform/host_call/epoll_event_ring.h"
+
+namespace asylo {
+namespace host_call {
+
+// An untrusted thread collecting the events of a host epoll instance into an
+// EpollEventRing read by the enclave. Workers are tracked in a process-wide
+// registry keyed by their ring, so that the enclave only ever refers to a
+// worker through the ring pointer it was handed.
+class EpollEventRingWorker {
+ public:
+  // Starts a worker polling the host epoll instance |epfd|, and returns its
+  // ring. The ring remains valid until Stop() is called on it.
+  static EpollEventRing *Start(int epfd);
+
+  // Stops the worker owning |ring|, appends the events still buffered in the
+  // ring to |events|, and frees the ring. Returns false if |ring| was not
+  // returned by Start() or has already been stopped.
+  static bool Stop(EpollEventRing *ring,
+                   std::vector<struct klinux_epoll_event> *events);
+
+  ~EpollEventRingWorker();
+
+  EpollEventRingWorker(const EpollEventRingWorker &other) = delete;
+  EpollEventRingWorker &operator=(const EpollEventRingWorker &other) = delete;
+
+ private:
+  explicit EpollEventRingWorker(int epfd);
+
+  // Body of the worker thread.
+  void Run();
+
+  const int epfd_;
+  EpollEventRing ring_;
+  std::thread thread_;
+};
+
+}  // namespace host_call
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_HOST_CALL_UNTRUSTED_EPOLL_EVENT_RING_WORKER_H_
@@ -0,0 +1,174 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/host_call/untrusted/epoll_event_ring_worker.h"
+
+#include <errno.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "asylo/platform/host_call/epoll_event_ring.h"
+
+namespace asylo {
+namespace host_call {
+namespace {
+
+TEST(EpollEventRingTest, PushPop) {
+  EpollEventRing ring;
+  EXPECT_FALSE(ring.HasEvents());
+  EXPECT_EQ(ring.Space(), size_t{EpollEventRing::kCapacity});
+
+  struct klinux_epoll_event events[3];
+  for (int i = 0; i < 3; i++) {
+    events[i].events = i;
+    events[i].data.u64 = 100 + i;
+  }
+  int32_t sequence = ring.sequence();
+  EXPECT_FALSE(ring.Push(events, 3));
+  EXPECT_NE(ring.sequence(), sequence);
+  EXPECT_TRUE(ring.HasEvents());
+  EXPECT_EQ(ring.Space(), EpollEventRing::kCapacity - 3);
+
+  struct klinux_epoll_event popped[4];
+  ASSERT_EQ(ring.Pop(popped, 2), 2);
+  EXPECT_EQ(popped[0].data.u64, 100);
+  EXPECT_EQ(popped[1].data.u64, 101);
+  ASSERT_EQ(ring.Pop(popped, 4), 1);
+  EXPECT_EQ(popped[0].data.u64, 102);
+  EXPECT_FALSE(ring.HasEvents());
+}
+
+TEST(EpollEventRingTest, PushReportsWaiters) {
+  EpollEventRing ring;
+  struct klinux_epoll_event event{};
+  ring.AddWaiter();
+  EXPECT_TRUE(ring.Push(&event, 1));
+  EXPECT_TRUE(ring.Close());
+  ring.RemoveWaiter();
+  EXPECT_FALSE(ring.Push(&event, 1));
+  EXPECT_TRUE(ring.IsClosed());
+}
+
+TEST(EpollEventRingTest, WrapsAround) {
+  EpollEventRing ring;
+  std::vector<struct klinux_epoll_event> events(EpollEventRing::kCapacity);
+  std::vector<struct klinux_epoll_event> popped(EpollEventRing::kCapacity);
+  for (uint64_t round = 0; round < 3; round++) {
+    for (size_t i = 0; i < events.size(); i++) {
+      events[i].data.u64 = round * EpollEventRing::kCapacity + i;
+    }
+    ASSERT_EQ(ring.Space(), size_t{EpollEventRing::kCapacity});
+    ring.Push(events.data(), events.size());
+    EXPECT_EQ(ring.Space(), 0);
+    ASSERT_EQ(ring.Pop(popped.data(), popped.size()), popped.size());
+    for (size_t i = 0; i < popped.size(); i++) {
+      EXPECT_EQ(popped[i].data.u64, round * EpollEventRing::kCapacity + i);
+    }
+  }
+}
+
+TEST(EpollEventRingWorkerTest, CollectsEdgeTriggeredEvents) {
+  int pipe_fds[2];
+  ASSERT_EQ(pipe(pipe_fds), 0);
+  int epfd = epoll_create1(0);
+  ASSERT_GE(epfd, 0);
+  struct epoll_event event {};
+  event.events = EPOLLIN | EPOLLET;
+  event.data.u64 = 42;
+  ASSERT_EQ(epoll_ctl(epfd, EPOLL_CTL_ADD, pipe_fds[0], &event), 0);
+
+  EpollEventRing *ring = EpollEventRingWorker::Start(epfd);
+  ASSERT_NE(ring, nullptr);
+  ASSERT_EQ(write(pipe_fds[1], "x", 1), 1);
+
+  struct klinux_epoll_event popped[2];
+  size_t count = 0;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (count == 0 && std::chrono::steady_clock::now() < deadline) {
+    count = ring->Pop(popped, 2);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(count, 1);
+  EXPECT_EQ(popped[0].data.u64, 42);
+  EXPECT_TRUE(popped[0].events & EPOLLIN);
+
+  // The edge-triggered event is reported once, so nothing is left when the
+  // worker is stopped.
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  std::vector<struct klinux_epoll_event> leftover;
+  EXPECT_TRUE(EpollEventRingWorker::Stop(ring, &leftover));
+  EXPECT_TRUE(leftover.empty());
+  EXPECT_FALSE(EpollEventRingWorker::Stop(ring, &leftover));
+
+  close(epfd);
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+}
+
+TEST(EpollEventRingWorkerTest, StopReturnsBufferedEvents) {
+  int pipe_fds[2];
+  ASSERT_EQ(pipe(pipe_fds), 0);
+  int epfd = epoll_create1(0);
+  ASSERT_GE(epfd, 0);
+  struct epoll_event event {};
+  event.events = EPOLLIN | EPOLLET;
+  event.data.u64 = 7;
+  ASSERT_EQ(epoll_ctl(epfd, EPOLL_CTL_ADD, pipe_fds[0], &event), 0);
+  ASSERT_EQ(write(pipe_fds[1], "x", 1), 1);
+
+  EpollEventRing *ring = EpollEventRingWorker::Start(epfd);
+  ASSERT_NE(ring, nullptr);
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (!ring->HasEvents() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::vector<struct klinux_epoll_event> leftover;
+  EXPECT_TRUE(EpollEventRingWorker::Stop(ring, &leftover));
+  ASSERT_EQ(leftover.size(), 1);
+  EXPECT_EQ(leftover[0].data.u64, 7);
+
+  close(epfd);
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+}
+
+TEST(EpollEventRingWorkerTest, FailsOnInvalidEpollInstance) {
+  int pipe_fds[2];
+  ASSERT_EQ(pipe(pipe_fds), 0);
+  EpollEventRing *ring = EpollEventRingWorker::Start(pipe_fds[0]);
+  ASSERT_NE(ring, nullptr);
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (!ring->IsClosed() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_TRUE(ring->IsClosed());
+  EXPECT_EQ(ring->error(), EINVAL);
+  std::vector<struct klinux_epoll_event> leftover;
+  EXPECT_TRUE(EpollEventRingWorker::Stop(ring, &leftover));
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+}
+
+}  // namespace
+}  // namespace host_call
+}  // namespace asylo
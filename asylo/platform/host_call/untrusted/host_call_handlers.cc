@@ -21,23 +21,35 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <ifaddrs.h>
+#include <limits.h>
 #include <net/if.h>
 #include <netdb.h>
+#include <poll.h>
 #include <pwd.h>
 #include <signal.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <syslog.h>
 #include <unistd.h>
 
 #include <cstdint>
 #include <ctime>
+#include <memory>
+#include <vector>
 
 #include "asylo/platform/common/memory.h"
+#include "asylo/platform/host_call/exit_handler_constants.h"
+#include "asylo/platform/host_call/host_call_result.h"
 #include "asylo/platform/host_call/serializer_functions.h"
+#include "asylo/platform/host_call/untrusted/epoll_event_ring_worker.h"
 #include "asylo/platform/host_call/untrusted/host_call_handlers_util.h"
+#include "asylo/platform/host_call/untrusted/io_uring_engine.h"
 #include "asylo/platform/primitives/util/message.h"
 #include "asylo/platform/primitives/util/status_conversions.h"
 #include "asylo/platform/system_call/untrusted_invoke.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
 #include "asylo/util/hex_util.h"
 #include "asylo/util/status_macros.h"
 
@@ -52,6 +64,65 @@ void untrusted_abort_handler(const char *message) {
   abort();
 }
 
+// io_uring instances set up by enclaves, keyed by the handle returned to the
+// enclave.
+struct IoUringRegistry {
+  absl::Mutex mutex;
+  absl::flat_hash_map<uint64_t, std::unique_ptr<IoUringEngine>> engines
+      ABSL_GUARDED_BY(mutex);
+};
+
+// Reads [uint64_t iovcnt, Extent iov[iovcnt]] from |input| into |iov|, the
+// entries pointing into the message itself. |other_args| is the number of
+// other arguments of the message.
+Status ReadIovecs(primitives::MessageReader *input, size_t other_args,
+                  std::vector<struct iovec> *iov) {
+  uint64_t iovcnt = input->next<uint64_t>();
+  if (iovcnt > IOV_MAX || input->size() != other_args + 1 + iovcnt) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "Malformed iovec on the MessageReader."};
+  }
+  iov->resize(iovcnt);
+  for (auto &entry : *iov) {
+    auto extent = input->next();
+    entry.iov_base = extent.As<char>();
+    entry.iov_len = extent.size();
+  }
+  return Status::OkStatus();
+}
+
+// Reads [uint64_t iovcnt, uint64_t iov_len[iovcnt]] from |input| into |iov|,
+// the entries pointing into consecutive slices of |buffer|, which is allocated
+// to hold them all. |other_args| is the number of other arguments of the
+// message.
+Status AllocateIovecs(primitives::MessageReader *input, size_t other_args,
+                      std::vector<struct iovec> *iov,
+                      std::unique_ptr<char[]> *buffer) {
+  uint64_t iovcnt = input->next<uint64_t>();
+  if (iovcnt > IOV_MAX || input->size() != other_args + 1 + iovcnt) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "Malformed iovec on the MessageReader."};
+  }
+  iov->resize(iovcnt);
+  size_t total_size = 0;
+  for (auto &entry : *iov) {
+    entry.iov_len = input->next<uint64_t>();
+    total_size += entry.iov_len;
+  }
+  buffer->reset(new char[total_size]);
+  size_t offset = 0;
+  for (auto &entry : *iov) {
+    entry.iov_base = buffer->get() + offset;
+    offset += entry.iov_len;
+  }
+  return Status::OkStatus();
+}
+
+IoUringRegistry *GetIoUringRegistry() {
+  static IoUringRegistry *registry = new IoUringRegistry;
+  return registry;
+}
+
 }  // namespace
 
 Status SystemCallHandler(const std::shared_ptr<primitives::Client> &client,
@@ -60,14 +131,21 @@ Status SystemCallHandler(const std::shared_ptr<primitives::Client> &client,
   ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*input, 1);
   auto request = input->next();
 
-  Extent response;  // To be owned by untrusted call parameters.
+  // The response is written over the request when it fits, which is owned by
+  // |input| and outlives the serialization of |output|.
+  Extent response;
+  bool in_place;
   primitives::PrimitiveStatus status =
-      system_call::UntrustedInvoke(request, &response);
+      system_call::UntrustedInvokeInPlace(request, &response, &in_place);
   if (!status.ok()) {
     return primitives::MakeStatus(status);
   }
-  output->PushByCopy(response);
-  free(response.data());
+  if (in_place) {
+    output->PushByReference(response);
+  } else {
+    output->PushByCopy(response);
+    free(response.data());
+  }
 
   return Status::OkStatus();
 }
@@ -91,8 +169,8 @@ Status USleepHandler(const std::shared_ptr<primitives::Client> &client,
                      primitives::MessageWriter *output) {
   ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*input, 1);
   auto usec = input->next<useconds_t>();
-  output->Push<int>(usleep(usec));  // Push return value first.
-  output->Push<int>(errno);         // Push errno next.
+  int result = usleep(usec);
+  output->Push<int64_t>(EncodeHostCallResult(result, errno));
   return Status::OkStatus();
 }
 
@@ -131,7 +209,7 @@ Status SleepHandler(const std::shared_ptr<primitives::Client> &client,
 Status SendMsgHandler(const std::shared_ptr<primitives::Client> &client,
                       void *context, primitives::MessageReader *input,
                       primitives::MessageWriter *output) {
-  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*input, 6);
+  ASYLO_RETURN_IF_TOO_FEW_READER_ARGUMENTS(*input, 5);
   struct msghdr msg;
   int sockfd = input->next<int>();
 
@@ -139,14 +217,11 @@ Status SendMsgHandler(const std::shared_ptr<primitives::Client> &client,
   msg.msg_name = msg_name_extent.As<char>();
   msg.msg_namelen = msg_name_extent.size();
 
-  auto msg_iov_extent = input->next();
-  // The message is serialized into a single buffer on the trusted side.
-  struct iovec msg_iov[1];
-  memset(msg_iov, 0, sizeof(*msg_iov));
-  msg_iov[0].iov_base = msg_iov_extent.As<char>();
-  msg_iov[0].iov_len = msg_iov_extent.size();
-  msg.msg_iov = msg_iov;
-  msg.msg_iovlen = 1;
+  // Each buffer of the message is passed as its own extent, sent in place.
+  std::vector<struct iovec> msg_iov;
+  ASYLO_RETURN_IF_ERROR(ReadIovecs(input, /*other_args=*/5, &msg_iov));
+  msg.msg_iov = msg_iov.data();
+  msg.msg_iovlen = msg_iov.size();
 
   auto msg_control_extent = input->next();
   msg.msg_control = msg_control_extent.As<char>();
@@ -155,8 +230,71 @@ Status SendMsgHandler(const std::shared_ptr<primitives::Client> &client,
   msg.msg_flags = input->next<int>();
 
   int flags = input->next<int>();
-  output->Push<int64_t>(sendmsg(sockfd, &msg, flags));  // Push return value.
-  output->Push<int>(errno);                             // Push errno.
+  ssize_t result = sendmsg(sockfd, &msg, flags);
+  output->Push<int64_t>(EncodeHostCallResult(result, errno));
+  return Status::OkStatus();
+}
+
+Status WritevHandler(const std::shared_ptr<primitives::Client> &client,
+                     void *context, primitives::MessageReader *input,
+                     primitives::MessageWriter *output) {
+  ASYLO_RETURN_IF_TOO_FEW_READER_ARGUMENTS(*input, 2);
+  int fd = input->next<int>();
+  std::vector<struct iovec> iov;
+  ASYLO_RETURN_IF_ERROR(ReadIovecs(input, /*other_args=*/1, &iov));
+  ssize_t result = writev(fd, iov.data(), iov.size());
+  output->Push<int64_t>(EncodeHostCallResult(result, errno));
+  return Status::OkStatus();
+}
+
+Status ReadvHandler(const std::shared_ptr<primitives::Client> &client,
+                    void *context, primitives::MessageReader *input,
+                    primitives::MessageWriter *output) {
+  ASYLO_RETURN_IF_TOO_FEW_READER_ARGUMENTS(*input, 2);
+  int fd = input->next<int>();
+
+  // Read into consecutive slices of a single buffer, which the enclave
+  // scatters into its own buffers.
+  std::vector<struct iovec> iov;
+  std::unique_ptr<char[]> buffer;
+  ASYLO_RETURN_IF_ERROR(AllocateIovecs(input, /*other_args=*/1, &iov, &buffer));
+
+  ssize_t result = readv(fd, iov.data(), iov.size());
+  output->Push<int64_t>(EncodeHostCallResult(result, errno));
+  output->PushByCopy(
+      Extent{buffer.get(), result > 0 ? static_cast<size_t>(result) : 0});
+  return Status::OkStatus();
+}
+
+Status PWritevHandler(const std::shared_ptr<primitives::Client> &client,
+                      void *context, primitives::MessageReader *input,
+                      primitives::MessageWriter *output) {
+  ASYLO_RETURN_IF_TOO_FEW_READER_ARGUMENTS(*input, 4);
+  int fd = input->next<int>();
+  off_t offset = input->next<int64_t>();
+  int flags = input->next<int>();
+  std::vector<struct iovec> iov;
+  ASYLO_RETURN_IF_ERROR(ReadIovecs(input, /*other_args=*/3, &iov));
+  ssize_t result = pwritev2(fd, iov.data(), iov.size(), offset, flags);
+  output->Push<int64_t>(EncodeHostCallResult(result, errno));
+  return Status::OkStatus();
+}
+
+Status PReadvHandler(const std::shared_ptr<primitives::Client> &client,
+                     void *context, primitives::MessageReader *input,
+                     primitives::MessageWriter *output) {
+  ASYLO_RETURN_IF_TOO_FEW_READER_ARGUMENTS(*input, 4);
+  int fd = input->next<int>();
+  off_t offset = input->next<int64_t>();
+  int flags = input->next<int>();
+  std::vector<struct iovec> iov;
+  std::unique_ptr<char[]> buffer;
+  ASYLO_RETURN_IF_ERROR(AllocateIovecs(input, /*other_args=*/3, &iov, &buffer));
+
+  ssize_t result = preadv2(fd, iov.data(), iov.size(), offset, flags);
+  output->Push<int64_t>(EncodeHostCallResult(result, errno));
+  output->PushByCopy(
+      Extent{buffer.get(), result > 0 ? static_cast<size_t>(result) : 0});
   return Status::OkStatus();
 }
 
@@ -216,6 +354,140 @@ Status RecvMsgHandler(const std::shared_ptr<primitives::Client> &client,
   return Status::OkStatus();
 }
 
+Status SendMmsgHandler(const std::shared_ptr<primitives::Client> &client,
+                       void *context, primitives::MessageReader *input,
+                       primitives::MessageWriter *output) {
+  ASYLO_RETURN_IF_TOO_FEW_READER_ARGUMENTS(*input, 3);
+  int sockfd = input->next<int>();
+  int flags = input->next<int>();
+  uint64_t vlen = input->next<uint64_t>();
+  if (vlen > IOV_MAX) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "Malformed mmsghdr on the MessageReader."};
+  }
+
+  // Every message has a name, an iovec count and a control message besides
+  // its buffers, all of which are sent in place.
+  std::vector<struct mmsghdr> msgvec(vlen);
+  std::vector<std::vector<struct iovec>> msg_iovs(vlen);
+  size_t consumed = 3;
+  for (uint64_t i = 0; i < vlen; ++i) {
+    size_t remaining = input->size() - consumed;
+    if (remaining < 3) {
+      return {error::GoogleError::INVALID_ARGUMENT,
+              "Malformed mmsghdr on the MessageReader."};
+    }
+    struct msghdr &msg = msgvec[i].msg_hdr;
+    auto msg_name_extent = input->next();
+    msg.msg_name = msg_name_extent.As<char>();
+    msg.msg_namelen = msg_name_extent.size();
+
+    uint64_t iovcnt = input->next<uint64_t>();
+    if (iovcnt > IOV_MAX || remaining < 3 + iovcnt) {
+      return {error::GoogleError::INVALID_ARGUMENT,
+              "Malformed iovec on the MessageReader."};
+    }
+    msg_iovs[i].resize(iovcnt);
+    for (auto &entry : msg_iovs[i]) {
+      auto extent = input->next();
+      entry.iov_base = extent.As<char>();
+      entry.iov_len = extent.size();
+    }
+    msg.msg_iov = msg_iovs[i].data();
+    msg.msg_iovlen = iovcnt;
+
+    auto msg_control_extent = input->next();
+    msg.msg_control = msg_control_extent.As<char>();
+    msg.msg_controllen = msg_control_extent.size();
+    msg.msg_flags = 0;
+    msgvec[i].msg_len = 0;
+    consumed += 3 + iovcnt;
+  }
+  if (consumed != input->size()) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "Malformed mmsghdr on the MessageReader."};
+  }
+
+  int result = sendmmsg(sockfd, msgvec.data(), vlen, flags);
+  output->Push<int>(result);
+  output->Push<int>(errno);
+  std::vector<uint32_t> msg_len(result > 0 ? result : 0);
+  for (size_t i = 0; i < msg_len.size(); ++i) {
+    msg_len[i] = msgvec[i].msg_len;
+  }
+  output->PushByCopy(Extent{msg_len.data(), msg_len.size() * sizeof(uint32_t)});
+  return Status::OkStatus();
+}
+
+Status RecvMmsgHandler(const std::shared_ptr<primitives::Client> &client,
+                       void *context, primitives::MessageReader *input,
+                       primitives::MessageWriter *output) {
+  ASYLO_RETURN_IF_TOO_FEW_READER_ARGUMENTS(*input, 4);
+  int sockfd = input->next<int>();
+  int flags = input->next<int>();
+  auto timeout_extent = input->next();
+  uint64_t vlen = input->next<uint64_t>();
+  if (vlen > IOV_MAX || input->size() != 4 + 3 * vlen ||
+      (timeout_extent.size() != 0 &&
+       timeout_extent.size() != sizeof(struct timespec))) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "Malformed mmsghdr on the MessageReader."};
+  }
+  struct timespec timeout;
+  if (timeout_extent.size() != 0) {
+    memcpy(&timeout, timeout_extent.data(), sizeof(timeout));
+  }
+
+  // As for RecvMsgHandler, bound the name and control buffers, and receive
+  // each message into a single buffer, scattered once back in the enclave.
+  // All buffers are slices of a single allocation.
+  constexpr size_t kMaxBufferSize = 1024;
+  std::vector<struct mmsghdr> msgvec(vlen);
+  std::vector<struct iovec> msg_iov(vlen);
+  size_t total_size = 0;
+  for (uint64_t i = 0; i < vlen; ++i) {
+    struct msghdr &msg = msgvec[i].msg_hdr;
+    msg.msg_namelen = input->next<uint64_t>();
+    if (msg.msg_namelen >= kMaxBufferSize) {
+      msg.msg_namelen = 0;
+    }
+    msg_iov[i].iov_len = input->next<uint64_t>();
+    msg.msg_controllen = input->next<uint64_t>();
+    if (msg.msg_controllen >= kMaxBufferSize) {
+      msg.msg_controllen = 0;
+    }
+    total_size += msg.msg_namelen + msg_iov[i].iov_len + msg.msg_controllen;
+  }
+  std::unique_ptr<char[]> buffer(new char[total_size]);
+  char *next_buffer = buffer.get();
+  for (uint64_t i = 0; i < vlen; ++i) {
+    struct msghdr &msg = msgvec[i].msg_hdr;
+    msg.msg_name = msg.msg_namelen > 0 ? next_buffer : nullptr;
+    next_buffer += msg.msg_namelen;
+    msg_iov[i].iov_base = next_buffer;
+    next_buffer += msg_iov[i].iov_len;
+    msg.msg_iov = &msg_iov[i];
+    msg.msg_iovlen = 1;
+    msg.msg_control = msg.msg_controllen > 0 ? next_buffer : nullptr;
+    next_buffer += msg.msg_controllen;
+    msg.msg_flags = 0;
+    msgvec[i].msg_len = 0;
+  }
+
+  int result = recvmmsg(sockfd, msgvec.data(), vlen, flags,
+                        timeout_extent.size() != 0 ? &timeout : nullptr);
+  output->Push<int>(result);
+  output->Push<int>(errno);
+  for (int i = 0; i < result; ++i) {
+    const struct msghdr &msg = msgvec[i].msg_hdr;
+    output->PushByCopy(Extent{msg.msg_name, msg.msg_namelen});
+    output->PushByCopy(Extent{msg_iov[i].iov_base, msgvec[i].msg_len});
+    output->PushByCopy(Extent{msg.msg_control, msg.msg_controllen});
+    output->Push<int>(msg.msg_flags);
+  }
+  return Status::OkStatus();
+}
+
 Status GetSocknameHandler(const std::shared_ptr<primitives::Client> &client,
                           void *context, primitives::MessageReader *input,
                           primitives::MessageWriter *output) {
@@ -259,6 +531,56 @@ Status AcceptHandler(const std::shared_ptr<primitives::Client> &client,
   return Status::OkStatus();
 }
 
+Status Accept4BatchHandler(const std::shared_ptr<primitives::Client> &client,
+                           void *context, primitives::MessageReader *input,
+                           primitives::MessageWriter *output) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*input, 3);
+  int sockfd = input->next<int>();
+  int flags = input->next<int>();
+  int max_connections = input->next<int>();
+  if (max_connections <= 0) {
+    output->Push<int64_t>(EncodeHostCallResult(-1, EINVAL));
+    return Status::OkStatus();
+  }
+
+  std::vector<int> fds;
+  std::vector<struct sockaddr_storage> addrs;
+  while (fds.size() < static_cast<size_t>(max_connections)) {
+    // Only wait for the first connection. Later connections are only accepted
+    // if they are pending already, even on a blocking socket.
+    if (!fds.empty()) {
+      struct pollfd pending = {sockfd, POLLIN, 0};
+      if (poll(&pending, 1, /*timeout=*/0) <= 0 ||
+          !(pending.revents & POLLIN)) {
+        break;
+      }
+    }
+    struct sockaddr_storage sock_addr;
+    socklen_t sock_len = sizeof(sock_addr);
+    int ret = accept4(sockfd, reinterpret_cast<struct sockaddr *>(&sock_addr),
+                      &sock_len, flags);
+    if (ret < 0) {
+      if (fds.empty()) {
+        output->Push<int64_t>(EncodeHostCallResult(ret, errno));
+        return Status::OkStatus();
+      }
+      // The error is reported by the next call, if it persists.
+      break;
+    }
+    LOG_IF(FATAL, sock_len > sizeof(sock_addr))
+        << "Insufficient sockaddr buf space encountered for accept4 host call.";
+    fds.push_back(ret);
+    addrs.push_back(sock_addr);
+  }
+
+  output->Push<int64_t>(fds.size());
+  for (size_t i = 0; i < fds.size(); ++i) {
+    output->Push<int>(fds[i]);
+    output->Push<struct sockaddr_storage>(addrs[i]);
+  }
+  return Status::OkStatus();
+}
+
 Status GetPeernameHandler(const std::shared_ptr<primitives::Client> &client,
                           void *context, primitives::MessageReader *input,
                           primitives::MessageWriter *output) {
@@ -312,8 +634,8 @@ Status RaiseHandler(const std::shared_ptr<primitives::Client> &client,
                     primitives::MessageWriter *output) {
   ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*input, 1);
   int klinux_sig = input->next<int>();
-  output->Push<int>(raise(klinux_sig));
-  output->Push<int>(errno);
+  int result = raise(klinux_sig);
+  output->Push<int64_t>(EncodeHostCallResult(result, errno));
   return Status::OkStatus();
 }
 
@@ -594,5 +916,169 @@ Status LocalLifetimeAllocHandler(
   return Status::OkStatus();
 }
 
+Status BatchHandler(const std::shared_ptr<primitives::Client> &client,
+                    void *context, primitives::MessageReader *input,
+                    primitives::MessageWriter *output) {
+  ASYLO_RETURN_IF_TOO_FEW_READER_ARGUMENTS(*input, 1);
+  size_t remaining = input->size() - 1;
+  uint64_t count = input->next<uint64_t>();
+  for (uint64_t i = 0; i < count; i++) {
+    if (remaining < 2) {
+      return Status{error::GoogleError::INVALID_ARGUMENT,
+                    "Truncated host call batch."};
+    }
+    uint64_t selector = input->next<uint64_t>();
+    uint64_t num_extents = input->next<uint64_t>();
+    remaining -= 2;
+    if (num_extents > remaining) {
+      return Status{error::GoogleError::INVALID_ARGUMENT,
+                    "Truncated host call batch."};
+    }
+    remaining -= num_extents;
+
+    primitives::MessageReader call_input;
+    call_input.Deserialize(num_extents,
+                           [input](size_t i) { return input->next(); });
+    primitives::MessageWriter call_output;
+    Status status =
+        selector == kBatchHandler
+            ? Status{error::GoogleError::INVALID_ARGUMENT,
+                     "Host call batches cannot be nested."}
+            : client->exit_call_provider()->InvokeExitHandler(
+                  selector, &call_input, &call_output, client.get());
+
+    output->Push<int>(status.error_code());
+    output->PushString(std::string(status.error_message()));
+    if (!status.ok()) {
+      output->Push<uint64_t>(0);
+      continue;
+    }
+    output->Push<uint64_t>(call_output.size());
+    call_output.Serialize(
+        [output](primitives::Extent extent) { output->PushByCopy(extent); });
+  }
+  return Status::OkStatus();
+}
+
+Status EpollEventRingStartHandler(
+    const std::shared_ptr<primitives::Client> &client, void *context,
+    primitives::MessageReader *input, primitives::MessageWriter *output) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*input, 1);
+  int epfd = input->next<int>();
+  EpollEventRing *ring = EpollEventRingWorker::Start(epfd);
+  output->Push<uintptr_t>(reinterpret_cast<uintptr_t>(ring));
+  return Status::OkStatus();
+}
+
+Status EpollEventRingStopHandler(
+    const std::shared_ptr<primitives::Client> &client, void *context,
+    primitives::MessageReader *input, primitives::MessageWriter *output) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*input, 1);
+  auto *ring = reinterpret_cast<EpollEventRing *>(input->next<uintptr_t>());
+  std::vector<struct klinux_epoll_event> events;
+  bool stopped = EpollEventRingWorker::Stop(ring, &events);
+  output->Push<int>(stopped ? 0 : -1);
+  output->PushByCopy(Extent{events.data(), events.size()});
+  return Status::OkStatus();
+}
+
+Status PollSetHandler(const std::shared_ptr<primitives::Client> &client,
+                      void *context, primitives::MessageReader *input,
+                      primitives::MessageWriter *output) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*input, 3);
+  auto *fds = reinterpret_cast<struct pollfd *>(input->next<uintptr_t>());
+  uint64_t nfds = input->next<uint64_t>();
+  int timeout = input->next<int>();
+  int result = poll(fds, nfds, timeout);
+  output->Push<int64_t>(EncodeHostCallResult(result, errno));
+  return Status::OkStatus();
+}
+
+Status InotifyReadBatchHandler(
+    const std::shared_ptr<primitives::Client> &client, void *context,
+    primitives::MessageReader *input, primitives::MessageWriter *output) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*input, 3);
+  int fd = input->next<int>();
+  char *buf = reinterpret_cast<char *>(input->next<uintptr_t>());
+  uint64_t count = input->next<uint64_t>();
+
+  ssize_t bytes_read = read(fd, buf, count);
+  if (bytes_read < 0) {
+    output->Push<int64_t>(EncodeHostCallResult(bytes_read, errno));
+    return Status::OkStatus();
+  }
+  output->Push<int64_t>(CoalesceInotifyEvents(buf, bytes_read));
+  return Status::OkStatus();
+}
+
+Status IoUringHandler(const std::shared_ptr<primitives::Client> &client,
+                      void *context, primitives::MessageReader *input,
+                      primitives::MessageWriter *output) {
+  ASYLO_RETURN_IF_TOO_FEW_READER_ARGUMENTS(*input, 1);
+  int32_t operation = input->next<int32_t>();
+  IoUringRegistry *registry = GetIoUringRegistry();
+  switch (operation) {
+    case kIoUringSetup: {
+      ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*input, 2);
+      uint32_t entries = input->next<uint32_t>();
+      auto engine_or_error = IoUringEngine::Create(entries);
+      if (!engine_or_error.ok()) {
+        output->Push<int>(-1);
+        output->Push<int>(engine_or_error.status().error_code());
+        output->Push<uint64_t>(0);
+        output->Push<IoUringQueues>(IoUringQueues{});
+        return Status::OkStatus();
+      }
+      std::unique_ptr<IoUringEngine> engine =
+          std::move(engine_or_error).ValueOrDie();
+      uint64_t instance = reinterpret_cast<uint64_t>(engine.get());
+      output->Push<int>(0);
+      output->Push<int>(0);
+      output->Push<uint64_t>(instance);
+      output->Push<IoUringQueues>(engine->queues());
+      absl::MutexLock lock(&registry->mutex);
+      registry->engines[instance] = std::move(engine);
+      return Status::OkStatus();
+    }
+    case kIoUringEnter: {
+      ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*input, 5);
+      uint64_t instance = input->next<uint64_t>();
+      uint32_t to_submit = input->next<uint32_t>();
+      uint32_t min_complete = input->next<uint32_t>();
+      uint32_t flags = input->next<uint32_t>();
+      // Holding the registry lock shared keeps the instance alive while a
+      // thread is blocked waiting for completions.
+      absl::ReaderMutexLock lock(&registry->mutex);
+      auto it = registry->engines.find(instance);
+      if (it == registry->engines.end()) {
+        output->Push<int>(-1);
+        output->Push<int>(EBADF);
+        return Status::OkStatus();
+      }
+      output->Push<int>(it->second->Enter(to_submit, min_complete, flags));
+      output->Push<int>(errno);
+      return Status::OkStatus();
+    }
+    case kIoUringDestroy: {
+      ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*input, 2);
+      uint64_t instance = input->next<uint64_t>();
+      std::unique_ptr<IoUringEngine> engine;
+      {
+        absl::MutexLock lock(&registry->mutex);
+        auto it = registry->engines.find(instance);
+        if (it != registry->engines.end()) {
+          engine = std::move(it->second);
+          registry->engines.erase(it);
+        }
+      }
+      output->Push<int>(engine ? 0 : -1);
+      return Status::OkStatus();
+    }
+    default:
+      return Status{error::GoogleError::INVALID_ARGUMENT,
+                    "Unknown io_uring host call operation."};
+  }
+}
+
 }  // namespace host_call
 }  // namespace asylo
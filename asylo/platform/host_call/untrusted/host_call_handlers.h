@@ -43,7 +43,7 @@ Status IsAttyHandler(const std::shared_ptr<primitives::Client> &client,
                      primitives::MessageWriter *output);
 
 // usleep library call handler on the host; expects [useconds_t usec] and
-// returns [int].
+// returns [int64_t result word] as encoded by EncodeHostCallResult.
 Status USleepHandler(const std::shared_ptr<primitives::Client> &client,
                      void *context, primitives::MessageReader *input,
                      primitives::MessageWriter *output);
@@ -66,18 +66,66 @@ Status SleepHandler(const std::shared_ptr<primitives::Client> &client,
                     void *context, primitives::MessageReader *input,
                     primitives::MessageWriter *output);
 
-// sendmsg syscall handler on the host; expects [int sockfd, const struct msghdr
-// *msg, int flags] and returns [ssize_t].
+// sendmsg syscall handler on the host; expects [int sockfd, Extent name,
+// uint64_t iovcnt, Extent iov[iovcnt], Extent control, int msg_flags,
+// int flags] and returns [int64_t result word].
 Status SendMsgHandler(const std::shared_ptr<primitives::Client> &client,
                       void *context, primitives::MessageReader *input,
                       primitives::MessageWriter *output);
 
+// writev syscall handler on the host; expects [int fd, uint64_t iovcnt,
+// Extent iov[iovcnt]] and returns [int64_t result word].
+Status WritevHandler(const std::shared_ptr<primitives::Client> &client,
+                     void *context, primitives::MessageReader *input,
+                     primitives::MessageWriter *output);
+
+// readv syscall handler on the host; expects [int fd, uint64_t iovcnt,
+// uint64_t iov_len[iovcnt]] and returns [int64_t result word, Extent data],
+// where |data| holds the bytes read, to be scattered by the caller.
+Status ReadvHandler(const std::shared_ptr<primitives::Client> &client,
+                    void *context, primitives::MessageReader *input,
+                    primitives::MessageWriter *output);
+
+// pwritev2 syscall handler on the host; expects [int fd, int64_t offset,
+// int flags, uint64_t iovcnt, Extent iov[iovcnt]] and returns [int64_t result
+// word]. |flags| holds kernel RWF_* flags. Serves pwritev() as well, with no
+// flags.
+Status PWritevHandler(const std::shared_ptr<primitives::Client> &client,
+                      void *context, primitives::MessageReader *input,
+                      primitives::MessageWriter *output);
+
+// preadv2 syscall handler on the host; expects [int fd, int64_t offset,
+// int flags, uint64_t iovcnt, uint64_t iov_len[iovcnt]] and returns [int64_t
+// result word, Extent data], where |data| holds the bytes read, to be
+// scattered by the caller. |flags| holds kernel RWF_* flags. Serves preadv()
+// as well, with no flags.
+Status PReadvHandler(const std::shared_ptr<primitives::Client> &client,
+                     void *context, primitives::MessageReader *input,
+                     primitives::MessageWriter *output);
+
 // recvmsg syscall handler on the host; expects [int sockfd, struct msghdr *msg,
 // int flags] and returns [ssize_t].
 Status RecvMsgHandler(const std::shared_ptr<primitives::Client> &client,
                       void *context, primitives::MessageReader *input,
                       primitives::MessageWriter *output);
 
+// sendmmsg syscall handler on the host; expects [int sockfd, int flags,
+// uint64_t vlen] followed for each message by [Extent name, uint64_t iovcnt,
+// Extent iov[iovcnt], Extent control], and returns [int, int errno,
+// Extent msg_len], where |msg_len| holds a uint32_t per message sent.
+Status SendMmsgHandler(const std::shared_ptr<primitives::Client> &client,
+                       void *context, primitives::MessageReader *input,
+                       primitives::MessageWriter *output);
+
+// recvmmsg syscall handler on the host; expects [int sockfd, int flags,
+// Extent timeout, uint64_t vlen] followed for each message by
+// [uint64_t namelen, uint64_t datalen, uint64_t controllen], and returns
+// [int, int errno] followed for each message received by [Extent name,
+// Extent data, Extent control, int msg_flags].
+Status RecvMmsgHandler(const std::shared_ptr<primitives::Client> &client,
+                       void *context, primitives::MessageReader *input,
+                       primitives::MessageWriter *output);
+
 // getsockname syscall handler on the host; expects [int sockfd] and returns
 // [int /*result*/, int /*errno*/, sockaddr] on the MessageWriter.
 Status GetSocknameHandler(const std::shared_ptr<primitives::Client> &client,
@@ -90,6 +138,16 @@ Status AcceptHandler(const std::shared_ptr<primitives::Client> &client,
                      void *context, primitives::MessageReader *input,
                      primitives::MessageWriter *output);
 
+// accept4 syscall handler on the host accepting several connections at once;
+// expects [int sockfd, int flags, int max_connections] and returns [int64_t
+// result word, then for each connection accepted, int fd, sockaddr] on the
+// MessageWriter. Blocks as accept4 would for the first connection only, and
+// returns the connections that are pending on top of it, up to
+// |max_connections|. |flags| holds kernel SOCK_* flags.
+Status Accept4BatchHandler(const std::shared_ptr<primitives::Client> &client,
+                           void *context, primitives::MessageReader *input,
+                           primitives::MessageWriter *output);
+
 // getpeername syscall handler on the host; expects [int sockfd] and returns
 // [int /*result*/, int /*errno*/, sockaddr] on the MessageWriter.
 Status GetPeernameHandler(const std::shared_ptr<primitives::Client> &client,
@@ -103,8 +161,8 @@ Status RecvFromHandler(const std::shared_ptr<primitives::Client> &client,
                        void *context, primitives::MessageReader *input,
                        primitives::MessageWriter *output);
 
-// raise library call handler on the host; expects [int sig] and returns [int
-// /*result*/, int /*errno*/] on the MessageWriter.
+// raise library call handler on the host; expects [int sig] and returns
+// [int64_t result word] on the MessageWriter.
 Status RaiseHandler(const std::shared_ptr<primitives::Client> &client,
                     void *context, primitives::MessageReader *input,
                     primitives::MessageWriter *output);
@@ -216,14 +274,14 @@ Status ClockGettimeHandler(const std::shared_ptr<primitives::Client> &client,
                            primitives::MessageWriter *output);
 
 // Handler for host call enc_untrusted_sys_futex_wait(). Expects [int32_t
-// *futex, int32_t expected, int64_t timeout_microsec] and returns [int result,
-// int errno] on the MessageWriter.
+// *futex, int32_t expected, int64_t timeout_microsec] and returns [int64_t
+// result word] on the MessageWriter.
 Status SysFutexWaitHandler(const std::shared_ptr<primitives::Client> &client,
                            void *context, primitives::MessageReader *input,
                            primitives::MessageWriter *output);
 
 // Handler for host call enc_untrusted_sys_futex_wake(). Expects [int32_t
-// *futex, int32_t num] and returns [int result, int errno] on the
+// *futex, int32_t num] and returns [int64_t result word] on the
 // MessageWriter.
 Status SysFutexWakeHandler(const std::shared_ptr<primitives::Client> &client,
                            void *context, primitives::MessageReader *input,
@@ -236,6 +294,54 @@ Status LocalLifetimeAllocHandler(
     const std::shared_ptr<primitives::Client> &client, void *context,
     primitives::MessageReader *input, primitives::MessageWriter *output);
 
+// Handler for a batch of host calls. Expects [uint64_t count], followed by
+// [uint64_t selector, uint64_t num_extents, extents...] for each host call, and
+// invokes the exit handler registered for each selector in order. Returns
+// [int error_code, string error_message, uint64_t num_extents, extents...] for
+// each host call on the MessageWriter.
+Status BatchHandler(const std::shared_ptr<primitives::Client> &client,
+                    void *context, primitives::MessageReader *input,
+                    primitives::MessageWriter *output);
+
+// Handler starting an untrusted thread that collects the events of a host
+// epoll instance into an EpollEventRing. Expects [int epfd] and returns
+// [uintptr_t ring] on the MessageWriter.
+Status EpollEventRingStartHandler(
+    const std::shared_ptr<primitives::Client> &client, void *context,
+    primitives::MessageReader *input, primitives::MessageWriter *output);
+
+// Handler stopping the thread filling an EpollEventRing and freeing the ring.
+// Expects [uintptr_t ring] and returns [int result, Extent events] on the
+// MessageWriter, where |events| holds the klinux_epoll_event entries still
+// buffered in the ring.
+Status EpollEventRingStopHandler(
+    const std::shared_ptr<primitives::Client> &client, void *context,
+    primitives::MessageReader *input, primitives::MessageWriter *output);
+
+// Handler polling a kernel pollfd array kept in untrusted memory by a trusted
+// PollSet. Expects [uintptr_t fds, uint64_t nfds, int timeout] and returns
+// [int64_t result word] on the MessageWriter. The revents are written to the
+// array in place.
+Status PollSetHandler(const std::shared_ptr<primitives::Client> &client,
+                      void *context, primitives::MessageReader *input,
+                      primitives::MessageWriter *output);
+
+// Handler reading inotify events into a buffer kept in untrusted memory by the
+// enclave. Expects [int fd, uintptr_t buf, uint64_t count] and returns
+// [int64_t result word] on the MessageWriter, holding the number of bytes of
+// the events coalesced by CoalesceInotifyEvents in the buffer.
+Status InotifyReadBatchHandler(
+    const std::shared_ptr<primitives::Client> &client, void *context,
+    primitives::MessageReader *input, primitives::MessageWriter *output);
+
+// Handler managing io_uring instances whose rings are shared with the enclave.
+// Expects [int32_t operation] followed by the arguments of the operation, and
+// returns its results on the MessageWriter, as described by
+// IoUringHostOperation.
+Status IoUringHandler(const std::shared_ptr<primitives::Client> &client,
+                      void *context, primitives::MessageReader *input,
+                      primitives::MessageWriter *output);
+
 }  // namespace host_call
 }  // namespace asylo
 
@@ -119,6 +119,48 @@ Status AddHostCallHandlersToExitCallProvider(
       kLocalLifetimeAllocHandler,
       primitives::ExitHandler{LocalLifetimeAllocHandler}));
 
+  ASYLO_RETURN_IF_ERROR(exit_call_provider->RegisterExitHandler(
+      kBatchHandler, primitives::ExitHandler{BatchHandler}));
+
+  ASYLO_RETURN_IF_ERROR(exit_call_provider->RegisterExitHandler(
+      kEpollEventRingStartHandler,
+      primitives::ExitHandler{EpollEventRingStartHandler}));
+
+  ASYLO_RETURN_IF_ERROR(exit_call_provider->RegisterExitHandler(
+      kEpollEventRingStopHandler,
+      primitives::ExitHandler{EpollEventRingStopHandler}));
+
+  ASYLO_RETURN_IF_ERROR(exit_call_provider->RegisterExitHandler(
+      kIoUringHandler, primitives::ExitHandler{IoUringHandler}));
+
+  ASYLO_RETURN_IF_ERROR(exit_call_provider->RegisterExitHandler(
+      kWritevHandler, primitives::ExitHandler{WritevHandler}));
+
+  ASYLO_RETURN_IF_ERROR(exit_call_provider->RegisterExitHandler(
+      kReadvHandler, primitives::ExitHandler{ReadvHandler}));
+
+  ASYLO_RETURN_IF_ERROR(exit_call_provider->RegisterExitHandler(
+      kSendMmsgHandler, primitives::ExitHandler{SendMmsgHandler}));
+
+  ASYLO_RETURN_IF_ERROR(exit_call_provider->RegisterExitHandler(
+      kRecvMmsgHandler, primitives::ExitHandler{RecvMmsgHandler}));
+
+  ASYLO_RETURN_IF_ERROR(exit_call_provider->RegisterExitHandler(
+      kPollSetHandler, primitives::ExitHandler{PollSetHandler}));
+
+  ASYLO_RETURN_IF_ERROR(exit_call_provider->RegisterExitHandler(
+      kInotifyReadBatchHandler,
+      primitives::ExitHandler{InotifyReadBatchHandler}));
+
+  ASYLO_RETURN_IF_ERROR(exit_call_provider->RegisterExitHandler(
+      kPReadvHandler, primitives::ExitHandler{PReadvHandler}));
+
+  ASYLO_RETURN_IF_ERROR(exit_call_provider->RegisterExitHandler(
+      kPWritevHandler, primitives::ExitHandler{PWritevHandler}));
+
+  ASYLO_RETURN_IF_ERROR(exit_call_provider->RegisterExitHandler(
+      kAccept4BatchHandler, primitives::ExitHandler{Accept4BatchHandler}));
+
   return Status::OkStatus();
 }
 
@@ -18,21 +18,39 @@
 
 #include "asylo/platform/host_call/untrusted/host_call_handlers.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
 #include <sys/syscall.h>
+#include <sys/un.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <cstring>
 #include <functional>
+#include <string>
+#include <vector>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include "absl/flags/flag.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "asylo/platform/host_call/exit_handler_constants.h"
+#include "asylo/platform/host_call/host_call_result.h"
 #include "asylo/platform/primitives/util/message.h"
 #include "asylo/platform/primitives/util/status_conversions.h"
 #include "asylo/platform/system_call/message.h"
 #include "asylo/platform/system_call/serialize.h"
+#include "asylo/platform/system_call/type_conversions/kernel_types.h"
 #include "asylo/test/util/status_matchers.h"
+#include "asylo/test/util/test_flags.h"
 
 using ::asylo::primitives::MessageReader;
 using ::asylo::primitives::MessageWriter;
+using ::testing::ElementsAre;
 using ::testing::IsEmpty;
 using ::testing::SizeIs;
 
@@ -197,13 +215,300 @@ TEST(HostCallHandlersTest, USleepValidRequestTest) {
   MessageWriter output;
   ASSERT_THAT(USleepHandler(nullptr, nullptr, &input, &output),
               StatusIs(error::GoogleError::OK));
-  ASSERT_THAT(output, SizeIs(2));
+  ASSERT_THAT(output, SizeIs(1));
   VerifyOutput(
       [](MessageReader *results) {
-        ASSERT_THAT(*results, SizeIs(2));
-        EXPECT_EQ(results->next<int>(), 0);
+        ASSERT_THAT(*results, SizeIs(1));
+        EXPECT_EQ(results->next<int64_t>(), 0);
+      },
+      &output);
+}
+
+// Verifies that a failed host call is reported as its negated errno, and a
+// successful one as its return value.
+TEST(HostCallHandlersTest, HostCallResultTest) {
+  EXPECT_EQ(EncodeHostCallResult(0, EBADF), 0);
+  EXPECT_EQ(EncodeHostCallResult(42, 0), 42);
+  EXPECT_EQ(EncodeHostCallResult(-1, EBADF), -EBADF);
+  EXPECT_EQ(EncodeHostCallResult(-1, 0), -EIO);
+
+  errno = 0;
+  EXPECT_EQ(DecodeHostCallResult(42), 42);
+  EXPECT_EQ(errno, 0);
+  EXPECT_EQ(DecodeHostCallResult(-EAGAIN), -1);
+  EXPECT_EQ(errno, EAGAIN);
+}
+
+// Invokes a batch hostcall for malformed requests, and verifies that they are
+// rejected before any host call is made.
+TEST(HostCallHandlersTest, BatchIncorrectSizeTest) {
+  MessageReader input;
+  MessageWriter output;
+  EXPECT_THAT(BatchHandler(nullptr, nullptr, &input, &output),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+
+  MessageReader truncated_input;
+  FillInput(
+      [](MessageWriter *params) {
+        params->Push<uint64_t>(1);  // One host call...
+        params->Push<uint64_t>(kIsAttyHandler);
+        params->Push<uint64_t>(2);  // ...claiming more extents than present.
+        params->Push(0);
+      },
+      &truncated_input);
+  EXPECT_THAT(BatchHandler(nullptr, nullptr, &truncated_input, &output),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  EXPECT_THAT(output, IsEmpty());
+}
+
+// Invokes an empty batch hostcall, and verifies that it succeeds with an empty
+// response.
+TEST(HostCallHandlersTest, BatchEmptyRequestTest) {
+  MessageReader input;
+  FillInput([](MessageWriter *params) { params->Push<uint64_t>(0); }, &input);
+  MessageWriter output;
+  ASSERT_THAT(BatchHandler(nullptr, nullptr, &input, &output),
+              StatusIs(error::GoogleError::OK));
+  EXPECT_THAT(output, IsEmpty());
+}
+
+// Invokes a PollSet hostcall on a pollfd array holding both ends of a pipe
+// with pending data, and verifies that the revents are written to the array in
+// place.
+TEST(HostCallHandlersTest, PollSetValidRequestTest) {
+  int pipe_fds[2];
+  ASSERT_EQ(pipe(pipe_fds), 0);
+  ASSERT_EQ(write(pipe_fds[1], "x", 1), 1);
+
+  struct pollfd fds[3] = {{pipe_fds[0], POLLIN, 0},
+                          {pipe_fds[1], POLLOUT, 0},
+                          {-1, POLLIN, POLLERR}};
+  MessageReader input;
+  FillInput(
+      [&fds](MessageWriter *params) {
+        params->Push<uintptr_t>(reinterpret_cast<uintptr_t>(fds));
+        params->Push<uint64_t>(3);
+        params->Push<int>(0);
+      },
+      &input);
+  MessageWriter output;
+  ASSERT_THAT(PollSetHandler(nullptr, nullptr, &input, &output), IsOk());
+  VerifyOutput(
+      [](MessageReader *results) {
+        ASSERT_THAT(*results, SizeIs(1));
+        EXPECT_EQ(results->next<int64_t>(), 2);
+      },
+      &output);
+  EXPECT_EQ(fds[0].revents, POLLIN);
+  EXPECT_EQ(fds[1].revents, POLLOUT);
+  EXPECT_EQ(fds[2].revents, 0);
+
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+}
+
+// Tests that InotifyReadBatchHandler collapses repeated events on the same
+// file into the untrusted buffer, and writes them as klinux_inotify_event
+// records.
+TEST(HostCallHandlersTest, InotifyReadBatchHandlerTest) {
+  std::string dir = absl::GetFlag(FLAGS_test_tmpdir);
+  std::string file_a = absl::StrCat(dir, "/inotify_batch_a.tmp");
+  std::string file_b = absl::StrCat(dir, "/inotify_batch_b.tmp");
+  int fd_a = open(file_a.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+  int fd_b = open(file_b.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+  ASSERT_GE(fd_a, 0);
+  ASSERT_GE(fd_b, 0);
+  int inotify_fd = inotify_init1(IN_NONBLOCK);
+  ASSERT_GE(inotify_fd, 0);
+  int wd = inotify_add_watch(inotify_fd, dir.c_str(), IN_MODIFY);
+  ASSERT_GE(wd, 0);
+
+  // Interleave the writes so that the kernel does not merge the events.
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(write(fd_a, "a", 1), 1);
+    ASSERT_EQ(write(fd_b, "b", 1), 1);
+  }
+
+  std::vector<char> buf(4096);
+  MessageReader input;
+  FillInput(
+      [&](MessageWriter *params) {
+        params->Push<int>(inotify_fd);
+        params->Push<uintptr_t>(reinterpret_cast<uintptr_t>(buf.data()));
+        params->Push<uint64_t>(buf.size());
+      },
+      &input);
+  MessageWriter output;
+  ASSERT_THAT(InotifyReadBatchHandler(nullptr, nullptr, &input, &output),
+              IsOk());
+  int result = -1;
+  VerifyOutput(
+      [&](MessageReader *results) {
+        ASSERT_THAT(*results, SizeIs(1));
+        result = results->next<int64_t>();
       },
       &output);
+
+  std::vector<std::string> names;
+  size_t offset = 0;
+  while (offset < static_cast<size_t>(result)) {
+    struct klinux_inotify_event event;
+    memcpy(&event, buf.data() + offset, sizeof(event));
+    EXPECT_EQ(event.klinux_wd, wd);
+    EXPECT_EQ(event.klinux_mask, kLinux_IN_MODIFY);
+    offset += sizeof(event);
+    names.emplace_back(buf.data() + offset);
+    offset += event.klinux_len;
+  }
+  EXPECT_EQ(offset, result);
+  EXPECT_THAT(names,
+              ElementsAre("inotify_batch_a.tmp", "inotify_batch_b.tmp"));
+
+  close(inotify_fd);
+  close(fd_a);
+  close(fd_b);
+}
+
+// Tests that PWritevHandler and PReadvHandler write and read a file at an
+// offset from several buffers, without moving the file offset.
+TEST(HostCallHandlersTest, PWritevPReadvHandlerTest) {
+  std::string path =
+      absl::StrCat(absl::GetFlag(FLAGS_test_tmpdir), "/pwritev_preadv.tmp");
+  int fd = open(path.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+  ASSERT_GE(fd, 0);
+
+  MessageReader write_input;
+  FillInput(
+      [&](MessageWriter *params) {
+        params->Push<int>(fd);
+        params->Push<int64_t>(4);
+        params->Push<int>(0);
+        params->Push<uint64_t>(2);
+        params->PushByCopy(primitives::Extent{"hello", 5});
+        params->PushByCopy(primitives::Extent{"world", 5});
+      },
+      &write_input);
+  MessageWriter write_output;
+  ASSERT_THAT(PWritevHandler(nullptr, nullptr, &write_input, &write_output),
+              IsOk());
+  VerifyOutput(
+      [](MessageReader *results) {
+        ASSERT_THAT(*results, SizeIs(1));
+        EXPECT_EQ(results->next<int64_t>(), 10);
+      },
+      &write_output);
+  EXPECT_EQ(lseek(fd, 0, SEEK_CUR), 0);
+
+  MessageReader read_input;
+  FillInput(
+      [&](MessageWriter *params) {
+        params->Push<int>(fd);
+        params->Push<int64_t>(6);
+        params->Push<int>(0);
+        params->Push<uint64_t>(2);
+        params->Push<uint64_t>(3);
+        params->Push<uint64_t>(16);
+      },
+      &read_input);
+  MessageWriter read_output;
+  ASSERT_THAT(PReadvHandler(nullptr, nullptr, &read_input, &read_output),
+              IsOk());
+  VerifyOutput(
+      [](MessageReader *results) {
+        ASSERT_THAT(*results, SizeIs(2));
+        EXPECT_EQ(results->next<int64_t>(), 8);
+        auto data = results->next();
+        EXPECT_EQ(std::string(data.As<char>(), data.size()), "lloworld");
+      },
+      &read_output);
+  EXPECT_EQ(lseek(fd, 0, SEEK_CUR), 0);
+
+  close(fd);
+}
+
+// Tests that PReadvHandler rejects a message with missing iovec lengths.
+TEST(HostCallHandlersTest, PReadvHandlerMalformedIovecTest) {
+  MessageReader input;
+  FillInput(
+      [](MessageWriter *params) {
+        params->Push<int>(0);
+        params->Push<int64_t>(0);
+        params->Push<int>(0);
+        params->Push<uint64_t>(2);
+        params->Push<uint64_t>(1);
+      },
+      &input);
+  MessageWriter output;
+  EXPECT_THAT(PReadvHandler(nullptr, nullptr, &input, &output),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+// Tests that Accept4BatchHandler accepts the pending connections in batches.
+TEST(HostCallHandlersTest, Accept4BatchHandlerTest) {
+  struct sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  std::string path =
+      absl::StrCat(absl::GetFlag(FLAGS_test_tmpdir), "/accept4_batch.sock");
+  ASSERT_LT(path.size(), sizeof(addr.sun_path));
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  unlink(path.c_str());
+  int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  ASSERT_GE(listener, 0);
+  ASSERT_EQ(bind(listener, reinterpret_cast<struct sockaddr *>(&addr),
+                 sizeof(addr)),
+            0);
+  ASSERT_EQ(listen(listener, 8), 0);
+  std::vector<int> clients;
+  for (int i = 0; i < 3; ++i) {
+    int client = socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_GE(client, 0);
+    ASSERT_EQ(connect(client, reinterpret_cast<struct sockaddr *>(&addr),
+                      sizeof(addr)),
+              0);
+    clients.push_back(client);
+  }
+
+  auto accept_batch = [listener](int max_connections,
+                                 std::vector<int> *fds) -> int64_t {
+    MessageReader input;
+    FillInput(
+        [&](MessageWriter *params) {
+          params->Push<int>(listener);
+          params->Push<int>(SOCK_CLOEXEC);
+          params->Push<int>(max_connections);
+        },
+        &input);
+    MessageWriter output;
+    EXPECT_THAT(Accept4BatchHandler(nullptr, nullptr, &input, &output),
+                IsOk());
+    int64_t result = 0;
+    VerifyOutput(
+        [&](MessageReader *results) {
+          result = results->next<int64_t>();
+          ASSERT_THAT(*results, SizeIs(1 + 2 * std::max<int64_t>(result, 0)));
+          for (int64_t i = 0; i < result; ++i) {
+            fds->push_back(results->next<int>());
+            results->next();
+          }
+        },
+        &output);
+    return result;
+  };
+
+  std::vector<int> fds;
+  EXPECT_EQ(accept_batch(2, &fds), 2);
+  EXPECT_EQ(accept_batch(4, &fds), 1);
+  EXPECT_EQ(accept_batch(4, &fds), -kLinux_EAGAIN);
+  ASSERT_THAT(fds, SizeIs(3));
+  for (int fd : fds) {
+    EXPECT_EQ(fcntl(fd, F_GETFD) & FD_CLOEXEC, FD_CLOEXEC);
+    close(fd);
+  }
+  for (int client : clients) {
+    close(client);
+  }
+  close(listener);
+  unlink(path.c_str());
 }
 
 }  // namespace
@@ -19,6 +19,7 @@
 #include "asylo/platform/host_call/untrusted/host_call_handlers_util.h"
 
 #include "asylo/platform/common/futex.h"
+#include "asylo/platform/host_call/host_call_result.h"
 
 namespace asylo {
 namespace host_call {
@@ -30,8 +31,8 @@ Status SysFutexWaitHelper(primitives::MessageReader *input,
                                               // to address of type in32_t.
   int32_t expected = input->next<int32_t>();
   int64_t timeout_microsec = input->next<int64_t>();
-  output->Push<int>(sys_futex_wait(futex, expected, timeout_microsec));
-  output->Push<int>(errno);
+  int result = sys_futex_wait(futex, expected, timeout_microsec);
+  output->Push<int64_t>(EncodeHostCallResult(result, errno));
   return Status::OkStatus();
 }
 
@@ -40,8 +41,8 @@ Status SysFutexWakeHelper(primitives::MessageReader *input,
   ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*input, 2);
   int32_t *futex = input->next<int32_t *>();
   int32_t num = input->next<int32_t>();
-  output->Push<int>(sys_futex_wake(futex, num));
-  output->Push<int>(errno);
+  int result = sys_futex_wake(futex, num);
+  output->Push<int64_t>(EncodeHostCallResult(result, errno));
   return Status::OkStatus();
 }
 
@@ -0,0 +1,135 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/host_call/untrusted/io_uring_engine.h"
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include "asylo/util/posix_error_space.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+namespace host_call {
+
+static_assert(sizeof(struct io_uring_sqe) == sizeof(klinux_io_uring_sqe),
+              "Host io_uring_sqe does not match klinux_io_uring_sqe.");
+static_assert(sizeof(struct io_uring_cqe) == sizeof(klinux_io_uring_cqe),
+              "Host io_uring_cqe does not match klinux_io_uring_cqe.");
+static_assert(IORING_SQ_NEED_WAKEUP == kLinuxIoUringSqNeedWakeup &&
+                  IORING_ENTER_GETEVENTS == kLinuxIoUringEnterGetEvents &&
+                  IORING_ENTER_SQ_WAKEUP == kLinuxIoUringEnterSqWakeup,
+              "Host io_uring flags do not match the enclave definitions.");
+static_assert(IORING_OP_READ == kLinuxIoUringOpRead &&
+                  IORING_OP_WRITE == kLinuxIoUringOpWrite &&
+                  IORING_OP_SEND == kLinuxIoUringOpSend &&
+                  IORING_OP_RECV == kLinuxIoUringOpRecv,
+              "Host io_uring opcodes do not match the enclave definitions.");
+
+namespace {
+
+int IoUringSetup(uint32_t entries, struct io_uring_params *params) {
+  return syscall(__NR_io_uring_setup, entries, params);
+}
+
+template <typename T>
+T *At(void *base, uint32_t offset) {
+  return reinterpret_cast<T *>(static_cast<uint8_t *>(base) + offset);
+}
+
+}  // namespace
+
+StatusOr<std::unique_ptr<IoUringEngine>> IoUringEngine::Create(
+    uint32_t entries) {
+  std::unique_ptr<IoUringEngine> engine(new IoUringEngine);
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  params.flags = IORING_SETUP_SQPOLL;
+  params.sq_thread_idle = kSqThreadIdleMs;
+  engine->fd_ = IoUringSetup(entries, &params);
+  if (engine->fd_ < 0) {
+    memset(&params, 0, sizeof(params));
+    engine->fd_ = IoUringSetup(entries, &params);
+  }
+  if (engine->fd_ < 0) {
+    return Status(static_cast<error::PosixError>(errno),
+                  "io_uring_setup failed");
+  }
+
+  engine->sq_ring_size_ =
+      params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  engine->cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  engine->sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  engine->sq_ring_ = engine->Map(engine->sq_ring_size_, IORING_OFF_SQ_RING);
+  engine->cq_ring_ = engine->Map(engine->cq_ring_size_, IORING_OFF_CQ_RING);
+  engine->sqes_ = engine->Map(engine->sqes_size_, IORING_OFF_SQES);
+  if (!engine->sq_ring_ || !engine->cq_ring_ || !engine->sqes_) {
+    return Status(static_cast<error::PosixError>(errno),
+                  "Failed to map io_uring rings");
+  }
+
+  IoUringQueues &queues = engine->queues_;
+  queues.sq_head = At<uint32_t>(engine->sq_ring_, params.sq_off.head);
+  queues.sq_tail = At<uint32_t>(engine->sq_ring_, params.sq_off.tail);
+  queues.sq_flags = At<uint32_t>(engine->sq_ring_, params.sq_off.flags);
+  queues.sq_array = At<uint32_t>(engine->sq_ring_, params.sq_off.array);
+  queues.sqes = static_cast<klinux_io_uring_sqe *>(engine->sqes_);
+  queues.sq_entries = params.sq_entries;
+  queues.cq_head = At<uint32_t>(engine->cq_ring_, params.cq_off.head);
+  queues.cq_tail = At<uint32_t>(engine->cq_ring_, params.cq_off.tail);
+  queues.cqes = At<klinux_io_uring_cqe>(engine->cq_ring_, params.cq_off.cqes);
+  queues.cq_entries = params.cq_entries;
+  queues.sq_polling = (params.flags & IORING_SETUP_SQPOLL) ? 1 : 0;
+  return engine;
+}
+
+IoUringEngine::~IoUringEngine() {
+  if (sqes_) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_) {
+    munmap(sq_ring_, sq_ring_size_);
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+int IoUringEngine::Enter(uint32_t to_submit, uint32_t min_complete,
+                         uint32_t flags) {
+  return syscall(__NR_io_uring_enter, fd_, to_submit, min_complete, flags,
+                 nullptr, 0);
+}
+
+void *IoUringEngine::Map(size_t size, uint64_t offset) {
+  void *region = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd_, offset);
+  return region == MAP_FAILED ? nullptr : region;
+}
+
+}  // namespace host_call
+}  // namespace asylo
@@ -0,0 +1,82 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_HOST_CALL_UNTRUSTED_IO_URING_ENGINE_H_
+#define ASYLO_PLATFORM_HOST_CALL_UNTRUSTED_IO_URING_ENGINE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "asylo/platform/host_call/io_uring_abi.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+namespace host_call {
+
+// An io_uring instance set up on behalf of an enclave. The submission and
+// completion rings are mapped into untrusted memory and described by an
+// IoUringQueues, which the enclave uses to fill submission entries and reap
+// completions directly. The engine only performs the system calls the enclave
+// cannot: setting the instance up, io_uring_enter, and tearing it down.
+//
+// The engine asks for a kernel submission polling thread, so that submitting
+// entries needs no system call while that thread is awake, and falls back to
+// a regular instance if the kernel refuses.
+class IoUringEngine {
+ public:
+  // Idle time after which the kernel submission polling thread sleeps.
+  static constexpr uint32_t kSqThreadIdleMs = 10;
+
+  // Sets up an io_uring instance with room for |entries| submission entries.
+  static StatusOr<std::unique_ptr<IoUringEngine>> Create(uint32_t entries);
+
+  // Unmaps the rings and closes the instance.
+  ~IoUringEngine();
+
+  IoUringEngine(const IoUringEngine &other) = delete;
+  IoUringEngine &operator=(const IoUringEngine &other) = delete;
+
+  // Returns the location of the rings.
+  const IoUringQueues &queues() const { return queues_; }
+
+  // Calls io_uring_enter on the instance. Returns the result of the system
+  // call, with errno set on failure.
+  int Enter(uint32_t to_submit, uint32_t min_complete, uint32_t flags);
+
+ private:
+  IoUringEngine() = default;
+
+  // Maps the region of the instance at |offset| of |size| bytes, returning
+  // nullptr on failure.
+  void *Map(size_t size, uint64_t offset);
+
+  int fd_ = -1;
+  void *sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  void *cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  void *sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+  IoUringQueues queues_ = {};
+};
+
+}  // namespace host_call
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_HOST_CALL_UNTRUSTED_IO_URING_ENGINE_H_
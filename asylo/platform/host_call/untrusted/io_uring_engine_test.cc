@@ -0,0 +1,128 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/host_call/untrusted/io_uring_engine.h"
+
+#include <unistd.h>
+
+#include <cstring>
+#include <memory>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "asylo/platform/host_call/io_uring_abi.h"
+#include "asylo/test/util/status_matchers.h"
+
+namespace asylo {
+namespace host_call {
+namespace {
+
+class IoUringEngineTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    auto engine_result = IoUringEngine::Create(8);
+    ASSERT_THAT(engine_result, IsOk());
+    engine_ = std::move(engine_result).ValueOrDie();
+  }
+
+  // Appends |sqe| to the submission queue the way the enclave does.
+  void Queue(const klinux_io_uring_sqe &sqe) {
+    const IoUringQueues &queues = engine_->queues();
+    uint32_t tail = *queues.sq_tail;
+    uint32_t index = tail & (queues.sq_entries - 1);
+    memcpy(&queues.sqes[index], &sqe, sizeof(sqe));
+    queues.sq_array[index] = index;
+    __atomic_store_n(queues.sq_tail, tail + 1, __ATOMIC_RELEASE);
+  }
+
+  // Submits queued entries and waits for one completion, which is returned.
+  klinux_io_uring_cqe SubmitAndWait() {
+    const IoUringQueues &queues = engine_->queues();
+    uint32_t flags = kLinuxIoUringEnterGetEvents;
+    if (queues.sq_polling) {
+      flags |= kLinuxIoUringEnterSqWakeup;
+    }
+    EXPECT_GE(engine_->Enter(queues.sq_polling ? 0 : 1, 1, flags), 0);
+    uint32_t head = *queues.cq_head;
+    EXPECT_NE(__atomic_load_n(queues.cq_tail, __ATOMIC_ACQUIRE), head);
+    klinux_io_uring_cqe cqe = queues.cqes[head & (queues.cq_entries - 1)];
+    __atomic_store_n(queues.cq_head, head + 1, __ATOMIC_RELEASE);
+    return cqe;
+  }
+
+  std::unique_ptr<IoUringEngine> engine_;
+};
+
+TEST_F(IoUringEngineTest, QueuesAreMapped) {
+  const IoUringQueues &queues = engine_->queues();
+  EXPECT_GE(queues.sq_entries, 8);
+  EXPECT_GE(queues.cq_entries, queues.sq_entries);
+  EXPECT_EQ(queues.sq_entries & (queues.sq_entries - 1), 0);
+  EXPECT_EQ(queues.cq_entries & (queues.cq_entries - 1), 0);
+  EXPECT_EQ(*queues.sq_head, *queues.sq_tail);
+  EXPECT_EQ(*queues.cq_head, *queues.cq_tail);
+}
+
+TEST_F(IoUringEngineTest, NoOpCompletes) {
+  klinux_io_uring_sqe sqe;
+  memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = kLinuxIoUringOpNop;
+  sqe.user_data = 0x1234;
+  Queue(sqe);
+  klinux_io_uring_cqe cqe = SubmitAndWait();
+  EXPECT_EQ(cqe.user_data, 0x1234);
+  EXPECT_EQ(cqe.res, 0);
+}
+
+TEST_F(IoUringEngineTest, ReadsAndWritesPipe) {
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+
+  char out[] = "io_uring";
+  klinux_io_uring_sqe sqe;
+  memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = kLinuxIoUringOpWrite;
+  sqe.fd = fds[1];
+  sqe.addr = reinterpret_cast<uint64_t>(out);
+  sqe.len = sizeof(out);
+  sqe.user_data = 1;
+  Queue(sqe);
+  klinux_io_uring_cqe cqe = SubmitAndWait();
+  EXPECT_EQ(cqe.user_data, 1);
+  EXPECT_EQ(cqe.res, sizeof(out));
+
+  char in[sizeof(out)] = {};
+  memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = kLinuxIoUringOpRead;
+  sqe.fd = fds[0];
+  sqe.addr = reinterpret_cast<uint64_t>(in);
+  sqe.len = sizeof(in);
+  sqe.user_data = 2;
+  Queue(sqe);
+  cqe = SubmitAndWait();
+  EXPECT_EQ(cqe.user_data, 2);
+  EXPECT_EQ(cqe.res, sizeof(in));
+  EXPECT_STREQ(in, out);
+
+  close(fds[0]);
+  close(fds[1]);
+}
+
+}  // namespace
+}  // namespace host_call
+}  // namespace asylo
@@ -17,15 +17,73 @@
  */
 
 #include <dlfcn.h>
-#include <stdlib.h>
+#include <stdio.h>
+
+#include <string>
+
+#include "asylo/platform/posix/trusted_plugin.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace {
+
+// The error reported by the next dlerror() call on this thread, if any.
+thread_local char dl_error[256];
+thread_local bool dl_error_set = false;
+
+void SetError(const asylo::Status &status) {
+  snprintf(dl_error, sizeof(dl_error), "%s", status.ToString().c_str());
+  dl_error_set = true;
+}
+
+}  // namespace
 
 extern "C" {
 
-// We are not supporting dynamic linking libraries inside an enclave as they may
-// cause security issues.
-void *dlopen(const char *filename, int flags) { abort(); }
-void *dlsym(void *handle, const char *symbol) { abort(); }
-int dlclose(void *handle) { abort(); }
-char *dlerror() { abort(); }
+// Dynamic libraries cannot be mapped into an enclave as they may cause
+// security issues. dlopen() instead opens trusted plugins, which are linked
+// into the enclave and measured with it but initialized on first use. See
+// asylo/platform/posix/trusted_plugin.h. Symbols are resolved when a plugin is
+// loaded, so |flags| is ignored.
+void *dlopen(const char *filename, int flags) {
+  if (!filename) {
+    SetError(asylo::Status(asylo::error::GoogleError::UNIMPLEMENTED,
+                           "dlopen of the main program is not supported"));
+    return nullptr;
+  }
+  asylo::StatusOr<void *> handle = asylo::OpenTrustedPlugin(filename);
+  if (!handle.ok()) {
+    SetError(handle.status());
+    return nullptr;
+  }
+  return handle.ValueOrDie();
+}
+
+void *dlsym(void *handle, const char *symbol) {
+  asylo::StatusOr<void *> address =
+      asylo::FindTrustedPluginSymbol(handle, symbol);
+  if (!address.ok()) {
+    SetError(address.status());
+    return nullptr;
+  }
+  return address.ValueOrDie();
+}
+
+int dlclose(void *handle) {
+  asylo::Status status = asylo::CloseTrustedPlugin(handle);
+  if (!status.ok()) {
+    SetError(status);
+    return -1;
+  }
+  return 0;
+}
+
+char *dlerror() {
+  if (!dl_error_set) {
+    return nullptr;
+  }
+  dl_error_set = false;
+  return dl_error;
+}
 
 }  // extern "C"
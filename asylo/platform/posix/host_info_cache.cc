@@ -0,0 +1,233 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/host_info_cache.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "asylo/platform/host_call/trusted/host_calls.h"
+
+namespace asylo {
+namespace {
+
+// Generation of a cached fact: the value of its host counter and of the local
+// epoch when the fact was fetched.
+struct Generation {
+  uint64_t host = 0;
+  uint64_t local = 0;
+
+  bool operator==(const Generation &other) const {
+    return host == other.host && local == other.local;
+  }
+};
+
+// A passwd entry copied out of the static buffer filled by the host call.
+struct CachedPasswd {
+  Generation generation;
+  std::string name;
+  std::string passwd;
+  std::string gecos;
+  std::string dir;
+  std::string shell;
+  struct passwd entry;
+};
+
+struct HostInfoCache {
+  absl::Mutex mu;
+
+  bool has_uname ABSL_GUARDED_BY(mu) = false;
+  Generation uname_generation ABSL_GUARDED_BY(mu);
+  struct utsname uname ABSL_GUARDED_BY(mu);
+
+  absl::flat_hash_map<uid_t, std::unique_ptr<CachedPasswd>> passwds
+      ABSL_GUARDED_BY(mu);
+
+  // The cached interface list, which may be null if the host has no
+  // interfaces, and the number of callers holding each shared list. The
+  // cached list holds one more reference, dropped when it is invalidated.
+  bool has_ifaddrs ABSL_GUARDED_BY(mu) = false;
+  Generation ifaddrs_generation ABSL_GUARDED_BY(mu);
+  struct ifaddrs *ifaddrs ABSL_GUARDED_BY(mu) = nullptr;
+  absl::flat_hash_map<struct ifaddrs *, int> ifaddrs_references
+      ABSL_GUARDED_BY(mu);
+};
+
+// Counters registered by the backend, or nullptr if the cache is disabled.
+std::atomic<HostInfoGenerations *> host_generations{nullptr};
+
+// Incremented by InvalidateHostInfoCache().
+std::atomic<uint64_t> local_epoch{0};
+
+HostInfoCache *GetCache() {
+  static HostInfoCache *cache = new HostInfoCache;
+  return cache;
+}
+
+// Sets |generation| to the current generation of |counter|. Returns false if
+// the cache is disabled.
+bool CurrentGeneration(std::atomic<uint64_t> HostInfoGenerations::*counter,
+                       Generation *generation) {
+  HostInfoGenerations *generations =
+      host_generations.load(std::memory_order_acquire);
+  if (!generations) {
+    return false;
+  }
+  generation->host = (generations->*counter).load(std::memory_order_acquire);
+  generation->local = local_epoch.load(std::memory_order_acquire);
+  return true;
+}
+
+// Drops the reference of the cache to its interface list.
+void DropCachedIfAddrs(HostInfoCache *cache)
+    ABSL_EXCLUSIVE_LOCKS_REQUIRED(cache->mu) {
+  if (cache->has_ifaddrs && cache->ifaddrs) {
+    auto it = cache->ifaddrs_references.find(cache->ifaddrs);
+    if (--it->second == 0) {
+      cache->ifaddrs_references.erase(it);
+      enc_freeifaddrs(cache->ifaddrs);
+    }
+  }
+  cache->has_ifaddrs = false;
+  cache->ifaddrs = nullptr;
+}
+
+}  // namespace
+
+void SetHostInfoGenerations(HostInfoGenerations *generations) {
+  host_generations.store(generations, std::memory_order_release);
+  InvalidateHostInfoCache();
+}
+
+void InvalidateHostInfoCache() {
+  local_epoch.fetch_add(1, std::memory_order_acq_rel);
+  HostInfoCache *cache = GetCache();
+  absl::MutexLock lock(&cache->mu);
+  DropCachedIfAddrs(cache);
+}
+
+int CachedUname(struct utsname *buf) {
+  Generation generation;
+  if (!CurrentGeneration(&HostInfoGenerations::system, &generation)) {
+    return enc_untrusted_uname(buf);
+  }
+  HostInfoCache *cache = GetCache();
+  absl::MutexLock lock(&cache->mu);
+  if (!cache->has_uname || !(cache->uname_generation == generation)) {
+    int result = enc_untrusted_uname(&cache->uname);
+    if (result != 0) {
+      cache->has_uname = false;
+      return result;
+    }
+    cache->has_uname = true;
+    cache->uname_generation = generation;
+  }
+  *buf = cache->uname;
+  return 0;
+}
+
+struct passwd *CachedGetPwUid(uid_t uid) {
+  Generation generation;
+  if (!CurrentGeneration(&HostInfoGenerations::system, &generation)) {
+    return enc_untrusted_getpwuid(uid);
+  }
+  HostInfoCache *cache = GetCache();
+  absl::MutexLock lock(&cache->mu);
+  std::unique_ptr<CachedPasswd> &cached = cache->passwds[uid];
+  if (cached && cached->generation == generation) {
+    return &cached->entry;
+  }
+  struct passwd *entry = enc_untrusted_getpwuid(uid);
+  if (!entry) {
+    cache->passwds.erase(uid);
+    return nullptr;
+  }
+  if (!cached) {
+    cached = absl::make_unique<CachedPasswd>();
+  }
+  cached->generation = generation;
+  cached->name = entry->pw_name;
+  cached->passwd = entry->pw_passwd;
+  cached->gecos = entry->pw_gecos;
+  cached->dir = entry->pw_dir;
+  cached->shell = entry->pw_shell;
+  cached->entry.pw_name = &cached->name[0];
+  cached->entry.pw_passwd = &cached->passwd[0];
+  cached->entry.pw_uid = entry->pw_uid;
+  cached->entry.pw_gid = entry->pw_gid;
+  cached->entry.pw_gecos = &cached->gecos[0];
+  cached->entry.pw_dir = &cached->dir[0];
+  cached->entry.pw_shell = &cached->shell[0];
+  return &cached->entry;
+}
+
+int CachedGetIfAddrs(struct ifaddrs **ifap) {
+  Generation generation;
+  if (!CurrentGeneration(&HostInfoGenerations::interfaces, &generation)) {
+    return enc_untrusted_getifaddrs(ifap);
+  }
+  HostInfoCache *cache = GetCache();
+  absl::MutexLock lock(&cache->mu);
+  if (!cache->has_ifaddrs || !(cache->ifaddrs_generation == generation)) {
+    DropCachedIfAddrs(cache);
+    struct ifaddrs *list = nullptr;
+    int result = enc_untrusted_getifaddrs(&list);
+    if (result != 0) {
+      return result;
+    }
+    cache->has_ifaddrs = true;
+    cache->ifaddrs_generation = generation;
+    cache->ifaddrs = list;
+    if (list) {
+      cache->ifaddrs_references[list] = 1;
+    }
+  }
+  if (cache->ifaddrs) {
+    cache->ifaddrs_references[cache->ifaddrs]++;
+  }
+  *ifap = cache->ifaddrs;
+  return 0;
+}
+
+void ReleaseIfAddrs(struct ifaddrs *ifa) {
+  if (!ifa) {
+    return;
+  }
+  HostInfoCache *cache = GetCache();
+  {
+    absl::MutexLock lock(&cache->mu);
+    auto it = cache->ifaddrs_references.find(ifa);
+    if (it != cache->ifaddrs_references.end()) {
+      if (--it->second > 0) {
+        return;
+      }
+      cache->ifaddrs_references.erase(it);
+    }
+  }
+  // Either the last reference to a shared list, or a list returned while the
+  // cache was disabled.
+  enc_freeifaddrs(ifa);
+}
+
+}  // namespace asylo
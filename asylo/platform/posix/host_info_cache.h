@@ -0,0 +1,61 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_POSIX_HOST_INFO_CACHE_H_
+#define ASYLO_PLATFORM_POSIX_HOST_INFO_CACHE_H_
+
+#include <ifaddrs.h>
+#include <pwd.h>
+#include <sys/types.h>
+#include <sys/utsname.h>
+
+#include "asylo/platform/common/host_info_generations.h"
+
+namespace asylo {
+
+// Makes uname(), getpwuid() and getifaddrs() serve the facts the host
+// returned before for as long as the matching counter of |generations|, a
+// HostInfoGenerations in untrusted memory incremented by the host, does not
+// change. Passing a null |generations| disables the cache, so that every call
+// is a host call.
+void SetHostInfoGenerations(HostInfoGenerations *generations);
+
+// Drops every cached fact, so that the next call of each function queries
+// the host again.
+void InvalidateHostInfoCache();
+
+// Implements uname() on top of the cache.
+int CachedUname(struct utsname *buf);
+
+// Implements getpwuid() on top of the cache. The returned entry is shared by
+// all callers looking up |uid|, must not be modified, and is overwritten when
+// the entry of |uid| is next refreshed from the host.
+struct passwd *CachedGetPwUid(uid_t uid);
+
+// Implements getifaddrs() on top of the cache. The returned list is shared
+// by all callers until it is invalidated, must not be modified, and must be
+// released with ReleaseIfAddrs().
+int CachedGetIfAddrs(struct ifaddrs **ifap);
+
+// Implements freeifaddrs() for lists returned by CachedGetIfAddrs(). A shared
+// list is freed once it is invalidated and released by all its callers.
+void ReleaseIfAddrs(struct ifaddrs *ifa);
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_HOST_INFO_CACHE_H_
@@ -0,0 +1,78 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/host_time.h"
+
+#include <atomic>
+
+namespace asylo {
+namespace {
+
+// Time page registered by the backend, or nullptr if every clock read is a
+// host call. |max_reads_per_update| is published before |page|.
+struct {
+  std::atomic<HostTimePage *> page{nullptr};
+  uint32_t max_reads_per_update = 0;
+} host_time;
+
+// Generation of the page snapshot last read by this thread and number of times
+// this thread read it.
+thread_local uint64_t last_generation = 0;
+thread_local uint32_t reads_of_last_generation = 0;
+
+}  // namespace
+
+void SetHostTimePage(HostTimePage *page, uint32_t max_reads_per_update) {
+  host_time.page.store(nullptr, std::memory_order_release);
+  host_time.max_reads_per_update = max_reads_per_update;
+  host_time.page.store(page, std::memory_order_release);
+}
+
+bool ReadHostTimePage(clockid_t clock_id, int64_t *nanos) {
+  if (clock_id != CLOCK_MONOTONIC && clock_id != CLOCK_REALTIME) {
+    return false;
+  }
+  HostTimePage *page = host_time.page.load(std::memory_order_acquire);
+  int64_t monotonic_nanos;
+  int64_t realtime_nanos;
+  uint64_t generation;
+  if (!page || !page->Read(&monotonic_nanos, &realtime_nanos, &generation)) {
+    return false;
+  }
+  // A page the host stopped updating must not freeze time for callers waiting
+  // for a deadline, so only serve a bounded number of reads per snapshot.
+  if (generation != last_generation) {
+    last_generation = generation;
+    reads_of_last_generation = 0;
+  }
+  if (reads_of_last_generation >= host_time.max_reads_per_update) {
+    return false;
+  }
+  reads_of_last_generation++;
+  *nanos = clock_id == CLOCK_MONOTONIC ? monotonic_nanos : realtime_nanos;
+  return true;
+}
+
+bool PeekHostTimePage(int64_t *monotonic_nanos) {
+  HostTimePage *page = host_time.page.load(std::memory_order_acquire);
+  int64_t realtime_nanos;
+  uint64_t generation;
+  return page && page->Read(monotonic_nanos, &realtime_nanos, &generation);
+}
+
+}  // namespace asylo
@@ -0,0 +1,49 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_POSIX_HOST_TIME_H_
+#define ASYLO_PLATFORM_POSIX_HOST_TIME_H_
+
+#include <time.h>
+
+#include <cstdint>
+
+#include "asylo/platform/common/host_time_page.h"
+
+namespace asylo {
+
+// Makes clock reads use |page|, a HostTimePage in untrusted memory updated by
+// the host, instead of a host call. A page whose snapshot does not change for
+// |max_reads_per_update| consecutive reads is considered stale, and reads fall
+// back to host calls until the host updates it again. Passing a null |page|
+// disables the time page.
+void SetHostTimePage(HostTimePage *page, uint32_t max_reads_per_update);
+
+// Reads |clock_id| from the host time page. Returns false if |clock_id| is
+// not served by the page or the page is disabled, stale or inconsistent, in
+// which case the caller must read the clock with a host call.
+bool ReadHostTimePage(clockid_t clock_id, int64_t *nanos);
+
+// Reads CLOCK_MONOTONIC from the host time page without counting towards its
+// staleness, for callers which only need a coarse timestamp, such as event
+// tracing. Returns false if the page is disabled or inconsistent.
+bool PeekHostTimePage(int64_t *monotonic_nanos);
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_HOST_TIME_H_
@@ -20,12 +20,12 @@
 
 #include <cstdlib>
 
-#include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/platform/posix/host_info_cache.h"
 
 extern "C" {
 
-int getifaddrs(struct ifaddrs **ifap) { return enc_untrusted_getifaddrs(ifap); }
+int getifaddrs(struct ifaddrs **ifap) { return asylo::CachedGetIfAddrs(ifap); }
 
-void freeifaddrs(struct ifaddrs *ifa) { enc_freeifaddrs(ifa); }
+void freeifaddrs(struct ifaddrs *ifa) { asylo::ReleaseIfAddrs(ifa); }
 
 }  // extern "C"
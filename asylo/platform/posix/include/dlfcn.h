@@ -25,6 +25,8 @@ extern "C" {
 
 #define RTLD_LOCAL 0
 
+#define RTLD_LAZY 1
+
 #define RTLD_NOW 2
 
 void *dlopen(const char *filename, int flags);
@@ -28,4 +28,23 @@
 #define O_DIRECT 0x20000
 #define O_SECURE 0x40000000
 
+#define SPLICE_F_MOVE 0x01
+#define SPLICE_F_NONBLOCK 0x02
+#define SPLICE_F_MORE 0x04
+#define SPLICE_F_GIFT 0x08
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+ssize_t splice(int fd_in, off_t *off_in, int fd_out, off_t *off_out,
+               size_t len, unsigned int flags);
+
+ssize_t copy_file_range(int fd_in, off_t *off_in, int fd_out, off_t *off_out,
+                        size_t len, unsigned int flags);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
 #endif  // ASYLO_PLATFORM_POSIX_INCLUDE_FCNTL_H_
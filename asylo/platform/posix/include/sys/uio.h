@@ -31,10 +31,23 @@ struct iovec {
   size_t iov_len;
 };
 
+// Flags for preadv2().
+#define RWF_HIPRI 0x00000001
+#define RWF_DSYNC 0x00000002
+#define RWF_SYNC 0x00000004
+#define RWF_NOWAIT 0x00000008
+
 ssize_t readv(int fd, const struct iovec *iov, int iovcnt);
 
 ssize_t writev(int fd, const struct iovec *iov, int iovcnt);
 
+ssize_t preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+
+ssize_t pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+
+ssize_t preadv2(int fd, const struct iovec *iov, int iovcnt, off_t offset,
+                int flags);
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif
@@ -0,0 +1,92 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/io/accept_queue.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace asylo {
+namespace io {
+
+AcceptQueue::AcceptQueue(Source source, Closer closer, int batch_size)
+    : source_(std::move(source)),
+      closer_(std::move(closer)),
+      batch_size_(batch_size),
+      closed_(false),
+      queued_(0) {}
+
+int AcceptQueue::Accept(struct sockaddr *addr, socklen_t *addrlen) {
+  Connection connection;
+  bool queued;
+  {
+    absl::MutexLock lock(&mu_);
+    queued = Pop(&connection);
+  }
+
+  if (!queued) {
+    // Accept without holding the lock, so that Close() does not wait for a
+    // connection to arrive.
+    std::vector<Connection> batch(batch_size_);
+    int count = source_(batch_size_, batch.data());
+    if (count <= 0) {
+      return -1;
+    }
+    connection = batch[0];
+    absl::MutexLock lock(&mu_);
+    for (int i = 1; i < count; ++i) {
+      if (closed_) {
+        closer_(batch[i].fd);
+      } else {
+        queue_.push_back(batch[i]);
+      }
+    }
+    queued_.store(queue_.size(), std::memory_order_release);
+  }
+
+  if (addr && addrlen) {
+    memcpy(addr, &connection.addr,
+           std::min<size_t>(*addrlen, connection.addrlen));
+    *addrlen = connection.addrlen;
+  }
+  return connection.fd;
+}
+
+void AcceptQueue::Close() {
+  absl::MutexLock lock(&mu_);
+  closed_ = true;
+  Connection connection;
+  while (Pop(&connection)) {
+    closer_(connection.fd);
+  }
+}
+
+bool AcceptQueue::Pop(Connection *connection) {
+  if (queue_.empty()) {
+    return false;
+  }
+  *connection = queue_.front();
+  queue_.pop_front();
+  queued_.store(queue_.size(), std::memory_order_release);
+  return true;
+}
+
+}  // namespace io
+}  // namespace asylo
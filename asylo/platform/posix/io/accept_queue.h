@@ -0,0 +1,102 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_POSIX_IO_ACCEPT_QUEUE_H_
+#define ASYLO_PLATFORM_POSIX_IO_ACCEPT_QUEUE_H_
+
+#include <sys/socket.h>
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace asylo {
+namespace io {
+
+// Queues the connections a listening socket accepts in batches, so that a
+// burst of connections is accepted by a single host call. A call to Accept()
+// finding the queue empty accepts the connections pending on the socket, up to
+// the batch size, and later calls are served from the queue until it drains.
+//
+// The host does not see queued connections, so callers waiting for readiness
+// have to report a socket with queued connections as readable themselves, see
+// HasQueuedConnections().
+//
+// This class is thread-safe.
+class AcceptQueue {
+ public:
+  struct Connection {
+    int fd;
+    struct sockaddr_storage addr;
+    socklen_t addrlen;
+  };
+
+  // Accepts up to |max_connections| connections into |connections|, blocking
+  // for the first one only. Returns the number of connections accepted, or -1
+  // with errno set.
+  using Source =
+      std::function<int(int max_connections, Connection *connections)>;
+
+  // Closes the file descriptor |fd| of a connection which was never handed
+  // out.
+  using Closer = std::function<void(int fd)>;
+
+  AcceptQueue(Source source, Closer closer, int batch_size);
+
+  AcceptQueue(const AcceptQueue &other) = delete;
+  AcceptQueue &operator=(const AcceptQueue &other) = delete;
+
+  // Hands out the next connection as accept(2) would, writing its peer
+  // address to |addr| unless |addr| is nullptr. Returns the file descriptor of
+  // the connection, or -1 with errno set.
+  int Accept(struct sockaddr *addr, socklen_t *addrlen);
+
+  // Closes the connections in the queue, as well as those accepted by calls
+  // to Accept() in progress which are not handed out.
+  void Close();
+
+  // Returns true if connections are queued. Does not block on concurrent
+  // calls.
+  bool HasQueuedConnections() const {
+    return queued_.load(std::memory_order_acquire) > 0;
+  }
+
+ private:
+  // Removes the first connection from |queue_| into |connection|. Returns
+  // false if the queue is empty.
+  bool Pop(Connection *connection) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const Source source_;
+  const Closer closer_;
+  const int batch_size_;
+
+  absl::Mutex mu_;
+  std::deque<Connection> queue_ ABSL_GUARDED_BY(mu_);
+  bool closed_ ABSL_GUARDED_BY(mu_);
+  // Number of connections queued, readable without holding |mu_|.
+  std::atomic<size_t> queued_;
+};
+
+}  // namespace io
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_IO_ACCEPT_QUEUE_H_
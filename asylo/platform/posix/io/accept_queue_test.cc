@@ -0,0 +1,135 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/io/accept_queue.h"
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/memory/memory.h"
+
+namespace asylo {
+namespace io {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+class AcceptQueueTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<AcceptQueue> MakeQueue(int batch_size) {
+    return absl::make_unique<AcceptQueue>(
+        [this](int max_connections, AcceptQueue::Connection *connections) {
+          calls_++;
+          if (pending_.empty()) {
+            errno = EAGAIN;
+            return -1;
+          }
+          int count = std::min<int>(max_connections, pending_.size());
+          for (int i = 0; i < count; ++i) {
+            struct sockaddr_in addr = {};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(pending_[i]);
+            connections[i].fd = pending_[i];
+            memcpy(&connections[i].addr, &addr, sizeof(addr));
+            connections[i].addrlen = sizeof(addr);
+          }
+          pending_.erase(pending_.begin(), pending_.begin() + count);
+          return count;
+        },
+        [this](int fd) { closed_.push_back(fd); }, batch_size);
+  }
+
+  std::vector<int> pending_;
+  std::vector<int> closed_;
+  int calls_ = 0;
+};
+
+TEST_F(AcceptQueueTest, ServesBurstFromOneBatch) {
+  pending_ = {10, 11, 12};
+  auto queue = MakeQueue(8);
+  EXPECT_EQ(queue->Accept(nullptr, nullptr), 10);
+  EXPECT_TRUE(queue->HasQueuedConnections());
+  EXPECT_EQ(queue->Accept(nullptr, nullptr), 11);
+  EXPECT_EQ(queue->Accept(nullptr, nullptr), 12);
+  EXPECT_FALSE(queue->HasQueuedConnections());
+  EXPECT_EQ(calls_, 1);
+}
+
+TEST_F(AcceptQueueTest, LimitsBatchSize) {
+  pending_ = {10, 11, 12};
+  auto queue = MakeQueue(2);
+  EXPECT_EQ(queue->Accept(nullptr, nullptr), 10);
+  EXPECT_EQ(queue->Accept(nullptr, nullptr), 11);
+  EXPECT_EQ(queue->Accept(nullptr, nullptr), 12);
+  EXPECT_EQ(calls_, 2);
+}
+
+TEST_F(AcceptQueueTest, ReportsPeerAddress) {
+  pending_ = {10, 11};
+  auto queue = MakeQueue(8);
+  struct sockaddr_in addr;
+  socklen_t addrlen = sizeof(addr);
+  queue->Accept(nullptr, nullptr);
+  EXPECT_EQ(queue->Accept(reinterpret_cast<struct sockaddr *>(&addr),
+                          &addrlen),
+            11);
+  EXPECT_EQ(addrlen, sizeof(addr));
+  EXPECT_EQ(addr.sin_family, AF_INET);
+  EXPECT_EQ(ntohs(addr.sin_port), 11);
+}
+
+TEST_F(AcceptQueueTest, TruncatesPeerAddress) {
+  pending_ = {10};
+  auto queue = MakeQueue(8);
+  struct sockaddr_storage addr;
+  socklen_t addrlen = 1;
+  EXPECT_EQ(queue->Accept(reinterpret_cast<struct sockaddr *>(&addr),
+                          &addrlen),
+            10);
+  EXPECT_EQ(addrlen, sizeof(struct sockaddr_in));
+}
+
+TEST_F(AcceptQueueTest, ReportsSourceFailure) {
+  auto queue = MakeQueue(8);
+  errno = 0;
+  EXPECT_EQ(queue->Accept(nullptr, nullptr), -1);
+  EXPECT_EQ(errno, EAGAIN);
+}
+
+TEST_F(AcceptQueueTest, CloseClosesQueuedConnections) {
+  pending_ = {10, 11, 12};
+  auto queue = MakeQueue(8);
+  EXPECT_EQ(queue->Accept(nullptr, nullptr), 10);
+  EXPECT_THAT(closed_, IsEmpty());
+  queue->Close();
+  EXPECT_THAT(closed_, ElementsAre(11, 12));
+  EXPECT_FALSE(queue->HasQueuedConnections());
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace asylo
@@ -0,0 +1,297 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/io/async_io_engine.h"
+
+#include <errno.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "asylo/platform/host_call/io_uring_abi.h"
+#include "asylo/platform/primitives/trusted_primitives.h"
+#include "asylo/platform/system_call/type_conversions/types_functions.h"
+
+namespace asylo {
+namespace io {
+namespace {
+
+using host_call::klinux_io_uring_cqe;
+using host_call::klinux_io_uring_sqe;
+using primitives::TrustedPrimitives;
+
+// Maximum number of completions copied out of the ring at once.
+constexpr int kReapBatch = 32;
+
+// User data of the no-ops posted by WakeWaiters(), which never matches a
+// request slot.
+constexpr uint64_t kWakeUserData = UINT64_MAX;
+
+// Returns the io_uring opcode of |operation|.
+uint8_t OpCode(AsyncIoEngine::Operation operation) {
+  switch (operation) {
+    case AsyncIoEngine::Operation::kRead:
+      return host_call::kLinuxIoUringOpRead;
+    case AsyncIoEngine::Operation::kWrite:
+      return host_call::kLinuxIoUringOpWrite;
+    case AsyncIoEngine::Operation::kSend:
+      return host_call::kLinuxIoUringOpSend;
+    case AsyncIoEngine::Operation::kRecv:
+      return host_call::kLinuxIoUringOpRecv;
+  }
+  return host_call::kLinuxIoUringOpRead;
+}
+
+// Returns true if |operation| moves data from the host into the enclave.
+bool IsInbound(AsyncIoEngine::Operation operation) {
+  return operation == AsyncIoEngine::Operation::kRead ||
+         operation == AsyncIoEngine::Operation::kRecv;
+}
+
+}  // namespace
+
+constexpr uint32_t AsyncIoEngine::kQueueEntries;
+constexpr size_t AsyncIoEngine::kStagingBufferSize;
+
+AsyncIoEngine::AsyncIoEngine()
+    : setup_error_(0), in_flight_(0), waiters_(0), wake_pending_(false) {}
+
+AsyncIoEngine::~AsyncIoEngine() {
+  absl::MutexLock lock(&mu_);
+  ring_.reset();
+  for (Request &request : requests_) {
+    if (request.staging) {
+      TrustedPrimitives::UntrustedLocalFree(request.staging);
+    }
+    if (request.large_staging) {
+      TrustedPrimitives::UntrustedLocalFree(request.large_staging);
+    }
+  }
+}
+
+bool AsyncIoEngine::EnsureStarted() {
+  if (ring_) {
+    return true;
+  }
+  if (setup_error_ != 0) {
+    errno = setup_error_;
+    return false;
+  }
+  ring_ = host_call::IoUringClient::Create(kQueueEntries);
+  if (!ring_) {
+    setup_error_ = errno;
+    return false;
+  }
+  // Bound the number of operations in flight by the size of the completion
+  // queue too, so that completions never overflow.
+  uint32_t slots = std::min(ring_->sq_entries(), ring_->cq_entries());
+  requests_.resize(slots);
+  free_requests_.reserve(slots);
+  for (uint32_t i = slots; i > 0; i--) {
+    free_requests_.push_back(i - 1);
+  }
+  return true;
+}
+
+void *AsyncIoEngine::StagingBuffer(Request *request, size_t count) {
+  if (count > kStagingBufferSize) {
+    request->large_staging = TrustedPrimitives::UntrustedLocalAlloc(count);
+    return request->large_staging;
+  }
+  if (!request->staging) {
+    request->staging =
+        TrustedPrimitives::UntrustedLocalAlloc(kStagingBufferSize);
+  }
+  return request->staging;
+}
+
+int AsyncIoEngine::Submit(Operation operation, int host_fd, void *buffer,
+                          size_t count, off_t offset, int flags,
+                          uint64_t user_data,
+                          std::shared_ptr<void> keep_alive) {
+  if (count > UINT32_MAX) {
+    errno = EINVAL;
+    return -1;
+  }
+  absl::MutexLock lock(&mu_);
+  if (!EnsureStarted()) {
+    return -1;
+  }
+  if (free_requests_.empty()) {
+    errno = EAGAIN;
+    return -1;
+  }
+  uint32_t index = free_requests_.back();
+  Request *request = &requests_[index];
+  void *staging = StagingBuffer(request, count);
+  if (!staging) {
+    errno = ENOMEM;
+    return -1;
+  }
+  if (!IsInbound(operation)) {
+    memcpy(staging, buffer, count);
+  }
+
+  klinux_io_uring_sqe sqe;
+  memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = OpCode(operation);
+  sqe.fd = host_fd;
+  sqe.addr = reinterpret_cast<uint64_t>(staging);
+  sqe.len = static_cast<uint32_t>(count);
+  if (operation == Operation::kSend || operation == Operation::kRecv) {
+    sqe.op_flags = static_cast<uint32_t>(TokLinuxRecvSendFlag(flags));
+  } else {
+    sqe.off = static_cast<uint64_t>(offset);
+  }
+  sqe.user_data = index | static_cast<uint64_t>(request->generation) << 32;
+
+  // The submission queue can only be full of entries not submitted yet, since
+  // there are no more request slots than entries.
+  if (!ring_->Queue(sqe) && (ring_->Submit(/*wait=*/false) != 0 ||
+                             !ring_->Queue(sqe))) {
+    if (request->large_staging) {
+      TrustedPrimitives::UntrustedLocalFree(request->large_staging);
+      request->large_staging = nullptr;
+    }
+    errno = EAGAIN;
+    return -1;
+  }
+  free_requests_.pop_back();
+  request->in_use = true;
+  request->operation = operation;
+  request->buffer = buffer;
+  request->count = count;
+  request->user_data = user_data;
+  request->keep_alive = std::move(keep_alive);
+  in_flight_++;
+
+  // A polling kernel thread picks the entry up without an exit, unless it went
+  // to sleep and has to be woken up.
+  if (ring_->sq_polling()) {
+    ring_->Submit(/*wait=*/false);
+  }
+  return 0;
+}
+
+int AsyncIoEngine::Reap(AsyncIoCompletion *completions, int max_completions) {
+  klinux_io_uring_cqe cqes[kReapBatch];
+  int count = 0;
+  while (count < max_completions) {
+    int reaped =
+        ring_->Reap(cqes, std::min(kReapBatch, max_completions - count));
+    if (reaped == 0) {
+      break;
+    }
+    for (int i = 0; i < reaped; i++) {
+      if (cqes[i].user_data == kWakeUserData) {
+        wake_pending_ = false;
+        continue;
+      }
+      uint64_t index = cqes[i].user_data & UINT32_MAX;
+      uint32_t generation = static_cast<uint32_t>(cqes[i].user_data >> 32);
+      if (index >= requests_.size() || !requests_[index].in_use ||
+          requests_[index].generation != generation) {
+        continue;
+      }
+      Request *request = &requests_[index];
+      AsyncIoCompletion *completion = &completions[count++];
+      completion->user_data = request->user_data;
+      if (cqes[i].res < 0) {
+        completion->result = -1;
+        completion->error = FromkLinuxErrorNumber(-cqes[i].res);
+      } else {
+        // Never trust the host to report more than was asked for.
+        size_t transferred = std::min(static_cast<size_t>(cqes[i].res),
+                                      request->count);
+        if (IsInbound(request->operation)) {
+          memcpy(request->buffer,
+                 request->large_staging ? request->large_staging
+                                        : request->staging,
+                 transferred);
+        }
+        completion->result = static_cast<ssize_t>(transferred);
+        completion->error = 0;
+      }
+
+      if (request->large_staging) {
+        TrustedPrimitives::UntrustedLocalFree(request->large_staging);
+        request->large_staging = nullptr;
+      }
+      request->keep_alive.reset();
+      request->in_use = false;
+      request->generation++;
+      free_requests_.push_back(index);
+      in_flight_--;
+    }
+  }
+  return count;
+}
+
+void AsyncIoEngine::WakeWaiters() {
+  if (wake_pending_) {
+    return;
+  }
+  klinux_io_uring_sqe sqe;
+  memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = host_call::kLinuxIoUringOpNop;
+  sqe.user_data = kWakeUserData;
+  if (!ring_->Queue(sqe) &&
+      (ring_->Submit(/*wait=*/false) != 0 || !ring_->Queue(sqe))) {
+    return;
+  }
+  if (ring_->Submit(/*wait=*/false) == 0) {
+    wake_pending_ = true;
+  }
+}
+
+int AsyncIoEngine::Poll(AsyncIoCompletion *completions, int max_completions,
+                        bool wait) {
+  if (max_completions <= 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  absl::MutexLock lock(&mu_);
+  if (!ring_) {
+    return 0;
+  }
+  if (ring_->Submit(/*wait=*/false) != 0) {
+    return -1;
+  }
+  int count = Reap(completions, max_completions);
+  while (count == 0 && wait && in_flight_ > 0) {
+    // Block without holding the lock, so that other threads can keep
+    // submitting operations and reaping their completions meanwhile.
+    host_call::IoUringClient *ring = ring_.get();
+    waiters_++;
+    mu_.Unlock();
+    int result = ring->Wait();
+    mu_.Lock();
+    waiters_--;
+    if (result != 0) {
+      return -1;
+    }
+    count = Reap(completions, max_completions);
+  }
+  if (count > 0 && waiters_ > 0) {
+    WakeWaiters();
+  }
+  return count;
+}
+
+}  // namespace io
+}  // namespace asylo
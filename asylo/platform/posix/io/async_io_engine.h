@@ -0,0 +1,155 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_POSIX_IO_ASYNC_IO_ENGINE_H_
+#define ASYLO_PLATFORM_POSIX_IO_ASYNC_IO_ENGINE_H_
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "asylo/platform/host_call/trusted/io_uring_client.h"
+
+namespace asylo {
+namespace io {
+
+// Outcome of an asynchronous I/O operation.
+struct AsyncIoCompletion {
+  // Value the operation was submitted with.
+  uint64_t user_data;
+  // Number of bytes transferred, or -1 on failure.
+  ssize_t result;
+  // errno value describing the failure if |result| is -1, 0 otherwise.
+  int error;
+};
+
+// Runs reads, writes, sends and receives on host file descriptors through an
+// io_uring instance whose rings are shared with the enclave, see
+// host_call::IoUringClient. When the host kernel polls the submission queue,
+// neither submitting an operation nor collecting its completion leaves the
+// enclave.
+//
+// Data is staged in untrusted buffers, one per in-flight operation. Staging
+// buffers of up to kStagingBufferSize bytes are allocated the first time their
+// request slot is used and reused afterwards, so that steady-state operations
+// do not allocate untrusted memory. The result reported by the host for a
+// read is clamped to the size of the read before data is copied back.
+//
+// This class is thread-safe.
+class AsyncIoEngine {
+ public:
+  // Kinds of operations.
+  enum class Operation { kRead, kWrite, kSend, kRecv };
+
+  // Number of submission queue entries of the io_uring instance, which also
+  // bounds the number of operations in flight.
+  static constexpr uint32_t kQueueEntries = 128;
+
+  // Size of the reusable staging buffer of each request slot.
+  static constexpr size_t kStagingBufferSize = 64 * 1024;
+
+  AsyncIoEngine();
+
+  // Must only be destroyed once no operation is in flight.
+  ~AsyncIoEngine();
+
+  AsyncIoEngine(const AsyncIoEngine &other) = delete;
+  AsyncIoEngine &operator=(const AsyncIoEngine &other) = delete;
+
+  // Queues |operation| on the host file descriptor |host_fd|, transferring
+  // |count| bytes from or to |buffer|, which must remain valid until the
+  // operation completes. |offset| is the file offset of reads and writes, with
+  // -1 meaning the current file position, and |flags| holds the enclave MSG_*
+  // flags of sends and receives. |keep_alive| is held until the operation
+  // completes, which keeps the owner of |host_fd| from closing it meanwhile.
+  //
+  // Without kernel submission polling, queued operations are submitted by the
+  // next call to Poll(), in a single enclave exit for all of them.
+  //
+  // Returns 0 on success, or -1 with errno set, in particular to EAGAIN if too
+  // many operations are in flight.
+  int Submit(Operation operation, int host_fd, void *buffer, size_t count,
+             off_t offset, int flags, uint64_t user_data,
+             std::shared_ptr<void> keep_alive);
+
+  // Submits queued operations and copies the outcome of up to
+  // |max_completions| completed operations to |completions|. If |wait| is set
+  // and operations are in flight, blocks until at least one completes. Returns
+  // the number of completions copied, or -1 with errno set.
+  int Poll(AsyncIoCompletion *completions, int max_completions, bool wait);
+
+ private:
+  // Bookkeeping for an operation in flight, kept in trusted memory.
+  struct Request {
+    bool in_use = false;
+    // Incremented every time the slot is released, so that a completion
+    // forged or replayed by the host for a stale operation is ignored.
+    uint32_t generation = 0;
+    Operation operation = Operation::kRead;
+    void *buffer = nullptr;
+    size_t count = 0;
+    uint64_t user_data = 0;
+    // Reusable untrusted staging buffer of kStagingBufferSize bytes, or
+    // nullptr if not allocated yet.
+    void *staging = nullptr;
+    // Untrusted buffer dedicated to an operation larger than the staging
+    // buffer, freed on completion.
+    void *large_staging = nullptr;
+    std::shared_ptr<void> keep_alive;
+  };
+
+  // Sets up the io_uring instance if needed. Returns false with errno set if
+  // it is not available.
+  bool EnsureStarted() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Copies available completions to |completions|, releasing their requests.
+  int Reap(AsyncIoCompletion *completions, int max_completions)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Posts a no-op to the ring so that threads blocked waiting for
+  // completions wake up and re-check, after another thread reaped the
+  // completions they were waiting for.
+  void WakeWaiters() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns the untrusted buffer of |request| for |count| bytes, allocating
+  // it if needed, or nullptr on failure.
+  void *StagingBuffer(Request *request, size_t count)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  absl::Mutex mu_;
+  std::unique_ptr<host_call::IoUringClient> ring_ ABSL_GUARDED_BY(mu_);
+  // errno from the failed setup of |ring_|, which is then not retried.
+  int setup_error_ ABSL_GUARDED_BY(mu_);
+  std::vector<Request> requests_ ABSL_GUARDED_BY(mu_);
+  std::vector<uint32_t> free_requests_ ABSL_GUARDED_BY(mu_);
+  // Number of operations in flight.
+  uint32_t in_flight_ ABSL_GUARDED_BY(mu_);
+  // Number of threads blocked waiting for completions without holding |mu_|.
+  int waiters_ ABSL_GUARDED_BY(mu_);
+  // Whether a no-op posted by WakeWaiters() has not completed yet.
+  bool wake_pending_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace io
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_IO_ASYNC_IO_ENGINE_H_
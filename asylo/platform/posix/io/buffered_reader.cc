@@ -0,0 +1,83 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/io/buffered_reader.h"
+
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace asylo {
+namespace io {
+
+BufferedReader::BufferedReader(Source source, size_t capacity)
+    : source_(std::move(source)),
+      capacity_(capacity),
+      buffer_(new char[capacity]),
+      begin_(0),
+      end_(0),
+      staged_(0) {}
+
+ssize_t BufferedReader::Read(void *data, size_t size, int flags) {
+  char *bytes = static_cast<char *>(data);
+  absl::MutexLock lock(&mu_);
+  size_t copied = CopyStaged(bytes, size, flags & MSG_PEEK);
+  if (copied == size || (copied > 0 && !(flags & MSG_WAITALL))) {
+    return copied;
+  }
+
+  if (copied > 0) {
+    // Complete a MSG_WAITALL read from the stream. The staged bytes were read
+    // from the stream already, so a failure only shortens the read.
+    ssize_t result = source_(bytes + copied, size - copied, flags);
+    return result > 0 ? copied + result : copied;
+  }
+
+  // Reads which the buffer cannot serve better go to the stream directly.
+  if (size >= capacity_ || (flags & (MSG_PEEK | MSG_WAITALL))) {
+    return source_(bytes, size, flags);
+  }
+
+  ssize_t result = source_(buffer_.get(), capacity_, flags);
+  if (result <= 0) {
+    return result;
+  }
+  begin_ = 0;
+  end_ = result;
+  return CopyStaged(bytes, size, /*peek=*/false);
+}
+
+size_t BufferedReader::ReadStaged(void *data, size_t size) {
+  absl::MutexLock lock(&mu_);
+  return CopyStaged(static_cast<char *>(data), size, /*peek=*/false);
+}
+
+size_t BufferedReader::CopyStaged(char *data, size_t size, bool peek) {
+  size_t copied = std::min(size, end_ - begin_);
+  memcpy(data, buffer_.get() + begin_, copied);
+  if (!peek) {
+    begin_ += copied;
+  }
+  staged_.store(end_ - begin_, std::memory_order_release);
+  return copied;
+}
+
+}  // namespace io
+}  // namespace asylo
@@ -0,0 +1,96 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_POSIX_IO_BUFFERED_READER_H_
+#define ASYLO_PLATFORM_POSIX_IO_BUFFERED_READER_H_
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace asylo {
+namespace io {
+
+// Stages reads from a stream socket in enclave memory, so that many small
+// reads, such as those of a protocol parsing requests a few bytes at a time,
+// are served by a single host read. A read finding no staged data reads as
+// much as is available, up to the capacity of the buffer, and later reads are
+// served from the buffer until it drains. Reads at least as large as the
+// buffer bypass it once it is empty.
+//
+// The host does not see staged data, so callers waiting for readiness have to
+// report a stream with staged data as readable themselves, see
+// HasStagedData().
+//
+// This class is thread-safe.
+class BufferedReader {
+ public:
+  // Reads up to |size| bytes into |data| from the underlying stream with
+  // recv(2) |flags|. Returns the number of bytes read, 0 at the end of the
+  // stream, or -1 with errno set.
+  using Source = std::function<ssize_t(void *data, size_t size, int flags)>;
+
+  BufferedReader(Source source, size_t capacity);
+
+  BufferedReader(const BufferedReader &other) = delete;
+  BufferedReader &operator=(const BufferedReader &other) = delete;
+
+  // Reads up to |size| bytes into |data| as recv(2) with |flags| would.
+  // MSG_PEEK leaves the data read staged, MSG_WAITALL completes a read from
+  // staged data from the stream, and other flags are passed to the stream.
+  // Returns the number of bytes read, 0 at the end of the stream, or -1 with
+  // errno set.
+  ssize_t Read(void *data, size_t size, int flags);
+
+  // Copies up to |size| bytes of staged data to |data| without reading from
+  // the stream. Returns the number of bytes copied.
+  size_t ReadStaged(void *data, size_t size);
+
+  // Returns true if data is staged. Does not block on concurrent reads.
+  bool HasStagedData() const {
+    return staged_.load(std::memory_order_acquire) > 0;
+  }
+
+ private:
+  // Copies up to |size| bytes of staged data to |data|, consuming them unless
+  // |peek| is set. Returns the number of bytes copied.
+  size_t CopyStaged(char *data, size_t size, bool peek)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const Source source_;
+  const size_t capacity_;
+
+  absl::Mutex mu_;
+  const std::unique_ptr<char[]> buffer_;
+  // Staged data is buffer_[begin_, end_).
+  size_t begin_ ABSL_GUARDED_BY(mu_);
+  size_t end_ ABSL_GUARDED_BY(mu_);
+  // Number of bytes staged, readable without holding |mu_|.
+  std::atomic<size_t> staged_;
+};
+
+}  // namespace io
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_IO_BUFFERED_READER_H_
@@ -0,0 +1,136 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/io/buffered_reader.h"
+
+#include <errno.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/memory/memory.h"
+
+namespace asylo {
+namespace io {
+namespace {
+
+using ::testing::ElementsAre;
+
+class BufferedReaderTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<BufferedReader> MakeReader(size_t capacity) {
+    return absl::make_unique<BufferedReader>(
+        [this](void *data, size_t size, int flags) -> ssize_t {
+          reads_.push_back(size);
+          if (fail_) {
+            errno = ECONNRESET;
+            return -1;
+          }
+          size_t read = std::min(size, stream_.size());
+          memcpy(data, stream_.data(), read);
+          if (!(flags & MSG_PEEK)) {
+            stream_.erase(0, read);
+          }
+          return read;
+        },
+        capacity);
+  }
+
+  std::string Read(BufferedReader *reader, size_t size, int flags = 0) {
+    std::string data(size, '\0');
+    ssize_t result = reader->Read(&data[0], size, flags);
+    data.resize(std::max<ssize_t>(result, 0));
+    return data;
+  }
+
+  std::string stream_;
+  std::vector<size_t> reads_;
+  bool fail_ = false;
+};
+
+TEST_F(BufferedReaderTest, ServesSmallReadsFromOneStreamRead) {
+  stream_ = "abcdefgh";
+  auto reader = MakeReader(16);
+  EXPECT_EQ(Read(reader.get(), 3), "abc");
+  EXPECT_TRUE(reader->HasStagedData());
+  EXPECT_EQ(Read(reader.get(), 3), "def");
+  EXPECT_EQ(Read(reader.get(), 3), "gh");
+  EXPECT_FALSE(reader->HasStagedData());
+  EXPECT_THAT(reads_, ElementsAre(16));
+}
+
+TEST_F(BufferedReaderTest, LargeReadsBypassBuffer) {
+  stream_ = "0123456789";
+  auto reader = MakeReader(4);
+  EXPECT_EQ(Read(reader.get(), 8), "01234567");
+  EXPECT_FALSE(reader->HasStagedData());
+  EXPECT_EQ(Read(reader.get(), 1), "8");
+  EXPECT_THAT(reads_, ElementsAre(8, 4));
+}
+
+TEST_F(BufferedReaderTest, PeekLeavesDataStaged) {
+  stream_ = "abcdef";
+  auto reader = MakeReader(16);
+  EXPECT_EQ(Read(reader.get(), 1), "a");
+  EXPECT_EQ(Read(reader.get(), 2, MSG_PEEK), "bc");
+  EXPECT_EQ(Read(reader.get(), 5), "bcdef");
+  EXPECT_THAT(reads_, ElementsAre(16));
+}
+
+TEST_F(BufferedReaderTest, WaitAllCompletesFromStream) {
+  stream_ = "abc";
+  auto reader = MakeReader(16);
+  EXPECT_EQ(Read(reader.get(), 1), "a");
+  stream_ = "defgh";
+  EXPECT_EQ(Read(reader.get(), 6, MSG_WAITALL), "bcdefg");
+  EXPECT_THAT(reads_, ElementsAre(16, 4));
+  EXPECT_EQ(stream_, "h");
+}
+
+TEST_F(BufferedReaderTest, ReadStagedDoesNotReadStream) {
+  stream_ = "abcd";
+  auto reader = MakeReader(16);
+  char data[8];
+  EXPECT_EQ(reader->ReadStaged(data, sizeof(data)), 0);
+  EXPECT_EQ(Read(reader.get(), 1), "a");
+  EXPECT_EQ(reader->ReadStaged(data, sizeof(data)), 3);
+  EXPECT_EQ(std::string(data, 3), "bcd");
+  EXPECT_THAT(reads_, ElementsAre(16));
+}
+
+TEST_F(BufferedReaderTest, ReportsStreamFailureAndEnd) {
+  auto reader = MakeReader(16);
+  fail_ = true;
+  char data[4];
+  errno = 0;
+  EXPECT_EQ(reader->Read(data, sizeof(data), 0), -1);
+  EXPECT_EQ(errno, ECONNRESET);
+  fail_ = false;
+  EXPECT_EQ(reader->Read(data, sizeof(data), 0), 0);
+  EXPECT_FALSE(reader->HasStagedData());
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace asylo
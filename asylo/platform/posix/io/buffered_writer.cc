@@ -0,0 +1,136 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/io/buffered_writer.h"
+
+#include <errno.h>
+
+#include <cstring>
+#include <utility>
+
+#include "absl/container/flat_hash_set.h"
+
+namespace asylo {
+namespace io {
+namespace {
+
+// Live writers, flushed by FlushAll().
+struct Registry {
+  absl::Mutex mu;
+  absl::flat_hash_set<BufferedWriter *> writers ABSL_GUARDED_BY(mu);
+};
+
+Registry *GetRegistry() {
+  static Registry *registry = new Registry;
+  return registry;
+}
+
+}  // namespace
+
+BufferedWriter::BufferedWriter(Sink sink, Clock clock, const Options &options)
+    : sink_(std::move(sink)),
+      clock_(std::move(clock)),
+      options_(options),
+      buffer_(new char[options.capacity]),
+      size_(0),
+      last_flush_nanos_(0) {
+  Registry *registry = GetRegistry();
+  absl::MutexLock lock(&registry->mu);
+  registry->writers.insert(this);
+}
+
+BufferedWriter::~BufferedWriter() {
+  {
+    Registry *registry = GetRegistry();
+    absl::MutexLock lock(&registry->mu);
+    registry->writers.erase(this);
+  }
+  absl::MutexLock lock(&mu_);
+  FlushLocked();
+}
+
+ssize_t BufferedWriter::Write(const void *data, size_t size) {
+  const char *bytes = static_cast<const char *>(data);
+  absl::MutexLock lock(&mu_);
+  if (size_ + size > options_.capacity && FlushLocked() != 0) {
+    return -1;
+  }
+  if (size >= options_.capacity) {
+    return WriteFully(bytes, size) == 0 ? static_cast<ssize_t>(size) : -1;
+  }
+
+  int64_t now = 0;
+  bool has_time = options_.flush_interval_nanos > 0 && clock_ && clock_(&now);
+  if (size_ == 0) {
+    last_flush_nanos_ = now;
+  }
+  memcpy(buffer_.get() + size_, bytes, size);
+  size_ += size;
+
+  bool flush =
+      (options_.line_buffered && memchr(bytes, '\n', size) != nullptr) ||
+      (has_time && now - last_flush_nanos_ >= options_.flush_interval_nanos);
+  if (flush && FlushLocked() != 0) {
+    return -1;
+  }
+  return static_cast<ssize_t>(size);
+}
+
+int BufferedWriter::Flush() {
+  absl::MutexLock lock(&mu_);
+  return FlushLocked();
+}
+
+void BufferedWriter::FlushAll() {
+  Registry *registry = GetRegistry();
+  absl::MutexLock lock(&registry->mu);
+  for (BufferedWriter *writer : registry->writers) {
+    writer->Flush();
+  }
+}
+
+int BufferedWriter::FlushLocked() {
+  if (size_ == 0) {
+    return 0;
+  }
+  int result = WriteFully(buffer_.get(), size_);
+  size_ = 0;
+  return result;
+}
+
+int BufferedWriter::WriteFully(const char *data, size_t size) {
+  while (size > 0) {
+    ssize_t written = sink_(data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    if (written == 0) {
+      errno = EIO;
+      return -1;
+    }
+    data += written;
+    size -= written;
+  }
+  return 0;
+}
+
+}  // namespace io
+}  // namespace asylo
@@ -0,0 +1,110 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_POSIX_IO_BUFFERED_WRITER_H_
+#define ASYLO_PLATFORM_POSIX_IO_BUFFERED_WRITER_H_
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace asylo {
+namespace io {
+
+// Buffers writes to a file in enclave memory, so that many small writes, such
+// as log lines written to standard out or standard error, are coalesced into
+// a single host write. Buffered data is written when:
+//  * the buffer would overflow,
+//  * a newline is written, if the writer is line buffered,
+//  * more than the flush interval elapsed since the last flush, as checked at
+//    each write,
+//  * Flush() or FlushAll() is called, or the writer is destroyed.
+//
+// Writes are reported as successful once buffered. A failure to write
+// buffered data is reported by the call that triggered the flush, and the
+// buffered data is dropped.
+//
+// This class is thread-safe.
+class BufferedWriter {
+ public:
+  // Writes |size| bytes of |data| to the underlying file. Returns the number
+  // of bytes written, or -1 with errno set.
+  using Sink = std::function<ssize_t(const void *data, size_t size)>;
+
+  // Reads a monotonic clock into |nanos|. Returns false if the clock cannot be
+  // read cheaply, in which case the flush interval is not enforced.
+  using Clock = std::function<bool(int64_t *nanos)>;
+
+  struct Options {
+    // Size of the buffer in bytes. Writes at least this large bypass it.
+    size_t capacity = 4096;
+    // Whether to flush at each newline.
+    bool line_buffered = false;
+    // Maximum time buffered data is held before the next write flushes it, or
+    // 0 to only flush on size.
+    int64_t flush_interval_nanos = 0;
+  };
+
+  BufferedWriter(Sink sink, Clock clock, const Options &options);
+
+  // Flushes buffered data.
+  ~BufferedWriter();
+
+  BufferedWriter(const BufferedWriter &other) = delete;
+  BufferedWriter &operator=(const BufferedWriter &other) = delete;
+
+  // Buffers |size| bytes of |data|, flushing as needed. Returns |size|, or -1
+  // with errno set if a flush failed.
+  ssize_t Write(const void *data, size_t size);
+
+  // Writes buffered data. Returns 0 on success, or -1 with errno set.
+  int Flush();
+
+  // Flushes every live writer, for instance before the enclave exits.
+  static void FlushAll();
+
+ private:
+  // Writes buffered data. Returns 0 on success, or -1 with errno set.
+  int FlushLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Writes all of |data| to |sink_|. Returns 0 on success, or -1 with errno
+  // set.
+  int WriteFully(const char *data, size_t size)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const Sink sink_;
+  const Clock clock_;
+  const Options options_;
+
+  absl::Mutex mu_;
+  const std::unique_ptr<char[]> buffer_;
+  size_t size_ ABSL_GUARDED_BY(mu_);
+  // Time of the last flush, or of the first buffered write since.
+  int64_t last_flush_nanos_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace io
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_IO_BUFFERED_WRITER_H_
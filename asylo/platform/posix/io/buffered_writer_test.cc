@@ -0,0 +1,157 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/io/buffered_writer.h"
+
+#include <errno.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/memory/memory.h"
+
+namespace asylo {
+namespace io {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+class BufferedWriterTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<BufferedWriter> MakeWriter(
+      const BufferedWriter::Options &options) {
+    return absl::make_unique<BufferedWriter>(
+        [this](const void *data, size_t size) -> ssize_t {
+          if (fail_) {
+            errno = EPIPE;
+            return -1;
+          }
+          // Exercise partial writes.
+          size_t written = std::min(size, max_write_);
+          writes_.emplace_back(static_cast<const char *>(data), written);
+          return written;
+        },
+        [this](int64_t *nanos) {
+          *nanos = now_;
+          return has_clock_;
+        },
+        options);
+  }
+
+  std::vector<std::string> writes_;
+  size_t max_write_ = 1 << 20;
+  bool fail_ = false;
+  int64_t now_ = 0;
+  bool has_clock_ = true;
+};
+
+TEST_F(BufferedWriterTest, CoalescesUntilFull) {
+  BufferedWriter::Options options;
+  options.capacity = 8;
+  auto writer = MakeWriter(options);
+  EXPECT_EQ(writer->Write("abc", 3), 3);
+  EXPECT_EQ(writer->Write("def", 3), 3);
+  EXPECT_THAT(writes_, IsEmpty());
+  EXPECT_EQ(writer->Write("ghi", 3), 3);
+  EXPECT_THAT(writes_, ElementsAre("abcdef"));
+  EXPECT_EQ(writer->Flush(), 0);
+  EXPECT_THAT(writes_, ElementsAre("abcdef", "ghi"));
+}
+
+TEST_F(BufferedWriterTest, LargeWritesBypassBuffer) {
+  BufferedWriter::Options options;
+  options.capacity = 4;
+  auto writer = MakeWriter(options);
+  EXPECT_EQ(writer->Write("ab", 2), 2);
+  EXPECT_EQ(writer->Write("0123456789", 10), 10);
+  EXPECT_THAT(writes_, ElementsAre("ab", "0123456789"));
+}
+
+TEST_F(BufferedWriterTest, LineBufferedFlushesAtNewline) {
+  BufferedWriter::Options options;
+  options.line_buffered = true;
+  auto writer = MakeWriter(options);
+  EXPECT_EQ(writer->Write("hello ", 6), 6);
+  EXPECT_THAT(writes_, IsEmpty());
+  EXPECT_EQ(writer->Write("world\n", 6), 6);
+  EXPECT_THAT(writes_, ElementsAre("hello world\n"));
+}
+
+TEST_F(BufferedWriterTest, FlushesAfterInterval) {
+  BufferedWriter::Options options;
+  options.flush_interval_nanos = 100;
+  auto writer = MakeWriter(options);
+  now_ = 1000;
+  EXPECT_EQ(writer->Write("a", 1), 1);
+  now_ = 1050;
+  EXPECT_EQ(writer->Write("b", 1), 1);
+  EXPECT_THAT(writes_, IsEmpty());
+  now_ = 1100;
+  EXPECT_EQ(writer->Write("c", 1), 1);
+  EXPECT_THAT(writes_, ElementsAre("abc"));
+
+  // The interval is not enforced without a cheap clock.
+  has_clock_ = false;
+  now_ = 5000;
+  EXPECT_EQ(writer->Write("d", 1), 1);
+  EXPECT_THAT(writes_, ElementsAre("abc"));
+}
+
+TEST_F(BufferedWriterTest, RetriesPartialWrites) {
+  max_write_ = 2;
+  BufferedWriter::Options options;
+  auto writer = MakeWriter(options);
+  EXPECT_EQ(writer->Write("abcde", 5), 5);
+  EXPECT_EQ(writer->Flush(), 0);
+  EXPECT_THAT(writes_, ElementsAre("ab", "cd", "e"));
+}
+
+TEST_F(BufferedWriterTest, ReportsFlushFailure) {
+  BufferedWriter::Options options;
+  options.line_buffered = true;
+  auto writer = MakeWriter(options);
+  fail_ = true;
+  errno = 0;
+  EXPECT_EQ(writer->Write("x\n", 2), -1);
+  EXPECT_EQ(errno, EPIPE);
+  fail_ = false;
+  EXPECT_EQ(writer->Flush(), 0);
+  EXPECT_THAT(writes_, IsEmpty());
+}
+
+TEST_F(BufferedWriterTest, FlushAllAndDestructionFlush) {
+  BufferedWriter::Options options;
+  auto first = MakeWriter(options);
+  auto second = MakeWriter(options);
+  first->Write("1", 1);
+  second->Write("2", 1);
+  BufferedWriter::FlushAll();
+  EXPECT_THAT(writes_, ::testing::UnorderedElementsAre("1", "2"));
+  first->Write("3", 1);
+  first.reset();
+  EXPECT_EQ(writes_.back(), "3");
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace asylo
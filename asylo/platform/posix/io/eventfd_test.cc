@@ -16,7 +16,10 @@
  *
  */
 
+#include <poll.h>
+#include <sys/epoll.h>
 #include <sys/eventfd.h>
+#include <sys/select.h>
 #include <unistd.h>
 
 #include <atomic>
@@ -196,5 +199,82 @@ TEST_F(EventFdTest, MaxCounterNonBlock) {
   EXPECT_EQ(errno, EAGAIN);
 }
 
+TEST_F(EventFdTest, PollReportsCounter) {
+  InitializeEventFd(false, 0, true);
+  struct pollfd fds = {event_fd_, POLLIN | POLLOUT, 0};
+  ASSERT_EQ(poll(&fds, 1, 0), 1);
+  EXPECT_EQ(fds.revents, POLLOUT);
+  ASSERT_EQ(Write(1), sizeof(uint64_t));
+  ASSERT_EQ(poll(&fds, 1, 0), 1);
+  EXPECT_EQ(fds.revents, POLLIN | POLLOUT);
+}
+
+TEST_F(EventFdTest, PollWaitsForWrite) {
+  InitializeEventFd(false, 0, true);
+  std::thread worker([this] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(kSleepDur));
+    Write(1);
+  });
+  struct pollfd fds = {event_fd_, POLLIN, 0};
+  EXPECT_EQ(poll(&fds, 1, -1), 1);
+  EXPECT_EQ(fds.revents, POLLIN);
+  worker.join();
+  EXPECT_EQ(Read(), 1);
+  EXPECT_EQ(poll(&fds, 1, 0), 0);
+}
+
+TEST_F(EventFdTest, PollWithHostFileDescriptor) {
+  InitializeEventFd(false, 0, true);
+  int pipe_fds[2];
+  ASSERT_EQ(pipe(pipe_fds), 0);
+  std::thread worker([this] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(kSleepDur));
+    Write(1);
+  });
+  struct pollfd fds[2] = {{pipe_fds[0], POLLIN, 0}, {event_fd_, POLLIN, 0}};
+  EXPECT_EQ(poll(fds, 2, -1), 1);
+  EXPECT_EQ(fds[0].revents, 0);
+  EXPECT_EQ(fds[1].revents, POLLIN);
+  worker.join();
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+}
+
+TEST_F(EventFdTest, SelectReportsCounter) {
+  InitializeEventFd(false, 0, true);
+  fd_set readfds;
+  FD_ZERO(&readfds);
+  FD_SET(event_fd_, &readfds);
+  struct timeval no_wait = {0, 0};
+  EXPECT_EQ(select(event_fd_ + 1, &readfds, nullptr, nullptr, &no_wait), 0);
+  ASSERT_EQ(Write(1), sizeof(uint64_t));
+  FD_SET(event_fd_, &readfds);
+  EXPECT_EQ(select(event_fd_ + 1, &readfds, nullptr, nullptr, &no_wait), 1);
+  EXPECT_TRUE(FD_ISSET(event_fd_, &readfds));
+}
+
+TEST_F(EventFdTest, EpollReportsCounter) {
+  InitializeEventFd(false, 0, true);
+  int epfd = epoll_create(1);
+  ASSERT_NE(epfd, -1);
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.u64 = 42;
+  ASSERT_EQ(epoll_ctl(epfd, EPOLL_CTL_ADD, event_fd_, &event), 0);
+  struct epoll_event ready;
+  EXPECT_EQ(epoll_wait(epfd, &ready, 1, 0), 0);
+  std::thread worker([this] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(kSleepDur));
+    Write(1);
+  });
+  ASSERT_EQ(epoll_wait(epfd, &ready, 1, -1), 1);
+  EXPECT_EQ(ready.events, EPOLLIN);
+  EXPECT_EQ(ready.data.u64, 42);
+  worker.join();
+  EXPECT_EQ(Read(), 1);
+  EXPECT_EQ(epoll_wait(epfd, &ready, 1, 0), 0);
+  close(epfd);
+}
+
 }  // namespace
 }  // namespace asylo
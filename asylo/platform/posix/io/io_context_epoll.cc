@@ -20,19 +20,55 @@
 #include <errno.h>
 #include <openssl/rand.h>
 #include <stdint.h>
+#include <time.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
 
 #include "absl/memory/memory.h"
 #include "asylo/platform/host_call/trusted/host_calls.h"
 
 namespace asylo {
 namespace io {
+namespace {
+
+// Returns the current monotonic time in microseconds.
+int64_t MonotonicMicros() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<int64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+}
+
+// Returns true if the host reports events of |event| only once.
+bool IsEdgeTriggered(const struct epoll_event *event) {
+  return event && (event->events & (EPOLLET | EPOLLONESHOT));
+}
 
-int IOContextEpoll::EpollCtl(int op, int hostfd, struct epoll_event *event) {
+}  // namespace
+
+int IOContextEpoll::EpollCtl(
+    int op, int hostfd, struct epoll_event *event,
+    const std::shared_ptr<IOManager::IOContext> &target) {
+  if (!event && op != EPOLL_CTL_DEL) {
+    errno = EFAULT;
+    return -1;
+  }
   struct epoll_event event_copy;
+  bool local = target && target->LocalEvents() >= 0;
   if (event) {
-    event_copy.events = event->events;
+    // The host readiness file descriptor of an enclave-local context is
+    // readable whenever the context may have events.
+    event_copy.events =
+        local ? EPOLLIN | (event->events & (EPOLLET | EPOLLONESHOT))
+              : event->events;
   }
+  absl::MutexLock lock(&mu_);
   if (op == EPOLL_CTL_ADD) {
+    if (fd_to_key.find(hostfd) != fd_to_key.end()) {
+      errno = EEXIST;
+      return -1;
+    }
     uint64_t key = 0;
     do {
       if (RAND_bytes(reinterpret_cast<uint8_t *>(&key),
@@ -42,49 +78,300 @@ int IOContextEpoll::EpollCtl(int op, int hostfd, struct epoll_event *event) {
       }
     } while (key_to_data.find(key) != key_to_data.end());
     key_to_data[key] = event->data.u64;
-    fd_to_key[hostfd] = key;
+    fd_to_key[hostfd] = {key, IsEdgeTriggered(event), event->events, {}};
+    if (target && target->StagesInput()) {
+      staged_sources_[hostfd] = target;
+    }
+    if (local) {
+      fd_to_key[hostfd].local = target;
+      local_sources_[key] = hostfd;
+    }
+    if (!IsEdgeTriggered(event)) {
+      level_triggered_registrations_++;
+    }
     event_copy.data.u64 = key;
   } else if (op == EPOLL_CTL_MOD) {
-    if (fd_to_key.find(hostfd) == fd_to_key.end()) {
+    auto it = fd_to_key.find(hostfd);
+    if (it == fd_to_key.end()) {
       errno = ENOENT;
       return -1;
     }
-    uint64_t key = fd_to_key[hostfd];
-    key_to_data[key] = event->data.u64;
-    event_copy.data.u64 = key;
+    Registration &registration = it->second;
+    if (registration.edge_triggered != IsEdgeTriggered(event)) {
+      level_triggered_registrations_ += registration.edge_triggered ? 1 : -1;
+      registration.edge_triggered = IsEdgeTriggered(event);
+    }
+    registration.events = event->events;
+    key_to_data[registration.key] = event->data.u64;
+    event_copy.data.u64 = registration.key;
   } else if (op == EPOLL_CTL_DEL) {
-    if (fd_to_key.find(hostfd) == fd_to_key.end()) {
+    auto it = fd_to_key.find(hostfd);
+    if (it == fd_to_key.end()) {
       errno = ENOENT;
       return -1;
     }
-    uint64_t key = fd_to_key[hostfd];
+    uint64_t key = it->second.key;
+    if (!it->second.edge_triggered) {
+      level_triggered_registrations_--;
+    }
     event_copy.data.u64 = key;
-    fd_to_key.erase(hostfd);
+    fd_to_key.erase(it);
     key_to_data.erase(key);
+    staged_sources_.erase(hostfd);
+    local_sources_.erase(key);
   } else {
     return -1;
   }
-  return enc_untrusted_epoll_ctl(host_fd_, op, hostfd, &event_copy);
+  int ret = enc_untrusted_epoll_ctl(host_fd_, op, hostfd, &event_copy);
+  if (ret == -1 && op == EPOLL_CTL_ADD) {
+    // Forget the registration the host refused.
+    int saved_errno = errno;
+    if (!IsEdgeTriggered(event)) {
+      level_triggered_registrations_--;
+    }
+    key_to_data.erase(event_copy.data.u64);
+    fd_to_key.erase(hostfd);
+    staged_sources_.erase(hostfd);
+    local_sources_.erase(event_copy.data.u64);
+    errno = saved_errno;
+  }
+  if (level_triggered_registrations_ > 0 && ring_) {
+    StopRing();
+  }
+  return ret;
 }
 
 int IOContextEpoll::EpollWait(struct epoll_event *events, int maxevents,
                               int timeout) {
-  int ret = enc_untrusted_epoll_wait(host_fd_, events, maxevents, timeout);
-  if (ret == -1) {
-    // errno is set in enc_untrusted_epoll_wait.
+  if (maxevents <= 0) {
+    errno = EINVAL;
     return -1;
   }
-  // Convert the random bits in the data field back to the original data using
-  // the key_to_data map.
-  for (int i = 0; i < ret; ++i) {
-    uint64_t key = events[i].data.u64;
-    if (key_to_data.find(key) == key_to_data.end()) {
+  absl::MutexLock lock(&mu_);
+  MaybeStartRing();
+  int staged = TakeEnclaveEvents(events, maxevents);
+  if (staged > 0) {
+    return WaitWithEnclaveEvents(events, maxevents, staged);
+  }
+  const int64_t deadline =
+      timeout > 0 ? MonotonicMicros() + int64_t{timeout} * 1000 : 0;
+  while (true) {
+    int count = TakeReadyEvents(events, maxevents);
+    if (count > 0 || (ring_ && timeout == 0)) {
+      return count;
+    }
+    if (!ring_) {
+      break;
+    }
+    if (ring_->IsClosed()) {
+      // The untrusted thread filling the ring failed. Fall back to waiting on
+      // the host directly.
+      ring_failed_ = true;
+      StopRing();
+      continue;
+    }
+    int64_t timeout_microsec = 0;
+    if (timeout > 0) {
+      timeout_microsec = deadline - MonotonicMicros();
+      if (timeout_microsec <= 0) {
+        return 0;
+      }
+    }
+    // Wait on the ring without holding |mu_|. StopRing() closes the ring to
+    // wake this thread up, then waits for it to leave before freeing the ring.
+    host_call::EpollEventRingClient *ring = ring_.get();
+    ring_waiters_++;
+    mu_.Unlock();
+    ring->Wait(timeout_microsec);
+    mu_.Lock();
+    ring_waiters_--;
+    mu_.Await(absl::Condition(+[](bool *stopping) { return !*stopping; },
+                              &ring_stopping_));
+  }
+
+  while (true) {
+    direct_waiters_++;
+    mu_.Unlock();
+    int ret = enc_untrusted_epoll_wait(host_fd_, events, maxevents, timeout);
+    int saved_errno = errno;
+    mu_.Lock();
+    direct_waiters_--;
+    if (ret == -1) {
+      // errno is set in enc_untrusted_epoll_wait.
+      errno = saved_errno;
+      return -1;
+    }
+    // Convert the random bits in the data field back to the original data
+    // using the key_to_data map.
+    int count = TranslateEvents(events, ret, /*drop_unknown=*/false);
+    if (count != 0 || ret == 0 || timeout == 0) {
+      return count;
+    }
+    // Only enclave-local registrations whose events were consumed since the
+    // host reported them woke this thread up, so it waits again.
+    if (timeout > 0) {
+      timeout = static_cast<int>((deadline - MonotonicMicros()) / 1000);
+      if (timeout <= 0) {
+        return 0;
+      }
+    }
+  }
+}
+
+void IOContextEpoll::MaybeStartRing() {
+  if (ring_ || ring_failed_ || ring_stopping_ || direct_waiters_ > 0 ||
+      level_triggered_registrations_ > 0 || fd_to_key.empty()) {
+    return;
+  }
+  ring_ = host_call::EpollEventRingClient::Create(host_fd_);
+  if (!ring_) {
+    ring_failed_ = true;
+  }
+}
+
+void IOContextEpoll::StopRing() {
+  std::unique_ptr<host_call::EpollEventRingClient> ring = std::move(ring_);
+  ring_stopping_ = true;
+  ring->Close();
+  mu_.Await(absl::Condition(+[](int *waiters) { return *waiters == 0; },
+                            &ring_waiters_));
+  std::vector<struct epoll_event> leftover;
+  ring->Stop(&leftover);
+  pending_.insert(pending_.end(), leftover.begin(), leftover.end());
+  ring_stopping_ = false;
+}
+
+int IOContextEpoll::TakeReadyEvents(struct epoll_event *events,
+                                    int maxevents) {
+  int count = TakeCollectedEvents(events, maxevents);
+  // Events collected ahead of time may belong to file descriptors that have
+  // been removed since.
+  return TranslateEvents(events, count, /*drop_unknown=*/true);
+}
+
+int IOContextEpoll::TakeCollectedEvents(struct epoll_event *events,
+                                        int maxevents) {
+  int count = 0;
+  while (count < maxevents && !pending_.empty()) {
+    events[count++] = pending_.front();
+    pending_.pop_front();
+  }
+  if (ring_ && count < maxevents) {
+    count += ring_->Pop(events + count, maxevents - count);
+  }
+  return count;
+}
+
+int IOContextEpoll::TakeEnclaveEvents(struct epoll_event *events,
+                                      int maxevents) {
+  int count = 0;
+  for (const auto &source : local_sources_) {
+    if (count == maxevents) {
+      break;
+    }
+    auto it = fd_to_key.find(source.second);
+    if (it == fd_to_key.end() || it->second.edge_triggered) {
+      // Edge-triggered registrations are only reported once the host reports
+      // a change of readiness.
+      continue;
+    }
+    uint32_t ready = LocalEvents(it->second);
+    if (ready == 0) {
+      continue;
+    }
+    events[count].events = ready;
+    events[count].data.u64 = source.first;
+    count++;
+  }
+  for (const auto &source : staged_sources_) {
+    if (count == maxevents) {
+      break;
+    }
+    std::shared_ptr<IOManager::IOContext> context = source.second.lock();
+    if (!context || !context->HasStagedInput()) {
+      continue;
+    }
+    auto it = fd_to_key.find(source.first);
+    if (it == fd_to_key.end() || !(it->second.events & EPOLLIN)) {
+      continue;
+    }
+    const Registration &registration = it->second;
+    events[count].events = EPOLLIN | (registration.events & EPOLLRDNORM);
+    events[count].data.u64 = registration.key;
+    count++;
+  }
+  return count;
+}
+
+int IOContextEpoll::WaitWithEnclaveEvents(struct epoll_event *events,
+                                          int maxevents, int staged) {
+  int count = staged;
+  if (count < maxevents) {
+    if (ring_) {
+      count += TakeCollectedEvents(events + count, maxevents - count);
+    } else {
+      int ret = enc_untrusted_epoll_wait(host_fd_, events + count,
+                                         maxevents - count, /*timeout=*/0);
+      count += std::max(ret, 0);
+    }
+  }
+
+  // Merge the host events of file descriptors with events in the enclave into
+  // those events, so that each file descriptor is reported once.
+  int kept = staged;
+  for (int i = staged; i < count; ++i) {
+    int j = 0;
+    while (j < staged && events[j].data.u64 != events[i].data.u64) {
+      j++;
+    }
+    if (j < staged) {
+      events[j].events |= events[i].events;
+    } else {
+      events[kept++] = events[i];
+    }
+  }
+  return TranslateEvents(events, kept, /*drop_unknown=*/true);
+}
+
+int IOContextEpoll::TranslateEvents(struct epoll_event *events, int count,
+                                    bool drop_unknown) {
+  int kept = 0;
+  for (int i = 0; i < count; ++i) {
+    auto it = key_to_data.find(events[i].data.u64);
+    if (it == key_to_data.end()) {
+      if (drop_unknown) {
+        continue;
+      }
       errno = EBADE;
       return -1;
     }
-    events[i].data.u64 = key_to_data[key];
+    auto local = local_sources_.find(events[i].data.u64);
+    if (local != local_sources_.end()) {
+      auto registration = fd_to_key.find(local->second);
+      uint32_t ready = registration == fd_to_key.end()
+                           ? 0
+                           : LocalEvents(registration->second);
+      if (ready == 0) {
+        continue;
+      }
+      events[i].events = ready;
+    }
+    events[kept] = events[i];
+    events[kept].data.u64 = it->second;
+    kept++;
   }
-  return ret;
+  return kept;
+}
+
+uint32_t IOContextEpoll::LocalEvents(const Registration &registration) {
+  std::shared_ptr<IOManager::IOContext> context = registration.local.lock();
+  if (!context) {
+    return 0;
+  }
+  // The poll(2) and epoll(7) event bits are the same.
+  uint32_t ready = static_cast<uint32_t>(context->LocalEvents());
+  return ready & (registration.events | EPOLLERR | EPOLLHUP) &
+         ~(EPOLLET | EPOLLONESHOT);
 }
 
 int IOContextEpoll::GetHostFileDescriptor() { return host_fd_; }
@@ -100,7 +387,15 @@ ssize_t IOContextEpoll::Write(const void *buf, size_t count) {
   return -1;
 }
 
-int IOContextEpoll::Close() { return enc_untrusted_close(host_fd_); }
+int IOContextEpoll::Close() {
+  {
+    absl::MutexLock lock(&mu_);
+    if (ring_) {
+      StopRing();
+    }
+  }
+  return enc_untrusted_close(host_fd_);
+}
 
 }  // namespace io
 }  // namespace asylo
@@ -19,19 +19,52 @@
 #ifndef ASYLO_PLATFORM_POSIX_IO_IO_CONTEXT_EPOLL_H_
 #define ASYLO_PLATFORM_POSIX_IO_IO_CONTEXT_EPOLL_H_
 
+#include <sys/epoll.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
 #include <unordered_map>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "asylo/platform/host_call/trusted/epoll_event_ring_client.h"
 #include "asylo/platform/posix/io/io_manager.h"
 
 namespace asylo {
 namespace io {
-// IOContext implementation wrapping an epoll file descriptor
+// IOContext implementation wrapping an epoll file descriptor.
+//
+// While every registered file descriptor is edge-triggered or one-shot, events
+// are collected by an untrusted thread into a ring in untrusted memory, see
+// host_call::EpollEventRingClient. Such events are reported exactly once by
+// the host regardless of when they are consumed, so EpollWait can serve them
+// without leaving the enclave, and a zero timeout never exits. As soon as a
+// level-triggered file descriptor is registered, the ring is stopped and
+// EpollWait calls the host epoll_wait directly, since level-triggered
+// readiness cannot be cached without reporting stale events.
+//
+// File descriptors registered for EPOLLIN with input staged in enclave memory,
+// see IOContext::HasStagedInput, are reported as readable by EpollWait while
+// input is staged, which the host cannot see. Likewise, the events of
+// level-triggered enclave-local file descriptors, see IOContext::LocalEvents,
+// are reported from enclave memory. The host is then only checked for events
+// without waiting. The host waits on the host readiness file descriptors of
+// enclave-local file descriptors, and the events it reports for them are
+// replaced with their events in the enclave.
 class IOContextEpoll : public IOManager::IOContext {
  public:
-  explicit IOContextEpoll(int host_fd) : host_fd_(host_fd) {}
+  explicit IOContextEpoll(int host_fd)
+      : host_fd_(host_fd),
+        level_triggered_registrations_(0),
+        direct_waiters_(0),
+        ring_waiters_(0),
+        ring_stopping_(false),
+        ring_failed_(false) {}
   // It's important to note that adding dup'd file descriptors here won't work
   // the same as it would in POSIX.
-  int EpollCtl(int op, int hostfd, struct epoll_event *event) override;
+  int EpollCtl(int op, int hostfd, struct epoll_event *event,
+               const std::shared_ptr<IOManager::IOContext> &target) override;
   int EpollWait(struct epoll_event *events, int maxevents,
                 int timeout) override;
   int GetHostFileDescriptor() override;
@@ -40,12 +73,94 @@ class IOContextEpoll : public IOManager::IOContext {
   int Close();
 
  private:
+  // A file descriptor registered with the epoll instance.
+  struct Registration {
+    // Random key passed to the host in place of the event data.
+    uint64_t key;
+    // Whether events are only reported once, by EPOLLET or EPOLLONESHOT.
+    bool edge_triggered;
+    // Events the file descriptor is registered for.
+    uint32_t events;
+    // The registered context if it is enclave-local.
+    std::weak_ptr<IOManager::IOContext> local;
+  };
+
+  // Starts the event ring if the registrations allow it and no thread is
+  // blocked in a direct host epoll_wait, which could otherwise miss events
+  // collected by the ring.
+  void MaybeStartRing() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Stops the event ring, keeping the events it still holds in |pending_|.
+  // Temporarily releases |mu_| while threads blocked on the ring leave it.
+  void StopRing() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Moves up to |maxevents| already collected events from |pending_| and the
+  // event ring to |events|, with their original data. Returns the number of
+  // events moved.
+  int TakeReadyEvents(struct epoll_event *events, int maxevents)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Like TakeReadyEvents, but leaves the keys in the data field of the events.
+  int TakeCollectedEvents(struct epoll_event *events, int maxevents)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Writes an EPOLLIN event, with its key in the data field, to |events| for
+  // up to |maxevents| registrations with input staged in enclave memory, and
+  // the ready events of level-triggered enclave-local registrations. Returns
+  // the number of events written.
+  int TakeEnclaveEvents(struct epoll_event *events, int maxevents)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Completes the |staged| events written by TakeEnclaveEvents at the start of
+  // |events| with the events the host reports without waiting, up to
+  // |maxevents| events in total, and restores the original data of all of
+  // them. Returns the number of events.
+  int WaitWithEnclaveEvents(struct epoll_event *events, int maxevents,
+                            int staged) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns the events of |registration| ready on its enclave-local context,
+  // or 0 if the context is gone.
+  static uint32_t LocalEvents(const Registration &registration);
+
+  // Replaces the keys in the data field of the first |count| entries of
+  // |events| with the data they were registered with, and the events of
+  // enclave-local registrations with their events in the enclave. Events for
+  // keys that are no longer registered are dropped if |drop_unknown| is set,
+  // and make the call fail with EBADE otherwise. Events of enclave-local
+  // registrations without ready events are dropped. Returns the number of
+  // remaining events, or -1 on failure.
+  int TranslateEvents(struct epoll_event *events, int count, bool drop_unknown)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   // Host file descriptor implementing this stream.
   int host_fd_;
-  std::unordered_map<uint64_t, uint64_t> key_to_data;
+
+  absl::Mutex mu_;
+  std::unordered_map<uint64_t, uint64_t> key_to_data ABSL_GUARDED_BY(mu_);
   // Manages a mapping from the host file descriptor to a random key to enable
   // updates to the above map durring deletions/modifications.
-  std::unordered_map<int, uint64_t> fd_to_key;
+  std::unordered_map<int, Registration> fd_to_key ABSL_GUARDED_BY(mu_);
+  // Contexts which stage input, by registered host file descriptor.
+  std::unordered_map<int, std::weak_ptr<IOManager::IOContext>> staged_sources_
+      ABSL_GUARDED_BY(mu_);
+  // Host readiness file descriptors of enclave-local registrations, by key.
+  std::unordered_map<uint64_t, int> local_sources_ ABSL_GUARDED_BY(mu_);
+  // Number of registrations which are not edge-triggered.
+  int level_triggered_registrations_ ABSL_GUARDED_BY(mu_);
+  // Number of threads blocked in a direct host epoll_wait.
+  int direct_waiters_ ABSL_GUARDED_BY(mu_);
+
+  // Event ring collecting host events, if running.
+  std::unique_ptr<host_call::EpollEventRingClient> ring_ ABSL_GUARDED_BY(mu_);
+  // Number of threads blocked waiting on |ring_| without holding |mu_|.
+  int ring_waiters_ ABSL_GUARDED_BY(mu_);
+  // Set while StopRing() waits for |ring_waiters_| to drain.
+  bool ring_stopping_ ABSL_GUARDED_BY(mu_);
+  // Set once the host failed to run an event ring, which is then not retried.
+  bool ring_failed_ ABSL_GUARDED_BY(mu_);
+  // Events collected by a stopped ring and not yet returned, with keys in
+  // their data field.
+  std::deque<struct epoll_event> pending_ ABSL_GUARDED_BY(mu_);
 };
 
 }  // namespace io
@@ -43,6 +43,7 @@ ssize_t IOContextEventFd::Read(void *buf, size_t count) {
     *reinterpret_cast<uint64_t *>(buf) = counter_;
     counter_ = 0;
   }
+  readiness_.Set(CounterEvents(counter_));
   return kCounterBufSize;
 }
 
@@ -65,6 +66,7 @@ ssize_t IOContextEventFd::Write(const void *buf, size_t count) {
     counter_mutex_.Await(absl::Condition(&ready));
   }
   counter_ += add;
+  readiness_.Set(CounterEvents(counter_));
   return kCounterBufSize;
 }
 
@@ -72,5 +74,22 @@ int IOContextEventFd::Close() {
   return 0;
 }
 
+int IOContextEventFd::LocalEvents() { return readiness_.events(); }
+
+int IOContextEventFd::GetHostReadinessFileDescriptor() {
+  return readiness_.GetHostFileDescriptor();
+}
+
+int IOContextEventFd::CounterEvents(uint64_t counter) {
+  int events = 0;
+  if (counter > 0) {
+    events |= POLLIN | POLLRDNORM;
+  }
+  if (counter < kMaxCounter) {
+    events |= POLLOUT | POLLWRNORM;
+  }
+  return events;
+}
+
 }  // namespace io
 }  // namespace asylo
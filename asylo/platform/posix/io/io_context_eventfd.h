@@ -19,20 +19,25 @@
 #ifndef ASYLO_PLATFORM_POSIX_IO_IO_CONTEXT_EVENTFD_H_
 #define ASYLO_PLATFORM_POSIX_IO_IO_CONTEXT_EVENTFD_H_
 
+#include <poll.h>
 #include <sys/eventfd.h>
 
 #include <thread>
 
 #include "absl/synchronization/mutex.h"
 #include "asylo/platform/posix/io/io_manager.h"
+#include "asylo/platform/posix/io/local_readiness.h"
 
 namespace asylo {
 namespace io {
-// IOContext implementation wrapping an epoll file descriptor
+// IOContext implementation of an eventfd whose counter is kept in enclave
+// memory. Its readiness is tracked by LocalReadiness, so threads of the
+// enclave signaling each other through it never exit the enclave.
 class IOContextEventFd : public IOManager::IOContext {
  public:
   explicit IOContextEventFd(unsigned int initval, int flags)
-      : counter_(initval) {
+      : counter_(initval),
+        readiness_(CounterEvents(initval), POLLIN | POLLRDNORM) {
     if (flags & EFD_SEMAPHORE) {
       semaphore_ = true;
     } else {
@@ -48,13 +53,18 @@ class IOContextEventFd : public IOManager::IOContext {
   ssize_t Read(void *buf, size_t count) override;
   ssize_t Write(const void *buf, size_t count) override;
   int Close() override;
+  int LocalEvents() override;
+  int GetHostReadinessFileDescriptor() override;
 
  private:
-  // Host file descriptor implementing this stream.
-  uint64_t counter_;
+  // Returns the poll(2) events ready on an eventfd whose counter is |counter|.
+  static int CounterEvents(uint64_t counter);
+
+  uint64_t counter_ ABSL_GUARDED_BY(counter_mutex_);
   bool semaphore_;
   bool nonblock_;
   absl::Mutex counter_mutex_;
+  LocalReadiness readiness_;
 };
 
 }  // namespace io
@@ -15,16 +15,39 @@
  * limitations under the License.
  *
  */
+
 #include "asylo/platform/posix/io/io_context_inotify.h"
 
+#include <errno.h>
+#include <limits.h>
 #include <sys/inotify.h>
 
-#include "asylo/platform/common/memory.h"
+#include <cstring>
+
 #include "asylo/platform/host_call/serializer_functions.h"
 #include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/platform/primitives/trusted_primitives.h"
 
 namespace asylo {
 namespace io {
+namespace {
+
+using primitives::TrustedPrimitives;
+
+// Size of the buffer the host reads events into. It must hold at least one
+// event with the longest possible name.
+constexpr size_t kEventBatchSize = 16 * 1024;
+
+static_assert(kEventBatchSize >= sizeof(struct inotify_event) + NAME_MAX + 1,
+              "kEventBatchSize is too small to hold an inotify event.");
+
+}  // namespace
+
+IOContextInotify::~IOContextInotify() {
+  if (untrusted_events_) {
+    TrustedPrimitives::UntrustedLocalFree(untrusted_events_);
+  }
+}
 
 int IOContextInotify::GetHostFileDescriptor() { return host_fd_; }
 
@@ -36,57 +59,66 @@ int IOContextInotify::InotifyRmWatch(int wd) {
   return enc_untrusted_inotify_rm_watch(host_fd_, wd);
 }
 
-size_t IOContextInotify::TransferFromQueueToBuffer(char *buf_ptr,
-                                                   size_t count) {
-  size_t num_bytes_written = 0;
-  while (!event_queue_.empty()) {
-    struct inotify_event *front_event = event_queue_.front();
-    size_t front_event_len = sizeof(struct inotify_event) + front_event->len;
-    if (count < front_event_len) {
-      return num_bytes_written;
+size_t IOContextInotify::TransferEventsToBuffer(char *buf_ptr, size_t count) {
+  size_t start = events_offset_;
+  while (HasPendingEvents()) {
+    struct inotify_event event;
+    memcpy(&event, events_.data() + events_offset_, sizeof(event));
+    size_t event_len = sizeof(struct inotify_event) + event.len;
+    if (count - (events_offset_ - start) < event_len) {
+      break;
     }
-    memcpy(buf_ptr, front_event, front_event_len);
-    buf_ptr += front_event_len;
-    num_bytes_written += front_event_len;
-    count -= front_event_len;
-    asylo::MallocUniquePtr<struct inotify_event> ev_ptr(front_event);
-    event_queue_.pop();
+    events_offset_ += event_len;
+  }
+  size_t num_bytes_written = events_offset_ - start;
+  if (num_bytes_written > 0) {
+    memcpy(buf_ptr, events_.data() + start, num_bytes_written);
   }
   return num_bytes_written;
 }
 
-ssize_t IOContextInotify::Read(void *buf, size_t count) {
-  // Remove events from queue, if there are any.
-  char *buf_ptr = static_cast<char *>(buf);
-  size_t num_bytes_written = TransferFromQueueToBuffer(buf_ptr, count);
-  buf_ptr += num_bytes_written;
-  count -= num_bytes_written;
-  // Check if the buffer was too small.
-  if (!event_queue_.empty() && (num_bytes_written == 0)) {
-    errno = EINVAL;
-    return -1;
-  } else if (!event_queue_.empty() || count == 0) {
-    // No need to read events from the host if the queue is not empty.
-    return num_bytes_written;
+bool IOContextInotify::ReadEventBatch() {
+  if (!untrusted_events_) {
+    untrusted_events_ = static_cast<char *>(
+        TrustedPrimitives::UntrustedLocalAlloc(kEventBatchSize));
+    if (!untrusted_events_) {
+      errno = ENOMEM;
+      return false;
+    }
+    events_.reserve(kEventBatchSize);
   }
-  // Read serialized events from the host, adjusting for space left in buffer.
-  char *serialized_events = nullptr;
-  size_t serialized_events_len = 0;
-  if (enc_untrusted_inotify_read(host_fd_, count, &serialized_events,
-                                 &serialized_events_len) < 0) {
-    // errno is set by enc_untrusted_inotify_read.
-    return -1;
+  ssize_t len = enc_untrusted_inotify_read_batch(host_fd_, untrusted_events_,
+                                                 kEventBatchSize);
+  if (len < 0) {
+    // errno is set by enc_untrusted_inotify_read_batch.
+    return false;
   }
-  asylo::MallocUniquePtr<char> serialized_events_ptr(serialized_events);
-  // Extract events back into the queue.
-  if (!asylo::host_call::DeserializeInotifyEvents(
-          serialized_events, serialized_events_len, &event_queue_)) {
+  // Copy the batch out of untrusted memory before validating it.
+  events_.resize(len);
+  memcpy(events_.data(), untrusted_events_, len);
+  events_offset_ = 0;
+  if (!asylo::host_call::FromkLinuxInotifyEvents(events_.data(),
+                                                 events_.size())) {
+    events_.clear();
     errno = EBADE;
-    return -1;
+    return false;
+  }
+  return true;
+}
+
+ssize_t IOContextInotify::Read(void *buf, size_t count) {
+  // Return events left from the last batch, if there are any.
+  char *buf_ptr = static_cast<char *>(buf);
+  size_t num_bytes_written = TransferEventsToBuffer(buf_ptr, count);
+  if (num_bytes_written == 0 && count > 0 && !HasPendingEvents()) {
+    // Read the next batch from the host.
+    if (!ReadEventBatch()) {
+      return -1;
+    }
+    num_bytes_written = TransferEventsToBuffer(buf_ptr, count);
   }
-  // Transfer events from the queue into the buffer again (as much as possible).
-  num_bytes_written += TransferFromQueueToBuffer(buf_ptr, count);
-  if (!event_queue_.empty() && (num_bytes_written == 0)) {
+  // Check if the buffer was too small.
+  if (num_bytes_written == 0 && HasPendingEvents()) {
     errno = EINVAL;
     return -1;
   }
@@ -21,15 +21,21 @@
 
 #include <sys/inotify.h>
 
-#include <queue>
+#include <vector>
+
 #include "asylo/platform/posix/io/io_manager.h"
 
 namespace asylo {
 namespace io {
-// IOContext implementation wrapping an epoll file descriptor
+// IOContext implementation wrapping an inotify file descriptor. The host reads
+// events in batches into a buffer kept in untrusted memory across reads, and
+// collapses duplicate events there. Each batch is copied into the enclave once
+// and handed out to readers without allocating memory per event.
 class IOContextInotify : public IOManager::IOContext {
  public:
-  explicit IOContextInotify(int host_fd) : host_fd_(host_fd) {}
+  explicit IOContextInotify(int host_fd)
+      : host_fd_(host_fd), untrusted_events_(nullptr), events_offset_(0) {}
+  ~IOContextInotify() override;
   // It's important to note that adding dup'd file descriptors here won't work
   // the same as it would in POSIX.
   int GetHostFileDescriptor() override;
@@ -40,10 +46,28 @@ class IOContextInotify : public IOManager::IOContext {
   int Close() override;
 
  private:
-  size_t TransferFromQueueToBuffer(char *buf_ptr, size_t count);
+  // Copies as many whole events as fit in |count| bytes from the current batch
+  // to |buf_ptr|, and returns the number of bytes copied.
+  size_t TransferEventsToBuffer(char *buf_ptr, size_t count);
+
+  // Reads the next batch of events from the host into |events_|. Returns false
+  // with errno set on failure.
+  bool ReadEventBatch();
+
+  // Returns true if events of the current batch have not been read yet.
+  bool HasPendingEvents() const { return events_offset_ < events_.size(); }
+
   // Host file descriptor implementing this stream.
   int host_fd_;
-  std::queue<struct inotify_event *> event_queue_;
+
+  // Buffer in untrusted memory the host reads batches of events into,
+  // allocated on the first read.
+  char *untrusted_events_;
+
+  // Trusted copy of the current batch of events in the enclave representation,
+  // and offset of the first event not read yet.
+  std::vector<char> events_;
+  size_t events_offset_;
 };
 
 }  // namespace io
@@ -0,0 +1,339 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "asylo/platform/posix/io/io_context_pipe.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "asylo/platform/posix/io/local_readiness.h"
+
+namespace asylo {
+namespace io {
+namespace {
+
+constexpr size_t kPageSize = 4096;
+
+// Default capacity of a pipe, as on Linux.
+constexpr size_t kDefaultCapacity = 16 * kPageSize;
+
+// Largest capacity F_SETPIPE_SZ accepts, the Linux default of
+// /proc/sys/fs/pipe-max-size.
+constexpr size_t kMaxCapacity = 1024 * 1024;
+
+constexpr int kReadEvents = POLLIN | POLLRDNORM;
+constexpr int kWriteEvents = POLLOUT | POLLWRNORM;
+
+}  // namespace
+
+// The buffer and state shared by the two ends of a pipe.
+class IOContextPipe::Channel {
+ public:
+  Channel()
+      : buffer_(kDefaultCapacity),
+        head_(0),
+        size_(0),
+        reader_open_(true),
+        writer_open_(true),
+        read_readiness_(0, kReadEvents | POLLHUP),
+        write_readiness_(kWriteEvents, kWriteEvents | POLLERR) {}
+
+  Channel(const Channel &other) = delete;
+  Channel &operator=(const Channel &other) = delete;
+
+  // Reads up to |count| bytes into |buf| as read(2) would.
+  ssize_t Read(void *buf, size_t count, bool nonblock) {
+    absl::MutexLock lock(&mu_);
+    auto readable = [this]() { return size_ > 0 || !writer_open_; };
+    if (!readable()) {
+      if (nonblock) {
+        errno = EAGAIN;
+        return -1;
+      }
+      mu_.Await(absl::Condition(&readable));
+    }
+    size_t length = std::min(count, size_);
+    char *data = static_cast<char *>(buf);
+    size_t first = std::min(length, buffer_.size() - head_);
+    memcpy(data, buffer_.data() + head_, first);
+    memcpy(data + first, buffer_.data(), length - first);
+    head_ = (head_ + length) % buffer_.size();
+    size_ -= length;
+    UpdateReadiness();
+    return length;
+  }
+
+  // Writes |count| bytes from |buf| as write(2) would. Writes of up to
+  // PIPE_BUF bytes are not interleaved with other writes.
+  ssize_t Write(const void *buf, size_t count, bool nonblock) {
+    const char *data = static_cast<const char *>(buf);
+    absl::MutexLock lock(&mu_);
+    size_t written = 0;
+    while (written < count) {
+      // Atomic writes wait for room for all of their data.
+      size_t needed = count <= PIPE_BUF ? count : 1;
+      auto writable = [this, needed]() {
+        return !reader_open_ || buffer_.size() - size_ >= needed;
+      };
+      if (!writable()) {
+        if (nonblock) {
+          if (written > 0) {
+            break;
+          }
+          errno = EAGAIN;
+          return -1;
+        }
+        mu_.Await(absl::Condition(&writable));
+      }
+      if (!reader_open_) {
+        if (written > 0) {
+          break;
+        }
+        errno = EPIPE;
+        return -1;
+      }
+      size_t length = std::min(count - written, buffer_.size() - size_);
+      size_t tail = (head_ + size_) % buffer_.size();
+      size_t first = std::min(length, buffer_.size() - tail);
+      memcpy(buffer_.data() + tail, data + written, first);
+      memcpy(buffer_.data(), data + written + first, length - first);
+      size_ += length;
+      written += length;
+      UpdateReadiness();
+    }
+    return written;
+  }
+
+  // Closes the read end if |read_end| is set, and the write end otherwise.
+  void CloseEnd(bool read_end) {
+    absl::MutexLock lock(&mu_);
+    if (read_end) {
+      reader_open_ = false;
+    } else {
+      writer_open_ = false;
+    }
+    UpdateReadiness();
+  }
+
+  size_t capacity() {
+    absl::MutexLock lock(&mu_);
+    return buffer_.size();
+  }
+
+  // Returns the number of bytes buffered.
+  size_t size() {
+    absl::MutexLock lock(&mu_);
+    return size_;
+  }
+
+  // Implements F_SETPIPE_SZ.
+  int SetCapacity(int64_t requested) {
+    if (requested < 0) {
+      errno = EINVAL;
+      return -1;
+    }
+    if (requested > static_cast<int64_t>(kMaxCapacity)) {
+      errno = EPERM;
+      return -1;
+    }
+    // Like Linux, round up to a power of two number of pages.
+    size_t capacity = kPageSize;
+    while (capacity < static_cast<size_t>(requested)) {
+      capacity *= 2;
+    }
+    absl::MutexLock lock(&mu_);
+    if (capacity < size_) {
+      errno = EBUSY;
+      return -1;
+    }
+    std::vector<char> buffer(capacity);
+    size_t first = std::min(size_, buffer_.size() - head_);
+    memcpy(buffer.data(), buffer_.data() + head_, first);
+    memcpy(buffer.data() + first, buffer_.data(), size_ - first);
+    buffer_ = std::move(buffer);
+    head_ = 0;
+    UpdateReadiness();
+    return capacity;
+  }
+
+  LocalReadiness *readiness(bool read_end) {
+    return read_end ? &read_readiness_ : &write_readiness_;
+  }
+
+ private:
+  // Publishes the events ready on each end.
+  void UpdateReadiness() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    int read_events = size_ > 0 ? kReadEvents : 0;
+    if (!writer_open_) {
+      read_events |= POLLHUP;
+    }
+    read_readiness_.Set(read_events);
+    // Like Linux, only report a pipe writable once an atomic write fits.
+    size_t room = buffer_.size() - size_;
+    int write_events = room >= std::min<size_t>(PIPE_BUF, buffer_.size())
+                           ? kWriteEvents
+                           : 0;
+    if (!reader_open_) {
+      write_events |= POLLERR;
+    }
+    write_readiness_.Set(write_events);
+  }
+
+  absl::Mutex mu_;
+  // Ring buffer holding |size_| bytes from |head_| on.
+  std::vector<char> buffer_ ABSL_GUARDED_BY(mu_);
+  size_t head_ ABSL_GUARDED_BY(mu_);
+  size_t size_ ABSL_GUARDED_BY(mu_);
+  bool reader_open_ ABSL_GUARDED_BY(mu_);
+  bool writer_open_ ABSL_GUARDED_BY(mu_);
+  LocalReadiness read_readiness_;
+  LocalReadiness write_readiness_;
+};
+
+void IOContextPipe::Create(int flags, std::unique_ptr<IOContextPipe> *read_end,
+                           std::unique_ptr<IOContextPipe> *write_end) {
+  auto channel = std::make_shared<Channel>();
+  read_end->reset(new IOContextPipe(channel, /*is_read_end=*/true, flags));
+  write_end->reset(
+      new IOContextPipe(std::move(channel), /*is_read_end=*/false, flags));
+}
+
+IOContextPipe::IOContextPipe(std::shared_ptr<Channel> channel,
+                             bool is_read_end, int flags)
+    : channel_(std::move(channel)),
+      is_read_end_(is_read_end),
+      nonblock_(flags & O_NONBLOCK),
+      cloexec_(flags & O_CLOEXEC) {}
+
+ssize_t IOContextPipe::Read(void *buf, size_t count) {
+  if (!is_read_end_) {
+    errno = EBADF;
+    return -1;
+  }
+  if (count == 0) {
+    return 0;
+  }
+  return channel_->Read(buf, count, nonblock_.load());
+}
+
+ssize_t IOContextPipe::Write(const void *buf, size_t count) {
+  if (is_read_end_) {
+    errno = EBADF;
+    return -1;
+  }
+  if (count == 0) {
+    return 0;
+  }
+  return channel_->Write(buf, count, nonblock_.load());
+}
+
+ssize_t IOContextPipe::Readv(const struct iovec *iov, int iovcnt) {
+  size_t total = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    total += iov[i].iov_len;
+  }
+  std::vector<char> data(total);
+  ssize_t ret = Read(data.data(), total);
+  if (ret <= 0) {
+    return ret;
+  }
+  size_t offset = 0;
+  for (int i = 0; i < iovcnt && offset < static_cast<size_t>(ret); ++i) {
+    size_t length = std::min(iov[i].iov_len, ret - offset);
+    memcpy(iov[i].iov_base, data.data() + offset, length);
+    offset += length;
+  }
+  return ret;
+}
+
+ssize_t IOContextPipe::Writev(const struct iovec *iov, int iovcnt) {
+  // Gathering the data first keeps small writev calls atomic.
+  std::vector<char> data;
+  for (int i = 0; i < iovcnt; ++i) {
+    const char *base = static_cast<const char *>(iov[i].iov_base);
+    data.insert(data.end(), base, base + iov[i].iov_len);
+  }
+  return Write(data.data(), data.size());
+}
+
+int IOContextPipe::Close() {
+  channel_->CloseEnd(is_read_end_);
+  return 0;
+}
+
+int IOContextPipe::FCntl(int cmd, int64_t arg) {
+  switch (cmd) {
+    case F_GETFD:
+      return cloexec_.load() ? FD_CLOEXEC : 0;
+    case F_SETFD:
+      cloexec_.store(arg & FD_CLOEXEC);
+      return 0;
+    case F_GETFL:
+      return (is_read_end_ ? O_RDONLY : O_WRONLY) |
+             (nonblock_.load() ? O_NONBLOCK : 0);
+    case F_SETFL:
+      nonblock_.store(arg & O_NONBLOCK);
+      return 0;
+    case F_GETPIPE_SZ:
+      return channel_->capacity();
+    case F_SETPIPE_SZ:
+      return channel_->SetCapacity(arg);
+    default:
+      errno = EINVAL;
+      return -1;
+  }
+}
+
+int IOContextPipe::FStat(struct stat *st) {
+  memset(st, 0, sizeof(*st));
+  st->st_mode = S_IFIFO | S_IRUSR | S_IWUSR;
+  st->st_nlink = 1;
+  st->st_blksize = kPageSize;
+  return 0;
+}
+
+int IOContextPipe::Ioctl(int request, void *argp) {
+  if (request != FIONREAD) {
+    errno = ENOTTY;
+    return -1;
+  }
+  *static_cast<int *>(argp) = channel_->size();
+  return 0;
+}
+
+int IOContextPipe::LocalEvents() {
+  return channel_->readiness(is_read_end_)->events();
+}
+
+int IOContextPipe::GetHostReadinessFileDescriptor() {
+  return channel_->readiness(is_read_end_)->GetHostFileDescriptor();
+}
+
+}  // namespace io
+}  // namespace asylo
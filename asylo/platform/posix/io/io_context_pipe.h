@@ -0,0 +1,76 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_POSIX_IO_IO_CONTEXT_PIPE_H_
+#define ASYLO_PLATFORM_POSIX_IO_IO_CONTEXT_PIPE_H_
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include "asylo/platform/posix/io/io_manager.h"
+
+namespace asylo {
+namespace io {
+
+// IOContext implementation of one end of a pipe whose two ends are in the
+// enclave. Data is held in a ring buffer in enclave memory and the readiness of
+// each end is tracked by LocalReadiness, so threads of the enclave signaling
+// each other through the pipe never exit the enclave.
+//
+// Writes of up to PIPE_BUF bytes are atomic, and the capacity can be changed
+// with F_SETPIPE_SZ, as for host pipes. Packet mode (O_DIRECT) is not
+// supported. Writing to a pipe without a reader fails with EPIPE without
+// raising SIGPIPE.
+class IOContextPipe : public IOManager::IOContext {
+ public:
+  // Creates the ends of a new pipe with pipe2(2) |flags|, which may only
+  // include O_CLOEXEC and O_NONBLOCK.
+  static void Create(int flags, std::unique_ptr<IOContextPipe> *read_end,
+                     std::unique_ptr<IOContextPipe> *write_end);
+
+  ssize_t Read(void *buf, size_t count) override;
+  ssize_t Write(const void *buf, size_t count) override;
+  ssize_t Readv(const struct iovec *iov, int iovcnt) override;
+  ssize_t Writev(const struct iovec *iov, int iovcnt) override;
+  int Close() override;
+  int FCntl(int cmd, int64_t arg) override;
+  int FStat(struct stat *st) override;
+  int Ioctl(int request, void *argp) override;
+  int LocalEvents() override;
+  int GetHostReadinessFileDescriptor() override;
+
+ private:
+  class Channel;
+
+  IOContextPipe(std::shared_ptr<Channel> channel, bool is_read_end, int flags);
+
+  std::shared_ptr<Channel> channel_;
+  const bool is_read_end_;
+  std::atomic<bool> nonblock_;
+  std::atomic<bool> cloexec_;
+};
+
+}  // namespace io
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_IO_IO_CONTEXT_PIPE_H_
@@ -21,18 +21,24 @@
 #include <fcntl.h>
 #include <poll.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <cstdint>
 #include <memory>
-#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "absl/algorithm/container.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "asylo/platform/common/enclave_trace.h"
 #include "asylo/platform/host_call/trusted/host_calls.h"
 #include "asylo/platform/posix/io/io_context_epoll.h"
 #include "asylo/platform/posix/io/io_context_eventfd.h"
 #include "asylo/platform/posix/io/io_context_inotify.h"
+#include "asylo/platform/posix/io/io_context_pipe.h"
+#include "asylo/platform/posix/io/local_readiness.h"
 #include "asylo/platform/posix/io/native_paths.h"
 #include "asylo/platform/posix/io/util.h"
 #include "asylo/util/posix_error_space.h"
@@ -41,27 +47,96 @@
 namespace asylo {
 namespace io {
 
+IOManager::FileDescriptorTable::Segment::Segment() : used(0) {
+  for (auto &slot : slots) {
+    slot.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
 IOManager::FileDescriptorTable::FileDescriptorTable()
-    : maximum_fd_soft_limit(kMaxOpenFiles),
-      maximum_fd_hard_limit(kMaxOpenFiles) {}
+    : generation_(0),
+      maximum_fd_soft_limit(kMaxOpenFiles),
+      maximum_fd_hard_limit(kMaxFileDescriptors) {
+  for (auto &segment : segments_) {
+    segment.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+IOManager::FileDescriptorTable::~FileDescriptorTable() {
+  for (auto &segment_pointer : segments_) {
+    Segment *segment = segment_pointer.load(std::memory_order_relaxed);
+    if (!segment) continue;
+    for (auto &slot : segment->slots) {
+      delete slot.load(std::memory_order_relaxed);
+    }
+    delete segment;
+  }
+}
 
 std::shared_ptr<IOManager::IOContext> IOManager::FileDescriptorTable::Get(
     int fd) {
-  if (!IsFileDescriptorValid(fd) || !fd_table_[fd]) return nullptr;
-  return fd_table_[fd]->Get();
+  if (!IsFileDescriptorValid(fd)) return nullptr;
+  Segment *segment =
+      segments_[fd / kSegmentSize].load(std::memory_order_acquire);
+  if (!segment) return nullptr;
+  ReadEpoch::Reader reader(&read_epoch_);
+  std::shared_ptr<AutoCloseIOContext> *entry =
+      segment->slots[fd % kSegmentSize].load(std::memory_order_acquire);
+  return entry ? (*entry)->Get() : nullptr;
+}
+
+std::shared_ptr<void> IOManager::FileDescriptorTable::Pin(
+    int fd, std::shared_ptr<IOContext> *context) {
+  if (!IsFileDescriptorValid(fd)) return nullptr;
+  Segment *segment =
+      segments_[fd / kSegmentSize].load(std::memory_order_acquire);
+  if (!segment) return nullptr;
+  ReadEpoch::Reader reader(&read_epoch_);
+  std::shared_ptr<AutoCloseIOContext> *entry =
+      segment->slots[fd % kSegmentSize].load(std::memory_order_acquire);
+  if (!entry) return nullptr;
+  *context = (*entry)->Get();
+  return *entry;
 }
 
 int IOManager::FileDescriptorTable::Delete(int fd) {
   if (!IsFileDescriptorValid(fd)) return 0;
+  Segment *segment =
+      segments_[fd / kSegmentSize].load(std::memory_order_relaxed);
+  if (!segment) return 0;
+  std::shared_ptr<AutoCloseIOContext> *entry =
+      segment->slots[fd % kSegmentSize].exchange(nullptr,
+                                                 std::memory_order_seq_cst);
+  if (!entry) return 0;
+  segment->used--;
+  generation_.fetch_add(1, std::memory_order_release);
   int close_result = 0;
-  fd_table_[fd]->WriteCloseResultTo(&close_result);
-  fd_table_[fd] = nullptr;
+  (*entry)->WriteCloseResultTo(&close_result);
+  // Wait for concurrent readers of the slot, then drop this reference, which
+  // closes the context if this was its last file descriptor.
+  read_epoch_.Synchronize();
+  delete entry;
   return close_result;
 }
 
 bool IOManager::FileDescriptorTable::IsFileDescriptorUnused(int fd) {
   if (!IsFileDescriptorValid(fd)) return false;
-  return !fd_table_[fd];
+  return !Slot(fd);
+}
+
+void IOManager::FileDescriptorTable::Publish(
+    int fd, std::shared_ptr<AutoCloseIOContext> entry) {
+  auto &segment_pointer = segments_[fd / kSegmentSize];
+  Segment *segment = segment_pointer.load(std::memory_order_relaxed);
+  if (!segment) {
+    segment = new Segment;
+    segment_pointer.store(segment, std::memory_order_release);
+  }
+  segment->slots[fd % kSegmentSize].store(
+      new std::shared_ptr<AutoCloseIOContext>(std::move(entry)),
+      std::memory_order_release);
+  segment->used++;
+  generation_.fetch_add(1, std::memory_order_release);
 }
 
 int IOManager::FileDescriptorTable::Insert(IOContext *context) {
@@ -69,26 +144,26 @@ int IOManager::FileDescriptorTable::Insert(IOContext *context) {
   if (fd < 0) {
     return -1;
   }
-  fd_table_[fd] = std::make_shared<AutoCloseIOContext>(context);
+  Publish(fd, std::make_shared<AutoCloseIOContext>(context));
   return fd;
 }
 
 int IOManager::FileDescriptorTable::CopyFileDescriptor(int oldfd, int startfd) {
   int newfd = GetNextFreeFileDescriptor(startfd);
-  if (!IsFileDescriptorValid(oldfd) || newfd == -1) {
+  if (!IsFileDescriptorValid(oldfd) || !Slot(oldfd) || newfd == -1) {
     return -1;
   }
-  fd_table_[newfd] = fd_table_[oldfd];
+  Publish(newfd, *Slot(oldfd));
   return newfd;
 }
 
 int IOManager::FileDescriptorTable::CopyFileDescriptorToSpecifiedTarget(
     int oldfd, int newfd) {
   if (!IsFileDescriptorValid(oldfd) || !IsFileDescriptorValid(newfd) ||
-      fd_table_[newfd]) {
+      !Slot(oldfd) || Slot(newfd)) {
     return -1;
   }
-  fd_table_[newfd] = fd_table_[oldfd];
+  Publish(newfd, *Slot(oldfd));
   return newfd;
 }
 
@@ -100,7 +175,8 @@ bool IOManager::FileDescriptorTable::SetFileDescriptorLimits(
     errno = EINVAL;
     return false;
   }
-  if (rlim->rlim_cur > rlim->rlim_max || rlim->rlim_max > kMaxOpenFiles ||
+  if (rlim->rlim_cur > rlim->rlim_max ||
+      rlim->rlim_max > kMaxFileDescriptors ||
       rlim->rlim_max > maximum_fd_hard_limit) {
     errno = EPERM;
     return false;
@@ -119,13 +195,17 @@ int IOManager::FileDescriptorTable::get_maximum_fd_hard_limit() {
 }
 
 bool IOManager::FileDescriptorTable::IsFileDescriptorValid(int fd) {
-  return fd >= 0 && fd < kMaxOpenFiles;
+  return fd >= 0 && fd < kMaxFileDescriptors;
 }
 
 int IOManager::FileDescriptorTable::GetHighestFileDescriptorUsed() {
-  for (int i = kMaxOpenFiles - 1; i >= 0; --i) {
-    if (fd_table_[i]) {
-      return i;
+  for (int i = kNumSegments - 1; i >= 0; --i) {
+    Segment *segment = segments_[i].load(std::memory_order_relaxed);
+    if (!segment || segment->used == 0) continue;
+    for (int j = kSegmentSize - 1; j >= 0; --j) {
+      if (segment->slots[j].load(std::memory_order_relaxed)) {
+        return i * kSegmentSize + j;
+      }
     }
   }
   return -1;
@@ -135,14 +215,23 @@ int IOManager::FileDescriptorTable::GetNextFreeFileDescriptor(int startfd) {
   if (startfd < 0) {
     return -1;
   }
-  int fd = -1;
-  for (int i = startfd; i < maximum_fd_soft_limit; ++i) {
-    if (!fd_table_[i]) {
-      fd = i;
-      break;
+  int fd = startfd;
+  while (fd < maximum_fd_soft_limit) {
+    Segment *segment =
+        segments_[fd / kSegmentSize].load(std::memory_order_relaxed);
+    if (!segment || !segment->slots[fd % kSegmentSize].load(
+                        std::memory_order_relaxed)) {
+      return fd;
+    }
+    if (segment->used == kSegmentSize) {
+      // Skip full segments, so that finding a free descriptor does not scan
+      // every open descriptor.
+      fd = (fd / kSegmentSize + 1) * kSegmentSize;
+    } else {
+      ++fd;
     }
   }
-  return fd;
+  return -1;
 }
 
 int IOManager::Access(const char *path, int mode) {
@@ -269,6 +358,10 @@ int IOManager::Dup2(int oldfd, int newfd) {
 }
 
 int IOManager::Pipe(int pipefd[2], int flags) {
+  if (local_pipes_enabled_.load(std::memory_order_acquire) &&
+      !(flags & O_DIRECT)) {
+    return LocalPipe(pipefd, flags);
+  }
   int res = enc_untrusted_pipe2(pipefd, flags);
   if (res != -1) {
     pipefd[0] = RegisterHostFileDescriptor(pipefd[0]);
@@ -281,6 +374,34 @@ int IOManager::Pipe(int pipefd[2], int flags) {
   return res;
 }
 
+int IOManager::LocalPipe(int pipefd[2], int flags) {
+  if (flags & ~(O_CLOEXEC | O_NONBLOCK)) {
+    errno = EINVAL;
+    return -1;
+  }
+  std::unique_ptr<IOContextPipe> read_end;
+  std::unique_ptr<IOContextPipe> write_end;
+  IOContextPipe::Create(flags, &read_end, &write_end);
+  local_contexts_created_.store(true, std::memory_order_release);
+  absl::WriterMutexLock lock(&fd_table_lock_);
+  int read_fd = fd_table_.Insert(read_end.get());
+  if (read_fd < 0) {
+    errno = EMFILE;
+    return -1;
+  }
+  read_end.release();
+  int write_fd = fd_table_.Insert(write_end.get());
+  if (write_fd < 0) {
+    fd_table_.Delete(read_fd);
+    errno = EMFILE;
+    return -1;
+  }
+  write_end.release();
+  pipefd[0] = read_fd;
+  pipefd[1] = write_fd;
+  return 0;
+}
+
 int IOManager::Select(int nfds, fd_set *readfds, fd_set *writefds,
                       fd_set *exceptfds, struct timeval *timeout) {
   if (nfds < 0) {
@@ -288,120 +409,373 @@ int IOManager::Select(int nfds, fd_set *readfds, fd_set *writefds,
     return -1;
   }
 
-  // Translate the fd_sets into host file descriptors.
+  // Translate the fd_sets into host file descriptors, looking up each enclave
+  // file descriptor once and remembering its host file descriptor for mapping
+  // the results back.
+  nfds = std::min(nfds, FD_SETSIZE);
+  int host_fds[FD_SETSIZE];
   fd_set host_readfds, host_writefds, host_exceptfds;
   FD_ZERO(&host_readfds);
   FD_ZERO(&host_writefds);
   FD_ZERO(&host_exceptfds);
 
+  // File descriptors with staged input are readable without the host knowing,
+  // in which case the host is only checked for events without waiting.
+  std::vector<int> staged_readfds;
+  // Enclave-local file descriptors are answered from enclave memory. The host
+  // only sees their host readiness file descriptors, and only if host file
+  // descriptors are waited for too.
+  std::vector<std::pair<int, std::shared_ptr<IOContext>>> local;
   int host_nfds = 0;
   for (int fd = 0; fd < nfds; ++fd) {
-    if (readfds && FD_ISSET(fd, readfds)) {
-      std::shared_ptr<IOContext> context = fd_table_.Get(fd);
-      if (context) {
-        int host_fd = context->GetHostFileDescriptor();
-        FD_SET(host_fd, &host_readfds);
-        host_nfds = std::max(host_nfds, host_fd + 1);
-      }
+    host_fds[fd] = -1;
+    bool read = readfds && FD_ISSET(fd, readfds);
+    bool write = writefds && FD_ISSET(fd, writefds);
+    bool except = exceptfds && FD_ISSET(fd, exceptfds);
+    if (!read && !write && !except) continue;
+
+    std::shared_ptr<IOContext> context = fd_table_.Get(fd);
+    if (!context) continue;
+    if (context->LocalEvents() >= 0) {
+      local.emplace_back(fd, std::move(context));
+      continue;
+    }
+    int host_fd = context->GetHostFileDescriptor();
+    if (host_fd < 0) continue;
+    host_fds[fd] = host_fd;
+    if (read && context->HasStagedInput()) {
+      staged_readfds.push_back(fd);
     }
-    if (writefds && FD_ISSET(fd, writefds)) {
-      std::shared_ptr<IOContext> context = fd_table_.Get(fd);
-      if (context) {
-        int host_fd = context->GetHostFileDescriptor();
-        FD_SET(host_fd, &host_writefds);
-        host_nfds = std::max(host_nfds, host_fd + 1);
+    if (read) FD_SET(host_fd, &host_readfds);
+    if (write) FD_SET(host_fd, &host_writefds);
+    if (except) FD_SET(host_fd, &host_exceptfds);
+    host_nfds = std::max(host_nfds, host_fd + 1);
+  }
+  fd_set enclave_readfds, enclave_writefds, enclave_exceptfds;
+  FD_ZERO(&enclave_readfds);
+  FD_ZERO(&enclave_writefds);
+  FD_ZERO(&enclave_exceptfds);
+
+  // Marks the enclave-local file descriptors which are ready in the enclave
+  // sets, returning how many bits were set.
+  auto report_local = [&]() {
+    int ready = 0;
+    for (const auto &entry : local) {
+      int fd = entry.first;
+      int events = entry.second->LocalEvents();
+      if (readfds && FD_ISSET(fd, readfds) &&
+          (events & (POLLIN | POLLHUP | POLLERR))) {
+        FD_SET(fd, &enclave_readfds);
+        ready++;
+      }
+      if (writefds && FD_ISSET(fd, writefds) &&
+          (events & (POLLOUT | POLLERR))) {
+        FD_SET(fd, &enclave_writefds);
+        ready++;
+      }
+      if (exceptfds && FD_ISSET(fd, exceptfds) && (events & POLLPRI)) {
+        FD_SET(fd, &enclave_exceptfds);
+        ready++;
       }
     }
-    if (exceptfds && FD_ISSET(fd, exceptfds)) {
-      std::shared_ptr<IOContext> context = fd_table_.Get(fd);
-      if (context) {
-        int host_fd = context->GetHostFileDescriptor();
-        FD_SET(host_fd, &host_exceptfds);
-        host_nfds = std::max(host_nfds, host_fd + 1);
+    return ready;
+  };
+
+  struct timeval no_wait = {0, 0};
+  bool wait = staged_readfds.empty();
+  if (!local.empty()) {
+    if (host_nfds == 0 && wait) {
+      absl::Time deadline = absl::InfiniteFuture();
+      if (timeout) {
+        deadline = absl::Now() + absl::DurationFromTimeval(*timeout);
+      }
+      int ready;
+      while (true) {
+        uint64_t generation = LocalReadiness::Generation();
+        ready = report_local();
+        if (ready > 0 ||
+            !LocalReadiness::WaitForChange(generation, deadline)) {
+          break;
+        }
       }
+      if (readfds) *readfds = enclave_readfds;
+      if (writefds) *writefds = enclave_writefds;
+      if (exceptfds) *exceptfds = enclave_exceptfds;
+      return ready;
+    }
+    for (const auto &entry : local) {
+      int host_fd = entry.second->GetHostReadinessFileDescriptor();
+      if (host_fd < 0) continue;
+      FD_SET(host_fd, &host_readfds);
+      host_nfds = std::max(host_nfds, host_fd + 1);
+    }
+    if (report_local() > 0) {
+      wait = false;
+      FD_ZERO(&enclave_readfds);
+      FD_ZERO(&enclave_writefds);
+      FD_ZERO(&enclave_exceptfds);
     }
   }
+
   int ret = enc_untrusted_select(host_nfds, &host_readfds, &host_writefds,
-                                 &host_exceptfds, timeout);
+                                 &host_exceptfds, wait ? timeout : &no_wait);
 
   // On error, errno should have been set by the host.
   if (ret < 0) {
     return ret;
   }
 
-  // Add the returned fd_sets into an unordered set. IOManager is used in
-  // trusted contexts where system calls might not be available; avoid using
-  // absl based containers which may perform system calls.
-  std::unordered_set<int> host_readfds_set, host_writefds_set,
-      host_exceptfds_set;
+  // Report each requested enclave file descriptor whose host file descriptor is
+  // included in the corresponding returned set.
+  ret = 0;
   for (int fd = 0; fd < nfds; ++fd) {
-    std::shared_ptr<IOContext> context = fd_table_.Get(fd);
-    if (context) {
-      int host_fd = context->GetHostFileDescriptor();
-      if (host_fd < 0) continue;
-      if (FD_ISSET(host_fd, &host_readfds)) {
-        host_readfds_set.insert(host_fd);
-      }
-      if (FD_ISSET(host_fd, &host_writefds)) {
-        host_writefds_set.insert(host_fd);
-      }
-      if (FD_ISSET(host_fd, &host_exceptfds)) {
-        host_exceptfds_set.insert(host_fd);
-      }
+    int host_fd = host_fds[fd];
+    if (host_fd < 0) continue;
+    if (readfds && FD_ISSET(fd, readfds) && FD_ISSET(host_fd, &host_readfds)) {
+      FD_SET(fd, &enclave_readfds);
+      ret++;
+    }
+    if (writefds && FD_ISSET(fd, writefds) &&
+        FD_ISSET(host_fd, &host_writefds)) {
+      FD_SET(fd, &enclave_writefds);
+      ret++;
+    }
+    if (exceptfds && FD_ISSET(fd, exceptfds) &&
+        FD_ISSET(host_fd, &host_exceptfds)) {
+      FD_SET(fd, &enclave_exceptfds);
+      ret++;
     }
   }
-
+  for (int fd : staged_readfds) {
+    if (!FD_ISSET(fd, &enclave_readfds)) {
+      FD_SET(fd, &enclave_readfds);
+      ret++;
+    }
+  }
+  ret += report_local();
   if (readfds) {
-    FD_ZERO(readfds);
+    *readfds = enclave_readfds;
   }
   if (writefds) {
-    FD_ZERO(writefds);
+    *writefds = enclave_writefds;
   }
   if (exceptfds) {
-    FD_ZERO(exceptfds);
+    *exceptfds = enclave_exceptfds;
   }
-  // Go through the file descriptor table, if any host file descriptor is
-  // included in any of the sets, add the corresponding enclave fd to the
-  // enclave fd_set.
-  for (int fd = 0; fd < nfds; ++fd) {
-    std::shared_ptr<IOContext> context = fd_table_.Get(fd);
-    if (context) {
-      int host_fd = context->GetHostFileDescriptor();
-      if (readfds && host_readfds_set.find(host_fd) != host_readfds_set.end()) {
-        FD_SET(fd, readfds);
-      }
-      if (writefds &&
-          host_writefds_set.find(host_fd) != host_writefds_set.end()) {
-        FD_SET(fd, writefds);
-      }
-      if (exceptfds &&
-          host_exceptfds_set.find(host_fd) != host_exceptfds_set.end()) {
-        FD_SET(fd, exceptfds);
-      }
+  return ret;
+}
+
+namespace {
+
+// Reports the entries of |fds| at indices |staged|, whose file descriptors have
+// input staged in enclave memory, as readable, on top of the events reported
+// by the host.
+void ReportStagedReads(struct pollfd *fds, const std::vector<nfds_t> &staged) {
+  for (nfds_t i : staged) {
+    fds[i].revents |= fds[i].events & (POLLIN | POLLRDNORM);
+  }
+}
+
+// Returns the number of entries of |fds| with events.
+int CountReady(const struct pollfd *fds, nfds_t nfds) {
+  int ready = 0;
+  for (nfds_t i = 0; i < nfds; ++i) {
+    if (fds[i].revents != 0) {
+      ready++;
     }
   }
-  return ret;
+  return ready;
 }
 
+}  // namespace
+
 int IOManager::Poll(struct pollfd *fds, nfds_t nfds, int timeout) {
-  std::vector<int> enclave_fd(nfds);
-  {
-    absl::ReaderMutexLock lock(&fd_table_lock_);
+  // Enclave-local file descriptors are answered from enclave memory. The host
+  // only sees their host readiness file descriptors, and only if host file
+  // descriptors are polled too.
+  std::vector<LocalEntry> local;
+  if (local_contexts_created_.load(std::memory_order_acquire)) {
+    bool needs_host = false;
+    local = FindLocalEntries(fds, nfds, &needs_host);
+    if (!needs_host) {
+      return PollLocal(fds, local, timeout);
+    }
+    if (ReportLocalEvents(fds, local) > 0) {
+      timeout = 0;
+    }
+  }
+  std::vector<bool> is_local(local.empty() ? 0 : nfds, false);
+  for (const LocalEntry &entry : local) {
+    is_local[entry.index] = true;
+  }
+
+  // File descriptors with staged input are readable without the host knowing,
+  // in which case the host is only checked for events without waiting.
+  std::vector<nfds_t> staged = FindStagedReads(fds, nfds);
+  if (!staged.empty()) {
+    timeout = 0;
+  }
+  auto report_enclave_events = [&](int ret) {
+    if (ret < 0 || (staged.empty() && local.empty())) {
+      return ret;
+    }
+    ReportStagedReads(fds, staged);
+    ReportLocalEvents(fds, local);
+    return CountReady(fds, nfds);
+  };
+
+  std::unique_ptr<CachedPollSet> cached = AcquirePollSet();
+  host_call::PollSet *poll_set = &cached->poll_set;
+  if (!poll_set->Resize(nfds)) {
+    // Fall back to translating all file descriptors in place if no untrusted
+    // memory is left for the poll set.
+    ReleasePollSet(std::move(cached));
+    std::vector<int> enclave_fd(nfds);
+    std::vector<short> enclave_events(nfds);
     for (int i = 0; i < nfds; ++i) {
       enclave_fd[i] = fds[i].fd;
+      enclave_events[i] = fds[i].events;
       std::shared_ptr<IOContext> context = fd_table_.Get(enclave_fd[i]);
-      if (context) {
-        fds[i].fd = context->GetHostFileDescriptor();
-      } else {
-        fds[i].fd = -1;
+      fds[i].fd = context ? GetPollFileDescriptor(context.get()) : -1;
+      if (!is_local.empty() && is_local[i]) {
+        fds[i].events = POLLIN;
       }
     }
+    int ret = enc_untrusted_poll(fds, nfds, timeout);
+    for (int i = 0; i < nfds; ++i) {
+      fds[i].fd = enclave_fd[i];
+      fds[i].events = enclave_events[i];
+    }
+    return report_enclave_events(ret);
   }
-  int ret = enc_untrusted_poll(fds, nfds, timeout);
+
+  // Only translate the file descriptors which changed, unless the file
+  // descriptor table changed since the cached translations were made.
+  uint64_t generation = fd_table_.generation();
+  bool retranslate = generation != cached->generation;
+  cached->generation = generation;
+  cached->enclave_fds.resize(nfds, -1);
   for (int i = 0; i < nfds; ++i) {
-    fds[i].fd = enclave_fd[i];
+    int host_fd = poll_set->host_fd(i);
+    if (retranslate || fds[i].fd != cached->enclave_fds[i]) {
+      cached->enclave_fds[i] = fds[i].fd;
+      std::shared_ptr<IOContext> context = fd_table_.Get(fds[i].fd);
+      host_fd = context ? GetPollFileDescriptor(context.get()) : -1;
+    }
+    bool local_entry = !is_local.empty() && is_local[i];
+    poll_set->Set(i, host_fd, local_entry ? POLLIN : fds[i].events);
   }
-  return ret;
+
+  int ret = poll_set->Poll(timeout);
+  if (ret >= 0) {
+    for (int i = 0; i < nfds; ++i) {
+      fds[i].revents = poll_set->revents(i);
+    }
+  }
+  ReleasePollSet(std::move(cached));
+  return report_enclave_events(ret);
+}
+
+std::vector<IOManager::LocalEntry> IOManager::FindLocalEntries(
+    struct pollfd *fds, nfds_t nfds, bool *needs_host) {
+  std::vector<LocalEntry> local;
+  *needs_host = false;
+  for (nfds_t i = 0; i < nfds; ++i) {
+    fds[i].revents = 0;
+    std::shared_ptr<IOContext> context = fd_table_.Get(fds[i].fd);
+    if (!context) {
+      continue;
+    }
+    if (context->LocalEvents() >= 0) {
+      local.push_back({i, std::move(context)});
+    } else {
+      *needs_host = true;
+    }
+  }
+  return local;
+}
+
+int IOManager::ReportLocalEvents(struct pollfd *fds,
+                                 const std::vector<LocalEntry> &local) {
+  int ready = 0;
+  for (const LocalEntry &entry : local) {
+    struct pollfd *pollfd = &fds[entry.index];
+    pollfd->revents =
+        entry.context->LocalEvents() & (pollfd->events | POLLERR | POLLHUP);
+    if (pollfd->revents != 0) {
+      ready++;
+    }
+  }
+  return ready;
+}
+
+int IOManager::PollLocal(struct pollfd *fds,
+                         const std::vector<LocalEntry> &local, int timeout) {
+  absl::Time deadline = timeout < 0
+                            ? absl::InfiniteFuture()
+                            : absl::Now() + absl::Milliseconds(timeout);
+  while (true) {
+    uint64_t generation = LocalReadiness::Generation();
+    int ready = ReportLocalEvents(fds, local);
+    if (ready > 0 || !LocalReadiness::WaitForChange(generation, deadline)) {
+      return ready;
+    }
+  }
+}
+
+int IOManager::GetPollFileDescriptor(IOContext *context) {
+  if (context->LocalEvents() >= 0) {
+    return context->GetHostReadinessFileDescriptor();
+  }
+  return context->GetHostFileDescriptor();
+}
+
+std::vector<nfds_t> IOManager::FindStagedReads(const struct pollfd *fds,
+                                               nfds_t nfds) {
+  std::vector<nfds_t> staged;
+  if (!input_staging_enabled_.load(std::memory_order_acquire)) {
+    return staged;
+  }
+  for (nfds_t i = 0; i < nfds; ++i) {
+    if ((fds[i].events & (POLLIN | POLLRDNORM)) && HasStagedReads(fds[i].fd)) {
+      staged.push_back(i);
+    }
+  }
+  return staged;
+}
+
+bool IOManager::HasStagedReads(int fd) {
+  if (!input_staging_enabled_.load(std::memory_order_acquire)) {
+    return false;
+  }
+  std::shared_ptr<IOContext> context = fd_table_.Get(fd);
+  return context && context->HasStagedInput();
+}
+
+std::unique_ptr<IOManager::CachedPollSet> IOManager::AcquirePollSet() {
+  {
+    absl::MutexLock lock(&poll_sets_lock_);
+    if (!idle_poll_sets_.empty()) {
+      std::unique_ptr<CachedPollSet> poll_set =
+          std::move(idle_poll_sets_.back());
+      idle_poll_sets_.pop_back();
+      return poll_set;
+    }
+  }
+  return absl::make_unique<CachedPollSet>();
+}
+
+void IOManager::ReleasePollSet(std::unique_ptr<CachedPollSet> poll_set) {
+  {
+    absl::MutexLock lock(&poll_sets_lock_);
+    if (idle_poll_sets_.size() < kMaxIdlePollSets) {
+      idle_poll_sets_.push_back(std::move(poll_set));
+      return;
+    }
+  }
+  // Freeing the untrusted memory of the poll set may exit the enclave, so the
+  // poll set is destroyed outside the lock.
+  poll_set.reset();
 }
 
 int IOManager::EpollCreate(int size) {
@@ -425,20 +799,16 @@ int IOManager::EpollCreate(int size) {
 }
 
 int IOManager::EpollCtl(int epfd, int op, int fd, struct epoll_event *event) {
-  std::shared_ptr<IOContext> context;
-  {
-    absl::ReaderMutexLock lock(&fd_table_lock_);
-    context = fd_table_.Get(fd);
-  }
-  int hostfd = context ? context->GetHostFileDescriptor() : -1;
+  std::shared_ptr<IOContext> context = fd_table_.Get(fd);
+  int hostfd = context ? GetPollFileDescriptor(context.get()) : -1;
   if (hostfd == -1) {
     errno = EBADF;
     return -1;
   }
-  return CallWithContext(
-      epfd, [op, hostfd, event](std::shared_ptr<IOContext> epoll_context) {
-        return epoll_context->EpollCtl(op, hostfd, event);
-      });
+  return CallWithContext(epfd, [op, hostfd, event, &context](
+                                   std::shared_ptr<IOContext> epoll_context) {
+    return epoll_context->EpollCtl(op, hostfd, event, context);
+  });
 }
 
 int IOManager::EpollWait(int epfd, struct epoll_event *events, int maxevents,
@@ -451,6 +821,7 @@ int IOManager::EpollWait(int epfd, struct epoll_event *events, int maxevents,
 
 int IOManager::EventFd(unsigned int initval, int flags) {
   auto context = ::absl::make_unique<IOContextEventFd>(initval, flags);
+  local_contexts_created_.store(true, std::memory_order_release);
   absl::WriterMutexLock lock(&fd_table_lock_);
   int fd = fd_table_.Insert(context.get());
   if (fd >= 0) {
@@ -498,6 +869,10 @@ int IOManager::InotifyRmWatch(int fd, int wd) {
 // Provide a proper error return value of different types for use in templates.
 namespace {
 
+// Size of the enclave buffer used by transfers between file descriptors which
+// cannot run on the host.
+constexpr size_t kTransferChunkSize = 64 * 1024;
+
 template <typename Type, typename = void>
 struct ErrorValue;
 
@@ -520,11 +895,7 @@ struct ErrorValue<Type,
 
 template <typename IOAction, typename ReturnType>
 ReturnType IOManager::CallWithContext(int fd, IOAction action) {
-  std::shared_ptr<IOContext> context;
-  {
-    absl::ReaderMutexLock lock(&fd_table_lock_);
-    context = fd_table_.Get(fd);
-  }
+  std::shared_ptr<IOContext> context = fd_table_.Get(fd);
   if (context) {
     return action(context);
   }
@@ -534,17 +905,17 @@ ReturnType IOManager::CallWithContext(int fd, IOAction action) {
 
 template <typename IOAction, typename ReturnType>
 ReturnType IOManager::CallWithHandler(const char *path, IOAction action) {
-  StatusOr<std::string> status = CanonicalizePath(path);
+  std::string canonical_path;
+  VirtualPathHandler *handler;
+  Status status = ResolvePath(path, &canonical_path, &handler);
   if (!status.ok()) {
-    errno = status.status().error_code();
+    errno = status.error_code();
     return ErrorValue<ReturnType>::value;
   }
 
-  absl::string_view canonical_path = status.ValueOrDie();
-  VirtualPathHandler *handler = HandlerForPath(canonical_path);
   if (handler) {
     // Invoke the path handler if one is installed.
-    return action(handler, canonical_path.data());
+    return action(handler, canonical_path.c_str());
   }
 
   errno = ENOENT;
@@ -554,21 +925,21 @@ ReturnType IOManager::CallWithHandler(const char *path, IOAction action) {
 template <typename IOAction, typename ReturnType>
 ReturnType IOManager::CallWithHandler(const char *path1, const char *path2,
                                       IOAction action) {
-  StatusOr<std::string> status1 = CanonicalizePath(path1);
-  if (!status1.ok()) {
-    errno = status1.status().error_code();
+  std::string canonical_path1;
+  VirtualPathHandler *handler1;
+  Status status = ResolvePath(path1, &canonical_path1, &handler1);
+  if (!status.ok()) {
+    errno = status.error_code();
     return ErrorValue<ReturnType>::value;
   }
-  StatusOr<std::string> status2 = CanonicalizePath(path2);
-  if (!status2.ok()) {
-    errno = status2.status().error_code();
+  std::string canonical_path2;
+  VirtualPathHandler *handler2;
+  status = ResolvePath(path2, &canonical_path2, &handler2);
+  if (!status.ok()) {
+    errno = status.error_code();
     return ErrorValue<ReturnType>::value;
   }
 
-  absl::string_view canonical_path1 = status1.ValueOrDie();
-  absl::string_view canonical_path2 = status2.ValueOrDie();
-  VirtualPathHandler *handler1 = HandlerForPath(canonical_path1);
-  VirtualPathHandler *handler2 = HandlerForPath(canonical_path2);
   if (handler1 != handler2) {
     errno = EXDEV;
     return ErrorValue<ReturnType>::value;
@@ -576,7 +947,7 @@ ReturnType IOManager::CallWithHandler(const char *path1, const char *path2,
 
   if (handler1) {
     // Invoke the path handler if one is installed.
-    return action(handler1, canonical_path1.data(), canonical_path2.data());
+    return action(handler1, canonical_path1.c_str(), canonical_path2.c_str());
   }
 
   errno = ENOENT;
@@ -584,9 +955,13 @@ ReturnType IOManager::CallWithHandler(const char *path1, const char *path2,
 }
 
 int IOManager::Read(int fd, char *buf, size_t count) {
-  return CallWithContext(fd, [buf, count](std::shared_ptr<IOContext> context) {
-    return context->Read(buf, count);
-  });
+  TraceEnclaveEvent(EnclaveTraceEvent::kIoReadBegin, fd, count);
+  int result =
+      CallWithContext(fd, [buf, count](std::shared_ptr<IOContext> context) {
+        return context->Read(buf, count);
+      });
+  TraceEnclaveEvent(EnclaveTraceEvent::kIoReadEnd, fd, result);
+  return result;
 }
 
 bool IOManager::RegisterVirtualPathHandler(
@@ -598,10 +973,14 @@ bool IOManager::RegisterVirtualPathHandler(
   }
 
   prefix_to_handler_.emplace(path_prefix, std::move(handler));
+  path_cache_.Invalidate();
   return true;
 }
 
 void IOManager::DeregisterVirtualPathHandler(const std::string &path_prefix) {
+  // Invalidate first, so that the cache holds no reference to the handler
+  // once it is destroyed.
+  path_cache_.Invalidate();
   prefix_to_handler_.erase(path_prefix);
 }
 
@@ -610,6 +989,7 @@ Status IOManager::SetCurrentWorkingDirectory(absl::string_view path) {
   Status status = working_directory.status();
   if (status.ok()) {
     current_working_directory_ = working_directory.ValueOrDie();
+    path_cache_.Invalidate();
   }
 
   return status;
@@ -666,10 +1046,32 @@ StatusOr<std::string> IOManager::CanonicalizePath(
   return ret;
 }
 
+Status IOManager::ResolvePath(absl::string_view path,
+                              std::string *canonical_path,
+                              VirtualPathHandler **handler) {
+  if (path_cache_.Lookup(path, canonical_path, handler)) {
+    return Status::OkStatus();
+  }
+  StatusOr<std::string> status = CanonicalizePath(path);
+  if (!status.ok()) {
+    return status.status();
+  }
+  *canonical_path = std::move(status).ValueOrDie();
+  *handler = HandlerForPath(*canonical_path);
+  if (*handler) {
+    path_cache_.Insert(path, *canonical_path, *handler);
+  }
+  return Status::OkStatus();
+}
+
 int IOManager::Write(int fd, const char *buf, size_t count) {
-  return CallWithContext(fd, [buf, count](std::shared_ptr<IOContext> context) {
-    return context->Write(buf, count);
-  });
+  TraceEnclaveEvent(EnclaveTraceEvent::kIoWriteBegin, fd, count);
+  int result =
+      CallWithContext(fd, [buf, count](std::shared_ptr<IOContext> context) {
+        return context->Write(buf, count);
+      });
+  TraceEnclaveEvent(EnclaveTraceEvent::kIoWriteEnd, fd, result);
+  return result;
 }
 
 int IOManager::Chown(const char *path, uid_t owner, gid_t group) {
@@ -973,6 +1375,166 @@ ssize_t IOManager::PRead(int fd, void *buf, size_t count, off_t offset) {
       });
 }
 
+ssize_t IOManager::PWrite(int fd, const void *buf, size_t count,
+                          off_t offset) {
+  struct iovec iov = {const_cast<void *>(buf), count};
+  return PWritev(fd, &iov, 1, offset);
+}
+
+ssize_t IOManager::PReadv(int fd, const struct iovec *iov, int iovcnt,
+                          off_t offset) {
+  if (offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  return PReadv2(fd, iov, iovcnt, offset, /*flags=*/0);
+}
+
+ssize_t IOManager::PWritev(int fd, const struct iovec *iov, int iovcnt,
+                           off_t offset) {
+  if (offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  return CallWithContext(
+      fd, [iov, iovcnt, offset](std::shared_ptr<IOContext> context) {
+        return context->PWritev(iov, iovcnt, offset);
+      });
+}
+
+ssize_t IOManager::PReadv2(int fd, const struct iovec *iov, int iovcnt,
+                           off_t offset, int flags) {
+  return CallWithContext(
+      fd, [iov, iovcnt, offset, flags](std::shared_ptr<IOContext> context) {
+        return context->PReadv(iov, iovcnt, offset, flags);
+      });
+}
+
+ssize_t IOManager::SendFile(int out_fd, int in_fd, off_t *offset,
+                            size_t count) {
+  return Transfer(in_fd, offset, out_fd, /*out_offset=*/nullptr, count,
+                  [offset, count](int host_in_fd, int host_out_fd) {
+                    return enc_untrusted_sendfile(host_out_fd, host_in_fd,
+                                                  offset, count);
+                  });
+}
+
+ssize_t IOManager::Splice(int fd_in, off_t *off_in, int fd_out,
+                          off_t *off_out, size_t len, unsigned int flags) {
+  // Splice flags are only hints, so they are dropped when the data is copied
+  // through the enclave.
+  return Transfer(fd_in, off_in, fd_out, off_out, len,
+                  [off_in, off_out, len, flags](int host_in_fd,
+                                                int host_out_fd) {
+                    return enc_untrusted_splice(host_in_fd, off_in,
+                                                host_out_fd, off_out, len,
+                                                flags);
+                  });
+}
+
+ssize_t IOManager::CopyFileRange(int fd_in, off_t *off_in, int fd_out,
+                                 off_t *off_out, size_t len,
+                                 unsigned int flags) {
+  if (flags != 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  return Transfer(fd_in, off_in, fd_out, off_out, len,
+                  [off_in, off_out, len](int host_in_fd, int host_out_fd) {
+                    return enc_untrusted_copy_file_range(
+                        host_in_fd, off_in, host_out_fd, off_out, len,
+                        /*flags=*/0);
+                  });
+}
+
+ssize_t IOManager::Transfer(
+    int in_fd, off_t *in_offset, int out_fd, off_t *out_offset, size_t count,
+    const std::function<ssize_t(int host_in_fd, int host_out_fd)>
+        &host_transfer) {
+  // The pins keep both host file descriptors open for the whole transfer, so
+  // that they cannot be reused for other files if closed meanwhile.
+  std::shared_ptr<IOContext> in, out;
+  std::shared_ptr<void> in_pin = fd_table_.Pin(in_fd, &in);
+  std::shared_ptr<void> out_pin = fd_table_.Pin(out_fd, &out);
+  if (!in_pin || !out_pin) {
+    errno = EBADF;
+    return -1;
+  }
+  if (in->HasPlainHostFileDescriptor() && out->HasPlainHostFileDescriptor()) {
+    return host_transfer(in->GetHostFileDescriptor(),
+                         out->GetHostFileDescriptor());
+  }
+  return CopyThroughEnclave(in.get(), in_offset, out.get(), out_offset, count);
+}
+
+ssize_t IOManager::CopyThroughEnclave(IOContext *in, off_t *in_offset,
+                                      IOContext *out, off_t *out_offset,
+                                      size_t count) {
+  // Explicit offsets are emulated by moving the file positions for the
+  // duration of the copy, and restoring them afterwards.
+  off_t in_position = 0;
+  if (in_offset) {
+    in_position = in->LSeek(0, SEEK_CUR);
+    if (in_position < 0 || in->LSeek(*in_offset, SEEK_SET) < 0) {
+      return -1;
+    }
+  }
+  off_t out_position = 0;
+  if (out_offset) {
+    out_position = out->LSeek(0, SEEK_CUR);
+    if (out_position < 0 || out->LSeek(*out_offset, SEEK_SET) < 0) {
+      if (in_offset) {
+        in->LSeek(in_position, SEEK_SET);
+      }
+      return -1;
+    }
+  }
+
+  std::vector<char> buffer(std::min(count, kTransferChunkSize));
+  size_t transferred = 0;
+  int error = 0;
+  while (transferred < count) {
+    ssize_t bytes_read =
+        in->Read(buffer.data(), std::min(buffer.size(), count - transferred));
+    if (bytes_read <= 0) {
+      error = bytes_read < 0 ? errno : 0;
+      break;
+    }
+    ssize_t bytes_written = 0;
+    while (bytes_written < bytes_read) {
+      ssize_t result = out->Write(buffer.data() + bytes_written,
+                                  bytes_read - bytes_written);
+      if (result <= 0) {
+        error = result < 0 ? errno : EIO;
+        break;
+      }
+      bytes_written += result;
+    }
+    transferred += bytes_written;
+    if (bytes_written < bytes_read) {
+      // Give back the bytes read but not written, where the input is seekable.
+      if (!in_offset) {
+        in->LSeek(bytes_written - bytes_read, SEEK_CUR);
+      }
+      break;
+    }
+  }
+
+  if (in_offset) {
+    in->LSeek(in_position, SEEK_SET);
+    *in_offset += transferred;
+  }
+  if (out_offset) {
+    out->LSeek(out_position, SEEK_SET);
+    *out_offset += transferred;
+  }
+  if (transferred == 0 && error != 0) {
+    errno = error;
+    return -1;
+  }
+  return transferred;
+}
+
 mode_t IOManager::Umask(mode_t mask) { return enc_untrusted_umask(mask); }
 
 int IOManager::GetRLimit(int resource, struct rlimit *rlim) {
@@ -1109,6 +1671,22 @@ ssize_t IOManager::RecvMsg(int sockfd, struct msghdr *msg, int flags) {
                          });
 }
 
+int IOManager::SendMmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen,
+                        int flags) {
+  return CallWithContext(
+      sockfd, [msgvec, vlen, flags](std::shared_ptr<IOContext> context) {
+        return context->SendMmsg(msgvec, vlen, flags);
+      });
+}
+
+int IOManager::RecvMmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen,
+                        int flags, struct timespec *timeout) {
+  return CallWithContext(sockfd, [msgvec, vlen, flags, timeout](
+                                     std::shared_ptr<IOContext> context) {
+    return context->RecvMmsg(msgvec, vlen, flags, timeout);
+  });
+}
+
 int IOManager::GetSockName(int sockfd, struct sockaddr *addr,
                            socklen_t *addrlen) {
   return CallWithContext(sockfd,
@@ -1133,6 +1711,90 @@ ssize_t IOManager::RecvFrom(int sockfd, void *buf, size_t len, int flags,
   });
 }
 
+int IOManager::SubmitAsyncIo(int fd, AsyncIoEngine::Operation operation,
+                             void *buf, size_t count, off_t offset, int flags,
+                             uint64_t user_data) {
+  std::shared_ptr<IOContext> context;
+  std::shared_ptr<void> pin = fd_table_.Pin(fd, &context);
+  if (!pin) {
+    errno = EBADF;
+    return -1;
+  }
+  if (!context->HasPlainHostFileDescriptor()) {
+    errno = ENOSYS;
+    return -1;
+  }
+  // The pin keeps the host file descriptor open, so that it cannot be reused
+  // for another file before the operation is submitted.
+  return async_io_.Submit(operation, context->GetHostFileDescriptor(), buf,
+                          count, offset, flags, user_data, std::move(pin));
+}
+
+int IOManager::AsyncRead(int fd, void *buf, size_t count, off_t offset,
+                         uint64_t user_data) {
+  return SubmitAsyncIo(fd, AsyncIoEngine::Operation::kRead, buf, count, offset,
+                       /*flags=*/0, user_data);
+}
+
+int IOManager::AsyncWrite(int fd, const void *buf, size_t count, off_t offset,
+                          uint64_t user_data) {
+  return SubmitAsyncIo(fd, AsyncIoEngine::Operation::kWrite,
+                       const_cast<void *>(buf), count, offset, /*flags=*/0,
+                       user_data);
+}
+
+int IOManager::AsyncSend(int sockfd, const void *buf, size_t len, int flags,
+                         uint64_t user_data) {
+  return SubmitAsyncIo(sockfd, AsyncIoEngine::Operation::kSend,
+                       const_cast<void *>(buf), len, /*offset=*/0, flags,
+                       user_data);
+}
+
+int IOManager::AsyncRecv(int sockfd, void *buf, size_t len, int flags,
+                         uint64_t user_data) {
+  return SubmitAsyncIo(sockfd, AsyncIoEngine::Operation::kRecv, buf, len,
+                       /*offset=*/0, flags, user_data);
+}
+
+int IOManager::PollAsyncIo(AsyncIoCompletion *completions,
+                           int max_completions, bool wait) {
+  return async_io_.Poll(completions, max_completions, wait);
+}
+
+int IOManager::EnableWriteBuffering(int fd, size_t capacity,
+                                    int64_t flush_interval_nanos) {
+  return CallWithContext(fd, [capacity, flush_interval_nanos](
+                                 std::shared_ptr<IOContext> context) {
+    return context->EnableWriteBuffering(capacity, flush_interval_nanos);
+  });
+}
+
+int IOManager::EnableReadBuffering(int fd, size_t capacity) {
+  int ret =
+      CallWithContext(fd, [capacity](std::shared_ptr<IOContext> context) {
+        return context->EnableReadBuffering(capacity);
+      });
+  if (ret == 0) {
+    input_staging_enabled_.store(true, std::memory_order_release);
+  }
+  return ret;
+}
+
+int IOManager::EnableAcceptBatching(int fd, int batch_size) {
+  int ret =
+      CallWithContext(fd, [batch_size](std::shared_ptr<IOContext> context) {
+        return context->EnableAcceptBatching(batch_size);
+      });
+  if (ret == 0) {
+    input_staging_enabled_.store(true, std::memory_order_release);
+  }
+  return ret;
+}
+
+void IOManager::EnableLocalPipes() {
+  local_pipes_enabled_.store(true, std::memory_order_release);
+}
+
 int IOManager::RegisterHostFileDescriptor(int host_fd) {
   absl::WriterMutexLock lock(&fd_table_lock_);
   auto context = ::absl::make_unique<IOContextNative>(host_fd);
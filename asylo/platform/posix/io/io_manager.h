@@ -38,11 +38,16 @@
 #include <memory>
 #include <queue>
 #include <type_traits>
+#include <vector>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
+#include "asylo/platform/host_call/trusted/poll_set.h"
+#include "asylo/platform/posix/io/async_io_engine.h"
+#include "asylo/platform/posix/io/path_cache.h"
+#include "asylo/platform/posix/io/read_epoch.h"
 #include "asylo/platform/storage/secure/enclave_storage_secure.h"
 #include "asylo/util/statusor.h"
 
@@ -53,10 +58,15 @@ namespace io {
 // mapping from "enclave file descriptors" to IOContext objects.
 class IOManager {
  public:
-  // The maximum number of virtual file descriptors which may be open at any one
-  // time.
+  // The default maximum number of virtual file descriptors which may be open
+  // at any one time. setrlimit(RLIMIT_NOFILE) may raise it up to
+  // kMaxFileDescriptors.
   static const constexpr int kMaxOpenFiles = 1024;
 
+  // The absolute maximum number of virtual file descriptors, which is the
+  // default hard limit of RLIMIT_NOFILE.
+  static const constexpr int kMaxFileDescriptors = 128 * 1024;
+
   // An IOContext object represents an abstract I/O stream. Different concrete
   // implementations might wrap a native file descriptor on the host, a virtual
   // device like "/dev/urandom" backed by software, or a secure stream with
@@ -144,6 +154,20 @@ class IOManager {
       return -1;
     }
 
+    // Reads into |iov| from |offset| with preadv2(2) |flags|, leaving the
+    // file offset unchanged unless |offset| is -1.
+    virtual ssize_t PReadv(const struct iovec *iov, int iovcnt, off_t offset,
+                           int flags) {
+      errno = ENOSYS;
+      return -1;
+    }
+
+    virtual ssize_t PWritev(const struct iovec *iov, int iovcnt,
+                            off_t offset) {
+      errno = ENOSYS;
+      return -1;
+    }
+
     virtual ssize_t FGetXattr(const char *name, void *value, size_t size) {
       errno = ENOSYS;
       return -1;
@@ -212,6 +236,17 @@ class IOManager {
       return -1;
     }
 
+    virtual int SendMmsg(struct mmsghdr *msgvec, unsigned int vlen, int flags) {
+      errno = ENOSYS;
+      return -1;
+    }
+
+    virtual int RecvMmsg(struct mmsghdr *msgvec, unsigned int vlen, int flags,
+                         struct timespec *timeout) {
+      errno = ENOSYS;
+      return -1;
+    }
+
     virtual int GetSockName(struct sockaddr *addr, socklen_t *addrlen) {
       errno = ENOSYS;
       return -1;
@@ -222,7 +257,10 @@ class IOManager {
       return -1;
     }
 
-    virtual int EpollCtl(int op, int hostfd, struct epoll_event *event) {
+    // Registers |target|, whose host file descriptor is |hostfd|, with this
+    // epoll instance according to |op|.
+    virtual int EpollCtl(int op, int hostfd, struct epoll_event *event,
+                         const std::shared_ptr<IOContext> &target) {
       // EINVAL since file descriptors do not by default support epoll behavior.
       errno = EINVAL;
       return -1;
@@ -253,7 +291,64 @@ class IOManager {
 
     virtual int GetHostFileDescriptor() { return -1; }
 
+    // Returns true if reads and writes on this context are plain, unbuffered
+    // reads and writes on its host file descriptor, in which case they may be
+    // run directly on the host file descriptor instead, for instance by the
+    // asynchronous I/O engine or by host-to-host transfers.
+    virtual bool HasPlainHostFileDescriptor() { return false; }
+
+    // Buffers writes to this context in enclave memory, see BufferedWriter.
+    // Writes to a terminal are flushed at each newline, other writes once
+    // |capacity| bytes are buffered or |flush_interval_nanos| elapsed. Must be
+    // called before the context is shared between threads.
+    virtual int EnableWriteBuffering(size_t capacity,
+                                     int64_t flush_interval_nanos) {
+      errno = ENOSYS;
+      return -1;
+    }
+
+    // Stages reads from this context in enclave memory, |capacity| bytes at a
+    // time, see BufferedReader. Must be called before the context is shared
+    // between threads or registered with an epoll instance.
+    virtual int EnableReadBuffering(size_t capacity) {
+      errno = ENOSYS;
+      return -1;
+    }
+
+    // Accepts connections on this listening socket |batch_size| at a time,
+    // queueing them in enclave memory, see AcceptQueue. Must be called before
+    // the context is shared between threads or registered with an epoll
+    // instance.
+    virtual int EnableAcceptBatching(int batch_size) {
+      errno = ENOSYS;
+      return -1;
+    }
+
+    // Returns true if input from this context may be staged in enclave memory,
+    // by EnableReadBuffering() or EnableAcceptBatching().
+    virtual bool StagesInput() { return false; }
+
+    // Returns true if input is staged in enclave memory. Poll(), Select() and
+    // EpollWait() report a context with staged input as readable, since the
+    // host cannot see that input.
+    virtual bool HasStagedInput() { return false; }
+
+    // Returns the poll(2) events ready on this context if it is implemented
+    // entirely in enclave memory, see LocalReadiness, or -1 if only the host
+    // knows its readiness. Poll(), Select() and EpollWait() report the events
+    // of enclave-local contexts without asking the host.
+    virtual int LocalEvents() { return -1; }
+
+    // Returns a host file descriptor which is readable while this
+    // enclave-local context is ready, for waiting on it together with host
+    // file descriptors, see LocalReadiness::GetHostFileDescriptor().
+    virtual int GetHostReadinessFileDescriptor() {
+      errno = EBADF;
+      return -1;
+    }
+
    private:
+    friend class IOContextEpoll;
     friend class IOManager;
     friend class NativePathHandler;
   };
@@ -393,16 +488,25 @@ class IOManager {
   };
 
   // A table of virtual file descriptors managed by the IOManager.
-  // This class is not thread safe. IOManager is responsible for locking the
-  // access to objects of this class.
+  // Get() may be called concurrently with any other method without locking.
+  // IOManager is responsible for serializing calls to all other methods.
   class FileDescriptorTable {
    public:
     FileDescriptorTable();
+    ~FileDescriptorTable();
+
+    FileDescriptorTable(const FileDescriptorTable &other) = delete;
+    FileDescriptorTable &operator=(const FileDescriptorTable &other) = delete;
 
     // Returns the IOContext associated with a file descriptor, or nullptr if
-    // no such context exists.
+    // no such context exists. Lock-free.
     std::shared_ptr<IOContext> Get(int fd);
 
+    // Like Get(), but also returns a reference which keeps the host resources
+    // behind |fd| open until it is released, even if |fd| is closed meanwhile.
+    // Lock-free.
+    std::shared_ptr<void> Pin(int fd, std::shared_ptr<IOContext> *context);
+
     // Removes an entry from the table, destroying the associated IOContext if
     // this is the last reference to the IOContext, and returns the file
     // descriptor to the free list. If close() is called on the host and that
@@ -435,6 +539,13 @@ class IOManager {
 
     bool SetFileDescriptorLimits(const struct rlimit *rlim);
 
+    // Returns a counter incremented every time a file descriptor is added to
+    // or removed from the table, so that callers can cache the contexts or
+    // host file descriptors of file descriptors until it changes. Lock-free.
+    uint64_t generation() const {
+      return generation_.load(std::memory_order_acquire);
+    }
+
     int get_maximum_fd_soft_limit();
 
     int get_maximum_fd_hard_limit();
@@ -491,7 +602,54 @@ class IOManager {
     // |startfd|. Returns -1 if there is no file descriptor available.
     int GetNextFreeFileDescriptor(int startfd);
 
-    std::array<std::shared_ptr<AutoCloseIOContext>, kMaxOpenFiles> fd_table_;
+    // Number of file descriptor slots in a segment of the table.
+    static constexpr int kSegmentSize = 1024;
+
+    // Number of segments needed to hold kMaxFileDescriptors slots.
+    static constexpr int kNumSegments = kMaxFileDescriptors / kSegmentSize;
+
+    static_assert(kMaxFileDescriptors % kSegmentSize == 0,
+                  "kMaxFileDescriptors must be a multiple of kSegmentSize");
+
+    // A fixed-size block of consecutive file descriptor slots. Each used slot
+    // points to its own heap-allocated reference to the AutoCloseIOContext of
+    // the file descriptor. Slots are read without locks, so an entry
+    // unpublished from a slot is only freed once |read_epoch_| guarantees that
+    // no reader still holds it.
+    struct Segment {
+      Segment();
+
+      std::atomic<std::shared_ptr<AutoCloseIOContext> *> slots[kSegmentSize];
+
+      // Number of used slots, only accessed by writers.
+      int used;
+    };
+
+    // Returns the file descriptor entry in slot |fd|, which must be valid, or
+    // nullptr if |fd| is unused. Only called by writers.
+    std::shared_ptr<AutoCloseIOContext> *Slot(int fd) {
+      Segment *segment =
+          segments_[fd / kSegmentSize].load(std::memory_order_relaxed);
+      return segment ? segment->slots[fd % kSegmentSize].load(
+                           std::memory_order_relaxed)
+                     : nullptr;
+    }
+
+    // Publishes |entry| in slot |fd|, which must be unused, allocating the
+    // segment of the slot if needed.
+    void Publish(int fd, std::shared_ptr<AutoCloseIOContext> entry);
+
+    // Segments of the table, allocated when a file descriptor in their range
+    // is first used and kept until the table is destroyed. Lookups are thus
+    // two dependent loads, and the table grows without moving any slot that a
+    // concurrent reader might be accessing.
+    std::array<std::atomic<Segment *>, kNumSegments> segments_;
+
+    // Tracks the readers of the segments.
+    ReadEpoch read_epoch_;
+
+    // Incremented after every change of a slot.
+    std::atomic<uint64_t> generation_;
 
     // The maximum file descriptor number allowed.
     int maximum_fd_soft_limit;
@@ -556,8 +714,10 @@ class IOManager {
   // combination of O_CLOEXEC, O_DIRECT, and O_NONBLOCK. The array |pipefd| is
   // used to return two file descriptors referring to the ends of the pipe.
   // |pipefd[0]| refers to the read end while |pipefd[1]| refers to the write
-  // end.
-  virtual int Pipe(int pipefd[2], int flags);
+  // end. Once EnableLocalPipes() was called, pipes without O_DIRECT are
+  // implemented in enclave memory, see IOContextPipe.
+  virtual int Pipe(int pipefd[2], int flags)
+      ABSL_LOCKS_EXCLUDED(fd_table_lock_);
 
   // Reads up to |count| bytes from the stream into |buf|, returning the number
   // of bytes read on success or -1 on error.
@@ -619,9 +779,10 @@ class IOManager {
   virtual int Select(int nfds, fd_set *readfds, fd_set *writefds,
                      fd_set *exceptfds, struct timeval *timeout);
 
-  // Implements poll(2).
-  virtual int Poll(struct pollfd *fds, nfds_t nfds, int timeout)
-      ABSL_LOCKS_EXCLUDED(fd_table_lock_);
+  // Implements poll(2). The host file descriptors polled are kept in a poll
+  // set across calls, so unchanged entries are neither translated nor copied
+  // to the host again.
+  virtual int Poll(struct pollfd *fds, nfds_t nfds, int timeout);
 
   // Implements epoll_create(2).
   virtual int EpollCreate(int size) ABSL_LOCKS_EXCLUDED(fd_table_lock_);
@@ -651,6 +812,38 @@ class IOManager {
   // Implements pread(2).
   virtual ssize_t PRead(int fd, void *buf, size_t count, off_t offset);
 
+  // Implements pwrite(2).
+  virtual ssize_t PWrite(int fd, const void *buf, size_t count, off_t offset);
+
+  // Implements preadv(2).
+  virtual ssize_t PReadv(int fd, const struct iovec *iov, int iovcnt,
+                         off_t offset);
+
+  // Implements pwritev(2).
+  virtual ssize_t PWritev(int fd, const struct iovec *iov, int iovcnt,
+                          off_t offset);
+
+  // Implements preadv2(2).
+  virtual ssize_t PReadv2(int fd, const struct iovec *iov, int iovcnt,
+                          off_t offset, int flags);
+
+  // Host-to-host transfers. When both file descriptors are backed by plain
+  // host file descriptors, the following calls run on the host and the data
+  // never enters the enclave. Otherwise, as is the case of secure files and
+  // virtual devices, the data is copied through the enclave instead.
+
+  // Implements sendfile(2).
+  virtual ssize_t SendFile(int out_fd, int in_fd, off_t *offset, size_t count);
+
+  // Implements splice(2).
+  virtual ssize_t Splice(int fd_in, off_t *off_in, int fd_out, off_t *off_out,
+                         size_t len, unsigned int flags);
+
+  // Implements copy_file_range(2).
+  virtual ssize_t CopyFileRange(int fd_in, off_t *off_in, int fd_out,
+                                off_t *off_out, size_t len,
+                                unsigned int flags);
+
   // Implements umask(2).
   virtual mode_t Umask(mode_t mask);
 
@@ -736,6 +929,14 @@ class IOManager {
   // Implements recvmsg(2).
   virtual ssize_t RecvMsg(int sockfd, struct msghdr *msg, int flags);
 
+  // Implements sendmmsg(2).
+  virtual int SendMmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen,
+                       int flags);
+
+  // Implements recvmmsg(2).
+  virtual int RecvMmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen,
+                       int flags, struct timespec *timeout);
+
   // Implements getsockname(2).
   virtual int GetSockName(int sockfd, struct sockaddr *addr,
                           socklen_t *addrlen);
@@ -763,6 +964,58 @@ class IOManager {
   // Implements recvfrom(2).
   virtual ssize_t RecvFrom(int sockfd, void *buf, size_t len, int flags,
                            struct sockaddr *src_addr, socklen_t *addrlen);
+  // Asynchronous I/O. The following calls queue an operation on |fd| and
+  // return 0 on success, or -1 with errno set, in particular to ENOSYS if |fd|
+  // does not support asynchronous I/O, as is the case of secure files, and to
+  // EAGAIN if too many operations are in flight. |buf| must remain valid until
+  // the completion of the operation, tagged with |user_data|, is returned by
+  // PollAsyncIo(). Closing |fd| does not cancel operations in flight.
+
+  // Queues a read of |count| bytes at |offset|, or at the current file
+  // position if |offset| is -1.
+  int AsyncRead(int fd, void *buf, size_t count, off_t offset,
+                uint64_t user_data);
+
+  // Queues a write of |count| bytes at |offset|, or at the current file
+  // position if |offset| is -1.
+  int AsyncWrite(int fd, const void *buf, size_t count, off_t offset,
+                 uint64_t user_data);
+
+  // Queues a send(2) of |len| bytes with |flags|.
+  int AsyncSend(int sockfd, const void *buf, size_t len, int flags,
+                uint64_t user_data);
+
+  // Queues a recv(2) of up to |len| bytes with |flags|.
+  int AsyncRecv(int sockfd, void *buf, size_t len, int flags,
+                uint64_t user_data);
+
+  // Copies the outcome of up to |max_completions| completed asynchronous
+  // operations to |completions|, blocking until at least one completes if
+  // |wait| is set and operations are in flight. Returns the number of
+  // completions copied, or -1 with errno set.
+  int PollAsyncIo(AsyncIoCompletion *completions, int max_completions,
+                  bool wait);
+
+  // Buffers writes to |fd| in enclave memory, see
+  // IOContext::EnableWriteBuffering. Buffered data is written at the latest by
+  // BufferedWriter::FlushAll(), which runs when the enclave exits or aborts.
+  int EnableWriteBuffering(int fd, size_t capacity,
+                           int64_t flush_interval_nanos);
+
+  // Stages reads from the stream socket |fd| in enclave memory, see
+  // IOContext::EnableReadBuffering.
+  int EnableReadBuffering(int fd, size_t capacity);
+
+  // Accepts connections on the listening socket |fd| |batch_size| at a time,
+  // see IOContext::EnableAcceptBatching.
+  int EnableAcceptBatching(int fd, int batch_size);
+
+  // Makes Pipe() create pipes whose data stays in enclave memory, so that
+  // threads of the enclave signaling each other through a pipe do not exit
+  // the enclave. Such pipes are not shared with the host, and thus not with
+  // the child of a fork() either.
+  void EnableLocalPipes();
+
   // Binds an enclave file descriptor to a host file descriptor, returning an
   // enclave file descriptor which will delegate all I/O operations to the host
   // operating system.
@@ -797,6 +1050,64 @@ class IOManager {
   // relative paths and path normalization.
   StatusOr<std::string> CanonicalizePath(absl::string_view path) const;
 
+  // Returns the indices of the entries of |fds| polled for reading whose file
+  // descriptors have input staged in enclave memory.
+  std::vector<nfds_t> FindStagedReads(const struct pollfd *fds, nfds_t nfds);
+
+  // Returns true if input from |fd| is staged in enclave memory.
+  bool HasStagedReads(int fd);
+
+  // An entry of a poll set whose file descriptor is enclave-local, see
+  // IOContext::LocalEvents().
+  struct LocalEntry {
+    nfds_t index;
+    std::shared_ptr<IOContext> context;
+  };
+
+  // Clears the revents of all entries of |fds| and returns those whose file
+  // descriptors are enclave-local. Sets |needs_host| if any other entry refers
+  // to an open file descriptor.
+  std::vector<LocalEntry> FindLocalEntries(struct pollfd *fds, nfds_t nfds,
+                                           bool *needs_host);
+
+  // Sets the revents of the |local| entries of |fds| to the events ready on
+  // their contexts. Returns the number of those entries with events.
+  static int ReportLocalEvents(struct pollfd *fds,
+                               const std::vector<LocalEntry> &local);
+
+  // Implements Poll() for a poll set whose only open file descriptors are the
+  // |local| ones, waiting for them inside the enclave.
+  static int PollLocal(struct pollfd *fds, const std::vector<LocalEntry> &local,
+                       int timeout);
+
+  // Returns the host file descriptor to poll for |context|, which is its host
+  // readiness file descriptor if it is enclave-local.
+  static int GetPollFileDescriptor(IOContext *context);
+
+  // Implements Pipe() with a pipe in enclave memory.
+  int LocalPipe(int pipefd[2], int flags) ABSL_LOCKS_EXCLUDED(fd_table_lock_);
+
+  // A host poll set reused across Poll() calls, together with the enclave file
+  // descriptors it was translated from and the |fd_table_| generation of the
+  // translation, so that only entries that changed since are translated again
+  // and written to the host.
+  struct CachedPollSet {
+    host_call::PollSet poll_set;
+    std::vector<int> enclave_fds;
+    uint64_t generation = 0;
+  };
+
+  // Maximum number of idle poll sets kept for reuse.
+  static constexpr size_t kMaxIdlePollSets = 8;
+
+  // Takes an idle poll set, or creates one if none is left.
+  std::unique_ptr<CachedPollSet> AcquirePollSet()
+      ABSL_LOCKS_EXCLUDED(poll_sets_lock_);
+
+  // Returns a poll set taken by AcquirePollSet() for reuse.
+  void ReleasePollSet(std::unique_ptr<CachedPollSet> poll_set)
+      ABSL_LOCKS_EXCLUDED(poll_sets_lock_);
+
   // Closes a file descriptor by removing it from |fd_table_|, and closing the
   // corresponding host file descriptor if this is the last reference to it.
   // This method does not obtain a locker. Caller of this method is responsible
@@ -807,11 +1118,37 @@ class IOManager {
   // nullptr if no entry is found.
   VirtualPathHandler *HandlerForPath(absl::string_view path) const;
 
-  // Locks the mutex corresponding to |fd| and performs thread safe action.
+  // Canonicalizes |path| and fetches the VirtualPathHandler serving it, which
+  // is set to nullptr if no entry is found. Successful resolutions are cached
+  // in |path_cache_|.
+  Status ResolvePath(absl::string_view path, std::string *canonical_path,
+                     VirtualPathHandler **handler);
+
+  // Queues |operation| on the host file descriptor behind |fd|.
+  int SubmitAsyncIo(int fd, AsyncIoEngine::Operation operation, void *buf,
+                    size_t count, off_t offset, int flags, uint64_t user_data);
+
+  // Transfers up to |count| bytes from |in_fd| to |out_fd|, at |*in_offset|
+  // and |*out_offset| if they are not null, which are then advanced by the
+  // number of bytes transferred, or at the current file positions otherwise.
+  // Calls |host_transfer| with the host file descriptors if both contexts have
+  // plain host file descriptors, and copies through the enclave otherwise.
+  ssize_t Transfer(
+      int in_fd, off_t *in_offset, int out_fd, off_t *out_offset, size_t count,
+      const std::function<ssize_t(int host_in_fd, int host_out_fd)>
+          &host_transfer);
+
+  // Copies up to |count| bytes from |in| to |out| in enclave memory, with the
+  // same offset semantics as Transfer().
+  static ssize_t CopyThroughEnclave(IOContext *in, off_t *in_offset,
+                                    IOContext *out, off_t *out_offset,
+                                    size_t count);
+
+  // Looks up the IOContext of |fd| without locking the file descriptor table
+  // and calls the given function on it.
   template <typename IOAction, typename ReturnType = typename std::result_of<
                                    IOAction(std::shared_ptr<IOContext>)>::type>
-  ReturnType CallWithContext(int fd, IOAction action)
-      ABSL_LOCKS_EXCLUDED(fd_table_lock_);
+  ReturnType CallWithContext(int fd, IOAction action);
 
   // Looks up the appropriate VirtualPathHandler and calls the given function on
   // it.  Errors related to path resolution and handler lookups are handled.
@@ -836,10 +1173,34 @@ class IOManager {
 
   FileDescriptorTable fd_table_;
 
-  // A mutex that locks the fd_table_.
+  // A mutex that serializes updates of the fd_table_. Lookups do not take it.
   absl::Mutex fd_table_lock_;
 
   std::string current_working_directory_;
+
+  // Resolutions of recently used paths, which depend on |prefix_to_handler_|
+  // and |current_working_directory_| and are invalidated when either changes.
+  PathCache<VirtualPathHandler> path_cache_;
+
+  AsyncIoEngine async_io_;
+
+  // Set once input from any file descriptor is staged in enclave memory,
+  // after which Poll() and Select() check every file descriptor for staged
+  // input.
+  std::atomic<bool> input_staging_enabled_{false};
+
+  // Set once an enclave-local context is created, after which Poll() and
+  // Select() check every file descriptor for enclave-local readiness.
+  std::atomic<bool> local_contexts_created_{false};
+
+  // Set by EnableLocalPipes().
+  std::atomic<bool> local_pipes_enabled_{false};
+
+  // Idle poll sets, most recently used last. A thread polling the same file
+  // descriptors in a loop thus keeps reusing the same poll set.
+  absl::Mutex poll_sets_lock_;
+  std::vector<std::unique_ptr<CachedPollSet>> idle_poll_sets_
+      ABSL_GUARDED_BY(poll_sets_lock_);
 };
 
 }  // namespace io
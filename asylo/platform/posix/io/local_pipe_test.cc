@@ -0,0 +1,131 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "asylo/platform/posix/io/io_manager.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Ne;
+
+constexpr int kSleepMillis = 100;
+
+class LocalPipeTest : public ::testing::Test {
+ protected:
+  static void SetUpTestSuite() {
+    io::IOManager::GetInstance().EnableLocalPipes();
+  }
+
+  void SetUp() override {
+    int pipe_fds[2];
+    ASSERT_THAT(pipe2(pipe_fds, O_NONBLOCK), Eq(0));
+    read_fd_ = pipe_fds[0];
+    write_fd_ = pipe_fds[1];
+  }
+
+  void TearDown() override {
+    close(read_fd_);
+    close(write_fd_);
+  }
+
+  int read_fd_;
+  int write_fd_;
+};
+
+TEST_F(LocalPipeTest, PipeIsFifo) {
+  struct stat st;
+  ASSERT_THAT(fstat(read_fd_, &st), Eq(0));
+  EXPECT_TRUE(S_ISFIFO(st.st_mode));
+  EXPECT_TRUE(fcntl(read_fd_, F_GETFL) & O_NONBLOCK);
+  EXPECT_THAT(fcntl(write_fd_, F_GETPIPE_SZ), Eq(65536));
+}
+
+TEST_F(LocalPipeTest, ReadsWhatWasWritten) {
+  char buf[16];
+  EXPECT_THAT(read(read_fd_, buf, sizeof(buf)), Eq(-1));
+  EXPECT_THAT(errno, Eq(EAGAIN));
+  ASSERT_THAT(write(write_fd_, "hello", 5), Eq(5));
+  ASSERT_THAT(read(read_fd_, buf, sizeof(buf)), Eq(5));
+  EXPECT_THAT(std::string(buf, 5), Eq("hello"));
+}
+
+TEST_F(LocalPipeTest, FullPipeIsNotWritable) {
+  std::vector<char> data(fcntl(write_fd_, F_GETPIPE_SZ) + 1, 'a');
+  EXPECT_THAT(write(write_fd_, data.data(), data.size()),
+              Eq(data.size() - 1));
+  struct pollfd fds = {write_fd_, POLLOUT, 0};
+  EXPECT_THAT(poll(&fds, 1, 0), Eq(0));
+  EXPECT_THAT(write(write_fd_, "b", 1), Eq(-1));
+  EXPECT_THAT(errno, Eq(EAGAIN));
+}
+
+TEST_F(LocalPipeTest, ClosingWriteEndSignalsEndOfFile) {
+  close(write_fd_);
+  write_fd_ = -1;
+  struct pollfd fds = {read_fd_, POLLIN, 0};
+  ASSERT_THAT(poll(&fds, 1, 0), Eq(1));
+  EXPECT_TRUE(fds.revents & POLLHUP);
+  char buf;
+  EXPECT_THAT(read(read_fd_, &buf, 1), Eq(0));
+}
+
+TEST_F(LocalPipeTest, PollWaitsForWrite) {
+  std::thread writer([this] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(kSleepMillis));
+    write(write_fd_, "x", 1);
+  });
+  struct pollfd fds = {read_fd_, POLLIN, 0};
+  EXPECT_THAT(poll(&fds, 1, -1), Eq(1));
+  EXPECT_THAT(fds.revents, Eq(POLLIN));
+  writer.join();
+}
+
+TEST_F(LocalPipeTest, EpollWaitsForWrite) {
+  int epfd = epoll_create(1);
+  ASSERT_THAT(epfd, Ne(-1));
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = read_fd_;
+  ASSERT_THAT(epoll_ctl(epfd, EPOLL_CTL_ADD, read_fd_, &event), Eq(0));
+  std::thread writer([this] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(kSleepMillis));
+    write(write_fd_, "x", 1);
+  });
+  struct epoll_event ready;
+  ASSERT_THAT(epoll_wait(epfd, &ready, 1, -1), Eq(1));
+  EXPECT_THAT(ready.events, Eq(EPOLLIN));
+  EXPECT_THAT(ready.data.fd, Eq(read_fd_));
+  writer.join();
+  close(epfd);
+}
+
+}  // namespace
+}  // namespace asylo
@@ -0,0 +1,114 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "asylo/platform/posix/io/local_readiness.h"
+
+#include <fcntl.h>
+
+#include "asylo/platform/host_call/trusted/host_calls.h"
+
+namespace asylo {
+namespace io {
+namespace {
+
+// Bumped whenever the events of any LocalReadiness change.
+std::atomic<uint64_t> generation{0};
+
+// Number of threads in WaitForChange(), which only have to be woken up while
+// there are any.
+std::atomic<int> waiters{0};
+
+ABSL_CONST_INIT absl::Mutex wait_mu(absl::kConstInit);
+
+}  // namespace
+
+LocalReadiness::LocalReadiness(int events, int mirrored_events)
+    : mirrored_events_(mirrored_events),
+      events_(events),
+      host_created_(false),
+      host_fds_{-1, -1},
+      host_readable_(false) {}
+
+LocalReadiness::~LocalReadiness() {
+  absl::MutexLock lock(&mu_);
+  if (host_created_.load()) {
+    enc_untrusted_close(host_fds_[0]);
+    enc_untrusted_close(host_fds_[1]);
+  }
+}
+
+void LocalReadiness::Set(int events) {
+  if (events_.exchange(events) == events) {
+    return;
+  }
+  // Either this thread sees the host pipe, or GetHostFileDescriptor() sees the
+  // new events after creating it.
+  if (host_created_.load()) {
+    absl::MutexLock lock(&mu_);
+    SyncHostPipe();
+  }
+  generation.fetch_add(1);
+  if (waiters.load() > 0) {
+    // Releasing the lock makes waiting threads re-evaluate their conditions.
+    absl::MutexLock lock(&wait_mu);
+  }
+}
+
+int LocalReadiness::GetHostFileDescriptor() {
+  absl::MutexLock lock(&mu_);
+  if (!host_created_.load()) {
+    if (enc_untrusted_pipe2(host_fds_, O_NONBLOCK | O_CLOEXEC) == -1) {
+      return -1;
+    }
+    host_created_.store(true);
+    SyncHostPipe();
+  }
+  return host_fds_[0];
+}
+
+uint64_t LocalReadiness::Generation() { return generation.load(); }
+
+bool LocalReadiness::WaitForChange(uint64_t seen, absl::Time deadline) {
+  // Registering as a waiter before checking the generation guarantees that
+  // either the check sees the change or Set() sees the waiter and wakes it.
+  waiters.fetch_add(1);
+  bool changed;
+  {
+    absl::MutexLock lock(&wait_mu);
+    auto changed_since = [seen]() { return generation.load() != seen; };
+    changed =
+        wait_mu.AwaitWithDeadline(absl::Condition(&changed_since), deadline);
+  }
+  waiters.fetch_sub(1);
+  return changed;
+}
+
+void LocalReadiness::SyncHostPipe() {
+  bool readable = (events_.load() & mirrored_events_) != 0;
+  if (readable == host_readable_) {
+    return;
+  }
+  char byte = 0;
+  ssize_t ret = readable ? enc_untrusted_write(host_fds_[1], &byte, 1)
+                         : enc_untrusted_read(host_fds_[0], &byte, 1);
+  if (ret == 1) {
+    host_readable_ = readable;
+  }
+}
+
+}  // namespace io
+}  // namespace asylo
@@ -0,0 +1,97 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_POSIX_IO_LOCAL_READINESS_H_
+#define ASYLO_PLATFORM_POSIX_IO_LOCAL_READINESS_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace asylo {
+namespace io {
+
+// Tracks the poll(2) events ready on an IOContext implemented entirely in
+// enclave memory, such as an eventfd or a pipe whose two ends are inside the
+// enclave. Threads waiting for such contexts only are woken up from inside the
+// enclave, see WaitForChange(), so signaling between enclave threads never
+// exits the enclave.
+//
+// Waiting for an enclave-local context together with host file descriptors
+// needs a host file descriptor the host can wait on. It is only created once
+// requested, see GetHostFileDescriptor(), after which changes of readiness are
+// mirrored to it, which exits the enclave.
+//
+// This class is thread-safe.
+class LocalReadiness {
+ public:
+  // Tracks a context on which |events| are initially ready. The host file
+  // descriptor is readable while any of |mirrored_events| is ready.
+  LocalReadiness(int events, int mirrored_events);
+
+  LocalReadiness(const LocalReadiness &other) = delete;
+  LocalReadiness &operator=(const LocalReadiness &other) = delete;
+
+  ~LocalReadiness();
+
+  // Returns the events currently ready.
+  int events() const { return events_.load(std::memory_order_acquire); }
+
+  // Records that |events| are now ready. Callers must serialize calls, for
+  // instance by holding the lock of the state |events| derive from.
+  void Set(int events);
+
+  // Returns the read end of a host pipe which is readable while any mirrored
+  // event is ready, creating it on first use. Returns -1 with errno set if the
+  // host pipe cannot be created.
+  int GetHostFileDescriptor();
+
+  // Returns a counter which changes whenever the events of any LocalReadiness
+  // change.
+  static uint64_t Generation();
+
+  // Blocks until Generation() differs from |generation| or |deadline| passes.
+  // Returns false if |deadline| passed first. Callers read Generation() before
+  // checking the events of the contexts they wait for, so that no change after
+  // the check is missed.
+  static bool WaitForChange(uint64_t generation, absl::Time deadline);
+
+ private:
+  // Writes a byte to or reads back the byte of the host pipe so that it is
+  // readable exactly while mirrored events are ready.
+  void SyncHostPipe() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const int mirrored_events_;
+  std::atomic<int> events_;
+
+  // Set once the host pipe is created, after which it is never closed before
+  // destruction.
+  std::atomic<bool> host_created_;
+
+  absl::Mutex mu_;
+  int host_fds_[2] ABSL_GUARDED_BY(mu_);
+  bool host_readable_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace io
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_IO_LOCAL_READINESS_H_
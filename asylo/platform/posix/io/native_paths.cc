@@ -19,24 +19,42 @@
 #include "asylo/platform/posix/io/native_paths.h"
 
 #include <fcntl.h>
+#include <sys/socket.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <cstring>
+#include <vector>
 
 #include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/platform/posix/host_time.h"
 #include "asylo/platform/posix/io/secure_paths.h"
 #include "asylo/platform/posix/io/io_context_inotify.h"
 
 namespace asylo {
 namespace io {
 
-int IOContextNative::Close() { return enc_untrusted_close(host_fd_); }
+int IOContextNative::Close() {
+  if (writer_) {
+    writer_->Flush();
+  }
+  if (accept_queue_) {
+    accept_queue_->Close();
+  }
+  return enc_untrusted_close(host_fd_);
+}
 
 ssize_t IOContextNative::Read(void *buf, size_t count) {
+  if (reader_) {
+    return reader_->Read(buf, count, /*flags=*/0);
+  }
   return enc_untrusted_read(host_fd_, buf, count);
 }
 
 ssize_t IOContextNative::Write(const void *buf, size_t count) {
+  if (writer_) {
+    return writer_->Write(buf, count);
+  }
   return enc_untrusted_write(host_fd_, buf, count);
 }
 
@@ -45,6 +63,9 @@ int IOContextNative::FChOwn(uid_t owner, gid_t group) {
 }
 
 int IOContextNative::LSeek(off_t offset, int whence) {
+  if (writer_ && writer_->Flush() != 0) {
+    return -1;
+  }
   return enc_untrusted_lseek(host_fd_, offset, whence);
 }
 
@@ -52,7 +73,12 @@ int IOContextNative::FCntl(int cmd, int64_t arg) {
   return enc_untrusted_fcntl(host_fd_, cmd, arg);
 }
 
-int IOContextNative::FSync() { return enc_untrusted_fsync(host_fd_); }
+int IOContextNative::FSync() {
+  if (writer_ && writer_->Flush() != 0) {
+    return -1;
+  }
+  return enc_untrusted_fsync(host_fd_);
+}
 
 int IOContextNative::FStat(struct stat *stat_buffer) {
   return enc_untrusted_fstat(host_fd_, stat_buffer);
@@ -89,38 +115,23 @@ int IOContextNative::FLock(int operation) {
   return enc_untrusted_flock(host_fd_, operation);
 }
 
-void IOContextNative::FillIov(const char *buf, int size,
-                              const struct iovec *iov, int iovcnt) {
-  size_t bytes_left = size;
-  for (int i = 0; i < iovcnt; ++i) {
-    if (bytes_left == 0) {
-      break;
-    }
-    int bytes_to_copy = std::min(bytes_left, iov[i].iov_len);
-    memcpy(iov[i].iov_base, buf, bytes_to_copy);
-    buf += bytes_to_copy;
-    bytes_left -= bytes_to_copy;
-  }
-}
-
 ssize_t IOContextNative::Writev(const struct iovec *iov, int iovcnt) {
   if (iovcnt <= 0) {
     errno = EINVAL;
     return -1;
   }
 
-  size_t total_size = 0;
-  for (int i = 0; i < iovcnt; ++i) {
-    total_size += iov[i].iov_len;
-  }
-  std::unique_ptr<char[]> trusted_buf(new char[total_size]);
-  size_t copied_bytes = 0;
-  for (int i = 0; i < iovcnt; ++i) {
-    memcpy(trusted_buf.get() + copied_bytes, iov[i].iov_base, iov[i].iov_len);
-    copied_bytes += iov[i].iov_len;
+  if (writer_) {
+    ssize_t total_size = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+      if (writer_->Write(iov[i].iov_base, iov[i].iov_len) < 0) {
+        return -1;
+      }
+      total_size += iov[i].iov_len;
+    }
+    return total_size;
   }
-
-  return enc_untrusted_write(host_fd_, trusted_buf.get(), total_size);
+  return enc_untrusted_writev(host_fd_, iov, iovcnt);
 }
 
 ssize_t IOContextNative::Readv(const struct iovec *iov, int iovcnt) {
@@ -128,23 +139,26 @@ ssize_t IOContextNative::Readv(const struct iovec *iov, int iovcnt) {
     errno = EINVAL;
     return -1;
   }
-
-  size_t total_size = 0;
-  for (int i = 0; i < iovcnt; ++i) {
-    total_size += iov[i].iov_len;
+  if (reader_) {
+    return ReadvStaged(iov, iovcnt, /*flags=*/0);
   }
-  std::unique_ptr<char[]> trusted_buf(new char[total_size]);
-
-  ssize_t ret = enc_untrusted_read(host_fd_, trusted_buf.get(), total_size);
-  FillIov(trusted_buf.get(), ret, iov, iovcnt);
-
-  return ret;
+  return enc_untrusted_readv(host_fd_, iov, iovcnt);
 }
 
 ssize_t IOContextNative::PRead(void *buf, size_t count, off_t offset) {
   return enc_untrusted_pread64(host_fd_, buf, count, offset);
 }
 
+ssize_t IOContextNative::PReadv(const struct iovec *iov, int iovcnt,
+                                off_t offset, int flags) {
+  return enc_untrusted_preadv2(host_fd_, iov, iovcnt, offset, flags);
+}
+
+ssize_t IOContextNative::PWritev(const struct iovec *iov, int iovcnt,
+                                 off_t offset) {
+  return enc_untrusted_pwritev(host_fd_, iov, iovcnt, offset);
+}
+
 int IOContextNative::SetSockOpt(int level, int option_name,
                                 const void *option_value,
                                 socklen_t option_len) {
@@ -170,6 +184,9 @@ int IOContextNative::GetSockOpt(int level, int optname, void *optval,
 }
 
 int IOContextNative::Accept(struct sockaddr *addr, socklen_t *addrlen) {
+  if (accept_queue_) {
+    return accept_queue_->Accept(addr, addrlen);
+  }
   return enc_untrusted_accept(host_fd_, addr, addrlen);
 }
 
@@ -186,9 +203,40 @@ ssize_t IOContextNative::SendMsg(const struct msghdr *msg, int flags) {
 }
 
 ssize_t IOContextNative::RecvMsg(struct msghdr *msg, int flags) {
+  if (reader_ && (msg->msg_controllen == 0 || reader_->HasStagedData())) {
+    // Stream sockets report neither a source address nor, for staged data,
+    // ancillary data.
+    ssize_t result = ReadvStaged(msg->msg_iov, msg->msg_iovlen, flags);
+    if (result >= 0) {
+      msg->msg_namelen = 0;
+      msg->msg_controllen = 0;
+      msg->msg_flags = 0;
+    }
+    return result;
+  }
   return enc_untrusted_recvmsg(host_fd_, msg, flags);
 }
 
+int IOContextNative::SendMmsg(struct mmsghdr *msgvec, unsigned int vlen,
+                              int flags) {
+  return enc_untrusted_sendmmsg(host_fd_, msgvec, vlen, flags);
+}
+
+int IOContextNative::RecvMmsg(struct mmsghdr *msgvec, unsigned int vlen,
+                              int flags, struct timespec *timeout) {
+  if (reader_ && vlen > 0) {
+    // A stream has no message boundaries, so all the data read goes to the
+    // first message.
+    ssize_t result = RecvMsg(&msgvec[0].msg_hdr, flags & ~MSG_WAITFORONE);
+    if (result < 0) {
+      return -1;
+    }
+    msgvec[0].msg_len = result;
+    return 1;
+  }
+  return enc_untrusted_recvmmsg(host_fd_, msgvec, vlen, flags, timeout);
+}
+
 int IOContextNative::GetSockName(struct sockaddr *addr, socklen_t *addrlen) {
   return enc_untrusted_getsockname(host_fd_, addr, addrlen);
 }
@@ -200,11 +248,159 @@ int IOContextNative::GetPeerName(struct sockaddr *addr, socklen_t *addrlen) {
 ssize_t IOContextNative::RecvFrom(void *buf, size_t len, int flags,
                                   struct sockaddr *src_addr,
                                   socklen_t *addrlen) {
+  if (reader_) {
+    // Stream sockets do not report a source address.
+    if (addrlen) {
+      *addrlen = 0;
+    }
+    return reader_->Read(buf, len, flags);
+  }
   return enc_untrusted_recvfrom(host_fd_, buf, len, flags, src_addr, addrlen);
 }
 
 int IOContextNative::GetHostFileDescriptor() { return host_fd_; }
 
+// Writes bypassing the context would overtake buffered ones, and reads
+// bypassing it would overtake staged ones.
+bool IOContextNative::HasPlainHostFileDescriptor() {
+  return !writer_ && !reader_ && !accept_queue_;
+}
+
+int IOContextNative::EnableWriteBuffering(size_t capacity,
+                                          int64_t flush_interval_nanos) {
+  if (capacity == 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  int host_fd = host_fd_;
+  BufferedWriter::Options options;
+  options.capacity = capacity;
+  options.line_buffered = Isatty() == 1;
+  options.flush_interval_nanos = flush_interval_nanos;
+  writer_ = absl::make_unique<BufferedWriter>(
+      [host_fd](const void *data, size_t size) {
+        return enc_untrusted_write(host_fd, data, size);
+      },
+      // Only check the interval when the clock can be read without an exit.
+      [](int64_t *nanos) {
+        return ReadHostTimePage(CLOCK_MONOTONIC, nanos);
+      },
+      options);
+  return 0;
+}
+
+int IOContextNative::EnableReadBuffering(size_t capacity) {
+  if (capacity == 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  // Staging would merge datagrams, so only stream sockets are supported.
+  int type;
+  socklen_t type_length = sizeof(type);
+  if (enc_untrusted_getsockopt(host_fd_, SOL_SOCKET, SO_TYPE, &type,
+                               &type_length) != 0) {
+    return -1;
+  }
+  if (type != SOCK_STREAM) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (reader_) {
+    return 0;
+  }
+  int host_fd = host_fd_;
+  reader_ = absl::make_unique<BufferedReader>(
+      [host_fd](void *data, size_t size, int flags) {
+        return enc_untrusted_recvfrom(host_fd, data, size, flags,
+                                      /*src_addr=*/nullptr,
+                                      /*addrlen=*/nullptr);
+      },
+      capacity);
+  return 0;
+}
+
+int IOContextNative::EnableAcceptBatching(int batch_size) {
+  if (batch_size <= 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (accept_queue_) {
+    return 0;
+  }
+  int host_fd = host_fd_;
+  accept_queue_ = absl::make_unique<AcceptQueue>(
+      [host_fd](int max_connections, AcceptQueue::Connection *connections) {
+        std::vector<int> fds(max_connections);
+        std::vector<struct sockaddr_storage> addrs(max_connections);
+        std::vector<socklen_t> addrlens(max_connections);
+        int count = enc_untrusted_accept4_batch(
+            host_fd, /*flags=*/0, max_connections, fds.data(), addrs.data(),
+            addrlens.data());
+        for (int i = 0; i < count; ++i) {
+          connections[i].fd = fds[i];
+          connections[i].addr = addrs[i];
+          connections[i].addrlen = addrlens[i];
+        }
+        return count;
+      },
+      [](int fd) { enc_untrusted_close(fd); }, batch_size);
+  return 0;
+}
+
+bool IOContextNative::StagesInput() { return reader_ || accept_queue_; }
+
+bool IOContextNative::HasStagedInput() {
+  return (reader_ && reader_->HasStagedData()) ||
+         (accept_queue_ && accept_queue_->HasQueuedConnections());
+}
+
+ssize_t IOContextNative::ReadvStaged(const struct iovec *iov, int iovcnt,
+                                     int flags) {
+  if (flags & (MSG_PEEK | MSG_WAITALL)) {
+    // Gather the whole read, for which these flags apply to the total.
+    size_t total_size = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+      total_size += iov[i].iov_len;
+    }
+    std::vector<char> buffer(total_size);
+    ssize_t result = reader_->Read(buffer.data(), buffer.size(), flags);
+    if (result <= 0) {
+      return result;
+    }
+    buffer.resize(result);
+    size_t scattered = 0;
+    for (int i = 0; i < iovcnt && scattered < buffer.size(); ++i) {
+      size_t size = std::min(iov[i].iov_len, buffer.size() - scattered);
+      memcpy(iov[i].iov_base, buffer.data() + scattered, size);
+      scattered += size;
+    }
+    return result;
+  }
+
+  // Only the first buffer may wait for data, the others take what is staged.
+  ssize_t total = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    if (iov[i].iov_len == 0) {
+      continue;
+    }
+    size_t read;
+    if (total == 0) {
+      ssize_t result = reader_->Read(iov[i].iov_base, iov[i].iov_len, flags);
+      if (result <= 0) {
+        return result;
+      }
+      read = result;
+    } else {
+      read = reader_->ReadStaged(iov[i].iov_base, iov[i].iov_len);
+    }
+    total += read;
+    if (read < iov[i].iov_len) {
+      break;
+    }
+  }
+  return total;
+}
+
 std::unique_ptr<IOManager::IOContext> NativePathHandler::Open(const char *path,
                                                               int flags,
                                                               mode_t mode) {
@@ -21,6 +21,11 @@
 
 #include <utime.h>
 
+#include <memory>
+
+#include "asylo/platform/posix/io/accept_queue.h"
+#include "asylo/platform/posix/io/buffered_reader.h"
+#include "asylo/platform/posix/io/buffered_writer.h"
 #include "asylo/platform/posix/io/io_manager.h"
 
 namespace asylo {
@@ -52,6 +57,9 @@ class IOContextNative : public IOManager::IOContext {
   ssize_t Writev(const struct iovec *iov, int iovcnt) override;
   ssize_t Readv(const struct iovec *iov, int iovcnt) override;
   ssize_t PRead(void *buf, size_t count, off_t offset) override;
+  ssize_t PReadv(const struct iovec *iov, int iovcnt, off_t offset,
+                 int flags) override;
+  ssize_t PWritev(const struct iovec *iov, int iovcnt, off_t offset) override;
   int SetSockOpt(int level, int option_name, const void *option_value,
                  socklen_t option_len) override;
   int Connect(const struct sockaddr *addr, socklen_t addrlen) override;
@@ -64,16 +72,36 @@ class IOContextNative : public IOManager::IOContext {
   int Listen(int backlog) override;
   ssize_t SendMsg(const struct msghdr *msg, int flags) override;
   ssize_t RecvMsg(struct msghdr *msg, int flags) override;
+  int SendMmsg(struct mmsghdr *msgvec, unsigned int vlen, int flags) override;
+  int RecvMmsg(struct mmsghdr *msgvec, unsigned int vlen, int flags,
+               struct timespec *timeout) override;
   int GetSockName(struct sockaddr *addr, socklen_t *addrlen) override;
   int GetPeerName(struct sockaddr *addr, socklen_t *addrlen) override;
   ssize_t RecvFrom(void *buf, size_t len, int flags, struct sockaddr *src_addr,
                    socklen_t *addrlen) override;
   int GetHostFileDescriptor() override;
+  bool HasPlainHostFileDescriptor() override;
+  int EnableWriteBuffering(size_t capacity,
+                           int64_t flush_interval_nanos) override;
+  int EnableReadBuffering(size_t capacity) override;
+  int EnableAcceptBatching(int batch_size) override;
+  bool StagesInput() override;
+  bool HasStagedInput() override;
 
  private:
+  // Reads into |iov| through |reader_| with recv(2) |flags|, waiting for data
+  // for the first buffer only.
+  ssize_t ReadvStaged(const struct iovec *iov, int iovcnt, int flags);
+
   // Host file descriptor implementing this stream.
   int host_fd_;
-  void FillIov(const char *buf, int size, const struct iovec *iov, int iovcnt);
+  // Buffer of writes to |host_fd_|, or nullptr if writes are not buffered.
+  std::unique_ptr<BufferedWriter> writer_;
+  // Stage of reads from |host_fd_|, or nullptr if reads are not staged.
+  std::unique_ptr<BufferedReader> reader_;
+  // Queue of connections accepted on |host_fd_|, or nullptr if connections
+  // are accepted one at a time.
+  std::unique_ptr<AcceptQueue> accept_queue_;
 };
 
 // VirtualPathHandler implementation handling paths to be forwarded to the host.
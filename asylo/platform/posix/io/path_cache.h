@@ -0,0 +1,125 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_POSIX_IO_PATH_CACHE_H_
+#define ASYLO_PLATFORM_POSIX_IO_PATH_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/hash/hash.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+
+namespace asylo {
+namespace io {
+
+// A bounded cache of path resolutions, mapping paths as passed by the caller to
+// their canonical form and to the Handler serving them. The cache is direct
+// mapped: each path hashes to a single slot, and a new entry replaces whatever
+// the slot held. Entries are only valid for the resolution state they were
+// computed in, so callers must call Invalidate() whenever the handlers or the
+// current working directory change.
+template <typename Handler>
+class PathCache {
+ public:
+  // Default number of slots.
+  static constexpr size_t kDefaultCapacity = 256;
+
+  // Paths longer than this are not cached, which bounds the memory held by
+  // the cache.
+  static constexpr size_t kMaxPathLength = 512;
+
+  explicit PathCache(size_t capacity = kDefaultCapacity)
+      : capacity_(capacity), slots_(capacity), generation_(1) {}
+
+  PathCache(const PathCache &other) = delete;
+  PathCache &operator=(const PathCache &other) = delete;
+
+  // Returns true and sets |canonical_path| and |handler| if the resolution of
+  // |path| is cached, or returns false.
+  bool Lookup(absl::string_view path, std::string *canonical_path,
+              Handler **handler) const ABSL_LOCKS_EXCLUDED(mu_) {
+    if (capacity_ == 0 || path.size() > kMaxPathLength) {
+      return false;
+    }
+    absl::MutexLock lock(&mu_);
+    const Slot &slot = slots_[SlotIndex(path)];
+    if (slot.generation != generation_ || slot.path != path) {
+      return false;
+    }
+    canonical_path->assign(slot.canonical_path);
+    *handler = slot.handler;
+    return true;
+  }
+
+  // Caches the resolution of |path| to |canonical_path| served by |handler|.
+  void Insert(absl::string_view path, absl::string_view canonical_path,
+              Handler *handler) ABSL_LOCKS_EXCLUDED(mu_) {
+    if (capacity_ == 0 || path.size() > kMaxPathLength ||
+        canonical_path.size() > kMaxPathLength) {
+      return;
+    }
+    absl::MutexLock lock(&mu_);
+    Slot &slot = slots_[SlotIndex(path)];
+    // Reuse the storage of the evicted entry.
+    slot.path.assign(path.data(), path.size());
+    slot.canonical_path.assign(canonical_path.data(), canonical_path.size());
+    slot.handler = handler;
+    slot.generation = generation_;
+  }
+
+  // Drops all cached resolutions.
+  void Invalidate() ABSL_LOCKS_EXCLUDED(mu_) {
+    absl::MutexLock lock(&mu_);
+    generation_++;
+  }
+
+ private:
+  struct Slot {
+    // Generation of the cache the entry was inserted in, where 0 is never a
+    // valid generation.
+    uint64_t generation = 0;
+    std::string path;
+    std::string canonical_path;
+    Handler *handler = nullptr;
+  };
+
+  size_t SlotIndex(absl::string_view path) const {
+    return absl::Hash<absl::string_view>()(path) % capacity_;
+  }
+
+  const size_t capacity_;
+  mutable absl::Mutex mu_;
+  std::vector<Slot> slots_ ABSL_GUARDED_BY(mu_);
+  uint64_t generation_ ABSL_GUARDED_BY(mu_);
+};
+
+template <typename Handler>
+constexpr size_t PathCache<Handler>::kDefaultCapacity;
+
+template <typename Handler>
+constexpr size_t PathCache<Handler>::kMaxPathLength;
+
+}  // namespace io
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_IO_PATH_CACHE_H_
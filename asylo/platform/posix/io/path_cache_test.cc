@@ -0,0 +1,103 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/io/path_cache.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+
+namespace asylo {
+namespace io {
+namespace {
+
+TEST(PathCacheTest, LookupReturnsInsertedResolution) {
+  PathCache<int> cache;
+  int handler = 0;
+  std::string canonical_path;
+  int *found = nullptr;
+  EXPECT_FALSE(cache.Lookup("foo/../bar", &canonical_path, &found));
+
+  cache.Insert("foo/../bar", "/cwd/bar", &handler);
+  EXPECT_TRUE(cache.Lookup("foo/../bar", &canonical_path, &found));
+  EXPECT_EQ(canonical_path, "/cwd/bar");
+  EXPECT_EQ(found, &handler);
+  EXPECT_FALSE(cache.Lookup("foo/../baz", &canonical_path, &found));
+}
+
+TEST(PathCacheTest, InvalidateDropsAllEntries) {
+  PathCache<int> cache;
+  int handler = 0;
+  cache.Insert("/a", "/a", &handler);
+  cache.Insert("/b", "/b", &handler);
+  cache.Invalidate();
+
+  std::string canonical_path;
+  int *found = nullptr;
+  EXPECT_FALSE(cache.Lookup("/a", &canonical_path, &found));
+  EXPECT_FALSE(cache.Lookup("/b", &canonical_path, &found));
+
+  cache.Insert("/a", "/a", &handler);
+  EXPECT_TRUE(cache.Lookup("/a", &canonical_path, &found));
+}
+
+TEST(PathCacheTest, IsBounded) {
+  PathCache<int> cache(/*capacity=*/4);
+  int handler = 0;
+  for (int i = 0; i < 100; i++) {
+    std::string path = absl::StrCat("/file", i);
+    cache.Insert(path, path, &handler);
+  }
+
+  // Each insertion only replaces the entry of its own slot, so the most
+  // recent insertion is always found.
+  std::string canonical_path;
+  int *found = nullptr;
+  EXPECT_TRUE(cache.Lookup("/file99", &canonical_path, &found));
+  int hits = 0;
+  for (int i = 0; i < 100; i++) {
+    hits += cache.Lookup(absl::StrCat("/file", i), &canonical_path, &found);
+  }
+  EXPECT_LE(hits, 4);
+}
+
+TEST(PathCacheTest, LongPathsAreNotCached) {
+  PathCache<int> cache;
+  int handler = 0;
+  std::string path(PathCache<int>::kMaxPathLength + 1, 'a');
+  cache.Insert(path, "/a", &handler);
+
+  std::string canonical_path;
+  int *found = nullptr;
+  EXPECT_FALSE(cache.Lookup(path, &canonical_path, &found));
+}
+
+TEST(PathCacheTest, ZeroCapacityDisablesCaching) {
+  PathCache<int> cache(/*capacity=*/0);
+  int handler = 0;
+  cache.Insert("/a", "/a", &handler);
+
+  std::string canonical_path;
+  int *found = nullptr;
+  EXPECT_FALSE(cache.Lookup("/a", &canonical_path, &found));
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace asylo
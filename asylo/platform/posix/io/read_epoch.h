@@ -0,0 +1,127 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_POSIX_IO_READ_EPOCH_H_
+#define ASYLO_PLATFORM_POSIX_IO_READ_EPOCH_H_
+
+#include <sched.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace asylo {
+namespace io {
+
+// Epoch-based protection of objects read without locks. Readers bracket each
+// access with a ReadEpoch::Reader, which costs two uncontended atomic updates
+// on a counter that is private in practice to the reading thread. A writer
+// that unpublishes an object calls Synchronize() before freeing it, which
+// waits until every reader that could still hold the object has left.
+//
+// Writers must unpublish objects with sequentially consistent stores. Readers
+// must not block or call Synchronize() while holding a Reader. Calls to
+// Synchronize() must be serialized by the caller.
+class ReadEpoch {
+ public:
+  // Marks the calling thread as reading for the lifetime of the object.
+  class Reader {
+   public:
+    explicit Reader(ReadEpoch *epoch)
+        : counter_(epoch->stripe()->readers +
+                   (epoch->epoch_.load(std::memory_order_relaxed) & 1)) {
+      // Sequentially consistent so that loads of published objects are not
+      // ordered before the reader is counted.
+      counter_->fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    ~Reader() { counter_->fetch_sub(1, std::memory_order_release); }
+
+    Reader(const Reader &other) = delete;
+    Reader &operator=(const Reader &other) = delete;
+
+   private:
+    std::atomic<int64_t> *const counter_;
+  };
+
+  ReadEpoch() : epoch_(0) {
+    for (auto &stripe : stripes_) {
+      stripe.readers[0].store(0, std::memory_order_relaxed);
+      stripe.readers[1].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  ReadEpoch(const ReadEpoch &other) = delete;
+  ReadEpoch &operator=(const ReadEpoch &other) = delete;
+
+  // Waits until all readers that started before the call have finished. Any
+  // object unpublished before the call can be freed once it returns.
+  void Synchronize() {
+    // Readers starting after a flip are counted in the other epoch, so the
+    // readers of the previous one can only drain. A reader may have loaded
+    // the epoch before an earlier flip and be counted in either epoch, so
+    // both are drained in turn.
+    for (int flip = 0; flip < 2; flip++) {
+      uint32_t old_epoch = epoch_.fetch_add(1, std::memory_order_seq_cst) & 1;
+      for (int spins = 0; ReadersIn(old_epoch) != 0; spins++) {
+        if (spins < kSpinsBeforeYield) {
+          __builtin_ia32_pause();
+        } else {
+          sched_yield();
+        }
+      }
+    }
+  }
+
+ private:
+  // Number of reader counters. Threads are spread over them so that readers
+  // on different threads do not contend on a cache line.
+  static constexpr size_t kNumStripes = 64;
+
+  // Number of times Synchronize() polls the readers before yielding.
+  static constexpr int kSpinsBeforeYield = 1000;
+
+  struct alignas(64) Stripe {
+    std::atomic<int64_t> readers[2];
+  };
+
+  // Returns the counters of the calling thread.
+  Stripe *stripe() {
+    static std::atomic<uint32_t> next_stripe(0);
+    thread_local uint32_t stripe_index =
+        next_stripe.fetch_add(1, std::memory_order_relaxed) % kNumStripes;
+    return &stripes_[stripe_index];
+  }
+
+  // Returns the number of readers in |epoch|.
+  int64_t ReadersIn(uint32_t epoch) {
+    int64_t readers = 0;
+    for (auto &stripe : stripes_) {
+      readers += stripe.readers[epoch].load(std::memory_order_seq_cst);
+    }
+    return readers;
+  }
+
+  std::atomic<uint32_t> epoch_;
+  Stripe stripes_[kNumStripes];
+};
+
+}  // namespace io
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_IO_READ_EPOCH_H_
@@ -0,0 +1,115 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/io/read_epoch.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace asylo {
+namespace io {
+namespace {
+
+TEST(ReadEpochTest, SynchronizeWithoutReadersReturns) {
+  ReadEpoch epoch;
+  epoch.Synchronize();
+  epoch.Synchronize();
+}
+
+TEST(ReadEpochTest, SynchronizeWaitsForReader) {
+  ReadEpoch epoch;
+  std::atomic<bool> reading(false);
+  std::atomic<bool> release(false);
+  std::thread reader([&] {
+    ReadEpoch::Reader guard(&epoch);
+    reading = true;
+    while (!release) {
+      std::this_thread::yield();
+    }
+  });
+  while (!reading) {
+    std::this_thread::yield();
+  }
+
+  std::atomic<bool> synchronized(false);
+  std::thread writer([&] {
+    epoch.Synchronize();
+    synchronized = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(synchronized);
+  release = true;
+  reader.join();
+  writer.join();
+  EXPECT_TRUE(synchronized);
+}
+
+// Readers dereference a published object while a writer keeps replacing and
+// freeing it. Freed objects are poisoned, so a reader observing a poisoned
+// value read an object that was freed too early.
+TEST(ReadEpochTest, ProtectsUnpublishedObjects) {
+  constexpr int kReaders = 4;
+  constexpr int kUpdates = 2000;
+  constexpr int kLive = 1;
+  constexpr int kFreed = 2;
+
+  ReadEpoch epoch;
+  std::atomic<std::atomic<int> *> published(new std::atomic<int>(kLive));
+  std::atomic<bool> done(false);
+  std::atomic<int> failures(0);
+  std::vector<std::thread> readers;
+  for (int i = 0; i < kReaders; i++) {
+    readers.emplace_back([&] {
+      while (!done) {
+        ReadEpoch::Reader guard(&epoch);
+        if (published.load(std::memory_order_acquire)->load() != kLive) {
+          failures++;
+        }
+      }
+    });
+  }
+
+  std::vector<std::atomic<int> *> retired;
+  for (int i = 0; i < kUpdates; i++) {
+    std::atomic<int> *old =
+        published.exchange(new std::atomic<int>(kLive),
+                           std::memory_order_seq_cst);
+    epoch.Synchronize();
+    // Poison instead of freeing, so that late readers are detected rather
+    // than crashing.
+    old->store(kFreed);
+    retired.push_back(old);
+  }
+  done = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(failures.load(), 0);
+  delete published.load();
+  for (auto *object : retired) {
+    delete object;
+  }
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace asylo
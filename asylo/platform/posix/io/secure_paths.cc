@@ -18,8 +18,14 @@
 
 #include "asylo/platform/posix/io/secure_paths.h"
 
+#include <sys/uio.h>
+
+#include <algorithm>
 #include <cerrno>
+#include <climits>
 #include <cstdint>
+#include <cstring>
+#include <vector>
 
 #include "asylo/platform/crypto/gcmlib/gcm_cryptor.h"
 #include "asylo/platform/host_call/trusted/host_calls.h"
@@ -33,6 +39,60 @@ using asylo::platform::storage::AeadHandler;
 
 namespace asylo {
 namespace io {
+namespace {
+
+// Maximum number of iovec entries of a vectored call, UIO_MAXIOV on Linux.
+constexpr int kMaxIovecCount = 1024;
+
+// Sets |total_size| to the number of bytes spanned by |iov|. Returns false with
+// errno set if |iov| is invalid.
+bool GetIovecsSize(const struct iovec *iov, int iovcnt, size_t *total_size) {
+  if (iovcnt < 0 || iovcnt > kMaxIovecCount) {
+    errno = EINVAL;
+    return false;
+  }
+  *total_size = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    if (iov[i].iov_len > SSIZE_MAX - *total_size) {
+      errno = EINVAL;
+      return false;
+    }
+    *total_size += iov[i].iov_len;
+  }
+  return true;
+}
+
+// Restores the file offset of a secure file when going out of scope, after
+// moving it with Seek().
+class ScopedFileOffset {
+ public:
+  explicit ScopedFileOffset(int fd) : fd_(fd), saved_offset_(-1) {}
+
+  ~ScopedFileOffset() {
+    if (saved_offset_ != -1) {
+      int saved_errno = errno;
+      platform::storage::secure_lseek(fd_, saved_offset_, SEEK_SET);
+      errno = saved_errno;
+    }
+  }
+
+  // Moves the file offset to |offset|. Returns false with errno set on
+  // failure.
+  bool Seek(off_t offset) {
+    saved_offset_ = platform::storage::secure_lseek(fd_, 0, SEEK_CUR);
+    if (saved_offset_ == -1) {
+      return false;
+    }
+    return platform::storage::secure_lseek(fd_, offset, SEEK_SET) != -1;
+  }
+
+ private:
+  const int fd_;
+  off_t saved_offset_;
+};
+
+}  // namespace
+
 
 int IOContextSecure::Close() {
   return platform::storage::secure_close(host_fd_);
@@ -50,7 +110,9 @@ int IOContextSecure::LSeek(off_t offset, int whence) {
   return platform::storage::secure_lseek(host_fd_, offset, whence);
 }
 
-int IOContextSecure::FSync() { return enc_untrusted_fsync(host_fd_); }
+int IOContextSecure::FSync() {
+  return platform::storage::secure_fsync(host_fd_);
+}
 
 int IOContextSecure::FStat(struct stat *st) {
   return platform::storage::secure_fstat(host_fd_, st);
@@ -58,6 +120,59 @@ int IOContextSecure::FStat(struct stat *st) {
 
 int IOContextSecure::Isatty() { return enc_untrusted_isatty(host_fd_); }
 
+// Positional I/O on secure files runs at the file offset of the stream, which
+// is restored afterwards. The buffers of |iov| are gathered into a single one,
+// so that all the blocks in range are transferred in a single host call. The
+// preadv2() |flags| are hints that do not apply to secure files.
+ssize_t IOContextSecure::PReadv(const struct iovec *iov, int iovcnt,
+                                off_t offset, int flags) {
+  size_t total_size;
+  if (!GetIovecsSize(iov, iovcnt, &total_size)) {
+    return -1;
+  }
+  ScopedFileOffset scoped_offset(host_fd_);
+  if (offset != -1 && !scoped_offset.Seek(offset)) {
+    return -1;
+  }
+
+  std::vector<uint8_t> buffer(total_size);
+  ssize_t bytes_read =
+      platform::storage::secure_read(host_fd_, buffer.data(), buffer.size());
+  if (bytes_read <= 0) {
+    return bytes_read;
+  }
+  buffer.resize(bytes_read);
+  size_t bytes_scattered = 0;
+  for (int i = 0; i < iovcnt && bytes_scattered < buffer.size(); ++i) {
+    size_t bytes_to_copy =
+        std::min(iov[i].iov_len, buffer.size() - bytes_scattered);
+    memcpy(iov[i].iov_base, buffer.data() + bytes_scattered, bytes_to_copy);
+    bytes_scattered += bytes_to_copy;
+  }
+  return bytes_read;
+}
+
+ssize_t IOContextSecure::PWritev(const struct iovec *iov, int iovcnt,
+                                 off_t offset) {
+  size_t total_size;
+  if (!GetIovecsSize(iov, iovcnt, &total_size)) {
+    return -1;
+  }
+  ScopedFileOffset scoped_offset(host_fd_);
+  if (!scoped_offset.Seek(offset)) {
+    return -1;
+  }
+
+  std::vector<uint8_t> buffer;
+  buffer.reserve(total_size);
+  for (int i = 0; i < iovcnt; ++i) {
+    const uint8_t *base = static_cast<const uint8_t *>(iov[i].iov_base);
+    buffer.insert(buffer.end(), base, base + iov[i].iov_len);
+  }
+  return platform::storage::secure_write(host_fd_, buffer.data(),
+                                         buffer.size());
+}
+
 int IOContextSecure::Ioctl(int request, void *argp) {
   switch (request) {
     case ENCLAVE_STORAGE_SET_KEY: {
@@ -65,6 +180,12 @@ int IOContextSecure::Ioctl(int request, void *argp) {
       return AeadHandler::GetInstance().SetMasterKey(
           host_fd_, ioctl_param->data, ioctl_param->length);
     }
+    case ENCLAVE_STORAGE_SET_BLOCK_LENGTH: {
+      struct block_length_info *ioctl_param =
+          reinterpret_cast<struct block_length_info *>(argp);
+      return AeadHandler::GetInstance().SetBlockLength(host_fd_,
+                                                       ioctl_param->length);
+    }
     default:
       if (argp != nullptr) {
         errno = ENOSYS;
@@ -46,6 +46,9 @@ class IOContextSecure : public IOManager::IOContext {
   int FStat(struct stat *st) override;
   int Isatty() override;
   int Ioctl(int request, void *argp) override;
+  ssize_t PReadv(const struct iovec *iov, int iovcnt, off_t offset,
+                 int flags) override;
+  ssize_t PWritev(const struct iovec *iov, int iovcnt, off_t offset) override;
 
  private:
   explicit IOContextSecure(int host_fd) : host_fd_(host_fd) {}
@@ -18,10 +18,8 @@
 
 #include "asylo/platform/posix/io/util.h"
 
-#include <vector>
+#include <string>
 
-#include "absl/strings/str_cat.h"
-#include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
 
 namespace asylo {
@@ -29,15 +27,19 @@ namespace io {
 namespace util {
 
 std::string NormalizePath(absl::string_view path) {
-  // Collects the current view of the directories in the path.
-  std::vector<absl::string_view> directories;
+  // Build the result in place, with each directory preceded by a "/", so that
+  // normalization makes a single allocation.
+  std::string result;
+  result.reserve(path.size() + 1);
 
   // Scan through the path, finding the directories.
   size_t current_directory = 0;
   while (current_directory < path.size()) {
     // Extract the next directory name.
     size_t next_directory = path.find_first_of('/', current_directory);
-    if (next_directory == std::string::npos) next_directory = path.size();
+    if (next_directory == absl::string_view::npos) {
+      next_directory = path.size();
+    }
     absl::string_view name =
         path.substr(current_directory, next_directory - current_directory);
 
@@ -47,18 +49,21 @@ std::string NormalizePath(absl::string_view path) {
     // If the directory name is empty or ".", leave it out entirely.
     if (name.empty() || name == ".") continue;
 
-    // If the directory name is "..", back up by one.
+    // If the directory name is "..", back up by one. If already at the root,
+    // stay at the root.
     if (name == "..") {
-      // If already at the root, stay at the root.
-      if (!directories.empty()) directories.pop_back();
+      size_t last_separator = result.rfind('/');
+      if (last_separator != std::string::npos) result.resize(last_separator);
       continue;
     }
 
     // Otherwise, keep track of this directory.
-    directories.push_back(name);
+    result.push_back('/');
+    result.append(name.data(), name.size());
   }
 
-  return absl::StrCat("/", absl::StrJoin(directories, "/"));
+  if (result.empty()) result.push_back('/');
+  return result;
 }
 
 }  // namespace util
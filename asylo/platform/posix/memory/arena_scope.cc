@@ -0,0 +1,122 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include "asylo/platform/posix/memory/arena_scope.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace asylo {
+namespace {
+
+// Alignment of every arena allocation.
+constexpr size_t kArenaAlignment = alignof(std::max_align_t);
+
+// Each allocation is preceded by a header holding its size, which realloc()
+// needs to copy the allocation.
+struct alignas(kArenaAlignment) AllocationHeader {
+  size_t size;
+};
+
+size_t AlignUp(size_t size) {
+  return (size + kArenaAlignment - 1) & ~(kArenaAlignment - 1);
+}
+
+}  // namespace
+
+struct alignas(kArenaAlignment) ArenaScope::Block {
+  Block *next;
+  uint8_t *end;
+};
+
+ArenaScope::ArenaScope(size_t block_size)
+    : block_size_(std::max(AlignUp(block_size), AlignUp(4 * sizeof(Block)))),
+      hooks_{&ArenaScope::Allocate, &ArenaScope::OwnedSize, this},
+      previous_hooks_(SetThreadHeapHooks(&hooks_)) {}
+
+ArenaScope::~ArenaScope() {
+  SetThreadHeapHooks(previous_hooks_);
+  while (blocks_) {
+    Block *block = blocks_;
+    blocks_ = block->next;
+    FreeToSharedHeap(block);
+  }
+}
+
+bool ArenaScope::AddBlock(size_t size) {
+  size_t block_size = std::max(block_size_, sizeof(Block) + size);
+  void *memory = AllocateFromSharedHeap(block_size);
+  if (!memory) {
+    return false;
+  }
+  Block *block = static_cast<Block *>(memory);
+  block->next = blocks_;
+  block->end = static_cast<uint8_t *>(memory) + block_size;
+  blocks_ = block;
+  next_ = reinterpret_cast<uint8_t *>(block + 1);
+  end_ = block->end;
+  reserved_bytes_ += block_size;
+  return true;
+}
+
+void *ArenaScope::Allocate(size_t size, void *pool) {
+  ArenaScope *arena = static_cast<ArenaScope *>(pool);
+  if (size > arena->block_size_ / 4) {
+    return nullptr;
+  }
+  size_t needed = sizeof(AllocationHeader) + AlignUp(std::max<size_t>(size, 1));
+  if (static_cast<size_t>(arena->end_ - arena->next_) < needed &&
+      !arena->AddBlock(needed)) {
+    return nullptr;
+  }
+  auto header = reinterpret_cast<AllocationHeader *>(arena->next_);
+  header->size = needed - sizeof(AllocationHeader);
+  arena->next_ += needed;
+  return header + 1;
+}
+
+size_t ArenaScope::OwnedSize(const void *ptr, void *pool) {
+  ArenaScope *arena = static_cast<ArenaScope *>(pool);
+  auto address = static_cast<const uint8_t *>(ptr);
+  for (Block *block = arena->blocks_; block; block = block->next) {
+    if (address > reinterpret_cast<const uint8_t *>(block) &&
+        address < block->end) {
+      return (reinterpret_cast<const AllocationHeader *>(ptr) - 1)->size;
+    }
+  }
+  const ThreadHeapHooks *previous = arena->previous_hooks_;
+  return previous ? previous->owned_size(ptr, previous->pool) : 0;
+}
+
+SharedHeapScope::SharedHeapScope()
+    : hooks_{&SharedHeapScope::Allocate, &SharedHeapScope::OwnedSize, this},
+      previous_hooks_(SetThreadHeapHooks(&hooks_)) {}
+
+SharedHeapScope::~SharedHeapScope() { SetThreadHeapHooks(previous_hooks_); }
+
+void *SharedHeapScope::Allocate(size_t size, void *pool) { return nullptr; }
+
+size_t SharedHeapScope::OwnedSize(const void *ptr, void *pool) {
+  const ThreadHeapHooks *previous =
+      static_cast<SharedHeapScope *>(pool)->previous_hooks_;
+  return previous ? previous->owned_size(ptr, previous->pool) : 0;
+}
+
+}  // namespace asylo
@@ -0,0 +1,105 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#ifndef ASYLO_PLATFORM_POSIX_MEMORY_ARENA_SCOPE_H_
+#define ASYLO_PLATFORM_POSIX_MEMORY_ARENA_SCOPE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "asylo/platform/posix/memory/thread_cache_malloc.h"
+
+namespace asylo {
+
+// Serves the allocations of the calling thread from an arena for the lifetime
+// of the scope, and releases them all at once when the scope ends. Allocating
+// from the arena takes no lock, and freeing arena memory is a no-op, so
+// request-scoped work such as parsing and serializing protocol buffers neither
+// contends on the malloc lock nor fragments the shared heap.
+//
+// Memory allocated within the scope must not be used or freed after the scope
+// ends. Objects which outlive the scope have to be allocated within a
+// SharedHeapScope. Memory allocated before the scope may be freed within it as
+// usual.
+//
+// Scopes are bound to the thread which created them and must be destroyed in
+// the reverse order of their creation. Allocations larger than a quarter of the
+// block size are served from the shared heap. The arena only applies to
+// enclaves linking the thread cache allocator; elsewhere all allocations come
+// from the shared heap.
+class ArenaScope {
+ public:
+  // Default size of the blocks the arena carves allocations from.
+  static constexpr size_t kDefaultBlockSize = 64 * 1024;
+
+  explicit ArenaScope(size_t block_size = kDefaultBlockSize);
+  ~ArenaScope();
+
+  ArenaScope(const ArenaScope &other) = delete;
+  ArenaScope &operator=(const ArenaScope &other) = delete;
+
+  // Returns the number of bytes the arena allocated from the shared heap.
+  size_t reserved_bytes() const { return reserved_bytes_; }
+
+ private:
+  struct Block;
+
+  static void *Allocate(size_t size, void *pool);
+  static size_t OwnedSize(const void *ptr, void *pool);
+
+  // Starts a new block able to hold at least |size| bytes. Returns false if the
+  // block could not be allocated.
+  bool AddBlock(size_t size);
+
+  const size_t block_size_;
+
+  // Blocks of the arena, most recent first, and the unused range of the most
+  // recent block.
+  Block *blocks_ = nullptr;
+  uint8_t *next_ = nullptr;
+  uint8_t *end_ = nullptr;
+
+  size_t reserved_bytes_ = 0;
+
+  const ThreadHeapHooks hooks_;
+  const ThreadHeapHooks *const previous_hooks_;
+};
+
+// Within an ArenaScope, serves new allocations of the calling thread from the
+// shared heap again, for objects that outlive the arena. Memory allocated from
+// enclosing arenas can still be freed within the scope, which is a no-op.
+class SharedHeapScope {
+ public:
+  SharedHeapScope();
+  ~SharedHeapScope();
+
+  SharedHeapScope(const SharedHeapScope &other) = delete;
+  SharedHeapScope &operator=(const SharedHeapScope &other) = delete;
+
+ private:
+  static void *Allocate(size_t size, void *pool);
+  static size_t OwnedSize(const void *ptr, void *pool);
+
+  const ThreadHeapHooks hooks_;
+  const ThreadHeapHooks *const previous_hooks_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_MEMORY_ARENA_SCOPE_H_
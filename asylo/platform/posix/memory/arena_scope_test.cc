@@ -0,0 +1,143 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include "asylo/platform/posix/memory/arena_scope.h"
+
+#include <stdlib.h>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/memory/memory.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Ge;
+using ::testing::Gt;
+
+bool IsInRange(const void *ptr, const void *begin, size_t size) {
+  auto address = reinterpret_cast<uintptr_t>(ptr);
+  auto start = reinterpret_cast<uintptr_t>(begin);
+  return address >= start && address < start + size;
+}
+
+TEST(ArenaScopeTest, AllocatesContiguouslyFromArena) {
+  ArenaScope arena;
+  char *first = static_cast<char *>(malloc(24));
+  char *second = static_cast<char *>(malloc(24));
+  ASSERT_NE(first, nullptr);
+  ASSERT_NE(second, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(first) % alignof(std::max_align_t), 0);
+  EXPECT_TRUE(IsInRange(second, first, ArenaScope::kDefaultBlockSize));
+  EXPECT_THAT(arena.reserved_bytes(), Ge(ArenaScope::kDefaultBlockSize));
+  free(first);
+  free(second);
+}
+
+TEST(ArenaScopeTest, ServesStandardContainers) {
+  ArenaScope arena(/*block_size=*/4096);
+  std::vector<std::string> strings;
+  for (int i = 0; i < 100; i++) {
+    strings.push_back(std::string(40, 'a' + i % 26));
+  }
+  EXPECT_EQ(strings[99], std::string(40, 'a' + 99 % 26));
+  EXPECT_THAT(arena.reserved_bytes(), Gt(4096));
+}
+
+TEST(ArenaScopeTest, ReallocCopiesArenaMemory) {
+  ArenaScope arena;
+  char *ptr = static_cast<char *>(malloc(16));
+  ASSERT_NE(ptr, nullptr);
+  strcpy(ptr, "arena realloc");
+  EXPECT_EQ(realloc(ptr, 10), ptr);
+  ptr = static_cast<char *>(realloc(ptr, 200));
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_STREQ(ptr, "arena realloc");
+
+  uint8_t *zeroed = static_cast<uint8_t *>(calloc(8, 8));
+  ASSERT_NE(zeroed, nullptr);
+  for (int i = 0; i < 64; i++) {
+    EXPECT_EQ(zeroed[i], 0);
+  }
+}
+
+TEST(ArenaScopeTest, FreesMemoryFromBeforeTheScope) {
+  auto outer = absl::make_unique<std::string>(100, 'x');
+  {
+    ArenaScope arena;
+    outer.reset();
+    outer = absl::make_unique<std::string>(100, 'y');
+
+    // Allocations which outlive the arena come from the shared heap.
+    std::string *shared;
+    {
+      SharedHeapScope shared_heap;
+      shared = new std::string(100, 'z');
+    }
+    EXPECT_FALSE(IsInRange(shared, outer.get(), ArenaScope::kDefaultBlockSize));
+    outer.release();
+    outer.reset(shared);
+  }
+  EXPECT_EQ(*outer, std::string(100, 'z'));
+}
+
+TEST(ArenaScopeTest, LargeAllocationsComeFromSharedHeap) {
+  void *large;
+  {
+    ArenaScope arena(/*block_size=*/4096);
+    large = malloc(2048);
+    ASSERT_NE(large, nullptr);
+    EXPECT_EQ(arena.reserved_bytes(), 0);
+  }
+  free(large);
+}
+
+TEST(ArenaScopeTest, NestedScopes) {
+  ArenaScope outer;
+  char *outer_ptr = static_cast<char *>(malloc(32));
+  ASSERT_NE(outer_ptr, nullptr);
+  strcpy(outer_ptr, "outer");
+  {
+    ArenaScope inner;
+    char *inner_ptr = static_cast<char *>(malloc(32));
+    ASSERT_NE(inner_ptr, nullptr);
+    EXPECT_FALSE(
+        IsInRange(inner_ptr, outer_ptr, ArenaScope::kDefaultBlockSize));
+    EXPECT_EQ(inner.reserved_bytes(), ArenaScope::kDefaultBlockSize);
+    free(inner_ptr);
+  }
+  EXPECT_STREQ(outer_ptr, "outer");
+
+  // Freeing memory of an enclosing arena is a no-op, including from a shared
+  // heap scope.
+  {
+    ArenaScope inner;
+    SharedHeapScope shared_heap;
+    free(outer_ptr);
+  }
+}
+
+}  // namespace
+}  // namespace asylo
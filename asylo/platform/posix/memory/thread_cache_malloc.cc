@@ -0,0 +1,264 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include "asylo/platform/posix/memory/thread_cache_malloc.h"
+
+#include <malloc.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <cstring>
+
+#include "asylo/platform/posix/memory/memory.h"
+#include "asylo/platform/primitives/trusted_runtime.h"
+
+// The allocation functions are wrapped at link time with --wrap, so every call
+// to malloc(), free(), realloc() and calloc() in the enclave, including calls
+// made by the C and C++ runtimes, lands here. __real_* name the underlying
+// allocator.
+extern "C" {
+void *__real_malloc(size_t size);
+void __real_free(void *ptr);
+void *__real_realloc(void *ptr, size_t size);
+void *__real_calloc(size_t count, size_t size);
+}
+
+namespace asylo {
+namespace {
+
+// Size classes are multiples of 16 bytes up to 256 bytes, then 512 and 1024
+// bytes.
+constexpr size_t kClassGranularity = 16;
+constexpr size_t kMaxSmallClassSize = 256;
+constexpr int kNumSmallClasses = kMaxSmallClassSize / kClassGranularity;
+constexpr int kNumClasses = kNumSmallClasses + 2;
+
+static_assert(kMaxThreadCachedSize == kMaxSmallClassSize * 4,
+              "Size classes do not end at kMaxThreadCachedSize");
+
+// Returns the size of the blocks in class |size_class|.
+size_t ClassSize(int size_class) {
+  if (size_class < kNumSmallClasses) {
+    return (size_class + 1) * kClassGranularity;
+  }
+  return kMaxSmallClassSize << (size_class - kNumSmallClasses + 1);
+}
+
+// Returns the smallest class whose blocks can hold |size| bytes. |size| must
+// not be larger than kMaxThreadCachedSize.
+int ClassForRequest(size_t size) {
+  if (size <= kMaxSmallClassSize) {
+    return size == 0 ? 0 : (size - 1) / kClassGranularity;
+  }
+  return size <= 2 * kMaxSmallClassSize ? kNumSmallClasses
+                                        : kNumSmallClasses + 1;
+}
+
+// Returns the largest class whose size is at most |usable_size|, the usable
+// size of a block, or -1 if the block should not be cached.
+int ClassForBlock(size_t usable_size) {
+  if (usable_size < kClassGranularity ||
+      usable_size >= 2 * kMaxThreadCachedSize) {
+    return -1;
+  }
+  if (usable_size < 2 * kMaxSmallClassSize) {
+    return usable_size < kMaxSmallClassSize + kClassGranularity
+               ? usable_size / kClassGranularity - 1
+               : kNumSmallClasses - 1;
+  }
+  return usable_size < kMaxThreadCachedSize ? kNumSmallClasses
+                                            : kNumSmallClasses + 1;
+}
+
+// A cached block. The link is stored in the block itself.
+struct FreeBlock {
+  FreeBlock *next;
+};
+
+// The cache of the calling thread. Trivially constructible and destructible so
+// that it can live in static TLS, which the trusted runtime sets up per TCS.
+struct ThreadCache {
+  FreeBlock *blocks[kNumClasses];
+  size_t cached_bytes;
+};
+
+thread_local ThreadCache thread_cache = {};
+
+thread_local const ThreadHeapHooks *thread_heap_hooks = nullptr;
+
+std::atomic<uint64_t> thread_cache_misses{0};
+std::atomic<uint64_t> thread_cache_overflows{0};
+
+// While fork switches the heap, every allocation must come from the switched
+// heap, and the cached blocks on the regular heap must not be touched.
+bool IsHeapSwitched() { return GetSwitchedHeapNext() != nullptr; }
+
+void *CachedMalloc(size_t size) {
+  if (size > kMaxThreadCachedSize || IsHeapSwitched()) {
+    return __real_malloc(size);
+  }
+  int size_class = ClassForRequest(size);
+  FreeBlock *block = thread_cache.blocks[size_class];
+  if (!block) {
+    thread_cache_misses.fetch_add(1, std::memory_order_relaxed);
+    return __real_malloc(ClassSize(size_class));
+  }
+  thread_cache.blocks[size_class] = block->next;
+  thread_cache.cached_bytes -= ClassSize(size_class);
+  return block;
+}
+
+void CachedFree(void *ptr) {
+  if (!ptr || IsHeapSwitched()) {
+    __real_free(ptr);
+    return;
+  }
+  int size_class = ClassForBlock(malloc_usable_size(ptr));
+  if (size_class < 0) {
+    __real_free(ptr);
+    return;
+  }
+  if (thread_cache.cached_bytes + ClassSize(size_class) >
+      kMaxThreadCacheBytes) {
+    thread_cache_overflows.fetch_add(1, std::memory_order_relaxed);
+    __real_free(ptr);
+    return;
+  }
+  FreeBlock *block = static_cast<FreeBlock *>(ptr);
+  block->next = thread_cache.blocks[size_class];
+  thread_cache.blocks[size_class] = block;
+  thread_cache.cached_bytes += ClassSize(size_class);
+}
+
+// Returns the usable size of |ptr| if it is owned by the hooks of the calling
+// thread, or 0 otherwise.
+size_t HookedSize(const void *ptr) {
+  const ThreadHeapHooks *hooks = thread_heap_hooks;
+  return hooks ? hooks->owned_size(ptr, hooks->pool) : 0;
+}
+
+void *HookedMalloc(size_t size) {
+  const ThreadHeapHooks *hooks = thread_heap_hooks;
+  if (hooks && !IsHeapSwitched()) {
+    void *ptr = hooks->allocate(size, hooks->pool);
+    if (ptr) {
+      return ptr;
+    }
+  }
+  return CachedMalloc(size);
+}
+
+}  // namespace
+
+EnclaveAllocatorStats GetEnclaveAllocatorStats() {
+  EnclaveAllocatorStats stats;
+  struct EnclaveMemoryLayout layout;
+  enc_get_memory_layout(&layout);
+  stats.heap_size = layout.heap_size;
+  stats.heap_used = layout.heap_used;
+  stats.heap_peak_used = layout.heap_peak_used;
+
+  struct mallinfo info = mallinfo();
+  stats.allocated_bytes = info.uordblks;
+  stats.free_bytes = info.fordblks;
+
+  stats.thread_cache_misses =
+      thread_cache_misses.load(std::memory_order_relaxed);
+  stats.thread_cache_overflows =
+      thread_cache_overflows.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void FlushThreadAllocationCache() {
+  for (FreeBlock *&head : thread_cache.blocks) {
+    while (head) {
+      FreeBlock *block = head;
+      head = block->next;
+      __real_free(block);
+    }
+  }
+  thread_cache.cached_bytes = 0;
+}
+
+const ThreadHeapHooks *SetThreadHeapHooks(const ThreadHeapHooks *hooks) {
+  const ThreadHeapHooks *previous = thread_heap_hooks;
+  thread_heap_hooks = hooks;
+  return previous;
+}
+
+void *AllocateFromSharedHeap(size_t size) { return CachedMalloc(size); }
+
+void FreeToSharedHeap(void *ptr) { CachedFree(ptr); }
+
+}  // namespace asylo
+
+extern "C" {
+
+void *__wrap_malloc(size_t size) { return asylo::HookedMalloc(size); }
+
+void __wrap_free(void *ptr) {
+  if (ptr && asylo::HookedSize(ptr) > 0) {
+    return;
+  }
+  asylo::CachedFree(ptr);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  if (!ptr) {
+    return asylo::HookedMalloc(size);
+  }
+  size_t hooked_size = asylo::HookedSize(ptr);
+  if (hooked_size > 0) {
+    if (size <= hooked_size) {
+      return ptr;
+    }
+    void *new_ptr = asylo::HookedMalloc(size);
+    if (new_ptr) {
+      memcpy(new_ptr, ptr, hooked_size);
+    }
+    return new_ptr;
+  }
+  if (asylo::IsHeapSwitched()) {
+    return __real_realloc(ptr, size);
+  }
+  // Blocks served from the caches are at least as large as the request, so
+  // growing within the usable size needs no copy.
+  if (size > 0 && size <= malloc_usable_size(ptr)) {
+    return ptr;
+  }
+  return __real_realloc(ptr, size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+  size_t total;
+  if (__builtin_mul_overflow(count, size, &total)) {
+    return nullptr;
+  }
+  if (asylo::IsHeapSwitched() || (total > asylo::kMaxThreadCachedSize &&
+                                  !asylo::thread_heap_hooks)) {
+    return __real_calloc(count, size);
+  }
+  void *ptr = asylo::HookedMalloc(total);
+  if (ptr) {
+    memset(ptr, 0, total);
+  }
+  return ptr;
+}
+
+}  // extern "C"
@@ -0,0 +1,102 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#ifndef ASYLO_PLATFORM_POSIX_MEMORY_THREAD_CACHE_MALLOC_H_
+#define ASYLO_PLATFORM_POSIX_MEMORY_THREAD_CACHE_MALLOC_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace asylo {
+
+// The trusted heap allocator keeps a small cache of freed blocks per thread, so
+// that most small allocations and frees do not take the global malloc lock.
+// Since each enclave thread is bound to a TCS, the caches are in effect per-TCS
+// arenas in front of the shared heap.
+//
+// Blocks in a cache remain allocated as far as the underlying allocator is
+// concerned. A cache holds at most kMaxThreadCacheBytes, and blocks that do
+// not fit are returned to the shared heap, which trims its top back into the
+// sbrk region.
+
+// Largest request size served from the thread caches.
+constexpr size_t kMaxThreadCachedSize = 1024;
+
+// Largest number of bytes each thread cache holds.
+constexpr size_t kMaxThreadCacheBytes = 64 * 1024;
+
+// Statistics of the trusted heap allocator.
+struct EnclaveAllocatorStats {
+  // Size of the enclave heap, and the part of it handed out by sbrk.
+  size_t heap_size;
+  size_t heap_used;
+
+  // Largest value of |heap_used| since the enclave was loaded.
+  size_t heap_peak_used;
+
+  // Bytes in blocks allocated from the shared heap, including blocks held in
+  // thread caches, and bytes in free blocks of the shared heap.
+  size_t allocated_bytes;
+  size_t free_bytes;
+
+  // Number of cacheable allocations that found the calling thread's cache
+  // empty and went to the shared heap.
+  uint64_t thread_cache_misses;
+
+  // Number of freed blocks returned to the shared heap because the calling
+  // thread's cache was full.
+  uint64_t thread_cache_overflows;
+};
+
+// Returns statistics of the trusted heap allocator. Takes the global malloc
+// lock.
+EnclaveAllocatorStats GetEnclaveAllocatorStats();
+
+// Returns all blocks cached by the calling thread to the shared heap.
+void FlushThreadAllocationCache();
+
+// Allocation hooks of a single thread, consulted before its cache. Unlike the
+// hooks installed by heap_switch(), they only apply to the thread that installed
+// them.
+struct ThreadHeapHooks {
+  // Allocates |size| bytes, or returns nullptr to allocate from the shared heap
+  // instead.
+  void *(*allocate)(size_t size, void *pool);
+
+  // Returns the usable size of |ptr| if the hooks own it, or 0 otherwise.
+  // Freeing an owned pointer is a no-op.
+  size_t (*owned_size)(const void *ptr, void *pool);
+
+  // Opaque value passed to the hooks.
+  void *pool;
+};
+
+// Installs |hooks| for the calling thread and returns the hooks installed
+// before, or nullptr if there were none. Passing nullptr removes the hooks.
+// |hooks| must stay valid until replaced.
+const ThreadHeapHooks *SetThreadHeapHooks(const ThreadHeapHooks *hooks);
+
+// Allocates from and frees to the shared heap, bypassing the hooks of the
+// calling thread.
+void *AllocateFromSharedHeap(size_t size);
+void FreeToSharedHeap(void *ptr);
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_MEMORY_THREAD_CACHE_MALLOC_H_
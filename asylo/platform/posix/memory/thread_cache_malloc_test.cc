@@ -0,0 +1,151 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include "asylo/platform/posix/memory/thread_cache_malloc.h"
+
+#include <malloc.h>
+#include <stdlib.h>
+
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace asylo {
+namespace {
+
+TEST(ThreadCacheMallocTest, ReusesFreedBlocks) {
+  FlushThreadAllocationCache();
+  void *first = malloc(40);
+  ASSERT_NE(first, nullptr);
+  free(first);
+  void *second = malloc(40);
+  EXPECT_EQ(second, first);
+  free(second);
+}
+
+TEST(ThreadCacheMallocTest, BlocksHoldRequestedSize) {
+  for (size_t size = 0; size <= 2 * kMaxThreadCachedSize; size += 8) {
+    void *ptr = malloc(size);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_GE(malloc_usable_size(ptr), size);
+    memset(ptr, 0xa5, size);
+    free(ptr);
+  }
+}
+
+TEST(ThreadCacheMallocTest, CallocZeroesReusedBlocks) {
+  void *ptr = malloc(64);
+  ASSERT_NE(ptr, nullptr);
+  memset(ptr, 0xff, 64);
+  free(ptr);
+
+  uint8_t *zeroed = static_cast<uint8_t *>(calloc(4, 16));
+  ASSERT_NE(zeroed, nullptr);
+  for (int i = 0; i < 64; i++) {
+    EXPECT_EQ(zeroed[i], 0);
+  }
+  free(zeroed);
+
+  volatile size_t count = SIZE_MAX / 2;
+  EXPECT_EQ(calloc(count, 4), nullptr);
+}
+
+TEST(ThreadCacheMallocTest, ReallocKeepsContents) {
+  char *ptr = static_cast<char *>(malloc(20));
+  ASSERT_NE(ptr, nullptr);
+  strcpy(ptr, "thread cache");
+  ptr = static_cast<char *>(realloc(ptr, 4000));
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_STREQ(ptr, "thread cache");
+  ptr = static_cast<char *>(realloc(ptr, 30));
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_STREQ(ptr, "thread cache");
+  free(ptr);
+}
+
+TEST(ThreadCacheMallocTest, CacheIsBounded) {
+  FlushThreadAllocationCache();
+  uint64_t overflows = GetEnclaveAllocatorStats().thread_cache_overflows;
+
+  // Freeing more than the cache can hold returns the excess to the heap.
+  std::vector<void *> blocks;
+  for (size_t i = 0; i < 2 * kMaxThreadCacheBytes / kMaxThreadCachedSize;
+       i++) {
+    blocks.push_back(malloc(kMaxThreadCachedSize));
+  }
+  for (void *block : blocks) {
+    free(block);
+  }
+  EXPECT_GT(GetEnclaveAllocatorStats().thread_cache_overflows, overflows);
+  FlushThreadAllocationCache();
+}
+
+TEST(ThreadCacheMallocTest, ReportsHeapStats) {
+  EnclaveAllocatorStats before = GetEnclaveAllocatorStats();
+  EXPECT_GT(before.heap_size, 0);
+  EXPECT_LE(before.heap_used, before.heap_size);
+
+  void *ptr = malloc(64 * 1024);
+  ASSERT_NE(ptr, nullptr);
+  EnclaveAllocatorStats during = GetEnclaveAllocatorStats();
+  EXPECT_GE(during.allocated_bytes, before.allocated_bytes + 64 * 1024);
+  EXPECT_GE(during.heap_used, during.allocated_bytes);
+  EXPECT_GE(during.heap_peak_used, during.heap_used);
+  free(ptr);
+}
+
+TEST(ThreadCacheMallocTest, BlocksMoveBetweenThreads) {
+  constexpr int kNumThreads = 4;
+  constexpr int kNumBlocks = 256;
+  std::vector<std::vector<void *>> blocks(kNumThreads);
+  std::vector<std::thread> threads;
+
+  // Blocks allocated on one thread may be freed on another.
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&blocks, i] {
+      for (int j = 0; j < kNumBlocks; j++) {
+        void *ptr = malloc(16 + j % 512);
+        memset(ptr, i, 16);
+        blocks[i].push_back(ptr);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  threads.clear();
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&blocks, i] {
+      for (void *ptr : blocks[(i + 1) % kNumThreads]) {
+        free(ptr);
+      }
+      FlushThreadAllocationCache();
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+}  // namespace
+}  // namespace asylo
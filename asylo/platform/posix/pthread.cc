@@ -21,7 +21,9 @@
 #include <signal.h>
 #include <sys/mman.h>
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <bitset>
 #include <cerrno>
 #include <cstdio>
@@ -30,6 +32,7 @@
 #include <type_traits>
 
 #include "asylo/platform/common/enclave_state.h"
+#include "asylo/platform/common/enclave_trace.h"
 #include "asylo/platform/common/time_util.h"
 #include "asylo/platform/core/atomic.h"
 #include "asylo/platform/core/trusted_global_state.h"
@@ -45,10 +48,50 @@ namespace {
 
 constexpr size_t kNumSpinLockAttempts = 10000;
 
-static void (*tsd_destructors[PTHREAD_KEYS_MAX])(void *) = {0};
-static pthread_rwlock_t key_lock = PTHREAD_RWLOCK_INITIALIZER;
-static void NoDestructor(void *dummy) {}
-size_t __pthread_tsd_size = sizeof(void *) * PTHREAD_KEYS_MAX;
+// Bounds on the number of times pthread_mutex_lock spins on a contended mutex
+// before sleeping on its untrusted wait queue, which requires enclave exits.
+constexpr uint32_t kMinMutexSpinAttempts = 100;
+constexpr uint32_t kMaxMutexSpinAttempts = kNumSpinLockAttempts;
+
+// Number of slots in the table of mutex spin estimates.
+constexpr size_t kMutexSpinEstimateSlots = 256;
+
+// Per-mutex estimates of the number of spins needed to acquire a contended
+// mutex, which tracks how long the mutex is typically held. pthread_mutex_t
+// has no room for the estimate, so mutexes are hashed by address into a fixed
+// table. A collision only makes two mutexes share a heuristic.
+std::atomic<uint32_t> mutex_spin_estimates[kMutexSpinEstimateSlots];
+
+// Contention statistics aggregated over all mutexes.
+struct {
+  std::atomic<uint64_t> contended_acquisitions;
+  std::atomic<uint64_t> spin_acquisitions;
+  std::atomic<uint64_t> sleeps;
+  std::atomic<uint64_t> spin_iterations;
+} mutex_stats;
+
+// Maximum number of passes over the thread-specific data of an exiting thread
+// made to run destructors, since destructors may set new values.
+constexpr int kThreadSpecificDataDestructorIterations = 4;
+
+// A thread's value for a pthread key, tagged with the generation of the key it
+// was set for.
+struct ThreadSpecificDataSlot {
+  void *value;
+  uint64_t generation;
+};
+
+// Generation of each pthread key. A key is allocated while its generation is
+// odd, and each allocation creates a new generation, so that a key which is
+// deleted and allocated again never observes values set for an earlier
+// generation. Keys are allocated and deleted with a single compare-and-swap,
+// and reading a key's generation never takes a lock.
+std::atomic<uint64_t> tsd_generations[PTHREAD_KEYS_MAX];
+
+// Destructor registered for each allocated pthread key, or nullptr.
+std::atomic<void (*)(void *)> tsd_destructors[PTHREAD_KEYS_MAX];
+
+size_t __pthread_tsd_size = sizeof(ThreadSpecificDataSlot) * PTHREAD_KEYS_MAX;
 
 inline int pthread_spin_lock(pthread_spinlock_t *lock) {
   constexpr unsigned int kLocked = 1;
@@ -122,75 +165,145 @@ int pthread_mutex_check_parameter(pthread_mutex_t *mutex) {
   return 0;
 }
 
-// Returns locks the mutex and returns 0 if possible. Returns EBUSY if the mutex
-// is taken. |mutex|->_lock must be locked.
-int pthread_mutex_lock_internal(pthread_mutex_t *mutex) {
-  const pthread_t self = pthread_self();
-
-  if (mutex->_control == PTHREAD_MUTEX_RECURSIVE && mutex->_owner == self) {
+// Attempts to acquire |mutex| for the calling thread |self| with a single
+// compare-and-swap of its owner, also handling recursive acquisition. Returns 0
+// on success or EBUSY if the mutex is held.
+int pthread_mutex_lock_internal(pthread_mutex_t *mutex, pthread_t self) {
+  pthread_t owner = PTHREAD_T_NULL;
+  if (asylo::AtomicCompareExchange(&mutex->_owner, &owner, self,
+                                   /*weak=*/false)) {
+    mutex->_refcount = 1;
+    return 0;
+  }
+  if (owner == self && mutex->_control == PTHREAD_MUTEX_RECURSIVE) {
     mutex->_refcount++;
     return 0;
   }
+  return EBUSY;
+}
 
-  if (mutex->_owner != PTHREAD_T_NULL) {
-    return EBUSY;
-  }
-  mutex->_owner = self;
-  mutex->_refcount++;
-  if (mutex->_untrusted_wait_queue) {
-    enc_untrusted_enable_waiting(mutex->_untrusted_wait_queue);
+// Returns the spin estimate slot for |mutex|.
+std::atomic<uint32_t> *mutex_spin_estimate(const pthread_mutex_t *mutex) {
+  uintptr_t address = reinterpret_cast<uintptr_t>(mutex);
+  return &mutex_spin_estimates[(address / alignof(pthread_mutex_t)) %
+                               kMutexSpinEstimateSlots];
+}
+
+// Spins on a contended |mutex| for at most |budget| attempts. Returns the
+// number of spins it took to acquire the mutex, or |budget| if it was not
+// acquired, in which case |acquired| is set to false.
+uint32_t pthread_mutex_spin(pthread_mutex_t *mutex, pthread_t self,
+                            uint32_t budget, bool *acquired) {
+  for (uint32_t i = 0; i < budget; i++) {
+    // Only attempt the compare-and-swap once the mutex appears free, to avoid
+    // bouncing its cache line between spinning threads.
+    if (__atomic_load_n(&mutex->_owner, __ATOMIC_RELAXED) == PTHREAD_T_NULL &&
+        pthread_mutex_lock_internal(mutex, self) == 0) {
+      *acquired = true;
+      return i;
+    }
+    enc_pause();
   }
-  return 0;
+  *acquired = false;
+  return budget;
 }
 
-// Read locks the given |rwlock| if possible and returns 0. On success,
-// |rwlock|._readers is incremented. Returns EBUSY if the |rwlock| is write
-// locked. |rwlock|._lock must be locked by the caller.
-int pthread_rwlock_tryrdlock_internal(pthread_rwlock_t *rwlock) {
-  // If |rwlock| is owned by a writer it is not read lockable.
-  if (rwlock->_write_owner != PTHREAD_T_NULL) {
-    return EBUSY;
+// Initializes the untrusted futex word of |lockable|, a condition variable or
+// rwlock, and sets it to the current value of its |_sequence| counter. The
+// word is only published once it holds the sequence number, so no thread can
+// wait on a stale value. Does nothing if the enclave is not yet running.
+template <class LockableType>
+void initialize_sequence_wait_queue(LockableType *lockable) {
+  LockableGuard lock_guard(lockable);
+  if (lockable->_untrusted_wait_queue) {
+    return;
+  }
+  int32_t *wait_queue = nullptr;
+  initialize_wait_queue(&wait_queue);
+  if (wait_queue) {
+    enc_untrusted_wait_queue_set_value(
+        wait_queue, static_cast<int32_t>(lockable->_sequence));
+    __atomic_store_n(&lockable->_untrusted_wait_queue, wait_queue,
+                     __ATOMIC_RELEASE);
   }
+}
 
-  rwlock->_reader_count++;
-#ifdef _ASYLO_PTHREAD_RWLOCK_TRANSITIONAL_FLAG
-  if (rwlock->_untrusted_wait_queue) {
-    enc_untrusted_enable_waiting(rwlock->_untrusted_wait_queue);
+// Wakes up to |num_threads| threads sleeping on the futex word |wait_queue| of
+// |lockable|. Advances the |_sequence| counter of |lockable| and publishes it to
+// the futex word, so that a thread which sampled an earlier sequence number
+// does not go to sleep, then issues a single futex wake. The update is made
+// under the lock of |lockable| so that the futex word never moves backwards.
+template <class LockableType>
+void futex_sequence_wake(LockableType *lockable, int32_t *wait_queue,
+                         int num_threads) {
+  {
+    LockableGuard lock_guard(lockable);
+    uint32_t sequence =
+        __atomic_add_fetch(&lockable->_sequence, 1, __ATOMIC_SEQ_CST);
+    enc_untrusted_wait_queue_set_value(wait_queue,
+                                       static_cast<int32_t>(sequence));
   }
-#endif
+  enc_untrusted_notify(wait_queue, num_threads);
+}
+
+// Bit of pthread_rwlock_t::_state that is set while the rwlock is write
+// locked. The remaining bits hold the number of readers holding the rwlock.
+constexpr uint32_t kRwlockWriteLocked = 1u << 31;
+
+// Read locks the given |rwlock| if possible and returns 0. An uncontended read
+// lock is a single compare-and-swap of |rwlock|._state. Returns EBUSY if the
+// |rwlock| is write locked.
+int pthread_rwlock_tryrdlock_internal(pthread_rwlock_t *rwlock) {
+  uint32_t state = __atomic_load_n(&rwlock->_state, __ATOMIC_RELAXED);
+  do {
+    // If |rwlock| is owned by a writer it is not read lockable.
+    if (state & kRwlockWriteLocked) {
+      return EBUSY;
+    }
+  } while (!asylo::AtomicCompareExchange(&rwlock->_state, &state, state + 1,
+                                         /*weak=*/true,
+                                         std::memory_order_acquire,
+                                         std::memory_order_relaxed));
   return 0;
 }
 
 // Write locks the given |rwlock| if possible and returns 0. On success,
-// |rwlock|._write_owner is set to pthread_self().  Returns EBUSY if the
-// |rwlock| is write locked or read locked. |rwlock|._lock must be locked by the
-// caller.
+// |rwlock|._write_owner is set to pthread_self(). Returns EBUSY if the
+// |rwlock| is write locked or read locked, or EDEADLK if it is write locked by
+// the calling thread.
 int pthread_rwlock_trywrlock_internal(pthread_rwlock_t *rwlock) {
-  // If |rwlock| is owned by a reader it is not write lockable.
-  if (rwlock->_reader_count != 0) {
-    return EBUSY;
-  }
-
   // If |rwlock| is owned by the current thread there is a deadlock.
   const pthread_t self = pthread_self();
-  if (rwlock->_write_owner == self) {
+  if (__atomic_load_n(&rwlock->_write_owner, __ATOMIC_RELAXED) == self) {
     return EDEADLK;
   }
 
-  // If |rwlock| is owned by another writer it is not write lockable.
-  if (rwlock->_write_owner != PTHREAD_T_NULL) {
+  // If |rwlock| is owned by readers or another writer it is not write
+  // lockable. Check before the compare-and-swap to avoid bouncing the cache
+  // line of a contended rwlock between spinning writers.
+  uint32_t state = __atomic_load_n(&rwlock->_state, __ATOMIC_RELAXED);
+  if (state != 0 ||
+      !asylo::AtomicCompareExchange(&rwlock->_state, &state,
+                                    kRwlockWriteLocked, /*weak=*/false,
+                                    std::memory_order_acquire,
+                                    std::memory_order_relaxed)) {
     return EBUSY;
   }
 
-  rwlock->_write_owner = self;
-#ifdef _ASYLO_PTHREAD_RWLOCK_TRANSITIONAL_FLAG
-  if (rwlock->_untrusted_wait_queue) {
-    enc_untrusted_enable_waiting(rwlock->_untrusted_wait_queue);
-  }
-#endif
+  __atomic_store_n(&rwlock->_write_owner, self, __ATOMIC_RELAXED);
   return 0;
 }
 
+// Wakes every thread sleeping on |rwlock| after it became free. Only exits the
+// enclave if a thread is waiting.
+void pthread_rwlock_wake(pthread_rwlock_t *rwlock) {
+  int32_t *const wait_queue =
+      __atomic_load_n(&rwlock->_untrusted_wait_queue, __ATOMIC_ACQUIRE);
+  if (wait_queue && __atomic_load_n(&rwlock->_waiters, __ATOMIC_SEQ_CST) > 0) {
+    futex_sequence_wake(rwlock, wait_queue, INT_MAX);
+  }
+}
+
 // Small utility function to "convert" a return value into an errno value. The
 // sem_* functions indicate errors by returning -1 and setting the global errno
 // variable to the error value. Unfortunately, this is different than the
@@ -219,77 +332,101 @@ asylo::ThreadManager::ThreadOptions CreateOptions(
 
 // Acquires |rwlock| with a read lock or a write lock if |TryLockFunc| is
 // set to pthread_rwlock_tryrdlock_internal() or
-// pthread_rwlock_trywrlock_internal() respectively.
+// pthread_rwlock_trywrlock_internal() respectively. A contended acquisition
+// spins for a while, then sleeps on the futex word of |rwlock| until the
+// rwlock becomes free.
 template <int(TryLockFunc)(pthread_rwlock_t *)>
 int pthread_rwlock_lock(pthread_rwlock_t *rwlock) {
   if (!asylo::primitives::IsValidEnclaveAddress<pthread_rwlock_t>(rwlock)) {
     return ConvertToErrno(EFAULT);
   }
 
-#ifdef _ASYLO_PTHREAD_RWLOCK_TRANSITIONAL_FLAG
-  if (!rwlock->_untrusted_wait_queue) {
-    LockableGuard lock_guard(rwlock);
-    initialize_wait_queue(&rwlock->_untrusted_wait_queue);
+  int ret = TryLockFunc(rwlock);
+  if (ret != EBUSY) {
+    return ret;
   }
-#endif
 
-  const pthread_t self = pthread_self();
-  asylo::pthread_impl::QueueOperations queue(rwlock);
-  int ret = 0;
-  {
-    LockableGuard lock_guard(rwlock);
+  // A thread holding the write lock can never acquire a read lock.
+  if (__atomic_load_n(&rwlock->_write_owner, __ATOMIC_RELAXED) ==
+      pthread_self()) {
+    return EDEADLK;
+  }
+
+  for (int i = 0; i < kNumSpinLockAttempts; i++) {
+    enc_pause();
     ret = TryLockFunc(rwlock);
-    if (ret == 0) {
-      return 0;
-    }
-    if (queue.Contains(self)) {
-      return EDEADLK;
+    if (ret != EBUSY) {
+      return ret;
     }
   }
 
-  while (ret == EBUSY) {
-    for (int i = 0; i < kNumSpinLockAttempts; i++) {
-      {
-        LockableGuard lock_guard(rwlock);
-        ret = TryLockFunc(rwlock);
-        if (ret == 0) {
-          return 0;
-        }
+  if (!rwlock->_untrusted_wait_queue) {
+    initialize_sequence_wait_queue(rwlock);
+  }
+
+  while (true) {
+    int32_t *const wait_queue =
+        __atomic_load_n(&rwlock->_untrusted_wait_queue, __ATOMIC_ACQUIRE);
+    if (!wait_queue) {
+      enc_pause();
+      ret = TryLockFunc(rwlock);
+      if (ret != EBUSY) {
+        return ret;
       }
+      continue;
     }
-    {
-      LockableGuard lock_guard(rwlock);
-      queue.Enqueue(self);
-    }
-#ifdef _ASYLO_PTHREAD_RWLOCK_TRANSITIONAL_FLAG
-    if (rwlock->_untrusted_wait_queue) {
-      enc_untrusted_thread_wait(rwlock->_untrusted_wait_queue);
+
+    // Register as a waiter and sample the sequence number before re-checking
+    // the rwlock. A thread releasing the rwlock after the re-check sees the
+    // waiter and advances the sequence number, so the futex wait below returns
+    // immediately instead of missing the wakeup.
+    __atomic_add_fetch(&rwlock->_waiters, 1, __ATOMIC_SEQ_CST);
+    const uint32_t sequence =
+        __atomic_load_n(&rwlock->_sequence, __ATOMIC_SEQ_CST);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    ret = TryLockFunc(rwlock);
+    if (ret == EBUSY) {
+      enc_untrusted_thread_wait_value(wait_queue,
+                                      static_cast<int32_t>(sequence));
     }
-#else
-    enc_pause();
-#endif
-    {
-      LockableGuard lock_guard(rwlock);
-      queue.Remove(self);
+    __atomic_sub_fetch(&rwlock->_waiters, 1, __ATOMIC_SEQ_CST);
+    if (ret != EBUSY) {
+      return ret;
     }
   }
+}
 
-  return ret;
+// Returns the thread-specific data slots of the calling thread.
+ThreadSpecificDataSlot *thread_specific_data() {
+  return reinterpret_cast<ThreadSpecificDataSlot *>(
+      reinterpret_cast<struct __pthread_info *>(pthread_self())->tsd);
 }
 
+// Runs the destructors of the calling thread's non-null thread-specific values,
+// repeating while destructors set new values.
 void pthread_tsd_run_destructors() {
-  struct __pthread_info *self =
-      reinterpret_cast<struct __pthread_info *>(pthread_self());
-  pthread_rwlock_rdlock(&key_lock);
-  for (int i = 0; i < PTHREAD_KEYS_MAX; ++i) {
-    void *val = self->tsd[i];
-    void (*destructor)(void *) = tsd_destructors[i];
-    self->tsd[i] = nullptr;
-    if (val && destructor && destructor != NoDestructor) {
-      destructor(val);
+  ThreadSpecificDataSlot *tsd = thread_specific_data();
+  for (int iteration = 0; iteration < kThreadSpecificDataDestructorIterations;
+       iteration++) {
+    bool ran_destructor = false;
+    for (int i = 0; i < PTHREAD_KEYS_MAX; ++i) {
+      uint64_t generation = tsd_generations[i].load(std::memory_order_acquire);
+      void *val = tsd[i].value;
+      if (!val || tsd[i].generation != generation || generation % 2 == 0) {
+        continue;
+      }
+      tsd[i].value = nullptr;
+      void (*destructor)(void *) =
+          tsd_destructors[i].load(std::memory_order_acquire);
+      if (destructor) {
+        destructor(val);
+        ran_destructor = true;
+      }
+    }
+    if (!ran_destructor) {
+      return;
     }
   }
-  pthread_rwlock_unlock(&key_lock);
 }
 
 struct start_args {
@@ -301,9 +438,12 @@ int start(void *p) {
   struct start_args *args = reinterpret_cast<struct start_args *>(p);
   asylo::ThreadManager *const thread_manager =
       asylo::ThreadManager::GetInstance();
+  // Register the thread-specific data destructors as the first cleanup routine,
+  // so that they run after any cleanup handlers still pushed when the thread
+  // returns.
+  thread_manager->PushCleanupRoutine(pthread_tsd_run_destructors);
   thread_manager->UpdateThreadResult(pthread_self(),
                                      args->start_func(args->start_arg));
-  pthread_tsd_run_destructors();
   return 0;
 }
 
@@ -411,6 +551,18 @@ bool QueueOperations::Empty() const {
   return current == nullptr;
 }
 
+MutexContentionStats GetMutexContentionStats() {
+  MutexContentionStats stats;
+  stats.contended_acquisitions =
+      mutex_stats.contended_acquisitions.load(std::memory_order_relaxed);
+  stats.spin_acquisitions =
+      mutex_stats.spin_acquisitions.load(std::memory_order_relaxed);
+  stats.sleeps = mutex_stats.sleeps.load(std::memory_order_relaxed);
+  stats.spin_iterations =
+      mutex_stats.spin_iterations.load(std::memory_order_relaxed);
+  return stats;
+}
+
 }  //  namespace pthread_impl
 }  //  namespace asylo
 
@@ -482,32 +634,39 @@ int pthread_key_create(pthread_key_t *key, void (*destructor)(void *)) {
   if (!CheckAndAllocateThreadSpecificData()) {
     return -1;
   }
-  if (!destructor) {
-    destructor = NoDestructor;
-  }
-  pthread_rwlock_wrlock(&key_lock);
   for (pthread_key_t next_key = 0; next_key < PTHREAD_KEYS_MAX; ++next_key) {
-    if (!tsd_destructors[next_key]) {
-      tsd_destructors[next_key] = destructor;
+    uint64_t generation =
+        tsd_generations[next_key].load(std::memory_order_relaxed);
+    if (generation % 2 == 0 &&
+        tsd_generations[next_key].compare_exchange_strong(
+            generation, generation + 1, std::memory_order_acq_rel)) {
+      tsd_destructors[next_key].store(destructor, std::memory_order_release);
       *key = next_key;
-      pthread_rwlock_unlock(&key_lock);
       return 0;
     }
   }
-  pthread_rwlock_unlock(&key_lock);
   return EAGAIN;
 }
 
 int pthread_key_delete(pthread_key_t key) {
-  if (key > PTHREAD_KEYS_MAX) {
+  if (key >= PTHREAD_KEYS_MAX) {
+    return EINVAL;
+  }
+  uint64_t generation = tsd_generations[key].load(std::memory_order_relaxed);
+  if (generation % 2 == 0) {
+    return EINVAL;
+  }
+  tsd_destructors[key].store(nullptr, std::memory_order_relaxed);
+  if (!tsd_generations[key].compare_exchange_strong(
+          generation, generation + 1, std::memory_order_acq_rel)) {
     return EINVAL;
   }
-  pthread_rwlock_wrlock(&key_lock);
-  tsd_destructors[key] = nullptr;
-  pthread_rwlock_unlock(&key_lock);
   return 0;
 }
 
+// Returns the calling thread's value for |key|. A lookup is a check of the
+// calling thread's slot against the key's current generation, without locks or
+// atomic read-modify-write operations.
 void *pthread_getspecific(pthread_key_t key) {
   // Behavior if the key wasn't obtained through pthread_key_create is
   // undefined.
@@ -518,8 +677,11 @@ void *pthread_getspecific(pthread_key_t key) {
   if (!CheckAndAllocateThreadSpecificData()) {
     return nullptr;
   }
-  auto self = reinterpret_cast<struct __pthread_info *>(pthread_self());
-  return self->tsd[key];
+  const ThreadSpecificDataSlot &slot = thread_specific_data()[key];
+  if (slot.generation != tsd_generations[key].load(std::memory_order_relaxed)) {
+    return nullptr;
+  }
+  return slot.value;
 }
 
 int pthread_setspecific(pthread_key_t key, const void *value) {
@@ -531,10 +693,12 @@ int pthread_setspecific(pthread_key_t key, const void *value) {
   if (!CheckAndAllocateThreadSpecificData()) {
     return -1;
   }
-  auto self = reinterpret_cast<struct __pthread_info *>(pthread_self());
-  self->tsd[key] = const_cast<void *>(value);
+  ThreadSpecificDataSlot &slot = thread_specific_data()[key];
+  slot.value = const_cast<void *>(value);
+  slot.generation = tsd_generations[key].load(std::memory_order_relaxed);
   return 0;
 }
+
 // Initializes |mutex|, |attr| is unused.
 int pthread_mutex_init(pthread_mutex_t *mutex,
                        const pthread_mutexattr_t *attr) {
@@ -561,7 +725,9 @@ int pthread_mutex_destroy(pthread_mutex_t *mutex) {
   return 0;
 }
 
-// Locks |mutex|.
+// Locks |mutex|. An uncontended acquisition is a single compare-and-swap. A
+// contended one spins for an adaptive number of attempts derived from how long
+// the mutex was recently held, then sleeps on the untrusted wait queue.
 int pthread_mutex_lock(pthread_mutex_t *mutex) {
   int ret = pthread_mutex_check_parameter(mutex);
   if (ret != 0) {
@@ -569,7 +735,11 @@ int pthread_mutex_lock(pthread_mutex_t *mutex) {
   }
 
   const pthread_t self = pthread_self();
-  asylo::pthread_impl::QueueOperations list(mutex);
+  if (pthread_mutex_lock_internal(mutex, self) == 0) {
+    return 0;
+  }
+  mutex_stats.contended_acquisitions.fetch_add(1, std::memory_order_relaxed);
+  asylo::TraceEnclaveEvent(asylo::EnclaveTraceEvent::kMutexContended);
 
   if (!mutex->_untrusted_wait_queue) {
     LockableGuard lock_guard(mutex);
@@ -577,29 +747,62 @@ int pthread_mutex_lock(pthread_mutex_t *mutex) {
     initialize_wait_queue(&mutex->_untrusted_wait_queue);
   }
 
+  asylo::pthread_impl::QueueOperations list(mutex);
+  std::atomic<uint32_t> *estimate = mutex_spin_estimate(mutex);
   while (true) {
-    for (int i = 0; i < kNumSpinLockAttempts; i++) {
-      {
-        LockableGuard lock_guard(mutex);
-        ret = pthread_mutex_lock_internal(mutex);
-      }
-      if (ret == 0) {
-        return ret;
+    // Spin for up to twice the current estimate. Spins that fail push the
+    // estimate up towards the budget, so that mutexes held for longer earn a
+    // longer budget, while quick acquisitions pull it back down.
+    uint32_t current = estimate->load(std::memory_order_relaxed);
+    uint32_t budget =
+        std::min(kMaxMutexSpinAttempts, 2 * current + kMinMutexSpinAttempts);
+    bool acquired;
+    uint32_t spins = pthread_mutex_spin(mutex, self, budget, &acquired);
+    mutex_stats.spin_iterations.fetch_add(spins, std::memory_order_relaxed);
+    int32_t delta = (static_cast<int32_t>(spins) -
+                     static_cast<int32_t>(current)) / 8;
+    estimate->store(current + delta, std::memory_order_relaxed);
+    if (acquired) {
+      mutex_stats.spin_acquisitions.fetch_add(1, std::memory_order_relaxed);
+      asylo::TraceEnclaveEvent(asylo::EnclaveTraceEvent::kMutexAcquired,
+                               spins);
+      // A woken waiter may have disabled waiting while other threads remain
+      // asleep. Re-enable it so that this thread's unlock wakes the next one.
+      if (mutex->_untrusted_wait_queue && !list.Empty()) {
+        enc_untrusted_enable_waiting(mutex->_untrusted_wait_queue);
       }
+      return 0;
     }
-    // Sleep on an untrusted wait queue until woken up. Waiting will
-    // be enabled if the lock is held, as the holder of the lock is
-    // responsible for enabling and disabling waiting.
-    if (mutex->_untrusted_wait_queue) {
-      {
-        LockableGuard lock_guard(mutex);
-        list.Enqueue(self);
-      }
+
+    // Sleep on an untrusted wait queue until woken up. The waiter enables
+    // waiting itself, and re-checks the mutex after enqueueing so that an
+    // unlock racing with the enqueue is not missed: the unlocking thread
+    // releases the owner before checking for waiters, and disables waiting
+    // before notifying one of them.
+    if (!mutex->_untrusted_wait_queue) {
+      continue;
+    }
+    {
+      LockableGuard lock_guard(mutex);
+      list.Enqueue(self);
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    enc_untrusted_enable_waiting(mutex->_untrusted_wait_queue);
+    ret = pthread_mutex_lock_internal(mutex, self);
+    if (ret != 0) {
+      mutex_stats.sleeps.fetch_add(1, std::memory_order_relaxed);
+      asylo::TraceEnclaveEvent(asylo::EnclaveTraceEvent::kMutexSleep,
+                               spins);
       enc_untrusted_thread_wait(mutex->_untrusted_wait_queue);
-      {
-        LockableGuard lock_guard(mutex);
-        list.Remove(self);
-      }
+    }
+    {
+      LockableGuard lock_guard(mutex);
+      list.Remove(self);
+    }
+    if (ret == 0) {
+      asylo::TraceEnclaveEvent(asylo::EnclaveTraceEvent::kMutexAcquired,
+                               spins);
+      return 0;
     }
   }
 }
@@ -610,9 +813,7 @@ int pthread_mutex_trylock(pthread_mutex_t *mutex) {
     return ret;
   }
 
-  LockableGuard lock_guard(mutex);
-  ret = pthread_mutex_lock_internal(mutex);
-  return ret;
+  return pthread_mutex_lock_internal(mutex, pthread_self());
 }
 
 // Unlocks |mutex|.
@@ -622,28 +823,28 @@ int pthread_mutex_unlock(pthread_mutex_t *mutex) {
     return ret;
   }
 
-  asylo::pthread_impl::QueueOperations list(mutex);
-  LockableGuard lock_guard(mutex);
-
-  if (mutex->_owner == PTHREAD_T_NULL) {
+  const pthread_t owner = __atomic_load_n(&mutex->_owner, __ATOMIC_RELAXED);
+  if (owner == PTHREAD_T_NULL) {
     return EINVAL;
   }
 
-  if (mutex->_owner != pthread_self()) {
+  if (owner != pthread_self()) {
     return EPERM;
   }
 
-  mutex->_refcount--;
-  // If we change state from locked to unlocked
-  if (mutex->_refcount == 0) {
-    mutex->_owner = PTHREAD_T_NULL;
-    if (mutex->_untrusted_wait_queue) {
-      enc_untrusted_disable_waiting(mutex->_untrusted_wait_queue);
-      // Only notify if there is a thread to notify
-      if (!list.Empty()) {
-        enc_untrusted_notify(mutex->_untrusted_wait_queue);
-      }
-    }
+  // Nested recursive unlocks leave the mutex held.
+  if (--mutex->_refcount > 0) {
+    return 0;
+  }
+
+  asylo::AtomicStore(&mutex->_owner, PTHREAD_T_NULL);
+  // Only exit the enclave to notify if there is a thread to notify, and no
+  // notification since waiting was last enabled is still pending.
+  if (mutex->_untrusted_wait_queue &&
+      __atomic_load_n(&mutex->_queue._first, __ATOMIC_SEQ_CST) != nullptr &&
+      enc_untrusted_is_waiting_enabled(mutex->_untrusted_wait_queue)) {
+    enc_untrusted_disable_waiting(mutex->_untrusted_wait_queue);
+    enc_untrusted_notify(mutex->_untrusted_wait_queue);
   }
 
   return 0;
@@ -700,129 +901,66 @@ int pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex,
     return EFAULT;
   }
 
-  // Get the current thread ID to use as a wait queue value, truncated
-  // to 32 bits to fit in the wait queue state.
-  const pthread_t self = pthread_self();
-
-#ifdef _ASYLO_PTHREAD_COND_TRANSITIONAL_FLAG
-  // Use a global atomic counter to enumerate each thread. This generates a
-  // thread-specific 32 bit unique identifier for each thread, which is not the
-  // address of anything, and thus safer to expose outside the enclave (relative
-  // to some implementations of pthread_self()).
-  static std::atomic<int32_t> thread_counter(1);
-  thread_local int32_t self_32 =
-      thread_counter.fetch_add(1, std::memory_order_relaxed);
-
   if (!cond->_untrusted_wait_queue) {
-    // initialize wait queue
-    LockableGuard lock_guard(cond);
-    initialize_wait_queue(&cond->_untrusted_wait_queue);
+    initialize_sequence_wait_queue(cond);
   }
-#endif
+  int32_t *const wait_queue =
+      __atomic_load_n(&cond->_untrusted_wait_queue, __ATOMIC_ACQUIRE);
 
-  asylo::pthread_impl::QueueOperations list(cond);
-  // Store a thread-specific unique ID to the wait queue. This allows wait to be
-  // atomic, as any other thread signalling a wakeup will overwrite this value
-  // with a different thread unique ID, disabling this thread from sleeping.
-  {
-    LockableGuard lock_guard(cond);
-#ifdef _ASYLO_PTHREAD_COND_TRANSITIONAL_FLAG
-    if (cond->_untrusted_wait_queue) {
-      enc_untrusted_wait_queue_set_value(cond->_untrusted_wait_queue, self_32);
-    }
-#endif
-    list.Enqueue(self);
-  }
+  // Sample the sequence number and register as a waiter while |mutex| is still
+  // held. A signal or broadcast issued after |mutex| is released sees the
+  // waiter and advances the sequence number, so the futex wait below either
+  // sleeps until woken or returns immediately.
+  const uint32_t sequence = __atomic_load_n(&cond->_sequence, __ATOMIC_SEQ_CST);
+  __atomic_add_fetch(&cond->_waiters, 1, __ATOMIC_SEQ_CST);
 
   int ret = pthread_mutex_unlock(mutex);
   if (ret != 0) {
+    __atomic_sub_fetch(&cond->_waiters, 1, __ATOMIC_SEQ_CST);
     return ret;
   }
 
-#ifdef _ASYLO_PTHREAD_COND_TRANSITIONAL_FLAG
   // A wait for 0 microseconds will actually wait indefinitely.
   uint64_t time_left_micros = 0;
   if (deadline) {
     timespec curr_time;
     ret = clock_gettime(CLOCK_REALTIME, &curr_time);
-    if (ret != 0) {
-      pthread_mutex_lock(mutex);
-      return ret;
-    }
-
-    // TimeSpecSubtract returns true if deadline < curr_time.
-    timespec time_left;
-    if (asylo::TimeSpecSubtract(*deadline, curr_time, &time_left)) {
-      pthread_mutex_lock(mutex);
-      return ETIMEDOUT;
-    }
-    time_left_micros = asylo::TimeSpecToMicroseconds(&time_left);
-
-    // Timeout if we're exactly at the deadline. Otherwise we'd sleep for 0
-    // microseconds, which is an indefinite sleep.
-    if (time_left_micros == 0) {
-      pthread_mutex_lock(mutex);
-      return ETIMEDOUT;
+    if (ret == 0) {
+      // TimeSpecSubtract returns true if deadline < curr_time.
+      timespec time_left;
+      if (asylo::TimeSpecSubtract(*deadline, curr_time, &time_left)) {
+        ret = ETIMEDOUT;
+      } else {
+        time_left_micros = asylo::TimeSpecToMicroseconds(&time_left);
+        // Timeout if we're exactly at the deadline. Otherwise we'd sleep for 0
+        // microseconds, which is an indefinite sleep.
+        if (time_left_micros == 0) {
+          ret = ETIMEDOUT;
+        }
+      }
     }
   }
-  // Sleep on the wait queue until either the timeout occurs, or a wakeup
-  // occurs.
-  if (cond->_untrusted_wait_queue) {
-    enc_untrusted_thread_wait_value(cond->_untrusted_wait_queue, self_32,
-                                    time_left_micros);
-  }
-  {
-    LockableGuard lock_guard(cond);
-    list.Remove(self);
+
+  // Sleep on the futex word until either the timeout occurs, or a wakeup
+  // occurs. If the sequence number already moved on, the wait returns
+  // immediately.
+  if (ret == 0 && wait_queue) {
+    enc_untrusted_thread_wait_value(
+        wait_queue, static_cast<int32_t>(sequence), time_left_micros);
   }
+  __atomic_sub_fetch(&cond->_waiters, 1, __ATOMIC_SEQ_CST);
 
-  if (deadline) {
+  if (ret == 0 && deadline) {
     // Check if awoken up due to timeout.
     timespec curr_time;
     ret = clock_gettime(CLOCK_REALTIME, &curr_time);
-    if (ret != 0) {
-      pthread_mutex_lock(mutex);
-      return ret;
-    }
-
-    // TimeSpecSubtract returns true if deadline < curr_time.
-    timespec time_left;
-    if (asylo::TimeSpecSubtract(*deadline, curr_time, &time_left)) {
-      pthread_mutex_lock(mutex);
-      return ETIMEDOUT;
-    }
-  }
-
-  return pthread_mutex_lock(mutex);
-#else
-  while (true) {
-    enc_untrusted_sched_yield();
-
-    // If a deadline has been specified, check to see if it has passed.
-    if (deadline) {
-      timespec curr_time;
-      ret = clock_gettime(CLOCK_REALTIME, &curr_time);
-      if (ret != 0) {
-        break;
-      }
-
+    if (ret == 0) {
       // TimeSpecSubtract returns true if deadline < curr_time.
       timespec time_left;
       if (asylo::TimeSpecSubtract(*deadline, curr_time, &time_left)) {
         ret = ETIMEDOUT;
-        break;
       }
     }
-
-    LockableGuard lock_guard(cond);
-    if (!list.Contains(self)) {
-      break;
-    }
-  }
-
-  {
-    LockableGuard lock_guard(cond);
-    list.Remove(self);
   }
 
   // Only set the retval to be the result of re-locking the mutex if there isn't
@@ -834,7 +972,6 @@ int pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex,
     return ret;
   }
   return relock_ret;
-#endif
 }
 
 // Blocks until the given |cond| is signaled or broadcasted. |mutex| must  be
@@ -847,34 +984,20 @@ int pthread_condattr_init(pthread_condattr_t *attr) { return 0; }
 
 int pthread_condattr_destroy(pthread_condattr_t *attr) { return 0; }
 
-// Wakes |num_threads| waiting on |cond|.
+// Wakes |num_threads| waiting on |cond|. Costs a single enclave exit however
+// many threads are woken, and none if no thread is waiting.
 int pthread_cond_notify_internal(pthread_cond_t *cond, int num_threads) {
   if (!asylo::primitives::IsValidEnclaveAddress<pthread_cond_t>(cond)) {
     return EFAULT;
   }
 
-#ifdef _ASYLO_PTHREAD_COND_TRANSITIONAL_FLAG
-  // If there is no queue, there is no way for other threads to be asleep on
-  // that queue, and thus there is nothing to do.
-  if (cond->_untrusted_wait_queue != nullptr) {
-    asylo::pthread_impl::QueueOperations list(cond);
-    const int32_t self = static_cast<int32_t>(pthread_self());
-    LockableGuard lock_guard(cond);
-    enc_untrusted_wait_queue_set_value(cond->_untrusted_wait_queue, self);
-    if (!list.Empty()) {
-      enc_untrusted_notify(cond->_untrusted_wait_queue, num_threads);
-    }
-  }
-#else
-  LockableGuard lock_guard(cond);
-  asylo::pthread_impl::QueueOperations list(cond);
-  if (num_threads == 1 && !list.Empty()) {
-    list.Dequeue();
-  } else {
-    // only called with 1 and INT_MAX
-    list.Clear();
+  // If there is no futex word, there is no way for other threads to be asleep
+  // on it, and thus there is nothing to do.
+  int32_t *const wait_queue =
+      __atomic_load_n(&cond->_untrusted_wait_queue, __ATOMIC_ACQUIRE);
+  if (wait_queue && __atomic_load_n(&cond->_waiters, __ATOMIC_SEQ_CST) > 0) {
+    futex_sequence_wake(cond, wait_queue, num_threads);
   }
-#endif
   return 0;
 }
 
@@ -1022,7 +1145,6 @@ int pthread_rwlock_tryrdlock(pthread_rwlock_t *rwlock) {
     return ConvertToErrno(EFAULT);
   }
 
-  LockableGuard lock_guard(rwlock);
   return pthread_rwlock_tryrdlock_internal(rwlock);
 }
 
@@ -1031,7 +1153,6 @@ int pthread_rwlock_trywrlock(pthread_rwlock_t *rwlock) {
     return ConvertToErrno(EFAULT);
   }
 
-  LockableGuard lock_guard(rwlock);
   return pthread_rwlock_trywrlock_internal(rwlock);
 }
 
@@ -1048,32 +1169,25 @@ int pthread_rwlock_unlock(pthread_rwlock_t *rwlock) {
     return ConvertToErrno(EFAULT);
   }
 
-  asylo::pthread_impl::QueueOperations list(rwlock);
-  LockableGuard lock_guard(rwlock);
-
-  const pthread_t self = pthread_self();
-  if (rwlock->_write_owner == self) {
-    rwlock->_write_owner = PTHREAD_T_NULL;
-#ifdef _ASYLO_PTHREAD_RWLOCK_TRANSITIONAL_FLAG
-    if (rwlock->_untrusted_wait_queue) {
-      enc_untrusted_disable_waiting(rwlock->_untrusted_wait_queue);
-      if (!list.Empty()) {
-        enc_untrusted_notify(rwlock->_untrusted_wait_queue);
-      }
-    }
-#endif
+  if (__atomic_load_n(&rwlock->_write_owner, __ATOMIC_RELAXED) ==
+      pthread_self()) {
+    __atomic_store_n(&rwlock->_write_owner, PTHREAD_T_NULL, __ATOMIC_RELAXED);
+    __atomic_store_n(&rwlock->_state, 0, __ATOMIC_SEQ_CST);
+    pthread_rwlock_wake(rwlock);
     return 0;
   }
 
-  rwlock->_reader_count--;
-#ifdef _ASYLO_PTHREAD_RWLOCK_TRANSITIONAL_FLAG
-  if (rwlock->_reader_count == 0 && rwlock->_untrusted_wait_queue) {
-    enc_untrusted_disable_waiting(rwlock->_untrusted_wait_queue);
-    if (!list.Empty()) {
-      enc_untrusted_notify(rwlock->_untrusted_wait_queue);
+  uint32_t state = __atomic_load_n(&rwlock->_state, __ATOMIC_RELAXED);
+  do {
+    // The calling thread holds neither a read nor the write lock.
+    if (state == 0 || (state & kRwlockWriteLocked)) {
+      return EPERM;
     }
+  } while (!asylo::AtomicCompareExchange(&rwlock->_state, &state, state - 1,
+                                         /*weak=*/true));
+  if (state == 1) {
+    pthread_rwlock_wake(rwlock);
   }
-#endif
   return 0;
 }
 
@@ -1082,9 +1196,8 @@ int pthread_rwlock_destroy(pthread_rwlock_t *rwlock) {
     return ConvertToErrno(EFAULT);
   }
 
-  LockableGuard lock_guard(rwlock);
-  asylo::pthread_impl::QueueOperations queue(rwlock);
-  if (rwlock->_write_owner == PTHREAD_T_NULL && queue.Empty()) {
+  if (__atomic_load_n(&rwlock->_state, __ATOMIC_SEQ_CST) == 0 &&
+      __atomic_load_n(&rwlock->_waiters, __ATOMIC_SEQ_CST) == 0) {
     return 0;
   }
 
@@ -20,6 +20,7 @@
 #define ASYLO_PLATFORM_POSIX_PTHREAD_IMPL_H_
 
 #include <pthread.h>
+#include <cstdint>
 #include <functional>
 
 #include "asylo/util/logging.h"
@@ -64,6 +65,25 @@ class QueueOperations {
   __pthread_list_t *const list_;
 };
 
+// Contention statistics aggregated over all pthread mutexes in the enclave.
+struct MutexContentionStats {
+  // Number of pthread_mutex_lock calls that found the mutex held.
+  uint64_t contended_acquisitions;
+
+  // Number of contended acquisitions that succeeded while spinning.
+  uint64_t spin_acquisitions;
+
+  // Number of times a thread slept on a mutex wait queue. Each sleep costs at
+  // least one enclave exit.
+  uint64_t sleeps;
+
+  // Total number of spin iterations on contended mutexes.
+  uint64_t spin_iterations;
+};
+
+// Returns a snapshot of the mutex contention statistics.
+MutexContentionStats GetMutexContentionStats();
+
 // Provides an RAII wrapper around pthread_mutex_t. Aborts on errors, so should
 // only be used for locks that are internal to pthread.cc, where errors indicate
 // internal implementation errors. Should not be used for user-provided mutexes
@@ -20,7 +20,7 @@
 #include <stdlib.h>
 #include <sys/types.h>
 
-#include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/platform/posix/host_info_cache.h"
 
 extern "C" {
 
@@ -35,7 +35,7 @@ int getpwnam_r(const char *name, struct passwd *pwd, char *buf, size_t buflen,
 }
 
 struct passwd *getpwuid(uid_t uid) {
-  return enc_untrusted_getpwuid(uid);
+  return asylo::CachedGetPwUid(uid);
 }
 
 }  // extern "C"
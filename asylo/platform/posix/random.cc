@@ -0,0 +1,43 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <errno.h>
+#include <sys/random.h>
+
+#include <cstdint>
+
+#include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/platform/primitives/random_bytes.h"
+#include "asylo/platform/primitives/trusted_runtime.h"
+
+extern "C" {
+
+ssize_t getrandom(void *buf, size_t buflen, unsigned int flags) {
+  if (flags & ~(GRND_NONBLOCK | GRND_RANDOM)) {
+    errno = EINVAL;
+    return -1;
+  }
+  // As for reads of /dev/random and /dev/urandom, serve the request inside the
+  // enclave unless there is no hardware source of randomness.
+  if (asylo::rdrand_supported()) {
+    return enc_hardware_random(static_cast<uint8_t *>(buf), buflen);
+  }
+  return enc_untrusted_getrandom(buf, buflen, flags);
+}
+
+}  // extern "C"
@@ -26,6 +26,7 @@
 #include "absl/synchronization/mutex.h"
 #include "asylo/platform/core/trusted_global_state.h"
 #include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/platform/posix/io/buffered_writer.h"
 #include "asylo/platform/posix/signal/signal_manager.h"
 #include "asylo/platform/posix/syscall/signal_syscalls.h"
 #include "asylo/platform/primitives/trusted_runtime.h"
@@ -68,7 +69,13 @@ sighandler_t signal(int signum, sighandler_t handler) {
 // If a signal is raised inside an enclave, it exits the enclave and raises the
 // signal on the host. If a handler has been registered for this signal in the
 // enclave, the signal handler on the host enters the enclave to invoke the
-// registered handler.
-int raise(int sig) { return enc_untrusted_raise(sig); }
+// registered handler. Buffered writes are flushed before abort() raises
+// SIGABRT, which takes the process down.
+int raise(int sig) {
+  if (sig == SIGABRT) {
+    asylo::io::BufferedWriter::FlushAll();
+  }
+  return enc_untrusted_raise(sig);
+}
 
 }  // extern "C"
@@ -20,6 +20,17 @@
 #include <stdlib.h>
 
 #include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/platform/posix/sockets/resolver_cache.h"
+
+namespace asylo {
+
+ResolverCache *ResolverCache::GetInstance() {
+  static ResolverCache *cache =
+      new ResolverCache(enc_untrusted_getaddrinfo, enc_freeaddrinfo);
+  return cache;
+}
+
+}  // namespace asylo
 
 extern "C" {
 
@@ -28,7 +39,8 @@ const char *gai_strerror(int ecode) { abort(); }
 
 int getaddrinfo(const char *node, const char *service,
                 const struct addrinfo *hints, struct addrinfo **res) {
-  return enc_untrusted_getaddrinfo(node, service, hints, res);
+  return asylo::ResolverCache::GetInstance()->GetAddrInfo(node, service, hints,
+                                                          res);
 }
 
 void freeaddrinfo(struct addrinfo *res) { enc_freeaddrinfo(res); }
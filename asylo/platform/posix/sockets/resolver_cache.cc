@@ -0,0 +1,351 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/sockets/resolver_cache.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "asylo/util/thread.h"
+
+namespace asylo {
+namespace {
+
+// Releases a partially built list. Unlike freeaddrinfo() on the host, this
+// does not assume that addresses are allocated with their nodes.
+void FreeList(struct addrinfo *head) {
+  while (head) {
+    struct addrinfo *next = head->ai_next;
+    free(head->ai_addr);
+    free(head->ai_canonname);
+    free(head);
+    head = next;
+  }
+}
+
+}  // namespace
+
+ResolverCache::ResolverCache(Resolver resolver, Releaser releaser,
+                             std::function<absl::Time()> clock)
+    : resolver_(std::move(resolver)),
+      releaser_(std::move(releaser)),
+      clock_(std::move(clock)) {}
+
+ResolverCache::~ResolverCache() {
+  std::unique_ptr<Thread> resolution_thread;
+  {
+    absl::MutexLock lock(&mu_);
+    stopping_ = true;
+    resolution_thread = std::move(resolution_thread_);
+  }
+  if (resolution_thread) {
+    resolution_thread->Join();
+  }
+  std::vector<Callback> callbacks;
+  {
+    absl::MutexLock lock(&mu_);
+    while (!queue_.empty()) {
+      Result result;
+      result.result = EAI_AGAIN;
+      for (auto &callback :
+           Complete(queue_.front().first, std::move(result),
+                    queue_.front().second.get())) {
+        callbacks.push_back(std::move(callback));
+      }
+      queue_.pop_front();
+    }
+  }
+  for (const auto &callback : callbacks) {
+    callback(EAI_AGAIN, nullptr);
+  }
+}
+
+void ResolverCache::SetOptions(const Options &options) {
+  absl::MutexLock lock(&mu_);
+  options_ = options;
+  entries_.clear();
+}
+
+void ResolverCache::Clear() {
+  absl::MutexLock lock(&mu_);
+  entries_.clear();
+}
+
+int ResolverCache::GetAddrInfo(const char *node, const char *service,
+                               const struct addrinfo *hints,
+                               struct addrinfo **res) {
+  const Key key = MakeKey(node, service, hints);
+  std::shared_ptr<InFlight> in_flight;
+  bool resolve = false;
+  {
+    absl::MutexLock lock(&mu_);
+    const Result *cached = Lookup(key);
+    if (cached) {
+      return BuildResult(*cached, res);
+    }
+    auto it = in_flight_.find(key);
+    if (it == in_flight_.end()) {
+      in_flight = std::make_shared<InFlight>();
+      in_flight_.emplace(key, in_flight);
+      resolve = true;
+    } else {
+      in_flight = it->second;
+    }
+  }
+  if (resolve) {
+    Resolve(key, in_flight);
+  } else {
+    absl::MutexLock lock(&mu_);
+    mu_.Await(absl::Condition(&in_flight->done));
+  }
+  // The result of a completed resolution is never modified again.
+  return BuildResult(in_flight->result, res);
+}
+
+void ResolverCache::GetAddrInfoAsync(const char *node, const char *service,
+                                     const struct addrinfo *hints,
+                                     Callback callback) {
+  const Key key = MakeKey(node, service, hints);
+  Result cached_result;
+  {
+    absl::MutexLock lock(&mu_);
+    const Result *cached = Lookup(key);
+    if (!cached) {
+      auto it = in_flight_.find(key);
+      if (it != in_flight_.end()) {
+        it->second->callbacks.push_back(std::move(callback));
+        return;
+      }
+      if (stopping_) {
+        cached_result.result = EAI_AGAIN;
+      } else {
+        auto in_flight = std::make_shared<InFlight>();
+        in_flight->callbacks.push_back(std::move(callback));
+        in_flight_.emplace(key, in_flight);
+        queue_.emplace_back(key, std::move(in_flight));
+        if (!resolution_thread_) {
+          resolution_thread_ =
+              absl::make_unique<Thread>([this] { ResolutionLoop(); });
+        }
+        return;
+      }
+    } else {
+      cached_result = *cached;
+    }
+  }
+  struct addrinfo *res = nullptr;
+  int result = BuildResult(cached_result, &res);
+  callback(result, res);
+}
+
+ResolverCache::Key ResolverCache::MakeKey(const char *node,
+                                          const char *service,
+                                          const struct addrinfo *hints) {
+  return Key(node != nullptr, node != nullptr ? node : "",
+             service != nullptr, service != nullptr ? service : "",
+             hints != nullptr, hints != nullptr ? hints->ai_flags : 0,
+             hints != nullptr ? hints->ai_family : 0,
+             hints != nullptr ? hints->ai_socktype : 0,
+             hints != nullptr ? hints->ai_protocol : 0);
+}
+
+int ResolverCache::BuildResult(const Result &result, struct addrinfo **res) {
+  if (result.result != 0) {
+    if (result.result == EAI_SYSTEM) {
+      errno = result.error_number;
+    }
+    return result.result;
+  }
+  struct addrinfo *head = nullptr;
+  struct addrinfo **next = &head;
+  for (const Address &address : result.addresses) {
+    struct addrinfo *info =
+        static_cast<struct addrinfo *>(calloc(1, sizeof(struct addrinfo)));
+    if (!info) {
+      FreeList(head);
+      return EAI_MEMORY;
+    }
+    *next = info;
+    next = &info->ai_next;
+    info->ai_flags = address.flags;
+    info->ai_family = address.family;
+    info->ai_socktype = address.socktype;
+    info->ai_protocol = address.protocol;
+    if (!address.addr.empty()) {
+      info->ai_addr =
+          static_cast<struct sockaddr *>(malloc(address.addr.size()));
+      if (!info->ai_addr) {
+        FreeList(head);
+        return EAI_MEMORY;
+      }
+      memcpy(info->ai_addr, address.addr.data(), address.addr.size());
+      info->ai_addrlen = address.addr.size();
+    }
+    if (address.has_canonname) {
+      info->ai_canonname = strdup(address.canonname.c_str());
+      if (!info->ai_canonname) {
+        FreeList(head);
+        return EAI_MEMORY;
+      }
+    }
+  }
+  *res = head;
+  return 0;
+}
+
+const ResolverCache::Result *ResolverCache::Lookup(const Key &key) {
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return nullptr;
+  }
+  if (it->second.expiry <= clock_()) {
+    entries_.erase(it);
+    return nullptr;
+  }
+  return &it->second.result;
+}
+
+void ResolverCache::Store(const Key &key, const Result &result) {
+  absl::Duration ttl;
+  switch (result.result) {
+    case 0:
+      ttl = options_.ttl;
+      break;
+    case EAI_NONAME:
+#ifdef EAI_NODATA
+    case EAI_NODATA:
+#endif  // EAI_NODATA
+      ttl = options_.negative_ttl;
+      break;
+    default:
+      return;
+  }
+  if (ttl <= absl::ZeroDuration() || options_.max_entries == 0) {
+    return;
+  }
+  const absl::Time now = clock_();
+  if (entries_.size() >= options_.max_entries && !entries_.contains(key)) {
+    // Drop expired results, and if there are none, the result expiring first.
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      if (it->second.expiry <= now) {
+        entries_.erase(it++);
+      } else {
+        ++it;
+      }
+    }
+    if (entries_.size() >= options_.max_entries) {
+      entries_.erase(std::min_element(
+          entries_.begin(), entries_.end(),
+          [](const std::pair<const Key, Entry> &a,
+             const std::pair<const Key, Entry> &b) {
+            return a.second.expiry < b.second.expiry;
+          }));
+    }
+  }
+  entries_[key] = Entry{result, now + ttl};
+}
+
+void ResolverCache::Resolve(const Key &key,
+                            const std::shared_ptr<InFlight> &in_flight) {
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  std::tie(std::ignore, std::ignore, std::ignore, std::ignore, std::ignore,
+           hints.ai_flags, hints.ai_family, hints.ai_socktype,
+           hints.ai_protocol) = key;
+  const char *node = std::get<0>(key) ? std::get<1>(key).c_str() : nullptr;
+  const char *service = std::get<2>(key) ? std::get<3>(key).c_str() : nullptr;
+
+  Result result;
+  struct addrinfo *res = nullptr;
+  result.result =
+      resolver_(node, service, std::get<4>(key) ? &hints : nullptr, &res);
+  result.error_number = errno;
+  if (result.result == 0) {
+    for (const struct addrinfo *info = res; info; info = info->ai_next) {
+      Address address;
+      address.flags = info->ai_flags;
+      address.family = info->ai_family;
+      address.socktype = info->ai_socktype;
+      address.protocol = info->ai_protocol;
+      if (info->ai_addr) {
+        address.addr.assign(reinterpret_cast<const char *>(info->ai_addr),
+                            info->ai_addrlen);
+      }
+      address.has_canonname = info->ai_canonname != nullptr;
+      if (address.has_canonname) {
+        address.canonname = info->ai_canonname;
+      }
+      result.addresses.push_back(std::move(address));
+    }
+    releaser_(res);
+  }
+
+  std::vector<Callback> callbacks;
+  {
+    absl::MutexLock lock(&mu_);
+    Store(key, result);
+    callbacks = Complete(key, std::move(result), in_flight.get());
+  }
+  for (const auto &callback : callbacks) {
+    struct addrinfo *callback_res = nullptr;
+    int callback_result = BuildResult(in_flight->result, &callback_res);
+    callback(callback_result, callback_res);
+  }
+}
+
+std::vector<ResolverCache::Callback> ResolverCache::Complete(
+    const Key &key, Result result, InFlight *in_flight) {
+  in_flight->result = std::move(result);
+  in_flight->done = true;
+  in_flight_.erase(key);
+  return std::move(in_flight->callbacks);
+}
+
+void ResolverCache::ResolutionLoop() {
+  while (true) {
+    std::pair<Key, std::shared_ptr<InFlight>> request;
+    {
+      absl::MutexLock lock(&mu_);
+      mu_.Await(absl::Condition(
+          +[](ResolverCache *cache) ABSL_EXCLUSIVE_LOCKS_REQUIRED(cache->mu_) {
+            return cache->stopping_ || !cache->queue_.empty();
+          },
+          this));
+      if (stopping_) {
+        return;
+      }
+      request = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    Resolve(request.first, request.second);
+  }
+}
+
+}  // namespace asylo
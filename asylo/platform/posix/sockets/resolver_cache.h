@@ -0,0 +1,188 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_POSIX_SOCKETS_RESOLVER_CACHE_H_
+#define ASYLO_PLATFORM_POSIX_SOCKETS_RESOLVER_CACHE_H_
+
+#include <netdb.h>
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "asylo/util/thread.h"
+
+namespace asylo {
+
+// ResolverCache caches the results of getaddrinfo inside the enclave, so that
+// resolving a recently resolved name does not exit the enclave. Successful
+// results are kept for Options::ttl, and failures reporting that the name does
+// not exist for Options::negative_ttl. Other failures are not cached.
+// Concurrent lookups of the same name and hints share a single resolution.
+//
+// Lists returned by the cache are allocated with malloc() node by node, like
+// the lists deserialized from host calls, and are released with
+// freeaddrinfo().
+class ResolverCache {
+ public:
+  // Resolves names, with the semantics of getaddrinfo().
+  using Resolver =
+      std::function<int(const char *node, const char *service,
+                        const struct addrinfo *hints, struct addrinfo **res)>;
+
+  // Releases a list returned by Resolver.
+  using Releaser = std::function<void(struct addrinfo *res)>;
+
+  // Receives the result of an asynchronous lookup, as returned by
+  // getaddrinfo(). The callee owns |res|.
+  using Callback = std::function<void(int result, struct addrinfo *res)>;
+
+  struct Options {
+    // How long successful results are kept. Zero disables caching them.
+    absl::Duration ttl = absl::Seconds(30);
+
+    // How long EAI_NONAME and EAI_NODATA failures are kept. Zero disables
+    // caching them.
+    absl::Duration negative_ttl = absl::Seconds(5);
+
+    // Maximum number of cached lookups.
+    size_t max_entries = 256;
+  };
+
+  // Returns the cache used by getaddrinfo(), which resolves names with host
+  // calls. Defined by the enclave POSIX layer.
+  static ResolverCache *GetInstance();
+
+  ResolverCache(Resolver resolver, Releaser releaser,
+                std::function<absl::Time()> clock = absl::Now);
+  ResolverCache(const ResolverCache &other) = delete;
+  ResolverCache &operator=(const ResolverCache &other) = delete;
+
+  // Waits for the asynchronous resolution thread to finish its current lookup.
+  // Lookups still queued complete with EAI_AGAIN.
+  ~ResolverCache();
+
+  void SetOptions(const Options &options) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Drops all cached results.
+  void Clear() ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Looks up |node| and |service| with the semantics of getaddrinfo(),
+  // resolving them only if no result is cached.
+  int GetAddrInfo(const char *node, const char *service,
+                  const struct addrinfo *hints, struct addrinfo **res)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Looks up |node| and |service| like GetAddrInfo(), without blocking the
+  // calling thread on a resolution. |callback| runs on the calling thread if a
+  // result is cached, and otherwise on a resolution thread owned by the cache.
+  void GetAddrInfoAsync(const char *node, const char *service,
+                        const struct addrinfo *hints, Callback callback)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  // A lookup: node and service, each with whether it is present, and whether
+  // hints are present with their flags, family, socket type and protocol.
+  using Key = std::tuple<bool, std::string, bool, std::string, bool, int, int,
+                         int, int>;
+
+  // One member of a resolved list.
+  struct Address {
+    int flags;
+    int family;
+    int socktype;
+    int protocol;
+    std::string addr;
+    bool has_canonname;
+    std::string canonname;
+  };
+
+  // Result of a lookup, as returned by getaddrinfo() and errno.
+  struct Result {
+    int result = 0;
+    int error_number = 0;
+    std::vector<Address> addresses;
+  };
+
+  struct Entry {
+    Result result;
+    absl::Time expiry;
+  };
+
+  // A resolution in progress, which the threads looking up the same key wait
+  // for.
+  struct InFlight {
+    bool done = false;
+    Result result;
+    std::vector<Callback> callbacks;
+  };
+
+  static Key MakeKey(const char *node, const char *service,
+                     const struct addrinfo *hints);
+
+  // Builds a list owned by the caller from |result|, and returns the value to
+  // be returned by getaddrinfo().
+  static int BuildResult(const Result &result, struct addrinfo **res);
+
+  // Returns a cached result for |key|, or nullptr if none is cached or it
+  // expired.
+  const Result *Lookup(const Key &key) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Caches |result| for |key|, if its kind of result is cached.
+  void Store(const Key &key, const Result &result)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Resolves |key|, completes |in_flight| and runs its callbacks.
+  void Resolve(const Key &key, const std::shared_ptr<InFlight> &in_flight)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Completes |in_flight| with |result| and returns its callbacks.
+  std::vector<Callback> Complete(const Key &key, Result result,
+                                 InFlight *in_flight)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Runs queued asynchronous lookups until the cache is destroyed.
+  void ResolutionLoop() ABSL_LOCKS_EXCLUDED(mu_);
+
+  const Resolver resolver_;
+  const Releaser releaser_;
+  const std::function<absl::Time()> clock_;
+
+  absl::Mutex mu_;
+  Options options_ ABSL_GUARDED_BY(mu_);
+  absl::flat_hash_map<Key, Entry> entries_ ABSL_GUARDED_BY(mu_);
+  absl::flat_hash_map<Key, std::shared_ptr<InFlight>> in_flight_
+      ABSL_GUARDED_BY(mu_);
+  std::deque<std::pair<Key, std::shared_ptr<InFlight>>> queue_
+      ABSL_GUARDED_BY(mu_);
+  bool stopping_ ABSL_GUARDED_BY(mu_) = false;
+  std::unique_ptr<Thread> resolution_thread_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_SOCKETS_RESOLVER_CACHE_H_
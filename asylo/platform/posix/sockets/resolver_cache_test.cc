@@ -0,0 +1,229 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/sockets/resolver_cache.h"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include <gtest/gtest.h>
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+
+namespace asylo {
+namespace {
+
+// Releases lists built by the fake resolver and by the cache.
+void FreeList(struct addrinfo *res) {
+  while (res) {
+    struct addrinfo *next = res->ai_next;
+    free(res->ai_addr);
+    free(res->ai_canonname);
+    free(res);
+    res = next;
+  }
+}
+
+class ResolverCacheTest : public ::testing::Test {
+ protected:
+  ResolverCacheTest()
+      : now_(absl::FromUnixSeconds(1000)),
+        cache_(
+            [this](const char *node, const char *service,
+                   const struct addrinfo *hints, struct addrinfo **res) {
+              return Resolve(node, service, hints, res);
+            },
+            FreeList, [this] { return now_; }) {}
+
+  // Resolves every name to 10.0.0.1, except those in |result_|'s failure
+  // mode. Records the family hint of the last resolution.
+  int Resolve(const char *node, const char *service,
+              const struct addrinfo *hints, struct addrinfo **res) {
+    ++resolutions_;
+    last_family_ = hints ? hints->ai_family : AF_UNSPEC;
+    if (result_ != 0) {
+      return result_;
+    }
+    struct addrinfo *info =
+        static_cast<struct addrinfo *>(calloc(1, sizeof(struct addrinfo)));
+    struct sockaddr_in *addr = static_cast<struct sockaddr_in *>(
+        calloc(1, sizeof(struct sockaddr_in)));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons(80);
+    inet_pton(AF_INET, "10.0.0.1", &addr->sin_addr);
+    info->ai_family = AF_INET;
+    info->ai_socktype = SOCK_STREAM;
+    info->ai_addr = reinterpret_cast<struct sockaddr *>(addr);
+    info->ai_addrlen = sizeof(*addr);
+    info->ai_canonname = strdup(node);
+    *res = info;
+    return 0;
+  }
+
+  // Looks up |node| and checks that it resolved to the fake address.
+  void ExpectResolved(const char *node) {
+    struct addrinfo *res = nullptr;
+    ASSERT_EQ(cache_.GetAddrInfo(node, "http", nullptr, &res), 0);
+    ASSERT_NE(res, nullptr);
+    EXPECT_EQ(res->ai_family, AF_INET);
+    EXPECT_EQ(res->ai_socktype, SOCK_STREAM);
+    ASSERT_EQ(res->ai_addrlen, sizeof(struct sockaddr_in));
+    auto addr = reinterpret_cast<struct sockaddr_in *>(res->ai_addr);
+    char buffer[INET_ADDRSTRLEN];
+    EXPECT_EQ(std::string(inet_ntop(AF_INET, &addr->sin_addr, buffer,
+                                    sizeof(buffer))),
+              "10.0.0.1");
+    EXPECT_EQ(ntohs(addr->sin_port), 80);
+    EXPECT_EQ(std::string(res->ai_canonname), node);
+    EXPECT_EQ(res->ai_next, nullptr);
+    FreeList(res);
+  }
+
+  absl::Time now_;
+  int result_ = 0;
+  int resolutions_ = 0;
+  int last_family_ = AF_UNSPEC;
+  ResolverCache cache_;
+};
+
+TEST_F(ResolverCacheTest, CachesSuccessfulResults) {
+  ExpectResolved("example.com");
+  ExpectResolved("example.com");
+  EXPECT_EQ(resolutions_, 1);
+
+  ExpectResolved("example.org");
+  EXPECT_EQ(resolutions_, 2);
+}
+
+TEST_F(ResolverCacheTest, ExpiresResults) {
+  ExpectResolved("example.com");
+  now_ += absl::Seconds(29);
+  ExpectResolved("example.com");
+  EXPECT_EQ(resolutions_, 1);
+
+  now_ += absl::Seconds(1);
+  ExpectResolved("example.com");
+  EXPECT_EQ(resolutions_, 2);
+}
+
+TEST_F(ResolverCacheTest, CachesMissingNames) {
+  result_ = EAI_NONAME;
+  struct addrinfo *res = nullptr;
+  EXPECT_EQ(cache_.GetAddrInfo("missing", nullptr, nullptr, &res),
+            EAI_NONAME);
+  EXPECT_EQ(cache_.GetAddrInfo("missing", nullptr, nullptr, &res),
+            EAI_NONAME);
+  EXPECT_EQ(resolutions_, 1);
+
+  now_ += absl::Seconds(5);
+  result_ = 0;
+  ExpectResolved("missing");
+  EXPECT_EQ(resolutions_, 2);
+}
+
+TEST_F(ResolverCacheTest, DoesNotCacheTransientFailures) {
+  result_ = EAI_AGAIN;
+  struct addrinfo *res = nullptr;
+  EXPECT_EQ(cache_.GetAddrInfo("example.com", nullptr, nullptr, &res),
+            EAI_AGAIN);
+  result_ = 0;
+  ExpectResolved("example.com");
+  EXPECT_EQ(resolutions_, 2);
+}
+
+TEST_F(ResolverCacheTest, DistinguishesHints) {
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET6;
+  struct addrinfo *res = nullptr;
+
+  ExpectResolved("example.com");
+  ASSERT_EQ(cache_.GetAddrInfo("example.com", "http", &hints, &res), 0);
+  FreeList(res);
+  EXPECT_EQ(resolutions_, 2);
+  EXPECT_EQ(last_family_, AF_INET6);
+
+  ASSERT_EQ(cache_.GetAddrInfo("example.com", "http", &hints, &res), 0);
+  FreeList(res);
+  EXPECT_EQ(resolutions_, 2);
+}
+
+TEST_F(ResolverCacheTest, EvictsEarliestExpiringResult) {
+  ResolverCache::Options options;
+  options.max_entries = 2;
+  cache_.SetOptions(options);
+
+  ExpectResolved("a.example.com");
+  now_ += absl::Seconds(1);
+  ExpectResolved("b.example.com");
+  ExpectResolved("c.example.com");
+  EXPECT_EQ(resolutions_, 3);
+
+  ExpectResolved("b.example.com");
+  ExpectResolved("c.example.com");
+  EXPECT_EQ(resolutions_, 3);
+  ExpectResolved("a.example.com");
+  EXPECT_EQ(resolutions_, 4);
+}
+
+TEST_F(ResolverCacheTest, DisablesCaching) {
+  ResolverCache::Options options;
+  options.ttl = absl::ZeroDuration();
+  cache_.SetOptions(options);
+
+  ExpectResolved("example.com");
+  ExpectResolved("example.com");
+  EXPECT_EQ(resolutions_, 2);
+}
+
+TEST_F(ResolverCacheTest, ResolvesAsynchronously) {
+  absl::Notification resolved;
+  int result = -1;
+  std::string canonname;
+  cache_.GetAddrInfoAsync("example.com", "http", nullptr,
+                          [&](int callback_result, struct addrinfo *res) {
+                            result = callback_result;
+                            if (res) {
+                              canonname = res->ai_canonname;
+                            }
+                            FreeList(res);
+                            resolved.Notify();
+                          });
+  resolved.WaitForNotification();
+  EXPECT_EQ(result, 0);
+  EXPECT_EQ(canonname, "example.com");
+
+  // A cached result is delivered on the calling thread.
+  bool called = false;
+  cache_.GetAddrInfoAsync("example.com", "http", nullptr,
+                          [&](int callback_result, struct addrinfo *res) {
+                            EXPECT_EQ(callback_result, 0);
+                            FreeList(res);
+                            called = true;
+                          });
+  EXPECT_TRUE(called);
+  EXPECT_EQ(resolutions_, 1);
+}
+
+}  // namespace
+}  // namespace asylo
@@ -81,6 +81,16 @@ ssize_t recvmsg(int sockfd, struct msghdr *msg, int flags) {
   return IOManager::GetInstance().RecvMsg(sockfd, msg, flags);
 }
 
+int sendmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen, int flags) {
+  return IOManager::GetInstance().SendMmsg(sockfd, msgvec, vlen, flags);
+}
+
+int recvmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen, int flags,
+             struct timespec *timeout) {
+  return IOManager::GetInstance().RecvMmsg(sockfd, msgvec, vlen, flags,
+                                           timeout);
+}
+
 int getsockname(int sockfd, struct sockaddr *addr, socklen_t *addrlen) {
   return IOManager::GetInstance().GetSockName(sockfd, addr, addrlen);
 }
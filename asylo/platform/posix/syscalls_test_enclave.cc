@@ -839,8 +839,8 @@ class SyscallsEnclave : public EnclaveTestCase {
 
     // setrlimit should fail if the limit is set to be greater than the maximum
     // allowed file descriptor number inside the enclave.
-    set_limit.rlim_cur = 2000;
-    set_limit.rlim_max = 2000;
+    set_limit.rlim_cur = 200000;
+    set_limit.rlim_max = 200000;
     if (setrlimit(RLIMIT_NOFILE, &set_limit) != -1) {
       return Status(error::GoogleError::INTERNAL,
                     "setrlimit with limit higher than the maximum allowed "
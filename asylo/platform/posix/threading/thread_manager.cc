@@ -178,6 +178,7 @@ std::shared_ptr<ThreadManager::Thread> ThreadManager::EnqueueThread(
   // If a Thread object cannot be allocated, abort.
   CHECK(thread != nullptr);
 
+  PublishStats();
   pthread_cond_broadcast(&threads_cond_);
   return thread;
 }
@@ -203,6 +204,7 @@ std::shared_ptr<ThreadManager::Thread> ThreadManager::DequeueThread(pid_t tid) {
   reinterpret_cast<__pthread_info *>(thread->GetThreadTls())->thread_id =
       thread_id;
 
+  PublishStats();
   pthread_cond_broadcast(&threads_cond_);
   return thread;
 }
@@ -216,8 +218,10 @@ int ThreadManager::CreateThread(const std::function<int()> &start_routine,
   }
   std::shared_ptr<Thread> thread = EnqueueThread(options, start_routine, tls);
 
-  // Exit and create a thread to enter with EnclaveCall DonateThread.
-  if (asylo::primitives::TrustedPrimitives::CreateThread()) {
+  // Unless an idle pool thread takes the job, exit and create a thread to enter
+  // with EnclaveCall DonateThread.
+  if (!AssignToPoolThread() &&
+      asylo::primitives::TrustedPrimitives::CreateThread()) {
     return ECHILD;
   }
 
@@ -231,11 +235,105 @@ int ThreadManager::CreateThread(const std::function<int()> &start_routine,
   return 0;
 }
 
+bool ThreadManager::AssignToPoolThread() {
+  PthreadMutexLock lock(&threads_lock_);
+  if (idle_pool_threads_ == 0) {
+    return false;
+  }
+  idle_pool_threads_--;
+  pool_assignments_++;
+  PublishStats();
+  pthread_cond_signal(&pool_cond_);
+  return true;
+}
+
+void ThreadManager::SetStats(EnclaveThreadStats *stats) {
+  PthreadMutexLock lock(&threads_lock_);
+  stats_.store(stats, std::memory_order_release);
+  PublishStats();
+}
+
+void ThreadManager::PublishStats() {
+  EnclaveThreadStats *stats = stats_.load(std::memory_order_acquire);
+  if (!stats) {
+    return;
+  }
+  stats->queued_threads.store(queued_threads_.size(),
+                              std::memory_order_relaxed);
+  stats->running_threads.store(threads_.size(), std::memory_order_relaxed);
+  stats->pool_threads.store(pool_threads_, std::memory_order_relaxed);
+  stats->parked_pool_threads.store(idle_pool_threads_,
+                                   std::memory_order_relaxed);
+}
+
+void ThreadManager::StartThreadPool(int size) {
+  if (size <= 0) {
+    return;
+  }
+  {
+    PthreadMutexLock lock(&threads_lock_);
+    pending_pool_threads_ += size;
+  }
+  for (int i = 0; i < size; i++) {
+    // Exit and create a thread to enter with EnclaveCall DonateThread. Give up
+    // on the rest of the pool if the host cannot create a thread.
+    if (asylo::primitives::TrustedPrimitives::CreateThread()) {
+      PthreadMutexLock lock(&threads_lock_);
+      pending_pool_threads_ -= size - i;
+      pthread_cond_broadcast(&threads_cond_);
+      return;
+    }
+  }
+}
+
 // StartThread is called from trusted_application.cc as the start routine when
 // a new thread is donated to the Enclave.
 int ThreadManager::StartThread(pid_t tid) {
-  std::shared_ptr<Thread> thread = DequeueThread(tid);
+  bool pool_thread = false;
+  {
+    PthreadMutexLock lock(&threads_lock_);
+    if (pending_pool_threads_ > 0) {
+      pending_pool_threads_--;
+      pool_threads_++;
+      pool_thread = true;
+      PublishStats();
+    }
+  }
+  if (pool_thread) {
+    RunPoolThread(tid);
+    return 0;
+  }
+
+  RunThread(DequeueThread(tid));
+  return 0;
+}
+
+void ThreadManager::RunPoolThread(pid_t tid) {
+  while (true) {
+    {
+      PthreadMutexLock lock(&threads_lock_);
+      idle_pool_threads_++;
+      PublishStats();
+      WaitFor(
+          [this]() { return pool_assignments_ > 0 || finalizing_.load(); },
+          &pool_cond_, &threads_lock_);
+      if (pool_assignments_ == 0) {
+        // Finalizing, leave the enclave.
+        idle_pool_threads_--;
+        pool_threads_--;
+        PublishStats();
+        pthread_cond_broadcast(&threads_cond_);
+        return;
+      }
+      // The thread handing out the assignment already marked a pool thread as
+      // busy.
+      pool_assignments_--;
+    }
+    RunThread(DequeueThread(tid));
+  }
+}
 
+void ThreadManager::RunThread(const std::shared_ptr<Thread> &thread) {
   // Update the thread info in pthread_self.
   enc_update_pthread_info(thread->GetThreadTls());
 
@@ -270,13 +368,13 @@ int ThreadManager::StartThread(pid_t tid) {
       zombie_threads_.insert(pthread_self());
     }
     threads_.erase(pthread_self());
+    PublishStats();
     pthread_cond_broadcast(&threads_cond_);
   }
 
   // Thread finished execution, reset the thread ID and release the TLS memory.
   munmap(reinterpret_cast<struct __pthread_info *>(pthread_self())->self,
          reinterpret_cast<struct __pthread_info *>(pthread_self())->tls_size);
-  return 0;
 }
 
 void ThreadManager::UpdateThreadResult(const pthread_t thread_id, void *ret) {
@@ -375,10 +473,17 @@ void ThreadManager::Finalize() {
     thread.second->SignalStateWaiters();
   }
 
-  // Wait for any expected threads to be donated and all threads to return from
-  // start_routine.
-  WaitFor([this]() { return queued_threads_.empty() && threads_.empty(); },
-          &threads_cond_, &threads_lock_);
+  // Release any idle pool threads.
+  pthread_cond_broadcast(&pool_cond_);
+
+  // Wait for any expected threads to be donated, all threads to return from
+  // start_routine, and all pool threads to leave the enclave.
+  WaitFor(
+      [this]() {
+        return queued_threads_.empty() && threads_.empty() &&
+               pending_pool_threads_ == 0 && pool_threads_ == 0;
+      },
+      &threads_cond_, &threads_lock_);
 }
 
 }  // namespace asylo
@@ -30,6 +30,8 @@
 #include <unordered_set>
 #include <utility>
 
+#include "asylo/platform/common/enclave_thread_stats.h"
+
 namespace asylo {
 
 bool ReturnFalse();
@@ -55,9 +57,19 @@ class ThreadManager {
 
   // Removes a function from the start_routine queue and runs it. If no
   // start_routine is present this function will abort(). |tid| is the system
-  // thread ID from the host.
+  // thread ID from the host. If the thread was donated by StartThreadPool(),
+  // instead parks it in the thread pool until the ThreadManager is finalized.
   int StartThread(pid_t tid);
 
+  // Donates |size| threads to the enclave to form a pool of parked threads.
+  // Threads created by CreateThread() while a pool thread is idle are run by
+  // that pool thread, without exiting the enclave to donate a new thread.
+  void StartThreadPool(int size);
+
+  // Publishes thread counters to |stats|, which lies in untrusted memory, from
+  // now on. Passing nullptr stops publishing.
+  void SetStats(EnclaveThreadStats *stats);
+
   // Updates the result of start function in the ThreadManager.
   void UpdateThreadResult(pthread_t thread_id, void *ret);
 
@@ -195,6 +207,24 @@ class ThreadManager {
   // Returns a Thread pointer for a given |thread_id|.
   std::shared_ptr<Thread> GetThread(pthread_t thread_id);
 
+  // Runs |thread| on the calling donated thread, waits for it to be joined or
+  // detached, and releases its resources.
+  void RunThread(const std::shared_ptr<Thread> &thread);
+
+  // Runs queued threads handed to the pool on the calling donated thread until
+  // the ThreadManager is finalized. |tid| is the system thread ID from the
+  // host.
+  void RunPoolThread(pid_t tid);
+
+  // Hands a queued thread to an idle pool thread, if there is one. Returns true
+  // if a pool thread will run it, in which case no thread needs to be donated
+  // for it.
+  bool AssignToPoolThread();
+
+  // Writes the current thread counters to the registered EnclaveThreadStats,
+  // if any. Must be called with threads_lock_ held.
+  void PublishStats();
+
   // Guards queued_threads_ and threads_.
   pthread_mutex_t threads_lock_ = PTHREAD_MUTEX_INITIALIZER;
   pthread_cond_t threads_cond_ = PTHREAD_COND_INITIALIZER;
@@ -210,10 +240,29 @@ class ThreadManager {
   // calls.
   std::unordered_map<pthread_t, std::shared_ptr<Thread>> threads_;
 
+  // Signaled when a queued thread is handed to the pool, or when the pool is
+  // asked to return during finalize. Guarded by threads_lock_.
+  pthread_cond_t pool_cond_ = PTHREAD_COND_INITIALIZER;
+
+  // Number of pool threads requested from the host that have not yet entered
+  // the enclave, and number of pool threads inside the enclave. Guarded by
+  // threads_lock_.
+  int pending_pool_threads_ = 0;
+  int pool_threads_ = 0;
+
+  // Number of pool threads waiting for work, and number of queued threads
+  // handed to the pool that no pool thread has dequeued yet. Guarded by
+  // threads_lock_.
+  int idle_pool_threads_ = 0;
+  int pool_assignments_ = 0;
+
   // Set of thread ids that completed during finalize, but were not joined. Keep
   // track of these in case join is called on the thread after it finishes.
   std::unordered_set<pthread_t> zombie_threads_;
 
+  // Counters in untrusted memory updated by PublishStats(), or nullptr.
+  std::atomic<EnclaveThreadStats *> stats_{nullptr};
+
   // Track whether or not we're finalizing the ThreadManager. Once we enter
   // finalize, cleanup/join behavior changes slightly to account for enclaves
   // that don't join all their threads. While finalizing, join becomes a noop
@@ -24,6 +24,7 @@
 
 #include "asylo/platform/common/time_util.h"
 #include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/platform/posix/host_time.h"
 
 using asylo::NanosecondsToTimeSpec;
 using asylo::NanosecondsToTimeVal;
@@ -35,6 +36,23 @@ namespace {
 static_assert(sizeof(std::atomic<int64_t>) == sizeof(int64_t),
               "lockfree int64_t is unavailable.");
 
+// Latest CLOCK_MONOTONIC value returned to any thread.
+std::atomic<int64_t> last_monotonic_nanos{0};
+
+// Returns |nanos|, or the latest CLOCK_MONOTONIC value returned before if that
+// is later. Readings from the host time page may lag behind readings obtained
+// with a host call, and neither is trusted, so monotonicity is enforced here.
+int64_t EnforceMonotonic(int64_t nanos) {
+  int64_t last = last_monotonic_nanos.load(std::memory_order_relaxed);
+  while (nanos > last) {
+    if (last_monotonic_nanos.compare_exchange_weak(
+            last, nanos, std::memory_order_relaxed)) {
+      return nanos;
+    }
+  }
+  return last;
+}
+
 }  // namespace
 
 extern "C" {
@@ -52,6 +70,11 @@ int enclave_gettimeofday(struct timeval *__restrict time, void *timezone) {
   }
 
   struct timeval tval {};
+  int64_t nanos;
+  if (asylo::ReadHostTimePage(CLOCK_REALTIME, &nanos)) {
+    NanosecondsToTimeVal(time, nanos);
+    return 0;
+  }
   int result = enc_untrusted_gettimeofday(&tval, nullptr);
   time->tv_sec = tval.tv_sec;
   time->tv_usec = tval.tv_usec;
@@ -61,13 +84,19 @@ int enclave_gettimeofday(struct timeval *__restrict time, void *timezone) {
 int enclave_times(struct tms *buf) { return enc_untrusted_times(buf); }
 
 int clock_gettime(clockid_t clock_id, struct timespec *time) {
-  int result = enc_untrusted_clock_gettime(clock_id, time);
+  int64_t nanos;
+  int result = 0;
+  if (asylo::ReadHostTimePage(clock_id, &nanos)) {
+    NanosecondsToTimeSpec(time, nanos);
+  } else {
+    result = enc_untrusted_clock_gettime(clock_id, time);
+    if (result != 0) {
+      return result;
+    }
+  }
   if (clock_id == CLOCK_MONOTONIC) {
-    int64_t clock_monotonic = TimeSpecToNanoseconds(time);
-    thread_local static int64_t last_tick = clock_monotonic;
     // CLOCK_MONOTONIC should never go backwards.
-    if (clock_monotonic < last_tick) abort();
-    last_tick = clock_monotonic;
+    NanosecondsToTimeSpec(time, EnforceMonotonic(TimeSpecToNanoseconds(time)));
   }
   return result;
 }
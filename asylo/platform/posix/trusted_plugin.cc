@@ -0,0 +1,125 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/trusted_plugin.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "asylo/util/status.h"
+#include "asylo/util/status_macros.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+namespace {
+
+// The state of a registered plugin. Records are created by the first open of
+// a plugin and never destroyed, so a handle to a closed plugin is detected
+// rather than dereferenced after being freed.
+struct PluginRecord {
+  TrustedPlugin *plugin;
+  TrustedPlugin::SymbolTable symbols;
+  int open_count = 0;
+};
+
+struct PluginRegistry {
+  absl::Mutex mu;
+  std::unordered_map<std::string, std::unique_ptr<PluginRecord>> records
+      ABSL_GUARDED_BY(mu);
+};
+
+PluginRegistry *GetRegistry() {
+  static PluginRegistry *registry = new PluginRegistry();
+  return registry;
+}
+
+// Returns the open record identified by |handle|, or an error if |handle| is
+// not a handle to an open plugin.
+StatusOr<PluginRecord *> GetOpenRecord(PluginRegistry *registry, void *handle)
+    ABSL_EXCLUSIVE_LOCKS_REQUIRED(registry->mu) {
+  for (auto &entry : registry->records) {
+    if (entry.second.get() == handle && entry.second->open_count > 0) {
+      return entry.second.get();
+    }
+  }
+  return Status(error::GoogleError::INVALID_ARGUMENT,
+                "Invalid trusted plugin handle");
+}
+
+}  // namespace
+
+StatusOr<void *> OpenTrustedPlugin(absl::string_view name) {
+  std::string key(name);
+  PluginRegistry *registry = GetRegistry();
+  absl::MutexLock lock(&registry->mu);
+  std::unique_ptr<PluginRecord> &record = registry->records[key];
+  if (!record) {
+    auto it = TrustedPluginMap::GetValue(key);
+    if (it == TrustedPluginMap::value_end()) {
+      registry->records.erase(key);
+      return Status(error::GoogleError::NOT_FOUND,
+                    absl::StrCat("No trusted plugin named ", name));
+    }
+    record.reset(new PluginRecord());
+    record->plugin = &*it;
+  }
+
+  if (record->open_count == 0) {
+    Status status = record->plugin->Load(&record->symbols);
+    if (!status.ok()) {
+      record->symbols.clear();
+      return status.WithPrependedContext(
+          absl::StrCat("Failed to load trusted plugin ", name));
+    }
+  }
+  ++record->open_count;
+  return record.get();
+}
+
+StatusOr<void *> FindTrustedPluginSymbol(void *handle,
+                                         absl::string_view symbol) {
+  PluginRegistry *registry = GetRegistry();
+  absl::MutexLock lock(&registry->mu);
+  PluginRecord *record;
+  ASYLO_ASSIGN_OR_RETURN(record, GetOpenRecord(registry, handle));
+  auto it = record->symbols.find(std::string(symbol));
+  if (it == record->symbols.end()) {
+    return Status(error::GoogleError::NOT_FOUND,
+                  absl::StrCat("Trusted plugin ", record->plugin->Name(),
+                               " does not export ", symbol));
+  }
+  return it->second;
+}
+
+Status CloseTrustedPlugin(void *handle) {
+  PluginRegistry *registry = GetRegistry();
+  absl::MutexLock lock(&registry->mu);
+  PluginRecord *record;
+  ASYLO_ASSIGN_OR_RETURN(record, GetOpenRecord(registry, handle));
+  if (--record->open_count == 0) {
+    record->plugin->Unload();
+    record->symbols.clear();
+  }
+  return Status::OkStatus();
+}
+
+}  // namespace asylo
@@ -0,0 +1,99 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_POSIX_TRUSTED_PLUGIN_H_
+#define ASYLO_PLATFORM_POSIX_TRUSTED_PLUGIN_H_
+
+#include <string>
+#include <unordered_map>
+
+#include "absl/strings/string_view.h"
+#include "asylo/platform/common/static_map.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+
+// A component linked into the enclave whose initialization is deferred until
+// it is first opened with dlopen(). Rarely used functionality can register
+// itself as a plugin so that its setup cost, and any memory it allocates, is
+// only paid by enclaves that use it.
+//
+// Plugins are part of the enclave image and so are covered by its measurement
+// and signature. dlopen() never maps code from outside the enclave.
+//
+// A plugin is registered in the .cc file defining it:
+//
+//   class CodecPlugin : public TrustedPlugin {
+//    public:
+//     std::string Name() const override { return "libcodec.so"; }
+//     Status Load(SymbolTable *symbols) override {
+//       ASYLO_RETURN_IF_ERROR(BuildTables());
+//       (*symbols)["codec_decode"] = reinterpret_cast<void *>(&Decode);
+//       return Status::OkStatus();
+//     }
+//   };
+//
+//   SET_STATIC_MAP_VALUE_OF_DERIVED_TYPE(TrustedPluginMap, CodecPlugin);
+class TrustedPlugin {
+ public:
+  // Symbols exported by a loaded plugin, by name.
+  using SymbolTable = std::unordered_map<std::string, void *>;
+
+  virtual ~TrustedPlugin() = default;
+
+  // Returns the file name under which the plugin is opened with dlopen().
+  virtual std::string Name() const = 0;
+
+  // Initializes the plugin and adds the symbols it exports to |symbols|.
+  // Called when the plugin is opened while it is not loaded. If it returns an
+  // error, the plugin stays unloaded and the open fails.
+  virtual Status Load(SymbolTable *symbols) = 0;
+
+  // Releases the resources acquired by Load(). Called when the last handle to
+  // the plugin is closed.
+  //
+  // Load() and Unload() are called while no other plugin is being opened or
+  // closed, and must not open or close plugins themselves.
+  virtual void Unload() {}
+};
+
+// \cond Internal
+template <>
+struct Namer<TrustedPlugin> {
+  std::string operator()(const TrustedPlugin &plugin) { return plugin.Name(); }
+};
+
+DEFINE_STATIC_MAP_OF_BASE_TYPE(TrustedPluginMap, TrustedPlugin);
+// \endcond
+
+// Opens the plugin registered as |name|, loading it if it is not loaded, and
+// returns a handle to it. Handles are counted; the plugin is unloaded when
+// every handle has been closed.
+StatusOr<void *> OpenTrustedPlugin(absl::string_view name);
+
+// Returns the address of |symbol| exported by the plugin opened as |handle|.
+StatusOr<void *> FindTrustedPluginSymbol(void *handle,
+                                         absl::string_view symbol);
+
+// Closes a handle returned by OpenTrustedPlugin().
+Status CloseTrustedPlugin(void *handle);
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_TRUSTED_PLUGIN_H_
@@ -0,0 +1,114 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/trusted_plugin.h"
+
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+namespace {
+
+int loads = 0;
+int unloads = 0;
+bool fail_load = false;
+
+int Answer() { return 42; }
+
+class TestPlugin : public TrustedPlugin {
+ public:
+  std::string Name() const override { return "libtest_plugin.so"; }
+
+  Status Load(SymbolTable *symbols) override {
+    if (fail_load) {
+      return Status(error::GoogleError::INTERNAL, "Load failed");
+    }
+    ++loads;
+    (*symbols)["answer"] = reinterpret_cast<void *>(&Answer);
+    return Status::OkStatus();
+  }
+
+  void Unload() override { ++unloads; }
+};
+
+SET_STATIC_MAP_VALUE_OF_DERIVED_TYPE(TrustedPluginMap, TestPlugin);
+
+class TrustedPluginTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    loads = 0;
+    unloads = 0;
+    fail_load = false;
+  }
+};
+
+TEST_F(TrustedPluginTest, LoadsOnFirstOpenAndUnloadsOnLastClose) {
+  StatusOr<void *> first = OpenTrustedPlugin("libtest_plugin.so");
+  ASYLO_ASSERT_OK(first);
+  StatusOr<void *> second = OpenTrustedPlugin("libtest_plugin.so");
+  ASYLO_ASSERT_OK(second);
+  EXPECT_EQ(first.ValueOrDie(), second.ValueOrDie());
+  EXPECT_EQ(loads, 1);
+
+  StatusOr<void *> address =
+      FindTrustedPluginSymbol(first.ValueOrDie(), "answer");
+  ASYLO_ASSERT_OK(address);
+  EXPECT_EQ(reinterpret_cast<int (*)()>(address.ValueOrDie())(), 42);
+  EXPECT_THAT(
+      FindTrustedPluginSymbol(first.ValueOrDie(), "question").status(),
+      StatusIs(error::GoogleError::NOT_FOUND));
+
+  ASYLO_EXPECT_OK(CloseTrustedPlugin(first.ValueOrDie()));
+  EXPECT_EQ(unloads, 0);
+  ASYLO_EXPECT_OK(CloseTrustedPlugin(second.ValueOrDie()));
+  EXPECT_EQ(unloads, 1);
+
+  // The handle no longer refers to an open plugin.
+  EXPECT_THAT(FindTrustedPluginSymbol(first.ValueOrDie(), "answer").status(),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  EXPECT_THAT(CloseTrustedPlugin(first.ValueOrDie()),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+
+  // Reopening loads the plugin again.
+  StatusOr<void *> third = OpenTrustedPlugin("libtest_plugin.so");
+  ASYLO_ASSERT_OK(third);
+  EXPECT_EQ(loads, 2);
+  ASYLO_EXPECT_OK(CloseTrustedPlugin(third.ValueOrDie()));
+}
+
+TEST_F(TrustedPluginTest, OpenFailures) {
+  EXPECT_THAT(OpenTrustedPlugin("libmissing.so").status(),
+              StatusIs(error::GoogleError::NOT_FOUND));
+
+  fail_load = true;
+  EXPECT_THAT(OpenTrustedPlugin("libtest_plugin.so").status(),
+              StatusIs(error::GoogleError::INTERNAL));
+  fail_load = false;
+  StatusOr<void *> handle = OpenTrustedPlugin("libtest_plugin.so");
+  ASYLO_ASSERT_OK(handle);
+  EXPECT_EQ(loads, 1);
+  ASYLO_EXPECT_OK(CloseTrustedPlugin(handle.ValueOrDie()));
+}
+
+}  // namespace
+}  // namespace asylo
@@ -26,6 +26,7 @@
 
 #include "asylo/platform/core/trusted_global_state.h"
 #include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/platform/posix/io/buffered_writer.h"
 #include "asylo/platform/posix/io/io_manager.h"
 #include "asylo/platform/primitives/trusted_primitives.h"
 #include "asylo/platform/primitives/trusted_runtime.h"
@@ -264,6 +265,10 @@ ssize_t pread(int fd, void *buf, size_t count, off_t offset) {
   return IOManager::GetInstance().PRead(fd, buf, count, offset);
 }
 
+ssize_t pwrite(int fd, const void *buf, size_t count, off_t offset) {
+  return IOManager::GetInstance().PWrite(fd, buf, count, offset);
+}
+
 // The functions below are prefixed with |enclave_|, as they are plumbed in from
 // newlib.
 int enclave_getpid() {
@@ -286,6 +291,7 @@ int enclave_unlink(const char *pathname) {
 }
 
 void enclave_exit(int rc) {
+  asylo::io::BufferedWriter::FlushAll();
   while (true) {
     enc_exit(rc);
   }
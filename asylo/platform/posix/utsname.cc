@@ -19,11 +19,11 @@
 #include <stdlib.h>
 #include <sys/utsname.h>
 
-#include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/platform/posix/host_info_cache.h"
 
 extern "C" {
 
-// Retrieves system information from the host.
-int uname(struct utsname *buf) { return enc_untrusted_uname(buf); }
+// Retrieves system information from the host, or from the host info cache.
+int uname(struct utsname *buf) { return asylo::CachedUname(buf); }
 
 }  // extern "C"
@@ -0,0 +1,224 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/ctr_drbg.h"
+
+#include <cpuid.h>
+#include <immintrin.h>
+#include <string.h>
+
+#include <algorithm>
+
+namespace asylo {
+namespace {
+
+// Number of blocks encrypted in parallel by bulk requests, enough to fill the
+// AES pipeline.
+constexpr int kParallelBlocks = 8;
+
+constexpr size_t kBlockSize = 16;
+
+bool cpuid_aesni() {
+  unsigned int eax, ebx, ecx, edx;
+  __cpuid(1, eax, ebx, ecx, edx);
+  // Bit 25 of ECX is set => machine supports AES-NI.
+  return !!(ecx & (1 << 25));
+}
+
+// Computes the next round key of the AES-256 key schedule from |previous|, the
+// round key two rounds back, and the output of aeskeygenassist on the last
+// round key, already broadcast to every word.
+__m128i NextRoundKey(__m128i previous, __m128i assist) {
+  previous = _mm_xor_si128(previous, _mm_slli_si128(previous, 4));
+  previous = _mm_xor_si128(previous, _mm_slli_si128(previous, 4));
+  previous = _mm_xor_si128(previous, _mm_slli_si128(previous, 4));
+  return _mm_xor_si128(previous, assist);
+}
+
+// Computes the two round keys following |round_keys|[0] and |round_keys|[1].
+// aeskeygenassist takes the round constant as an immediate, hence the template
+// parameter.
+template <int kRoundConstant>
+void ExpandRoundKeys(__m128i *round_keys) {
+  round_keys[2] = NextRoundKey(
+      round_keys[0],
+      _mm_shuffle_epi32(
+          _mm_aeskeygenassist_si128(round_keys[1], kRoundConstant), 0xff));
+  round_keys[3] = NextRoundKey(
+      round_keys[1],
+      _mm_shuffle_epi32(_mm_aeskeygenassist_si128(round_keys[2], 0), 0xaa));
+}
+
+void WipeMemory(void *buf, size_t size) {
+  volatile uint8_t *bytes = static_cast<volatile uint8_t *>(buf);
+  for (size_t i = 0; i < size; i++) {
+    bytes[i] = 0;
+  }
+}
+
+}  // namespace
+
+constexpr size_t CtrDrbg::kSeedLength;
+constexpr size_t CtrDrbg::kMaxRequestBytes;
+constexpr uint64_t CtrDrbg::kReseedInterval;
+constexpr int CtrDrbg::kRoundKeys;
+
+bool aesni_supported() {
+  static bool supported = cpuid_aesni();
+  return supported;
+}
+
+void CtrDrbg::Seed(const uint8_t *seed) {
+  uint8_t zero_key[32] = {};
+  SetKey(zero_key);
+  v_high_ = 0;
+  v_low_ = 0;
+  Update(seed);
+  reseed_counter_ = 1;
+}
+
+void CtrDrbg::Reseed(const uint8_t *entropy) {
+  Update(entropy);
+  reseed_counter_ = 1;
+}
+
+void CtrDrbg::Generate(uint8_t *out, size_t count) {
+  while (count > 0) {
+    size_t request = std::min(count, kMaxRequestBytes);
+    GenerateBlocks(out, request);
+    // Update the state after each request for backtracking resistance.
+    Update(nullptr);
+    reseed_counter_++;
+    out += request;
+    count -= request;
+  }
+}
+
+void CtrDrbg::Clear() {
+  WipeMemory(round_keys_, sizeof(round_keys_));
+  WipeMemory(&v_high_, sizeof(v_high_));
+  WipeMemory(&v_low_, sizeof(v_low_));
+  reseed_counter_ = kReseedInterval + 1;
+}
+
+void CtrDrbg::SetKey(const uint8_t *key) {
+  round_keys_[0] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(key));
+  round_keys_[1] =
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(key + kBlockSize));
+  ExpandRoundKeys<0x01>(&round_keys_[0]);
+  ExpandRoundKeys<0x02>(&round_keys_[2]);
+  ExpandRoundKeys<0x04>(&round_keys_[4]);
+  ExpandRoundKeys<0x08>(&round_keys_[6]);
+  ExpandRoundKeys<0x10>(&round_keys_[8]);
+  ExpandRoundKeys<0x20>(&round_keys_[10]);
+  // The last step of the schedule only needs its first round key.
+  round_keys_[14] = NextRoundKey(
+      round_keys_[12],
+      _mm_shuffle_epi32(_mm_aeskeygenassist_si128(round_keys_[13], 0x40),
+                        0xff));
+}
+
+__m128i CtrDrbg::EncryptCounter(uint64_t increment) const {
+  uint64_t low = v_low_ + increment;
+  uint64_t high = v_high_ + (low < v_low_ ? 1 : 0);
+  // The counter is big-endian, so its high half comes first in memory.
+  __m128i block = _mm_set_epi64x(__builtin_bswap64(low),
+                                 __builtin_bswap64(high));
+  block = _mm_xor_si128(block, round_keys_[0]);
+  for (int i = 1; i < kRoundKeys - 1; i++) {
+    block = _mm_aesenc_si128(block, round_keys_[i]);
+  }
+  return _mm_aesenclast_si128(block, round_keys_[kRoundKeys - 1]);
+}
+
+void CtrDrbg::IncrementCounter() {
+  v_low_++;
+  if (v_low_ == 0) {
+    v_high_++;
+  }
+}
+
+void CtrDrbg::Update(const uint8_t *provided_data) {
+  alignas(16) uint8_t temp[kSeedLength];
+  for (int i = 0; i < 3; i++) {
+    __m128i block = EncryptCounter(i + 1);
+    if (provided_data) {
+      block = _mm_xor_si128(
+          block, _mm_loadu_si128(reinterpret_cast<const __m128i *>(
+                     provided_data + i * kBlockSize)));
+    }
+    _mm_store_si128(reinterpret_cast<__m128i *>(temp + i * kBlockSize), block);
+  }
+  SetKey(temp);
+  uint64_t v_high, v_low;
+  memcpy(&v_high, temp + 32, sizeof(v_high));
+  memcpy(&v_low, temp + 40, sizeof(v_low));
+  v_high_ = __builtin_bswap64(v_high);
+  v_low_ = __builtin_bswap64(v_low);
+  WipeMemory(temp, sizeof(temp));
+}
+
+void CtrDrbg::GenerateBlocks(uint8_t *out, size_t count) {
+  // Bulk of the request, eight counter blocks at a time with the rounds of all
+  // blocks interleaved.
+  while (count >= kParallelBlocks * kBlockSize) {
+    __m128i blocks[kParallelBlocks];
+    for (int j = 0; j < kParallelBlocks; j++) {
+      uint64_t low = v_low_ + j + 1;
+      uint64_t high = v_high_ + (low < v_low_ ? 1 : 0);
+      blocks[j] = _mm_xor_si128(
+          _mm_set_epi64x(__builtin_bswap64(low), __builtin_bswap64(high)),
+          round_keys_[0]);
+    }
+    for (int i = 1; i < kRoundKeys - 1; i++) {
+      for (int j = 0; j < kParallelBlocks; j++) {
+        blocks[j] = _mm_aesenc_si128(blocks[j], round_keys_[i]);
+      }
+    }
+    for (int j = 0; j < kParallelBlocks; j++) {
+      blocks[j] = _mm_aesenclast_si128(blocks[j], round_keys_[kRoundKeys - 1]);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + j * kBlockSize),
+                       blocks[j]);
+    }
+    v_low_ += kParallelBlocks;
+    if (v_low_ < kParallelBlocks) {
+      v_high_++;
+    }
+    out += kParallelBlocks * kBlockSize;
+    count -= kParallelBlocks * kBlockSize;
+  }
+
+  // Remaining blocks one at a time, the last one possibly partial.
+  while (count > 0) {
+    IncrementCounter();
+    __m128i block = EncryptCounter(0);
+    size_t bytes = std::min(count, kBlockSize);
+    if (bytes == kBlockSize) {
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out), block);
+    } else {
+      alignas(16) uint8_t temp[kBlockSize];
+      _mm_store_si128(reinterpret_cast<__m128i *>(temp), block);
+      memcpy(out, temp, bytes);
+      WipeMemory(temp, sizeof(temp));
+    }
+    out += bytes;
+    count -= bytes;
+  }
+}
+
+}  // namespace asylo
@@ -0,0 +1,99 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_CTR_DRBG_H_
+#define ASYLO_PLATFORM_PRIMITIVES_CTR_DRBG_H_
+
+#include <immintrin.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace asylo {
+
+// Returns whether the CPU supports the AES-NI instructions used by CtrDrbg.
+bool aesni_supported();
+
+// CTR_DRBG with AES-256 and no derivation function, as specified in NIST SP
+// 800-90A section 10.2.1, implemented with AES-NI. Output is generated eight
+// blocks at a time, so that bulk requests keep the AES units busy.
+//
+// The object is trivially constructible and destructible so that it can be
+// kept in thread-local storage. It must be seeded with Seed() before use, and
+// should be wiped with Clear() when no longer needed. It is not thread-safe.
+class CtrDrbg {
+ public:
+  // Length of the seed and entropy inputs, the key length plus the block
+  // length.
+  static constexpr size_t kSeedLength = 48;
+
+  // Maximum number of bytes produced by a single internal generate request.
+  // Larger requests are split, with a state update after each part.
+  static constexpr size_t kMaxRequestBytes = 1 << 16;
+
+  // Number of generate requests after which NeedsReseed() returns true. This
+  // is far below the limit of the specification, so that a compromised state
+  // does not predict much output.
+  static constexpr uint64_t kReseedInterval = 1 << 12;
+
+  // Instantiates the DRBG with |seed|, which must hold kSeedLength bytes of
+  // full entropy.
+  void Seed(const uint8_t *seed);
+
+  // Mixes kSeedLength bytes of fresh |entropy| into the state.
+  void Reseed(const uint8_t *entropy);
+
+  // Returns true if the DRBG should be reseeded before the next Generate().
+  bool NeedsReseed() const { return reseed_counter_ > kReseedInterval; }
+
+  // Writes |count| pseudorandom bytes to |out|.
+  void Generate(uint8_t *out, size_t count);
+
+  // Erases the state. The DRBG must be seeded again before further use.
+  void Clear();
+
+ private:
+  // Number of AES-256 round keys.
+  static constexpr int kRoundKeys = 15;
+
+  // Expands the 32-byte |key| into |round_keys_|.
+  void SetKey(const uint8_t *key);
+
+  // Returns the encryption of the counter block |v_| + |increment|.
+  __m128i EncryptCounter(uint64_t increment) const;
+
+  // Advances the counter by one block.
+  void IncrementCounter();
+
+  // The CTR_DRBG_Update function, with |provided_data| of kSeedLength bytes,
+  // or nullptr for all-zero provided data.
+  void Update(const uint8_t *provided_data);
+
+  // Generates up to kMaxRequestBytes bytes without updating the state.
+  void GenerateBlocks(uint8_t *out, size_t count);
+
+  __m128i round_keys_[kRoundKeys];
+  // The counter block V as a 128-bit big-endian integer.
+  uint64_t v_high_;
+  uint64_t v_low_;
+  uint64_t reseed_counter_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_CTR_DRBG_H_
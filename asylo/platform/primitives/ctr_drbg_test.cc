@@ -0,0 +1,111 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/ctr_drbg.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/strings/escaping.h"
+
+namespace asylo {
+namespace {
+
+// Expected outputs were computed with an independent implementation of
+// CTR_DRBG built on a reference AES-256.
+constexpr char kFirstOutput[] =
+      "061550234d158c5ec95595fe04ef7a25767f2e24cc2bc479d09d86dc9abcfde7"
+      "056a8c266f9ef97ed08541dbd2e1ffa19810f5392d076276ef41277c3ab6e94a";
+constexpr char kSecondOutput[] =
+      "04562ad35e8ecafaafda16981cdaa147606beea62801342af13c8b5535f72f94"
+      "95b74317c762f0adab7abe710797612176b61b0e208398113cf9c170157bc75f"
+      "a698b6c4ea2679084e27634ca3380be448690c5f837bd6d3ab0cc76aa7d9ad6a"
+      "8b3c1d1bd84c70521a30559f69e3c29e37a7b22d8f81e7d19aa40db277e39d1c"
+      "727c33c94262cde09b82a787abcb7cdc81f8400e20dd8922a070fd6a1caa3456"
+      "22193178e48b352f2db562cbfa5e3083fc8e42d9a4d5dff2f31d1cf827ea7923"
+      "2191f59cfc87cdcb";
+constexpr char kOutputAfterReseed[] =
+      "361297d5a8e55beae56119270a823387258b7ae95014a9ad448f90a7f73d2e80"
+      "11";
+
+class CtrDrbgTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    for (size_t i = 0; i < CtrDrbg::kSeedLength; i++) {
+      seed_[i] = i;
+      entropy_[i] = CtrDrbg::kSeedLength + i;
+    }
+  }
+
+  std::string Generate(CtrDrbg *drbg, size_t count) {
+    std::vector<uint8_t> output(count);
+    drbg->Generate(output.data(), output.size());
+    return absl::BytesToHexString(absl::string_view(
+        reinterpret_cast<const char *>(output.data()), output.size()));
+  }
+
+  uint8_t seed_[CtrDrbg::kSeedLength];
+  uint8_t entropy_[CtrDrbg::kSeedLength];
+};
+
+TEST_F(CtrDrbgTest, KnownAnswers) {
+  if (!aesni_supported()) return;
+  CtrDrbg drbg;
+  drbg.Seed(seed_);
+  // The second request covers both the parallel and the partial block paths.
+  EXPECT_EQ(Generate(&drbg, 64), kFirstOutput);
+  EXPECT_EQ(Generate(&drbg, 200), kSecondOutput);
+  drbg.Reseed(entropy_);
+  EXPECT_EQ(Generate(&drbg, 33), kOutputAfterReseed);
+  drbg.Clear();
+}
+
+TEST_F(CtrDrbgTest, LargeRequestsAreSplit) {
+  if (!aesni_supported()) return;
+  CtrDrbg whole;
+  whole.Seed(seed_);
+  std::string whole_output =
+      Generate(&whole, CtrDrbg::kMaxRequestBytes + 100);
+
+  CtrDrbg split;
+  split.Seed(seed_);
+  std::string split_output = Generate(&split, CtrDrbg::kMaxRequestBytes);
+  split_output += Generate(&split, 100);
+  EXPECT_EQ(whole_output, split_output);
+}
+
+TEST_F(CtrDrbgTest, NeedsReseedAfterInterval) {
+  if (!aesni_supported()) return;
+  CtrDrbg drbg;
+  drbg.Seed(seed_);
+  uint8_t byte;
+  for (uint64_t i = 0; i < CtrDrbg::kReseedInterval; i++) {
+    EXPECT_FALSE(drbg.NeedsReseed());
+    drbg.Generate(&byte, 1);
+  }
+  EXPECT_TRUE(drbg.NeedsReseed());
+  drbg.Reseed(entropy_);
+  EXPECT_FALSE(drbg.NeedsReseed());
+  drbg.Clear();
+  EXPECT_TRUE(drbg.NeedsReseed());
+}
+
+}  // namespace
+}  // namespace asylo
@@ -23,7 +23,10 @@
 #include <cstdint>
 #include <type_traits>
 
+#include "absl/container/inlined_vector.h"
+#include "asylo/platform/primitives/extent.h"
 #include "asylo/platform/primitives/primitive_status.h"
+#include "asylo/platform/primitives/util/message.h"
 
 namespace asylo {
 namespace primitives {
@@ -34,7 +37,31 @@ constexpr uint64_t dlopen_trampoline_address = 0x7e0000000000;
 // Trampoline magic number and version.
 constexpr uint64_t kTrampolineMagicNumber =
     0x446c4f54724d6167;  // "DlOTrMag"
-constexpr uint64_t kTrampolineVersion = 0;
+constexpr uint64_t kTrampolineVersion = 1;
+
+// Trusted and untrusted components share an address space, so messages are
+// passed across the boundary as arrays of extents referring to the contents of
+// the sender's MessageWriter in place, rather than serialized into a buffer
+// allocated for each call. The receiver copies each extent exactly once, into
+// the MessageReader it owns. MessageWriter and MessageReader objects are never
+// shared themselves, since each component has its own heap.
+//
+// Callback through which the callee of a call hands |count| extents of its
+// output to the caller, which copies them into the MessageReader identified by
+// |context| before returning.
+using DlopenOutputSink = void (*)(void *context, const Extent *extents,
+                                  size_t count);
+
+// Extents of a MessageWriter, valid for as long as the writer is not modified.
+using DlopenExtents = absl::InlinedVector<Extent, 8>;
+
+// Returns the extents pushed to |writer|.
+inline DlopenExtents FlattenMessage(const MessageWriter &writer) {
+  DlopenExtents extents;
+  extents.reserve(writer.size());
+  writer.Serialize([&extents](Extent extent) { extents.push_back(extent); });
+  return extents;
+}
 
 // Collection of handlers implemented by untrusted dlopen component and passed
 // to the trusted one to use. The trusted component is statically built shared
@@ -49,8 +76,9 @@ struct DlopenTrampoline {
   uint64_t magic_number;
   uint64_t version;
   PrimitiveStatus (*asylo_exit_call)(uint64_t untrusted_selector,
-                                     const void *input, size_t input_size,
-                                     void **output, size_t *output_size);
+                                     const Extent *input, size_t input_count,
+                                     void *output_context,
+                                     DlopenOutputSink output_sink);
   void *(*asylo_local_alloc_handler)(size_t size);
   void (*asylo_local_free_handler)(void *ptr);
 };
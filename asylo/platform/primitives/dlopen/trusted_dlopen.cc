@@ -18,6 +18,7 @@
 
 #include <unistd.h>
 
+#include <cstdint>
 #include <cstdio>
 #include <cstring>
 
@@ -57,6 +58,39 @@ struct DlopenState {
   }
 };
 
+// Copies |count| extents located in untrusted memory into |reader|. Each extent
+// is read from untrusted memory once and bounds checked before its contents are
+// copied, which prevents TOC/TOU attacks.
+void DeserializeExtentsFromUntrusted(const Extent *extents, size_t count,
+                                     MessageReader *reader) {
+  if (count == 0) {
+    return;
+  }
+  if (count > SIZE_MAX / sizeof(Extent) ||
+      !TrustedPrimitives::IsOutsideEnclave(extents, count * sizeof(Extent))) {
+    TrustedPrimitives::BestEffortAbort(
+        "Input should lie within untrusted memory.");
+    return;
+  }
+  reader->Deserialize(count, [extents](size_t i) {
+    Extent extent = extents[i];
+    if (!TrustedPrimitives::IsOutsideEnclave(extent.data(), extent.size())) {
+      TrustedPrimitives::BestEffortAbort(
+          "Input should lie within untrusted memory.");
+      return Extent{};
+    }
+    return extent;
+  });
+}
+
+// Copies the output extents of an exit call into the MessageReader |context|.
+void CopyFromUntrusted(void *context, const Extent *extents, size_t count) {
+  auto reader = static_cast<MessageReader *>(context);
+  if (reader) {
+    DeserializeExtentsFromUntrusted(extents, count, reader);
+  }
+}
+
 }  // namespace
 
 // Message handler installed by the runtime to finalize the enclave at the time
@@ -104,9 +138,10 @@ extern "C" void *enclave_sbrk(intptr_t increment) {
 }
 
 extern "C" PrimitiveStatus asylo_enclave_call(uint64_t selector,
-                                              const void *input,
-                                              size_t input_len, void **output,
-                                              size_t *output_len) {
+                                              const Extent *input,
+                                              size_t input_count,
+                                              void *output_context,
+                                              DlopenOutputSink output_sink) {
   if (GetDlopenTrampoline()->magic_number != kTrampolineMagicNumber ||
       GetDlopenTrampoline()->version != kTrampolineVersion) {
     TrustedPrimitives::BestEffortAbort(
@@ -116,25 +151,14 @@ extern "C" PrimitiveStatus asylo_enclave_call(uint64_t selector,
 
   MessageReader in;
   MessageWriter out;
-  // Copy untrusted input to a trusted buffer before deserializing to prevent
-  // TOC/TOU attacks.
-  auto trusted_input = CopyFromUntrusted(input, input_len);
-  if (trusted_input) {
-    in.Deserialize(trusted_input.get(), input_len);
-  }
-
+  DeserializeExtentsFromUntrusted(input, input_count, &in);
   PrimitiveStatus status = InvokeEntryHandler(selector, &in, &out);
-  size_t output_size = out.MessageSize();
-
-  if (output && output_size > 0) {
-    // Serialize |out| to untrusted memory. The untrusted caller is still
-    // responsible for freeing |*output|. Serialize to a trusted output buffer
-    // first to prevent TOC/TOU attacks.
-    std::unique_ptr<char[]> trusted_output(new char[out.MessageSize()]);
-    out.Serialize(trusted_output.get());
-    *output = CopyToUntrusted(trusted_output.get(), output_size);
+  if (!out.empty()) {
+    // Hand |out| to the untrusted caller in place, which copies it before the
+    // sink returns.
+    DlopenExtents extents = FlattenMessage(out);
+    output_sink(output_context, extents.data(), extents.size());
   }
-  *output_len = output_size;
   return status;
 }
 
@@ -182,27 +206,18 @@ void *TrustedPrimitives::UntrustedLocalMemcpy(void *dest, const void *src,
 PrimitiveStatus TrustedPrimitives::UntrustedCall(uint64_t untrusted_selector,
                                                  MessageWriter *input,
                                                  MessageReader *output) {
-  size_t input_size = 0;
-  void *input_buffer = nullptr;
+  DlopenExtents extents;
   if (input) {
-    input_size = input->MessageSize();
-    if (input_size > 0) {
-      input_buffer = TrustedPrimitives::UntrustedLocalAlloc(input_size);
-      input->Serialize(input_buffer);
-    }
+    extents = FlattenMessage(*input);
   }
-  size_t output_size = 0;
-  void *output_buffer = nullptr;
-  auto status = GetDlopenTrampoline()->asylo_exit_call(
-      untrusted_selector, input_buffer, input_size, &output_buffer,
-      &output_size);
-  if (output_buffer) {
-    // For the results obtained in |output_buffer|, copy them to |output| before
-    // freeing the buffer.
-    output->Deserialize(output_buffer, output_size);
-    TrustedPrimitives::UntrustedLocalFree(output_buffer);
-  }
-  return status;
+  return GetDlopenTrampoline()->asylo_exit_call(
+      untrusted_selector, extents.data(), extents.size(), output,
+      &CopyFromUntrusted);
+}
+
+PrimitiveStatus TrustedPrimitives::UntrustedBlockingCall(
+    uint64_t untrusted_selector, MessageWriter *input, MessageReader *output) {
+  return UntrustedCall(untrusted_selector, input, output);
 }
 
 int TrustedPrimitives::CreateThread() {
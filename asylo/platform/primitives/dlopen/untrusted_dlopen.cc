@@ -29,7 +29,6 @@
 
 #include "absl/base/call_once.h"
 #include "absl/debugging/leak_check.h"
-#include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "asylo/platform/primitives/dlopen/shared_dlopen.h"
 #include "asylo/platform/primitives/primitive_status.h"
@@ -46,24 +45,25 @@ namespace primitives {
 
 namespace {
 
+// Copies the output extents of a call into the MessageReader |context|.
+void CopyToMessageReader(void *context, const Extent *extents, size_t count) {
+  auto reader = static_cast<MessageReader *>(context);
+  if (reader) {
+    reader->Deserialize(count, [extents](size_t i) { return extents[i]; });
+  }
+}
+
 PrimitiveStatus dlopen_asylo_exit_call(uint64_t untrusted_selector,
-                                       const void *input, size_t input_size,
-                                       void **output, size_t *output_size) {
+                                       const Extent *input, size_t input_count,
+                                       void *output_context,
+                                       DlopenOutputSink output_sink) {
   MessageReader in;
-  in.Deserialize(input, input_size);
-  *output_size = 0;
-  *output = nullptr;
+  in.Deserialize(input_count, [input](size_t i) { return input[i]; });
   MessageWriter out;
   const auto status = Client::ExitCallback(untrusted_selector, &in, &out);
-  if (input) {
-    free(const_cast<void *>(input));
-  }
-  if (status.ok()) {
-    *output_size = out.MessageSize();
-    if (*output_size > 0) {
-      *output = malloc(*output_size);
-      out.Serialize(*output);
-    }
+  if (status.ok() && !out.empty()) {
+    DlopenExtents extents = FlattenMessage(out);
+    output_sink(output_context, extents.data(), extents.size());
   }
   return status;
 }
@@ -107,9 +107,8 @@ void InitTrampolineOnce() {
 DlopenEnclaveClient::~DlopenEnclaveClient() {
   if (dl_handle_) {
     if (enclave_call_) {
-      size_t output_size = 0;
-      void *output = nullptr;
-      enclave_call_(kSelectorAsyloFini, nullptr, 0, &output, &output_size);
+      enclave_call_(kSelectorAsyloFini, /*input=*/nullptr, /*input_count=*/0,
+                    /*output_context=*/nullptr, &CopyToMessageReader);
     }
     dlclose(dl_handle_);
   }
@@ -173,24 +172,12 @@ Status DlopenEnclaveClient::EnclaveCallInternal(uint64_t selector,
                   "Enclave client closed or uninitialized."};
   }
 
-  size_t input_size = 0;
-  std::unique_ptr<char[]> input_buffer;
+  DlopenExtents extents;
   if (input) {
-    input_size = input->MessageSize();
-    if (input_size > 0) {
-      input_buffer = absl::make_unique<char[]>(input_size);
-      input->Serialize(input_buffer.get());
-    }
-  }
-  size_t output_size = 0;
-  void *output_buffer = nullptr;
-  const auto status = enclave_call_(selector, input_buffer.get(), input_size,
-                                    &output_buffer, &output_size);
-  if (output_buffer) {
-    output->Deserialize(output_buffer, output_size);
-    free(output_buffer);
+    extents = FlattenMessage(*input);
   }
-  return MakeStatus(status);
+  return MakeStatus(enclave_call_(selector, extents.data(), extents.size(),
+                                  output, &CopyToMessageReader));
 }
 
 bool DlopenEnclaveClient::IsClosed() const { return dl_handle_ == nullptr; }
@@ -43,11 +43,14 @@
 namespace asylo {
 namespace primitives {
 
-// Type signature of the enclave entry function pointer. All data extents in
-// serialized `input` message are expected to be located in untrusted memory.
+// Type signature of the enclave entry function pointer. All `input` extents are
+// expected to be located in untrusted memory. The enclave passes its output
+// extents to `output_sink` together with `output_context` before returning.
 using EnclaveCallPtr = PrimitiveStatus (*)(uint64_t trusted_selector,
-                                           const void *input, size_t input_size,
-                                           void **output, size_t *output_size);
+                                           const Extent *input,
+                                           size_t input_count,
+                                           void *output_context,
+                                           DlopenOutputSink output_sink);
 
 // dlopen implementation of the generic "EnclaveBackend" concept.
 struct DlopenBackend {
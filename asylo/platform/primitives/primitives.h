@@ -41,10 +41,77 @@ static constexpr uint64_t kSelectorAsyloDonateThread = 2;
 /// Enclave finalization entry point selector.
 static constexpr uint64_t kSelectorAsyloFini = 3;
 
+/// Switchless exit call initialization entry point selector. Only implemented
+/// by backends supporting switchless exit calls.
+static constexpr uint64_t kSelectorAsyloInitSwitchlessOcalls = 4;
+
+/// Switchless enclave call initialization entry point selector. Only
+/// implemented by backends supporting switchless enclave calls.
+static constexpr uint64_t kSelectorAsyloInitSwitchlessEcalls = 5;
+
+/// Pending signal set initialization entry point selector. Only implemented by
+/// backends supporting deferred signal delivery.
+static constexpr uint64_t kSelectorAsyloInitPendingSignals = 6;
+
+/// Pending signal delivery entry point selector. Only implemented by backends
+/// supporting deferred signal delivery.
+static constexpr uint64_t kSelectorAsyloDeliverPendingSignals = 7;
+
+/// Host time page initialization entry point selector. Only implemented by
+/// backends supporting clock reads from a host time page.
+static constexpr uint64_t kSelectorAsyloInitHostTimePage = 8;
+
+/// Thread statistics initialization entry point selector. Only implemented by
+/// backends maintaining EnclaveThreadStats.
+static constexpr uint64_t kSelectorAsyloInitThreadStats = 9;
+
+/// Memory statistics entry point selector. Only implemented by backends
+/// reporting EnclaveMemoryStats.
+static constexpr uint64_t kSelectorAsyloGetMemoryStats = 10;
+
+/// Trace buffer initialization entry point selector. Only implemented by
+/// backends recording events to an EnclaveTraceBuffer.
+static constexpr uint64_t kSelectorAsyloInitTraceBuffer = 11;
+
+/// Profiler control entry point selectors. Only implemented by backends
+/// supporting sampling profiles of trusted code.
+static constexpr uint64_t kSelectorAsyloSetProfiling = 12;
+static constexpr uint64_t kSelectorAsyloTakeProfile = 13;
+
+/// Thread parking entry point selectors. Only implemented by backends able to
+/// release the TCS of a donated thread blocked in an exit call.
+static constexpr uint64_t kSelectorAsyloInitThreadParking = 14;
+static constexpr uint64_t kSelectorAsyloResumeThread = 15;
+
+/// Untrusted arena registration entry point selector. Only implemented by
+/// backends carving their untrusted buffers from an arena lent by the host.
+static constexpr uint64_t kSelectorAsyloInitUntrustedArena = 16;
+
+/// Host info cache initialization entry point selector. Only implemented by
+/// backends caching host facts until the host invalidates them.
+static constexpr uint64_t kSelectorAsyloInitHostInfoGenerations = 17;
+
+/// Exit profiler control entry point selectors. Only implemented by backends
+/// attributing exit calls to the trusted stacks making them.
+static constexpr uint64_t kSelectorAsyloSetExitProfiling = 18;
+static constexpr uint64_t kSelectorAsyloTakeExitProfile = 19;
+
+/// Highest entry point selector reserved for the backend. Selectors above it,
+/// up to kSelectorUser, get placeholder handlers that reject calls, so it
+/// must be moved along with each new backend selector.
+static constexpr uint64_t kSelectorAsyloLastReserved =
+    kSelectorAsyloTakeExitProfile;
+
 //////////////////////////////////////
 //      Exit handler selectors      //
 //////////////////////////////////////
 
+/// Selectors for the handlers serving the streams of EnclaveStream. The
+/// enclave reads the next chunk of a stream's input with the first, and
+/// appends a chunk to its output with the second.
+static constexpr uint64_t kSelectorStreamRead = 85;
+static constexpr uint64_t kSelectorStreamWrite = 86;
+
 /// Selector for thread creation handler.
 static constexpr uint64_t kSelectorCreateThread = 87;
 
@@ -55,11 +122,11 @@ static constexpr uint64_t kSelectorHostCall = 88;
 
 /// Selector values in [`kSelectorRemote`, `kSelectorUser`) range are reserved
 /// for remote backend needs and cannot be used by any other component.
-static constexpr uint64_t kSelectorRemote = 120;
+static constexpr uint64_t kSelectorRemote = 158;
 
 /// Selector values less than `kSelectorUser` are reserved by the runtime and
 /// may not be registered by the applications.
-static constexpr uint64_t kSelectorUser = 128;
+static constexpr uint64_t kSelectorUser = 160;
 
 }  // namespace primitives
 }  // namespace asylo
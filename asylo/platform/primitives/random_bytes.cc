@@ -21,7 +21,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <algorithm>
+#include <atomic>
 
+#include "asylo/platform/primitives/ctr_drbg.h"
 #include "asylo/platform/primitives/trusted_runtime.h"
 
 namespace {
@@ -47,6 +49,77 @@ static uint64_t rdrand64() {
   return temp;
 }
 
+static bool cpuid_rdseed() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+    return false;
+  }
+  // Bit 18 of EBX is set => machine supports RDSEED.
+  return !!(ebx & (1 << 18));
+}
+
+static bool rdseed_supported() {
+  static bool supported = cpuid_rdseed();
+  return supported;
+}
+
+// Returns 64 bits of entropy from RDSEED, or from RDRAND if RDSEED is not
+// supported or keeps failing.
+static uint64_t seed64() {
+  // RDSEED fails transiently when the entropy source is drained, so give it
+  // more attempts than RDRAND, pausing in between.
+  constexpr int kSeedRetries = 100;
+  if (rdseed_supported()) {
+    unsigned long long temp;
+    for (int i = 0; i < kSeedRetries; ++i) {
+      if (_rdseed64_step(&temp)) {
+        return temp;
+      }
+      _mm_pause();
+    }
+  }
+  return rdrand64();
+}
+
+// Seeds of the per-thread generators are only valid for the current reseed
+// generation, which enc_hardware_random_reseed() advances.
+std::atomic<uint64_t> reseed_generation(0);
+
+// A DRBG private to each thread. Trivially constructible, so the thread-local
+// instance needs no initialization guard.
+struct ThreadDrbg {
+  asylo::CtrDrbg drbg;
+  bool seeded;
+  uint64_t generation;
+};
+
+thread_local ThreadDrbg thread_drbg;
+
+// Fills |buf| from the calling thread's DRBG, which is seeded on first use and
+// reseeded from the hardware entropy source periodically and after each
+// enc_hardware_random_reseed().
+static void drbg_random(uint8_t *buf, size_t count) {
+  ThreadDrbg *state = &thread_drbg;
+  uint64_t generation = reseed_generation.load(std::memory_order_acquire);
+  if (!state->seeded || state->generation != generation ||
+      state->drbg.NeedsReseed()) {
+    uint64_t entropy[asylo::CtrDrbg::kSeedLength / sizeof(uint64_t)];
+    for (uint64_t &word : entropy) {
+      word = seed64();
+    }
+    const uint8_t *entropy_bytes = reinterpret_cast<const uint8_t *>(entropy);
+    if (state->seeded && state->generation == generation) {
+      state->drbg.Reseed(entropy_bytes);
+    } else {
+      state->drbg.Seed(entropy_bytes);
+    }
+    memset(entropy, 0, sizeof(entropy));
+    state->seeded = true;
+    state->generation = generation;
+  }
+  state->drbg.Generate(buf, count);
+}
+
 // Compute alignment properties of given buffer.
 static void CalculateAlignment(const void *buf, size_t size, size_t align_size,
                                size_t *unaligned_bytes, size_t *aligned_count,
@@ -83,10 +156,20 @@ extern "C" int enc_hardware_random_entropy() {
   return 0;
 }
 
+extern "C" void enc_hardware_random_reseed() {
+  reseed_generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
 extern "C" ssize_t enc_hardware_random(uint8_t *buf, size_t count) {
   if (!asylo::rdrand_supported()) {
     return count;
   }
+  // Serve requests from a DRBG seeded by the hardware where AES-NI is
+  // available, rather than running RDRAND for every 8 bytes.
+  if (asylo::aesni_supported()) {
+    drbg_random(buf, count);
+    return count;
+  }
   size_t unaligned_bytes;
   size_t aligned_count;
   size_t partial_bytes;
@@ -18,15 +18,23 @@
 
 #include "asylo/platform/primitives/remote/communicator.h"
 
+#include <array>
 #include <cstdint>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <queue>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/flags/flag.h"
+#include "absl/hash/hash.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "asylo/util/logging.h"
 #include "include/grpcpp/support/status.h"
@@ -44,13 +52,142 @@
 #include "include/grpcpp/security/credentials.h"
 #include "include/grpcpp/security/server_credentials.h"
 #include "include/grpcpp/server_builder.h"
+#include "opencensus/trace/propagation/trace_context.h"
+#include "opencensus/trace/span.h"
+
+ABSL_FLAG(int32_t, communicator_max_idle_workers, 0,
+          "For target side only: number of worker threads kept waiting for a "
+          "new host thread after the host thread they served has exited. "
+          "Pooled workers are reused as is, so handlers must not rely on "
+          "thread local state of a new host thread starting out empty");
+
+ABSL_FLAG(int64_t, communicator_worker_idle_timeout_ms, 10000,
+          "For target side only: number of milliseconds a pooled worker "
+          "thread waits for a new host thread before exiting");
 
 namespace asylo {
 namespace primitives {
+namespace {
+
+// Pool of target worker threads. A worker runs a single task at a time; once
+// the task returns, the worker waits for the next one for up to
+// --communicator_worker_idle_timeout_ms, unless --communicator_max_idle_workers
+// are already waiting, and exits otherwise.
+class WorkerPool {
+ public:
+  static WorkerPool *Get() {
+    static WorkerPool *const pool = new WorkerPool();
+    return pool;
+  }
+
+  // Runs |task| on an idle worker, or on a new worker if none is idle.
+  void Schedule(std::function<void()> task) {
+    std::vector<std::unique_ptr<Thread>> exited;
+    {
+      auto locked_state = state_.Lock();
+      exited.swap(locked_state->exited);
+      if (locked_state->idle > static_cast<int>(locked_state->tasks.size())) {
+        locked_state->tasks.emplace_back(std::move(task));
+      } else {
+        auto worker =
+            absl::make_unique<Thread>(&WorkerPool::WorkerLoop, this, task);
+        const Thread::Id worker_id = worker->get_id();
+        locked_state->workers.emplace(worker_id, std::move(worker));
+      }
+    }
+    JoinAll(&exited);
+  }
+
+  // Makes idle workers exit and waits until all workers have exited. Workers
+  // that are running a task exit as soon as the task returns.
+  void Drain() {
+    state_.Lock()->is_draining = true;
+    std::vector<std::unique_ptr<Thread>> exited;
+    {
+      auto locked_state = state_.LockWhen(
+          [](const State &state) { return state.workers.empty(); });
+      exited.swap(locked_state->exited);
+      locked_state->is_draining = false;
+    }
+    JoinAll(&exited);
+  }
+
+ private:
+  struct State {
+    // Running and idle workers, keyed by thread id.
+    absl::flat_hash_map<Thread::Id, std::unique_ptr<Thread>> workers;
+
+    // Workers that have exited and are yet to be joined.
+    std::vector<std::unique_ptr<Thread>> exited;
+
+    // Tasks handed to idle workers but not yet picked up.
+    std::deque<std::function<void()>> tasks;
+
+    // Number of workers waiting for a task.
+    int idle = 0;
+
+    // Flag indicating that all workers need to exit.
+    bool is_draining = false;
+  };
+
+  WorkerPool() : state_(State()) {}
+
+  void WorkerLoop(std::function<void()> task) {
+    const int max_idle_workers =
+        absl::GetFlag(FLAGS_communicator_max_idle_workers);
+    const absl::Duration idle_timeout = absl::Milliseconds(
+        absl::GetFlag(FLAGS_communicator_worker_idle_timeout_ms));
+    while (task) {
+      task();
+      task = nullptr;
+      {
+        auto locked_state = state_.Lock();
+        if (locked_state->is_draining ||
+            locked_state->idle >= max_idle_workers) {
+          break;
+        }
+        ++locked_state->idle;
+      }
+      auto locked_state =
+          state_
+              .LockWhenWithTimeout(
+                  [](const State &state) {
+                    return state.is_draining || !state.tasks.empty();
+                  },
+                  idle_timeout)
+              .second;
+      --locked_state->idle;
+      if (!locked_state->tasks.empty()) {
+        task = std::move(locked_state->tasks.front());
+        locked_state->tasks.pop_front();
+      }
+    }
+    // Hand the Thread object over to be joined by the next Schedule or Drain.
+    auto locked_state = state_.Lock();
+    auto it = locked_state->workers.find(Thread::this_thread_id());
+    CHECK(it != locked_state->workers.end());
+    locked_state->exited.emplace_back(std::move(it->second));
+    locked_state->workers.erase(it);
+  }
+
+  static void JoinAll(std::vector<std::unique_ptr<Thread>> *threads) {
+    for (auto &thread : *threads) {
+      thread->Join();
+    }
+    threads->clear();
+  }
+
+  MutexGuarded<State> state_;
+};
+
+}  // namespace
 
 ABSL_CONST_INIT thread_local Communicator::ThreadActivityWorkQueue
     *Communicator::current_thread_context_ = nullptr;
 
+ABSL_CONST_INIT thread_local const ::opencensus::trace::Span
+    *Communicator::current_span_ = nullptr;
+
 thread_local std::unique_ptr<Cleanup> Communicator::thread_exiter_;
 
 MutexGuarded<absl::flat_hash_set<Communicator *>>
@@ -108,11 +245,6 @@ class Communicator::ThreadActivityWorkQueue {
     }
   }
 
-  void SetWorkerThread(std::unique_ptr<Thread> new_worker) {
-    worker_thread_ = std::move(new_worker);
-    CHECK(worker_thread_);
-  }
-
   Thread::Id GetHostThreadId() const { return host_thread_id_; }
 
   void SignalExit() { wrapped_messages_queue_.Lock()->is_exiting = true; }
@@ -123,10 +255,6 @@ class Communicator::ThreadActivityWorkQueue {
 
   ~ThreadActivityWorkQueue() {
     SignalExit();
-    if (worker_thread_) {
-      worker_thread_->Join();
-      worker_thread_.reset();
-    }
     auto locked_message_queue = wrapped_messages_queue_.ReaderLock();
     CHECK(locked_message_queue->is_exiting ||
           locked_message_queue->queue.empty());
@@ -144,13 +272,73 @@ class Communicator::ThreadActivityWorkQueue {
   // thread on each side. 'invocation_thread_id' is passed with every Invoke RPC
   // request and allows Communicator to assign the handling to the matching
   // worker thread.
-  static MutexGuarded<
-      absl::flat_hash_map<Thread::Id, std::unique_ptr<ThreadActivityWorkQueue>>>
-      *map() {
-    static const auto static_map = new MutexGuarded<absl::flat_hash_map<
-        Thread::Id, std::unique_ptr<ThreadActivityWorkQueue>>>(
+  //
+  // The map is split into shards guarded by separate mutexes, so that looking
+  // up queues of different threads does not contend on a single lock.
+  class Map {
+   public:
+    // Returns the queue of |host_thread_id|, or nullptr if there is none.
+    std::shared_ptr<ThreadActivityWorkQueue> Find(
+        Thread::Id host_thread_id) const {
+      auto locked_shard = shard(host_thread_id).ReaderLock();
+      auto it = locked_shard->find(host_thread_id);
+      return it == locked_shard->end() ? nullptr : it->second;
+    }
+
+    // Adds |queue| unless its host thread already has one. Returns the queue
+    // stored in the map.
+    std::shared_ptr<ThreadActivityWorkQueue> Emplace(
+        std::shared_ptr<ThreadActivityWorkQueue> queue) {
+      const Thread::Id host_thread_id = queue->GetHostThreadId();
+      auto locked_shard = shard(host_thread_id).Lock();
+      return locked_shard->emplace(host_thread_id, std::move(queue))
+          .first->second;
+    }
+
+    // Removes the queue of |host_thread_id| and returns it, or nullptr if there
+    // is none.
+    std::shared_ptr<ThreadActivityWorkQueue> Erase(Thread::Id host_thread_id) {
+      auto locked_shard = shard(host_thread_id).Lock();
+      auto it = locked_shard->find(host_thread_id);
+      if (it == locked_shard->end()) {
+        return nullptr;
+      }
+      auto queue = std::move(it->second);
+      locked_shard->erase(it);
+      return queue;
+    }
+
+    // Removes all queues and returns them.
+    std::vector<std::shared_ptr<ThreadActivityWorkQueue>> Clear() {
+      std::vector<std::shared_ptr<ThreadActivityWorkQueue>> queues;
+      for (auto &map_shard : shards_) {
+        auto released_shard = map_shard.Release();
+        for (auto &entry : released_shard) {
+          queues.emplace_back(std::move(entry.second));
+        }
+      }
+      return queues;
+    }
+
+   private:
+    using Shard = MutexGuarded<
         absl::flat_hash_map<Thread::Id,
-                            std::unique_ptr<ThreadActivityWorkQueue>>());
+                            std::shared_ptr<ThreadActivityWorkQueue>>>;
+
+    static constexpr size_t kNumShards = 16;
+
+    Shard &shard(Thread::Id host_thread_id) {
+      return shards_[absl::Hash<Thread::Id>()(host_thread_id) % kNumShards];
+    }
+    const Shard &shard(Thread::Id host_thread_id) const {
+      return shards_[absl::Hash<Thread::Id>()(host_thread_id) % kNumShards];
+    }
+
+    std::array<Shard, kNumShards> shards_;
+  };
+
+  static Map *map() {
+    static Map *const static_map = new Map();
     return static_map;
   }
 
@@ -175,64 +363,53 @@ class Communicator::ThreadActivityWorkQueue {
 
   // Host thread id (for host side it matches the current thread).
   const Thread::Id host_thread_id_;
-
-  // On target: thread that processes requests coming from invocation_thread_id.
-  // On host: nullptr (requests, if any, are processed by the application
-  // thread).
-  std::unique_ptr<Thread> worker_thread_;
 };
 
-StatusOr<Communicator::ThreadActivityWorkQueue *>
+StatusOr<std::shared_ptr<Communicator::ThreadActivityWorkQueue>>
 Communicator::LocateOrCreateThreadActivityWorkQueue(
     Thread::Id invocation_thread_id) {
-  auto locked_threads_map = ThreadActivityWorkQueue::map()->Lock();
-  auto it = locked_threads_map->find(invocation_thread_id);
-  if (it == locked_threads_map->end()) {
-    auto ins = locked_threads_map->emplace(
-        invocation_thread_id,
-        absl::make_unique<ThreadActivityWorkQueue>(invocation_thread_id));
-    if (!ins.second) {
-      return Status(error::GoogleError::INTERNAL,
-                    "Failed to add thread to the map");
-    }
-    it = ins.first;
-    if (is_host()) {
-      // Before recording current_thread_context_, set a thread exit callback
-      // which will signal the target side that the matching thread is no longer
-      // needed. This callback will be invoked on that host thread when it is
-      // exiting.
-      thread_exiter_ = absl::make_unique<Cleanup>([invocation_thread_id]() {
-        for (auto communicator : *active_communicators()->ReaderLock()) {
-          if (communicator->IsConnected()) {
-            communicator->client_->SendDisposeOfThread(invocation_thread_id);
-          }
+  auto thread_activity_context =
+      ThreadActivityWorkQueue::map()->Find(invocation_thread_id);
+  if (thread_activity_context) {
+    return thread_activity_context;
+  }
+  auto new_context =
+      std::make_shared<ThreadActivityWorkQueue>(invocation_thread_id);
+  thread_activity_context =
+      ThreadActivityWorkQueue::map()->Emplace(new_context);
+  if (thread_activity_context != new_context) {
+    // Another thread added the queue first.
+    return thread_activity_context;
+  }
+  if (is_host()) {
+    // Before recording current_thread_context_, set a thread exit callback
+    // which will signal the target side that the matching thread is no longer
+    // needed. This callback will be invoked on that host thread when it is
+    // exiting.
+    thread_exiter_ = absl::make_unique<Cleanup>([invocation_thread_id]() {
+      for (auto communicator : *active_communicators()->ReaderLock()) {
+        if (communicator->IsConnected()) {
+          communicator->client_->SendDisposeOfThread(invocation_thread_id);
         }
-      });
-    } else {
-      // Create new thread to handle requests associated with that thread_id.
-      // On a host side we are always called by that very thread (when we first
-      // send something from it).
-      auto *const thread_activity_context = it->second.get();
-      auto new_worker =
-          absl::make_unique<Thread>([this, thread_activity_context] {
-            CHECK(!current_thread_context_);
-            current_thread_context_ = thread_activity_context;
-            auto message_result = MessageLoop();
-            current_thread_context_ = nullptr;
-            // May not end receiving a message.
-            CHECK(!message_result.ok())
-                << "Received a message that is not a request, ignored: "
-                << message_result.ValueOrDie()->ShortDebugString();
-          });
-      if (!new_worker) {
-        locked_threads_map->erase(it);
-        return Status(error::GoogleError::RESOURCE_EXHAUSTED,
-                      "Failed to start worker thread to handle requests");
       }
-      it->second->SetWorkerThread(std::move(new_worker));
-    }
+    });
+  } else {
+    // Hand the queue over to a worker thread to handle requests associated
+    // with that thread_id. The worker keeps the queue alive until it is
+    // signaled to exit. On a host side we are always called by that very
+    // thread (when we first send something from it).
+    WorkerPool::Get()->Schedule([this, new_context] {
+      CHECK(!current_thread_context_);
+      current_thread_context_ = new_context.get();
+      auto message_result = MessageLoop();
+      current_thread_context_ = nullptr;
+      // May not end receiving a message.
+      CHECK(!message_result.ok())
+          << "Received a message that is not a request, ignored: "
+          << message_result.ValueOrDie()->ShortDebugString();
+    });
   }
-  return it->second.get();
+  return thread_activity_context;
 }
 
 StatusOr<Communicator::CommunicationMessagePtr> Communicator::MessageLoop() {
@@ -298,6 +475,7 @@ Status Communicator::Connect(const RemoteProxyConfig &config,
 
 Communicator::Communicator(bool is_host)
     : is_host_(is_host),
+      exit_metrics_(is_host ? nullptr : std::make_shared<ExitMetrics>()),
       is_server_ready_(false),
       is_client_ready_(false),
       last_host_time_nanos_(absl::nullopt) {
@@ -319,9 +497,14 @@ Communicator::~Communicator() {
     }
   }
   // For target Communicator or the last active Communicator in host: signal
-  // created threads that they need to terminate (when thread contexts are
-  // destructed on target, they will wait for termination to happen).
-  ThreadActivityWorkQueue::map()->Release().clear();
+  // created threads that they need to terminate, and on target wait for the
+  // worker threads to exit.
+  for (const auto &thread_context : ThreadActivityWorkQueue::map()->Clear()) {
+    thread_context->SignalExit();
+  }
+  if (!is_host()) {
+    WorkerPool::Get()->Drain();
+  }
 }
 
 void Communicator::set_handler(
@@ -329,6 +512,20 @@ void Communicator::set_handler(
   service_->set_handler(std::move(handler));
 }
 
+void Communicator::set_thread_stats_provider(
+    std::function<const EnclaveThreadStats *()> provider) {
+  if (service_) {
+    service_->set_thread_stats_provider(std::move(provider));
+  }
+}
+
+void Communicator::set_memory_stats_provider(
+    std::function<StatusOr<EnclaveMemoryStats>()> provider) {
+  if (service_) {
+    service_->set_memory_stats_provider(std::move(provider));
+  }
+}
+
 void Communicator::SendEndPointAddress(absl::string_view address) {
   client_->SendEndPointAddress(address);
 }
@@ -348,16 +545,10 @@ void Communicator::Disconnect() {
 
 void Communicator::DisposeOfThread(Thread::Id exiting_thread_id) {
   CHECK(!is_host());
-  std::unique_ptr<ThreadActivityWorkQueue> thread_context;
-  {
-    auto locked_threads_map = ThreadActivityWorkQueue::map()->Lock();
-    auto it = locked_threads_map->find(exiting_thread_id);
-    if (it == locked_threads_map->end()) {
-      return;
-    }
-    thread_context = std::move(it->second);
-    locked_threads_map->erase(it);
-  }
+  // The worker thread serving the queue returns to the pool once it observes
+  // the exit signal.
+  auto thread_context =
+      ThreadActivityWorkQueue::map()->Erase(exiting_thread_id);
   if (thread_context) {
     thread_context->SignalExit();
   }
@@ -373,8 +564,20 @@ void Communicator::Invoke(
     std::function<void(std::unique_ptr<Invocation> invocation)> callback) {
   const auto prior_context = current_thread_context_;
   auto invocation = absl::make_unique<Invocation>();
+  // Trace the call as a whole; the counterpart adds the time spent queued and
+  // in the handler as children, the rest is spent on the wire.
+  ::opencensus::trace::Span span = ::opencensus::trace::Span::StartSpan(
+      "asylo/remote/Invoke", current_span_);
+  span.AddAttribute("selector", static_cast<int64_t>(selector));
+  span.AddAttribute("is_host", is_host());
   // Always return with the callback, and restore current_thread_context_.
-  asylo::Cleanup cleanup([&callback, &invocation, prior_context] {
+  asylo::Cleanup cleanup([&callback, &invocation, &span, prior_context] {
+    if (!invocation->status.ok()) {
+      const std::string status = invocation->status.ToString();
+      span.AddAnnotation("Invocation failed",
+                         {{"status", absl::string_view(status)}});
+    }
+    span.End();
     callback(std::move(invocation));
     current_thread_context_ = prior_context;
   });
@@ -389,7 +592,7 @@ void Communicator::Invoke(
       invocation->status = thread_context_result.status();
       return;
     }
-    current_thread_context_ = thread_context_result.ValueOrDie();
+    current_thread_context_ = thread_context_result.ValueOrDie().get();
   }
   if (!current_thread_context_) {
     invocation->status = Status{
@@ -402,6 +605,10 @@ void Communicator::Invoke(
   // Fill in invocation.
   invocation->selector = selector;
   invocation->invocation_thread_id = current_thread_context_->GetHostThreadId();
+  if (span.IsSampled()) {
+    invocation->trace_context =
+        ::opencensus::trace::propagation::ToTraceParentHeader(span.context());
+  }
   params_setter(invocation.get());
   if (!invocation->status.ok()) {
     return;
@@ -35,11 +35,14 @@
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
+#include "asylo/platform/common/enclave_memory_stats.h"
+#include "asylo/platform/common/enclave_thread_stats.h"
 #include "asylo/platform/primitives/extent.h"
 #include "asylo/platform/primitives/primitive_status.h"
 #include "asylo/platform/primitives/remote/grpc_service.grpc.pb.h"
 #include "asylo/platform/primitives/remote/grpc_service.pb.h"
 #include "asylo/platform/primitives/untrusted_primitives.h"
+#include "asylo/platform/primitives/util/exit_metrics.h"
 #include "asylo/platform/primitives/util/message.h"
 #include "asylo/util/asylo_macros.h"
 #include "asylo/util/cleanup.h"
@@ -52,6 +55,7 @@
 #include "include/grpcpp/security/server_credentials.h"
 #include "include/grpcpp/server.h"
 #include "include/grpcpp/support/channel_arguments.h"
+#include "opencensus/trace/span.h"
 
 namespace asylo {
 namespace primitives {
@@ -91,6 +95,9 @@ class Communicator {
     Thread::Id invocation_thread_id;
     uint64_t selector;
     Status status;
+    // Trace context the invocation was sent under, as a W3C traceparent
+    // header. Empty if the invocation is not traced.
+    std::string trace_context;
   };
 
   // Wrapped smart pointer to CommunicationMessage that ensures access to the
@@ -203,6 +210,20 @@ class Communicator {
   // Returns port assigned when creating the server.
   int server_port() const;
 
+  // Sets the source of the enclave thread counters reported by the metrics
+  // service of the target Communicator. Has no effect on the host one.
+  void set_thread_stats_provider(
+      std::function<const EnclaveThreadStats *()> provider);
+
+  // Sets the source of the enclave memory statistics reported by the metrics
+  // service of the target Communicator. Has no effect on the host one.
+  void set_memory_stats_provider(
+      std::function<StatusOr<EnclaveMemoryStats>()> provider);
+
+  // Returns the exit call metrics reported by the metrics service of the
+  // target Communicator, or nullptr on the host one.
+  std::shared_ptr<ExitMetrics> exit_metrics() const { return exit_metrics_; }
+
   // Accessor to the last time received from the host (valid only
   // on target Communicator, has no use on the host one).
   absl::optional<int64_t> last_host_time_nanos() const {
@@ -215,7 +236,8 @@ class Communicator {
   class ServiceImpl;
   // A queue of each worker thread that handles messages dispatched to it with
   // QueueMessageForThread. A new queue is added whenever the first Invoke call
-  // takes place on a specific host thread.
+  // takes place on a specific host thread. On target the queue is served by a
+  // thread taken from a pool of workers.
   class ThreadActivityWorkQueue;
 
   // Sends |message| (request or response) to the counterpart Communicator.
@@ -227,7 +249,7 @@ class Communicator {
 
   // Locates or creates ThreadActivityWorkQueue for the given host thread id
   // (both on host and target side).
-  ASYLO_MUST_USE_RESULT StatusOr<ThreadActivityWorkQueue *>
+  ASYLO_MUST_USE_RESULT StatusOr<std::shared_ptr<ThreadActivityWorkQueue>>
   LocateOrCreateThreadActivityWorkQueue(Thread::Id invocation_thread_id);
 
   // Runs a loop getting wrapped messages and processing requests on the current
@@ -260,6 +282,9 @@ class Communicator {
   // Host/target flag.
   const bool is_host_;
 
+  // Exit call metrics served by the target Communicator, null on the host.
+  const std::shared_ptr<ExitMetrics> exit_metrics_;
+
   // gRPC client and service.
   std::unique_ptr<ClientImpl> client_;
   std::unique_ptr<ServiceImpl> service_;
@@ -281,12 +306,17 @@ class Communicator {
   static thread_local std::unique_ptr<Cleanup> thread_exiter_;
 
   // Pointer to the ThreadActivityWorkQueue for the current thread, cached here
-  // in order to reduce contention on threads_map_. It is captured for target
+  // in order to reduce contention on the threads map. It is captured for target
   // threads at the time a worker thread begins executing, and for host threads
   // the first time Invoke is called by that thread. The cached value never
   // changes until the thread terminates or all communicators destruct.
   ABSL_CONST_INIT static thread_local ThreadActivityWorkQueue
       *current_thread_context_;
+
+  // Trace span of the handler running on the current thread, if any. Spans of
+  // the Invoke calls the handler makes are started as its children.
+  ABSL_CONST_INIT static thread_local const ::opencensus::trace::Span
+      *current_span_;
 };
 
 }  // namespace primitives
@@ -30,6 +30,7 @@
 #include <iterator>
 #include <memory>
 #include <set>
+#include <string>
 #include <thread>
 #include <utility>
 #include <vector>
@@ -38,6 +39,8 @@
 #include <gtest/gtest.h>
 #include "absl/base/macros.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
 #include "absl/strings/str_cat.h"
 #include "absl/synchronization/blocking_counter.h"
@@ -46,6 +49,9 @@
 #include "asylo/util/logging.h"
 #include "asylo/platform/primitives/extent.h"
 #include "asylo/platform/primitives/primitive_status.h"
+#include "asylo/platform/primitives/remote/metrics/proc_system.grpc.pb.h"
+#include "asylo/platform/primitives/remote/metrics/proc_system.pb.h"
+#include "asylo/platform/primitives/util/exit_metrics.h"
 #include "asylo/test/util/status_matchers.h"
 #include "asylo/util/cleanup.h"
 #include "asylo/util/mutex_guarded.h"
@@ -54,18 +60,26 @@
 #include "asylo/util/status.h"
 #include "asylo/util/status_macros.h"
 #include "asylo/util/thread.h"
+#include "include/grpcpp/client_context.h"
+#include "include/grpcpp/create_channel.h"
 #include "include/grpcpp/security/credentials.h"
 #include "include/grpcpp/security/server_credentials.h"
 #include "include/grpcpp/support/channel_arguments.h"
 #include "opencensus/stats/stats.h"
 #include "opencensus/tags/tag_key.h"
 
+ABSL_DECLARE_FLAG(bool, communicator_streaming);
+ABSL_DECLARE_FLAG(int32_t, communicator_max_idle_workers);
+
 using ::opencensus::stats::ViewData;
 using ::opencensus::stats::ViewDescriptor;
 using ::testing::Eq;
 using ::testing::Field;
+using ::testing::Gt;
 using ::testing::InSequence;
 using ::testing::IsEmpty;
+using ::testing::IsNull;
+using ::testing::Le;
 using ::testing::Lt;
 using ::testing::MockFunction;
 using ::testing::Not;
@@ -130,6 +144,11 @@ class CommunicatorTestFixture : public ::testing::Test {
     CHECK_EQ(res, 0) << strerror(errno);
   }
 
+  // Target end point and the credentials to reach it. Set on the host side
+  // before RunAction is called.
+  std::string end_point_;
+  std::shared_ptr<::grpc::ChannelCredentials> channel_creds_;
+
  private:
   // Sets up host-side handler expectations, defaults to not being called
   // unless overridden.
@@ -199,6 +218,8 @@ class CommunicatorTestFixture : public ::testing::Test {
 
       // Establish connection to the target server.
       ASYLO_ASSERT_OK(communicator->Connect(*proxy_config, end_point));
+      end_point_ = end_point;
+      channel_creds_ = proxy_config->channel_creds();
     } else {
       // For target: receive host server port.
       int host_server_port = 0;
@@ -674,6 +695,111 @@ class DuplexNestedMultithreadedInvokesTest : public CommunicatorTestFixture {
   }
 };
 
+// Same as DuplexNestedMultithreadedInvokesTest, with both Communicator clients
+// sending their messages over a CommunicateStream call.
+class StreamingDuplexNestedMultithreadedInvokesTest
+    : public DuplexNestedMultithreadedInvokesTest {
+ public:
+  StreamingDuplexNestedMultithreadedInvokesTest() = default;
+
+ protected:
+  void SetUp() override { absl::SetFlag(&FLAGS_communicator_streaming, true); }
+
+  void TearDown() override {
+    absl::SetFlag(&FLAGS_communicator_streaming, false);
+  }
+};
+
+class PooledWorkersInvokesTest : public CommunicatorTestFixture {
+ public:
+  PooledWorkersInvokesTest()
+      : thread_set_((absl::flat_hash_set<std::thread::id>())) {}
+
+ protected:
+  void SetUp() override {
+    absl::SetFlag(&FLAGS_communicator_max_idle_workers, kThreads);
+  }
+
+  void TearDown() override {
+    absl::SetFlag(&FLAGS_communicator_max_idle_workers, 0);
+  }
+
+ private:
+  const uint64_t kDataSelector = 1234;
+  const uint64_t kCountSelector = 4321;
+  const int64_t kThreads = 8;
+  const int64_t kRounds = 16;
+  const int64_t kTotalMessages = 16;
+
+  void SetTargetHandler(ServerHandlerMock *handler,
+                        Communicator *communicator) override {
+    EXPECT_CALL(*handler,
+                Call(Pointee(Field(&Communicator::Invocation::selector,
+                                   Eq(kDataSelector)))))
+        .Times(kRounds * kThreads * kTotalMessages)
+        .WillRepeatedly(
+            [this](std::unique_ptr<Communicator::Invocation> invocation) {
+              thread_set_.Lock()->insert(std::this_thread::get_id());
+              // Make output identical to input.
+              ASSERT_THAT(invocation->reader, SizeIs(1));
+              invocation->writer.Push(invocation->reader.next<int64_t>());
+            })
+        .RetiresOnSaturation();
+    EXPECT_CALL(*handler,
+                Call(Pointee(Field(&Communicator::Invocation::selector,
+                                   Eq(kCountSelector)))))
+        .WillOnce([this](std::unique_ptr<Communicator::Invocation> invocation) {
+          // Return the number of distinct worker threads seen.
+          ASSERT_THAT(invocation->reader, IsEmpty());
+          invocation->writer.Push<int64_t>(thread_set_.ReaderLock()->size());
+        });
+  }
+
+  void RunAction(Communicator *communicator) override {
+    // Run rounds of short-lived host threads; with a pool of idle workers,
+    // the target side reuses worker threads across rounds instead of
+    // starting one for every host thread.
+    for (int64_t round = 0; round < kRounds; ++round) {
+      std::vector<Thread> threads;
+      for (int64_t thread_index = 0; thread_index < kThreads; ++thread_index) {
+        threads.emplace_back([this, communicator] {
+          const auto current_thread_id = Thread::this_thread_id();
+          for (int64_t i = 0; i < kTotalMessages; ++i) {
+            communicator->Invoke(
+                kDataSelector,
+                [i](Communicator::Invocation *invocation) {
+                  invocation->writer.Push(i);
+                },
+                [i, current_thread_id](
+                    std::unique_ptr<Communicator::Invocation> invocation) {
+                  ASYLO_ASSERT_OK(invocation->status);
+                  ASSERT_THAT(invocation->invocation_thread_id,
+                              Eq(current_thread_id));
+                  ASSERT_THAT(invocation->reader, SizeIs(1));
+                  EXPECT_THAT(invocation->reader.next<int64_t>(), Eq(i));
+                });
+          }
+        });
+      }
+      for (auto &thread : threads) {
+        thread.Join();
+      }
+    }
+
+    communicator->Invoke(
+        kCountSelector, [](Communicator::Invocation *invocation) {},
+        [this](std::unique_ptr<Communicator::Invocation> invocation) {
+          ASYLO_ASSERT_OK(invocation->status);
+          ASSERT_THAT(invocation->reader, SizeIs(1));
+          const int64_t worker_count = invocation->reader.next<int64_t>();
+          EXPECT_THAT(worker_count, Gt(0));
+          EXPECT_THAT(worker_count, Le(kRounds * kThreads));
+        });
+  }
+
+  MutexGuarded<absl::flat_hash_set<std::thread::id>> thread_set_;
+};
+
 class UnknownSelectorTest : public CommunicatorTestFixture {
  public:
   UnknownSelectorTest() = default;
@@ -760,6 +886,58 @@ class OpenCensusClientTest : public CommunicatorTestFixture {
   }
 };
 
+class ExitCallStatsTest : public CommunicatorTestFixture {
+ public:
+  ExitCallStatsTest() = default;
+
+ private:
+  const uint64_t kSelector = 1234;
+  const uint64_t kExitSelector = 88;
+
+  // Records an exit call in the metrics of the target Communicator.
+  void SetTargetHandler(ServerHandlerMock *handler,
+                        Communicator *communicator) override {
+    EXPECT_CALL(*handler, Call(NotNull()))
+        .WillOnce([this, communicator](
+                      std::unique_ptr<Communicator::Invocation> invocation) {
+          ASYLO_ASSERT_OK(invocation->status);
+          ASSERT_THAT(communicator->exit_metrics(), NotNull());
+          communicator->exit_metrics()->Record(
+              kExitSelector, ExitMetrics::kNoSystemCall,
+              absl::Microseconds(3), /*input_bytes=*/100,
+              /*output_bytes=*/200, /*ok=*/true);
+        });
+  }
+
+  // Tests that the metrics service of the target reports the exit calls
+  // recorded in the metrics of its Communicator.
+  void RunAction(Communicator *communicator) override {
+    EXPECT_THAT(communicator->exit_metrics(), IsNull());
+    communicator->Invoke(
+        kSelector, [](Communicator::Invocation *invocation) {},
+        [](std::unique_ptr<Communicator::Invocation> invocation) {
+          ASYLO_ASSERT_OK(invocation->status);
+        });
+
+    auto stub = ProcSystemService::NewStub(::grpc::CreateCustomChannel(
+        end_point_, channel_creds_, ::grpc::ChannelArguments()));
+    ::grpc::ClientContext context;
+    ExitCallStatsRequest request;
+    ExitCallStatsResponse response;
+    ::grpc::Status status =
+        stub->GetExitCallStats(&context, request, &response);
+    ASSERT_TRUE(status.ok()) << status.error_message();
+    ASSERT_THAT(response.exit_call_stats(), SizeIs(1));
+    const ExitCallStats &stats = response.exit_call_stats(0);
+    EXPECT_THAT(stats.selector(), Eq(kExitSelector));
+    EXPECT_THAT(stats.sysno(), Eq(ExitMetrics::kNoSystemCall));
+    EXPECT_THAT(stats.count(), Eq(1));
+    EXPECT_THAT(stats.error_count(), Eq(0));
+    EXPECT_THAT(stats.input_bytes(), Eq(100));
+    EXPECT_THAT(stats.output_bytes(), Eq(200));
+  }
+};
+
 void RegisterAllTests() {
   // Prepare all the tests (before forking the process - so that both host and
   // target processes see them), do not store pointers - they are handed over
@@ -770,8 +948,12 @@ void RegisterAllTests() {
   CommunicatorTestFixture::Register<MultithreadedInvokesAndCheckBackTest>();
   CommunicatorTestFixture::Register<MultithreadedWithThreadLocalStorageTest>();
   CommunicatorTestFixture::Register<DuplexNestedMultithreadedInvokesTest>();
+  CommunicatorTestFixture::Register<
+      StreamingDuplexNestedMultithreadedInvokesTest>();
+  CommunicatorTestFixture::Register<PooledWorkersInvokesTest>();
   CommunicatorTestFixture::Register<UnknownSelectorTest>();
   CommunicatorTestFixture::Register<OpenCensusClientTest>();
+  CommunicatorTestFixture::Register<ExitCallStatsTest>();
 }
 
 }  // namespace test
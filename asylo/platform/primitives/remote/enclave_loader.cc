@@ -18,12 +18,15 @@
 
 #include "asylo/platform/primitives/enclave_loader.h"
 
+#include <memory>
+
 #include "absl/memory/memory.h"
 #include "asylo/enclave.pb.h"
 #include "asylo/platform/primitives/remote/proxy_client.h"
 #include "asylo/platform/primitives/untrusted_primitives.h"
 #include "asylo/platform/primitives/util/dispatch_table.h"
 #include "asylo/platform/primitives/util/exit_log.h"
+#include "asylo/platform/primitives/util/exit_metrics.h"
 #include "asylo/util/remote/remote_loader.pb.h"
 #include "asylo/util/remote/remote_proxy_config.h"
 #include "asylo/util/status.h"
@@ -47,7 +50,10 @@ StatusOr<std::shared_ptr<Client>> LoadEnclave(
                          primitives::RemoteEnclaveProxyClient::Create(
                              enclave_name, std::move(client_config),
                              absl::make_unique<LoggingDispatchTable>(
-                                 /*enable_logging=*/load_config.exit_logging()),
+                                 /*enable_logging=*/load_config.exit_logging(),
+                                 /*metrics=*/load_config.exit_metrics()
+                                     ? std::make_shared<ExitMetrics>()
+                                     : nullptr),
                              remote_config.loader_case()));
   ASYLO_RETURN_IF_ERROR(primitive_client->Connect(load_config));
   return std::move(primitive_client);
@@ -22,9 +22,13 @@
 #include <iterator>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "absl/flags/flag.h"
+#include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
 #include "asylo/util/logging.h"
 #include "asylo/platform/primitives/extent.h"
 #include "asylo/platform/primitives/remote/communicator.h"
@@ -32,6 +36,8 @@
 #include "asylo/platform/primitives/remote/grpc_service.pb.h"
 #include "asylo/platform/primitives/remote/metrics/clients/opencensus_client.h"
 #include "asylo/platform/primitives/util/message.h"
+#include "asylo/platform/primitives/util/status_conversions.h"
+#include "asylo/util/mutex_guarded.h"
 #include "asylo/util/posix_error_space.h"
 #include "asylo/util/remote/remote_proxy_config.h"
 #include "asylo/util/status.h"
@@ -42,8 +48,13 @@
 #include "include/grpcpp/support/status.h"
 #include "include/grpcpp/create_channel.h"
 #include "include/grpcpp/security/credentials.h"
+#include "include/grpcpp/impl/codegen/sync_stream.h"
 #include "include/grpcpp/support/channel_arguments.h"
 
+ABSL_FLAG(bool, communicator_streaming, false,
+          "Send the messages of a Communicator client over a single "
+          "CommunicateStream call instead of a Communicate call per message");
+
 namespace asylo {
 namespace primitives {
 
@@ -55,14 +66,13 @@ void SerializeIntoRequest(CommunicationMessage *request,
       request->mutable_status());
   request->set_invocation_thread_id(invocation->invocation_thread_id);
   request->set_selector(invocation->selector);
-  // Parameters are OK, serialize them into request.
-  invocation->writer.Serialize([request](Extent extent) {
-    auto item = request->add_items();
-    if (!extent.empty()) {
-      item->assign(reinterpret_cast<const char *>(extent.data()),
-                   extent.size());
-    }
-  });
+  if (!invocation->trace_context.empty()) {
+    request->set_trace_context(invocation->trace_context);
+  }
+  // Parameters are OK, serialize them into request as a single buffer.
+  std::string *payload = request->mutable_payload();
+  payload->resize(invocation->writer.MessageSize());
+  invocation->writer.Serialize(&(*payload)[0]);
 }
 
 void DeserializeFromReply(const CommunicationMessage &reply,
@@ -72,7 +82,12 @@ void DeserializeFromReply(const CommunicationMessage &reply,
     return;
   }
 
-  // Derialize results from response.
+  // Deserialize results from response.
+  if (reply.has_payload()) {
+    invocation->status = MakeStatus(invocation->reader.Deserialize(
+        reply.payload().data(), reply.payload().size()));
+    return;
+  }
   invocation->reader.Deserialize(reply.items_size(), [&reply](size_t i) {
     const auto &item = reply.items(i);
     return Extent{item.data(), item.size()};
@@ -81,6 +96,174 @@ void DeserializeFromReply(const CommunicationMessage &reply,
 
 }  // namespace
 
+// Pipelines the messages sent by a ClientImpl over a CommunicateStream call.
+// Senders queue their messages and return immediately, as long as the server
+// has granted enough credit. A writer thread batches queued messages into
+// frames, while a reader thread collects credit returned by the server.
+class Communicator::ClientImpl::Stream {
+ public:
+  // Opens a stream on |channel| and waits for the initial credit. Returns an
+  // error if the server does not grant any, for instance because it does not
+  // implement CommunicatorStreamService.
+  static StatusOr<std::unique_ptr<Stream>> Open(
+      const std::shared_ptr<::grpc::Channel> &channel,
+      Communicator *communicator);
+
+  // Writes the remaining queued messages and closes the stream.
+  ~Stream();
+
+  Stream(const Stream &other) = delete;
+  Stream &operator=(const Stream &other) = delete;
+
+  // Queues |message| for writing, waiting for credit if the client already
+  // has as many messages in flight as the server allows. Returns an error if
+  // the stream is closed.
+  Status Send(const CommunicationMessage &message);
+
+  // Waits until all queued messages have been written.
+  void Flush();
+
+ private:
+  struct State {
+    // Messages queued for the next frame.
+    std::vector<CommunicationMessage> pending;
+
+    // Number of messages the client may still send.
+    int64_t credit = 0;
+
+    // Set while the writer thread is writing a frame.
+    bool is_writing = false;
+
+    // Set once the stream no longer accepts messages, with the reason.
+    bool is_closed = false;
+    Status close_status;
+  };
+
+  explicit Stream(Communicator *communicator)
+      : state_(State()), communicator_(communicator) {}
+
+  void WriterLoop();
+  void ReaderLoop();
+
+  // Stops accepting messages, reporting |status| to later senders.
+  void Close(const Status &status);
+
+  std::unique_ptr<CommunicatorStreamService::Stub> stub_;
+  ::grpc::ClientContext context_;
+  std::unique_ptr<
+      ::grpc::ClientReaderWriter<CommunicationFrame, CommunicationCredit>>
+      stream_;
+  MutexGuarded<State> state_;
+  Communicator *const communicator_;
+  std::unique_ptr<Thread> writer_thread_;
+  std::unique_ptr<Thread> reader_thread_;
+};
+
+StatusOr<std::unique_ptr<Communicator::ClientImpl::Stream>>
+Communicator::ClientImpl::Stream::Open(
+    const std::shared_ptr<::grpc::Channel> &channel,
+    Communicator *communicator) {
+  std::unique_ptr<Stream> stream(new Stream(communicator));
+  stream->stub_ = CommunicatorStreamService::NewStub(channel);
+  stream->stream_ = stream->stub_->CommunicateStream(&stream->context_);
+  CommunicationCredit credit;
+  if (!stream->stream_->Read(&credit)) {
+    return Status(stream->stream_->Finish());
+  }
+  stream->state_.Lock()->credit = credit.messages();
+  Stream *const raw_stream = stream.get();
+  stream->writer_thread_ =
+      absl::make_unique<Thread>([raw_stream] { raw_stream->WriterLoop(); });
+  stream->reader_thread_ =
+      absl::make_unique<Thread>([raw_stream] { raw_stream->ReaderLoop(); });
+  return std::move(stream);
+}
+
+Communicator::ClientImpl::Stream::~Stream() {
+  if (!writer_thread_) {
+    // Open failed and has already finished the call.
+    return;
+  }
+  Close(Status{error::GoogleError::CANCELLED, "Disconnected"});
+  // The writer half-closes the stream once done, which lets the server finish
+  // the call and the reader exit.
+  writer_thread_->Join();
+  reader_thread_->Join();
+  const ::grpc::Status grpc_status = stream_->Finish();
+  LOG_IF(ERROR, !grpc_status.ok())
+      << "CommunicateStream error=" << Status(grpc_status);
+}
+
+Status Communicator::ClientImpl::Stream::Send(
+    const CommunicationMessage &message) {
+  auto locked_state = state_.LockWhen([](const State &state) {
+    return state.is_closed || state.credit > 0;
+  });
+  if (locked_state->is_closed) {
+    return locked_state->close_status;
+  }
+  --locked_state->credit;
+  locked_state->pending.push_back(message);
+  return Status::OkStatus();
+}
+
+void Communicator::ClientImpl::Stream::Flush() {
+  state_.ReaderLockWhen([](const State &state) {
+    return state.is_closed || (state.pending.empty() && !state.is_writing);
+  });
+}
+
+void Communicator::ClientImpl::Stream::Close(const Status &status) {
+  auto locked_state = state_.Lock();
+  if (!locked_state->is_closed) {
+    locked_state->is_closed = true;
+    locked_state->close_status = status;
+  }
+}
+
+void Communicator::ClientImpl::Stream::WriterLoop() {
+  for (;;) {
+    CommunicationFrame frame;
+    {
+      auto locked_state = state_.LockWhen([](const State &state) {
+        return state.is_closed || !state.pending.empty();
+      });
+      if (locked_state->pending.empty()) {
+        break;
+      }
+      for (CommunicationMessage &message : locked_state->pending) {
+        frame.add_messages()->Swap(&message);
+      }
+      locked_state->pending.clear();
+      locked_state->is_writing = true;
+    }
+    if (communicator_->is_host()) {
+      frame.set_host_time_nanos(absl::GetCurrentTimeNanos());
+    }
+    const bool written = stream_->Write(frame);
+    state_.Lock()->is_writing = false;
+    if (!written) {
+      Close(Status{error::GoogleError::INTERNAL,
+                   "Failed to write to CommunicateStream"});
+      break;
+    }
+  }
+  stream_->WritesDone();
+}
+
+void Communicator::ClientImpl::Stream::ReaderLoop() {
+  CommunicationCredit credit;
+  while (stream_->Read(&credit)) {
+    // If host responded with time stamp, process it.
+    if (!communicator_->is_host() && credit.has_host_time_nanos()) {
+      communicator_->set_host_time_nanos(credit.host_time_nanos());
+    }
+    state_.Lock()->credit += credit.messages();
+  }
+  Close(Status{error::GoogleError::CANCELLED,
+               "CommunicateStream closed by the server"});
+}
+
 Status Communicator::ClientImpl::RunInvocation(
     Communicator::Invocation *invocation) {
   if (!communicator_->is_client_ready_.load()) {
@@ -137,6 +320,15 @@ Communicator::ClientImpl::Create(const RemoteProxyConfig &config,
   }
   client->grpc_stub_ =
       CommunicatorService::NewStub(client->grpc_channel_);
+  if (absl::GetFlag(FLAGS_communicator_streaming)) {
+    auto stream_result = Stream::Open(client->grpc_channel_, communicator);
+    if (stream_result.ok()) {
+      client->stream_ = std::move(stream_result).ValueOrDie();
+    } else {
+      LOG(WARNING) << "Falling back to Communicate calls, status="
+                   << stream_result.status();
+    }
+  }
 
   if (communicator->is_host()) {
     const RemoteProxyClientConfig &client_config =
@@ -155,6 +347,9 @@ Communicator::ClientImpl::Create(const RemoteProxyConfig &config,
 Status Communicator::ClientImpl::SendCommunication(
     const CommunicationMessage &message) {
   ASYLO_RETURN_IF_ERROR(IsMessageValid(message));
+  if (stream_) {
+    return stream_->Send(message);
+  }
   CommunicationConfirmation confirmation;
   if (communicator_->is_host()) {
     confirmation.set_host_time_nanos(absl::GetCurrentTimeNanos());
@@ -178,6 +373,10 @@ Status Communicator::ClientImpl::SendCommunication(
 }
 
 void Communicator::ClientImpl::SendDisconnect() {
+  // Do not let the disconnect request overtake messages still being written.
+  if (stream_) {
+    stream_->Flush();
+  }
   DisconnectRequest request;
   DisconnectReply reply;
   ::grpc::ClientContext context;
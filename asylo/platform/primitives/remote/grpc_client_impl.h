@@ -75,6 +75,9 @@ class Communicator::ClientImpl {
   Status RunInvocation(Communicator::Invocation *invocation);
 
  private:
+  // Long-lived CommunicateStream call carrying the messages of the client.
+  class Stream;
+
   // Constructor, used by factory method only.
   explicit ClientImpl(Communicator *communicator);
 
@@ -86,6 +89,10 @@ class Communicator::ClientImpl {
   std::shared_ptr<::grpc::Channel> grpc_channel_;
   std::unique_ptr<CommunicatorService::Stub> grpc_stub_;
 
+  // Stream used instead of Communicate RPCs if --communicator_streaming is
+  // set and the server supports it, nullptr otherwise.
+  std::unique_ptr<Stream> stream_;
+
   // SequenceNumber generation.
   std::atomic<uint64_t> sequence_number_;
 
@@ -22,8 +22,10 @@
 #include <cstdint>
 #include <ctime>
 #include <iterator>
+#include <memory>
 #include <string>
 
+#include "absl/container/flat_hash_set.h"
 #include "absl/flags/flag.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
@@ -34,6 +36,8 @@
 #include "asylo/platform/primitives/remote/grpc_service.grpc.pb.h"
 #include "asylo/platform/primitives/remote/grpc_service.pb.h"
 #include "asylo/platform/primitives/remote/metrics/proc_system_service.h"
+#include "asylo/platform/primitives/util/status_conversions.h"
+#include "asylo/util/mutex_guarded.h"
 #include "asylo/util/posix_error_space.h"
 #include "asylo/util/status.h"
 #include "asylo/util/status_macros.h"
@@ -46,21 +50,61 @@
 #include "include/grpcpp/create_channel.h"
 #include "include/grpcpp/impl/codegen/async_unary_call.h"
 #include "include/grpcpp/impl/codegen/server_context.h"
+#include "include/grpcpp/impl/codegen/sync_stream.h"
 #include "include/grpcpp/security/server_credentials.h"
 #include "include/grpcpp/server.h"
 #include "include/grpcpp/server_builder.h"
 #include "include/grpcpp/server_impl.h"
+#include "opencensus/trace/propagation/trace_context.h"
+#include "opencensus/trace/span.h"
 
 ABSL_FLAG(
     int64_t, host_time_expiration_ms, 500,
     "For target side only: number of milliseconds the timestamp is to be used "
     "after it has been received from the host communicator");
 
+ABSL_FLAG(int32_t, communicator_stream_window, 64,
+          "Number of messages a Communicator client may have in flight on a "
+          "CommunicateStream call before waiting for them to be processed");
+
+ABSL_FLAG(int64_t, proc_stat_sampling_interval_ms, 0,
+          "For target side only: if positive, number of milliseconds between "
+          "background samples of /proc/[pid]/stat served by the metrics "
+          "service; otherwise the file is read on every request");
+
+ABSL_FLAG(int32_t, proc_stat_history_size, 60,
+          "For target side only: number of /proc/[pid]/stat samples kept by "
+          "the metrics service when sampling in the background");
+
 namespace asylo {
 namespace primitives {
 
 namespace {
 
+// Starts a span named |name| as a child of the span a request was sent under,
+// given its |trace_context|. Returns a blank span if the request is not traced.
+::opencensus::trace::Span StartRemoteChildSpan(absl::string_view name,
+                                               absl::string_view trace_context,
+                                               uint64_t selector) {
+  if (trace_context.empty()) {
+    return ::opencensus::trace::Span::BlankSpan();
+  }
+  ::opencensus::trace::Span span =
+      ::opencensus::trace::Span::StartSpanWithRemoteParent(
+          name,
+          ::opencensus::trace::propagation::FromTraceParentHeader(
+              trace_context));
+  span.AddAttribute("selector", static_cast<int64_t>(selector));
+  return span;
+}
+
+// Starts the span covering the time |message| waits to be picked up by its
+// thread.
+::opencensus::trace::Span StartQueueSpan(const CommunicationMessage &message) {
+  return StartRemoteChildSpan("asylo/remote/Queue", message.trace_context(),
+                              message.selector());
+}
+
 class ServerInvocation : public Communicator::Invocation {
  public:
   ServerInvocation(
@@ -89,6 +133,12 @@ class ServerInvocation : public Communicator::Invocation {
     request_sequence_number_ = request.request_sequence_number();
     selector = request.selector();
     invocation_thread_id = request.invocation_thread_id();
+    trace_context = request.trace_context();
+    if (request.has_payload()) {
+      status = MakeStatus(reader.Deserialize(request.payload().data(),
+                                             request.payload().size()));
+      return;
+    }
     reader.Deserialize(request.items_size(), [&request](size_t i) {
       auto const &item = request.items(i);
       return Extent{item.data(), item.size()};
@@ -103,13 +153,9 @@ class ServerInvocation : public Communicator::Invocation {
     if (!status.ok()) {
       status.SaveTo(response->mutable_status());
     } else {
-      writer.Serialize([response](Extent extent) {
-        auto item = response->add_items();
-        if (!extent.empty()) {
-          item->assign(reinterpret_cast<const char *>(extent.data()),
-                       extent.size());
-        }
-      });
+      std::string *payload = response->mutable_payload();
+      payload->resize(writer.MessageSize());
+      writer.Serialize(&(*payload)[0]);
     }
   }
 
@@ -138,7 +184,15 @@ void Communicator::ServiceImpl::StartInvocation(
                                 "Invocation handler not set"};
     return;
   }
+  ::opencensus::trace::Span span = StartRemoteChildSpan(
+      "asylo/remote/Handle", invocation->trace_context, invocation->selector);
+  const ::opencensus::trace::Span *const prior_span = current_span_;
+  if (span.context().IsValid()) {
+    current_span_ = &span;
+  }
   handler_(std::move(invocation));
+  current_span_ = prior_span;
+  span.End();
 }
 
 // Server-side instance base that asynchronously processes one RPC call through
@@ -235,8 +289,12 @@ class Communicator::ServiceImpl::CommunicationRpcInstance
       service()->communicator_->set_host_time_nanos(message_.host_time_nanos());
     }
 
+    ::opencensus::trace::Span queue_span = StartQueueSpan(message_);
     service()->communicator_->QueueMessageForThread(CommunicationMessagePtr(
-        &message_, WrappedMessageDeleter([this] { Complete(); })));
+        &message_, WrappedMessageDeleter([this, queue_span]() mutable {
+          queue_span.End();
+          Complete();
+        })));
   }
 
   // What we get from the client.
@@ -396,6 +454,126 @@ class Communicator::ServiceImpl::EndPointAddressRpcInstance
   ::grpc::ServerAsyncResponseWriter<EndPointAddressReply> responder_;
 };
 
+class Communicator::ServiceImpl::StreamServiceImpl
+    : public CommunicatorStreamService::Service {
+ public:
+  explicit StreamServiceImpl(Communicator::ServiceImpl *service)
+      : service_(CHECK_NOTNULL(service)), active_streams_(ActiveStreams()) {}
+
+  ::grpc::Status CommunicateStream(
+      ::grpc::ServerContext *context,
+      ::grpc::ServerReaderWriter<CommunicationCredit, CommunicationFrame>
+          *stream) override;
+
+  // Cancels the CommunicateStream calls in progress and rejects new ones, so
+  // that the server can shut down without waiting for the clients to close
+  // their streams.
+  void CancelStreams();
+
+ private:
+  // Writing side of a CommunicateStream call. Shared with the messages
+  // received over the call, which return credit once they are discarded, even
+  // if the call has finished by then.
+  class CreditWriter {
+   public:
+    CreditWriter(
+        ::grpc::ServerReaderWriter<CommunicationCredit, CommunicationFrame>
+            *stream,
+        bool is_host)
+        : stream_(stream), is_host_(is_host) {}
+
+    // Grants the client credit for |messages| more messages, unless the call
+    // has finished.
+    void Grant(uint32_t messages) {
+      auto locked_stream = stream_.Lock();
+      if (!*locked_stream) {
+        return;
+      }
+      CommunicationCredit credit;
+      credit.set_messages(messages);
+      // If host responds to the target, add time stamp.
+      if (is_host_) {
+        credit.set_host_time_nanos(absl::GetCurrentTimeNanos());
+      }
+      if (!(*locked_stream)->Write(credit)) {
+        *locked_stream = nullptr;
+      }
+    }
+
+    // Stops writing to the call, which is about to finish.
+    void Close() { *stream_.Lock() = nullptr; }
+
+   private:
+    MutexGuarded<
+        ::grpc::ServerReaderWriter<CommunicationCredit, CommunicationFrame> *>
+        stream_;
+    const bool is_host_;
+  };
+
+  struct ActiveStreams {
+    absl::flat_hash_set<::grpc::ServerContext *> contexts;
+    bool is_shutting_down = false;
+  };
+
+  Communicator::ServiceImpl *const service_;
+  MutexGuarded<ActiveStreams> active_streams_;
+};
+
+::grpc::Status Communicator::ServiceImpl::StreamServiceImpl::CommunicateStream(
+    ::grpc::ServerContext *context,
+    ::grpc::ServerReaderWriter<CommunicationCredit, CommunicationFrame>
+        *stream) {
+  {
+    auto locked_active_streams = active_streams_.Lock();
+    if (locked_active_streams->is_shutting_down) {
+      return ::grpc::Status(::grpc::StatusCode::CANCELLED, "Disconnected");
+    }
+    locked_active_streams->contexts.insert(context);
+  }
+  Communicator *const communicator = service_->communicator_;
+  auto credit_writer =
+      std::make_shared<CreditWriter>(stream, communicator->is_host());
+  credit_writer->Grant(absl::GetFlag(FLAGS_communicator_stream_window));
+
+  CommunicationFrame frame;
+  while (stream->Read(&frame)) {
+    // If received time stamp from host with the frame, store it.
+    if (!communicator->is_host() && frame.has_host_time_nanos()) {
+      communicator->set_host_time_nanos(frame.host_time_nanos());
+    }
+    for (CommunicationMessage &frame_message : *frame.mutable_messages()) {
+      auto message = absl::make_unique<CommunicationMessage>();
+      message->Swap(&frame_message);
+      ::opencensus::trace::Span queue_span = StartQueueSpan(*message);
+      CommunicationMessage *const raw_message = message.release();
+      communicator->QueueMessageForThread(CommunicationMessagePtr(
+          raw_message,
+          WrappedMessageDeleter([raw_message, credit_writer,
+                                 queue_span]() mutable {
+            queue_span.End();
+            delete raw_message;
+            credit_writer->Grant(1);
+          })));
+    }
+  }
+  credit_writer->Close();
+  active_streams_.Lock()->contexts.erase(context);
+  return ::grpc::Status::OK;
+}
+
+void Communicator::ServiceImpl::StreamServiceImpl::CancelStreams() {
+  auto locked_active_streams = active_streams_.Lock();
+  locked_active_streams->is_shutting_down = true;
+  for (::grpc::ServerContext *context : locked_active_streams->contexts) {
+    context->TryCancel();
+  }
+}
+
+Communicator::ServiceImpl::ServiceImpl(Communicator *communicator)
+    : end_point_address_callback_(absl::optional<address_callback>()),
+      communicator_(CHECK_NOTNULL(communicator)),
+      address_state_(absl::optional<std::string>()) {}
+
 StatusOr<std::unique_ptr<Communicator::ServiceImpl>>
 Communicator::ServiceImpl::Create(
     int requested_port, const std::shared_ptr<::grpc::ServerCredentials> &creds,
@@ -403,9 +581,19 @@ Communicator::ServiceImpl::Create(
   std::unique_ptr<ServiceImpl> service(new ServiceImpl(communicator));
   ::grpc::ServerBuilder builder;
   builder.RegisterService(service.get());
+  service->stream_service_ =
+      absl::make_unique<StreamServiceImpl>(service.get());
+  builder.RegisterService(service->stream_service_.get());
   if (!communicator->is_host()) {
-    service->proc_system_service_ =
-        absl::make_unique<ProcSystemServiceImpl>(getpid());
+    service->proc_system_service_ = absl::make_unique<ProcSystemServiceImpl>(
+        getpid(), communicator->exit_metrics());
+    const int64_t sampling_interval_ms =
+        absl::GetFlag(FLAGS_proc_stat_sampling_interval_ms);
+    if (sampling_interval_ms > 0) {
+      service->proc_system_service_->StartSampling(
+          absl::Milliseconds(sampling_interval_ms),
+          absl::GetFlag(FLAGS_proc_stat_history_size));
+    }
     builder.RegisterService(service->proc_system_service_.get());
   }
   builder.AddListeningPort(absl::StrCat("[::]:", requested_port), creds,
@@ -497,6 +685,9 @@ std::string Communicator::ServiceImpl::WaitForEndPointAddress() {
 }
 
 void Communicator::ServiceImpl::WaitForDisconnect() {
+  if (stream_service_) {
+    stream_service_->CancelStreams();
+  }
   if (server_) {
     server_->Shutdown();
   }
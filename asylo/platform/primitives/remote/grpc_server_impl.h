@@ -77,6 +77,24 @@ class Communicator::ServiceImpl
     handler_ = std::move(handler);
   }
 
+  // Sets the source of the enclave thread counters served by the metrics
+  // service, if there is one.
+  void set_thread_stats_provider(
+      ProcSystemServiceImpl::ThreadStatsProvider provider) {
+    if (proc_system_service_) {
+      proc_system_service_->SetThreadStatsProvider(std::move(provider));
+    }
+  }
+
+  // Sets the source of the enclave memory statistics served by the metrics
+  // service, if there is one.
+  void set_memory_stats_provider(
+      ProcSystemServiceImpl::MemoryStatsProvider provider) {
+    if (proc_system_service_) {
+      proc_system_service_->SetMemoryStatsProvider(std::move(provider));
+    }
+  }
+
   ServiceImpl(const ServiceImpl &other) = delete;
   ServiceImpl &operator=(const ServiceImpl &other) = delete;
 
@@ -90,11 +108,11 @@ class Communicator::ServiceImpl
   class DisposeOfThreadRpcInstance;
   class EndPointAddressRpcInstance;
 
+  // Synchronous service serving CommunicateStream calls on gRPC threads.
+  class StreamServiceImpl;
+
   // Constructor is called by Create() factory only.
-  explicit ServiceImpl(Communicator *communicator)
-      : end_point_address_callback_(absl::optional<address_callback>()),
-        communicator_(CHECK_NOTNULL(communicator)),
-        address_state_(absl::optional<std::string>()) {}
+  explicit ServiceImpl(Communicator *communicator);
 
   void RecordEndPointAddress(absl::string_view address);
 
@@ -108,6 +126,9 @@ class Communicator::ServiceImpl
   // ProcSystemService for serving enclave metrics.
   std::unique_ptr<ProcSystemServiceImpl> proc_system_service_;
 
+  // CommunicatorStreamService delivering messages to this service.
+  std::unique_ptr<StreamServiceImpl> stream_service_;
+
   // Actual port gRPC server above is listening to, once started.
   // Set only once by CreateServer() and never changes after that.
   int server_port_ = 0;
@@ -18,14 +18,24 @@
 
 #include "asylo/platform/primitives/remote/local_exit_calls.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
 #include "absl/types/optional.h"
 #include "asylo/platform/host_call/exit_handler_constants.h"
+#include "asylo/platform/host_call/untrusted/host_call_handlers.h"
 #include "asylo/platform/host_call/untrusted/host_call_handlers_util.h"
 #include "asylo/platform/primitives/remote/communicator.h"
 #include "asylo/platform/primitives/remote/proxy_server.h"
 #include "asylo/platform/primitives/untrusted_primitives.h"
 #include "asylo/platform/primitives/util/exit_log.h"
+#include "asylo/platform/primitives/util/exit_metrics.h"
 #include "asylo/platform/primitives/util/message.h"
 #include "asylo/platform/system_call/type_conversions/generated_types.h"
 #include "asylo/util/status.h"
@@ -36,17 +46,40 @@ namespace primitives {
 
 namespace {
 
+// Signature of the untrusted host call handlers.
+using HostCallHandler = Status (*)(const std::shared_ptr<Client> &client,
+                                   void *context, MessageReader *input,
+                                   MessageWriter *output);
+
+// Optional local exit calls other than kClockGettimeHandler, see
+// local_exit_calls.h.
+struct LocalHostCall {
+  uint64_t selector;
+  HostCallHandler handler;
+};
+constexpr LocalHostCall kLocalHostCalls[] = {
+    {host_call::kSysconfHandler, &host_call::SysconfHandler},
+    {host_call::kSleepHandler, &host_call::SleepHandler},
+    {host_call::kUSleepHandler, &host_call::USleepHandler},
+};
+
 class GetTimeExitCallHandler
     : public LocalExitCallForwarder::LocalExitCallHandler {
  public:
-  explicit GetTimeExitCallHandler(Communicator *communicator,
-                                  LocalExitCallForwarder *forwarder)
+  GetTimeExitCallHandler(Communicator *communicator, bool read_local_clock,
+                         LocalExitCallForwarder *forwarder)
       : LocalExitCallForwarder::LocalExitCallHandler(
             host_call::kClockGettimeHandler, forwarder),
-        communicator_(communicator) {}
+        communicator_(communicator),
+        read_local_clock_(read_local_clock) {}
 
   absl::optional<Status> AttemptExecute(MessageReader *input,
                                         MessageWriter *output) override {
+    if (read_local_clock_) {
+      return host_call::ClockGettimeHandler(/*client=*/nullptr,
+                                            /*context=*/nullptr, input, output);
+    }
+
     // Filter out the calls that need to be forwarded to the proxy client.
     if (input->size() != 1 ||
         input->peek<clockid_t>() != kLinux_CLOCK_REALTIME) {
@@ -73,6 +106,27 @@ class GetTimeExitCallHandler
 
  private:
   Communicator *const communicator_;
+  const bool read_local_clock_;
+};
+
+// Handles an exit call on the remote machine with its untrusted host call
+// handler.
+class HostCallExitCallHandler
+    : public LocalExitCallForwarder::LocalExitCallHandler {
+ public:
+  HostCallExitCallHandler(const LocalHostCall &host_call,
+                          LocalExitCallForwarder *forwarder)
+      : LocalExitCallForwarder::LocalExitCallHandler(host_call.selector,
+                                                     forwarder),
+        handler_(host_call.handler) {}
+
+  absl::optional<Status> AttemptExecute(MessageReader *input,
+                                        MessageWriter *output) override {
+    return handler_(/*client=*/nullptr, /*context=*/nullptr, input, output);
+  }
+
+ private:
+  const HostCallHandler handler_;
 };
 
 class SysFutexWaitExitCallHandler
@@ -113,8 +167,10 @@ Status LocalExitCallForwarder::PerformUnknownExit(uint64_t untrusted_selector,
 }
 
 LocalExitCallForwarder::LocalExitCallForwarder(
-    bool exit_logging, const RemoteEnclaveProxyServer *server)
-    : LoggingDispatchTable(exit_logging), server_(CHECK_NOTNULL(server)) {}
+    bool exit_logging, std::shared_ptr<ExitMetrics> metrics,
+    const RemoteEnclaveProxyServer *server)
+    : LoggingDispatchTable(exit_logging, std::move(metrics)),
+      server_(CHECK_NOTNULL(server)) {}
 
 Status LocalExitCallForwarder::Run(const std::shared_ptr<Client> &client,
                                    void *context, MessageReader *input,
@@ -134,15 +190,40 @@ Status LocalExitCallForwarder::Run(const std::shared_ptr<Client> &client,
 
 StatusOr<std::unique_ptr<Client::ExitCallProvider>>
 LocalExitCallForwarder::Create(bool exit_logging,
+                               std::shared_ptr<ExitMetrics> metrics,
+                               const std::vector<uint64_t> &local_exit_calls,
                                const RemoteEnclaveProxyServer *server) {
   // Create forwarder for all unregistered exit calls.
-  auto exit_call_forwarder =
-      absl::WrapUnique(new LocalExitCallForwarder(exit_logging, server));
+  auto exit_call_forwarder = absl::WrapUnique(new LocalExitCallForwarder(
+      exit_logging, std::move(metrics), server));
+
+  // Create the optional exit call handlers enabled by the host.
+  bool read_local_clock = false;
+  for (uint64_t selector : local_exit_calls) {
+    if (selector == host_call::kClockGettimeHandler) {
+      read_local_clock = true;
+      continue;
+    }
+    auto it = std::find_if(std::begin(kLocalHostCalls),
+                           std::end(kLocalHostCalls),
+                           [selector](const LocalHostCall &host_call) {
+                             return host_call.selector == selector;
+                           });
+    if (it == std::end(kLocalHostCalls)) {
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    absl::StrCat("Exit call cannot be handled remotely, "
+                                 "selector=",
+                                 selector));
+    }
+    exit_call_forwarder->handlers_.emplace_back(
+        absl::make_unique<HostCallExitCallHandler>(*it,
+                                                   exit_call_forwarder.get()));
+  }
 
   // Create exit call handlers that could be handled locally.
   exit_call_forwarder->handlers_.emplace_back(
-      absl::make_unique<GetTimeExitCallHandler>(server->communicator(),
-                                                exit_call_forwarder.get()));
+      absl::make_unique<GetTimeExitCallHandler>(
+          server->communicator(), read_local_clock, exit_call_forwarder.get()));
   exit_call_forwarder->handlers_.emplace_back(
       absl::make_unique<SysFutexWaitExitCallHandler>(
           exit_call_forwarder.get()));
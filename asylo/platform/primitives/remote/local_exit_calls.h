@@ -19,12 +19,15 @@
 #ifndef ASYLO_PLATFORM_PRIMITIVES_REMOTE_LOCAL_EXIT_CALLS_H_
 #define ASYLO_PLATFORM_PRIMITIVES_REMOTE_LOCAL_EXIT_CALLS_H_
 
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 #include "absl/types/optional.h"
 #include "asylo/platform/primitives/remote/proxy_server.h"
 #include "asylo/platform/primitives/util/dispatch_table.h"
 #include "asylo/platform/primitives/util/exit_log.h"
+#include "asylo/platform/primitives/util/exit_metrics.h"
 #include "asylo/platform/primitives/util/message.h"
 #include "asylo/util/status.h"
 #include "asylo/util/statusor.h"
@@ -36,6 +39,15 @@ namespace primitives {
 // to forward majority of exit calls invoked by the enclave loaded by proxy
 // server over the remote connector to the untrusted host. Registration of exit
 // handlers is only needed for those exit calls that can be handled locally.
+//
+// Besides the exit calls it always handles locally, the forwarder handles the
+// following ones on the remote machine if the RemoteProxyClientConfig enables
+// them with EnableLocalExitCall(). None of them refers to resources of the
+// host process, but their results reflect the remote machine:
+//   * host_call::kClockGettimeHandler, reading every clock locally instead of
+//     approximating CLOCK_REALTIME with the last time received from the host,
+//   * host_call::kSysconfHandler,
+//   * host_call::kSleepHandler and host_call::kUSleepHandler.
 class LocalExitCallForwarder : public LoggingDispatchTable {
  public:
   // Base class for exit calls to be potentially handled by proxy server.
@@ -104,9 +116,14 @@ class LocalExitCallForwarder : public LoggingDispatchTable {
   // Factory method creates a forwarder associated with the server and
   // registers all local exit handlers. Should only be called once.
   // `exit_logging` parameter indicates whether enclave exit call logging is
-  // to be enabled or not.
+  // to be enabled or not, and `metrics`, if not null, receives the statistics
+  // of every exit call.
+  // `local_exit_calls` lists the selectors of the optional local exit calls
+  // to enable; an error is returned if any of them is not one of those.
   static StatusOr<std::unique_ptr<Client::ExitCallProvider>> Create(
-      bool exit_logging, const RemoteEnclaveProxyServer *server);
+      bool exit_logging, std::shared_ptr<ExitMetrics> metrics,
+      const std::vector<uint64_t> &local_exit_calls,
+      const RemoteEnclaveProxyServer *server);
 
   // Runs exit call handler.
   static Status Run(const std::shared_ptr<Client> &client, void *context,
@@ -118,6 +135,7 @@ class LocalExitCallForwarder : public LoggingDispatchTable {
 
  private:
   LocalExitCallForwarder(bool exit_logging,
+                         std::shared_ptr<ExitMetrics> metrics,
                          const RemoteEnclaveProxyServer *server);
 
   // Registered handlers.
@@ -46,6 +46,48 @@ ProcSystemServiceClient::ProcSystemServiceClient(
   return response;
 }
 
+::asylo::StatusOr<ExitCallStatsResponse>
+ProcSystemServiceClient::GetExitCallStats() const {
+  ExitCallStatsRequest request;
+  ExitCallStatsResponse response;
+  ::grpc::ClientContext context;
+
+  auto status = stub_->GetExitCallStats(&context, request, &response);
+  if (!status.ok()) {
+    return ::asylo::Status(static_cast<error::GoogleError>(status.error_code()),
+                           std::string(status.error_message()));
+  }
+  return response;
+}
+
+::asylo::StatusOr<EnclaveThreadStatsResponse>
+ProcSystemServiceClient::GetEnclaveThreadStats() const {
+  EnclaveThreadStatsRequest request;
+  EnclaveThreadStatsResponse response;
+  ::grpc::ClientContext context;
+
+  auto status = stub_->GetEnclaveThreadStats(&context, request, &response);
+  if (!status.ok()) {
+    return ::asylo::Status(static_cast<error::GoogleError>(status.error_code()),
+                           std::string(status.error_message()));
+  }
+  return response;
+}
+
+::asylo::StatusOr<EnclaveMemoryStatsResponse>
+ProcSystemServiceClient::GetEnclaveMemoryStats() const {
+  EnclaveMemoryStatsRequest request;
+  EnclaveMemoryStatsResponse response;
+  ::grpc::ClientContext context;
+
+  auto status = stub_->GetEnclaveMemoryStats(&context, request, &response);
+  if (!status.ok()) {
+    return ::asylo::Status(static_cast<error::GoogleError>(status.error_code()),
+                           std::string(status.error_message()));
+  }
+  return response;
+}
+
 ProcSystemServiceClient::ProcSystemServiceClient(
     const std::shared_ptr<::grpc::Channel> &channel)
     : stub_(std::make_shared<ProcSystemService::Stub>(channel)) {}
@@ -41,6 +41,12 @@ class ProcSystemServiceClient {
 
   ::asylo::StatusOr<ProcStatResponse> GetProcStat() const;
 
+  ::asylo::StatusOr<ExitCallStatsResponse> GetExitCallStats() const;
+
+  ::asylo::StatusOr<EnclaveThreadStatsResponse> GetEnclaveThreadStats() const;
+
+  ::asylo::StatusOr<EnclaveMemoryStatsResponse> GetEnclaveMemoryStats() const;
+
  private:
   const std::shared_ptr<ProcSystemService::StubInterface> stub_;
 };
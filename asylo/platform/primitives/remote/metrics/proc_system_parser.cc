@@ -18,15 +18,15 @@
 
 #include "asylo/platform/primitives/remote/metrics/proc_system_parser.h"
 
+#include <fcntl.h>
 #include <linux/sched.h>
 #include <sys/types.h>
+#include <unistd.h>
 
-#include <fstream>
-#include <iostream>
-#include <sstream>
+#include <cerrno>
+#include <string>
 
 #include "absl/strings/str_cat.h"
-#include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "asylo/util/asylo_macros.h"
 #include "asylo/util/cleanup.h"
@@ -45,18 +45,42 @@ namespace asylo {
 namespace primitives {
 namespace {
 
+// Maximum character length of a stat file.
+constexpr size_t kStatFileLength = TASK_COMM_LEN + 1001;
+
 StatusOr<std::string> GetFileContents(const std::string &filename) {
-  std::ifstream file;
-  Cleanup file_cleanup([&file]() { file.close(); });
-  file.open(filename.c_str());
-  if (!file) {
+  int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
     return Status(error::GoogleError::UNKNOWN,
                   absl::StrCat("Unable to open file with filename=", filename));
   }
-
-  std::stringstream file_contents;
-  file_contents << file.rdbuf();
-  return file_contents.str();
+  Cleanup file_cleanup([fd]() { close(fd); });
+
+  // Read straight into the returned string, sized for a whole stat file so
+  // that it is usually read with a single allocation and system call.
+  std::string file_contents(kStatFileLength, '\0');
+  size_t size = 0;
+  for (;;) {
+    ssize_t bytes_read =
+        read(fd, &file_contents[size], file_contents.size() - size);
+    if (bytes_read < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return Status(
+          error::GoogleError::UNKNOWN,
+          absl::StrCat("Unable to read file with filename=", filename));
+    }
+    if (bytes_read == 0) {
+      break;
+    }
+    size += bytes_read;
+    if (size == file_contents.size()) {
+      file_contents.resize(2 * size);
+    }
+  }
+  file_contents.resize(size);
+  return file_contents;
 }
 
 }  // namespace
@@ -71,11 +95,11 @@ StatusOr<std::string> ProcSystemParser::ReadProcStat(pid_t pid) const {
 StatusOr<ProcSystemStat> ProcSystemParser::GetProcStat(pid_t pid) const {
   std::string stat_contents;
   ASYLO_ASSIGN_OR_RETURN(stat_contents, ReadProcStat(pid));
-  // Maximum character length of a stat file plus a null character.
-  static constexpr uint64_t kStatFileLength = TASK_COMM_LEN + 1002;
-  char stat_contents_c_str[kStatFileLength];
-  absl::SNPrintF(stat_contents_c_str, sizeof(stat_contents_c_str), "%s",
-                 stat_contents);
+  // Parse the contents in place, only looking at the length of a stat file.
+  if (stat_contents.size() > kStatFileLength) {
+    stat_contents.resize(kStatFileLength);
+  }
+  const char *const stat_contents_c_str = stat_contents.c_str();
 
   ProcSystemStat proc_stat;
 
@@ -97,14 +121,14 @@ StatusOr<ProcSystemStat> ProcSystemParser::GetProcStat(pid_t pid) const {
   // We add one byte for the terminating character.
   char process_filename[kFilenameLength + 1];
 
-  char *start = nullptr;
-  char *end = nullptr;
+  const char *start = nullptr;
+  const char *end = nullptr;
 
   // This loop scans through the stat contents and finds the beginning and end
   // of the process' filename. |start| is set to the first open parenthenses,
   // and |end| is set to the last parenthenses. This has the unfortunate side
   // effect of needing to scan the entire string.
-  for (char *peek = stat_contents_c_str; *peek != '\0'; peek++) {
+  for (const char *peek = stat_contents_c_str; *peek != '\0'; peek++) {
     if (start == nullptr && *peek == '(') {
       start = peek;
     }
@@ -18,7 +18,12 @@
 
 #include "asylo/platform/primitives/remote/metrics/proc_system_service.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "absl/memory/memory.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "asylo/platform/primitives/remote/metrics/proc_system.grpc.pb.h"
 #include "asylo/platform/primitives/remote/metrics/proc_system.pb.h"
 #include "asylo/platform/primitives/remote/metrics/proc_system_parser.h"
@@ -29,10 +34,88 @@
 
 namespace asylo {
 namespace primitives {
+namespace {
+
+// Time a WatchProcStat call waits for a new sample before checking whether it
+// has been cancelled.
+constexpr absl::Duration kWatchPollInterval = absl::Seconds(1);
+
+}  // namespace
+
+uint64_t ProcSystemServiceImpl::SampleHistory::oldest_sequence_number() const {
+  return next_sequence_number > ring.size() ? next_sequence_number - ring.size()
+                                            : 1;
+}
+
+ProcSystemServiceImpl::~ProcSystemServiceImpl() {
+  if (sampler_thread_) {
+    history_.Lock()->is_stopping = true;
+    sampler_thread_->Join();
+  }
+}
+
+void ProcSystemServiceImpl::StartSampling(absl::Duration interval,
+                                          size_t history_size) {
+  {
+    auto locked_history = history_.Lock();
+    CHECK(!locked_history->is_sampling) << "Sampling already started";
+    locked_history->ring.resize(std::max<size_t>(history_size, 1));
+    locked_history->is_sampling = true;
+  }
+  sampler_thread_ = absl::make_unique<Thread>(
+      [this, interval] { SampleLoop(interval); });
+}
+
+void ProcSystemServiceImpl::SampleLoop(absl::Duration interval) {
+  ProcStatSample sample;
+  for (;;) {
+    sample.Clear();
+    auto status = BuildProcStat(sample.mutable_proc_stat());
+    sample.set_time_nanos(absl::GetCurrentTimeNanos());
+    {
+      auto locked_history = history_.Lock();
+      if (status.ok()) {
+        const uint64_t sequence_number = locked_history->next_sequence_number++;
+        sample.set_sequence_number(sequence_number);
+        locked_history->ring[sequence_number % locked_history->ring.size()]
+            .Swap(&sample);
+      } else {
+        LOG(ERROR) << status;
+      }
+    }
+    if (history_
+            .LockWhenWithTimeout(
+                [](const SampleHistory &history) {
+                  return history.is_stopping;
+                },
+                interval)
+            .first) {
+      return;
+    }
+  }
+}
 
 ::grpc::Status ProcSystemServiceImpl::GetProcStat(
     grpc::ServerContext *context, const ProcStatRequest *request,
     ProcStatResponse *response) {
+  {
+    auto locked_history = history_.ReaderLock();
+    if (locked_history->is_sampling &&
+        locked_history->next_sequence_number > 1) {
+      const auto &ring = locked_history->ring;
+      const uint64_t latest = locked_history->next_sequence_number - 1;
+      *response->mutable_proc_stat() = ring[latest % ring.size()].proc_stat();
+      if (request->has_after_sequence_number()) {
+        for (uint64_t sequence_number =
+                 std::max(request->after_sequence_number() + 1,
+                          locked_history->oldest_sequence_number());
+             sequence_number <= latest; ++sequence_number) {
+          *response->add_samples() = ring[sequence_number % ring.size()];
+        }
+      }
+      return ::grpc::Status::OK;
+    }
+  }
   auto status = BuildProcStatResponse(response);
   if (!status.ok()) {
     LOG(ERROR) << status;
@@ -42,6 +125,163 @@ namespace primitives {
   return ::grpc::Status::OK;
 }
 
+::grpc::Status ProcSystemServiceImpl::WatchProcStat(
+    grpc::ServerContext *context, const WatchProcStatRequest *request,
+    ::grpc::ServerWriter<ProcStatSample> *writer) {
+  if (!history_.ReaderLock()->is_sampling) {
+    return ::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION,
+                          "ProcStat sampling is not enabled.");
+  }
+  // Start with the latest sample, if there is one.
+  uint64_t next_to_send = 0;
+  std::vector<ProcStatSample> samples;
+  while (!context->IsCancelled()) {
+    {
+      auto locked_history =
+          history_
+              .ReaderLockWhenWithTimeout(
+                  [next_to_send](const SampleHistory &history) {
+                    return history.is_stopping ||
+                           history.next_sequence_number > next_to_send;
+                  },
+                  kWatchPollInterval)
+              .second;
+      if (locked_history->is_stopping) {
+        break;
+      }
+      if (next_to_send == 0) {
+        next_to_send = std::max<uint64_t>(
+            locked_history->next_sequence_number - 1, 1);
+      }
+      const auto &ring = locked_history->ring;
+      for (uint64_t sequence_number =
+               std::max(next_to_send, locked_history->oldest_sequence_number());
+           sequence_number < locked_history->next_sequence_number;
+           ++sequence_number) {
+        samples.emplace_back(ring[sequence_number % ring.size()]);
+      }
+      next_to_send =
+          std::max(next_to_send, locked_history->next_sequence_number);
+    }
+    for (const ProcStatSample &sample : samples) {
+      if (!writer->Write(sample)) {
+        return ::grpc::Status::OK;
+      }
+    }
+    samples.clear();
+  }
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status ProcSystemServiceImpl::GetExitCallStats(
+    grpc::ServerContext *context, const ExitCallStatsRequest *request,
+    ExitCallStatsResponse *response) {
+  if (!exit_metrics_) {
+    return ::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION,
+                          "Exit call metrics are not enabled.");
+  }
+  for (const auto &stats : exit_metrics_->Snapshot()) {
+    auto exit_call_stats = response->add_exit_call_stats();
+    exit_call_stats->set_selector(stats.selector);
+    exit_call_stats->set_sysno(stats.sysno);
+    exit_call_stats->set_count(stats.count);
+    exit_call_stats->set_error_count(stats.error_count);
+    exit_call_stats->set_input_bytes(stats.input_bytes);
+    exit_call_stats->set_output_bytes(stats.output_bytes);
+    exit_call_stats->set_total_latency_ns(stats.total_latency_ns);
+    for (uint64_t bucket : stats.latency_histogram) {
+      exit_call_stats->add_latency_histogram(bucket);
+    }
+  }
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status ProcSystemServiceImpl::GetEnclaveThreadStats(
+    grpc::ServerContext *context, const EnclaveThreadStatsRequest *request,
+    EnclaveThreadStatsResponse *response) {
+  auto provider = thread_stats_provider_.ReaderLock();
+  const ::asylo::EnclaveThreadStats *stats =
+      *provider ? (*provider)() : nullptr;
+  if (!stats) {
+    return ::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION,
+                          "Enclave thread statistics are not available.");
+  }
+  auto thread_stats = response->mutable_enclave_thread_counters();
+  thread_stats->set_queued_threads(
+      stats->queued_threads.load(std::memory_order_relaxed));
+  thread_stats->set_running_threads(
+      stats->running_threads.load(std::memory_order_relaxed));
+  thread_stats->set_pool_threads(
+      stats->pool_threads.load(std::memory_order_relaxed));
+  thread_stats->set_parked_pool_threads(
+      stats->parked_pool_threads.load(std::memory_order_relaxed));
+  thread_stats->set_active_tcs(
+      stats->active_tcs.load(std::memory_order_relaxed));
+  thread_stats->set_donated_tcs(
+      stats->donated_tcs.load(std::memory_order_relaxed));
+  thread_stats->set_ecalls(stats->ecalls.load(std::memory_order_relaxed));
+  thread_stats->set_ocalls(stats->ocalls.load(std::memory_order_relaxed));
+  thread_stats->set_tcs_waits(stats->tcs_waits.load(std::memory_order_relaxed));
+  thread_stats->set_tcs_wait_ns(
+      stats->tcs_wait_ns.load(std::memory_order_relaxed));
+  thread_stats->set_emulated_cpuid(
+      stats->emulated_cpuid.load(std::memory_order_relaxed));
+  thread_stats->set_emulated_rdtsc(
+      stats->emulated_rdtsc.load(std::memory_order_relaxed));
+  return ::grpc::Status::OK;
+}
+
+void ProcSystemServiceImpl::SetThreadStatsProvider(
+    ThreadStatsProvider provider) {
+  *thread_stats_provider_.Lock() = std::move(provider);
+}
+
+::grpc::Status ProcSystemServiceImpl::GetEnclaveMemoryStats(
+    grpc::ServerContext *context, const EnclaveMemoryStatsRequest *request,
+    EnclaveMemoryStatsResponse *response) {
+  auto provider = memory_stats_provider_.ReaderLock();
+  if (!*provider) {
+    return ::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION,
+                          "Enclave memory statistics are not available.");
+  }
+  auto stats_result = (*provider)();
+  if (!stats_result.ok()) {
+    const ::asylo::Status &status = stats_result.status();
+    return ::grpc::Status(static_cast<::grpc::StatusCode>(status.error_code()),
+                          std::string(status.error_message()));
+  }
+  const ::asylo::EnclaveMemoryStats &stats = stats_result.ValueOrDie();
+  auto usage = response->mutable_enclave_memory_usage();
+  usage->set_heap_size(stats.heap_size);
+  usage->set_heap_used(stats.heap_used);
+  usage->set_heap_peak_used(stats.heap_peak_used);
+  usage->set_heap_allocated_bytes(stats.heap_allocated_bytes);
+  usage->set_heap_free_bytes(stats.heap_free_bytes);
+  for (const ::asylo::EnclaveStackStats &stack : stats.stacks) {
+    auto stack_usage = usage->add_stacks();
+    stack_usage->set_size(stack.size);
+    stack_usage->set_peak_used(stack.peak_used);
+  }
+  if (stats.epc.total_pages) {
+    usage->set_epc_total_pages(*stats.epc.total_pages);
+  }
+  if (stats.epc.free_pages) {
+    usage->set_epc_free_pages(*stats.epc.free_pages);
+  }
+  if (stats.epc.marked_old_pages) {
+    usage->set_epc_marked_old_pages(*stats.epc.marked_old_pages);
+  }
+  if (stats.epc.loaded_back_pages) {
+    usage->set_epc_loaded_back_pages(*stats.epc.loaded_back_pages);
+  }
+  return ::grpc::Status::OK;
+}
+
+void ProcSystemServiceImpl::SetMemoryStatsProvider(
+    MemoryStatsProvider provider) {
+  *memory_stats_provider_.Lock() = std::move(provider);
+}
+
 std::unique_ptr<ProcSystemParser>
 ProcSystemServiceImpl::CreateProcSystemParser() const {
   return absl::make_unique<ProcSystemParser>();
@@ -49,9 +289,13 @@ ProcSystemServiceImpl::CreateProcSystemParser() const {
 
 ::asylo::Status ProcSystemServiceImpl::BuildProcStatResponse(
     ProcStatResponse *response) const {
+  return BuildProcStat(response->mutable_proc_stat());
+}
+
+::asylo::Status ProcSystemServiceImpl::BuildProcStat(
+    ProcStat *response_proc_stat) const {
   ProcSystemStat proc_stat;
   ASYLO_ASSIGN_OR_RETURN(proc_stat, proc_system_parser_->GetProcStat(pid_));
-  auto response_proc_stat = response->mutable_proc_stat();
   response_proc_stat->set_pid(proc_stat.pid);
   response_proc_stat->set_comm(proc_stat.comm);
   response_proc_stat->set_state(proc_stat.state);
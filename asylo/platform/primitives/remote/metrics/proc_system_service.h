@@ -19,11 +19,24 @@
 #ifndef ASYLO_PLATFORM_PRIMITIVES_REMOTE_METRICS_PROC_SYSTEM_SERVICE_H_
 #define ASYLO_PLATFORM_PRIMITIVES_REMOTE_METRICS_PROC_SYSTEM_SERVICE_H_
 
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "asylo/platform/common/enclave_memory_stats.h"
+#include "asylo/platform/common/enclave_thread_stats.h"
 #include "asylo/platform/primitives/remote/metrics/proc_system.grpc.pb.h"
 #include "asylo/platform/primitives/remote/metrics/proc_system.pb.h"
 #include "asylo/platform/primitives/remote/metrics/proc_system_parser.h"
+#include "absl/time/time.h"
+#include "asylo/platform/primitives/util/exit_metrics.h"
+#include "asylo/util/mutex_guarded.h"
 #include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+#include "asylo/util/thread.h"
 #include "include/grpc/support/time.h"
+#include "include/grpcpp/impl/codegen/sync_stream.h"
 #include "include/grpcpp/support/status.h"
 
 namespace asylo {
@@ -31,27 +44,101 @@ namespace primitives {
 
 class ProcSystemServiceImpl : public ProcSystemService::Service {
  public:
+  // Returns the thread counters of the served enclave, or nullptr if they are
+  // unavailable.
+  using ThreadStatsProvider =
+      std::function<const ::asylo::EnclaveThreadStats *()>;
+
+  // Reads the memory usage of the served enclave.
+  using MemoryStatsProvider =
+      std::function<::asylo::StatusOr<::asylo::EnclaveMemoryStats>()>;
+
   explicit ProcSystemServiceImpl(pid_t pid)
       : proc_system_parser_(CreateProcSystemParser()), pid_(pid) {}
+
+  // Creates a service which also reports the exit call statistics recorded in
+  // |exit_metrics|.
+  ProcSystemServiceImpl(pid_t pid,
+                        std::shared_ptr<const ExitMetrics> exit_metrics)
+      : proc_system_parser_(CreateProcSystemParser()),
+        pid_(pid),
+        exit_metrics_(std::move(exit_metrics)) {}
+
   ProcSystemServiceImpl(const ProcSystemServiceImpl &other) = delete;
   ProcSystemServiceImpl &operator=(const ProcSystemServiceImpl &other) = delete;
 
+  ~ProcSystemServiceImpl() override;
+
+  // Starts sampling /proc/[pid]/stat every |interval| on a background thread,
+  // keeping the latest |history_size| samples. Once sampling, GetProcStat()
+  // answers from the latest sample instead of parsing the file per request,
+  // and WatchProcStat() becomes available. May be called at most once.
+  void StartSampling(absl::Duration interval, size_t history_size);
+
   ::grpc::Status GetProcStat(::grpc::ServerContext *context,
                              const ProcStatRequest *request,
                              ProcStatResponse *response) override;
 
+  ::grpc::Status WatchProcStat(
+      ::grpc::ServerContext *context, const WatchProcStatRequest *request,
+      ::grpc::ServerWriter<ProcStatSample> *writer) override;
+
+  ::grpc::Status GetExitCallStats(::grpc::ServerContext *context,
+                                  const ExitCallStatsRequest *request,
+                                  ExitCallStatsResponse *response) override;
+
+  ::grpc::Status GetEnclaveThreadStats(
+      ::grpc::ServerContext *context, const EnclaveThreadStatsRequest *request,
+      EnclaveThreadStatsResponse *response) override;
+
+  // Sets the source of the counters reported by GetEnclaveThreadStats(). The
+  // provider is only called while set, so passing nullptr guarantees that the
+  // counters of a previous provider are no longer read.
+  void SetThreadStatsProvider(ThreadStatsProvider provider);
+
+  ::grpc::Status GetEnclaveMemoryStats(
+      ::grpc::ServerContext *context, const EnclaveMemoryStatsRequest *request,
+      EnclaveMemoryStatsResponse *response) override;
+
+  // Sets the source of the statistics reported by GetEnclaveMemoryStats(),
+  // with the same guarantees as SetThreadStatsProvider().
+  void SetMemoryStatsProvider(MemoryStatsProvider provider);
+
  protected:
   ProcSystemServiceImpl(std::unique_ptr<ProcSystemParser> proc_system_parser,
                         pid_t pid)
       : proc_system_parser_(std::move(proc_system_parser)), pid_(pid) {}
 
  private:
+  // Samples kept by the background sampler. The sample with sequence number
+  // |n| is stored at |ring[n % ring.size()]|, for the |ring.size()| sequence
+  // numbers preceding |next_sequence_number|.
+  struct SampleHistory {
+    std::vector<ProcStatSample> ring;
+    uint64_t next_sequence_number = 1;
+    bool is_sampling = false;
+    bool is_stopping = false;
+
+    // Returns the sequence number of the oldest sample still kept.
+    uint64_t oldest_sequence_number() const;
+  };
+
   std::unique_ptr<ProcSystemParser> CreateProcSystemParser() const;
 
   ::asylo::Status BuildProcStatResponse(ProcStatResponse *response) const;
 
+  ::asylo::Status BuildProcStat(ProcStat *proc_stat) const;
+
+  // Body of |sampler_thread_|.
+  void SampleLoop(absl::Duration interval);
+
   std::unique_ptr<ProcSystemParser> proc_system_parser_;
   const pid_t pid_;
+  const std::shared_ptr<const ExitMetrics> exit_metrics_;
+  MutexGuarded<ThreadStatsProvider> thread_stats_provider_{nullptr};
+  MutexGuarded<MemoryStatsProvider> memory_stats_provider_{nullptr};
+  MutexGuarded<SampleHistory> history_{SampleHistory()};
+  std::unique_ptr<Thread> sampler_thread_;
 };
 
 }  // namespace primitives
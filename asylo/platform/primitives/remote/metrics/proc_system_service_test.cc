@@ -18,13 +18,20 @@
 
 #include "asylo/platform/primitives/remote/metrics/proc_system_service.h"
 
+#include <unistd.h>
+
 #include <memory>
+#include <string>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "absl/memory/memory.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "asylo/platform/common/enclave_thread_stats.h"
 #include "asylo/platform/primitives/remote/metrics/mocks/mock_proc_system_parser.h"
 #include "asylo/platform/primitives/remote/metrics/mocks/mock_proc_system_service.h"
+#include "asylo/platform/primitives/util/exit_metrics.h"
 #include "asylo/test/util/status_matchers.h"
 
 namespace asylo {
@@ -187,6 +194,159 @@ TEST_F(ProcSystemServiceTest, ResponseIsSuccessfulParse) {
               Eq(comparison_parser->kExpectedExitCode));
 }
 
+TEST_F(ProcSystemServiceTest, SampledResponsesKeepHistory) {
+  auto mock_parser = absl::make_unique<MockProcSystemParser>();
+  const std::string stat_contents = mock_parser->stat_contents();
+  const pid_t pid = mock_parser->kExpectedPid;
+  EXPECT_CALL(*mock_parser, ReadProcStat(_))
+      .WillRepeatedly(Return(stat_contents));
+  MockProcSystemService mock_service(std::move(mock_parser), pid);
+  constexpr size_t kHistorySize = 4;
+  mock_service.StartSampling(absl::Milliseconds(1), kHistorySize);
+
+  // Wait until the history has wrapped around.
+  proc_stat_request_.set_after_sequence_number(0);
+  do {
+    absl::SleepFor(absl::Milliseconds(5));
+    proc_stat_response_.Clear();
+    ASYLO_ASSERT_OK(Status(mock_service.GetProcStat(
+        &context_, &proc_stat_request_, &proc_stat_response_)));
+  } while (proc_stat_response_.samples_size() == 0 ||
+           proc_stat_response_.samples(0).sequence_number() == 1);
+
+  ASSERT_THAT(proc_stat_response_.samples_size(), Eq(kHistorySize));
+  EXPECT_THAT(proc_stat_response_.proc_stat().pid(), Eq(pid));
+  for (int i = 1; i < proc_stat_response_.samples_size(); ++i) {
+    EXPECT_THAT(proc_stat_response_.samples(i).sequence_number(),
+                Eq(proc_stat_response_.samples(i - 1).sequence_number() + 1));
+    EXPECT_THAT(proc_stat_response_.samples(i).proc_stat().pid(), Eq(pid));
+  }
+
+  // Only samples past the requested one are returned.
+  const uint64_t latest = proc_stat_response_.samples(kHistorySize - 1)
+                              .sequence_number();
+  proc_stat_request_.set_after_sequence_number(latest);
+  proc_stat_response_.Clear();
+  ASYLO_ASSERT_OK(Status(mock_service.GetProcStat(
+      &context_, &proc_stat_request_, &proc_stat_response_)));
+  for (const ProcStatSample &sample : proc_stat_response_.samples()) {
+    EXPECT_THAT(sample.sequence_number(), Gt(latest));
+  }
+}
+
+TEST_F(ProcSystemServiceTest, WatchRequiresSampling) {
+  ProcSystemServiceImpl proc_system_service(getpid());
+  WatchProcStatRequest request;
+  EXPECT_THAT(Status(proc_system_service.WatchProcStat(&context_, &request,
+                                                       /*writer=*/nullptr)),
+              StatusIs(error::GoogleError::FAILED_PRECONDITION));
+}
+
+TEST_F(ProcSystemServiceTest, ExitCallStatsRequireMetrics) {
+  ProcSystemServiceImpl proc_system_service(getpid());
+  ExitCallStatsRequest request;
+  ExitCallStatsResponse response;
+  EXPECT_THAT(Status(proc_system_service.GetExitCallStats(&context_, &request,
+                                                          &response)),
+              StatusIs(error::GoogleError::FAILED_PRECONDITION));
+}
+
+TEST_F(ProcSystemServiceTest, ReportsExitCallStats) {
+  auto exit_metrics = std::make_shared<ExitMetrics>();
+  exit_metrics->Record(/*selector=*/88, /*sysno=*/1, absl::Microseconds(3),
+                       /*input_bytes=*/100, /*output_bytes=*/200, /*ok=*/true);
+  ProcSystemServiceImpl proc_system_service(getpid(), exit_metrics);
+
+  ExitCallStatsRequest request;
+  ExitCallStatsResponse response;
+  ASYLO_ASSERT_OK(Status(
+      proc_system_service.GetExitCallStats(&context_, &request, &response)));
+  ASSERT_THAT(response.exit_call_stats_size(), Eq(1));
+  const ExitCallStats &stats = response.exit_call_stats(0);
+  EXPECT_THAT(stats.selector(), Eq(88));
+  EXPECT_THAT(stats.sysno(), Eq(1));
+  EXPECT_THAT(stats.count(), Eq(1));
+  EXPECT_THAT(stats.input_bytes(), Eq(100));
+  EXPECT_THAT(stats.output_bytes(), Eq(200));
+  EXPECT_THAT(stats.latency_histogram_size(),
+              Eq(ExitMetrics::kNumLatencyBuckets));
+  EXPECT_THAT(stats.latency_histogram(2), Eq(1));
+}
+
+TEST_F(ProcSystemServiceTest, EnclaveThreadStatsRequireProvider) {
+  ProcSystemServiceImpl proc_system_service(getpid());
+  EnclaveThreadStatsRequest request;
+  EnclaveThreadStatsResponse response;
+  EXPECT_THAT(Status(proc_system_service.GetEnclaveThreadStats(
+                  &context_, &request, &response)),
+              StatusIs(error::GoogleError::FAILED_PRECONDITION));
+}
+
+TEST_F(ProcSystemServiceTest, ReportsEnclaveThreadStats) {
+  ::asylo::EnclaveThreadStats stats;
+  stats.running_threads = 3;
+  stats.active_tcs = 2;
+  stats.ecalls = 40;
+  stats.emulated_rdtsc = 7;
+  ProcSystemServiceImpl proc_system_service(getpid());
+  proc_system_service.SetThreadStatsProvider([&stats] { return &stats; });
+
+  EnclaveThreadStatsRequest request;
+  EnclaveThreadStatsResponse response;
+  ASYLO_ASSERT_OK(Status(proc_system_service.GetEnclaveThreadStats(
+      &context_, &request, &response)));
+  const EnclaveThreadCounters &counters = response.enclave_thread_counters();
+  EXPECT_THAT(counters.running_threads(), Eq(3));
+  EXPECT_THAT(counters.active_tcs(), Eq(2));
+  EXPECT_THAT(counters.ecalls(), Eq(40));
+  EXPECT_THAT(counters.tcs_waits(), Eq(0));
+  EXPECT_THAT(counters.emulated_rdtsc(), Eq(7));
+
+  proc_system_service.SetThreadStatsProvider(nullptr);
+  EXPECT_THAT(Status(proc_system_service.GetEnclaveThreadStats(
+                  &context_, &request, &response)),
+              StatusIs(error::GoogleError::FAILED_PRECONDITION));
+}
+
+TEST_F(ProcSystemServiceTest, ReportsEnclaveMemoryStats) {
+  ProcSystemServiceImpl proc_system_service(getpid());
+  EnclaveMemoryStatsRequest request;
+  EnclaveMemoryStatsResponse response;
+  EXPECT_THAT(Status(proc_system_service.GetEnclaveMemoryStats(
+                  &context_, &request, &response)),
+              StatusIs(error::GoogleError::FAILED_PRECONDITION));
+
+  ::asylo::EnclaveMemoryStats stats;
+  stats.heap_size = 1 << 20;
+  stats.heap_used = 4096;
+  stats.heap_peak_used = 8192;
+  stats.stacks.push_back({65536, 1024});
+  stats.epc.free_pages = 12;
+  proc_system_service.SetMemoryStatsProvider(
+      [&stats]() -> StatusOr<::asylo::EnclaveMemoryStats> { return stats; });
+  ASYLO_ASSERT_OK(Status(proc_system_service.GetEnclaveMemoryStats(
+      &context_, &request, &response)));
+  const EnclaveMemoryUsage &usage = response.enclave_memory_usage();
+  EXPECT_THAT(usage.heap_size(), Eq(1 << 20));
+  EXPECT_THAT(usage.heap_used(), Eq(4096));
+  EXPECT_THAT(usage.heap_peak_used(), Eq(8192));
+  ASSERT_THAT(usage.stacks_size(), Eq(1));
+  EXPECT_THAT(usage.stacks(0).size(), Eq(65536));
+  EXPECT_THAT(usage.stacks(0).peak_used(), Eq(1024));
+  EXPECT_TRUE(usage.has_epc_free_pages());
+  EXPECT_THAT(usage.epc_free_pages(), Eq(12));
+  EXPECT_FALSE(usage.has_epc_total_pages());
+
+  // Errors reading the statistics are passed through.
+  proc_system_service.SetMemoryStatsProvider(
+      []() -> StatusOr<::asylo::EnclaveMemoryStats> {
+        return Status(error::GoogleError::UNIMPLEMENTED, "No statistics");
+      });
+  EXPECT_THAT(Status(proc_system_service.GetEnclaveMemoryStats(
+                  &context_, &request, &response)),
+              StatusIs(error::GoogleError::UNIMPLEMENTED));
+}
+
 }  // namespace
 }  // namespace primitives
 }  // namespace asylo
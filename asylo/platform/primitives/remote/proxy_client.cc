@@ -156,6 +156,14 @@ Status RemoteEnclaveProxyClient::Connect(const EnclaveLoadConfig &load_config) {
       *enclave_path,
       config_->RunProvision(communicator()->server_port(), *enclave_path));
 
+  // Tell the proxy server which exit calls it may handle by itself.
+  RemoteLoadConfig *remote_config =
+      provisioned_load_config.MutableExtension(remote_load_config);
+  remote_config->clear_local_exit_calls();
+  for (uint64_t selector : config_->local_exit_calls()) {
+    remote_config->add_local_exit_calls(selector);
+  }
+
   // Receive address of the target server, which client will need to connect to.
   const std::string target_address = communicator_->WaitForEndPointAddress();
 
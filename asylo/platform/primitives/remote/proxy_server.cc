@@ -38,6 +38,7 @@
 #include "asylo/platform/primitives/util/exit_log.h"
 #include "asylo/platform/primitives/util/message.h"
 #include "asylo/platform/system_call/type_conversions/generated_types.h"
+#include "asylo/util/remote/remote_loader.pb.h"
 #include "asylo/util/status_macros.h"
 #include "asylo/util/statusor.h"
 #include "asylo/util/thread.h"
@@ -128,8 +129,17 @@ Status RemoteEnclaveProxyServer::Start(
             }
 
             // Create local exit forwarder for the local enclave.
+            const auto &local_exit_calls =
+                provisioned_load_config.GetExtension(remote_load_config)
+                    .local_exit_calls();
+            // Exit call statistics are served by the metrics service of the
+            // target Communicator.
             auto exit_call_forwarder_result = LocalExitCallForwarder::Create(
-                provisioned_load_config.exit_logging(), this);
+                provisioned_load_config.exit_logging(),
+                provisioned_load_config.exit_metrics()
+                    ? communicator_->exit_metrics()
+                    : nullptr,
+                {local_exit_calls.begin(), local_exit_calls.end()}, this);
             if (!exit_call_forwarder_result.ok()) {
               invocation->status = exit_call_forwarder_result.status();
               return;
@@ -147,10 +157,20 @@ Status RemoteEnclaveProxyServer::Start(
             }
             local_enclave_client_ =
                 std::move(local_enclave_client_result.ValueOrDie());
+            // Serve the thread counters and memory usage of the local enclave
+            // as metrics.
+            Client *const client = local_enclave_client_.get();
+            communicator_->set_thread_stats_provider(
+                [client] { return client->thread_stats(); });
+            communicator_->set_memory_stats_provider(
+                [client] { return client->GetMemoryStats(); });
             return;
           }
           case kSelectorRemoteDisconnect:
-            // Unload local client.
+            // Unload local client, once the metrics service stopped reading
+            // its thread counters and memory usage.
+            communicator_->set_thread_stats_provider(nullptr);
+            communicator_->set_memory_stats_provider(nullptr);
             local_enclave_client_.reset();
             invocation->status = Status::OkStatus();
             return;
@@ -19,6 +19,7 @@
 #include "asylo/platform/primitives/remote/util/proxy_launcher.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -26,16 +27,24 @@
 #include <string>
 
 #include "absl/flags/flag.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "asylo/util/logging.h"
 #include "asylo/platform/primitives/remote/util/grpc_credential_builder.h"
+#include "asylo/util/posix_error_space.h"
 #include "asylo/util/status.h"
 #include "asylo/util/statusor.h"
 
 namespace asylo {
 
-StatusOr<pid_t> LaunchProxy(absl::string_view host_address,
-                            absl::string_view remote_proxy) {
+namespace {
+
+// Forks and executes remote proxy process with |address_param| specifying how
+// it locates the host. If |inherited_fd| is not negative, it is kept open in
+// the proxy process.
+StatusOr<pid_t> LaunchProxyProcess(absl::string_view remote_proxy,
+                                   const std::string &address_param,
+                                   int inherited_fd) {
   // Prepare remote proxy base name, so that viewers display this proxy
   // process nicely.
   if (remote_proxy.empty()) {
@@ -70,7 +79,6 @@ StatusOr<pid_t> LaunchProxy(absl::string_view host_address,
   }
 
   // Fork remote enclave proxy process that will later load the Enclave.
-  std::string host_address_param(absl::StrCat("--host_address=", host_address));
   auto remote_target_pid = fork();
   if (remote_target_pid < 0) {
     return Status{
@@ -78,18 +86,105 @@ StatusOr<pid_t> LaunchProxy(absl::string_view host_address,
         absl::StrCat("Failed to fork remote proxy process: ", strerror(errno))};
   }
   if (remote_target_pid == 0) {
-    execl(proxy_name.c_str(), process_basename.c_str(),
-          host_address_param.c_str(), security_type_param.c_str(),
-          ssl_cert_param.c_str(), ssl_key_param.c_str(), nullptr);
+    if (inherited_fd >= 0) {
+      fcntl(inherited_fd, F_SETFD, 0);
+    }
+    execl(proxy_name.c_str(), process_basename.c_str(), address_param.c_str(),
+          security_type_param.c_str(), ssl_cert_param.c_str(),
+          ssl_key_param.c_str(), nullptr);
     LOG(FATAL) << "Failed to execute proxy_test_process: " << strerror(errno);
   }
   return remote_target_pid;
 }
 
+}  // namespace
+
+StatusOr<pid_t> LaunchProxy(absl::string_view host_address,
+                            absl::string_view remote_proxy) {
+  return LaunchProxyProcess(
+      remote_proxy, absl::StrCat("--host_address=", host_address),
+      /*inherited_fd=*/-1);
+}
+
 void WaitProxyTermination(pid_t remote_target_pid) {
   int wstatus;
   waitpid(remote_target_pid, &wstatus, 0);
   CHECK_EQ(0, wstatus) << strerror(errno);
 }
 
+StatusOr<PendingProxy> LaunchPendingProxy(absl::string_view remote_proxy) {
+  // Both ends are closed on exec, so that the pipe is not leaked into other
+  // proxies. The proxy process keeps the read end open explicitly.
+  int fds[2];
+  if (pipe2(fds, O_CLOEXEC) != 0) {
+    return Status{static_cast<error::PosixError>(errno),
+                  "Failed to create host address pipe"};
+  }
+  auto pid_or_status = LaunchProxyProcess(
+      remote_proxy, absl::StrCat("--host_address_fd=", fds[0]), fds[0]);
+  close(fds[0]);
+  if (!pid_or_status.ok()) {
+    close(fds[1]);
+    return pid_or_status.status();
+  }
+  return PendingProxy{pid_or_status.ValueOrDie(), fds[1]};
+}
+
+Status ReleasePendingProxy(const PendingProxy &proxy,
+                           absl::string_view host_address) {
+  Status status;
+  const char *ptr = host_address.data();
+  size_t remaining = host_address.size();
+  while (remaining > 0) {
+    ssize_t written = write(proxy.host_address_fd, ptr, remaining);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      status = Status{static_cast<error::PosixError>(errno),
+                      "Failed to send host address to remote proxy"};
+      break;
+    }
+    ptr += written;
+    remaining -= written;
+  }
+  close(proxy.host_address_fd);
+  return status;
+}
+
+bool IsPendingProxyAlive(const PendingProxy &proxy) {
+  int wstatus;
+  return waitpid(proxy.pid, &wstatus, WNOHANG) == 0;
+}
+
+void DiscardPendingProxy(const PendingProxy &proxy) {
+  close(proxy.host_address_fd);
+  // Fails with ECHILD if the process has already been reaped.
+  int wstatus;
+  waitpid(proxy.pid, &wstatus, 0);
+}
+
+StatusOr<std::string> ReceiveHostAddress(int host_address_fd) {
+  std::string host_address;
+  char buffer[256];
+  while (true) {
+    ssize_t received = read(host_address_fd, buffer, sizeof(buffer));
+    if (received < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      Status status{static_cast<error::PosixError>(errno),
+                    "Failed to receive host address"};
+      close(host_address_fd);
+      return status;
+    }
+    if (received == 0) {
+      break;
+    }
+    host_address.append(buffer, received);
+  }
+  close(host_address_fd);
+  return host_address;
+}
+
 }  // namespace asylo
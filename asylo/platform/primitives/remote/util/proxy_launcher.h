@@ -21,7 +21,10 @@
 
 #include <sys/types.h>
 
+#include <string>
+
 #include "absl/strings/string_view.h"
+#include "asylo/util/status.h"
 #include "asylo/util/statusor.h"
 
 namespace asylo {
@@ -35,6 +38,36 @@ StatusOr<pid_t> LaunchProxy(absl::string_view host_address,
 // Helper function waits for the remote proxt process to terminate.
 void WaitProxyTermination(pid_t remote_target_pid);
 
+// Remote proxy process launched ahead of time, which waits for its host address
+// to be written to |host_address_fd| before connecting to the host.
+struct PendingProxy {
+  pid_t pid;
+  int host_address_fd;
+};
+
+// Helper function launches a remote proxy process with given path, passing it
+// the read end of a pipe with --host_address_fd instead of a host address.
+// Returns the pending proxy or status in case of any error.
+StatusOr<PendingProxy> LaunchPendingProxy(absl::string_view remote_proxy);
+
+// Sends |host_address| to a pending proxy and closes its pipe. The proxy then
+// proceeds exactly like one launched with LaunchProxy.
+Status ReleasePendingProxy(const PendingProxy &proxy,
+                           absl::string_view host_address);
+
+// Returns true if the pending proxy process is still running. A terminated
+// process is reaped, and only needs to be discarded.
+bool IsPendingProxyAlive(const PendingProxy &proxy);
+
+// Closes the pipe of a pending proxy, which then terminates without connecting
+// to any host, and waits for its process to terminate.
+void DiscardPendingProxy(const PendingProxy &proxy);
+
+// Helper function used by a pending remote proxy process to read the host
+// address from |host_address_fd| and close it. Returns an empty address if the
+// proxy was discarded.
+StatusOr<std::string> ReceiveHostAddress(int host_address_fd);
+
 }  // namespace asylo
 
 #endif  // ASYLO_PLATFORM_PRIMITIVES_REMOTE_UTIL_PROXY_LAUNCHER_H_
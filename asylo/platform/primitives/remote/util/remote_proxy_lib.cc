@@ -18,6 +18,7 @@
 
 #include "asylo/platform/primitives/remote/util/remote_proxy_lib.h"
 
+#include <cstdint>
 #include <string>
 #include <utility>
 
@@ -31,6 +32,7 @@
 #include "asylo/platform/primitives/primitives.h"
 #include "asylo/platform/primitives/remote/communicator.h"
 #include "asylo/platform/primitives/remote/proxy_server.h"
+#include "asylo/platform/primitives/remote/util/proxy_launcher.h"
 #include "asylo/platform/primitives/untrusted_primitives.h"
 #include "asylo/platform/primitives/util/message.h"
 #include "asylo/util/remote/process_main_wrapper.h"
@@ -41,6 +43,10 @@
 ABSL_FLAG(std::string, host_address, "[::]:8888",
           "Address that remote enclave calls back to the host");
 
+ABSL_FLAG(int32_t, host_address_fd, -1,
+          "File descriptor to read the host address from, overriding "
+          "--host_address; set when the proxy is launched ahead of time");
+
 using ::asylo::EnclaveLoadConfig;
 using ::asylo::ProcessMainWrapper;
 using ::asylo::RemoteProxyServerConfig;
@@ -79,8 +85,24 @@ StatusOr<EnclaveLoadConfig> LocalEnclaveFactory::ParseEnclaveLoadConfig(
 int main(int argc, char **argv) {
   absl::ParseCommandLine(argc, argv);
 
-  auto config_or_request = RemoteProxyServerConfig::DefaultsWithHostAddress(
-      absl::GetFlag(FLAGS_host_address));
+  std::string host_address = absl::GetFlag(FLAGS_host_address);
+  if (absl::GetFlag(FLAGS_host_address_fd) >= 0) {
+    // Launched ahead of time: block until a host is assigned.
+    auto host_address_result =
+        ::asylo::ReceiveHostAddress(absl::GetFlag(FLAGS_host_address_fd));
+    if (!host_address_result.ok()) {
+      LOG(ERROR) << host_address_result.status();
+      return -1;
+    }
+    host_address = std::move(host_address_result.ValueOrDie());
+    if (host_address.empty()) {
+      // Discarded without being assigned to any host.
+      return 0;
+    }
+  }
+
+  auto config_or_request =
+      RemoteProxyServerConfig::DefaultsWithHostAddress(host_address);
   if (!config_or_request.ok()) {
     LOG(ERROR) << config_or_request.status();
     return -1;
@@ -0,0 +1,99 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include "asylo/platform/primitives/sgx/committed_heap.h"
+
+#include <cstdint>
+
+extern "C" {
+
+// Provided by the SGX trusted runtime. Add or remove |page_number| EPC pages
+// starting at |start_address| with EDMM, and return zero on success.
+int apply_EPC_pages(void *start_address, size_t page_number);
+int trim_EPC_pages(void *start_address, size_t page_number);
+
+}  // extern "C"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+constexpr size_t kPageSize = 4096;
+
+// Pointer to start of the heap.
+void *heap_base = nullptr;
+
+// Size of the heap that is never trimmed, in bytes.
+size_t heap_min_size = 0;
+
+// Size of the part of the heap backed by EPC pages, in bytes.
+size_t heap_committed_size = 0;
+
+bool is_edmm_supported = false;
+
+size_t RoundUpToPage(size_t size) {
+  return (size + kPageSize - 1) & ~(kPageSize - 1);
+}
+
+}  // namespace
+
+void InitCommittedHeap(void *base, size_t min_size, size_t committed_size,
+                       bool edmm_supported) {
+  heap_base = base;
+  is_edmm_supported = edmm_supported;
+  heap_min_size = RoundUpToPage(min_size);
+  heap_committed_size = RoundUpToPage(committed_size);
+  if (heap_committed_size < heap_min_size) {
+    heap_committed_size = heap_min_size;
+  }
+}
+
+bool ResizeCommittedHeap(size_t heap_size) {
+  if (!is_edmm_supported) {
+    return true;
+  }
+  size_t target = RoundUpToPage(heap_size);
+  if (target < heap_min_size) {
+    target = heap_min_size;
+  }
+  uintptr_t base = reinterpret_cast<uintptr_t>(heap_base);
+  if (target > heap_committed_size) {
+    if (apply_EPC_pages(reinterpret_cast<void *>(base + heap_committed_size),
+                        (target - heap_committed_size) / kPageSize) != 0) {
+      return false;
+    }
+    heap_committed_size = target;
+  } else if (target < heap_committed_size) {
+    // A failed trim leaves the pages committed, which is harmless.
+    if (trim_EPC_pages(reinterpret_cast<void *>(base + target),
+                       (heap_committed_size - target) / kPageSize) == 0) {
+      heap_committed_size = target;
+    }
+  }
+  return true;
+}
+
+size_t GetCommittedHeapSize() { return heap_committed_size; }
+
+void SetCommittedHeapSize(size_t committed_size) {
+  heap_committed_size = committed_size;
+}
+
+}  // namespace primitives
+}  // namespace asylo
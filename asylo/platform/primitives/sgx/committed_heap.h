@@ -0,0 +1,55 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_SGX_COMMITTED_HEAP_H_
+#define ASYLO_PLATFORM_PRIMITIVES_SGX_COMMITTED_HEAP_H_
+
+#include <cstddef>
+
+namespace asylo {
+namespace primitives {
+
+// Tracks the part of the enclave heap that is backed by EPC pages. Without
+// EDMM the whole heap is added when the enclave is loaded. With EDMM only the
+// initial heap is, and the rest is added and trimmed on demand through the SGX
+// trusted runtime's apply_EPC_pages() and trim_EPC_pages().
+
+// Starts tracking the heap at |base|, of which the first |committed_size|
+// bytes are backed. The heap is never trimmed below |min_size| bytes. Pages
+// are only added or trimmed if |edmm_supported|.
+void InitCommittedHeap(void *base, size_t min_size, size_t committed_size,
+                       bool edmm_supported);
+
+// Adds or trims EPC pages at the end of the heap so that at least
+// |heap_size| bytes are backed, and trimmed pages are not. Returns false if
+// pages could not be added.
+bool ResizeCommittedHeap(size_t heap_size);
+
+// Returns the number of bytes at the start of the heap that are backed.
+size_t GetCommittedHeapSize();
+
+// Overrides the number of bytes at the start of the heap that are backed,
+// without adding or trimming pages. Used after the bookkeeping has been
+// overwritten, as when fork restores the bss section of the parent.
+void SetCommittedHeapSize(size_t committed_size);
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_SGX_COMMITTED_HEAP_H_
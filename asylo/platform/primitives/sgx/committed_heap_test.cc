@@ -0,0 +1,140 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include "asylo/platform/primitives/sgx/committed_heap.h"
+
+#include <cstdint>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace {
+
+// A call to one of the stubbed EDMM functions.
+struct PageCall {
+  uintptr_t start_address;
+  size_t page_number;
+
+  bool operator==(const PageCall &other) const {
+    return start_address == other.start_address &&
+           page_number == other.page_number;
+  }
+};
+
+std::vector<PageCall> applied_pages;
+std::vector<PageCall> trimmed_pages;
+int apply_result = 0;
+int trim_result = 0;
+
+}  // namespace
+
+// Stubs of the SGX trusted runtime functions that add and trim EPC pages.
+extern "C" int apply_EPC_pages(void *start_address, size_t page_number) {
+  applied_pages.push_back(
+      {reinterpret_cast<uintptr_t>(start_address), page_number});
+  return apply_result;
+}
+
+extern "C" int trim_EPC_pages(void *start_address, size_t page_number) {
+  trimmed_pages.push_back(
+      {reinterpret_cast<uintptr_t>(start_address), page_number});
+  return trim_result;
+}
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+constexpr uintptr_t kHeapBase = 0x100000;
+constexpr size_t kPageSize = 4096;
+
+class CommittedHeapTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    applied_pages.clear();
+    trimmed_pages.clear();
+    apply_result = 0;
+    trim_result = 0;
+    InitCommittedHeap(reinterpret_cast<void *>(kHeapBase),
+                      /*min_size=*/2 * kPageSize,
+                      /*committed_size=*/4 * kPageSize,
+                      /*edmm_supported=*/true);
+  }
+};
+
+TEST_F(CommittedHeapTest, StartsAtTheInitialHeap) {
+  EXPECT_EQ(GetCommittedHeapSize(), 4 * kPageSize);
+  EXPECT_TRUE(ResizeCommittedHeap(4 * kPageSize));
+  EXPECT_TRUE(ResizeCommittedHeap(3 * kPageSize + 1));
+  EXPECT_THAT(applied_pages, IsEmpty());
+  EXPECT_THAT(trimmed_pages, IsEmpty());
+}
+
+TEST_F(CommittedHeapTest, AddsPagesPastTheCommittedHeap) {
+  EXPECT_TRUE(ResizeCommittedHeap(6 * kPageSize + 1));
+  EXPECT_THAT(applied_pages,
+              ElementsAre(PageCall{kHeapBase + 4 * kPageSize, 3}));
+  EXPECT_EQ(GetCommittedHeapSize(), 7 * kPageSize);
+}
+
+TEST_F(CommittedHeapTest, FailsIfPagesCannotBeAdded) {
+  apply_result = -1;
+  EXPECT_FALSE(ResizeCommittedHeap(5 * kPageSize));
+  EXPECT_EQ(GetCommittedHeapSize(), 4 * kPageSize);
+}
+
+TEST_F(CommittedHeapTest, TrimsDownToTheMinimumHeap) {
+  EXPECT_TRUE(ResizeCommittedHeap(0));
+  EXPECT_THAT(trimmed_pages,
+              ElementsAre(PageCall{kHeapBase + 2 * kPageSize, 2}));
+  EXPECT_EQ(GetCommittedHeapSize(), 2 * kPageSize);
+}
+
+TEST_F(CommittedHeapTest, KeepsPagesIfTrimFails) {
+  trim_result = -1;
+  EXPECT_TRUE(ResizeCommittedHeap(kPageSize));
+  EXPECT_EQ(GetCommittedHeapSize(), 4 * kPageSize);
+}
+
+TEST_F(CommittedHeapTest, SetCommittedHeapSizeDoesNotTouchPages) {
+  SetCommittedHeapSize(8 * kPageSize);
+  EXPECT_EQ(GetCommittedHeapSize(), 8 * kPageSize);
+  EXPECT_TRUE(ResizeCommittedHeap(9 * kPageSize));
+  EXPECT_THAT(applied_pages,
+              ElementsAre(PageCall{kHeapBase + 8 * kPageSize, 1}));
+}
+
+TEST_F(CommittedHeapTest, NeverCallsEdmmWithoutIt) {
+  InitCommittedHeap(reinterpret_cast<void *>(kHeapBase),
+                    /*min_size=*/16 * kPageSize,
+                    /*committed_size=*/16 * kPageSize,
+                    /*edmm_supported=*/false);
+  EXPECT_TRUE(ResizeCommittedHeap(0));
+  EXPECT_TRUE(ResizeCommittedHeap(32 * kPageSize));
+  EXPECT_THAT(applied_pages, IsEmpty());
+  EXPECT_THAT(trimmed_pages, IsEmpty());
+}
+
+}  // namespace
+}  // namespace primitives
+}  // namespace asylo
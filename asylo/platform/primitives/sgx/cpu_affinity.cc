@@ -0,0 +1,152 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/sgx/cpu_affinity.h"
+
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <fstream>
+#include <string>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
+#include "asylo/util/posix_error_space.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+constexpr char kNumaNodeDirectory[] = "/sys/devices/system/node";
+
+// Reads the first line of the sysfs file at |path|.
+StatusOr<std::string> ReadSysfsLine(const std::string &path) {
+  std::ifstream file(path);
+  std::string line;
+  if (!file || !std::getline(file, line)) {
+    return Status(error::GoogleError::NOT_FOUND,
+                  absl::StrCat("Failed to read ", path));
+  }
+  return line;
+}
+
+}  // namespace
+
+StatusOr<CpuAffinity> CpuAffinity::Create(
+    const SgxLoadConfig::CpuAffinityConfig &config) {
+  CpuAffinity affinity;
+  if (config.cpus_size() > 0) {
+    affinity.cpus_.assign(config.cpus().begin(), config.cpus().end());
+  } else if (config.numa_node() >= 0) {
+    std::string cpu_list;
+    ASYLO_ASSIGN_OR_RETURN(
+        cpu_list, ReadSysfsLine(absl::StrCat(kNumaNodeDirectory, "/node",
+                                             config.numa_node(), "/cpulist")));
+    ASYLO_ASSIGN_OR_RETURN(affinity.cpus_, ParseCpuList(cpu_list));
+    affinity.numa_node_ = config.numa_node();
+  }
+  for (int cpu : affinity.cpus_) {
+    if (cpu >= CPU_SETSIZE) {
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    absl::StrCat("CPU ", cpu, " is out of range"));
+    }
+  }
+  return affinity;
+}
+
+StatusOr<std::vector<int>> CpuAffinity::ParseCpuList(absl::string_view list) {
+  std::vector<int> cpus;
+  for (absl::string_view range :
+       absl::StrSplit(absl::StripAsciiWhitespace(list), ',',
+                      absl::SkipEmpty())) {
+    size_t dash = range.find('-');
+    int first;
+    int last;
+    if (!absl::SimpleAtoi(range.substr(0, dash), &first) ||
+        !absl::SimpleAtoi(
+            dash == absl::string_view::npos ? range : range.substr(dash + 1),
+            &last) ||
+        first < 0 || last < first) {
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    absl::StrCat("Malformed CPU list: ", list));
+    }
+    for (int cpu = first; cpu <= last; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+int CpuAffinity::NumNumaNodes() {
+  auto node_list = ReadSysfsLine(absl::StrCat(kNumaNodeDirectory, "/online"));
+  if (!node_list.ok()) {
+    return 1;
+  }
+  auto nodes = ParseCpuList(node_list.ValueOrDie());
+  if (!nodes.ok() || nodes.ValueOrDie().empty()) {
+    return 1;
+  }
+  return *std::max_element(nodes.ValueOrDie().begin(),
+                           nodes.ValueOrDie().end()) +
+         1;
+}
+
+Status CpuAffinity::ApplyToCurrentThread() const {
+  if (cpus_.empty()) {
+    return Status::OkStatus();
+  }
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu : cpus_) {
+    CPU_SET(cpu, &cpu_set);
+  }
+  int result = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set),
+                                      &cpu_set);
+  if (result != 0) {
+    return Status(static_cast<error::PosixError>(result),
+                  "Failed to set thread CPU affinity");
+  }
+  if (numa_node_ >= 0) {
+    // Preferring a node, unlike binding to it, still falls back to other
+    // nodes when the preferred one runs out of memory.
+    unsigned long node_mask[4] = {0};
+    constexpr int kBitsPerWord = 8 * sizeof(node_mask[0]);
+    if (numa_node_ >= kBitsPerWord * 4) {
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    absl::StrCat("NUMA node ", numa_node_, " is out of range"));
+    }
+    node_mask[numa_node_ / kBitsPerWord] = 1UL << (numa_node_ % kBitsPerWord);
+    if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, node_mask,
+                kBitsPerWord * 4 + 1) != 0) {
+      return Status(static_cast<error::PosixError>(errno),
+                    "Failed to set thread memory policy");
+    }
+  }
+  return Status::OkStatus();
+}
+
+}  // namespace primitives
+}  // namespace asylo
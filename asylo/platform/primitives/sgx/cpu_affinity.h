@@ -0,0 +1,73 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_SGX_CPU_AFFINITY_H_
+#define ASYLO_PLATFORM_PRIMITIVES_SGX_CPU_AFFINITY_H_
+
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "asylo/platform/primitives/sgx/loader.pb.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+namespace primitives {
+
+// The host CPUs, and optionally the NUMA node, that the untrusted threads
+// serving an enclave run on. A default-constructed CpuAffinity places no
+// restriction on threads.
+class CpuAffinity {
+ public:
+  CpuAffinity() = default;
+
+  // Creates the placement described by |config|. Resolves |config.numa_node|
+  // to the CPUs of that node.
+  static StatusOr<CpuAffinity> Create(
+      const SgxLoadConfig::CpuAffinityConfig &config);
+
+  // Parses a CPU or node list in the format used by sysfs, such as "0-3,8".
+  static StatusOr<std::vector<int>> ParseCpuList(absl::string_view list);
+
+  // Returns the number of NUMA nodes of the host, which is 1 if the host does
+  // not report any.
+  static int NumNumaNodes();
+
+  // Returns true if threads are not restricted.
+  bool empty() const { return cpus_.empty(); }
+
+  // Returns the CPUs threads are pinned to.
+  const std::vector<int> &cpus() const { return cpus_; }
+
+  // Returns the NUMA node threads prefer allocating memory on, or -1 if none.
+  int numa_node() const { return numa_node_; }
+
+  // Pins the calling thread to cpus(). If numa_node() is set, also makes the
+  // thread prefer that node for the pages it faults in, which covers the
+  // untrusted buffers the enclave allocates and first touches on the thread.
+  Status ApplyToCurrentThread() const;
+
+ private:
+  std::vector<int> cpus_;
+  int numa_node_ = -1;
+};
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_SGX_CPU_AFFINITY_H_
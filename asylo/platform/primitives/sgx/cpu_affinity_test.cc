@@ -0,0 +1,86 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/sgx/cpu_affinity.h"
+
+#include <sched.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "asylo/test/util/status_matchers.h"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::Ge;
+using ::testing::IsEmpty;
+
+TEST(CpuAffinityTest, ParsesCpuLists) {
+  EXPECT_THAT(CpuAffinity::ParseCpuList("0-3,8,10-11\n"),
+              IsOkAndHolds(ElementsAre(0, 1, 2, 3, 8, 10, 11)));
+  EXPECT_THAT(CpuAffinity::ParseCpuList("5"), IsOkAndHolds(ElementsAre(5)));
+  EXPECT_THAT(CpuAffinity::ParseCpuList(""), IsOkAndHolds(IsEmpty()));
+}
+
+TEST(CpuAffinityTest, RejectsMalformedCpuLists) {
+  EXPECT_THAT(CpuAffinity::ParseCpuList("3-1"),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  EXPECT_THAT(CpuAffinity::ParseCpuList("a,1"),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  EXPECT_THAT(CpuAffinity::ParseCpuList("1-"),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+TEST(CpuAffinityTest, EmptyConfigDoesNotRestrictThreads) {
+  auto affinity = CpuAffinity::Create(SgxLoadConfig::CpuAffinityConfig());
+  ASYLO_ASSERT_OK(affinity);
+  EXPECT_TRUE(affinity.ValueOrDie().empty());
+  EXPECT_EQ(affinity.ValueOrDie().numa_node(), -1);
+  ASYLO_EXPECT_OK(affinity.ValueOrDie().ApplyToCurrentThread());
+}
+
+TEST(CpuAffinityTest, PinsThreadToCpus) {
+  cpu_set_t original;
+  ASSERT_EQ(sched_getaffinity(0, sizeof(original), &original), 0);
+  int cpu = 0;
+  while (!CPU_ISSET(cpu, &original)) {
+    cpu++;
+  }
+
+  SgxLoadConfig::CpuAffinityConfig config;
+  config.add_cpus(cpu);
+  auto affinity = CpuAffinity::Create(config);
+  ASYLO_ASSERT_OK(affinity);
+  ASYLO_ASSERT_OK(affinity.ValueOrDie().ApplyToCurrentThread());
+
+  cpu_set_t pinned;
+  ASSERT_EQ(sched_getaffinity(0, sizeof(pinned), &pinned), 0);
+  EXPECT_EQ(CPU_COUNT(&pinned), 1);
+  EXPECT_TRUE(CPU_ISSET(cpu, &pinned));
+  ASSERT_EQ(sched_setaffinity(0, sizeof(original), &original), 0);
+}
+
+TEST(CpuAffinityTest, CountsNumaNodes) {
+  EXPECT_THAT(CpuAffinity::NumNumaNodes(), Ge(1));
+}
+
+}  // namespace
+}  // namespace primitives
+}  // namespace asylo
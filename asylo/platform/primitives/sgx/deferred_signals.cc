@@ -0,0 +1,120 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/sgx/deferred_signals.h"
+
+#include <errno.h>
+#include <signal.h>
+
+#include <chrono>
+#include <thread>
+
+#include "absl/memory/memory.h"
+#include "asylo/platform/primitives/primitives.h"
+#include "asylo/platform/primitives/util/message.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+// Time the delivery thread leaves enclave threads to pick up a newly pending
+// signal before it enters the enclave to deliver it.
+constexpr std::chrono::microseconds kDeliveryGracePeriod(1000);
+
+}  // namespace
+
+bool IsImmediateSignal(int signum, int sigcode) {
+  switch (signum) {
+    // Raised by the faulting instruction, typically as an exception.
+    case SIGSEGV:
+    case SIGBUS:
+    case SIGFPE:
+    case SIGILL:
+    case SIGTRAP:
+    case SIGSYS:
+    // Terminate the process by default.
+    case SIGABRT:
+    case SIGTERM:
+    case SIGINT:
+    case SIGQUIT:
+    case SIGHUP:
+      return true;
+    default:
+      // Queued signals carry a value per instance and must not be coalesced.
+      return sigcode == SI_QUEUE || signum > PendingSignalSet::kMaxSignal;
+  }
+}
+
+DeferredSignalDelivery::DeferredSignalDelivery(Client *client)
+    : client_(client),
+      pending_signals_(absl::make_unique<PendingSignalSet>()),
+      stopped_(false) {
+  sem_init(&wakeup_, /*pshared=*/0, /*value=*/0);
+  thread_ = absl::make_unique<Thread>(&DeferredSignalDelivery::Run, this);
+}
+
+DeferredSignalDelivery::~DeferredSignalDelivery() {
+  Stop();
+  sem_destroy(&wakeup_);
+}
+
+bool DeferredSignalDelivery::Post(int signum) {
+  if (!PendingSignalSet::Bit(signum) ||
+      stopped_.load(std::memory_order_acquire)) {
+    return false;
+  }
+  // Only a signal that was not pending yet needs a delivery. sem_post() is
+  // async-signal-safe.
+  if (pending_signals_->Add(signum)) {
+    sem_post(&wakeup_);
+  }
+  return true;
+}
+
+void DeferredSignalDelivery::Stop() {
+  if (stopped_.exchange(true, std::memory_order_acq_rel)) {
+    return;
+  }
+  sem_post(&wakeup_);
+  thread_->Join();
+}
+
+void DeferredSignalDelivery::Run() {
+  while (!stopped_.load(std::memory_order_acquire)) {
+    if (sem_wait(&wakeup_) != 0) {
+      continue;
+    }
+    std::this_thread::sleep_for(kDeliveryGracePeriod);
+    if (stopped_.load(std::memory_order_acquire) ||
+        !pending_signals_->HasPending()) {
+      continue;
+    }
+    MessageReader output;
+    Status status =
+        client_->EnclaveCall(kSelectorAsyloDeliverPendingSignals, nullptr,
+                             &output);
+    if (!status.ok()) {
+      LOG(ERROR) << "Failed to deliver pending signals: " << status;
+    }
+  }
+}
+
+}  // namespace primitives
+}  // namespace asylo
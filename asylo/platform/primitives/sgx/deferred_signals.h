@@ -0,0 +1,89 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_SGX_DEFERRED_SIGNALS_H_
+#define ASYLO_PLATFORM_PRIMITIVES_SGX_DEFERRED_SIGNALS_H_
+
+#include <semaphore.h>
+
+#include <atomic>
+#include <memory>
+
+#include "asylo/platform/primitives/sgx/pending_signals.h"
+#include "asylo/platform/primitives/untrusted_primitives.h"
+#include "asylo/util/thread.h"
+
+namespace asylo {
+namespace primitives {
+
+// Returns true if the host signal |signum| with code |sigcode| must be
+// delivered to the enclave immediately rather than deferred. This is the case
+// for signals raised synchronously by the faulting instruction, and for
+// signals that terminate the process by default and so may not wait for the
+// enclave to pick them up.
+bool IsImmediateSignal(int signum, int sigcode);
+
+// Untrusted side of deferred signal delivery. Asynchronous host signals are
+// marked in a PendingSignalSet shared with the enclave instead of each
+// entering the enclave. Enclave threads run the handlers of pending signals at
+// their next enclave entry or exit. If no enclave thread does so within a
+// short grace period, for instance because the enclave is idle, a delivery
+// thread enters the enclave once to run them.
+class DeferredSignalDelivery {
+ public:
+  // Starts the delivery thread for the enclave of |client|, which must outlive
+  // this object. The pending signal set is not drained by the enclave until it
+  // is registered with kSelectorAsyloInitPendingSignals.
+  explicit DeferredSignalDelivery(Client *client);
+
+  // Stops the delivery thread.
+  ~DeferredSignalDelivery();
+
+  DeferredSignalDelivery(const DeferredSignalDelivery &other) = delete;
+  DeferredSignalDelivery &operator=(const DeferredSignalDelivery &other) =
+      delete;
+
+  // Returns the pending signal set drained by the enclave.
+  PendingSignalSet *pending_signals() { return pending_signals_.get(); }
+
+  // Marks the host signal |signum| pending, coalescing it with a pending
+  // instance of the same signal. Returns false if |signum| cannot be deferred.
+  // Async-signal-safe.
+  bool Post(int signum);
+
+  // Stops deferring signals and joins the delivery thread. Signals that are
+  // still pending are left to the enclave. Does nothing if already stopped.
+  void Stop();
+
+ private:
+  // Body of the delivery thread.
+  void Run();
+
+  Client *const client_;
+  const std::unique_ptr<PendingSignalSet> pending_signals_;
+
+  // Posted once for each signal newly marked pending, and to stop the thread.
+  sem_t wakeup_;
+  std::atomic<bool> stopped_;
+  std::unique_ptr<Thread> thread_;
+};
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_SGX_DEFERRED_SIGNALS_H_
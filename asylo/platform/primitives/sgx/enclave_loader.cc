@@ -18,12 +18,15 @@
 
 #include "asylo/platform/primitives/enclave_loader.h"
 
+#include <memory>
+
 #include "asylo/enclave.pb.h"
 #include "asylo/platform/primitives/sgx/loader.pb.h"
 #include "asylo/platform/primitives/sgx/untrusted_sgx.h"
 #include "asylo/platform/primitives/untrusted_primitives.h"
 #include "asylo/platform/primitives/util/dispatch_table.h"
 #include "asylo/platform/primitives/util/exit_log.h"
+#include "asylo/platform/primitives/util/exit_metrics.h"
 #include "asylo/util/status.h"
 #include "asylo/util/status_macros.h"
 #include "asylo/util/statusor.h"
@@ -51,7 +54,9 @@ StatusOr<std::shared_ptr<Client>> LoadEnclave(
   bool is_embedded_enclave = sgx_config.has_embedded_enclave_config();
   bool is_file_enclave = sgx_config.has_file_enclave_config();
   auto exit_call_provider = absl::make_unique<LoggingDispatchTable>(
-      /*enable_logging=*/load_config.exit_logging());
+      /*enable_logging=*/load_config.exit_logging(),
+      /*metrics=*/load_config.exit_metrics() ? std::make_shared<ExitMetrics>()
+                                             : nullptr);
 
   if (is_embedded_enclave) {
     std::string section_name =
@@ -72,6 +77,77 @@ StatusOr<std::shared_ptr<Client>> LoadEnclave(
     return Status(error::GoogleError::INVALID_ARGUMENT,
                   "SGX enclave source not set");
   }
+
+  ASYLO_RETURN_IF_ERROR(
+      std::static_pointer_cast<SgxEnclaveClient>(primitive_client)
+          ->EnableDeferredSignals());
+  ASYLO_RETURN_IF_ERROR(
+      std::static_pointer_cast<SgxEnclaveClient>(primitive_client)
+          ->RegisterThreadStats());
+
+  if (sgx_config.has_hugepage_arena_config()) {
+    ASYLO_RETURN_IF_ERROR(
+        std::static_pointer_cast<SgxEnclaveClient>(primitive_client)
+            ->EnableHugepageArena(sgx_config.hugepage_arena_config()));
+  }
+
+  if (sgx_config.has_host_info_cache_config()) {
+    ASYLO_RETURN_IF_ERROR(
+        std::static_pointer_cast<SgxEnclaveClient>(primitive_client)
+            ->EnableHostInfoCache(sgx_config.host_info_cache_config()));
+  }
+
+  if (sgx_config.has_cpu_affinity_config()) {
+    ASYLO_RETURN_IF_ERROR(
+        std::static_pointer_cast<SgxEnclaveClient>(primitive_client)
+            ->SetCpuAffinity(sgx_config.cpu_affinity_config()));
+  }
+
+  if (sgx_config.has_host_time_config()) {
+    ASYLO_RETURN_IF_ERROR(
+        std::static_pointer_cast<SgxEnclaveClient>(primitive_client)
+            ->EnableHostTimePage(sgx_config.host_time_config()));
+  }
+
+  if (sgx_config.has_trace_config()) {
+    ASYLO_RETURN_IF_ERROR(
+        std::static_pointer_cast<SgxEnclaveClient>(primitive_client)
+            ->EnableTracing(sgx_config.trace_config()));
+  }
+
+  if (sgx_config.has_profiler_config()) {
+    ASYLO_RETURN_IF_ERROR(
+        std::static_pointer_cast<SgxEnclaveClient>(primitive_client)
+            ->StartProfiling(sgx_config.profiler_config()));
+  }
+
+  if (sgx_config.has_exit_profiler_config()) {
+    ASYLO_RETURN_IF_ERROR(
+        std::static_pointer_cast<SgxEnclaveClient>(primitive_client)
+            ->StartExitProfiling(sgx_config.exit_profiler_config()));
+  }
+
+  if (sgx_config.has_switchless_config()) {
+    const auto &switchless_config = sgx_config.switchless_config();
+    auto sgx_client =
+        std::static_pointer_cast<SgxEnclaveClient>(primitive_client);
+    if (switchless_config.ocall_selectors_size() > 0) {
+      ASYLO_RETURN_IF_ERROR(
+          sgx_client->EnableSwitchlessOcalls(switchless_config));
+    }
+    if (switchless_config.ecall_selectors_size() > 0) {
+      ASYLO_RETURN_IF_ERROR(
+          sgx_client->EnableSwitchlessEcalls(switchless_config));
+    }
+  }
+
+  // Green threads post their blocking exit calls to the switchless queue, so
+  // thread parking is enabled once switchless exit calls are.
+  if (sgx_config.has_thread_parking_config()) {
+    ASYLO_RETURN_IF_ERROR(
+        std::static_pointer_cast<SgxEnclaveClient>(primitive_client)
+            ->EnableThreadParking(sgx_config.thread_parking_config()));
+  }
   return std::move(primitive_client);
 }
 
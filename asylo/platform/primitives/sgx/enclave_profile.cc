@@ -0,0 +1,200 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/sgx/enclave_profile.h"
+
+#include <algorithm>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "asylo/platform/system_call/metadata.h"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+// FNV-1a over the frames of a stack, never zero so that zero marks free
+// entries.
+uint64_t HashFrames(const uint64_t *frames, size_t depth) {
+  uint64_t hash = 0xcbf29ce484222325;
+  for (size_t i = 0; i < depth; i++) {
+    hash = (hash ^ frames[i]) * 0x100000001b3;
+  }
+  return hash ? hash : 1;
+}
+
+// Names the exit of an ExitSample.
+std::string ExitName(uint64_t exit) {
+  if ((exit & kExitProfileSyscallBit) == 0) {
+    return absl::StrCat("exit:", exit);
+  }
+  int sysno = static_cast<int>(exit & ~kExitProfileSyscallBit);
+  system_call::SystemCallDescriptor descriptor(sysno);
+  if (!descriptor.is_valid()) {
+    return absl::StrCat("syscall:", sysno);
+  }
+  return absl::StrCat("syscall:", descriptor.name());
+}
+
+void AppendWord(uint64_t word, std::string *out) {
+  out->append(reinterpret_cast<const char *>(&word), sizeof(word));
+}
+
+}  // namespace
+
+StackProfile::StackProfile(size_t capacity)
+    : entries_(new Entry[capacity]()), capacity_(capacity), dropped_(0) {}
+
+bool StackProfile::Add(const uint64_t *frames, size_t depth) {
+  depth = std::min(depth, kMaxProfileDepth);
+  uint64_t hash = HashFrames(frames, depth);
+  for (size_t probe = 0; probe < capacity_; probe++) {
+    Entry &entry = entries_[(hash + probe) % capacity_];
+    if (entry.hash == 0) {
+      entry.hash = hash;
+      entry.count = 1;
+      entry.depth = depth;
+      std::copy(frames, frames + depth, entry.frames);
+      return true;
+    }
+    if (entry.hash == hash && entry.depth == depth &&
+        std::equal(frames, frames + depth, entry.frames)) {
+      entry.count++;
+      return true;
+    }
+  }
+  dropped_++;
+  return false;
+}
+
+std::vector<ProfileSample> StackProfile::Take() {
+  std::vector<ProfileSample> samples;
+  for (size_t i = 0; i < capacity_; i++) {
+    Entry &entry = entries_[i];
+    if (entry.hash == 0) {
+      continue;
+    }
+    samples.push_back(ProfileSample{
+        entry.count,
+        std::vector<uint64_t>(entry.frames, entry.frames + entry.depth)});
+    entry.hash = 0;
+  }
+  dropped_ = 0;
+  return samples;
+}
+
+ExitProfile::ExitProfile(size_t capacity)
+    : entries_(new Entry[capacity]()), capacity_(capacity), dropped_(0) {}
+
+bool ExitProfile::Add(uint64_t exit, const uint64_t *frames, size_t depth,
+                      uint64_t nanos) {
+  depth = std::min(depth, kMaxProfileDepth);
+  uint64_t hash = HashFrames(frames, depth);
+  hash = (hash ^ exit) * 0x100000001b3;
+  hash = hash ? hash : 1;
+  for (size_t probe = 0; probe < capacity_; probe++) {
+    Entry &entry = entries_[(hash + probe) % capacity_];
+    if (entry.hash == 0) {
+      entry.hash = hash;
+      entry.exit = exit;
+      entry.count = 1;
+      entry.nanos = nanos;
+      entry.depth = depth;
+      std::copy(frames, frames + depth, entry.frames);
+      return true;
+    }
+    if (entry.hash == hash && entry.exit == exit && entry.depth == depth &&
+        std::equal(frames, frames + depth, entry.frames)) {
+      entry.count++;
+      entry.nanos += nanos;
+      return true;
+    }
+  }
+  dropped_++;
+  return false;
+}
+
+std::vector<ExitSample> ExitProfile::Take() {
+  std::vector<ExitSample> samples;
+  for (size_t i = 0; i < capacity_; i++) {
+    Entry &entry = entries_[i];
+    if (entry.hash == 0) {
+      continue;
+    }
+    samples.push_back(ExitSample{
+        entry.exit, entry.count, entry.nanos,
+        std::vector<uint64_t>(entry.frames, entry.frames + entry.depth)});
+    entry.hash = 0;
+  }
+  dropped_ = 0;
+  return samples;
+}
+
+std::string FormatFoldedExitStacks(
+    const std::vector<ExitSample> &samples, bool weigh_by_time,
+    const std::function<std::string(uint64_t frame)> &symbolize) {
+  std::string folded;
+  for (const ExitSample &sample : samples) {
+    uint64_t weight = weigh_by_time ? sample.nanos : sample.count;
+    if (weight == 0) {
+      continue;
+    }
+    std::vector<std::string> names;
+    for (auto frame = sample.frames.rbegin(); frame != sample.frames.rend();
+         ++frame) {
+      names.push_back(symbolize(*frame));
+    }
+    names.push_back(ExitName(sample.exit));
+    absl::StrAppend(&folded, absl::StrJoin(names, ";"), " ", weight, "\n");
+  }
+  return folded;
+}
+
+std::string SerializeCpuProfile(const std::vector<ProfileSample> &samples,
+                                uint64_t sampling_period_us,
+                                uint64_t code_size, absl::string_view path) {
+  std::string profile;
+  // Header: header words, version, sampling period and padding.
+  AppendWord(0, &profile);
+  AppendWord(3, &profile);
+  AppendWord(0, &profile);
+  AppendWord(sampling_period_us, &profile);
+  AppendWord(0, &profile);
+  for (const ProfileSample &sample : samples) {
+    if (sample.frames.empty()) {
+      continue;
+    }
+    AppendWord(sample.count, &profile);
+    AppendWord(sample.frames.size(), &profile);
+    for (uint64_t frame : sample.frames) {
+      AppendWord(frame, &profile);
+    }
+  }
+  // Trailer, followed by the memory map used for symbolization.
+  AppendWord(0, &profile);
+  AppendWord(1, &profile);
+  AppendWord(0, &profile);
+  absl::StrAppend(&profile, absl::StrFormat("%08x-%08x r-xp 00000000 00:00 0",
+                                            0, code_size),
+                  " ", path, "\n");
+  return profile;
+}
+
+}  // namespace primitives
+}  // namespace asylo
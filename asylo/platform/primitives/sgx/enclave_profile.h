@@ -0,0 +1,150 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_SGX_ENCLAVE_PROFILE_H_
+#define ASYLO_PLATFORM_PRIMITIVES_SGX_ENCLAVE_PROFILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+
+namespace asylo {
+namespace primitives {
+
+// Maximum number of frames recorded for a sampled stack.
+constexpr size_t kMaxProfileDepth = 32;
+
+// A sampled call stack and the number of times it was sampled. Frames are
+// return addresses relative to the enclave base, innermost first.
+struct ProfileSample {
+  uint64_t count;
+  std::vector<uint64_t> frames;
+};
+
+// Fixed-capacity table counting samples per distinct call stack, filled by the
+// trusted profiler. Allocates only when constructed, so that samples can be
+// recorded from a signal handler. Not thread-safe.
+class StackProfile {
+ public:
+  explicit StackProfile(size_t capacity);
+
+  StackProfile(const StackProfile &other) = delete;
+  StackProfile &operator=(const StackProfile &other) = delete;
+
+  // Counts a sample of the stack |frames|, truncated to kMaxProfileDepth
+  // frames. Returns false and counts the sample as dropped if the table has no
+  // room for a new stack.
+  bool Add(const uint64_t *frames, size_t depth);
+
+  // Returns the recorded samples and clears the table.
+  std::vector<ProfileSample> Take();
+
+  // Returns the number of samples dropped since the last call to Take().
+  uint64_t dropped() const { return dropped_; }
+
+ private:
+  struct Entry {
+    uint64_t hash;
+    uint64_t count;
+    size_t depth;
+    uint64_t frames[kMaxProfileDepth];
+  };
+
+  std::unique_ptr<Entry[]> entries_;
+  size_t capacity_;
+  uint64_t dropped_;
+};
+
+// Bit set in the exit of an ExitSample recorded for a system call, whose
+// number is in the low bits. Exits without it are exit call selectors.
+constexpr uint64_t kExitProfileSyscallBit = uint64_t{1} << 63;
+
+// A trusted call stack that left the enclave, how many times it left on a
+// given exit, and the time spent outside the enclave on those exits. Frames
+// are return addresses relative to the enclave base, innermost first.
+struct ExitSample {
+  uint64_t exit;
+  uint64_t count;
+  uint64_t nanos;
+  std::vector<uint64_t> frames;
+};
+
+// Fixed-capacity table aggregating exits per exit and distinct call stack,
+// filled by the trusted exit profiler. Allocates only when constructed, so
+// recording an exit makes no allocations. Not thread-safe.
+class ExitProfile {
+ public:
+  explicit ExitProfile(size_t capacity);
+
+  ExitProfile(const ExitProfile &other) = delete;
+  ExitProfile &operator=(const ExitProfile &other) = delete;
+
+  // Counts an exit |exit| from the stack |frames|, truncated to
+  // kMaxProfileDepth frames, which spent |nanos| outside the enclave. Returns
+  // false and counts the exit as dropped if the table has no room for a new
+  // stack.
+  bool Add(uint64_t exit, const uint64_t *frames, size_t depth,
+           uint64_t nanos);
+
+  // Returns the recorded exits and clears the table.
+  std::vector<ExitSample> Take();
+
+  // Returns the number of exits dropped since the last call to Take().
+  uint64_t dropped() const { return dropped_; }
+
+ private:
+  struct Entry {
+    uint64_t hash;
+    uint64_t exit;
+    uint64_t count;
+    uint64_t nanos;
+    size_t depth;
+    uint64_t frames[kMaxProfileDepth];
+  };
+
+  std::unique_ptr<Entry[]> entries_;
+  size_t capacity_;
+  uint64_t dropped_;
+};
+
+// Formats |samples| as folded stacks, as read by flamegraph.pl, with one line
+// per sample listing its frames outermost first, then its exit, separated by
+// semicolons, followed by its count, or by its time in nanoseconds if
+// |weigh_by_time|. Frames are named by |symbolize|, and exits are named
+// "syscall:<name>" for system calls and "exit:<selector>" otherwise.
+std::string FormatFoldedExitStacks(
+    const std::vector<ExitSample> &samples, bool weigh_by_time,
+    const std::function<std::string(uint64_t frame)> &symbolize);
+
+// Serializes |samples| in the legacy binary CPU profile format read by pprof,
+// as written by gperftools. Frames are mapped to an executable region of
+// |code_size| bytes at address zero backed by the file at |path|, which is
+// how enclave-relative addresses are symbolized against the enclave binary.
+std::string SerializeCpuProfile(const std::vector<ProfileSample> &samples,
+                                uint64_t sampling_period_us,
+                                uint64_t code_size, absl::string_view path);
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_SGX_ENCLAVE_PROFILE_H_
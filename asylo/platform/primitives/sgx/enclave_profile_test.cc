@@ -0,0 +1,152 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/sgx/enclave_profile.h"
+
+#include <sys/syscall.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::Eq;
+using ::testing::SizeIs;
+using ::testing::UnorderedElementsAre;
+
+std::vector<uint64_t> Words(const std::string &profile, size_t count) {
+  std::vector<uint64_t> words(count);
+  memcpy(words.data(), profile.data(), count * sizeof(uint64_t));
+  return words;
+}
+
+TEST(StackProfileTest, CountsSamplesPerStack) {
+  StackProfile profile(16);
+  const uint64_t first[] = {0x10, 0x20, 0x30};
+  const uint64_t second[] = {0x10, 0x40};
+  EXPECT_TRUE(profile.Add(first, 3));
+  EXPECT_TRUE(profile.Add(second, 2));
+  EXPECT_TRUE(profile.Add(first, 3));
+
+  std::vector<ProfileSample> samples = profile.Take();
+  ASSERT_THAT(samples, SizeIs(2));
+  std::vector<uint64_t> counts = {samples[0].count, samples[1].count};
+  EXPECT_THAT(counts, UnorderedElementsAre(1, 2));
+  for (const ProfileSample &sample : samples) {
+    if (sample.count == 2) {
+      EXPECT_THAT(sample.frames, ElementsAre(0x10, 0x20, 0x30));
+    } else {
+      EXPECT_THAT(sample.frames, ElementsAre(0x10, 0x40));
+    }
+  }
+  EXPECT_THAT(profile.Take(), SizeIs(0));
+}
+
+TEST(StackProfileTest, DropsSamplesOnceFull) {
+  StackProfile profile(2);
+  const uint64_t stacks[][1] = {{1}, {2}, {3}};
+  EXPECT_TRUE(profile.Add(stacks[0], 1));
+  EXPECT_TRUE(profile.Add(stacks[1], 1));
+  EXPECT_FALSE(profile.Add(stacks[2], 1));
+  EXPECT_TRUE(profile.Add(stacks[0], 1));
+  EXPECT_THAT(profile.dropped(), Eq(1));
+
+  EXPECT_THAT(profile.Take(), SizeIs(2));
+  EXPECT_THAT(profile.dropped(), Eq(0));
+  EXPECT_TRUE(profile.Add(stacks[2], 1));
+}
+
+TEST(StackProfileTest, TruncatesDeepStacks) {
+  StackProfile profile(4);
+  std::vector<uint64_t> frames(kMaxProfileDepth + 8, 7);
+  EXPECT_TRUE(profile.Add(frames.data(), frames.size()));
+
+  std::vector<ProfileSample> samples = profile.Take();
+  ASSERT_THAT(samples, SizeIs(1));
+  EXPECT_THAT(samples[0].frames, SizeIs(kMaxProfileDepth));
+}
+
+TEST(ExitProfileTest, AggregatesExitsPerExitAndStack) {
+  ExitProfile profile(16);
+  const uint64_t stack[] = {0x10, 0x20};
+  EXPECT_TRUE(profile.Add(7, stack, 2, 100));
+  EXPECT_TRUE(profile.Add(7, stack, 2, 50));
+  EXPECT_TRUE(profile.Add(8, stack, 2, 10));
+
+  std::vector<ExitSample> samples = profile.Take();
+  ASSERT_THAT(samples, SizeIs(2));
+  for (const ExitSample &sample : samples) {
+    EXPECT_THAT(sample.frames, ElementsAre(0x10, 0x20));
+    if (sample.exit == 7) {
+      EXPECT_THAT(sample.count, Eq(2));
+      EXPECT_THAT(sample.nanos, Eq(150));
+    } else {
+      EXPECT_THAT(sample.exit, Eq(8));
+      EXPECT_THAT(sample.count, Eq(1));
+      EXPECT_THAT(sample.nanos, Eq(10));
+    }
+  }
+  EXPECT_THAT(profile.Take(), SizeIs(0));
+}
+
+TEST(ExitProfileTest, DropsExitsOnceFull) {
+  ExitProfile profile(1);
+  const uint64_t stack[] = {0x10};
+  EXPECT_TRUE(profile.Add(7, stack, 1, 0));
+  EXPECT_FALSE(profile.Add(8, stack, 1, 0));
+  EXPECT_THAT(profile.dropped(), Eq(1));
+}
+
+TEST(FormatFoldedExitStacksTest, ListsFramesOutermostFirst) {
+  std::vector<ExitSample> samples = {
+      {7, 3, 900, {0x10, 0x20}},
+      {kExitProfileSyscallBit | SYS_write, 2, 0, {0x30}},
+  };
+  auto symbolize = [](uint64_t frame) { return absl::StrCat("f", frame); };
+
+  EXPECT_THAT(FormatFoldedExitStacks(samples, false, symbolize),
+              Eq("f32;f16;exit:7 3\nf48;syscall:write 2\n"));
+  EXPECT_THAT(FormatFoldedExitStacks(samples, true, symbolize),
+              Eq("f32;f16;exit:7 900\n"));
+}
+
+TEST(SerializeCpuProfileTest, WritesLegacyFormat) {
+  std::vector<ProfileSample> samples = {{5, {0x1000, 0x2000}}};
+  std::string profile =
+      SerializeCpuProfile(samples, 10000, 0x80000, "/enclave.so");
+
+  constexpr size_t kWords = 5 + 4 + 3;
+  ASSERT_GT(profile.size(), kWords * sizeof(uint64_t));
+  EXPECT_THAT(Words(profile, kWords),
+              ElementsAre(0, 3, 0, 10000, 0, 5, 2, 0x1000, 0x2000, 0, 1, 0));
+  EXPECT_THAT(profile.substr(kWords * sizeof(uint64_t)),
+              Eq("00000000-00080000 r-xp 00000000 00:00 0 /enclave.so\n"));
+}
+
+}  // namespace
+}  // namespace primitives
+}  // namespace asylo
@@ -0,0 +1,69 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/sgx/epc_info.h"
+
+#include <cpuid.h>
+
+#include "asylo/util/status.h"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+// CPUID leaf enumerating SGX capabilities and EPC sections.
+constexpr unsigned int kSgxLeaf = 0x12;
+
+// First subleaf of |kSgxLeaf| describing an EPC section.
+constexpr unsigned int kFirstEpcSubleaf = 2;
+
+// Value of the sub-leaf type in bits 3:0 of EAX for a valid EPC section.
+constexpr unsigned int kEpcSectionType = 1;
+
+// Bit of EBX for CPUID leaf 7, subleaf 0, that is set if SGX is supported.
+constexpr unsigned int kSgxFeatureBit = 1u << 2;
+
+}  // namespace
+
+StatusOr<uint64_t> GetEpcSize() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) ||
+      !(ebx & kSgxFeatureBit) || __get_cpuid_max(0, nullptr) < kSgxLeaf) {
+    return Status(error::GoogleError::UNAVAILABLE,
+                  "The processor does not support SGX");
+  }
+
+  uint64_t size = 0;
+  for (unsigned int subleaf = kFirstEpcSubleaf;; ++subleaf) {
+    __cpuid_count(kSgxLeaf, subleaf, eax, ebx, ecx, edx);
+    if ((eax & 0xf) != kEpcSectionType) {
+      break;
+    }
+    // Bits 31:12 of the section size are in ECX 31:12, and bits 51:32 are in
+    // EDX 19:0.
+    size += (ecx & 0xfffff000) | (static_cast<uint64_t>(edx & 0xfffff) << 32);
+  }
+  if (size == 0) {
+    return Status(error::GoogleError::UNAVAILABLE,
+                  "The processor reports no EPC sections");
+  }
+  return size;
+}
+
+}  // namespace primitives
+}  // namespace asylo
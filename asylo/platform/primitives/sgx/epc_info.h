@@ -0,0 +1,38 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_SGX_EPC_INFO_H_
+#define ASYLO_PLATFORM_PRIMITIVES_SGX_EPC_INFO_H_
+
+#include <cstdint>
+
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+namespace primitives {
+
+// Returns the total size, in bytes, of the enclave page cache (EPC) sections
+// reported by the processor of the host. This is the EPC shared by every
+// enclave on the host, including enclaves of other processes. Returns an
+// UNAVAILABLE error if the processor does not support SGX.
+StatusOr<uint64_t> GetEpcSize();
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_SGX_EPC_INFO_H_
@@ -0,0 +1,63 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include "asylo/platform/primitives/sgx/epc_stats.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/optional.h"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+// Reads the unsigned integer in the driver parameter file |name| of
+// |directory|, or returns absl::nullopt if it cannot be read.
+absl::optional<uint64_t> ReadCounter(absl::string_view directory,
+                                     absl::string_view name) {
+  std::ifstream file(absl::StrCat(directory, "/", name));
+  std::string line;
+  uint64_t value;
+  if (!file || !std::getline(file, line) || !absl::SimpleAtoi(line, &value)) {
+    return absl::nullopt;
+  }
+  return value;
+}
+
+}  // namespace
+
+EpcPagingStats ReadEpcPagingStats() {
+  return ReadEpcPagingStatsFrom(kIsgxParametersDirectory);
+}
+
+EpcPagingStats ReadEpcPagingStatsFrom(absl::string_view directory) {
+  EpcPagingStats stats;
+  stats.total_pages = ReadCounter(directory, "sgx_nr_total_epc_pages");
+  stats.free_pages = ReadCounter(directory, "sgx_nr_free_pages");
+  stats.marked_old_pages = ReadCounter(directory, "sgx_nr_marked_old");
+  stats.loaded_back_pages = ReadCounter(directory, "sgx_loaded_back");
+  return stats;
+}
+
+}  // namespace primitives
+}  // namespace asylo
@@ -0,0 +1,42 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_SGX_EPC_STATS_H_
+#define ASYLO_PLATFORM_PRIMITIVES_SGX_EPC_STATS_H_
+
+#include "absl/strings/string_view.h"
+#include "asylo/platform/common/enclave_memory_stats.h"
+
+namespace asylo {
+namespace primitives {
+
+// Directory where the out-of-tree Intel SGX driver exposes its EPC counters.
+constexpr char kIsgxParametersDirectory[] = "/sys/module/isgx/parameters";
+
+// Reads the EPC counters of the host from the SGX driver. Counters the driver
+// does not expose are left absent, so this never fails.
+EpcPagingStats ReadEpcPagingStats();
+
+// Reads the EPC counters from the driver parameter files in |directory|.
+EpcPagingStats ReadEpcPagingStatsFrom(absl::string_view directory);
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_SGX_EPC_STATS_H_
@@ -0,0 +1,71 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include "asylo/platform/primitives/sgx/epc_stats.h"
+
+#include <stdlib.h>
+
+#include <fstream>
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/flags/flag.h"
+#include "absl/strings/str_cat.h"
+#include "asylo/test/util/test_flags.h"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Optional;
+
+void WriteFile(const std::string &path, const std::string &contents) {
+  std::ofstream file(path);
+  file << contents;
+}
+
+TEST(EpcStatsTest, ReadsDriverCounters) {
+  std::string directory =
+      absl::StrCat(absl::GetFlag(FLAGS_test_tmpdir), "/epc_stats_XXXXXX");
+  ASSERT_NE(mkdtemp(&directory[0]), nullptr);
+  WriteFile(absl::StrCat(directory, "/sgx_nr_total_epc_pages"), "23936\n");
+  WriteFile(absl::StrCat(directory, "/sgx_nr_free_pages"), "1024\n");
+  WriteFile(absl::StrCat(directory, "/sgx_loaded_back"), "77\n");
+  WriteFile(absl::StrCat(directory, "/sgx_nr_marked_old"), "not a number\n");
+
+  EpcPagingStats stats = ReadEpcPagingStatsFrom(directory);
+  EXPECT_THAT(stats.total_pages, Optional(Eq(23936)));
+  EXPECT_THAT(stats.free_pages, Optional(Eq(1024)));
+  EXPECT_THAT(stats.loaded_back_pages, Optional(Eq(77)));
+  EXPECT_FALSE(stats.marked_old_pages.has_value());
+}
+
+TEST(EpcStatsTest, MissingDriverLeavesCountersAbsent) {
+  EpcPagingStats stats = ReadEpcPagingStatsFrom("/nonexistent/isgx");
+  EXPECT_FALSE(stats.total_pages.has_value());
+  EXPECT_FALSE(stats.free_pages.has_value());
+  EXPECT_FALSE(stats.marked_old_pages.has_value());
+  EXPECT_FALSE(stats.loaded_back_pages.has_value());
+}
+
+}  // namespace
+}  // namespace primitives
+}  // namespace asylo
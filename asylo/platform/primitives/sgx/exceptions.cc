@@ -19,9 +19,17 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#include <algorithm>
+#include <atomic>
+
+#include "asylo/platform/common/enclave_thread_stats.h"
+#include "asylo/platform/posix/host_time.h"
+#include "asylo/platform/primitives/sgx/trusted_cpu_emulation.h"
 #include "include/sgx_cpuid.h"
 #include "include/sgx_trts_exception.h"
 
+namespace asylo {
+namespace primitives {
 namespace {
 
 // Handled opcodes
@@ -60,6 +68,51 @@ constexpr uint32_t CPUID_01H_EDX_SSE = 1 << 25;
 constexpr uint32_t CPUID_01H_EDX_SSE2 = 1 << 26;
 constexpr uint32_t CPUID_07H_EBX_RDSEED = 1 << 18;
 
+// CPUID leaf enumerating SGX capabilities, and the bit reporting SGX2 support.
+// SGX2 processors allow RDTSC inside enclaves.
+constexpr int kSgxCpuidLeaf = 0x12;
+constexpr uint32_t CPUID_12H_EAX_SGX2 = 1 << 1;
+
+// Whether RDTSC is believed to execute natively. Seeded from the CPUID report
+// of the host, which is untrusted; a trapping RDTSC clears it, so a false
+// report only costs one exception.
+std::atomic<bool> native_rdtsc_allowed{false};
+
+// Last value returned for an emulated RDTSC.
+std::atomic<uint64_t> last_emulated_timestamp{0};
+
+// Number of CPUID and RDTSC instructions emulated by the exception handlers.
+std::atomic<uint64_t> emulated_cpuid_exceptions{0};
+std::atomic<uint64_t> emulated_rdtsc_exceptions{0};
+
+// Untrusted counters mirroring the ones above, or nullptr if not registered.
+std::atomic<EnclaveThreadStats *> emulation_stats{nullptr};
+
+void CountEmulatedInstruction(std::atomic<uint64_t> *trusted_counter,
+                              std::atomic<uint64_t> EnclaveThreadStats::*
+                                  untrusted_counter) {
+  trusted_counter->fetch_add(1, std::memory_order_relaxed);
+  EnclaveThreadStats *stats = emulation_stats.load(std::memory_order_acquire);
+  if (stats) {
+    (stats->*untrusted_counter).fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+// Returns an emulated timestamp counter value. The value is the host monotonic
+// clock in nanoseconds when the host time page is enabled, and is otherwise
+// only guaranteed to increase with every call.
+uint64_t EmulatedTimestamp() {
+  int64_t monotonic_nanos = 0;
+  PeekHostTimePage(&monotonic_nanos);
+  uint64_t last = last_emulated_timestamp.load(std::memory_order_relaxed);
+  uint64_t next;
+  do {
+    next = std::max(static_cast<uint64_t>(monotonic_nanos), last + 1);
+  } while (!last_emulated_timestamp.compare_exchange_weak(
+      last, next, std::memory_order_relaxed));
+  return next;
+}
+
 // Prior to any CPUID instructions being executed, go fetch results from outside
 // the enclave, for us to use as the results in the enclave.
 void initialize_cpuid_results() {
@@ -86,6 +139,12 @@ void initialize_cpuid_results() {
       CPUID_01H_EDX_SSE | CPUID_01H_EDX_SSE2;
   cpuid_results[7].reg[CpuidResult::EBX] |= CPUID_07H_EBX_RDSEED;
 
+  int sgx_leaf[4];
+  if (sgx_cpuidex(sgx_leaf, kSgxCpuidLeaf, 0) == SGX_SUCCESS) {
+    native_rdtsc_allowed.store(
+        (sgx_leaf[CpuidResult::EAX] & CPUID_12H_EAX_SGX2) != 0,
+        std::memory_order_relaxed);
+  }
 }
 
 // Called whenever an SGX exception occurs.  This handler deals with CPUID
@@ -103,23 +162,21 @@ int handle_cpuid_exception(sgx_exception_info_t *info) {
     return EXCEPTION_CONTINUE_SEARCH;
   }
 
-  // This handler only provides results for CPUID calls that were cached.
-  uint64_t leaf = info->cpu_context.rax;
-  if (leaf > kMaxSupportedCpuidLeaf || !cpuid_results[leaf].cached) {
+  // This handler only provides results for CPUID calls that were cached. CPUID
+  // takes its leaf and subleaf from EAX and ECX.
+  uint32_t regs[4];
+  if (!ReadCachedCpuid(static_cast<uint32_t>(info->cpu_context.rax),
+                       static_cast<uint32_t>(info->cpu_context.rcx), regs)) {
     return EXCEPTION_CONTINUE_SEARCH;
   }
-
-  // Only subleaf==0 results were cached.  Since subleaf doesn't mean anything
-  // for leaves 0 and 1, allow those to be anything (some code doesn't set RCX
-  // at all when making those CPUID calls).
-  uint64_t subleaf = info->cpu_context.rcx;
-  if (leaf != 0 && leaf != 1 && subleaf != 0) return EXCEPTION_CONTINUE_SEARCH;
+  CountEmulatedInstruction(&emulated_cpuid_exceptions,
+                           &EnclaveThreadStats::emulated_cpuid);
 
   // Copy the cached result registers into our result registers.
-  info->cpu_context.rax = cpuid_results[leaf].reg[CpuidResult::EAX];
-  info->cpu_context.rbx = cpuid_results[leaf].reg[CpuidResult::EBX];
-  info->cpu_context.rcx = cpuid_results[leaf].reg[CpuidResult::ECX];
-  info->cpu_context.rdx = cpuid_results[leaf].reg[CpuidResult::EDX];
+  info->cpu_context.rax = regs[CpuidResult::EAX];
+  info->cpu_context.rbx = regs[CpuidResult::EBX];
+  info->cpu_context.rcx = regs[CpuidResult::ECX];
+  info->cpu_context.rdx = regs[CpuidResult::EDX];
 
   // CPUID instruction is 2 bytes wide, so advance the instruction pointer
   // beyond it. This way the enclave should continue execution as though the
@@ -130,7 +187,7 @@ int handle_cpuid_exception(sgx_exception_info_t *info) {
 }
 
 // Called whenever an SGX exception occurs.  This handler deals with RDTSC
-// invalid opcode exceptions by filling in dummy data.
+// invalid opcode exceptions by filling in an emulated timestamp.
 int handle_rdtsc_exception(sgx_exception_info_t *info) {
   // Grab the opcode for the instruction at the exception's instruction pointer.
   uint16_t opcode = *reinterpret_cast<uint16_t *>(info->cpu_context.rip);
@@ -144,13 +201,15 @@ int handle_rdtsc_exception(sgx_exception_info_t *info) {
     return EXCEPTION_CONTINUE_SEARCH;
   }
 
-  // Increment the timestamp value from the last one returned.
-  static uint64_t last_rdtsc = 0;
-  last_rdtsc++;
+  // RDTSC trapped, so it is not allowed natively whatever the host reported.
+  native_rdtsc_allowed.store(false, std::memory_order_relaxed);
+  CountEmulatedInstruction(&emulated_rdtsc_exceptions,
+                           &EnclaveThreadStats::emulated_rdtsc);
 
   // Split the timestamp and return in registers
-  info->cpu_context.rax = last_rdtsc & 0xFFFFFFFF;
-  info->cpu_context.rdx = last_rdtsc >> 32;
+  uint64_t timestamp = EmulatedTimestamp();
+  info->cpu_context.rax = timestamp & 0xFFFFFFFF;
+  info->cpu_context.rdx = timestamp >> 32;
 
   // RDTSC instruction is 2 bytes wide, so advance the instruction pointer
   // beyond it. This way the enclave should continue execution should continue
@@ -171,3 +230,50 @@ void register_exception_handlers() {
 }
 
 }  // namespace
+
+bool ReadCachedCpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4]) {
+  if (leaf > kMaxSupportedCpuidLeaf || !cpuid_results[leaf].cached) {
+    return false;
+  }
+
+  // Only subleaf==0 results were cached.  Since subleaf doesn't mean anything
+  // for leaves 0 and 1, allow those to be anything (some code doesn't set RCX
+  // at all when making those CPUID calls).
+  if (leaf != 0 && leaf != 1 && subleaf != 0) {
+    return false;
+  }
+  for (int i = 0; i < 4; ++i) {
+    regs[i] = static_cast<uint32_t>(cpuid_results[leaf].reg[i]);
+  }
+  return true;
+}
+
+uint64_t ReadTimestampCounter() {
+  if (native_rdtsc_allowed.load(std::memory_order_relaxed)) {
+    uint32_t low;
+    uint32_t high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return (static_cast<uint64_t>(high) << 32) | low;
+  }
+  return EmulatedTimestamp();
+}
+
+bool IsNativeRdtscAllowed() {
+  return native_rdtsc_allowed.load(std::memory_order_relaxed);
+}
+
+EmulatedInstructionCounts GetEmulatedInstructionCounts() {
+  EmulatedInstructionCounts counts;
+  counts.cpuid_exceptions =
+      emulated_cpuid_exceptions.load(std::memory_order_relaxed);
+  counts.rdtsc_exceptions =
+      emulated_rdtsc_exceptions.load(std::memory_order_relaxed);
+  return counts;
+}
+
+void SetEmulatedInstructionStats(EnclaveThreadStats *stats) {
+  emulation_stats.store(stats, std::memory_order_release);
+}
+
+}  // namespace primitives
+}  // namespace asylo
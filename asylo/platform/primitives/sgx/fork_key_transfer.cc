@@ -0,0 +1,265 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/sgx/fork_key_transfer.h"
+
+#include <openssl/curve25519.h>
+#include <openssl/digest.h>
+#include <openssl/hkdf.h>
+#include <openssl/sha.h>
+
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "asylo/crypto/aead_cryptor.h"
+#include "asylo/crypto/util/bssl_util.h"
+#include "asylo/crypto/util/trivial_object_util.h"
+#include "asylo/identity/platform/sgx/internal/hardware_interface.h"
+#include "asylo/identity/platform/sgx/internal/self_identity.h"
+#include "asylo/identity/platform/sgx/internal/sgx_identity_util_internal.h"
+#include "asylo/platform/primitives/sgx/fork.pb.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace {
+
+// Labels bound into the REPORTDATA of requests and responses, so that neither
+// side accepts its own REPORT reflected back to it.
+constexpr char kRequestLabel[] = "Asylo fork key request";
+constexpr char kResponseLabel[] = "Asylo fork key response";
+
+// HKDF info for the key sealing the snapshot key.
+constexpr char kTransferKeyInfo[] = "Asylo fork key transfer";
+
+constexpr char kSnapshotKeyAssociatedData[] = "AES256-GCM-SIV snapshot key";
+
+// Size of X25519 keys and shared secrets, as defined by RFC 7748.
+constexpr size_t kX25519KeySize = 32;
+
+// Size of the AES256-GCM-SIV key sealing the snapshot key.
+constexpr size_t kTransferKeySize = 32;
+
+// Returns the REPORTDATA binding |public_key| under |label|.
+sgx::Reportdata BindPublicKey(absl::string_view label,
+                              ByteContainerView public_key) {
+  SHA256_CTX context;
+  SHA256_Init(&context);
+  SHA256_Update(&context, label.data(), label.size());
+  SHA256_Update(&context, public_key.data(), public_key.size());
+
+  sgx::Reportdata reportdata;
+  reportdata.data = TrivialZeroObject<UnsafeBytes<sgx::kReportdataSize>>();
+  SHA256_Final(reportdata.data.data(), &context);
+  return reportdata;
+}
+
+// Returns a serialized REPORT of this enclave binding |public_key| under
+// |label|, targeted at enclaves with the same identity as this one.
+StatusOr<std::string> CreateReport(absl::string_view label,
+                                   ByteContainerView public_key) {
+  sgx::AlignedTargetinfoPtr targetinfo;
+  sgx::SetTargetinfoFromSelfIdentity(targetinfo.get());
+  sgx::AlignedReportdataPtr reportdata;
+  *reportdata = BindPublicKey(label, public_key);
+
+  sgx::Report report;
+  ASYLO_ASSIGN_OR_RETURN(report,
+                         sgx::HardwareInterface::CreateDefault()->GetReport(
+                             *targetinfo, *reportdata));
+  return ConvertTrivialObjectToBinaryString(report);
+}
+
+// Verifies that |report|, whose MAC has been checked, is the REPORT of an
+// enclave with the same identity as this one binding |public_key| under
+// |label|.
+Status VerifyPeerReport(const sgx::Report &report, absl::string_view label,
+                        ByteContainerView public_key) {
+  const sgx::SelfIdentity *self = sgx::GetSelfIdentity();
+  const sgx::ReportBody &body = report.body;
+  if (body.mrenclave != self->mrenclave || body.mrsigner != self->mrsigner ||
+      body.attributes != self->attributes ||
+      body.miscselect != self->miscselect ||
+      body.isvprodid != self->isvprodid || body.isvsvn != self->isvsvn ||
+      body.cpusvn != self->cpusvn) {
+    return Status(error::GoogleError::PERMISSION_DENIED,
+                  "The identity of the peer enclave does not match this "
+                  "enclave");
+  }
+
+  if (body.reportdata.data != BindPublicKey(label, public_key).data) {
+    return Status(error::GoogleError::PERMISSION_DENIED,
+                  "The REPORT of the peer enclave is not bound to its key");
+  }
+  return Status::OkStatus();
+}
+
+// Generates a new X25519 key pair.
+void GenerateKeyPair(std::vector<uint8_t> *public_key,
+                     CleansingVector<uint8_t> *private_key) {
+  public_key->resize(kX25519KeySize);
+  private_key->resize(kX25519KeySize);
+  X25519_keypair(public_key->data(), private_key->data());
+}
+
+// Returns a cryptor with the key shared by the holder of |private_key| and the
+// holder of |peer_public_key|, bound to the public keys of the child and the
+// parent.
+StatusOr<std::unique_ptr<AeadCryptor>> CreateTransferCryptor(
+    ByteContainerView private_key, ByteContainerView peer_public_key,
+    ByteContainerView child_public_key, ByteContainerView parent_public_key) {
+  if (peer_public_key.size() != kX25519KeySize) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "The public key of the peer enclave has an invalid size");
+  }
+  CleansingVector<uint8_t> shared_secret(kX25519KeySize);
+  if (!X25519(shared_secret.data(), private_key.data(),
+              peer_public_key.data())) {
+    return Status(error::GoogleError::INTERNAL,
+                  absl::StrCat("X25519 failed: ", BsslLastErrorString()));
+  }
+
+  std::string info = absl::StrCat(
+      kTransferKeyInfo,
+      absl::string_view(reinterpret_cast<const char *>(child_public_key.data()),
+                        child_public_key.size()),
+      absl::string_view(
+          reinterpret_cast<const char *>(parent_public_key.data()),
+          parent_public_key.size()));
+  CleansingVector<uint8_t> transfer_key(kTransferKeySize);
+  if (!HKDF(transfer_key.data(), transfer_key.size(), EVP_sha256(),
+            shared_secret.data(), shared_secret.size(), /*salt=*/nullptr,
+            /*salt_len=*/0, reinterpret_cast<const uint8_t *>(info.data()),
+            info.size())) {
+    return Status(error::GoogleError::INTERNAL,
+                  absl::StrCat("HKDF failed: ", BsslLastErrorString()));
+  }
+  return AeadCryptor::CreateAesGcmSivCryptor(transfer_key);
+}
+
+}  // namespace
+
+StatusOr<std::unique_ptr<ForkKeyServer>> ForkKeyServer::Create() {
+  std::unique_ptr<ForkKeyServer> server(new ForkKeyServer());
+  GenerateKeyPair(&server->public_key_, &server->private_key_);
+  ASYLO_ASSIGN_OR_RETURN(server->report_,
+                         CreateReport(kResponseLabel, server->public_key_));
+
+  // Every REPORT created on this platform carries the same KEYID, so the
+  // report key retrieved for the REPORT of the server verifies those of the
+  // children as well.
+  sgx::Report report;
+  ASYLO_RETURN_IF_ERROR(SetTrivialObjectFromBinaryString<sgx::Report>(
+      server->report_, &report));
+  server->report_keyid_ = report.keyid;
+  ASYLO_ASSIGN_OR_RETURN(server->report_key_,
+                         sgx::GetReportKey(server->report_keyid_));
+  return std::move(server);
+}
+
+StatusOr<std::string> ForkKeyServer::SealSnapshotKey(
+    ByteContainerView request, ByteContainerView snapshot_key) const {
+  ForkKeyRequest key_request;
+  if (!key_request.ParseFromArray(request.data(), request.size())) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Failed to parse ForkKeyRequest");
+  }
+  sgx::Report report;
+  ASYLO_RETURN_IF_ERROR(SetTrivialObjectFromBinaryString<sgx::Report>(
+      key_request.report(), &report));
+  if (report.keyid == report_keyid_) {
+    ASYLO_RETURN_IF_ERROR(
+        sgx::VerifyHardwareReportWithKey(report, report_key_));
+  } else {
+    ASYLO_RETURN_IF_ERROR(sgx::VerifyHardwareReport(report));
+  }
+  ByteContainerView child_public_key(key_request.public_key());
+  ASYLO_RETURN_IF_ERROR(
+      VerifyPeerReport(report, kRequestLabel, child_public_key));
+
+  std::unique_ptr<AeadCryptor> cryptor;
+  ASYLO_ASSIGN_OR_RETURN(
+      cryptor, CreateTransferCryptor(private_key_, child_public_key,
+                                     child_public_key, public_key_));
+  std::vector<uint8_t> ciphertext(snapshot_key.size() +
+                                  cryptor->MaxSealOverhead());
+  std::vector<uint8_t> nonce(cryptor->NonceSize());
+  size_t ciphertext_size;
+  ASYLO_RETURN_IF_ERROR(cryptor->Seal(
+      snapshot_key, kSnapshotKeyAssociatedData, absl::MakeSpan(nonce),
+      absl::MakeSpan(ciphertext), &ciphertext_size));
+
+  ForkKeyResponse key_response;
+  key_response.set_public_key(public_key_.data(), public_key_.size());
+  key_response.set_report(report_);
+  EncryptedSnapshotKey *encrypted_key = key_response.mutable_snapshot_key();
+  encrypted_key->set_ciphertext(ciphertext.data(), ciphertext_size);
+  encrypted_key->set_nonce(nonce.data(), nonce.size());
+
+  std::string response;
+  if (!key_response.SerializeToString(&response)) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Failed to serialize ForkKeyResponse");
+  }
+  return response;
+}
+
+StatusOr<std::unique_ptr<ForkKeyClient>> ForkKeyClient::Create() {
+  std::unique_ptr<ForkKeyClient> client(new ForkKeyClient());
+  GenerateKeyPair(&client->public_key_, &client->private_key_);
+
+  ForkKeyRequest key_request;
+  key_request.set_public_key(client->public_key_.data(),
+                             client->public_key_.size());
+  ASYLO_ASSIGN_OR_RETURN(*key_request.mutable_report(),
+                         CreateReport(kRequestLabel, client->public_key_));
+  if (!key_request.SerializeToString(&client->request_)) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Failed to serialize ForkKeyRequest");
+  }
+  return std::move(client);
+}
+
+StatusOr<CleansingVector<uint8_t>> ForkKeyClient::OpenSnapshotKey(
+    ByteContainerView response) const {
+  ForkKeyResponse key_response;
+  if (!key_response.ParseFromArray(response.data(), response.size())) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Failed to parse ForkKeyResponse");
+  }
+  sgx::Report report;
+  ASYLO_RETURN_IF_ERROR(SetTrivialObjectFromBinaryString<sgx::Report>(
+      key_response.report(), &report));
+  ASYLO_RETURN_IF_ERROR(sgx::VerifyHardwareReport(report));
+  ByteContainerView parent_public_key(key_response.public_key());
+  ASYLO_RETURN_IF_ERROR(
+      VerifyPeerReport(report, kResponseLabel, parent_public_key));
+
+  std::unique_ptr<AeadCryptor> cryptor;
+  ASYLO_ASSIGN_OR_RETURN(
+      cryptor, CreateTransferCryptor(private_key_, parent_public_key,
+                                     public_key_, parent_public_key));
+  const EncryptedSnapshotKey &encrypted_key = key_response.snapshot_key();
+  CleansingVector<uint8_t> snapshot_key(encrypted_key.ciphertext().size());
+  size_t snapshot_key_size;
+  ASYLO_RETURN_IF_ERROR(cryptor->Open(
+      encrypted_key.ciphertext(), kSnapshotKeyAssociatedData,
+      encrypted_key.nonce(), absl::MakeSpan(snapshot_key), &snapshot_key_size));
+  snapshot_key.resize(snapshot_key_size);
+  return std::move(snapshot_key);
+}
+
+}  // namespace asylo
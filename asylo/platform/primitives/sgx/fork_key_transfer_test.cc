@@ -0,0 +1,106 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/sgx/fork_key_transfer.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "asylo/platform/primitives/sgx/fork.pb.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/cleansing_types.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::ElementsAreArray;
+using ::testing::Ne;
+using ::testing::Not;
+
+constexpr char kSnapshotKey[] = "0123456789abcdef0123456789abcdef";
+
+TEST(ForkKeyTransferTest, ChildOpensSnapshotKeySealedForIt) {
+  std::unique_ptr<ForkKeyServer> server;
+  ASYLO_ASSERT_OK_AND_ASSIGN(server, ForkKeyServer::Create());
+
+  // The server serves any number of children.
+  for (int i = 0; i < 3; ++i) {
+    std::unique_ptr<ForkKeyClient> client;
+    ASYLO_ASSERT_OK_AND_ASSIGN(client, ForkKeyClient::Create());
+    std::string response;
+    ASYLO_ASSERT_OK_AND_ASSIGN(
+        response, server->SealSnapshotKey(client->request(), kSnapshotKey));
+    CleansingVector<uint8_t> snapshot_key;
+    ASYLO_ASSERT_OK_AND_ASSIGN(snapshot_key,
+                               client->OpenSnapshotKey(response));
+    EXPECT_THAT(snapshot_key,
+                ElementsAreArray(kSnapshotKey, sizeof(kSnapshotKey) - 1));
+  }
+}
+
+TEST(ForkKeyTransferTest, ResponseOnlyOpensForItsRequest) {
+  std::unique_ptr<ForkKeyServer> server;
+  ASYLO_ASSERT_OK_AND_ASSIGN(server, ForkKeyServer::Create());
+  std::unique_ptr<ForkKeyClient> client;
+  ASYLO_ASSERT_OK_AND_ASSIGN(client, ForkKeyClient::Create());
+  std::unique_ptr<ForkKeyClient> other_client;
+  ASYLO_ASSERT_OK_AND_ASSIGN(other_client, ForkKeyClient::Create());
+
+  std::string response;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      response, server->SealSnapshotKey(client->request(), kSnapshotKey));
+  EXPECT_THAT(other_client->OpenSnapshotKey(response), Not(IsOk()));
+}
+
+TEST(ForkKeyTransferTest, ServerRejectsRequestWithSwappedKey) {
+  std::unique_ptr<ForkKeyServer> server;
+  ASYLO_ASSERT_OK_AND_ASSIGN(server, ForkKeyServer::Create());
+  std::unique_ptr<ForkKeyClient> client;
+  ASYLO_ASSERT_OK_AND_ASSIGN(client, ForkKeyClient::Create());
+  std::unique_ptr<ForkKeyClient> other_client;
+  ASYLO_ASSERT_OK_AND_ASSIGN(other_client, ForkKeyClient::Create());
+
+  ForkKeyRequest request;
+  ASSERT_TRUE(request.ParseFromString(client->request()));
+  ForkKeyRequest other_request;
+  ASSERT_TRUE(other_request.ParseFromString(other_client->request()));
+  ASSERT_THAT(request.public_key(), Ne(other_request.public_key()));
+  request.set_public_key(other_request.public_key());
+  EXPECT_THAT(server->SealSnapshotKey(request.SerializeAsString(),
+                                      kSnapshotKey),
+              StatusIs(error::GoogleError::PERMISSION_DENIED));
+}
+
+TEST(ForkKeyTransferTest, ClientRejectsReflectedRequest) {
+  std::unique_ptr<ForkKeyClient> client;
+  ASYLO_ASSERT_OK_AND_ASSIGN(client, ForkKeyClient::Create());
+
+  ForkKeyRequest request;
+  ASSERT_TRUE(request.ParseFromString(client->request()));
+  ForkKeyResponse response;
+  response.set_public_key(request.public_key());
+  response.set_report(request.report());
+  EXPECT_THAT(client->OpenSnapshotKey(response.SerializeAsString()),
+              StatusIs(error::GoogleError::PERMISSION_DENIED));
+}
+
+}  // namespace
+}  // namespace asylo
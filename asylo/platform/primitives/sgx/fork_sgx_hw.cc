@@ -19,14 +19,20 @@
 #include <openssl/rand.h>
 #include <sys/socket.h>
 
+#include <algorithm>
 #include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "absl/base/macros.h"
 #include "absl/strings/str_cat.h"
 #include "asylo/crypto/aead_cryptor.h"
+#include "asylo/crypto/ecdsa_p256_sha256_signing_key.h"
+#include "asylo/crypto/random_nonce_generator.h"
+#include "asylo/crypto/x25519_key_pool.h"
 #include "asylo/crypto/util/bssl_util.h"
 #include "asylo/crypto/util/byte_container_view.h"
 #include "asylo/crypto/util/trivial_object_util.h"
@@ -37,9 +43,12 @@
 #include "asylo/identity/identity_acl_evaluator.h"
 #include "asylo/identity/platform/sgx/sgx_identity_expectation_matcher.h"
 #include "asylo/identity/platform/sgx/sgx_identity_util.h"
+#include "asylo/platform/core/trusted_global_state.h"
 #include "asylo/platform/host_call/trusted/host_calls.h"
 #include "asylo/platform/posix/memory/memory.h"
+#include "asylo/platform/primitives/sgx/committed_heap.h"
 #include "asylo/platform/primitives/sgx/fork_internal.h"
+#include "asylo/platform/primitives/sgx/fork_key_transfer.h"
 #include "asylo/platform/primitives/sgx/trusted_sgx.h"
 #include "asylo/platform/primitives/trusted_primitives.h"
 #include "asylo/platform/primitives/trusted_runtime.h"
@@ -55,6 +64,11 @@ namespace {
 // use an AES256-GCM-SIV key to encrypt the snapshot.
 constexpr size_t kSnapshotKeySize = 32;
 
+// Maximum size of the plaintext sealed in a single snapshot entry. Each entry
+// has its own nonce, and is bound to the enclave address it is restored to, so
+// entries can be sealed and opened independently of each other.
+constexpr size_t kSnapshotChunkSize = 8 << 20;
+
 // Indicates whether a fork request has been made from inside the enclave. A
 // snapshot ecall is only allowed to enter the enclave if it's set.
 std::atomic<bool> fork_requested(false);
@@ -69,6 +83,13 @@ const char kSnapshotKeyAssociatedDataBuf[] = "AES256-GCM-SIV snapshot key";
 // AES256-GCM-SIV snapshot key, which is used to encrypt/decrypt snapshot.
 static CleansingVector<uint8_t> *global_snapshot_key(nullptr);
 
+// Maximum size of a message of the snapshot key transfer with local reports.
+constexpr uint32_t kMaxKeyTransferMessageSize = 4096;
+
+// Service transferring snapshot keys to the children of this enclave with local
+// reports. Created by the first fork that uses it, and never destroyed.
+static ForkKeyServer *fork_key_server(nullptr);
+
 // Structure describing the layout of per-thread memory resources.
 struct ThreadMemoryLayout {
   // Base address of the thread data for the current thread, including the stack
@@ -135,6 +156,13 @@ bool GetSnapshotKey(CleansingVector<uint8_t> *key) {
   return true;
 }
 
+// Returns whether snapshot keys are transferred with local reports instead of
+// an EKEP handshake.
+bool UseReportKeyTransfer() {
+  StatusOr<const EnclaveConfig *> config = GetEnclaveConfig();
+  return config.ok() && config.ValueOrDie()->fork_key_transfer_with_reports();
+}
+
 // Blocks all enclave entries and waits until all enclave entries have exited
 // the enclave and are either blocked from re-entry or staying on the untrusted
 // side. During blocking the calling thread uses |calling_thread_entry_count|
@@ -257,19 +285,27 @@ void CopyNonOkStatus(const Status &non_ok_status,
           std::min(message_buffer_size, non_ok_status.error_message().size()));
 }
 
+// Returns the size of the plaintext sealed in each snapshot entry produced
+// with |cryptor|.
+size_t GetSnapshotChunkSize(const AeadCryptor &cryptor) {
+  return std::min(kSnapshotChunkSize, cryptor.MaxMessageSize());
+}
+
 // Encrypts a whole memory region of size |source_size| at |source_base| in the
 // enclave with |cryptor|. The memory could be data, bss, heap, thread or data.
-// The encryption may result in multiple snapshot entries if the memory size is
-// greater than the maximum message size supported by |cryptor|. The result is
-// written to |entry|.
+// The region is split into chunks of at most kSnapshotChunkSize bytes, each of
+// which is sealed into its own snapshot entry. The result is written to
+// |entry|.
 Status EncryptToSnapshot(AeadCryptor *cryptor, void *source_base,
                          size_t source_size,
                          google::protobuf::RepeatedPtrField<SnapshotLayoutEntry> *entry) {
+  const size_t chunk_size = GetSnapshotChunkSize(*cryptor);
   size_t bytes_left = source_size;
   uint8_t *current_position = reinterpret_cast<uint8_t *>(source_base);
 
+  entry->Reserve(entry->size() + (source_size + chunk_size - 1) / chunk_size);
   while (bytes_left > 0) {
-    size_t plaintext_size = std::min(cryptor->MaxMessageSize(), bytes_left);
+    size_t plaintext_size = std::min(chunk_size, bytes_left);
     ASYLO_RETURN_IF_ERROR(EncryptToUntrustedMemory(
         cryptor, current_position, plaintext_size, entry->Add()));
 
@@ -280,21 +316,22 @@ Status EncryptToSnapshot(AeadCryptor *cryptor, void *source_base,
 }
 
 // Decrypts a whole memory region with |cryptor| from |entry|. The memory region
-// can be data, bss, heap, thread or stack. The snapshot may contain one or more
-// entries, and is decrypted in a loop. The decrypted result is saved in
-// |destination_base| with |destination_size|.
+// can be data, bss, heap, thread or stack. The snapshot contains one entry for
+// each chunk of the region, which are decrypted in a loop. The decrypted result
+// is saved in |destination_base| with |destination_size|. Fails unless the
+// entries cover the whole region exactly.
 Status DecryptFromSnapshot(
     AeadCryptor *cryptor, void *destination_base, size_t destination_size,
     const google::protobuf::RepeatedPtrField<SnapshotLayoutEntry> &entry) {
+  const size_t chunk_size = GetSnapshotChunkSize(*cryptor);
   uint8_t *current_position = reinterpret_cast<uint8_t *>(destination_base);
   size_t bytes_left = destination_size;
 
-  for (int i = 0; i < entry.size() && bytes_left > 0; ++i) {
+  int i = 0;
+  for (; i < entry.size() && bytes_left > 0; ++i) {
     // The expected plaintext size in the current snapshot part. It should be
-    // either the max message size of the cryptor, or the bytes left in the
-    // destination.
-    size_t expected_plaintext_size =
-        std::min(cryptor->MaxMessageSize(), bytes_left);
+    // either the chunk size, or the bytes left in the destination.
+    size_t expected_plaintext_size = std::min(chunk_size, bytes_left);
     // We should not decrypt to any untrusted memory.
     if (!current_position || !primitives::TrustedPrimitives::IsInsideEnclave(
                                  current_position, expected_plaintext_size)) {
@@ -313,6 +350,13 @@ Status DecryptFromSnapshot(
     bytes_left -= actual_plaintext_size;
     current_position += actual_plaintext_size;
   }
+
+  // Every chunk is sealed on its own, so a snapshot with dropped or extra
+  // entries would otherwise go unnoticed.
+  if (bytes_left > 0 || i < entry.size()) {
+    return Status(error::GoogleError::INTERNAL,
+                  "The snapshot entries do not cover the enclave memory");
+  }
   return Status::OkStatus();
 }
 
@@ -397,6 +441,16 @@ Status TakeSnapshotForFork(SnapshotLayout *snapshot_layout) {
                   "Failed to save snapshot key inside enclave");
   }
 
+  // Create the key transfer service before the snapshot is taken, so that
+  // children restored from the snapshot can serve their own children with it.
+  if (UseReportKeyTransfer() && !fork_key_server) {
+    auto server_result = ForkKeyServer::Create();
+    if (!server_result.ok()) {
+      return server_result.status();
+    }
+    fork_key_server = server_result.ValueOrDie().release();
+  }
+
   // Block and check for other entries inside the enclave. Currently there
   // should be two entries inside the enclave: snapshot ecall and the run ecall
   // which calls fork. If other TCS are running inside the enclave, they may
@@ -408,6 +462,10 @@ Status TakeSnapshotForFork(SnapshotLayout *snapshot_layout) {
     return status;
   }
 
+  // Now that no other thread can grow the heap, get the size of the part of
+  // the heap in use. Only that part is included in the snapshot.
+  enc_get_memory_layout(&enclave_layout);
+
   // Copy the data and bss section to reserved sections to avoid modifying
   // the data/bss sections while encrypting and copying them to the
   // snapshot.
@@ -482,10 +540,12 @@ Status TakeSnapshotForFork(SnapshotLayout *snapshot_layout) {
       break;
     }
 
-    // Allocate and encrypt heap to an untrusted snapshot.
+    // Allocate and encrypt the part of the heap in use to an untrusted
+    // snapshot. The child zero-fills the rest of the heap.
     status = EncryptToSnapshot(cryptor.get(), enclave_layout.heap_base,
-                               enclave_layout.heap_size,
+                               enclave_layout.heap_used,
                                tmp_snapshot_layout.mutable_heap());
+    tmp_snapshot_layout.set_heap_used(enclave_layout.heap_used);
 
     if (!status.ok()) {
       CopyNonOkStatus(status, &error_code, error_message,
@@ -559,11 +619,32 @@ Status DecryptAndRestoreEnclaveDataBssHeap(
       DecryptFromSnapshot(cryptor.get(), enclave_layout.reserved_bss_base,
                           enclave_layout.bss_size, snapshot_layout.bss()));
 
-  // Decrypt and restore the heap. It is safe to overwrite the heap here because
-  // the heap used by the cryptor is allocated on the switched heap.
+  // Decrypt and restore the part of the heap that was in use in the parent. It
+  // is safe to overwrite the heap here because the heap used by the cryptor is
+  // allocated on the switched heap.
+  size_t heap_used = snapshot_layout.heap_used();
+  if (heap_used > enclave_layout.heap_size) {
+    return Status(error::GoogleError::INTERNAL,
+                  "The snapshot heap does not fit in the enclave heap");
+  }
+  // With EDMM only the initial heap of this enclave is backed. Add the pages
+  // the parent used, and keep those the child used, which are cleared below.
+  if (!primitives::ResizeCommittedHeap(
+          std::max<size_t>(heap_used, enclave_layout.heap_used))) {
+    return Status(error::GoogleError::RESOURCE_EXHAUSTED,
+                  "Failed to add EPC pages for the snapshot heap");
+  }
+  size_t committed_heap_size = primitives::GetCommittedHeapSize();
   ASYLO_RETURN_IF_ERROR(
-      DecryptFromSnapshot(cryptor.get(), enclave_layout.heap_base,
-                          enclave_layout.heap_size, snapshot_layout.heap()));
+      DecryptFromSnapshot(cryptor.get(), enclave_layout.heap_base, heap_used,
+                          snapshot_layout.heap()));
+
+  // The rest of the heap is still untouched, except for what the child used
+  // before the restore. Clear that part.
+  if (enclave_layout.heap_used > heap_used) {
+    memset(reinterpret_cast<uint8_t *>(enclave_layout.heap_base) + heap_used,
+           0, enclave_layout.heap_used - heap_used);
+  }
 
   void *switched_heap_next = GetSwitchedHeapNext();
   size_t switched_heap_remaining = GetSwitchedHeapRemaining();
@@ -574,10 +655,23 @@ Status DecryptAndRestoreEnclaveDataBssHeap(
   memcpy(enclave_layout.bss_base, enclave_layout.reserved_bss_base,
          enclave_layout.bss_size);
 
+  // The bss section of the parent holds its own committed heap size, whereas
+  // the pages backed in this enclave are the ones added above.
+  primitives::SetCommittedHeapSize(committed_heap_size);
+
   // Reset the heap switch, because it has been overwritten while restoring the
   // data and bss. We should set to the memory address before overwriting the
   // data, to avoid overwriting the existing memory on the switched heap.
   heap_switch(switched_heap_next, switched_heap_remaining);
+
+  // |heap_used| comes from untrusted memory. Check it against the heap size
+  // restored with the authenticated bss section.
+  struct EnclaveMemoryLayout restored_layout;
+  enc_get_memory_layout(&restored_layout);
+  if (restored_layout.heap_used != heap_used) {
+    return Status(error::GoogleError::INTERNAL,
+                  "The snapshot heap size does not match the restored heap");
+  }
   return Status::OkStatus();
 }
 
@@ -694,6 +788,15 @@ Status RestoreForFork(const char *input, size_t input_len) {
     return Status(error_code, error_message);
   }
 
+  // The random generator states were restored along with the rest of the
+  // enclave, so they are shared with the parent and must not be used again.
+  // Neither may the random bytes buffered for nonces, the pooled ephemeral
+  // key pairs, nor the precomputed signing nonces.
+  enc_hardware_random_reseed();
+  RandomNonceGenerator::DiscardBufferedBytes();
+  X25519KeyPool::DiscardPooledKeys();
+  EcdsaP256Sha256SigningKey::DiscardPrecomputedNonces();
+
   // Only allow other entries if restoring the child enclave succeeds.
   enc_unblock_entries();
   return Status::OkStatus();
@@ -891,6 +994,87 @@ Status ReceiveSnapshotKey(std::unique_ptr<AeadCryptor> cryptor, int socket) {
   return Status::OkStatus();
 }
 
+// Reads exactly |size| bytes from |socket| into |buffer|.
+Status ReadFully(int socket, void *buffer, size_t size) {
+  uint8_t *position = reinterpret_cast<uint8_t *>(buffer);
+  while (size > 0) {
+    ssize_t bytes_read = enc_untrusted_read(socket, position, size);
+    if (bytes_read <= 0) {
+      return Status(static_cast<error::PosixError>(errno), "Read failed");
+    }
+    position += bytes_read;
+    size -= bytes_read;
+  }
+  return Status::OkStatus();
+}
+
+// Writes |message| to |socket|, preceded by its size.
+Status WriteKeyTransferMessage(int socket, const std::string &message) {
+  uint32_t size = message.size();
+  std::string framed_message(reinterpret_cast<const char *>(&size),
+                             sizeof(size));
+  framed_message.append(message);
+  const char *position = framed_message.data();
+  size_t remaining = framed_message.size();
+  while (remaining > 0) {
+    ssize_t bytes_written = enc_untrusted_write(socket, position, remaining);
+    if (bytes_written <= 0) {
+      return Status(static_cast<error::PosixError>(errno), "Write failed");
+    }
+    position += bytes_written;
+    remaining -= bytes_written;
+  }
+  return Status::OkStatus();
+}
+
+// Reads a message written with WriteKeyTransferMessage() from |socket|.
+Status ReadKeyTransferMessage(int socket, std::string *message) {
+  uint32_t size;
+  ASYLO_RETURN_IF_ERROR(ReadFully(socket, &size, sizeof(size)));
+  if (size > kMaxKeyTransferMessageSize) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Snapshot key transfer message is too large");
+  }
+  message->resize(size);
+  return ReadFully(socket, &(*message)[0], size);
+}
+
+// Transfers the snapshot key with one exchange of local reports. The child
+// sends a ForkKeyRequest, which the parent answers with a ForkKeyResponse from
+// the service it created when it took the snapshot.
+Status TransferSnapshotKeyWithReports(bool is_parent, int socket) {
+  if (is_parent) {
+    Cleanup delete_snapshot_key(DeleteSnapshotKey);
+    if (!fork_key_server) {
+      return Status(error::GoogleError::FAILED_PRECONDITION,
+                    "Snapshot key transfer service not created");
+    }
+    CleansingVector<uint8_t> snapshot_key(kSnapshotKeySize);
+    if (!GetSnapshotKey(&snapshot_key)) {
+      return Status(error::GoogleError::INTERNAL, "Failed to get snapshot key");
+    }
+    std::string request;
+    ASYLO_RETURN_IF_ERROR(ReadKeyTransferMessage(socket, &request));
+    std::string response;
+    ASYLO_ASSIGN_OR_RETURN(
+        response, fork_key_server->SealSnapshotKey(request, snapshot_key));
+    return WriteKeyTransferMessage(socket, response);
+  }
+
+  std::unique_ptr<ForkKeyClient> client;
+  ASYLO_ASSIGN_OR_RETURN(client, ForkKeyClient::Create());
+  ASYLO_RETURN_IF_ERROR(WriteKeyTransferMessage(socket, client->request()));
+  std::string response;
+  ASYLO_RETURN_IF_ERROR(ReadKeyTransferMessage(socket, &response));
+  CleansingVector<uint8_t> snapshot_key;
+  ASYLO_ASSIGN_OR_RETURN(snapshot_key, client->OpenSnapshotKey(response));
+  if (!SetSnapshotKey(snapshot_key)) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Failed to save snapshot key inside enclave");
+  }
+  return Status::OkStatus();
+}
+
 // Securely transfer the snapshot key. First create a shared secret from an EKEP
 // handshake between the parent and the child enclave. The parent enclave then
 // encrypt the snapshot key with the shared secret, and sends it to the child
@@ -925,6 +1109,11 @@ Status TransferSecureSnapshotKey(
                   "fork inside an enclave");
   }
 
+  if (UseReportKeyTransfer()) {
+    return TransferSnapshotKeyWithReports(is_parent,
+                                          fork_handshake_config.socket());
+  }
+
   AssertionDescription description;
   SetSgxLocalAssertionDescription(&description);
 
@@ -0,0 +1,130 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/sgx/host_info_watcher.h"
+
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+#include "absl/memory/memory.h"
+#include "asylo/util/posix_error_space.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+// Interval at which the watcher thread checks whether it was stopped.
+constexpr int kPollTimeoutMs = 100;
+
+}  // namespace
+
+StatusOr<std::unique_ptr<HostInfoWatcher>> HostInfoWatcher::Create(
+    bool watch_interfaces, std::chrono::seconds system_refresh_interval) {
+  int netlink_fd = -1;
+  if (watch_interfaces) {
+    netlink_fd =
+        socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC,
+               NETLINK_ROUTE);
+    if (netlink_fd < 0) {
+      return Status(static_cast<error::PosixError>(errno),
+                    "Failed to open a NETLINK_ROUTE socket");
+    }
+    struct sockaddr_nl address = {};
+    address.nl_family = AF_NETLINK;
+    address.nl_groups =
+        RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+    if (bind(netlink_fd, reinterpret_cast<struct sockaddr *>(&address),
+             sizeof(address)) != 0) {
+      Status status(static_cast<error::PosixError>(errno),
+                    "Failed to subscribe to interface notifications");
+      close(netlink_fd);
+      return status;
+    }
+  }
+  return absl::WrapUnique(
+      new HostInfoWatcher(netlink_fd, system_refresh_interval));
+}
+
+HostInfoWatcher::HostInfoWatcher(int netlink_fd,
+                                 std::chrono::seconds system_refresh_interval)
+    : netlink_fd_(netlink_fd),
+      system_refresh_interval_(system_refresh_interval),
+      generations_(absl::make_unique<HostInfoGenerations>()),
+      stopped_(false) {
+  if (netlink_fd_ >= 0 || system_refresh_interval_.count() > 0) {
+    thread_ = absl::make_unique<Thread>(&HostInfoWatcher::Run, this);
+  }
+}
+
+HostInfoWatcher::~HostInfoWatcher() {
+  stopped_.store(true, std::memory_order_release);
+  if (thread_) {
+    thread_->Join();
+  }
+  if (netlink_fd_ >= 0) {
+    close(netlink_fd_);
+  }
+}
+
+void HostInfoWatcher::InvalidateAll() {
+  generations_->interfaces.fetch_add(1, std::memory_order_release);
+  generations_->system.fetch_add(1, std::memory_order_release);
+}
+
+void HostInfoWatcher::Run() {
+  auto next_refresh = std::chrono::steady_clock::now() +
+                      system_refresh_interval_;
+  while (!stopped_.load(std::memory_order_acquire)) {
+    if (netlink_fd_ >= 0) {
+      struct pollfd fd = {netlink_fd_, POLLIN, 0};
+      if (poll(&fd, 1, kPollTimeoutMs) > 0) {
+        // The content of the notifications does not matter, since any of them
+        // invalidates the whole interface list. An overrun of the socket
+        // buffer also means that something changed.
+        char buffer[8192];
+        bool changed = false;
+        for (;;) {
+          ssize_t received = recv(netlink_fd_, buffer, sizeof(buffer), 0);
+          if (received <= 0 && (received == 0 || errno != ENOBUFS)) {
+            break;
+          }
+          changed = true;
+        }
+        if (changed) {
+          generations_->interfaces.fetch_add(1, std::memory_order_release);
+        }
+      }
+    } else {
+      poll(nullptr, 0, kPollTimeoutMs);
+    }
+    if (system_refresh_interval_.count() > 0 &&
+        std::chrono::steady_clock::now() >= next_refresh) {
+      generations_->system.fetch_add(1, std::memory_order_release);
+      next_refresh += system_refresh_interval_;
+    }
+  }
+}
+
+}  // namespace primitives
+}  // namespace asylo
@@ -0,0 +1,74 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_SGX_HOST_INFO_WATCHER_H_
+#define ASYLO_PLATFORM_PRIMITIVES_SGX_HOST_INFO_WATCHER_H_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+#include "asylo/platform/common/host_info_generations.h"
+#include "asylo/util/statusor.h"
+#include "asylo/util/thread.h"
+
+namespace asylo {
+namespace primitives {
+
+// An untrusted thread incrementing the counters of a HostInfoGenerations when
+// the host facts cached by the enclave may have changed. The interfaces
+// counter is incremented on every link and address notification of a
+// NETLINK_ROUTE socket, and the system counter at a fixed interval.
+class HostInfoWatcher {
+ public:
+  // Starts watching. If |watch_interfaces| is false, the interfaces counter
+  // never changes, so the enclave never refreshes its interface list. If
+  // |system_refresh_interval| is zero, the system counter never changes.
+  static StatusOr<std::unique_ptr<HostInfoWatcher>> Create(
+      bool watch_interfaces, std::chrono::seconds system_refresh_interval);
+
+  // Stops and joins the watcher thread.
+  ~HostInfoWatcher();
+
+  HostInfoWatcher(const HostInfoWatcher &other) = delete;
+  HostInfoWatcher &operator=(const HostInfoWatcher &other) = delete;
+
+  // Returns the counters incremented by this object.
+  HostInfoGenerations *generations() { return generations_.get(); }
+
+  // Increments all counters, so that the enclave refreshes every fact.
+  void InvalidateAll();
+
+ private:
+  HostInfoWatcher(int netlink_fd, std::chrono::seconds system_refresh_interval);
+
+  // Body of the watcher thread.
+  void Run();
+
+  // NETLINK_ROUTE socket, or -1 if interfaces are not watched.
+  const int netlink_fd_;
+  const std::chrono::seconds system_refresh_interval_;
+  const std::unique_ptr<HostInfoGenerations> generations_;
+  std::atomic<bool> stopped_;
+  std::unique_ptr<Thread> thread_;
+};
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_SGX_HOST_INFO_WATCHER_H_
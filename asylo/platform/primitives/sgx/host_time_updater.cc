@@ -0,0 +1,61 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/sgx/host_time_updater.h"
+
+#include <time.h>
+
+#include <thread>
+
+#include "absl/memory/memory.h"
+#include "asylo/platform/common/time_util.h"
+
+namespace asylo {
+namespace primitives {
+
+HostTimeUpdater::HostTimeUpdater(std::chrono::microseconds interval)
+    : interval_(interval),
+      page_(absl::make_unique<HostTimePage>()),
+      stopped_(false) {
+  Update();
+  thread_ = absl::make_unique<Thread>(&HostTimeUpdater::Run, this);
+}
+
+HostTimeUpdater::~HostTimeUpdater() {
+  stopped_.store(true, std::memory_order_release);
+  thread_->Join();
+}
+
+void HostTimeUpdater::Update() {
+  struct timespec monotonic;
+  struct timespec realtime;
+  clock_gettime(CLOCK_MONOTONIC, &monotonic);
+  clock_gettime(CLOCK_REALTIME, &realtime);
+  page_->Update(TimeSpecToNanoseconds(&monotonic),
+                TimeSpecToNanoseconds(&realtime));
+}
+
+void HostTimeUpdater::Run() {
+  while (!stopped_.load(std::memory_order_acquire)) {
+    std::this_thread::sleep_for(interval_);
+    Update();
+  }
+}
+
+}  // namespace primitives
+}  // namespace asylo
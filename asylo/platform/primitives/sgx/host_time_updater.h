@@ -0,0 +1,64 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_SGX_HOST_TIME_UPDATER_H_
+#define ASYLO_PLATFORM_PRIMITIVES_SGX_HOST_TIME_UPDATER_H_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+#include "asylo/platform/common/host_time_page.h"
+#include "asylo/util/thread.h"
+
+namespace asylo {
+namespace primitives {
+
+// An untrusted thread refreshing a HostTimePage from the host clocks at a fixed
+// interval, so that the enclave can read the clocks without leaving.
+class HostTimeUpdater {
+ public:
+  // Updates the page once and starts refreshing it every |interval|.
+  explicit HostTimeUpdater(std::chrono::microseconds interval);
+
+  // Stops and joins the updater thread.
+  ~HostTimeUpdater();
+
+  HostTimeUpdater(const HostTimeUpdater &other) = delete;
+  HostTimeUpdater &operator=(const HostTimeUpdater &other) = delete;
+
+  // Returns the page updated by this object.
+  HostTimePage *page() { return page_.get(); }
+
+ private:
+  // Writes the current host clocks to the page.
+  void Update();
+
+  // Body of the updater thread.
+  void Run();
+
+  const std::chrono::microseconds interval_;
+  const std::unique_ptr<HostTimePage> page_;
+  std::atomic<bool> stopped_;
+  std::unique_ptr<Thread> thread_;
+};
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_SGX_HOST_TIME_UPDATER_H_
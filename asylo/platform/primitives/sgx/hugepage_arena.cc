@@ -0,0 +1,82 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/sgx/hugepage_arena.h"
+
+#include <sys/mman.h>
+
+#include <cerrno>
+#include <cstdint>
+
+#include "absl/memory/memory.h"
+#include "asylo/util/posix_error_space.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+namespace primitives {
+
+constexpr size_t HugepageArena::kHugepageSize;
+
+HugepageArena::~HugepageArena() { munmap(base_, size_); }
+
+StatusOr<std::unique_ptr<HugepageArena>> HugepageArena::Create(size_t size) {
+  if (size == 0) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Hugepage arena size must be positive");
+  }
+  if (size > SIZE_MAX - 2 * kHugepageSize) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Hugepage arena size is too large");
+  }
+  size = (size + kHugepageSize - 1) & ~(kHugepageSize - 1);
+
+  void *base = mmap(/*addr=*/nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE,
+                    /*fd=*/-1, /*offset=*/0);
+  if (base != MAP_FAILED) {
+    return absl::WrapUnique(new HugepageArena(base, size, /*hugetlb=*/true));
+  }
+
+  // Over-allocate by one hugepage so that an aligned range of |size| bytes
+  // fits, and trim the rest.
+  size_t mapped_size = size + kHugepageSize;
+  void *mapping =
+      mmap(/*addr=*/nullptr, mapped_size, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS, /*fd=*/-1, /*offset=*/0);
+  if (mapping == MAP_FAILED) {
+    return Status(static_cast<error::PosixError>(errno),
+                  "Failed to map hugepage arena");
+  }
+  uintptr_t start = reinterpret_cast<uintptr_t>(mapping);
+  uintptr_t aligned = (start + kHugepageSize - 1) & ~(kHugepageSize - 1);
+  if (aligned > start) {
+    munmap(mapping, aligned - start);
+  }
+  if (aligned + size < start + mapped_size) {
+    munmap(reinterpret_cast<void *>(aligned + size),
+           start + mapped_size - aligned - size);
+  }
+  base = reinterpret_cast<void *>(aligned);
+  // Transparent hugepages may be disabled on the host, in which case the arena
+  // is still usable with ordinary pages.
+  madvise(base, size, MADV_HUGEPAGE);
+  return absl::WrapUnique(new HugepageArena(base, size, /*hugetlb=*/false));
+}
+
+}  // namespace primitives
+}  // namespace asylo
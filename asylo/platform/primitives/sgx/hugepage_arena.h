@@ -0,0 +1,74 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_SGX_HUGEPAGE_ARENA_H_
+#define ASYLO_PLATFORM_PRIMITIVES_SGX_HUGEPAGE_ARENA_H_
+
+#include <cstddef>
+#include <memory>
+
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+namespace primitives {
+
+// A region of untrusted memory backed by 2 MiB pages, mapped once and shared
+// with an enclave for the buffers it exchanges with the host. Backing the
+// buffers with hugepages saves the TLB misses that heavy boundary traffic
+// incurs on both sides of the enclave when the buffers span many 4 KiB pages.
+class HugepageArena {
+ public:
+  // Size of the pages backing the arena and alignment of its base address.
+  static constexpr size_t kHugepageSize = 2 * 1024 * 1024;
+
+  HugepageArena(const HugepageArena &) = delete;
+  HugepageArena &operator=(const HugepageArena &) = delete;
+
+  // Unmaps the arena.
+  ~HugepageArena();
+
+  // Maps an arena of |size| bytes, rounded up to a multiple of kHugepageSize.
+  // The arena is mapped from the hugetlbfs pool of the host if it has enough
+  // free hugepages, which are faulted in immediately. Otherwise it is mapped
+  // from ordinary memory aligned to kHugepageSize and marked for transparent
+  // hugepages, which the kernel backs with hugepages where it can.
+  static StatusOr<std::unique_ptr<HugepageArena>> Create(size_t size);
+
+  // Returns the base address of the arena, aligned to kHugepageSize.
+  void *base() const { return base_; }
+
+  // Returns the size of the arena in bytes.
+  size_t size() const { return size_; }
+
+  // Returns true if the arena is mapped from the hugetlbfs pool, and false if
+  // it relies on transparent hugepages.
+  bool hugetlb() const { return hugetlb_; }
+
+ private:
+  HugepageArena(void *base, size_t size, bool hugetlb)
+      : base_(base), size_(size), hugetlb_(hugetlb) {}
+
+  void *const base_;
+  const size_t size_;
+  const bool hugetlb_;
+};
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_SGX_HUGEPAGE_ARENA_H_
@@ -0,0 +1,54 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/sgx/hugepage_arena.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include <gtest/gtest.h>
+#include "asylo/test/util/status_matchers.h"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+TEST(HugepageArenaTest, RejectsEmptyArena) {
+  EXPECT_THAT(HugepageArena::Create(0),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+TEST(HugepageArenaTest, MapsAlignedArena) {
+  auto arena_result = HugepageArena::Create(HugepageArena::kHugepageSize + 1);
+  ASYLO_ASSERT_OK(arena_result);
+  auto arena = std::move(arena_result).ValueOrDie();
+  EXPECT_EQ(arena->size(), 2 * HugepageArena::kHugepageSize);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(arena->base()) %
+                HugepageArena::kHugepageSize,
+            0);
+
+  // The whole arena is writable.
+  memset(arena->base(), 0xa5, arena->size());
+  auto bytes = static_cast<const uint8_t *>(arena->base());
+  EXPECT_EQ(bytes[0], 0xa5);
+  EXPECT_EQ(bytes[arena->size() - 1], 0xa5);
+}
+
+}  // namespace
+}  // namespace primitives
+}  // namespace asylo
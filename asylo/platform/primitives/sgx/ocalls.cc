@@ -487,12 +487,24 @@ int ocall_dispatch_untrusted_call(uint64_t selector, void *buffer) {
   sgx_params->output_size = 0;
   sgx_params->output = nullptr;
   ::asylo::primitives::MessageWriter out;
+  auto client = static_cast<::asylo::primitives::SgxEnclaveClient *>(
+      ::asylo::primitives::Client::GetCurrentClient());
+  if (client) {
+    client->CountExitCall();
+  }
   const auto status =
       ::asylo::primitives::Client::ExitCallback(selector, &in, &out);
   if (status.ok()) {
     sgx_params->output_size = out.MessageSize();
     if (sgx_params->output_size > 0) {
-      sgx_params->output = malloc(sgx_params->output_size);
+      // Serialize into the buffer lent by the enclave when the results fit,
+      // which spares the enclave an ocall to free them.
+      if (sgx_params->output_buffer &&
+          sgx_params->output_size <= sgx_params->output_capacity) {
+        sgx_params->output = sgx_params->output_buffer;
+      } else {
+        sgx_params->output = malloc(sgx_params->output_size);
+      }
       out.Serialize(sgx_params->output);
     }
   }
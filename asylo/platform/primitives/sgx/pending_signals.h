@@ -0,0 +1,94 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_SGX_PENDING_SIGNALS_H_
+#define ASYLO_PLATFORM_PRIMITIVES_SGX_PENDING_SIGNALS_H_
+
+#include <atomic>
+#include <cstdint>
+
+namespace asylo {
+namespace primitives {
+
+// A set of host signals pending delivery to an enclave, shared between trusted
+// and untrusted code. The host marks asynchronous signals pending instead of
+// entering the enclave for each of them, and trusted threads take the pending
+// signals and run their handlers at their next enclave entry or exit. Marking
+// a signal that is already pending has no effect, so a burst of the same
+// signal is delivered once, as a non-realtime signal would be by the kernel.
+//
+// Signals are identified by their Linux signal numbers. The set lives in
+// untrusted memory, so trusted code must treat its contents as
+// attacker-controlled. A corrupted set can only add, drop or delay signals,
+// which the untrusted host can already do.
+class PendingSignalSet {
+ public:
+  // Largest signal number the set can hold.
+  static constexpr int kMaxSignal = 64;
+
+  static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+                "std::atomic<uint64_t> is not lock free.");
+
+  PendingSignalSet() : pending_(0) {}
+
+  PendingSignalSet(const PendingSignalSet &other) = delete;
+  PendingSignalSet &operator=(const PendingSignalSet &other) = delete;
+
+  // Returns the bit representing |signum| in a set of signals, or 0 if
+  // |signum| is out of range.
+  static uint64_t Bit(int signum) {
+    if (signum <= 0 || signum > kMaxSignal) {
+      return 0;
+    }
+    return uint64_t{1} << (signum - 1);
+  }
+
+  // Marks |signum| pending. Returns true if it was not pending already, or
+  // false if it was coalesced with a pending instance or is out of range. Safe
+  // to call from a signal handler.
+  bool Add(int signum) {
+    uint64_t bit = Bit(signum);
+    return bit && !(pending_.fetch_or(bit, std::memory_order_release) & bit);
+  }
+
+  // Marks every signal in |signals| pending again, for instance because it is
+  // blocked and could not be delivered.
+  void Restore(uint64_t signals) {
+    if (signals) {
+      pending_.fetch_or(signals, std::memory_order_release);
+    }
+  }
+
+  // Returns true if any signal is pending.
+  bool HasPending() const {
+    return pending_.load(std::memory_order_relaxed) != 0;
+  }
+
+  // Clears the set and returns the signals that were pending.
+  uint64_t TakeAll() {
+    return HasPending() ? pending_.exchange(0, std::memory_order_acquire) : 0;
+  }
+
+ private:
+  std::atomic<uint64_t> pending_;
+};
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_SGX_PENDING_SIGNALS_H_
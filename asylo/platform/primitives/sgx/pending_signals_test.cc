@@ -0,0 +1,111 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/sgx/pending_signals.h"
+
+#include <signal.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+TEST(PendingSignalSetTest, CoalescesPendingSignals) {
+  PendingSignalSet set;
+  EXPECT_FALSE(set.HasPending());
+  EXPECT_EQ(set.TakeAll(), uint64_t{0});
+
+  EXPECT_TRUE(set.Add(SIGALRM));
+  EXPECT_FALSE(set.Add(SIGALRM));
+  EXPECT_TRUE(set.Add(SIGUSR1));
+  EXPECT_TRUE(set.HasPending());
+
+  EXPECT_EQ(set.TakeAll(),
+            PendingSignalSet::Bit(SIGALRM) | PendingSignalSet::Bit(SIGUSR1));
+  EXPECT_FALSE(set.HasPending());
+  EXPECT_TRUE(set.Add(SIGALRM));
+}
+
+TEST(PendingSignalSetTest, RejectsOutOfRangeSignals) {
+  PendingSignalSet set;
+  EXPECT_EQ(PendingSignalSet::Bit(0), uint64_t{0});
+  EXPECT_EQ(PendingSignalSet::Bit(PendingSignalSet::kMaxSignal + 1),
+            uint64_t{0});
+  EXPECT_FALSE(set.Add(0));
+  EXPECT_FALSE(set.Add(-1));
+  EXPECT_FALSE(set.Add(PendingSignalSet::kMaxSignal + 1));
+  EXPECT_TRUE(set.Add(PendingSignalSet::kMaxSignal));
+  EXPECT_EQ(set.TakeAll(), PendingSignalSet::Bit(PendingSignalSet::kMaxSignal));
+}
+
+TEST(PendingSignalSetTest, RestoreKeepsSignalsPending) {
+  PendingSignalSet set;
+  set.Add(SIGUSR2);
+  uint64_t signals = set.TakeAll();
+  set.Restore(signals);
+  EXPECT_FALSE(set.Add(SIGUSR2));
+  EXPECT_EQ(set.TakeAll(), PendingSignalSet::Bit(SIGUSR2));
+}
+
+TEST(PendingSignalSetTest, EachSignalIsTakenOnce) {
+  constexpr int kProducers = 4;
+  constexpr int kSignalsPerProducer = 10000;
+
+  PendingSignalSet set;
+  std::atomic<int> added(0);
+  std::vector<std::thread> producers;
+  for (int i = 0; i < kProducers; i++) {
+    producers.emplace_back([&set, &added, i] {
+      for (int j = 0; j < kSignalsPerProducer; j++) {
+        if (set.Add(i + 1)) {
+          added++;
+        }
+      }
+    });
+  }
+
+  // Every successful Add() must be matched by exactly one TakeAll() returning
+  // the signal.
+  int taken = 0;
+  auto take = [&set, &taken] {
+    uint64_t signals = set.TakeAll();
+    for (int signum = 1; signum <= kProducers; signum++) {
+      if (signals & PendingSignalSet::Bit(signum)) {
+        taken++;
+      }
+    }
+  };
+  for (int i = 0; i < kProducers * kSignalsPerProducer / 10; i++) {
+    take();
+  }
+  for (auto &producer : producers) {
+    producer.join();
+  }
+  take();
+  EXPECT_EQ(taken, added.load());
+  EXPECT_GT(taken, 0);
+}
+
+}  // namespace
+}  // namespace primitives
+}  // namespace asylo
@@ -23,8 +23,8 @@
 
 namespace asylo {
 
-// Helper structure needed for passing 4 parameters to and from SGX layer
-// in a single message, referred to as void *buffer.
+// Helper structure needed for passing parameters to and from SGX layer in a
+// single message, referred to as void *buffer.
 struct SgxParams {
   // Serialized input parameters - if input != nullptr, input_size is its size,
   // otherwise input_size = 0.
@@ -34,6 +34,22 @@ struct SgxParams {
   // otherwise output_size = 0.
   void *output;
   uint64_t output_size;
+  // Untrusted buffer lent by the trusted caller of an exit call for its
+  // results - if output_buffer != nullptr, results of up to output_capacity
+  // bytes are serialized into it, and output is set to output_buffer instead
+  // of a buffer allocated by the untrusted side. Unused by enclave calls.
+  void *output_buffer;
+  uint64_t output_capacity;
+};
+
+// Record, in untrusted memory, of the exit call a donated thread parked in.
+// If thread_id != 0, the host makes the exit call selector with params on
+// behalf of the enclave and then resumes thread_id, otherwise the thread
+// returned.
+struct ParkedExitCall {
+  uint64_t thread_id;
+  uint64_t selector;
+  SgxParams *params;
 };
 
 }  // namespace asylo
@@ -22,6 +22,7 @@
 
 #include "absl/strings/str_cat.h"
 #include "asylo/enclave.pb.h"
+#include "asylo/platform/primitives/sgx/deferred_signals.h"
 #include "asylo/platform/primitives/sgx/untrusted_sgx.h"
 #include "asylo/util/status.h"
 #include "asylo/util/status_macros.h"
@@ -105,6 +106,12 @@ int EnclaveSignalDispatcher::EnterEnclaveAndHandleSignal(int signum,
   if (!client) {
     return -1;
   }
+  // Asynchronous signals are left for the enclave to pick up at its next entry
+  // or exit, which coalesces bursts of them into a single delivery.
+  if (!IsImmediateSignal(signum, info->si_code) &&
+      client->DeferSignal(signum)) {
+    return 0;
+  }
   return client->EnterAndHandleSignal(signum, info->si_code);
 }
 
@@ -53,7 +53,8 @@ class EnclaveSignalDispatcher {
 
   // Looks for the enclave client that registered |signum|, and calls
   // EnterAndHandleSignal() with that enclave client. |signum|, |info| and
-  // |ucontext| are passed into the enclave.
+  // |ucontext| are passed into the enclave. Asynchronous signals are instead
+  // deferred to the next enclave entry or exit if the client supports it.
   int EnterEnclaveAndHandleSignal(int signum, siginfo_t *info, void *ucontext);
 
  private:
@@ -0,0 +1,318 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/sgx/string_functions.h"
+
+#include <immintrin.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/base/attributes.h"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+// Sizes from which REP MOVSB and REP STOSB outperform vector loops. Below them
+// the startup cost of the string instructions dominates.
+constexpr size_t kRepMovsbThreshold = 2048;
+constexpr size_t kRepStosbThreshold = 2048;
+
+using Byte = unsigned char;
+
+// Copies |n| <= 16 bytes. All bytes are loaded before any is stored, so the
+// ranges may overlap.
+inline void CopyUpTo16(Byte *dest, const Byte *src, size_t n) {
+  if (n >= 8) {
+    uint64_t head;
+    uint64_t tail;
+    __builtin_memcpy(&head, src, 8);
+    __builtin_memcpy(&tail, src + n - 8, 8);
+    __builtin_memcpy(dest, &head, 8);
+    __builtin_memcpy(dest + n - 8, &tail, 8);
+  } else if (n >= 4) {
+    uint32_t head;
+    uint32_t tail;
+    __builtin_memcpy(&head, src, 4);
+    __builtin_memcpy(&tail, src + n - 4, 4);
+    __builtin_memcpy(dest, &head, 4);
+    __builtin_memcpy(dest + n - 4, &tail, 4);
+  } else if (n > 0) {
+    Byte first = src[0];
+    Byte middle = src[n / 2];
+    Byte last = src[n - 1];
+    dest[0] = first;
+    dest[n / 2] = middle;
+    dest[n - 1] = last;
+  }
+}
+
+// Copies |n| >= 16 bytes front to back. The last 16 bytes are loaded first and
+// stored last, so |dest| may overlap |src| from below.
+inline void CopyForward16(Byte *dest, const Byte *src, size_t n) {
+  __m128i tail =
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + n - 16));
+  for (size_t i = 0; i + 16 < n; i += 16) {
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i *>(dest + i),
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + n - 16), tail);
+}
+
+// Copies |n| >= 16 bytes back to front. |dest| may overlap |src| from above.
+inline void CopyBackward16(Byte *dest, const Byte *src, size_t n) {
+  __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+  for (size_t i = n; i > 16; i -= 16) {
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i *>(dest + i - 16),
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i - 16)));
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(dest), head);
+}
+
+// The AVX2 helpers below are not inlined into their callers, which are not
+// compiled for AVX2 so that the other variants never execute AVX2
+// instructions.
+
+// Copies |n| > 32 bytes front to back, as CopyForward16() does.
+__attribute__((target("avx2"))) void CopyForward32(Byte *dest, const Byte *src,
+                                                   size_t n) {
+  __m256i tail =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + n - 32));
+  for (size_t i = 0; i + 32 < n; i += 32) {
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i *>(dest + i),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i)));
+  }
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + n - 32), tail);
+}
+
+// Copies |n| > 32 bytes back to front, as CopyBackward16() does.
+__attribute__((target("avx2"))) void CopyBackward32(Byte *dest, const Byte *src,
+                                                    size_t n) {
+  __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+  for (size_t i = n; i > 32; i -= 32) {
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i *>(dest + i - 32),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i - 32)));
+  }
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest), head);
+}
+
+// Copies front to back one byte at a time, as far as the architecture is
+// concerned, so |dest| may overlap |src| from below.
+inline void RepMovsb(Byte *dest, const Byte *src, size_t n) {
+  asm volatile("rep movsb" : "+D"(dest), "+S"(src), "+c"(n) : : "memory");
+}
+
+// Copies front to back. Used both by memcpy and by memmove when |dest| does
+// not overlap |src| from above.
+// Fills |n| > 32 bytes with |value|.
+__attribute__((target("avx2"))) void Fill32(Byte *dest, Byte value, size_t n) {
+  __m256i fill = _mm256_set1_epi8(static_cast<char>(value));
+  for (size_t i = 0; i + 32 < n; i += 32) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + i), fill);
+  }
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + n - 32), fill);
+}
+
+template <bool kErms, bool kAvx2>
+inline void CopyForward(Byte *dest, const Byte *src, size_t n) {
+  if (n <= 16) {
+    CopyUpTo16(dest, src, n);
+  } else if (kErms && n >= kRepMovsbThreshold) {
+    RepMovsb(dest, src, n);
+  } else if (kAvx2 && n > 32) {
+    CopyForward32(dest, src, n);
+  } else {
+    CopyForward16(dest, src, n);
+  }
+}
+
+template <bool kErms, bool kAvx2>
+void *Memcpy(void *dest, const void *src, size_t n) {
+  CopyForward<kErms, kAvx2>(static_cast<Byte *>(dest),
+                            static_cast<const Byte *>(src), n);
+  return dest;
+}
+
+template <bool kErms, bool kAvx2>
+void *Memmove(void *dest, const void *src, size_t n) {
+  Byte *to = static_cast<Byte *>(dest);
+  const Byte *from = static_cast<const Byte *>(src);
+  // Copying front to back is safe unless |dest| starts inside [src, src + n).
+  if (reinterpret_cast<uintptr_t>(to) - reinterpret_cast<uintptr_t>(from) >=
+      n) {
+    CopyForward<kErms, kAvx2>(to, from, n);
+  } else if (n <= 16) {
+    CopyUpTo16(to, from, n);
+  } else if (kAvx2 && n > 32) {
+    CopyBackward32(to, from, n);
+  } else {
+    CopyBackward16(to, from, n);
+  }
+  return dest;
+}
+
+template <bool kErms, bool kAvx2>
+void *Memset(void *dest, int c, size_t n) {
+  Byte *to = static_cast<Byte *>(dest);
+  Byte value = static_cast<Byte>(c);
+  if (n < 16) {
+    if (n >= 8) {
+      uint64_t word = value * 0x0101010101010101ull;
+      __builtin_memcpy(to, &word, 8);
+      __builtin_memcpy(to + n - 8, &word, 8);
+    } else if (n >= 4) {
+      uint32_t word = value * 0x01010101u;
+      __builtin_memcpy(to, &word, 4);
+      __builtin_memcpy(to + n - 4, &word, 4);
+    } else if (n > 0) {
+      to[0] = value;
+      to[n / 2] = value;
+      to[n - 1] = value;
+    }
+  } else if (kErms && n >= kRepStosbThreshold) {
+    asm volatile("rep stosb" : "+D"(to), "+c"(n) : "a"(value) : "memory");
+  } else if (kAvx2 && n > 32) {
+    Fill32(to, value, n);
+  } else {
+    __m128i fill = _mm_set1_epi8(static_cast<char>(value));
+    for (size_t i = 0; i + 16 < n; i += 16) {
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(to + i), fill);
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(to + n - 16), fill);
+  }
+  return dest;
+}
+
+int MemcmpSse2(const void *lhs, const void *rhs, size_t n) {
+  const Byte *a = static_cast<const Byte *>(lhs);
+  const Byte *b = static_cast<const Byte *>(rhs);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i equal = _mm_cmpeq_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)));
+    uint32_t differences =
+        static_cast<uint32_t>(_mm_movemask_epi8(equal)) ^ 0xffff;
+    if (differences) {
+      size_t j = i + __builtin_ctz(differences);
+      return a[j] - b[j];
+    }
+  }
+  for (; i < n; i++) {
+    if (a[i] != b[i]) {
+      return a[i] - b[i];
+    }
+  }
+  return 0;
+}
+
+__attribute__((target("avx2"))) int MemcmpAvx2(const void *lhs,
+                                               const void *rhs, size_t n) {
+  const Byte *a = static_cast<const Byte *>(lhs);
+  const Byte *b = static_cast<const Byte *>(rhs);
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i equal = _mm256_cmpeq_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i)));
+    uint32_t differences = ~static_cast<uint32_t>(_mm256_movemask_epi8(equal));
+    if (differences) {
+      size_t j = i + __builtin_ctz(differences);
+      return a[j] - b[j];
+    }
+  }
+  return i == n ? 0 : MemcmpSse2(a + i, b + i, n - i);
+}
+
+// The strlen implementations read whole aligned blocks, which may extend past
+// the terminator but never into another page.
+ABSL_ATTRIBUTE_NO_SANITIZE_ADDRESS size_t StrlenSse2(const char *str) {
+  uintptr_t address = reinterpret_cast<uintptr_t>(str);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i *block = reinterpret_cast<const __m128i *>(address & ~15);
+  uint32_t nuls =
+      static_cast<uint32_t>(_mm_movemask_epi8(
+          _mm_cmpeq_epi8(_mm_load_si128(block), zero))) >>
+      (address & 15);
+  if (nuls) {
+    return __builtin_ctz(nuls);
+  }
+  while (true) {
+    ++block;
+    nuls = static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(block), zero)));
+    if (nuls) {
+      return reinterpret_cast<const char *>(block) - str + __builtin_ctz(nuls);
+    }
+  }
+}
+
+ABSL_ATTRIBUTE_NO_SANITIZE_ADDRESS __attribute__((target("avx2"))) size_t
+StrlenAvx2(const char *str) {
+  uintptr_t address = reinterpret_cast<uintptr_t>(str);
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i *block = reinterpret_cast<const __m256i *>(address & ~31);
+  uint32_t nuls =
+      static_cast<uint32_t>(_mm256_movemask_epi8(
+          _mm256_cmpeq_epi8(_mm256_load_si256(block), zero))) >>
+      (address & 31);
+  if (nuls) {
+    return __builtin_ctz(nuls);
+  }
+  while (true) {
+    ++block;
+    nuls = static_cast<uint32_t>(_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_load_si256(block), zero)));
+    if (nuls) {
+      return reinterpret_cast<const char *>(block) - str + __builtin_ctz(nuls);
+    }
+  }
+}
+
+constexpr StringFunctions kErmsStringFunctions = {
+    &Memcpy<true, false>, &Memmove<true, false>, &Memset<true, false>,
+    &MemcmpSse2, &StrlenSse2};
+
+constexpr StringFunctions kAvx2StringFunctions = {
+    &Memcpy<false, true>, &Memmove<false, true>, &Memset<false, true>,
+    &MemcmpAvx2, &StrlenAvx2};
+
+constexpr StringFunctions kErmsAvx2StringFunctions = {
+    &Memcpy<true, true>, &Memmove<true, true>, &Memset<true, true>,
+    &MemcmpAvx2, &StrlenAvx2};
+
+}  // namespace
+
+const StringFunctions kBaselineStringFunctions = {
+    &Memcpy<false, false>, &Memmove<false, false>, &Memset<false, false>,
+    &MemcmpSse2, &StrlenSse2};
+
+const StringFunctions *GetStringFunctions(bool erms, bool avx2) {
+  if (avx2) {
+    return erms ? &kErmsAvx2StringFunctions : &kAvx2StringFunctions;
+  }
+  return erms ? &kErmsStringFunctions : &kBaselineStringFunctions;
+}
+
+}  // namespace primitives
+}  // namespace asylo
@@ -0,0 +1,49 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_SGX_STRING_FUNCTIONS_H_
+#define ASYLO_PLATFORM_PRIMITIVES_SGX_STRING_FUNCTIONS_H_
+
+#include <cstddef>
+
+namespace asylo {
+namespace primitives {
+
+// Implementations of memcpy, memmove, memset, memcmp and strlen for a set of
+// x86-64 processor features. The trusted runtime routes the C library
+// functions through one of these tables, chosen when the enclave starts.
+struct StringFunctions {
+  void *(*copy)(void *dest, const void *src, size_t n);
+  void *(*move)(void *dest, const void *src, size_t n);
+  void *(*fill)(void *dest, int c, size_t n);
+  int (*compare)(const void *lhs, const void *rhs, size_t n);
+  size_t (*length)(const char *str);
+};
+
+// Implementations using only SSE2, which every x86-64 processor supports.
+extern const StringFunctions kBaselineStringFunctions;
+
+// Returns the fastest implementations that only use the enabled features.
+// |erms| enables REP MOVSB/STOSB for long strings on processors with Enhanced
+// REP MOVSB/STOSB, and |avx2| enables 32-byte vector loops.
+const StringFunctions *GetStringFunctions(bool erms, bool avx2);
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_SGX_STRING_FUNCTIONS_H_
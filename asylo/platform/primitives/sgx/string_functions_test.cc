@@ -0,0 +1,143 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/sgx/string_functions.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+// Sizes around every threshold the implementations branch on.
+const size_t kSizes[] = {0,   1,   2,   3,   4,   7,   8,   9,    15,   16,
+                         17,  31,  32,  33,  63,  64,  65,  100,  255,  256,
+                         257, 1000, 2047, 2048, 2049, 4096, 5000};
+
+struct Variant {
+  bool erms;
+  bool avx2;
+};
+
+class StringFunctionsTest : public ::testing::TestWithParam<Variant> {
+ protected:
+  void SetUp() override {
+    if (GetParam().avx2 && !__builtin_cpu_supports("avx2")) {
+      GTEST_SKIP() << "AVX2 is not supported";
+    }
+    functions_ = GetStringFunctions(GetParam().erms, GetParam().avx2);
+  }
+
+  // Returns a buffer of |size| bytes with a recognizable pattern.
+  static std::vector<uint8_t> Pattern(size_t size) {
+    std::vector<uint8_t> buffer(size);
+    for (size_t i = 0; i < size; i++) {
+      buffer[i] = static_cast<uint8_t>(i * 7 + 3);
+    }
+    return buffer;
+  }
+
+  const StringFunctions *functions_;
+};
+
+TEST_P(StringFunctionsTest, Copy) {
+  for (size_t size : kSizes) {
+    for (size_t offset = 0; offset < 8; offset++) {
+      std::vector<uint8_t> src = Pattern(size + offset);
+      std::vector<uint8_t> dest(size + 16, 0xee);
+      EXPECT_EQ(functions_->copy(dest.data() + 1, src.data() + offset, size),
+                dest.data() + 1);
+      EXPECT_EQ(dest[0], 0xee) << size;
+      EXPECT_EQ(memcmp(dest.data() + 1, src.data() + offset, size), 0) << size;
+      EXPECT_EQ(dest[size + 1], 0xee) << size;
+    }
+  }
+}
+
+TEST_P(StringFunctionsTest, MoveOverlapping) {
+  for (size_t size : kSizes) {
+    for (size_t shift : {1, 7, 16, 33}) {
+      std::vector<uint8_t> expected = Pattern(size + shift);
+      std::vector<uint8_t> buffer = expected;
+      functions_->move(buffer.data() + shift, buffer.data(), size);
+      memmove(expected.data() + shift, expected.data(), size);
+      EXPECT_EQ(buffer, expected) << size << " forward by " << shift;
+
+      expected = Pattern(size + shift);
+      buffer = expected;
+      functions_->move(buffer.data(), buffer.data() + shift, size);
+      memmove(expected.data(), expected.data() + shift, size);
+      EXPECT_EQ(buffer, expected) << size << " backward by " << shift;
+    }
+  }
+}
+
+TEST_P(StringFunctionsTest, Fill) {
+  for (size_t size : kSizes) {
+    std::vector<uint8_t> buffer(size + 2, 0xee);
+    EXPECT_EQ(functions_->fill(buffer.data() + 1, 0x1a5, size),
+              buffer.data() + 1);
+    std::vector<uint8_t> expected(size + 2, 0xa5);
+    expected.front() = 0xee;
+    expected.back() = 0xee;
+    EXPECT_EQ(buffer, expected) << size;
+  }
+}
+
+TEST_P(StringFunctionsTest, Compare) {
+  for (size_t size : kSizes) {
+    std::vector<uint8_t> lhs = Pattern(size);
+    std::vector<uint8_t> rhs = lhs;
+    EXPECT_EQ(functions_->compare(lhs.data(), rhs.data(), size), 0);
+    for (size_t i : {size_t{0}, size / 2, size - 1}) {
+      if (i >= size) {
+        continue;
+      }
+      rhs = lhs;
+      rhs[i] = lhs[i] + 1;
+      EXPECT_LT(functions_->compare(lhs.data(), rhs.data(), size), 0) << size;
+      EXPECT_GT(functions_->compare(rhs.data(), lhs.data(), size), 0) << size;
+    }
+  }
+}
+
+TEST_P(StringFunctionsTest, Length) {
+  for (size_t size : kSizes) {
+    for (size_t offset = 0; offset < 40; offset++) {
+      std::string str(offset + size + 1, '\0');
+      memset(&str[offset], 'x', size);
+      EXPECT_EQ(functions_->length(str.data() + offset), size);
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(AllVariants, StringFunctionsTest,
+                         ::testing::Values(Variant{false, false},
+                                           Variant{true, false},
+                                           Variant{false, true},
+                                           Variant{true, true}));
+
+}  // namespace
+}  // namespace primitives
+}  // namespace asylo
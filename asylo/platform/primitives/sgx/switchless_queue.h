@@ -0,0 +1,173 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_SGX_SWITCHLESS_QUEUE_H_
+#define ASYLO_PLATFORM_PRIMITIVES_SGX_SWITCHLESS_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace asylo {
+namespace primitives {
+
+// A fixed-capacity array of request slots shared between trusted and untrusted
+// code, used to dispatch calls across the enclave boundary without an enclave
+// transition. Producers claim a free slot, fill it in and post it. Consumers
+// running on the other side of the boundary poll for posted slots, execute the
+// request and mark it done. The producer then collects the result and releases
+// the slot.
+//
+// The queue lives in untrusted memory, so its contents must be treated as
+// attacker-controlled by trusted code. All slot indices are reduced modulo a
+// capacity fixed at compile time, so a corrupted queue cannot cause the caller
+// to access memory outside the queue object itself. A misbehaving consumer can
+// only delay or fail a request, which is no worse than what an untrusted host
+// can already do to a regular enclave exit.
+class SwitchlessQueue {
+ public:
+  // Maximum number of requests in flight at any time.
+  static constexpr size_t kCapacity = 64;
+
+  // States of a queue slot. A slot moves through these states in order, except
+  // that a producer may withdraw a posted request that has not yet been picked
+  // up by a consumer, moving the slot from kPosted back to kReserved.
+  enum SlotState : uint32_t {
+    kFree = 0,      // Available to producers.
+    kReserved = 1,  // Owned by a producer, not yet visible to consumers.
+    kPosted = 2,    // Waiting for a consumer.
+    kRunning = 3,   // Owned by a consumer executing the request.
+    kDone = 4,      // Request complete, result waiting for the producer.
+  };
+
+  // A single request. Each slot is padded to the size of a cache line so that
+  // producers and consumers spinning on distinct slots do not contend.
+  struct Slot {
+    std::atomic<uint32_t> state;
+    int32_t result;
+    uint64_t selector;
+    void *params;
+    uint8_t padding[40];
+  };
+
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+                "std::atomic<uint32_t> is not lock free.");
+  static_assert(sizeof(Slot) == 64, "Slot must be sizeof a cache line.");
+
+  SwitchlessQueue() : closed_(0) {
+    for (size_t i = 0; i < kCapacity; i++) {
+      slots_[i].state.store(kFree, std::memory_order_relaxed);
+      slots_[i].result = 0;
+      slots_[i].selector = 0;
+      slots_[i].params = nullptr;
+    }
+  }
+
+  SwitchlessQueue(const SwitchlessQueue &other) = delete;
+  SwitchlessQueue &operator=(const SwitchlessQueue &other) = delete;
+
+  // Returns the slot at |index|, which is reduced modulo kCapacity.
+  Slot *slot(size_t index) { return &slots_[index % kCapacity]; }
+
+  // Producer interface.
+
+  // Claims a free slot and returns its index, or returns -1 if every slot is
+  // in use.
+  int Reserve() {
+    for (size_t i = 0; i < kCapacity; i++) {
+      uint32_t expected = kFree;
+      if (slots_[i].state.compare_exchange_strong(
+              expected, kReserved, std::memory_order_acquire,
+              std::memory_order_relaxed)) {
+        return static_cast<int>(i);
+      }
+    }
+    return -1;
+  }
+
+  // Publishes a reserved slot to consumers.
+  void Post(size_t index) {
+    slot(index)->state.store(kPosted, std::memory_order_release);
+  }
+
+  // Attempts to take back a posted request before a consumer picks it up.
+  // Returns true if the request was withdrawn, in which case the slot is
+  // reserved again by the caller.
+  bool Withdraw(size_t index) {
+    uint32_t expected = kPosted;
+    return slot(index)->state.compare_exchange_strong(
+        expected, kReserved, std::memory_order_acquire,
+        std::memory_order_relaxed);
+  }
+
+  // Returns true if the request in the slot at |index| is still waiting for a
+  // consumer.
+  bool IsPosted(size_t index) {
+    return slot(index)->state.load(std::memory_order_acquire) == kPosted;
+  }
+
+  // Returns true if the request in the slot at |index| has completed.
+  bool IsDone(size_t index) {
+    return slot(index)->state.load(std::memory_order_acquire) == kDone;
+  }
+
+  // Returns a reserved or completed slot to the pool of free slots.
+  void Release(size_t index) {
+    slot(index)->state.store(kFree, std::memory_order_release);
+  }
+
+  // Consumer interface.
+
+  // Claims a posted request and returns its index, or returns -1 if there is
+  // no request waiting.
+  int Take() {
+    for (size_t i = 0; i < kCapacity; i++) {
+      if (slots_[i].state.load(std::memory_order_relaxed) != kPosted) {
+        continue;
+      }
+      uint32_t expected = kPosted;
+      if (slots_[i].state.compare_exchange_strong(
+              expected, kRunning, std::memory_order_acquire,
+              std::memory_order_relaxed)) {
+        return static_cast<int>(i);
+      }
+    }
+    return -1;
+  }
+
+  // Marks the request at |index| as complete with |result|.
+  void Complete(size_t index, int32_t result) {
+    slot(index)->result = result;
+    slot(index)->state.store(kDone, std::memory_order_release);
+  }
+
+  // Signals consumers to stop polling the queue.
+  void Close() { closed_.store(1, std::memory_order_release); }
+
+  // Returns true if the queue has been closed.
+  bool IsClosed() const { return closed_.load(std::memory_order_acquire); }
+
+ private:
+  Slot slots_[kCapacity];
+  std::atomic<uint32_t> closed_;
+};
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_SGX_SWITCHLESS_QUEUE_H_
@@ -0,0 +1,137 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/sgx/switchless_queue.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+TEST(SwitchlessQueueTest, PostTakeComplete) {
+  SwitchlessQueue queue;
+  EXPECT_EQ(queue.Take(), -1);
+
+  int index = queue.Reserve();
+  ASSERT_GE(index, 0);
+  queue.slot(index)->selector = 42;
+  EXPECT_EQ(queue.Take(), -1);
+
+  queue.Post(index);
+  EXPECT_TRUE(queue.IsPosted(index));
+  EXPECT_EQ(queue.Take(), index);
+  EXPECT_FALSE(queue.IsPosted(index));
+  EXPECT_EQ(queue.slot(index)->selector, 42);
+  EXPECT_FALSE(queue.IsDone(index));
+
+  queue.Complete(index, 7);
+  EXPECT_TRUE(queue.IsDone(index));
+  EXPECT_EQ(queue.slot(index)->result, 7);
+  queue.Release(index);
+  EXPECT_EQ(queue.Reserve(), index);
+}
+
+TEST(SwitchlessQueueTest, WithdrawOnlyBeforeTake) {
+  SwitchlessQueue queue;
+  int index = queue.Reserve();
+  queue.Post(index);
+  EXPECT_TRUE(queue.Withdraw(index));
+  EXPECT_EQ(queue.Take(), -1);
+
+  queue.Post(index);
+  EXPECT_EQ(queue.Take(), index);
+  EXPECT_FALSE(queue.Withdraw(index));
+}
+
+TEST(SwitchlessQueueTest, ReserveFailsWhenFull) {
+  SwitchlessQueue queue;
+  for (size_t i = 0; i < SwitchlessQueue::kCapacity; i++) {
+    EXPECT_GE(queue.Reserve(), 0);
+  }
+  EXPECT_EQ(queue.Reserve(), -1);
+  queue.Release(3);
+  EXPECT_EQ(queue.Reserve(), 3);
+}
+
+TEST(SwitchlessQueueTest, SlotIndexIsBounded) {
+  SwitchlessQueue queue;
+  EXPECT_EQ(queue.slot(SwitchlessQueue::kCapacity + 5), queue.slot(5));
+}
+
+TEST(SwitchlessQueueTest, ConcurrentProducersAndConsumers) {
+  constexpr int kProducers = 4;
+  constexpr int kConsumers = 2;
+  constexpr int kRequestsPerProducer = 500;
+
+  SwitchlessQueue queue;
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < kConsumers; i++) {
+    consumers.emplace_back([&queue] {
+      while (!queue.IsClosed()) {
+        int index = queue.Take();
+        if (index < 0) {
+          std::this_thread::yield();
+          continue;
+        }
+        queue.Complete(index,
+                       static_cast<int32_t>(queue.slot(index)->selector * 2));
+      }
+    });
+  }
+
+  std::atomic<int> failures(0);
+  std::vector<std::thread> producers;
+  for (int i = 0; i < kProducers; i++) {
+    producers.emplace_back([&queue, &failures, i] {
+      for (int j = 0; j < kRequestsPerProducer; j++) {
+        int index;
+        while ((index = queue.Reserve()) < 0) {
+          std::this_thread::yield();
+        }
+        uint64_t selector = i * kRequestsPerProducer + j;
+        queue.slot(index)->selector = selector;
+        queue.Post(index);
+        while (!queue.IsDone(index)) {
+          std::this_thread::yield();
+        }
+        if (queue.slot(index)->result != static_cast<int32_t>(selector * 2)) {
+          failures++;
+        }
+        queue.Release(index);
+      }
+    });
+  }
+
+  for (auto &producer : producers) {
+    producer.join();
+  }
+  queue.Close();
+  for (auto &consumer : consumers) {
+    consumer.join();
+  }
+  EXPECT_EQ(failures.load(), 0);
+}
+
+}  // namespace
+}  // namespace primitives
+}  // namespace asylo
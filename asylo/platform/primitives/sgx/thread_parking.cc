@@ -0,0 +1,566 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/sgx/thread_parking.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include "asylo/platform/core/trusted_spin_lock.h"
+#include "asylo/platform/posix/memory/thread_cache_malloc.h"
+#include "asylo/platform/primitives/sgx/generated_bridge_t.h"
+#include "asylo/platform/primitives/trusted_primitives.h"
+#include "asylo/platform/primitives/trusted_runtime.h"
+#include "asylo/util/lock_guard.h"
+#include "include/sgx_trts.h"
+
+// Saves the callee-saved registers and floating point control state of the
+// running thread on its stack and its stack pointer in |save_sp|, then sets the
+// thread pointer to |thread_pointer| and restores the thread whose stack
+// pointer is |load_sp|.
+extern "C" void asylo_switch_parkable_thread(void **save_sp, void *load_sp,
+                                             void *thread_pointer);
+
+// First code run by a parkable thread, which calls the function in r13 with
+// the argument in r12.
+extern "C" void asylo_start_parkable_thread();
+
+asm(R"(
+    .pushsection .text
+    .p2align 4
+    .globl asylo_switch_parkable_thread
+    .hidden asylo_switch_parkable_thread
+    .type asylo_switch_parkable_thread, @function
+asylo_switch_parkable_thread:
+    pushq %rbp
+    pushq %rbx
+    pushq %r12
+    pushq %r13
+    pushq %r14
+    pushq %r15
+    subq $8, %rsp
+    stmxcsr (%rsp)
+    fnstcw 4(%rsp)
+    movq %rsp, (%rdi)
+    wrfsbase %rdx
+    movq %rsi, %rsp
+    ldmxcsr (%rsp)
+    fldcw 4(%rsp)
+    addq $8, %rsp
+    popq %r15
+    popq %r14
+    popq %r13
+    popq %r12
+    popq %rbx
+    popq %rbp
+    ret
+    .size asylo_switch_parkable_thread, .-asylo_switch_parkable_thread
+
+    .p2align 4
+    .globl asylo_start_parkable_thread
+    .hidden asylo_start_parkable_thread
+    .type asylo_start_parkable_thread, @function
+asylo_start_parkable_thread:
+    movq %r12, %rdi
+    callq *%r13
+    ud2
+    .size asylo_start_parkable_thread, .-asylo_start_parkable_thread
+    .popsection
+)");
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+constexpr size_t kPageSize = 4096;
+
+// Written at the lowest address of the stack of each parkable thread, and
+// checked whenever the thread switches back to its TCS.
+constexpr uint64_t kStackSentinel = 0x7061726b65647374;
+
+// Floating point control state a parkable thread starts with, as set by the
+// x86-64 ABI.
+constexpr uint32_t kInitialMxcsr = 0x1f80;
+constexpr uint32_t kInitialFpuControlWord = 0x037f;
+
+// Number of consecutive polls finding nothing to do after which an idle green
+// thread worker sleeps between polls instead of spinning, and the sleep time.
+constexpr int kIdleWorkerPolls = 4096;
+constexpr useconds_t kIdleWorkerSleepMicros = 20;
+
+struct ParkableThread {
+  enum class State { kRunning, kParked, kDone };
+
+  uint64_t id;
+  std::function<int()> body;
+  int result;
+
+  // Host thread ID of the green thread worker a green thread started on.
+  pid_t host_tid;
+
+  // Memory of the stack and of the thread local storage, and the thread
+  // pointer given by the SGX runtime for the latter.
+  void *stack;
+  void *storage;
+  void *thread_pointer;
+
+  // Stack pointers saved by the parkable thread and by the thread of the TCS
+  // it runs on, when each switches to the other.
+  void *stack_pointer;
+  void *tcs_stack_pointer;
+  void *tcs_thread_pointer;
+
+  // Exit call made by the host on behalf of the thread while it is parked.
+  uint64_t selector;
+  SgxParams *params;
+
+  // Set to kParked once the thread switched back to its TCS for good, after
+  // which any TCS may resume it.
+  std::atomic<State> state;
+};
+
+// Stack size of new parkable threads, or 0 while thread parking is disabled.
+std::atomic<size_t> parkable_stack_size{0};
+
+// Guards |parkable_threads|, which maps the id of each parkable thread, running
+// or parked, to the thread.
+TrustedSpinLock parkable_threads_lock(/*is_recursive=*/false);
+std::unordered_map<uint64_t, ParkableThread *> *parkable_threads = nullptr;
+uint64_t next_thread_id = 1;
+
+// State of green threads. Workers take threads from |ready_threads| to run
+// them, and make their blocking exit calls through |exit_call_queue|, or
+// themselves if it is nullptr.
+struct {
+  std::atomic<bool> enabled{false};
+  std::atomic<bool> stopped{false};
+
+  // Number of threads the host is about to donate to become workers.
+  std::atomic<int> pending_workers{0};
+
+  SwitchlessQueue *exit_call_queue = nullptr;
+
+  // Number of times a posted exit call is polled before the worker takes it
+  // back and makes it itself.
+  uint32_t max_polls = 0;
+
+  // Guards |ready_threads|.
+  TrustedSpinLock ready_threads_lock{/*is_recursive=*/false};
+  std::deque<ParkableThread *> *ready_threads = nullptr;
+} green_threads;
+
+// The parkable thread running, in the thread local storage of each parkable
+// thread, and nullptr for the threads of the TCSes.
+thread_local ParkableThread *current_thread = nullptr;
+
+void *CurrentThreadPointer() {
+  void *thread_pointer;
+  asm volatile("movq %%fs:0, %0" : "=r"(thread_pointer));
+  return thread_pointer;
+}
+
+void SwitchToTcs(ParkableThread *thread) {
+  asylo_switch_parkable_thread(&thread->stack_pointer,
+                               thread->tcs_stack_pointer,
+                               thread->tcs_thread_pointer);
+}
+
+void RunParkableThread(ParkableThread *thread) {
+  current_thread = thread;
+  try {
+    thread->result = thread->body();
+  } catch (...) {
+    TrustedPrimitives::BestEffortAbort(
+        "Uncaught exception in donated thread: failed to start the thread.");
+  }
+  thread->body = nullptr;
+  FlushThreadAllocationCache();
+  thread->state.store(ParkableThread::State::kDone, std::memory_order_relaxed);
+  SwitchToTcs(thread);
+  TrustedPrimitives::BestEffortAbort("Returned thread was resumed.");
+}
+
+void DeleteParkableThread(ParkableThread *thread) {
+  {
+    LockGuard lock(&parkable_threads_lock);
+    parkable_threads->erase(thread->id);
+  }
+  free(thread->storage);
+  free(thread->stack);
+  delete thread;
+}
+
+// Returns a new parkable thread running |body|, or nullptr if the enclave is
+// out of memory for it.
+ParkableThread *CreateParkableThread(const std::function<int()> &body,
+                                     size_t stack_size) {
+  size_t storage_size = sgx_fiber_size();
+  void *stack = nullptr;
+  void *storage = nullptr;
+  if (posix_memalign(&stack, kPageSize, stack_size) != 0) {
+    return nullptr;
+  }
+  if (posix_memalign(&storage, kPageSize, storage_size) != 0) {
+    free(stack);
+    return nullptr;
+  }
+  uintptr_t stack_base = reinterpret_cast<uintptr_t>(stack) + stack_size;
+  void *thread_pointer =
+      sgx_init_fiber(storage, storage_size,
+                     reinterpret_cast<void *>(stack_base), stack);
+  if (!thread_pointer) {
+    free(storage);
+    free(stack);
+    return nullptr;
+  }
+  *reinterpret_cast<uint64_t *>(stack) = kStackSentinel;
+
+  auto thread = new ParkableThread();
+  thread->body = body;
+  thread->result = 0;
+  thread->host_tid = 0;
+  thread->stack = stack;
+  thread->storage = storage;
+  thread->thread_pointer = thread_pointer;
+  thread->state.store(ParkableThread::State::kRunning,
+                      std::memory_order_relaxed);
+
+  // Lay out the frame asylo_switch_parkable_thread restores, returning into
+  // asylo_start_parkable_thread with a 16-byte aligned stack.
+  auto frame = reinterpret_cast<uint64_t *>(stack_base & ~uintptr_t{15}) - 8;
+  frame[0] = kInitialMxcsr | (uint64_t{kInitialFpuControlWord} << 32);
+  frame[1] = 0;  // r15
+  frame[2] = 0;  // r14
+  frame[3] = reinterpret_cast<uint64_t>(&RunParkableThread);  // r13
+  frame[4] = reinterpret_cast<uint64_t>(thread);               // r12
+  frame[5] = 0;  // rbx
+  frame[6] = 0;  // rbp
+  frame[7] = reinterpret_cast<uint64_t>(&asylo_start_parkable_thread);
+  thread->stack_pointer = frame;
+
+  LockGuard lock(&parkable_threads_lock);
+  if (!parkable_threads) {
+    parkable_threads = new std::unordered_map<uint64_t, ParkableThread *>();
+  }
+  thread->id = next_thread_id++;
+  parkable_threads->emplace(thread->id, thread);
+  return thread;
+}
+
+// Runs |thread| on the current TCS until it returns or switches back for an
+// exit call. Returns false if the SGX runtime cannot bind it to the TCS.
+bool SwitchIntoThread(ParkableThread *thread) {
+  if (sgx_bind_fiber(thread->thread_pointer) != 0) {
+    return false;
+  }
+  thread->tcs_thread_pointer = CurrentThreadPointer();
+  asylo_switch_parkable_thread(&thread->tcs_stack_pointer,
+                               thread->stack_pointer, thread->thread_pointer);
+  sgx_unbind_fiber(thread->thread_pointer);
+  if (*reinterpret_cast<uint64_t *>(thread->stack) != kStackSentinel) {
+    TrustedPrimitives::BestEffortAbort(
+        "Stack overflow in a parkable donated thread.");
+  }
+  return true;
+}
+
+// Runs |thread| on the current TCS until it returns or parks.
+PrimitiveStatus RunOnCurrentTcs(ParkableThread *thread,
+                                ParkedExitCall *parked) {
+  if (!SwitchIntoThread(thread)) {
+    return {error::GoogleError::INTERNAL,
+            "Could not run the donated thread on the current TCS."};
+  }
+
+  if (thread->state.load(std::memory_order_relaxed) ==
+      ParkableThread::State::kDone) {
+    int result = thread->result;
+    DeleteParkableThread(thread);
+    parked->thread_id = 0;
+    return PrimitiveStatus(result);
+  }
+  // Once parked, the thread may be resumed on another TCS and must not be
+  // touched here anymore.
+  parked->selector = thread->selector;
+  parked->params = thread->params;
+  parked->thread_id = thread->id;
+  thread->state.store(ParkableThread::State::kParked,
+                      std::memory_order_release);
+  return PrimitiveStatus::OkStatus();
+}
+
+void MakeReady(ParkableThread *thread) {
+  LockGuard lock(&green_threads.ready_threads_lock);
+  green_threads.ready_threads->push_back(thread);
+}
+
+ParkableThread *TakeReadyThread() {
+  LockGuard lock(&green_threads.ready_threads_lock);
+  if (green_threads.ready_threads->empty()) {
+    return nullptr;
+  }
+  ParkableThread *thread = green_threads.ready_threads->front();
+  green_threads.ready_threads->pop_front();
+  return thread;
+}
+
+// Makes the exit call a green thread switched back for on the calling worker.
+void MakeExitCall(ParkableThread *thread) {
+  int result;
+  if (ocall_dispatch_untrusted_call(&result, thread->selector,
+                                    thread->params) != SGX_SUCCESS) {
+    TrustedPrimitives::BestEffortAbort(
+        "Exit call of a green thread failed.");
+  }
+}
+
+// An exit call posted to the exit call queue for a green thread.
+struct PostedExitCall {
+  ParkableThread *thread;
+  int slot;
+  uint32_t polls;
+};
+
+// Makes the green threads whose exit call completed ready again, and makes the
+// exit calls the host did not pick up in time on the calling worker. Returns
+// true if any thread became ready.
+bool PollExitCalls(std::vector<PostedExitCall> *posted) {
+  SwitchlessQueue *queue = green_threads.exit_call_queue;
+  bool progress = false;
+  for (size_t i = 0; i < posted->size();) {
+    PostedExitCall &call = (*posted)[i];
+    if (queue->IsDone(call.slot)) {
+      queue->Release(call.slot);
+    } else if (++call.polls > green_threads.max_polls &&
+               queue->Withdraw(call.slot)) {
+      // The host workers are all busy, possibly blocked in other exit calls.
+      queue->Release(call.slot);
+      MakeExitCall(call.thread);
+    } else {
+      i++;
+      continue;
+    }
+    MakeReady(call.thread);
+    (*posted)[i] = posted->back();
+    posted->pop_back();
+    progress = true;
+  }
+  return progress;
+}
+
+// Runs green threads on the current TCS until green threads are stopped.
+int ServeGreenThreads(pid_t tid) {
+  SwitchlessQueue *queue = green_threads.exit_call_queue;
+  std::vector<PostedExitCall> posted;
+  int idle_polls = 0;
+  while (!green_threads.stopped.load(std::memory_order_acquire)) {
+    bool progress = queue && PollExitCalls(&posted);
+    ParkableThread *thread = TakeReadyThread();
+    if (!thread) {
+      if (progress) {
+        continue;
+      }
+      if (++idle_polls < kIdleWorkerPolls) {
+        enc_pause();
+      } else {
+        usleep(kIdleWorkerSleepMicros);
+      }
+      continue;
+    }
+    idle_polls = 0;
+    if (thread->host_tid == 0) {
+      thread->host_tid = tid;
+    }
+    if (!SwitchIntoThread(thread)) {
+      TrustedPrimitives::BestEffortAbort(
+          "Could not run a green thread on the current TCS.");
+    }
+    if (thread->state.load(std::memory_order_relaxed) ==
+        ParkableThread::State::kDone) {
+      DeleteParkableThread(thread);
+      continue;
+    }
+    // The thread switched back to make a blocking exit call. Hand the call to
+    // the host workers and run other green threads meanwhile.
+    int slot = queue ? queue->Reserve() : -1;
+    if (slot < 0) {
+      MakeExitCall(thread);
+      MakeReady(thread);
+      continue;
+    }
+    queue->slot(slot)->selector = thread->selector;
+    queue->slot(slot)->params = thread->params;
+    queue->Post(slot);
+    posted.push_back({thread, slot, 0});
+  }
+  return 0;
+}
+
+}  // namespace
+
+PrimitiveStatus EnableThreadParking(size_t stack_size) {
+  if (sgx_fiber_size() == 0) {
+    return {error::GoogleError::FAILED_PRECONDITION,
+            "The SGX runtime cannot run parkable threads."};
+  }
+  if (stack_size == 0) {
+    struct EnclaveMemoryLayout layout;
+    enc_get_memory_layout(&layout);
+    stack_size = reinterpret_cast<uintptr_t>(layout.stack_base) -
+                 reinterpret_cast<uintptr_t>(layout.stack_limit);
+  }
+  stack_size = (stack_size + kPageSize - 1) & ~(kPageSize - 1);
+  parkable_stack_size.store(stack_size, std::memory_order_release);
+  return PrimitiveStatus::OkStatus();
+}
+
+PrimitiveStatus RunDonatedThread(const std::function<int()> &body,
+                                 ParkedExitCall *parked) {
+  size_t stack_size = parkable_stack_size.load(std::memory_order_acquire);
+  ParkableThread *thread = nullptr;
+  if (stack_size != 0 && parked) {
+    thread = CreateParkableThread(body, stack_size);
+  }
+  if (!thread) {
+    // Run the thread on the TCS it was donated with.
+    return PrimitiveStatus(body());
+  }
+  return RunOnCurrentTcs(thread, parked);
+}
+
+PrimitiveStatus ResumeParkedThread(uint64_t thread_id,
+                                   ParkedExitCall *parked) {
+  ParkableThread *thread = nullptr;
+  {
+    // Claim the thread under the lock, as a running thread may return and be
+    // deleted at any time.
+    LockGuard lock(&parkable_threads_lock);
+    if (parkable_threads) {
+      auto it = parkable_threads->find(thread_id);
+      if (it != parkable_threads->end()) {
+        thread = it->second;
+      }
+    }
+    if (!thread) {
+      return {error::GoogleError::INVALID_ARGUMENT,
+              "No parked thread with the given id."};
+    }
+    auto expected = ParkableThread::State::kParked;
+    if (!thread->state.compare_exchange_strong(
+            expected, ParkableThread::State::kRunning,
+            std::memory_order_acq_rel)) {
+      return {error::GoogleError::FAILED_PRECONDITION,
+              "The thread with the given id is not parked."};
+    }
+  }
+  return RunOnCurrentTcs(thread, parked);
+}
+
+bool ParkForUntrustedCall(uint64_t selector, SgxParams *params) {
+  ParkableThread *thread = current_thread;
+  if (!thread) {
+    return false;
+  }
+  thread->selector = selector;
+  thread->params = params;
+  SwitchToTcs(thread);
+  // Resumed, possibly on another TCS, once the host made the exit call.
+  return true;
+}
+
+PrimitiveStatus EnableGreenThreads(int num_workers,
+                                   SwitchlessQueue *exit_call_queue,
+                                   uint32_t max_polls) {
+  if (parkable_stack_size.load(std::memory_order_acquire) == 0) {
+    return {error::GoogleError::FAILED_PRECONDITION,
+            "Green threads require thread parking to be enabled."};
+  }
+  if (num_workers <= 0) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "Green threads require at least one worker."};
+  }
+  if (green_threads.enabled.load(std::memory_order_acquire)) {
+    return {error::GoogleError::FAILED_PRECONDITION,
+            "Green threads are already enabled."};
+  }
+  green_threads.exit_call_queue = exit_call_queue;
+  green_threads.max_polls = max_polls;
+  green_threads.ready_threads = new std::deque<ParkableThread *>();
+  green_threads.pending_workers.fetch_add(num_workers,
+                                          std::memory_order_acq_rel);
+  for (int i = 0; i < num_workers; i++) {
+    // Threads created from here on are green threads, so donate the workers
+    // first.
+    if (TrustedPrimitives::CreateThread()) {
+      green_threads.pending_workers.fetch_sub(num_workers - i,
+                                              std::memory_order_acq_rel);
+      if (i == 0) {
+        return {error::GoogleError::RESOURCE_EXHAUSTED,
+                "The host could not donate a green thread worker."};
+      }
+      break;
+    }
+  }
+  green_threads.enabled.store(true, std::memory_order_release);
+  return PrimitiveStatus::OkStatus();
+}
+
+void StopGreenThreads() {
+  green_threads.stopped.store(true, std::memory_order_release);
+}
+
+bool GreenThreadsEnabled() {
+  return green_threads.enabled.load(std::memory_order_acquire);
+}
+
+int CreateGreenThread(const std::function<int(pid_t)> &start_routine) {
+  ParkableThread *thread = CreateParkableThread(
+      nullptr, parkable_stack_size.load(std::memory_order_acquire));
+  if (!thread) {
+    return -1;
+  }
+  thread->body = [thread, start_routine] {
+    return start_routine(thread->host_tid);
+  };
+  MakeReady(thread);
+  return 0;
+}
+
+bool TakeGreenThreadWorker() {
+  int pending = green_threads.pending_workers.load(std::memory_order_acquire);
+  while (pending > 0) {
+    if (green_threads.pending_workers.compare_exchange_weak(
+            pending, pending - 1, std::memory_order_acq_rel)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+PrimitiveStatus RunGreenThreadWorker(pid_t tid) {
+  return PrimitiveStatus(ServeGreenThreads(tid));
+}
+
+}  // namespace primitives
+}  // namespace asylo
@@ -0,0 +1,102 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_SGX_THREAD_PARKING_H_
+#define ASYLO_PLATFORM_PRIMITIVES_SGX_THREAD_PARKING_H_
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "asylo/platform/primitives/primitive_status.h"
+#include "asylo/platform/primitives/sgx/sgx_params.h"
+#include "asylo/platform/primitives/sgx/switchless_queue.h"
+
+namespace asylo {
+namespace primitives {
+
+// Donated threads may run as parkable threads, each with its own stack and
+// thread local storage in the enclave heap. A parkable thread about to block in
+// an exit call switches back to the thread of the TCS it runs on, which leaves
+// the enclave and makes the exit call on the host, freeing the TCS for other
+// threads meanwhile. The host then resumes the parked thread on any TCS.
+//
+// With green threads, pthreads are instead parkable threads created inside the
+// enclave and multiplexed onto a fixed set of donated worker threads. A green
+// thread about to block in an exit call switches back to its worker, which
+// posts the call to the switchless exit call queue and runs other green threads
+// until it completes.
+
+// Runs donated threads as parkable threads from now on, each with a stack of
+// |stack_size| bytes, or as large as the stack of a TCS if |stack_size| is 0.
+// Returns an error if the SGX runtime cannot run user-level threads.
+PrimitiveStatus EnableThreadParking(size_t stack_size);
+
+// Runs |body| for a thread donated to the enclave. If thread parking is
+// enabled, runs it as a parkable thread until it either returns or parks, in
+// which case |parked| receives the exit call the host makes on its behalf
+// before it resumes the thread. Returns the result of |body| once it returned.
+PrimitiveStatus RunDonatedThread(const std::function<int()> &body,
+                                 ParkedExitCall *parked);
+
+// Resumes the parked thread |thread_id| on the current TCS, once the host made
+// its exit call. Returns like RunDonatedThread().
+PrimitiveStatus ResumeParkedThread(uint64_t thread_id, ParkedExitCall *parked);
+
+// Parks the calling thread until the host made the exit call |selector| with
+// |params| on its behalf, or until a green thread worker did so for a green
+// thread. Returns false without parking if the calling thread is not a
+// parkable thread.
+bool ParkForUntrustedCall(uint64_t selector, SgxParams *params);
+
+// Asks the host to donate |num_workers| threads to run green threads, and runs
+// the threads created from now on as green threads. Blocking exit calls of
+// green threads are posted to |exit_call_queue|, and taken back by the worker
+// after |max_polls| polls without a host worker picking them up. If
+// |exit_call_queue| is nullptr, workers make the exit calls themselves. Thread
+// parking must be enabled first.
+PrimitiveStatus EnableGreenThreads(int num_workers,
+                                   SwitchlessQueue *exit_call_queue,
+                                   uint32_t max_polls);
+
+// Makes the green thread workers return once idle. Green threads still running
+// are abandoned.
+void StopGreenThreads();
+
+// Returns true if threads are created as green threads.
+bool GreenThreadsEnabled();
+
+// Creates a green thread running |start_routine|, which is passed the host
+// thread ID of the worker it starts on. Returns 0 on success, or -1 if the
+// enclave is out of memory for it.
+int CreateGreenThread(const std::function<int(pid_t)> &start_routine);
+
+// Returns true if the calling donated thread is meant to become a green thread
+// worker, in which case it must call RunGreenThreadWorker().
+bool TakeGreenThreadWorker();
+
+// Runs green threads on the calling donated thread, whose host thread ID is
+// |tid|, until green threads are stopped.
+PrimitiveStatus RunGreenThreadWorker(pid_t tid);
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_SGX_THREAD_PARKING_H_
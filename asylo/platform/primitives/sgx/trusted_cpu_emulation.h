@@ -0,0 +1,65 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_SGX_TRUSTED_CPU_EMULATION_H_
+#define ASYLO_PLATFORM_PRIMITIVES_SGX_TRUSTED_CPU_EMULATION_H_
+
+#include <cstdint>
+
+#include "asylo/platform/common/enclave_thread_stats.h"
+
+namespace asylo {
+namespace primitives {
+
+// CPUID and RDTSC are not allowed inside SGX1 enclaves and trap with #UD, to be
+// emulated by the exception handlers of the trusted runtime at the cost of an
+// enclave exit and re-entry. The functions below provide the same results
+// without faulting, for trusted code which needs them on a hot path.
+
+// Number of CPUID and RDTSC instructions emulated by the exception handlers.
+struct EmulatedInstructionCounts {
+  uint64_t cpuid_exceptions;
+  uint64_t rdtsc_exceptions;
+};
+
+// Fills |regs| with the EAX, EBX, ECX and EDX results of CPUID for |leaf| and
+// |subleaf|, as cached from the host when the enclave was loaded. Returns false
+// if the leaf is not one the runtime emulates.
+bool ReadCachedCpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4]);
+
+// Returns a timestamp counter value. Executes RDTSC natively on processors
+// which allow it inside enclaves. Otherwise returns the host monotonic clock in
+// nanoseconds read from the host time page, or a counter incremented on every
+// call if the page is not enabled. Values never decrease.
+uint64_t ReadTimestampCounter();
+
+// Returns whether RDTSC is believed to execute natively inside the enclave.
+bool IsNativeRdtscAllowed();
+
+// Returns the number of instructions emulated by the exception handlers so
+// far.
+EmulatedInstructionCounts GetEmulatedInstructionCounts();
+
+// Makes the exception handlers also count emulated instructions in |stats|,
+// which lies in untrusted memory, or stop doing so if |stats| is nullptr.
+void SetEmulatedInstructionStats(EnclaveThreadStats *stats);
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_SGX_TRUSTED_CPU_EMULATION_H_
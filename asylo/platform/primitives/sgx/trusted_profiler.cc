@@ -0,0 +1,235 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/sgx/trusted_profiler.h"
+
+#include <signal.h>
+
+#include <atomic>
+#include <cstdint>
+
+#include "asylo/platform/core/trusted_global_state.h"
+#include "asylo/platform/core/trusted_spin_lock.h"
+#include "asylo/platform/posix/host_time.h"
+#include "asylo/platform/primitives/sgx/enclave_profile.h"
+#include "asylo/platform/primitives/trusted_primitives.h"
+#include "asylo/platform/primitives/trusted_runtime.h"
+#include "asylo/platform/system_call/system_call.h"
+#include "asylo/util/lock_guard.h"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+// Number of distinct stacks recorded between two calls to TakeProfile().
+constexpr size_t kMaxProfileStacks = 1024;
+
+std::atomic<bool> profiling{false};
+
+// Guards |stack_profile|, which is allocated on the first StartProfiling().
+TrustedSpinLock profile_lock(/*is_recursive=*/false);
+StackProfile *stack_profile = nullptr;
+
+// Guards |exit_profile|, which is allocated on the first StartExitProfiling().
+// No exit is made while it is held.
+TrustedSpinLock exit_profile_lock(/*is_recursive=*/false);
+ExitProfile *exit_profile = nullptr;
+
+PrimitiveStatus CheckProfilingEnabled() {
+  StatusOr<const EnclaveConfig *> config = GetEnclaveConfig();
+  if (!config.ok() || !config.ValueOrDie()->enable_profiling()) {
+    return {error::GoogleError::FAILED_PRECONDITION,
+            "Profiling is not enabled in the enclave config."};
+  }
+  return PrimitiveStatus::OkStatus();
+}
+
+// Fills |frames| with the return addresses of the calling thread's stack,
+// relative to the enclave base, and returns their number. Stops at the first
+// frame pointer that leaves the stack of the thread or does not move towards
+// its base, so a corrupted or missing frame chain ends the walk.
+size_t CollectFrames(uint64_t *frames) {
+  struct EnclaveMemoryLayout layout;
+  enc_get_memory_layout(&layout);
+  auto base = reinterpret_cast<uintptr_t>(layout.base);
+  auto stack_base = reinterpret_cast<uintptr_t>(layout.stack_base);
+  auto stack_limit = reinterpret_cast<uintptr_t>(layout.stack_limit);
+
+  auto frame = reinterpret_cast<uintptr_t>(__builtin_frame_address(0));
+  size_t depth = 0;
+  while (depth < kMaxProfileDepth && frame >= stack_limit &&
+         frame + 2 * sizeof(uintptr_t) <= stack_base &&
+         frame % sizeof(uintptr_t) == 0) {
+    auto words = reinterpret_cast<const uintptr_t *>(frame);
+    uintptr_t return_address = words[1];
+    if (!TrustedPrimitives::IsInsideEnclave(
+            reinterpret_cast<void *>(return_address), 1)) {
+      break;
+    }
+    frames[depth++] = return_address - base;
+    if (words[0] <= frame) {
+      break;
+    }
+    frame = words[0];
+  }
+  return depth;
+}
+
+void HandleProfileSignal(int signum, siginfo_t *info, void *ucontext) {
+  if (!profiling.load(std::memory_order_relaxed)) {
+    return;
+  }
+  uint64_t frames[kMaxProfileDepth];
+  size_t depth = CollectFrames(frames);
+  // The signal may be delivered at an exit made while this thread holds the
+  // lock, in which case the sample is dropped rather than deadlocking.
+  if (!profile_lock.TryLock()) {
+    return;
+  }
+  if (stack_profile) {
+    stack_profile->Add(frames, depth);
+  }
+  profile_lock.Unlock();
+}
+
+}  // namespace
+
+namespace trusted_profiler_internal {
+
+std::atomic<bool> exit_profiling{false};
+
+}  // namespace trusted_profiler_internal
+
+PrimitiveStatus StartProfiling() {
+  PrimitiveStatus status = CheckProfilingEnabled();
+  if (!status.ok()) {
+    return status;
+  }
+  {
+    LockGuard lock(&profile_lock);
+    if (!stack_profile) {
+      stack_profile = new StackProfile(kMaxProfileStacks);
+    }
+  }
+  struct sigaction action = {};
+  action.sa_sigaction = HandleProfileSignal;
+  action.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(SIGPROF, &action, nullptr) != 0) {
+    return {error::GoogleError::INTERNAL,
+            "Could not register the profiling signal handler."};
+  }
+  profiling.store(true, std::memory_order_relaxed);
+  return PrimitiveStatus::OkStatus();
+}
+
+void StopProfiling() { profiling.store(false, std::memory_order_relaxed); }
+
+void TakeProfile(MessageWriter *out) {
+  std::vector<ProfileSample> samples;
+  uint64_t dropped = 0;
+  {
+    LockGuard lock(&profile_lock);
+    if (stack_profile) {
+      dropped = stack_profile->dropped();
+      samples = stack_profile->Take();
+    }
+  }
+  out->Push<uint64_t>(dropped);
+  for (const ProfileSample &sample : samples) {
+    out->Push<uint64_t>(sample.count);
+    out->Push<uint64_t>(sample.frames.size());
+    for (uint64_t frame : sample.frames) {
+      out->Push<uint64_t>(frame);
+    }
+  }
+}
+
+PrimitiveStatus StartExitProfiling(size_t capacity) {
+  PrimitiveStatus status = CheckProfilingEnabled();
+  if (!status.ok()) {
+    return status;
+  }
+  if (capacity == 0) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "Exit profile capacity must be positive."};
+  }
+  {
+    LockGuard lock(&exit_profile_lock);
+    if (!exit_profile) {
+      exit_profile = new ExitProfile(capacity);
+    }
+  }
+  trusted_profiler_internal::exit_profiling.store(true,
+                                                  std::memory_order_relaxed);
+  return PrimitiveStatus::OkStatus();
+}
+
+void StopExitProfiling() {
+  trusted_profiler_internal::exit_profiling.store(false,
+                                                  std::memory_order_relaxed);
+}
+
+void TakeExitProfile(MessageWriter *out) {
+  std::vector<ExitSample> samples;
+  uint64_t dropped = 0;
+  {
+    LockGuard lock(&exit_profile_lock);
+    if (exit_profile) {
+      dropped = exit_profile->dropped();
+      samples = exit_profile->Take();
+    }
+  }
+  out->Push<uint64_t>(dropped);
+  for (const ExitSample &sample : samples) {
+    out->Push<uint64_t>(sample.exit);
+    out->Push<uint64_t>(sample.count);
+    out->Push<uint64_t>(sample.nanos);
+    out->Push<uint64_t>(sample.frames.size());
+    for (uint64_t frame : sample.frames) {
+      out->Push<uint64_t>(frame);
+    }
+  }
+}
+
+void ScopedExitProfile::Begin(uint64_t selector) {
+  int sysno = system_call::CurrentSystemCall();
+  exit_ = sysno >= 0 ? kExitProfileSyscallBit | static_cast<uint64_t>(sysno)
+                     : selector;
+  depth_ = CollectFrames(frames_);
+  if (!PeekHostTimePage(&start_nanos_)) {
+    start_nanos_ = -1;
+  }
+  active_ = true;
+}
+
+void ScopedExitProfile::End() {
+  int64_t end_nanos;
+  uint64_t nanos = 0;
+  if (start_nanos_ >= 0 && PeekHostTimePage(&end_nanos) &&
+      end_nanos > start_nanos_) {
+    nanos = end_nanos - start_nanos_;
+  }
+  LockGuard lock(&exit_profile_lock);
+  if (exit_profile) {
+    exit_profile->Add(exit_, frames_, depth_, nanos);
+  }
+}
+
+}  // namespace primitives
+}  // namespace asylo
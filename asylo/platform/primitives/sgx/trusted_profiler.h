@@ -0,0 +1,104 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_SGX_TRUSTED_PROFILER_H_
+#define ASYLO_PLATFORM_PRIMITIVES_SGX_TRUSTED_PROFILER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "asylo/platform/primitives/primitive_status.h"
+#include "asylo/platform/primitives/sgx/enclave_profile.h"
+#include "asylo/platform/primitives/util/message.h"
+
+namespace asylo {
+namespace primitives {
+
+// Starts sampling the stacks of enclave threads on every SIGPROF delivered to
+// the enclave. The sample is taken on the thread the signal is delivered to,
+// by walking frame pointers from the point of delivery, so only code built
+// with frame pointers yields full stacks. Fails unless the enclave config sets
+// enable_profiling, since profiles reveal the control flow of the enclave to
+// the host.
+PrimitiveStatus StartProfiling();
+
+// Stops sampling. Samples recorded so far are kept until taken.
+void StopProfiling();
+
+// Pushes the number of samples dropped for lack of room, then for each sampled
+// stack its sample count, its depth and its frames as enclave-relative return
+// addresses, and clears the recorded samples.
+void TakeProfile(MessageWriter *out);
+
+// Starts attributing every exit call made by enclave threads to the trusted
+// stack making it, in a table of up to |capacity| distinct stacks allocated on
+// the first call. Exits made to dispatch a system call are attributed to the
+// system call. Time outside the enclave is only measured if the host time page
+// is enabled. Fails unless the enclave config sets enable_profiling.
+PrimitiveStatus StartExitProfiling(size_t capacity);
+
+// Stops attributing exits. Exits recorded so far are kept until taken.
+void StopExitProfiling();
+
+// Pushes the number of exits dropped for lack of room, then for each exit and
+// stack its exit, count, time outside the enclave in nanoseconds, depth and
+// frames as enclave-relative return addresses, and clears the recorded exits.
+void TakeExitProfile(MessageWriter *out);
+
+namespace trusted_profiler_internal {
+
+extern std::atomic<bool> exit_profiling;
+
+}  // namespace trusted_profiler_internal
+
+// Records the exit call |selector| made in the scope of this object while exit
+// profiling is started. Costs a single atomic load when it is not.
+class ScopedExitProfile {
+ public:
+  explicit ScopedExitProfile(uint64_t selector) {
+    if (trusted_profiler_internal::exit_profiling.load(
+            std::memory_order_relaxed)) {
+      Begin(selector);
+    }
+  }
+
+  ScopedExitProfile(const ScopedExitProfile &other) = delete;
+  ScopedExitProfile &operator=(const ScopedExitProfile &other) = delete;
+
+  ~ScopedExitProfile() {
+    if (active_) {
+      End();
+    }
+  }
+
+ private:
+  void Begin(uint64_t selector);
+  void End();
+
+  bool active_ = false;
+  uint64_t exit_;
+  int64_t start_nanos_;
+  size_t depth_;
+  uint64_t frames_[kMaxProfileDepth];
+};
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_SGX_TRUSTED_PROFILER_H_
@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <sys/types.h>
 
+#include "asylo/platform/primitives/sgx/committed_heap.h"
 #include "asylo/platform/primitives/sgx/generated_bridge_t.h"
 #include "include/sgx_thread.h"
 #include "include/sgx_trts.h"
@@ -43,11 +44,27 @@ extern "C" {
 
 size_t g_peak_heap_used __attribute__((visibility("default"))) = 0;
 
+// Called by the SGX trusted runtime during enclave initialization. With EDMM,
+// only the initial heap is added when the enclave is loaded, and
+// enclave_sbrk() adds and trims the rest with EAUG/EACCEPT, never trimming
+// below |_heap_min_size| bytes.
 int heap_init(void *_heap_base, size_t _heap_max_size, size_t _heap_min_size,
               int _is_edmm_supported) {
   heap_base = _heap_base;
   heap_max_size = _heap_max_size;
-  // EDDM not supported so _heap_min_size and _is_edmm_supported are unused.
+  if (_is_edmm_supported == 0 || _heap_min_size >= _heap_max_size) {
+    asylo::primitives::InitCommittedHeap(_heap_base, _heap_max_size,
+                                         _heap_max_size,
+                                         /*edmm_supported=*/false);
+    return 0;
+  }
+  size_t committed_size = sgx_heap_init_size();
+  if (committed_size > _heap_max_size) {
+    committed_size = _heap_max_size;
+  }
+  asylo::primitives::InitCommittedHeap(_heap_base, _heap_min_size,
+                                       committed_size,
+                                       /*edmm_supported=*/true);
   return 0;
 }
 
@@ -55,7 +72,8 @@ int heap_init(void *_heap_base, size_t _heap_max_size, size_t _heap_min_size,
 void *enclave_sbrk(intptr_t increment) {
   ssize_t new_heap_size = heap_size + increment;
   if (heap_base == nullptr || new_heap_size < 0 ||
-      new_heap_size > heap_max_size) {
+      new_heap_size > heap_max_size ||
+      !asylo::primitives::ResizeCommittedHeap(new_heap_size)) {
     errno = ENOMEM;
     return reinterpret_cast<void *>(-1);
   }
@@ -111,6 +129,8 @@ void enc_get_memory_layout(struct EnclaveMemoryLayout *enclave_memory_layout) {
   enclave_memory_layout->bss_size = memory_layout.bss_size;
   enclave_memory_layout->heap_base = memory_layout.heap_base;
   enclave_memory_layout->heap_size = memory_layout.heap_size;
+  enclave_memory_layout->heap_used = heap_size;
+  enclave_memory_layout->heap_peak_used = g_peak_heap_used;
   enclave_memory_layout->thread_base = memory_layout.thread_base;
   enclave_memory_layout->thread_size = memory_layout.thread_size;
   enclave_memory_layout->stack_base = memory_layout.stack_base;
@@ -19,22 +19,39 @@
 #include "asylo/platform/primitives/sgx/trusted_sgx.h"
 
 #include <errno.h>
+#include <pthread.h>
 #include <signal.h>
 #include <sys/types.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <vector>
 
 #include "absl/strings/str_cat.h"
 #include "asylo/enclave.pb.h"
+#include "asylo/platform/common/enclave_thread_stats.h"
+#include "asylo/platform/common/enclave_trace.h"
+#include "asylo/platform/common/enclave_trace_buffer.h"
 #include "asylo/util/logging.h"
+#include "asylo/platform/posix/host_info_cache.h"
+#include "asylo/platform/posix/host_time.h"
+#include "asylo/platform/posix/memory/thread_cache_malloc.h"
 #include "asylo/platform/posix/signal/signal_manager.h"
 #include "asylo/platform/posix/threading/thread_manager.h"
 #include "asylo/platform/primitives/extent.h"
 #include "asylo/platform/primitives/primitive_status.h"
 #include "asylo/platform/primitives/primitives.h"
 #include "asylo/platform/primitives/sgx/generated_bridge_t.h"
+#include "asylo/platform/primitives/sgx/pending_signals.h"
 #include "asylo/platform/primitives/sgx/sgx_error_space.h"
 #include "asylo/platform/primitives/sgx/sgx_params.h"
+#include "asylo/platform/primitives/sgx/switchless_queue.h"
+#include "asylo/platform/primitives/sgx/thread_parking.h"
+#include "asylo/platform/primitives/sgx/trusted_cpu_emulation.h"
+#include "asylo/platform/primitives/sgx/trusted_profiler.h"
+#include "asylo/platform/primitives/sgx/trusted_stack_usage.h"
 #include "asylo/platform/primitives/sgx/untrusted_cache_malloc.h"
 #include "asylo/platform/primitives/trusted_primitives.h"
 #include "asylo/platform/primitives/trusted_runtime.h"
@@ -61,6 +78,237 @@
 
 namespace asylo {
 namespace primitives {
+namespace {
+
+// Maximum number of exit call selectors which may be served by the switchless
+// queue.
+constexpr size_t kMaxSwitchlessSelectors = 64;
+
+// State of the switchless exit call path. |queue| is published last by
+// InitSwitchlessOcalls, so a thread observing a non-null |queue| also observes
+// the remaining fields.
+struct {
+  // Queue shared with the untrusted worker pool, or nullptr if switchless exit
+  // calls are disabled.
+  std::atomic<SwitchlessQueue *> queue{nullptr};
+
+  // Exit call selectors dispatched through |queue|.
+  uint64_t selectors[kMaxSwitchlessSelectors];
+
+  // Number of valid entries in |selectors|.
+  size_t num_selectors = 0;
+
+  // Number of times a posted request is polled before it is withdrawn and
+  // dispatched with a regular ocall instead.
+  uint32_t max_polls = 0;
+} switchless_ocalls;
+
+// Bounds of the size of the untrusted buffer lent to the host for the results
+// of an exit call, and of the area of a thread's control block its inputs are
+// serialized into. Results that fit are serialized into the buffer, which is
+// reused without an ocall, instead of into a buffer the host allocates and the
+// enclave must free with another ocall.
+constexpr size_t kMinExitCallOutputSize = 1024;
+constexpr size_t kMaxExitCallOutputSize =
+    UntrustedCacheMalloc::kMaxPoolEntrySize;
+
+// Size of the buffer lent for the results of this thread's next exit call. It
+// grows to fit the largest results this thread received so far.
+thread_local size_t exit_call_output_size = kMinExitCallOutputSize;
+
+// Untrusted memory reused by the exit calls of a thread: the SgxParams of the
+// call, followed by an area its inputs are serialized into and an area lent to
+// the host for its results. Parkable threads have thread local storage of
+// their own, so a parked thread keeps its block wherever it is resumed.
+struct ExitCallBlock {
+  // Size of the SgxParams at the start of the block, padded so that the areas
+  // following it stay aligned.
+  static constexpr size_t kParamsSize = (sizeof(SgxParams) + 15) & ~size_t{15};
+
+  void *input() { return reinterpret_cast<uint8_t *>(params) + kParamsSize; }
+  void *output() {
+    return reinterpret_cast<uint8_t *>(input()) + input_capacity;
+  }
+
+  SgxParams *params;
+  size_t input_capacity;
+  size_t output_capacity;
+
+  // Set while an exit call uses the block, so that exit calls made meanwhile
+  // on the same thread, from a nested enclave call or a signal handler, do
+  // not overwrite it.
+  bool in_use;
+};
+
+// Control block of the calling thread, allocated on its first exit call and
+// grown as needed. Enclave threads are never destroyed, so the block is never
+// released.
+thread_local ExitCallBlock exit_call_block = {};
+
+// Returns the control block of the calling thread marked in use, with room for
+// |input_size| bytes of inputs and results of exit_call_output_size bytes if
+// they fit the bounds of lent buffers. Returns nullptr if the block is in use
+// or cannot be grown.
+ExitCallBlock *AcquireExitCallBlock(size_t input_size) {
+  ExitCallBlock *block = &exit_call_block;
+  if (block->in_use) {
+    return nullptr;
+  }
+  size_t input_capacity =
+      std::max(block->input_capacity, kMinExitCallOutputSize);
+  while (input_capacity < input_size &&
+         input_capacity < kMaxExitCallOutputSize) {
+    input_capacity *= 2;
+  }
+  size_t output_capacity =
+      std::max(block->output_capacity, exit_call_output_size);
+  if (!block->params || input_capacity > block->input_capacity ||
+      output_capacity > block->output_capacity) {
+    // The block is allocated from the host rather than from the untrusted
+    // cache, whose buffers must be released under the same heap they were
+    // allocated under. It only grows a few times over the life of a thread.
+    void *params = TrustedPrimitives::UntrustedLocalAlloc(
+        ExitCallBlock::kParamsSize + input_capacity + output_capacity);
+    if (!params) {
+      return nullptr;
+    }
+    if (block->params) {
+      TrustedPrimitives::UntrustedLocalFree(block->params);
+    }
+    block->params = reinterpret_cast<SgxParams *>(params);
+    block->input_capacity = input_capacity;
+    block->output_capacity = output_capacity;
+  }
+  block->in_use = true;
+  return block;
+}
+
+// Returns the switchless queue if |selector| is configured to be dispatched
+// switchlessly, otherwise nullptr.
+SwitchlessQueue *GetSwitchlessQueue(uint64_t selector) {
+  SwitchlessQueue *queue =
+      switchless_ocalls.queue.load(std::memory_order_acquire);
+  if (!queue) {
+    return nullptr;
+  }
+  for (size_t i = 0; i < switchless_ocalls.num_selectors; i++) {
+    if (switchless_ocalls.selectors[i] == selector) {
+      return queue;
+    }
+  }
+  return nullptr;
+}
+
+// Dispatches an exit call through the switchless queue. Returns false if the
+// call could not be handed off to an untrusted worker, in which case the caller
+// must fall back to a regular ocall. |sgx_params| must be in untrusted memory.
+bool SwitchlessUntrustedCall(SwitchlessQueue *queue, uint64_t selector,
+                             SgxParams *sgx_params) {
+  int index = queue->Reserve();
+  if (index < 0) {
+    return false;
+  }
+  SwitchlessQueue::Slot *slot = queue->slot(index);
+  slot->selector = selector;
+  slot->params = sgx_params;
+  queue->Post(index);
+
+  // Give the workers a bounded amount of time to pick up the request. If they
+  // are all busy, for instance blocked in a long-running host call, withdraw
+  // it rather than wait indefinitely.
+  for (uint32_t i = 0; queue->IsPosted(index); i++) {
+    if (i >= switchless_ocalls.max_polls && queue->Withdraw(index)) {
+      queue->Release(index);
+      return false;
+    }
+    enc_pause();
+  }
+  while (!queue->IsDone(index)) {
+    enc_pause();
+  }
+  queue->Release(index);
+  return true;
+}
+
+// Number of consecutive empty polls after which an idle switchless enclave call
+// worker starts sleeping between polls instead of spinning.
+constexpr int kIdlePollsBeforeSleep = 4096;
+
+// Time in microseconds an idle switchless enclave call worker sleeps between
+// polls once it stopped spinning.
+constexpr useconds_t kIdleSleepMicros = 20;
+
+// Set at enclave finalization to stop all switchless enclave call workers, so
+// that the thread manager is not left waiting on them.
+std::atomic<bool> switchless_ecalls_stopped{false};
+
+// Start routine of switchless enclave call workers. Runs enclave calls posted to
+// the SwitchlessQueue passed in |arg| until the queue is closed by the host or
+// the enclave is finalized.
+void *SwitchlessEcallWorker(void *arg) {
+  auto queue = reinterpret_cast<SwitchlessQueue *>(arg);
+  int idle_polls = 0;
+  while (!switchless_ecalls_stopped.load(std::memory_order_acquire) &&
+         !queue->IsClosed()) {
+    int index = queue->Take();
+    if (index < 0) {
+      if (++idle_polls < kIdlePollsBeforeSleep) {
+        enc_pause();
+      } else {
+        usleep(kIdleSleepMicros);
+      }
+      continue;
+    }
+    idle_polls = 0;
+    // The slot contents are untrusted. asylo_enclave_call validates the
+    // parameter block and copies its input into trusted memory, exactly as
+    // for a regular ecall.
+    SwitchlessQueue::Slot *slot = queue->slot(index);
+    uint64_t selector = slot->selector;
+    void *params = slot->params;
+    queue->Complete(index, asylo_enclave_call(selector, params));
+  }
+  return nullptr;
+}
+
+// Set of signals the host deferred instead of entering the enclave for each of
+// them, or nullptr if the host delivers every signal with an enclave call.
+std::atomic<PendingSignalSet *> pending_signals{nullptr};
+
+// Whether the current thread is running the handlers of pending signals. A
+// handler making a host call must not start delivering signals again from
+// within the drain.
+thread_local bool draining_pending_signals = false;
+
+// Runs the handlers of all pending host signals on the current thread. Called
+// at every enclave entry and exit, so this is a single load unless signals are
+// pending. Signals blocked by the enclave signal mask stay pending until a
+// later drain finds them unblocked.
+void DrainPendingSignals() {
+  PendingSignalSet *set = pending_signals.load(std::memory_order_acquire);
+  if (!set || !set->HasPending() || draining_pending_signals) {
+    return;
+  }
+  draining_pending_signals = true;
+  uint64_t signals = set->TakeAll();
+  uint64_t blocked = 0;
+  for (int signum = 1; signals; signum++) {
+    uint64_t bit = PendingSignalSet::Bit(signum);
+    if (!(signals & bit)) {
+      continue;
+    }
+    signals &= ~bit;
+    // Coalesced signals have no individual origin, so they are delivered as
+    // if sent by a process.
+    if (DeliverSignal(signum, /*klinux_sigcode=*/0) < 0) {
+      blocked |= bit;
+    }
+  }
+  set->Restore(blocked);
+  draining_pending_signals = false;
+}
+
+}  // namespace
 
 int RegisterSignalHandler(int signum,
                           void (*klinux_sigaction)(int, klinux_siginfo_t *,
@@ -119,28 +367,417 @@ PrimitiveStatus FinalizeEnclave(void *context, MessageReader *in,
   if (in) {
     ASYLO_RETURN_IF_READER_NOT_EMPTY(*in);
   }
+  // Stop dispatching exit calls to the untrusted worker pool, which is torn
+  // down along with the enclave, and release the switchless enclave call
+  // workers before the thread manager waits for all threads to return.
+  switchless_ocalls.queue.store(nullptr, std::memory_order_release);
+  switchless_ecalls_stopped.store(true, std::memory_order_release);
+  // Signals still pending are dropped, as they would be for an exiting process.
+  pending_signals.store(nullptr, std::memory_order_release);
+  // The host stops updating the time page once the enclave is destroyed.
+  SetHostTimePage(nullptr, 0);
+  SetHostInfoGenerations(nullptr);
+
   // Delete instance of the global memory pool singleton freeing all memory held
   // by the pool.
   delete UntrustedCacheMalloc::Instance();
-  return asylo_enclave_fini();
+  PrimitiveStatus status = asylo_enclave_fini();
+  // The thread manager is done waiting for pthreads, which may have been green
+  // threads, so their workers can leave the enclave.
+  StopGreenThreads();
+  return status;
+}
+
+// Returns the record of a parked exit call in |address|, or nullptr if it does
+// not lie within untrusted memory.
+ParkedExitCall *ParkedExitCallRecord(uint64_t address) {
+  auto parked = reinterpret_cast<ParkedExitCall *>(address);
+  if (!parked ||
+      !TrustedPrimitives::IsOutsideEnclave(parked, sizeof(ParkedExitCall))) {
+    return nullptr;
+  }
+  return parked;
 }
 
-// Entry handler installed by the runtime to start the created thread.
+// Entry handler installed by the runtime to start the created thread. Takes the
+// thread ID and the address of the untrusted ParkedExitCall record of the
+// donation.
 PrimitiveStatus DonateThread(void *context, MessageReader *in,
                              MessageWriter *out) {
+  if (!in) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "DonateThread: no input provided."};
+  }
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 2);
+  pid_t tid = in->next<pid_t>();
+  ParkedExitCall *parked = ParkedExitCallRecord(in->next<uint64_t>());
+  if (!parked) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "Parked exit call record should lie within untrusted memory."};
+  }
+  if (TakeGreenThreadWorker()) {
+    return RunGreenThreadWorker(tid);
+  }
+  return RunDonatedThread(
+      [tid] {
+        int result = 0;
+        try {
+          ThreadManager *thread_manager = ThreadManager::GetInstance();
+          result = thread_manager->StartThread(tid);
+        } catch (...) {
+          TrustedPrimitives::BestEffortAbort(
+              "Uncaught exception in enclave entry handler: DonateThread. "
+              "Failed to get ThreadManager instance or start the thread.");
+        }
+        return result;
+      },
+      parked);
+}
+
+// Entry handler installed by the runtime to run donated threads as parkable
+// threads. Takes the stack size of each thread, or 0 for that of a TCS, and the
+// number of green thread workers, or 0 to keep one TCS per thread.
+PrimitiveStatus InitThreadParking(void *context, MessageReader *in,
+                                  MessageWriter *out) {
+  if (!in) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "InitThreadParking: no input provided."};
+  }
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 2);
+  uint64_t stack_size = in->next<uint64_t>();
+  uint32_t green_thread_workers = in->next<uint32_t>();
+  ASYLO_RETURN_IF_ERROR(EnableThreadParking(stack_size));
+  if (green_thread_workers == 0) {
+    return PrimitiveStatus::OkStatus();
+  }
+  // Blocking exit calls of green threads go through the switchless queue if
+  // switchless exit calls are enabled.
+  return EnableGreenThreads(
+      green_thread_workers,
+      switchless_ocalls.queue.load(std::memory_order_acquire),
+      switchless_ocalls.max_polls);
+}
+
+// Entry handler installed by the runtime to resume a parked thread once the
+// host made its exit call. Takes the ID of the thread and the address of the
+// untrusted ParkedExitCall record of its donation.
+PrimitiveStatus ResumeThread(void *context, MessageReader *in,
+                             MessageWriter *out) {
+  if (!in) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "ResumeThread: no input provided."};
+  }
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 2);
+  uint64_t thread_id = in->next<uint64_t>();
+  ParkedExitCall *parked = ParkedExitCallRecord(in->next<uint64_t>());
+  if (!parked) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "Parked exit call record should lie within untrusted memory."};
+  }
+  return ResumeParkedThread(thread_id, parked);
+}
+
+// Entry handler installed by the runtime to enable switchless exit calls. Takes
+// the address of an untrusted SwitchlessQueue, the number of polls before a
+// posted request is withdrawn, and the array of selectors to dispatch through
+// the queue.
+PrimitiveStatus InitSwitchlessOcalls(void *context, MessageReader *in,
+                                     MessageWriter *out) {
+  if (!in) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "InitSwitchlessOcalls: no input provided."};
+  }
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 3);
+  auto queue = reinterpret_cast<SwitchlessQueue *>(in->next<uint64_t>());
+  uint32_t max_polls = in->next<uint32_t>();
+  Extent selectors = in->next();
+
+  if (!queue || !TrustedPrimitives::IsOutsideEnclave(queue,
+                                                     sizeof(SwitchlessQueue))) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "Switchless queue should lie within untrusted memory."};
+  }
+  size_t num_selectors = selectors.size() / sizeof(uint64_t);
+  if (num_selectors > kMaxSwitchlessSelectors) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "Too many switchless exit call selectors."};
+  }
+  if (switchless_ocalls.queue.load(std::memory_order_acquire)) {
+    return {error::GoogleError::FAILED_PRECONDITION,
+            "Switchless exit calls are already enabled."};
+  }
+
+  memcpy(switchless_ocalls.selectors, selectors.data(),
+         num_selectors * sizeof(uint64_t));
+  switchless_ocalls.num_selectors = num_selectors;
+  switchless_ocalls.max_polls = max_polls;
+  switchless_ocalls.queue.store(queue, std::memory_order_release);
+  return PrimitiveStatus::OkStatus();
+}
+
+// Entry handler installed by the runtime to enable switchless enclave calls.
+// Takes the address of an untrusted SwitchlessQueue and the number of trusted
+// worker threads to start. Each worker is an ordinary enclave thread created
+// with pthread_create, and so enters the enclave through DonateThread.
+PrimitiveStatus InitSwitchlessEcalls(void *context, MessageReader *in,
+                                     MessageWriter *out) {
+  if (!in) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "InitSwitchlessEcalls: no input provided."};
+  }
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 2);
+  auto queue = reinterpret_cast<SwitchlessQueue *>(in->next<uint64_t>());
+  int32_t num_workers = in->next<int32_t>();
+
+  if (!queue || !TrustedPrimitives::IsOutsideEnclave(queue,
+                                                     sizeof(SwitchlessQueue))) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "Switchless queue should lie within untrusted memory."};
+  }
+  if (num_workers <= 0) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "Switchless enclave calls require at least one worker."};
+  }
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  Cleanup destroy_attr([&attr] { pthread_attr_destroy(&attr); });
+  for (int32_t i = 0; i < num_workers; i++) {
+    pthread_t thread;
+    if (pthread_create(&thread, &attr, SwitchlessEcallWorker, queue) != 0) {
+      return {error::GoogleError::INTERNAL,
+              "Failed to start switchless enclave call worker."};
+    }
+  }
+  return PrimitiveStatus::OkStatus();
+}
+
+// Entry handler installed by the runtime to enable deferred signal delivery.
+// Takes the address of an untrusted PendingSignalSet, which trusted threads
+// drain at their enclave entries and exits from then on. Replaces any set
+// registered before, such as the one of the parent of a forked enclave.
+PrimitiveStatus InitPendingSignals(void *context, MessageReader *in,
+                                   MessageWriter *out) {
+  if (!in) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "InitPendingSignals: no input provided."};
+  }
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 1);
+  auto set = reinterpret_cast<PendingSignalSet *>(in->next<uint64_t>());
+  if (!set || !TrustedPrimitives::IsOutsideEnclave(set,
+                                                   sizeof(PendingSignalSet))) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "Pending signal set should lie within untrusted memory."};
+  }
+  pending_signals.store(set, std::memory_order_release);
+  return PrimitiveStatus::OkStatus();
+}
+
+// Entry handler installed by the runtime for the host to deliver pending
+// signals when no enclave thread picked them up in time.
+PrimitiveStatus DeliverPendingSignals(void *context, MessageReader *in,
+                                      MessageWriter *out) {
   if (in) {
-    ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 1);
+    ASYLO_RETURN_IF_READER_NOT_EMPTY(*in);
   }
-  int result = 0;
-  try {
-    ThreadManager *thread_manager = ThreadManager::GetInstance();
-    result = thread_manager->StartThread(in->next<pid_t>());
-  } catch (...) {
-    TrustedPrimitives::BestEffortAbort(
-        "Uncaught exception in enclave entry handler: DonateThread. Failed to "
-        "get ThreadManager instance or start the thread.");
+  DrainPendingSignals();
+  return PrimitiveStatus::OkStatus();
+}
+
+// Entry handler installed by the runtime to serve clock reads from a host time
+// page. Takes the address of an untrusted HostTimePage and the number of reads
+// of an unchanged snapshot after which the page is considered stale. Replaces
+// any page registered before.
+PrimitiveStatus InitHostTimePage(void *context, MessageReader *in,
+                                 MessageWriter *out) {
+  if (!in) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "InitHostTimePage: no input provided."};
+  }
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 2);
+  auto page = reinterpret_cast<HostTimePage *>(in->next<uint64_t>());
+  uint32_t max_reads_per_update = in->next<uint32_t>();
+  if (!page ||
+      !TrustedPrimitives::IsOutsideEnclave(page, sizeof(HostTimePage))) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "Host time page should lie within untrusted memory."};
+  }
+  SetHostTimePage(page, max_reads_per_update);
+  return PrimitiveStatus::OkStatus();
+}
+
+// Entry handler installed by the runtime to cache host facts. Takes the
+// address of an untrusted HostInfoGenerations. Replaces any counters
+// registered before, which drops every cached fact.
+PrimitiveStatus InitHostInfoGenerations(void *context, MessageReader *in,
+                                        MessageWriter *out) {
+  if (!in) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "InitHostInfoGenerations: no input provided."};
+  }
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 1);
+  auto generations =
+      reinterpret_cast<HostInfoGenerations *>(in->next<uint64_t>());
+  if (!generations || !TrustedPrimitives::IsOutsideEnclave(
+                          generations, sizeof(HostInfoGenerations))) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "Host info counters should lie within untrusted memory."};
+  }
+  SetHostInfoGenerations(generations);
+  return PrimitiveStatus::OkStatus();
+}
+
+// Entry handler installed by the runtime to publish thread counters. Takes the
+// address of an untrusted EnclaveThreadStats. Replaces any counters registered
+// before.
+PrimitiveStatus InitThreadStats(void *context, MessageReader *in,
+                                MessageWriter *out) {
+  if (!in) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "InitThreadStats: no input provided."};
+  }
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 1);
+  auto stats = reinterpret_cast<EnclaveThreadStats *>(in->next<uint64_t>());
+  if (!stats ||
+      !TrustedPrimitives::IsOutsideEnclave(stats, sizeof(EnclaveThreadStats))) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "Thread statistics should lie within untrusted memory."};
+  }
+  ThreadManager::GetInstance()->SetStats(stats);
+  SetEmulatedInstructionStats(stats);
+  return PrimitiveStatus::OkStatus();
+}
+
+// Entry handler installed by the runtime to record events for the host. Takes
+// the address of an untrusted EnclaveTraceBuffer, or zero to stop recording.
+// Replaces any buffer registered before. Events are timestamped from the host
+// time page, since SGX1 enclaves cannot read the TSC.
+PrimitiveStatus InitTraceBuffer(void *context, MessageReader *in,
+                                MessageWriter *out) {
+  if (!in) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "InitTraceBuffer: no input provided."};
+  }
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 1);
+  auto buffer = reinterpret_cast<EnclaveTraceBuffer *>(in->next<uint64_t>());
+  if (buffer && !TrustedPrimitives::IsOutsideEnclave(
+                    buffer, sizeof(EnclaveTraceBuffer))) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "Trace buffer should lie within untrusted memory."};
+  }
+  SetEnclaveTraceBuffer(buffer, PeekHostTimePage);
+  return PrimitiveStatus::OkStatus();
+}
+
+// Entry handler installed by the runtime to carve untrusted buffers from an
+// arena lent by the host. Takes the base address and size of the arena, which
+// is checked to lie outside the enclave once here rather than per buffer.
+PrimitiveStatus InitUntrustedArena(void *context, MessageReader *in,
+                                   MessageWriter *out) {
+  if (!in) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "InitUntrustedArena: no input provided."};
   }
-  return PrimitiveStatus(result);
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 2);
+  void *base = reinterpret_cast<void *>(in->next<uint64_t>());
+  size_t size = in->next<uint64_t>();
+  if (!UntrustedCacheMalloc::Instance()->AddArena(base, size)) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "Untrusted arena should lie within untrusted memory and be the "
+            "only arena."};
+  }
+  return PrimitiveStatus::OkStatus();
+}
+
+// Entry handler installed by the runtime to report memory usage. Pushes the
+// heap size, current and peak heap usage, allocated and free heap bytes, then
+// the size and peak usage of each tracked stack.
+PrimitiveStatus GetMemoryStats(void *context, MessageReader *in,
+                               MessageWriter *out) {
+  if (in) {
+    ASYLO_RETURN_IF_READER_NOT_EMPTY(*in);
+  }
+  if (!out) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "GetMemoryStats: no output provided."};
+  }
+  EnclaveAllocatorStats heap = GetEnclaveAllocatorStats();
+  out->Push<uint64_t>(heap.heap_size);
+  out->Push<uint64_t>(heap.heap_used);
+  out->Push<uint64_t>(heap.heap_peak_used);
+  out->Push<uint64_t>(heap.allocated_bytes);
+  out->Push<uint64_t>(heap.free_bytes);
+  for (const EnclaveStackStats &stack : GetTrackedStackStats()) {
+    out->Push<uint64_t>(stack.size);
+    out->Push<uint64_t>(stack.peak_used);
+  }
+  return PrimitiveStatus::OkStatus();
+}
+
+// Entry handler installed by the runtime to start or stop sampling profiles.
+// Takes a single boolean, true to start.
+PrimitiveStatus SetProfiling(void *context, MessageReader *in,
+                             MessageWriter *out) {
+  if (!in) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "SetProfiling: no input provided."};
+  }
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 1);
+  if (!in->next<bool>()) {
+    StopProfiling();
+    return PrimitiveStatus::OkStatus();
+  }
+  return StartProfiling();
+}
+
+// Entry handler installed by the runtime to hand the recorded profile samples
+// to the host.
+PrimitiveStatus TakeProfileSamples(void *context, MessageReader *in,
+                                   MessageWriter *out) {
+  if (in) {
+    ASYLO_RETURN_IF_READER_NOT_EMPTY(*in);
+  }
+  if (!out) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "TakeProfileSamples: no output provided."};
+  }
+  TakeProfile(out);
+  return PrimitiveStatus::OkStatus();
+}
+
+// Entry handler installed by the runtime to start or stop attributing exit
+// calls to trusted stacks. Takes whether to start, then the capacity of the
+// table of stacks.
+PrimitiveStatus SetExitProfiling(void *context, MessageReader *in,
+                                 MessageWriter *out) {
+  if (!in) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "SetExitProfiling: no input provided."};
+  }
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 2);
+  bool start = in->next<bool>();
+  uint64_t capacity = in->next<uint64_t>();
+  if (!start) {
+    StopExitProfiling();
+    return PrimitiveStatus::OkStatus();
+  }
+  return StartExitProfiling(capacity);
+}
+
+// Entry handler installed by the runtime to hand the recorded exits to the
+// host.
+PrimitiveStatus TakeExitProfileSamples(void *context, MessageReader *in,
+                                       MessageWriter *out) {
+  if (in) {
+    ASYLO_RETURN_IF_READER_NOT_EMPTY(*in);
+  }
+  if (!out) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "TakeExitProfileSamples: no output provided."};
+  }
+  TakeExitProfile(out);
+  return PrimitiveStatus::OkStatus();
 }
 
 // Registers internal handlers, including entry handlers.
@@ -160,6 +797,131 @@ void RegisterInternalHandlers() {
     TrustedPrimitives::BestEffortAbort(
         "Could not register entry handler: FinalizeEnclave");
   }
+
+  // Register the switchless exit call initialization entry handler.
+  if (!TrustedPrimitives::RegisterEntryHandler(
+           kSelectorAsyloInitSwitchlessOcalls,
+           EntryHandler{InitSwitchlessOcalls})
+           .ok()) {
+    TrustedPrimitives::BestEffortAbort(
+        "Could not register entry handler: InitSwitchlessOcalls");
+  }
+
+  // Register the switchless enclave call initialization entry handler.
+  if (!TrustedPrimitives::RegisterEntryHandler(
+           kSelectorAsyloInitSwitchlessEcalls,
+           EntryHandler{InitSwitchlessEcalls})
+           .ok()) {
+    TrustedPrimitives::BestEffortAbort(
+        "Could not register entry handler: InitSwitchlessEcalls");
+  }
+
+  // Register the deferred signal delivery entry handlers.
+  if (!TrustedPrimitives::RegisterEntryHandler(
+           kSelectorAsyloInitPendingSignals, EntryHandler{InitPendingSignals})
+           .ok()) {
+    TrustedPrimitives::BestEffortAbort(
+        "Could not register entry handler: InitPendingSignals");
+  }
+  if (!TrustedPrimitives::RegisterEntryHandler(
+           kSelectorAsyloDeliverPendingSignals,
+           EntryHandler{DeliverPendingSignals})
+           .ok()) {
+    TrustedPrimitives::BestEffortAbort(
+        "Could not register entry handler: DeliverPendingSignals");
+  }
+
+  // Register the host time page initialization entry handler.
+  if (!TrustedPrimitives::RegisterEntryHandler(kSelectorAsyloInitHostTimePage,
+                                               EntryHandler{InitHostTimePage})
+           .ok()) {
+    TrustedPrimitives::BestEffortAbort(
+        "Could not register entry handler: InitHostTimePage");
+  }
+
+  // Register the host info cache initialization entry handler.
+  if (!TrustedPrimitives::RegisterEntryHandler(
+           kSelectorAsyloInitHostInfoGenerations,
+           EntryHandler{InitHostInfoGenerations})
+           .ok()) {
+    TrustedPrimitives::BestEffortAbort(
+        "Could not register entry handler: InitHostInfoGenerations");
+  }
+
+  // Register the thread statistics initialization entry handler.
+  if (!TrustedPrimitives::RegisterEntryHandler(kSelectorAsyloInitThreadStats,
+                                               EntryHandler{InitThreadStats})
+           .ok()) {
+    TrustedPrimitives::BestEffortAbort(
+        "Could not register entry handler: InitThreadStats");
+  }
+
+  // Register the memory statistics entry handler.
+  if (!TrustedPrimitives::RegisterEntryHandler(kSelectorAsyloGetMemoryStats,
+                                               EntryHandler{GetMemoryStats})
+           .ok()) {
+    TrustedPrimitives::BestEffortAbort(
+        "Could not register entry handler: GetMemoryStats");
+  }
+
+  // Register the untrusted arena initialization entry handler.
+  if (!TrustedPrimitives::RegisterEntryHandler(
+           kSelectorAsyloInitUntrustedArena, EntryHandler{InitUntrustedArena})
+           .ok()) {
+    TrustedPrimitives::BestEffortAbort(
+        "Could not register entry handler: InitUntrustedArena");
+  }
+
+  // Register the trace buffer initialization entry handler.
+  if (!TrustedPrimitives::RegisterEntryHandler(kSelectorAsyloInitTraceBuffer,
+                                               EntryHandler{InitTraceBuffer})
+           .ok()) {
+    TrustedPrimitives::BestEffortAbort(
+        "Could not register entry handler: InitTraceBuffer");
+  }
+
+  // Register the thread parking entry handlers.
+  if (!TrustedPrimitives::RegisterEntryHandler(
+           kSelectorAsyloInitThreadParking, EntryHandler{InitThreadParking})
+           .ok()) {
+    TrustedPrimitives::BestEffortAbort(
+        "Could not register entry handler: InitThreadParking");
+  }
+  if (!TrustedPrimitives::RegisterEntryHandler(kSelectorAsyloResumeThread,
+                                               EntryHandler{ResumeThread})
+           .ok()) {
+    TrustedPrimitives::BestEffortAbort(
+        "Could not register entry handler: ResumeThread");
+  }
+
+  // Register the profiler entry handlers.
+  if (!TrustedPrimitives::RegisterEntryHandler(kSelectorAsyloSetProfiling,
+                                               EntryHandler{SetProfiling})
+           .ok()) {
+    TrustedPrimitives::BestEffortAbort(
+        "Could not register entry handler: SetProfiling");
+  }
+  if (!TrustedPrimitives::RegisterEntryHandler(
+           kSelectorAsyloTakeProfile, EntryHandler{TakeProfileSamples})
+           .ok()) {
+    TrustedPrimitives::BestEffortAbort(
+        "Could not register entry handler: TakeProfileSamples");
+  }
+
+  // Register the exit profiler entry handlers.
+  if (!TrustedPrimitives::RegisterEntryHandler(kSelectorAsyloSetExitProfiling,
+                                               EntryHandler{SetExitProfiling})
+           .ok()) {
+    TrustedPrimitives::BestEffortAbort(
+        "Could not register entry handler: SetExitProfiling");
+  }
+  if (!TrustedPrimitives::RegisterEntryHandler(
+           kSelectorAsyloTakeExitProfile,
+           EntryHandler{TakeExitProfileSamples})
+           .ok()) {
+    TrustedPrimitives::BestEffortAbort(
+        "Could not register entry handler: TakeExitProfileSamples");
+  }
 }
 
 void TrustedPrimitives::BestEffortAbort(const char *message) {
@@ -183,32 +945,30 @@ int asylo_enclave_call(uint64_t selector, void *buffer) {
     return status.error_code();
   }
 
+  TrackCurrentStack();
+  TraceEnclaveEvent(EnclaveTraceEvent::kEnclaveCallBegin, selector);
+
   const void *input = sgx_params->input;
   size_t input_size = sgx_params->input_size;
   size_t output_size = 0;
 
   MessageReader in;
   MessageWriter out;
-  // Copy untrusted input to a trusted buffer before deserializing to prevent
-  // TOC/TOU attacks.
-  auto trusted_input = CopyFromUntrusted(input, input_size);
-  if (trusted_input) {
-    in.Deserialize(trusted_input.get(), input_size);
+  // Deserialize untrusted input with a single bounds-checked copy into trusted
+  // extents, which prevents TOC/TOU attacks.
+  PrimitiveStatus status = DeserializeFromUntrusted(input, input_size, &in);
+  if (status.ok()) {
+    status = InvokeEntryHandler(selector, &in, &out);
   }
 
-  PrimitiveStatus status = InvokeEntryHandler(selector, &in, &out);
-
-  // Serialize |out| to untrusted memory and pass that as output. The untrusted
-  // caller is still responsible for freeing |*output|, which now points to
-  // untrusted memory.
-  output_size = out.MessageSize();
-  if (out.MessageSize() > 0) {
-    // Serialize to a trusted output buffer first to prevent TOC/TOU attacks.
-    std::unique_ptr<char[]> trusted_output(new char[output_size]);
-    out.Serialize(trusted_output.get());
-    sgx_params->output = CopyToUntrusted(trusted_output.get(), output_size);
-  }
+  // Serialize |out| directly to untrusted memory and pass that as output. The
+  // untrusted caller is still responsible for freeing |*output|, which now
+  // points to untrusted memory.
+  sgx_params->output = SerializeToUntrusted(out, &output_size);
   sgx_params->output_size = static_cast<uint64_t>(output_size);
+  DrainPendingSignals();
+  TraceEnclaveEvent(EnclaveTraceEvent::kEnclaveCallEnd, selector,
+                    status.error_code());
   return status.error_code();
 }
 
@@ -260,41 +1020,122 @@ void TrustedPrimitives::DebugPuts(const char *message) {
   }
 }
 
-PrimitiveStatus TrustedPrimitives::UntrustedCall(uint64_t untrusted_selector,
-                                                 MessageWriter *input,
-                                                 MessageReader *output) {
+namespace {
+
+// Makes the exit call |untrusted_selector|. If |blocking| and the calling
+// thread is parkable, parks it while the host makes the call.
+PrimitiveStatus MakeUntrustedCall(uint64_t untrusted_selector,
+                                  MessageWriter *input, MessageReader *output,
+                                  bool blocking) {
+  ScopedExitProfile exit_profile(untrusted_selector);
   int ret;
 
   UntrustedCacheMalloc *untrusted_cache = UntrustedCacheMalloc::Instance();
+  const size_t input_size = input ? input->MessageSize() : 0;
 
-  SgxParams *const sgx_params =
-      reinterpret_cast<SgxParams *>(untrusted_cache->Malloc(sizeof(SgxParams)));
+  // Exit calls made while the control block of this thread is in use allocate
+  // their parameters and output buffer for themselves.
+  ExitCallBlock *const block = AcquireExitCallBlock(input_size);
+  SgxParams *sgx_params;
+  void *lent_output;
+  size_t output_capacity;
+  void *input_buffer = nullptr;
+  if (block) {
+    sgx_params = block->params;
+    lent_output = block->output();
+    output_capacity = block->output_capacity;
+    if (input_size <= block->input_capacity) {
+      input_buffer = block->input();
+    }
+  } else {
+    sgx_params = reinterpret_cast<SgxParams *>(
+        untrusted_cache->Malloc(sizeof(SgxParams)));
+    output_capacity = exit_call_output_size;
+    lent_output = untrusted_cache->Malloc(output_capacity);
+  }
+  // Inputs too large for the block are serialized into a buffer of their own.
+  void *const owned_input = input_size > 0 && !input_buffer
+                                ? untrusted_cache->Malloc(input_size)
+                                : nullptr;
   Cleanup clean_up(
-      [sgx_params, untrusted_cache] { untrusted_cache->Free(sgx_params); });
-  sgx_params->input_size = 0;
+      [block, sgx_params, lent_output, owned_input, untrusted_cache] {
+        if (owned_input) {
+          untrusted_cache->Free(owned_input);
+        }
+        if (block) {
+          block->in_use = false;
+        } else {
+          untrusted_cache->Free(lent_output);
+          untrusted_cache->Free(sgx_params);
+        }
+      });
+  sgx_params->input_size = input_size;
   sgx_params->input = nullptr;
-  if (input) {
-    sgx_params->input_size = input->MessageSize();
-    if (sgx_params->input_size > 0) {
-      // Allocate and copy data to |input_buffer|.
-      sgx_params->input = untrusted_cache->Malloc(sgx_params->input_size);
-      input->Serialize(const_cast<void *>(sgx_params->input));
-    }
+  if (input_size > 0) {
+    void *buffer = owned_input ? owned_input : input_buffer;
+    input->Serialize(buffer);
+    sgx_params->input = buffer;
   }
   sgx_params->output_size = 0;
   sgx_params->output = nullptr;
-  CHECK_OCALL(
-      ocall_dispatch_untrusted_call(&ret, untrusted_selector, sgx_params));
-  if (sgx_params->input) {
-    untrusted_cache->Free(const_cast<void *>(sgx_params->input));
+  sgx_params->output_buffer = lent_output;
+  sgx_params->output_capacity = output_capacity;
+  TraceEnclaveEvent(EnclaveTraceEvent::kUntrustedCallBegin,
+                    untrusted_selector);
+  if (!blocking || !ParkForUntrustedCall(untrusted_selector, sgx_params)) {
+    SwitchlessQueue *switchless_queue = GetSwitchlessQueue(untrusted_selector);
+    if (!switchless_queue || !SwitchlessUntrustedCall(switchless_queue,
+                                                      untrusted_selector,
+                                                      sgx_params)) {
+      CHECK_OCALL(
+          ocall_dispatch_untrusted_call(&ret, untrusted_selector, sgx_params));
+    }
   }
-  if (sgx_params->output) {
+  DrainPendingSignals();
+  // The output buffer may have been written by an untrusted worker thread
+  // rather than by the ocall bridge, so read its location once and validate it
+  // before use.
+  void *output_buffer = sgx_params->output;
+  size_t output_size = sgx_params->output_size;
+  TraceEnclaveEvent(EnclaveTraceEvent::kUntrustedCallEnd, untrusted_selector,
+                    output_size);
+  PrimitiveStatus status = PrimitiveStatus::OkStatus();
+  if (output_buffer == lent_output) {
+    // The results were serialized into the lent buffer, which is released with
+    // |sgx_params| or kept with the control block.
+    if (output_size > output_capacity) {
+      return PrimitiveStatus{error::GoogleError::OUT_OF_RANGE,
+                             "Exit call results overflow the output buffer."};
+    }
+    status = DeserializeFromUntrusted(output_buffer, output_size, output);
+  } else if (output_buffer) {
     // For the results obtained in |output_buffer|, copy them to |output|
     // before freeing the buffer.
-    output->Deserialize(sgx_params->output, sgx_params->output_size);
-    TrustedPrimitives::UntrustedLocalFree(sgx_params->output);
+    status = DeserializeFromUntrusted(output_buffer, output_size, output);
+    TrustedPrimitives::UntrustedLocalFree(output_buffer);
+    // Lend a buffer large enough for results of this size to the next exit
+    // calls of this thread.
+    while (exit_call_output_size < output_size &&
+           exit_call_output_size < kMaxExitCallOutputSize) {
+      exit_call_output_size *= 2;
+    }
   }
-  return PrimitiveStatus::OkStatus();
+  return status;
+}
+
+}  // namespace
+
+PrimitiveStatus TrustedPrimitives::UntrustedCall(uint64_t untrusted_selector,
+                                                 MessageWriter *input,
+                                                 MessageReader *output) {
+  return MakeUntrustedCall(untrusted_selector, input, output,
+                           /*blocking=*/false);
+}
+
+PrimitiveStatus TrustedPrimitives::UntrustedBlockingCall(
+    uint64_t untrusted_selector, MessageWriter *input, MessageReader *output) {
+  return MakeUntrustedCall(untrusted_selector, input, output,
+                           /*blocking=*/true);
 }
 
 // For SGX, CreateThread() needs to exit the enclave by making an UntrustedCall
@@ -302,6 +1143,12 @@ PrimitiveStatus TrustedPrimitives::UntrustedCall(uint64_t untrusted_selector,
 // the new thread and register it with the thread manager and execute the
 // intended callback.
 int TrustedPrimitives::CreateThread() {
+  // Green threads are multiplexed onto the worker threads donated before.
+  if (GreenThreadsEnabled()) {
+    return CreateGreenThread([](pid_t tid) {
+      return ThreadManager::GetInstance()->StartThread(tid);
+    });
+  }
   MessageWriter input;
   MessageReader output;
   PrimitiveStatus status =
@@ -0,0 +1,136 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include "asylo/platform/primitives/sgx/trusted_stack_usage.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#include "asylo/platform/primitives/trusted_runtime.h"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+// Value written to every word of the unused part of a stack.
+constexpr uint64_t kStackFillPattern = 0xd2a9b4c3e1f08765;
+
+// Number of bytes right below the stack pointer left unmarked, which covers the
+// frame of the marking loop itself.
+constexpr uintptr_t kUnmarkedStackBytes = 4096;
+
+// Maximum number of stacks tracked, well above the number of TCS an enclave is
+// usually configured with.
+constexpr size_t kMaxTrackedStacks = 512;
+
+// A tracked stack. |base| is published last, so a reader observing a non-zero
+// |base| also observes |limit|.
+struct TrackedStack {
+  std::atomic<uintptr_t> base;
+  uintptr_t limit;
+};
+
+TrackedStack tracked_stacks[kMaxTrackedStacks];
+std::atomic<size_t> num_tracked_stacks{0};
+
+// Thread-local storage is bound to the TCS, so this is set once per TCS.
+thread_local bool stack_tracked = false;
+
+// Fills [begin, end) with kStackFillPattern. Kept out of line so that its frame
+// stays within the unmarked part of the stack.
+__attribute__((noinline)) void MarkStack(uintptr_t begin, uintptr_t end) {
+  for (auto word = reinterpret_cast<volatile uint64_t *>(begin);
+       reinterpret_cast<uintptr_t>(word) < end; word++) {
+    *word = kStackFillPattern;
+  }
+}
+
+// Returns the index of the tracked stack with the given base, or
+// kMaxTrackedStacks if there is none. A forked enclave inherits the stack table
+// but not the marked stacks, so its TCS find their own entries.
+size_t FindTrackedStack(uintptr_t base) {
+  size_t count = std::min(num_tracked_stacks.load(std::memory_order_acquire),
+                          kMaxTrackedStacks);
+  for (size_t i = 0; i < count; i++) {
+    if (tracked_stacks[i].base.load(std::memory_order_acquire) == base) {
+      return i;
+    }
+  }
+  return kMaxTrackedStacks;
+}
+
+}  // namespace
+
+void TrackCurrentStack() {
+  if (stack_tracked) {
+    return;
+  }
+  stack_tracked = true;
+
+  struct EnclaveMemoryLayout layout;
+  enc_get_memory_layout(&layout);
+  uintptr_t base = reinterpret_cast<uintptr_t>(layout.stack_base);
+  uintptr_t limit = reinterpret_cast<uintptr_t>(layout.stack_limit);
+  uintptr_t stack_pointer =
+      reinterpret_cast<uintptr_t>(__builtin_frame_address(0));
+  if (stack_pointer > base || stack_pointer < limit + 2 * kUnmarkedStackBytes) {
+    return;
+  }
+
+  size_t index = FindTrackedStack(base);
+  if (index == kMaxTrackedStacks) {
+    index = num_tracked_stacks.fetch_add(1, std::memory_order_acq_rel);
+    if (index >= kMaxTrackedStacks) {
+      return;
+    }
+  }
+  constexpr uintptr_t kWordMask = sizeof(uint64_t) - 1;
+  uintptr_t begin = (limit + kWordMask) & ~kWordMask;
+  uintptr_t end = (stack_pointer - kUnmarkedStackBytes) & ~kWordMask;
+  MarkStack(begin, end);
+  tracked_stacks[index].limit = begin;
+  tracked_stacks[index].base.store(base, std::memory_order_release);
+}
+
+std::vector<EnclaveStackStats> GetTrackedStackStats() {
+  std::vector<EnclaveStackStats> stats;
+  size_t count = std::min(num_tracked_stacks.load(std::memory_order_acquire),
+                          kMaxTrackedStacks);
+  for (size_t i = 0; i < count; i++) {
+    uintptr_t base = tracked_stacks[i].base.load(std::memory_order_acquire);
+    if (!base) {
+      continue;
+    }
+    uintptr_t limit = tracked_stacks[i].limit;
+    auto word = reinterpret_cast<volatile uint64_t *>(limit);
+    while (reinterpret_cast<uintptr_t>(word) < base &&
+           *word == kStackFillPattern) {
+      word++;
+    }
+    EnclaveStackStats stack;
+    stack.size = base - limit;
+    stack.peak_used = base - reinterpret_cast<uintptr_t>(word);
+    stats.push_back(stack);
+  }
+  return stats;
+}
+
+}  // namespace primitives
+}  // namespace asylo
@@ -0,0 +1,45 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_SGX_TRUSTED_STACK_USAGE_H_
+#define ASYLO_PLATFORM_PRIMITIVES_SGX_TRUSTED_STACK_USAGE_H_
+
+#include <vector>
+
+#include "asylo/platform/common/enclave_memory_stats.h"
+
+namespace asylo {
+namespace primitives {
+
+// Starts tracking the stack of the calling thread, if it is not tracked yet.
+// Fills the unused part of the stack with a known pattern, so that the peak
+// usage can later be found as the lowest address where the pattern was
+// overwritten. Called on every enclave entry; only the first call on each TCS
+// does any work.
+void TrackCurrentStack();
+
+// Returns the size and peak usage of each tracked stack. May be called on any
+// thread, including while the tracked stacks are in use, in which case the
+// peak usage reported for them may lag behind.
+std::vector<EnclaveStackStats> GetTrackedStackStats();
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_SGX_TRUSTED_STACK_USAGE_H_
@@ -0,0 +1,97 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Replaces the generic C implementations of the newlib string and memory
+// functions with the ones from string_functions.h best suited to the
+// processor, so that boundary copies, message serialization and protobuf work
+// inside the enclave run at native speed.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "asylo/platform/primitives/sgx/string_functions.h"
+#include "asylo/platform/primitives/sgx/trusted_cpu_emulation.h"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+// CPUID bits taken from Intel SDM, Vol 2A, CPUID section
+constexpr uint32_t CPUID_01H_ECX_OSXSAVE = 1 << 27;
+constexpr uint32_t CPUID_01H_ECX_AVX = 1 << 28;
+constexpr uint32_t CPUID_07H_EBX_AVX2 = 1 << 5;
+constexpr uint32_t CPUID_07H_EBX_ERMS = 1 << 9;
+
+// XCR0 bits enabling the SSE and AVX register state.
+constexpr uint64_t kXcr0SseAvxState = 0x6;
+
+// The implementations in use. Starts with ones every x86-64 processor runs, as
+// the functions are called before the processor features are known.
+const StringFunctions *string_functions = &kBaselineStringFunctions;
+
+// Picks the implementations once the CPUID results are cached, which happens
+// in a constructor of priority 101. The host reports CPUID, so a false report
+// can only slow the enclave down or crash it. AVX is additionally required to
+// be enabled in XCR0, which reflects the enclave's XFRM and is not under the
+// host's control.
+void SelectStringFunctions() __attribute__((constructor(102)));
+void SelectStringFunctions() {
+  uint32_t leaf1[4];
+  uint32_t leaf7[4];
+  if (!ReadCachedCpuid(1, 0, leaf1) || !ReadCachedCpuid(7, 0, leaf7)) {
+    return;
+  }
+  bool erms = (leaf7[1] & CPUID_07H_EBX_ERMS) != 0;
+  bool avx2 = false;
+  if ((leaf1[2] & CPUID_01H_ECX_OSXSAVE) && (leaf1[2] & CPUID_01H_ECX_AVX) &&
+      (leaf7[1] & CPUID_07H_EBX_AVX2)) {
+    uint32_t low;
+    uint32_t high;
+    asm volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+    avx2 = (low & kXcr0SseAvxState) == kXcr0SseAvxState;
+  }
+  string_functions = GetStringFunctions(erms, avx2);
+}
+
+}  // namespace
+}  // namespace primitives
+}  // namespace asylo
+
+using asylo::primitives::string_functions;
+
+extern "C" {
+
+void *memcpy(void *dest, const void *src, size_t n) {
+  return string_functions->copy(dest, src, n);
+}
+
+void *memmove(void *dest, const void *src, size_t n) {
+  return string_functions->move(dest, src, n);
+}
+
+void *memset(void *dest, int c, size_t n) {
+  return string_functions->fill(dest, c, n);
+}
+
+int memcmp(const void *lhs, const void *rhs, size_t n) {
+  return string_functions->compare(lhs, rhs, n);
+}
+
+size_t strlen(const char *str) { return string_functions->length(str); }
+
+}  // extern "C"
@@ -49,8 +49,24 @@ namespace asylo {
 
 using primitives::TrustedPrimitives;
 
+struct UntrustedCacheMalloc::Magazine {
+  void *buffers[kMagazineCapacity];
+  uint32_t count;
+
+  // Index plus one of the next magazine on the stack holding this magazine.
+  std::atomic<uint32_t> next;
+};
+
+constexpr size_t UntrustedCacheMalloc::kMinPoolEntrySize;
+constexpr size_t UntrustedCacheMalloc::kMaxPoolEntrySize;
+constexpr int UntrustedCacheMalloc::kNumSizeClasses;
+
 bool UntrustedCacheMalloc::is_destroyed_ = false;
 
+thread_local uint32_t
+    UntrustedCacheMalloc::loaded_magazines_[UntrustedCacheMalloc::
+                                                kNumSizeClasses] = {};
+
 UntrustedCacheMalloc *UntrustedCacheMalloc::Instance() {
   static TrustedSpinLock lock(/*is_recursive=*/false);
   static UntrustedCacheMalloc *instance = nullptr;
@@ -63,7 +79,22 @@ UntrustedCacheMalloc *UntrustedCacheMalloc::Instance() {
   return instance;
 }
 
-UntrustedCacheMalloc::UntrustedCacheMalloc() : lock_(/*is_recursive=*/true) {
+UntrustedCacheMalloc::UntrustedCacheMalloc()
+    : lock_(/*is_recursive=*/true),
+      slab_lock_(/*is_recursive=*/false),
+      empty_magazines_(0),
+      num_magazines_(0),
+      num_slabs_(0),
+      has_arena_(false) {
+  for (auto &stack : full_magazines_) {
+    stack.store(0, std::memory_order_relaxed);
+  }
+  for (auto &chunk : magazine_chunks_) {
+    chunk.store(nullptr, std::memory_order_relaxed);
+  }
+  for (auto &slab : slabs_) {
+    slab.store(0, std::memory_order_relaxed);
+  }
   if (is_destroyed_) {
     return;
   }
@@ -77,9 +108,12 @@ UntrustedCacheMalloc::UntrustedCacheMalloc() : lock_(/*is_recursive=*/true) {
 }
 
 UntrustedCacheMalloc::~UntrustedCacheMalloc() {
-  while (!buffer_pool_.empty()) {
-    PushToFreeList(buffer_pool_.top());
-    buffer_pool_.pop();
+  // Pool buffers are released together with the slabs holding them.
+  for (void *region : regions_) {
+    PushToFreeList(region);
+  }
+  for (auto &chunk : magazine_chunks_) {
+    delete[] chunk.load(std::memory_order_relaxed);
   }
 
   // Free remaining elements in the free_list_.
@@ -92,46 +126,217 @@ UntrustedCacheMalloc::~UntrustedCacheMalloc() {
   is_destroyed_ = true;
 }
 
-void *UntrustedCacheMalloc::GetBuffer() {
-  void **buffers = nullptr;
-  void *buffer;
-  bool is_pool_empty;
+int UntrustedCacheMalloc::SizeClass(size_t size) {
+  if (size <= kMinPoolEntrySize) {
+    return 0;
+  }
+  // Index of the highest bit of |size| - 1, relative to kMinPoolEntrySize.
+  return 64 - __builtin_clzll(static_cast<uint64_t>(size - 1)) -
+         __builtin_ctzll(kMinPoolEntrySize);
+}
+
+size_t UntrustedCacheMalloc::ClassSize(int size_class) {
+  return kMinPoolEntrySize << size_class;
+}
+
+int UntrustedCacheMalloc::LookupSlab(const void *buffer) const {
+  uintptr_t address = reinterpret_cast<uintptr_t>(buffer);
+  uintptr_t slab = address & ~(kSlabSize - 1);
+  if (slab == 0) {
+    return -1;
+  }
+  for (size_t i = 0; i < kSlabTableSize; i++) {
+    uintptr_t entry = slabs_[(slab / kSlabSize + i) % kSlabTableSize].load(
+        std::memory_order_acquire);
+    if (entry == 0) {
+      return -1;
+    }
+    if ((entry & ~(kSlabSize - 1)) == slab) {
+      int size_class = static_cast<int>(entry & (kSlabSize - 1));
+      // Reject pointers into the middle of a pool buffer.
+      if ((address - slab) % ClassSize(size_class) != 0) {
+        return -1;
+      }
+      return size_class;
+    }
+  }
+  return -1;
+}
+
+UntrustedCacheMalloc::Magazine *UntrustedCacheMalloc::GetMagazine(
+    uint32_t index) const {
+  return &magazine_chunks_[index / kMagazinesPerChunk].load(
+      std::memory_order_acquire)[index % kMagazinesPerChunk];
+}
+
+uint32_t UntrustedCacheMalloc::GetEmptyMagazine() {
+  uint32_t index = PopMagazine(&empty_magazines_);
+  if (index != 0) {
+    return index - 1;
+  }
+  LockGuard guard(&slab_lock_);
+  index = num_magazines_.load(std::memory_order_relaxed);
+  if (index % kMagazinesPerChunk == 0) {
+    if (index / kMagazinesPerChunk == kMaxMagazineChunks) {
+      TrustedPrimitives::BestEffortAbort(
+          "UntrustedCacheMalloc ran out of magazines.");
+    }
+    magazine_chunks_[index / kMagazinesPerChunk].store(
+        new Magazine[kMagazinesPerChunk](), std::memory_order_release);
+  }
+  num_magazines_.store(index + 1, std::memory_order_relaxed);
+  GetMagazine(index)->count = 0;
+  return index;
+}
+
+void UntrustedCacheMalloc::PushMagazine(MagazineStack *stack, uint32_t index) {
+  Magazine *magazine = GetMagazine(index);
+  uint64_t head = stack->load(std::memory_order_relaxed);
+  uint64_t new_head;
+  do {
+    magazine->next.store(static_cast<uint32_t>(head),
+                         std::memory_order_relaxed);
+    new_head = ((head >> 32) + 1) << 32 | (index + 1);
+  } while (!stack->compare_exchange_weak(head, new_head,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed));
+}
 
+uint32_t UntrustedCacheMalloc::PopMagazine(MagazineStack *stack) {
+  uint64_t head = stack->load(std::memory_order_acquire);
+  uint64_t new_head;
+  do {
+    uint32_t top = static_cast<uint32_t>(head);
+    if (top == 0) {
+      return 0;
+    }
+    // The magazine may be concurrently popped and reused, in which case |next|
+    // is stale but the version tag makes the exchange below fail.
+    uint32_t next = GetMagazine(top - 1)->next.load(std::memory_order_relaxed);
+    new_head = ((head >> 32) + 1) << 32 | next;
+  } while (!stack->compare_exchange_weak(head, new_head,
+                                         std::memory_order_acquire,
+                                         std::memory_order_acquire));
+  return static_cast<uint32_t>(head);
+}
+
+uint32_t UntrustedCacheMalloc::Refill(int size_class) {
+  uintptr_t slab;
   {
-    LockGuard spin_lock(&lock_);
-    is_pool_empty = buffer_pool_.empty();
-    if (is_pool_empty) {
-      buffers =
-          primitives::AllocateUntrustedBuffers(kPoolIncrement, kPoolEntrySize);
-      for (int i = 0; i < kPoolIncrement; i++) {
-        if (!buffers[i] ||
-            !TrustedPrimitives::IsOutsideEnclave(buffers[i], kPoolEntrySize)) {
-          abort();
-        }
-        buffer_pool_.push(buffers[i]);
+    LockGuard guard(&slab_lock_);
+    if (spare_slabs_.empty()) {
+      if (2 * (num_slabs_ + kSlabsPerRegion) > kSlabTableSize) {
+        TrustedPrimitives::BestEffortAbort(
+            "UntrustedCacheMalloc ran out of slabs.");
+      }
+      size_t region_size = (kSlabsPerRegion + 1) * kSlabSize;
+      void *region = TrustedPrimitives::UntrustedLocalAlloc(region_size);
+      if (!region || !TrustedPrimitives::IsOutsideEnclave(region, region_size)) {
+        abort();
+      }
+      regions_.push_back(region);
+      uintptr_t first =
+          (reinterpret_cast<uintptr_t>(region) + kSlabSize - 1) &
+          ~(kSlabSize - 1);
+      for (size_t i = 0; i < kSlabsPerRegion; i++) {
+        spare_slabs_.push_back(first + i * kSlabSize);
+      }
+      num_slabs_ += kSlabsPerRegion;
+    }
+    slab = spare_slabs_.back();
+    spare_slabs_.pop_back();
+    for (size_t i = 0;; i++) {
+      auto &entry = slabs_[(slab / kSlabSize + i) % kSlabTableSize];
+      if (entry.load(std::memory_order_relaxed) == 0) {
+        entry.store(slab | size_class, std::memory_order_release);
+        break;
       }
     }
-    buffer = buffer_pool_.top();
-    buffer_pool_.pop();
-    busy_buffers_.insert(buffer);
   }
 
-  if (is_pool_empty) {
-    // Free memory held by the array of buffer pointers returned by
-    // AllocateUntrustedBuffers.
-    Free(buffers);
+  // Carve the slab into full magazines. All but the last are published to the
+  // depot, and the last one is returned to the caller.
+  size_t buffer_size = ClassSize(size_class);
+  size_t num_buffers = kSlabSize / buffer_size;
+  uint32_t index = 0;
+  for (size_t i = 0; i < num_buffers; i++) {
+    if (i % kMagazineCapacity == 0) {
+      if (i > 0) {
+        PushMagazine(&full_magazines_[size_class], index);
+      }
+      index = GetEmptyMagazine();
+    }
+    Magazine *magazine = GetMagazine(index);
+    magazine->buffers[magazine->count++] =
+        reinterpret_cast<void *>(slab + i * buffer_size);
+  }
+  return index;
+}
+
+void *UntrustedCacheMalloc::GetBuffer(int size_class) {
+  uint32_t &loaded = loaded_magazines_[size_class];
+  if (loaded == 0 || GetMagazine(loaded - 1)->count == 0) {
+    uint32_t full = PopMagazine(&full_magazines_[size_class]);
+    uint32_t index = full != 0 ? full - 1 : Refill(size_class);
+    if (loaded != 0) {
+      PushMagazine(&empty_magazines_, loaded - 1);
+    }
+    loaded = index + 1;
   }
-  return buffer;
+  Magazine *magazine = GetMagazine(loaded - 1);
+  return magazine->buffers[--magazine->count];
+}
+
+void UntrustedCacheMalloc::PutBuffer(void *buffer, int size_class) {
+  uint32_t &loaded = loaded_magazines_[size_class];
+  if (loaded == 0 || GetMagazine(loaded - 1)->count == kMagazineCapacity) {
+    if (loaded != 0) {
+      PushMagazine(&full_magazines_[size_class], loaded - 1);
+    }
+    loaded = GetEmptyMagazine() + 1;
+  }
+  Magazine *magazine = GetMagazine(loaded - 1);
+  magazine->buffers[magazine->count++] = buffer;
+}
+
+bool UntrustedCacheMalloc::AddArena(void *base, size_t size) {
+  uintptr_t start = reinterpret_cast<uintptr_t>(base);
+  if (is_destroyed_ || !base || start + size < start ||
+      !TrustedPrimitives::IsOutsideEnclave(base, size)) {
+    return false;
+  }
+  uintptr_t first = (start + kSlabSize - 1) & ~(kSlabSize - 1);
+  if (first + kSlabSize > start + size) {
+    return false;
+  }
+  size_t num_slabs = (start + size - first) / kSlabSize;
+
+  LockGuard guard(&slab_lock_);
+  if (has_arena_) {
+    return false;
+  }
+  // Leave the slab table at most half full, as in Refill().
+  if (2 * (num_slabs_ + num_slabs) > kSlabTableSize) {
+    num_slabs = kSlabTableSize / 2 - num_slabs_;
+  }
+  // Spare slabs are taken from the back, so push the arena in reverse to carve
+  // it from its base up.
+  for (size_t i = num_slabs; i > 0; i--) {
+    spare_slabs_.push_back(first + (i - 1) * kSlabSize);
+  }
+  num_slabs_ += num_slabs;
+  has_arena_ = true;
+  return true;
 }
 
 void *UntrustedCacheMalloc::Malloc(size_t size) {
   // Don't access UnturstedCacheMalloc if not running on normal heap, otherwise
   // it will cause error when UntrustedCacheMalloc tries to free the memory on
   // the normal heap.
-  if (is_destroyed_ || (size > kPoolEntrySize) || GetSwitchedHeapNext()) {
+  if (is_destroyed_ || (size > kMaxPoolEntrySize) || GetSwitchedHeapNext()) {
     return primitives::TrustedPrimitives::UntrustedLocalAlloc(size);
   }
-  return GetBuffer();
+  return GetBuffer(SizeClass(size));
 }
 
 void UntrustedCacheMalloc::PushToFreeList(void *buffer) {
@@ -150,17 +355,17 @@ void UntrustedCacheMalloc::Free(void *buffer) {
     primitives::TrustedPrimitives::UntrustedLocalFree(buffer);
     return;
   }
-  LockGuard spin_lock(&lock_);
 
   // Add the buffer to the free list if it was not allocated from the buffer
-  // pool and was allocated via UntrustedLocalAlloc. If the
-  // buffer was allocated from the buffer pool push it back to the pool.
-  if (busy_buffers_.find(buffer) == busy_buffers_.end()) {
+  // pool and was allocated via UntrustedLocalAlloc. If the buffer was allocated
+  // from the buffer pool push it back to the pool.
+  int size_class = LookupSlab(buffer);
+  if (size_class < 0) {
+    LockGuard spin_lock(&lock_);
     PushToFreeList(buffer);
     return;
   }
-  busy_buffers_.erase(buffer);
-  buffer_pool_.push(buffer);
+  PutBuffer(buffer, size_class);
 }
 
 }  // namespace asylo
@@ -19,11 +19,13 @@
 #ifndef ASYLO_PLATFORM_PRIMITIVES_SGX_UNTRUSTED_CACHE_MALLOC_H_
 #define ASYLO_PLATFORM_PRIMITIVES_SGX_UNTRUSTED_CACHE_MALLOC_H_
 
+#include <atomic>
 #include <cstddef>
-#include <stack>
-#include <unordered_set>
+#include <cstdint>
+#include <memory>
+#include <vector>
 
-#include "asylo/platform/core/trusted_spin_lock.h"
+#include "asylo/platform/core/trusted_ticket_lock.h"
 #include "asylo/platform/primitives/sgx/trusted_sgx.h"
 #include "asylo/platform/primitives/trusted_primitives.h"
 
@@ -33,20 +35,26 @@ namespace asylo {
 // class optimizes the common case of small allocations on backends where the
 // trusted and untrusted application partitions share an address space.
 //
-// For smaller allocations, the implementation allocates memory from a buffer
-// pool maintained by the class. The buffer pool is implemented as a stack
-// of untrusted buffers.
+// Allocations of up to kMaxPoolEntrySize bytes are rounded up to a power-of-two
+// size class and served from slabs of untrusted memory maintained by the
+// class. Each thread caches a magazine of free buffers per size class, so the
+// common case of Malloc and Free touches only thread-local state. Threads
+// exchange full and empty magazines through a lock-free depot, and only
+// allocating a new slab takes a lock.
 //
-// This class is initialized in the trusted space and manages the buffers
-// in untrusted memory 1) assigning buffers to threads requesting memory and
-// 2) pushing back buffers to the pool (for reuse) when they are requested to
-// be freed.
+// All bookkeeping is kept in trusted memory. Slabs are verified to be outside
+// the enclave when allocated, and Free identifies pool buffers by looking up
+// their slab in a trusted table rather than trusting any untrusted header.
+//
+// The host may lend the class an arena of untrusted memory backed by
+// hugepages, which is checked to be outside the enclave once and carved into
+// slabs before any memory is requested from the host.
 class UntrustedCacheMalloc {
  public:
   UntrustedCacheMalloc(UntrustedCacheMalloc const &) = delete;
   UntrustedCacheMalloc &operator=(UntrustedCacheMalloc const &) = delete;
 
-  // The destructor frees all buffers in the buffer pool and the free list.
+  // The destructor frees all slabs and the free list.
   ~UntrustedCacheMalloc();
 
   // Returns the UntrustedCacheMalloc singleton instance.
@@ -62,24 +70,70 @@ class UntrustedCacheMalloc {
   // Releases memory on the untrusted heap.
   void Free(void *buffer);
 
+  // Adds the slabs fitting in the |size| bytes of untrusted memory at |base|
+  // to the pool, which serves allocations from them before obtaining more
+  // memory from the host. The memory is not freed by this class, and must
+  // remain mapped until the UntrustedCacheMalloc singleton is destroyed.
+  // Returns false if the range is not outside the enclave, holds no slab, or
+  // an arena was already added.
+  bool AddArena(void *base, size_t size);
+
+  // Size of the smallest buffer pool entry in bytes.
+  static constexpr size_t kMinPoolEntrySize = 64;
+
+  // Size of the largest buffer pool entry in bytes. Larger allocations are
+  // forwarded to UntrustedLocalAlloc.
+  static constexpr size_t kMaxPoolEntrySize = 64 * 1024;
+
  private:
   struct FreeList {
     primitives::UntrustedUniquePtr<void *> buffers;
     int count;
   };
 
-  TrustedSpinLock lock_;
+  // A fixed-capacity stack of free buffers of a single size class. Magazines
+  // live in trusted memory, are identified by index, and are never freed
+  // before the UntrustedCacheMalloc is destroyed.
+  struct Magazine;
+
+  // A lock-free stack of magazines, implemented as a Treiber stack over
+  // magazine indices. The head packs a version tag in the upper 32 bits with
+  // the index of the top magazine plus one in the lower 32 bits, which protects
+  // against ABA races.
+  using MagazineStack = std::atomic<uint64_t>;
+
+  // Number of power-of-two size classes between kMinPoolEntrySize and
+  // kMaxPoolEntrySize.
+  static constexpr int kNumSizeClasses = 11;
+
+  // Number of buffers held by a magazine.
+  static constexpr size_t kMagazineCapacity = 32;
 
-  // Number of entries added to the buffer pool when it's depleted.
-  static constexpr size_t kPoolIncrement = 1024;
+  // Size of a slab of pool buffers in bytes. Slabs are aligned to their size,
+  // so the slab owning a buffer is found by masking the buffer address.
+  static constexpr size_t kSlabSize = 256 * 1024;
 
-  // Size of a buffer pool entry in bytes.
-  static constexpr size_t kPoolEntrySize = 4096;
+  // Number of slabs obtained from the host at once. One extra slab worth of
+  // memory is requested to align the slabs.
+  static constexpr size_t kSlabsPerRegion = 16;
+
+  // Number of entries in the open-addressed slab table. This bounds the pool
+  // to half as many slabs.
+  static constexpr size_t kSlabTableSize = 8192;
+
+  // Number of magazines allocated at once, and the maximum number of such
+  // chunks.
+  static constexpr size_t kMagazinesPerChunk = 256;
+  static constexpr size_t kMaxMagazineChunks = 4096;
 
   // Maximum entries in the free list. When this limit is reached, all memory
   // held by the pointers in the free list is freed.
   static constexpr size_t kFreeListCapacity = 1024;
 
+  // Index plus one of the magazine each thread allocates from and frees to,
+  // per size class, or 0 if the thread holds no magazine.
+  static thread_local uint32_t loaded_magazines_[kNumSizeClasses];
+
   // Defaults to false. Set to true when the singleton class object is
   // destructed. The class will internally route all subsequent calls for memory
   // (de)allocation to the native malloc/free implementation.
@@ -87,10 +141,38 @@ class UntrustedCacheMalloc {
 
   UntrustedCacheMalloc();
 
-  // Returns a buffer from the pool. If no buffers are available in the pool,
-  // this function is responsible for adding new buffers to the pool before
-  // returning the buffer.
-  void *GetBuffer();
+  // Returns the index of the size class serving allocations of |size| bytes.
+  static int SizeClass(size_t size);
+
+  // Returns the size of buffers in size class |size_class|.
+  static size_t ClassSize(int size_class);
+
+  // Returns the size class of the pool buffer |buffer|, or -1 if |buffer| was
+  // not allocated from the pool.
+  int LookupSlab(const void *buffer) const;
+
+  // Returns the magazine at |index|.
+  Magazine *GetMagazine(uint32_t index) const;
+
+  // Returns the index of an empty magazine, allocating one if necessary.
+  uint32_t GetEmptyMagazine();
+
+  // Pushes magazine |index| onto |stack|.
+  void PushMagazine(MagazineStack *stack, uint32_t index);
+
+  // Pops a magazine from |stack| and returns its index plus one, or 0 if the
+  // stack is empty.
+  uint32_t PopMagazine(MagazineStack *stack);
+
+  // Carves a new slab into magazines of size class |size_class|, pushes them
+  // to the depot and returns the index of one of them.
+  uint32_t Refill(int size_class);
+
+  // Returns a buffer of size class |size_class| from the pool.
+  void *GetBuffer(int size_class);
+
+  // Returns the pool buffer |buffer| of size class |size_class| to the pool.
+  void PutBuffer(void *buffer, int size_class);
 
   // Pushes |buffer| to the free list. If the free list capacity is reached,
   // this function is also responsible for first emptying the free list by
@@ -98,17 +180,38 @@ class UntrustedCacheMalloc {
   // the list.
   void PushToFreeList(void *buffer);
 
+  // Guards |free_list_|.
+  TrustedTicketLock lock_;
+
+  // Guards slab and magazine allocation.
+  TrustedTicketLock slab_lock_;
+
   // List of pointers to untrusted buffers which need to be freed.
   std::unique_ptr<FreeList> free_list_;
 
-  // Pool of pointers to free buffers allocated on the untrusted heap. The
-  // buffer pool is implemented as a stack. This allows for a warmer cache as a
-  // recently returned buffer which is hot in the cache is the first to get
-  // reassigned to a thread requesting a buffer.
-  std::stack<void *> buffer_pool_;
+  // Depot of full and empty magazines, per size class.
+  MagazineStack full_magazines_[kNumSizeClasses];
+  MagazineStack empty_magazines_;
+
+  // Magazine storage, allocated in chunks on demand.
+  std::atomic<Magazine *> magazine_chunks_[kMaxMagazineChunks];
+  std::atomic<uint32_t> num_magazines_;
+
+  // Open-addressed table of slabs, keyed by slab address. Each entry holds the
+  // slab address with its size class in the low bits, or 0 if unused.
+  std::atomic<uintptr_t> slabs_[kSlabTableSize];
+
+  // Aligned slabs obtained from the host but not yet assigned a size class.
+  std::vector<uintptr_t> spare_slabs_;
+
+  // Memory regions obtained from the host for slabs.
+  std::vector<void *> regions_;
+
+  // Number of slabs obtained from the host or from the arena.
+  size_t num_slabs_;
 
-  // Set of buffers returned to and owned by buffer pool clients.
-  std::unordered_set<void *> busy_buffers_;
+  // Whether an arena was added with AddArena().
+  bool has_arena_;
 };
 
 }  // namespace asylo
@@ -20,12 +20,15 @@
 
 #include <cstddef>
 #include <cstdlib>
+#include <cstring>
 #include <random>
 #include <thread>
+#include <utility>
 #include <vector>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include "asylo/platform/primitives/trusted_primitives.h"
 
 namespace asylo {
 namespace {
@@ -67,5 +70,65 @@ TEST_F(UntrustedCacheMallocTest, StressTest) {
   }
 }
 
+// Ensure buffers of every size class are usable and can be freed by a thread
+// other than the one that allocated them.
+TEST_F(UntrustedCacheMallocTest, CrossThreadFree) {
+  constexpr int kAllocationsPerSize = 100;
+  std::vector<std::pair<char *, size_t>> buffers;
+  for (size_t size = 1; size <= 2 * UntrustedCacheMalloc::kMaxPoolEntrySize;
+       size *= 2) {
+    for (int i = 0; i < kAllocationsPerSize; i++) {
+      char *buffer =
+          static_cast<char *>(untrusted_cache_malloc_->Malloc(size));
+      ASSERT_NE(buffer, nullptr);
+      memset(buffer, static_cast<int>(i), size);
+      buffers.emplace_back(buffer, size);
+    }
+  }
+
+  std::thread freer([this, &buffers] {
+    for (size_t i = 0; i < buffers.size(); i++) {
+      char *buffer = buffers[i].first;
+      size_t size = buffers[i].second;
+      EXPECT_EQ(buffer[0], static_cast<char>(i % kAllocationsPerSize));
+      EXPECT_EQ(buffer[size - 1], static_cast<char>(i % kAllocationsPerSize));
+      untrusted_cache_malloc_->Free(buffer);
+    }
+  });
+  freer.join();
+}
+
+// Ensure an arena is only accepted if it lies outside the enclave, and that
+// the pool serves allocations of a fresh size class from it.
+TEST_F(UntrustedCacheMallocTest, AddsArena) {
+  char trusted[1024];
+  EXPECT_FALSE(untrusted_cache_malloc_->AddArena(trusted, sizeof(trusted)));
+
+  // The arena must stay mapped until the singleton is destroyed, so it is
+  // never freed.
+  constexpr size_t kArenaSize = 2 * 1024 * 1024;
+  char *arena = static_cast<char *>(
+      primitives::TrustedPrimitives::UntrustedLocalAlloc(kArenaSize));
+  ASSERT_NE(arena, nullptr);
+  ASSERT_TRUE(untrusted_cache_malloc_->AddArena(arena, kArenaSize));
+  EXPECT_FALSE(untrusted_cache_malloc_->AddArena(arena, kArenaSize));
+
+  // Allocate more buffers than other tests may have left cached, so that the
+  // pool carves new slabs, which come from the arena.
+  std::vector<char *> buffers;
+  bool from_arena = false;
+  for (size_t i = 0; i < kArenaSize / UntrustedCacheMalloc::kMaxPoolEntrySize;
+       i++) {
+    char *buffer = static_cast<char *>(untrusted_cache_malloc_->Malloc(
+        UntrustedCacheMalloc::kMaxPoolEntrySize));
+    from_arena |= buffer >= arena && buffer < arena + kArenaSize;
+    buffers.push_back(buffer);
+  }
+  EXPECT_TRUE(from_arena);
+  for (char *buffer : buffers) {
+    untrusted_cache_malloc_->Free(buffer);
+  }
+}
+
 }  // namespace
 }  // namespace asylo
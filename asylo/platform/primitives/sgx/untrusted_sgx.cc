@@ -18,16 +18,32 @@
 
 #include "asylo/platform/primitives/sgx/untrusted_sgx.h"
 
+#include <cxxabi.h>
+#include <elf.h>
+#include <sys/auxv.h>
 #include <sys/mman.h>
+#include <sys/time.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <memory>
 #include <string>
-
+#include <thread>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "asylo/platform/primitives/sgx/cpu_affinity.h"
+#include "asylo/platform/primitives/sgx/enclave_profile.h"
+#include "asylo/platform/primitives/sgx/epc_stats.h"
 #include "asylo/platform/primitives/sgx/exit_handlers.h"
 #include "asylo/platform/primitives/sgx/generated_bridge_u.h"
 #include "asylo/platform/primitives/sgx/sgx_error_space.h"
@@ -39,6 +55,7 @@
 #include "asylo/util/elf_reader.h"
 #include "asylo/util/file_mapping.h"
 #include "asylo/util/function_deleter.h"
+#include "asylo/util/logging.h"
 #include "asylo/util/posix_error_space.h"
 #include "asylo/util/status.h"
 #include "asylo/util/status_macros.h"
@@ -63,6 +80,65 @@ forked_loader_callback_t forked_loader_callback;
 
 constexpr int kMaxEnclaveCreateAttempts = 5;
 
+// The SGX kernel driver requires enclaves to be aligned at a 4096-byte
+// boundary.
+constexpr size_t kEnclaveAlignment = 4096;
+
+// The binary of the calling process, mapped and parsed once and shared by all
+// loads of enclaves embedded in it.
+struct SelfBinary {
+  FileMapping mapping;
+  ElfReader reader;
+};
+
+// Returns the binary of the calling process, mapping it on first use. The
+// mapping lives until the process exits.
+StatusOr<const SelfBinary *> GetSelfBinary() {
+  static absl::Mutex *mu = new absl::Mutex();
+  static SelfBinary *self_binary = nullptr;
+
+  absl::MutexLock lock(mu);
+  if (!self_binary) {
+    auto binary = absl::make_unique<SelfBinary>();
+    ASYLO_ASSIGN_OR_RETURN(binary->mapping, FileMapping::CreateFromFile(
+                                                kCallingProcessBinaryFile));
+    ASYLO_ASSIGN_OR_RETURN(binary->reader, ElfReader::CreateFromSpan(
+                                               binary->mapping.buffer()));
+    self_binary = binary.release();
+  }
+  return self_binary;
+}
+
+// Size of the stack buffer used to pass small enclave call inputs.
+constexpr size_t kInlineEnclaveCallInputSize = 256;
+
+// Bounds on the time a thread donation waits between attempts to find a free
+// TCS.
+constexpr std::chrono::microseconds kMinTcsWait(10);
+constexpr std::chrono::microseconds kMaxTcsWait(1000);
+
+// Bit of AT_HWCAP2 set by kernels allowing FSGSBASE instructions in user code.
+constexpr unsigned long kHwcap2Fsgsbase = 1UL << 1;
+
+// Counts a host thread in |counter| for the duration of a scope.
+class ScopedThreadCount {
+ public:
+  explicit ScopedThreadCount(std::atomic<int64_t> *counter)
+      : counter_(counter) {
+    if (counter_) {
+      counter_->fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  ~ScopedThreadCount() {
+    if (counter_) {
+      counter_->fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+ private:
+  std::atomic<int64_t> *const counter_;
+};
+
 // Enters the enclave and invokes the secure snapshot key transfer entry-point.
 // If the ecall fails, return a non-OK status.
 static Status TransferSecureSnapshotKey(sgx_enclave_id_t eid, const char *input,
@@ -137,6 +213,84 @@ static Status Restore(sgx_enclave_id_t eid, const char *input, size_t input_len,
   return Status::OkStatus();
 }
 
+// Function symbols of an enclave binary, used to name the frames of exit
+// profiles.
+class EnclaveSymbols {
+ public:
+  // Reads the symbol table of the enclave binary at |path|. No frame is named
+  // if |path| is empty or the binary cannot be read or is stripped.
+  explicit EnclaveSymbols(absl::string_view path) {
+    if (path.empty()) {
+      return;
+    }
+    auto mapping = FileMapping::CreateFromFile(path);
+    if (!mapping.ok()) {
+      LOG(WARNING) << "Cannot read enclave symbols: " << mapping.status();
+      return;
+    }
+    auto reader = ElfReader::CreateFromSpan(mapping.ValueOrDie().buffer());
+    if (!reader.ok()) {
+      LOG(WARNING) << "Cannot read enclave symbols: " << reader.status();
+      return;
+    }
+    auto symtab = reader.ValueOrDie().GetSectionData(".symtab");
+    auto strtab = reader.ValueOrDie().GetSectionData(".strtab");
+    if (!symtab.ok() || !strtab.ok()) {
+      return;
+    }
+    absl::Span<const uint8_t> names = strtab.ValueOrDie();
+    auto entries =
+        reinterpret_cast<const Elf64_Sym *>(symtab.ValueOrDie().data());
+    size_t count = symtab.ValueOrDie().size() / sizeof(Elf64_Sym);
+    for (size_t i = 0; i < count; i++) {
+      const Elf64_Sym &entry = entries[i];
+      if (ELF64_ST_TYPE(entry.st_info) != STT_FUNC || entry.st_value == 0 ||
+          entry.st_name >= names.size()) {
+        continue;
+      }
+      auto name = reinterpret_cast<const char *>(names.data() + entry.st_name);
+      std::string mangled(name, strnlen(name, names.size() - entry.st_name));
+      int status;
+      std::unique_ptr<char, void (*)(void *)> demangled(
+          abi::__cxa_demangle(mangled.c_str(), nullptr, nullptr, &status),
+          free);
+      symbols_.push_back({entry.st_value, entry.st_size,
+                          status == 0 ? demangled.get() : mangled});
+    }
+    std::sort(symbols_.begin(), symbols_.end(),
+              [](const Symbol &a, const Symbol &b) {
+                return a.address < b.address;
+              });
+  }
+
+  // Names the function containing the call returning to |return_address|,
+  // relative to the enclave base.
+  std::string Symbolize(uint64_t return_address) const {
+    uint64_t address = return_address - 1;
+    auto next = std::upper_bound(
+        symbols_.begin(), symbols_.end(), address,
+        [](uint64_t address, const Symbol &symbol) {
+          return address < symbol.address;
+        });
+    if (next != symbols_.begin()) {
+      const Symbol &symbol = *(next - 1);
+      if (symbol.size == 0 || address < symbol.address + symbol.size) {
+        return symbol.name;
+      }
+    }
+    return absl::StrFormat("0x%x", return_address);
+  }
+
+ private:
+  struct Symbol {
+    uint64_t address;
+    uint64_t size;
+    std::string name;
+  };
+
+  std::vector<Symbol> symbols_;
+};
+
 }  // namespace
 
 SgxEnclaveClient::~SgxEnclaveClient() = default;
@@ -188,8 +342,6 @@ StatusOr<std::shared_ptr<Client>> SgxEmbeddedBackend::Load(
     absl::string_view section_name, size_t enclave_size,
     const EnclaveConfig &config, bool debug,
     std::unique_ptr<Client::ExitCallProvider> exit_call_provider) {
-  constexpr size_t kEnclaveAlignment = 4096;
-
   std::shared_ptr<SgxEnclaveClient> client(
       new SgxEnclaveClient(enclave_name, std::move(exit_call_provider)));
   client->RegisterExitHandlers();
@@ -212,31 +364,32 @@ StatusOr<std::shared_ptr<Client>> SgxEmbeddedBackend::Load(
     }
   }
 
-  FileMapping self_binary_mapping;
-  ASYLO_ASSIGN_OR_RETURN(self_binary_mapping, FileMapping::CreateFromFile(
-                                                  kCallingProcessBinaryFile));
-
-  ElfReader self_binary_reader;
-  ASYLO_ASSIGN_OR_RETURN(self_binary_reader, ElfReader::CreateFromSpan(
-                                                 self_binary_mapping.buffer()));
+  const SelfBinary *self_binary;
+  ASYLO_ASSIGN_OR_RETURN(self_binary, GetSelfBinary());
 
   absl::Span<const uint8_t> enclave_buffer;
   ASYLO_ASSIGN_OR_RETURN(enclave_buffer,
-                         self_binary_reader.GetSectionData(section_name));
-
-  // The SGX kernel driver requires enclaves to be aligned at a 4096-byte
-  // boundary.
-  void *aligned_enclave_ptr = nullptr;
-  int memalign_result = posix_memalign(&aligned_enclave_ptr, kEnclaveAlignment,
-                                       enclave_buffer.size());
-  if (memalign_result != 0) {
-    return Status(static_cast<error::PosixError>(memalign_result),
-                  "Failed to allocate aligned enclave buffer");
-  }
-  std::unique_ptr<uint8_t, FunctionDeleter<free>> aligned_enclave_buffer(
-      reinterpret_cast<uint8_t *>(aligned_enclave_ptr));
-  memcpy(aligned_enclave_buffer.get(), enclave_buffer.data(),
-         enclave_buffer.size());
+                         self_binary->reader.GetSectionData(section_name));
+
+  // Sections embedded with an aligned file offset are passed to the SGX SDK
+  // straight from the mapping of the binary. Otherwise the section is copied
+  // to an aligned buffer.
+  std::unique_ptr<uint8_t, FunctionDeleter<free>> aligned_enclave_buffer;
+  const uint8_t *enclave_data = enclave_buffer.data();
+  if (reinterpret_cast<uintptr_t>(enclave_data) % kEnclaveAlignment != 0) {
+    void *aligned_enclave_ptr = nullptr;
+    int memalign_result = posix_memalign(
+        &aligned_enclave_ptr, kEnclaveAlignment, enclave_buffer.size());
+    if (memalign_result != 0) {
+      return Status(static_cast<error::PosixError>(memalign_result),
+                    "Failed to allocate aligned enclave buffer");
+    }
+    aligned_enclave_buffer.reset(
+        reinterpret_cast<uint8_t *>(aligned_enclave_ptr));
+    memcpy(aligned_enclave_buffer.get(), enclave_buffer.data(),
+           enclave_buffer.size());
+    enclave_data = aligned_enclave_buffer.get();
+  }
 
   if (base_address && enclave_size > 0 &&
       munmap(base_address, enclave_size) < 0) {
@@ -254,9 +407,8 @@ StatusOr<std::shared_ptr<Client>> SgxEmbeddedBackend::Load(
   ex_features_p[SGX_CREATE_ENCLAVE_EX_ASYLO_BIT_IDX] = &create_config;
   for (int i = 0; i < kMaxEnclaveCreateAttempts; ++i) {
     status = sgx_create_enclave_from_buffer_ex(
-        const_cast<uint8_t *>(aligned_enclave_buffer.get()),
-        enclave_buffer.size(), debug, &client->id_,
-        /*misc_attr=*/nullptr, ex_features, ex_features_p);
+        const_cast<uint8_t *>(enclave_data), enclave_buffer.size(), debug,
+        &client->id_, /*misc_attr=*/nullptr, ex_features, ex_features_p);
 
     if (status != SGX_INTERNAL_ERROR_ENCLAVE_CREATE_INTERRUPTED) {
       break;
@@ -274,14 +426,34 @@ StatusOr<std::shared_ptr<Client>> SgxEmbeddedBackend::Load(
 }
 
 Status SgxEnclaveClient::Destroy() {
+  // Release the switchless enclave call workers so that finalization does not
+  // wait on them. Their queue stays allocated until the enclave is destroyed.
+  if (switchless_ecalls_) {
+    switchless_ecalls_->Close();
+  }
+  // Stop entering the enclave to deliver pending signals.
+  if (deferred_signals_) {
+    deferred_signals_->Stop();
+  }
+  if (profiling_) {
+    struct itimerval timer = {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    profiling_ = false;
+  }
   MessageReader output;
   ASYLO_RETURN_IF_ERROR(EnclaveCall(kSelectorAsyloFini, nullptr, &output));
+  // The enclave stops posting switchless exit calls once finalized.
+  switchless_ocall_workers_.reset();
   ScopedCurrentClient scoped_client(this);
   sgx_status_t status = sgx_destroy_enclave(id_);
   if (status != SGX_SUCCESS) {
     return Status(status, "Failed to destroy enclave");
   }
   is_destroyed_ = true;
+  switchless_ecalls_.reset();
+  host_time_updater_.reset();
+  host_info_watcher_.reset();
+  hugepage_arena_.reset();
   ASYLO_RETURN_IF_ERROR(
       EnclaveSignalDispatcher::GetInstance()->DeregisterAllSignalsForClient(
           this));
@@ -307,13 +479,20 @@ bool SgxEnclaveClient::IsClosed() const { return is_destroyed_; }
 Status SgxEnclaveClient::EnclaveCallInternal(uint64_t selector,
                                              MessageWriter *input,
                                              MessageReader *output) {
+  // Inputs that fit in |inline_input| are serialized on the stack, which saves
+  // a heap allocation on the common small-call path. The enclave copies the
+  // input into trusted memory before running any handler.
+  alignas(uint64_t) char inline_input[kInlineEnclaveCallInputSize];
+
   SgxParams params{};
   params.input_size = 0;
   params.input = nullptr;
   params.output = nullptr;
   params.output_size = 0;
-  Cleanup clean_up([&params] {
-    if (params.input) {
+  params.output_buffer = nullptr;
+  params.output_capacity = 0;
+  Cleanup clean_up([&params, &inline_input] {
+    if (params.input && params.input != inline_input) {
       free(const_cast<void *>(params.input));
     }
     if (params.output) {
@@ -321,19 +500,59 @@ Status SgxEnclaveClient::EnclaveCallInternal(uint64_t selector,
     }
   });
 
+  const bool donation = selector == kSelectorAsyloDonateThread;
+  // The enclave records in |parked| the exit call a donated thread parked in,
+  // if thread parking is enabled.
+  ParkedExitCall parked{};
+  if (donation && input) {
+    input->Push(reinterpret_cast<uint64_t>(&parked));
+  }
   if (input) {
     params.input_size = input->MessageSize();
     if (params.input_size > 0) {
-      params.input = malloc(static_cast<size_t>(params.input_size));
+      params.input = params.input_size <= sizeof(inline_input)
+                         ? inline_input
+                         : malloc(static_cast<size_t>(params.input_size));
       input->Serialize(const_cast<void *>(params.input));
     }
   }
+  thread_stats_.ecalls.fetch_add(1, std::memory_order_relaxed);
   int retval = 0;
-  sgx_status_t status =
-      ecall_dispatch_trusted_call(id_, &retval, selector, &params);
-  if (status != SGX_SUCCESS) {
-    // Return a Status object in the SGX error space.
-    return Status(status, "Call to primitives ecall endpoint failed");
+  // Donations hold on to the calling thread, which must serve the exit calls of
+  // its parked thread, so they never go through the switchless workers.
+  if (donation || !switchless_ecalls_ ||
+      !switchless_ecalls_->Dispatch(selector, &params, &retval)) {
+    if (donation) {
+      // Donated threads are started by the runtime for this enclave only, so
+      // they are placed once, before entering the enclave for good.
+      Status affinity_status = cpu_affinity_.ApplyToCurrentThread();
+      if (!affinity_status.ok()) {
+        LOG(WARNING) << "Donated thread runs unpinned: " << affinity_status;
+      }
+    }
+    ScopedThreadCount donated(donation ? &thread_stats_.donated_tcs : nullptr);
+    sgx_status_t status =
+        EnterEnclave(selector, &params, &retval, /*wait_for_tcs=*/donation);
+    // A parked thread left its TCS to the enclave while the exit call it
+    // blocks in is made here, and is resumed on any free TCS afterwards.
+    while (status == SGX_SUCCESS && !retval && parked.thread_id != 0) {
+      ocall_dispatch_untrusted_call(parked.selector, parked.params);
+      MessageWriter resume_input;
+      resume_input.Push(parked.thread_id);
+      resume_input.Push(reinterpret_cast<uint64_t>(&parked));
+      SgxParams resume_params{};
+      resume_params.input_size = resume_input.MessageSize();
+      resume_params.input = inline_input;
+      resume_input.Serialize(inline_input);
+      parked.thread_id = 0;
+      status = EnterEnclave(kSelectorAsyloResumeThread, &resume_params, &retval,
+                            /*wait_for_tcs=*/true);
+      free(resume_params.output);
+    }
+    if (status != SGX_SUCCESS) {
+      // Return a Status object in the SGX error space.
+      return Status(status, "Call to primitives ecall endpoint failed");
+    }
   }
   if (retval) {
     return Status(error::GoogleError::INTERNAL,
@@ -345,6 +564,82 @@ Status SgxEnclaveClient::EnclaveCallInternal(uint64_t selector,
   return Status::OkStatus();
 }
 
+sgx_status_t SgxEnclaveClient::EnterEnclave(uint64_t selector,
+                                            SgxParams *params, int *retval,
+                                            bool wait_for_tcs) {
+  ScopedThreadCount active(&thread_stats_.active_tcs);
+  sgx_status_t status =
+      ecall_dispatch_trusted_call(id_, retval, selector, params);
+  // A donated thread is the only way to run a queued pthread, so failing the
+  // donation would leave that pthread waiting forever. Wait for a TCS to be
+  // released instead.
+  if (wait_for_tcs && status == SGX_ERROR_OUT_OF_TCS) {
+    thread_stats_.tcs_waits.fetch_add(1, std::memory_order_relaxed);
+    auto wait_start = std::chrono::steady_clock::now();
+    std::chrono::microseconds wait = kMinTcsWait;
+    while (status == SGX_ERROR_OUT_OF_TCS && !is_destroyed_) {
+      std::this_thread::sleep_for(wait);
+      wait = std::min(2 * wait, kMaxTcsWait);
+      status = ecall_dispatch_trusted_call(id_, retval, selector, params);
+    }
+    thread_stats_.tcs_wait_ns.fetch_add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - wait_start)
+            .count(),
+        std::memory_order_relaxed);
+  }
+  return status;
+}
+
+Status SgxEnclaveClient::EnableSwitchlessOcalls(
+    const SgxLoadConfig::SwitchlessConfig &config) {
+  if (switchless_ocall_workers_) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Switchless exit calls are already enabled");
+  }
+  if (config.num_ocall_workers() <= 0) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Switchless exit calls require at least one worker");
+  }
+  auto workers = absl::make_unique<SwitchlessOcallWorkerPool>(
+      this, config.num_ocall_workers(), cpu_affinity_);
+  std::vector<uint64_t> selectors(config.ocall_selectors().begin(),
+                                  config.ocall_selectors().end());
+  MessageWriter input;
+  input.Push(reinterpret_cast<uint64_t>(workers->queue()));
+  input.Push(config.ocall_max_polls());
+  input.PushByCopy(Extent{selectors.data(), selectors.size()});
+  MessageReader output;
+  ASYLO_RETURN_IF_ERROR(
+      EnclaveCall(kSelectorAsyloInitSwitchlessOcalls, &input, &output));
+  switchless_ocall_workers_ = std::move(workers);
+  return Status::OkStatus();
+}
+
+Status SgxEnclaveClient::EnableSwitchlessEcalls(
+    const SgxLoadConfig::SwitchlessConfig &config) {
+  if (switchless_ecalls_) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Switchless enclave calls are already enabled");
+  }
+  if (config.num_ecall_workers() <= 0) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Switchless enclave calls require at least one worker");
+  }
+  std::vector<uint64_t> selectors(config.ecall_selectors().begin(),
+                                  config.ecall_selectors().end());
+  auto dispatcher = absl::make_unique<SwitchlessEcallDispatcher>(
+      selectors, config.ecall_max_polls());
+  MessageWriter input;
+  input.Push(reinterpret_cast<uint64_t>(dispatcher->queue()));
+  input.Push(config.num_ecall_workers());
+  MessageReader output;
+  ASYLO_RETURN_IF_ERROR(
+      EnclaveCall(kSelectorAsyloInitSwitchlessEcalls, &input, &output));
+  switchless_ecalls_ = std::move(dispatcher);
+  return Status::OkStatus();
+}
+
 int SgxEnclaveClient::EnterAndHandleSignal(int signum, int sigcode) {
   if (is_destroyed_) {
     return -1;
@@ -360,6 +655,320 @@ int SgxEnclaveClient::EnterAndHandleSignal(int signum, int sigcode) {
   return 0;
 }
 
+Status SgxEnclaveClient::EnableDeferredSignals() {
+  if (deferred_signals_) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Deferred signal delivery is already enabled");
+  }
+  auto delivery = absl::make_unique<DeferredSignalDelivery>(this);
+  MessageWriter input;
+  input.Push(reinterpret_cast<uint64_t>(delivery->pending_signals()));
+  MessageReader output;
+  ASYLO_RETURN_IF_ERROR(
+      EnclaveCall(kSelectorAsyloInitPendingSignals, &input, &output));
+  deferred_signals_ = std::move(delivery);
+  return Status::OkStatus();
+}
+
+Status SgxEnclaveClient::EnableHostTimePage(
+    const SgxLoadConfig::HostTimeConfig &config) {
+  if (host_time_updater_) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Host time page is already enabled");
+  }
+  if (config.update_interval_us() == 0) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Host time page update interval must be positive");
+  }
+  auto updater = absl::make_unique<HostTimeUpdater>(
+      std::chrono::microseconds(config.update_interval_us()));
+  MessageWriter input;
+  input.Push(reinterpret_cast<uint64_t>(updater->page()));
+  input.Push(config.max_reads_per_update());
+  MessageReader output;
+  ASYLO_RETURN_IF_ERROR(
+      EnclaveCall(kSelectorAsyloInitHostTimePage, &input, &output));
+  host_time_updater_ = std::move(updater);
+  host_time_max_reads_per_update_ = config.max_reads_per_update();
+  return Status::OkStatus();
+}
+
+Status SgxEnclaveClient::EnableHugepageArena(
+    const SgxLoadConfig::HugepageArenaConfig &config) {
+  if (hugepage_arena_) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Hugepage arena is already enabled");
+  }
+  std::unique_ptr<HugepageArena> arena;
+  ASYLO_ASSIGN_OR_RETURN(arena, HugepageArena::Create(config.size()));
+  if (!arena->hugetlb()) {
+    LOG(WARNING) << "Not enough free hugepages for a hugepage arena of "
+                 << arena->size()
+                 << " bytes, relying on transparent hugepages instead";
+  }
+  MessageWriter input;
+  input.Push(reinterpret_cast<uint64_t>(arena->base()));
+  input.Push(static_cast<uint64_t>(arena->size()));
+  MessageReader output;
+  ASYLO_RETURN_IF_ERROR(
+      EnclaveCall(kSelectorAsyloInitUntrustedArena, &input, &output));
+  hugepage_arena_ = std::move(arena);
+  return Status::OkStatus();
+}
+
+Status SgxEnclaveClient::EnableHostInfoCache(
+    const SgxLoadConfig::HostInfoCacheConfig &config) {
+  if (host_info_watcher_) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Host info cache is already enabled");
+  }
+  std::unique_ptr<HostInfoWatcher> watcher;
+  ASYLO_ASSIGN_OR_RETURN(
+      watcher, HostInfoWatcher::Create(
+                   config.watch_interfaces(),
+                   std::chrono::seconds(config.system_refresh_interval_s())));
+  MessageWriter input;
+  input.Push(reinterpret_cast<uint64_t>(watcher->generations()));
+  MessageReader output;
+  ASYLO_RETURN_IF_ERROR(
+      EnclaveCall(kSelectorAsyloInitHostInfoGenerations, &input, &output));
+  host_info_watcher_ = std::move(watcher);
+  return Status::OkStatus();
+}
+
+Status SgxEnclaveClient::InvalidateHostInfoCache() {
+  if (!host_info_watcher_) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Host info cache is not enabled");
+  }
+  host_info_watcher_->InvalidateAll();
+  return Status::OkStatus();
+}
+
+Status SgxEnclaveClient::EnableThreadParking(
+    const SgxLoadConfig::ThreadParkingConfig &config) {
+  // Parked threads are switched by setting the FS base inside the enclave,
+  // which faults unless the host kernel enabled FSGSBASE for user code.
+  if (!(getauxval(AT_HWCAP2) & kHwcap2Fsgsbase)) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Thread parking requires FSGSBASE support from the kernel");
+  }
+  MessageWriter input;
+  input.Push(config.stack_size());
+  input.Push(config.green_thread_workers());
+  MessageReader output;
+  return EnclaveCall(kSelectorAsyloInitThreadParking, &input, &output);
+}
+
+Status SgxEnclaveClient::SetCpuAffinity(
+    const SgxLoadConfig::CpuAffinityConfig &config) {
+  ASYLO_ASSIGN_OR_RETURN(cpu_affinity_, CpuAffinity::Create(config));
+  return Status::OkStatus();
+}
+
+Status SgxEnclaveClient::RegisterThreadStats() {
+  MessageWriter input;
+  input.Push(reinterpret_cast<uint64_t>(&thread_stats_));
+  MessageReader output;
+  return EnclaveCall(kSelectorAsyloInitThreadStats, &input, &output);
+}
+
+Status SgxEnclaveClient::EnableTracing(
+    const SgxLoadConfig::TraceConfig &config) {
+  if (trace_buffer_) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Tracing is already enabled");
+  }
+  auto buffer = absl::make_unique<EnclaveTraceBuffer>();
+  buffer->enabled.store(config.start_enabled(), std::memory_order_relaxed);
+  MessageWriter input;
+  input.Push(reinterpret_cast<uint64_t>(buffer.get()));
+  MessageReader output;
+  ASYLO_RETURN_IF_ERROR(
+      EnclaveCall(kSelectorAsyloInitTraceBuffer, &input, &output));
+  trace_buffer_ = std::move(buffer);
+  return Status::OkStatus();
+}
+
+Status SgxEnclaveClient::StartProfiling(
+    const SgxLoadConfig::ProfilerConfig &config) {
+  if (profiling_) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Profiling is already started");
+  }
+  if (config.sampling_frequency_hz() == 0 ||
+      config.sampling_frequency_hz() > 1000000) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Profiling frequency must be between 1 and 1000000 Hz");
+  }
+  MessageWriter input;
+  input.Push(true);
+  MessageReader output;
+  ASYLO_RETURN_IF_ERROR(
+      EnclaveCall(kSelectorAsyloSetProfiling, &input, &output));
+  uint64_t period_us = 1000000 / config.sampling_frequency_hz();
+  struct itimerval timer;
+  timer.it_interval.tv_sec = period_us / 1000000;
+  timer.it_interval.tv_usec = period_us % 1000000;
+  timer.it_value = timer.it_interval;
+  if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+    Status status(static_cast<error::PosixError>(errno),
+                  "Failed to arm the profiling timer");
+    MessageWriter stop_input;
+    stop_input.Push(false);
+    MessageReader stop_output;
+    EnclaveCall(kSelectorAsyloSetProfiling, &stop_input, &stop_output)
+        .IgnoreError();
+    return status;
+  }
+  profiling_ = true;
+  profiling_period_us_ = period_us;
+  return Status::OkStatus();
+}
+
+Status SgxEnclaveClient::StopProfiling() {
+  if (!profiling_) {
+    return Status::OkStatus();
+  }
+  struct itimerval timer = {};
+  setitimer(ITIMER_PROF, &timer, nullptr);
+  profiling_ = false;
+  MessageWriter input;
+  input.Push(false);
+  MessageReader output;
+  return EnclaveCall(kSelectorAsyloSetProfiling, &input, &output);
+}
+
+StatusOr<std::string> SgxEnclaveClient::TakeCpuProfile(
+    absl::string_view enclave_path) {
+  MessageReader output;
+  ASYLO_RETURN_IF_ERROR(
+      EnclaveCall(kSelectorAsyloTakeProfile, nullptr, &output));
+  std::vector<uint64_t> words;
+  while (output.hasNext()) {
+    words.push_back(output.next<uint64_t>());
+  }
+  if (words.empty()) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Malformed profile returned by the enclave");
+  }
+  if (words[0] > 0) {
+    LOG(WARNING) << "Enclave profile dropped " << words[0] << " samples";
+  }
+  std::vector<ProfileSample> samples;
+  for (size_t i = 1; i < words.size();) {
+    if (words.size() - i < 2 || words[i + 1] > kMaxProfileDepth ||
+        words.size() - i - 2 < words[i + 1]) {
+      return Status(error::GoogleError::INTERNAL,
+                    "Malformed profile returned by the enclave");
+    }
+    ProfileSample sample;
+    sample.count = words[i];
+    auto frames = words.begin() + i + 2;
+    sample.frames.assign(frames, frames + words[i + 1]);
+    i += 2 + words[i + 1];
+    samples.push_back(std::move(sample));
+  }
+  return SerializeCpuProfile(samples, profiling_period_us_, size_,
+                             enclave_path);
+}
+
+Status SgxEnclaveClient::StartExitProfiling(
+    const SgxLoadConfig::ExitProfilerConfig &config) {
+  if (config.max_stacks() == 0) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Exit profile must hold at least one stack");
+  }
+  MessageWriter input;
+  input.Push(true);
+  input.Push<uint64_t>(config.max_stacks());
+  MessageReader output;
+  return EnclaveCall(kSelectorAsyloSetExitProfiling, &input, &output);
+}
+
+Status SgxEnclaveClient::StopExitProfiling() {
+  MessageWriter input;
+  input.Push(false);
+  input.Push<uint64_t>(0);
+  MessageReader output;
+  return EnclaveCall(kSelectorAsyloSetExitProfiling, &input, &output);
+}
+
+StatusOr<FoldedExitProfile> SgxEnclaveClient::TakeExitProfile(
+    absl::string_view enclave_path) {
+  MessageReader output;
+  ASYLO_RETURN_IF_ERROR(
+      EnclaveCall(kSelectorAsyloTakeExitProfile, nullptr, &output));
+  std::vector<uint64_t> words;
+  while (output.hasNext()) {
+    words.push_back(output.next<uint64_t>());
+  }
+  if (words.empty()) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Malformed exit profile returned by the enclave");
+  }
+  if (words[0] > 0) {
+    LOG(WARNING) << "Enclave exit profile dropped " << words[0] << " exits";
+  }
+  std::vector<ExitSample> samples;
+  for (size_t i = 1; i < words.size();) {
+    if (words.size() - i < 4 || words[i + 3] > kMaxProfileDepth ||
+        words.size() - i - 4 < words[i + 3]) {
+      return Status(error::GoogleError::INTERNAL,
+                    "Malformed exit profile returned by the enclave");
+    }
+    ExitSample sample;
+    sample.exit = words[i];
+    sample.count = words[i + 1];
+    sample.nanos = words[i + 2];
+    auto frames = words.begin() + i + 4;
+    sample.frames.assign(frames, frames + words[i + 3]);
+    i += 4 + words[i + 3];
+    samples.push_back(std::move(sample));
+  }
+  EnclaveSymbols symbols(enclave_path);
+  auto symbolize = [&symbols](uint64_t frame) {
+    return symbols.Symbolize(frame);
+  };
+  FoldedExitProfile profile;
+  profile.counts = FormatFoldedExitStacks(samples, /*weigh_by_time=*/false,
+                                          symbolize);
+  profile.nanos = FormatFoldedExitStacks(samples, /*weigh_by_time=*/true,
+                                         symbolize);
+  return profile;
+}
+
+StatusOr<EnclaveMemoryStats> SgxEnclaveClient::GetMemoryStats() {
+  MessageReader output;
+  ASYLO_RETURN_IF_ERROR(
+      EnclaveCall(kSelectorAsyloGetMemoryStats, nullptr, &output));
+  constexpr size_t kNumHeapStats = 5;
+  if (output.size() < kNumHeapStats ||
+      (output.size() - kNumHeapStats) % 2 != 0) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Malformed memory statistics returned by the enclave");
+  }
+  EnclaveMemoryStats stats;
+  stats.heap_size = output.next<uint64_t>();
+  stats.heap_used = output.next<uint64_t>();
+  stats.heap_peak_used = output.next<uint64_t>();
+  stats.heap_allocated_bytes = output.next<uint64_t>();
+  stats.heap_free_bytes = output.next<uint64_t>();
+  while (output.hasNext()) {
+    EnclaveStackStats stack;
+    stack.size = output.next<uint64_t>();
+    stack.peak_used = output.next<uint64_t>();
+    stats.stacks.push_back(stack);
+  }
+  stats.epc = ReadEpcPagingStats();
+  return stats;
+}
+
+bool SgxEnclaveClient::DeferSignal(int signum) {
+  DeferredSignalDelivery *delivery = deferred_signals_.get();
+  return delivery && delivery->Post(signum);
+}
+
 Status SgxEnclaveClient::EnterAndTakeSnapshot(SnapshotLayout *snapshot_layout) {
   char *output_buf = nullptr;
   size_t output_len = 0;
@@ -414,6 +1023,45 @@ Status SgxEnclaveClient::EnterAndRestore(
   // is the untrusted caller's responsibility to free this buffer.
   free(output);
 
+  // The restored enclave state refers to the pending signal set of the parent
+  // enclave, so register the set of this client again.
+  if (status.ok() && deferred_signals_) {
+    MessageWriter input;
+    input.Push(
+        reinterpret_cast<uint64_t>(deferred_signals_->pending_signals()));
+    MessageReader pending_output;
+    status = EnclaveCall(kSelectorAsyloInitPendingSignals, &input,
+                         &pending_output);
+  }
+  // Likewise for the host time page.
+  if (status.ok() && host_time_updater_) {
+    MessageWriter input;
+    input.Push(reinterpret_cast<uint64_t>(host_time_updater_->page()));
+    input.Push(host_time_max_reads_per_update_);
+    MessageReader time_output;
+    status =
+        EnclaveCall(kSelectorAsyloInitHostTimePage, &input, &time_output);
+  }
+  // Likewise for the host info counters.
+  if (status.ok() && host_info_watcher_) {
+    MessageWriter input;
+    input.Push(reinterpret_cast<uint64_t>(host_info_watcher_->generations()));
+    MessageReader info_output;
+    status = EnclaveCall(kSelectorAsyloInitHostInfoGenerations, &input,
+                         &info_output);
+  }
+  // Likewise for the thread counters.
+  if (status.ok()) {
+    status = RegisterThreadStats();
+  }
+  // Likewise for the trace buffer.
+  if (status.ok() && trace_buffer_) {
+    MessageWriter input;
+    input.Push(reinterpret_cast<uint64_t>(trace_buffer_.get()));
+    MessageReader trace_output;
+    status =
+        EnclaveCall(kSelectorAsyloInitTraceBuffer, &input, &trace_output);
+  }
   return status;
 }
 
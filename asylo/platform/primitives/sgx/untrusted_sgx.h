@@ -19,12 +19,26 @@
 #ifndef ASYLO_PLATFORM_PRIMITIVES_SGX_UNTRUSTED_SGX_H_
 #define ASYLO_PLATFORM_PRIMITIVES_SGX_UNTRUSTED_SGX_H_
 
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <string>
 
 #include "absl/strings/string_view.h"
 #include "asylo/enclave.pb.h"  // IWYU pragma: export
+#include "asylo/platform/common/enclave_memory_stats.h"
+#include "asylo/platform/common/enclave_thread_stats.h"
+#include "asylo/platform/common/enclave_trace_buffer.h"
+#include "asylo/platform/primitives/sgx/cpu_affinity.h"
+#include "asylo/platform/primitives/sgx/deferred_signals.h"
 #include "asylo/platform/primitives/sgx/fork.pb.h"
+#include "asylo/platform/primitives/sgx/host_info_watcher.h"
+#include "asylo/platform/primitives/sgx/host_time_updater.h"
+#include "asylo/platform/primitives/sgx/hugepage_arena.h"
+#include "asylo/platform/primitives/sgx/loader.pb.h"
+#include "asylo/platform/primitives/sgx/sgx_params.h"
+#include "asylo/platform/primitives/sgx/untrusted_switchless.h"
 #include "asylo/platform/primitives/untrusted_primitives.h"
 #include "asylo/platform/primitives/util/message.h"
 #include "asylo/util/status.h"
@@ -64,6 +78,13 @@ struct SgxEmbeddedBackend {
       std::unique_ptr<Client::ExitCallProvider> exit_call_provider);
 };
 
+// Exits recorded by the exit profiler of an enclave, as folded stacks weighed
+// by number of exits and by time spent outside the enclave in nanoseconds.
+struct FoldedExitProfile {
+  std::string counts;
+  std::string nanos;
+};
+
 // SGX implementation of Client.
 class SgxEnclaveClient : public Client {
  public:
@@ -103,6 +124,105 @@ class SgxEnclaveClient : public Client {
 
   int EnterAndHandleSignal(int signum, int sigcode);
 
+  // Starts deferred delivery of asynchronous signals and enters the enclave to
+  // register the set of pending signals with it.
+  Status EnableDeferredSignals();
+
+  // Marks |signum| pending for the enclave to handle at the next enclave entry
+  // or exit of any of its threads. Returns false if deferred signal delivery
+  // is not enabled, in which case the caller must deliver |signum| with
+  // EnterAndHandleSignal(). Async-signal-safe.
+  bool DeferSignal(int signum);
+
+  // Starts refreshing a host time page as configured by |config| and enters
+  // the enclave to serve clock reads from it.
+  Status EnableHostTimePage(const SgxLoadConfig::HostTimeConfig &config);
+
+  // Maps a hugepage arena as configured by |config| and enters the enclave to
+  // carve its untrusted buffers from it.
+  Status EnableHugepageArena(const SgxLoadConfig::HugepageArenaConfig &config);
+
+  // Starts watching the host as configured by |config| and enters the enclave
+  // to cache host facts until the watcher invalidates them.
+  Status EnableHostInfoCache(const SgxLoadConfig::HostInfoCacheConfig &config);
+
+  // Makes the enclave refresh every cached host fact on its next use, for
+  // instance after the host name or user database changed. Returns an error if
+  // the host info cache is not enabled.
+  Status InvalidateHostInfoCache();
+
+  // Enters the enclave to have the trusted thread manager publish its counters
+  // to thread_stats().
+  Status RegisterThreadStats();
+
+  const EnclaveThreadStats *thread_stats() const override {
+    return &thread_stats_;
+  }
+
+  // Allocates a trace buffer with recording enabled if |config| says so, and
+  // enters the enclave to record hot-path events to it.
+  Status EnableTracing(const SgxLoadConfig::TraceConfig &config);
+
+  EnclaveTraceBuffer *trace_buffer() override { return trace_buffer_.get(); }
+
+  // Enters the enclave to start sampling its stacks, and arms a process CPU
+  // time profiling timer at the frequency set by |config|. The timer is
+  // process-wide, so only one enclave of a process can be profiled at a time,
+  // and it conflicts with host profilers using SIGPROF.
+  Status StartProfiling(const SgxLoadConfig::ProfilerConfig &config);
+
+  // Disarms the profiling timer and enters the enclave to stop sampling.
+  Status StopProfiling();
+
+  // Enters the enclave to collect the samples recorded since the last call,
+  // and returns them as a CPU profile readable by pprof. Frames are
+  // symbolized against |enclave_path|, the enclave binary.
+  StatusOr<std::string> TakeCpuProfile(absl::string_view enclave_path);
+
+  // Enters the enclave to start attributing its exit calls to the trusted
+  // stacks making them, in a table sized by |config|.
+  Status StartExitProfiling(const SgxLoadConfig::ExitProfilerConfig &config);
+
+  // Enters the enclave to stop attributing exit calls.
+  Status StopExitProfiling();
+
+  // Enters the enclave to collect the exits recorded since the last call, and
+  // returns them as folded stacks readable by flamegraph.pl. Frames are
+  // symbolized against the symbol table of |enclave_path|, the enclave binary,
+  // and named by enclave-relative address if it has none.
+  StatusOr<FoldedExitProfile> TakeExitProfile(absl::string_view enclave_path);
+
+  // Enters the enclave to read its heap and stack usage, and reads the EPC
+  // counters of the host from the SGX driver.
+  StatusOr<EnclaveMemoryStats> GetMemoryStats() override;
+
+  // Counts an exit call dispatched on behalf of the enclave.
+  void CountExitCall() {
+    thread_stats_.ocalls.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Places the threads donated to the enclave and the switchless exit call
+  // workers started afterwards as configured by |config|.
+  Status SetCpuAffinity(const SgxLoadConfig::CpuAffinityConfig &config);
+
+  // Starts a pool of untrusted worker threads and enters the enclave to enable
+  // switchless dispatch of the exit calls selected by |config|.
+  Status EnableSwitchlessOcalls(
+      const SgxLoadConfig::SwitchlessConfig &config);
+
+  // Enters the enclave to start the enclave worker threads selected by
+  // |config|, and dispatches subsequent calls to the enclave call selectors
+  // in |config| through them.
+  Status EnableSwitchlessEcalls(
+      const SgxLoadConfig::SwitchlessConfig &config);
+
+  // Enters the enclave to run the threads donated afterwards as parkable
+  // threads, configured by |config|, which release their TCS while blocked in
+  // an exit call, and to start the green thread workers requested by |config|.
+  // Returns an error if the host or the SGX runtime cannot switch between
+  // threads inside the enclave.
+  Status EnableThreadParking(const SgxLoadConfig::ThreadParkingConfig &config);
+
   // Sets a new expected process ID for an existing SGX enclave.
   void SetProcessId();
 
@@ -120,6 +240,11 @@ class SgxEnclaveClient : public Client {
   bool IsClosed() const override;
 
  private:
+  // Enters the enclave to handle |selector| with |params|. If |wait_for_tcs|,
+  // waits for a TCS to be released instead of failing when none is free.
+  sgx_status_t EnterEnclave(uint64_t selector, SgxParams *params, int *retval,
+                            bool wait_for_tcs);
+
   friend SgxBackend;
   friend SgxEmbeddedBackend;
 
@@ -133,6 +258,48 @@ class SgxEnclaveClient : public Client {
   void *base_address_;              // Enclave base address.
   size_t size_;                     // Enclave size.
   bool is_destroyed_ = true;        // Whether enclave is destroyed.
+
+  // Worker pool serving switchless exit calls, or nullptr if switchless exit
+  // calls are disabled.
+  std::unique_ptr<SwitchlessOcallWorkerPool> switchless_ocall_workers_;
+
+  // Dispatcher of switchless enclave calls, or nullptr if switchless enclave
+  // calls are disabled.
+  std::unique_ptr<SwitchlessEcallDispatcher> switchless_ecalls_;
+
+  // Deferred delivery of asynchronous signals, or nullptr if every signal is
+  // delivered with an enclave call. Stopped, but not released, when the
+  // enclave is destroyed, since signal handlers may still reference it.
+  std::unique_ptr<DeferredSignalDelivery> deferred_signals_;
+
+  // Updater of the host time page read by the enclave, or nullptr if every
+  // clock read leaves the enclave.
+  std::unique_ptr<HostTimeUpdater> host_time_updater_;
+
+  // Number of reads of an unchanged time page snapshot the enclave serves.
+  uint32_t host_time_max_reads_per_update_ = 0;
+
+  // Watcher invalidating the host facts cached by the enclave, or nullptr if
+  // every query of such facts leaves the enclave.
+  std::unique_ptr<HostInfoWatcher> host_info_watcher_;
+
+  // Arena the enclave carves its untrusted buffers from, or nullptr if they
+  // are allocated from the host heap. Unmapped once the enclave is destroyed.
+  std::unique_ptr<HugepageArena> hugepage_arena_;
+
+  // Placement of the untrusted threads serving the enclave.
+  CpuAffinity cpu_affinity_;
+
+  // Thread and transition counters of the enclave. Shared with the enclave
+  // once registered with RegisterThreadStats().
+  EnclaveThreadStats thread_stats_;
+
+  // Whether the profiling timer is armed, and its last sampling period.
+  bool profiling_ = false;
+  uint64_t profiling_period_us_ = 0;
+
+  // Event trace recorded by the enclave, or nullptr if tracing is disabled.
+  std::unique_ptr<EnclaveTraceBuffer> trace_buffer_;
 };
 
 }  // namespace primitives
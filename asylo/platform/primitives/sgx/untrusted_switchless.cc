@@ -0,0 +1,129 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/sgx/untrusted_switchless.h"
+
+#include <chrono>
+#include <thread>
+
+#include "absl/memory/memory.h"
+#include "asylo/util/logging.h"
+#include "asylo/platform/primitives/sgx/generated_bridge_u.h"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+// Number of consecutive empty polls after which an idle worker starts sleeping
+// between polls instead of spinning.
+constexpr int kIdlePollsBeforeSleep = 4096;
+
+// Time an idle worker sleeps between polls once it stopped spinning.
+constexpr std::chrono::microseconds kIdleSleep(20);
+
+}  // namespace
+
+SwitchlessOcallWorkerPool::SwitchlessOcallWorkerPool(
+    Client *client, int num_workers, const CpuAffinity &affinity)
+    : client_(client),
+      affinity_(affinity),
+      queue_(absl::make_unique<SwitchlessQueue>()) {
+  for (int i = 0; i < num_workers; i++) {
+    workers_.emplace_back(&SwitchlessOcallWorkerPool::Run, this);
+  }
+}
+
+SwitchlessOcallWorkerPool::~SwitchlessOcallWorkerPool() {
+  queue_->Close();
+  for (auto &worker : workers_) {
+    worker.Join();
+  }
+}
+
+void SwitchlessOcallWorkerPool::Run() {
+  // Exit handlers expect the current client to be set, as it would be on an
+  // enclave thread making a regular ocall.
+  Client::ScopedCurrentClient scoped_client(client_);
+  Status status = affinity_.ApplyToCurrentThread();
+  if (!status.ok()) {
+    LOG(WARNING) << "Switchless exit call worker runs unpinned: " << status;
+  }
+  int idle_polls = 0;
+  while (!queue_->IsClosed()) {
+    int index = queue_->Take();
+    if (index < 0) {
+      if (++idle_polls < kIdlePollsBeforeSleep) {
+        __builtin_ia32_pause();
+      } else {
+        std::this_thread::sleep_for(kIdleSleep);
+      }
+      continue;
+    }
+    idle_polls = 0;
+    SwitchlessQueue::Slot *slot = queue_->slot(index);
+    int result = ocall_dispatch_untrusted_call(slot->selector, slot->params);
+    queue_->Complete(index, result);
+  }
+}
+
+SwitchlessEcallDispatcher::SwitchlessEcallDispatcher(
+    const std::vector<uint64_t> &selectors, uint32_t max_polls)
+    : queue_(absl::make_unique<SwitchlessQueue>()),
+      selectors_(selectors.begin(), selectors.end()),
+      max_polls_(max_polls),
+      closed_(false) {}
+
+SwitchlessEcallDispatcher::~SwitchlessEcallDispatcher() { Close(); }
+
+bool SwitchlessEcallDispatcher::Dispatch(uint64_t selector, SgxParams *params,
+                                         int *result) {
+  if (closed_.load(std::memory_order_acquire) ||
+      !selectors_.contains(selector)) {
+    return false;
+  }
+  int index = queue_->Reserve();
+  if (index < 0) {
+    return false;
+  }
+  SwitchlessQueue::Slot *slot = queue_->slot(index);
+  slot->selector = selector;
+  slot->params = params;
+  queue_->Post(index);
+
+  for (uint32_t i = 0; queue_->IsPosted(index); i++) {
+    if (i >= max_polls_ && queue_->Withdraw(index)) {
+      queue_->Release(index);
+      return false;
+    }
+    __builtin_ia32_pause();
+  }
+  while (!queue_->IsDone(index)) {
+    __builtin_ia32_pause();
+  }
+  *result = slot->result;
+  queue_->Release(index);
+  return true;
+}
+
+void SwitchlessEcallDispatcher::Close() {
+  closed_.store(true, std::memory_order_release);
+  queue_->Close();
+}
+
+}  // namespace primitives
+}  // namespace asylo
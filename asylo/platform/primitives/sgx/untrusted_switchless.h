@@ -0,0 +1,109 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_SGX_UNTRUSTED_SWITCHLESS_H_
+#define ASYLO_PLATFORM_PRIMITIVES_SGX_UNTRUSTED_SWITCHLESS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "asylo/platform/primitives/sgx/cpu_affinity.h"
+#include "asylo/platform/primitives/sgx/sgx_params.h"
+#include "asylo/platform/primitives/sgx/switchless_queue.h"
+#include "asylo/platform/primitives/untrusted_primitives.h"
+#include "asylo/util/thread.h"
+
+namespace asylo {
+namespace primitives {
+
+// A pool of untrusted threads serving switchless exit calls. Each worker polls
+// a SwitchlessQueue shared with the enclave and dispatches posted requests to
+// the exit handlers of the owning client, exactly as a regular
+// ocall_dispatch_untrusted_call would, but without the enclave thread leaving
+// the enclave.
+class SwitchlessOcallWorkerPool {
+ public:
+  // Starts |num_workers| threads dispatching exit calls on behalf of |client|,
+  // which must outlive the pool. The threads are placed as described by
+  // |affinity|.
+  SwitchlessOcallWorkerPool(Client *client, int num_workers,
+                            const CpuAffinity &affinity = CpuAffinity());
+
+  // Closes the queue and joins all worker threads.
+  ~SwitchlessOcallWorkerPool();
+
+  SwitchlessOcallWorkerPool(const SwitchlessOcallWorkerPool &other) = delete;
+  SwitchlessOcallWorkerPool &operator=(const SwitchlessOcallWorkerPool &other) =
+      delete;
+
+  // Returns the queue served by this pool.
+  SwitchlessQueue *queue() { return queue_.get(); }
+
+ private:
+  // Body of each worker thread.
+  void Run();
+
+  Client *const client_;
+  const CpuAffinity affinity_;
+  const std::unique_ptr<SwitchlessQueue> queue_;
+  std::vector<Thread> workers_;
+};
+
+// Untrusted side of switchless enclave calls. Posts enclave calls to a
+// SwitchlessQueue polled by worker threads donated to the enclave, so that the
+// calling thread does not have to enter the enclave itself.
+class SwitchlessEcallDispatcher {
+ public:
+  // Creates a dispatcher for enclave calls to |selectors|. A posted call that
+  // is not picked up by an enclave worker after |max_polls| polls is withdrawn.
+  SwitchlessEcallDispatcher(const std::vector<uint64_t> &selectors,
+                            uint32_t max_polls);
+
+  // Closes the queue, which makes the enclave workers return.
+  ~SwitchlessEcallDispatcher();
+
+  SwitchlessEcallDispatcher(const SwitchlessEcallDispatcher &other) = delete;
+  SwitchlessEcallDispatcher &operator=(const SwitchlessEcallDispatcher &other) =
+      delete;
+
+  // Returns the queue polled by the enclave workers.
+  SwitchlessQueue *queue() { return queue_.get(); }
+
+  // Attempts to run the enclave call |selector| with the parameter block
+  // |params| on an enclave worker thread. Returns true and sets |result| to
+  // the value returned by the enclave if the call was run, or false if the
+  // caller must fall back to a regular ecall.
+  bool Dispatch(uint64_t selector, SgxParams *params, int *result);
+
+  // Stops dispatching calls and signals the enclave workers to return.
+  void Close();
+
+ private:
+  const std::unique_ptr<SwitchlessQueue> queue_;
+  const absl::flat_hash_set<uint64_t> selectors_;
+  const uint32_t max_polls_;
+  std::atomic<bool> closed_;
+};
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_SGX_UNTRUSTED_SWITCHLESS_H_
@@ -0,0 +1,132 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <time.h>
+#include <unistd.h>
+
+#include <cstdint>
+
+#include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/platform/primitives/extent.h"
+#include "asylo/platform/primitives/primitive_status.h"
+#include "asylo/platform/primitives/test/benchmark_selectors.h"
+#include "asylo/platform/primitives/trusted_primitives.h"
+#include "asylo/platform/primitives/trusted_runtime.h"
+#include "asylo/platform/primitives/util/message.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+// Message handler doing nothing, to measure empty enclave calls.
+PrimitiveStatus Empty(void *context, MessageReader *in, MessageWriter *out) {
+  return PrimitiveStatus::OkStatus();
+}
+
+// Message handler returning its only input, to measure enclave calls passing a
+// payload in each direction.
+PrimitiveStatus Echo(void *context, MessageReader *in, MessageWriter *out) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 1);
+  out->PushByCopy(in->next());
+  return PrimitiveStatus::OkStatus();
+}
+
+// Message handler making the number of kBenchmarkUntrustedEcho exit calls given
+// by the first input, each passing the second input as payload unless it is
+// empty.
+PrimitiveStatus ExitCalls(void *context, MessageReader *in,
+                          MessageWriter *out) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 2);
+  const uint64_t count = in->next<uint64_t>();
+  const Extent payload = in->next();
+  for (uint64_t i = 0; i < count; ++i) {
+    MessageWriter exit_input;
+    if (payload.size() > 0) {
+      exit_input.PushByReference(payload);
+    }
+    MessageReader exit_output;
+    ASYLO_RETURN_IF_ERROR(TrustedPrimitives::UntrustedCall(
+        kBenchmarkUntrustedEcho, &exit_input, &exit_output));
+  }
+  return PrimitiveStatus::OkStatus();
+}
+
+// Message handler making the number of host calls given by the second input,
+// of the BenchmarkHostCall kind given by the first input. Writes go to the host
+// file descriptor given by the third input.
+PrimitiveStatus HostCalls(void *context, MessageReader *in,
+                          MessageWriter *out) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 3);
+  const auto host_call = in->next<BenchmarkHostCall>();
+  const uint64_t count = in->next<uint64_t>();
+  const int fd = in->next<int>();
+  const char byte = 0;
+  struct timespec ts;
+  for (uint64_t i = 0; i < count; ++i) {
+    switch (host_call) {
+      case BenchmarkHostCall::kGetpid:
+        enc_untrusted_getpid();
+        break;
+      case BenchmarkHostCall::kWrite:
+        if (enc_untrusted_write(fd, &byte, sizeof(byte)) != sizeof(byte)) {
+          return {error::GoogleError::INTERNAL, "write host call failed"};
+        }
+        break;
+      case BenchmarkHostCall::kClockGettime:
+        if (enc_untrusted_clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+          return {error::GoogleError::INTERNAL,
+                  "clock_gettime host call failed"};
+        }
+        break;
+      default:
+        return {error::GoogleError::INVALID_ARGUMENT, "Unknown host call"};
+    }
+  }
+  return PrimitiveStatus::OkStatus();
+}
+
+}  // namespace
+}  // namespace primitives
+}  // namespace asylo
+
+using ::asylo::primitives::EntryHandler;
+using ::asylo::primitives::PrimitiveStatus;
+using ::asylo::primitives::TrustedPrimitives;
+
+// Implements the required enclave initialization function.
+extern "C" PrimitiveStatus asylo_enclave_init() {
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      asylo::primitives::kBenchmarkEmptySelector,
+      EntryHandler{asylo::primitives::Empty}));
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      asylo::primitives::kBenchmarkEchoSelector,
+      EntryHandler{asylo::primitives::Echo}));
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      asylo::primitives::kBenchmarkExitCallsSelector,
+      EntryHandler{asylo::primitives::ExitCalls}));
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      asylo::primitives::kBenchmarkHostCallsSelector,
+      EntryHandler{asylo::primitives::HostCalls}));
+  return PrimitiveStatus::OkStatus();
+}
+
+// Implements the required enclave finalization function.
+extern "C" PrimitiveStatus asylo_enclave_fini() {
+  return PrimitiveStatus::OkStatus();
+}
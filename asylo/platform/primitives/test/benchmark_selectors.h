@@ -0,0 +1,48 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_TEST_BENCHMARK_SELECTORS_H_
+#define ASYLO_PLATFORM_PRIMITIVES_TEST_BENCHMARK_SELECTORS_H_
+
+#include <cstdint>
+
+#include "asylo/platform/primitives/primitives.h"
+
+namespace asylo {
+namespace primitives {
+
+// Entry points registered by the benchmark enclave.
+constexpr uint64_t kBenchmarkEmptySelector = kSelectorUser + 1;
+constexpr uint64_t kBenchmarkEchoSelector = kSelectorUser + 2;
+constexpr uint64_t kBenchmarkExitCallsSelector = kSelectorUser + 3;
+constexpr uint64_t kBenchmarkHostCallsSelector = kSelectorUser + 4;
+
+// Exit point registered by the benchmark driver.
+constexpr uint64_t kBenchmarkUntrustedEcho = kSelectorUser + 1;
+
+// Host calls made by kBenchmarkHostCallsSelector.
+enum class BenchmarkHostCall : uint64_t {
+  kGetpid = 1,
+  kWrite = 2,
+  kClockGettime = 3,
+};
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_TEST_BENCHMARK_SELECTORS_H_
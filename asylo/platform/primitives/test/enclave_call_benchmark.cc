@@ -0,0 +1,230 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Benchmarks of enclave calls, exit calls and host calls through the primitives
+// API. The benchmarks are linked against each test backend, so that the same
+// costs are measured on the dlopen, remote dlopen, SGX simulation and SGX
+// hardware backends. They are only executed when selected with --benchmarks,
+// and results are written as JSON with --benchmark_out, for example:
+//
+//   bazel run //asylo/platform/primitives/test:dlopen_enclave_call_benchmark \
+//       -- --benchmarks=all --benchmark_out=/tmp/dlopen.json
+//
+// Exit calls and host calls are made in batches by a single enclave call, so
+// their exit_call_ns and host_call_ns counters include a share of the enclave
+// call cost. BM_NativeCall measures the same calls made directly by the host as
+// a baseline for the host calls.
+
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "asylo/platform/host_call/untrusted/host_call_handlers_initializer.h"
+#include "asylo/platform/primitives/extent.h"
+#include "asylo/platform/primitives/test/benchmark_selectors.h"
+#include "asylo/platform/primitives/test/test_backend.h"
+#include "asylo/platform/primitives/untrusted_primitives.h"
+#include "asylo/platform/primitives/util/dispatch_table.h"
+#include "asylo/platform/primitives/util/message.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/status.h"
+#include <benchmark/benchmark.h>
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+// Number of exit calls or host calls made by each benchmarked enclave call.
+constexpr uint64_t kCallsPerEnclaveCall = 100;
+
+// Returns the benchmark enclave, which is loaded on first use and shared by
+// all benchmarks and threads for the rest of the process.
+Client *GetClient() {
+  static Client *client = [] {
+    auto exit_call_provider = absl::make_unique<DispatchTable>();
+    Status status = exit_call_provider->RegisterExitHandler(
+        kBenchmarkUntrustedEcho,
+        ExitHandler{[](std::shared_ptr<Client> client, void *context,
+                       MessageReader *in, MessageWriter *out) {
+          while (in->hasNext()) {
+            out->PushByCopy(in->next());
+          }
+          return Status::OkStatus();
+        }});
+    if (status.ok()) {
+      status = host_call::AddHostCallHandlersToExitCallProvider(
+          exit_call_provider.get());
+    }
+    LOG_IF(FATAL, !status.ok()) << "Failed to register exit handlers: "
+                                << status;
+    auto *loaded = new std::shared_ptr<Client>(
+        test::TestBackend::Get()->LoadTestEnclaveOrDie(
+            /*enclave_name=*/"enclave_call_benchmark",
+            std::move(exit_call_provider)));
+    LOG_IF(FATAL, !*loaded) << "Failed to load the benchmark enclave";
+    return loaded->get();
+  }();
+  return client;
+}
+
+// Makes an enclave call, stopping the benchmark on failure.
+bool EnclaveCallOrSkip(benchmark::State &state, uint64_t selector,
+                       MessageWriter *in, MessageReader *out) {
+  Status status = GetClient()->EnclaveCall(selector, in, out);
+  if (!status.ok()) {
+    state.SkipWithError(status.ToString().c_str());
+    return false;
+  }
+  return true;
+}
+
+// Sets counter |name| to the average real time in nanoseconds of each of the
+// kCallsPerEnclaveCall calls made by each iteration since |start|.
+void SetNanosecondsPerCall(benchmark::State &state, const char *name,
+                           absl::Time start) {
+  const double calls = state.iterations() * kCallsPerEnclaveCall;
+  if (calls > 0) {
+    state.counters[name] = benchmark::Counter(
+        absl::ToDoubleNanoseconds(absl::Now() - start) / calls,
+        benchmark::Counter::kAvgThreads);
+  }
+}
+
+void BM_EmptyEnclaveCall(benchmark::State &state) {
+  GetClient();
+  for (auto _ : state) {
+    MessageWriter in;
+    MessageReader out;
+    if (!EnclaveCallOrSkip(state, kBenchmarkEmptySelector, &in, &out)) {
+      break;
+    }
+  }
+}
+BENCHMARK(BM_EmptyEnclaveCall)->ThreadRange(1, 16)->UseRealTime();
+
+// Passes a payload of state.range(0) bytes into the enclave and back.
+void BM_EnclaveCallPayload(benchmark::State &state) {
+  GetClient();
+  const std::string payload(state.range(0), 'x');
+  for (auto _ : state) {
+    MessageWriter in;
+    in.PushByReference(Extent{payload.data(), payload.size()});
+    MessageReader out;
+    if (!EnclaveCallOrSkip(state, kBenchmarkEchoSelector, &in, &out)) {
+      break;
+    }
+  }
+  state.SetBytesProcessed(2 * state.iterations() * payload.size());
+}
+BENCHMARK(BM_EnclaveCallPayload)
+    ->Arg(0)
+    ->RangeMultiplier(16)
+    ->Range(16, 1 << 20)
+    ->UseRealTime();
+
+// Makes exit calls passing a payload of state.range(0) bytes out of the enclave
+// and back.
+void BM_ExitCall(benchmark::State &state) {
+  GetClient();
+  const std::string payload(state.range(0), 'x');
+  const absl::Time start = absl::Now();
+  for (auto _ : state) {
+    MessageWriter in;
+    in.Push(kCallsPerEnclaveCall);
+    in.PushByReference(Extent{payload.data(), payload.size()});
+    MessageReader out;
+    if (!EnclaveCallOrSkip(state, kBenchmarkExitCallsSelector, &in, &out)) {
+      break;
+    }
+  }
+  SetNanosecondsPerCall(state, "exit_call_ns", start);
+  state.SetBytesProcessed(2 * state.iterations() * kCallsPerEnclaveCall *
+                          payload.size());
+}
+BENCHMARK(BM_ExitCall)->Arg(0)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_ExitCall)->RangeMultiplier(16)->Range(16, 1 << 20)->UseRealTime();
+
+// Opens /dev/null as the target of write host calls, once per process.
+int GetDevNull() {
+  static const int fd = [] {
+    int fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    LOG_IF(FATAL, fd < 0) << "Failed to open /dev/null: " << strerror(errno);
+    return fd;
+  }();
+  return fd;
+}
+
+void BM_HostCall(benchmark::State &state, BenchmarkHostCall host_call) {
+  GetClient();
+  const int fd = GetDevNull();
+  const absl::Time start = absl::Now();
+  for (auto _ : state) {
+    MessageWriter in;
+    in.Push(host_call);
+    in.Push(kCallsPerEnclaveCall);
+    in.Push(fd);
+    MessageReader out;
+    if (!EnclaveCallOrSkip(state, kBenchmarkHostCallsSelector, &in, &out)) {
+      break;
+    }
+  }
+  SetNanosecondsPerCall(state, "host_call_ns", start);
+}
+BENCHMARK_CAPTURE(BM_HostCall, getpid, BenchmarkHostCall::kGetpid)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_HostCall, write, BenchmarkHostCall::kWrite)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_HostCall, clock_gettime, BenchmarkHostCall::kClockGettime)
+    ->UseRealTime();
+
+void BM_NativeCall(benchmark::State &state, BenchmarkHostCall host_call) {
+  const int fd = GetDevNull();
+  const char byte = 0;
+  struct timespec ts;
+  for (auto _ : state) {
+    switch (host_call) {
+      case BenchmarkHostCall::kGetpid:
+        benchmark::DoNotOptimize(getpid());
+        break;
+      case BenchmarkHostCall::kWrite:
+        benchmark::DoNotOptimize(write(fd, &byte, sizeof(byte)));
+        break;
+      case BenchmarkHostCall::kClockGettime:
+        benchmark::DoNotOptimize(clock_gettime(CLOCK_MONOTONIC, &ts));
+        break;
+    }
+  }
+}
+BENCHMARK_CAPTURE(BM_NativeCall, getpid, BenchmarkHostCall::kGetpid);
+BENCHMARK_CAPTURE(BM_NativeCall, write, BenchmarkHostCall::kWrite);
+BENCHMARK_CAPTURE(BM_NativeCall, clock_gettime,
+                  BenchmarkHostCall::kClockGettime);
+
+}  // namespace
+}  // namespace primitives
+}  // namespace asylo
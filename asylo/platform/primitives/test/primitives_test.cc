@@ -28,6 +28,7 @@
 #include "absl/memory/memory.h"
 #include "asylo/platform/primitives/extent.h"
 #include "asylo/platform/primitives/primitive_status.h"
+#include "asylo/platform/primitives/primitives.h"
 #include "asylo/platform/primitives/test/test_backend.h"
 #include "asylo/platform/primitives/test/test_selectors.h"
 #include "asylo/platform/primitives/trusted_primitives.h"
@@ -219,6 +220,27 @@ TEST_F(PrimitivesTest, LoadEnclave) {
   EXPECT_THAT(status, Not(IsOk()));
 }
 
+// Ensure that the first entry into a fresh enclave initializes it, which fails
+// if a placeholder handler was registered for a selector the backend serves,
+// and that the unused selectors below those of the remote backends are rejected
+// without aborting it.
+TEST_F(PrimitivesTest, ReservedSelectors) {
+  auto client = LoadTestEnclaveOrDie(/*reload=*/true);
+  EXPECT_THAT(MultiplyByTwoOrDie(client, 1), Eq(2));
+
+  for (uint64_t selector = kSelectorAsyloLastReserved + 1;
+       selector < kSelectorRemote; selector++) {
+    MessageWriter in;
+    MessageReader out;
+    EXPECT_THAT(client->EnclaveCall(selector, &in, &out),
+                StatusIs(error::GoogleError::INTERNAL));
+  }
+
+  EXPECT_FALSE(client->IsClosed());
+  EXPECT_THAT(MultiplyByTwoOrDie(client, 2), Eq(4));
+  client->Destroy();
+}
+
 // Ensure that an aborted enclave cannot be reentered.
 TEST_F(PrimitivesTest, AbortEnclave) {
   // If the enclave is aborted, then the call to the finalizer routine and
@@ -26,6 +26,7 @@
 #include "asylo/platform/primitives/primitive_status.h"
 #include "asylo/platform/primitives/primitives.h"
 #include "asylo/platform/primitives/util/message.h"
+#include "asylo/platform/primitives/util/typed_call.h"
 #include "asylo/util/asylo_macros.h"
 
 namespace asylo {
@@ -131,6 +132,34 @@ class TrustedPrimitives {
       uint64_t untrusted_selector, MessageWriter *input,
       MessageReader *output) ASYLO_MUST_USE_RESULT;
 
+  /// Makes the exit call declared by the TypedCall `Call`, marshaling
+  /// `request` and `response` with a single copy each.
+  ///
+  /// \param request The request of the call.
+  /// \param response A pointer to the response of the call.
+  /// \returns A status for the call action, which is an error if the response
+  ///    does not have the layout of `Call::Response`.
+  template <typename Call>
+  ASYLO_MUST_USE_RESULT static PrimitiveStatus TypedUntrustedCall(
+      const typename Call::Request &request,
+      typename Call::Response *response) {
+    MessageWriter input;
+    internal::PushTyped(request, &input);
+    MessageReader output;
+    PrimitiveStatus status = UntrustedCall(Call::kSelector, &input, &output);
+    if (!status.ok()) {
+      return status;
+    }
+    return internal::PopTyped(&output, response);
+  }
+
+  /// Like UntrustedCall(), for an untrusted call that may block for a long
+  /// time. Backends able to do so release the resources the calling thread
+  /// holds inside the enclave, such as its TCS on SGX, until the call returns.
+  static PrimitiveStatus UntrustedBlockingCall(
+      uint64_t untrusted_selector, MessageWriter *input,
+      MessageReader *output) ASYLO_MUST_USE_RESULT;
+
   /// Registers a callback as the handler routine for an enclave entry point
   /// trusted_selector.
   ///
@@ -43,9 +43,15 @@ extern "C" {
 void enc_exit(int rc);
 
 // Writes `count`-many random bytes into `buf` with a hardware source of
-// randomness.
+// randomness. Bytes are drawn from a per-thread CTR_DRBG reseeded from
+// RDSEED where AES-NI is available, and from RDRAND directly otherwise.
 ssize_t enc_hardware_random(uint8_t *buf, size_t count);
 
+// Makes every thread reseed its generator for enc_hardware_random before its
+// next use, for instance after the enclave was restored from a snapshot and
+// shares its generator states with another enclave.
+void enc_hardware_random_reseed();
+
 // Returns the number of entropy bits from the randomness source for
 // enc_hardware_random.
 int enc_hardware_random_entropy();
@@ -91,6 +97,11 @@ struct EnclaveMemoryLayout {
   void *heap_base;
   // size of heap in the current enclave.
   size_t heap_size;
+  // Size of the part of the heap, starting at heap_base, that has been handed
+  // out by enclave_sbrk(). The remainder of the heap is not in use.
+  size_t heap_used;
+  // Largest value of |heap_used| since the enclave was loaded.
+  size_t heap_peak_used;
   // Base address of the thread data for the current thread.
   void *thread_base;
   // Size of the thread data for the current thread.
@@ -76,5 +76,10 @@ PrimitiveStatus Client::ExitCallback(uint64_t untrusted_selector,
 // overridden for any backend.
 Status Client::RegisterExitHandlers() { return Status::OkStatus(); }
 
+StatusOr<EnclaveMemoryStats> Client::GetMemoryStats() {
+  return Status(error::GoogleError::UNIMPLEMENTED,
+                "Memory statistics are not reported by this backend");
+}
+
 }  // namespace primitives
 }  // namespace asylo
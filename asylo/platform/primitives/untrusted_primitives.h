@@ -26,10 +26,15 @@
 #include <utility>
 
 #include "absl/base/thread_annotations.h"
+#include "asylo/platform/common/enclave_memory_stats.h"
+#include "asylo/platform/common/enclave_thread_stats.h"
+#include "asylo/platform/common/enclave_trace_buffer.h"
 #include "asylo/platform/primitives/extent.h"
 #include "asylo/platform/primitives/primitive_status.h"
 #include "asylo/platform/primitives/primitives.h"
 #include "asylo/platform/primitives/util/message.h"
+#include "asylo/platform/primitives/util/status_conversions.h"
+#include "asylo/platform/primitives/util/typed_call.h"
 #include "asylo/util/asylo_macros.h"
 #include "asylo/util/mutex_guarded.h"
 #include "asylo/util/status.h"
@@ -190,6 +195,27 @@ class Client : public std::enable_shared_from_this<Client> {
   /// \returns The name of the enclave.
   virtual absl::string_view Name() const { return name_; }
 
+  /// A getter for the thread and transition counters of the enclave.
+  ///
+  /// \returns The counters of the enclave, which stay valid for the lifetime
+  /// of the client and can be read without entering the enclave, or nullptr
+  /// if the backend does not maintain them.
+  virtual const EnclaveThreadStats *thread_stats() const { return nullptr; }
+
+  /// A getter for the event trace of the enclave.
+  ///
+  /// \returns The trace buffer the enclave records events to, which stays
+  /// valid for the lifetime of the client and can be drained and enabled
+  /// without entering the enclave, or nullptr if tracing is not enabled.
+  virtual EnclaveTraceBuffer *trace_buffer() { return nullptr; }
+
+  /// Reads the memory usage of the enclave, which enters the enclave.
+  ///
+  /// \returns The heap and stack usage of the enclave along with the EPC
+  /// counters of the host, or an UNIMPLEMENTED error if the backend does not
+  /// report them.
+  virtual StatusOr<EnclaveMemoryStats> GetMemoryStats();
+
   /// Stores `this` as the active thread's "current client".
   ///
   /// This should only be called if an enclave entry happens without going
@@ -218,6 +244,27 @@ class Client : public std::enable_shared_from_this<Client> {
   Status EnclaveCall(uint64_t selector, MessageWriter *input,
                      MessageReader *output) ASYLO_MUST_USE_RESULT;
 
+  /// Makes the enclave call declared by the TypedCall `Call`, marshaling
+  /// `request` and `response` with a single copy each.
+  ///
+  /// \param request The request of the call.
+  /// \param response A pointer to the response of the call.
+  /// \returns A status for the call action, which is an error if the response
+  ///    does not have the layout of `Call::Response`.
+  template <typename Call>
+  ASYLO_MUST_USE_RESULT Status TypedEnclaveCall(
+      const typename Call::Request &request,
+      typename Call::Response *response) {
+    MessageWriter input;
+    internal::PushTyped(request, &input);
+    MessageReader output;
+    Status status = EnclaveCall(Call::kSelector, &input, &output);
+    if (!status.ok()) {
+      return status;
+    }
+    return MakeStatus(internal::PopTyped(&output, response));
+  }
+
   /// Enclave exit callback function shared with the enclave.
   ///
   /// \param untrusted_selector The identification number to select a registered
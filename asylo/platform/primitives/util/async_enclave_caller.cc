@@ -0,0 +1,79 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/util/async_enclave_caller.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace asylo {
+namespace primitives {
+
+AsyncEnclaveCaller::AsyncEnclaveCaller(std::shared_ptr<Client> client,
+                                       int num_threads, int max_in_flight)
+    : client_(std::move(client)),
+      max_in_flight_(std::max({max_in_flight, num_threads, 1})),
+      pool_(num_threads) {}
+
+void AsyncEnclaveCaller::EnclaveCallAsync(uint64_t selector,
+                                          MessageWriter input, Callback done) {
+  {
+    absl::MutexLock lock(&mu_);
+    auto has_room = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      return in_flight_ < max_in_flight_;
+    };
+    mu_.Await(absl::Condition(&has_room));
+    ++in_flight_;
+  }
+
+  // std::function requires a copyable target, so share the move-only input.
+  auto shared_input = std::make_shared<MessageWriter>(std::move(input));
+  pool_.Schedule([this, selector, shared_input, done] {
+    MessageReader output;
+    Status status =
+        client_->EnclaveCall(selector, shared_input.get(), &output);
+    {
+      absl::MutexLock lock(&mu_);
+      --in_flight_;
+    }
+    done(std::move(status), std::move(output));
+  });
+}
+
+std::future<StatusOr<MessageReader>> AsyncEnclaveCaller::EnclaveCallAsync(
+    uint64_t selector, MessageWriter input) {
+  auto promise = std::make_shared<std::promise<StatusOr<MessageReader>>>();
+  std::future<StatusOr<MessageReader>> result = promise->get_future();
+  EnclaveCallAsync(selector, std::move(input),
+                   [promise](Status status, MessageReader output) {
+                     if (status.ok()) {
+                       promise->set_value(std::move(output));
+                     } else {
+                       promise->set_value(std::move(status));
+                     }
+                   });
+  return result;
+}
+
+int AsyncEnclaveCaller::in_flight() {
+  absl::MutexLock lock(&mu_);
+  return in_flight_;
+}
+
+}  // namespace primitives
+}  // namespace asylo
@@ -0,0 +1,99 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_UTIL_ASYNC_ENCLAVE_CALLER_H_
+#define ASYLO_PLATFORM_PRIMITIVES_UTIL_ASYNC_ENCLAVE_CALLER_H_
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "asylo/platform/primitives/untrusted_primitives.h"
+#include "asylo/platform/primitives/util/message.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+#include "asylo/util/thread_pool.h"
+
+namespace asylo {
+namespace primitives {
+
+// Makes enclave calls on behalf of host threads that do not wait for them, so
+// that a host dispatcher can keep many enclave calls in flight without a host
+// thread per call.
+//
+// Calls are made with Client::EnclaveCall() by a fixed set of caller threads,
+// so they take the same path as synchronous calls: on SGX, a caller thread
+// posts the call to the switchless enclave call queue if switchless enclave
+// calls are enabled for its selector, and on the remote backend it sends the
+// call over the communicator of the proxy client. At most |max_in_flight|
+// calls are accepted but not yet completed at any time. Issuing another call
+// blocks until one completes, which pushes back on the dispatcher.
+//
+// AsyncEnclaveCaller is thread-safe.
+class AsyncEnclaveCaller {
+ public:
+  // Receives the status and the output of a completed call.
+  using Callback = std::function<void(Status status, MessageReader output)>;
+
+  // Creates a caller making up to |num_threads| calls to |client| at once, and
+  // accepting up to |max_in_flight| calls before blocking. |max_in_flight| is
+  // raised to |num_threads| if it is smaller. The caller keeps |client| alive
+  // until it is destroyed.
+  AsyncEnclaveCaller(std::shared_ptr<Client> client, int num_threads,
+                     int max_in_flight);
+
+  AsyncEnclaveCaller(const AsyncEnclaveCaller &other) = delete;
+  AsyncEnclaveCaller &operator=(const AsyncEnclaveCaller &other) = delete;
+
+  // Completes all accepted calls and joins the caller threads.
+  ~AsyncEnclaveCaller() = default;
+
+  // Makes the enclave call |selector| with |input| and passes its result to
+  // |done| on a caller thread. Blocks while |max_in_flight| calls are pending.
+  // |done| may issue further calls, since the call counts as completed before
+  // |done| runs.
+  void EnclaveCallAsync(uint64_t selector, MessageWriter input,
+                        Callback done);
+
+  // Makes the enclave call |selector| with |input| and returns a future for
+  // its output. Blocks while |max_in_flight| calls are pending.
+  std::future<StatusOr<MessageReader>> EnclaveCallAsync(uint64_t selector,
+                                                        MessageWriter input);
+
+  // Returns the number of calls accepted but not yet completed.
+  int in_flight() ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  const std::shared_ptr<Client> client_;
+  const int max_in_flight_;
+
+  absl::Mutex mu_;
+  int in_flight_ ABSL_GUARDED_BY(mu_) = 0;
+
+  // Declared last, so that its threads are joined before the members above
+  // are destroyed.
+  ThreadPool pool_;
+};
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_UTIL_ASYNC_ENCLAVE_CALLER_H_
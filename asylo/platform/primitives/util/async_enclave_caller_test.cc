@@ -0,0 +1,169 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/util/async_enclave_caller.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "asylo/platform/primitives/untrusted_primitives.h"
+#include "asylo/platform/primitives/util/dispatch_table.h"
+#include "asylo/platform/primitives/util/message.h"
+#include "asylo/platform/primitives/util/status_conversions.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/status.h"
+#include "asylo/util/status_macros.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+constexpr uint64_t kFailingSelector = kSelectorUser + 1;
+
+// A client whose enclave calls return their input incremented by one, or fail
+// for kFailingSelector. Calls block until release() is notified.
+class FakeEnclaveClient : public Client {
+ public:
+  FakeEnclaveClient()
+      : Client(/*name=*/"fake_enclave", absl::make_unique<DispatchTable>()) {}
+
+  bool IsClosed() const override { return false; }
+  Status Destroy() override { return Status::OkStatus(); }
+
+  absl::Notification *release() { return &release_; }
+
+  int max_concurrent_calls() {
+    absl::MutexLock lock(&mu_);
+    return max_concurrent_calls_;
+  }
+
+ protected:
+  Status EnclaveCallInternal(uint64_t selector, MessageWriter *input,
+                             MessageReader *output) override {
+    {
+      absl::MutexLock lock(&mu_);
+      ++concurrent_calls_;
+      max_concurrent_calls_ =
+          std::max(max_concurrent_calls_, concurrent_calls_);
+    }
+    release_.WaitForNotification();
+    {
+      absl::MutexLock lock(&mu_);
+      --concurrent_calls_;
+    }
+    if (selector == kFailingSelector) {
+      return Status(error::GoogleError::INTERNAL, "Call failed");
+    }
+
+    std::vector<char> buffer(input->MessageSize());
+    input->Serialize(buffer.data());
+    MessageReader reader;
+    ASYLO_RETURN_IF_ERROR(MakeStatus(reader.Deserialize(buffer.data(),
+                                                        buffer.size())));
+    MessageWriter result;
+    result.Push(reader.next<uint64_t>() + 1);
+    buffer.resize(result.MessageSize());
+    result.Serialize(buffer.data());
+    return MakeStatus(output->Deserialize(buffer.data(), buffer.size()));
+  }
+
+ private:
+  absl::Notification release_;
+  absl::Mutex mu_;
+  int concurrent_calls_ ABSL_GUARDED_BY(mu_) = 0;
+  int max_concurrent_calls_ ABSL_GUARDED_BY(mu_) = 0;
+};
+
+MessageWriter InputOf(uint64_t value) {
+  MessageWriter input;
+  input.Push(value);
+  return input;
+}
+
+TEST(AsyncEnclaveCallerTest, FuturesReturnOutputs) {
+  auto client = std::make_shared<FakeEnclaveClient>();
+  client->release()->Notify();
+  AsyncEnclaveCaller caller(client, /*num_threads=*/2, /*max_in_flight=*/8);
+
+  std::vector<std::future<StatusOr<MessageReader>>> results;
+  for (uint64_t i = 0; i < 16; ++i) {
+    results.push_back(caller.EnclaveCallAsync(kSelectorUser, InputOf(i)));
+  }
+  for (uint64_t i = 0; i < results.size(); ++i) {
+    StatusOr<MessageReader> output = results[i].get();
+    ASYLO_ASSERT_OK(output.status());
+    EXPECT_EQ(output.ValueOrDie().next<uint64_t>(), i + 1);
+  }
+  EXPECT_EQ(caller.in_flight(), 0);
+}
+
+TEST(AsyncEnclaveCallerTest, CallbackReceivesError) {
+  auto client = std::make_shared<FakeEnclaveClient>();
+  client->release()->Notify();
+  AsyncEnclaveCaller caller(client, /*num_threads=*/1, /*max_in_flight=*/1);
+
+  absl::Notification done;
+  Status result;
+  caller.EnclaveCallAsync(kFailingSelector, InputOf(0),
+                          [&](Status status, MessageReader output) {
+                            result = status;
+                            done.Notify();
+                          });
+  done.WaitForNotification();
+  EXPECT_THAT(result, StatusIs(error::GoogleError::INTERNAL));
+}
+
+TEST(AsyncEnclaveCallerTest, InFlightCallsAreBounded) {
+  auto client = std::make_shared<FakeEnclaveClient>();
+  AsyncEnclaveCaller caller(client, /*num_threads=*/2, /*max_in_flight=*/3);
+
+  std::vector<std::future<StatusOr<MessageReader>>> results;
+  for (uint64_t i = 0; i < 3; ++i) {
+    results.push_back(caller.EnclaveCallAsync(kSelectorUser, InputOf(i)));
+  }
+  EXPECT_EQ(caller.in_flight(), 3);
+
+  // The fourth call blocks until one of the first three completes.
+  std::future<std::future<StatusOr<MessageReader>>> blocked =
+      std::async(std::launch::async, [&caller] {
+        return caller.EnclaveCallAsync(kSelectorUser, InputOf(3));
+      });
+  EXPECT_EQ(blocked.wait_for(std::chrono::milliseconds(100)),
+            std::future_status::timeout);
+
+  client->release()->Notify();
+  results.push_back(blocked.get());
+  for (auto &result : results) {
+    ASYLO_EXPECT_OK(result.get().status());
+  }
+  EXPECT_LE(client->max_concurrent_calls(), 2);
+}
+
+}  // namespace
+}  // namespace primitives
+}  // namespace asylo
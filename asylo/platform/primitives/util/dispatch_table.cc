@@ -20,7 +20,6 @@
 
 #include <memory>
 
-#include "absl/types/optional.h"
 #include "asylo/platform/primitives/util/message.h"
 #include "asylo/util/status.h"
 #include "asylo/util/status_macros.h"
@@ -36,10 +35,23 @@ Status DispatchTable::RegisterExitHandler(uint64_t untrusted_selector,
     return {error::GoogleError::ALREADY_EXISTS,
             "Invalid selector in RegisterExitHandler."};
   }
-  locked_exit_table->emplace(untrusted_selector, handler);
+  auto it = locked_exit_table->emplace(untrusted_selector, handler).first;
+  if (untrusted_selector < kDirectTableSize) {
+    direct_table_[untrusted_selector].store(&it->second,
+                                            std::memory_order_release);
+  }
   return Status::OkStatus();
 }
 
+const ExitHandler *DispatchTable::FindExitHandler(uint64_t untrusted_selector) {
+  if (untrusted_selector < kDirectTableSize) {
+    return direct_table_[untrusted_selector].load(std::memory_order_acquire);
+  }
+  auto locked_exit_table = exit_table_.ReaderLock();
+  auto it = locked_exit_table->find(untrusted_selector);
+  return it == locked_exit_table->end() ? nullptr : &it->second;
+}
+
 Status DispatchTable::PerformUnknownExit(uint64_t untrusted_selector,
                                          MessageReader *input,
                                          MessageWriter *output,
@@ -51,19 +63,12 @@ Status DispatchTable::PerformUnknownExit(uint64_t untrusted_selector,
 Status DispatchTable::PerformExit(uint64_t untrusted_selector,
                                   MessageReader *input, MessageWriter *output,
                                   Client *client) {
-  absl::optional<ExitHandler> handler;
-  {
-    auto locked_exit_table = exit_table_.ReaderLock();
-    auto it = locked_exit_table->find(untrusted_selector);
-    if (it != locked_exit_table->end()) {
-      handler = it->second;
-    }
-  }
-  if (!handler.has_value()) {
+  const ExitHandler *handler = FindExitHandler(untrusted_selector);
+  if (!handler) {
     return PerformUnknownExit(untrusted_selector, input, output, client);
   }
-  return handler.value().callback(client->shared_from_this(),
-                                  handler.value().context, input, output);
+  return handler->callback(client->shared_from_this(), handler->context, input,
+                           output);
 }
 
 // Finds and invokes an exit handler, setting an error status on failure.
@@ -72,9 +77,11 @@ Status DispatchTable::InvokeExitHandler(uint64_t untrusted_selector,
                                         MessageWriter *output, Client *client) {
   if (exit_hook_factory_) {
     auto hook = exit_hook_factory_->CreateExitHook();
-    ASYLO_RETURN_IF_ERROR(hook->PreExit(untrusted_selector));
-    return hook->PostExit(
-        PerformExit(untrusted_selector, input, output, client));
+    ASYLO_RETURN_IF_ERROR(hook->PreExit(untrusted_selector, input));
+    Status result = PerformExit(untrusted_selector, input, output, client);
+    hook->RecordMessageSizes(input ? input->MessageSize() : 0,
+                             output ? output->MessageSize() : 0);
+    return hook->PostExit(result);
   } else {
     return PerformExit(untrusted_selector, input, output, client);
   }
@@ -19,6 +19,9 @@
 #ifndef ASYLO_PLATFORM_PRIMITIVES_UTIL_DISPATCH_TABLE_H_
 #define ASYLO_PLATFORM_PRIMITIVES_UTIL_DISPATCH_TABLE_H_
 
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <unordered_map>
 
 #include "asylo/platform/primitives/untrusted_primitives.h"
@@ -31,8 +34,19 @@ namespace asylo {
 namespace primitives {
 
 // Implementation of ExitCallProvider based on dispatch table (thread safe).
+//
+// Handlers are almost always registered at load time and then looked up on
+// every exit call from every enclave thread. Handlers for selectors below
+// kDirectTableSize are therefore published in a flat, directly indexed table
+// which is read without taking a lock. Registration, and lookup of handlers
+// for larger selectors, go through a mutex guarded map.
 class DispatchTable : public Client::ExitCallProvider {
  public:
+  // Selectors below this value are dispatched without taking a lock. This
+  // covers the reserved, host call and remote selector ranges, as well as the
+  // first block of user selectors.
+  static constexpr size_t kDirectTableSize = 256;
+
   // A hook class which gives users a callback mechanism to inspect
   // exit calls.
   class ExitHook {
@@ -43,6 +57,18 @@ class DispatchTable : public Client::ExitCallProvider {
     // returned back to the enclave.
     virtual Status PreExit(uint64_t untrusted_selector) = 0;
 
+    // Variant of PreExit which is also given the input of the exit call. The
+    // hook may peek at |input| but must not consume it. The default
+    // implementation ignores |input| and calls PreExit(untrusted_selector).
+    virtual Status PreExit(uint64_t untrusted_selector, MessageReader *input) {
+      return PreExit(untrusted_selector);
+    }
+
+    // Called after the exit call is made and before PostExit, with the
+    // serialized sizes of the exit call input and output. The default
+    // implementation does nothing.
+    virtual void RecordMessageSizes(size_t input_size, size_t output_size) {}
+
     // PostExit is called with the result of the external exit call,
     // after that call is made (but before returning to the
     // enclave). PostExit returns a status as well, which will be
@@ -64,18 +90,21 @@ class DispatchTable : public Client::ExitCallProvider {
     virtual ~ExitHookFactory() = default;
   };
 
-  DispatchTable()
-      : exit_table_(std::unordered_map<uint64_t, ExitHandler>()),
-        exit_hook_factory_() {}
+  DispatchTable() : DispatchTable(/*exit_hook_factory=*/nullptr) {}
 
   explicit DispatchTable(std::unique_ptr<ExitHookFactory> exit_hook_factory)
       : exit_table_(std::unordered_map<uint64_t, ExitHandler>()),
-        exit_hook_factory_(std::move(exit_hook_factory)) {}
+        exit_hook_factory_(std::move(exit_hook_factory)) {
+    for (auto &entry : direct_table_) {
+      entry.store(nullptr, std::memory_order_relaxed);
+    }
+  }
 
   // Registers a callback as the handler routine for an enclave exit point
   // `untrusted_selector`. Returns an error code if a handler has already been
   // registered for `trusted_selector` or if an invalid selector value is
-  // passed.
+  // passed. Registration may happen concurrently with exit calls; a handler
+  // is visible to every caller once this method returns.
   Status RegisterExitHandler(uint64_t untrusted_selector,
                              const ExitHandler &handler) override;
 
@@ -96,10 +125,20 @@ class DispatchTable : public Client::ExitCallProvider {
                                     MessageReader *input, MessageWriter *output,
                                     Client *client);
 
+  // Returns the handler registered for |untrusted_selector|, or nullptr if
+  // there is none.
+  const ExitHandler *FindExitHandler(uint64_t untrusted_selector);
+
   // DispatchTable is used in trusted primitives layer where system calls might
   // not be available; avoid using absl based containers which may perform
-  // system calls.
+  // system calls. Handlers are never removed and std::unordered_map does not
+  // move its elements, so pointers to the stored handlers remain valid for the
+  // lifetime of the table.
   MutexGuarded<std::unordered_map<uint64_t, ExitHandler>> exit_table_;
+
+  // Lock-free view of the handlers in |exit_table_| for selectors below
+  // kDirectTableSize, indexed by selector.
+  std::array<std::atomic<const ExitHandler *>, kDirectTableSize> direct_table_;
   const std::unique_ptr<ExitHookFactory> exit_hook_factory_;
 };
 
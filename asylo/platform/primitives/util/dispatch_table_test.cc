@@ -110,6 +110,34 @@ TEST(DispatchTableTest, HandlersInvocation) {
               StatusIs(error::GoogleError::OUT_OF_RANGE));
 }
 
+TEST(DispatchTableTest, HandlersBeyondDirectTable) {
+  const auto client = std::make_shared<MockedEnclaveClient>();
+  MockedEnclaveClient::MockExitHandlerCallback callbacks[2];
+  constexpr uint64_t kLastDirect = DispatchTable::kDirectTableSize - 1;
+  constexpr uint64_t kFirstIndirect = DispatchTable::kDirectTableSize;
+  EXPECT_CALL(callbacks[0], Call(Eq(client), _, _, _)).Times(1);
+  EXPECT_CALL(callbacks[1], Call(Eq(client), _, _, _)).Times(1);
+  ASSERT_THAT(client->exit_call_provider()->RegisterExitHandler(
+                  kLastDirect, ExitHandler{callbacks[0].AsStdFunction()}),
+              IsOk());
+  ASSERT_THAT(client->exit_call_provider()->RegisterExitHandler(
+                  kFirstIndirect, ExitHandler{callbacks[1].AsStdFunction()}),
+              IsOk());
+  ASSERT_THAT(client->exit_call_provider()->RegisterExitHandler(
+                  kFirstIndirect, ExitHandler{callbacks[1].AsStdFunction()}),
+              StatusIs(error::GoogleError::ALREADY_EXISTS));
+  MessageWriter out;
+  EXPECT_THAT(client->exit_call_provider()->InvokeExitHandler(
+                  kLastDirect, nullptr, &out, client.get()),
+              IsOk());
+  EXPECT_THAT(client->exit_call_provider()->InvokeExitHandler(
+                  kFirstIndirect, nullptr, &out, client.get()),
+              IsOk());
+  EXPECT_THAT(client->exit_call_provider()->InvokeExitHandler(
+                  kFirstIndirect + 1, nullptr, &out, client.get()),
+              StatusIs(error::GoogleError::OUT_OF_RANGE));
+}
+
 TEST(DispatchTableTest, HandlersInMultipleThreads) {
   const size_t kThreads = 64;
   const size_t kCount = 256;
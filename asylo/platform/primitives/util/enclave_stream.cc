@@ -0,0 +1,165 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/util/enclave_stream.h"
+
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "asylo/platform/primitives/extent.h"
+#include "asylo/platform/primitives/primitives.h"
+#include "asylo/platform/primitives/util/message.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+// The streams that exist, by id. Exit handlers hold |mu| in shared mode while
+// they transfer a chunk, so that a stream is not destroyed under them.
+struct StreamRegistry {
+  absl::Mutex mu;
+  absl::flat_hash_map<uint64_t, EnclaveStream *> streams ABSL_GUARDED_BY(mu);
+  uint64_t next_id ABSL_GUARDED_BY(mu) = 1;
+};
+
+StreamRegistry *GetStreamRegistry() {
+  static StreamRegistry *registry = new StreamRegistry;
+  return registry;
+}
+
+// Registers |callback| as the exit handler for |selector|, unless a handler is
+// already registered for it.
+Status RegisterStreamHandler(Client::ExitCallProvider *exit_call_provider,
+                             uint64_t selector,
+                             ExitHandler::Callback callback) {
+  Status status = exit_call_provider->RegisterExitHandler(
+      selector, ExitHandler{std::move(callback)});
+  if (status.Is(error::GoogleError::ALREADY_EXISTS)) {
+    return Status::OkStatus();
+  }
+  return status;
+}
+
+}  // namespace
+
+constexpr size_t EnclaveStream::kMaxChunkSize;
+
+StatusOr<std::unique_ptr<EnclaveStream>> EnclaveStream::Create(Client *client,
+                                                               Source source,
+                                                               Sink sink) {
+  Client::ExitCallProvider *exit_call_provider = client->exit_call_provider();
+  if (!exit_call_provider) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Client has no exit call provider");
+  }
+  ASYLO_RETURN_IF_ERROR(RegisterStreamHandler(
+      exit_call_provider, kSelectorStreamRead, &EnclaveStream::ReadHandler));
+  ASYLO_RETURN_IF_ERROR(RegisterStreamHandler(
+      exit_call_provider, kSelectorStreamWrite, &EnclaveStream::WriteHandler));
+
+  StreamRegistry *registry = GetStreamRegistry();
+  absl::MutexLock lock(&registry->mu);
+  uint64_t id = registry->next_id++;
+  std::unique_ptr<EnclaveStream> stream(
+      new EnclaveStream(id, std::move(source), std::move(sink)));
+  registry->streams[id] = stream.get();
+  return std::move(stream);
+}
+
+EnclaveStream::EnclaveStream(uint64_t id, Source source, Sink sink)
+    : id_(id),
+      source_(std::move(source)),
+      sink_(std::move(sink)),
+      bytes_read_(0),
+      bytes_written_(0) {}
+
+EnclaveStream::~EnclaveStream() {
+  StreamRegistry *registry = GetStreamRegistry();
+  absl::MutexLock lock(&registry->mu);
+  registry->streams.erase(id_);
+}
+
+Status EnclaveStream::ReadHandler(std::shared_ptr<Client> client,
+                                  void *context, MessageReader *input,
+                                  MessageWriter *output) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*input, 2);
+  uint64_t id = input->next<uint64_t>();
+  uint64_t size = input->next<uint64_t>();
+  if (size > kMaxChunkSize) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  absl::StrCat("Stream chunk of ", size,
+                               " bytes exceeds the maximum of ",
+                               kMaxChunkSize));
+  }
+
+  StreamRegistry *registry = GetStreamRegistry();
+  absl::ReaderMutexLock lock(&registry->mu);
+  auto it = registry->streams.find(id);
+  if (it == registry->streams.end()) {
+    return Status(error::GoogleError::NOT_FOUND,
+                  absl::StrCat("No stream with id ", id));
+  }
+  EnclaveStream *stream = it->second;
+  if (!stream->source_) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Stream has no source");
+  }
+
+  std::vector<char> chunk(size);
+  size_t chunk_size;
+  ASYLO_ASSIGN_OR_RETURN(chunk_size, stream->source_(chunk.data(), size));
+  if (chunk_size > size) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Stream source filled more bytes than requested");
+  }
+  stream->bytes_read_ += chunk_size;
+  output->PushByCopy(Extent{chunk.data(), chunk_size});
+  return Status::OkStatus();
+}
+
+Status EnclaveStream::WriteHandler(std::shared_ptr<Client> client,
+                                   void *context, MessageReader *input,
+                                   MessageWriter *output) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*input, 2);
+  uint64_t id = input->next<uint64_t>();
+  Extent chunk = input->next();
+
+  StreamRegistry *registry = GetStreamRegistry();
+  absl::ReaderMutexLock lock(&registry->mu);
+  auto it = registry->streams.find(id);
+  if (it == registry->streams.end()) {
+    return Status(error::GoogleError::NOT_FOUND,
+                  absl::StrCat("No stream with id ", id));
+  }
+  EnclaveStream *stream = it->second;
+  if (!stream->sink_) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "Stream has no sink");
+  }
+  ASYLO_RETURN_IF_ERROR(stream->sink_(chunk.data(), chunk.size()));
+  stream->bytes_written_ += chunk.size();
+  return Status::OkStatus();
+}
+
+}  // namespace primitives
+}  // namespace asylo
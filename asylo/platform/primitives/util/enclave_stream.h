@@ -0,0 +1,107 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_UTIL_ENCLAVE_STREAM_H_
+#define ASYLO_PLATFORM_PRIMITIVES_UTIL_ENCLAVE_STREAM_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "asylo/platform/primitives/untrusted_primitives.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+namespace primitives {
+
+// Untrusted side of a stream of bytes into and out of an enclave call, for
+// inputs and outputs too large to pass as a single message. The enclave pulls
+// the input and pushes the output one chunk at a time with the StreamReader and
+// StreamWriter of trusted_stream.h, so that enclave memory only holds a
+// bounded window of either, regardless of the size of the stream.
+//
+// Example:
+//
+//     std::unique_ptr<EnclaveStream> stream;
+//     ASYLO_ASSIGN_OR_RETURN(stream,
+//                           EnclaveStream::Create(client.get(), source, sink));
+//     MessageWriter input;
+//     input.Push(stream->id());
+//     MessageReader output;
+//     ASYLO_RETURN_IF_ERROR(client->EnclaveCall(selector, &input, &output));
+//
+// The enclave entry handler for |selector| constructs its StreamReader and
+// StreamWriter from the id. A stream must outlive the enclave calls using it.
+class EnclaveStream {
+ public:
+  // Fills up to |size| bytes at |buffer| with the next bytes of the input, and
+  // returns how many it filled, which is 0 once the input is exhausted.
+  using Source = std::function<StatusOr<size_t>(void *buffer, size_t size)>;
+
+  // Consumes the next |size| bytes of the output, at |data|.
+  using Sink = std::function<Status(const void *data, size_t size)>;
+
+  // Largest chunk the enclave may read or write at once.
+  static constexpr size_t kMaxChunkSize = 64 << 20;
+
+  // Creates a stream from |source| to |sink| for enclave calls to |client|.
+  // Either may be null, in which case the enclave fails to read or write the
+  // stream. Registers the exit handlers serving streams with the exit call
+  // provider of |client| if they are not registered yet.
+  static StatusOr<std::unique_ptr<EnclaveStream>> Create(Client *client,
+                                                         Source source,
+                                                         Sink sink);
+
+  EnclaveStream(const EnclaveStream &other) = delete;
+  EnclaveStream &operator=(const EnclaveStream &other) = delete;
+
+  // Waits for in-progress chunk transfers of the stream to finish.
+  ~EnclaveStream();
+
+  // Returns the id the enclave refers to the stream by.
+  uint64_t id() const { return id_; }
+
+  // Returns the number of bytes read from the source and written to the sink
+  // so far.
+  uint64_t bytes_read() const { return bytes_read_.load(); }
+  uint64_t bytes_written() const { return bytes_written_.load(); }
+
+ private:
+  EnclaveStream(uint64_t id, Source source, Sink sink);
+
+  // Exit handlers for kSelectorStreamRead and kSelectorStreamWrite.
+  static Status ReadHandler(std::shared_ptr<Client> client, void *context,
+                            MessageReader *input, MessageWriter *output);
+  static Status WriteHandler(std::shared_ptr<Client> client, void *context,
+                             MessageReader *input, MessageWriter *output);
+
+  const uint64_t id_;
+  const Source source_;
+  const Sink sink_;
+
+  std::atomic<uint64_t> bytes_read_;
+  std::atomic<uint64_t> bytes_written_;
+};
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_UTIL_ENCLAVE_STREAM_H_
@@ -0,0 +1,234 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/util/enclave_stream.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/memory/memory.h"
+#include "asylo/platform/primitives/extent.h"
+#include "asylo/platform/primitives/primitives.h"
+#include "asylo/platform/primitives/untrusted_primitives.h"
+#include "asylo/platform/primitives/util/dispatch_table.h"
+#include "asylo/platform/primitives/util/message.h"
+#include "asylo/platform/primitives/util/status_conversions.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/status.h"
+#include "asylo/util/status_macros.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+using ::testing::Eq;
+
+// Copies the message in |writer| into |reader|, as crossing the enclave
+// boundary would.
+Status Transfer(const MessageWriter &writer, MessageReader *reader) {
+  std::vector<char> buffer(writer.MessageSize());
+  writer.Serialize(buffer.data());
+  return MakeStatus(reader->Deserialize(buffer.data(), buffer.size()));
+}
+
+// A client whose enclave calls take a stream id and a window size, and copy
+// the input of the stream to its output one window at a time through the
+// stream exit handlers.
+class FakeStreamingClient : public Client {
+ public:
+  FakeStreamingClient()
+      : Client(/*name=*/"fake_enclave", absl::make_unique<DispatchTable>()) {}
+
+  bool IsClosed() const override { return false; }
+  Status Destroy() override { return Status::OkStatus(); }
+
+  // Returns the size of the largest chunk the enclave read.
+  size_t max_chunk_size() const { return max_chunk_size_; }
+
+ protected:
+  Status EnclaveCallInternal(uint64_t selector, MessageWriter *input,
+                             MessageReader *output) override {
+    MessageReader in;
+    ASYLO_RETURN_IF_ERROR(Transfer(*input, &in));
+    uint64_t stream_id = in.next<uint64_t>();
+    uint64_t window_size = in.next<uint64_t>();
+    while (true) {
+      MessageWriter read_request;
+      read_request.Push(stream_id);
+      read_request.Push(window_size);
+      MessageReader read_request_reader;
+      ASYLO_RETURN_IF_ERROR(Transfer(read_request, &read_request_reader));
+      MessageWriter read_response;
+      ASYLO_RETURN_IF_ERROR(exit_call_provider()->InvokeExitHandler(
+          kSelectorStreamRead, &read_request_reader, &read_response, this));
+      MessageReader chunk_reader;
+      ASYLO_RETURN_IF_ERROR(Transfer(read_response, &chunk_reader));
+      Extent chunk = chunk_reader.next();
+      if (chunk.empty()) {
+        return Status::OkStatus();
+      }
+      max_chunk_size_ = std::max(max_chunk_size_, chunk.size());
+
+      MessageWriter write_request;
+      write_request.Push(stream_id);
+      write_request.PushByReference(chunk);
+      MessageReader write_request_reader;
+      ASYLO_RETURN_IF_ERROR(Transfer(write_request, &write_request_reader));
+      MessageWriter write_response;
+      ASYLO_RETURN_IF_ERROR(exit_call_provider()->InvokeExitHandler(
+          kSelectorStreamWrite, &write_request_reader, &write_response, this));
+    }
+  }
+
+ private:
+  size_t max_chunk_size_ = 0;
+};
+
+// Returns a source reading |data| from its beginning.
+EnclaveStream::Source SourceOf(const std::string &data) {
+  auto offset = std::make_shared<size_t>(0);
+  return [data, offset](void *buffer, size_t size) -> StatusOr<size_t> {
+    size_t count = std::min(size, data.size() - *offset);
+    memcpy(buffer, data.data() + *offset, count);
+    *offset += count;
+    return count;
+  };
+}
+
+Status CallWithStream(Client *client, uint64_t stream_id,
+                      uint64_t window_size) {
+  MessageWriter input;
+  input.Push(stream_id);
+  input.Push(window_size);
+  MessageReader output;
+  return client->EnclaveCall(kSelectorUser, &input, &output);
+}
+
+TEST(EnclaveStreamTest, CopiesInputToOutputInChunks) {
+  auto client = std::make_shared<FakeStreamingClient>();
+  std::string data(1 << 20, '\0');
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<char>(i * 31);
+  }
+  std::string result;
+  std::unique_ptr<EnclaveStream> stream;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      stream, EnclaveStream::Create(
+                  client.get(), SourceOf(data),
+                  [&result](const void *chunk, size_t size) {
+                    result.append(reinterpret_cast<const char *>(chunk), size);
+                    return Status::OkStatus();
+                  }));
+
+  ASYLO_ASSERT_OK(CallWithStream(client.get(), stream->id(),
+                                 /*window_size=*/4096));
+  EXPECT_EQ(result, data);
+  EXPECT_THAT(stream->bytes_read(), Eq(data.size()));
+  EXPECT_THAT(stream->bytes_written(), Eq(data.size()));
+  EXPECT_THAT(client->max_chunk_size(), Eq(4096));
+}
+
+TEST(EnclaveStreamTest, StreamsAreIndependent) {
+  auto client = std::make_shared<FakeStreamingClient>();
+  std::string first_result;
+  std::string second_result;
+  std::unique_ptr<EnclaveStream> first;
+  std::unique_ptr<EnclaveStream> second;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      first, EnclaveStream::Create(client.get(), SourceOf("first"),
+                                   [&](const void *chunk, size_t size) {
+                                     first_result.append(
+                                         reinterpret_cast<const char *>(chunk),
+                                         size);
+                                     return Status::OkStatus();
+                                   }));
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      second, EnclaveStream::Create(client.get(), SourceOf("second"),
+                                    [&](const void *chunk, size_t size) {
+                                      second_result.append(
+                                          reinterpret_cast<const char *>(chunk),
+                                          size);
+                                      return Status::OkStatus();
+                                    }));
+  EXPECT_NE(first->id(), second->id());
+
+  ASYLO_ASSERT_OK(CallWithStream(client.get(), second->id(),
+                                 /*window_size=*/2));
+  ASYLO_ASSERT_OK(CallWithStream(client.get(), first->id(),
+                                 /*window_size=*/2));
+  EXPECT_EQ(first_result, "first");
+  EXPECT_EQ(second_result, "second");
+}
+
+TEST(EnclaveStreamTest, DestroyedStreamIsNotFound) {
+  auto client = std::make_shared<FakeStreamingClient>();
+  std::unique_ptr<EnclaveStream> stream;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      stream, EnclaveStream::Create(client.get(), SourceOf("data"),
+                                    /*sink=*/nullptr));
+  uint64_t id = stream->id();
+  stream.reset();
+  EXPECT_THAT(CallWithStream(client.get(), id, /*window_size=*/16),
+              StatusIs(error::GoogleError::NOT_FOUND));
+}
+
+TEST(EnclaveStreamTest, MissingSinkFailsWrite) {
+  auto client = std::make_shared<FakeStreamingClient>();
+  std::unique_ptr<EnclaveStream> stream;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      stream, EnclaveStream::Create(client.get(), SourceOf("data"),
+                                    /*sink=*/nullptr));
+  EXPECT_THAT(CallWithStream(client.get(), stream->id(), /*window_size=*/16),
+              StatusIs(error::GoogleError::FAILED_PRECONDITION));
+}
+
+TEST(EnclaveStreamTest, OversizedChunkIsRejected) {
+  auto client = std::make_shared<FakeStreamingClient>();
+  std::unique_ptr<EnclaveStream> stream;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      stream, EnclaveStream::Create(client.get(), SourceOf("data"),
+                                    /*sink=*/nullptr));
+  EXPECT_THAT(CallWithStream(client.get(), stream->id(),
+                             EnclaveStream::kMaxChunkSize + 1),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+TEST(EnclaveStreamTest, SourceErrorIsReturned) {
+  auto client = std::make_shared<FakeStreamingClient>();
+  std::unique_ptr<EnclaveStream> stream;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      stream, EnclaveStream::Create(
+                  client.get(),
+                  [](void *buffer, size_t size) -> StatusOr<size_t> {
+                    return Status(error::GoogleError::DATA_LOSS, "Bad input");
+                  },
+                  /*sink=*/nullptr));
+  EXPECT_THAT(CallWithStream(client.get(), stream->id(), /*window_size=*/16),
+              StatusIs(error::GoogleError::DATA_LOSS));
+}
+
+}  // namespace
+}  // namespace primitives
+}  // namespace asylo
@@ -18,13 +18,17 @@
 
 #include "asylo/platform/primitives/util/exit_log.h"
 
+#include <cstring>
 #include <functional>
 #include <ostream>
 #include <vector>
 
 #include "absl/memory/memory.h"
 #include "absl/time/clock.h"
+#include "asylo/platform/primitives/primitives.h"
 #include "asylo/platform/primitives/util/dispatch_table.h"
+#include "asylo/platform/primitives/util/exit_metrics.h"
+#include "asylo/platform/system_call/message.h"
 #include "asylo/util/status.h"
 
 namespace asylo {
@@ -53,11 +57,32 @@ class ExitLogEntry {
   const uint64_t untrusted_selector_;
 };
 
-// A hook which will log a single exit call.
+// Returns the system call number of the serialized system call request at the
+// front of |input|, or ExitMetrics::kNoSystemCall if the exit to
+// |untrusted_selector| does not carry one.
+int64_t PeekSystemCallNumber(uint64_t untrusted_selector, MessageReader *input) {
+  if (untrusted_selector != kSelectorHostCall || !input || !input->hasNext()) {
+    return ExitMetrics::kNoSystemCall;
+  }
+  Extent request = input->peek();
+  if (request.size() < sizeof(system_call::MessageHeader)) {
+    return ExitMetrics::kNoSystemCall;
+  }
+  system_call::MessageHeader header;
+  memcpy(&header, request.data(), sizeof(header));
+  if (header.magic != system_call::kMessageMagic) {
+    return ExitMetrics::kNoSystemCall;
+  }
+  return header.sysno;
+}
+
+// A hook which will log a single exit call and record it in ExitMetrics.
+// Either may be disabled by passing a null |store_log_entry| or |metrics|.
 class ExitLogHook : public DispatchTable::ExitHook {
  public:
-  explicit ExitLogHook(std::function<void(ExitLogEntry)> store_log_entry)
-      : store_log_entry_(std::move(store_log_entry)) {}
+  ExitLogHook(std::function<void(ExitLogEntry)> store_log_entry,
+              ExitMetrics *metrics)
+      : store_log_entry_(std::move(store_log_entry)), metrics_(metrics) {}
 
   Status PreExit(uint64_t untrusted_selector) override {
     start_ = absl::Now();
@@ -65,32 +90,80 @@ class ExitLogHook : public DispatchTable::ExitHook {
     return Status::OkStatus();
   }
 
+  Status PreExit(uint64_t untrusted_selector, MessageReader *input) override {
+    if (metrics_) {
+      sysno_ = PeekSystemCallNumber(untrusted_selector, input);
+    }
+    return PreExit(untrusted_selector);
+  }
+
+  void RecordMessageSizes(size_t input_size, size_t output_size) override {
+    input_size_ = input_size;
+    output_size_ = output_size;
+  }
+
   Status PostExit(Status result) override {
     auto duration = absl::Now() - start_;
-    store_log_entry_(ExitLogEntry(start_, duration, untrusted_selector_));
+    if (metrics_) {
+      metrics_->Record(untrusted_selector_, sysno_, duration, input_size_,
+                       output_size_, result.ok());
+    }
+    if (store_log_entry_) {
+      store_log_entry_(ExitLogEntry(start_, duration, untrusted_selector_));
+    }
     return result;
   }
 
  private:
   absl::Time start_;
   uint64_t untrusted_selector_;
+  int64_t sysno_ = ExitMetrics::kNoSystemCall;
+  size_t input_size_ = 0;
+  size_t output_size_ = 0;
   const std::function<void(ExitLogEntry)> store_log_entry_;
+  ExitMetrics *const metrics_;
 };
 
 // A hook factory which will generate one hook object per exit call.
 class ExitLogHookFactory : public DispatchTable::ExitHookFactory {
  public:
-  ExitLogHookFactory() = default;
+  ExitLogHookFactory(bool enable_logging, std::shared_ptr<ExitMetrics> metrics)
+      : enable_logging_(enable_logging), metrics_(std::move(metrics)) {}
+
   std::unique_ptr<DispatchTable::ExitHook> CreateExitHook() override {
-    return absl::make_unique<ExitLogHook>(
-        [](ExitLogEntry entry) { LOG(ERROR) << entry << std::endl; });
+    std::function<void(ExitLogEntry)> store_log_entry;
+    if (enable_logging_) {
+      store_log_entry = [](ExitLogEntry entry) {
+        LOG(ERROR) << entry << std::endl;
+      };
+    }
+    return absl::make_unique<ExitLogHook>(std::move(store_log_entry),
+                                          metrics_.get());
   }
+
+ private:
+  const bool enable_logging_;
+  const std::shared_ptr<ExitMetrics> metrics_;
 };
 
+std::unique_ptr<DispatchTable::ExitHookFactory> CreateExitLogHookFactory(
+    bool enable_logging, std::shared_ptr<ExitMetrics> metrics) {
+  if (!enable_logging && !metrics) {
+    return nullptr;
+  }
+  return absl::make_unique<ExitLogHookFactory>(enable_logging,
+                                               std::move(metrics));
+}
+
 }  // namespace
 
 LoggingDispatchTable::LoggingDispatchTable(bool enable_logging)
-    : DispatchTable(enable_logging ? absl::make_unique<ExitLogHookFactory>()
-                                   : nullptr) {}
+    : LoggingDispatchTable(enable_logging, /*metrics=*/nullptr) {}
+
+LoggingDispatchTable::LoggingDispatchTable(bool enable_logging,
+                                           std::shared_ptr<ExitMetrics> metrics)
+    : DispatchTable(CreateExitLogHookFactory(enable_logging, metrics)),
+      metrics_(std::move(metrics)) {}
+
 }  // namespace primitives
 }  // namespace asylo
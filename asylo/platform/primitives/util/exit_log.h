@@ -20,22 +20,35 @@
 #define ASYLO_PLATFORM_PRIMITIVES_UTIL_EXIT_LOG_H_
 
 #include <functional>
+#include <memory>
 #include <ostream>
 #include <vector>
 
 #include "absl/time/clock.h"
 #include "asylo/platform/primitives/util/dispatch_table.h"
+#include "asylo/platform/primitives/util/exit_metrics.h"
 #include "asylo/util/status.h"
 
 namespace asylo {
 namespace primitives {
 
 // A variation of DispatchTable that performs logging of exit calls, if
-// `enable_logging` parameter in constructor is true (otherwise it is identical
-// to the regular DispatchTable).
+// `enable_logging` parameter in constructor is true, and records statistics of
+// exit calls in `metrics`, if provided (otherwise it is identical to the
+// regular DispatchTable).
 class LoggingDispatchTable : public DispatchTable {
  public:
   explicit LoggingDispatchTable(bool enable_logging);
+
+  LoggingDispatchTable(bool enable_logging,
+                       std::shared_ptr<ExitMetrics> metrics);
+
+  // Returns the metrics recorded by this table, or nullptr if metrics are not
+  // enabled.
+  std::shared_ptr<const ExitMetrics> metrics() const { return metrics_; }
+
+ private:
+  const std::shared_ptr<ExitMetrics> metrics_;
 };
 
 }  // namespace primitives
@@ -0,0 +1,98 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include "asylo/platform/primitives/util/exit_metrics.h"
+
+#include "absl/memory/memory.h"
+
+namespace asylo {
+namespace primitives {
+
+constexpr int ExitMetrics::kNumLatencyBuckets;
+constexpr int64_t ExitMetrics::kNoSystemCall;
+
+int ExitMetrics::LatencyBucket(absl::Duration latency) {
+  int64_t micros = absl::ToInt64Microseconds(latency);
+  if (micros <= 0) {
+    return 0;
+  }
+  int bucket = 64 - __builtin_clzll(static_cast<uint64_t>(micros));
+  return bucket < kNumLatencyBuckets ? bucket : kNumLatencyBuckets - 1;
+}
+
+ExitMetrics::Counters *ExitMetrics::GetCounters(const Key &key) {
+  {
+    auto counters = counters_.ReaderLock();
+    auto it = counters->find(key);
+    if (it != counters->end()) {
+      return it->second.get();
+    }
+  }
+  auto counters = counters_.Lock();
+  auto &entry = (*counters)[key];
+  if (!entry) {
+    entry = absl::make_unique<Counters>();
+  }
+  return entry.get();
+}
+
+void ExitMetrics::Record(uint64_t selector, int64_t sysno,
+                         absl::Duration latency, size_t input_bytes,
+                         size_t output_bytes, bool ok) {
+  Counters *counters = GetCounters(Key{selector, sysno});
+  counters->count.fetch_add(1, std::memory_order_relaxed);
+  if (!ok) {
+    counters->error_count.fetch_add(1, std::memory_order_relaxed);
+  }
+  counters->input_bytes.fetch_add(input_bytes, std::memory_order_relaxed);
+  counters->output_bytes.fetch_add(output_bytes, std::memory_order_relaxed);
+  counters->total_latency_ns.fetch_add(absl::ToInt64Nanoseconds(latency),
+                                       std::memory_order_relaxed);
+  counters->latency_histogram[LatencyBucket(latency)].fetch_add(
+      1, std::memory_order_relaxed);
+}
+
+std::vector<ExitMetrics::Stats> ExitMetrics::Snapshot() const {
+  std::vector<Stats> snapshot;
+  auto counters = counters_.ReaderLock();
+  snapshot.reserve(counters->size());
+  for (const auto &entry : *counters) {
+    Stats stats;
+    stats.selector = entry.first.selector;
+    stats.sysno = entry.first.sysno;
+    stats.count = entry.second->count.load(std::memory_order_relaxed);
+    stats.error_count =
+        entry.second->error_count.load(std::memory_order_relaxed);
+    stats.input_bytes =
+        entry.second->input_bytes.load(std::memory_order_relaxed);
+    stats.output_bytes =
+        entry.second->output_bytes.load(std::memory_order_relaxed);
+    stats.total_latency_ns =
+        entry.second->total_latency_ns.load(std::memory_order_relaxed);
+    for (int i = 0; i < kNumLatencyBuckets; i++) {
+      stats.latency_histogram[i] =
+          entry.second->latency_histogram[i].load(std::memory_order_relaxed);
+    }
+    snapshot.push_back(stats);
+  }
+  return snapshot;
+}
+
+}  // namespace primitives
+}  // namespace asylo
@@ -0,0 +1,119 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_UTIL_EXIT_METRICS_H_
+#define ASYLO_PLATFORM_PRIMITIVES_UTIL_EXIT_METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "asylo/util/mutex_guarded.h"
+
+namespace asylo {
+namespace primitives {
+
+// Continuously aggregated statistics of enclave exit calls. Statistics are
+// kept per exit selector and, for exits carrying a serialized system call, per
+// system call number, so that the cost of individual system calls can be told
+// apart even though they share a single exit selector.
+//
+// Recording an exit takes a reader lock and a handful of relaxed atomic
+// increments; a writer lock is only taken the first time an exit selector is
+// seen. This class is thread safe.
+class ExitMetrics {
+ public:
+  // Number of latency histogram buckets. Bucket 0 counts exits that took less
+  // than 1 microsecond, bucket i counts exits that took [2^(i-1), 2^i)
+  // microseconds, and the last bucket counts all longer exits.
+  static constexpr int kNumLatencyBuckets = 24;
+
+  // Value of |sysno| for exits that are not system calls.
+  static constexpr int64_t kNoSystemCall = -1;
+
+  // A snapshot of the statistics of one kind of exit call.
+  struct Stats {
+    uint64_t selector;
+    int64_t sysno;
+    uint64_t count;
+    uint64_t error_count;
+    uint64_t input_bytes;
+    uint64_t output_bytes;
+    uint64_t total_latency_ns;
+    std::array<uint64_t, kNumLatencyBuckets> latency_histogram;
+  };
+
+  ExitMetrics() = default;
+  ExitMetrics(const ExitMetrics &other) = delete;
+  ExitMetrics &operator=(const ExitMetrics &other) = delete;
+
+  // Records an exit call to |selector|, for system call |sysno| or
+  // kNoSystemCall, which took |latency|, passed |input_bytes| bytes to the
+  // exit handler, returned |output_bytes| bytes, and succeeded if |ok|.
+  void Record(uint64_t selector, int64_t sysno, absl::Duration latency,
+              size_t input_bytes, size_t output_bytes, bool ok);
+
+  // Returns the statistics of every kind of exit call recorded so far.
+  std::vector<Stats> Snapshot() const;
+
+  // Returns the index of the latency histogram bucket counting |latency|.
+  static int LatencyBucket(absl::Duration latency);
+
+ private:
+  struct Key {
+    uint64_t selector;
+    int64_t sysno;
+
+    bool operator==(const Key &other) const {
+      return selector == other.selector && sysno == other.sysno;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key &key) const {
+      return std::hash<uint64_t>()(key.selector * 1000003 ^
+                                   static_cast<uint64_t>(key.sysno));
+    }
+  };
+
+  struct Counters {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> error_count{0};
+    std::atomic<uint64_t> input_bytes{0};
+    std::atomic<uint64_t> output_bytes{0};
+    std::atomic<uint64_t> total_latency_ns{0};
+    std::array<std::atomic<uint64_t>, kNumLatencyBuckets> latency_histogram{};
+  };
+
+  // Returns the counters for |key|, creating them if necessary. Counters are
+  // never removed, so the returned pointer stays valid.
+  Counters *GetCounters(const Key &key);
+
+  MutexGuarded<std::unordered_map<Key, std::unique_ptr<Counters>, KeyHash>>
+      counters_;
+};
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_UTIL_EXIT_METRICS_H_
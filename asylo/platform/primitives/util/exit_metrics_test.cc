@@ -0,0 +1,108 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include "asylo/platform/primitives/util/exit_metrics.h"
+
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/time/time.h"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+using ::testing::Eq;
+using ::testing::IsEmpty;
+using ::testing::SizeIs;
+
+TEST(ExitMetricsTest, LatencyBuckets) {
+  EXPECT_THAT(ExitMetrics::LatencyBucket(absl::ZeroDuration()), Eq(0));
+  EXPECT_THAT(ExitMetrics::LatencyBucket(absl::Nanoseconds(999)), Eq(0));
+  EXPECT_THAT(ExitMetrics::LatencyBucket(absl::Microseconds(1)), Eq(1));
+  EXPECT_THAT(ExitMetrics::LatencyBucket(absl::Microseconds(3)), Eq(2));
+  EXPECT_THAT(ExitMetrics::LatencyBucket(absl::Microseconds(4)), Eq(3));
+  EXPECT_THAT(ExitMetrics::LatencyBucket(absl::Hours(1)),
+              Eq(ExitMetrics::kNumLatencyBuckets - 1));
+}
+
+TEST(ExitMetricsTest, RecordsPerSelectorAndSystemCall) {
+  ExitMetrics metrics;
+  EXPECT_THAT(metrics.Snapshot(), IsEmpty());
+
+  metrics.Record(/*selector=*/1, ExitMetrics::kNoSystemCall,
+                 absl::Microseconds(5), /*input_bytes=*/10,
+                 /*output_bytes=*/20, /*ok=*/true);
+  metrics.Record(/*selector=*/1, ExitMetrics::kNoSystemCall,
+                 absl::Microseconds(6), /*input_bytes=*/1,
+                 /*output_bytes=*/2, /*ok=*/false);
+  metrics.Record(/*selector=*/1, /*sysno=*/0, absl::Microseconds(7),
+                 /*input_bytes=*/0, /*output_bytes=*/0, /*ok=*/true);
+
+  auto snapshot = metrics.Snapshot();
+  ASSERT_THAT(snapshot, SizeIs(2));
+  for (const auto &stats : snapshot) {
+    EXPECT_THAT(stats.selector, Eq(1));
+    if (stats.sysno == ExitMetrics::kNoSystemCall) {
+      EXPECT_THAT(stats.count, Eq(2));
+      EXPECT_THAT(stats.error_count, Eq(1));
+      EXPECT_THAT(stats.input_bytes, Eq(11));
+      EXPECT_THAT(stats.output_bytes, Eq(22));
+      EXPECT_THAT(stats.total_latency_ns, Eq(11000));
+      EXPECT_THAT(stats.latency_histogram[3], Eq(2));
+    } else {
+      EXPECT_THAT(stats.sysno, Eq(0));
+      EXPECT_THAT(stats.count, Eq(1));
+      EXPECT_THAT(stats.error_count, Eq(0));
+    }
+  }
+}
+
+TEST(ExitMetricsTest, ConcurrentRecords) {
+  constexpr int kThreads = 4;
+  constexpr int kRecordsPerThread = 1000;
+
+  ExitMetrics metrics;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; i++) {
+    threads.emplace_back([&metrics, i] {
+      for (int j = 0; j < kRecordsPerThread; j++) {
+        metrics.Record(/*selector=*/j % 2, ExitMetrics::kNoSystemCall,
+                       absl::ZeroDuration(), /*input_bytes=*/1,
+                       /*output_bytes=*/1, /*ok=*/true);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  auto snapshot = metrics.Snapshot();
+  ASSERT_THAT(snapshot, SizeIs(2));
+  for (const auto &stats : snapshot) {
+    EXPECT_THAT(stats.count, Eq(kThreads * kRecordsPerThread / 2));
+    EXPECT_THAT(stats.latency_histogram[0], Eq(stats.count));
+  }
+}
+
+}  // namespace
+}  // namespace primitives
+}  // namespace asylo
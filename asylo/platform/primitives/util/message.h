@@ -30,6 +30,7 @@
 #include <string>
 #include <vector>
 
+#include "absl/container/inlined_vector.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "asylo/platform/primitives/extent.h"
@@ -38,6 +39,84 @@
 namespace asylo {
 namespace primitives {
 
+namespace internal {
+
+// A contiguous growable byte buffer. The first |kInlineSize| bytes are stored
+// inline, so small messages need no heap allocation. Growing the buffer may
+// move its contents, so users should refer to its contents by offset.
+template <size_t kInlineSize>
+class MessageBuffer {
+ public:
+  MessageBuffer() : data_(inline_data_), size_(0), capacity_(kInlineSize) {}
+
+  // Disallow copying.
+  MessageBuffer(const MessageBuffer &other) = delete;
+  MessageBuffer &operator=(const MessageBuffer &other) = delete;
+
+  // Allow moving.
+  MessageBuffer(MessageBuffer &&other) noexcept { MoveFrom(&other); }
+  MessageBuffer &operator=(MessageBuffer &&other) noexcept {
+    if (this != &other) {
+      MoveFrom(&other);
+    }
+    return *this;
+  }
+
+  char *data() { return data_; }
+  const char *data() const { return data_; }
+
+  // Returns the number of bytes in use.
+  size_t size() const { return size_; }
+
+  // Ensures the buffer can hold |capacity| bytes without growing.
+  void Reserve(size_t capacity) {
+    if (capacity <= capacity_) {
+      return;
+    }
+    size_t new_capacity = std::max(capacity, 2 * capacity_);
+    std::unique_ptr<char[]> new_data(new char[new_capacity]);
+    memcpy(new_data.get(), data_, size_);
+    heap_data_ = std::move(new_data);
+    data_ = heap_data_.get();
+    capacity_ = new_capacity;
+  }
+
+  // Extends the buffer by |size| uninitialized bytes, returning the offset of
+  // the first new byte.
+  size_t Append(size_t size) {
+    Reserve(size_ + size);
+    size_t offset = size_;
+    size_ += size;
+    return offset;
+  }
+
+ private:
+  void MoveFrom(MessageBuffer *other) {
+    size_ = other->size_;
+    if (other->heap_data_) {
+      heap_data_ = std::move(other->heap_data_);
+      data_ = heap_data_.get();
+      capacity_ = other->capacity_;
+    } else {
+      heap_data_.reset();
+      memcpy(inline_data_, other->inline_data_, other->size_);
+      data_ = inline_data_;
+      capacity_ = kInlineSize;
+    }
+    other->data_ = other->inline_data_;
+    other->size_ = 0;
+    other->capacity_ = kInlineSize;
+  }
+
+  alignas(uint64_t) char inline_data_[kInlineSize];
+  std::unique_ptr<char[]> heap_data_;
+  char *data_;
+  size_t size_;
+  size_t capacity_;
+};
+
+}  // namespace internal
+
 // A message serialization implementation to allow the users to pass input data
 // via extents and generate a serialized message. The MessageReader is a
 // serialization utility designed to make it easier and safer to pass structured
@@ -50,6 +129,12 @@ namespace primitives {
 // from the writer is disallowed. The message writer does not perform memory
 // allocation for the serialized message. Extents can be pushed by reference or
 // by copy, in which case they are owned by the MessageWriter.
+//
+// Extents pushed by copy are stored, together with their size prefixes, in a
+// single contiguous buffer laid out exactly as the serialized message. Small
+// messages fit in storage inline in the MessageWriter and need no heap
+// allocation, and a message containing no extents pushed by reference is
+// serialized with a single memcpy.
 class MessageWriter {
  public:
   MessageWriter() = default;
@@ -63,53 +148,69 @@ class MessageWriter {
   MessageWriter &operator=(MessageWriter &&other) = default;
 
   // Returns true if no output has been written to the MessageWriter.
-  bool empty() const { return extents_.empty(); }
+  bool empty() const { return entries_.empty(); }
 
   // Returns the number of extents pushed on the writer.
-  size_t size() const { return extents_.size(); }
+  size_t size() const { return entries_.size(); }
 
   // Returns the size of serialized message generated by Serialize().
-  size_t MessageSize() const {
-    size_t result = sizeof(uint64_t) * extents_.size();
-    for (const auto &extent : extents_) {
-      result += extent.size();
-    }
-    return result;
-  }
+  size_t MessageSize() const { return buffer_.size() + referenced_size_; }
 
   // Generates and writes a serialized message into |buffer| owned by
   // the caller, which must accommodate at least MessageSize() bytes.
   void Serialize(void *buffer) const {
-    if (extents_.empty()) {
+    if (entries_.empty()) {
+      return;
+    }
+    if (referenced_size_ == 0) {
+      memcpy(buffer, buffer_.data(), buffer_.size());
       return;
     }
     auto ptr = reinterpret_cast<char *>(buffer);
-    for (const auto &extent : extents_) {
-      uint64_t size = extent.size();
-      memcpy(ptr, &size, sizeof(uint64_t));  // Copy data size.
-      ptr += sizeof(uint64_t);
-      memcpy(ptr, extent.data(), size);  // Copy data.
+    for (const auto &entry : entries_) {
+      uint64_t size = entry.size;
+      if (entry.by_reference) {
+        memcpy(ptr, &size, sizeof(uint64_t));  // Copy data size.
+        ptr += sizeof(uint64_t);
+        if (size > 0) {
+          memcpy(ptr, entry.reference, size);  // Copy data.
+        }
+      } else {
+        // Copy data size and data, which are adjacent in |buffer_|.
+        memcpy(ptr, buffer_.data() + entry.offset - sizeof(uint64_t),
+               sizeof(uint64_t) + size);
+        ptr += sizeof(uint64_t);
+      }
       ptr += size;
     }
   }
 
   // Serializes data using a given serializer.
   void Serialize(const std::function<void(Extent)> &serializer) const {
-    for (const auto &extent : extents_) {
-      serializer(extent);
+    for (const auto &entry : entries_) {
+      serializer(ExtentOf(entry));
     }
   }
 
   // Pushes an extent to the MessageWriter by reference.
-  void PushByReference(Extent extent) { extents_.emplace_back(extent); }
+  void PushByReference(Extent extent) {
+    entries_.push_back(Entry{/*by_reference=*/true, extent.data(),
+                             /*offset=*/0, extent.size()});
+    referenced_size_ += sizeof(uint64_t) + extent.size();
+  }
 
   // Pushes an extent to the MessageWriter by copy. Data is copied and owned by
   // the MessageWriter.
   void PushByCopy(Extent extent) {
-    char *extent_data = new char[extent.size()];
-    copied_data_owner_.emplace_back(extent_data);
-    memcpy(extent_data, extent.data(), extent.size());
-    PushByReference(Extent{extent_data, extent.size()});
+    uint64_t size = extent.size();
+    size_t offset = buffer_.Append(sizeof(uint64_t) + size);
+    memcpy(buffer_.data() + offset, &size, sizeof(uint64_t));
+    offset += sizeof(uint64_t);
+    if (size > 0) {
+      memcpy(buffer_.data() + offset, extent.data(), size);
+    }
+    entries_.push_back(
+        Entry{/*by_reference=*/false, /*reference=*/nullptr, offset, size});
   }
 
   // Pushes non-pointer data types (eg. ints, structs) by value. Internally
@@ -165,19 +266,52 @@ class MessageWriter {
 
   // Copies the extents of |other| to this MessageWriter.
   void Extend(const MessageWriter &other) {
-    for (const auto extent : other.extents_) {
-      PushByCopy(extent);
+    buffer_.Reserve(buffer_.size() + other.MessageSize());
+    for (const auto &entry : other.entries_) {
+      PushByCopy(other.ExtentOf(entry));
     }
   }
 
  private:
-  std::vector<Extent> extents_;
-  std::vector<std::unique_ptr<char[]>> copied_data_owner_;
+  // Size of the inline message storage in bytes.
+  static constexpr size_t kInlineBufferSize = 256;
+
+  // Number of extents tracked without a heap allocation.
+  static constexpr size_t kInlineExtents = 8;
+
+  // An extent pushed on the writer. Extents pushed by copy are stored at
+  // |offset| in |buffer_|, directly after their size prefix. Extents pushed by
+  // reference are stored at |reference|.
+  struct Entry {
+    bool by_reference;
+    const void *reference;
+    size_t offset;
+    size_t size;
+  };
+
+  Extent ExtentOf(const Entry &entry) const {
+    const void *data =
+        entry.by_reference ? entry.reference : buffer_.data() + entry.offset;
+    return Extent{const_cast<void *>(data), entry.size};
+  }
+
+  absl::InlinedVector<Entry, kInlineExtents> entries_;
+
+  // Serialized form of all extents pushed by copy.
+  internal::MessageBuffer<kInlineBufferSize> buffer_;
+
+  // Serialized size of all extents pushed by reference.
+  size_t referenced_size_ = 0;
 };
 
 // A message reader that consumes a serialized message and generates extents.
 // The extent memory is owned by the class and freed with the destructor.
 // Extents can be read from the MessageReader only once, and never written.
+//
+// All extents are stored in a single contiguous buffer, each aligned to 8
+// bytes. Small messages fit in storage inline in the MessageReader and need no
+// heap allocation. Extents returned by a MessageReader are invalidated if the
+// reader is moved or deserializes another message.
 class MessageReader {
  public:
   MessageReader() = default;
@@ -198,30 +332,47 @@ class MessageReader {
   // remotely manage untrusted memory. This necessitates deserializing and
   // copying |buffer| into new owned extents, since MessageReader is expected
   // to own its memory.
-  void Deserialize(const void *buffer, size_t size) {
+  //
+  // Every byte of |buffer| is read exactly once and every extent is bounds
+  // checked against |size| before it is copied, so |buffer| may be
+  // deserialized directly from untrusted memory without first copying it into
+  // a trusted buffer. Returns an error if |buffer| is not a well-formed
+  // message, in which case the extents preceding the malformed one are kept.
+  PrimitiveStatus Deserialize(const void *buffer, size_t size) {
     const char *ptr = reinterpret_cast<const char *>(buffer);
-    const char *end_ptr = ptr + size;
-    while (ptr < end_ptr) {
+    size_t remaining = size;
+    // Padding each extent to alignment never takes more room than its size
+    // prefix, so |size| bytes hold the whole message.
+    buffer_.Reserve(buffer_.size() + size);
+    while (remaining > 0) {
       uint64_t extent_len;
+      if (remaining < sizeof(uint64_t)) {
+        return {error::GoogleError::INVALID_ARGUMENT,
+                "Truncated extent size in serialized message."};
+      }
       memcpy(&extent_len, ptr, sizeof(uint64_t));
       ptr += sizeof(uint64_t);
-      char *extent_data = new char[extent_len];
-      extents_.emplace_back(std::unique_ptr<char[]>(extent_data), extent_len);
-      memcpy(extent_data, ptr, extent_len);
+      remaining -= sizeof(uint64_t);
+      if (extent_len > remaining) {
+        return {error::GoogleError::INVALID_ARGUMENT,
+                "Extent exceeds the size of serialized message."};
+      }
+      memcpy(AppendExtent(extent_len), ptr, extent_len);
       ptr += extent_len;
+      remaining -= extent_len;
     }
+    return PrimitiveStatus::OkStatus();
   }
 
   // Deserializes data using a given deserializer.
   void Deserialize(const size_t size,
                    const std::function<Extent(size_t i)> &deserializer) {
-    extents_.reserve(size);
+    extents_.reserve(extents_.size() + size);
     for (size_t i = 0; i < size; ++i) {
       auto extent = deserializer(i);
-      extents_.emplace_back(absl::make_unique<char[]>(extent.size()),
-                            extent.size());
+      char *extent_data = AppendExtent(extent.size());
       if (extent.size() > 0) {
-        memcpy(extents_.back().first.get(), extent.data(), extent.size());
+        memcpy(extent_data, extent.data(), extent.size());
       }
     }
   }
@@ -229,6 +380,15 @@ class MessageReader {
   // Returns the number of extents read.
   size_t size() const { return extents_.size(); }
 
+  // Returns the size of the serialized message the extents were read from.
+  size_t MessageSize() const {
+    size_t message_size = 0;
+    for (const auto &extent : extents_) {
+      message_size += sizeof(uint64_t) + extent.second;
+    }
+    return message_size;
+  }
+
   // Returns the next extent in the MessageReader. The MessageReader may only be
   // traversed once. The returned extent remains owned by the MessageReader and
   // its lifetime is the lifetime of the MessageReader.
@@ -250,7 +410,8 @@ class MessageReader {
   // return the same extent. The extent remains owned by the MessageReader and
   // its lifetime is the lifetime of the MessageReader.
   Extent peek() {
-    return Extent{extents_[pos_].first.get(), extents_[pos_].second};
+    return Extent{buffer_.data() + extents_[pos_].first,
+                  extents_[pos_].second};
   }
 
   // Interprets the peek item in the MessageReader as a pointer to a value of
@@ -302,7 +463,25 @@ class MessageReader {
   } while (false)
 
  private:
-  std::vector<std::pair<std::unique_ptr<char[]>, size_t>> extents_;
+  // Size of the inline message storage in bytes.
+  static constexpr size_t kInlineBufferSize = 256;
+
+  // Number of extents tracked without a heap allocation.
+  static constexpr size_t kInlineExtents = 8;
+
+  // Appends an extent of |size| bytes to the buffer, returning a pointer to its
+  // uninitialized contents. The pointer is valid until the next call.
+  char *AppendExtent(size_t size) {
+    size_t padded_size =
+        (size + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+    size_t offset = buffer_.Append(padded_size);
+    extents_.emplace_back(offset, size);
+    return buffer_.data() + offset;
+  }
+
+  // Offsets in |buffer_| and sizes of the deserialized extents.
+  absl::InlinedVector<std::pair<size_t, size_t>, kInlineExtents> extents_;
+  internal::MessageBuffer<kInlineBufferSize> buffer_;
   size_t pos_ = 0;
 };
 
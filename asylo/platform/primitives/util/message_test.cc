@@ -20,6 +20,7 @@
 
 #include <cstddef>
 #include <memory>
+#include <string>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -190,6 +191,106 @@ TEST(MessageTest, PushPopStrings) {
   EXPECT_THAT(reader.next().As<char>(), StrEq("moon"));
 }
 
+TEST(MessageTest, DeserializeReturnsOk) {
+  MessageWriter writer;
+  writer.Push(1);
+  writer.PushString("hello");
+
+  const size_t size = writer.MessageSize();
+  const auto buffer = absl::make_unique<char[]>(size);
+  writer.Serialize(buffer.get());
+
+  MessageReader reader;
+  EXPECT_TRUE(reader.Deserialize(buffer.get(), size).ok());
+  EXPECT_THAT(reader, SizeIs(2));
+}
+
+// Ensure a truncated extent size is rejected rather than read past the end of
+// the buffer.
+TEST(MessageTest, DeserializeTruncatedSize) {
+  MessageWriter writer;
+  writer.Push(1);
+  writer.Push(2);
+
+  const size_t size = writer.MessageSize();
+  const auto buffer = absl::make_unique<char[]>(size);
+  writer.Serialize(buffer.get());
+
+  MessageReader reader;
+  EXPECT_FALSE(reader.Deserialize(buffer.get(), size - sizeof(int) - 1).ok());
+  ASSERT_THAT(reader, SizeIs(1));
+  EXPECT_THAT(reader.next<int>(), Eq(1));
+}
+
+// Ensure an extent claiming to be larger than the remaining buffer is rejected.
+TEST(MessageTest, DeserializeOversizedExtent) {
+  MessageWriter writer;
+  writer.PushString("hello");
+
+  const size_t size = writer.MessageSize();
+  const auto buffer = absl::make_unique<char[]>(size);
+  writer.Serialize(buffer.get());
+  uint64_t bogus_size = 1 << 20;
+  memcpy(buffer.get(), &bogus_size, sizeof(bogus_size));
+
+  MessageReader reader;
+  EXPECT_FALSE(reader.Deserialize(buffer.get(), size).ok());
+  EXPECT_THAT(reader, IsEmpty());
+}
+
+// Ensure messages larger than the inline storage round-trip intact.
+TEST(MessageTest, PushPopLargeExtents) {
+  const std::string large(4096, 'x');
+  MessageWriter writer;
+  for (size_t i = 0; i < kNumBuffer * 4; ++i) {
+    writer.Push<uint64_t>(i);
+    writer.PushString(large);
+  }
+  EXPECT_THAT(writer, SizeIs(kNumBuffer * 8));
+
+  auto reader = BuildMessageReader(writer);
+  ASSERT_THAT(reader, SizeIs(kNumBuffer * 8));
+  for (size_t i = 0; i < kNumBuffer * 4; ++i) {
+    EXPECT_THAT(reader.next<uint64_t>(), Eq(i));
+    EXPECT_THAT(reader.next().As<char>(), StrEq(large));
+  }
+}
+
+// Ensure extents pushed by reference and by copy keep their order.
+TEST(MessageTest, MixedReferenceAndCopy) {
+  const std::string referenced = "referenced";
+  MessageWriter writer;
+  writer.Push(7);
+  writer.PushByReference(Extent{referenced.c_str(), referenced.size() + 1});
+  writer.PushString("copied");
+  writer.PushByReference(Extent{nullptr, 0});
+  writer.Push(8);
+
+  auto reader = BuildMessageReader(writer);
+  ASSERT_THAT(reader, SizeIs(5));
+  EXPECT_THAT(reader.next<int>(), Eq(7));
+  EXPECT_THAT(reader.next().As<char>(), StrEq(referenced));
+  EXPECT_THAT(reader.next().As<char>(), StrEq("copied"));
+  EXPECT_TRUE(reader.next().empty());
+  EXPECT_THAT(reader.next<int>(), Eq(8));
+}
+
+// Ensure moved writers and readers keep their contents.
+TEST(MessageTest, MoveWriterAndReader) {
+  MessageWriter writer;
+  writer.Push(1);
+  writer.PushString("moved");
+  MessageWriter moved_writer(std::move(writer));
+  ASSERT_THAT(moved_writer, SizeIs(2));
+
+  MessageReader reader = BuildMessageReader(moved_writer);
+  MessageReader moved_reader;
+  moved_reader = std::move(reader);
+  ASSERT_THAT(moved_reader, SizeIs(2));
+  EXPECT_THAT(moved_reader.next<int>(), Eq(1));
+  EXPECT_THAT(moved_reader.next().As<char>(), StrEq("moved"));
+}
+
 }  // namespace
 }  // namespace primitives
 }  // namespace asylo
@@ -20,6 +20,7 @@
 
 #include <unistd.h>
 
+#include <atomic>
 #include <cstdio>
 #include <cstring>
 
@@ -43,29 +44,43 @@ static constexpr size_t kEntryPointMax = 4096;
 // Enclave status flag bits.
 enum Flag : uint64_t { kInitialized = 0x1, kAborted = 0x2 };
 
+// An entry in the entry handler table. The callback is published with release
+// semantics after the context is written, so a reader that observes a non-null
+// callback also observes its context. Entries are never modified once
+// published, which lets InvokeEntryHandler read them without a lock.
+struct alignas(2 * sizeof(void *)) EntryTableSlot {
+  std::atomic<EntryHandler::Callback> callback;
+  void *context;
+};
+
+static_assert(sizeof(std::atomic<EntryHandler::Callback>) ==
+                  sizeof(EntryHandler::Callback),
+              "std::atomic<EntryHandler::Callback> is not lock free.");
+
 // A statically initialized record describing the state of the enclave.
 struct {
   // Lock ensuring thread-safe enclave initialization. Note that this lock must
   // always be acquired *before* flags_write_lock.
   TrustedSpinLock initialization_lock{/*is_recursive=*/true};
 
-  // Status flag bitmap.
-  uint64_t flags = 0;
+  // Status flag bitmap. Read without a lock on every entry.
+  std::atomic<uint64_t> flags{0};
 
   // Lock protecting writes to the flags bitmap.
   TrustedSpinLock flags_write_lock{/*is_recursive=*/true};
 
-  // Table of enclave entry handlers.
-  EntryHandler entry_table[kEntryPointMax];
+  // Table of enclave entry handlers, indexed by selector. Aligned so that no
+  // entry straddles a cache line.
+  alignas(64) EntryTableSlot entry_table[kEntryPointMax];
 
-  // Lock protecting entry_table.
+  // Lock serializing writes to entry_table.
   TrustedSpinLock entry_table_lock{/*is_recursive=*/true};
 } enclave_state;
 
 // Updates the state of the enclave.
 void UpdateEnclaveState(const Flag &flag) {
   LockGuard lock(&enclave_state.flags_write_lock);
-  enclave_state.flags |= flag;
+  enclave_state.flags.fetch_or(flag, std::memory_order_release);
 }
 
 PrimitiveStatus ReservedEntry(void *context, MessageReader *in,
@@ -75,10 +90,18 @@ PrimitiveStatus ReservedEntry(void *context, MessageReader *in,
 
 // Initializes the enclave if it has not been initialized already.
 void EnsureInitialized() {
+  // Fast path taken by every entry once the enclave has been initialized.
+  if (enclave_state.flags.load(std::memory_order_acquire) &
+      Flag::kInitialized) {
+    return;
+  }
   LockGuard lock(&enclave_state.initialization_lock);
-  if (!(enclave_state.flags & Flag::kInitialized)) {
-    // Register placeholder handlers for reserved entry points.
-    for (uint64_t i = kSelectorAsyloFini + 1; i < kSelectorUser; i++) {
+  if (!(enclave_state.flags.load(std::memory_order_acquire) &
+        Flag::kInitialized)) {
+    // Register placeholder handlers for reserved entry points. Entry points up
+    // to and including kSelectorAsyloLastReserved are left to the backend.
+    for (uint64_t i = kSelectorAsyloLastReserved + 1; i < kSelectorUser;
+         i++) {
       EntryHandler handler{ReservedEntry};
       if (!TrustedPrimitives::RegisterEntryHandler(i, handler).ok()) {
         TrustedPrimitives::BestEffortAbort("Could not register entry handler");
@@ -105,12 +128,15 @@ PrimitiveStatus RegisterEntryHandler(uint64_t trusted_selector,
                                      const EntryHandler &handler) {
   LockGuard lock(&enclave_state.entry_table_lock);
   if (trusted_selector >= kEntryPointMax ||
-      !enclave_state.entry_table[trusted_selector].IsNull()) {
+      enclave_state.entry_table[trusted_selector].callback.load(
+          std::memory_order_relaxed) != nullptr) {
     return {error::GoogleError::OUT_OF_RANGE,
             "Invalid selector in RegisterEntryHandler."};
   }
 
-  enclave_state.entry_table[trusted_selector] = handler;
+  EntryTableSlot &slot = enclave_state.entry_table[trusted_selector];
+  slot.context = handler.context;
+  slot.callback.store(handler.callback, std::memory_order_release);
   return PrimitiveStatus::OkStatus();
 }
 
@@ -120,21 +146,25 @@ PrimitiveStatus InvokeEntryHandler(uint64_t selector, MessageReader *in,
   EnsureInitialized();
 
   // Ensure the enclave has not been aborted.
-  if (enclave_state.flags & Flag::kAborted) {
+  if (enclave_state.flags.load(std::memory_order_acquire) & Flag::kAborted) {
     return {error::GoogleError::ABORTED, "Invalid call to aborted enclave."};
   }
 
   // Bounds check the passed selector.
-  if (selector >= kEntryPointMax ||
-      enclave_state.entry_table[selector].IsNull()) {
+  if (selector >= kEntryPointMax) {
+    return {error::GoogleError::OUT_OF_RANGE,
+            "Invalid selector passed in call to asylo_enclave_call."};
+  }
+  const EntryTableSlot &slot = enclave_state.entry_table[selector];
+  EntryHandler::Callback callback =
+      slot.callback.load(std::memory_order_acquire);
+  if (!callback) {
     return {error::GoogleError::OUT_OF_RANGE,
             "Invalid selector passed in call to asylo_enclave_call."};
   }
 
   // Invoke the entry point handler.
-  auto &handler = enclave_state.entry_table[selector];
-
-  ASYLO_RETURN_IF_ERROR(handler.callback(handler.context, in, out));
+  ASYLO_RETURN_IF_ERROR(callback(slot.context, in, out));
   return PrimitiveStatus::OkStatus();
 }
 
@@ -169,5 +199,32 @@ void *CopyToUntrusted(void *trusted_data, size_t size) {
   return nullptr;
 }
 
+void *SerializeToUntrusted(const MessageWriter &writer, size_t *size) {
+  *size = writer.MessageSize();
+  if (*size == 0) {
+    return nullptr;
+  }
+  void *untrusted_data = TrustedPrimitives::UntrustedLocalAlloc(*size);
+  if (!untrusted_data ||
+      !TrustedPrimitives::IsOutsideEnclave(untrusted_data, *size)) {
+    TrustedPrimitives::BestEffortAbort(
+        "Serialized message should lie within untrusted memory.");
+  }
+  writer.Serialize(untrusted_data);
+  return untrusted_data;
+}
+
+PrimitiveStatus DeserializeFromUntrusted(const void *untrusted_data,
+                                         size_t size, MessageReader *reader) {
+  if (!untrusted_data || size == 0) {
+    return PrimitiveStatus::OkStatus();
+  }
+  if (!TrustedPrimitives::IsOutsideEnclave(untrusted_data, size)) {
+    TrustedPrimitives::BestEffortAbort(
+        "Input should lie within untrusted memory.");
+  }
+  return reader->Deserialize(untrusted_data, size);
+}
+
 }  // namespace primitives
 }  // namespace asylo
@@ -64,6 +64,19 @@ std::unique_ptr<char[]> CopyFromUntrusted(const void *untrusted_data,
 // The caller (or untrusted code) is responsible for freeing the untrusted data.
 void *CopyToUntrusted(void *trusted_data, size_t size);
 
+// Serializes |writer| directly into a new untrusted buffer, returning a raw
+// pointer to the buffer and storing its size in |size|. Returns nullptr if the
+// message is empty. Serialization only reads trusted memory, so no
+// intermediate trusted copy is required. The caller (or untrusted code) is
+// responsible for freeing the untrusted buffer.
+void *SerializeToUntrusted(const MessageWriter &writer, size_t *size);
+
+// Deserializes the untrusted message |untrusted_data| of |size| bytes into
+// |reader| with a single copy. Aborts if the message is found to not be in
+// untrusted memory.
+PrimitiveStatus DeserializeFromUntrusted(const void *untrusted_data,
+                                         size_t size, MessageReader *reader);
+
 }  // namespace primitives
 }  // namespace asylo
 
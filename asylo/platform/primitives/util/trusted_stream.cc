@@ -0,0 +1,132 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/util/trusted_stream.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "asylo/platform/primitives/extent.h"
+#include "asylo/platform/primitives/primitives.h"
+#include "asylo/platform/primitives/trusted_primitives.h"
+#include "asylo/platform/primitives/util/message.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace primitives {
+
+// Bounds the window to what the untrusted side serves in one chunk, kept in
+// sync with EnclaveStream::kMaxChunkSize.
+static constexpr size_t kMaxWindowSize = 64 << 20;
+
+StreamReader::StreamReader(uint64_t stream_id, size_t window_size)
+    : stream_id_(stream_id),
+      window_size_(std::max<size_t>(1, std::min(window_size, kMaxWindowSize))),
+      window_(new char[window_size_]) {}
+
+PrimitiveStatus StreamReader::Fill() {
+  MessageWriter input;
+  input.Push<uint64_t>(stream_id_);
+  input.Push<uint64_t>(window_size_);
+  MessageReader output;
+  ASYLO_RETURN_IF_ERROR(
+      TrustedPrimitives::UntrustedCall(kSelectorStreamRead, &input, &output));
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(output, 1);
+  Extent chunk = output.next();
+  if (chunk.size() > window_size_) {
+    return PrimitiveStatus{error::GoogleError::OUT_OF_RANGE,
+                           "Stream chunk exceeds the requested size"};
+  }
+  memcpy(window_.get(), chunk.data(), chunk.size());
+  begin_ = 0;
+  end_ = chunk.size();
+  exhausted_ = chunk.empty();
+  return PrimitiveStatus::OkStatus();
+}
+
+PrimitiveStatus StreamReader::Read(void *buffer, size_t size,
+                                   size_t *bytes_read) {
+  *bytes_read = 0;
+  char *out = reinterpret_cast<char *>(buffer);
+  while (*bytes_read < size) {
+    if (begin_ == end_) {
+      if (exhausted_) {
+        break;
+      }
+      ASYLO_RETURN_IF_ERROR(Fill());
+      continue;
+    }
+    size_t count = std::min(size - *bytes_read, end_ - begin_);
+    memcpy(out + *bytes_read, window_.get() + begin_, count);
+    begin_ += count;
+    *bytes_read += count;
+  }
+  return PrimitiveStatus::OkStatus();
+}
+
+StreamWriter::StreamWriter(uint64_t stream_id, size_t window_size)
+    : stream_id_(stream_id),
+      window_size_(std::max<size_t>(1, std::min(window_size, kMaxWindowSize))),
+      window_(new char[window_size_]) {}
+
+PrimitiveStatus StreamWriter::Send(const void *data, size_t size) {
+  MessageWriter input;
+  input.Push<uint64_t>(stream_id_);
+  input.PushByReference(Extent{const_cast<void *>(data), size});
+  MessageReader output;
+  return TrustedPrimitives::UntrustedCall(kSelectorStreamWrite, &input,
+                                          &output);
+}
+
+PrimitiveStatus StreamWriter::Write(const void *data, size_t size) {
+  const char *in = reinterpret_cast<const char *>(data);
+  // Fill up the buffered window first, so that output reaches the sink in
+  // order.
+  if (size_ > 0) {
+    size_t count = std::min(size, window_size_ - size_);
+    memcpy(window_.get() + size_, in, count);
+    size_ += count;
+    in += count;
+    size -= count;
+    if (size_ < window_size_) {
+      return PrimitiveStatus::OkStatus();
+    }
+    ASYLO_RETURN_IF_ERROR(Flush());
+  }
+  // Whole windows are sent straight from |data| without buffering.
+  while (size >= window_size_) {
+    ASYLO_RETURN_IF_ERROR(Send(in, window_size_));
+    in += window_size_;
+    size -= window_size_;
+  }
+  memcpy(window_.get(), in, size);
+  size_ = size;
+  return PrimitiveStatus::OkStatus();
+}
+
+PrimitiveStatus StreamWriter::Flush() {
+  if (size_ == 0) {
+    return PrimitiveStatus::OkStatus();
+  }
+  ASYLO_RETURN_IF_ERROR(Send(window_.get(), size_));
+  size_ = 0;
+  return PrimitiveStatus::OkStatus();
+}
+
+}  // namespace primitives
+}  // namespace asylo
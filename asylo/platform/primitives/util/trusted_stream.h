@@ -0,0 +1,87 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_UTIL_TRUSTED_STREAM_H_
+#define ASYLO_PLATFORM_PRIMITIVES_UTIL_TRUSTED_STREAM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "asylo/platform/primitives/primitive_status.h"
+
+namespace asylo {
+namespace primitives {
+
+// Reads the input of an EnclaveStream from inside the enclave. The reader
+// fetches the input with an exit call per window of |window_size| bytes, and
+// only holds one window in enclave memory at a time.
+class StreamReader {
+ public:
+  StreamReader(uint64_t stream_id, size_t window_size);
+
+  StreamReader(const StreamReader &other) = delete;
+  StreamReader &operator=(const StreamReader &other) = delete;
+
+  // Reads up to |size| bytes of the input into |buffer|, storing the number
+  // of bytes read in |bytes_read|. Stores 0 once the input is exhausted.
+  PrimitiveStatus Read(void *buffer, size_t size, size_t *bytes_read);
+
+ private:
+  // Fetches the next window of the input.
+  PrimitiveStatus Fill();
+
+  const uint64_t stream_id_;
+  const size_t window_size_;
+  std::unique_ptr<char[]> window_;
+  size_t begin_ = 0;
+  size_t end_ = 0;
+  bool exhausted_ = false;
+};
+
+// Writes the output of an EnclaveStream from inside the enclave. The writer
+// buffers up to |window_size| bytes of output in enclave memory before passing
+// them to the sink with an exit call.
+class StreamWriter {
+ public:
+  StreamWriter(uint64_t stream_id, size_t window_size);
+
+  StreamWriter(const StreamWriter &other) = delete;
+  StreamWriter &operator=(const StreamWriter &other) = delete;
+
+  // Appends |size| bytes at |data| to the output.
+  PrimitiveStatus Write(const void *data, size_t size);
+
+  // Passes the buffered output to the sink. Must be called before the enclave
+  // call using the stream returns, otherwise the buffered output is lost.
+  PrimitiveStatus Flush();
+
+ private:
+  // Passes |size| bytes at |data| to the sink.
+  PrimitiveStatus Send(const void *data, size_t size);
+
+  const uint64_t stream_id_;
+  const size_t window_size_;
+  std::unique_ptr<char[]> window_;
+  size_t size_ = 0;
+};
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_UTIL_TRUSTED_STREAM_H_
@@ -0,0 +1,153 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_UTIL_TYPED_CALL_H_
+#define ASYLO_PLATFORM_PRIMITIVES_UTIL_TYPED_CALL_H_
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "asylo/platform/primitives/primitive_status.h"
+#include "asylo/platform/primitives/util/message.h"
+#include "asylo/platform/primitives/util/status_conversions.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+namespace primitives {
+
+class Client;
+
+// Declares an enclave or exit call with selector |kSelectorValue| that takes
+// a |RequestType| and returns a |ResponseType|. Both types must be trivially
+// copyable, so that they have a fixed layout and can be marshaled with a
+// single memcpy each. Fixed-size buffers are passed as array members.
+//
+// A call is declared once in a header shared by trusted and untrusted code:
+//
+//   struct AddRequest { int64_t lhs; int64_t rhs; };
+//   struct AddResponse { int64_t sum; };
+//   using AddCall = TypedCall<kSelectorUser + 1, AddRequest, AddResponse>;
+//
+// The enclave registers a handler for it:
+//
+//   PrimitiveStatus Add(void *context, const AddRequest &request,
+//                       AddResponse *response) {
+//     response->sum = request.lhs + request.rhs;
+//     return PrimitiveStatus::OkStatus();
+//   }
+//
+//   TrustedPrimitives::RegisterEntryHandler(
+//       AddCall::kSelector, EntryHandler{TypedEntryCallback<AddCall, &Add>});
+//
+// and the host calls it with Client::TypedEnclaveCall<AddCall>(). Exit calls
+// are declared the same way, registered with TypedExitCallback() and made with
+// TrustedPrimitives::TypedUntrustedCall().
+//
+// A typed call sends a single extent in each direction. Its receiver only
+// checks that the extent has the size of the expected type, rather than
+// counting and checking extents one by one.
+template <uint64_t kSelectorValue, typename RequestType, typename ResponseType>
+struct TypedCall {
+  static_assert(std::is_trivially_copyable<RequestType>::value,
+                "Typed call requests must be trivially copyable");
+  static_assert(std::is_trivially_copyable<ResponseType>::value,
+                "Typed call responses must be trivially copyable");
+
+  static constexpr uint64_t kSelector = kSelectorValue;
+  using Request = RequestType;
+  using Response = ResponseType;
+};
+
+template <uint64_t kSelectorValue, typename RequestType, typename ResponseType>
+constexpr uint64_t
+    TypedCall<kSelectorValue, RequestType, ResponseType>::kSelector;
+
+namespace internal {
+
+// Pushes |value| on |writer| as a single extent.
+template <typename T>
+void PushTyped(const T &value, MessageWriter *writer) {
+  writer->Push(value);
+}
+
+// Reads the next extent of |reader| into |value|. Returns an error if there is
+// no next extent or if it does not have the size of a T.
+template <typename T>
+PrimitiveStatus PopTyped(MessageReader *reader, T *value) {
+  if (!reader->hasNext() || reader->peek().size() != sizeof(T)) {
+    return {error::GoogleError::INVALID_ARGUMENT,
+            "Typed call message does not have the expected layout"};
+  }
+  memcpy(value, reader->next().data(), sizeof(T));
+  return PrimitiveStatus::OkStatus();
+}
+
+}  // namespace internal
+
+// An EntryHandler callback that unmarshals the request of |Call|, invokes
+// |kHandler| with it and marshals its response. The context of the handler is
+// passed along to |kHandler|.
+template <typename Call,
+          PrimitiveStatus (*kHandler)(void *context,
+                                      const typename Call::Request &request,
+                                      typename Call::Response *response)>
+PrimitiveStatus TypedEntryCallback(void *context, MessageReader *in,
+                                   MessageWriter *out) {
+  typename Call::Request request;
+  PrimitiveStatus status = internal::PopTyped(in, &request);
+  if (!status.ok()) {
+    return status;
+  }
+  typename Call::Response response{};
+  status = kHandler(context, request, &response);
+  if (!status.ok()) {
+    return status;
+  }
+  internal::PushTyped(response, out);
+  return PrimitiveStatus::OkStatus();
+}
+
+// An ExitHandler callback that unmarshals the request of |Call|, invokes
+// |kHandler| with it and marshals its response.
+template <typename Call,
+          Status (*kHandler)(std::shared_ptr<Client> client, void *context,
+                             const typename Call::Request &request,
+                             typename Call::Response *response)>
+Status TypedExitCallback(std::shared_ptr<Client> client, void *context,
+                         MessageReader *in, MessageWriter *out) {
+  typename Call::Request request;
+  Status status = MakeStatus(internal::PopTyped(in, &request));
+  if (!status.ok()) {
+    return status;
+  }
+  typename Call::Response response{};
+  status = kHandler(std::move(client), context, request, &response);
+  if (!status.ok()) {
+    return status;
+  }
+  internal::PushTyped(response, out);
+  return Status::OkStatus();
+}
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_UTIL_TYPED_CALL_H_
@@ -0,0 +1,151 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/util/typed_call.h"
+
+#include <cstdint>
+#include <memory>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/memory/memory.h"
+#include "asylo/platform/primitives/primitives.h"
+#include "asylo/platform/primitives/util/message.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/error_codes.h"
+
+using ::testing::Eq;
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+struct AddRequest {
+  int64_t lhs;
+  int64_t rhs;
+};
+
+struct AddResponse {
+  int64_t sum;
+  char name[8];
+};
+
+using AddCall = TypedCall<kSelectorUser + 1, AddRequest, AddResponse>;
+
+// Builds a MessageReader from |writer|.
+MessageReader BuildMessageReader(const MessageWriter &writer) {
+  const size_t size = writer.MessageSize();
+  const auto buffer = absl::make_unique<char[]>(size);
+  writer.Serialize(buffer.get());
+
+  MessageReader reader;
+  reader.Deserialize(buffer.get(), size);
+  return reader;
+}
+
+PrimitiveStatus AddEntry(void *context, const AddRequest &request,
+                         AddResponse *response) {
+  ++*static_cast<int *>(context);
+  response->sum = request.lhs + request.rhs;
+  memcpy(response->name, "add", 4);
+  return PrimitiveStatus::OkStatus();
+}
+
+Status AddExit(std::shared_ptr<Client> /*client*/, void * /*context*/,
+               const AddRequest &request, AddResponse *response) {
+  if (request.rhs < 0) {
+    return Status(error::GoogleError::OUT_OF_RANGE, "Negative operand");
+  }
+  response->sum = request.lhs + request.rhs;
+  return Status::OkStatus();
+}
+
+TEST(TypedCallTest, EntryCallbackRoundTrip) {
+  MessageWriter request_writer;
+  internal::PushTyped(AddRequest{40, 2}, &request_writer);
+  EXPECT_THAT(request_writer.size(), Eq(1));
+  MessageReader request_reader = BuildMessageReader(request_writer);
+
+  int calls = 0;
+  MessageWriter response_writer;
+  ASYLO_ASSERT_OK(MakeStatus(TypedEntryCallback<AddCall, &AddEntry>(
+      &calls, &request_reader, &response_writer)));
+  EXPECT_THAT(calls, Eq(1));
+
+  MessageReader response_reader = BuildMessageReader(response_writer);
+  AddResponse response;
+  ASYLO_ASSERT_OK(MakeStatus(internal::PopTyped(&response_reader, &response)));
+  EXPECT_THAT(response.sum, Eq(42));
+  EXPECT_THAT(response.name, testing::StrEq("add"));
+  EXPECT_FALSE(response_reader.hasNext());
+}
+
+TEST(TypedCallTest, ExitCallbackRoundTrip) {
+  MessageWriter request_writer;
+  internal::PushTyped(AddRequest{1, 2}, &request_writer);
+  MessageReader request_reader = BuildMessageReader(request_writer);
+
+  MessageWriter response_writer;
+  ASYLO_ASSERT_OK((TypedExitCallback<AddCall, &AddExit>(
+      /*client=*/nullptr, /*context=*/nullptr, &request_reader,
+      &response_writer)));
+
+  MessageReader response_reader = BuildMessageReader(response_writer);
+  AddResponse response;
+  ASYLO_ASSERT_OK(MakeStatus(internal::PopTyped(&response_reader, &response)));
+  EXPECT_THAT(response.sum, Eq(3));
+}
+
+TEST(TypedCallTest, HandlerErrorIsReturned) {
+  MessageWriter request_writer;
+  internal::PushTyped(AddRequest{1, -2}, &request_writer);
+  MessageReader request_reader = BuildMessageReader(request_writer);
+
+  MessageWriter response_writer;
+  EXPECT_THAT((TypedExitCallback<AddCall, &AddExit>(
+                  /*client=*/nullptr, /*context=*/nullptr, &request_reader,
+                  &response_writer)),
+              StatusIs(error::GoogleError::OUT_OF_RANGE));
+  EXPECT_TRUE(response_writer.empty());
+}
+
+TEST(TypedCallTest, MalformedRequestIsRejected) {
+  int calls = 0;
+
+  // No extent at all.
+  MessageReader empty_reader;
+  MessageWriter response_writer;
+  EXPECT_THAT(MakeStatus(TypedEntryCallback<AddCall, &AddEntry>(
+                  &calls, &empty_reader, &response_writer)),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+
+  // An extent of the wrong size.
+  MessageWriter request_writer;
+  request_writer.Push<int64_t>(40);
+  MessageReader request_reader = BuildMessageReader(request_writer);
+  EXPECT_THAT(MakeStatus(TypedEntryCallback<AddCall, &AddEntry>(
+                  &calls, &request_reader, &response_writer)),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+
+  EXPECT_THAT(calls, Eq(0));
+  EXPECT_TRUE(response_writer.empty());
+}
+
+}  // namespace
+}  // namespace primitives
+}  // namespace asylo
@@ -22,10 +22,16 @@
 
 // IO syscall interface constants.
 #include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 
+#include <algorithm>
 #include <iomanip>
 #include <memory>
+#include <utility>
+#include <vector>
 
+#include "absl/memory/memory.h"
 #include "absl/strings/escaping.h"
 #include "absl/synchronization/mutex.h"
 #include "asylo/crypto/util/byte_container_view.h"
@@ -101,51 +107,154 @@ ssize_t write_all(int fd, const void *buf, size_t len) {
   return offset;
 }
 
+// Maximum number of iovec entries passed to the host in a single call,
+// UIO_MAXIOV on Linux.
+constexpr int64_t kMaxIovecCount = 1024;
+
+// Returns -1 on failure, or min(|len|, bytes to EOF) on success.
+ssize_t pread_all(int fd, void *buf, size_t len, off_t offset) {
+  size_t bytes_to_read = len;
+  size_t buf_offset = 0;
+
+  while (bytes_to_read > 0) {
+    ssize_t bytes_read;
+    do {
+      bytes_read = enc_untrusted_pread64(
+          fd, static_cast<uint8_t *>(buf) + buf_offset, bytes_to_read,
+          offset + buf_offset);
+    } while ((bytes_read == -1) && is_transient_error(errno));
+    if (bytes_read == -1) {
+      return -1;
+    }
+    if (bytes_read == 0) {
+      return buf_offset;
+    }
+
+    bytes_to_read -= bytes_read;
+    buf_offset += bytes_read;
+  }
+
+  return buf_offset;
+}
+
+// Returns -1 on failure, or |len| on success.
+ssize_t pwrite_all(int fd, const void *buf, size_t len, off_t offset) {
+  size_t buf_offset = 0;
+
+  while (buf_offset < len) {
+    ssize_t bytes_written;
+    do {
+      bytes_written = enc_untrusted_pwrite64(
+          fd, static_cast<const uint8_t *>(buf) + buf_offset,
+          len - buf_offset, offset + buf_offset);
+    } while ((bytes_written == -1) && is_transient_error(errno));
+    if (bytes_written <= 0) {
+      return -1;
+    }
+
+    buf_offset += bytes_written;
+  }
+
+  return buf_offset;
+}
+
+// Number of blocks read ahead on the first sequential read through a file
+// descriptor. The window doubles on each read ahead, up to the lesser of
+// kMaxReadaheadLength bytes and half the block cache, so that blocks read
+// ahead do not evict each other.
+constexpr size_t kInitialReadaheadBlocks = 4;
+constexpr size_t kMaxReadaheadLength = 64 * 1024;
+
+// Length of the journal of a file past which a commit also checkpoints the
+// file, making it durable in place and emptying the journal.
+constexpr size_t kJournalCheckpointLength = 4 * 1024 * 1024;
+
+// Approximate number of file bytes covered by each subtree root in the Merkle
+// tree cache. Loading the tags of a subtree reads this many bytes at most.
+constexpr size_t kMerkleTreeCacheSubtreeBytes = 256 * 1024;
+
+// Returns the level of the subtree roots stored in the Merkle tree cache of a
+// file with secure blocks of |secure_block_length| bytes.
+uint32_t GetMerkleTreeCacheLevel(size_t secure_block_length) {
+  uint32_t level = 0;
+  while ((secure_block_length << (level + 1)) <= kMerkleTreeCacheSubtreeBytes) {
+    level++;
+  }
+  return level;
+}
+
+// Number of low bits of the encoded file size that hold the logical file size.
+constexpr int kBlockLengthShift = 56;
+constexpr uint64_t kFileSizeMask = (uint64_t{1} << kBlockLengthShift) - 1;
+
+bool IsBlockLengthValid(size_t block_length) {
+  return block_length >= kMinBlockLength && block_length <= kMaxBlockLength &&
+         (block_length & (block_length - 1)) == 0;
+}
+
+// Encodes the logical file size and the block length of a file as stored in
+// the file header.
+uint64_t EncodeFileSize(size_t file_size, size_t block_length) {
+  uint64_t exponent = 0;
+  while ((kDefaultBlockLength << exponent) < block_length) {
+    exponent++;
+  }
+  return (exponent << kBlockLengthShift) | file_size;
+}
+
+// Decodes the logical file size and the block length of a file from the file
+// header. Returns false if the encoded block length is invalid.
+bool DecodeFileSize(uint64_t encoded, size_t *file_size,
+                    size_t *block_length) {
+  uint64_t exponent = encoded >> kBlockLengthShift;
+  if (exponent >= kBlockLengthShift ||
+      !IsBlockLengthValid(kDefaultBlockLength << exponent)) {
+    return false;
+  }
+  *file_size = encoded & kFileSizeMask;
+  *block_length = kDefaultBlockLength << exponent;
+  return true;
+}
+
 // Returns offset to the plaintext buffer associated with the |block_index| of
 // a full block.
 const uint8_t *GetPlaintextBuffer(size_t first_partial_block_bytes_count,
-                                  int64_t block_index, const void *buf) {
+                                  int64_t block_index, size_t block_length,
+                                  const void *buf) {
   const uint8_t *plaintext_data = reinterpret_cast<const uint8_t *>(buf);
   if (first_partial_block_bytes_count > 0) {
     if (block_index > 0) {
       plaintext_data += first_partial_block_bytes_count;
     }
     if (block_index > 1) {
-      plaintext_data += (block_index - 1) * kBlockLength;
+      plaintext_data += (block_index - 1) * block_length;
     }
   } else {
-    plaintext_data += block_index * kBlockLength;
+    plaintext_data += block_index * block_length;
   }
 
   return plaintext_data;
 }
 
 uint8_t *GetPlaintextBuffer(size_t first_partial_block_bytes_count,
-                            int64_t block_index, void *buf) {
+                            int64_t block_index, size_t block_length,
+                            void *buf) {
   return const_cast<uint8_t *>(
       GetPlaintextBuffer(first_partial_block_bytes_count, block_index,
-                         const_cast<const void *>(buf)));
+                         block_length, const_cast<const void *>(buf)));
 }
 
 }  // namespace
 
 using Tag = UnsafeBytes<kTagLength>;
-using Token = UnsafeBytes<kTokenLength>;
-using Block = UnsafeBytes<kBlockLength>;
-using Ciphertext = UnsafeBytes<kCipherBlockLength>;
-using SecureBlock = UnsafeBytes<kSecureBlockLength>;
 
 using TagView = ByteContainerView;
 using TokenView = ByteContainerView;
-using BlockView = ByteContainerView;
 using CiphertextView = ByteContainerView;
-using SecureBlockView = ByteContainerView;
 
-AeadHandler::AeadHandler()
-    : offset_translator_(OffsetTranslator::Create(
-          sizeof(FileHeader), kBlockLength, kSecureBlockLength)) {}
+constexpr char AeadHandler::kMerkleTreeCacheSuffix[];
 
-bool AeadHandler::Deserialize(FileControl *file_ctrl) {
+bool AeadHandler::Deserialize(FileControl *file_ctrl, bool is_read_only) {
   if (!file_ctrl) {
     errno = EINVAL;
     return false;
@@ -166,10 +275,26 @@ bool AeadHandler::Deserialize(FileControl *file_ctrl) {
 
     file_ctrl->is_new = false;
 
+    // Discard the Merkle tree cache of a previous file at the same path, if
+    // any. It could never be used, but would be read on every open.
+    std::string cache_path = file_ctrl->path + kMerkleTreeCacheSuffix;
+    enc_untrusted_unlink(cache_path.c_str());
+
+    // Likewise for its journal, which must never be applied to this file.
+    std::string journal_path = file_ctrl->path + SecureJournal::kPathSuffix;
+    enc_untrusted_unlink(journal_path.c_str());
+
     // No metadata to collect.
     return true;
   }
 
+  // Undo the effects of a crash before reading any metadata.
+  if (!RecoverFromJournal(file_ctrl, *cryptor)) {
+    LOG(ERROR) << "Failed to recover file from its journal, path="
+               << file_ctrl->path;
+    return false;
+  }
+
   // Rebuild the Merkle tree.
   int fd = enc_untrusted_open(file_ctrl->path.c_str(), O_RDONLY);
   if (fd == -1) {
@@ -188,72 +313,104 @@ bool AeadHandler::Deserialize(FileControl *file_ctrl) {
     return false;
   }
 
-  // In order to validate the integrity metadata and the file size have to first
-  // collect integrity metadata across the file using the initially untrusted
-  // value of the file size - then validation of the hash of the file digest
-  // confirms validity of both the file size and the integrity metadata.
-  const int64_t blocks_count =
-      (file_header.file_size + kBlockLength - 1) / kBlockLength;
-  Tag tag;
-  for (int64_t block_index = 0; block_index < blocks_count; block_index++) {
-    off_t offset = enc_untrusted_lseek(fd, kBlockLength, SEEK_CUR);
-    if (offset == -1) {
-      LOG(ERROR)
-          << "Failed lseek past block when collecting integrity metadata.";
-      return false;
+  // In order to validate the integrity metadata, the file size and the block
+  // length have to first collect integrity metadata across the file using the
+  // initially untrusted values of the file size and the block length - then
+  // validation of the hash of the file digest confirms validity of all of them.
+  size_t file_size;
+  size_t block_length;
+  if (!DecodeFileSize(file_header.file_size, &file_size, &block_length)) {
+    LOG(ERROR) << "Invalid block length in the file header, path="
+               << file_ctrl->path;
+    errno = EINVAL;
+    return false;
+  }
+  file_ctrl->SetBlockLength(block_length);
+
+  const int64_t blocks_count = (file_size + block_length - 1) / block_length;
+
+  // Restore the Merkle tree from the cache if possible, which does not require
+  // reading the tags of all blocks. Fall back to rebuilding the tree if the
+  // cache is missing or stale.
+  if (LoadMerkleTreeCache(file_ctrl, file_header.file_size, blocks_count)) {
+    if (IsDigestValid(file_ctrl, *cryptor, file_header)) {
+      VLOG(2) << "Restored Merkle tree from the cache, path = "
+              << file_ctrl->path;
+      file_ctrl->logical_size = file_size;
+      file_ctrl->committed_leaf_count = file_ctrl->ad->LeafCount();
+      return true;
+    }
+    LOG(WARNING) << "Ignoring stale Merkle tree cache, path = "
+                 << file_ctrl->path;
+    file_ctrl->ad = absl::make_unique<FlatAuthenticatedDictionary>();
+  }
+
+  // Gather the tags of a batch of blocks per host call, reading the ciphertext
+  // and the token around each tag into a scratch buffer.
+  const int64_t blocks_per_read = kMaxIovecCount / 3;
+  std::vector<uint8_t> scratch(std::max(block_length, kTokenLength));
+  std::vector<Tag> tags(std::min(blocks_count, blocks_per_read));
+  std::vector<struct iovec> iov;
+  for (int64_t first_block_index = 0; first_block_index < blocks_count;
+       first_block_index += blocks_per_read) {
+    const int64_t batch_blocks_count =
+        std::min(blocks_count - first_block_index, blocks_per_read);
+    iov.clear();
+    for (int64_t index = 0; index < batch_blocks_count; index++) {
+      iov.push_back({scratch.data(), block_length});
+      iov.push_back({tags[index].data(), kTagLength});
+      iov.push_back({scratch.data(), kTokenLength});
     }
 
-    bytes_read = read_all(fd, tag.data(), kTagLength);
-    if (bytes_read != kTagLength) {
+    const ssize_t batch_length =
+        batch_blocks_count * file_ctrl->secure_block_length();
+    do {
+      bytes_read = enc_untrusted_preadv(
+          fd, iov.data(), iov.size(),
+          sizeof(FileHeader) +
+              first_block_index * file_ctrl->secure_block_length());
+    } while ((bytes_read == -1) && is_transient_error(errno));
+    if (bytes_read != batch_length) {
       LOG(ERROR) << "Failed to read integrity metadata, bytes_read="
                  << bytes_read;
       return false;
     }
 
-    std::string tag_string(reinterpret_cast<char *>(tag.data()), kTagLength);
-    VLOG(2) << "Adding auth tag as leaf to rebuild Merkle tree: "
-            << absl::BytesToHexString(tag_string);
-    file_ctrl->ad->AddLeaf(tag_string);
-
-    offset = enc_untrusted_lseek(fd, kTokenLength, SEEK_CUR);
-    if (offset == -1) {
-      LOG(ERROR)
-          << "Failed lseek past token when collecting integrity metadata.";
-      return false;
+    for (int64_t index = 0; index < batch_blocks_count; index++) {
+      std::string tag_string(reinterpret_cast<char *>(tags[index].data()),
+                             kTagLength);
+      VLOG(2) << "Adding auth tag as leaf to rebuild Merkle tree: "
+              << absl::BytesToHexString(tag_string);
+      file_ctrl->ad->AddLeaf(tag_string);
     }
   }
 
   VLOG(2) << "Pushed block auth tags on initialization.";
 
-  // Prepare file data digest.
-  DataDigest data_digest;
-  std::copy_n(
-      reinterpret_cast<const uint8_t *>(file_ctrl->ad->CurrentRoot().data()),
-      kRootHashLength, data_digest.data());
-  data_digest.file_size = file_header.file_size;
-
   // Validate AD root and the file size.
-  FileHash new_hash;
-  if (!cryptor->GetAuthTag(new_hash.data(), data_digest.data(),
-                           sizeof(DataDigest))) {
-    LOG(ERROR) << "Failed to generate CMAC for integrity verification, root="
-               << file_ctrl->ad->CurrentRoot();
-    return false;
-  }
-
-  if (new_hash != file_header.file_hash) {
+  if (!IsDigestValid(file_ctrl, *cryptor, file_header)) {
     LOG(ERROR) << "Failure validating integrity root for file "
                << file_ctrl->path << ", current root: "
                << absl::BytesToHexString(file_ctrl->ad->CurrentRoot());
     return false;
   }
 
-  file_ctrl->logical_size = file_header.file_size;
+  file_ctrl->logical_size = file_size;
+  file_ctrl->committed_leaf_count = file_ctrl->ad->LeafCount();
+
+  // Cache the tree for subsequent opens of the file, unless it was opened for
+  // reading only. A file that cannot be written to is still readable without
+  // the cache.
+  if (!is_read_only && !PersistMerkleTreeCache(file_ctrl)) {
+    LOG(WARNING) << "Failed to write Merkle tree cache, path = "
+                 << file_ctrl->path;
+  }
+
   return true;
 }
 
 bool AeadHandler::InitializeFile(int fd, const char *path_name,
-                                 bool is_new_file) {
+                                 bool is_new_file, bool is_read_only) {
   if (!IsPathNameValid(path_name)) {
     LOG(ERROR) << "Invalid input when initializing file, path_name="
                << path_name;
@@ -281,11 +438,16 @@ bool AeadHandler::InitializeFile(int fd, const char *path_name,
           : path_it->second;
   fmap_.emplace(fd, file_ctrl);
   opened_files_.emplace(path_name, file_ctrl);
+  if (is_read_only) {
+    read_only_fds_.insert(fd);
+  }
 
   return true;
 }
 
-bool AeadHandler::RetrieveLogicalOffset(int fd, off_t *logical_offset) const {
+bool AeadHandler::RetrieveLogicalOffset(int fd, const FileControl &file_ctrl,
+                                        off_t *logical_offset) const {
+  file_ctrl.mu.AssertReaderHeld();
   if (fd < 0) {
     errno = EINVAL;
     return false;
@@ -297,7 +459,8 @@ bool AeadHandler::RetrieveLogicalOffset(int fd, off_t *logical_offset) const {
     return false;
   }
 
-  *logical_offset = offset_translator_->PhysicalToLogical(physical_offset);
+  *logical_offset =
+      file_ctrl.offset_translator->PhysicalToLogical(physical_offset);
   if (*logical_offset == OffsetTranslator::kInvalidOffset) {
     LOG(ERROR) << "The file is corrupted, fd = " << fd;
     return false;
@@ -307,14 +470,14 @@ bool AeadHandler::RetrieveLogicalOffset(int fd, off_t *logical_offset) const {
 }
 
 GcmCryptor *AeadHandler::GetGcmCryptor(const FileControl &file_ctrl) const {
-  file_ctrl.mu.AssertHeld();
+  file_ctrl.mu.AssertReaderHeld();
   if (!file_ctrl.master_key) {
     LOG(ERROR) << "Master key has not been set, path = " << file_ctrl.path;
     return nullptr;
   }
 
   GcmCryptor *cryptor = GcmCryptorRegistry::GetInstance().GetGcmCryptor(
-      kBlockLength, *file_ctrl.master_key);
+      file_ctrl.block_length, *file_ctrl.master_key);
   if (!cryptor) {
     LOG(ERROR) << "Unable to instantiate GCM cryptor.";
   }
@@ -328,14 +491,9 @@ ssize_t AeadHandler::DecryptAndVerify(int fd, void *buf, size_t count) {
     return -1;
   }
 
-  off_t logical_offset;
-  if (!RetrieveLogicalOffset(fd, &logical_offset)) {
-    return -1;
-  }
-
   std::shared_ptr<FileControl> file_ctrl;
   {
-    absl::MutexLock global_lock(&mu_);
+    absl::ReaderMutexLock global_lock(&mu_);
 
     auto entry = fmap_.find(fd);
     if (entry == fmap_.end()) {
@@ -347,14 +505,160 @@ ssize_t AeadHandler::DecryptAndVerify(int fd, void *buf, size_t count) {
     file_ctrl = entry->second;
   }
 
-  absl::MutexLock lock(&file_ctrl->mu);
-  return DecryptAndVerifyInternal(fd, buf, count, *file_ctrl, logical_offset);
+  absl::ReaderMutexLock lock(&file_ctrl->mu);
+
+  off_t logical_offset;
+  if (!RetrieveLogicalOffset(fd, *file_ctrl, &logical_offset)) {
+    return -1;
+  }
+
+  // Read ahead of reads continuing where the previous read through |fd|
+  // ended, and stop reading ahead on a read anywhere else.
+  size_t window = 0;
+  int64_t trigger_block = 0;
+  {
+    absl::MutexLock cache_lock(&file_ctrl->cache_mu);
+    ReadaheadState &state = file_ctrl->readahead[fd];
+    if (logical_offset != state.next_offset) {
+      state.window = 0;
+    } else if (state.window == 0) {
+      state.window = kInitialReadaheadBlocks;
+      state.trigger_block = 0;
+    }
+    window = state.window;
+    trigger_block = state.trigger_block;
+  }
+  bool is_read_ahead =
+      window > 0 && ReadAhead(fd, *file_ctrl, logical_offset, count, window,
+                              &trigger_block);
+
+  ssize_t bytes_read =
+      DecryptAndVerifyInternal(fd, buf, count, *file_ctrl, logical_offset);
+
+  {
+    absl::MutexLock cache_lock(&file_ctrl->cache_mu);
+    ReadaheadState &state = file_ctrl->readahead[fd];
+    state.next_offset = bytes_read > 0 ? logical_offset + bytes_read : -1;
+    if (is_read_ahead) {
+      const size_t max_window = std::min(
+          kMaxReadaheadLength / file_ctrl->block_length,
+          file_ctrl->block_cache->capacity() / 2);
+      state.window = std::max<size_t>(1, std::min(2 * window, max_window));
+      state.trigger_block = trigger_block;
+    }
+  }
+
+  return bytes_read;
+}
+
+bool AeadHandler::ReadAhead(int fd, const FileControl &file_ctrl,
+                            off_t logical_offset, size_t count,
+                            size_t window, int64_t *trigger_block) const {
+  file_ctrl.mu.AssertReaderHeld();
+  if (count == 0 || logical_offset >= file_ctrl.logical_size) {
+    return false;
+  }
+
+  const size_t block_length = file_ctrl.block_length;
+  const size_t secure_block_length = file_ctrl.secure_block_length();
+  const size_t max_blocks = file_ctrl.block_cache->capacity() / 2;
+  int64_t first_block_index = logical_offset / block_length;
+  const int64_t requested_blocks =
+      (logical_offset + count + block_length - 1) / block_length -
+      first_block_index;
+  if (requested_blocks > max_blocks) {
+    return false;
+  }
+  const int64_t end_block_index = std::min<int64_t>(
+      file_ctrl.ad->LeafCount(),
+      first_block_index + std::min<int64_t>(requested_blocks + window,
+                                            max_blocks));
+
+  // Skip the blocks already cached, and load the tags of the rest.
+  {
+    absl::MutexLock cache_lock(&file_ctrl.cache_mu);
+    while (first_block_index < end_block_index &&
+           file_ctrl.block_cache->Contains(first_block_index)) {
+      first_block_index++;
+    }
+    const int64_t requested_end_block_index =
+        logical_offset / block_length + requested_blocks;
+    if (first_block_index >= requested_end_block_index &&
+        requested_end_block_index <= *trigger_block) {
+      return false;
+    }
+  }
+  if (first_block_index >= end_block_index ||
+      !LoadLeaves(file_ctrl, first_block_index + 1, end_block_index)) {
+    return false;
+  }
+  *trigger_block = first_block_index;
+
+  GcmCryptor *cryptor = GetGcmCryptor(file_ctrl);
+  if (!cryptor) {
+    return false;
+  }
+
+  std::vector<uint8_t> buffer(
+      (end_block_index - first_block_index) * secure_block_length);
+  ssize_t bytes_read =
+      pread_all(fd, buffer.data(), buffer.size(),
+                sizeof(FileHeader) + first_block_index * secure_block_length);
+  if (bytes_read <= 0) {
+    return false;
+  }
+  const int64_t blocks_read = bytes_read / secure_block_length;
+
+  // Verify the tags of the blocks read, and collect the blocks to decrypt.
+  std::vector<uint8_t> plaintext(blocks_read * block_length);
+  std::vector<const uint8_t *> ciphertexts;
+  std::vector<const uint8_t *> tokens;
+  std::vector<uint8_t *> decrypt_targets;
+  int64_t blocks_verified = 0;
+  {
+    absl::MutexLock cache_lock(&file_ctrl.cache_mu);
+    for (; blocks_verified < blocks_read; blocks_verified++) {
+      const uint8_t *secure_block =
+          buffer.data() + blocks_verified * secure_block_length;
+      std::string leaf_hash =
+          file_ctrl.ad->LeafHash(first_block_index + blocks_verified + 1);
+      // Sparse blocks read as zeros, as |plaintext| is initialized.
+      if (leaf_hash == file_ctrl.zero_hash) {
+        continue;
+      }
+      if (leaf_hash !=
+          file_ctrl.ad->LeafHash(std::string(
+              reinterpret_cast<const char *>(secure_block + block_length),
+              kTagLength))) {
+        break;
+      }
+      ciphertexts.push_back(secure_block);
+      tokens.push_back(secure_block + file_ctrl.cipher_block_length());
+      decrypt_targets.push_back(plaintext.data() +
+                                blocks_verified * block_length);
+    }
+  }
+  if (!cryptor->DecryptBlocks(ciphertexts.size(), ciphertexts.data(),
+                              tokens.data(), decrypt_targets.data())) {
+    return false;
+  }
+
+  absl::MutexLock cache_lock(&file_ctrl.cache_mu);
+  for (int64_t block_index = 0; block_index < blocks_verified; block_index++) {
+    file_ctrl.block_cache->Insert(
+        first_block_index + block_index,
+        plaintext.data() + block_index * block_length);
+  }
+  VLOG(2) << "Read ahead blocks, first block = " << first_block_index
+          << ", blocks count = " << blocks_verified;
+
+  return true;
 }
 
 ssize_t AeadHandler::DecryptAndVerifyInternal(int fd, void *buf, size_t count,
                                               const FileControl &file_ctrl,
                                               off_t logical_offset) const {
-  file_ctrl.mu.AssertHeld();
+  file_ctrl.mu.AssertReaderHeld();
   if (count == 0) {
     return 0;
   }
@@ -369,42 +673,83 @@ ssize_t AeadHandler::DecryptAndVerifyInternal(int fd, void *buf, size_t count,
     count = file_ctrl.logical_size - logical_offset;
   }
 
+  const OffsetTranslator &offset_translator = *file_ctrl.offset_translator;
+  const size_t block_length = file_ctrl.block_length;
+  const size_t cipher_block_length = file_ctrl.cipher_block_length();
+  const size_t secure_block_length = file_ctrl.secure_block_length();
+
   // Determine data breakdown into logical blocks.
   size_t first_partial_block_bytes_count;
   size_t last_partial_block_bytes_count;
   size_t full_inclusive_blocks_bytes_count;
-  offset_translator_->ReduceLogicalRangeToFullLogicalBlocks(
+  offset_translator.ReduceLogicalRangeToFullLogicalBlocks(
       logical_offset, count, &first_partial_block_bytes_count,
       &last_partial_block_bytes_count, &full_inclusive_blocks_bytes_count);
 
-  // Use single read buffer to minimize the number of read calls to the host.
-  std::vector<uint8_t> buffer;
   const size_t physical_bytes_count =
-      (full_inclusive_blocks_bytes_count / kBlockLength) * kSecureBlockLength;
-  buffer.resize(physical_bytes_count);
+      (full_inclusive_blocks_bytes_count / block_length) * secure_block_length;
+  const int64_t blocks_read_max = physical_bytes_count / secure_block_length;
 
-  // Move cursor to the first full block to read.
-  const off_t first_logical_block_offset =
-      (first_partial_block_bytes_count > 0)
-          ? (logical_offset + first_partial_block_bytes_count - kBlockLength)
-          : logical_offset;
+  // Note that the first partial block may also end before the end of the
+  // block, if the whole range falls within a single block.
+  const size_t first_block_skip = logical_offset % block_length;
+  const off_t first_logical_block_offset = logical_offset - first_block_skip;
   const off_t first_physical_block_offset =
-      offset_translator_->LogicalToPhysical(first_logical_block_offset);
-  if (first_partial_block_bytes_count > 0) {
-    off_t offset =
-        enc_untrusted_lseek(fd, first_physical_block_offset, SEEK_SET);
-    if (offset == -1) {
-      LOG(ERROR)
-          << "Failed lseek to the fist block offset when reading file data.";
+      offset_translator.LogicalToPhysical(first_logical_block_offset);
+  const off_t first_block_index =
+      (first_physical_block_offset - sizeof(FileHeader)) / secure_block_length;
+
+  // Serve the read from the block cache if all blocks in the range are cached,
+  // which requires neither reading nor decrypting any of them.
+  BlockCache *block_cache = file_ctrl.block_cache.get();
+  absl::ReleasableMutexLock cache_lock(&file_ctrl.cache_mu);
+  bool is_range_cached = true;
+  for (int64_t block_index = 0; block_index < blocks_read_max; block_index++) {
+    if (!block_cache->Contains(first_block_index + block_index)) {
+      is_range_cached = false;
+      break;
+    }
+  }
+  if (is_range_cached) {
+    const off_t new_cur_physical_offset =
+        offset_translator.LogicalToPhysical(logical_offset + count);
+    if (enc_untrusted_lseek(fd, new_cur_physical_offset, SEEK_SET) == -1) {
+      LOG(ERROR) << "Failed lseek to the end of read range.";
       return -1;
     }
+    for (int64_t block_index = 0; block_index < blocks_read_max;
+         block_index++) {
+      uint8_t *plaintext_data = GetPlaintextBuffer(
+          first_partial_block_bytes_count, block_index, block_length, buf);
+      const uint8_t *block =
+          block_cache->Lookup(first_block_index + block_index);
+      if (block_index == 0 && first_partial_block_bytes_count > 0) {
+        std::copy_n(block + first_block_skip, first_partial_block_bytes_count,
+                    plaintext_data);
+      } else if (block_index == blocks_read_max - 1 &&
+                 last_partial_block_bytes_count > 0) {
+        std::copy_n(block, last_partial_block_bytes_count, plaintext_data);
+      } else {
+        std::copy_n(block, block_length, plaintext_data);
+      }
+    }
+    VLOG(2) << "Read blocks from the block cache, blocks_read = "
+            << blocks_read_max;
+    return count;
   }
+  // Do not serialize concurrent readers while reading from the host.
+  cache_lock.Release();
 
-  // Perform the read. Read may have been requested beyond EOF - cannot require
-  // that bytes_read is equal to physical_bytes_count. The read was not
-  // requested at EOF - checked this above.
-  ssize_t bytes_read =
-      enc_untrusted_read(fd, buffer.data(), physical_bytes_count);
+  // Use single read buffer to minimize the number of read calls to the host.
+  std::vector<uint8_t> buffer;
+  buffer.resize(physical_bytes_count);
+
+  // Perform the read from the first full block, which also covers a partial
+  // first block without a separate seek. Read may have been requested beyond
+  // EOF - cannot require that bytes_read is equal to physical_bytes_count. The
+  // read was not requested at EOF - checked this above.
+  ssize_t bytes_read = enc_untrusted_pread64(
+      fd, buffer.data(), physical_bytes_count, first_physical_block_offset);
   if (bytes_read <= 0) {
     LOG(ERROR) << "Cannot verify data - data has not been read, fd = " << fd;
     return -1;
@@ -412,7 +757,7 @@ ssize_t AeadHandler::DecryptAndVerifyInternal(int fd, void *buf, size_t count,
 
   // Process only complete blocks read, since need per-block metadata to decrypt
   // the block.
-  bytes_read = (bytes_read / kSecureBlockLength) * kSecureBlockLength;
+  bytes_read = (bytes_read / secure_block_length) * secure_block_length;
   if (bytes_read == 0) {
     LOG(ERROR) << "Cannot verify data - data has not been read, fd = " << fd;
     return -1;
@@ -422,15 +767,15 @@ ssize_t AeadHandler::DecryptAndVerifyInternal(int fd, void *buf, size_t count,
   off_t new_cur_logical_offset = logical_offset + count;
   if (bytes_read != physical_bytes_count) {
     int64_t blocks_not_read =
-        (physical_bytes_count - bytes_read) / kSecureBlockLength;
+        (physical_bytes_count - bytes_read) / secure_block_length;
     if (last_partial_block_bytes_count > 0) {
       new_cur_logical_offset -= last_partial_block_bytes_count;
       blocks_not_read--;
     }
-    new_cur_logical_offset -= blocks_not_read * kBlockLength;
+    new_cur_logical_offset -= blocks_not_read * block_length;
   }
   const off_t new_cur_physical_offset =
-      offset_translator_->LogicalToPhysical(new_cur_logical_offset);
+      offset_translator.LogicalToPhysical(new_cur_logical_offset);
   off_t offset = enc_untrusted_lseek(fd, new_cur_physical_offset, SEEK_SET);
   if (offset == -1) {
     LOG(ERROR) << "Failed lseek to the end of read range.";
@@ -442,43 +787,79 @@ ssize_t AeadHandler::DecryptAndVerifyInternal(int fd, void *buf, size_t count,
     return -1;
   }
 
-  // Cycle through blocks.
-  const int64_t blocks_read = bytes_read / kSecureBlockLength;
-  const int64_t blocks_read_max = physical_bytes_count / kSecureBlockLength;
-  const off_t first_block_index =
-      (first_physical_block_offset - sizeof(FileHeader)) / kSecureBlockLength;
+  // Cycle through blocks, verifying the integrity tags and collecting the
+  // blocks to decrypt in a single batch.
+  const int64_t blocks_read = bytes_read / secure_block_length;
+  if (!LoadLeaves(file_ctrl, first_block_index + 1,
+                  first_block_index + blocks_read)) {
+    return -1;
+  }
+  absl::ReleasableMutexLock verify_lock(&file_ctrl.cache_mu);
+  std::vector<const uint8_t *> ciphertexts;
+  std::vector<const uint8_t *> tokens;
+  std::vector<uint8_t *> decrypt_targets;
+  std::vector<int64_t> decrypted_blocks;
+  ciphertexts.reserve(blocks_read);
+  tokens.reserve(blocks_read);
+  decrypt_targets.reserve(blocks_read);
+  decrypted_blocks.reserve(blocks_read);
+
+  // Bounce blocks for reading partial blocks at the ends of the full range, and
+  // the destinations of their content.
+  std::vector<uint8_t> first_bounce_block;
+  std::vector<uint8_t> last_bounce_block;
+  uint8_t *first_partial_data = nullptr;
+  uint8_t *last_partial_data = nullptr;
+  size_t last_partial_bytes_count = 0;
+
   size_t read_count = 0;
   for (int64_t block_index = 0; block_index < blocks_read; block_index++) {
     const size_t merkle_block_idx = first_block_index + block_index + 1;
 
-    uint8_t *plaintext_data =
-        GetPlaintextBuffer(first_partial_block_bytes_count, block_index, buf);
+    uint8_t *plaintext_data = GetPlaintextBuffer(
+        first_partial_block_bytes_count, block_index, block_length, buf);
+
+    // Count of bytes of the block within the read range.
+    size_t block_bytes_count = block_length;
+    if (block_index == 0 && first_partial_block_bytes_count > 0) {
+      block_bytes_count = first_partial_block_bytes_count;
+    } else if (block_index == blocks_read_max - 1 &&
+               last_partial_block_bytes_count > 0) {
+      block_bytes_count = last_partial_block_bytes_count;
+    }
+    read_count += block_bytes_count;
+
+    // Blocks in the block cache need neither verification nor decryption.
+    const uint8_t *cached_block =
+        block_cache->Lookup(first_block_index + block_index);
+    if (cached_block) {
+      size_t block_skip = block_index == 0 ? first_block_skip : 0;
+      std::copy_n(cached_block + block_skip, block_bytes_count, plaintext_data);
+      continue;
+    }
 
     // Detect full blocks that belong to sparse regions in the file - no need to
     // decrypt.
     if (file_ctrl.ad->LeafHash(merkle_block_idx) == file_ctrl.zero_hash) {
       VLOG(2) << "A sparse region block detected.";
-      memset(plaintext_data, 0, kBlockLength);
-      read_count += kBlockLength;
+      memset(plaintext_data, 0, block_bytes_count);
       continue;
     }
 
-    CiphertextView ciphertext(buffer.data() + block_index * kSecureBlockLength,
-                              kCipherBlockLength);
+    const uint8_t *secure_block =
+        buffer.data() + block_index * secure_block_length;
+    CiphertextView ciphertext(secure_block, cipher_block_length);
     VLOG(2) << "Ciphertext read: "
             << absl::BytesToHexString(absl::string_view(
                    reinterpret_cast<const char *>(ciphertext.data()),
-                   kCipherBlockLength));
+                   cipher_block_length));
 
-    TagView tag(buffer.data() + block_index * kSecureBlockLength + kBlockLength,
-                kTagLength);
+    TagView tag(secure_block + block_length, kTagLength);
     VLOG(2) << "Auth tag read: "
             << absl::BytesToHexString(absl::string_view(
                    reinterpret_cast<const char *>(tag.data()), kTagLength));
 
-    TokenView token(
-        buffer.data() + block_index * kSecureBlockLength + kCipherBlockLength,
-        kTokenLength);
+    TokenView token(secure_block + cipher_block_length, kTokenLength);
     VLOG(2) << "Token read: "
             << absl::BytesToHexString(absl::string_view(
                    reinterpret_cast<const char *>(token.data()), kTokenLength));
@@ -493,44 +874,52 @@ ssize_t AeadHandler::DecryptAndVerifyInternal(int fd, void *buf, size_t count,
       return -1;
     }
 
-    // Bounce block for reading partial blocks at the ends of the full range.
-    Block bounce_block;
-    // Target for decryption - bounce block or the supplied buffer.
-    uint8_t *decrypt_target;
-    // Determine the target depending on whether the read block is at the end of
-    // the full range.
-    if ((block_index == 0 && first_partial_block_bytes_count > 0) ||
-        (block_index == blocks_read_max - 1 &&
-         last_partial_block_bytes_count > 0)) {
-      decrypt_target = bounce_block.data();
-    } else {
-      decrypt_target = plaintext_data;
+    // Target for decryption - bounce block or the supplied buffer, depending
+    // on whether the read block is at the end of the full range.
+    uint8_t *decrypt_target = plaintext_data;
+    if (block_index == 0 && first_partial_block_bytes_count > 0) {
+      first_bounce_block.resize(block_length);
+      first_partial_data = plaintext_data;
+      decrypt_target = first_bounce_block.data();
+    } else if (block_bytes_count < block_length) {
+      last_bounce_block.resize(block_length);
+      last_partial_data = plaintext_data;
+      last_partial_bytes_count = block_bytes_count;
+      decrypt_target = last_bounce_block.data();
     }
 
-    // Decrypt the block.
-    if (!cryptor->DecryptBlock(ciphertext.data(), token.data(),
-                               decrypt_target)) {
-      LOG(ERROR) << "Decryption failed, fd = " << fd;
-      return -1;
-    }
+    ciphertexts.push_back(ciphertext.data());
+    tokens.push_back(token.data());
+    decrypt_targets.push_back(decrypt_target);
+    decrypted_blocks.push_back(first_block_index + block_index);
+  }
+  verify_lock.Release();
 
-    // Copy content from the bounce buffer, if used. Increment the count of read
-    // bytes.
-    if (block_index == 0 && first_partial_block_bytes_count > 0) {
-      std::copy_n(
-          bounce_block.begin() + kBlockLength - first_partial_block_bytes_count,
-          first_partial_block_bytes_count, plaintext_data);
-      read_count += first_partial_block_bytes_count;
-    } else if (block_index == blocks_read_max - 1 &&
-               last_partial_block_bytes_count > 0) {
-      std::copy_n(bounce_block.begin(), last_partial_block_bytes_count,
-                  plaintext_data);
-      read_count += last_partial_block_bytes_count;
-    } else {
-      read_count += kBlockLength;
+  // Decrypt the blocks.
+  if (!cryptor->DecryptBlocks(ciphertexts.size(), ciphertexts.data(),
+                              tokens.data(), decrypt_targets.data())) {
+    LOG(ERROR) << "Decryption failed, fd = " << fd;
+    return -1;
+  }
+
+  // Cache the verified plaintext of the decrypted blocks.
+  {
+    absl::MutexLock insert_lock(&file_ctrl.cache_mu);
+    for (size_t index = 0; index < decrypted_blocks.size(); index++) {
+      block_cache->Insert(decrypted_blocks[index], decrypt_targets[index]);
     }
   }
 
+  // Copy content from the bounce buffers, if used.
+  if (first_partial_data) {
+    std::copy_n(first_bounce_block.begin() + first_block_skip,
+                first_partial_block_bytes_count, first_partial_data);
+  }
+  if (last_partial_data) {
+    std::copy_n(last_bounce_block.begin(), last_partial_bytes_count,
+                last_partial_data);
+  }
+
   VLOG(2) << "Verified read blocks, blocks_read = " << blocks_read
           << ", bytes_read = " << bytes_read;
   return read_count;
@@ -544,16 +933,17 @@ bool AeadHandler::UpdateDigest(FileControl *file_ctrl,
   }
   file_ctrl->mu.AssertHeld();
 
-  int fd = enc_untrusted_open(file_ctrl->path.c_str(), O_WRONLY);
-  if (fd == -1) {
-    LOG(ERROR) << "Failed to open file to save data digest, path="
-               << file_ctrl->path << ", errno = " << errno;
-    return false;
-  }
+  FileHeader header;
+  return ComputeFileHeader(*file_ctrl, cryptor, &header) &&
+         WriteFileHeader(*file_ctrl, header);
+}
 
-  FdCloser fd_closer(fd, &enc_untrusted_close);
+bool AeadHandler::ComputeFileHeader(const FileControl &file_ctrl,
+                                    const GcmCryptor &cryptor,
+                                    FileHeader *header) const {
+  file_ctrl.mu.AssertReaderHeld();
 
-  std::string root = file_ctrl->ad->CurrentRoot();
+  std::string root = file_ctrl.ad->CurrentRoot();
   if (root.size() != kRootHashLength) {
     LOG(ERROR) << "Unexpected size of root hash encountered, size="
                << root.size();
@@ -564,42 +954,389 @@ bool AeadHandler::UpdateDigest(FileControl *file_ctrl,
   DataDigest data_digest;
   std::copy_n(reinterpret_cast<const uint8_t *>(root.data()), kRootHashLength,
               data_digest.data());
-  data_digest.file_size = file_ctrl->logical_size;
+  data_digest.file_size =
+      EncodeFileSize(file_ctrl.logical_size, file_ctrl.block_length);
 
-  FileHeader header;
-  if (!cryptor.GetAuthTag(header.data(), data_digest.data(),
+  if (!cryptor.GetAuthTag(header->data(), data_digest.data(),
                           sizeof(DataDigest))) {
     LOG(ERROR) << "Failed to generate CMAC, root = " << root;
     return false;
   }
-  header.file_size = file_ctrl->logical_size;
+  header->file_size = data_digest.file_size;
 
-  VLOG(2) << "Updating the digest for file: " << file_ctrl->path
+  VLOG(2) << "Computed the digest for file: " << file_ctrl.path
           << ", root hash: " << absl::BytesToHexString(root);
-  ssize_t bytes_written = write_all(fd, header.data(), sizeof(FileHeader));
+  return true;
+}
+
+bool AeadHandler::WriteFileHeader(const FileControl &file_ctrl,
+                                  const FileHeader &header) const {
+  file_ctrl.mu.AssertReaderHeld();
+
+  int fd = enc_untrusted_open(file_ctrl.path.c_str(), O_WRONLY);
+  if (fd == -1) {
+    LOG(ERROR) << "Failed to open file to save data digest, path="
+               << file_ctrl.path << ", errno = " << errno;
+    return false;
+  }
+
+  FdCloser fd_closer(fd, &enc_untrusted_close);
+
+  ssize_t bytes_written = write_all(fd, &header, sizeof(FileHeader));
   if (bytes_written != sizeof(FileHeader)) {
     LOG(ERROR) << "Failed to write full digest to file, path="
-               << file_ctrl->path << ", bytes written = " << bytes_written;
+               << file_ctrl.path << ", bytes written = " << bytes_written;
     return false;
   }
 
   if (!fd_closer.reset()) {
     LOG(ERROR) << "Failed to close the file after digest update, path="
-               << file_ctrl->path;
+               << file_ctrl.path;
     return false;
   }
 
   return true;
 }
 
+bool AeadHandler::RecoverFromJournal(FileControl *file_ctrl,
+                                     const GcmCryptor &cryptor) const {
+  file_ctrl->mu.AssertHeld();
+
+  std::vector<SecureJournal::Record> records;
+  if (!SecureJournal::Read(file_ctrl->path + SecureJournal::kPathSuffix,
+                           cryptor, &records)) {
+    return false;
+  }
+  if (records.empty()) {
+    return true;
+  }
+
+  int64_t last_commit = -1;
+  for (int64_t index = 0; index < records.size(); index++) {
+    if (records[index].type == SecureJournal::RecordType::kCommit) {
+      last_commit = index;
+    }
+  }
+  LOG(WARNING) << "Recovering file from its journal, path = "
+               << file_ctrl->path << ", records = " << records.size()
+               << ", uncommitted records = "
+               << records.size() - (last_commit + 1);
+
+  int fd = enc_untrusted_open(file_ctrl->path.c_str(), O_WRONLY);
+  if (fd == -1) {
+    LOG(ERROR) << "Failed to open file for recovery, path=" << file_ctrl->path
+               << ", errno = " << errno;
+    return false;
+  }
+  FdCloser fd_closer(fd, &enc_untrusted_close);
+
+  // Redo the committed writes, which bring the file to its last committed
+  // state, including its header...
+  for (int64_t index = 0; index <= last_commit; index++) {
+    const SecureJournal::Record &record = records[index];
+    const bool is_commit = record.type == SecureJournal::RecordType::kCommit;
+    if (record.type == SecureJournal::RecordType::kUndo ||
+        (is_commit && record.data.size() != sizeof(FileHeader))) {
+      continue;
+    }
+    const off_t offset = is_commit ? 0 : record.offset;
+    if (pwrite_all(fd, record.data.data(), record.data.size(), offset) !=
+        record.data.size()) {
+      return false;
+    }
+  }
+
+  // ...then undo the uncommitted overwrites of committed blocks, latest first.
+  for (int64_t index = records.size() - 1; index > last_commit; index--) {
+    const SecureJournal::Record &record = records[index];
+    if (record.type == SecureJournal::RecordType::kUndo &&
+        pwrite_all(fd, record.data.data(), record.data.size(),
+                   record.offset) != record.data.size()) {
+      return false;
+    }
+  }
+
+  // Blocks appended after the last commit are not part of the file.
+  if (last_commit >= 0 &&
+      enc_untrusted_ftruncate(fd, records[last_commit].offset) != 0) {
+    return false;
+  }
+
+  if (enc_untrusted_fsync(fd) != 0 || !fd_closer.reset()) {
+    return false;
+  }
+  return file_ctrl->journal->Reset();
+}
+
+bool AeadHandler::JournalWrite(FileControl *file_ctrl,
+                               const GcmCryptor &cryptor,
+                               int64_t first_block_index, int64_t blocks_count,
+                               const uint8_t *blocks) const {
+  file_ctrl->mu.AssertHeld();
+
+  const size_t secure_block_length = file_ctrl->secure_block_length();
+  const int64_t committed_end =
+      std::min<int64_t>(first_block_index + blocks_count,
+                        file_ctrl->committed_leaf_count);
+
+  // Save the committed contents of the blocks to be overwritten, unless they
+  // were saved since the last commit.
+  std::vector<int64_t> saved_blocks;
+  if (first_block_index < committed_end) {
+    const off_t first_offset =
+        sizeof(FileHeader) + first_block_index * secure_block_length;
+    const size_t length =
+        (committed_end - first_block_index) * secure_block_length;
+    std::vector<uint8_t> committed_blocks(length);
+    int fd = enc_untrusted_open(file_ctrl->path.c_str(), O_RDONLY);
+    if (fd == -1) {
+      return false;
+    }
+    FdCloser fd_closer(fd, &enc_untrusted_close);
+    if (pread_all(fd, committed_blocks.data(), length, first_offset) !=
+        length) {
+      return false;
+    }
+
+    for (int64_t index = first_block_index; index < committed_end; index++) {
+      if (file_ctrl->undo_journaled_blocks.count(index) != 0) {
+        continue;
+      }
+      const size_t block_offset =
+          (index - first_block_index) * secure_block_length;
+      if (!file_ctrl->journal->Append(
+              cryptor, SecureJournal::RecordType::kUndo,
+              first_offset + block_offset,
+              committed_blocks.data() + block_offset, secure_block_length)) {
+        return false;
+      }
+      saved_blocks.push_back(index);
+    }
+  }
+
+  // The saved contents must be durable before the blocks are overwritten.
+  if (!saved_blocks.empty()) {
+    if (!file_ctrl->journal->Sync()) {
+      return false;
+    }
+    file_ctrl->undo_journaled_blocks.insert(saved_blocks.begin(),
+                                            saved_blocks.end());
+  }
+
+  return file_ctrl->journal->Append(
+      cryptor, SecureJournal::RecordType::kRedo,
+      sizeof(FileHeader) + first_block_index * secure_block_length, blocks,
+      blocks_count * secure_block_length);
+}
+
+bool AeadHandler::CheckpointJournal(FileControl *file_ctrl,
+                                    size_t min_length) const {
+  file_ctrl->mu.AssertHeld();
+
+  if (file_ctrl->journal->length() < min_length) {
+    return true;
+  }
+  int fd = enc_untrusted_open(file_ctrl->path.c_str(), O_WRONLY);
+  if (fd == -1) {
+    return false;
+  }
+  FdCloser fd_closer(fd, &enc_untrusted_close);
+  return enc_untrusted_fsync(fd) == 0 && fd_closer.reset() &&
+         file_ctrl->journal->Reset();
+}
+
+bool AeadHandler::IsDigestValid(FileControl *file_ctrl,
+                                const GcmCryptor &cryptor,
+                                const FileHeader &file_header) const {
+  file_ctrl->mu.AssertHeld();
+
+  // Prepare file data digest.
+  DataDigest data_digest;
+  std::string root = file_ctrl->ad->CurrentRoot();
+  std::copy_n(reinterpret_cast<const uint8_t *>(root.data()), kRootHashLength,
+              data_digest.data());
+  data_digest.file_size = file_header.file_size;
+
+  FileHash new_hash;
+  if (!cryptor.GetAuthTag(new_hash.data(), data_digest.data(),
+                          sizeof(DataDigest))) {
+    LOG(ERROR) << "Failed to generate CMAC for integrity verification, root="
+               << absl::BytesToHexString(root);
+    return false;
+  }
+
+  return new_hash == file_header.file_hash;
+}
+
+bool AeadHandler::LoadMerkleTreeCache(FileControl *file_ctrl,
+                                      uint64_t file_size,
+                                      size_t leaf_count) const {
+  file_ctrl->mu.AssertHeld();
+
+  std::string cache_path = file_ctrl->path + kMerkleTreeCacheSuffix;
+  int fd = enc_untrusted_open(cache_path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+
+  FdCloser fd_closer(fd, &enc_untrusted_close);
+
+  MerkleTreeCacheHeader cache_header;
+  ssize_t bytes_read = read_all(fd, &cache_header, sizeof(cache_header));
+  const uint32_t subtree_level =
+      GetMerkleTreeCacheLevel(file_ctrl->secure_block_length());
+  if (bytes_read != sizeof(cache_header) ||
+      cache_header.file_size != file_size ||
+      cache_header.subtree_level != subtree_level || leaf_count == 0) {
+    return false;
+  }
+
+  // Read one byte past the expected roots to detect a cache of the wrong size.
+  const size_t subtree_count = ((leaf_count - 1) >> subtree_level) + 1;
+  std::string roots(
+      subtree_count * FlatAuthenticatedDictionary::kHashLength + 1, '\0');
+  bytes_read = read_all(fd, &roots[0], roots.size());
+  if (bytes_read != roots.size() - 1) {
+    return false;
+  }
+  roots.pop_back();
+
+  return file_ctrl->ad->RestoreFromSubtreeRoots(leaf_count, subtree_level,
+                                                roots);
+}
+
+bool AeadHandler::PersistMerkleTreeCache(FileControl *file_ctrl) const {
+  file_ctrl->mu.AssertHeld();
+
+  MerkleTreeCacheHeader cache_header;
+  cache_header.file_size =
+      EncodeFileSize(file_ctrl->logical_size, file_ctrl->block_length);
+  cache_header.subtree_level =
+      GetMerkleTreeCacheLevel(file_ctrl->secure_block_length());
+  if ((file_ctrl->ad->LeafCount() >> cache_header.subtree_level) == 0) {
+    return true;
+  }
+  std::string roots = file_ctrl->ad->SubtreeRoots(cache_header.subtree_level);
+
+  std::string cache_path = file_ctrl->path + kMerkleTreeCacheSuffix;
+  int fd = enc_untrusted_open(cache_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+                              S_IRUSR | S_IWUSR);
+  if (fd == -1) {
+    return false;
+  }
+
+  FdCloser fd_closer(fd, &enc_untrusted_close);
+
+  if (write_all(fd, &cache_header, sizeof(cache_header)) !=
+          sizeof(cache_header) ||
+      write_all(fd, roots.data(), roots.size()) != roots.size()) {
+    return false;
+  }
+
+  return fd_closer.reset();
+}
+
+bool AeadHandler::LoadLeaves(const FileControl &file_ctrl, size_t first_leaf,
+                             size_t last_leaf) const {
+  file_ctrl.mu.AssertReaderHeld();
+
+  // Collect the subtrees to load. Leaves are only unloaded by writers, which
+  // hold |mu| exclusively, so a subtree collected here is at most loaded by a
+  // concurrent reader once |cache_mu| is released.
+  std::vector<std::pair<size_t, size_t>> subtrees;
+  {
+    absl::MutexLock cache_lock(&file_ctrl.cache_mu);
+    for (size_t leaf = first_leaf; leaf <= last_leaf; leaf++) {
+      if (file_ctrl.ad->IsLeafLoaded(leaf)) {
+        continue;
+      }
+      size_t subtree_first_leaf;
+      size_t subtree_leaf_count;
+      file_ctrl.ad->GetSubtreeLeaves(leaf, &subtree_first_leaf,
+                                     &subtree_leaf_count);
+      subtrees.emplace_back(subtree_first_leaf, subtree_leaf_count);
+      leaf = subtree_first_leaf + subtree_leaf_count - 1;
+    }
+  }
+  if (subtrees.empty()) {
+    return true;
+  }
+
+  int fd = enc_untrusted_open(file_ctrl.path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    LOG(ERROR) << "Failed to open file for loading integrity metadata, "
+                  "path = "
+               << file_ctrl.path << ", errno = " << errno;
+    return false;
+  }
+  FdCloser fd_closer(fd, &enc_untrusted_close);
+
+  const size_t block_length = file_ctrl.block_length;
+  const size_t secure_block_length = file_ctrl.secure_block_length();
+  std::vector<uint8_t> buffer;
+  for (const auto &subtree : subtrees) {
+    const size_t subtree_first_leaf = subtree.first;
+    const size_t subtree_leaf_count = subtree.second;
+
+    // Read the blocks of the whole subtree at once, and collect their tags.
+    buffer.resize(subtree_leaf_count * secure_block_length);
+    off_t offset =
+        sizeof(FileHeader) + (subtree_first_leaf - 1) * secure_block_length;
+    ssize_t bytes_read =
+        pread_all(fd_closer.get(), buffer.data(), buffer.size(), offset);
+    if (bytes_read != buffer.size()) {
+      LOG(ERROR) << "Failed to read integrity metadata, bytes_read="
+                 << bytes_read;
+      return false;
+    }
+
+    std::vector<std::string> tags;
+    tags.reserve(subtree_leaf_count);
+    for (size_t index = 0; index < subtree_leaf_count; index++) {
+      tags.emplace_back(reinterpret_cast<const char *>(buffer.data()) +
+                            index * secure_block_length + block_length,
+                        kTagLength);
+    }
+
+    // Verify the tags against the subtree root and insert them.
+    absl::MutexLock cache_lock(&file_ctrl.cache_mu);
+    if (file_ctrl.ad->IsLeafLoaded(subtree_first_leaf)) {
+      // Loaded by a concurrent reader.
+      continue;
+    }
+    if (!file_ctrl.ad->LoadSubtree(subtree_first_leaf, tags)) {
+      LOG(ERROR) << "Integrity verification of block tags failed, path = "
+                 << file_ctrl.path;
+      errno = EIO;
+      return false;
+    }
+    VLOG(2) << "Loaded block auth tags, first block = " << subtree_first_leaf
+            << ", blocks count = " << subtree_leaf_count;
+  }
+
+  return true;
+}
+
 bool AeadHandler::ReadFullBlock(const FileControl &file_ctrl,
-                                off_t logical_offset, Block *block) const {
-  file_ctrl.mu.AssertHeld();
-  if (logical_offset < 0 || logical_offset % kBlockLength != 0) {
+                                off_t logical_offset,
+                                std::vector<uint8_t> *block) const {
+  file_ctrl.mu.AssertReaderHeld();
+  const size_t block_length = file_ctrl.block_length;
+  if (logical_offset < 0 || logical_offset % block_length != 0) {
     errno = EINVAL;
     return false;
   }
 
+  {
+    absl::MutexLock cache_lock(&file_ctrl.cache_mu);
+    const uint8_t *cached_block =
+        file_ctrl.block_cache->Lookup(logical_offset / block_length);
+    if (cached_block) {
+      block->assign(cached_block, cached_block + block_length);
+      return true;
+    }
+  }
+
   int fd = enc_untrusted_open(file_ctrl.path.c_str(), O_RDONLY);
   if (fd == -1) {
     LOG(ERROR) << "Failed to open file to read a block, path=" << file_ctrl.path
@@ -609,21 +1346,23 @@ bool AeadHandler::ReadFullBlock(const FileControl &file_ctrl,
 
   FdCloser fd_closer(fd, &enc_untrusted_close);
 
-  off_t physical_offset = offset_translator_->LogicalToPhysical(logical_offset);
+  off_t physical_offset =
+      file_ctrl.offset_translator->LogicalToPhysical(logical_offset);
   off_t offset = enc_untrusted_lseek(fd, physical_offset, SEEK_SET);
   if (offset == -1) {
     LOG(ERROR) << "Failed lseek when reading a full block.";
     return false;
   }
 
-  ssize_t bytes_read = DecryptAndVerifyInternal(fd, block->data(), kBlockLength,
+  block->resize(block_length);
+  ssize_t bytes_read = DecryptAndVerifyInternal(fd, block->data(), block_length,
                                                 file_ctrl, logical_offset);
   if (bytes_read == -1) {
-    return -1;
+    return false;
   }
 
-  if (bytes_read < kBlockLength) {
-    memset(block->data() + bytes_read, 0, kBlockLength - bytes_read);
+  if (bytes_read < block_length) {
+    memset(block->data() + bytes_read, 0, block_length - bytes_read);
   }
 
   return true;
@@ -635,14 +1374,9 @@ ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
     return -1;
   }
 
-  off_t logical_offset;
-  if (!RetrieveLogicalOffset(fd, &logical_offset)) {
-    return -1;
-  }
-
   std::shared_ptr<FileControl> file_ctrl;
   {
-    absl::MutexLock global_lock(&mu_);
+    absl::ReaderMutexLock global_lock(&mu_);
 
     auto entry = fmap_.find(fd);
     if (entry == fmap_.end()) {
@@ -654,40 +1388,58 @@ ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
     file_ctrl = entry->second;
   }
 
+  absl::MutexLock lock(&file_ctrl->mu);
+
+  off_t logical_offset;
+  if (!RetrieveLogicalOffset(fd, *file_ctrl, &logical_offset)) {
+    return -1;
+  }
+
   if (count == 0) {
     return 0;
   }
 
-  absl::MutexLock lock(&file_ctrl->mu);
+  // The file header has room for file sizes up to kFileSizeMask only.
+  if (logical_offset + count > kFileSizeMask) {
+    errno = EFBIG;
+    return -1;
+  }
+
+  const OffsetTranslator &offset_translator = *file_ctrl->offset_translator;
+  const size_t block_length = file_ctrl->block_length;
+  const size_t cipher_block_length = file_ctrl->cipher_block_length();
+  const size_t secure_block_length = file_ctrl->secure_block_length();
 
   // Determine data breakdown into logical blocks.
   size_t first_partial_block_bytes_count;
   size_t last_partial_block_bytes_count;
   size_t full_inclusive_blocks_bytes_count;
-  offset_translator_->ReduceLogicalRangeToFullLogicalBlocks(
+  offset_translator.ReduceLogicalRangeToFullLogicalBlocks(
       logical_offset, count, &first_partial_block_bytes_count,
       &last_partial_block_bytes_count, &full_inclusive_blocks_bytes_count);
 
+  // Note that the first partial block may also end before the end of the block,
+  // if the whole range falls within a single block.
+  const size_t first_block_skip = logical_offset % block_length;
+  const off_t first_logical_block_offset = logical_offset - first_block_skip;
+
   // Bounce block for writing the first partial block in the range, if any.
-  Block first_block;
+  std::vector<uint8_t> first_block;
   if (first_partial_block_bytes_count > 0) {
-    if (!ReadFullBlock(
-            *file_ctrl,
-            logical_offset + first_partial_block_bytes_count - kBlockLength,
-            &first_block)) {
+    if (!ReadFullBlock(*file_ctrl, first_logical_block_offset, &first_block)) {
       LOG(ERROR)
           << "failed to read the first misaligned block when writing, fd = "
           << fd;
       return -1;
     }
 
-    std::copy_n(
-        reinterpret_cast<const uint8_t *>(buf), first_partial_block_bytes_count,
-        first_block.data() + kBlockLength - first_partial_block_bytes_count);
+    std::copy_n(reinterpret_cast<const uint8_t *>(buf),
+                first_partial_block_bytes_count,
+                first_block.data() + first_block_skip);
   }
 
   // Bounce block for writing the last partial block in the range, if any.
-  Block last_block;
+  std::vector<uint8_t> last_block;
   if (last_partial_block_bytes_count > 0) {
     if (!ReadFullBlock(*file_ctrl,
                        logical_offset + count - last_partial_block_bytes_count,
@@ -703,19 +1455,30 @@ ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
                 last_partial_block_bytes_count, last_block.data());
   }
 
-  const off_t first_logical_block_offset =
-      (first_partial_block_bytes_count > 0)
-          ? (logical_offset + first_partial_block_bytes_count - kBlockLength)
-          : logical_offset;
   const off_t first_physical_block_offset =
-      offset_translator_->LogicalToPhysical(first_logical_block_offset);
+      offset_translator.LogicalToPhysical(first_logical_block_offset);
   const int64_t eof_block_index = file_ctrl->ad->LeafCount();
+  const int64_t blocks_to_write =
+      full_inclusive_blocks_bytes_count / block_length;
+
+  // Load the tags of the blocks to overwrite, and of the last block if the
+  // tree grows, before modifying the tree.
+  const int64_t first_block_index =
+      (first_physical_block_offset - sizeof(FileHeader)) / secure_block_length;
+  const int64_t end_block_index = first_block_index + blocks_to_write;
+  if (!LoadLeaves(*file_ctrl, first_block_index + 1,
+                  std::min(end_block_index, eof_block_index)) ||
+      (end_block_index > eof_block_index &&
+       !LoadLeaves(*file_ctrl, eof_block_index, eof_block_index))) {
+    return -1;
+  }
+
   int64_t start_block_to_write = 0;
   if (first_physical_block_offset > file_ctrl->physical_size()) {
     // Append leafs to the Merkle Tree to account for sparse region blocks.
     int64_t sparse_blocks_count =
         (first_physical_block_offset - file_ctrl->physical_size()) /
-        kSecureBlockLength;
+        secure_block_length;
     for (int64_t idx = 0; idx < sparse_blocks_count; idx++) {
       VLOG(2) << "Adding an empty auth tag to AD for a block "
                  "from a sparse region: "
@@ -726,7 +1489,7 @@ ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
   } else {
     int64_t blocks_to_eof =
         (file_ctrl->physical_size() - first_physical_block_offset) /
-        kSecureBlockLength;
+        secure_block_length;
     start_block_to_write = eof_block_index - blocks_to_eof;
   }
 
@@ -739,51 +1502,53 @@ ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
 
   // Use single write buffer to minimize the number of write calls to the host.
   std::vector<uint8_t> buffer;
-  const int64_t blocks_to_write =
-      full_inclusive_blocks_bytes_count / kBlockLength;
-  const size_t physical_bytes_count = blocks_to_write * kSecureBlockLength;
+  const size_t physical_bytes_count = blocks_to_write * secure_block_length;
   buffer.resize(physical_bytes_count);
 
-  // Cycle through blocks.
-  std::vector<Tag> tags;
+  // Determine the source and the destination of each block, then encrypt all
+  // the blocks in a single batch.
+  std::vector<const uint8_t *> encrypt_sources(blocks_to_write);
+  std::vector<uint8_t *> ciphertexts(blocks_to_write);
+  std::vector<uint8_t *> tokens(blocks_to_write);
   for (int64_t block_index = 0; block_index < blocks_to_write; block_index++) {
-    const uint8_t *plaintext_data =
-        GetPlaintextBuffer(first_partial_block_bytes_count, block_index, buf);
+    const uint8_t *plaintext_data = GetPlaintextBuffer(
+        first_partial_block_bytes_count, block_index, block_length, buf);
 
-    // Source for encryption - bounce block or the supplied buffer.
-    const uint8_t *encrypt_source;
-    // Determine the source depending on whether the written block is at the end
-    // of the full range.
+    // Source for encryption - bounce block or the supplied buffer, depending
+    // on whether the written block is at the end of the full range.
     if (block_index == 0 && first_partial_block_bytes_count > 0) {
-      encrypt_source = first_block.data();
+      encrypt_sources[block_index] = first_block.data();
     } else if (block_index == blocks_to_write - 1 &&
                last_partial_block_bytes_count > 0) {
-      encrypt_source = last_block.data();
+      encrypt_sources[block_index] = last_block.data();
     } else {
-      encrypt_source = plaintext_data;
+      encrypt_sources[block_index] = plaintext_data;
     }
 
-    Ciphertext *ciphertext =
-        Ciphertext::Place(&buffer, block_index * kSecureBlockLength);
-    Token *token = Token::Place(
-        &buffer, block_index * kSecureBlockLength + kCipherBlockLength);
+    ciphertexts[block_index] =
+        buffer.data() + block_index * secure_block_length;
+    tokens[block_index] = ciphertexts[block_index] + cipher_block_length;
+  }
 
-    // Encrypt the block.
-    if (!cryptor->EncryptBlock(encrypt_source, token->data(),
-                               ciphertext->data())) {
-      LOG(ERROR) << "Encryption failed, fd = " << fd;
-      return -1;
-    }
+  if (!cryptor->EncryptBlocks(blocks_to_write, encrypt_sources.data(),
+                              tokens.data(), ciphertexts.data())) {
+    LOG(ERROR) << "Encryption failed, fd = " << fd;
+    return -1;
+  }
+
+  std::vector<Tag> tags;
+  tags.reserve(blocks_to_write);
+  for (int64_t block_index = 0; block_index < blocks_to_write; block_index++) {
+    const uint8_t *ciphertext = ciphertexts[block_index];
     VLOG(2) << "Ciphertext generated: "
             << absl::BytesToHexString(absl::string_view(
-                   reinterpret_cast<const char *>(ciphertext->data()),
-                   kBlockLength));
+                   reinterpret_cast<const char *>(ciphertext), block_length));
     VLOG(2) << "Token generated: "
             << absl::BytesToHexString(absl::string_view(
-                   reinterpret_cast<const char *>(token->data()),
+                   reinterpret_cast<const char *>(tokens[block_index]),
                    kTokenLength));
 
-    TagView tag(ciphertext->data() + kBlockLength, kTagLength);
+    TagView tag(ciphertext + block_length, kTagLength);
     tags.push_back(tag);
     VLOG(2) << "Auth tag generated: "
             << absl::BytesToHexString(absl::string_view(
@@ -801,6 +1566,13 @@ ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
     }
   }
 
+  // Record the write in the journal before making it in place.
+  if (!JournalWrite(file_ctrl.get(), *cryptor, start_block_to_write,
+                    blocks_to_write, buffer.data())) {
+    LOG(ERROR) << "Failed to journal write to file, path=" << file_ctrl->path;
+    return -1;
+  }
+
   // Note: with block alignment constraint in place, partial block writes are
   // not permissible - complete blocks must be written. Thus, the options are:
   // 1. Allow partial yet block-aligned writes - this would require truncating
@@ -817,10 +1589,10 @@ ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
   }
 
   // Move cursor to the position of the end of the write range.
-  if (last_partial_block_bytes_count > 0) {
+  if ((logical_offset + count) % block_length != 0) {
     off_t new_cur_logical_offset = logical_offset + count;
     off_t new_cur_physical_offset =
-        offset_translator_->LogicalToPhysical(new_cur_logical_offset);
+        offset_translator.LogicalToPhysical(new_cur_logical_offset);
     off_t offset = enc_untrusted_lseek(fd, new_cur_physical_offset, SEEK_SET);
     if (offset == -1) {
       LOG(ERROR)
@@ -844,25 +1616,91 @@ ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
     }
   }
 
-  file_ctrl->logical_size = logical_offset + count;
-
-  if (!UpdateDigest(file_ctrl.get(), *cryptor)) {
-    return -1;
+  // Write through the block cache.
+  {
+    absl::MutexLock cache_lock(&file_ctrl->cache_mu);
+    for (int64_t idx = 0; idx < blocks_to_write; idx++) {
+      file_ctrl->block_cache->Insert(start_block_to_write + idx,
+                                     encrypt_sources[idx]);
+    }
   }
 
+  // Overwriting data within the file does not shrink the file.
+  file_ctrl->logical_size =
+      std::max<size_t>(file_ctrl->logical_size, logical_offset + count);
+  file_ctrl->is_digest_dirty = true;
+
   VLOG(2) << "Wrote data to file, bytes_written = " << bytes_written;
 
   return count;
 }
 
-bool AeadHandler::FinalizeFile(int fd) {
-  absl::MutexLock global_lock(&mu_);
+int AeadHandler::FlushDigest(int fd) {
+  std::shared_ptr<FileControl> file_ctrl;
+  {
+    absl::ReaderMutexLock global_lock(&mu_);
+
+    auto entry = fmap_.find(fd);
+    if (entry == fmap_.end()) {
+      LOG(ERROR) << "Attempt made to flush an unopened file, fd = " << fd;
+      errno = ENOENT;
+      return -1;
+    }
 
+    file_ctrl = entry->second;
+  }
+
+  absl::MutexLock lock(&file_ctrl->mu);
+  if (!file_ctrl->is_digest_dirty) {
+    return 0;
+  }
+
+  const GcmCryptor *cryptor = GetGcmCryptor(*file_ctrl);
+  if (!cryptor) {
+    return -1;
+  }
+
+  // The commit record makes all writes since the last commit durable at once.
+  // The header is only updated in place once the commit is durable, so that a
+  // crash leaves either the previous or the new committed state to recover.
+  FileHeader header;
+  if (!ComputeFileHeader(*file_ctrl, *cryptor, &header) ||
+      !file_ctrl->journal->Append(*cryptor, SecureJournal::RecordType::kCommit,
+                                  file_ctrl->physical_size(), header.data(),
+                                  sizeof(FileHeader)) ||
+      !file_ctrl->journal->Sync() ||
+      !WriteFileHeader(*file_ctrl, header)) {
+    return -1;
+  }
+  file_ctrl->is_digest_dirty = false;
+  file_ctrl->committed_leaf_count = file_ctrl->ad->LeafCount();
+  file_ctrl->undo_journaled_blocks.clear();
+
+  if (!CheckpointJournal(file_ctrl.get(), kJournalCheckpointLength)) {
+    LOG(WARNING) << "Failed to checkpoint journal, path = " << file_ctrl->path;
+  }
+
+  if (!PersistMerkleTreeCache(file_ctrl.get())) {
+    LOG(WARNING) << "Failed to write Merkle tree cache, path = "
+                 << file_ctrl->path;
+  }
+
+  return 0;
+}
+
+bool AeadHandler::FinalizeFile(int fd) {
   if (fd < 0) {
     errno = EINVAL;
     return false;
   }
 
+  // Persist the digest and checkpoint the journal before removing the file
+  // from the maps, so that a concurrent open of the same path neither reads a
+  // stale digest nor replays journal records over the committed file.
+  bool flushed = FlushDigest(fd) == 0;
+
+  absl::MutexLock global_lock(&mu_);
+
   auto entry = fmap_.find(fd);
   if (entry == fmap_.end()) {
     LOG(ERROR) << "Attempt made to finalize uninitialized file, fd = " << fd;
@@ -870,6 +1708,14 @@ bool AeadHandler::FinalizeFile(int fd) {
     return false;
   }
 
+  {
+    absl::MutexLock lock(&entry->second->mu);
+    if (!CheckpointJournal(entry->second.get(), 1)) {
+      LOG(WARNING) << "Failed to checkpoint journal, path = "
+                   << entry->second->path;
+    }
+  }
+
   // Do not need to wait until the file is no longer operated on - shared_ptr
   // taken by the operator will keep file_ctrl alive and allow it to take and
   // release the lock on its own schedule. Removal from the maps here will not
@@ -877,10 +1723,15 @@ bool AeadHandler::FinalizeFile(int fd) {
 
   VLOG(2) << "Finalizing secure file, fd = " << fd
           << ", pathname = " << entry->second->path;
+  {
+    absl::MutexLock cache_lock(&entry->second->cache_mu);
+    entry->second->readahead.erase(fd);
+  }
   opened_files_.erase(entry->second->path);
   fmap_.erase(entry);
+  read_only_fds_.erase(fd);
 
-  return true;
+  return flushed;
 }
 
 // Note: questionable whether to allow setting the key only on newly opened
@@ -896,8 +1747,9 @@ int AeadHandler::SetMasterKey(int fd, const uint8_t *key_data,
   }
 
   std::shared_ptr<FileControl> file_ctrl;
+  bool is_read_only;
   {
-    absl::MutexLock global_lock(&mu_);
+    absl::ReaderMutexLock global_lock(&mu_);
 
     auto entry = fmap_.find(fd);
     if (entry == fmap_.end()) {
@@ -907,6 +1759,7 @@ int AeadHandler::SetMasterKey(int fd, const uint8_t *key_data,
     }
 
     file_ctrl = entry->second;
+    is_read_only = read_only_fds_.count(fd) != 0;
   }
 
   absl::MutexLock lock(&file_ctrl->mu);
@@ -923,7 +1776,7 @@ int AeadHandler::SetMasterKey(int fd, const uint8_t *key_data,
 
   file_ctrl->master_key =
       absl::make_unique<GcmCryptorKey>(key_data, key_length);
-  if (!Deserialize(file_ctrl.get())) {
+  if (!Deserialize(file_ctrl.get(), is_read_only)) {
     LOG(ERROR) << "Failed to deserialize integrity metadata for file, path="
                << file_ctrl->path;
     return -1;
@@ -933,20 +1786,90 @@ int AeadHandler::SetMasterKey(int fd, const uint8_t *key_data,
   return 0;
 }
 
-const OffsetTranslator &AeadHandler::GetOffsetTranslator() const {
-  return *offset_translator_;
+int AeadHandler::SetBlockLength(int fd, size_t block_length) {
+  if (!IsBlockLengthValid(block_length)) {
+    LOG(ERROR) << "Attempt made to set an invalid block length: "
+               << block_length;
+    errno = EINVAL;
+    return -1;
+  }
+
+  std::shared_ptr<FileControl> file_ctrl;
+  {
+    absl::ReaderMutexLock global_lock(&mu_);
+
+    auto entry = fmap_.find(fd);
+    if (entry == fmap_.end()) {
+      LOG(ERROR) << "Attempt made to set block length on an unopened file, fd="
+                 << fd;
+      errno = ENOENT;
+      return -1;
+    }
+
+    file_ctrl = entry->second;
+  }
+
+  absl::MutexLock lock(&file_ctrl->mu);
+
+  // The block length cannot change once the file layout is established. For an
+  // existing file that is not deserialized yet, the block length recorded in
+  // the file replaces the one set here on deserialization.
+  if (file_ctrl->is_deserialized) {
+    if (file_ctrl->block_length != block_length) {
+      LOG(ERROR) << "Attempt made to change the block length of an opened "
+                    "file, fd = "
+                 << fd;
+      errno = EINVAL;
+      return -1;
+    }
+
+    return 0;
+  }
+
+  file_ctrl->SetBlockLength(block_length);
+  return 0;
+}
+
+std::shared_ptr<const OffsetTranslator> AeadHandler::GetOffsetTranslator(
+    int fd) {
+  std::shared_ptr<FileControl> file_ctrl;
+  {
+    absl::ReaderMutexLock global_lock(&mu_);
+
+    auto entry = fmap_.find(fd);
+    if (entry == fmap_.end()) {
+      LOG(ERROR) << "Attempt made to get offset translator on an unopened "
+                    "file, fd = "
+                 << fd;
+      errno = ENOENT;
+      return nullptr;
+    }
+
+    file_ctrl = entry->second;
+  }
+
+  absl::ReaderMutexLock lock(&file_ctrl->mu);
+  return file_ctrl->offset_translator;
 }
 
 off_t AeadHandler::GetLogicalFileSize(int fd) {
-  absl::MutexLock global_lock(&mu_);
-  auto entry = fmap_.find(fd);
-  if (entry == fmap_.end()) {
-    LOG(ERROR)
-        << "Attempt made to get logical file size on an unopened file, fd = "
-        << fd;
-    return -1;
+  std::shared_ptr<FileControl> file_ctrl;
+  {
+    absl::ReaderMutexLock global_lock(&mu_);
+
+    auto entry = fmap_.find(fd);
+    if (entry == fmap_.end()) {
+      LOG(ERROR)
+          << "Attempt made to get logical file size on an unopened file, fd = "
+          << fd;
+      return -1;
+    }
+
+    file_ctrl = entry->second;
   }
-  return entry->second->logical_size;
+
+  absl::ReaderMutexLock lock(&file_ctrl->mu);
+  return file_ctrl->logical_size;
 }
 
 }  // namespace storage
@@ -24,13 +24,18 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "absl/base/attributes.h"
+#include "absl/memory/memory.h"
 #include "absl/synchronization/mutex.h"
 #include "asylo/crypto/util/bytes.h"
 #include "asylo/platform/crypto/gcmlib/gcm_cryptor.h"
 #include "asylo/platform/storage/secure/authenticated_dictionary.h"
-#include "asylo/platform/storage/secure/ctmmt_authenticated_dictionary.h"
+#include "asylo/platform/storage/secure/block_cache.h"
+#include "asylo/platform/storage/secure/flat_authenticated_dictionary.h"
+#include "asylo/platform/storage/secure/secure_journal.h"
 #include "asylo/platform/storage/utils/offset_translator.h"
 
 namespace asylo {
@@ -43,9 +48,14 @@ using crypto::gcmlib::kKeyLength;
 using crypto::gcmlib::kTagLength;
 using crypto::gcmlib::kTokenLength;
 
-// Length of file blocks to encrypt/decrypt.
-constexpr size_t kBlockLength = 128;
-using Block = UnsafeBytes<kBlockLength>;
+// Default length of file blocks to encrypt/decrypt. Files created before the
+// block length became configurable use this length.
+constexpr size_t kDefaultBlockLength = 128;
+
+// Bounds on the length of file blocks, which is chosen per file when the file
+// is created. The block length must be a power of two within these bounds.
+constexpr size_t kMinBlockLength = kDefaultBlockLength;
+constexpr size_t kMaxBlockLength = 64 * 1024;
 
 // Length of the file digest (of the AD root).
 constexpr int64_t kRootHashLength = 32;
@@ -53,11 +63,14 @@ constexpr int64_t kRootHashLength = 32;
 // Length of the hash of the file digest (of the AD root).
 constexpr int64_t kFileHashLength = 16;
 
-// Constants for the secure block structure - the secure block consists of
-// the ciphertext of the same length as the original plaintext, followed by the
-// integrity tag, followed by the encryption token.
-constexpr size_t kCipherBlockLength = kBlockLength + kTagLength;
-constexpr size_t kSecureBlockLength = kCipherBlockLength + kTokenLength;
+// Length of the metadata of the secure block structure - the secure block
+// consists of the ciphertext of the same length as the original plaintext,
+// followed by the integrity tag, followed by the encryption token.
+constexpr size_t kBlockMetadataLength = kTagLength + kTokenLength;
+
+// Budget of enclave memory for the cache of verified plaintext blocks of each
+// opened file.
+constexpr size_t kBlockCacheLength = 256 * 1024;
 
 using FileHash = UnsafeBytes<kFileHashLength>;
 using FileDigest = UnsafeBytes<kRootHashLength>;
@@ -72,17 +85,25 @@ using FileDigest = UnsafeBytes<kRootHashLength>;
 //
 class AeadHandler {
  public:
+  // Suffix appended to the path of a secure file to form the path of its Merkle
+  // tree cache.
+  static constexpr char kMerkleTreeCacheSuffix[] = ".mtc";
+
   static AeadHandler &GetInstance() {
     static AeadHandler *instance = new AeadHandler;
     return *instance;
   }
 
   // Loads integrity metadata, initializes integrity assurance for a newly
-  // opened file, returns false on failure. Does not modify the state of the
+  // opened file, returns false on failure. Metadata is loaded once the master
+  // key of the file is set, after bringing the file back to its last committed
+  // state from its journal. Does not modify the state of the
   // file descriptor. By contract, absolute (canonical) |path_name| is expected.
   // The function performs a weak validation that the path is canonical.
-  bool InitializeFile(int fd, const char *path_name, bool is_new_file)
-      ABSL_LOCKS_EXCLUDED(mu_);
+  // |is_read_only| is set for descriptors opened with O_RDONLY, which never
+  // write the Merkle tree cache of the file.
+  bool InitializeFile(int fd, const char *path_name, bool is_new_file,
+                      bool is_read_only) ABSL_LOCKS_EXCLUDED(mu_);
 
   // Decrypts read data in-place, verifies data has not been tampered with,
   // returns the size of data verified, or -1 on failure.
@@ -94,6 +115,12 @@ class AeadHandler {
   ssize_t EncryptAndPersist(int fd, const void *buf, size_t count)
       ABSL_LOCKS_EXCLUDED(mu_);
 
+  // Commits the writes to an opened file since the last commit, if any: makes
+  // them durable with a single fsync of the journal of the file, then updates
+  // the integrity metadata of the file in place. Returns 0 on success, or -1
+  // on failure.
+  int FlushDigest(int fd) ABSL_LOCKS_EXCLUDED(mu_);
+
   // Frees resources used to assure integrity of an opened file, persists
   // integrity metadata to a designated location on disk, returns false on
   // failure. Does not modify the state of the file descriptor.
@@ -103,10 +130,18 @@ class AeadHandler {
   int SetMasterKey(int fd, const uint8_t *key_data, uint32_t key_length)
       ABSL_LOCKS_EXCLUDED(mu_);
 
+  // Sets the block length for a newly created file, returns -1 on failure. Must
+  // be called before the master key is set. The block length of an existing
+  // file is recorded in the file and takes precedence.
+  int SetBlockLength(int fd, size_t block_length) ABSL_LOCKS_EXCLUDED(mu_);
+
   // Returns the logical file size, or -1 on failure.
   off_t GetLogicalFileSize(int fd) ABSL_LOCKS_EXCLUDED(mu_);
 
-  const OffsetTranslator &GetOffsetTranslator() const;
+  // Returns the offset translator for the block layout of an opened file, or
+  // nullptr on failure.
+  std::shared_ptr<const OffsetTranslator> GetOffsetTranslator(int fd)
+      ABSL_LOCKS_EXCLUDED(mu_);
 
  private:
   // Structure represents the file header layout.
@@ -114,9 +149,12 @@ class AeadHandler {
     // Hash of the DataDigest.
     FileHash file_hash;
 
-    // Logical file size - is incorporated into DataDigest and is protected by
-    // FileHash.
-    size_t file_size;
+    // Logical file size in the low 56 bits, and the block length in the most
+    // significant byte, encoded as log2(block_length / kDefaultBlockLength) -
+    // so that files with the default block length have the same header as
+    // files created before the block length became configurable. Is
+    // incorporated into DataDigest and is protected by FileHash.
+    uint64_t file_size;
 
     // Returns the address of the FileHeader instance.
     uint8_t *data() { return file_hash.data(); }
@@ -128,80 +166,238 @@ class AeadHandler {
     // AD digest of the file data.
     FileDigest file_digest;
 
-    // Logical file size.
-    size_t file_size;
+    // Logical file size, encoded as in FileHeader.
+    uint64_t file_size;
 
     // Returns the address of the DataDigest instance.
     uint8_t *data() { return file_digest.data(); }
   } ABSL_ATTRIBUTE_PACKED;
 
+  // Structure represents the header of the Merkle tree cache of a file, which
+  // is followed by the roots of the subtrees of the AD at |subtree_level|. The
+  // cache is stored next to the file, and is not trusted - the AD restored
+  // from it is verified against the file hash, like an AD rebuilt from the
+  // block tags.
+  struct MerkleTreeCacheHeader {
+    // Encoded file size, as in the FileHeader the cache was written with.
+    uint64_t file_size;
+
+    // Level of the subtree roots in the AD.
+    uint32_t subtree_level;
+  } ABSL_ATTRIBUTE_PACKED;
+
+  // Sequential access state of a file descriptor, used to read ahead of
+  // sequential reads through the descriptor.
+  struct ReadaheadState {
+    // Logical offset right after the last read through the descriptor.
+    off_t next_offset = 0;
+    // Number of blocks to read ahead on the next read ahead, or 0 if the
+    // descriptor is not read sequentially.
+    size_t window = 0;
+    // Index of the block whose read triggers the next read ahead, which is the
+    // first block of the last read ahead, so that the blocks after it are read
+    // before they are needed.
+    int64_t trigger_block = 0;
+  };
+
   // File (data set) control structure for an opened file.
   struct FileControl {
     const std::string path;
     size_t logical_size;
     bool is_new;
     bool is_deserialized;
-    std::unique_ptr<AuthenticatedDictionary> ad;
+    // Whether the root of |ad| has changed since the digest was last written.
+    // The digest is persisted lazily, on fsync and on close, so that a
+    // sequence of writes recomputes the root only once.
+    bool is_digest_dirty;
+    // Authenticated dictionary of the block tags. It may be restored from the
+    // Merkle tree cache of the file, in which case the tags are loaded from the
+    // file on first access to the blocks.
+    std::unique_ptr<FlatAuthenticatedDictionary> ad;
     std::string zero_hash;
     std::unique_ptr<GcmCryptorKey> master_key;
-
-    // Mutex for protecting FileControl instance.
+    size_t block_length;
+    std::shared_ptr<const OffsetTranslator> offset_translator;
+    std::unique_ptr<BlockCache> block_cache;
+    // Read-ahead state of each file descriptor of the file, protected by
+    // |cache_mu|.
+    std::unordered_map<int, ReadaheadState> readahead;
+    // Write-ahead journal of the file. Writes are recorded in the journal as
+    // they are made, and become durable together when they are committed.
+    std::unique_ptr<SecureJournal> journal;
+    // Number of blocks of the file as of the last commit, and the blocks among
+    // them whose committed contents were recorded in the journal since.
+    size_t committed_leaf_count;
+    std::unordered_set<int64_t> undo_journaled_blocks;
+
+    // Mutex for protecting FileControl instance. Reads of the file hold it in
+    // shared mode, so that readers of the same file run in parallel, and all
+    // other operations hold it exclusively.
     absl::Mutex mu;
 
+    // Mutex for protecting |block_cache| and the loading of tags into |ad|,
+    // both of which are modified by readers holding |mu| in shared mode.
+    // Acquired after |mu|, and never held while waiting on the host or
+    // decrypting.
+    mutable absl::Mutex cache_mu;
+
     FileControl(const char *path_name, bool is_new_file)
         : path(path_name),
           logical_size(0),
           is_new(is_new_file),
           is_deserialized(false),
-          ad(absl::make_unique<CTMMTAuthenticatedDictionary>()) {
+          is_digest_dirty(false),
+          ad(absl::make_unique<FlatAuthenticatedDictionary>()),
+          journal(absl::make_unique<SecureJournal>(path +
+                                                   SecureJournal::kPathSuffix)),
+          committed_leaf_count(0) {
       UnsafeBytes<kTagLength> tag;
       memset(tag.data(), 0, kTagLength);
       std::string tag_string(reinterpret_cast<char *>(tag.data()), kTagLength);
       zero_hash = ad->LeafHash(tag_string);
+      SetBlockLength(kDefaultBlockLength);
+    }
+
+    // Sets the block length, the offset translator for the block layout and
+    // the block cache.
+    void SetBlockLength(size_t length) {
+      block_length = length;
+      offset_translator = OffsetTranslator::Create(
+          sizeof(FileHeader), block_length, secure_block_length());
+      block_cache = absl::make_unique<BlockCache>(
+          kBlockCacheLength / block_length, block_length);
+    }
+
+    // Returns the length of the ciphertext followed by the integrity tag.
+    size_t cipher_block_length() const { return block_length + kTagLength; }
+
+    // Returns the length of the full secure block.
+    size_t secure_block_length() const {
+      return block_length + kBlockMetadataLength;
     }
 
     // NOTE: The physical_size is on block granularity because the block
     // metadata is placed after the block data, hence, only full blocks are
     // written - there are no partial blocks.
     size_t physical_size() {
-      return sizeof(FileHeader) + ad->LeafCount() * kSecureBlockLength;
+      return sizeof(FileHeader) + ad->LeafCount() * secure_block_length();
     }
   };
 
-  AeadHandler();
+  AeadHandler() = default;
   AeadHandler(AeadHandler const &) = delete;
   void operator=(AeadHandler const &) = delete;
 
-  // Loads and validates integrity metadata, returns false on failure.
-  bool Deserialize(FileControl *file_ctrl)
+  // Loads and validates integrity metadata, returns false on failure. Writes
+  // the Merkle tree cache of the file if it had to be rebuilt, unless
+  // |is_read_only| is set.
+  bool Deserialize(FileControl *file_ctrl, bool is_read_only)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(file_ctrl->mu);
 
   // Retrieves logical cursor offset associated with a file descriptor |fd|.
   // Returns false on failure.
-  bool RetrieveLogicalOffset(int fd, off_t *logical_offset) const;
+  bool RetrieveLogicalOffset(int fd, const FileControl &file_ctrl,
+                             off_t *logical_offset) const
+      ABSL_SHARED_LOCKS_REQUIRED(file_ctrl.mu);
 
   // Updates digest of the file data in the secure file header.
   bool UpdateDigest(FileControl *file_ctrl, const GcmCryptor &cryptor) const
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(file_ctrl->mu);
 
+  // Computes the secure file header for the current AD root and logical size
+  // of a file. Returns false on failure.
+  bool ComputeFileHeader(const FileControl &file_ctrl,
+                         const GcmCryptor &cryptor, FileHeader *header) const
+      ABSL_SHARED_LOCKS_REQUIRED(file_ctrl.mu);
+
+  // Writes |header| as the secure file header of a file. Returns false on
+  // failure.
+  bool WriteFileHeader(const FileControl &file_ctrl,
+                       const FileHeader &header) const
+      ABSL_SHARED_LOCKS_REQUIRED(file_ctrl.mu);
+
+  // Brings a file back to its last committed state from its journal: replays
+  // the records up to the last commit, then rolls back the blocks overwritten
+  // after it, and empties the journal. Returns false on failure.
+  bool RecoverFromJournal(FileControl *file_ctrl,
+                          const GcmCryptor &cryptor) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(file_ctrl->mu);
+
+  // Records in the journal of a file |blocks_count| sealed blocks about to be
+  // written at |first_block_index|. Makes the committed contents of the blocks
+  // to be overwritten for the first time since the last commit durable in the
+  // journal first, so that they can be restored if the file is not committed.
+  // Returns false on failure.
+  bool JournalWrite(FileControl *file_ctrl, const GcmCryptor &cryptor,
+                    int64_t first_block_index, int64_t blocks_count,
+                    const uint8_t *blocks) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(file_ctrl->mu);
+
+  // Makes the file durable and empties its journal, if the journal holds at
+  // least |min_length| bytes. Returns false on failure.
+  bool CheckpointJournal(FileControl *file_ctrl, size_t min_length) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(file_ctrl->mu);
+
+  // Returns true if the current root of the AD of a file and the file size in
+  // |file_header| match the file hash in |file_header|.
+  bool IsDigestValid(FileControl *file_ctrl, const GcmCryptor &cryptor,
+                     const FileHeader &file_header) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(file_ctrl->mu);
+
+  // Restores the AD of a file of |leaf_count| blocks from the Merkle tree
+  // cache of the file, if the cache exists and was written for the encoded
+  // file size |file_size|. The restored AD is not yet verified against the
+  // file hash. Returns false if the AD was not restored.
+  bool LoadMerkleTreeCache(FileControl *file_ctrl, uint64_t file_size,
+                           size_t leaf_count) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(file_ctrl->mu);
+
+  // Writes the Merkle tree cache of a file, so that the AD can be restored
+  // without reading all block tags when the file is next opened. Does nothing
+  // for files too small to benefit from the cache. Returns false on failure.
+  bool PersistMerkleTreeCache(FileControl *file_ctrl) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(file_ctrl->mu);
+
+  // Loads the tags of blocks |first_leaf| through |last_leaf| of a file into
+  // the AD, if the AD was restored without them. Indexing starts from 1, as in
+  // the AD. The tags are read from the host without holding |cache_mu|, which
+  // is only taken to verify and insert them. Returns false if the tags cannot
+  // be read or fail verification.
+  bool LoadLeaves(const FileControl &file_ctrl, size_t first_leaf,
+                  size_t last_leaf) const
+      ABSL_SHARED_LOCKS_REQUIRED(file_ctrl.mu)
+          ABSL_LOCKS_EXCLUDED(file_ctrl.cache_mu);
+
   // Returns an instance of GcmCryptor associated with a file, or nullptr if was
   // not able to retrieve. The caller does not own the instance.
   GcmCryptor *GetGcmCryptor(const FileControl &file_ctrl) const
-      ABSL_EXCLUSIVE_LOCKS_REQUIRED(file_ctrl.mu);
+      ABSL_SHARED_LOCKS_REQUIRED(file_ctrl.mu);
 
   // Similar to DecryptAndVerify, but is called by internal implementation, and
-  // as such does not take a file lock. The cursor associated with the file
-  // descriptor |fd| is expected to be at the position of |logical_offset|.
+  // as such does not take the file lock |mu|. The cursor associated with the
+  // file descriptor |fd| is expected to be at the position of |logical_offset|.
   ssize_t DecryptAndVerifyInternal(int fd, void *buf, size_t count,
                                    const FileControl &file_ctrl,
                                    off_t logical_offset) const
-      ABSL_EXCLUSIVE_LOCKS_REQUIRED(file_ctrl.mu);
-
-  // Reads a single full block of a file at a specified logical offset. Returns
-  // false on failure.
+      ABSL_SHARED_LOCKS_REQUIRED(file_ctrl.mu);
+
+  // Reads, verifies and decrypts into the block cache the blocks holding
+  // |count| bytes at |logical_offset| of a file, and up to |window| blocks
+  // after them, without moving the cursor of |fd|. Does nothing if the
+  // requested blocks are cached and end before |trigger_block|, which is
+  // otherwise updated to the first block read ahead. Stops at the first block
+  // that fails verification, leaving the error to be reported by the read of
+  // the block. Returns true if blocks were read from the host.
+  bool ReadAhead(int fd, const FileControl &file_ctrl, off_t logical_offset,
+                 size_t count, size_t window, int64_t *trigger_block) const
+      ABSL_SHARED_LOCKS_REQUIRED(file_ctrl.mu)
+          ABSL_LOCKS_EXCLUDED(file_ctrl.cache_mu);
+
+  // Reads a single full block of a file at a specified logical offset into
+  // |block|, which is resized to the block length. Returns false on failure.
   bool ReadFullBlock(const FileControl &file_ctrl, off_t logical_offset,
-                     Block *block) const
-      ABSL_EXCLUSIVE_LOCKS_REQUIRED(file_ctrl.mu);
+                     std::vector<uint8_t> *block) const
+      ABSL_SHARED_LOCKS_REQUIRED(file_ctrl.mu);
 
   // Map of file (data set) controls for opened files keyed on int identity of
   // files. Avoid using absl based containers which may perform system calls, as
@@ -217,8 +413,8 @@ class AeadHandler {
   std::unordered_map<std::string, std::shared_ptr<FileControl>> opened_files_
       ABSL_GUARDED_BY(mu_);
 
-  // An instance that performs operations on untrusted file offset.
-  std::unique_ptr<OffsetTranslator> offset_translator_;
+  // File descriptors of |fmap_| opened with O_RDONLY.
+  std::unordered_set<int> read_only_fds_ ABSL_GUARDED_BY(mu_);
 
   // Mutex for protecting map members of the class.
   absl::Mutex mu_;
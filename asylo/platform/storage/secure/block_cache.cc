@@ -0,0 +1,68 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/storage/secure/block_cache.h"
+
+#include <algorithm>
+
+namespace asylo {
+namespace platform {
+namespace storage {
+
+const uint8_t *BlockCache::Lookup(int64_t index) {
+  auto it = index_.find(index);
+  if (it == index_.end()) {
+    return nullptr;
+  }
+  entries_.splice(entries_.begin(), entries_, it->second);
+  return it->second->data.data();
+}
+
+void BlockCache::Insert(int64_t index, const uint8_t *data) {
+  if (capacity_ == 0) {
+    return;
+  }
+
+  auto it = index_.find(index);
+  if (it != index_.end()) {
+    entries_.splice(entries_.begin(), entries_, it->second);
+  } else if (index_.size() < capacity_) {
+    entries_.emplace_front();
+    entries_.front().data.resize(block_length_);
+    index_.emplace(index, entries_.begin());
+  } else {
+    // Reuse the least recently used entry for the new block.
+    auto last = std::prev(entries_.end());
+    index_.erase(last->index);
+    entries_.splice(entries_.begin(), entries_, last);
+    index_.emplace(index, entries_.begin());
+  }
+
+  Entry &entry = entries_.front();
+  entry.index = index;
+  std::copy_n(data, block_length_, entry.data.begin());
+}
+
+void BlockCache::Clear() {
+  index_.clear();
+  entries_.clear();
+}
+
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
@@ -0,0 +1,97 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_STORAGE_SECURE_BLOCK_CACHE_H_
+#define ASYLO_PLATFORM_STORAGE_SECURE_BLOCK_CACHE_H_
+
+#include <stdint.h>
+
+#include <list>
+#include <unordered_map>
+
+#include "asylo/util/cleansing_types.h"
+
+namespace asylo {
+namespace platform {
+namespace storage {
+
+// Bounded cache of the verified plaintext of blocks of a secure file, keyed on
+// the block index. Lets repeated reads of a block skip reading, verifying and
+// decrypting it again. Evicts the least recently used block when full. Cached
+// plaintext is cleansed when it is evicted or when the cache is destroyed.
+//
+// The cache holds plaintext as last read or written through the enclave - it
+// is the responsibility of the owner to update cached blocks on writes. This
+// class is not thread-safe.
+class BlockCache {
+ public:
+  // Creates a cache of up to |capacity| blocks of |block_length| bytes. A cache
+  // with a capacity of 0 holds no blocks.
+  BlockCache(size_t capacity, size_t block_length)
+      : capacity_(capacity), block_length_(block_length) {}
+
+  BlockCache(const BlockCache &) = delete;
+  BlockCache &operator=(const BlockCache &) = delete;
+
+  // Returns the cached plaintext of the block at |index| and marks the block as
+  // most recently used, or returns nullptr if the block is not cached. The
+  // returned pointer is valid until the next call to Insert() or Clear().
+  const uint8_t *Lookup(int64_t index);
+
+  // Returns true if the block at |index| is cached, without marking it as
+  // used.
+  bool Contains(int64_t index) const { return index_.count(index) > 0; }
+
+  // Caches |block_length| bytes of plaintext from |data| as the content of the
+  // block at |index|, replacing the content cached for the block, if any.
+  void Insert(int64_t index, const uint8_t *data);
+
+  // Removes all blocks from the cache.
+  void Clear();
+
+  // Returns the number of cached blocks.
+  size_t size() const { return index_.size(); }
+
+  // Returns the maximum number of cached blocks.
+  size_t capacity() const { return capacity_; }
+
+ private:
+  struct Entry {
+    int64_t index;
+    CleansingVector<uint8_t> data;
+  };
+
+  // Maximum number of cached blocks.
+  const size_t capacity_;
+
+  // Length of the cached blocks.
+  const size_t block_length_;
+
+  // Cached blocks in the order of their use, most recently used first.
+  std::list<Entry> entries_;
+
+  // Cached blocks keyed on the block index. Avoid using absl based containers,
+  // which may perform system calls.
+  std::unordered_map<int64_t, std::list<Entry>::iterator> index_;
+};
+
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_STORAGE_SECURE_BLOCK_CACHE_H_
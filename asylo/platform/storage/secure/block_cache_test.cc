@@ -0,0 +1,96 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/storage/secure/block_cache.h"
+
+#include <cstring>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace asylo {
+namespace platform {
+namespace storage {
+namespace {
+
+constexpr size_t kBlockLength = 16;
+
+std::vector<uint8_t> Block(uint8_t value) {
+  return std::vector<uint8_t>(kBlockLength, value);
+}
+
+bool HasContent(BlockCache *cache, int64_t index, uint8_t value) {
+  const uint8_t *data = cache->Lookup(index);
+  return data && memcmp(data, Block(value).data(), kBlockLength) == 0;
+}
+
+TEST(BlockCacheTest, LookupInsertedBlocks) {
+  BlockCache cache(4, kBlockLength);
+  EXPECT_EQ(cache.Lookup(0), nullptr);
+  cache.Insert(0, Block(1).data());
+  cache.Insert(7, Block(2).data());
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_TRUE(HasContent(&cache, 0, 1));
+  EXPECT_TRUE(HasContent(&cache, 7, 2));
+  EXPECT_EQ(cache.Lookup(1), nullptr);
+
+  cache.Insert(0, Block(3).data());
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_TRUE(HasContent(&cache, 0, 3));
+}
+
+TEST(BlockCacheTest, EvictsLeastRecentlyUsed) {
+  BlockCache cache(3, kBlockLength);
+  for (int64_t index = 0; index < 3; index++) {
+    cache.Insert(index, Block(index).data());
+  }
+
+  // Block 0 is used again, so block 1 is evicted first.
+  EXPECT_NE(cache.Lookup(0), nullptr);
+  cache.Insert(3, Block(3).data());
+  EXPECT_EQ(cache.size(), 3);
+  EXPECT_FALSE(cache.Contains(1));
+  cache.Insert(4, Block(4).data());
+  EXPECT_FALSE(cache.Contains(2));
+  EXPECT_TRUE(HasContent(&cache, 0, 0));
+  EXPECT_TRUE(HasContent(&cache, 3, 3));
+  EXPECT_TRUE(HasContent(&cache, 4, 4));
+}
+
+TEST(BlockCacheTest, ZeroCapacityCachesNothing) {
+  BlockCache cache(0, kBlockLength);
+  cache.Insert(0, Block(1).data());
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_EQ(cache.Lookup(0), nullptr);
+}
+
+TEST(BlockCacheTest, Clear) {
+  BlockCache cache(2, kBlockLength);
+  cache.Insert(0, Block(1).data());
+  cache.Insert(1, Block(2).data());
+  cache.Clear();
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_FALSE(cache.Contains(0));
+  cache.Insert(1, Block(3).data());
+  EXPECT_TRUE(HasContent(&cache, 1, 3));
+}
+
+}  // namespace
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
@@ -25,15 +25,28 @@
 #include <fcntl.h>
 #include <stdarg.h>
 
+#include <cerrno>
+#include <memory>
+#include <string>
+
 #include "asylo/util/logging.h"
+#include "asylo/platform/common/enclave_trace.h"
 #include "asylo/platform/host_call/trusted/host_calls.h"
 #include "asylo/platform/storage/secure/aead_handler.h"
+#include "asylo/platform/storage/secure/secure_journal.h"
 #include "asylo/platform/storage/utils/fd_closer.h"
 #include "asylo/platform/storage/utils/offset_translator.h"
 
 namespace asylo {
 namespace platform {
 namespace storage {
+namespace {
+
+// Suffixes of the paths of the files kept next to a secure file.
+const char *const kSideFileSuffixes[] = {AeadHandler::kMerkleTreeCacheSuffix,
+                                         SecureJournal::kPathSuffix};
+
+}  // namespace
 
 int secure_open(const char *pathname, int flags, ...) {
   if ((flags & O_APPEND) || (flags & O_TRUNC)) {
@@ -59,15 +72,18 @@ int secure_open(const char *pathname, int flags, ...) {
 
   FdCloser fd_closer(fd, &enc_untrusted_close);
 
+  const bool is_read_only = (flags & O_ACCMODE) == O_RDONLY;
+  if (!AeadHandler::GetInstance().InitializeFile(fd, pathname, is_new_file,
+                                                 is_read_only)) {
+    LOG(ERROR) << "Failed to initialize secure handling of file: " << pathname;
+    return -1;
+  }
+
   // Set cursor to the logical offset of 0.
   if (secure_lseek(fd, 0, SEEK_SET) == -1) {
     LOG(ERROR) << "Failed to initialize cursor to the logical offset of 0, fd="
                << fd;
-    return -1;
-  }
-
-  if (!AeadHandler::GetInstance().InitializeFile(fd, pathname, is_new_file)) {
-    LOG(ERROR) << "Failed to initialize secure handling of file: " << pathname;
+    AeadHandler::GetInstance().FinalizeFile(fd);
     return -1;
   }
 
@@ -76,11 +92,18 @@ int secure_open(const char *pathname, int flags, ...) {
 }
 
 ssize_t secure_read(int fd, void *buf, size_t count) {
-  return AeadHandler::GetInstance().DecryptAndVerify(fd, buf, count);
+  TraceEnclaveEvent(EnclaveTraceEvent::kAeadDecryptBegin, fd, count);
+  ssize_t result = AeadHandler::GetInstance().DecryptAndVerify(fd, buf, count);
+  TraceEnclaveEvent(EnclaveTraceEvent::kAeadDecryptEnd, fd, result);
+  return result;
 }
 
 ssize_t secure_write(int fd, const void *buf, size_t count) {
-  return AeadHandler::GetInstance().EncryptAndPersist(fd, buf, count);
+  TraceEnclaveEvent(EnclaveTraceEvent::kAeadEncryptBegin, fd, count);
+  ssize_t result =
+      AeadHandler::GetInstance().EncryptAndPersist(fd, buf, count);
+  TraceEnclaveEvent(EnclaveTraceEvent::kAeadEncryptEnd, fd, result);
+  return result;
 }
 
 int secure_close(int fd) {
@@ -88,13 +111,22 @@ int secure_close(int fd) {
   return (finalize_result && enc_untrusted_close(fd) == 0) ? 0 : -1;
 }
 
+int secure_fsync(int fd) {
+  // Committing through the journal makes the writes durable, so the file
+  // itself need not be synced.
+  return AeadHandler::GetInstance().FlushDigest(fd) == 0 ? 0 : -1;
+}
+
 off_t secure_lseek(int fd, off_t offset, int whence) {
   if (offset < 0) {
     return -1;
   }
 
-  const OffsetTranslator &offset_translator =
-      AeadHandler::GetInstance().GetOffsetTranslator();
+  std::shared_ptr<const OffsetTranslator> offset_translator =
+      AeadHandler::GetInstance().GetOffsetTranslator(fd);
+  if (!offset_translator) {
+    return -1;
+  }
 
   // The net logical offset to which lseek has been requested.
   off_t logical_offset;
@@ -109,7 +141,7 @@ off_t secure_lseek(int fd, off_t offset, int whence) {
         return -1;
       }
       off_t logical_cur_offset =
-          offset_translator.PhysicalToLogical(physical_cur_offset);
+          offset_translator->PhysicalToLogical(physical_cur_offset);
       logical_offset = logical_cur_offset + offset;
     } break;
     case SEEK_END: {
@@ -121,14 +153,14 @@ off_t secure_lseek(int fd, off_t offset, int whence) {
   }
 
   // The net physical offset that corresponds to the requested logical offset.
-  off_t physical_offset = offset_translator.LogicalToPhysical(logical_offset);
+  off_t physical_offset = offset_translator->LogicalToPhysical(logical_offset);
   physical_offset = enc_untrusted_lseek(fd, physical_offset, SEEK_SET);
   if (physical_offset == -1) {
     LOG(ERROR) << "enclave_lseek failed, fd = " << fd
                << ", offset = " << offset;
     return -1;
   }
-  return offset_translator.PhysicalToLogical(physical_offset);
+  return offset_translator->PhysicalToLogical(physical_offset);
 }
 
 int secure_fstat(int fd, struct stat *st) {
@@ -140,6 +172,40 @@ int secure_fstat(int fd, struct stat *st) {
   return ret;
 }
 
+int secure_unlink(const char *pathname) {
+  int ret = enc_untrusted_unlink(pathname);
+  if (ret == -1 && errno != ENOENT) {
+    return -1;
+  }
+
+  // Remove the side files of a missing file too, as they can only be stale.
+  int saved_errno = errno;
+  for (const char *suffix : kSideFileSuffixes) {
+    std::string side_path = std::string(pathname) + suffix;
+    enc_untrusted_unlink(side_path.c_str());
+  }
+  errno = saved_errno;
+  return ret;
+}
+
+int secure_rename(const char *oldpath, const char *newpath) {
+  if (enc_untrusted_rename(oldpath, newpath) == -1) {
+    return -1;
+  }
+
+  // Move the side files along. A file without a given side file may replace
+  // one that had it, whose side file must not be left behind.
+  for (const char *suffix : kSideFileSuffixes) {
+    std::string old_side_path = std::string(oldpath) + suffix;
+    std::string new_side_path = std::string(newpath) + suffix;
+    if (enc_untrusted_rename(old_side_path.c_str(), new_side_path.c_str()) ==
+        -1) {
+      enc_untrusted_unlink(new_side_path.c_str());
+    }
+  }
+  return 0;
+}
+
 }  // namespace storage
 }  // namespace platform
 }  // namespace asylo
@@ -45,11 +45,24 @@ ssize_t secure_write(int fd, const void *buf, size_t count);
 
 int secure_close(int fd);
 
+// Commits all writes to the file since the last commit, making them durable
+// together with a single sync of the journal of the file. After a crash, the
+// file is recovered to its last committed state when it is next opened.
+int secure_fsync(int fd);
+
 off_t secure_lseek(int fd, off_t offset, int whence);
 
 // |st->st_size| will be set to logical file size on success.
 int secure_fstat(int fd, struct stat* st);
 
+// Removes a secure file along with its Merkle tree cache and its journal,
+// which plain unlink() leaves behind.
+int secure_unlink(const char *pathname);
+
+// Renames a secure file along with its Merkle tree cache and its journal,
+// which plain rename() leaves behind.
+int secure_rename(const char *oldpath, const char *newpath);
+
 }  // namespace storage
 }  // namespace platform
 }  // namespace asylo
@@ -24,6 +24,10 @@
 #include <fcntl.h>
 #include <openssl/rand.h>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "absl/base/macros.h"
@@ -42,20 +46,31 @@ namespace asylo {
 namespace {
 
 using platform::crypto::gcmlib::kKeyLength;
+using platform::crypto::gcmlib::kTagLength;
 using platform::storage::AeadHandler;
-using platform::storage::kBlockLength;
-using platform::storage::kCipherBlockLength;
+using platform::storage::kBlockMetadataLength;
+using platform::storage::kDefaultBlockLength;
 using platform::storage::kFileHashLength;
 using platform::storage::secure_close;
 using platform::storage::secure_fstat;
 using platform::storage::secure_lseek;
 using platform::storage::secure_open;
 using platform::storage::secure_read;
+using platform::storage::secure_rename;
+using platform::storage::secure_unlink;
 using platform::storage::secure_write;
 using ::testing::Not;
 
 constexpr size_t kMaxTestBufLen = 1000;
 constexpr char kTamperData[] = "Exceedingly rare string";
+constexpr size_t kBlockLength = kDefaultBlockLength;
+constexpr size_t kCipherBlockLength = kBlockLength + kTagLength;
+constexpr size_t kLargeBlockLength = 4096;
+
+// Suffix of the path of the Merkle tree cache of a secure file, and the number
+// of test buffers to write for the cache to hold several subtrees.
+constexpr char kMerkleTreeCacheSuffix[] = ".mtc";
+constexpr int64_t kLargeFileBuffersCount = 3000;
 
 class EnclaveStorageSecureTest : public ::testing::Test,
                                  public ::testing::WithParamInterface<size_t> {
@@ -64,9 +79,11 @@ class EnclaveStorageSecureTest : public ::testing::Test,
   void PrepareTest();
   Status OpenWriteClose(off_t offset);
   Status OpenReadVerifyClose(off_t offset, size_t bytes_expected);
+  Status OpenWriteLargeFileClose();
 
   const int64_t kFileHeaderLength = kFileHashLength + sizeof(size_t);
   const std::string &GetPath() const { return path_; }
+  std::string GetCachePath() const { return path_ + kMerkleTreeCacheSuffix; }
   const void *GetWriteBuffer() const {
     return reinterpret_cast<const void *>(write_buffer_);
   }
@@ -162,6 +179,32 @@ Status EnclaveStorageSecureTest::OpenWriteClose(off_t offset) {
   return Status::OkStatus();
 }
 
+Status EnclaveStorageSecureTest::OpenWriteLargeFileClose() {
+  int fd = secure_open(GetPath().c_str(), O_WRONLY | O_CREAT,
+                       S_IRWXU | S_IRWXG | S_IRWXO);
+  if (fd < 0) {
+    return Status(error::GoogleError::INTERNAL,
+                  absl::StrCat("Secure open path ", GetPath(), " failed."));
+  }
+
+  platform::storage::FdCloser fd_closer(fd, &secure_close);
+
+  if (EmulateSetKeyIoctl(fd) != 0) {
+    return Status(error::GoogleError::INTERNAL, "Set Master Key failed.");
+  }
+
+  for (int64_t i = 0; i < kLargeFileBuffersCount; i++) {
+    if (secure_write(fd, GetWriteBuffer(), test_buf_len_) != test_buf_len_) {
+      return Status(error::GoogleError::INTERNAL, "Secure write failed.");
+    }
+  }
+
+  if (!fd_closer.reset()) {
+    return Status(error::GoogleError::INTERNAL, "Secure close failed.");
+  }
+  return Status::OkStatus();
+}
+
 Status EnclaveStorageSecureTest::OpenReadVerifyClose(off_t offset,
                                                      size_t bytes_expected) {
   // Open for read.
@@ -503,10 +546,299 @@ TEST_P(EnclaveStorageSecureTest, LseekEndSuccess) {
   EXPECT_EQ(secure_close(fd), 0);
 }
 
+TEST_P(EnclaveStorageSecureTest, LargeBlockLengthSuccess) {
+  int fd = secure_open(GetPath().c_str(), O_WRONLY | O_CREAT,
+                       S_IRWXU | S_IRWXG | S_IRWXO);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(AeadHandler::GetInstance().SetBlockLength(fd, kLargeBlockLength),
+            0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+  EXPECT_EQ(secure_write(fd, GetWriteBuffer(), test_buf_len_), test_buf_len_);
+  EXPECT_EQ(secure_close(fd), 0);
+
+  // The whole test buffer fits in a single secure block.
+  fd = enc_untrusted_open(GetPath().c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+  EXPECT_EQ(enc_untrusted_lseek(fd, 0, SEEK_END),
+            kFileHeaderLength + kLargeBlockLength + kBlockMetadataLength);
+  ASSERT_EQ(enc_untrusted_close(fd), 0) << strerror(errno);
+
+  // The block length is recorded in the file. Read and overwrite ranges that
+  // fall within the single block.
+  fd = secure_open(GetPath().c_str(), O_RDWR);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+  EXPECT_EQ(AeadHandler::GetInstance().SetBlockLength(fd, kDefaultBlockLength),
+            -1);
+  off_t offset = test_buf_len_ / 4;
+  size_t count = test_buf_len_ / 2;
+  EXPECT_EQ(secure_lseek(fd, offset, SEEK_SET), offset);
+  EXPECT_EQ(secure_read(fd, GetReadBuffer(), count), count);
+  EXPECT_EQ(memcmp(static_cast<const char *>(GetWriteBuffer()) + offset,
+                   GetReadBuffer(), count),
+            0);
+  EXPECT_EQ(secure_lseek(fd, 0, SEEK_CUR), offset + count);
+  count = test_buf_len_ - offset;
+  EXPECT_EQ(secure_lseek(fd, offset, SEEK_SET), offset);
+  EXPECT_EQ(secure_write(fd, GetZeroBuffer(), count), count);
+  EXPECT_EQ(secure_lseek(fd, 0, SEEK_CUR), test_buf_len_);
+  EXPECT_EQ(secure_close(fd), 0);
+
+  fd = secure_open(GetPath().c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+  EXPECT_EQ(secure_read(fd, GetReadBuffer(), test_buf_len_), test_buf_len_);
+  EXPECT_EQ(memcmp(GetWriteBuffer(), GetReadBuffer(), offset), 0);
+  EXPECT_EQ(memcmp(GetZeroBuffer(), read_buffer_ + offset, count), 0);
+  EXPECT_EQ(secure_close(fd), 0);
+}
+
+TEST_P(EnclaveStorageSecureTest, MerkleTreeCacheSuccess) {
+  ASSERT_THAT(OpenWriteLargeFileClose(), IsOk());
+  EXPECT_EQ(enc_untrusted_access(GetCachePath().c_str(), F_OK), 0);
+
+  // Overwrite data in the middle of the file, with the Merkle tree restored
+  // from the cache.
+  const off_t middle = (kLargeFileBuffersCount / 2) * test_buf_len_;
+  int fd = secure_open(GetPath().c_str(), O_RDWR);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+  EXPECT_EQ(secure_lseek(fd, middle, SEEK_SET), middle);
+  EXPECT_EQ(secure_read(fd, GetReadBuffer(), test_buf_len_), test_buf_len_);
+  EXPECT_EQ(memcmp(GetWriteBuffer(), GetReadBuffer(), test_buf_len_), 0);
+  EXPECT_EQ(secure_lseek(fd, middle, SEEK_SET), middle);
+  EXPECT_EQ(secure_write(fd, GetZeroBuffer(), test_buf_len_), test_buf_len_);
+  EXPECT_EQ(secure_close(fd), 0);
+
+  EXPECT_THAT(OpenReadVerifyClose(0, test_buf_len_), IsOk());
+  EXPECT_THAT(OpenReadVerifyClose(middle + test_buf_len_, test_buf_len_),
+              IsOk());
+  fd = secure_open(GetPath().c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+  EXPECT_EQ(secure_lseek(fd, middle, SEEK_SET), middle);
+  EXPECT_EQ(secure_read(fd, GetReadBuffer(), test_buf_len_), test_buf_len_);
+  EXPECT_EQ(memcmp(GetZeroBuffer(), GetReadBuffer(), test_buf_len_), 0);
+  EXPECT_EQ(secure_close(fd), 0);
+}
+
+TEST_P(EnclaveStorageSecureTest, ConcurrentReadersSuccess) {
+  constexpr int kReaders = 4;
+  ASSERT_THAT(OpenWriteLargeFileClose(), IsOk());
+
+  // Each reader reads the whole file through its own descriptor, with all
+  // descriptors sharing the state of the opened file.
+  std::vector<int> fds;
+  for (int i = 0; i < kReaders; i++) {
+    int fd = secure_open(GetPath().c_str(), O_RDONLY);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+    fds.push_back(fd);
+  }
+
+  std::atomic<int> failures(0);
+  std::vector<std::thread> readers;
+  for (int fd : fds) {
+    readers.emplace_back([this, fd, &failures] {
+      std::vector<char> buffer(test_buf_len_);
+      for (int64_t i = 0; i < kLargeFileBuffersCount; i++) {
+        if (secure_read(fd, buffer.data(), test_buf_len_) != test_buf_len_ ||
+            memcmp(GetWriteBuffer(), buffer.data(), test_buf_len_) != 0) {
+          failures++;
+          return;
+        }
+      }
+    });
+  }
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(failures.load(), 0);
+
+  for (int fd : fds) {
+    EXPECT_EQ(secure_close(fd), 0);
+  }
+}
+
+TEST_P(EnclaveStorageSecureTest, ReadCachedBlocksAfterWriteSuccess) {
+  int fd = secure_open(GetPath().c_str(), O_RDWR | O_CREAT,
+                       S_IRWXU | S_IRWXG | S_IRWXO);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+  EXPECT_EQ(secure_write(fd, GetWriteBuffer(), test_buf_len_), test_buf_len_);
+
+  // Read the data twice, then overwrite a misaligned range within it and read
+  // it again, all with the open file's blocks in the block cache.
+  for (int i = 0; i < 2; i++) {
+    EXPECT_EQ(secure_lseek(fd, 0, SEEK_SET), 0);
+    EXPECT_EQ(secure_read(fd, GetReadBuffer(), test_buf_len_), test_buf_len_);
+    EXPECT_EQ(memcmp(GetWriteBuffer(), GetReadBuffer(), test_buf_len_), 0);
+  }
+  const off_t offset = kBlockLength / 2 + 1;
+  const size_t count = test_buf_len_ / 2 - 1;
+  EXPECT_EQ(secure_lseek(fd, offset, SEEK_SET), offset);
+  EXPECT_EQ(secure_write(fd, GetZeroBuffer(), count), count);
+  EXPECT_EQ(secure_lseek(fd, 0, SEEK_SET), 0);
+  EXPECT_EQ(secure_read(fd, GetReadBuffer(), test_buf_len_), test_buf_len_);
+  EXPECT_EQ(secure_lseek(fd, 0, SEEK_CUR), test_buf_len_);
+  EXPECT_EQ(secure_close(fd), 0);
+
+  std::string expected(static_cast<const char *>(GetWriteBuffer()),
+                       test_buf_len_);
+  expected.replace(offset, count, count, '\0');
+  EXPECT_EQ(std::string(read_buffer_, test_buf_len_), expected);
+
+  // The same data is read back without the block cache.
+  fd = secure_open(GetPath().c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+  EXPECT_EQ(secure_read(fd, GetReadBuffer(), test_buf_len_), test_buf_len_);
+  EXPECT_EQ(secure_close(fd), 0);
+  EXPECT_EQ(std::string(read_buffer_, test_buf_len_), expected);
+}
+
+TEST_P(EnclaveStorageSecureTest, StaleMerkleTreeCacheIgnored) {
+  ASSERT_THAT(OpenWriteLargeFileClose(), IsOk());
+
+  // Save the cache, then modify the file.
+  std::string stale_cache(64 * 1024, '\0');
+  int fd = enc_untrusted_open(GetCachePath().c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+  ssize_t cache_length =
+      enc_untrusted_read(fd, &stale_cache[0], stale_cache.size());
+  ASSERT_GT(cache_length, 0);
+  ASSERT_EQ(enc_untrusted_close(fd), 0) << strerror(errno);
+
+  fd = secure_open(GetPath().c_str(), O_RDWR);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+  EXPECT_EQ(secure_write(fd, GetZeroBuffer(), test_buf_len_), test_buf_len_);
+  EXPECT_EQ(secure_close(fd), 0);
+
+  // Restore the stale cache. The file is still verified, and the cache is
+  // rewritten by the next open for writing.
+  fd = enc_untrusted_open(GetCachePath().c_str(), O_WRONLY | O_TRUNC);
+  ASSERT_GE(fd, 0);
+  EXPECT_EQ(enc_untrusted_write(fd, stale_cache.data(), cache_length),
+            cache_length);
+  ASSERT_EQ(enc_untrusted_close(fd), 0) << strerror(errno);
+  EXPECT_THAT(OpenReadVerifyClose(test_buf_len_, test_buf_len_), IsOk());
+  fd = secure_open(GetPath().c_str(), O_RDWR);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+  EXPECT_EQ(secure_close(fd), 0);
+
+  std::string cache(stale_cache.size(), '\0');
+  fd = enc_untrusted_open(GetCachePath().c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+  EXPECT_EQ(enc_untrusted_read(fd, &cache[0], cache.size()), cache_length);
+  ASSERT_EQ(enc_untrusted_close(fd), 0) << strerror(errno);
+  EXPECT_NE(cache, stale_cache);
+}
+
+TEST_P(EnclaveStorageSecureTest, ReadOnlyOpenLeavesMerkleTreeCacheAlone) {
+  ASSERT_THAT(OpenWriteLargeFileClose(), IsOk());
+  ASSERT_EQ(enc_untrusted_unlink(GetCachePath().c_str()), 0) << strerror(errno);
+
+  EXPECT_THAT(OpenReadVerifyClose(0, test_buf_len_), IsOk());
+  EXPECT_EQ(enc_untrusted_access(GetCachePath().c_str(), F_OK), -1);
+}
+
+TEST_P(EnclaveStorageSecureTest, UnlinkRemovesMerkleTreeCache) {
+  ASSERT_THAT(OpenWriteLargeFileClose(), IsOk());
+  ASSERT_EQ(enc_untrusted_access(GetCachePath().c_str(), F_OK), 0);
+
+  EXPECT_EQ(secure_unlink(GetPath().c_str()), 0) << strerror(errno);
+  EXPECT_EQ(enc_untrusted_access(GetPath().c_str(), F_OK), -1);
+  EXPECT_EQ(enc_untrusted_access(GetCachePath().c_str(), F_OK), -1);
+}
+
+TEST_P(EnclaveStorageSecureTest, RenameMovesMerkleTreeCache) {
+  ASSERT_THAT(OpenWriteLargeFileClose(), IsOk());
+  const std::string new_path = GetPath() + ".renamed";
+  const std::string new_cache_path = new_path + kMerkleTreeCacheSuffix;
+
+  ASSERT_EQ(secure_rename(GetPath().c_str(), new_path.c_str()), 0)
+      << strerror(errno);
+  EXPECT_EQ(enc_untrusted_access(GetCachePath().c_str(), F_OK), -1);
+  EXPECT_EQ(enc_untrusted_access(new_cache_path.c_str(), F_OK), 0);
+
+  // Renaming a file without a cache over one with a cache does not leave the
+  // cache of the replaced file behind.
+  ASSERT_EQ(enc_untrusted_unlink(new_cache_path.c_str()), 0);
+  ASSERT_THAT(OpenWriteLargeFileClose(), IsOk());
+  ASSERT_EQ(secure_rename(new_path.c_str(), GetPath().c_str()), 0)
+      << strerror(errno);
+  EXPECT_EQ(enc_untrusted_access(GetCachePath().c_str(), F_OK), -1);
+  EXPECT_EQ(enc_untrusted_access(new_path.c_str(), F_OK), -1);
+}
+
 //
 // Failure cases.
 //
 
+TEST_P(EnclaveStorageSecureTest, InvalidBlockLengthFailure) {
+  int fd = secure_open(GetPath().c_str(), O_WRONLY | O_CREAT,
+                       S_IRWXU | S_IRWXG | S_IRWXO);
+  ASSERT_GE(fd, 0);
+  EXPECT_EQ(AeadHandler::GetInstance().SetBlockLength(fd, 1000), -1);
+  EXPECT_EQ(errno, EINVAL);
+  EXPECT_EQ(AeadHandler::GetInstance().SetBlockLength(
+                fd, 2 * platform::storage::kMaxBlockLength),
+            -1);
+  EXPECT_EQ(errno, EINVAL);
+  EXPECT_EQ(secure_close(fd), 0);
+}
+
+TEST_P(EnclaveStorageSecureTest, MerkleTreeCacheTagModified) {
+  ASSERT_THAT(OpenWriteLargeFileClose(), IsOk());
+
+  // Modify the tag of a block in the middle of the file. The file still opens,
+  // since the tags are only verified when the blocks are accessed.
+  const off_t middle = (kLargeFileBuffersCount / 2) * test_buf_len_;
+  int fd = enc_untrusted_open(GetPath().c_str(), O_WRONLY);
+  ASSERT_GE(fd, 0);
+  off_t tag_offset = kFileHeaderLength +
+                     (middle / kBlockLength) *
+                         (kBlockLength + kBlockMetadataLength) +
+                     kBlockLength;
+  EXPECT_EQ(enc_untrusted_lseek(fd, tag_offset, SEEK_SET), tag_offset);
+  EXPECT_EQ(enc_untrusted_write(fd, kTamperData, kTagLength), kTagLength);
+  ASSERT_EQ(enc_untrusted_close(fd), 0) << strerror(errno);
+
+  EXPECT_THAT(OpenReadVerifyClose(0, test_buf_len_), IsOk());
+  EXPECT_THAT(OpenReadVerifyClose(middle, test_buf_len_),
+              StatusIs(error::GoogleError::INTERNAL, "Secure read failed."));
+}
+
+TEST_P(EnclaveStorageSecureTest, SequentialReadDataModified) {
+  ASSERT_THAT(OpenWriteLargeFileClose(), IsOk());
+
+  // Modify the data of a block a few blocks into the file, within the range
+  // read ahead of the first reads.
+  constexpr int64_t kModifiedBlock = 20;
+  int fd = enc_untrusted_open(GetPath().c_str(), O_WRONLY);
+  ASSERT_GE(fd, 0);
+  off_t data_offset =
+      kFileHeaderLength + kModifiedBlock * (kBlockLength + kBlockMetadataLength);
+  EXPECT_EQ(enc_untrusted_lseek(fd, data_offset, SEEK_SET), data_offset);
+  EXPECT_GT(enc_untrusted_write(fd, kTamperData, ABSL_ARRAYSIZE(kTamperData)),
+            0);
+  ASSERT_EQ(enc_untrusted_close(fd), 0) << strerror(errno);
+
+  // Reads succeed up to the read of the modified block.
+  fd = secure_open(GetPath().c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+  const int64_t modified_buffer = kModifiedBlock * kBlockLength / test_buf_len_;
+  for (int64_t i = 0; i < modified_buffer; i++) {
+    EXPECT_EQ(secure_read(fd, GetReadBuffer(), test_buf_len_), test_buf_len_);
+    EXPECT_EQ(memcmp(GetWriteBuffer(), GetReadBuffer(), test_buf_len_), 0);
+  }
+  EXPECT_EQ(secure_read(fd, GetReadBuffer(), test_buf_len_), -1);
+  EXPECT_EQ(secure_close(fd), 0);
+}
+
 TEST_P(EnclaveStorageSecureTest, ReadWriteDataModified) {
   EXPECT_THAT(OpenWriteClose(0), IsOk());
   // Modify file data - form of tampering.
@@ -0,0 +1,314 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/storage/secure/flat_authenticated_dictionary.h"
+
+#include <openssl/sha.h>
+
+#include <algorithm>
+#include <numeric>
+
+#include "asylo/crypto/sha256_multi_buffer.h"
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/util/logging.h"
+
+namespace asylo {
+namespace platform {
+namespace storage {
+
+namespace {
+
+// Domain separation prefixes of leaf and inner node hashes, as in RFC 6962.
+constexpr uint8_t kLeafHashPrefix = 0x00;
+constexpr uint8_t kNodeHashPrefix = 0x01;
+
+static_assert(FlatAuthenticatedDictionary::kHashLength == SHA256_DIGEST_LENGTH,
+              "Unexpected SHA-256 digest length.");
+static_assert(FlatAuthenticatedDictionary::kHashLength == kSha256DigestLength,
+              "Unexpected SHA-256 digest length.");
+
+// Writes the RFC 6962 leaf hash of |data| to |out|.
+void HashLeaf(const void *data, size_t size, uint8_t *out) {
+  SHA256_CTX context;
+  SHA256_Init(&context);
+  SHA256_Update(&context, &kLeafHashPrefix, 1);
+  SHA256_Update(&context, data, size);
+  SHA256_Final(out, &context);
+}
+
+// Writes the RFC 6962 hashes of |messages| with domain separation |prefix| to
+// |digests|, hashing several messages at once where the CPU allows it.
+void HashMany(uint8_t prefix, absl::Span<const ByteContainerView> messages,
+              absl::Span<uint8_t *const> digests) {
+  Status status =
+      Sha256MultiBuffer(ByteContainerView(&prefix, 1), messages, digests);
+  CHECK(status.ok()) << status;
+}
+
+// Returns the indices |begin| to |end| - 1.
+std::vector<size_t> IndexRange(size_t begin, size_t end) {
+  std::vector<size_t> indices(end > begin ? end - begin : 0);
+  std::iota(indices.begin(), indices.end(), begin);
+  return indices;
+}
+
+}  // namespace
+
+constexpr size_t FlatAuthenticatedDictionary::kHashLength;
+constexpr size_t FlatAuthenticatedDictionary::kMaxSubtreeLevel;
+
+FlatAuthenticatedDictionary::FlatAuthenticatedDictionary()
+    : levels_(1), subtree_level_(0) {
+  SHA256(nullptr, 0, empty_root_.data());
+}
+
+size_t FlatAuthenticatedDictionary::AddLeaf(const std::string &data) {
+  if (!IsLeafLoaded(levels_[0].size())) {
+    return 0;
+  }
+  Hash hash;
+  HashLeaf(data.data(), data.size(), hash.data());
+  levels_[0].push_back(hash);
+  MarkDirty(levels_[0].size() - 1);
+  return levels_[0].size();
+}
+
+size_t FlatAuthenticatedDictionary::AddLeafHash(const std::string &hash) {
+  if (hash.size() != kHashLength || !IsLeafLoaded(levels_[0].size())) {
+    return 0;
+  }
+  levels_[0].emplace_back();
+  std::copy_n(hash.begin(), kHashLength, levels_[0].back().begin());
+  MarkDirty(levels_[0].size() - 1);
+  return levels_[0].size();
+}
+
+std::string FlatAuthenticatedDictionary::CurrentRoot() {
+  if (levels_[0].empty()) {
+    return std::string(empty_root_.begin(), empty_root_.end());
+  }
+
+  // Rehash the ancestors of the dirty leaves level by level. Sorting the
+  // indices lets each parent be computed once for both of its children.
+  std::vector<size_t> dirty;
+  dirty.swap(dirty_leaves_);
+  for (size_t index : dirty) {
+    is_dirty_[index] = false;
+  }
+  std::sort(dirty.begin(), dirty.end());
+
+  size_t level = 0;
+  while (levels_[level].size() > 1) {
+    if (levels_.size() == level + 1) {
+      levels_.emplace_back();
+    }
+    const std::vector<Hash> &children = levels_[level];
+    std::vector<Hash> &parents = levels_[level + 1];
+    parents.resize((children.size() + 1) / 2);
+
+    size_t parents_count = 0;
+    for (size_t index : dirty) {
+      size_t parent = index / 2;
+      if (parents_count > 0 && dirty[parents_count - 1] == parent) {
+        continue;
+      }
+      // The parent indices are sorted too, and never overtake the child
+      // indices, so they can be collected in place.
+      dirty[parents_count++] = parent;
+    }
+    dirty.resize(parents_count);
+    HashNodes(level, dirty);
+    level++;
+  }
+
+  const Hash &root = levels_[level][0];
+  return std::string(root.begin(), root.end());
+}
+
+std::string FlatAuthenticatedDictionary::LeafHash(size_t leaf) const {
+  if (leaf == 0 || leaf > levels_[0].size() || !IsLeafLoaded(leaf)) {
+    return std::string();
+  }
+  const Hash &hash = levels_[0][leaf - 1];
+  return std::string(hash.begin(), hash.end());
+}
+
+std::string FlatAuthenticatedDictionary::LeafHash(
+    const std::string &data) const {
+  Hash hash;
+  HashLeaf(data.data(), data.size(), hash.data());
+  return std::string(hash.begin(), hash.end());
+}
+
+bool FlatAuthenticatedDictionary::UpdateLeaf(size_t leaf,
+                                             const std::string &data) {
+  if (leaf == 0 || leaf > levels_[0].size() || !IsLeafLoaded(leaf)) {
+    return false;
+  }
+  HashLeaf(data.data(), data.size(), levels_[0][leaf - 1].data());
+  MarkDirty(leaf - 1);
+  return true;
+}
+
+std::string FlatAuthenticatedDictionary::SubtreeRoots(size_t level) {
+  CurrentRoot();
+  if (level >= levels_.size() || levels_[0].empty()) {
+    return std::string();
+  }
+  std::string roots;
+  roots.reserve(levels_[level].size() * kHashLength);
+  for (const Hash &hash : levels_[level]) {
+    roots.append(hash.begin(), hash.end());
+  }
+  return roots;
+}
+
+bool FlatAuthenticatedDictionary::RestoreFromSubtreeRoots(
+    size_t leaf_count, size_t level, const std::string &roots) {
+  if (!levels_[0].empty() || level > kMaxSubtreeLevel) {
+    return false;
+  }
+  if (leaf_count == 0) {
+    return roots.empty();
+  }
+  const size_t subtree_count = ((leaf_count - 1) >> level) + 1;
+  if (roots.size() != subtree_count * kHashLength) {
+    return false;
+  }
+
+  // Size the levels below the subtree roots for the restored leaves. Their
+  // content is only filled in as subtrees are loaded.
+  levels_.resize(level + 1);
+  for (size_t below = 0; below < level; below++) {
+    levels_[below].resize(((leaf_count - 1) >> below) + 1);
+  }
+  levels_[level].resize(subtree_count);
+  for (size_t index = 0; index < subtree_count; index++) {
+    std::copy_n(roots.begin() + index * kHashLength, kHashLength,
+                levels_[level][index].begin());
+  }
+
+  // Compute the levels above the subtree roots.
+  for (size_t above = level; levels_[above].size() > 1; above++) {
+    levels_.emplace_back((levels_[above].size() + 1) / 2);
+    HashNodes(above, IndexRange(0, levels_[above + 1].size()));
+  }
+
+  subtree_level_ = level;
+  if (level > 0) {
+    is_subtree_loaded_.assign(subtree_count, false);
+  }
+  return true;
+}
+
+bool FlatAuthenticatedDictionary::IsLeafLoaded(size_t leaf) const {
+  if (leaf == 0) {
+    return true;
+  }
+  size_t subtree = (leaf - 1) >> subtree_level_;
+  return subtree >= is_subtree_loaded_.size() || is_subtree_loaded_[subtree];
+}
+
+void FlatAuthenticatedDictionary::GetSubtreeLeaves(size_t leaf,
+                                                   size_t *first_leaf,
+                                                   size_t *count) const {
+  size_t subtree = leaf == 0 ? 0 : (leaf - 1) >> subtree_level_;
+  size_t first = subtree << subtree_level_;
+  size_t end =
+      std::min(first + (size_t{1} << subtree_level_), levels_[0].size());
+  *first_leaf = first + 1;
+  *count = end > first ? end - first : 0;
+}
+
+bool FlatAuthenticatedDictionary::LoadSubtree(
+    size_t first_leaf, const std::vector<std::string> &data) {
+  if (first_leaf == 0) {
+    return false;
+  }
+  const size_t subtree = (first_leaf - 1) >> subtree_level_;
+  const size_t first = subtree << subtree_level_;
+  if (first != first_leaf - 1 || subtree >= is_subtree_loaded_.size() ||
+      is_subtree_loaded_[subtree]) {
+    return false;
+  }
+  const size_t end =
+      std::min(first + (size_t{1} << subtree_level_), levels_[0].size());
+  if (data.size() != end - first) {
+    return false;
+  }
+
+  std::vector<ByteContainerView> leaves;
+  std::vector<uint8_t *> leaf_hashes;
+  leaves.reserve(data.size());
+  leaf_hashes.reserve(data.size());
+  for (size_t index = first; index < end; index++) {
+    leaves.emplace_back(data[index - first]);
+    leaf_hashes.push_back(levels_[0][index].data());
+  }
+  HashMany(kLeafHashPrefix, leaves, leaf_hashes);
+
+  // Recompute the subtree, then compare its root with the restored one.
+  const Hash expected_root = levels_[subtree_level_][subtree];
+  for (size_t level = 0; level < subtree_level_; level++) {
+    size_t level_end = ((end - 1) >> level) + 1;
+    HashNodes(level, IndexRange((first >> level) / 2, (level_end + 1) / 2));
+  }
+  if (levels_[subtree_level_][subtree] != expected_root) {
+    levels_[subtree_level_][subtree] = expected_root;
+    return false;
+  }
+
+  is_subtree_loaded_[subtree] = true;
+  return true;
+}
+
+void FlatAuthenticatedDictionary::MarkDirty(size_t index) {
+  if (is_dirty_.size() <= index) {
+    is_dirty_.resize(levels_[0].size());
+  }
+  if (!is_dirty_[index]) {
+    is_dirty_[index] = true;
+    dirty_leaves_.push_back(index);
+  }
+}
+
+void FlatAuthenticatedDictionary::HashNodes(
+    size_t level, absl::Span<const size_t> indices) {
+  static_assert(sizeof(Hash) == kHashLength, "Hashes must be packed.");
+  const std::vector<Hash> &children = levels_[level];
+  std::vector<Hash> &parents = levels_[level + 1];
+  std::vector<ByteContainerView> siblings;
+  std::vector<uint8_t *> parent_hashes;
+  siblings.reserve(indices.size());
+  parent_hashes.reserve(indices.size());
+  for (size_t index : indices) {
+    size_t left = 2 * index;
+    if (left + 1 < children.size()) {
+      // Siblings are adjacent in their level, so the pair is hashed in place.
+      siblings.emplace_back(children[left].data(), 2 * kHashLength);
+      parent_hashes.push_back(parents[index].data());
+    } else {
+      parents[index] = children[left];
+    }
+  }
+  HashMany(kNodeHashPrefix, siblings, parent_hashes);
+}
+
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
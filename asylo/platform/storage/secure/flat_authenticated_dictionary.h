@@ -0,0 +1,132 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_STORAGE_SECURE_FLAT_AUTHENTICATED_DICTIONARY_H_
+#define ASYLO_PLATFORM_STORAGE_SECURE_FLAT_AUTHENTICATED_DICTIONARY_H_
+
+#include <stdint.h>
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "asylo/platform/storage/secure/authenticated_dictionary.h"
+
+namespace asylo {
+namespace platform {
+namespace storage {
+
+// Authenticated Dictionary implementation backed by an array-based SHA-256
+// Merkle tree. Computes the same leaf hashes and roots as the Certificate
+// Transparency Merkle tree (RFC 6962), so the two implementations are
+// interchangeable for persisted data.
+//
+// Each level of the tree is stored in a contiguous array of fixed-size hashes,
+// so updating the tree does not allocate per node. Leaf updates only mark the
+// leaf dirty - the root is recomputed on CurrentRoot(), rehashing each inner
+// node above a dirty leaf once, regardless of how many times the leaves below
+// it changed.
+//
+// A tree may also be restored from the roots of its subtrees at a given level
+// alone, without the leaves below them. The leaves of each such subtree are
+// then loaded on demand, and verified against the restored subtree root. Leaves
+// that are not loaded cannot be read or modified.
+class FlatAuthenticatedDictionary : public AuthenticatedDictionary {
+ public:
+  // Length of the hashes in the tree.
+  static constexpr size_t kHashLength = 32;
+
+  FlatAuthenticatedDictionary();
+
+  size_t LeafCount() const final { return levels_[0].size(); }
+
+  size_t AddLeaf(const std::string &data) final;
+
+  size_t AddLeafHash(const std::string &hash) final;
+
+  std::string CurrentRoot() final;
+
+  std::string LeafHash(size_t leaf) const final;
+
+  std::string LeafHash(const std::string &data) const final;
+
+  bool UpdateLeaf(size_t leaf, const std::string &data) final;
+
+  // Returns the concatenated hashes of the nodes at |level| of the tree after
+  // updating the root. Each of these nodes is the root of a subtree of up to
+  // 2^|level| leaves.
+  std::string SubtreeRoots(size_t level);
+
+  // Restores an empty tree of |leaf_count| leaves from the concatenated hashes
+  // |roots| of its subtrees at |level|, as returned by SubtreeRoots(). None of
+  // the leaves are loaded if |level| is non-zero. Returns false if the tree is
+  // not empty, or if |roots| does not hold the expected number of hashes.
+  bool RestoreFromSubtreeRoots(size_t leaf_count, size_t level,
+                               const std::string &roots);
+
+  // Returns true if the |leaf|th leaf is loaded. Indexing starts from 1.
+  bool IsLeafLoaded(size_t leaf) const;
+
+  // Retrieves the range of leaves of the restored subtree which contains the
+  // |leaf|th leaf, as the position of its first leaf and its number of leaves.
+  // Indexing starts from 1.
+  void GetSubtreeLeaves(size_t leaf, size_t *first_leaf, size_t *count) const;
+
+  // Loads the leaves of the restored subtree starting at the |first_leaf|th
+  // leaf from their |data|. Returns false if the leaves do not match the
+  // subtree root, in which case the subtree remains not loaded.
+  bool LoadSubtree(size_t first_leaf, const std::vector<std::string> &data);
+
+ private:
+  using Hash = std::array<uint8_t, kHashLength>;
+
+  // Maximum level of the subtrees a tree can be restored from.
+  static constexpr size_t kMaxSubtreeLevel = 32;
+
+  // Marks the leaf at zero-based |index| for rehashing up to the root.
+  void MarkDirty(size_t index);
+
+  // Recomputes the nodes at |indices| of level |level| + 1 of the tree from
+  // their children, hashing several nodes at once where the CPU allows it.
+  void HashNodes(size_t level, absl::Span<const size_t> indices);
+
+  // Levels of the tree, from the leaf hashes at level 0 up to the root. A node
+  // without a sibling is promoted to the level above unchanged.
+  std::vector<std::vector<Hash>> levels_;
+
+  // Zero-based indices of leaves added or updated since the root was last
+  // computed, and the corresponding per-leaf flags, so that each leaf is
+  // recorded once.
+  std::vector<size_t> dirty_leaves_;
+  std::vector<bool> is_dirty_;
+
+  // Hash of an empty tree.
+  Hash empty_root_;
+
+  // Level the tree was restored from, and whether each of the subtrees at that
+  // level is loaded. Subtrees added after the tree was restored are loaded.
+  size_t subtree_level_;
+  std::vector<bool> is_subtree_loaded_;
+};
+
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_STORAGE_SECURE_FLAT_AUTHENTICATED_DICTIONARY_H_
@@ -0,0 +1,202 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/storage/secure/flat_authenticated_dictionary.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/base/macros.h"
+#include "absl/strings/escaping.h"
+
+namespace asylo {
+namespace platform {
+namespace storage {
+namespace {
+
+// Leaves and roots of the RFC 6962 test vectors used by the Certificate
+// Transparency Merkle tree tests.
+const char *const kLeaves[] = {
+    "",
+    "00",
+    "10",
+    "2021",
+    "3031",
+    "40414243",
+    "5051525354555657",
+    "606162636465666768696a6b6c6d6e6f",
+};
+
+const char *const kRoots[] = {
+    "6e340b9cffb37a989ca544e6bb780a2c78901d3fb33738768511a30617afa01d",
+    "fac54203e7cc696cf0dfcb42c92a1d9dbaf70ad9e621f4bd8d98662f00e3c125",
+    "aeb6bcfe274b70a14fb067a5e5578264db0fa9b51af5e0ba159158f329e06e77",
+    "d37ee418976dd95753c1c73862b9398fa2a2cf9b4ff0fdfe8b30cd95209614b7",
+    "4e3bbb1f7b478dcfe71fb631631519a3bca12c9aefca1612bfce4c13a86264d4",
+    "76e67dadbcdf1e10e1b74ddc608abd2f98dfb16fbce75277b5232a127f2087ef",
+    "ddb89be403809e325750d3d263cd78929c2942b7942a34b77e122c9594a74c8c",
+    "5dc9da79a70659a9ad559cb701ded9a2ab9d823aad2f4960cfe370eff4604328",
+};
+
+constexpr char kEmptyRoot[] =
+    "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855";
+
+std::string Hex(const std::string &bytes) {
+  return absl::BytesToHexString(bytes);
+}
+
+TEST(FlatAuthenticatedDictionaryTest, EmptyRoot) {
+  FlatAuthenticatedDictionary ad;
+  EXPECT_EQ(ad.LeafCount(), 0);
+  EXPECT_EQ(Hex(ad.CurrentRoot()), kEmptyRoot);
+  EXPECT_EQ(ad.LeafHash(1), "");
+}
+
+TEST(FlatAuthenticatedDictionaryTest, MatchesRfc6962Vectors) {
+  FlatAuthenticatedDictionary ad;
+  for (size_t i = 0; i < ABSL_ARRAYSIZE(kLeaves); i++) {
+    EXPECT_EQ(ad.AddLeaf(absl::HexStringToBytes(kLeaves[i])), i + 1);
+    EXPECT_EQ(Hex(ad.CurrentRoot()), kRoots[i]);
+  }
+  EXPECT_EQ(ad.LeafHash(1), ad.LeafHash(std::string()));
+}
+
+TEST(FlatAuthenticatedDictionaryTest, AddLeafHashMatchesAddLeaf) {
+  FlatAuthenticatedDictionary ad;
+  for (size_t i = 0; i < ABSL_ARRAYSIZE(kLeaves); i++) {
+    ad.AddLeafHash(ad.LeafHash(absl::HexStringToBytes(kLeaves[i])));
+  }
+  EXPECT_EQ(Hex(ad.CurrentRoot()), kRoots[ABSL_ARRAYSIZE(kRoots) - 1]);
+}
+
+TEST(FlatAuthenticatedDictionaryTest, UpdatesMatchRebuiltTree) {
+  constexpr size_t kLeafCount = 37;
+  std::vector<std::string> data;
+  FlatAuthenticatedDictionary ad;
+  for (size_t i = 0; i < kLeafCount; i++) {
+    data.push_back(std::string(1 + i % 5, static_cast<char>(i)));
+    ad.AddLeaf(data.back());
+  }
+  ad.CurrentRoot();
+
+  // Update some of the leaves, several of them twice, and append a few more.
+  for (size_t i : {0, 5, 6, 20, 36, 5, 0}) {
+    data[i] += "updated";
+    EXPECT_TRUE(ad.UpdateLeaf(i + 1, data[i]));
+  }
+  for (size_t i = 0; i < 4; i++) {
+    data.push_back(std::string(3, static_cast<char>(100 + i)));
+    ad.AddLeaf(data.back());
+  }
+  ad.UpdateLeaf(kLeafCount + 1, data[kLeafCount] += "updated");
+
+  FlatAuthenticatedDictionary rebuilt;
+  for (const std::string &leaf_data : data) {
+    rebuilt.AddLeaf(leaf_data);
+  }
+  EXPECT_EQ(ad.LeafCount(), rebuilt.LeafCount());
+  EXPECT_EQ(Hex(ad.CurrentRoot()), Hex(rebuilt.CurrentRoot()));
+  for (size_t leaf = 1; leaf <= data.size(); leaf++) {
+    EXPECT_EQ(ad.LeafHash(leaf), rebuilt.LeafHash(leaf));
+  }
+}
+
+TEST(FlatAuthenticatedDictionaryTest, InvalidInputsFail) {
+  FlatAuthenticatedDictionary ad;
+  EXPECT_EQ(ad.AddLeafHash("too short"), 0);
+  EXPECT_FALSE(ad.UpdateLeaf(0, "data"));
+  EXPECT_FALSE(ad.UpdateLeaf(1, "data"));
+  EXPECT_EQ(ad.AddLeaf("data"), 1);
+  EXPECT_TRUE(ad.UpdateLeaf(1, "data"));
+  EXPECT_FALSE(ad.UpdateLeaf(2, "data"));
+}
+
+TEST(FlatAuthenticatedDictionaryTest, RestoredTreeLoadsSubtreesLazily) {
+  constexpr size_t kLeafCount = 29;
+  constexpr size_t kLevel = 3;
+  std::vector<std::string> data;
+  FlatAuthenticatedDictionary ad;
+  for (size_t i = 0; i < kLeafCount; i++) {
+    data.push_back(std::string(1 + i % 3, static_cast<char>(i)));
+    ad.AddLeaf(data.back());
+  }
+  const std::string root = ad.CurrentRoot();
+
+  FlatAuthenticatedDictionary restored;
+  ASSERT_TRUE(restored.RestoreFromSubtreeRoots(kLeafCount, kLevel,
+                                               ad.SubtreeRoots(kLevel)));
+  EXPECT_EQ(restored.LeafCount(), kLeafCount);
+  EXPECT_EQ(restored.CurrentRoot(), root);
+  EXPECT_FALSE(restored.IsLeafLoaded(kLeafCount));
+  EXPECT_EQ(restored.LeafHash(kLeafCount), "");
+  EXPECT_FALSE(restored.UpdateLeaf(1, "data"));
+  EXPECT_EQ(restored.AddLeaf("data"), 0);
+
+  // Load the last, partial subtree, then one with tampered data.
+  size_t first_leaf;
+  size_t count;
+  restored.GetSubtreeLeaves(kLeafCount, &first_leaf, &count);
+  EXPECT_EQ(first_leaf, 25);
+  EXPECT_EQ(count, 5);
+  EXPECT_TRUE(restored.LoadSubtree(
+      first_leaf, std::vector<std::string>(data.begin() + first_leaf - 1,
+                                           data.end())));
+  EXPECT_TRUE(restored.IsLeafLoaded(kLeafCount));
+  EXPECT_EQ(restored.LeafHash(kLeafCount), ad.LeafHash(kLeafCount));
+
+  std::vector<std::string> tampered(data.begin() + 8, data.begin() + 16);
+  tampered[3] += "tampered";
+  EXPECT_FALSE(restored.LoadSubtree(9, tampered));
+  EXPECT_FALSE(restored.IsLeafLoaded(12));
+  EXPECT_TRUE(restored.LoadSubtree(
+      9, std::vector<std::string>(data.begin() + 8, data.begin() + 16)));
+  EXPECT_EQ(restored.CurrentRoot(), root);
+
+  // Modify loaded leaves in both trees, and append past the restored leaves.
+  for (FlatAuthenticatedDictionary *tree : {&ad, &restored}) {
+    EXPECT_TRUE(tree->UpdateLeaf(10, "updated"));
+    EXPECT_TRUE(tree->UpdateLeaf(27, "updated"));
+    for (size_t i = 0; i < 6; i++) {
+      EXPECT_EQ(tree->AddLeaf("appended"), kLeafCount + i + 1);
+    }
+  }
+  EXPECT_EQ(Hex(restored.CurrentRoot()), Hex(ad.CurrentRoot()));
+  EXPECT_FALSE(restored.IsLeafLoaded(1));
+}
+
+TEST(FlatAuthenticatedDictionaryTest, RestoreWithInvalidRootsFails) {
+  FlatAuthenticatedDictionary ad;
+  for (size_t i = 0; i < 10; i++) {
+    ad.AddLeaf(std::string(1, static_cast<char>(i)));
+  }
+  const std::string roots = ad.SubtreeRoots(2);
+  EXPECT_EQ(roots.size(), 3 * FlatAuthenticatedDictionary::kHashLength);
+
+  FlatAuthenticatedDictionary restored;
+  EXPECT_FALSE(restored.RestoreFromSubtreeRoots(13, 2, roots));
+  EXPECT_FALSE(restored.RestoreFromSubtreeRoots(10, 2, roots + "extra"));
+  EXPECT_TRUE(restored.RestoreFromSubtreeRoots(10, 2, roots));
+  EXPECT_FALSE(restored.RestoreFromSubtreeRoots(10, 2, roots));
+  EXPECT_FALSE(ad.RestoreFromSubtreeRoots(10, 2, roots));
+}
+
+}  // namespace
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
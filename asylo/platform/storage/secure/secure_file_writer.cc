@@ -0,0 +1,154 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/storage/secure/secure_file_writer.h"
+
+#include <fcntl.h>
+
+#include <algorithm>
+#include <future>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "asylo/platform/storage/secure/aead_handler.h"
+#include "asylo/platform/storage/secure/enclave_storage_secure.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace platform {
+namespace storage {
+
+StatusOr<std::unique_ptr<SecureFileWriter>> SecureFileWriter::Create(
+    int fd, size_t buffer_length) {
+  std::shared_ptr<const OffsetTranslator> offset_translator =
+      AeadHandler::GetInstance().GetOffsetTranslator(fd);
+  if (!offset_translator) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  absl::StrCat("File descriptor ", fd,
+                               " is not opened for secure storage"));
+  }
+  off_t end_offset = secure_lseek(fd, 0, SEEK_END);
+  if (end_offset == -1) {
+    return Status(error::GoogleError::INTERNAL,
+                  absl::StrCat("Failed to seek to the end of file descriptor ",
+                               fd));
+  }
+  return absl::WrapUnique(
+      new SecureFileWriter(fd, end_offset, offset_translator->payload_length(),
+                           std::max<size_t>(buffer_length, 1)));
+}
+
+SecureFileWriter::SecureFileWriter(int fd, off_t end_offset,
+                                   size_t block_length, size_t buffer_length)
+    : fd_(fd),
+      block_length_(block_length),
+      buffer_length_(buffer_length),
+      buffer_offset_(end_offset),
+      background_(/*num_threads=*/1) {
+  buffer_.reserve(buffer_length_ + block_length_);
+}
+
+SecureFileWriter::~SecureFileWriter() {
+  Status status = Commit();
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to commit secure file " << fd_ << ": " << status;
+  }
+}
+
+Status SecureFileWriter::Append(ByteContainerView data) {
+  ASYLO_RETURN_IF_ERROR(background_status());
+  buffer_.insert(buffer_.end(), data.begin(), data.end());
+  if (buffer_.size() >= buffer_length_) {
+    SealBuffered(/*all=*/false);
+  }
+  return Status::OkStatus();
+}
+
+void SecureFileWriter::Flush(FlushCallback done) {
+  SealBuffered(/*all=*/true);
+  background_.Schedule([this, done] {
+    Status status = background_status();
+    if (status.ok() && secure_fsync(fd_) != 0) {
+      status = Status(error::GoogleError::INTERNAL,
+                      absl::StrCat("Failed to commit secure file ", fd_));
+    }
+    if (done) {
+      done(status);
+    }
+  });
+}
+
+Status SecureFileWriter::Commit() {
+  std::promise<Status> result;
+  Flush([&result](const Status &status) { result.set_value(status); });
+  return result.get_future().get();
+}
+
+void SecureFileWriter::SealBuffered(bool all) {
+  size_t length = buffer_.size();
+  if (!all) {
+    off_t end = buffer_offset_ + buffer_.size();
+    length -= end % block_length_;
+  }
+  if (length == 0) {
+    return;
+  }
+
+  auto plaintext = std::make_shared<CleansingVector<uint8_t>>();
+  if (length == buffer_.size()) {
+    // Hand over the buffer itself, and keep appending to a fresh one of the
+    // same capacity.
+    plaintext->reserve(buffer_length_ + block_length_);
+    plaintext->swap(buffer_);
+  } else {
+    plaintext->assign(buffer_.begin(), buffer_.begin() + length);
+    buffer_.erase(buffer_.begin(), buffer_.begin() + length);
+  }
+  buffer_offset_ += length;
+  background_.Schedule([this, plaintext] { Write(*plaintext); });
+}
+
+void SecureFileWriter::Write(const CleansingVector<uint8_t> &plaintext) {
+  if (!background_status().ok()) {
+    return;
+  }
+  size_t written = 0;
+  while (written < plaintext.size()) {
+    ssize_t result = secure_write(fd_, plaintext.data() + written,
+                                  plaintext.size() - written);
+    if (result <= 0) {
+      absl::MutexLock lock(&mu_);
+      background_status_ =
+          Status(error::GoogleError::INTERNAL,
+                 absl::StrCat("Failed to write secure file ", fd_));
+      return;
+    }
+    written += result;
+  }
+}
+
+Status SecureFileWriter::background_status() const {
+  absl::MutexLock lock(&mu_);
+  return background_status_;
+}
+
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
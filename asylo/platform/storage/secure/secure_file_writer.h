@@ -0,0 +1,128 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_STORAGE_SECURE_SECURE_FILE_WRITER_H_
+#define ASYLO_PLATFORM_STORAGE_SECURE_SECURE_FILE_WRITER_H_
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/util/cleansing_types.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+#include "asylo/util/thread_pool.h"
+
+namespace asylo {
+namespace platform {
+namespace storage {
+
+// Append-only streaming writer for a file opened with secure_open(), for
+// write-heavy workloads such as logs and journals. Append() only buffers
+// plaintext in the enclave. Once enough plaintext is buffered, the full blocks
+// are handed to a background thread, which encrypts them, updates the
+// integrity metadata and writes them to the host, so that the appending thread
+// does not wait for storage exits. The file hash is only committed to disk by
+// Flush() or Commit().
+//
+// Example:
+//
+//     ASYLO_ASSIGN_OR_RETURN(std::unique_ptr<SecureFileWriter> writer,
+//                            SecureFileWriter::Create(fd));
+//     ASYLO_RETURN_IF_ERROR(writer->Append(record));
+//     ...
+//     writer->Flush([](const Status &status) { ... });
+//
+// A SecureFileWriter is not thread-safe. While it exists, the file descriptor
+// must not be used for anything else.
+class SecureFileWriter {
+ public:
+  // Called with the result of a Flush(), on the background thread.
+  using FlushCallback = std::function<void(const Status &)>;
+
+  // Default amount of plaintext to buffer before sealing it.
+  static constexpr size_t kDefaultBufferLength = 64 * 1024;
+
+  // Creates a writer appending to |fd|, a file descriptor opened with
+  // secure_open() for writing, whose master key is set. Moves the cursor of
+  // |fd| to the end of the file. Plaintext is sealed once at least
+  // |buffer_length| bytes are buffered. The writer does not take ownership of
+  // |fd|.
+  static StatusOr<std::unique_ptr<SecureFileWriter>> Create(
+      int fd, size_t buffer_length = kDefaultBufferLength);
+
+  SecureFileWriter(const SecureFileWriter &other) = delete;
+  SecureFileWriter &operator=(const SecureFileWriter &other) = delete;
+
+  // Commits all appended data, logging any failure.
+  ~SecureFileWriter();
+
+  // Appends |data| to the file. Returns the first error of the background
+  // thread, if any, after which the writer accepts no more data.
+  Status Append(ByteContainerView data);
+
+  // Seals and writes all appended data and commits the file hash to disk in
+  // the background, then calls |done| with the result.
+  void Flush(FlushCallback done);
+
+  // Like Flush(), but waits for the commit to complete and returns its result.
+  Status Commit();
+
+ private:
+  SecureFileWriter(int fd, off_t end_offset, size_t block_length,
+                   size_t buffer_length);
+
+  // Hands the buffered plaintext to the background thread. Unless |all| is
+  // set, keeps the plaintext after the last full block buffered, so that the
+  // background thread never rewrites a partially written block.
+  void SealBuffered(bool all);
+
+  // Encrypts and writes |plaintext| to the file. Runs on the background
+  // thread.
+  void Write(const CleansingVector<uint8_t> &plaintext);
+
+  // Returns the first error of the background thread.
+  Status background_status() const ABSL_LOCKS_EXCLUDED(mu_);
+
+  const int fd_;
+  const size_t block_length_;
+  const size_t buffer_length_;
+
+  // Plaintext not yet handed to the background thread, and the logical offset
+  // of the file at which it starts.
+  CleansingVector<uint8_t> buffer_;
+  off_t buffer_offset_;
+
+  mutable absl::Mutex mu_;
+  Status background_status_ ABSL_GUARDED_BY(mu_);
+
+  // Single thread, so that writes reach the file in the order they were
+  // appended. Declared last so that it is shut down first.
+  ThreadPool background_;
+};
+
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_STORAGE_SECURE_SECURE_FILE_WRITER_H_
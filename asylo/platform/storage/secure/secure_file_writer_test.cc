@@ -0,0 +1,158 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/storage/secure/secure_file_writer.h"
+
+#include <fcntl.h>
+#include <openssl/rand.h>
+#include <stdio.h>
+
+#include <memory>
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/flags/flag.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/notification.h"
+#include "asylo/platform/storage/secure/aead_handler.h"
+#include "asylo/platform/storage/secure/enclave_storage_secure.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/test/util/test_flags.h"
+#include "asylo/util/cleansing_types.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+namespace platform {
+namespace storage {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Not;
+
+// Length of each record appended, which is not a multiple of the block length
+// so that records straddle block boundaries.
+constexpr size_t kRecordLength = 100;
+constexpr int kRecordCount = 200;
+
+class SecureFileWriterTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = absl::StrCat(absl::GetFlag(FLAGS_test_tmpdir),
+                         "/SecureFileWriterTest.txt");
+    remove(path_.c_str());
+    key_.resize(kKeyLength);
+    ASSERT_EQ(RAND_bytes(key_.data(), key_.size()), 1);
+  }
+
+  // Opens the test file and sets its key. Returns -1 on failure.
+  int Open(int flags) {
+    int fd = secure_open(path_.c_str(), flags, S_IRWXU);
+    if (fd != -1 && AeadHandler::GetInstance().SetMasterKey(
+                        fd, key_.data(), key_.size()) != 0) {
+      secure_close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+  // Returns the contents of the test file.
+  std::string ReadAll() {
+    int fd = Open(O_RDONLY);
+    EXPECT_NE(fd, -1);
+    std::string contents(secure_lseek(fd, 0, SEEK_END), '\0');
+    secure_lseek(fd, 0, SEEK_SET);
+    EXPECT_EQ(secure_read(fd, &contents[0], contents.size()),
+              contents.size());
+    EXPECT_EQ(secure_close(fd), 0);
+    return contents;
+  }
+
+  static std::string Record(int index) {
+    return std::string(kRecordLength, 'a' + index % 26);
+  }
+
+  std::string path_;
+  CleansingVector<uint8_t> key_;
+};
+
+TEST_F(SecureFileWriterTest, AppendsAndCommitsRecords) {
+  int fd = Open(O_RDWR | O_CREAT);
+  ASSERT_NE(fd, -1);
+  std::string expected;
+  {
+    std::unique_ptr<SecureFileWriter> writer;
+    ASYLO_ASSERT_OK_AND_ASSIGN(writer, SecureFileWriter::Create(
+                                           fd, /*buffer_length=*/1000));
+    for (int i = 0; i < kRecordCount; ++i) {
+      ASYLO_ASSERT_OK(writer->Append(Record(i)));
+      expected += Record(i);
+    }
+    ASYLO_ASSERT_OK(writer->Commit());
+  }
+  ASSERT_EQ(secure_close(fd), 0);
+  EXPECT_THAT(ReadAll(), Eq(expected));
+}
+
+TEST_F(SecureFileWriterTest, AppendsToExistingFile) {
+  std::string expected;
+  for (int pass = 0; pass < 2; ++pass) {
+    int fd = Open(O_RDWR | O_CREAT);
+    ASSERT_NE(fd, -1);
+    std::unique_ptr<SecureFileWriter> writer;
+    ASYLO_ASSERT_OK_AND_ASSIGN(writer, SecureFileWriter::Create(fd));
+    for (int i = 0; i < kRecordCount; ++i) {
+      ASYLO_ASSERT_OK(writer->Append(Record(i)));
+      expected += Record(i);
+    }
+    // The destructor commits the appended records.
+    writer.reset();
+    ASSERT_EQ(secure_close(fd), 0);
+  }
+  EXPECT_THAT(ReadAll(), Eq(expected));
+}
+
+TEST_F(SecureFileWriterTest, FlushCallsCallback) {
+  int fd = Open(O_RDWR | O_CREAT);
+  ASSERT_NE(fd, -1);
+  std::unique_ptr<SecureFileWriter> writer;
+  ASYLO_ASSERT_OK_AND_ASSIGN(writer, SecureFileWriter::Create(fd));
+  ASYLO_ASSERT_OK(writer->Append(Record(0)));
+
+  absl::Notification flushed;
+  Status flush_status;
+  writer->Flush([&](const Status &status) {
+    flush_status = status;
+    flushed.Notify();
+  });
+  flushed.WaitForNotification();
+  ASYLO_EXPECT_OK(flush_status);
+
+  writer.reset();
+  ASSERT_EQ(secure_close(fd), 0);
+  EXPECT_THAT(ReadAll(), Eq(Record(0)));
+}
+
+TEST_F(SecureFileWriterTest, CreateFailsForInsecureDescriptor) {
+  EXPECT_THAT(SecureFileWriter::Create(/*fd=*/-1), Not(IsOk()));
+}
+
+}  // namespace
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
@@ -0,0 +1,218 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/storage/secure/secure_journal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/platform/storage/utils/fd_closer.h"
+#include "asylo/util/logging.h"
+
+namespace asylo {
+namespace platform {
+namespace storage {
+namespace {
+
+// Length of buffered records past which they are written out before the next
+// Sync(), bounding the enclave memory held by a journal.
+constexpr size_t kMaxBufferedLength = 1024 * 1024;
+
+// Length of the chunks in which a journal is read.
+constexpr size_t kReadChunkLength = 64 * 1024;
+
+bool IsTransientError(int err) { return (err == EAGAIN) || (err == EINTR); }
+
+}  // namespace
+
+constexpr char SecureJournal::kPathSuffix[];
+constexpr size_t SecureJournal::kRecordTagLength;
+
+SecureJournal::SecureJournal(std::string path)
+    : path_(std::move(path)), fd_(-1), next_sequence_(0), written_length_(0) {}
+
+SecureJournal::~SecureJournal() {
+  if (fd_ != -1) {
+    enc_untrusted_close(fd_);
+  }
+}
+
+bool SecureJournal::Append(const crypto::gcmlib::GcmCryptor &cryptor,
+                           RecordType type, uint64_t offset,
+                           const uint8_t *data, size_t length) {
+  if (length > UINT32_MAX) {
+    errno = EINVAL;
+    return false;
+  }
+  RecordHeader header;
+  header.sequence = next_sequence_;
+  header.offset = offset;
+  header.type = static_cast<uint32_t>(type);
+  header.length = static_cast<uint32_t>(length);
+
+  const size_t record_offset = buffer_.size();
+  const uint8_t *header_bytes = reinterpret_cast<const uint8_t *>(&header);
+  buffer_.insert(buffer_.end(), header_bytes, header_bytes + sizeof(header));
+  buffer_.insert(buffer_.end(), data, data + length);
+  buffer_.resize(buffer_.size() + kRecordTagLength);
+  if (!cryptor.GetAuthTag(buffer_.data() + buffer_.size() - kRecordTagLength,
+                          buffer_.data() + record_offset,
+                          sizeof(header) + length)) {
+    buffer_.resize(record_offset);
+    LOG(ERROR) << "Failed to authenticate journal record, path = " << path_;
+    return false;
+  }
+  next_sequence_++;
+
+  return buffer_.size() < kMaxBufferedLength || WriteBuffered();
+}
+
+bool SecureJournal::Sync() {
+  if (!WriteBuffered()) {
+    return false;
+  }
+  if (fd_ == -1) {
+    return true;
+  }
+  return enc_untrusted_fsync(fd_) == 0;
+}
+
+bool SecureJournal::Reset() {
+  buffer_.clear();
+  next_sequence_ = 0;
+  if (written_length_ == 0 && fd_ == -1) {
+    return true;
+  }
+  if (!Open() || enc_untrusted_ftruncate(fd_, 0) != 0 ||
+      enc_untrusted_fsync(fd_) != 0) {
+    LOG(ERROR) << "Failed to reset journal, path = " << path_
+               << ", errno = " << errno;
+    return false;
+  }
+  written_length_ = 0;
+  return true;
+}
+
+bool SecureJournal::WriteBuffered() {
+  if (buffer_.empty()) {
+    return true;
+  }
+  if (!Open()) {
+    return false;
+  }
+  size_t offset = 0;
+  while (offset < buffer_.size()) {
+    ssize_t bytes_written = enc_untrusted_write(
+        fd_, buffer_.data() + offset, buffer_.size() - offset);
+    if (bytes_written == -1 && IsTransientError(errno)) {
+      continue;
+    }
+    if (bytes_written <= 0) {
+      LOG(ERROR) << "Failed to write journal, path = " << path_
+                 << ", errno = " << errno;
+      return false;
+    }
+    offset += bytes_written;
+  }
+  written_length_ += buffer_.size();
+  buffer_.clear();
+  return true;
+}
+
+bool SecureJournal::Open() {
+  if (fd_ != -1) {
+    return true;
+  }
+  fd_ = enc_untrusted_open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND,
+                           S_IRUSR | S_IWUSR);
+  if (fd_ == -1) {
+    LOG(ERROR) << "Failed to open journal, path = " << path_
+               << ", errno = " << errno;
+    return false;
+  }
+  return true;
+}
+
+bool SecureJournal::Read(const std::string &path,
+                         const crypto::gcmlib::GcmCryptor &cryptor,
+                         std::vector<Record> *records) {
+  records->clear();
+  int fd = enc_untrusted_open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return errno == ENOENT;
+  }
+  FdCloser fd_closer(fd, &enc_untrusted_close);
+
+  std::vector<uint8_t> contents;
+  while (true) {
+    size_t length = contents.size();
+    contents.resize(length + kReadChunkLength);
+    ssize_t bytes_read =
+        enc_untrusted_read(fd, contents.data() + length, kReadChunkLength);
+    if (bytes_read == -1 && IsTransientError(errno)) {
+      contents.resize(length);
+      continue;
+    }
+    if (bytes_read == -1) {
+      LOG(ERROR) << "Failed to read journal, path = " << path
+                 << ", errno = " << errno;
+      return false;
+    }
+    contents.resize(length + bytes_read);
+    if (bytes_read == 0) {
+      break;
+    }
+  }
+
+  size_t offset = 0;
+  while (contents.size() - offset >= sizeof(RecordHeader)) {
+    RecordHeader header;
+    memcpy(&header, contents.data() + offset, sizeof(header));
+    if (header.sequence != records->size() ||
+        header.type < static_cast<uint32_t>(RecordType::kRedo) ||
+        header.type > static_cast<uint32_t>(RecordType::kCommit) ||
+        contents.size() - offset - sizeof(header) <
+            static_cast<size_t>(header.length) + kRecordTagLength) {
+      break;
+    }
+    uint8_t tag[kRecordTagLength];
+    const uint8_t *data = contents.data() + offset + sizeof(header);
+    if (!cryptor.GetAuthTag(tag, contents.data() + offset,
+                            sizeof(header) + header.length) ||
+        memcmp(tag, data + header.length, kRecordTagLength) != 0) {
+      LOG(WARNING) << "Ignoring unauthenticated journal records, path = "
+                   << path;
+      break;
+    }
+    records->push_back(
+        {static_cast<RecordType>(header.type), header.offset,
+         std::vector<uint8_t>(data, data + header.length)});
+    offset += sizeof(header) + header.length + kRecordTagLength;
+  }
+  return true;
+}
+
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
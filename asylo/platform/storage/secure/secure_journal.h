@@ -0,0 +1,130 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_STORAGE_SECURE_SECURE_JOURNAL_H_
+#define ASYLO_PLATFORM_STORAGE_SECURE_SECURE_JOURNAL_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "absl/base/attributes.h"
+#include "asylo/platform/crypto/gcmlib/gcm_cryptor.h"
+
+namespace asylo {
+namespace platform {
+namespace storage {
+
+// Write-ahead journal of a secure file, stored next to the file in untrusted
+// storage. Records changes to the physical file so that the file can be
+// brought back to its last committed state after a crash, with a single fsync
+// of the journal per commit:
+//  - a redo record holds sealed blocks written to the file,
+//  - an undo record holds the committed contents of blocks before they are
+//    first overwritten after a commit,
+//  - a commit record holds the file header of a committed state, and the
+//    physical size of the file in that state.
+//
+// Each record is authenticated with the key of the file and carries a
+// sequence number, so that a journal modified outside the enclave is only
+// trusted up to the first modified record. The blocks and the file header in
+// the records are sealed as in the file itself, and are verified like the
+// rest of the file once the journal is applied.
+//
+// Not thread-safe; the file control of the journaled file serializes access.
+class SecureJournal {
+ public:
+  enum class RecordType : uint32_t {
+    kRedo = 1,
+    kUndo = 2,
+    kCommit = 3,
+  };
+
+  struct Record {
+    RecordType type;
+    // Physical offset in the journaled file: of the data of redo and undo
+    // records, and of the end of the file for commit records.
+    uint64_t offset;
+    std::vector<uint8_t> data;
+  };
+
+  // Suffix appended to the path of a secure file to form the path of its
+  // journal.
+  static constexpr char kPathSuffix[] = ".jnl";
+
+  explicit SecureJournal(std::string path);
+  ~SecureJournal();
+
+  SecureJournal(const SecureJournal &other) = delete;
+  SecureJournal &operator=(const SecureJournal &other) = delete;
+
+  // Buffers a record. Buffered records are written to the journal by Sync(),
+  // or once they grow past a bounded size. Returns false on failure.
+  bool Append(const crypto::gcmlib::GcmCryptor &cryptor, RecordType type,
+              uint64_t offset, const uint8_t *data, size_t length);
+
+  // Writes all buffered records and makes the journal durable. Returns false
+  // on failure.
+  bool Sync();
+
+  // Empties the journal durably, discarding buffered records. Returns false
+  // on failure.
+  bool Reset();
+
+  // Returns the length of the journal, including buffered records.
+  size_t length() const { return written_length_ + buffer_.size(); }
+
+  // Reads the records of the journal at |path| into |records|, up to the first
+  // incomplete, reordered or unauthenticated record. A missing journal has no
+  // records. Returns false if the journal cannot be read.
+  static bool Read(const std::string &path,
+                   const crypto::gcmlib::GcmCryptor &cryptor,
+                   std::vector<Record> *records);
+
+ private:
+  // Layout of the header of each record, which is followed by the data of the
+  // record and by the authentication tag of the header and the data.
+  struct RecordHeader {
+    uint64_t sequence;
+    uint64_t offset;
+    uint32_t type;
+    uint32_t length;
+  } ABSL_ATTRIBUTE_PACKED;
+
+  static constexpr size_t kRecordTagLength = 16;
+
+  // Writes the buffered records to the journal. Returns false on failure.
+  bool WriteBuffered();
+
+  // Opens the journal for appending, if not open yet. Returns false on
+  // failure.
+  bool Open();
+
+  const std::string path_;
+  int fd_;
+  uint64_t next_sequence_;
+  size_t written_length_;
+  std::vector<uint8_t> buffer_;
+};
+
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_STORAGE_SECURE_SECURE_JOURNAL_H_
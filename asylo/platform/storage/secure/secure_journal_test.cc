@@ -0,0 +1,163 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/storage/secure/secure_journal.h"
+
+#include <fcntl.h>
+#include <openssl/rand.h>
+#include <stdio.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/flags/flag.h"
+#include "absl/strings/str_cat.h"
+#include "asylo/platform/crypto/gcmlib/gcm_cryptor.h"
+#include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/test/util/test_flags.h"
+
+namespace asylo {
+namespace platform {
+namespace storage {
+namespace {
+
+using crypto::gcmlib::GcmCryptor;
+using crypto::gcmlib::GcmCryptorKey;
+using ::testing::Eq;
+using ::testing::IsEmpty;
+using ::testing::SizeIs;
+
+constexpr size_t kBlockLength = 128;
+
+class SecureJournalTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = absl::StrCat(absl::GetFlag(FLAGS_test_tmpdir),
+                         "/SecureJournalTest", SecureJournal::kPathSuffix);
+    remove(path_.c_str());
+    cryptor_ = CreateCryptor();
+    ASSERT_TRUE(cryptor_);
+  }
+
+  static std::unique_ptr<GcmCryptor> CreateCryptor() {
+    uint8_t key[crypto::gcmlib::kKeyLength];
+    if (RAND_bytes(key, sizeof(key)) != 1) {
+      return nullptr;
+    }
+    return GcmCryptor::Create(kBlockLength, GcmCryptorKey(key, sizeof(key)));
+  }
+
+  // Appends a record holding |data| to |journal|.
+  bool Append(SecureJournal *journal, SecureJournal::RecordType type,
+              uint64_t offset, const std::string &data) {
+    return journal->Append(*cryptor_, type, offset,
+                           reinterpret_cast<const uint8_t *>(data.data()),
+                           data.size());
+  }
+
+  std::vector<SecureJournal::Record> Read() {
+    std::vector<SecureJournal::Record> records;
+    EXPECT_TRUE(SecureJournal::Read(path_, *cryptor_, &records));
+    return records;
+  }
+
+  std::string path_;
+  std::unique_ptr<GcmCryptor> cryptor_;
+};
+
+std::string DataOf(const SecureJournal::Record &record) {
+  return std::string(record.data.begin(), record.data.end());
+}
+
+TEST_F(SecureJournalTest, MissingJournalHasNoRecords) {
+  EXPECT_THAT(Read(), IsEmpty());
+}
+
+TEST_F(SecureJournalTest, ReadsSyncedRecords) {
+  SecureJournal journal(path_);
+  ASSERT_TRUE(Append(&journal, SecureJournal::RecordType::kRedo, 24, "redo"));
+  ASSERT_TRUE(Append(&journal, SecureJournal::RecordType::kUndo, 48, "undo"));
+  ASSERT_TRUE(
+      Append(&journal, SecureJournal::RecordType::kCommit, 96, "commit"));
+
+  // Records are only written by Sync().
+  EXPECT_THAT(Read(), IsEmpty());
+  ASSERT_TRUE(journal.Sync());
+
+  std::vector<SecureJournal::Record> records = Read();
+  ASSERT_THAT(records, SizeIs(3));
+  EXPECT_THAT(records[0].type, Eq(SecureJournal::RecordType::kRedo));
+  EXPECT_THAT(records[0].offset, Eq(24));
+  EXPECT_THAT(DataOf(records[0]), Eq("redo"));
+  EXPECT_THAT(records[1].type, Eq(SecureJournal::RecordType::kUndo));
+  EXPECT_THAT(records[2].type, Eq(SecureJournal::RecordType::kCommit));
+  EXPECT_THAT(records[2].offset, Eq(96));
+  EXPECT_THAT(DataOf(records[2]), Eq("commit"));
+}
+
+TEST_F(SecureJournalTest, ResetEmptiesJournal) {
+  SecureJournal journal(path_);
+  ASSERT_TRUE(Append(&journal, SecureJournal::RecordType::kRedo, 24, "old"));
+  ASSERT_TRUE(journal.Sync());
+  ASSERT_TRUE(journal.Reset());
+  EXPECT_THAT(journal.length(), Eq(0));
+  EXPECT_THAT(Read(), IsEmpty());
+
+  ASSERT_TRUE(Append(&journal, SecureJournal::RecordType::kRedo, 24, "new"));
+  ASSERT_TRUE(journal.Sync());
+  std::vector<SecureJournal::Record> records = Read();
+  ASSERT_THAT(records, SizeIs(1));
+  EXPECT_THAT(DataOf(records[0]), Eq("new"));
+}
+
+TEST_F(SecureJournalTest, StopsAtTornRecord) {
+  SecureJournal journal(path_);
+  ASSERT_TRUE(Append(&journal, SecureJournal::RecordType::kRedo, 24, "first"));
+  ASSERT_TRUE(Append(&journal, SecureJournal::RecordType::kRedo, 48, "second"));
+  ASSERT_TRUE(journal.Sync());
+
+  // Drop the last byte of the second record, as a crash during a write could.
+  int fd = enc_untrusted_open(path_.c_str(), O_WRONLY);
+  ASSERT_NE(fd, -1);
+  ASSERT_EQ(enc_untrusted_ftruncate(fd, journal.length() - 1), 0);
+  enc_untrusted_close(fd);
+
+  std::vector<SecureJournal::Record> records = Read();
+  ASSERT_THAT(records, SizeIs(1));
+  EXPECT_THAT(DataOf(records[0]), Eq("first"));
+}
+
+TEST_F(SecureJournalTest, IgnoresRecordsSealedWithAnotherKey) {
+  SecureJournal journal(path_);
+  ASSERT_TRUE(Append(&journal, SecureJournal::RecordType::kRedo, 24, "data"));
+  ASSERT_TRUE(journal.Sync());
+
+  std::unique_ptr<GcmCryptor> other_cryptor = CreateCryptor();
+  ASSERT_TRUE(other_cryptor);
+  std::vector<SecureJournal::Record> records;
+  ASSERT_TRUE(SecureJournal::Read(path_, *other_cryptor, &records));
+  EXPECT_THAT(records, IsEmpty());
+}
+
+}  // namespace
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
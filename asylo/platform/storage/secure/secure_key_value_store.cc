@@ -0,0 +1,474 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/storage/secure/secure_key_value_store.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "asylo/util/compression.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace platform {
+namespace storage {
+namespace {
+
+// Identifies the superblock of a store, "ASYLOKV1".
+constexpr uint64_t kMagic = 0x31564b4f4c595341;
+
+// Type of an entry.
+enum EntryType : uint32_t {
+  kPut = 1,
+  kDelete = 2,
+  kPutCompressed = 3,
+};
+
+// Header of the plaintext of an entry, followed by the key and the value.
+struct PlaintextHeader {
+  uint32_t key_length;
+  uint32_t type;
+};
+
+// Length of the reads made while scanning the log, and of the writes made while
+// rewriting it.
+constexpr size_t kLogIoLength = 1024 * 1024;
+
+// Returns the associated data sealed with the object named |label| stored at
+// |offset|, so that no object can be moved to another offset or taken for an
+// object of another kind.
+std::string AssociatedData(absl::string_view label, off_t offset) {
+  uint64_t position = offset;
+  return absl::StrCat(
+      label,
+      absl::string_view(reinterpret_cast<const char *>(&position),
+                        sizeof(position)));
+}
+
+Status DataLossError(absl::string_view message) {
+  return Status(error::GoogleError::DATA_LOSS, message);
+}
+
+}  // namespace
+
+constexpr size_t SecureKeyValueStore::kMaxKeyLength;
+constexpr size_t SecureKeyValueStore::kNonceLength;
+constexpr size_t SecureKeyValueStore::kTagLength;
+
+StatusOr<std::unique_ptr<SecureKeyValueStore>> SecureKeyValueStore::Open(
+    std::unique_ptr<AeadCryptor> cryptor, RandomAccessStorage *io,
+    bool compress_values) {
+  if (!cryptor || cryptor->NonceSize() != kNonceLength ||
+      cryptor->MaxSealOverhead() > kTagLength) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Cryptor must use 96-bit nonces and at most 16 bytes of "
+                  "seal overhead");
+  }
+  auto store = absl::WrapUnique(
+      new SecureKeyValueStore(std::move(cryptor), io, compress_values));
+  ASYLO_RETURN_IF_ERROR(store->Load());
+  return std::move(store);
+}
+
+SecureKeyValueStore::SecureKeyValueStore(std::unique_ptr<AeadCryptor> cryptor,
+                                         RandomAccessStorage *io,
+                                         bool compress_values)
+    : cryptor_(std::move(cryptor)),
+      io_(io),
+      compress_values_(compress_values),
+      superblocks_(2, io),
+      tree_(absl::make_unique<FlatAuthenticatedDictionary>()),
+      generation_(0),
+      log_begin_(2 * sizeof(SealedSuperblock)),
+      log_end_(log_begin_),
+      live_length_(0),
+      dirty_(false) {}
+
+SecureKeyValueStore::~SecureKeyValueStore() {
+  Status status = Commit();
+  LOG_IF(ERROR, !status.ok()) << "Could not commit key-value store: "
+                              << status;
+}
+
+Status SecureKeyValueStore::Put(absl::string_view key,
+                                ByteContainerView value) {
+  return Append(/*is_put=*/true, key, value);
+}
+
+StatusOr<CleansingVector<uint8_t>> SecureKeyValueStore::Get(
+    absl::string_view key) {
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    return Status(error::GoogleError::NOT_FOUND, "Key not found");
+  }
+  DecodedEntry entry;
+  ASYLO_ASSIGN_OR_RETURN(entry, ReadEntry(it->second));
+  if (!entry.is_put || entry.key != key) {
+    return DataLossError("Entry does not hold the value of the key");
+  }
+  if (!entry.compressed) {
+    return std::move(entry.value);
+  }
+  CleansingVector<uint8_t> value;
+  ASYLO_RETURN_IF_ERROR(Decompress(
+      entry.value, std::numeric_limits<uint32_t>::max(), &value));
+  return std::move(value);
+}
+
+Status SecureKeyValueStore::Delete(absl::string_view key) {
+  if (!Contains(key)) {
+    return Status(error::GoogleError::NOT_FOUND, "Key not found");
+  }
+  return Append(/*is_put=*/false, key, absl::string_view());
+}
+
+bool SecureKeyValueStore::Contains(absl::string_view key) const {
+  return index_.contains(key);
+}
+
+Status SecureKeyValueStore::Commit() {
+  if (!dirty_) {
+    return Status::OkStatus();
+  }
+
+  // The log must be durable before a superblock refers to it.
+  ASYLO_RETURN_IF_ERROR(io_->Sync());
+
+  Superblock superblock;
+  superblock.magic = kMagic;
+  superblock.generation = generation_ + 1;
+  superblock.log_begin = log_begin_;
+  superblock.log_end = log_end_;
+  std::string root = tree_->CurrentRoot();
+  memcpy(superblock.root, root.data(), sizeof(superblock.root));
+
+  SealedSuperblock sealed;
+  off_t slot = (superblock.generation % 2) * sizeof(SealedSuperblock);
+  size_t ciphertext_size;
+  ASYLO_RETURN_IF_ERROR(cryptor_->Seal(
+      ByteContainerView(&superblock, sizeof(superblock)),
+      AssociatedData("superblock", slot), absl::MakeSpan(sealed.nonce),
+      absl::MakeSpan(sealed.ciphertext), &ciphertext_size));
+  ASYLO_RETURN_IF_ERROR(superblocks_.Write(slot, sealed));
+  ASYLO_RETURN_IF_ERROR(superblocks_.Flush());
+
+  generation_ = superblock.generation;
+  dirty_ = false;
+  return Status::OkStatus();
+}
+
+Status SecureKeyValueStore::Compact() {
+  std::vector<std::pair<const std::string *, IndexEntry>> live;
+  live.reserve(index_.size());
+  for (const auto &entry : index_) {
+    live.emplace_back(&entry.first, entry.second);
+  }
+  std::sort(live.begin(), live.end(), [](const auto &lhs, const auto &rhs) {
+    return lhs.second.offset < rhs.second.offset;
+  });
+
+  // Rewritten entries keep the encoding of their values, and so have the same
+  // length as the original ones, so the
+  // rewritten log fits below the current one if the live entries do.
+  const off_t first_offset = 2 * sizeof(SealedSuperblock);
+  const off_t target =
+      live_length_ <= static_cast<size_t>(log_begin_ - first_offset)
+          ? first_offset
+          : log_end_;
+
+  auto tree = absl::make_unique<FlatAuthenticatedDictionary>();
+  absl::flat_hash_map<std::string, IndexEntry> index;
+  std::string pending;
+  off_t pending_offset = target;
+  off_t offset = target;
+  for (size_t i = 0; i <= live.size(); i++) {
+    if (i < live.size()) {
+      const std::string &key = *live[i].first;
+      DecodedEntry decoded;
+      ASYLO_ASSIGN_OR_RETURN(decoded, ReadEntry(live[i].second));
+      if (!decoded.is_put || decoded.key != key) {
+        return DataLossError("Entry does not hold the value of the key");
+      }
+      std::string entry;
+      ASYLO_RETURN_IF_ERROR(SealEntry(offset, /*is_put=*/true,
+                                      decoded.compressed, key, decoded.value,
+                                      &entry));
+      index[key] = {offset, entry.size(), tree->AddLeaf(entry)};
+      pending.append(entry);
+      offset += entry.size();
+    }
+    if (!pending.empty() &&
+        (pending.size() >= kLogIoLength || i == live.size())) {
+      if (target < log_begin_ && offset > log_begin_) {
+        return Status(error::GoogleError::INTERNAL,
+                      "Rewritten log overlaps the current log");
+      }
+      ASYLO_RETURN_IF_ERROR(
+          io_->Write(pending.data(), pending_offset, pending.size()));
+      pending_offset = offset;
+      pending.clear();
+    }
+  }
+
+  tree_ = std::move(tree);
+  index_ = std::move(index);
+  log_begin_ = target;
+  log_end_ = offset;
+  live_length_ = offset - target;
+  dirty_ = true;
+  ASYLO_RETURN_IF_ERROR(Commit());
+
+  // The previous log after the rewritten one is no longer referenced.
+  if (target == first_offset) {
+    ASYLO_RETURN_IF_ERROR(io_->Truncate(log_end_));
+  }
+  return Status::OkStatus();
+}
+
+Status SecureKeyValueStore::Load() {
+  size_t size;
+  ASYLO_ASSIGN_OR_RETURN(size, io_->Size());
+  if (size == 0) {
+    // Commit the empty store, so that it is found when reopened.
+    dirty_ = true;
+    return Commit();
+  }
+  if (size < static_cast<size_t>(log_begin_)) {
+    return DataLossError("Storage is too short to hold the superblocks");
+  }
+
+  // Select the valid superblock of the latest generation.
+  bool found = false;
+  Superblock latest;
+  for (off_t slot = 0; slot < log_begin_; slot += sizeof(SealedSuperblock)) {
+    SealedSuperblock sealed;
+    ASYLO_RETURN_IF_ERROR(superblocks_.Read(slot, &sealed));
+    CleansingVector<uint8_t> plaintext(sizeof(sealed.ciphertext));
+    size_t plaintext_size;
+    if (!cryptor_
+             ->Open(sealed.ciphertext, AssociatedData("superblock", slot),
+                    sealed.nonce, absl::MakeSpan(plaintext), &plaintext_size)
+             .ok() ||
+        plaintext_size != sizeof(Superblock)) {
+      continue;
+    }
+    Superblock superblock;
+    memcpy(&superblock, plaintext.data(), sizeof(superblock));
+    if (superblock.magic != kMagic ||
+        static_cast<off_t>((superblock.generation % 2) *
+                           sizeof(SealedSuperblock)) != slot ||
+        (found && superblock.generation <= latest.generation)) {
+      continue;
+    }
+    latest = superblock;
+    found = true;
+  }
+  if (!found) {
+    return DataLossError("No valid superblock");
+  }
+  if (latest.log_begin < static_cast<uint64_t>(log_begin_) ||
+      latest.log_end < latest.log_begin || latest.log_end > size) {
+    return DataLossError("Superblock refers to a log out of the storage");
+  }
+
+  // Rebuild the index and the Merkle tree from the committed log, reading it in
+  // large windows rather than one entry at a time.
+  std::string window;
+  off_t window_offset = latest.log_begin;
+  auto read = [&](off_t offset, size_t length, void *buffer) -> Status {
+    off_t window_end = window_offset + window.size();
+    if (offset < window_offset ||
+        offset + static_cast<off_t>(length) > window_end) {
+      window_offset = offset;
+      window.resize(std::min<uint64_t>(std::max(length, kLogIoLength),
+                                       latest.log_end - offset));
+      ASYLO_RETURN_IF_ERROR(io_->Read(&window[0], offset, window.size()));
+    }
+    memcpy(buffer, window.data() + (offset - window_offset), length);
+    return Status::OkStatus();
+  };
+
+  off_t offset = latest.log_begin;
+  while (offset < static_cast<off_t>(latest.log_end)) {
+    EntryHeader header;
+    if (latest.log_end - offset < sizeof(header)) {
+      return DataLossError("Log ends with a truncated entry");
+    }
+    ASYLO_RETURN_IF_ERROR(read(offset, sizeof(header), &header));
+    if (header.sealed_length > latest.log_end - offset - sizeof(header)) {
+      return DataLossError("Log ends with a truncated entry");
+    }
+    std::string entry(sizeof(header) + header.sealed_length, '\0');
+    ASYLO_RETURN_IF_ERROR(read(offset, entry.size(), &entry[0]));
+    DecodedEntry decoded;
+    ASYLO_ASSIGN_OR_RETURN(decoded, OpenEntry(offset, entry));
+    UpdateIndex(decoded.is_put, decoded.key,
+                {offset, entry.size(), tree_->AddLeaf(entry)});
+    offset += entry.size();
+  }
+
+  if (tree_->CurrentRoot() !=
+      absl::string_view(reinterpret_cast<const char *>(latest.root),
+                        sizeof(latest.root))) {
+    return DataLossError("Log does not match the committed root");
+  }
+
+  generation_ = latest.generation;
+  log_begin_ = latest.log_begin;
+  log_end_ = latest.log_end;
+  return Status::OkStatus();
+}
+
+Status SecureKeyValueStore::SealEntry(off_t offset, bool is_put,
+                                      bool compressed, absl::string_view key,
+                                      ByteContainerView value,
+                                      std::string *entry) {
+  if (key.size() > kMaxKeyLength) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  absl::StrCat("Key length ", key.size(),
+                               " exceeds maximum key length (", kMaxKeyLength,
+                               " bytes)"));
+  }
+
+  PlaintextHeader plaintext_header;
+  plaintext_header.key_length = key.size();
+  plaintext_header.type =
+      is_put ? (compressed ? kPutCompressed : kPut) : kDelete;
+  const ByteContainerView fragments[] = {
+      ByteContainerView(&plaintext_header, sizeof(plaintext_header)), key,
+      value};
+  size_t plaintext_length = sizeof(plaintext_header) + key.size() +
+                            value.size();
+
+  EntryHeader header;
+  entry->resize(sizeof(header) + plaintext_length + kTagLength);
+  size_t sealed_length;
+  ASYLO_RETURN_IF_ERROR(cryptor_->SealV(
+      fragments, AssociatedData("entry", offset), absl::MakeSpan(header.nonce),
+      absl::MakeSpan(reinterpret_cast<uint8_t *>(&(*entry)[sizeof(header)]),
+                     entry->size() - sizeof(header)),
+      &sealed_length));
+  header.sealed_length = sealed_length;
+  memcpy(&(*entry)[0], &header, sizeof(header));
+  entry->resize(sizeof(header) + sealed_length);
+  return Status::OkStatus();
+}
+
+StatusOr<SecureKeyValueStore::DecodedEntry> SecureKeyValueStore::OpenEntry(
+    off_t offset, const std::string &entry) {
+  EntryHeader header;
+  if (entry.size() < sizeof(header)) {
+    return DataLossError("Entry is truncated");
+  }
+  memcpy(&header, entry.data(), sizeof(header));
+  if (header.sealed_length != entry.size() - sizeof(header)) {
+    return DataLossError("Entry is truncated");
+  }
+
+  CleansingVector<uint8_t> plaintext(header.sealed_length);
+  size_t plaintext_length;
+  if (!cryptor_
+           ->Open(ByteContainerView(entry.data() + sizeof(header),
+                                    header.sealed_length),
+                  AssociatedData("entry", offset), header.nonce,
+                  absl::MakeSpan(plaintext), &plaintext_length)
+           .ok()) {
+    return DataLossError(
+        absl::StrCat("Entry at offset ", offset, " failed authentication"));
+  }
+
+  PlaintextHeader plaintext_header;
+  if (plaintext_length < sizeof(plaintext_header)) {
+    return DataLossError("Entry is malformed");
+  }
+  memcpy(&plaintext_header, plaintext.data(), sizeof(plaintext_header));
+  if (plaintext_header.key_length >
+          plaintext_length - sizeof(plaintext_header) ||
+      (plaintext_header.type != kPut && plaintext_header.type != kDelete &&
+       plaintext_header.type != kPutCompressed)) {
+    return DataLossError("Entry is malformed");
+  }
+
+  DecodedEntry decoded;
+  decoded.is_put = plaintext_header.type != kDelete;
+  decoded.compressed = plaintext_header.type == kPutCompressed;
+  auto key = plaintext.begin() + sizeof(plaintext_header);
+  auto value = key + plaintext_header.key_length;
+  decoded.key.assign(key, value);
+  decoded.value.assign(value, plaintext.begin() + plaintext_length);
+  return std::move(decoded);
+}
+
+StatusOr<SecureKeyValueStore::DecodedEntry> SecureKeyValueStore::ReadEntry(
+    const IndexEntry &location) {
+  std::string entry(location.length, '\0');
+  ASYLO_RETURN_IF_ERROR(io_->Read(&entry[0], location.offset, location.length));
+  if (tree_->LeafHash(entry) != tree_->LeafHash(location.leaf)) {
+    return DataLossError(absl::StrCat("Entry at offset ", location.offset,
+                                      " does not match its leaf hash"));
+  }
+  return OpenEntry(location.offset, entry);
+}
+
+Status SecureKeyValueStore::Append(bool is_put, absl::string_view key,
+                                   ByteContainerView value) {
+  CleansingVector<uint8_t> compressed_value;
+  bool compressed = false;
+  if (is_put && compress_values_) {
+    ASYLO_RETURN_IF_ERROR(Compress(value, &compressed_value));
+    compressed = compressed_value.size() < value.size();
+  }
+  std::string entry;
+  ASYLO_RETURN_IF_ERROR(SealEntry(
+      log_end_, is_put, compressed, key,
+      compressed ? ByteContainerView(compressed_value) : value, &entry));
+  ASYLO_RETURN_IF_ERROR(io_->Write(entry.data(), log_end_, entry.size()));
+  UpdateIndex(is_put, key, {log_end_, entry.size(), tree_->AddLeaf(entry)});
+  log_end_ += entry.size();
+  dirty_ = true;
+  return Status::OkStatus();
+}
+
+void SecureKeyValueStore::UpdateIndex(bool is_put, absl::string_view key,
+                                      const IndexEntry &location) {
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    live_length_ -= it->second.length;
+    if (!is_put) {
+      index_.erase(it);
+      return;
+    }
+    it->second = location;
+  } else if (is_put) {
+    index_.emplace(key, location);
+  } else {
+    return;
+  }
+  live_length_ += location.length;
+}
+
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
@@ -0,0 +1,227 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_STORAGE_SECURE_SECURE_KEY_VALUE_STORE_H_
+#define ASYLO_PLATFORM_STORAGE_SECURE_SECURE_KEY_VALUE_STORE_H_
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "asylo/crypto/aead_cryptor.h"
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/platform/storage/secure/flat_authenticated_dictionary.h"
+#include "asylo/platform/storage/utils/random_access_storage.h"
+#include "asylo/platform/storage/utils/record_store.h"
+#include "asylo/util/cleansing_types.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+namespace platform {
+namespace storage {
+
+// A sealed key-value store persisted to an untrusted storage resource.
+//
+// The store is a log of entries sealed with an AeadCryptor, each holding a key
+// and either its value or a deletion. Puts and deletes append to the log, and
+// an index of the live entries is kept in the enclave, so that a Get() costs a
+// single read of the storage resource. Each entry is sealed with its offset in
+// the log as associated data, and is a leaf of a Merkle tree over the log. The
+// root of the tree is committed in a sealed superblock, which is verified
+// against the log when the store is opened, and each entry read by Get() is
+// verified against its leaf hash.
+//
+// Changes become durable on Commit(). The superblock is written alternately to
+// one of two slots at the start of the storage resource, so that a commit
+// interrupted by a crash leaves the previous commit in place, and the entries
+// appended since the last commit are discarded when the store is reopened. The
+// store does not protect against the whole storage resource being rolled back
+// to an earlier commit.
+//
+// Compact() rewrites the live entries without the overwritten and deleted ones.
+// The rewritten log is placed below the current one when it fits, and after it
+// otherwise, so that the previous log stays intact until the rewritten one is
+// committed.
+//
+// Values can be compressed before they are sealed, which shrinks the log and
+// the reads of Get() for compressible values. The length of a compressed entry
+// then depends on the contents of its value, so an observer of the storage
+// resource who can choose part of a value can learn about the rest of it from
+// the lengths of the entries. Compression is therefore off by default.
+//
+// This class is not thread-safe. It is the responsibility of the caller to
+// ensure that its methods are not called concurrently.
+class SecureKeyValueStore {
+ public:
+  // Maximum length of a key.
+  static constexpr size_t kMaxKeyLength = 4096;
+
+  // Opens the store persisted to |io|, or creates an empty store if |io| is
+  // empty, with entries sealed by |cryptor|. |cryptor| must use 96-bit nonces
+  // and at most 16 bytes of seal overhead, such as the AES-GCM and AES-GCM-SIV
+  // cryptors. The store does not take ownership of |io| and it is the
+  // responsibility of the caller to ensure it remains valid over the lifetime
+  // of the store. Returns a DATA_LOSS error if the persisted store fails
+  // verification. If |compress_values| is true, the values put afterwards are
+  // compressed with DEFLATE whenever that makes them shorter. Compressed
+  // values are read back regardless of |compress_values|.
+  static StatusOr<std::unique_ptr<SecureKeyValueStore>> Open(
+      std::unique_ptr<AeadCryptor> cryptor, RandomAccessStorage *io,
+      bool compress_values = false);
+
+  SecureKeyValueStore(const SecureKeyValueStore &) = delete;
+  SecureKeyValueStore &operator=(const SecureKeyValueStore &) = delete;
+
+  // Commits the pending changes.
+  ~SecureKeyValueStore();
+
+  // Sets the value of |key| to |value|.
+  Status Put(absl::string_view key, ByteContainerView value);
+
+  // Returns the value of |key|, or a NOT_FOUND error if |key| has no value.
+  // Returns a DATA_LOSS error if the entry read fails verification.
+  StatusOr<CleansingVector<uint8_t>> Get(absl::string_view key);
+
+  // Removes the value of |key|. Returns a NOT_FOUND error if |key| has no
+  // value.
+  Status Delete(absl::string_view key);
+
+  // Returns true if |key| has a value.
+  bool Contains(absl::string_view key) const;
+
+  // Makes the changes since the last commit durable.
+  Status Commit();
+
+  // Rewrites the log with only the live entries and commits it. Returns an
+  // error without changing the store if the rewritten log cannot be written.
+  Status Compact();
+
+  // Returns the number of keys with a value.
+  size_t size() const { return index_.size(); }
+
+  // Returns the length of the log, and the length of its live entries. The
+  // difference is the space reclaimed by Compact().
+  size_t log_length() const { return log_end_ - log_begin_; }
+  size_t live_length() const { return live_length_; }
+
+ private:
+  // Lengths of the nonces and the maximum seal overhead of the cryptor.
+  static constexpr size_t kNonceLength = 12;
+  static constexpr size_t kTagLength = 16;
+
+  // Location of a live entry in the log.
+  struct IndexEntry {
+    off_t offset;   // Offset of the entry in the storage resource.
+    size_t length;  // Length of the entry.
+    size_t leaf;    // Position of the entry in the Merkle tree.
+  };
+
+  // Plaintext of an entry. |value| is compressed if |compressed| is true.
+  struct DecodedEntry {
+    bool is_put;
+    bool compressed;
+    std::string key;
+    CleansingVector<uint8_t> value;
+  };
+
+  // Header of an entry, followed by |sealed_length| bytes of ciphertext.
+  struct EntryHeader {
+    uint32_t sealed_length;
+    uint8_t nonce[kNonceLength];
+  };
+
+  // Plaintext of the superblock.
+  struct Superblock {
+    uint64_t magic;
+    uint64_t generation;
+    uint64_t log_begin;
+    uint64_t log_end;
+    uint8_t root[FlatAuthenticatedDictionary::kHashLength];
+  };
+
+  // Superblock sealed in one of the two slots.
+  struct SealedSuperblock {
+    uint8_t nonce[kNonceLength];
+    uint8_t ciphertext[sizeof(Superblock) + kTagLength];
+  };
+
+  SecureKeyValueStore(std::unique_ptr<AeadCryptor> cryptor,
+                      RandomAccessStorage *io, bool compress_values);
+
+  // Reads the latest valid superblock and rebuilds the index and the Merkle
+  // tree from the log it commits.
+  Status Load();
+
+  // Seals an entry for |key| to be written at |offset| into |entry|. |value|
+  // is sealed as-is, and is marked as compressed if |compressed| is true.
+  Status SealEntry(off_t offset, bool is_put, bool compressed,
+                   absl::string_view key, ByteContainerView value,
+                   std::string *entry);
+
+  // Verifies and unseals an entry read from |offset|.
+  StatusOr<DecodedEntry> OpenEntry(off_t offset, const std::string &entry);
+
+  // Reads the live entry at |location| and verifies it against its leaf hash.
+  StatusOr<DecodedEntry> ReadEntry(const IndexEntry &location);
+
+  // Appends an entry for |key| to the log and updates the index.
+  Status Append(bool is_put, absl::string_view key, ByteContainerView value);
+
+  // Records the entry for |key| at |location| in the index.
+  void UpdateIndex(bool is_put, absl::string_view key,
+                   const IndexEntry &location);
+
+  std::unique_ptr<AeadCryptor> cryptor_;
+  RandomAccessStorage *io_;
+
+  // True if the values put are compressed.
+  const bool compress_values_;
+
+  // The two superblock slots at the start of |io_|.
+  RecordStore<SealedSuperblock> superblocks_;
+
+  // Merkle tree over the entries of the log, in log order.
+  std::unique_ptr<FlatAuthenticatedDictionary> tree_;
+
+  // Live entries by key.
+  absl::flat_hash_map<std::string, IndexEntry> index_;
+
+  // Generation of the last commit, which selects the slot of the next one.
+  uint64_t generation_;
+
+  // Range of the log in |io_|.
+  off_t log_begin_;
+  off_t log_end_;
+
+  // Total length of the live entries.
+  size_t live_length_;
+
+  // True if the store changed since the last commit.
+  bool dirty_;
+};
+
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_STORAGE_SECURE_SECURE_KEY_VALUE_STORE_H_
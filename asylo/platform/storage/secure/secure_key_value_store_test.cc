@@ -0,0 +1,222 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/storage/secure/secure_key_value_store.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "asylo/crypto/aead_cryptor.h"
+#include "asylo/platform/storage/utils/fd_closer.h"
+#include "asylo/platform/storage/utils/test_utils.h"
+#include "asylo/platform/storage/utils/untrusted_file.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/cleansing_types.h"
+
+namespace asylo {
+namespace platform {
+namespace storage {
+namespace {
+
+using ::testing::ElementsAreArray;
+
+constexpr uint8_t kKey[] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                            0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+
+class SecureKeyValueStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    fd_ = CreateEmptyTempFileOrDie("secure_key_value_store.tmp");
+    closer_.reset(fd_);
+    file_ = absl::make_unique<UntrustedFile>(fd_);
+  }
+
+  // Opens the store persisted to the test file with a cryptor using |key|.
+  StatusOr<std::unique_ptr<SecureKeyValueStore>> OpenStore(
+      ByteContainerView key = kKey, bool compress_values = false) {
+    std::unique_ptr<AeadCryptor> cryptor;
+    ASYLO_ASSIGN_OR_RETURN(cryptor, AeadCryptor::CreateAesGcmCryptor(key));
+    return SecureKeyValueStore::Open(std::move(cryptor), file_.get(),
+                                     compress_values);
+  }
+
+  // Flips a byte of the test file at |offset|.
+  void TamperWith(off_t offset) {
+    uint8_t byte;
+    ASYLO_ASSERT_OK(file_->Read(&byte, offset, 1));
+    byte ^= 0xff;
+    ASYLO_ASSERT_OK(file_->Write(&byte, offset, 1));
+  }
+
+  int fd_;
+  FdCloser closer_;
+  std::unique_ptr<UntrustedFile> file_;
+};
+
+std::vector<uint8_t> Bytes(absl::string_view value) {
+  return std::vector<uint8_t>(value.begin(), value.end());
+}
+
+// Ensure that values are read back, both from the open store and after it is
+// reopened.
+TEST_F(SecureKeyValueStoreTest, PutGetReopen) {
+  constexpr int kKeyCount = 100;
+  {
+    std::unique_ptr<SecureKeyValueStore> store;
+    ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+    for (int i = 0; i < kKeyCount; i++) {
+      ASYLO_ASSERT_OK(store->Put(absl::StrCat("key", i),
+                                 absl::StrCat("value", i)));
+    }
+    ASYLO_ASSERT_OK(store->Put("key0", "updated"));
+    ASYLO_ASSERT_OK(store->Commit());
+    EXPECT_EQ(store->size(), kKeyCount);
+    EXPECT_THAT(store->Get("key0"), IsOkAndHolds(ElementsAreArray(
+                                        Bytes("updated"))));
+  }
+
+  std::unique_ptr<SecureKeyValueStore> store;
+  ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+  EXPECT_EQ(store->size(), kKeyCount);
+  EXPECT_THAT(store->Get("key0"),
+              IsOkAndHolds(ElementsAreArray(Bytes("updated"))));
+  for (int i = 1; i < kKeyCount; i++) {
+    EXPECT_THAT(store->Get(absl::StrCat("key", i)),
+                IsOkAndHolds(ElementsAreArray(
+                    Bytes(absl::StrCat("value", i)))));
+  }
+  EXPECT_THAT(store->Get("missing"), StatusIs(error::GoogleError::NOT_FOUND));
+}
+
+// Ensure that deleted keys have no value, including after reopening.
+TEST_F(SecureKeyValueStoreTest, Delete) {
+  {
+    std::unique_ptr<SecureKeyValueStore> store;
+    ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+    ASYLO_ASSERT_OK(store->Put("a", "1"));
+    ASYLO_ASSERT_OK(store->Put("b", "2"));
+    ASYLO_ASSERT_OK(store->Delete("a"));
+    EXPECT_THAT(store->Delete("a"), StatusIs(error::GoogleError::NOT_FOUND));
+    EXPECT_FALSE(store->Contains("a"));
+    EXPECT_THAT(store->Get("a"), StatusIs(error::GoogleError::NOT_FOUND));
+  }
+
+  std::unique_ptr<SecureKeyValueStore> store;
+  ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+  EXPECT_FALSE(store->Contains("a"));
+  EXPECT_TRUE(store->Contains("b"));
+  EXPECT_EQ(store->size(), 1);
+}
+
+// Ensure that compaction reclaims overwritten and deleted entries, whether the
+// rewritten log is placed after or below the current one.
+TEST_F(SecureKeyValueStoreTest, Compact) {
+  {
+    std::unique_ptr<SecureKeyValueStore> store;
+    ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+    for (int round = 0; round < 3; round++) {
+      for (int i = 0; i < 50; i++) {
+        ASYLO_ASSERT_OK(store->Put(absl::StrCat("key", i),
+                                   absl::StrCat("value", round, "-", i)));
+      }
+      ASYLO_ASSERT_OK(store->Delete(absl::StrCat("key", round)));
+      EXPECT_GT(store->log_length(), store->live_length());
+      ASYLO_ASSERT_OK(store->Compact());
+      EXPECT_EQ(store->log_length(), store->live_length());
+    }
+  }
+
+  std::unique_ptr<SecureKeyValueStore> store;
+  ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+  EXPECT_EQ(store->size(), 49);
+  EXPECT_FALSE(store->Contains("key2"));
+  EXPECT_THAT(store->Get("key10"),
+              IsOkAndHolds(ElementsAreArray(Bytes("value2-10"))));
+}
+
+// Ensure that compressed values shrink the log, are read back after the store
+// is reopened without compression, and survive compaction.
+TEST_F(SecureKeyValueStoreTest, CompressedValues) {
+  const std::string kValue(4096, 'v');
+  {
+    std::unique_ptr<SecureKeyValueStore> store;
+    ASYLO_ASSERT_OK_AND_ASSIGN(
+        store, OpenStore(kKey, /*compress_values=*/true));
+    ASYLO_ASSERT_OK(store->Put("compressible", kValue));
+    ASYLO_ASSERT_OK(store->Put("short", "x"));
+    ASYLO_ASSERT_OK(store->Put("short", "y"));
+    EXPECT_LT(store->live_length(), kValue.size());
+  }
+
+  std::unique_ptr<SecureKeyValueStore> store;
+  ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+  ASYLO_ASSERT_OK(store->Compact());
+  EXPECT_THAT(store->Get("compressible"),
+              IsOkAndHolds(ElementsAreArray(Bytes(kValue))));
+  EXPECT_THAT(store->Get("short"), IsOkAndHolds(ElementsAreArray(Bytes("y"))));
+}
+
+// Ensure that a modified entry is detected when the store is reopened.
+TEST_F(SecureKeyValueStoreTest, ModifiedLogFailsOpen) {
+  {
+    std::unique_ptr<SecureKeyValueStore> store;
+    ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+    ASYLO_ASSERT_OK(store->Put("key", "value"));
+  }
+  StatusOr<size_t> size = file_->Size();
+  ASYLO_ASSERT_OK(size);
+  TamperWith(size.ValueOrDie() - 1);
+
+  EXPECT_THAT(OpenStore(), StatusIs(error::GoogleError::DATA_LOSS));
+}
+
+// Ensure that an entry modified after the store is opened fails to be read.
+TEST_F(SecureKeyValueStoreTest, ModifiedEntryFailsGet) {
+  std::unique_ptr<SecureKeyValueStore> store;
+  ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+  ASYLO_ASSERT_OK(store->Put("key", "value"));
+  StatusOr<size_t> size = file_->Size();
+  ASYLO_ASSERT_OK(size);
+  TamperWith(size.ValueOrDie() - 1);
+
+  EXPECT_THAT(store->Get("key"), StatusIs(error::GoogleError::DATA_LOSS));
+}
+
+// Ensure that a store cannot be opened with another key.
+TEST_F(SecureKeyValueStoreTest, WrongKeyFailsOpen) {
+  {
+    std::unique_ptr<SecureKeyValueStore> store;
+    ASYLO_ASSERT_OK_AND_ASSIGN(store, OpenStore());
+    ASYLO_ASSERT_OK(store->Put("key", "value"));
+  }
+
+  std::vector<uint8_t> other_key(std::begin(kKey), std::end(kKey));
+  other_key[0] ^= 1;
+  EXPECT_THAT(OpenStore(other_key), StatusIs(error::GoogleError::DATA_LOSS));
+}
+
+}  // namespace
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
@@ -0,0 +1,607 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/storage/sqlite/secure_vfs.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "asylo/util/logging.h"
+#include "asylo/platform/crypto/gcmlib/gcm_cryptor.h"
+#include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/platform/storage/secure/aead_handler.h"
+#include "asylo/platform/storage/secure/enclave_storage_secure.h"
+#include "asylo/util/cleansing_types.h"
+#include "asylo/util/status.h"
+#include "sqlite3.h"
+
+namespace asylo {
+namespace platform {
+namespace storage {
+namespace {
+
+// Permissions of the files created by the VFS, as in the unix VFS.
+constexpr mode_t kFileMode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+
+// Length of the random part of the names of temporary files.
+constexpr int kTempFileNameRandomLength = 8;
+
+// State of a VFS registered by RegisterSecureVfs(), pointed to by its
+// pAppData. Never freed, since SQLite may use a VFS until the process exits.
+struct SecureVfs {
+  sqlite3_vfs vfs;
+  std::string name;
+  CleansingVector<uint8_t> key;
+  uint32_t block_length;
+  uint32_t write_buffer_length;
+
+  // The default VFS of SQLite when the VFS was registered, which services the
+  // calls that do not involve files.
+  sqlite3_vfs *root;
+};
+
+SecureVfs *GetSecureVfs(sqlite3_vfs *vfs) {
+  return static_cast<SecureVfs *>(vfs->pAppData);
+}
+
+// Opens |path| with secure_open() and sets its block length and master key.
+// Returns the file descriptor, or -1 on failure.
+int OpenSecureFile(const SecureVfs &vfs, const std::string &path,
+                   int open_flags) {
+  int fd = secure_open(path.c_str(), open_flags, kFileMode);
+  if (fd == -1) {
+    return -1;
+  }
+  AeadHandler &handler = AeadHandler::GetInstance();
+  if (handler.SetBlockLength(fd, vfs.block_length) != 0 ||
+      handler.SetMasterKey(fd, vfs.key.data(), vfs.key.size()) != 0) {
+    LOG(ERROR) << "Failed to set up secure file " << path;
+    secure_close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Removes the secure storage file at |path| along with its journal and Merkle
+// tree cache. Returns false with errno set if the file exists and could not be
+// removed.
+bool RemoveSecureFile(const std::string &path) {
+  return secure_unlink(path.c_str()) == 0 || errno == ENOENT;
+}
+
+// An opened file of the VFS. Writes to rollback journals and WAL files, which
+// SQLite appends to in small records, are buffered while they are contiguous,
+// and written to the file with a single secure write when the buffer fills
+// up, when the file is synced, read past the buffer, truncated or closed.
+class SecureFile {
+ public:
+  SecureFile(const SecureVfs &vfs, std::string path, int fd, int open_flags,
+             bool buffer_writes, bool delete_on_close)
+      : vfs_(vfs),
+        path_(std::move(path)),
+        fd_(fd),
+        open_flags_(open_flags),
+        buffer_writes_(buffer_writes),
+        delete_on_close_(delete_on_close),
+        buffer_offset_(0) {}
+
+  SecureFile(const SecureFile &other) = delete;
+  SecureFile &operator=(const SecureFile &other) = delete;
+
+  // Writes the buffered writes and closes the file. Returns an SQLite result
+  // code.
+  int Close() {
+    int result = FlushWriteBuffer();
+    if (secure_close(fd_) != 0 && result == SQLITE_OK) {
+      result = SQLITE_IOERR_CLOSE;
+    }
+    fd_ = -1;
+    if (delete_on_close_) {
+      RemoveSecureFile(path_);
+    }
+    return result;
+  }
+
+  int Read(void *buf, int amount, sqlite3_int64 offset) {
+    uint8_t *data = static_cast<uint8_t *>(buf);
+
+    // Reads of buffered writes, such as WAL frames read back within the
+    // transaction that wrote them, are served from the buffer.
+    if (!write_buffer_.empty() && offset >= buffer_offset_ &&
+        offset + amount <= buffer_end()) {
+      memcpy(data, write_buffer_.data() + (offset - buffer_offset_), amount);
+      return SQLITE_OK;
+    }
+    if (FlushWriteBuffer() != SQLITE_OK ||
+        secure_lseek(fd_, offset, SEEK_SET) == -1) {
+      return SQLITE_IOERR_READ;
+    }
+
+    int bytes_read = 0;
+    while (bytes_read < amount) {
+      ssize_t result = secure_read(fd_, data + bytes_read, amount - bytes_read);
+      if (result < 0) {
+        return SQLITE_IOERR_READ;
+      }
+      if (result == 0) {
+        break;
+      }
+      bytes_read += result;
+    }
+
+    // SQLite requires the rest of the buffer of a short read to be zeroed.
+    if (bytes_read < amount) {
+      memset(data + bytes_read, 0, amount - bytes_read);
+      return SQLITE_IOERR_SHORT_READ;
+    }
+    return SQLITE_OK;
+  }
+
+  int Write(const void *buf, int amount, sqlite3_int64 offset) {
+    const uint8_t *data = static_cast<const uint8_t *>(buf);
+    if (!buffer_writes_) {
+      return WriteAt(data, amount, offset) ? SQLITE_OK : SQLITE_IOERR_WRITE;
+    }
+
+    if (write_buffer_.empty() || offset != buffer_end()) {
+      if (FlushWriteBuffer() != SQLITE_OK) {
+        return SQLITE_IOERR_WRITE;
+      }
+      buffer_offset_ = offset;
+    }
+    write_buffer_.insert(write_buffer_.end(), data, data + amount);
+    if (write_buffer_.size() >= vfs_.write_buffer_length) {
+      return FlushWriteBuffer();
+    }
+    return SQLITE_OK;
+  }
+
+  int Truncate(sqlite3_int64 size) {
+    if (FlushWriteBuffer() != SQLITE_OK) {
+      return SQLITE_IOERR_TRUNCATE;
+    }
+    if (size > 0) {
+      // Secure storage files cannot be shrunk, see RegisterSecureVfs().
+      return SQLITE_OK;
+    }
+
+    // Recreate the file, which also discards its integrity metadata.
+    if (secure_close(fd_) != 0) {
+      fd_ = -1;
+      return SQLITE_IOERR_TRUNCATE;
+    }
+    fd_ = -1;
+    if (!RemoveSecureFile(path_)) {
+      return SQLITE_IOERR_TRUNCATE;
+    }
+    fd_ = OpenSecureFile(vfs_, path_, open_flags_ | O_CREAT);
+    return fd_ == -1 ? SQLITE_IOERR_TRUNCATE : SQLITE_OK;
+  }
+
+  int Sync() {
+    if (FlushWriteBuffer() != SQLITE_OK || secure_fsync(fd_) != 0) {
+      return SQLITE_IOERR_FSYNC;
+    }
+    return SQLITE_OK;
+  }
+
+  int FileSize(sqlite3_int64 *size) {
+    off_t file_size = AeadHandler::GetInstance().GetLogicalFileSize(fd_);
+    if (file_size < 0) {
+      return SQLITE_IOERR_FSTAT;
+    }
+    *size = file_size;
+    if (!write_buffer_.empty()) {
+      *size = std::max<sqlite3_int64>(*size, buffer_end());
+    }
+    return SQLITE_OK;
+  }
+
+  // Maps region |region| of |region_size| bytes of the WAL index of the file,
+  // allocating it if |extend| is set. Sets |*address| to nullptr if the region
+  // does not exist and |extend| is not set.
+  int ShmMap(int region, int region_size, bool extend,
+             void volatile **address) {
+    if (region >= static_cast<int>(shm_regions_.size())) {
+      if (!extend) {
+        *address = nullptr;
+        return SQLITE_OK;
+      }
+      while (region >= static_cast<int>(shm_regions_.size())) {
+        shm_regions_.emplace_back(new uint8_t[region_size]());
+      }
+    }
+    *address = shm_regions_[region].get();
+    return SQLITE_OK;
+  }
+
+  void ShmUnmap() { shm_regions_.clear(); }
+
+  uint32_t block_length() const { return vfs_.block_length; }
+
+ private:
+  sqlite3_int64 buffer_end() const {
+    return buffer_offset_ + write_buffer_.size();
+  }
+
+  // Writes the buffered writes to the file. Returns an SQLite result code.
+  int FlushWriteBuffer() {
+    if (write_buffer_.empty()) {
+      return SQLITE_OK;
+    }
+    bool success =
+        WriteAt(write_buffer_.data(), write_buffer_.size(), buffer_offset_);
+    write_buffer_.clear();
+    return success ? SQLITE_OK : SQLITE_IOERR_WRITE;
+  }
+
+  // Writes |size| bytes of |data| at |offset|, zero-filling the file up to
+  // |offset| if it ends before. Returns false on failure.
+  bool WriteAt(const uint8_t *data, size_t size, sqlite3_int64 offset) {
+    off_t file_size = AeadHandler::GetInstance().GetLogicalFileSize(fd_);
+    if (file_size < 0) {
+      return false;
+    }
+    if (file_size < offset) {
+      std::vector<uint8_t> zeros(offset - file_size);
+      if (!WriteAt(zeros.data(), zeros.size(), file_size)) {
+        return false;
+      }
+    }
+
+    if (secure_lseek(fd_, offset, SEEK_SET) == -1) {
+      return false;
+    }
+    size_t bytes_written = 0;
+    while (bytes_written < size) {
+      ssize_t result =
+          secure_write(fd_, data + bytes_written, size - bytes_written);
+      if (result <= 0) {
+        LOG(ERROR) << "Failed to write to secure file " << path_;
+        return false;
+      }
+      bytes_written += result;
+    }
+    return true;
+  }
+
+  const SecureVfs &vfs_;
+  const std::string path_;
+  int fd_;
+  const int open_flags_;
+  const bool buffer_writes_;
+  const bool delete_on_close_;
+
+  // Contiguous writes not yet written to the file, and the offset they start
+  // at.
+  CleansingVector<uint8_t> write_buffer_;
+  sqlite3_int64 buffer_offset_;
+
+  // Regions of the WAL index, which is never shared with other connections.
+  std::vector<std::unique_ptr<uint8_t[]>> shm_regions_;
+};
+
+// The sqlite3_file allocated by SQLite for a file of the VFS.
+struct SecureFileHandle {
+  sqlite3_file base;
+  SecureFile *file;
+};
+
+SecureFile *GetSecureFile(sqlite3_file *handle) {
+  return reinterpret_cast<SecureFileHandle *>(handle)->file;
+}
+
+int SecureFileClose(sqlite3_file *handle) {
+  SecureFile *file = GetSecureFile(handle);
+  int result = file->Close();
+  delete file;
+  return result;
+}
+
+int SecureFileRead(sqlite3_file *handle, void *buf, int amount,
+                   sqlite3_int64 offset) {
+  return GetSecureFile(handle)->Read(buf, amount, offset);
+}
+
+int SecureFileWrite(sqlite3_file *handle, const void *buf, int amount,
+                    sqlite3_int64 offset) {
+  return GetSecureFile(handle)->Write(buf, amount, offset);
+}
+
+int SecureFileTruncate(sqlite3_file *handle, sqlite3_int64 size) {
+  return GetSecureFile(handle)->Truncate(size);
+}
+
+int SecureFileSync(sqlite3_file *handle, int flags) {
+  return GetSecureFile(handle)->Sync();
+}
+
+int SecureFileFileSize(sqlite3_file *handle, sqlite3_int64 *size) {
+  return GetSecureFile(handle)->FileSize(size);
+}
+
+// File locks are not enforced, see RegisterSecureVfs().
+int SecureFileLock(sqlite3_file *handle, int lock) { return SQLITE_OK; }
+
+int SecureFileUnlock(sqlite3_file *handle, int lock) { return SQLITE_OK; }
+
+int SecureFileCheckReservedLock(sqlite3_file *handle, int *result) {
+  *result = 0;
+  return SQLITE_OK;
+}
+
+int SecureFileFileControl(sqlite3_file *handle, int op, void *arg) {
+  return SQLITE_NOTFOUND;
+}
+
+// Reports the block length as the sector size, so that SQLite aligns the
+// records of rollback journals to blocks where it can.
+int SecureFileSectorSize(sqlite3_file *handle) {
+  return GetSecureFile(handle)->block_length();
+}
+
+// Writes to secure storage files are journaled, so a write never damages the
+// data around it on a crash.
+int SecureFileDeviceCharacteristics(sqlite3_file *handle) {
+  return SQLITE_IOCAP_POWERSAFE_OVERWRITE;
+}
+
+int SecureFileShmMap(sqlite3_file *handle, int region, int region_size,
+                     int extend, void volatile **address) {
+  return GetSecureFile(handle)->ShmMap(region, region_size, extend != 0,
+                                       address);
+}
+
+int SecureFileShmLock(sqlite3_file *handle, int offset, int count, int flags) {
+  return SQLITE_OK;
+}
+
+void SecureFileShmBarrier(sqlite3_file *handle) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+int SecureFileShmUnmap(sqlite3_file *handle, int delete_flag) {
+  GetSecureFile(handle)->ShmUnmap();
+  return SQLITE_OK;
+}
+
+const sqlite3_io_methods kSecureFileMethods = {
+    /*iVersion=*/2,
+    SecureFileClose,
+    SecureFileRead,
+    SecureFileWrite,
+    SecureFileTruncate,
+    SecureFileSync,
+    SecureFileFileSize,
+    SecureFileLock,
+    SecureFileUnlock,
+    SecureFileCheckReservedLock,
+    SecureFileFileControl,
+    SecureFileSectorSize,
+    SecureFileDeviceCharacteristics,
+    SecureFileShmMap,
+    SecureFileShmLock,
+    SecureFileShmBarrier,
+    SecureFileShmUnmap,
+    /*xFetch=*/nullptr,
+    /*xUnfetch=*/nullptr,
+};
+
+// Returns a path for a new temporary file.
+std::string TempFilePath(const SecureVfs &vfs) {
+  char random[kTempFileNameRandomLength];
+  vfs.root->xRandomness(vfs.root, sizeof(random), random);
+  const char *directory =
+      sqlite3_temp_directory ? sqlite3_temp_directory : "/tmp";
+  return absl::StrCat(directory, "/asylo_sqlite_",
+                      absl::BytesToHexString(
+                          absl::string_view(random, sizeof(random))));
+}
+
+int SecureVfsOpen(sqlite3_vfs *vfs, const char *name, sqlite3_file *handle,
+                  int flags, int *out_flags) {
+  const SecureVfs &secure_vfs = *GetSecureVfs(vfs);
+  handle->pMethods = nullptr;
+
+  std::string path = name ? name : TempFilePath(secure_vfs);
+  int open_flags = (flags & SQLITE_OPEN_READWRITE) ? O_RDWR : O_RDONLY;
+  if (flags & SQLITE_OPEN_CREATE) {
+    open_flags |= O_CREAT;
+  }
+  if (flags & SQLITE_OPEN_EXCLUSIVE) {
+    open_flags |= O_EXCL;
+  }
+
+  int fd = OpenSecureFile(secure_vfs, path, open_flags);
+  if (fd == -1) {
+    return SQLITE_CANTOPEN;
+  }
+
+  bool buffer_writes =
+      flags & (SQLITE_OPEN_MAIN_JOURNAL | SQLITE_OPEN_TEMP_JOURNAL |
+               SQLITE_OPEN_SUBJOURNAL | SQLITE_OPEN_MASTER_JOURNAL |
+               SQLITE_OPEN_WAL);
+  bool delete_on_close = !name || (flags & SQLITE_OPEN_DELETEONCLOSE);
+  reinterpret_cast<SecureFileHandle *>(handle)->file =
+      new SecureFile(secure_vfs, std::move(path), fd, open_flags & ~O_EXCL,
+                     buffer_writes, delete_on_close);
+  handle->pMethods = &kSecureFileMethods;
+  if (out_flags) {
+    *out_flags = flags;
+  }
+  return SQLITE_OK;
+}
+
+int SecureVfsDelete(sqlite3_vfs *vfs, const char *name, int sync_dir) {
+  return RemoveSecureFile(name) ? SQLITE_OK : SQLITE_IOERR_DELETE;
+}
+
+int SecureVfsAccess(sqlite3_vfs *vfs, const char *name, int flags,
+                    int *result) {
+  int mode = F_OK;
+  if (flags == SQLITE_ACCESS_READWRITE) {
+    mode = R_OK | W_OK;
+  } else if (flags == SQLITE_ACCESS_READ) {
+    mode = R_OK;
+  }
+  *result = enc_untrusted_access(name, mode) == 0;
+  return SQLITE_OK;
+}
+
+// Secure storage requires absolute paths. Relative paths are resolved against
+// the current working directory.
+int SecureVfsFullPathname(sqlite3_vfs *vfs, const char *name, int out_size,
+                          char *out) {
+  std::string path;
+  if (name[0] == '/') {
+    path = name;
+  } else {
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd))) {
+      return SQLITE_CANTOPEN;
+    }
+    path = absl::StrCat(cwd, "/", name);
+  }
+  if (path.size() >= static_cast<size_t>(out_size)) {
+    return SQLITE_CANTOPEN;
+  }
+  memcpy(out, path.c_str(), path.size() + 1);
+  return SQLITE_OK;
+}
+
+// Enclaves cannot load shared libraries.
+void *SecureVfsDlOpen(sqlite3_vfs *vfs, const char *filename) {
+  return nullptr;
+}
+
+void SecureVfsDlError(sqlite3_vfs *vfs, int size, char *message) {
+  sqlite3_snprintf(size, message, "Loadable extensions are not supported");
+}
+
+void (*SecureVfsDlSym(sqlite3_vfs *vfs, void *library, const char *symbol))(
+    void) {
+  return nullptr;
+}
+
+void SecureVfsDlClose(sqlite3_vfs *vfs, void *library) {}
+
+int SecureVfsRandomness(sqlite3_vfs *vfs, int size, char *out) {
+  sqlite3_vfs *root = GetSecureVfs(vfs)->root;
+  return root->xRandomness(root, size, out);
+}
+
+int SecureVfsSleep(sqlite3_vfs *vfs, int microseconds) {
+  sqlite3_vfs *root = GetSecureVfs(vfs)->root;
+  return root->xSleep(root, microseconds);
+}
+
+int SecureVfsCurrentTime(sqlite3_vfs *vfs, double *time) {
+  sqlite3_vfs *root = GetSecureVfs(vfs)->root;
+  return root->xCurrentTime(root, time);
+}
+
+int SecureVfsGetLastError(sqlite3_vfs *vfs, int size, char *message) {
+  sqlite3_vfs *root = GetSecureVfs(vfs)->root;
+  return root->xGetLastError(root, size, message);
+}
+
+int SecureVfsCurrentTimeInt64(sqlite3_vfs *vfs, sqlite3_int64 *time) {
+  sqlite3_vfs *root = GetSecureVfs(vfs)->root;
+  return root->xCurrentTimeInt64(root, time);
+}
+
+}  // namespace
+
+Status RegisterSecureVfs(const SecureVfsOptions &options) {
+  if (options.key.size() != crypto::gcmlib::kKeyLength) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  absl::StrCat("Key must be ", crypto::gcmlib::kKeyLength,
+                               " bytes long"));
+  }
+  if (options.block_length < kMinBlockLength ||
+      options.block_length > kMaxBlockLength ||
+      (options.block_length & (options.block_length - 1)) != 0) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  absl::StrCat("Invalid block length: ", options.block_length));
+  }
+
+  int result = sqlite3_initialize();
+  if (result != SQLITE_OK) {
+    return Status(error::GoogleError::INTERNAL,
+                  absl::StrCat("Failed to initialize SQLite: ",
+                               sqlite3_errstr(result)));
+  }
+  sqlite3_vfs *root = sqlite3_vfs_find(nullptr);
+  if (!root || root->iVersion < 2) {
+    return Status(error::GoogleError::FAILED_PRECONDITION,
+                  "SQLite has no suitable default VFS");
+  }
+
+  auto *secure_vfs = new SecureVfs;
+  secure_vfs->name = options.name;
+  secure_vfs->key = options.key;
+  secure_vfs->block_length = options.block_length;
+  secure_vfs->write_buffer_length = options.write_buffer_length;
+  secure_vfs->root = root;
+
+  sqlite3_vfs &vfs = secure_vfs->vfs;
+  memset(&vfs, 0, sizeof(vfs));
+  vfs.iVersion = 2;
+  vfs.szOsFile = sizeof(SecureFileHandle);
+  vfs.mxPathname = PATH_MAX;
+  vfs.zName = secure_vfs->name.c_str();
+  vfs.pAppData = secure_vfs;
+  vfs.xOpen = SecureVfsOpen;
+  vfs.xDelete = SecureVfsDelete;
+  vfs.xAccess = SecureVfsAccess;
+  vfs.xFullPathname = SecureVfsFullPathname;
+  vfs.xDlOpen = SecureVfsDlOpen;
+  vfs.xDlError = SecureVfsDlError;
+  vfs.xDlSym = SecureVfsDlSym;
+  vfs.xDlClose = SecureVfsDlClose;
+  vfs.xRandomness = SecureVfsRandomness;
+  vfs.xSleep = SecureVfsSleep;
+  vfs.xCurrentTime = SecureVfsCurrentTime;
+  vfs.xGetLastError = SecureVfsGetLastError;
+  vfs.xCurrentTimeInt64 = SecureVfsCurrentTimeInt64;
+
+  result = sqlite3_vfs_register(&vfs, options.make_default);
+  if (result != SQLITE_OK) {
+    return Status(error::GoogleError::INTERNAL,
+                  absl::StrCat("Failed to register VFS ", options.name, ": ",
+                               sqlite3_errstr(result)));
+  }
+  return Status::OkStatus();
+}
+
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
@@ -0,0 +1,78 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_STORAGE_SQLITE_SECURE_VFS_H_
+#define ASYLO_PLATFORM_STORAGE_SQLITE_SECURE_VFS_H_
+
+#include <cstdint>
+#include <string>
+
+#include "asylo/util/cleansing_types.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+namespace platform {
+namespace storage {
+
+// Options of the SQLite VFS backed by secure storage.
+struct SecureVfsOptions {
+  // Name the VFS is registered under, to be passed to sqlite3_open_v2().
+  std::string name = "asylo-secure";
+
+  // Master key of all the files of the VFS, of crypto::gcmlib::kKeyLength
+  // bytes.
+  CleansingVector<uint8_t> key;
+
+  // AEAD block length of the files created by the VFS. Databases whose page
+  // size equals the block length have every page sealed in a block, and
+  // hashed into a Merkle leaf, of its own, so that page writes never rewrite
+  // their neighbours. Must be a valid secure storage block length, which
+  // includes every SQLite page size from 512 bytes up. Existing files keep the
+  // block length they were created with.
+  uint32_t block_length = 4096;
+
+  // Amount of contiguous rollback journal and WAL writes to buffer in the
+  // enclave before writing them to the file with a single secure write.
+  // Buffered writes are flushed on sync, on reads and on close.
+  uint32_t write_buffer_length = 256 * 1024;
+
+  // Whether to make the VFS the default VFS of SQLite.
+  bool make_default = false;
+};
+
+// Registers a SQLite VFS that stores databases, rollback journals, WAL files
+// and temporary files as secure storage files, through secure_open() and
+// friends, so that their contents are encrypted and integrity-protected on the
+// host. Calls sqlite3_initialize(), so SQLite can no longer be configured with
+// sqlite3_config() afterwards.
+//
+// Only one connection at a time may open each database through the VFS: file
+// locks are not enforced, and the WAL index of a database lives in the enclave
+// memory of its connection. Secure storage files cannot be shrunk, so
+// truncating a file to a non-zero length leaves it as is, which SQLite
+// tolerates: it relies on the database size recorded in the database header,
+// and on the checksums of WAL frames. Truncating a file to zero recreates it.
+//
+// Must only be called inside an enclave.
+Status RegisterSecureVfs(const SecureVfsOptions &options);
+
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_STORAGE_SQLITE_SECURE_VFS_H_
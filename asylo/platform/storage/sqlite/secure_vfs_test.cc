@@ -0,0 +1,183 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/storage/sqlite/secure_vfs.h"
+
+#include <fcntl.h>
+#include <openssl/rand.h>
+#include <stdio.h>
+
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/flags/flag.h"
+#include "absl/strings/str_cat.h"
+#include "asylo/platform/crypto/gcmlib/gcm_cryptor.h"
+#include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/test/util/test_flags.h"
+#include "asylo/util/cleansing_types.h"
+#include "sqlite3.h"
+
+namespace asylo {
+namespace platform {
+namespace storage {
+namespace {
+
+using ::testing::Eq;
+using ::testing::HasSubstr;
+using ::testing::Not;
+
+constexpr char kVfsName[] = "secure_vfs_test";
+
+class SecureVfsTest : public ::testing::Test {
+ protected:
+  static void SetUpTestSuite() {
+    SecureVfsOptions options;
+    options.name = kVfsName;
+    options.key.resize(crypto::gcmlib::kKeyLength);
+    ASSERT_EQ(RAND_bytes(options.key.data(), options.key.size()), 1);
+    ASYLO_ASSERT_OK(RegisterSecureVfs(options));
+  }
+
+  void SetUp() override {
+    path_ = absl::StrCat(absl::GetFlag(FLAGS_test_tmpdir), "/",
+                         ::testing::UnitTest::GetInstance()
+                             ->current_test_info()
+                             ->name(),
+                         ".db");
+    for (const char *suffix : {"", "-journal", "-wal"}) {
+      remove(absl::StrCat(path_, suffix).c_str());
+    }
+  }
+
+  sqlite3 *Open() {
+    sqlite3 *db = nullptr;
+    EXPECT_EQ(sqlite3_open_v2(path_.c_str(), &db,
+                              SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
+                              kVfsName),
+              SQLITE_OK);
+    return db;
+  }
+
+  // Runs |sql| and returns the first column of its last result row, if any.
+  static std::string Exec(sqlite3 *db, const std::string &sql) {
+    std::string result;
+    char *error = nullptr;
+    int rc = sqlite3_exec(
+        db, sql.c_str(),
+        [](void *out, int columns, char **values, char **names) {
+          *static_cast<std::string *>(out) = values[0] ? values[0] : "";
+          return 0;
+        },
+        &result, &error);
+    EXPECT_EQ(rc, SQLITE_OK) << sql << ": " << (error ? error : "");
+    sqlite3_free(error);
+    return result;
+  }
+
+  // Fills table t of |db| with |rows| rows, in a single transaction.
+  static void Fill(sqlite3 *db, int rows) {
+    Exec(db, "CREATE TABLE t(id INTEGER PRIMARY KEY, value TEXT)");
+    Exec(db, "BEGIN");
+    for (int i = 0; i < rows; ++i) {
+      Exec(db, absl::StrCat("INSERT INTO t(value) VALUES('plaintext-", i,
+                            "')"));
+    }
+    Exec(db, "COMMIT");
+  }
+
+  std::string path_;
+};
+
+TEST_F(SecureVfsTest, RejectsInvalidKey) {
+  SecureVfsOptions options;
+  options.name = "secure_vfs_test_invalid";
+  options.key.resize(crypto::gcmlib::kKeyLength - 1);
+  EXPECT_THAT(RegisterSecureVfs(options), Not(IsOk()));
+}
+
+TEST_F(SecureVfsTest, PersistsRollbackJournalDatabase) {
+  sqlite3 *db = Open();
+  ASSERT_NE(db, nullptr);
+  Fill(db, 1000);
+  Exec(db, "DELETE FROM t WHERE id % 2 = 0");
+  ASSERT_EQ(sqlite3_close(db), SQLITE_OK);
+
+  db = Open();
+  ASSERT_NE(db, nullptr);
+  EXPECT_THAT(Exec(db, "SELECT COUNT(*) FROM t"), Eq("500"));
+  EXPECT_THAT(Exec(db, "PRAGMA integrity_check"), Eq("ok"));
+  ASSERT_EQ(sqlite3_close(db), SQLITE_OK);
+}
+
+TEST_F(SecureVfsTest, RollsBackTransactions) {
+  sqlite3 *db = Open();
+  ASSERT_NE(db, nullptr);
+  Fill(db, 100);
+  Exec(db, "BEGIN");
+  Exec(db, "UPDATE t SET value = 'updated'");
+  Exec(db, "INSERT INTO t(value) SELECT value FROM t");
+  Exec(db, "ROLLBACK");
+  EXPECT_THAT(Exec(db, "SELECT COUNT(*) FROM t WHERE value = 'updated'"),
+              Eq("0"));
+  EXPECT_THAT(Exec(db, "SELECT COUNT(*) FROM t"), Eq("100"));
+  ASSERT_EQ(sqlite3_close(db), SQLITE_OK);
+}
+
+TEST_F(SecureVfsTest, PersistsWalDatabase) {
+  sqlite3 *db = Open();
+  ASSERT_NE(db, nullptr);
+  EXPECT_THAT(Exec(db, "PRAGMA journal_mode=WAL"), Eq("wal"));
+  Fill(db, 1000);
+  Exec(db, "PRAGMA wal_checkpoint");
+  Exec(db, "UPDATE t SET value = 'updated' WHERE id <= 10");
+  ASSERT_EQ(sqlite3_close(db), SQLITE_OK);
+
+  db = Open();
+  ASSERT_NE(db, nullptr);
+  EXPECT_THAT(Exec(db, "SELECT COUNT(*) FROM t WHERE value = 'updated'"),
+              Eq("10"));
+  EXPECT_THAT(Exec(db, "PRAGMA integrity_check"), Eq("ok"));
+  ASSERT_EQ(sqlite3_close(db), SQLITE_OK);
+}
+
+TEST_F(SecureVfsTest, EncryptsDatabaseFile) {
+  sqlite3 *db = Open();
+  ASSERT_NE(db, nullptr);
+  Fill(db, 100);
+  ASSERT_EQ(sqlite3_close(db), SQLITE_OK);
+
+  int fd = enc_untrusted_open(path_.c_str(), O_RDONLY);
+  ASSERT_NE(fd, -1);
+  std::string contents;
+  char buffer[4096];
+  ssize_t bytes_read;
+  while ((bytes_read = enc_untrusted_read(fd, buffer, sizeof(buffer))) > 0) {
+    contents.append(buffer, bytes_read);
+  }
+  enc_untrusted_close(fd);
+  EXPECT_THAT(contents, Not(HasSubstr("plaintext-")));
+  EXPECT_THAT(contents, Not(HasSubstr("SQLite format 3")));
+}
+
+}  // namespace
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
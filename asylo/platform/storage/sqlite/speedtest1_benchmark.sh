@@ -0,0 +1,53 @@
+#!/bin/bash
+#
+# Copyright 2020 Asylo authors
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+# Runs speedtest1 natively, inside an enclave over plaintext files, and inside
+# an enclave over the secure VFS, each on a fresh database, and prints the
+# total time of each run. The arguments of the script are passed to every run
+# of speedtest1, for instance "--size 50" or "--journal wal". The full output
+# of each run is written next to its database in $OUTPUT_DIR, or in a temporary
+# directory that is removed afterwards.
+
+set -e
+
+readonly PACKAGE="asylo/platform/storage/sqlite"
+readonly NATIVE_SPEEDTEST="${PACKAGE}/speedtest1"
+readonly ENCLAVE_SPEEDTEST="${PACKAGE}/speedtest1_enclave_sgx_sim"
+
+if [[ -n "${OUTPUT_DIR}" ]]; then
+  WORK_DIR="${OUTPUT_DIR}"
+  mkdir -p "${WORK_DIR}"
+else
+  WORK_DIR="$(mktemp -d)"
+  trap 'rm -rf "${WORK_DIR}"' EXIT
+fi
+
+# Runs speedtest1 in mode $1 with the command $2..., on database $1.db of the
+# work directory.
+function run_mode() {
+  local mode="$1"
+  shift
+  local db="${WORK_DIR}/${mode}.db"
+  rm -f "${db}"*
+  "$@" "${db}" > "${WORK_DIR}/${mode}.txt" 2>&1
+  printf "%-10s %s\n" "${mode}" \
+    "$(grep TOTAL "${WORK_DIR}/${mode}.txt" | tr -s ' .')"
+}
+
+run_mode native "${NATIVE_SPEEDTEST}" "$@"
+run_mode plaintext "${ENCLAVE_SPEEDTEST}" "$@"
+run_mode secure "${ENCLAVE_SPEEDTEST}" --vfs asylo-secure "$@"
@@ -0,0 +1,47 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Runs speedtest1 with the secure VFS registered under its default name, so
+// that passing "--vfs asylo-secure" benchmarks databases kept in secure
+// storage. The VFS key is random, so databases only last for a single run.
+
+#include <openssl/rand.h>
+
+#include "asylo/util/logging.h"
+#include "asylo/platform/crypto/gcmlib/gcm_cryptor.h"
+#include "asylo/platform/storage/sqlite/secure_vfs.h"
+#include "asylo/util/status.h"
+
+// The main() of speedtest1.c, renamed at compile time.
+extern "C" int Speedtest1Main(int argc, char **argv);
+
+int main(int argc, char **argv) {
+  asylo::platform::storage::SecureVfsOptions options;
+  options.key.resize(asylo::platform::crypto::gcmlib::kKeyLength);
+  if (RAND_bytes(options.key.data(), options.key.size()) != 1) {
+    LOG(ERROR) << "Failed to generate a secure VFS key";
+    return 1;
+  }
+  asylo::Status status =
+      asylo::platform::storage::RegisterSecureVfs(options);
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to register the secure VFS: " << status;
+    return 1;
+  }
+  return Speedtest1Main(argc, argv);
+}
@@ -0,0 +1,84 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/storage/utils/group_commit_storage.h"
+
+namespace asylo {
+
+GroupCommitStorage::GroupCommitStorage(RandomAccessStorage *io)
+    : io_(io),
+      requested_(0),
+      completed_(0),
+      syncing_(false),
+      sync_count_(0) {}
+
+StatusOr<size_t> GroupCommitStorage::Size() const {
+  absl::MutexLock lock(&io_mu_);
+  return io_->Size();
+}
+
+Status GroupCommitStorage::Read(void *buffer, off_t offset, size_t size) {
+  absl::MutexLock lock(&io_mu_);
+  return io_->Read(buffer, offset, size);
+}
+
+Status GroupCommitStorage::Write(const void *buffer, off_t offset,
+                                 size_t size) {
+  absl::MutexLock lock(&io_mu_);
+  return io_->Write(buffer, offset, size);
+}
+
+Status GroupCommitStorage::Sync() {
+  absl::MutexLock lock(&sync_mu_);
+  const uint64_t ticket = ++requested_;
+
+  // Wait for a synchronization in progress, which may have started before the
+  // writes this call is meant to commit, then lead the next one unless another
+  // thread leads it first.
+  auto can_proceed = [this, ticket]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(sync_mu_) {
+    return completed_ >= ticket || !syncing_;
+  };
+  sync_mu_.Await(absl::Condition(&can_proceed));
+  if (completed_ >= ticket) {
+    return status_;
+  }
+
+  // Lead a synchronization covering all calls made so far.
+  syncing_ = true;
+  const uint64_t covered = requested_;
+  sync_mu_.Unlock();
+  Status status = io_->Sync();
+  sync_mu_.Lock();
+  syncing_ = false;
+  completed_ = covered;
+  status_ = status;
+  sync_count_++;
+  return status;
+}
+
+Status GroupCommitStorage::Truncate(size_t size) {
+  absl::MutexLock lock(&io_mu_);
+  return io_->Truncate(size);
+}
+
+uint64_t GroupCommitStorage::sync_count() const {
+  absl::MutexLock lock(&sync_mu_);
+  return sync_count_;
+}
+
+}  // namespace asylo
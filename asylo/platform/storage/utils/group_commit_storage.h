@@ -0,0 +1,98 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_STORAGE_UTILS_GROUP_COMMIT_STORAGE_H_
+#define ASYLO_PLATFORM_STORAGE_UTILS_GROUP_COMMIT_STORAGE_H_
+
+#include <cstdint>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "asylo/platform/storage/utils/random_access_storage.h"
+
+namespace asylo {
+
+// A thread-safe RandomAccessStorage that forwards to another storage resource
+// and commits concurrent calls to Sync() as a group. A thread calling Sync()
+// while a synchronization of the underlying resource is in progress waits for
+// it to complete, then joins the threads that called Sync() in the meantime in
+// a single synchronization covering all of their writes. Several RecordStore
+// instances flushed from different threads through the same GroupCommitStorage
+// thus share synchronizations instead of each paying for one.
+//
+// Reads, writes, and truncations of the underlying resource are serialized,
+// and do not wait for synchronizations in progress.
+class GroupCommitStorage : public RandomAccessStorage {
+ public:
+  // Creates a GroupCommitStorage forwarding to |io|. The GroupCommitStorage
+  // does not take ownership of |io| and it is the responsibility of the caller
+  // to ensure it remains valid over the lifetime of the GroupCommitStorage.
+  // |io| must support a call to Sync() concurrently with any other call.
+  explicit GroupCommitStorage(RandomAccessStorage *io);
+
+  GroupCommitStorage(const GroupCommitStorage &) = delete;
+  GroupCommitStorage &operator=(const GroupCommitStorage &) = delete;
+
+  StatusOr<size_t> Size() const override ABSL_LOCKS_EXCLUDED(io_mu_);
+
+  Status Read(void *buffer, off_t offset, size_t size) override
+      ABSL_LOCKS_EXCLUDED(io_mu_);
+
+  Status Write(const void *buffer, off_t offset, size_t size) override
+      ABSL_LOCKS_EXCLUDED(io_mu_);
+
+  // Synchronizes the underlying resource, as part of a group commit. Returns
+  // once a synchronization that started after the call completed, with the
+  // status of that synchronization.
+  Status Sync() override ABSL_LOCKS_EXCLUDED(sync_mu_);
+
+  Status Truncate(size_t size) override ABSL_LOCKS_EXCLUDED(io_mu_);
+
+  // Returns the number of synchronizations of the underlying resource.
+  uint64_t sync_count() const ABSL_LOCKS_EXCLUDED(sync_mu_);
+
+ private:
+  RandomAccessStorage *const io_;
+
+  // Serializes calls to |io_| other than Sync().
+  mutable absl::Mutex io_mu_;
+
+  // Protects the group commit state.
+  mutable absl::Mutex sync_mu_;
+
+  // Number of calls to Sync() made so far, which is the ticket of the latest
+  // call.
+  uint64_t requested_ ABSL_GUARDED_BY(sync_mu_);
+
+  // Ticket of the latest call to Sync() covered by a completed
+  // synchronization.
+  uint64_t completed_ ABSL_GUARDED_BY(sync_mu_);
+
+  // True while a synchronization of |io_| is in progress.
+  bool syncing_ ABSL_GUARDED_BY(sync_mu_);
+
+  // Status of the latest completed synchronization.
+  Status status_ ABSL_GUARDED_BY(sync_mu_);
+
+  // Number of synchronizations of |io_|.
+  uint64_t sync_count_ ABSL_GUARDED_BY(sync_mu_);
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_STORAGE_UTILS_GROUP_COMMIT_STORAGE_H_
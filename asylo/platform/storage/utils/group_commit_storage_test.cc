@@ -0,0 +1,132 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/storage/utils/group_commit_storage.h"
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "asylo/platform/storage/utils/fd_closer.h"
+#include "asylo/platform/storage/utils/record_store.h"
+#include "asylo/platform/storage/utils/test_utils.h"
+#include "asylo/platform/storage/utils/untrusted_file.h"
+#include "asylo/test/util/status_matchers.h"
+
+namespace asylo {
+namespace {
+
+// A RandomAccessStorage forwarding to another one, with slow calls to Sync().
+class SlowSyncStorage : public RandomAccessStorage {
+ public:
+  explicit SlowSyncStorage(RandomAccessStorage *io) : io_(io), syncs_(0) {}
+
+  StatusOr<size_t> Size() const override { return io_->Size(); }
+
+  Status Read(void *buffer, off_t offset, size_t size) override {
+    return io_->Read(buffer, offset, size);
+  }
+
+  Status Write(const void *buffer, off_t offset, size_t size) override {
+    return io_->Write(buffer, offset, size);
+  }
+
+  Status Sync() override {
+    syncs_++;
+    absl::SleepFor(absl::Milliseconds(5));
+    return io_->Sync();
+  }
+
+  Status Truncate(size_t size) override { return io_->Truncate(size); }
+
+  int syncs() const { return syncs_.load(); }
+
+ private:
+  RandomAccessStorage *io_;
+  std::atomic<int> syncs_;
+};
+
+// Ensure that a single call to Sync() synchronizes the underlying storage.
+TEST(GroupCommitStorageTest, SingleSync) {
+  int fd = CreateEmptyTempFileOrDie("single_sync.tmp");
+  platform::storage::FdCloser closer(fd);
+  UntrustedFile file(fd);
+  SlowSyncStorage slow(&file);
+  GroupCommitStorage storage(&slow);
+
+  size_t value = 42;
+  ASYLO_ASSERT_OK(storage.Write(&value, 0, sizeof(value)));
+  ASYLO_ASSERT_OK(storage.Sync());
+  ASYLO_ASSERT_OK(storage.Sync());
+  EXPECT_EQ(slow.syncs(), 2);
+  EXPECT_EQ(storage.sync_count(), 2);
+  EXPECT_THAT(storage.Size(), IsOkAndHolds(sizeof(value)));
+
+  value = 0;
+  ASYLO_ASSERT_OK(storage.Read(&value, 0, sizeof(value)));
+  EXPECT_EQ(value, 42);
+}
+
+// Ensure that concurrent flushes of record stores sharing a GroupCommitStorage
+// share synchronizations of the underlying storage, and that every record is
+// written.
+TEST(GroupCommitStorageTest, ConcurrentFlushes) {
+  int fd = CreateEmptyTempFileOrDie("concurrent_flushes.tmp");
+  platform::storage::FdCloser closer(fd);
+  UntrustedFile file(fd);
+  SlowSyncStorage slow(&file);
+  GroupCommitStorage storage(&slow);
+
+  constexpr int kThreads = 8;
+  constexpr int kFlushesPerThread = 10;
+  constexpr size_t kRecordsPerThread = 16;
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; i++) {
+    threads.emplace_back([&storage, i] {
+      RecordStore<size_t> records(kRecordsPerThread, &storage);
+      for (int j = 0; j < kFlushesPerThread; j++) {
+        for (size_t k = 0; k < kRecordsPerThread; k++) {
+          size_t index = i * kRecordsPerThread + k;
+          ASYLO_EXPECT_OK(records.Write(index * sizeof(size_t), index + j));
+        }
+        ASYLO_EXPECT_OK(records.Flush());
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_LT(slow.syncs(), kThreads * kFlushesPerThread);
+  EXPECT_EQ(storage.sync_count(), slow.syncs());
+  for (size_t index = 0; index < kThreads * kRecordsPerThread; index++) {
+    size_t record;
+    ASYLO_EXPECT_OK(
+        file.Read(&record, index * sizeof(size_t), sizeof(size_t)));
+    EXPECT_EQ(record, index + kFlushesPerThread - 1);
+  }
+}
+
+}  // namespace
+}  // namespace asylo
@@ -0,0 +1,166 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/storage/utils/mmap_untrusted_file.h"
+
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include "absl/memory/memory.h"
+#include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/posix_error_space.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace {
+
+// Minimum length of the mapping of a file. Longer mappings are powers of two,
+// so that a growing file is remapped a logarithmic number of times.
+constexpr size_t kMinMappingLength = 64 * 1024;
+
+// Returns the length of a mapping able to hold |size| bytes.
+size_t MappingLength(size_t size) {
+  size_t length = kMinMappingLength;
+  while (length < size) {
+    length *= 2;
+  }
+  return length;
+}
+
+}  // namespace
+
+MmapUntrustedFile::MmapUntrustedFile(int host_fd)
+    : host_fd_(host_fd), size_(0), mapping_(nullptr), mapping_length_(0) {}
+
+StatusOr<std::unique_ptr<MmapUntrustedFile>> MmapUntrustedFile::Create(
+    int host_fd) {
+  off_t size = enc_untrusted_lseek(host_fd, 0, SEEK_END);
+  if (size == -1) {
+    return Status{static_cast<error::PosixError>(errno),
+                  "lseek() failed in MmapUntrustedFile::Create()"};
+  }
+
+  auto file = absl::WrapUnique(new MmapUntrustedFile(host_fd));
+  file->size_ = size;
+  ASYLO_RETURN_IF_ERROR(file->Map(size));
+  return std::move(file);
+}
+
+MmapUntrustedFile::~MmapUntrustedFile() {
+  Status result = Sync();
+  if (!result.ok()) {
+    LOG(ERROR) << "Unexpected failure in Sync() when closing an "
+                  "MmapUntrustedFile: "
+               << result;
+  }
+  result = Unmap();
+  if (!result.ok()) {
+    LOG(ERROR) << "Unexpected failure in Unmap() when closing an "
+                  "MmapUntrustedFile: "
+               << result;
+  }
+}
+
+Status MmapUntrustedFile::Map(size_t size) {
+  size_t length = MappingLength(size);
+  void *mapping = enc_untrusted_mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                                     MAP_SHARED, host_fd_, 0);
+  if (mapping == MAP_FAILED) {
+    return Status{static_cast<error::PosixError>(errno),
+                  "mmap() failed in MmapUntrustedFile::Map()"};
+  }
+
+  // Only release the existing mapping once the new one is established, so
+  // that the file stays mapped on failure.
+  Status status = Unmap();
+  mapping_ = static_cast<uint8_t *>(mapping);
+  mapping_length_ = length;
+  return status;
+}
+
+Status MmapUntrustedFile::Unmap() {
+  if (!mapping_) {
+    return Status::OkStatus();
+  }
+
+  if (enc_untrusted_munmap(mapping_, mapping_length_) != 0) {
+    return Status{static_cast<error::PosixError>(errno),
+                  "munmap() failed in MmapUntrustedFile::Unmap()"};
+  }
+  mapping_ = nullptr;
+  mapping_length_ = 0;
+  return Status::OkStatus();
+}
+
+Status MmapUntrustedFile::Read(void *buffer, off_t offset, size_t size) {
+  if (offset < 0 || offset + size > size_) {
+    return Status{error::NOT_FOUND,
+                  "Read beyond the end of file in MmapUntrustedFile::Read()"};
+  }
+
+  memcpy(buffer, mapping_ + offset, size);
+  return Status::OkStatus();
+}
+
+StatusOr<size_t> MmapUntrustedFile::Size() const { return size_; }
+
+Status MmapUntrustedFile::Sync() {
+  if (!mapping_ || size_ == 0) {
+    return Status::OkStatus();
+  }
+
+  if (enc_untrusted_msync(mapping_, size_, MS_SYNC) != 0) {
+    return Status{static_cast<error::PosixError>(errno),
+                  "msync() failed in MmapUntrustedFile::Sync()"};
+  }
+  return Status::OkStatus();
+}
+
+Status MmapUntrustedFile::Write(const void *buffer, off_t offset,
+                                size_t size) {
+  if (offset < 0) {
+    return Status{error::INVALID_ARGUMENT,
+                  "Negative offset in MmapUntrustedFile::Write()"};
+  }
+
+  if (offset + size > size_) {
+    ASYLO_RETURN_IF_ERROR(Truncate(offset + size));
+  }
+
+  memcpy(mapping_ + offset, buffer, size);
+  return Status::OkStatus();
+}
+
+Status MmapUntrustedFile::Truncate(size_t size) {
+  if (enc_untrusted_ftruncate(host_fd_, size) != 0) {
+    return Status{static_cast<error::PosixError>(errno),
+                  "ftruncate() failed in MmapUntrustedFile::Truncate()"};
+  }
+  size_ = size;
+
+  if (size > mapping_length_) {
+    ASYLO_RETURN_IF_ERROR(Map(size));
+  }
+  return Status::OkStatus();
+}
+
+}  // namespace asylo
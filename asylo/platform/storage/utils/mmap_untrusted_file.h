@@ -0,0 +1,91 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_STORAGE_UTILS_MMAP_UNTRUSTED_FILE_H_
+#define ASYLO_PLATFORM_STORAGE_UTILS_MMAP_UNTRUSTED_FILE_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "asylo/platform/storage/utils/random_access_storage.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+
+// An implementation of RandomAccessStorage backed by a host file mapped into
+// untrusted memory. Reads and writes within the mapping are memory copies that
+// do not exit the enclave. Exits are only needed to grow the file and the
+// mapping, which is done geometrically, and to synchronize it.
+//
+// The mapping is shared with the host, which may read or modify its content at
+// any time, exactly as it may for a file accessed through read(2) and write(2).
+// The size of the file is tracked by the instance, and the file must not be
+// resized by anyone else while it is mapped. If the host truncates the file
+// regardless, accesses beyond its end fault, which denies service but is no
+// worse than what the host can already do.
+class MmapUntrustedFile : public RandomAccessStorage {
+ public:
+  // Creates an MmapUntrustedFile mapping the file open on the host file
+  // descriptor |host_fd|, which must be open for reading and writing. |host_fd|
+  // remains owned by the caller, and must not be closed before the instance is
+  // destroyed.
+  static StatusOr<std::unique_ptr<MmapUntrustedFile>> Create(int host_fd);
+
+  // Synchronizes and unmaps the file.
+  ~MmapUntrustedFile() override;
+
+  MmapUntrustedFile(const MmapUntrustedFile &) = delete;
+  MmapUntrustedFile &operator=(const MmapUntrustedFile &) = delete;
+
+  StatusOr<size_t> Size() const override;
+
+  Status Read(void *buffer, off_t offset, size_t size) override;
+
+  Status Write(const void *buffer, off_t offset, size_t size) override;
+
+  // Writes modified pages of the mapping back to the file via msync(2) with
+  // MS_SYNC, which returns once they are written.
+  Status Sync() override;
+
+  Status Truncate(size_t size) override;
+
+ private:
+  explicit MmapUntrustedFile(int host_fd);
+
+  // Maps at least |size| bytes of the file, replacing any existing mapping.
+  // The existing mapping is kept if the file cannot be mapped.
+  Status Map(size_t size);
+
+  // Unmaps the file, if mapped.
+  Status Unmap();
+
+  const int host_fd_;
+
+  // Size of the file.
+  size_t size_;
+
+  // Untrusted address and length of the mapping of the file. The mapping may
+  // extend beyond the end of the file, so that the file can grow without
+  // remapping it.
+  uint8_t *mapping_;
+  size_t mapping_length_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_STORAGE_UTILS_MMAP_UNTRUSTED_FILE_H_
@@ -0,0 +1,139 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/storage/utils/mmap_untrusted_file.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/flags/flag.h"
+#include "absl/strings/str_cat.h"
+#include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/platform/storage/utils/fd_closer.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/test/util/test_flags.h"
+
+namespace asylo {
+namespace {
+
+// Creates an empty file in the test temporary directory and opens it on the
+// host, returning the host file descriptor.
+int CreateEmptyHostFile(const std::string &basename) {
+  std::string path =
+      absl::StrCat(absl::GetFlag(FLAGS_test_tmpdir), "/", basename);
+  enc_untrusted_unlink(path.c_str());
+  return enc_untrusted_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR,
+                            S_IRUSR | S_IWUSR);
+}
+
+TEST(MmapUntrustedFileTest, WriteRead) {
+  int fd = CreateEmptyHostFile("mmap_write_read.tmp");
+  ASSERT_GE(fd, 0);
+  platform::storage::FdCloser closer(fd, &enc_untrusted_close);
+
+  auto file_result = MmapUntrustedFile::Create(fd);
+  ASSERT_THAT(file_result, IsOk());
+  std::unique_ptr<MmapUntrustedFile> file = std::move(file_result).ValueOrDie();
+  EXPECT_THAT(file->Size(), IsOkAndHolds(0));
+
+  constexpr int kCount = 1024;
+  for (int i = 0; i < kCount; i++) {
+    ASYLO_EXPECT_OK(file->Write(&i, i * sizeof(int), sizeof(int)));
+  }
+
+  ASYLO_EXPECT_OK(file->Sync());
+
+  for (int i = 0; i < kCount; i++) {
+    int record;
+    ASYLO_EXPECT_OK(file->Read(&record, i * sizeof(int), sizeof(int)));
+    EXPECT_EQ(record, i);
+  }
+
+  EXPECT_THAT(file->Size(), IsOkAndHolds(kCount * sizeof(int)));
+  int record;
+  EXPECT_THAT(file->Read(&record, kCount * sizeof(int), sizeof(int)),
+              StatusIs(error::NOT_FOUND));
+}
+
+TEST(MmapUntrustedFileTest, GrowBeyondMapping) {
+  int fd = CreateEmptyHostFile("mmap_grow.tmp");
+  ASSERT_GE(fd, 0);
+  platform::storage::FdCloser closer(fd, &enc_untrusted_close);
+
+  // Write records far enough apart for the file to be remapped several times,
+  // then check that they persist in the file once it is closed.
+  constexpr int kCount = 16;
+  constexpr off_t kStride = 100 * 1000;
+  {
+    auto file_result = MmapUntrustedFile::Create(fd);
+    ASSERT_THAT(file_result, IsOk());
+    std::unique_ptr<MmapUntrustedFile> file =
+        std::move(file_result).ValueOrDie();
+    for (int i = 0; i < kCount; i++) {
+      ASYLO_EXPECT_OK(file->Write(&i, i * kStride, sizeof(int)));
+    }
+    EXPECT_THAT(file->Size(),
+                IsOkAndHolds((kCount - 1) * kStride + sizeof(int)));
+  }
+
+  auto file_result = MmapUntrustedFile::Create(fd);
+  ASSERT_THAT(file_result, IsOk());
+  std::unique_ptr<MmapUntrustedFile> file = std::move(file_result).ValueOrDie();
+  EXPECT_THAT(file->Size(), IsOkAndHolds((kCount - 1) * kStride + sizeof(int)));
+  for (int i = 0; i < kCount; i++) {
+    int record;
+    ASYLO_EXPECT_OK(file->Read(&record, i * kStride, sizeof(int)));
+    EXPECT_EQ(record, i);
+  }
+  int hole;
+  ASYLO_EXPECT_OK(file->Read(&hole, kStride / 2, sizeof(int)));
+  EXPECT_EQ(hole, 0);
+}
+
+TEST(MmapUntrustedFileTest, Truncate) {
+  int fd = CreateEmptyHostFile("mmap_truncate.tmp");
+  ASSERT_GE(fd, 0);
+  platform::storage::FdCloser closer(fd, &enc_untrusted_close);
+
+  auto file_result = MmapUntrustedFile::Create(fd);
+  ASSERT_THAT(file_result, IsOk());
+  std::unique_ptr<MmapUntrustedFile> file = std::move(file_result).ValueOrDie();
+
+  std::vector<uint8_t> data(1024, 0xa5);
+  ASYLO_EXPECT_OK(file->Write(data.data(), 0, data.size()));
+  ASYLO_EXPECT_OK(file->Truncate(512));
+  EXPECT_THAT(file->Size(), IsOkAndHolds(512));
+  EXPECT_THAT(file->Read(data.data(), 0, data.size()),
+              StatusIs(error::NOT_FOUND));
+
+  // Extending the file again zero-fills it past the truncation point.
+  ASYLO_EXPECT_OK(file->Truncate(1024));
+  ASYLO_EXPECT_OK(file->Read(data.data(), 0, data.size()));
+  EXPECT_EQ(data[511], 0xa5);
+  EXPECT_EQ(data[512], 0);
+  EXPECT_EQ(data[1023], 0);
+}
+
+}  // namespace
+}  // namespace asylo
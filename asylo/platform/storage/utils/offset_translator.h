@@ -66,7 +66,10 @@ class OffsetTranslator {
       off_t logical_offset, size_t count,
       size_t *first_partial_block_bytes_count,
       size_t *last_partial_block_bytes_count,
-      size_t *full_inclusive_blocks_bytes_count);
+      size_t *full_inclusive_blocks_bytes_count) const;
+
+  // Returns the length of the payload of each block.
+  size_t payload_length() const { return payload_length_; }
 
  private:
   OffsetTranslator(size_t header_len, size_t payload_len, size_t block_len);
@@ -23,6 +23,7 @@
 #include <iterator>
 #include <list>
 #include <type_traits>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "asylo/util/logging.h"
@@ -48,7 +49,8 @@ namespace asylo {
 // Read and write operations are performed via a fixed-size cache using a least-
 // recently-used eviction policy. The cache may be flushed to disk explicitly
 // via Flush(), and is automatically flushed when the RecordStore passes out of
-// scope.
+// scope. Modified records are written back lazily, and each run of modified
+// records adjacent in storage is written back in a single write.
 //
 // This class is not thread-safe. It is the responsibility of the caller to
 // ensure that its methods are not called concurrently.
@@ -86,9 +88,24 @@ class RecordStore {
 
   // Flushes the cache to persistent storage and ensures the underlying storage
   // resource has been synchronized. Returns an error status on failure.
+  // Modified records are written in order of their offsets.
   ASYLO_MUST_USE_RESULT Status Flush() {
-    for (auto it = cache_.begin(); it != cache_.end(); it++) {
-      ASYLO_RETURN_IF_ERROR(Commit(it));
+    std::vector<off_t> dirty_offsets;
+    for (const CacheEntry &entry : cache_) {
+      if (entry.dirty) {
+        dirty_offsets.push_back(entry.offset);
+      }
+    }
+    std::sort(dirty_offsets.begin(), dirty_offsets.end());
+
+    size_t run_start = 0;
+    for (size_t i = 1; i <= dirty_offsets.size(); i++) {
+      if (i == dirty_offsets.size() ||
+          dirty_offsets[i] != dirty_offsets[i - 1] + sizeof(T)) {
+        ASYLO_RETURN_IF_ERROR(CommitRun(dirty_offsets[run_start],
+                                        dirty_offsets[i - 1] + sizeof(T)));
+        run_start = i;
+      }
     }
     ASYLO_RETURN_IF_ERROR(io_->Sync());
     return Status::OkStatus();
@@ -170,13 +187,46 @@ class RecordStore {
   using NodeRef = typename std::list<CacheEntry>::iterator;
   using ConstNodeRef = typename std::list<CacheEntry>::const_iterator;
 
-  // Writes a cache entry to storage, returning an error status on failure.
-  ASYLO_MUST_USE_RESULT Status Commit(NodeRef entry) {
-    ASYLO_RETURN_IF_ERROR(io_->Write(&entry->value, entry->offset, sizeof(T)));
-    entry->dirty = false;
+  // Returns true if the record at |offset| is cached and modified.
+  bool IsDirty(off_t offset) const {
+    auto it = index_.find(offset);
+    return it != index_.end() && it->second->dirty;
+  }
+
+  // Writes the run of modified records between the byte offsets |begin| and
+  // |end| to storage in a single write, returning an error status on failure.
+  // Every record in the run must be cached.
+  ASYLO_MUST_USE_RESULT Status CommitRun(off_t begin, off_t end) {
+    std::vector<T> values;
+    values.reserve((end - begin) / sizeof(T));
+    for (off_t offset = begin; offset < end; offset += sizeof(T)) {
+      values.push_back(index_.at(offset)->value);
+    }
+    ASYLO_RETURN_IF_ERROR(io_->Write(values.data(), begin, end - begin));
+    for (off_t offset = begin; offset < end; offset += sizeof(T)) {
+      index_.at(offset)->dirty = false;
+    }
     return Status::OkStatus();
   }
 
+  // Writes a modified cache entry to storage along with the modified records
+  // adjacent to it, returning an error status on failure.
+  ASYLO_MUST_USE_RESULT Status Commit(NodeRef entry) {
+    if (!entry->dirty) {
+      return Status::OkStatus();
+    }
+    off_t begin = entry->offset;
+    while (begin >= static_cast<off_t>(sizeof(T)) &&
+           IsDirty(begin - sizeof(T))) {
+      begin -= sizeof(T);
+    }
+    off_t end = entry->offset + sizeof(T);
+    while (IsDirty(end)) {
+      end += sizeof(T);
+    }
+    return CommitRun(begin, end);
+  }
+
   // Evicts an entry from the cache and moves the evicted cache node to the
   // front of the LRU list. Returns an error status on failure.
   ASYLO_MUST_USE_RESULT Status Evict() {
@@ -213,7 +263,7 @@ class RecordStore {
   // by the default allocator.
   std::list<CacheEntry> cache_;
 
-  absl::flat_hash_map<off_t, ConstNodeRef> index_;  // Index by record offset.
+  absl::flat_hash_map<off_t, NodeRef> index_;  // Index by record offset.
 };
 
 }  // namespace asylo
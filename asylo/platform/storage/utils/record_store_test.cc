@@ -30,6 +30,34 @@
 namespace asylo {
 namespace {
 
+// A RandomAccessStorage forwarding to another one and counting the calls to
+// Write().
+class CountingStorage : public RandomAccessStorage {
+ public:
+  explicit CountingStorage(RandomAccessStorage *io) : io_(io), writes_(0) {}
+
+  StatusOr<size_t> Size() const override { return io_->Size(); }
+
+  Status Read(void *buffer, off_t offset, size_t size) override {
+    return io_->Read(buffer, offset, size);
+  }
+
+  Status Write(const void *buffer, off_t offset, size_t size) override {
+    writes_++;
+    return io_->Write(buffer, offset, size);
+  }
+
+  Status Sync() override { return io_->Sync(); }
+
+  Status Truncate(size_t size) override { return io_->Truncate(size); }
+
+  int writes() const { return writes_; }
+
+ private:
+  RandomAccessStorage *io_;
+  int writes_;
+};
+
 // Ensure that reading and writing records through a RecordStore returns the
 // expected values.
 TEST(RecordStoreTest, WriteRead) {
@@ -119,5 +147,66 @@ TEST(RecordStoreTest, Flush) {
   }
 }
 
+// Ensure that adjacent dirty records are written back in a single write, and
+// that clean records are not written back.
+TEST(RecordStoreTest, CoalescedFlush) {
+  int fd = CreateEmptyTempFileOrDie("coalesced_flush.tmp");
+  platform::storage::FdCloser closer(fd);
+  UntrustedFile file(fd);
+  CountingStorage counting(&file);
+
+  constexpr size_t kCapacity = 256;
+  constexpr size_t kRecordCount = 128;
+
+  RecordStore<size_t> records(kCapacity, &counting);
+
+  // Write two runs of adjacent records, out of order.
+  for (size_t i = kRecordCount; i > 0; i--) {
+    if (i - 1 != kRecordCount / 2) {
+      off_t offset = (i - 1) * sizeof(size_t);
+      ASYLO_EXPECT_OK(records.Write(offset, i - 1));
+    }
+  }
+  ASYLO_ASSERT_OK(records.Flush());
+  EXPECT_EQ(counting.writes(), 2);
+
+  // Records are clean after a flush.
+  ASYLO_ASSERT_OK(records.Flush());
+  EXPECT_EQ(counting.writes(), 2);
+
+  for (size_t i = 0; i < kRecordCount; i++) {
+    if (i != kRecordCount / 2) {
+      size_t record;
+      ASYLO_EXPECT_OK(file.Read(&record, i * sizeof(size_t), sizeof(size_t)));
+      EXPECT_EQ(record, i);
+    }
+  }
+}
+
+// Ensure that evicting a dirty record writes back the adjacent dirty records
+// along with it.
+TEST(RecordStoreTest, CoalescedEviction) {
+  int fd = CreateEmptyTempFileOrDie("coalesced_eviction.tmp");
+  platform::storage::FdCloser closer(fd);
+  UntrustedFile file(fd);
+  CountingStorage counting(&file);
+
+  constexpr size_t kCapacity = 16;
+
+  RecordStore<size_t> records(kCapacity, &counting);
+  for (size_t i = 0; i < kCapacity + 1; i++) {
+    ASYLO_EXPECT_OK(records.Write(i * sizeof(size_t), i));
+  }
+  EXPECT_EQ(counting.writes(), 1);
+
+  ASYLO_ASSERT_OK(records.Flush());
+  EXPECT_EQ(counting.writes(), 2);
+  for (size_t i = 0; i < kCapacity + 1; i++) {
+    size_t record;
+    ASYLO_EXPECT_OK(file.Read(&record, i * sizeof(size_t), sizeof(size_t)));
+    EXPECT_EQ(record, i);
+  }
+}
+
 }  // namespace
 }  // namespace asylo
@@ -0,0 +1,323 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/storage/utils/trusted_file_image.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/platform/storage/utils/fd_closer.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/posix_error_space.h"
+#include "asylo/util/status_macros.h"
+#include "asylo/util/thread_pool.h"
+
+namespace asylo {
+namespace {
+
+// Number of threads computing the digests of the chunks of images.
+constexpr int kNumVerificationThreads = 4;
+
+// Returns the process-wide pool that computes the digests of the chunks of
+// images. The pool is started on first use and is never destroyed.
+ThreadPool *VerificationPool() {
+  static ThreadPool *pool = new ThreadPool(kNumVerificationThreads);
+  return pool;
+}
+
+// Returns the number of chunks of a file of |size| bytes.
+size_t ChunkCount(size_t size) {
+  return (size + TrustedFileImage::kChunkLength - 1) /
+         TrustedFileImage::kChunkLength;
+}
+
+// Returns a view of the |index|th chunk of |data|, the contents of a file of
+// |size| bytes.
+ByteContainerView Chunk(const uint8_t *data, size_t size, size_t index) {
+  size_t offset = index * TrustedFileImage::kChunkLength;
+  return ByteContainerView(
+      data + offset, std::min(TrustedFileImage::kChunkLength, size - offset));
+}
+
+// Writes the digests of the chunks from |first_chunk| up to |end_chunk| of
+// |data|, the contents of a file of |size| bytes, to |digests|.
+Status HashChunks(const uint8_t *data, size_t size, size_t first_chunk,
+                  size_t end_chunk, uint8_t *digests) {
+  std::vector<ByteContainerView> chunks;
+  std::vector<uint8_t *> outputs;
+  for (size_t i = first_chunk; i < end_chunk; i++) {
+    chunks.push_back(Chunk(data, size, i));
+    outputs.push_back(digests + (i - first_chunk) * kSha256DigestLength);
+  }
+  return Sha256MultiBuffer(/*prefix=*/"", chunks, outputs);
+}
+
+// Returns the image digest of a file of |size| bytes from the concatenated
+// digests of its chunks.
+StatusOr<std::string> ImageDigestOf(size_t size, ByteContainerView digests) {
+  uint64_t length = size;
+  std::string digest(kSha256DigestLength, '\0');
+  uint8_t *output = reinterpret_cast<uint8_t *>(&digest[0]);
+  ASYLO_RETURN_IF_ERROR(
+      Sha256MultiBuffer(ByteContainerView(&length, sizeof(length)), {digests},
+                        absl::MakeSpan(&output, 1)));
+  return digest;
+}
+
+// Registered files, by path.
+struct ImageRegistry {
+  struct Registration {
+    std::string expected_digest;
+    std::shared_ptr<TrustedFileImage> image;
+  };
+
+  absl::Mutex mu;
+  absl::flat_hash_map<std::string, Registration> images ABSL_GUARDED_BY(mu);
+};
+
+ImageRegistry *GetImageRegistry() {
+  static ImageRegistry *registry = new ImageRegistry;
+  return registry;
+}
+
+}  // namespace
+
+constexpr size_t TrustedFileImage::kChunkLength;
+
+TrustedFileImage::TrustedFileImage(const uint8_t *mapping, size_t size)
+    : mapping_(mapping), size_(size), chunk_digests_(ChunkCount(size)) {}
+
+TrustedFileImage::~TrustedFileImage() {
+  if (mapping_ &&
+      enc_untrusted_munmap(const_cast<uint8_t *>(mapping_), size_) != 0) {
+    LOG(ERROR) << "Unexpected failure in munmap() when closing a "
+                  "TrustedFileImage: "
+               << strerror(errno);
+  }
+}
+
+StatusOr<std::string> TrustedFileImage::ComputeDigest(
+    ByteContainerView contents) {
+  size_t count = ChunkCount(contents.size());
+  std::vector<Digest> digests(count);
+  ASYLO_RETURN_IF_ERROR(HashChunks(contents.data(), contents.size(), 0, count,
+                                   digests.data()->data()));
+  return ImageDigestOf(contents.size(),
+                       ByteContainerView(digests.data(),
+                                         count * kSha256DigestLength));
+}
+
+Status TrustedFileImage::Register(const std::string &path,
+                                  ByteContainerView expected_digest) {
+  if (expected_digest.size() != kSha256DigestLength) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Image digest must be a SHA-256 digest");
+  }
+  std::string digest(expected_digest.begin(), expected_digest.end());
+
+  ImageRegistry *registry = GetImageRegistry();
+  absl::MutexLock lock(&registry->mu);
+  auto it = registry->images.find(path);
+  if (it != registry->images.end()) {
+    if (it->second.expected_digest != digest) {
+      return Status(error::GoogleError::ALREADY_EXISTS,
+                    absl::StrCat(path, " is registered with another digest"));
+    }
+    return Status::OkStatus();
+  }
+  registry->images[path].expected_digest = std::move(digest);
+  return Status::OkStatus();
+}
+
+StatusOr<std::shared_ptr<TrustedFileImage>> TrustedFileImage::Get(
+    const std::string &path) {
+  ImageRegistry *registry = GetImageRegistry();
+  absl::MutexLock lock(&registry->mu);
+  auto it = registry->images.find(path);
+  if (it == registry->images.end()) {
+    return Status(error::GoogleError::NOT_FOUND,
+                  absl::StrCat(path, " is not registered"));
+  }
+  if (!it->second.image) {
+    std::unique_ptr<TrustedFileImage> image;
+    ASYLO_ASSIGN_OR_RETURN(image, Open(path, it->second.expected_digest));
+    it->second.image = std::move(image);
+  }
+  return it->second.image;
+}
+
+StatusOr<std::unique_ptr<TrustedFileImage>> TrustedFileImage::Open(
+    const std::string &path, ByteContainerView expected_digest) {
+  if (expected_digest.size() != kSha256DigestLength) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Image digest must be a SHA-256 digest");
+  }
+
+  int fd = enc_untrusted_open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return Status{static_cast<error::PosixError>(errno),
+                  absl::StrCat("open() failed for ", path)};
+  }
+  platform::storage::FdCloser closer(fd, &enc_untrusted_close);
+  off_t size = enc_untrusted_lseek(fd, 0, SEEK_END);
+  if (size == -1) {
+    return Status{static_cast<error::PosixError>(errno),
+                  "lseek() failed in TrustedFileImage::Open()"};
+  }
+
+  // The mapping remains valid once the file is closed.
+  void *mapping = nullptr;
+  if (size > 0) {
+    mapping = enc_untrusted_mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+      return Status{static_cast<error::PosixError>(errno),
+                    "mmap() failed in TrustedFileImage::Open()"};
+    }
+  }
+  auto image = absl::WrapUnique(
+      new TrustedFileImage(static_cast<const uint8_t *>(mapping), size));
+
+  ASYLO_RETURN_IF_ERROR(image->ComputeChunkDigests());
+  std::string digest;
+  ASYLO_ASSIGN_OR_RETURN(digest, image->ImageDigest());
+  if (ByteContainerView(digest) != expected_digest) {
+    return Status(error::GoogleError::DATA_LOSS,
+                  absl::StrCat(path, " does not match its image digest"));
+  }
+  return std::move(image);
+}
+
+StatusOr<absl::Span<const uint8_t>> TrustedFileImage::Read(size_t offset,
+                                                           size_t length) {
+  ASYLO_RETURN_IF_ERROR(CheckRange(offset, length));
+  if (length == 0) {
+    return absl::Span<const uint8_t>();
+  }
+
+  absl::MutexLock lock(&mu_);
+  if (!contents_) {
+    contents_ = absl::make_unique<uint8_t[]>(size_);
+    is_chunk_loaded_.assign(chunk_digests_.size(), false);
+  }
+
+  // Copy the missing chunks in before verifying them, so that the host cannot
+  // modify them once verified.
+  std::vector<size_t> chunks;
+  size_t end_chunk = (offset + length - 1) / kChunkLength + 1;
+  for (size_t i = offset / kChunkLength; i < end_chunk; i++) {
+    if (!is_chunk_loaded_[i]) {
+      ByteContainerView chunk = Chunk(mapping_, size_, i);
+      memcpy(contents_.get() + i * kChunkLength, chunk.data(), chunk.size());
+      chunks.push_back(i);
+    }
+  }
+  ASYLO_RETURN_IF_ERROR(VerifyChunks(contents_.get(), chunks));
+  for (size_t i : chunks) {
+    is_chunk_loaded_[i] = true;
+  }
+  return absl::MakeConstSpan(contents_.get() + offset, length);
+}
+
+StatusOr<absl::Span<const uint8_t>> TrustedFileImage::ReadInPlace(
+    size_t offset, size_t length) const {
+  ASYLO_RETURN_IF_ERROR(CheckRange(offset, length));
+  if (length == 0) {
+    return absl::Span<const uint8_t>();
+  }
+
+  std::vector<size_t> chunks;
+  size_t end_chunk = (offset + length - 1) / kChunkLength + 1;
+  for (size_t i = offset / kChunkLength; i < end_chunk; i++) {
+    chunks.push_back(i);
+  }
+  ASYLO_RETURN_IF_ERROR(VerifyChunks(mapping_, chunks));
+  return absl::MakeConstSpan(mapping_ + offset, length);
+}
+
+Status TrustedFileImage::ComputeChunkDigests() {
+  size_t count = chunk_digests_.size();
+  size_t tasks = std::min<size_t>(count, kNumVerificationThreads);
+  std::vector<std::future<Status>> results;
+  for (size_t task = 0; task < tasks; task++) {
+    size_t first_chunk = count * task / tasks;
+    size_t end_chunk = count * (task + 1) / tasks;
+    results.push_back(VerificationPool()->Submit([this, first_chunk,
+                                                  end_chunk] {
+      return HashChunks(mapping_, size_, first_chunk, end_chunk,
+                        chunk_digests_[first_chunk].data());
+    }));
+  }
+
+  Status status = Status::OkStatus();
+  for (std::future<Status> &result : results) {
+    Status task_status = result.get();
+    if (status.ok()) {
+      status = task_status;
+    }
+  }
+  return status;
+}
+
+StatusOr<std::string> TrustedFileImage::ImageDigest() const {
+  return ImageDigestOf(size_,
+                       ByteContainerView(chunk_digests_.data(),
+                                         chunk_digests_.size() *
+                                             kSha256DigestLength));
+}
+
+Status TrustedFileImage::CheckRange(size_t offset, size_t length) const {
+  if (offset > size_ || length > size_ - offset) {
+    return Status(error::GoogleError::OUT_OF_RANGE,
+                  absl::StrCat("Range of ", length, " bytes at offset ", offset,
+                               " is beyond the end of the image"));
+  }
+  return Status::OkStatus();
+}
+
+Status TrustedFileImage::VerifyChunks(const uint8_t *data,
+                                      absl::Span<const size_t> chunks) const {
+  std::vector<ByteContainerView> messages;
+  std::vector<Digest> digests(chunks.size());
+  std::vector<uint8_t *> outputs;
+  for (size_t i = 0; i < chunks.size(); i++) {
+    messages.push_back(Chunk(data, size_, chunks[i]));
+    outputs.push_back(digests[i].data());
+  }
+  ASYLO_RETURN_IF_ERROR(Sha256MultiBuffer(/*prefix=*/"", messages, outputs));
+  for (size_t i = 0; i < chunks.size(); i++) {
+    if (digests[i] != chunk_digests_[chunks[i]]) {
+      return Status(error::GoogleError::DATA_LOSS,
+                    absl::StrCat("Chunk ", chunks[i],
+                                 " does not match its digest"));
+    }
+  }
+  return Status::OkStatus();
+}
+
+}  // namespace asylo
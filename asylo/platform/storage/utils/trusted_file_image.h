@@ -0,0 +1,142 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_STORAGE_UTILS_TRUSTED_FILE_IMAGE_H_
+#define ASYLO_PLATFORM_STORAGE_UTILS_TRUSTED_FILE_IMAGE_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "asylo/crypto/sha256_multi_buffer.h"
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+
+// A read-only host file, such as a model or a certificate bundle, mapped into
+// untrusted memory and verified against a digest known to the enclave.
+//
+// The file is split into chunks of kChunkLength bytes, and is identified by
+// its image digest, the SHA-256 digest of its length followed by the SHA-256
+// digests of its chunks, as computed by ComputeDigest(). Unlike the digest of
+// the whole file, the image digest can be computed over the chunks in
+// parallel, and lets each chunk be verified on its own. When the image is
+// opened, the digests of its chunks are computed on a pool of threads and
+// checked against the expected image digest. Chunks are then verified against
+// their digests as they are accessed:
+//
+//  * Read() copies the chunks it covers into enclave memory the first time they
+//    are read, and verifies the copies, so the returned view cannot be
+//    modified by the host.
+//  * ReadInPlace() verifies the chunks in the untrusted mapping itself, without
+//    copying them. The host can still modify the mapping once it is verified,
+//    so the returned view is only suitable for data that is consumed once, as
+//    it is read, or whose later modification does not matter to the caller.
+//
+// Files are registered with their expected image digest, typically while the
+// enclave is initialized, and opened on the first call to Get().
+//
+// This class is thread-safe.
+class TrustedFileImage {
+ public:
+  // Length of the chunks of an image.
+  static constexpr size_t kChunkLength = 64 * 1024;
+
+  ~TrustedFileImage();
+
+  TrustedFileImage(const TrustedFileImage &) = delete;
+  TrustedFileImage &operator=(const TrustedFileImage &) = delete;
+
+  // Returns the image digest of a file with |contents|.
+  static StatusOr<std::string> ComputeDigest(ByteContainerView contents);
+
+  // Registers the file at |path| with its expected image digest. Returns an
+  // ALREADY_EXISTS error if |path| is registered with another digest.
+  static Status Register(const std::string &path,
+                         ByteContainerView expected_digest);
+
+  // Returns the image of the registered file at |path|, opening it on the first
+  // call. Returns a NOT_FOUND error if |path| is not registered, and a
+  // DATA_LOSS error if the file does not match its expected digest.
+  static StatusOr<std::shared_ptr<TrustedFileImage>> Get(
+      const std::string &path);
+
+  // Maps the file at |path| and verifies it against |expected_digest|.
+  static StatusOr<std::unique_ptr<TrustedFileImage>> Open(
+      const std::string &path, ByteContainerView expected_digest);
+
+  // Returns the length of the file.
+  size_t size() const { return size_; }
+
+  // Returns a view of |length| bytes at |offset| in enclave memory, valid for
+  // the lifetime of the image. Returns a DATA_LOSS error if a chunk copied in
+  // does not match its digest.
+  StatusOr<absl::Span<const uint8_t>> Read(size_t offset, size_t length)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns a view of |length| bytes at |offset| in the untrusted mapping,
+  // after verifying the chunks it covers. Returns a DATA_LOSS error if a chunk
+  // does not match its digest.
+  StatusOr<absl::Span<const uint8_t>> ReadInPlace(size_t offset,
+                                                  size_t length) const;
+
+ private:
+  using Digest = std::array<uint8_t, kSha256DigestLength>;
+
+  TrustedFileImage(const uint8_t *mapping, size_t size);
+
+  // Computes the digests of the chunks of the mapping on a pool of threads.
+  Status ComputeChunkDigests();
+
+  // Returns the image digest of the file from the digests of its chunks.
+  StatusOr<std::string> ImageDigest() const;
+
+  // Returns an error if |length| bytes at |offset| are not within the file.
+  Status CheckRange(size_t offset, size_t length) const;
+
+  // Verifies the chunks at |chunks| in |data|, which holds the contents of the
+  // file.
+  Status VerifyChunks(const uint8_t *data,
+                      absl::Span<const size_t> chunks) const;
+
+  // Untrusted mapping of the file, and length of the file.
+  const uint8_t *const mapping_;
+  const size_t size_;
+
+  // Digests of the chunks of the file, verified against the image digest.
+  std::vector<Digest> chunk_digests_;
+
+  absl::Mutex mu_;
+
+  // Enclave copy of the file, allocated on the first call to Read(), and
+  // whether each chunk has been copied in and verified.
+  std::unique_ptr<uint8_t[]> contents_ ABSL_GUARDED_BY(mu_);
+  std::vector<bool> is_chunk_loaded_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_STORAGE_UTILS_TRUSTED_FILE_IMAGE_H_
@@ -0,0 +1,127 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/storage/utils/trusted_file_image.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/flags/flag.h"
+#include "absl/strings/str_cat.h"
+#include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/platform/storage/utils/fd_closer.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/test/util/test_flags.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::ElementsAreArray;
+
+// Length of the test file, which ends with a partial chunk.
+constexpr size_t kFileLength = 5 * TrustedFileImage::kChunkLength / 2;
+
+class TrustedFileImageTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    contents_.resize(kFileLength);
+    for (size_t i = 0; i < contents_.size(); i++) {
+      contents_[i] = i * 7 + i / 251;
+    }
+    path_ = absl::StrCat(absl::GetFlag(FLAGS_test_tmpdir), "/image.tmp");
+    WriteFile(contents_);
+    ASYLO_ASSERT_OK_AND_ASSIGN(digest_,
+                               TrustedFileImage::ComputeDigest(contents_));
+  }
+
+  // Replaces the contents of the test file with |contents|.
+  void WriteFile(const std::vector<uint8_t> &contents) {
+    enc_untrusted_unlink(path_.c_str());
+    int fd = enc_untrusted_open(path_.c_str(), O_CREAT | O_EXCL | O_WRONLY,
+                                S_IRUSR | S_IWUSR);
+    ASSERT_GE(fd, 0);
+    platform::storage::FdCloser closer(fd, &enc_untrusted_close);
+    ASSERT_EQ(enc_untrusted_write(fd, contents.data(), contents.size()),
+              static_cast<ssize_t>(contents.size()));
+  }
+
+  std::vector<uint8_t> Slice(size_t offset, size_t length) const {
+    return std::vector<uint8_t>(contents_.begin() + offset,
+                                contents_.begin() + offset + length);
+  }
+
+  std::vector<uint8_t> contents_;
+  std::string path_;
+  std::string digest_;
+};
+
+// Ensure that reads copied in and reads in place return the file contents,
+// including across chunk boundaries.
+TEST_F(TrustedFileImageTest, ReadMatchesFile) {
+  std::unique_ptr<TrustedFileImage> image;
+  ASYLO_ASSERT_OK_AND_ASSIGN(image, TrustedFileImage::Open(path_, digest_));
+  EXPECT_EQ(image->size(), kFileLength);
+
+  const size_t offset = TrustedFileImage::kChunkLength - 10;
+  EXPECT_THAT(image->Read(offset, 100),
+              IsOkAndHolds(ElementsAreArray(Slice(offset, 100))));
+  EXPECT_THAT(image->ReadInPlace(offset, 100),
+              IsOkAndHolds(ElementsAreArray(Slice(offset, 100))));
+  EXPECT_THAT(image->Read(0, kFileLength),
+              IsOkAndHolds(ElementsAreArray(contents_)));
+  EXPECT_THAT(image->Read(kFileLength - 1, 2),
+              StatusIs(error::GoogleError::OUT_OF_RANGE));
+}
+
+// Ensure that a file not matching its digest fails to open.
+TEST_F(TrustedFileImageTest, ModifiedFileFailsOpen) {
+  contents_[kFileLength - 1] ^= 1;
+  WriteFile(contents_);
+  EXPECT_THAT(TrustedFileImage::Open(path_, digest_),
+              StatusIs(error::GoogleError::DATA_LOSS));
+}
+
+// Ensure that registered files are opened once, and only when registered.
+TEST_F(TrustedFileImageTest, RegisterAndGet) {
+  std::string path = absl::StrCat(path_, ".registered");
+  EXPECT_THAT(TrustedFileImage::Get(path),
+              StatusIs(error::GoogleError::NOT_FOUND));
+
+  ASSERT_EQ(enc_untrusted_rename(path_.c_str(), path.c_str()), 0);
+  ASYLO_ASSERT_OK(TrustedFileImage::Register(path, digest_));
+  ASYLO_EXPECT_OK(TrustedFileImage::Register(path, digest_));
+  std::string other_digest = digest_;
+  other_digest[0] ^= 1;
+  EXPECT_THAT(TrustedFileImage::Register(path, other_digest),
+              StatusIs(error::GoogleError::ALREADY_EXISTS));
+
+  std::shared_ptr<TrustedFileImage> image;
+  ASYLO_ASSERT_OK_AND_ASSIGN(image, TrustedFileImage::Get(path));
+  EXPECT_THAT(TrustedFileImage::Get(path), IsOkAndHolds(image));
+  EXPECT_THAT(image->Read(0, 16), IsOkAndHolds(ElementsAreArray(Slice(0, 16))));
+}
+
+}  // namespace
+}  // namespace asylo
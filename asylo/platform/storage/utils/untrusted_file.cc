@@ -36,23 +36,18 @@ UntrustedFile::~UntrustedFile() {
 }
 
 Status UntrustedFile::Read(void *buffer, off_t offset, size_t size) {
-  off_t result = lseek(fd_, offset, SEEK_SET);
-  if (result == -1) {
-    return Status{static_cast<error::PosixError>(errno),
-                  "lseek() failed in UntrustedFile::Read()"};
-  }
-
   size_t count = 0;
   while (count < size) {
-    ssize_t result =
-        read(fd_, reinterpret_cast<uint8_t *>(buffer) + count, size - count);
+    ssize_t result = pread(fd_, reinterpret_cast<uint8_t *>(buffer) + count,
+                           size - count, offset + count);
     if (result == 0) {
-      return Status{error::NOT_FOUND, "read() failed in UntrustedFile::Read()"};
+      return Status{error::NOT_FOUND,
+                    "pread() failed in UntrustedFile::Read()"};
     }
 
     if (result < 0) {
       return Status{static_cast<error::PosixError>(errno),
-                    "read() failed in UntrustedFile::Read()"};
+                    "pread() failed in UntrustedFile::Read()"};
     }
 
     count += result;
@@ -79,38 +74,22 @@ Status UntrustedFile::Sync() {
 }
 
 Status UntrustedFile::Write(const void *buffer, off_t offset, size_t size) {
-  off_t result = lseek(fd_, offset, SEEK_SET);
-  if (result == -1) {
-    return Status{static_cast<error::PosixError>(errno),
-                  "lseek() failed in UntrustedFile::Write()"};
-  }
-
-  if (result < offset) {
-    if (ftruncate(fd_, offset) != 0) {
-      return Status{static_cast<error::PosixError>(errno),
-                    "ftruncate() failed in UntrustedFile::Write()"};
-    }
-    off_t result = lseek(fd_, offset, SEEK_SET);
-    if (result == -1) {
-      return Status{
-          static_cast<error::PosixError>(errno),
-          "lseek() failed after extending file in UntrustedFile::Write()"};
-    }
-  }
-
+  // Writing past the end of the file extends it with zeros, as if by
+  // Truncate().
   size_t count = 0;
   while (count < size) {
-    ssize_t result = write(
-        fd_, reinterpret_cast<const uint8_t *>(buffer) + count, size - count);
+    ssize_t result =
+        pwrite(fd_, reinterpret_cast<const uint8_t *>(buffer) + count,
+               size - count, offset + count);
 
     if (result == 0) {
       return Status{error::RESOURCE_EXHAUSTED,
-                    "write() failed in UntrustedFile::Write()"};
+                    "pwrite() failed in UntrustedFile::Write()"};
     }
 
     if (result < 0) {
       return Status{static_cast<error::PosixError>(errno),
-                    "write() failed in UntrustedFile::Write()"};
+                    "pwrite() failed in UntrustedFile::Write()"};
     }
     count += result;
   }
@@ -27,7 +27,7 @@ namespace asylo {
 class UntrustedFile : public RandomAccessStorage {
  public:
   // Constructs an UntrustedFile wrapping an open file descriptor. |fd| is
-  // expected to support read(2), write(2), lseek(2), ftruncate(2), and
+  // expected to support pread(2), pwrite(2), lseek(2), ftruncate(2), and
   // fsync(2).  |fd| remains owned by the caller and is not closed by the
   // UntrustedFile instance.
   explicit UntrustedFile(int fd);
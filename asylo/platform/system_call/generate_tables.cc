@@ -24,9 +24,11 @@
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
 #include "asylo/platform/system_call/syscalls.inc"
 
 // This file implements a code generation tool built with a native Linux
@@ -291,6 +293,37 @@ absl::flat_hash_map<int, ParameterDescription> *ParameterTable() {
   return parameter_table;
 }
 
+// Encoding size emitted for a message whose size depends on the values of its
+// parameters.
+constexpr int kVariableSize = -1;
+
+// Returns the largest size in bytes of the encoded parameters of a request
+// (|convention| is kIn) or response (|convention| is kOut) for a system call,
+// or kVariableSize if a string or bounded buffer is encoded. Mirrors the
+// encoding of MessageWriter, so each scalar takes 8 bytes and each fixed size
+// object its size rounded up to a multiple of 8.
+int MaxEncodingSize(const SystemCallDescription &syscall,
+                    ConventionFlag convention) {
+  int size = 0;
+  for (int i = 0; i < syscall.parameter_count; i++) {
+    const ParameterDescription &parameter =
+        (*ParameterTable())[syscall.parameter_index + i];
+    absl::flat_hash_set<std::string> flags =
+        absl::StrSplit(parameter.flags, " | ");
+    if (!flags.contains(convention == kIn ? "kIn" : "kOut")) {
+      continue;
+    }
+    if (flags.contains("kScalar")) {
+      size += sizeof(uint64_t);
+    } else if (flags.contains("kFixed")) {
+      size += (parameter.size + 7) / 8 * 8;
+    } else {
+      return kVariableSize;
+    }
+  }
+  return size;
+}
+
 // Emits a table of system call descriptions.
 void EmitSystemCallTable(std::ostream *os) {
   // Write a table to the output stream as a C++ static data.
@@ -311,17 +344,23 @@ void EmitSystemCallTable(std::ostream *os) {
     std::string name;
     int count;
     size_t index;
+    int request_size;
+    int response_size;
     if (it == SystemCallTable()->end()) {
       name = "nullptr";
       count = 0;
       index = 0;
+      request_size = kVariableSize;
+      response_size = kVariableSize;
     } else {
       name = absl::StrCat("\"", it->second.name, "\"");
       count = it->second.parameter_count;
       index = it->second.parameter_index;
+      request_size = MaxEncodingSize(it->second, kIn);
+      response_size = MaxEncodingSize(it->second, kOut);
     }
-    *os << absl::StreamFormat("  /* %i */ {%s, %i, %i},\n", i, name, count,
-                              index);
+    *os << absl::StreamFormat("  /* %i */ {%s, %i, %i, %i, %i},\n", i, name,
+                              count, index, request_size, response_size);
   }
   *os << "};\n";
 }
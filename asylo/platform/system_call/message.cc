@@ -20,6 +20,7 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -365,5 +366,46 @@ bool MessageWriter::Write(primitives::Extent *message) const {
   return true;
 }
 
+size_t WriteBoundedRequest(
+    int sysno, const std::array<uint64_t, kParameterMax> &parameters,
+    uint8_t *buffer) {
+  auto *header = reinterpret_cast<MessageHeader *>(buffer);
+  memset(header, 0, sizeof(*header));
+  header->magic = kMessageMagic;
+  header->flags = kSystemCallRequest;
+  header->sysno = sysno;
+
+  size_t next_offset = sizeof(MessageHeader);
+  SystemCallDescriptor syscall(sysno);
+  for (int i = 0; i < syscall.parameter_count(); i++) {
+    ParameterDescriptor parameter = syscall.parameter(i);
+    if (!parameter.is_in()) {
+      continue;
+    }
+
+    // A bounded request copies in only scalars and fixed size objects, sized
+    // as by MessageWriter::ParameterSize.
+    size_t size;
+    if (parameter.is_scalar()) {
+      size = sizeof(uint64_t);
+    } else {
+      size = parameters[i] ? parameter.size() : 0;
+    }
+    uint8_t *dst = buffer + next_offset;
+    const void *src = reinterpret_cast<const void *>(parameters[i]);
+    if (!parameter.is_pointer()) {
+      *reinterpret_cast<uint64_t *>(dst) = parameters[i];
+    } else if (src) {
+      memcpy(dst, src, size);
+    } else {
+      memset(dst, 0, size);
+    }
+    header->offset[i] = next_offset;
+    header->size[i] = size;
+    next_offset = RoundUpToMultipleOf8(next_offset + size);
+  }
+  return next_offset;
+}
+
 }  // namespace system_call
 }  // namespace asylo
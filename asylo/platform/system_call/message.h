@@ -21,7 +21,9 @@
 
 #include <array>
 #include <cstddef>
+#include <cstdint>
 #include <string>
+#include <type_traits>
 
 #include "absl/base/attributes.h"
 #include "asylo/platform/primitives/extent.h"
@@ -69,6 +71,52 @@ static_assert(sizeof(MessageHeader) % 8 == 0,
               "sizeof(MessageHeader) must be a multiple of 8 to ensure correct "
               "parameter alignment.");
 
+namespace internal {
+
+// True if every type in Ts is an integral or enumeration type.
+template <typename... Ts>
+struct AllScalar : std::true_type {};
+
+template <typename T, typename... Ts>
+struct AllScalar<T, Ts...>
+    : std::integral_constant<bool, (std::is_integral<T>::value ||
+                                    std::is_enum<T>::value) &&
+                                       AllScalar<Ts...>::value> {};
+
+}  // namespace internal
+
+// A request for a system call with |N| parameters, all of which are scalar
+// values copied in to the kernel. The encoding of such a request depends only
+// on |N|, so it is laid out at compile time and written directly, without
+// consulting system call metadata or sizing the message at runtime. The
+// response to such a request carries no parameters.
+template <size_t N>
+struct ScalarRequest {
+  static_assert(N <= kParameterMax, "Too many system call parameters.");
+
+  // Size of the encoded request. Differs from sizeof(ScalarRequest) when N is
+  // zero, since an empty std::array still occupies a byte.
+  static constexpr size_t kSize = sizeof(MessageHeader) + N * sizeof(uint64_t);
+
+  template <typename... Ts>
+  explicit ScalarRequest(int sysno, Ts... args)
+      : header(), parameters{{static_cast<uint64_t>(args)...}} {
+    static_assert(sizeof...(Ts) == N, "Parameter count mismatch.");
+    static_assert(internal::AllScalar<Ts...>::value,
+                  "ScalarRequest parameters must be integral values.");
+    header.magic = kMessageMagic;
+    header.flags = kSystemCallRequest;
+    header.sysno = sysno;
+    for (size_t i = 0; i < N; i++) {
+      header.offset[i] = sizeof(MessageHeader) + i * sizeof(uint64_t);
+      header.size[i] = sizeof(uint64_t);
+    }
+  }
+
+  MessageHeader header;
+  std::array<uint64_t, N> parameters;
+} ABSL_ATTRIBUTE_PACKED;
+
 // Read operations on a system call request or response message.
 class MessageReader {
  public:
@@ -195,6 +243,16 @@ class MessageWriter {
   std::array<size_t, kParameterMax> parameter_size_;
 };
 
+// Writes a request for a system call whose request size has a bound known from
+// metadata, that is for which SystemCallDescriptor::max_request_parameters_size
+// is not negative. The request is written in a single pass over the parameters,
+// without first sizing the message. |buffer| must be at least
+// sizeof(MessageHeader) plus that bound bytes long. Returns the size of the
+// message written, which is encoded exactly as by MessageWriter.
+size_t WriteBoundedRequest(
+    int sysno, const std::array<uint64_t, kParameterMax> &parameters,
+    uint8_t *buffer);
+
 // Formats a message as a human-readable string suitable for logging or
 // debugging.
 std::string FormatMessage(primitives::Extent extent);
@@ -44,6 +44,8 @@ struct SystemCallTableEntry {
   const char *name;
   const uint8_t parameter_count;
   const size_t parameter_index;
+  const int32_t max_request_size;   // -1 if it depends on parameter values.
+  const int32_t max_response_size;  // -1 if it depends on parameter values.
 };
 
 struct ParameterTableEntry {
@@ -88,6 +90,14 @@ int SystemCallDescriptor::parameter_count() const {
   return is_valid() ? kSystemCallTable[sysno_].parameter_count : -1;
 }
 
+int64_t SystemCallDescriptor::max_request_parameters_size() const {
+  return is_valid() ? kSystemCallTable[sysno_].max_request_size : -1;
+}
+
+int64_t SystemCallDescriptor::max_response_parameters_size() const {
+  return is_valid() ? kSystemCallTable[sysno_].max_response_size : -1;
+}
+
 ParameterDescriptor SystemCallDescriptor::parameter(int index) const {
   return ParameterDescriptor{sysno_, index};
 }
@@ -19,6 +19,8 @@
 #ifndef ASYLO_PLATFORM_SYSTEM_CALL_METADATA_H_
 #define ASYLO_PLATFORM_SYSTEM_CALL_METADATA_H_
 
+#include <cstdint>
+
 #include "absl/strings/string_view.h"
 
 namespace asylo {
@@ -139,6 +141,16 @@ class SystemCallDescriptor {
   // this descriptor is invalid.
   int parameter_count() const;
 
+  // Returns the largest size in bytes of the parameters encoded in a request
+  // for this system call, computed when the descriptor tables are generated.
+  // Returns -1 if the size depends on the parameter values, because a string
+  // or bounded buffer is copied in, or if this descriptor is invalid.
+  int64_t max_request_parameters_size() const;
+
+  // As max_request_parameters_size(), for the parameters encoded in a
+  // response.
+  int64_t max_response_parameters_size() const;
+
   // Returns a descriptor for the parameter at offset `index` into the parameter
   // list.
   ParameterDescriptor parameter(int index) const;
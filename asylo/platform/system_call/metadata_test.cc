@@ -19,6 +19,7 @@
 #include "asylo/platform/system_call/metadata.h"
 
 #include <sys/poll.h>
+#include <sys/stat.h>
 #include <sys/syscall.h>
 
 #include <string>
@@ -123,6 +124,29 @@ TEST(MetaDataTest, ValidSystemCallDescriptor) {
   EXPECT_THAT(SystemCallDescriptor{SYS_read}.parameter_count(), Eq(3));
 }
 
+TEST(MetaDataTest, MessageSizeBounds) {
+  // close copies a scalar in and nothing out.
+  SystemCallDescriptor close_syscall{SYS_close};
+  EXPECT_THAT(close_syscall.max_request_parameters_size(), Eq(8));
+  EXPECT_THAT(close_syscall.max_response_parameters_size(), Eq(0));
+
+  // fstat copies a fixed size struct out.
+  SystemCallDescriptor fstat_syscall{SYS_fstat};
+  EXPECT_THAT(fstat_syscall.max_request_parameters_size(), Eq(8));
+  EXPECT_THAT(fstat_syscall.max_response_parameters_size(),
+              Eq((sizeof(struct stat) + 7) / 8 * 8));
+
+  // read and write copy bounded buffers out and in.
+  SystemCallDescriptor read_syscall{SYS_read};
+  EXPECT_THAT(read_syscall.max_request_parameters_size(), Eq(16));
+  EXPECT_THAT(read_syscall.max_response_parameters_size(), Eq(-1));
+  SystemCallDescriptor write_syscall{SYS_write};
+  EXPECT_THAT(write_syscall.max_request_parameters_size(), Eq(-1));
+  EXPECT_THAT(write_syscall.max_response_parameters_size(), Eq(0));
+
+  EXPECT_THAT(SystemCallDescriptor{-1}.max_request_parameters_size(), Eq(-1));
+}
+
 TEST(MetaDataTest, ValidParameterDescriptor) {
   SystemCallDescriptor dup{SYS_dup};
   EXPECT_THAT(dup.parameter(0).name().data(), StrEq("fildes"));
@@ -20,6 +20,7 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstring>
 #include <numeric>
 
 #include "absl/strings/str_cat.h"
@@ -41,6 +42,12 @@ typename T::value_type Sum(const T &values) {
 primitives::PrimitiveStatus SerializeRequest(
     int sysno, const std::array<uint64_t, kParameterMax> &parameters,
     primitives::Extent *request) {
+  return SerializeRequest(sysno, parameters, primitives::Extent{}, request);
+}
+
+primitives::PrimitiveStatus SerializeRequest(
+    int sysno, const std::array<uint64_t, kParameterMax> &parameters,
+    primitives::Extent buffer, primitives::Extent *request) {
   SystemCallDescriptor descriptor{sysno};
   if (!descriptor.is_valid()) {
     return primitives::PrimitiveStatus{
@@ -49,6 +56,19 @@ primitives::PrimitiveStatus SerializeRequest(
                      sysno, ") provided.")};
   }
 
+  // Requests copying in only scalars and fixed size objects are written in a
+  // single pass into a buffer of their size bound.
+  int64_t bound = descriptor.max_request_parameters_size();
+  if (bound >= 0) {
+    size_t capacity = sizeof(MessageHeader) + bound;
+    uint8_t *data = buffer.As<uint8_t>();
+    if (buffer.size() < capacity) {
+      data = reinterpret_cast<uint8_t *>(malloc(capacity));
+    }
+    *request = {data, WriteBoundedRequest(sysno, parameters, data)};
+    return primitives::PrimitiveStatus::OkStatus();
+  }
+
   auto writer = MessageWriter::RequestWriter(sysno, parameters);
   size_t size = writer.MessageSize();
 
@@ -81,5 +101,45 @@ primitives::PrimitiveStatus SerializeResponse(
   return primitives::PrimitiveStatus::OkStatus();
 }
 
+primitives::PrimitiveStatus DeserializeResponse(
+    int sysno, const std::array<uint64_t, kParameterMax> &parameters,
+    primitives::Extent response, uint64_t *result, int *error_number) {
+  SystemCallDescriptor descriptor{sysno};
+  if (!descriptor.is_valid()) {
+    return primitives::PrimitiveStatus{
+        error::GoogleError::INVALID_ARGUMENT,
+        absl::StrCat("Could not infer system call descriptor from the sysno (",
+                     sysno, ") provided.")};
+  }
+
+  MessageReader reader(response);
+  primitives::PrimitiveStatus status = reader.Validate();
+  if (!status.ok()) {
+    return status;
+  }
+
+  // Copy outputs back into pointer parameters.
+  for (int i = 0; i < kParameterMax; i++) {
+    ParameterDescriptor parameter = descriptor.parameter(i);
+    if (parameter.is_out()) {
+      size_t size;
+      if (parameter.is_fixed()) {
+        size = parameter.size();
+      } else {
+        size = parameters[parameter.size()] * parameter.element_size();
+      }
+      const void *src = reader.parameter_address<const void *>(i);
+      void *dst = reinterpret_cast<void *>(parameters[i]);
+      if (dst != nullptr) {
+        memcpy(dst, src, size);
+      }
+    }
+  }
+
+  *result = reader.header()->result;
+  *error_number = reader.header()->error_number;
+  return primitives::PrimitiveStatus::OkStatus();
+}
+
 }  // namespace system_call
 }  // namespace asylo
@@ -38,6 +38,15 @@ primitives::PrimitiveStatus SerializeRequest(int sysno,
                                              const ParameterList &parameters,
                                              primitives::Extent *request);
 
+// Serializes a system call request as above, into `buffer` if the request size
+// bound known from metadata fits in it. On success, `request` then refers to a
+// prefix of `buffer`, and otherwise to a buffer allocated by malloc and owned
+// by the caller.
+primitives::PrimitiveStatus SerializeRequest(int sysno,
+                                             const ParameterList &parameters,
+                                             primitives::Extent buffer,
+                                             primitives::Extent *request);
+
 // Serializes a system call response specified by a system call number, a return
 // code, and a list of parameters into a buffer. On success, `response` is
 // populated with a buffer allocated by malloc and owned by the caller.
@@ -46,6 +55,17 @@ primitives::PrimitiveStatus SerializeResponse(int sysno, uint64_t result,
                                               const ParameterList &parameters,
                                               primitives::Extent *response);
 
+// Deserializes a system call response for the system call specified by a
+// system call number and the list of parameters it was issued with. Output
+// parameters are copied back to the buffers designated by `parameters`, and
+// `result` and `error_number` are populated with the return value and kLinux
+// error number of the system call.
+primitives::PrimitiveStatus DeserializeResponse(int sysno,
+                                                const ParameterList &parameters,
+                                                primitives::Extent response,
+                                                uint64_t *result,
+                                                int *error_number);
+
 }  // namespace system_call
 }  // namespace asylo
 
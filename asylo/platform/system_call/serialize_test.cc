@@ -17,6 +17,14 @@
  */
 
 #include "asylo/platform/system_call/serialize.h"
+
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "absl/strings/str_cat.h"
@@ -25,7 +33,9 @@ namespace asylo {
 namespace system_call {
 namespace {
 
+using testing::ElementsAreArray;
 using testing::Eq;
+using testing::Ne;
 using testing::StrEq;
 
 TEST(SerializeTest, SerializeRequestInvalidSysnoTest) {
@@ -54,6 +64,44 @@ TEST(SerializeTest, SerializeResponseInvalidSysnoTest) {
                   10000, ") provided.")));
 }
 
+TEST(SerializeTest, SerializeBoundedRequestIntoBuffer) {
+  struct stat statbuf;
+  ParameterList parameters = {3, reinterpret_cast<uint64_t>(&statbuf)};
+  uint8_t buffer[512];
+  primitives::Extent request;
+  ASSERT_TRUE(
+      SerializeRequest(SYS_fstat, parameters, {buffer, sizeof(buffer)},
+                       &request)
+          .ok());
+  EXPECT_THAT(request.As<uint8_t>(), Eq(buffer));
+
+  // The request is encoded as by a MessageWriter.
+  auto writer = MessageWriter::RequestWriter(SYS_fstat, parameters);
+  std::vector<uint8_t> expected(writer.MessageSize());
+  primitives::Extent expected_extent{expected.data(), expected.size()};
+  writer.Write(&expected_extent);
+  EXPECT_THAT(std::vector<uint8_t>(request.As<uint8_t>(),
+                                   request.As<uint8_t>() + request.size()),
+              ElementsAreArray(expected));
+  EXPECT_TRUE(MessageReader(request).Validate().ok());
+}
+
+TEST(SerializeTest, SerializeRequestAllocatesIfBufferTooSmall) {
+  ParameterList parameters = {3};
+  uint8_t buffer[sizeof(MessageHeader)];
+  primitives::Extent request;
+  ASSERT_TRUE(
+      SerializeRequest(SYS_close, parameters, {buffer, sizeof(buffer)},
+                       &request)
+          .ok());
+  EXPECT_THAT(request.As<uint8_t>(), Ne(buffer));
+  EXPECT_THAT(request.size(), Eq(sizeof(MessageHeader) + sizeof(uint64_t)));
+  MessageReader reader(request);
+  EXPECT_TRUE(reader.Validate().ok());
+  EXPECT_THAT(reader.parameter<uint64_t>(0), Eq(3));
+  free(request.data());
+}
+
 }  // namespace
 }  // namespace system_call
 }  // namespace asylo
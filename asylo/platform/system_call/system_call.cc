@@ -36,12 +36,46 @@ struct MallocDeleter {
   void operator()(uint8_t *buffer) { free(buffer); }
 };
 
+// Size of the buffer requests with a size bound known from metadata are
+// serialized into before being dispatched, which covers every such request.
+constexpr size_t kInlineRequestSize = 1024;
+
 // Default abort handler if none provided.
 void default_error_handler(const char *message) { abort(); }
 
 syscall_dispatch_callback global_syscall_callback = nullptr;
 void (*error_handler)(const char *message) = nullptr;
 
+// Sets errno from the kLinux error number of a system call that returned
+// |result|.
+void SetErrnoFromResult(uint64_t result, int klinux_errno) {
+  if (static_cast<int64_t>(result) == -1) {
+    // Simply having a return value of -1 from a syscall is not a necessary
+    // condition that the syscall failed. Some syscalls can return -1 when
+    // successful (eg., lseek). The reliable way to check for syscall failure is
+    // to therefore check both return value and presence of a non-zero errno.
+    if (klinux_errno != 0) {
+      errno = FromkLinuxErrorNumber(klinux_errno);
+    }
+  }
+}
+
+// Number of the system call the calling thread is dispatching, or -1.
+thread_local int current_sysno = -1;
+
+// Marks the calling thread as dispatching the system call |sysno| for the
+// duration of a scope.
+class ScopedSystemCall {
+ public:
+  explicit ScopedSystemCall(int sysno) : previous_(current_sysno) {
+    current_sysno = sysno;
+  }
+  ~ScopedSystemCall() { current_sysno = previous_; }
+
+ private:
+  int previous_;
+};
+
 }  // namespace
 
 extern "C" bool enc_is_syscall_dispatcher_set() {
@@ -78,17 +112,22 @@ extern "C" int64_t enc_untrusted_syscall(int sysno, ...) {
   }
   va_end(args);
 
-  // Allocate a buffer for the serialized request.
+  // Serialize the request on the stack if it fits, and otherwise into a buffer
+  // allocated for it.
+  alignas(8) uint8_t request_buffer[kInlineRequestSize];
   asylo::primitives::Extent request;
   asylo::primitives::PrimitiveStatus status;
-  status = asylo::system_call::SerializeRequest(sysno, parameters, &request);
+  status = asylo::system_call::SerializeRequest(
+      sysno, parameters, {request_buffer, sizeof(request_buffer)}, &request);
   if (!status.ok()) {
     error_handler(
         "system_call.cc: Encountered serialization error when serializing "
         "syscall parameters.");
   }
 
-  std::unique_ptr<uint8_t, MallocDeleter> request_owner(request.As<uint8_t>());
+  std::unique_ptr<uint8_t, MallocDeleter> request_owner(
+      request.As<uint8_t>() == request_buffer ? nullptr
+                                              : request.As<uint8_t>());
 
   // Invoke the system call dispatch callback to execute the system call.
   uint8_t *response_buffer;
@@ -97,6 +136,7 @@ extern "C" int64_t enc_untrusted_syscall(int sysno, ...) {
   if (!enc_is_syscall_dispatcher_set()) {
     error_handler("system_.cc: system call dispatcher not set.");
   }
+  ScopedSystemCall scoped_syscall(sysno);
   status = global_syscall_callback(request.As<uint8_t>(), request.size(),
                                    &response_buffer, &response_size);
   if (!status.ok()) {
@@ -111,45 +151,64 @@ extern "C" int64_t enc_untrusted_syscall(int sysno, ...) {
         "system_call.cc: null response buffer received for the syscall.");
   }
 
-  // Copy outputs back into pointer parameters.
-  auto response_reader =
-      asylo::system_call::MessageReader({response_buffer, response_size});
-  const asylo::primitives::PrimitiveStatus response_status =
-      response_reader.Validate();
-  if (!response_status.ok()) {
+  uint64_t result;
+  int klinux_errno;
+  status = asylo::system_call::DeserializeResponse(
+      sysno, parameters, {response_buffer, response_size}, &result,
+      &klinux_errno);
+  if (!status.ok()) {
     error_handler(
         "system_call.cc: Error deserializing response buffer into response "
         "reader.");
   }
 
-  for (int i = 0; i < asylo::system_call::kParameterMax; i++) {
-    asylo::system_call::ParameterDescriptor parameter = descriptor.parameter(i);
-    if (parameter.is_out()) {
-      size_t size;
-      if (parameter.is_fixed()) {
-        size = parameter.size();
-      } else {
-        size = parameters[parameter.size()] * parameter.element_size();
-      }
-      const void *src = response_reader.parameter_address(i);
-      void *dst = reinterpret_cast<void *>(parameters[i]);
-      if (dst != nullptr) {
-        memcpy(dst, src, size);
-      }
-    }
+  SetErrnoFromResult(result, klinux_errno);
+  return result;
+}
+
+namespace asylo {
+namespace system_call {
+
+int CurrentSystemCall() { return current_sysno; }
+
+int64_t DispatchScalarSystemCall(int sysno, const void *request, size_t size) {
+  if (!enc_is_error_handler_set()) {
+    enc_set_error_handler(default_error_handler);
+  }
+  if (!enc_is_syscall_dispatcher_set()) {
+    error_handler("system_call.cc: system call dispatcher not set.");
   }
 
-  uint64_t result = response_reader.header()->result;
-  if (static_cast<int64_t>(result) == -1) {
-    int klinux_errno = response_reader.header()->error_number;
+  uint8_t *response_buffer;
+  size_t response_size;
+  ScopedSystemCall scoped_syscall(sysno);
+  primitives::PrimitiveStatus status =
+      global_syscall_callback(reinterpret_cast<const uint8_t *>(request), size,
+                              &response_buffer, &response_size);
+  if (!status.ok()) {
+    error_handler(
+        "system_call.cc: Callback from syscall dispatcher was unsuccessful.");
+  }
 
-    // Simply having a return value of -1 from a syscall is not a necessary
-    // condition that the syscall failed. Some syscalls can return -1 when
-    // successful (eg., lseek). The reliable way to check for syscall failure is
-    // to therefore check both return value and presence of a non-zero errno.
-    if (klinux_errno != 0) {
-      errno = FromkLinuxErrorNumber(klinux_errno);
-    }
+  std::unique_ptr<uint8_t, MallocDeleter> response_owner(response_buffer);
+
+  // A system call without outputs is answered by a bare header, so there are
+  // no parameters to validate or copy back.
+  if (!response_buffer || response_size < sizeof(MessageHeader)) {
+    error_handler(
+        "system_call.cc: Malformed response buffer received for the syscall.");
+  }
+  MessageReader reader({response_buffer, response_size});
+  if (reader.header()->magic != kMessageMagic || !reader.is_response() ||
+      reader.is_request() || reader.sysno() != sysno) {
+    error_handler(
+        "system_call.cc: Malformed response buffer received for the syscall.");
   }
+
+  uint64_t result = reader.result();
+  SetErrnoFromResult(result, static_cast<int>(reader.error_number()));
   return result;
 }
+
+}  // namespace system_call
+}  // namespace asylo
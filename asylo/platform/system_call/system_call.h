@@ -23,6 +23,7 @@
 #include <cstdint>
 
 #include "asylo/platform/primitives/primitive_status.h"
+#include "asylo/platform/system_call/message.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -59,4 +60,31 @@ int64_t enc_untrusted_syscall(int sysno, ...);
 }
 #endif
 
+namespace asylo {
+namespace system_call {
+
+// Returns the number of the system call the calling thread is dispatching to
+// the host, or -1 if it is not dispatching one. Lets the exit calls made to
+// dispatch a system call be attributed to it.
+int CurrentSystemCall();
+
+// Dispatches the serialized request |request| of |size| bytes for a system
+// call whose parameters are all scalar inputs, and returns its result. Only the
+// response header is checked, since such a system call has no outputs to copy
+// back.
+int64_t DispatchScalarSystemCall(int sysno, const void *request, size_t size);
+
+// Invokes the system call |sysno| on the host, with parameters |args| which
+// must all be integral values copied in to the kernel. Equivalent to
+// enc_untrusted_syscall(sysno, args...), but the request is built on the stack
+// with a layout fixed at compile time.
+template <typename... Ts>
+int64_t UntrustedScalarSyscall(int sysno, Ts... args) {
+  ScalarRequest<sizeof...(Ts)> request(sysno, args...);
+  return DispatchScalarSystemCall(sysno, &request, request.kSize);
+}
+
+}  // namespace system_call
+}  // namespace asylo
+
 #endif  // ASYLO_PLATFORM_SYSTEM_CALL_SYSTEM_CALL_H_
@@ -87,6 +87,46 @@ asylo::primitives::PrimitiveStatus InvalidResponseDispatcher(
   return asylo::primitives::PrimitiveStatus::OkStatus();
 }
 
+// Whether the last request dispatched by InPlaceDispatcher was answered in
+// place.
+bool last_response_in_place = false;
+
+// A system call dispatch function which invokes a copy of the request message
+// locally, as the host does, allowing the response to be written over it.
+asylo::primitives::PrimitiveStatus InPlaceDispatcher(
+    const uint8_t *request_buffer, size_t request_size,
+    uint8_t **response_buffer, size_t *response_size) {
+  std::vector<uint8_t> request(request_buffer, request_buffer + request_size);
+  primitives::Extent response;
+
+  ASYLO_RETURN_IF_ERROR(UntrustedInvokeInPlace(
+      {request.data(), request.size()}, &response, &last_response_in_place));
+  if (last_response_in_place) {
+    EXPECT_THAT(response.As<uint8_t>(), Eq(request.data()));
+    *response_buffer = static_cast<uint8_t *>(malloc(response.size()));
+    memcpy(*response_buffer, response.data(), response.size());
+  } else {
+    *response_buffer = response.As<uint8_t>();
+  }
+  *response_size = response.size();
+
+  return asylo::primitives::PrimitiveStatus::OkStatus();
+}
+
+// System call reported by CurrentSystemCall() during the last dispatch made by
+// ObservingDispatcher.
+int dispatched_sysno = -1;
+
+// A system call dispatch function recording the system call being dispatched
+// before invoking it locally.
+asylo::primitives::PrimitiveStatus ObservingDispatcher(
+    const uint8_t *request_buffer, size_t request_size,
+    uint8_t **response_buffer, size_t *response_size) {
+  dispatched_sysno = CurrentSystemCall();
+  return SystemCallDispatcher(request_buffer, request_size, response_buffer,
+                              response_size);
+}
+
 // A system call dispatch function that always fails.
 asylo::primitives::PrimitiveStatus AlwaysFailingDispatcher(
     const uint8_t *request_buffer, size_t request_size,
@@ -103,6 +143,18 @@ TEST(SystemCallTest, ZeroParameterTest) {
   EXPECT_THAT(enc_untrusted_syscall(SYS_getegid), Eq(getegid()));
 }
 
+// Reports the system call being dispatched only while it is dispatched.
+TEST(SystemCallTest, CurrentSystemCallTest) {
+  enc_set_dispatch_syscall(ObservingDispatcher);
+  EXPECT_THAT(CurrentSystemCall(), Eq(-1));
+  EXPECT_THAT(enc_untrusted_syscall(SYS_getpid), Eq(getpid()));
+  EXPECT_THAT(dispatched_sysno, Eq(SYS_getpid));
+  dispatched_sysno = -1;
+  EXPECT_THAT(UntrustedScalarSyscall(kSYS_getpid), Eq(getpid()));
+  EXPECT_THAT(dispatched_sysno, Eq(kSYS_getpid));
+  EXPECT_THAT(CurrentSystemCall(), Eq(-1));
+}
+
 // Invokes a system call which copies a buffer out of the kernel.
 TEST(SystemCallTest, BufferOutTest) {
   enc_set_dispatch_syscall(SystemCallDispatcher);
@@ -132,6 +184,36 @@ TEST(SystemCallTest, ScalarInTest) {
   EXPECT_THAT(fcntl(fd, F_GETFD), Eq(-1));
 }
 
+// Checks that a compile-time scalar request is a valid system call message.
+TEST(SystemCallTest, ScalarRequestIsValidMessage) {
+  ScalarRequest<3> request(kSYS_lseek, 3, -1, SEEK_END);
+  MessageReader reader({&request, request.kSize});
+  EXPECT_TRUE(reader.Validate().ok());
+  EXPECT_TRUE(reader.is_request());
+  EXPECT_THAT(reader.sysno(), Eq(kSYS_lseek));
+  EXPECT_THAT(reader.parameter<int64_t>(1), Eq(-1));
+  EXPECT_THAT(reader.parameter<uint64_t>(2), Eq(SEEK_END));
+}
+
+// Invokes system calls through the scalar fast path.
+TEST(SystemCallTest, ScalarSyscallTest) {
+  enc_set_dispatch_syscall(SystemCallDispatcher);
+  EXPECT_THAT(UntrustedScalarSyscall(kSYS_getpid), Eq(getpid()));
+
+  std::string path =
+      absl::StrCat(absl::GetFlag(FLAGS_test_tmpdir), "/scalar_syscall.tmp");
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+  ASSERT_GE(fd, 0);
+  ASSERT_THAT(write(fd, "asylo", 5), Eq(5));
+  EXPECT_THAT(UntrustedScalarSyscall(kSYS_lseek, fd, 1, SEEK_SET), Eq(1));
+  EXPECT_THAT(UntrustedScalarSyscall(kSYS_close, fd), Eq(0));
+  EXPECT_THAT(fcntl(fd, F_GETFD), Eq(-1));
+
+  errno = 0;
+  EXPECT_THAT(UntrustedScalarSyscall(kSYS_close, fd), Eq(-1));
+  EXPECT_THAT(errno, Eq(EBADF));
+}
+
 // Invokes a system call which takes a string input parameter.
 TEST(SystemCallTest, StringInTest) {
   enc_set_dispatch_syscall(SystemCallDispatcher);
@@ -201,6 +283,38 @@ TEST(SystemCallTest, ArrayOutTest) {
   close(fd[1]);
 }
 
+// Invokes system calls whose responses are written over their requests where
+// they fit.
+TEST(SystemCallTest, InPlaceResponseTest) {
+  enc_set_dispatch_syscall(InPlaceDispatcher);
+
+  // pipe2 copies its file descriptors out in less space than its request.
+  int fd[2];
+  ASSERT_THAT(enc_untrusted_syscall(SYS_pipe2, &fd, 0), Eq(0));
+  EXPECT_TRUE(last_response_in_place);
+  EXPECT_THAT(enc_untrusted_syscall(SYS_write, fd[1], "asylo", 5), Eq(5));
+  EXPECT_TRUE(last_response_in_place);
+  char buf[5];
+  EXPECT_THAT(read(fd[0], buf, sizeof(buf)), Eq(5));
+  EXPECT_THAT(std::string(buf, sizeof(buf)), StrEq("asylo"));
+
+  // fstat copies out a struct larger than its request.
+  struct stat stat_expected;
+  struct stat stat_actual;
+  ASSERT_THAT(fstat(fd[0], &stat_expected), Eq(0));
+  EXPECT_THAT(enc_untrusted_syscall(SYS_fstat, fd[0], &stat_actual), Eq(0));
+  EXPECT_FALSE(last_response_in_place);
+  EXPECT_THAT(memcmp(&stat_expected, &stat_actual, sizeof(struct stat)), Eq(0));
+
+  errno = 0;
+  EXPECT_THAT(enc_untrusted_syscall(SYS_close, -1), Eq(-1));
+  EXPECT_TRUE(last_response_in_place);
+  EXPECT_THAT(errno, Eq(EBADF));
+
+  close(fd[0]);
+  close(fd[1]);
+}
+
 // Ensure that a header file containing system call numbers was generated
 // correctly.
 TEST(SystemCallTest, SysCallNumbers) {
@@ -130,6 +130,12 @@ define_constants(
     include_header_file="sys/inotify.h",
     multi_valued=True)
 
+define_constants(
+    name="RwfFlag",
+    values=["RWF_HIPRI", "RWF_DSYNC", "RWF_SYNC", "RWF_NOWAIT"],
+    include_header_file="sys/uio.h",
+    multi_valued=True)
+
 define_constants(
     name="InotifyEventMask",
     values=[
@@ -303,6 +309,24 @@ define_constants(
     multi_valued=True,
     data_type="unsigned int")
 
+define_constants(
+    name="MmapProtection",
+    values=["PROT_READ", "PROT_WRITE", "PROT_EXEC"],
+    include_header_file="sys/mman.h",
+    multi_valued=True)
+
+define_constants(
+    name="MmapFlag",
+    values=["MAP_SHARED", "MAP_PRIVATE", "MAP_FIXED", "MAP_ANONYMOUS"],
+    include_header_file="sys/mman.h",
+    multi_valued=True)
+
+define_constants(
+    name="MsyncFlag",
+    values=["MS_ASYNC", "MS_SYNC", "MS_INVALIDATE"],
+    include_header_file="sys/mman.h",
+    multi_valued=True)
+
 define_constants(
     name="RusageTarget",
     values=["RUSAGE_SELF", "RUSAGE_CHILDREN"],
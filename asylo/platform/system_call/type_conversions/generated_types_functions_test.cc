@@ -195,6 +195,13 @@ TEST_F(GeneratedTypesFunctionsTest, InotifyFlagsTest) {
                        TokLinuxInotifyFlag);
 }
 
+TEST_F(GeneratedTypesFunctionsTest, RwfFlagsTest) {
+  std::vector<int64_t> from_bits = {kLinux_RWF_HIPRI, kLinux_RWF_DSYNC,
+                                    kLinux_RWF_SYNC, kLinux_RWF_NOWAIT};
+  std::vector<int64_t> to_bits = {RWF_HIPRI, RWF_DSYNC, RWF_SYNC, RWF_NOWAIT};
+  TestMultiValuedEnums(from_bits, to_bits, FromkLinuxRwfFlag, TokLinuxRwfFlag);
+}
+
 TEST_F(GeneratedTypesFunctionsTest, InotifyEventMaskTest) {
   std::vector<uint32_t> from_bits = {
       kLinux_IN_ACCESS,        kLinux_IN_ATTRIB,      kLinux_IN_CLOSE_WRITE,
@@ -160,6 +160,15 @@ struct klinux_pollfd {
   int16_t klinux_revents;
 };
 
+// Header of an inotify event as laid out by the kernel, followed by
+// |klinux_len| bytes holding the null-padded name of the event.
+struct klinux_inotify_event {
+  int32_t klinux_wd;
+  uint32_t klinux_mask;
+  uint32_t klinux_cookie;
+  uint32_t klinux_len;
+};
+
 #define KLINUX_SIGSET_NWORDS (1024 / (8 * sizeof(uint64_t)))
 
 typedef struct {
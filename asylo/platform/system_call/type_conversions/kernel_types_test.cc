@@ -18,6 +18,7 @@
 
 #include <netinet/in.h>
 #include <signal.h>
+#include <sys/inotify.h>
 #include <sys/un.h>
 #include <sys/utsname.h>
 
@@ -77,6 +78,11 @@ TEST(ManualTypesFunctionsTest, EpollEventSizeTest) {
               Eq(sizeof(struct klinux_epoll_event)));
 }
 
+TEST(ManualTypesFunctionsTest, InotifyEventSizeTest) {
+  EXPECT_THAT(sizeof(struct inotify_event),
+              Eq(sizeof(struct klinux_inotify_event)));
+}
+
 TEST(ManualTypesFunctionsTest, RusageSizeTest) {
   EXPECT_THAT(sizeof(struct klinux_rusage), Eq(sizeof(struct rusage)));
 }
@@ -701,6 +701,84 @@ bool FromkLinuxEpollEvent(const struct klinux_epoll_event *input,
   return true;
 }
 
+bool TokLinuxPollfdArray(const struct pollfd *input,
+                         struct klinux_pollfd *output, size_t count) {
+  if (count == 0) return true;
+  if (!input || !output) return false;
+
+  // Avoid the per-element conversion calls when the poll event values agree,
+  // leaving a loop the compiler can vectorize.
+  if (kPollEventIsIdentity) {
+    for (size_t i = 0; i < count; ++i) {
+      output[i].klinux_fd = input[i].fd;
+      output[i].klinux_events = input[i].events & kPollEventMask;
+      output[i].klinux_revents = input[i].revents & kPollEventMask;
+    }
+    return true;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (!TokLinuxPollfd(&input[i], &output[i])) return false;
+  }
+  return true;
+}
+
+bool FromkLinuxPollfdArray(const struct klinux_pollfd *input,
+                           struct pollfd *output, size_t count) {
+  if (count == 0) return true;
+  if (!input || !output) return false;
+
+  if (kPollEventIsIdentity) {
+    for (size_t i = 0; i < count; ++i) {
+      output[i].fd = input[i].klinux_fd;
+      output[i].events = input[i].klinux_events & kPollEventMask;
+      output[i].revents = input[i].klinux_revents & kPollEventMask;
+    }
+    return true;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (!FromkLinuxPollfd(&input[i], &output[i])) return false;
+  }
+  return true;
+}
+
+bool TokLinuxEpollEventArray(const struct epoll_event *input,
+                             struct klinux_epoll_event *output, size_t count) {
+  if (count == 0) return true;
+  if (!input || !output) return false;
+
+  if (kEpollEventsIsIdentity) {
+    for (size_t i = 0; i < count; ++i) {
+      output[i].events = input[i].events & kEpollEventsMask;
+      if (input[i].events != 0 && output[i].events == 0) return false;
+      output[i].data.u64 = input[i].data.u64;
+    }
+    return true;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (!TokLinuxEpollEvent(&input[i], &output[i])) return false;
+  }
+  return true;
+}
+
+bool FromkLinuxEpollEventArray(const struct klinux_epoll_event *input,
+                               struct epoll_event *output, size_t count) {
+  if (count == 0) return true;
+  if (!input || !output) return false;
+
+  if (kEpollEventsIsIdentity) {
+    for (size_t i = 0; i < count; ++i) {
+      output[i].events = input[i].events & kEpollEventsMask;
+      if (input[i].events != 0 && output[i].events == 0) return false;
+      output[i].data.u64 = input[i].data.u64;
+    }
+    return true;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (!FromkLinuxEpollEvent(&input[i], &output[i])) return false;
+  }
+  return true;
+}
+
 bool FromkLinuxRusage(const struct klinux_rusage *input,
                       struct rusage *output) {
   if (!input || !output) {
@@ -31,6 +31,7 @@
 #include <sys/time.h>
 #include <sys/un.h>
 #include <sys/utsname.h>
+#include <cstddef>
 
 #include "asylo/platform/system_call/type_conversions/generated_types.h"
 #include "asylo/platform/system_call/type_conversions/kernel_types.h"
@@ -162,6 +163,16 @@ bool TokLinuxPollfd(const struct pollfd *input, struct klinux_pollfd *output);
 // poll event counterparts.
 bool FromkLinuxPollfd(const struct klinux_pollfd *input, struct pollfd *output);
 
+// Converts an array of |count| enclave based pollfd structs to kernel based
+// pollfd structs. Returns false if any element fails to convert.
+bool TokLinuxPollfdArray(const struct pollfd *input,
+                         struct klinux_pollfd *output, size_t count);
+
+// Converts an array of |count| kernel based pollfd structs to enclave based
+// pollfd structs. Returns false if any element fails to convert.
+bool FromkLinuxPollfdArray(const struct klinux_pollfd *input,
+                           struct pollfd *output, size_t count);
+
 // Converts an enclave based sigset to a kernel based sigset.
 bool TokLinuxSigset(const sigset_t *input, klinux_sigset_t *output);
 
@@ -176,6 +187,16 @@ bool TokLinuxEpollEvent(const struct epoll_event *input,
 bool FromkLinuxEpollEvent(const struct klinux_epoll_event *input,
                           struct epoll_event *output);
 
+// Converts an array of |count| enclave based epoll events to kernel based epoll
+// events. Returns false if any element fails to convert.
+bool TokLinuxEpollEventArray(const struct epoll_event *input,
+                             struct klinux_epoll_event *output, size_t count);
+
+// Converts an array of |count| kernel based epoll events to enclave based epoll
+// events. Returns false if any element fails to convert.
+bool FromkLinuxEpollEventArray(const struct klinux_epoll_event *input,
+                               struct epoll_event *output, size_t count);
+
 // Converts a kernel based rusage to an enclave based rusage.
 bool FromkLinuxRusage(const struct klinux_rusage *input, struct rusage *output);
 
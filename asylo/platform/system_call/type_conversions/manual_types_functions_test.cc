@@ -299,6 +299,71 @@ TEST(ManualTypesFunctionsTest, FromPollFdTest) {
   EXPECT_THAT(poll_fd.revents, Eq(POLLOUT));
 }
 
+TEST(ManualTypesFunctionsTest, PollFdArrayTest) {
+  constexpr int kCount = 17;
+  struct pollfd poll_fds[kCount] = {};
+  for (int i = 0; i < kCount; ++i) {
+    poll_fds[i].fd = i;
+    poll_fds[i].events = i % 2 ? POLLIN : POLLOUT | POLLPRI;
+    poll_fds[i].revents = i % 3 ? POLLHUP : 0;
+  }
+
+  struct klinux_pollfd klinux_poll_fds[kCount] = {};
+  ASSERT_THAT(TokLinuxPollfdArray(poll_fds, klinux_poll_fds, kCount), Eq(true));
+  for (int i = 0; i < kCount; ++i) {
+    struct klinux_pollfd expected {};
+    ASSERT_THAT(TokLinuxPollfd(&poll_fds[i], &expected), Eq(true));
+    EXPECT_THAT(klinux_poll_fds[i].klinux_fd, Eq(expected.klinux_fd));
+    EXPECT_THAT(klinux_poll_fds[i].klinux_events, Eq(expected.klinux_events));
+    EXPECT_THAT(klinux_poll_fds[i].klinux_revents,
+                Eq(expected.klinux_revents));
+  }
+
+  struct pollfd round_trip[kCount] = {};
+  ASSERT_THAT(FromkLinuxPollfdArray(klinux_poll_fds, round_trip, kCount),
+              Eq(true));
+  for (int i = 0; i < kCount; ++i) {
+    EXPECT_THAT(round_trip[i].fd, Eq(poll_fds[i].fd));
+    EXPECT_THAT(round_trip[i].events, Eq(poll_fds[i].events));
+    EXPECT_THAT(round_trip[i].revents, Eq(poll_fds[i].revents));
+  }
+
+  EXPECT_THAT(TokLinuxPollfdArray(nullptr, nullptr, 0), Eq(true));
+  EXPECT_THAT(TokLinuxPollfdArray(nullptr, klinux_poll_fds, 1), Eq(false));
+  EXPECT_THAT(FromkLinuxPollfdArray(klinux_poll_fds, nullptr, 1), Eq(false));
+}
+
+TEST(ManualTypesFunctionsTest, EpollEventArrayTest) {
+  constexpr int kCount = 9;
+  struct epoll_event events[kCount] = {};
+  for (int i = 0; i < kCount; ++i) {
+    events[i].events = i % 2 ? EPOLLIN | EPOLLET : EPOLLOUT;
+    events[i].data.u64 = 0x100000000ULL * i + i;
+  }
+
+  struct klinux_epoll_event klinux_events[kCount] = {};
+  ASSERT_THAT(TokLinuxEpollEventArray(events, klinux_events, kCount), Eq(true));
+  for (int i = 0; i < kCount; ++i) {
+    struct klinux_epoll_event expected {};
+    ASSERT_THAT(TokLinuxEpollEvent(&events[i], &expected), Eq(true));
+    EXPECT_THAT(klinux_events[i].events, Eq(expected.events));
+    EXPECT_THAT(klinux_events[i].data.u64, Eq(events[i].data.u64));
+  }
+
+  struct epoll_event round_trip[kCount] = {};
+  ASSERT_THAT(FromkLinuxEpollEventArray(klinux_events, round_trip, kCount),
+              Eq(true));
+  for (int i = 0; i < kCount; ++i) {
+    EXPECT_THAT(round_trip[i].events, Eq(events[i].events));
+    EXPECT_THAT(round_trip[i].data.u64, Eq(events[i].data.u64));
+  }
+
+  // An element whose events have no kernel counterpart fails the conversion.
+  klinux_events[kCount - 1].events = 0x4000000;
+  EXPECT_THAT(FromkLinuxEpollEventArray(klinux_events, round_trip, kCount),
+              Eq(false));
+}
+
 TEST(ManualTypesFunctionsTest, UtsnameTest) {
   const char *sysname = "abc";
   const char *nodename = "def";
@@ -16,15 +16,20 @@
  *
  */
 
+#include <cstdint>
 #include <fstream>
 #include <map>
+#include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
+#include "absl/strings/ascii.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
 #include "absl/strings/str_replace.h"
 #include "asylo/util/logging.h"
 #include "asylo/platform/system_call/type_conversions/types_macros.inc"
@@ -85,12 +90,135 @@ void WriteMacroProvidedIncludes(std::ostream *os) {
   *os << "\n";
 }
 
+// Returns the name of the kernel counterpart of the C library constant |name|.
+std::string KlinuxName(const std::string &name) {
+  return absl::StrCat(klinux_prefix, "_", name);
+}
+
+// Returns |name| with its first character upper-cased, for use in generated
+// constant names (eg. "timespec" becomes "kTimespec...").
+std::string CapitalizedName(const std::string &name) {
+  std::string result = name;
+  if (!result.empty()) result[0] = absl::ascii_toupper(result[0]);
+  return result;
+}
+
+// Returns the bitwise OR of all the kernel values of a multi-valued enum.
+int64_t GetKlinuxMask(const EnumProperties &enum_properties) {
+  int64_t mask = 0;
+  for (const auto &enum_pair : enum_properties.values) {
+    mask |= enum_pair.second;
+  }
+  return mask;
+}
+
+// Returns whether an identity fast path may be generated for an enum. The fast
+// path applies when every C library constant of the enum has the same value as
+// its kernel counterpart, which is decided by the compiler, not the generator,
+// since the C library values are not known here. Enums whose constants may be
+// undefined are not eligible. The or-based conversion of a multi-valued enum
+// only reduces to a mask when every bit of the mask is itself an enum value;
+// otherwise a partially set multi-bit value would be kept by the mask but
+// dropped by the conversion.
+bool HasIdentityFastPath(const EnumProperties &enum_properties) {
+  if (enum_properties.wrap_macros_with_if_defined ||
+      enum_properties.values.empty()) {
+    return false;
+  }
+  if (!enum_properties.multi_valued) return true;
+
+  std::set<int64_t> values;
+  for (const auto &enum_pair : enum_properties.values) {
+    if (enum_pair.second < 0) return false;
+    values.insert(enum_pair.second);
+  }
+  int64_t mask = GetKlinuxMask(enum_properties);
+  for (int bit = 0; bit < 63; ++bit) {
+    int64_t value = int64_t{1} << bit;
+    if ((mask & value) && values.count(value) == 0) return false;
+  }
+  return true;
+}
+
+// Returns the name of the constant telling whether the C library values of
+// |enum_name| equal the kernel values.
+std::string GetIdentityConstantName(const std::string &enum_name) {
+  return absl::StrCat("k", enum_name, "IsIdentity");
+}
+
+// Returns the name of the constant holding the mask of all kernel values of the
+// multi-valued enum |enum_name|.
+std::string GetMaskConstantName(const std::string &enum_name) {
+  return absl::StrCat("k", enum_name, "Mask");
+}
+
+// Generates the header definitions of the identity (and for multi-valued enums,
+// mask) constants used by the fast path of an enum's conversion functions.
+std::string GetEnumIdentityConstants(const std::string &enum_name,
+                                     const EnumProperties &enum_properties) {
+  std::vector<std::string> comparisons;
+  for (const auto &enum_pair : enum_properties.values) {
+    comparisons.push_back(absl::StrReplaceAll(
+        "static_cast<$data_type>($name) == "
+        "static_cast<$data_type>($klinux_name)",
+        {{"$data_type", enum_properties.data_type},
+         {"$name", enum_pair.first},
+         {"$klinux_name", KlinuxName(enum_pair.first)}}));
+  }
+
+  std::ostringstream os;
+  os << "\nconstexpr bool " << GetIdentityConstantName(enum_name) << " =\n    "
+     << absl::StrJoin(comparisons, " &&\n    ") << ";\n";
+  if (enum_properties.multi_valued) {
+    os << "\nconstexpr " << enum_properties.data_type << " "
+       << GetMaskConstantName(enum_name) << " =\n    static_cast<"
+       << enum_properties.data_type << ">(" << GetKlinuxMask(enum_properties)
+       << "LL);\n";
+  }
+  return os.str();
+}
+
+// Groups the values of a single-valued enum by kernel value, preserving the
+// order in which the values are listed. Multiple enum names may share a kernel
+// value, in which case the first defined one is the conversion result.
+std::vector<std::pair<int64_t, std::vector<std::string>>> GroupByKlinuxValue(
+    const EnumProperties &enum_properties) {
+  std::vector<std::pair<int64_t, std::vector<std::string>>> groups;
+  std::map<int64_t, size_t> group_index;
+  for (const auto &enum_pair : enum_properties.values) {
+    auto it = group_index.find(enum_pair.second);
+    if (it == group_index.end()) {
+      group_index[enum_pair.second] = groups.size();
+      groups.push_back({enum_pair.second, {enum_pair.first}});
+    } else {
+      groups[it->second].second.push_back(enum_pair.first);
+    }
+  }
+  return groups;
+}
+
 // Generates the function body for enum type conversions where the enums can be
 // multi-valued.
 std::string GetOrBasedEnumBody(bool to_prefix, const std::string &enum_name,
                                const EnumProperties &enum_properties) {
   std::ostringstream os;
 
+  // Generate the identity fast path, which reduces the conversion to a single
+  // mask operation when the C library and kernel values agree.
+  if (HasIdentityFastPath(enum_properties)) {
+    int64_t default_output = to_prefix ? enum_properties.default_value_host
+                                       : enum_properties.default_value_enclave;
+    os << "  if (" << GetIdentityConstantName(enum_name) << ") {\n"
+       << "    return static_cast<" << enum_properties.data_type << ">("
+       << default_output << " | "
+       << (enum_properties.or_input_to_default_value
+               ? "input"
+               : absl::StrCat("(input & ", GetMaskConstantName(enum_name),
+                              ")"))
+       << ");\n"
+       << "  }\n";
+  }
+
   // Generate result initialization.
   os << "  " << enum_properties.data_type << " output = "
      << (to_prefix ? enum_properties.default_value_host
@@ -126,53 +254,132 @@ std::string GetOrBasedEnumBody(bool to_prefix, const std::string &enum_name,
   return os.str();
 }
 
+// Generates a switch statement over the kernel values of a single-valued enum.
+// Unlike the C library values, the kernel values are known to the generator,
+// so duplicates are merged into a single case and the compiler may lower the
+// switch to a lookup table. When |return_input| is set, every case returns the
+// input unchanged, which is used by the identity fast path. Otherwise each
+// case returns the first defined C library value for that kernel value.
+std::string GetKlinuxSwitch(bool return_input,
+                            const EnumProperties &enum_properties,
+                            const std::string &indent) {
+  std::ostringstream os;
+  os << indent << "switch (input) {\n";
+  for (const auto &group : GroupByKlinuxValue(enum_properties)) {
+    os << indent << "  case " << KlinuxName(group.second.front()) << ":\n";
+    if (return_input) continue;
+    if (!enum_properties.wrap_macros_with_if_defined) {
+      os << indent << "    return " << group.second.front() << ";\n";
+      continue;
+    }
+    for (size_t i = 0; i < group.second.size(); ++i) {
+      os << (i == 0 ? "#if" : "#elif") << " defined(" << group.second[i]
+         << ")\n"
+         << indent << "    return " << group.second[i] << ";\n";
+    }
+    os << "#else\n" << indent << "    break;\n#endif\n";
+  }
+  if (return_input) os << indent << "    return input;\n";
+  os << indent << "  default:\n" << indent << "    break;\n";
+  os << indent << "}\n";
+  return os.str();
+}
+
+// Generates the default return statement of a single-valued enum conversion.
+std::string GetDefaultReturn(bool to_prefix,
+                             const EnumProperties &enum_properties,
+                             const std::string &indent) {
+  int64_t default_output = to_prefix ? enum_properties.default_value_host
+                                     : enum_properties.default_value_enclave;
+  if (enum_properties.or_input_to_default_value) {
+    return absl::StrCat(indent, "return ", default_output, " | input;\n");
+  }
+  return absl::StrCat(indent, "return ", default_output, ";\n");
+}
+
 // Generate the function body for enum type conversions where the enums cannot
-// be multi-valued. Uses an if condition based implementation to find the
-// matching enum. A switch case should not be used here because enum values may
-// be duplicate.
+// be multi-valued. Conversions from kernel values switch over the kernel
+// values, which are known when generating. Conversions to kernel values use an
+// if condition based implementation to find the matching enum, since the C
+// library values may be duplicate and are only known when compiling. These
+// first check whether the C library values equal the kernel values, in which
+// case only membership of the input needs to be tested.
 std::string GetIfBasedEnumBody(bool to_prefix, const std::string &enum_name,
                                const EnumProperties &enum_properties) {
   std::ostringstream os;
-  for (const auto &enum_pair : enum_properties.values) {
-    std::string input_val =
-        to_prefix ? enum_pair.first
-                  : absl::StrCat(klinux_prefix, "_", enum_pair.first);
-    std::string output_val =
-        to_prefix ? absl::StrCat(klinux_prefix, "_", enum_pair.first)
-                  : enum_pair.first;
+  if (!to_prefix) {
+    os << GetKlinuxSwitch(/*return_input=*/false, enum_properties, "  ");
+    os << GetDefaultReturn(to_prefix, enum_properties, "  ");
+    return os.str();
+  }
+
+  if (HasIdentityFastPath(enum_properties)) {
+    os << "  if (" << GetIdentityConstantName(enum_name) << ") {\n"
+       << GetKlinuxSwitch(/*return_input=*/true, enum_properties, "    ")
+       << GetDefaultReturn(to_prefix, enum_properties, "    ") << "  }\n";
+  }
 
+  for (const auto &enum_pair : enum_properties.values) {
     if (enum_properties.wrap_macros_with_if_defined) {
       os << "#if defined(" << enum_pair.first << ")\n";
     }
     os << absl::StrReplaceAll(
         "  if (input == $input_val) return $output_val;\n",
-        {{"$input_val", input_val}, {"$output_val", output_val}});
+        {{"$input_val", enum_pair.first},
+         {"$output_val", KlinuxName(enum_pair.first)}});
     if (enum_properties.wrap_macros_with_if_defined) {
       os << "#endif\n";
     }
   }
 
   // Generate code for handling default case.
-  int64_t default_output = to_prefix ? enum_properties.default_value_host
-                                     : enum_properties.default_value_enclave;
-  if (enum_properties.or_input_to_default_value) {
-    os << "  return " << default_output << " | input;\n";
-  } else {
-    os << "  return " << default_output << ";\n";
-  }
+  os << GetDefaultReturn(to_prefix, enum_properties, "  ");
   return os.str();
 }
 
+// Generates the definition of a constant telling whether the C library struct
+// |name| and its kernel counterpart have the same layout, in which case the
+// conversions reduce to a copy. Like the enum values, the C library layout is
+// only known when compiling.
+std::string GetStructLayoutConstant(const std::string &name,
+                                    const std::string &layout_constant,
+                                    const StructProperties &struct_properties) {
+  std::string klinux_name = KlinuxName(name);
+  std::vector<std::string> comparisons = {absl::StrReplaceAll(
+      "sizeof(struct $name) == sizeof(struct $klinux_name)",
+      {{"$name", name}, {"$klinux_name", klinux_name}})};
+  for (const auto &member_pair : struct_properties.values) {
+    comparisons.push_back(absl::StrReplaceAll(
+        "offsetof(struct $name, $member) == "
+        "offsetof(struct $klinux_name, $klinux_member) &&\n    "
+        "sizeof(static_cast<struct $name *>(nullptr)->$member) ==\n        "
+        "sizeof(static_cast<struct $klinux_name *>(nullptr)->$klinux_member)",
+        {{"$name", name},
+         {"$klinux_name", klinux_name},
+         {"$member", member_pair.first},
+         {"$klinux_member", KlinuxName(member_pair.first)}}));
+  }
+  return absl::StrCat("\nconstexpr bool ", layout_constant, " =\n    ",
+                      absl::StrJoin(comparisons, " &&\n    "), ";\n");
+}
+
 // Generate the function definition for struct type conversions. Depending on
 // the value provided for |to_klinux|, this function generates the function
 // definition for conversions to and from kernel struct types respectively.
+// When |layout_constant| holds, the struct is copied as a whole.
 std::string GetStructConversionsFuncBody(
     bool to_klinux, const std::string &input_struct,
     const std::string &output_struct,
+    const std::string &layout_constant,
     const StructProperties &struct_properties) {
   std::ostringstream os;
   os << "  if (!" << input_struct << " || !" << output_struct
      << ") return false;\n";
+  os << "  if (" << layout_constant << ") {\n"
+     << "    memcpy(" << output_struct << ", " << input_struct << ", sizeof(*"
+     << output_struct << "));\n"
+     << "    return true;\n"
+     << "  }\n";
 
   for (const auto &member_pair : struct_properties.values) {
     std::string klinux_member =
@@ -199,10 +406,6 @@ void WriteEnumConversions(
       continue;
     }
 
-    std::string enum_name_lower = it.first;
-    std::transform(enum_name_lower.begin(), enum_name_lower.end(),
-                   enum_name_lower.begin(), ::tolower);
-
     std::string to_prefix_decl = absl::StrReplaceAll(
         "$data_type To$klinux_prefix$enum_name($data_type input)",
         {{"$klinux_prefix", klinux_prefix},
@@ -214,7 +417,11 @@ void WriteEnumConversions(
          {"$enum_name", it.first},
          {"$data_type", it.second.data_type}});
 
-    // Write the function declarations to the header file.
+    // Write the fast path constants and function declarations to the header
+    // file.
+    if (HasIdentityFastPath(it.second)) {
+      *os_h << GetEnumIdentityConstants(it.first, it.second);
+    }
     *os_h << "\n" << to_prefix_decl << "; \n";
     *os_h << "\n" << from_prefix_decl << "; \n";
 
@@ -222,17 +429,17 @@ void WriteEnumConversions(
     if (it.second.multi_valued) {
       *os_cc << "\n"
              << to_prefix_decl << " {\n"
-             << GetOrBasedEnumBody(true, enum_name_lower, it.second) << "}\n";
+             << GetOrBasedEnumBody(true, it.first, it.second) << "}\n";
       *os_cc << "\n"
              << from_prefix_decl << " {\n"
-             << GetOrBasedEnumBody(false, enum_name_lower, it.second) << "}\n";
+             << GetOrBasedEnumBody(false, it.first, it.second) << "}\n";
     } else {
       *os_cc << "\n"
              << to_prefix_decl << " {\n"
-             << GetIfBasedEnumBody(true, enum_name_lower, it.second) << "}\n";
+             << GetIfBasedEnumBody(true, it.first, it.second) << "}\n";
       *os_cc << "\n"
              << from_prefix_decl << " {\n"
-             << GetIfBasedEnumBody(false, enum_name_lower, it.second) << "}\n";
+             << GetIfBasedEnumBody(false, it.first, it.second) << "}\n";
     }
   }
 }
@@ -268,7 +475,11 @@ void WriteStructConversions(
          {"$struct_var", struct_var},
          {"$klinux_struct_var", klinux_struct_var}});
 
-    // Write the function declarations to the header file.
+    std::string layout_constant =
+        absl::StrCat("k", CapitalizedName(it.first), "LayoutIsIdentity");
+
+    // Write the layout constant and function declarations to the header file.
+    *os_h << GetStructLayoutConstant(it.first, layout_constant, it.second);
     *os_h << "\n" << to_klinux_declaration << "; \n";
     *os_h << "\n" << from_klinux_declaration << "; \n";
 
@@ -276,12 +487,12 @@ void WriteStructConversions(
     *os_cc << "\n"
            << to_klinux_declaration << " {\n"
            << GetStructConversionsFuncBody(true, struct_var, klinux_struct_var,
-                                           it.second)
+                                           layout_constant, it.second)
            << "}\n";
     *os_cc << "\n"
            << from_klinux_declaration << " {\n"
            << GetStructConversionsFuncBody(false, klinux_struct_var, struct_var,
-                                           it.second)
+                                           layout_constant, it.second)
            << "}\n";
   }
 }
@@ -368,10 +579,12 @@ void WriteTypesConversions(
         << "#define " << header_guard << "\n\n";
 
   // Write all the includes.
+  *os_h << "#include <cstddef>\n";
   WriteMacroProvidedIncludes(os_h);
   *os_cc << "#include "
             "\"asylo/platform/system_call/type_conversions/"
-            "generated_types_functions.h\"\n";
+            "generated_types_functions.h\"\n\n"
+         << "#include <cstring>\n";
   *os_h << "#include "
            "\"asylo/platform/system_call/type_conversions/"
            "generated_types.h\"\n";
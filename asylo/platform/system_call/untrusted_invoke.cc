@@ -21,19 +21,56 @@
 #include <errno.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <vector>
 
+#include "asylo/platform/system_call/message.h"
 #include "asylo/platform/system_call/metadata.h"
 #include "asylo/platform/system_call/serialize.h"
 
 namespace asylo {
 namespace system_call {
 
-primitives::PrimitiveStatus UntrustedInvoke(primitives::Extent request,
-                                            primitives::Extent *response) {
+namespace {
+
+// Size of the stack buffer holding the output parameters of a system call
+// whose response is written in place.
+constexpr size_t kInPlaceOutputSize = 1024;
+
+// Returns the smallest multiple of 8 greater than or equal to |value|.
+size_t RoundUpToMultipleOf8(size_t value) { return (value + 7) / 8 * 8; }
+
+// Returns the size of an output parameter of a request.
+size_t OutputSize(const MessageReader &reader, ParameterDescriptor parameter) {
+  if (parameter.is_bounded()) {
+    int bounding_index = parameter.bounding_parameter().index();
+    return reader.parameter<size_t>(bounding_index) * parameter.element_size();
+  }
+  return parameter.size();
+}
+
+// Returns the size of an output parameter kept in the stack buffer of a
+// response written in place. Parameters copied both in and out take the larger
+// of their input and output sizes, and none if the input is null.
+size_t InPlaceSize(const MessageReader &reader, ParameterDescriptor parameter) {
+  if (parameter.is_scalar()) {
+    return sizeof(uint64_t);
+  }
+  size_t size = OutputSize(reader, parameter);
+  if (parameter.is_in()) {
+    size_t input_size = reader.parameter_size(parameter.index());
+    return input_size == 0 ? 0 : std::max(size, input_size);
+  }
+  return size;
+}
+
+primitives::PrimitiveStatus Invoke(primitives::Extent request,
+                                   primitives::Extent *response,
+                                   bool allow_in_place, bool *in_place) {
   MessageReader reader(request);
   SystemCallDescriptor descriptor(reader.sysno());
 
@@ -41,6 +78,30 @@ primitives::PrimitiveStatus UntrustedInvoke(primitives::Extent request,
   std::array<uint64_t, kParameterMax> params;
   params.fill(0);
 
+  // Whether the response may be written over the request is decided before the
+  // system call, since the request buffer holds its inputs. Output parameters
+  // are then kept in |in_place_outputs| rather than on the heap. Requests with
+  // an invalid sysno are left to SerializeResponse() to reject.
+  alignas(8) char in_place_outputs[kInPlaceOutputSize];
+  size_t in_place_offset = 0;
+  *in_place = false;
+  if (allow_in_place && descriptor.is_valid()) {
+    size_t outputs_size = 0;
+    *in_place = true;
+    for (int i = 0; i < kParameterMax && *in_place; i++) {
+      ParameterDescriptor parameter = descriptor.parameter(i);
+      if (parameter.is_out()) {
+        size_t size = InPlaceSize(reader, parameter);
+        *in_place = size <= kInPlaceOutputSize - outputs_size;
+        if (*in_place) {
+          outputs_size += RoundUpToMultipleOf8(size);
+        }
+      }
+    }
+    *in_place =
+        *in_place && sizeof(MessageHeader) + outputs_size <= request.size();
+  }
+
   // A vector of buffers allocated for output params.
   std::vector<std::unique_ptr<char[]>> output_buffers;
 
@@ -50,30 +111,70 @@ primitives::PrimitiveStatus UntrustedInvoke(primitives::Extent request,
       // Read an input parameter from the request.
       if (parameter.is_pointer()) {
         params[i] = reader.parameter_address<uint64_t>(i);
+        // Inputs copied back out must not alias the request being overwritten.
+        if (*in_place && parameter.is_out() && params[i]) {
+          size_t size = InPlaceSize(reader, parameter);
+          char *output = in_place_outputs + in_place_offset;
+          memset(output, 0, size);
+          memcpy(output, reinterpret_cast<const void *>(params[i]),
+                 reader.parameter_size(i));
+          params[i] = reinterpret_cast<uint64_t>(output);
+          in_place_offset += RoundUpToMultipleOf8(size);
+        }
       } else {
         params[i] = reader.parameter<uint64_t>(i);
       }
     } else if (parameter.is_out()) {
       // Otherwise, allocate storage for the result.
-      size_t size;
-      if (parameter.is_bounded()) {
-        int bounding_index = parameter.bounding_parameter().index();
-        size =
-            reader.parameter<size_t>(bounding_index) * parameter.element_size();
+      if (*in_place) {
+        size_t size = InPlaceSize(reader, parameter);
+        char *output = in_place_outputs + in_place_offset;
+        memset(output, 0, size);
+        params[i] = reinterpret_cast<uint64_t>(output);
+        in_place_offset += RoundUpToMultipleOf8(size);
       } else {
-        size = parameter.size();
+        size_t size = OutputSize(reader, parameter);
+        output_buffers.emplace_back(new char[size]());
+        params[i] = reinterpret_cast<uint64_t>(output_buffers.back().get());
       }
-      output_buffers.emplace_back(new char[size]());
-      params[i] = reinterpret_cast<uint64_t>(output_buffers.back().get());
     }
   }
 
   // Invoke the native system call.
-  uint64_t result = syscall(reader.sysno(), params[0], params[1], params[2],
-                            params[3], params[4], params[5]);
+  int sysno = reader.sysno();
+  uint64_t result = syscall(sysno, params[0], params[1], params[2], params[3],
+                            params[4], params[5]);
+  int error_number = errno;
+
+  // Build the response message. Should it not fit in the request buffer after
+  // all, it is serialized to a fresh buffer rather than overrunning the
+  // request.
+  if (*in_place) {
+    auto writer =
+        MessageWriter::ResponseWriter(sysno, result, error_number, params);
+    if (writer.MessageSize() <= request.size()) {
+      *response = {request.data(), writer.MessageSize()};
+      memset(request.data(), 0, sizeof(MessageHeader));
+      writer.Write(response);
+      return primitives::PrimitiveStatus::OkStatus();
+    }
+    *in_place = false;
+  }
+  return SerializeResponse(sysno, result, error_number, params, response);
+}
+
+}  // namespace
+
+primitives::PrimitiveStatus UntrustedInvoke(primitives::Extent request,
+                                            primitives::Extent *response) {
+  bool in_place;
+  return Invoke(request, response, /*allow_in_place=*/false, &in_place);
+}
 
-  // Build the response message.
-  return SerializeResponse(reader.sysno(), result, errno, params, response);
+primitives::PrimitiveStatus UntrustedInvokeInPlace(primitives::Extent request,
+                                                   primitives::Extent *response,
+                                                   bool *in_place) {
+  return Invoke(request, response, /*allow_in_place=*/true, in_place);
 }
 
 }  // namespace system_call
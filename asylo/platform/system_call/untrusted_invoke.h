@@ -33,6 +33,14 @@ namespace system_call {
 primitives::PrimitiveStatus UntrustedInvoke(primitives::Extent request,
                                             primitives::Extent *response);
 
+// Invokes a system call as UntrustedInvoke() does, writing the response over
+// `request` if it fits in the request buffer. In that case `*in_place` is set
+// to true and `response` refers to a prefix of `request`. Otherwise `response`
+// is allocated by malloc and owned by the caller.
+primitives::PrimitiveStatus UntrustedInvokeInPlace(primitives::Extent request,
+                                                   primitives::Extent *response,
+                                                   bool *in_place);
+
 }  // namespace system_call
 }  // namespace asylo
 
@@ -40,4 +40,19 @@ struct key_info {
   uint8_t *data;
 } __attribute__((packed));
 
+// IOCTL to set the block length of a newly created secure file. Must be issued
+// before ENCLAVE_STORAGE_SET_KEY. The block length must be a power of two
+// between 128 bytes and 64 KiB. Larger blocks amortize the per-block integrity
+// metadata over more data, at the cost of rewriting a full block on every
+// partial block write. Existing files keep the block length they were created
+// with.
+#ifndef ENCLAVE_STORAGE_SET_BLOCK_LENGTH
+#define ENCLAVE_STORAGE_SET_BLOCK_LENGTH \
+  (ENCLAVE_STORAGE_IOCTL_TYPE | 0x00000002)
+#endif
+
+struct block_length_info {
+  uint32_t length;
+} __attribute__((packed));
+
 #endif  // ASYLO_SECURE_STORAGE_H_
@@ -18,12 +18,15 @@
 
 #include <pthread.h>
 #include <stdio.h>
+#include <atomic>
 #include <cstring>
 #include <thread>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "absl/synchronization/barrier.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "asylo/util/logging.h"
 #include "asylo/platform/common/time_util.h"
 #include "asylo/test/util/pthread_test_util.h"
@@ -106,9 +109,10 @@ TEST_F(RwLockTest, Init) {
   ASSERT_EQ(pthread_rwlock_init(&rwlock, nullptr), 0);
 
   ASSERT_EQ(rwlock._write_owner, rwlock_._write_owner);
-  ASSERT_EQ(rwlock._queue._first, rwlock_._queue._first);
   ASSERT_EQ(rwlock._lock, rwlock_._lock);
-  ASSERT_EQ(rwlock._reader_count, rwlock_._reader_count);
+  ASSERT_EQ(rwlock._state, rwlock_._state);
+  ASSERT_EQ(rwlock._sequence, rwlock_._sequence);
+  ASSERT_EQ(rwlock._waiters, rwlock_._waiters);
 }
 
 TEST_F(RwLockTest, ManyThreads) {
@@ -146,5 +150,30 @@ TEST_F(RwLockTest, MultipleReaders) {
   EXPECT_EQ(pthread_rwlock_destroy(&rwlock_), 0);
 }
 
+TEST_F(RwLockTest, WriterExcludesReaders) {
+  EXPECT_EQ(pthread_rwlock_wrlock(&rwlock_), 0);
+  EXPECT_EQ(pthread_rwlock_wrlock(&rwlock_), EDEADLK);
+  EXPECT_EQ(pthread_rwlock_rdlock(&rwlock_), EDEADLK);
+  EXPECT_EQ(pthread_rwlock_destroy(&rwlock_), EBUSY);
+
+  // A reader blocks until the writer releases the rwlock.
+  std::atomic<bool> read_locked(false);
+  std::thread reader([&]() {
+    EXPECT_EQ(pthread_rwlock_tryrdlock(&rwlock_), EBUSY);
+    EXPECT_EQ(pthread_rwlock_rdlock(&rwlock_), 0);
+    read_locked = true;
+    EXPECT_EQ(pthread_rwlock_unlock(&rwlock_), 0);
+  });
+  absl::SleepFor(absl::Milliseconds(100));
+  EXPECT_FALSE(read_locked);
+  EXPECT_EQ(pthread_rwlock_unlock(&rwlock_), 0);
+  reader.join();
+  EXPECT_TRUE(read_locked);
+
+  // Unlocking a free rwlock fails.
+  EXPECT_EQ(pthread_rwlock_unlock(&rwlock_), EPERM);
+  EXPECT_EQ(pthread_rwlock_destroy(&rwlock_), 0);
+}
+
 }  // namespace
 }  // namespace asylo
@@ -18,6 +18,8 @@
 
 #include <pthread.h>
 
+#include <atomic>
+#include <cerrno>
 #include <cstdio>
 #include <thread>
 
@@ -170,6 +172,45 @@ TEST(ThreadedTest, ThreadKeys) {
   EXPECT_EQ(pthread_key_delete(tls_key2), 0);
 }
 
+TEST(ThreadedTest, RecreatedKeyStartsNull) {
+  pthread_key_t tls_key;
+  EXPECT_EQ(pthread_key_create(&tls_key, nullptr), 0);
+  int used_for_address;
+  EXPECT_EQ(pthread_setspecific(tls_key, &used_for_address), 0);
+  EXPECT_EQ(pthread_key_delete(tls_key), 0);
+  EXPECT_EQ(pthread_key_delete(tls_key), EINVAL);
+
+  // A key allocated again does not observe values set for its previous use.
+  pthread_key_t new_key;
+  EXPECT_EQ(pthread_key_create(&new_key, nullptr), 0);
+  EXPECT_EQ(new_key, tls_key);
+  EXPECT_EQ(pthread_getspecific(new_key), nullptr);
+  EXPECT_EQ(pthread_key_delete(new_key), 0);
+}
+
+static std::atomic<int> tsd_destructor_calls(0);
+
+void *set_destructed_value(void *arg) {
+  pthread_setspecific(*static_cast<pthread_key_t *>(arg), &global_arg);
+  return nullptr;
+}
+
+TEST(ThreadedTest, ThreadSpecificDestructor) {
+  pthread_key_t tls_key;
+  EXPECT_EQ(pthread_key_create(&tls_key, [](void *value) {
+              EXPECT_EQ(value, &global_arg);
+              tsd_destructor_calls++;
+            }),
+            0);
+
+  pthread_t thread;
+  ASSERT_EQ(pthread_create(&thread, nullptr, set_destructed_value, &tls_key),
+            0);
+  EXPECT_EQ(pthread_join(thread, nullptr), 0);
+  EXPECT_EQ(tsd_destructor_calls.load(), 1);
+  EXPECT_EQ(pthread_key_delete(tls_key), 0);
+}
+
 // Tests that pthread_create works and that the pthread_mutex_.* symbols are
 // present and do not crash. This does not test the correctness of the mutex.
 TEST(ThreadedTest, EnclaveThread) {
@@ -0,0 +1,65 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include <benchmark/benchmark.h>
+
+ABSL_FLAG(std::string, benchmarks, "",
+          "A regular expression that specifies the set of benchmarks "
+          "to execute.  If this flag is empty, no benchmarks are run. "
+          "If this flag is the string \"all\", all benchmarks linked "
+          "into the process are run.");
+
+ABSL_FLAG(std::string, benchmark_out, "",
+          "A file to which results of the benchmarks selected by --benchmarks "
+          "are also written, in the format given by --benchmark_out_format.");
+
+ABSL_FLAG(std::string, benchmark_out_format, "json",
+          "The format of --benchmark_out, one of \"json\", \"csv\" or "
+          "\"console\".");
+
+// Runs the benchmarks selected by --benchmarks, followed by all gtest tests.
+// --benchmarks has the same meaning as for benchmarks run inside an enclave by
+// the test shim loader.
+int main(int argc, char *argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  absl::ParseCommandLine(argc, argv);
+
+  std::string benchmarks = absl::GetFlag(FLAGS_benchmarks);
+  if (!benchmarks.empty()) {
+    std::string filter =
+        "--benchmark_filter=" + (benchmarks == "all" ? "." : benchmarks);
+    std::vector<char *> benchmark_argv = {argv[0], &filter[0]};
+    std::string out = "--benchmark_out=" + absl::GetFlag(FLAGS_benchmark_out);
+    std::string out_format = "--benchmark_out_format=" +
+                             absl::GetFlag(FLAGS_benchmark_out_format);
+    if (!absl::GetFlag(FLAGS_benchmark_out).empty()) {
+      benchmark_argv.push_back(&out[0]);
+      benchmark_argv.push_back(&out_format[0]);
+    }
+    int benchmark_argc = benchmark_argv.size();
+    benchmark::Initialize(&benchmark_argc, benchmark_argv.data());
+    benchmark::RunSpecifiedBenchmarks();
+  }
+  return RUN_ALL_TESTS();
+}
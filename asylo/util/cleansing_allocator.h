@@ -25,6 +25,8 @@
 #include <memory>
 #include <type_traits>
 
+#include "asylo/util/secret_pool_allocator.h"
+
 namespace asylo {
 
 /// CleansingAllocator is a minimal C++11
@@ -38,7 +40,11 @@ namespace asylo {
 /// underlying allocator in a passthrough fashion. It however cleanses the
 /// memory being deallocated before passing it to the deallocate method of
 /// the underlying allocator.
-template <typename T, class A = std::allocator<T>>
+//
+/// By default, the underlying allocator is SecretPoolAllocator, which recycles
+/// the cleansed memory of small allocations instead of returning it to the
+/// heap.
+template <typename T, class A = SecretPoolAllocator<T>>
 class CleansingAllocator {
  public:
   using value_type = typename std::allocator_traits<A>::value_type;
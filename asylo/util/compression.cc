@@ -0,0 +1,178 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/util/compression.h"
+
+#include <openssl/mem.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#include "absl/strings/str_cat.h"
+#include "asylo/util/cleanup.h"
+
+namespace asylo {
+namespace {
+
+// Largest number of bytes passed to zlib at once, whose lengths are 32-bit.
+constexpr size_t kMaxZlibChunk = std::numeric_limits<uInt>::max();
+
+// Length by which the output buffer of Decompress() grows at a time.
+constexpr size_t kDecompressChunk = 64 * 1024;
+
+// zlib allocation functions that cleanse the working memory of the
+// compressor, which holds a window of the data, when it is freed. Each
+// allocation is prefixed with its length.
+void *CleansingZalloc(void *opaque, uInt items, uInt size) {
+  size_t length = static_cast<size_t>(items) * size;
+  size_t *block = static_cast<size_t *>(malloc(sizeof(size_t) + length));
+  if (!block) {
+    return Z_NULL;
+  }
+  *block = length;
+  return block + 1;
+}
+
+void CleansingZfree(void *opaque, void *address) {
+  size_t *block = static_cast<size_t *>(address) - 1;
+  OPENSSL_cleanse(address, *block);
+  free(block);
+}
+
+void InitStream(z_stream *stream) {
+  memset(stream, 0, sizeof(*stream));
+  stream->zalloc = &CleansingZalloc;
+  stream->zfree = &CleansingZfree;
+}
+
+}  // namespace
+
+Status Compress(ByteContainerView data, CleansingVector<uint8_t> *compressed) {
+  z_stream stream;
+  InitStream(&stream);
+  if (deflateInit(&stream, Z_DEFAULT_COMPRESSION) != Z_OK) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Failed to initialize the compressor");
+  }
+  Cleanup end_stream([&stream] { deflateEnd(&stream); });
+
+  // deflateBound() only takes a 32-bit length, so bound larger inputs by
+  // summing the bounds of their chunks.
+  size_t bound = 0;
+  for (size_t offset = 0; offset < data.size(); offset += kMaxZlibChunk) {
+    bound += deflateBound(&stream, static_cast<uLong>(std::min(
+                                       kMaxZlibChunk, data.size() - offset)));
+  }
+  compressed->resize(std::max(bound, deflateBound(&stream, 0)));
+
+  size_t consumed = 0;
+  size_t produced = 0;
+  int result;
+  do {
+    size_t input = std::min(kMaxZlibChunk, data.size() - consumed);
+    size_t output = std::min(kMaxZlibChunk, compressed->size() - produced);
+    stream.next_in = const_cast<Bytef *>(data.data() + consumed);
+    stream.avail_in = static_cast<uInt>(input);
+    stream.next_out = compressed->data() + produced;
+    stream.avail_out = static_cast<uInt>(output);
+    bool last = consumed + input == data.size();
+    result = deflate(&stream, last ? Z_FINISH : Z_NO_FLUSH);
+    if (result == Z_STREAM_ERROR) {
+      return Status(error::GoogleError::INTERNAL, "Compression failed");
+    }
+    consumed += input - stream.avail_in;
+    produced += output - stream.avail_out;
+    if (result != Z_STREAM_END && produced == compressed->size()) {
+      return Status(error::GoogleError::INTERNAL,
+                    "Compressed data exceeds its bound");
+    }
+  } while (result != Z_STREAM_END);
+  compressed->resize(produced);
+  return Status::OkStatus();
+}
+
+Status Decompress(ByteContainerView compressed, size_t max_length,
+                  CleansingVector<uint8_t> *data) {
+  z_stream stream;
+  InitStream(&stream);
+  if (inflateInit(&stream) != Z_OK) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Failed to initialize the decompressor");
+  }
+  Cleanup end_stream([&stream] { inflateEnd(&stream); });
+
+  CleansingVector<uint8_t> output;
+  size_t consumed = 0;
+  size_t produced = 0;
+  int result;
+  do {
+    if (produced == output.size()) {
+      if (produced > max_length) {
+        return Status(error::GoogleError::OUT_OF_RANGE,
+                      absl::StrCat("Decompressed data exceeds the maximum of ",
+                                   max_length, " bytes"));
+      }
+      // Grow by one byte past |max_length| at most, to tell data of exactly
+      // |max_length| bytes from longer data.
+      output.resize(std::min(output.size() + kDecompressChunk,
+                             max_length + 1));
+    }
+    size_t input = std::min(kMaxZlibChunk, compressed.size() - consumed);
+    size_t available = std::min(kMaxZlibChunk, output.size() - produced);
+    stream.next_in = const_cast<Bytef *>(compressed.data() + consumed);
+    stream.avail_in = static_cast<uInt>(input);
+    stream.next_out = output.data() + produced;
+    stream.avail_out = static_cast<uInt>(available);
+    result = inflate(&stream, Z_NO_FLUSH);
+    if (result == Z_NEED_DICT || result == Z_DATA_ERROR ||
+        result == Z_STREAM_ERROR) {
+      return Status(error::GoogleError::DATA_LOSS,
+                    "Compressed data is malformed");
+    }
+    if (result == Z_MEM_ERROR) {
+      return Status(error::GoogleError::RESOURCE_EXHAUSTED,
+                    "Out of memory while decompressing");
+    }
+    bool progressed =
+        input != stream.avail_in || available != stream.avail_out;
+    consumed += input - stream.avail_in;
+    produced += available - stream.avail_out;
+    if (result == Z_BUF_ERROR && !progressed && consumed == compressed.size()) {
+      return Status(error::GoogleError::DATA_LOSS,
+                    "Compressed data is truncated");
+    }
+  } while (result != Z_STREAM_END);
+
+  if (produced > max_length) {
+    return Status(error::GoogleError::OUT_OF_RANGE,
+                  absl::StrCat("Decompressed data exceeds the maximum of ",
+                               max_length, " bytes"));
+  }
+  if (consumed != compressed.size()) {
+    return Status(error::GoogleError::DATA_LOSS,
+                  "Compressed data has trailing bytes");
+  }
+  output.resize(produced);
+  *data = std::move(output);
+  return Status::OkStatus();
+}
+
+}  // namespace asylo
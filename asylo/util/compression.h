@@ -0,0 +1,53 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_UTIL_COMPRESSION_H_
+#define ASYLO_UTIL_COMPRESSION_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/util/cleansing_types.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+
+// DEFLATE compression of secret data, for compressing data before it is
+// sealed. The compressed data and the working memory of the compressor are
+// cleansed when released.
+//
+// Compressing before sealing makes the length of the ciphertext depend on the
+// contents of the plaintext, and not only on its length. An observer of the
+// ciphertext who can also choose part of the plaintext, such as a request
+// field that is stored next to a secret, can recover the secret by watching
+// how the length changes. Only compress data that no untrusted party has a say
+// in, or that is not secret from the parties that do.
+
+// Compresses |data| into |compressed|.
+Status Compress(ByteContainerView data, CleansingVector<uint8_t> *compressed);
+
+// Decompresses |compressed| into |data|. Returns an OUT_OF_RANGE error if the
+// decompressed data is longer than |max_length|, and a DATA_LOSS error if
+// |compressed| is malformed.
+Status Decompress(ByteContainerView compressed, size_t max_length,
+                  CleansingVector<uint8_t> *data);
+
+}  // namespace asylo
+
+#endif  // ASYLO_UTIL_COMPRESSION_H_
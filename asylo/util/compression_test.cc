@@ -0,0 +1,111 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/util/compression.h"
+
+#include <cstdint>
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/cleansing_types.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::ElementsAreArray;
+using ::testing::IsEmpty;
+using ::testing::Lt;
+using ::testing::SizeIs;
+
+std::string RepetitiveData() {
+  std::string data;
+  for (int i = 0; i < 1000; ++i) {
+    absl::StrAppend(&data, "{\"key\": ", i % 10, ", \"value\": \"secret\"}");
+  }
+  return data;
+}
+
+TEST(CompressionTest, RoundTrip) {
+  std::string data = RepetitiveData();
+  CleansingVector<uint8_t> compressed;
+  ASYLO_ASSERT_OK(Compress(data, &compressed));
+  EXPECT_THAT(compressed.size(), Lt(data.size() / 5));
+
+  CleansingVector<uint8_t> decompressed;
+  ASYLO_ASSERT_OK(Decompress(compressed, data.size(), &decompressed));
+  EXPECT_THAT(decompressed, ElementsAreArray(data));
+}
+
+TEST(CompressionTest, RoundTripEmpty) {
+  CleansingVector<uint8_t> compressed;
+  ASYLO_ASSERT_OK(Compress("", &compressed));
+
+  CleansingVector<uint8_t> decompressed = {1, 2, 3};
+  ASYLO_ASSERT_OK(Decompress(compressed, 0, &decompressed));
+  EXPECT_THAT(decompressed, IsEmpty());
+}
+
+TEST(CompressionTest, RoundTripLargerThanChunk) {
+  std::string data(1 << 20, '\0');
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<char>((i * i) >> 7);
+  }
+  CleansingVector<uint8_t> compressed;
+  ASYLO_ASSERT_OK(Compress(data, &compressed));
+
+  CleansingVector<uint8_t> decompressed;
+  ASYLO_ASSERT_OK(Decompress(compressed, data.size(), &decompressed));
+  ASSERT_THAT(decompressed, SizeIs(data.size()));
+  EXPECT_THAT(decompressed, ElementsAreArray(data));
+}
+
+TEST(CompressionTest, DecompressRejectsLongerThanMaximum) {
+  std::string data = RepetitiveData();
+  CleansingVector<uint8_t> compressed;
+  ASYLO_ASSERT_OK(Compress(data, &compressed));
+
+  CleansingVector<uint8_t> decompressed;
+  EXPECT_THAT(Decompress(compressed, data.size() - 1, &decompressed),
+              StatusIs(error::GoogleError::OUT_OF_RANGE));
+}
+
+TEST(CompressionTest, DecompressRejectsMalformedData) {
+  std::string data = RepetitiveData();
+  CleansingVector<uint8_t> compressed;
+  ASYLO_ASSERT_OK(Compress(data, &compressed));
+
+  CleansingVector<uint8_t> decompressed;
+  CleansingVector<uint8_t> truncated(compressed.begin(),
+                                     compressed.end() - 8);
+  EXPECT_THAT(Decompress(truncated, data.size(), &decompressed),
+              StatusIs(error::GoogleError::DATA_LOSS));
+
+  CleansingVector<uint8_t> trailing = compressed;
+  trailing.push_back(0);
+  EXPECT_THAT(Decompress(trailing, data.size(), &decompressed),
+              StatusIs(error::GoogleError::DATA_LOSS));
+
+  EXPECT_THAT(Decompress("not compressed", data.size(), &decompressed),
+              StatusIs(error::GoogleError::DATA_LOSS));
+}
+
+}  // namespace
+}  // namespace asylo
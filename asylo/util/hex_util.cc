@@ -20,25 +20,323 @@
 
 #include <endian.h>
 
-#include "absl/strings/ascii.h"
-#include "absl/strings/escaping.h"
+#ifdef __SSE2__
+#include <cpuid.h>
+#include <immintrin.h>
+#endif  // __SSE2__
+
 #include "absl/strings/str_cat.h"
+#include "asylo/util/error_codes.h"
+#include "asylo/util/status.h"
 
 namespace asylo {
+namespace {
 
-bool IsHexEncoded(absl::string_view str) {
-  for (char c : str) {
-    if (!absl::ascii_isxdigit(c)) {
+constexpr char kHexDigits[] = "0123456789abcdef";
+
+// Returns the value of the hex digit |c|, or -1 if |c| is not a hex digit.
+int HexDigitValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  // Setting bit 5 maps uppercase letters to lowercase ones.
+  char lower = c | 0x20;
+  if (lower >= 'a' && lower <= 'f') {
+    return lower - 'a' + 10;
+  }
+  return -1;
+}
+
+// The scalar routines below encode or decode one byte at a time. They handle
+// the inputs shorter than a vector, and the tails of longer ones.
+
+void EncodeScalar(const uint8_t *bytes, size_t size, char *output) {
+  for (size_t i = 0; i < size; ++i) {
+    output[2 * i] = kHexDigits[bytes[i] >> 4];
+    output[2 * i + 1] = kHexDigits[bytes[i] & 0x0f];
+  }
+}
+
+bool DecodeScalar(const char *hex, size_t size, uint8_t *output) {
+  for (size_t i = 0; i < size / 2; ++i) {
+    int high = HexDigitValue(hex[2 * i]);
+    int low = HexDigitValue(hex[2 * i + 1]);
+    if (high < 0 || low < 0) {
+      return false;
+    }
+    output[i] = static_cast<uint8_t>((high << 4) | low);
+  }
+  return true;
+}
+
+bool ValidateScalar(const char *hex, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    if (HexDigitValue(hex[i]) < 0) {
       return false;
     }
   }
-  return str.size() % 2 == 0;
+  return true;
+}
+
+#ifdef __SSE2__
+
+// The vector routines convert 16 or 32 bytes per step without branching on
+// the data. A nibble n is encoded as n + '0', plus 'a' - '0' - 10 if n > 9. A
+// character c is a digit if c - '0' < 10 and a letter if (c | 0x20) - 'a' < 6,
+// as unsigned bytes. Adjacent digit values are then merged in 16-bit lanes and
+// packed down to bytes.
+
+bool CpuSupportsAvx2() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+    return false;
+  }
+  // Bits 27 and 28 of ECX are set => the OS uses XSAVE and machine supports
+  // AVX.
+  if (!(ecx & (1 << 27)) || !(ecx & (1 << 28))) {
+    return false;
+  }
+  // Bits 1 and 2 of XCR0 are set => the OS saves the SSE and AVX state.
+  uint32_t xcr0_low, xcr0_high;
+  __asm__ volatile("xgetbv" : "=a"(xcr0_low), "=d"(xcr0_high) : "c"(0));
+  if ((xcr0_low & 0x6) != 0x6) {
+    return false;
+  }
+  if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+    return false;
+  }
+  // Bit 5 of EBX is set => machine supports AVX2.
+  return !!(ebx & (1 << 5));
+}
+
+bool UseAvx2() {
+  static const bool avx2_supported = CpuSupportsAvx2();
+  return avx2_supported;
+}
+
+inline __m128i NibblesToHex128(__m128i nibbles) {
+  __m128i letters = _mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9));
+  return _mm_add_epi8(
+      _mm_add_epi8(nibbles, _mm_set1_epi8('0')),
+      _mm_and_si128(letters, _mm_set1_epi8('a' - '0' - 10)));
+}
+
+// Returns the digit values of the 16 characters in |chars| and sets |valid| to
+// a mask of the characters that are hex digits.
+inline __m128i HexToNibbles128(__m128i chars, __m128i *valid) {
+  __m128i digits = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+  __m128i is_digit =
+      _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+  __m128i letters = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)),
+                                 _mm_set1_epi8('a'));
+  __m128i is_letter =
+      _mm_cmpeq_epi8(_mm_min_epu8(letters, _mm_set1_epi8(5)), letters);
+  *valid = _mm_or_si128(is_digit, is_letter);
+  return _mm_or_si128(
+      _mm_and_si128(is_digit, digits),
+      _mm_and_si128(is_letter, _mm_add_epi8(letters, _mm_set1_epi8(10))));
+}
+
+// Merges each pair of digit values in |nibbles| into a byte, leaving the bytes
+// in the low byte of each 16-bit lane.
+inline __m128i MergeNibbles128(__m128i nibbles) {
+  __m128i high =
+      _mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0xff)), 4);
+  return _mm_or_si128(high, _mm_srli_epi16(nibbles, 8));
+}
+
+size_t EncodeSse2(const uint8_t *bytes, size_t size, char *output) {
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i input =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + i));
+    __m128i mask = _mm_set1_epi8(0x0f);
+    __m128i high =
+        NibblesToHex128(_mm_and_si128(_mm_srli_epi16(input, 4), mask));
+    __m128i low = NibblesToHex128(_mm_and_si128(input, mask));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(output + 2 * i),
+                     _mm_unpacklo_epi8(high, low));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(output + 2 * i + 16),
+                     _mm_unpackhi_epi8(high, low));
+  }
+  return i;
+}
+
+// Decodes 8 bytes per step. Returns the number of characters consumed, or
+// |size| + 1 if an invalid character was found.
+size_t DecodeSse2(const char *hex, size_t size, uint8_t *output) {
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i valid;
+    __m128i nibbles = HexToNibbles128(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(hex + i)), &valid);
+    if (_mm_movemask_epi8(valid) != 0xffff) {
+      return size + 1;
+    }
+    __m128i bytes = MergeNibbles128(nibbles);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(output + i / 2),
+                     _mm_packus_epi16(bytes, bytes));
+  }
+  return i;
+}
+
+size_t ValidateSse2(const char *hex, size_t size) {
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i valid;
+    HexToNibbles128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(hex + i)),
+                    &valid);
+    if (_mm_movemask_epi8(valid) != 0xffff) {
+      return size + 1;
+    }
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) inline __m256i NibblesToHex256(
+    __m256i nibbles) {
+  __m256i letters = _mm256_cmpgt_epi8(nibbles, _mm256_set1_epi8(9));
+  return _mm256_add_epi8(
+      _mm256_add_epi8(nibbles, _mm256_set1_epi8('0')),
+      _mm256_and_si256(letters, _mm256_set1_epi8('a' - '0' - 10)));
+}
+
+__attribute__((target("avx2"))) inline __m256i HexToNibbles256(
+    __m256i chars, __m256i *valid) {
+  __m256i digits = _mm256_sub_epi8(chars, _mm256_set1_epi8('0'));
+  __m256i is_digit =
+      _mm256_cmpeq_epi8(_mm256_min_epu8(digits, _mm256_set1_epi8(9)), digits);
+  __m256i letters = _mm256_sub_epi8(
+      _mm256_or_si256(chars, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+  __m256i is_letter =
+      _mm256_cmpeq_epi8(_mm256_min_epu8(letters, _mm256_set1_epi8(5)), letters);
+  *valid = _mm256_or_si256(is_digit, is_letter);
+  return _mm256_or_si256(
+      _mm256_and_si256(is_digit, digits),
+      _mm256_and_si256(is_letter,
+                       _mm256_add_epi8(letters, _mm256_set1_epi8(10))));
+}
+
+// The unpack and pack instructions work within 128-bit lanes, so the results
+// are permuted back into order before they are stored.
+
+__attribute__((target("avx2"))) size_t EncodeAvx2(const uint8_t *bytes,
+                                                  size_t size, char *output) {
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i input =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(bytes + i));
+    __m256i mask = _mm256_set1_epi8(0x0f);
+    __m256i high =
+        NibblesToHex256(_mm256_and_si256(_mm256_srli_epi16(input, 4), mask));
+    __m256i low = NibblesToHex256(_mm256_and_si256(input, mask));
+    __m256i first = _mm256_unpacklo_epi8(high, low);
+    __m256i second = _mm256_unpackhi_epi8(high, low);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + 2 * i),
+                        _mm256_permute2x128_si256(first, second, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + 2 * i + 32),
+                        _mm256_permute2x128_si256(first, second, 0x31));
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) size_t DecodeAvx2(const char *hex,
+                                                  size_t size,
+                                                  uint8_t *output) {
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i valid;
+    __m256i nibbles = HexToNibbles256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(hex + i)), &valid);
+    if (_mm256_movemask_epi8(valid) != -1) {
+      return size + 1;
+    }
+    __m256i high = _mm256_slli_epi16(
+        _mm256_and_si256(nibbles, _mm256_set1_epi16(0xff)), 4);
+    __m256i bytes = _mm256_or_si256(high, _mm256_srli_epi16(nibbles, 8));
+    __m256i packed = _mm256_permute4x64_epi64(
+        _mm256_packus_epi16(bytes, bytes), 0x08);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(output + i / 2),
+                     _mm256_castsi256_si128(packed));
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) size_t ValidateAvx2(const char *hex,
+                                                    size_t size) {
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i valid;
+    HexToNibbles256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(hex + i)), &valid);
+    if (_mm256_movemask_epi8(valid) != -1) {
+      return size + 1;
+    }
+  }
+  return i;
+}
+
+#endif  // __SSE2__
+
+}  // namespace
+
+bool IsHexEncoded(absl::string_view str) {
+  if (str.size() % 2 != 0) {
+    return false;
+  }
+  size_t done = 0;
+#ifdef __SSE2__
+  done = UseAvx2() ? ValidateAvx2(str.data(), str.size())
+                   : ValidateSse2(str.data(), str.size());
+  if (done > str.size()) {
+    return false;
+  }
+#endif  // __SSE2__
+  return ValidateScalar(str.data() + done, str.size() - done);
+}
+
+void BytesToHexBuffer(ByteContainerView bytes, char *output) {
+  size_t done = 0;
+#ifdef __SSE2__
+  done = UseAvx2() ? EncodeAvx2(bytes.data(), bytes.size(), output)
+                   : EncodeSse2(bytes.data(), bytes.size(), output);
+#endif  // __SSE2__
+  EncodeScalar(bytes.data() + done, bytes.size() - done, output + 2 * done);
+}
+
+std::string BytesToHex(ByteContainerView bytes) {
+  std::string hex(2 * bytes.size(), '\0');
+  BytesToHexBuffer(bytes, &hex[0]);
+  return hex;
+}
+
+bool HexToBytesBuffer(absl::string_view hex, uint8_t *output) {
+  if (hex.size() % 2 != 0) {
+    return false;
+  }
+  size_t done = 0;
+#ifdef __SSE2__
+  done = UseAvx2() ? DecodeAvx2(hex.data(), hex.size(), output)
+                   : DecodeSse2(hex.data(), hex.size(), output);
+  if (done > hex.size()) {
+    return false;
+  }
+#endif  // __SSE2__
+  return DecodeScalar(hex.data() + done, hex.size() - done, output + done / 2);
+}
+
+StatusOr<std::string> HexToBytes(absl::string_view hex) {
+  std::string bytes(hex.size() / 2, '\0');
+  if (!HexToBytesBuffer(hex, reinterpret_cast<uint8_t *>(&bytes[0]))) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Input is not a valid hex string");
+  }
+  return bytes;
 }
 
 std::string Uint16ToLittleEndianHexString(uint16_t val) {
   uint16_t le_val = htole16(val);
-  return absl::BytesToHexString(
-      absl::string_view{reinterpret_cast<char *>(&le_val), sizeof(uint16_t)});
+  return BytesToHex(ByteContainerView(&le_val, sizeof(le_val)));
 }
 
 std::string BufferToDebugHexString(const void *buf, int nbytes) {
@@ -51,10 +349,7 @@ std::string BufferToDebugHexString(const void *buf, int nbytes) {
   if (nbytes == 0) {
     return "[]";
   }
-  return absl::StrCat("[0x",
-                      absl::BytesToHexString(absl::string_view(
-                          reinterpret_cast<const char *>(buf), nbytes)),
-                      "]");
+  return absl::StrCat("[0x", BytesToHex(ByteContainerView(buf, nbytes)), "]");
 }
 
 }  // namespace asylo
@@ -23,6 +23,8 @@
 #include <string>
 
 #include "absl/strings/string_view.h"
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/util/statusor.h"
 
 namespace asylo {
 
@@ -30,6 +32,22 @@ namespace asylo {
 // bytes.
 bool IsHexEncoded(absl::string_view str);
 
+// Writes the lowercase hex-encoding of |bytes| to |output|, which must have
+// room for 2 * |bytes|.size() characters. No null terminator is written.
+void BytesToHexBuffer(ByteContainerView bytes, char *output);
+
+// Returns the lowercase hex-encoding of |bytes|.
+std::string BytesToHex(ByteContainerView bytes);
+
+// Decodes the hex-encoded |hex| to |output|, which must have room for
+// |hex|.size() / 2 bytes. Returns false if |hex| is not hex-encoded, in which
+// case the contents of |output| are unspecified.
+bool HexToBytesBuffer(absl::string_view hex, uint8_t *output);
+
+// Returns the bytes encoded by |hex|, or an INVALID_ARGUMENT error if |hex| is
+// not hex-encoded.
+StatusOr<std::string> HexToBytes(absl::string_view hex);
+
 // Returns the little-endian hex-string representation of |val|.
 std::string Uint16ToLittleEndianHexString(uint16_t val);
 
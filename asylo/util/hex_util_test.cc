@@ -20,8 +20,14 @@
 
 #include <endian.h>
 
+#include <string>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include "absl/strings/ascii.h"
+#include "absl/strings/escaping.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/error_codes.h"
 
 using ::testing::Eq;
 using ::testing::StrEq;
@@ -41,6 +47,54 @@ TEST(IsHexEncodedTest, HexStringReturnsTrue) {
   EXPECT_TRUE(IsHexEncoded("1234567890ABCDEFabcdef"));
 }
 
+TEST(IsHexEncodedTest, LongStringWithInvalidCharacterReturnsFalse) {
+  std::string hex(100, 'a');
+  EXPECT_TRUE(IsHexEncoded(hex));
+  for (size_t i = 0; i < hex.size(); ++i) {
+    std::string corrupted = hex;
+    corrupted[i] = 'g';
+    EXPECT_FALSE(IsHexEncoded(corrupted)) << i;
+  }
+}
+
+// Covers inputs shorter than, equal to, and longer than the vector widths, so
+// that both the vector loops and the scalar tails are exercised.
+TEST(BytesToHexTest, MatchesAbslForAllLengths) {
+  std::string bytes;
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_THAT(BytesToHex(bytes), StrEq(absl::BytesToHexString(bytes)));
+    bytes.push_back(static_cast<char>(i * 37 + 11));
+  }
+}
+
+TEST(HexToBytesTest, RoundTripsForAllLengths) {
+  std::string bytes;
+  for (int i = 0; i < 100; ++i) {
+    std::string hex = absl::BytesToHexString(bytes);
+    std::string decoded;
+    ASYLO_ASSERT_OK_AND_ASSIGN(decoded, HexToBytes(hex));
+    EXPECT_THAT(decoded, Eq(bytes));
+    ASYLO_ASSERT_OK_AND_ASSIGN(decoded, HexToBytes(absl::AsciiStrToUpper(hex)));
+    EXPECT_THAT(decoded, Eq(bytes));
+    bytes.push_back(static_cast<char>(i * 37 + 11));
+  }
+}
+
+TEST(HexToBytesTest, InvalidInputFails) {
+  EXPECT_THAT(HexToBytes("123"),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  std::string hex(100, '0');
+  for (char invalid : {'g', 'G', '/', ':', '@', '`', ' ', '\0'}) {
+    for (size_t i = 0; i < hex.size(); ++i) {
+      std::string corrupted = hex;
+      corrupted[i] = invalid;
+      EXPECT_THAT(HexToBytes(corrupted),
+                  StatusIs(error::GoogleError::INVALID_ARGUMENT))
+          << i;
+    }
+  }
+}
+
 TEST(Uint16ToLeHexStringTest, Success) {
   EXPECT_EQ(Uint16ToLittleEndianHexString(le16toh(0x1234)), "3412");
   EXPECT_EQ(Uint16ToLittleEndianHexString(le16toh(0xabcd)), "cdab");
@@ -18,6 +18,7 @@
 #ifndef ASYLO_UTIL_HTTP_FETCHER_H_
 #define ASYLO_UTIL_HTTP_FETCHER_H_
 
+#include <functional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -63,6 +64,19 @@ class HttpFetcher {
   virtual StatusOr<HttpResponse> Get(
       absl::string_view url,
       const std::vector<HttpHeaderField> &custom_headers) = 0;
+
+  // Called with the result of an asynchronous fetch.
+  using GetCallback = std::function<void(StatusOr<HttpResponse>)>;
+
+  // Fetches |url| like Get() and passes the result to |callback|. Thread safe.
+  // Implementations may return before the fetch completes and run |callback|
+  // on another thread, so that several fetches can proceed in parallel. The
+  // default implementation fetches synchronously on the calling thread.
+  virtual void GetAsync(absl::string_view url,
+                        const std::vector<HttpHeaderField> &custom_headers,
+                        GetCallback callback) {
+    callback(Get(url, custom_headers));
+  }
 };
 
 }  // namespace asylo
@@ -17,9 +17,12 @@
  */
 #include "asylo/util/http_fetcher_impl.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <cstring>
+#include <utility>
 
+#include "absl/memory/memory.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/match.h"
 #include "absl/strings/string_view.h"
@@ -74,10 +77,20 @@ class CurlImpl : public Curl {
     return ToStatus(curl_easy_setopt(curl_.get(), option, value));
   }
 
+  Status SetOptLong(CURLoption option, long value) override {
+    return ToStatus(curl_easy_setopt(curl_.get(), option, value));
+  }
+
   Status Perform() override { return ToStatus(curl_easy_perform(curl_.get())); }
 
   void Reset() override {
-    curl_.reset(curl_easy_init());
+    // Unlike a new handle, a reset handle keeps its connections and TLS
+    // sessions.
+    if (curl_) {
+      curl_easy_reset(curl_.get());
+    } else {
+      curl_.reset(curl_easy_init());
+    }
     memset(err_msg_, 0, sizeof(err_msg_));
     ASYLO_CHECK_OK(SetOpt(CURLOPT_ERRORBUFFER, err_msg_));
   }
@@ -109,8 +122,58 @@ void FreeCurlList(void *headers) {
   curl_slist_free_all(reinterpret_cast<curl_slist *>(headers));
 }
 
+// Returns whether the linked libcurl supports HTTP/2.
+bool CurlSupportsHttp2() {
+  return (curl_version_info(CURLVERSION_NOW)->features & CURL_VERSION_HTTP2) !=
+         0;
+}
+
 }  // namespace
 
+// Wraps a curl share handle, through which all Curl objects of a fetcher share
+// their connection cache, TLS session cache and DNS cache.
+class HttpFetcherImpl::CurlShare {
+ public:
+  CurlShare() : share_(curl_share_init()) {
+    if (share_ == nullptr) {
+      return;
+    }
+    curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, &CurlShare::Lock);
+    curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, &CurlShare::Unlock);
+    curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  }
+
+  ~CurlShare() {
+    if (share_ != nullptr) {
+      curl_share_cleanup(share_);
+    }
+  }
+
+  CurlShare(const CurlShare &) = delete;
+  CurlShare &operator=(const CurlShare &) = delete;
+
+  // Returns the share handle, or nullptr if it could not be created.
+  CURLSH *get() const { return share_; }
+
+ private:
+  static void Lock(CURL *handle, curl_lock_data data, curl_lock_access access,
+                   void *userptr) {
+    static_cast<CurlShare *>(userptr)->mutexes_[data].Lock();
+  }
+
+  static void Unlock(CURL *handle, curl_lock_data data, void *userptr) {
+    static_cast<CurlShare *>(userptr)->mutexes_[data].Unlock();
+  }
+
+  CURLSH *const share_;
+
+  // Guards the data shared through |share_|, indexed by curl_lock_data.
+  absl::Mutex mutexes_[CURL_LOCK_DATA_LAST];
+};
+
 std::unique_ptr<Curl> CreateCurl() { return absl::make_unique<CurlImpl>(); }
 
 size_t ParseHttpHeader(const char *buffer, size_t size, size_t nitems,
@@ -142,33 +205,145 @@ size_t ParseHttpHeader(const char *buffer, size_t size, size_t nitems,
   return data_len;
 }
 
+HttpFetcherImpl::HttpFetcherImpl(std::unique_ptr<Curl> curl,
+                                 absl::string_view ca_cert_filename)
+    : HttpFetcherImpl(CreateCurl, [ca_cert_filename] {
+        Options options;
+        options.ca_cert_filename = std::string(ca_cert_filename);
+        return options;
+      }()) {
+  idle_curls_.push_back(std::move(curl));
+}
+
+HttpFetcherImpl::HttpFetcherImpl(const Options &options)
+    : HttpFetcherImpl(CreateCurl, options) {}
+
+HttpFetcherImpl::HttpFetcherImpl(
+    std::function<std::unique_ptr<Curl>()> curl_factory, const Options &options)
+    : curl_factory_(std::move(curl_factory)),
+      options_(options),
+      share_(absl::make_unique<CurlShare>()) {}
+
+HttpFetcherImpl::~HttpFetcherImpl() {
+  std::vector<Thread> workers;
+  {
+    absl::MutexLock lock(&mu_);
+    stopping_ = true;
+    workers = std::move(workers_);
+  }
+  for (auto &worker : workers) {
+    worker.Join();
+  }
+}
+
 StatusOr<HttpFetcher::HttpResponse> HttpFetcherImpl::Get(
     absl::string_view url,
     const std::vector<HttpFetcher::HttpHeaderField> &custom_headers) {
-  curl_->Reset();
-  if (!ca_cert_filename_.empty()) {
-    ASYLO_RETURN_IF_ERROR(curl_->SetOpt(
-        CURLOPT_CAINFO, const_cast<char *>(ca_cert_filename_.c_str())));
+  std::unique_ptr<Curl> curl = AcquireCurl();
+  StatusOr<HttpFetcher::HttpResponse> result =
+      GetWithCurl(curl.get(), url, custom_headers);
+  ReleaseCurl(std::move(curl));
+  return result;
+}
+
+void HttpFetcherImpl::GetAsync(
+    absl::string_view url,
+    const std::vector<HttpFetcher::HttpHeaderField> &custom_headers,
+    GetCallback callback) {
+  absl::MutexLock lock(&mu_);
+  async_requests_.push_back(
+      {std::string(url), custom_headers, std::move(callback)});
+  if (idle_workers_ == 0 &&
+      workers_.size() <
+          static_cast<size_t>(std::max(options_.max_parallel_requests, 1))) {
+    workers_.emplace_back(&HttpFetcherImpl::AsyncWorker, this);
+  }
+}
+
+StatusOr<HttpFetcher::HttpResponse> HttpFetcherImpl::GetWithCurl(
+    Curl *curl, absl::string_view url,
+    const std::vector<HttpFetcher::HttpHeaderField> &custom_headers) {
+  curl->Reset();
+  if (share_->get() != nullptr) {
+    ASYLO_RETURN_IF_ERROR(curl->SetOpt(CURLOPT_SHARE, share_->get()));
   }
-  ASYLO_RETURN_IF_ERROR(curl_->SetOpt(
+  // Timeouts must not be implemented with signals in a multi-threaded
+  // process.
+  ASYLO_RETURN_IF_ERROR(curl->SetOptLong(CURLOPT_NOSIGNAL, 1L));
+  ASYLO_RETURN_IF_ERROR(curl->SetOptLong(CURLOPT_TCP_KEEPALIVE, 1L));
+  ASYLO_RETURN_IF_ERROR(
+      curl->SetOptLong(CURLOPT_CONNECTTIMEOUT_MS,
+                       absl::ToInt64Milliseconds(options_.connect_timeout)));
+  ASYLO_RETURN_IF_ERROR(
+      curl->SetOptLong(CURLOPT_TIMEOUT_MS,
+                       absl::ToInt64Milliseconds(options_.request_timeout)));
+  if (options_.enable_http2 && CurlSupportsHttp2()) {
+    ASYLO_RETURN_IF_ERROR(
+        curl->SetOptLong(CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS));
+  }
+  if (!options_.ca_cert_filename.empty()) {
+    ASYLO_RETURN_IF_ERROR(curl->SetOpt(
+        CURLOPT_CAINFO, const_cast<char *>(options_.ca_cert_filename.c_str())));
+  }
+  std::string url_string(url);
+  ASYLO_RETURN_IF_ERROR(curl->SetOpt(
       CURLOPT_URL,
-      reinterpret_cast<void *>(const_cast<char *>(std::string(url).c_str()))));
+      reinterpret_cast<void *>(const_cast<char *>(url_string.c_str()))));
   std::unique_ptr<curl_slist, FunctionDeleter<FreeCurlList>> headers;
   for (const auto &header : custom_headers) {
     headers.reset(curl_slist_append(
-        headers.get(),
+        headers.release(),
         absl::StrFormat("%s: %s", header.first, header.second).c_str()));
   }
-  ASYLO_RETURN_IF_ERROR(curl_->SetOpt(CURLOPT_HTTPHEADER, headers.get()));
+  ASYLO_RETURN_IF_ERROR(curl->SetOpt(CURLOPT_HTTPHEADER, headers.get()));
   HttpFetcher::HttpResponse result;
-  ASYLO_RETURN_IF_ERROR(curl_->SetOpt(CURLOPT_WRITEFUNCTION,
-                                      reinterpret_cast<void *>(ReadToString)));
-  ASYLO_RETURN_IF_ERROR(curl_->SetOpt(CURLOPT_WRITEDATA, &result.body));
-  ASYLO_RETURN_IF_ERROR(curl_->SetOpt(CURLOPT_HEADERDATA, &result));
-  ASYLO_RETURN_IF_ERROR(curl_->SetOpt(
+  ASYLO_RETURN_IF_ERROR(curl->SetOpt(CURLOPT_WRITEFUNCTION,
+                                     reinterpret_cast<void *>(ReadToString)));
+  ASYLO_RETURN_IF_ERROR(curl->SetOpt(CURLOPT_WRITEDATA, &result.body));
+  ASYLO_RETURN_IF_ERROR(curl->SetOpt(CURLOPT_HEADERDATA, &result));
+  ASYLO_RETURN_IF_ERROR(curl->SetOpt(
       CURLOPT_HEADERFUNCTION, reinterpret_cast<void *>(ParseHttpHeader)));
-  ASYLO_RETURN_IF_ERROR(curl_->Perform());
+  ASYLO_RETURN_IF_ERROR(curl->Perform());
   return result;
 }
 
+std::unique_ptr<Curl> HttpFetcherImpl::AcquireCurl() {
+  {
+    absl::MutexLock lock(&mu_);
+    if (!idle_curls_.empty()) {
+      std::unique_ptr<Curl> curl = std::move(idle_curls_.back());
+      idle_curls_.pop_back();
+      return curl;
+    }
+  }
+  return curl_factory_();
+}
+
+void HttpFetcherImpl::ReleaseCurl(std::unique_ptr<Curl> curl) {
+  absl::MutexLock lock(&mu_);
+  idle_curls_.push_back(std::move(curl));
+}
+
+void HttpFetcherImpl::AsyncWorker() {
+  auto has_work = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return stopping_ || !async_requests_.empty();
+  };
+  while (true) {
+    AsyncRequest request;
+    {
+      absl::MutexLock lock(&mu_);
+      ++idle_workers_;
+      mu_.Await(absl::Condition(&has_work));
+      --idle_workers_;
+      // Requests queued before destruction are still performed.
+      if (async_requests_.empty()) {
+        return;
+      }
+      request = std::move(async_requests_.front());
+      async_requests_.pop_front();
+    }
+    request.callback(Get(request.url, request.custom_headers));
+  }
+}
+
 }  // namespace asylo
@@ -18,13 +18,20 @@
 #ifndef ASYLO_UTIL_HTTP_FETCHER_IMPL_H_
 #define ASYLO_UTIL_HTTP_FETCHER_IMPL_H_
 
+#include <deque>
+#include <functional>
 #include <memory>
+#include <string>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 #include "asylo/util/http_fetcher.h"
 #include "asylo/util/statusor.h"
+#include "asylo/util/thread.h"
 #include <curl/curl.h>
 
 namespace asylo {
@@ -37,11 +44,15 @@ class Curl {
   // Wraps libcurl's curl_easy_setopt call with exactly three arguments.
   virtual Status SetOpt(CURLoption option, void *value) = 0;
 
+  // Wraps libcurl's curl_easy_setopt call for options that take a long.
+  virtual Status SetOptLong(CURLoption option, long value) = 0;
+
   // Wraps libcurl's curl_easy_perform call.
   virtual Status Perform() = 0;
 
-  // Resets the Curl object before each use. Wraps libcurl's curl_easy_init
-  // call.
+  // Resets the Curl object before each use. Options are reset to their
+  // defaults, but open connections and cached TLS sessions are kept for reuse
+  // by the next request. Wraps libcurl's curl_easy_reset call.
   virtual void Reset() = 0;
 };
 
@@ -55,8 +66,32 @@ size_t ParseHttpHeader(const char *buffer, size_t size, size_t nitems,
                        HttpFetcher::HttpResponse *response);
 
 // Implements HttpFetcher using libcurl.
+//
+// Curl handles are pooled and share a connection cache, a TLS session cache
+// and a DNS cache, so that consecutive requests to the same server reuse the
+// connection instead of opening a new one and repeating the TLS handshake.
+// HTTP/2 is negotiated with servers that support it.
 class HttpFetcherImpl : public HttpFetcher {
  public:
+  struct Options {
+    // File holding the trusted roots for validating the TLS connection with
+    // the remote server. If empty, the system default is used.
+    std::string ca_cert_filename;
+
+    // Maximum time to establish a connection, or zero for libcurl's default.
+    absl::Duration connect_timeout = absl::Seconds(30);
+
+    // Maximum time for a whole request, or zero for no limit.
+    absl::Duration request_timeout = absl::Minutes(2);
+
+    // Whether to negotiate HTTP/2 on TLS connections.
+    bool enable_http2 = true;
+
+    // Maximum number of requests that are performed in parallel on behalf of
+    // GetAsync(). Further requests are queued.
+    int max_parallel_requests = 8;
+  };
+
   HttpFetcherImpl() : HttpFetcherImpl("") {}
 
   // Constructs an HttpFetcherImpl object that will use |ca_cert_filename| as
@@ -65,17 +100,62 @@ class HttpFetcherImpl : public HttpFetcher {
       : HttpFetcherImpl(CreateCurl(), ca_cert_filename) {}
 
   explicit HttpFetcherImpl(std::unique_ptr<Curl> curl,
-                           absl::string_view ca_cert_filename)
-      : curl_(std::move(curl)), ca_cert_filename_(ca_cert_filename) {}
-  ~HttpFetcherImpl() override {}
+                           absl::string_view ca_cert_filename);
+
+  // Constructs an HttpFetcherImpl object configured by |options|.
+  explicit HttpFetcherImpl(const Options &options);
+
+  // Constructs an HttpFetcherImpl object configured by |options| that obtains
+  // a Curl object from |curl_factory| whenever all pooled ones are in use.
+  HttpFetcherImpl(std::function<std::unique_ptr<Curl>()> curl_factory,
+                  const Options &options);
+
+  // Waits for all requests passed to GetAsync() to complete.
+  ~HttpFetcherImpl() override;
 
   StatusOr<HttpFetcher::HttpResponse> Get(
       absl::string_view url,
       const std::vector<HttpFetcher::HttpHeaderField> &custom_headers) override;
 
+  void GetAsync(absl::string_view url,
+                const std::vector<HttpFetcher::HttpHeaderField> &custom_headers,
+                GetCallback callback) override;
+
  private:
-  std::unique_ptr<Curl> curl_;
-  std::string ca_cert_filename_;
+  // State shared between the Curl objects of a fetcher.
+  class CurlShare;
+
+  // A request passed to GetAsync().
+  struct AsyncRequest {
+    std::string url;
+    std::vector<HttpFetcher::HttpHeaderField> custom_headers;
+    GetCallback callback;
+  };
+
+  // Performs a GET request on |curl|.
+  StatusOr<HttpFetcher::HttpResponse> GetWithCurl(
+      Curl *curl, absl::string_view url,
+      const std::vector<HttpFetcher::HttpHeaderField> &custom_headers);
+
+  // Takes a Curl object from the pool, or creates one if the pool is empty.
+  std::unique_ptr<Curl> AcquireCurl();
+
+  // Returns |curl| to the pool.
+  void ReleaseCurl(std::unique_ptr<Curl> curl);
+
+  // Body of the threads performing requests passed to GetAsync().
+  void AsyncWorker();
+
+  const std::function<std::unique_ptr<Curl>()> curl_factory_;
+  const Options options_;
+  const std::unique_ptr<CurlShare> share_;
+
+  absl::Mutex mu_;
+  std::vector<std::unique_ptr<Curl>> idle_curls_ ABSL_GUARDED_BY(mu_);
+  std::deque<AsyncRequest> async_requests_ ABSL_GUARDED_BY(mu_);
+  int idle_workers_ ABSL_GUARDED_BY(mu_) = 0;
+  bool stopping_ ABSL_GUARDED_BY(mu_) = false;
+  std::vector<Thread> workers_ ABSL_GUARDED_BY(mu_);
 };
 
 }  // namespace asylo
@@ -22,10 +22,15 @@
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "asylo/test/util/status_matchers.h"
 #include "asylo/util/statusor.h"
@@ -34,8 +39,11 @@
 namespace asylo {
 namespace {
 
+using ::testing::AllOf;
 using ::testing::ElementsAre;
 using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::Le;
 using ::testing::Ne;
 using ::testing::Pair;
 using ::testing::ValuesIn;
@@ -60,9 +68,18 @@ class FakeCurl : public Curl {
 
   Status Perform() override;
   Status SetOpt(CURLoption option, void *value) override;
+  Status SetOptLong(CURLoption option, long value) override;
   void Reset() override;
   const std::string last_url() const { return last_url_; }
   const absl::optional<std::string> ca_path() const { return ca_path_; }
+  absl::optional<long> long_opt(CURLoption option) const {
+    auto it = long_opts_.find(option);
+    if (it == long_opts_.end()) {
+      return absl::nullopt;
+    }
+    return it->second;
+  }
+  int reset_count() const { return reset_count_; }
 
   void set_perform_failure() { perform_failure_ = true; }
   void set_setopt_failure(CURLoption option) {
@@ -74,6 +91,8 @@ class FakeCurl : public Curl {
   std::string body_;
   std::string last_url_;
   absl::optional<std::string> ca_path_;
+  absl::flat_hash_map<CURLoption, long> long_opts_;
+  int reset_count_ = 0;
   WriteFn write_fn_;
   void *write_data_;
   WriteFn header_fn_;
@@ -110,8 +129,10 @@ Status FakeCurl::Perform() {
 }
 
 void FakeCurl::Reset() {
+  ++reset_count_;
   last_url_ = "";
   ca_path_.reset();
+  long_opts_.clear();
   write_fn_ = nullptr;
   write_data_ = nullptr;
   header_fn_ = nullptr;
@@ -136,6 +157,7 @@ Status FakeCurl::SetOpt(CURLoption option, void *value) {
       write_data_ = value;
       break;
     case CURLOPT_HTTPHEADER:
+    case CURLOPT_SHARE:
       break;
     case CURLOPT_URL:
       last_url_ = static_cast<char *>(value);
@@ -150,6 +172,14 @@ Status FakeCurl::SetOpt(CURLoption option, void *value) {
   return Status::OkStatus();
 }
 
+Status FakeCurl::SetOptLong(CURLoption option, long value) {
+  if (setopt_failures_.contains(option)) {
+    return Status(error::GoogleError::INTERNAL, "test");
+  }
+  long_opts_[option] = value;
+  return Status::OkStatus();
+}
+
 TEST(ParseHttpHeaderTest, StatusLine) {
   absl::string_view line = "HTTP/1.1 200 OK\r\n";
   HttpFetcher::HttpResponse response;
@@ -289,7 +319,8 @@ INSTANTIATE_TEST_SUITE_P(SetOptErrors, HttpFetcherImplSetOptErrorTest,
                          ValuesIn(std::vector<CURLoption>{
                              CURLOPT_URL, CURLOPT_HEADERFUNCTION,
                              CURLOPT_HEADERDATA, CURLOPT_WRITEFUNCTION,
-                             CURLOPT_WRITEDATA, CURLOPT_CAINFO}));
+                             CURLOPT_WRITEDATA, CURLOPT_CAINFO,
+                             CURLOPT_TIMEOUT_MS}));
 
 TEST_P(HttpFetcherImplSetOptErrorTest, SetOpt_Failure) {
   constexpr char kRawResponse[] =
@@ -310,5 +341,95 @@ TEST_P(HttpFetcherImplSetOptErrorTest, SetOpt_Failure) {
   EXPECT_THAT(fetcher.Get(kUrl, {}), StatusIs(error::GoogleError::INTERNAL));
 }
 
+constexpr char kSimpleResponse[] =
+    "HTTP/1.1 200 OK\r\n"
+    "\r\n"
+    "lorem ipsum dolor sit\r\n";
+
+TEST(HttpFetcherImplTest, AppliesOptions) {
+  std::unique_ptr<FakeCurl> curl;
+  ASYLO_ASSERT_OK_AND_ASSIGN(curl, FakeCurl::Create(kSimpleResponse));
+  FakeCurl *curlptr = curl.get();
+  HttpFetcherImpl::Options options;
+  options.connect_timeout = absl::Seconds(5);
+  options.request_timeout = absl::Seconds(7);
+  HttpFetcherImpl fetcher([&curl] { return std::move(curl); }, options);
+  ASYLO_ASSERT_OK(fetcher.Get("http://lorem.ipsum", {}));
+
+  EXPECT_THAT(curlptr->long_opt(CURLOPT_CONNECTTIMEOUT_MS), Eq(5000));
+  EXPECT_THAT(curlptr->long_opt(CURLOPT_TIMEOUT_MS), Eq(7000));
+  EXPECT_THAT(curlptr->long_opt(CURLOPT_NOSIGNAL), Eq(1));
+}
+
+TEST(HttpFetcherImplTest, ReusesCurl) {
+  int num_curls = 0;
+  FakeCurl *curlptr = nullptr;
+  HttpFetcherImpl fetcher(
+      [&num_curls, &curlptr]() -> std::unique_ptr<Curl> {
+        ++num_curls;
+        auto curl = FakeCurl::Create(kSimpleResponse).ValueOrDie();
+        curlptr = curl.get();
+        return std::move(curl);
+      },
+      HttpFetcherImpl::Options());
+  for (int i = 0; i < 3; ++i) {
+    HttpFetcher::HttpResponse response;
+    ASYLO_ASSERT_OK_AND_ASSIGN(response, fetcher.Get("http://lorem.ipsum", {}));
+    EXPECT_THAT(response.body, Eq("lorem ipsum dolor sit\r\n"));
+  }
+
+  EXPECT_THAT(num_curls, Eq(1));
+  EXPECT_THAT(curlptr->reset_count(), Eq(3));
+}
+
+TEST(HttpFetcherImplTest, GetAsync) {
+  constexpr int kNumRequests = 16;
+
+  absl::Mutex mu;
+  int num_curls = 0;
+  HttpFetcherImpl::Options options;
+  options.max_parallel_requests = 4;
+  auto fetcher = absl::make_unique<HttpFetcherImpl>(
+      [&mu, &num_curls]() -> std::unique_ptr<Curl> {
+        absl::MutexLock lock(&mu);
+        ++num_curls;
+        return FakeCurl::Create(kSimpleResponse).ValueOrDie();
+      },
+      options);
+
+  absl::BlockingCounter done(kNumRequests);
+  for (int i = 0; i < kNumRequests; ++i) {
+    fetcher->GetAsync(
+        absl::StrCat("http://lorem.ipsum/", i), {},
+        [&done](StatusOr<HttpFetcher::HttpResponse> response) {
+          ASYLO_EXPECT_OK(response);
+          if (response.ok()) {
+            EXPECT_THAT(response.ValueOrDie().status_code, Eq(200));
+          }
+          done.DecrementCount();
+        });
+  }
+  done.Wait();
+  fetcher.reset();
+
+  absl::MutexLock lock(&mu);
+  EXPECT_THAT(num_curls, AllOf(Ge(1), Le(4)));
+}
+
+TEST(HttpFetcherImplTest, DestructorCompletesAsyncRequests) {
+  bool done = false;
+  {
+    std::unique_ptr<FakeCurl> curl;
+    ASYLO_ASSERT_OK_AND_ASSIGN(curl, FakeCurl::Create(kSimpleResponse));
+    HttpFetcherImpl fetcher(std::move(curl), /*ca_cert_filename=*/"");
+    fetcher.GetAsync("http://lorem.ipsum", {},
+                     [&done](StatusOr<HttpFetcher::HttpResponse> response) {
+                       ASYLO_EXPECT_OK(response);
+                       done = true;
+                     });
+  }
+  EXPECT_TRUE(done);
+}
+
 }  // namespace
 }  // namespace asylo
@@ -0,0 +1,385 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/util/json_reader.h"
+
+#include <cstdint>
+#include <string>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_cat.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace {
+
+// Appends the UTF-8 encoding of |code_point| to |out|.
+void AppendUtf8(uint32_t code_point, std::string *out) {
+  if (code_point < 0x80) {
+    out->push_back(static_cast<char>(code_point));
+  } else if (code_point < 0x800) {
+    out->push_back(static_cast<char>(0xc0 | (code_point >> 6)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+  } else if (code_point < 0x10000) {
+    out->push_back(static_cast<char>(0xe0 | (code_point >> 12)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+  } else {
+    out->push_back(static_cast<char>(0xf0 | (code_point >> 18)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3f)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+  }
+}
+
+bool IsHighSurrogate(uint32_t code_unit) {
+  return code_unit >= 0xd800 && code_unit <= 0xdbff;
+}
+
+bool IsLowSurrogate(uint32_t code_unit) {
+  return code_unit >= 0xdc00 && code_unit <= 0xdfff;
+}
+
+}  // namespace
+
+constexpr int JsonReader::kMaxDepth;
+
+JsonReader::JsonReader(absl::string_view json) : json_(json), pos_(0) {}
+
+StatusOr<JsonReader::ValueKind> JsonReader::PeekValueKind() {
+  SkipWhitespace();
+  if (pos_ == json_.size()) {
+    return Error("expected a value");
+  }
+  switch (json_[pos_]) {
+    case '{':
+      return ValueKind::kObject;
+    case '[':
+      return ValueKind::kArray;
+    case '"':
+      return ValueKind::kString;
+    case 't':
+    case 'f':
+      return ValueKind::kBoolean;
+    case 'n':
+      return ValueKind::kNull;
+    case '-':
+      return ValueKind::kNumber;
+    default:
+      if (absl::ascii_isdigit(json_[pos_])) {
+        return ValueKind::kNumber;
+      }
+      return Error("expected a value");
+  }
+}
+
+Status JsonReader::BeginObject() {
+  if (containers_.size() >= kMaxDepth) {
+    return Error("nested too deeply");
+  }
+  ASYLO_RETURN_IF_ERROR(Expect('{'));
+  containers_.push_back({/*is_object=*/true, /*has_members=*/false});
+  return Status::OkStatus();
+}
+
+StatusOr<bool> JsonReader::NextField(std::string *name) {
+  bool has_field;
+  ASYLO_ASSIGN_OR_RETURN(has_field,
+                         NextMember(/*is_object=*/true, /*terminator=*/'}'));
+  if (!has_field) {
+    return false;
+  }
+  SkipWhitespace();
+  name->clear();
+  ASYLO_RETURN_IF_ERROR(ScanString(name));
+  ASYLO_RETURN_IF_ERROR(Expect(':'));
+  return true;
+}
+
+Status JsonReader::BeginArray() {
+  if (containers_.size() >= kMaxDepth) {
+    return Error("nested too deeply");
+  }
+  ASYLO_RETURN_IF_ERROR(Expect('['));
+  containers_.push_back({/*is_object=*/false, /*has_members=*/false});
+  return Status::OkStatus();
+}
+
+StatusOr<bool> JsonReader::NextElement() {
+  return NextMember(/*is_object=*/false, /*terminator=*/']');
+}
+
+StatusOr<std::string> JsonReader::ReadString() {
+  SkipWhitespace();
+  std::string decoded;
+  ASYLO_RETURN_IF_ERROR(ScanString(&decoded));
+  return decoded;
+}
+
+StatusOr<absl::string_view> JsonReader::ReadRawValue() {
+  SkipWhitespace();
+  size_t begin = pos_;
+  ASYLO_RETURN_IF_ERROR(ScanValue(containers_.size()));
+  return json_.substr(begin, pos_ - begin);
+}
+
+Status JsonReader::SkipValue() { return ReadRawValue().status(); }
+
+Status JsonReader::ExpectEnd() {
+  if (!containers_.empty()) {
+    return Error(containers_.back().is_object ? "expected '}'"
+                                              : "expected ']'");
+  }
+  SkipWhitespace();
+  if (pos_ != json_.size()) {
+    return Error("expected the end of the input");
+  }
+  return Status::OkStatus();
+}
+
+Status JsonReader::Error(absl::string_view problem) const {
+  return Status(error::GoogleError::INVALID_ARGUMENT,
+                absl::StrCat("Invalid JSON at offset ", pos_, ": ", problem));
+}
+
+void JsonReader::SkipWhitespace() {
+  while (pos_ < json_.size() &&
+         (json_[pos_] == ' ' || json_[pos_] == '\t' || json_[pos_] == '\n' ||
+          json_[pos_] == '\r')) {
+    ++pos_;
+  }
+}
+
+Status JsonReader::Expect(char c) {
+  SkipWhitespace();
+  if (pos_ == json_.size() || json_[pos_] != c) {
+    return Error(absl::StrCat("expected '", std::string(1, c), "'"));
+  }
+  ++pos_;
+  return Status::OkStatus();
+}
+
+StatusOr<bool> JsonReader::NextMember(bool is_object, char terminator) {
+  if (containers_.empty() || containers_.back().is_object != is_object) {
+    return Error(is_object ? "not in an object" : "not in an array");
+  }
+  Container *container = &containers_.back();
+  SkipWhitespace();
+  if (pos_ < json_.size() && json_[pos_] == terminator) {
+    ++pos_;
+    containers_.pop_back();
+    return false;
+  }
+  if (container->has_members) {
+    ASYLO_RETURN_IF_ERROR(Expect(','));
+  }
+  container->has_members = true;
+  return true;
+}
+
+Status JsonReader::ScanValue(int depth) {
+  ValueKind kind;
+  ASYLO_ASSIGN_OR_RETURN(kind, PeekValueKind());
+  switch (kind) {
+    case ValueKind::kString:
+      return ScanString(/*decoded=*/nullptr);
+    case ValueKind::kNumber:
+      return ScanNumber();
+    case ValueKind::kBoolean:
+      return ScanLiteral(json_[pos_] == 't' ? "true" : "false");
+    case ValueKind::kNull:
+      return ScanLiteral("null");
+    case ValueKind::kObject:
+    case ValueKind::kArray:
+      break;
+  }
+
+  if (depth >= kMaxDepth) {
+    return Error("nested too deeply");
+  }
+  bool is_object = kind == ValueKind::kObject;
+  char terminator = is_object ? '}' : ']';
+  ++pos_;
+  SkipWhitespace();
+  if (pos_ < json_.size() && json_[pos_] == terminator) {
+    ++pos_;
+    return Status::OkStatus();
+  }
+  while (true) {
+    if (is_object) {
+      SkipWhitespace();
+      ASYLO_RETURN_IF_ERROR(ScanString(/*decoded=*/nullptr));
+      ASYLO_RETURN_IF_ERROR(Expect(':'));
+    }
+    ASYLO_RETURN_IF_ERROR(ScanValue(depth + 1));
+    SkipWhitespace();
+    if (pos_ < json_.size() && json_[pos_] == terminator) {
+      ++pos_;
+      return Status::OkStatus();
+    }
+    ASYLO_RETURN_IF_ERROR(Expect(','));
+  }
+}
+
+Status JsonReader::ScanString(std::string *decoded) {
+  if (pos_ == json_.size() || json_[pos_] != '"') {
+    return Error("expected a string");
+  }
+  ++pos_;
+  while (true) {
+    // Copy the run of characters up to the next quote or escape at once.
+    size_t run_begin = pos_;
+    while (pos_ < json_.size() && json_[pos_] != '"' && json_[pos_] != '\\') {
+      if (static_cast<unsigned char>(json_[pos_]) < 0x20) {
+        return Error("control character in string");
+      }
+      ++pos_;
+    }
+    if (decoded) {
+      decoded->append(json_.data() + run_begin, pos_ - run_begin);
+    }
+    if (pos_ == json_.size()) {
+      return Error("unterminated string");
+    }
+    if (json_[pos_++] == '"') {
+      return Status::OkStatus();
+    }
+
+    if (pos_ == json_.size()) {
+      return Error("unterminated string");
+    }
+    char escaped = json_[pos_++];
+    char unescaped;
+    switch (escaped) {
+      case '"':
+      case '\\':
+      case '/':
+        unescaped = escaped;
+        break;
+      case 'b':
+        unescaped = '\b';
+        break;
+      case 'f':
+        unescaped = '\f';
+        break;
+      case 'n':
+        unescaped = '\n';
+        break;
+      case 'r':
+        unescaped = '\r';
+        break;
+      case 't':
+        unescaped = '\t';
+        break;
+      case 'u': {
+        uint32_t code_point;
+        ASYLO_ASSIGN_OR_RETURN(code_point, ScanHexQuad());
+        if (IsLowSurrogate(code_point)) {
+          return Error("unpaired surrogate in string");
+        }
+        if (IsHighSurrogate(code_point)) {
+          if (json_.substr(pos_, 2) != "\\u") {
+            return Error("unpaired surrogate in string");
+          }
+          pos_ += 2;
+          uint32_t low;
+          ASYLO_ASSIGN_OR_RETURN(low, ScanHexQuad());
+          if (!IsLowSurrogate(low)) {
+            return Error("unpaired surrogate in string");
+          }
+          code_point = 0x10000 + ((code_point - 0xd800) << 10) + (low - 0xdc00);
+        }
+        if (decoded) {
+          AppendUtf8(code_point, decoded);
+        }
+        continue;
+      }
+      default:
+        return Error("invalid escape sequence in string");
+    }
+    if (decoded) {
+      decoded->push_back(unescaped);
+    }
+  }
+}
+
+Status JsonReader::ScanNumber() {
+  if (json_[pos_] == '-') {
+    ++pos_;
+  }
+  auto scan_digits = [this] {
+    size_t begin = pos_;
+    while (pos_ < json_.size() && absl::ascii_isdigit(json_[pos_])) {
+      ++pos_;
+    }
+    return pos_ - begin;
+  };
+
+  size_t integer_begin = pos_;
+  size_t integer_digits = scan_digits();
+  if (integer_digits == 0) {
+    return Error("expected a digit");
+  }
+  if (integer_digits > 1 && json_[integer_begin] == '0') {
+    return Error("leading zero in number");
+  }
+  if (pos_ < json_.size() && json_[pos_] == '.') {
+    ++pos_;
+    if (scan_digits() == 0) {
+      return Error("expected a digit");
+    }
+  }
+  if (pos_ < json_.size() && (json_[pos_] == 'e' || json_[pos_] == 'E')) {
+    ++pos_;
+    if (pos_ < json_.size() && (json_[pos_] == '+' || json_[pos_] == '-')) {
+      ++pos_;
+    }
+    if (scan_digits() == 0) {
+      return Error("expected a digit");
+    }
+  }
+  return Status::OkStatus();
+}
+
+Status JsonReader::ScanLiteral(absl::string_view literal) {
+  if (json_.substr(pos_, literal.size()) != literal) {
+    return Error("expected a value");
+  }
+  pos_ += literal.size();
+  return Status::OkStatus();
+}
+
+StatusOr<uint32_t> JsonReader::ScanHexQuad() {
+  if (json_.size() - pos_ < 4) {
+    return Error("unterminated string");
+  }
+  uint32_t value = 0;
+  for (int i = 0; i < 4; ++i) {
+    char c = json_[pos_];
+    if (!absl::ascii_isxdigit(c)) {
+      return Error("invalid escape sequence in string");
+    }
+    int digit =
+        absl::ascii_isdigit(c) ? c - '0' : absl::ascii_tolower(c) - 'a' + 10;
+    value = (value << 4) | digit;
+    ++pos_;
+  }
+  return value;
+}
+
+}  // namespace asylo
@@ -0,0 +1,146 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_UTIL_JSON_READER_H_
+#define ASYLO_UTIL_JSON_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+
+// JsonReader reads JSON text one value at a time, in the order the values
+// appear, without building a tree of the whole document. This lets callers
+// convert large documents directly into the messages they describe, holding
+// only what they keep.
+//
+// Objects and arrays are read with BeginObject() and NextField(), or with
+// BeginArray() and NextElement(). Each field or element must then be read with
+// exactly one of ReadString(), ReadRawValue(), SkipValue(), BeginObject() or
+// BeginArray(). For example:
+//
+//     JsonReader reader(json);
+//     ASYLO_RETURN_IF_ERROR(reader.BeginArray());
+//     bool has_element;
+//     while (true) {
+//       ASYLO_ASSIGN_OR_RETURN(has_element, reader.NextElement());
+//       if (!has_element) break;
+//       std::string element;
+//       ASYLO_ASSIGN_OR_RETURN(element, reader.ReadString());
+//       ...
+//     }
+//     ASYLO_RETURN_IF_ERROR(reader.ExpectEnd());
+//
+// All methods return an INVALID_ARGUMENT error if the text read is not valid
+// JSON or is not of the kind expected. After an error, the reader must not be
+// used further.
+//
+// JsonReader does not copy |json|, which must outlive it.
+class JsonReader {
+ public:
+  // The kinds of JSON values.
+  enum class ValueKind { kObject, kArray, kString, kNumber, kBoolean, kNull };
+
+  // The maximum nesting depth of objects and arrays the reader accepts.
+  static constexpr int kMaxDepth = 100;
+
+  explicit JsonReader(absl::string_view json);
+
+  // Returns the kind of the next value, without reading it.
+  StatusOr<ValueKind> PeekValueKind();
+
+  // Reads the opening brace of an object.
+  Status BeginObject();
+
+  // Reads the name of the next field of the innermost object being read into
+  // |name| and returns true. If that object has no more fields, reads its
+  // closing brace and returns false.
+  StatusOr<bool> NextField(std::string *name);
+
+  // Reads the opening bracket of an array.
+  Status BeginArray();
+
+  // Returns true if the innermost array being read has another element. If it
+  // does not, reads its closing bracket and returns false.
+  StatusOr<bool> NextElement();
+
+  // Reads a string value and returns it with its escape sequences decoded.
+  StatusOr<std::string> ReadString();
+
+  // Reads a value of any kind and returns its text, exactly as it appears in
+  // the input. The returned view points into the input.
+  StatusOr<absl::string_view> ReadRawValue();
+
+  // Reads and discards a value of any kind.
+  Status SkipValue();
+
+  // Returns an OK status if all objects and arrays begun have been read and
+  // nothing but whitespace follows.
+  Status ExpectEnd();
+
+ private:
+  // An object or array being read.
+  struct Container {
+    bool is_object;
+    bool has_members;
+  };
+
+  // Returns an INVALID_ARGUMENT error describing |problem| at the current
+  // position.
+  Status Error(absl::string_view problem) const;
+
+  // Skips any whitespace at the current position.
+  void SkipWhitespace();
+
+  // Reads |c| at the current position, after any whitespace.
+  Status Expect(char c);
+
+  // Reads the separator before the next member of the innermost container, if
+  // it has any members already. Returns false and reads the closing
+  // |terminator| if it has no more members.
+  StatusOr<bool> NextMember(bool is_object, char terminator);
+
+  // Reads a value of any kind, nested |depth| containers deep, checking its
+  // syntax without decoding it.
+  Status ScanValue(int depth);
+
+  // Reads a string, storing its decoded contents to |decoded| if it is not
+  // null.
+  Status ScanString(std::string *decoded);
+
+  // Reads a number or the literal |literal|.
+  Status ScanNumber();
+  Status ScanLiteral(absl::string_view literal);
+
+  // Reads four hexadecimal digits of a \u escape sequence.
+  StatusOr<uint32_t> ScanHexQuad();
+
+  absl::string_view json_;
+  size_t pos_;
+  std::vector<Container> containers_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_UTIL_JSON_READER_H_
@@ -0,0 +1,129 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/util/json_reader.h"
+
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Eq;
+using ::testing::IsFalse;
+using ::testing::IsTrue;
+
+TEST(JsonReaderTest, ReadsNestedValuesInOrder) {
+  JsonReader reader(
+      R"json( {"name": "a\"b\\c\u00e9\ud83d\ude00", "list": [1, -2.5e3],
+               "skip": {"x": [true, false, null]}} )json");
+  std::string name;
+  ASYLO_ASSERT_OK(reader.BeginObject());
+
+  EXPECT_THAT(reader.NextField(&name), IsOkAndHolds(IsTrue()));
+  EXPECT_THAT(name, Eq("name"));
+  EXPECT_THAT(reader.ReadString(),
+              IsOkAndHolds(Eq("a\"b\\c\xc3\xa9\xf0\x9f\x98\x80")));
+
+  EXPECT_THAT(reader.NextField(&name), IsOkAndHolds(IsTrue()));
+  EXPECT_THAT(name, Eq("list"));
+  ASYLO_ASSERT_OK(reader.BeginArray());
+  EXPECT_THAT(reader.NextElement(), IsOkAndHolds(IsTrue()));
+  EXPECT_THAT(reader.PeekValueKind(),
+              IsOkAndHolds(Eq(JsonReader::ValueKind::kNumber)));
+  EXPECT_THAT(reader.ReadRawValue(), IsOkAndHolds(Eq("1")));
+  EXPECT_THAT(reader.NextElement(), IsOkAndHolds(IsTrue()));
+  EXPECT_THAT(reader.ReadRawValue(), IsOkAndHolds(Eq("-2.5e3")));
+  EXPECT_THAT(reader.NextElement(), IsOkAndHolds(IsFalse()));
+
+  EXPECT_THAT(reader.NextField(&name), IsOkAndHolds(IsTrue()));
+  EXPECT_THAT(name, Eq("skip"));
+  EXPECT_THAT(reader.ReadRawValue(),
+              IsOkAndHolds(Eq(R"json({"x": [true, false, null]})json")));
+
+  EXPECT_THAT(reader.NextField(&name), IsOkAndHolds(IsFalse()));
+  ASYLO_EXPECT_OK(reader.ExpectEnd());
+}
+
+TEST(JsonReaderTest, ReadsEmptyContainers) {
+  JsonReader reader("[{}, []]");
+  std::string name;
+  ASYLO_ASSERT_OK(reader.BeginArray());
+  EXPECT_THAT(reader.NextElement(), IsOkAndHolds(IsTrue()));
+  ASYLO_ASSERT_OK(reader.BeginObject());
+  EXPECT_THAT(reader.NextField(&name), IsOkAndHolds(IsFalse()));
+  EXPECT_THAT(reader.NextElement(), IsOkAndHolds(IsTrue()));
+  ASYLO_EXPECT_OK(reader.SkipValue());
+  EXPECT_THAT(reader.NextElement(), IsOkAndHolds(IsFalse()));
+  ASYLO_EXPECT_OK(reader.ExpectEnd());
+}
+
+TEST(JsonReaderTest, RejectsInvalidValues) {
+  std::vector<std::string> invalid_values = {
+      "",         "[1,]",       "{\"a\" 1}",  "{\"a\":1,}", "\"unterminated",
+      "\"\t\"",   "\"\\x\"",    "\"\\ud800\"", "\"\\udc00\"", "01",
+      "1.",       "-",          "1e",         "tru",        "[1 2]",
+      "{1: 2}",   "[",          "nul",
+  };
+  for (const std::string &value : invalid_values) {
+    JsonReader reader(value);
+    Status status = reader.SkipValue();
+    if (status.ok()) {
+      status = reader.ExpectEnd();
+    }
+    EXPECT_THAT(status, StatusIs(error::GoogleError::INVALID_ARGUMENT))
+        << value;
+  }
+}
+
+TEST(JsonReaderTest, RejectsTrailingText) {
+  JsonReader reader("{} {}");
+  ASYLO_ASSERT_OK(reader.SkipValue());
+  EXPECT_THAT(reader.ExpectEnd(),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+TEST(JsonReaderTest, RejectsUnfinishedContainers) {
+  JsonReader reader("[1");
+  ASYLO_ASSERT_OK(reader.BeginArray());
+  EXPECT_THAT(reader.NextElement(), IsOkAndHolds(IsTrue()));
+  ASYLO_ASSERT_OK(reader.SkipValue());
+  EXPECT_THAT(reader.ExpectEnd(),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+TEST(JsonReaderTest, RejectsDeepNesting) {
+  std::string json(JsonReader::kMaxDepth + 1, '[');
+  json.append(JsonReader::kMaxDepth + 1, ']');
+  JsonReader reader(json);
+  EXPECT_THAT(reader.SkipValue(),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+
+  std::string shallow_json(JsonReader::kMaxDepth, '[');
+  shallow_json.append(JsonReader::kMaxDepth, ']');
+  JsonReader shallow_reader(shallow_json);
+  ASYLO_EXPECT_OK(shallow_reader.SkipValue());
+}
+
+}  // namespace
+}  // namespace asylo
@@ -0,0 +1,293 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/util/log_sink.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <utility>
+
+#include "absl/memory/memory.h"
+
+namespace asylo {
+namespace {
+
+// Maximum number of messages written by one writev(2).
+constexpr size_t kMaxBatchMessages = 256;
+
+// Writes the buffers of |iov| to |fd|, retrying partial writes. Returns false
+// on failure.
+bool WriteAll(int fd, std::vector<struct iovec> iov) {
+  size_t next = 0;
+  while (next < iov.size()) {
+    ssize_t written = writev(fd, iov.data() + next, iov.size() - next);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    while (next < iov.size() &&
+           static_cast<size_t>(written) >= iov[next].iov_len) {
+      written -= iov[next].iov_len;
+      next++;
+    }
+    if (next < iov.size()) {
+      iov[next].iov_base = static_cast<char *>(iov[next].iov_base) + written;
+      iov[next].iov_len -= written;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+// A bounded queue of messages after D. Vyukov's bounded MPMC queue. Each cell
+// carries a sequence number telling producers and the consumer whose turn it
+// is, so that pushes and pops only contend on a single atomic index.
+class LogSink::Ring {
+ public:
+  explicit Ring(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    mask_ = size - 1;
+    cells_ = absl::make_unique<Cell[]>(size);
+    for (size_t i = 0; i < size; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    head_.store(0, std::memory_order_relaxed);
+    tail_.store(0, std::memory_order_relaxed);
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+  // Returns the number of messages in the ring, which may be stale by the time
+  // it is returned.
+  size_t size() const {
+    size_t head = head_.load(std::memory_order_relaxed);
+    return tail_.load(std::memory_order_relaxed) - head;
+  }
+
+  // Moves |*message| into the ring. Returns false, leaving |*message| intact,
+  // if the ring is full.
+  bool TryPush(std::string *message) {
+    size_t position = tail_.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+      cell = &cells_[position & mask_];
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      intptr_t difference =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+      if (difference == 0) {
+        if (tail_.compare_exchange_weak(position, position + 1,
+                                        std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = tail_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->message = std::move(*message);
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Moves up to |max_messages| messages from the ring to |messages|. Must not
+  // be called concurrently.
+  void PopBatch(std::vector<std::string> *messages, size_t max_messages) {
+    size_t position = head_.load(std::memory_order_relaxed);
+    while (messages->size() < max_messages) {
+      Cell *cell = &cells_[position & mask_];
+      if (cell->sequence.load(std::memory_order_acquire) != position + 1) {
+        break;
+      }
+      messages->push_back(std::move(cell->message));
+      cell->message.clear();
+      cell->sequence.store(position + mask_ + 1, std::memory_order_release);
+      position++;
+    }
+    head_.store(position, std::memory_order_relaxed);
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    std::string message;
+  };
+
+  size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  std::atomic<size_t> head_;
+  std::atomic<size_t> tail_;
+};
+
+LogSink::LogSink(Opener open_log_file, int console_fd, const Options &options)
+    : open_log_file_(std::move(open_log_file)),
+      console_fd_(console_fd),
+      options_(options),
+      ring_(absl::make_unique<Ring>(options.max_pending_messages)),
+      log_fd_(-1),
+      dropped_(0),
+      total_dropped_(0),
+      async_(false),
+      wake_(false),
+      stop_(false) {}
+
+LogSink::~LogSink() {
+  {
+    absl::MutexLock lock(&wake_mu_);
+    stop_ = true;
+  }
+  if (flush_thread_.joinable()) {
+    flush_thread_.join();
+  }
+  absl::MutexLock lock(&write_mu_);
+  Drain();
+  if (log_fd_ >= 0) {
+    close(log_fd_);
+  }
+}
+
+void LogSink::Log(std::string message, bool is_error, bool sync) {
+  if (message.empty() || message.back() != '\n') {
+    message.push_back('\n');
+  }
+  if (is_error) {
+    fputs(message.c_str(), stderr);
+    fflush(stderr);
+  }
+
+  if (sync || !async_.load(std::memory_order_acquire)) {
+    absl::MutexLock lock(&write_mu_);
+    Drain();
+    std::vector<std::string> messages;
+    messages.push_back(std::move(message));
+    WriteMessages(&messages, /*dropped=*/0);
+    return;
+  }
+
+  if (!ring_->TryPush(&message)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    total_dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  // Only wake the background thread early once the ring fills up, so that a
+  // steady trickle of messages does not cost a wakeup each.
+  if (ring_->size() >= ring_->capacity() / 2) {
+    absl::MutexLock lock(&wake_mu_);
+    wake_ = true;
+  }
+}
+
+bool LogSink::StartFlushThread() {
+  absl::MutexLock lock(&wake_mu_);
+  if (async_.load(std::memory_order_relaxed)) {
+    return true;
+  }
+  if (stop_) {
+    return false;
+  }
+  flush_thread_ = std::thread(&LogSink::FlushLoop, this);
+  async_.store(true, std::memory_order_release);
+  return true;
+}
+
+void LogSink::Flush() {
+  absl::MutexLock lock(&write_mu_);
+  Drain();
+}
+
+void LogSink::ReopenLogFile() {
+  absl::MutexLock lock(&write_mu_);
+  Drain();
+  if (log_fd_ >= 0) {
+    close(log_fd_);
+    log_fd_ = -1;
+  }
+}
+
+void LogSink::WriteMessages(std::vector<std::string> *messages,
+                            uint64_t dropped) {
+  std::string note;
+  std::vector<struct iovec> iov;
+  iov.reserve(messages->size() + 1);
+  if (dropped > 0) {
+    note = std::to_string(dropped) + " log messages dropped\n";
+    iov.push_back({&note[0], note.size()});
+  }
+  for (std::string &message : *messages) {
+    iov.push_back({&message[0], message.size()});
+  }
+  if (iov.empty()) {
+    return;
+  }
+
+  if (log_fd_ < 0) {
+    log_fd_ = open_log_file_();
+  }
+  if (log_fd_ >= 0 && !WriteAll(log_fd_, iov)) {
+    fprintf(stderr, "Failed to write to log file!\n");
+  }
+  WriteAll(console_fd_, iov);
+}
+
+void LogSink::Drain() {
+  std::vector<std::string> messages;
+  messages.reserve(kMaxBatchMessages);
+  while (true) {
+    messages.clear();
+    ring_->PopBatch(&messages, kMaxBatchMessages);
+    uint64_t dropped = dropped_.exchange(0, std::memory_order_relaxed);
+    if (messages.empty() && dropped == 0) {
+      return;
+    }
+    WriteMessages(&messages, dropped);
+    if (messages.size() < kMaxBatchMessages) {
+      return;
+    }
+  }
+}
+
+void LogSink::FlushLoop() {
+  while (true) {
+    bool stop;
+    {
+      absl::MutexLock lock(&wake_mu_);
+      auto woken = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(wake_mu_) {
+        return wake_ || stop_;
+      };
+      wake_mu_.AwaitWithTimeout(absl::Condition(&woken),
+                                options_.flush_interval);
+      wake_ = false;
+      stop = stop_;
+    }
+    absl::MutexLock lock(&write_mu_);
+    Drain();
+    if (stop) {
+      return;
+    }
+  }
+}
+
+}  // namespace asylo
@@ -0,0 +1,137 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_UTIL_LOG_SINK_H_
+#define ASYLO_UTIL_LOG_SINK_H_
+
+#include <sys/uio.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace asylo {
+
+// Writes log messages to a log file, which is kept open between messages, and
+// to a console file descriptor.
+//
+// By default each message is written synchronously, with one writev(2) per
+// destination. Once StartFlushThread() succeeds, messages are instead appended
+// to a bounded, lock-free ring in memory and written in batches, one writev(2)
+// per destination, by a background thread. Inside an enclave, this replaces
+// several host calls on every logging thread with a few host calls per batch
+// on the flushing thread. Messages which find the ring full are dropped, and
+// the number of dropped messages is reported in the next batch.
+//
+// This class is thread-safe.
+class LogSink {
+ public:
+  struct Options {
+    // Maximum number of messages waiting for the background thread, rounded
+    // up to a power of two.
+    size_t max_pending_messages = 1024;
+
+    // Longest time a message waits for the background thread. The thread is
+    // woken earlier once the ring is half full.
+    absl::Duration flush_interval = absl::Milliseconds(100);
+  };
+
+  // Opens the log file, returning a file descriptor open for appending, or -1
+  // on failure.
+  using Opener = std::function<int()>;
+
+  // Constructs a sink writing to the log file opened by |open_log_file| on
+  // first use, and to |console_fd|, which is not owned.
+  LogSink(Opener open_log_file, int console_fd, const Options &options);
+
+  LogSink(const LogSink &other) = delete;
+  LogSink &operator=(const LogSink &other) = delete;
+
+  // Stops the background thread, if any, and writes the pending messages.
+  ~LogSink();
+
+  // Writes |message|, followed by a newline unless it ends in one. A message
+  // with |is_error| set is written to stderr immediately as well. A message
+  // with |sync| set is written, after all pending messages, before the call
+  // returns.
+  void Log(std::string message, bool is_error, bool sync);
+
+  // Starts writing messages from a background thread. Returns false if the
+  // thread could not be started, in which case messages are still written
+  // synchronously.
+  bool StartFlushThread();
+
+  // Writes all pending messages before returning.
+  void Flush();
+
+  // Closes the log file, to be opened again by the next write, such as after
+  // the log path changed.
+  void ReopenLogFile();
+
+  // Returns the number of messages dropped since construction.
+  uint64_t dropped_messages() const {
+    return total_dropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // A bounded multiple-producer queue of messages.
+  class Ring;
+
+  // Writes |messages| to the log file and console, preceded by a note of
+  // |dropped| messages unless it is zero.
+  void WriteMessages(std::vector<std::string> *messages, uint64_t dropped)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(write_mu_);
+
+  // Writes all pending messages.
+  void Drain() ABSL_EXCLUSIVE_LOCKS_REQUIRED(write_mu_);
+
+  // Flushes pending messages until stopped.
+  void FlushLoop();
+
+  const Opener open_log_file_;
+  const int console_fd_;
+  const Options options_;
+  const std::unique_ptr<Ring> ring_;
+
+  // Serializes writes, so that lines of different messages do not interleave.
+  absl::Mutex write_mu_;
+  int log_fd_ ABSL_GUARDED_BY(write_mu_);
+
+  // Messages dropped since the last batch, and since construction.
+  std::atomic<uint64_t> dropped_;
+  std::atomic<uint64_t> total_dropped_;
+
+  std::atomic<bool> async_;
+  absl::Mutex wake_mu_;
+  bool wake_ ABSL_GUARDED_BY(wake_mu_);
+  bool stop_ ABSL_GUARDED_BY(wake_mu_);
+  std::thread flush_thread_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_UTIL_LOG_SINK_H_
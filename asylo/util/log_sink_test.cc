@@ -0,0 +1,151 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/util/log_sink.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/memory/memory.h"
+#include "absl/time/time.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::HasSubstr;
+using ::testing::IsEmpty;
+
+class LogSinkTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_EQ(pipe2(log_pipe_, O_NONBLOCK), 0);
+    ASSERT_EQ(pipe2(console_pipe_, O_NONBLOCK), 0);
+  }
+
+  void TearDown() override {
+    for (int fd : {log_pipe_[0], log_pipe_[1], console_pipe_[0],
+                   console_pipe_[1]}) {
+      close(fd);
+    }
+  }
+
+  std::unique_ptr<LogSink> MakeSink(const LogSink::Options &options) {
+    return absl::make_unique<LogSink>(
+        [this] {
+          opens_++;
+          return dup(log_pipe_[1]);
+        },
+        console_pipe_[1], options);
+  }
+
+  // Returns all data written to the read end |fd| of a pipe so far.
+  static std::string ReadAvailable(int fd) {
+    std::string data;
+    char buffer[4096];
+    ssize_t size;
+    while ((size = read(fd, buffer, sizeof(buffer))) > 0) {
+      data.append(buffer, size);
+    }
+    return data;
+  }
+
+  int log_pipe_[2];
+  int console_pipe_[2];
+  int opens_ = 0;
+};
+
+TEST_F(LogSinkTest, WritesSynchronouslyByDefault) {
+  auto sink = MakeSink(LogSink::Options());
+  sink->Log("first", /*is_error=*/false, /*sync=*/false);
+  sink->Log("second\n", /*is_error=*/false, /*sync=*/false);
+  EXPECT_EQ(ReadAvailable(log_pipe_[0]), "first\nsecond\n");
+  EXPECT_EQ(ReadAvailable(console_pipe_[0]), "first\nsecond\n");
+  EXPECT_EQ(opens_, 1);
+}
+
+TEST_F(LogSinkTest, QueuesMessagesForFlushThread) {
+  LogSink::Options options;
+  options.flush_interval = absl::Hours(1);
+  auto sink = MakeSink(options);
+  ASSERT_TRUE(sink->StartFlushThread());
+  sink->Log("first", /*is_error=*/false, /*sync=*/false);
+  sink->Log("second", /*is_error=*/false, /*sync=*/false);
+  EXPECT_THAT(ReadAvailable(log_pipe_[0]), IsEmpty());
+  sink->Flush();
+  EXPECT_EQ(ReadAvailable(log_pipe_[0]), "first\nsecond\n");
+  EXPECT_EQ(ReadAvailable(console_pipe_[0]), "first\nsecond\n");
+}
+
+TEST_F(LogSinkTest, SyncMessagesFollowPendingMessages) {
+  LogSink::Options options;
+  options.flush_interval = absl::Hours(1);
+  auto sink = MakeSink(options);
+  ASSERT_TRUE(sink->StartFlushThread());
+  sink->Log("pending", /*is_error=*/false, /*sync=*/false);
+  sink->Log("fatal", /*is_error=*/false, /*sync=*/true);
+  EXPECT_EQ(ReadAvailable(log_pipe_[0]), "pending\nfatal\n");
+}
+
+TEST_F(LogSinkTest, ReportsDroppedMessages) {
+  LogSink::Options options;
+  options.max_pending_messages = 2;
+  options.flush_interval = absl::Hours(1);
+  auto sink = MakeSink(options);
+  ASSERT_TRUE(sink->StartFlushThread());
+  constexpr int kMessages = 1000;
+  for (int i = 0; i < kMessages; ++i) {
+    sink->Log("m", /*is_error=*/false, /*sync=*/false);
+  }
+  sink->Flush();
+  std::string log = ReadAvailable(log_pipe_[0]);
+  size_t written = 0;
+  for (size_t i = log.find("m\n"); i != std::string::npos;
+       i = log.find("m\n", i + 2)) {
+    written++;
+  }
+  EXPECT_EQ(written + sink->dropped_messages(), kMessages);
+  if (sink->dropped_messages() > 0) {
+    EXPECT_THAT(log, HasSubstr("log messages dropped\n"));
+  }
+}
+
+TEST_F(LogSinkTest, ReopensLogFile) {
+  auto sink = MakeSink(LogSink::Options());
+  sink->Log("first", /*is_error=*/false, /*sync=*/false);
+  sink->ReopenLogFile();
+  sink->Log("second", /*is_error=*/false, /*sync=*/false);
+  EXPECT_EQ(opens_, 2);
+  EXPECT_EQ(ReadAvailable(log_pipe_[0]), "first\nsecond\n");
+}
+
+TEST_F(LogSinkTest, DestructionWritesPendingMessages) {
+  LogSink::Options options;
+  options.flush_interval = absl::Hours(1);
+  auto sink = MakeSink(options);
+  ASSERT_TRUE(sink->StartFlushThread());
+  sink->Log("pending", /*is_error=*/false, /*sync=*/false);
+  sink.reset();
+  EXPECT_EQ(ReadAvailable(log_pipe_[0]), "pending\n");
+}
+
+}  // namespace
+}  // namespace asylo
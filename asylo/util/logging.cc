@@ -25,6 +25,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <atomic>
 #include <cctype>
 #include <cstdio>
 #include <cstdlib>
@@ -32,6 +33,11 @@
 #include <sstream>
 #include <string>
 
+#include "absl/base/const_init.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "asylo/util/log_sink.h"
+
 namespace asylo {
 
 #ifdef __ASYLO__
@@ -53,7 +59,11 @@ std::string *log_basename = nullptr;
 
 // The VLOG level, only VLOG with level equal to or below this level is logged,
 // specified at the time the enclave is initialized.
-int vlog_level = 0;
+std::atomic<int> vlog_level(0);
+
+// Guards the registry of VLOG sites, a list linked through VLogSite::next_.
+ABSL_CONST_INIT absl::Mutex vlog_sites_mu(absl::kConstInit);
+VLogSite *vlog_sites ABSL_GUARDED_BY(vlog_sites_mu) = nullptr;
 
 // A flag to ensure that LOG(FATAL) doesn't lead to an infinite loop of
 // failures.
@@ -74,21 +84,38 @@ const std::string BuildFilename(std::string filename) {
   return filename;
 }
 
+const std::string get_log_basename() {
+  if (!log_basename || log_basename->empty()) {
+    return kInsideEnclave ? "enclave_log" : "untrusted_log";
+  }
+  return *log_basename;
+}
+
+// Returns the sink writing log messages to the log file and stdout, which
+// opens the log file once rather than for every message.
+LogSink *GetLogSink() {
+  static LogSink *sink = new LogSink(
+      [] {
+        std::string log_path = get_log_directory() + get_log_basename();
+        int fd = open(log_path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0666);
+        if (fd < 0) {
+          fprintf(stderr, "Failed to open log file : %s!\n", log_path.c_str());
+        }
+        return fd;
+      },
+      STDOUT_FILENO, LogSink::Options());
+  return sink;
+}
+
 bool set_log_basename(const std::string &filename) {
   if (log_basename || filename.empty()) {
     return false;
   }
   log_basename = new std::string(filename);
+  GetLogSink()->ReopenLogFile();
   return true;
 }
 
-const std::string get_log_basename() {
-  if (!log_basename || log_basename->empty()) {
-    return kInsideEnclave ? "enclave_log" : "untrusted_log";
-  }
-  return *log_basename;
-}
-
 }  // namespace
 
 bool set_log_directory(const std::string &log_directory) {
@@ -104,6 +131,7 @@ bool set_log_directory(const std::string &log_directory) {
   } else {
     log_file_directory = new std::string(tmp_directory + "/");
   }
+  GetLogSink()->ReopenLogFile();
   return true;
 }
 
@@ -114,9 +142,27 @@ const std::string get_log_directory() {
   return *log_file_directory;
 }
 
-void set_vlog_level(int level) { vlog_level = level; }
+void set_vlog_level(int level) {
+  absl::MutexLock lock(&vlog_sites_mu);
+  vlog_level.store(level, std::memory_order_relaxed);
+  for (VLogSite *site = vlog_sites; site; site = site->next_) {
+    site->level_.store(level, std::memory_order_relaxed);
+  }
+}
 
-int get_vlog_level() { return vlog_level; }
+int get_vlog_level() { return vlog_level.load(std::memory_order_relaxed); }
+
+bool VLogSite::SlowIsEnabled(int level) {
+  absl::MutexLock lock(&vlog_sites_mu);
+  if (!registered_) {
+    registered_ = true;
+    next_ = vlog_sites;
+    vlog_sites = this;
+    level_.store(vlog_level.load(std::memory_order_relaxed),
+                 std::memory_order_relaxed);
+  }
+  return level <= level_.load(std::memory_order_relaxed);
+}
 
 bool EnsureDirectory(const char *path) {
   struct stat dirStat;
@@ -133,6 +179,16 @@ bool EnsureDirectory(const char *path) {
   return true;
 }
 
+bool EnableAsyncLogging() {
+  if (!GetLogSink()->StartFlushThread()) {
+    return false;
+  }
+  static bool flush_at_exit = atexit(FlushLog) == 0;
+  return flush_at_exit;
+}
+
+void FlushLog() { GetLogSink()->Flush(); }
+
 bool InitLogging(const char *directory, const char *file_name, int level) {
   set_vlog_level(level);
   std::string log_directory = directory ? std::string(directory) : "";
@@ -217,27 +273,9 @@ LogMessageFatal::~LogMessageFatal() {
 }
 
 void LogMessage::SendToLog(const std::string &message_text) {
-  std::string log_path = get_log_directory() + get_log_basename();
-
-  FILE *file = fopen(log_path.c_str(), "ab");
-  if (file) {
-    if (fprintf(file, "%s", message_text.c_str()) > 0) {
-      if (message_text.back() != '\n') {
-        fprintf(file, "\n");
-      }
-    } else {
-      fprintf(stderr, "Failed to write to log file : %s!\n", log_path.c_str());
-    }
-    fclose(file);
-  } else {
-    fprintf(stderr, "Failed to open log file : %s!\n", log_path.c_str());
-  }
-  if (severity_ >= ERROR) {
-    fprintf(stderr, "%s\n", message_text.c_str());
-    fflush(stderr);
-  }
-  printf("%s\n", message_text.c_str());
-  fflush(stdout);
+  // Fatal messages are written before the caller aborts.
+  GetLogSink()->Log(message_text, /*is_error=*/severity_ >= ERROR,
+                    /*sync=*/severity_ >= FATAL);
 }
 
 CheckOpMessageBuilder::CheckOpMessageBuilder(const char *exprtext)
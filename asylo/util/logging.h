@@ -19,6 +19,7 @@
 #ifndef ASYLO_UTIL_LOGGING_H_
 #define ASYLO_UTIL_LOGGING_H_
 
+#include <atomic>
 #include <cstdint>
 #include <cstdlib>
 #include <memory>
@@ -84,8 +85,31 @@
 /// VLOG(1) << "Print when VLOG level is set to be 1 or higher";
 /// ```
 ///
+/// A statement is only compiled in if its level is at most
+/// `ASYLO_MAX_VLOG_LEVEL`, such that disabled statements cost nothing at all.
+/// Otherwise, its level is checked against a threshold cached at the statement,
+/// so that a disabled statement costs a single relaxed load.
+///
 /// \param level The numeric level that determines whether to log the message.
-#define VLOG(level) LOG_IF(INFO, (level) <= get_vlog_level())
+#define VLOG(level) LOG_IF(INFO, VLOG_IS_ON(level))
+
+/// The highest `VLOG` level compiled in. `VLOG` statements of higher levels are
+/// compiled out, regardless of the threshold set at runtime. Builds may define
+/// it, to -1 to compile out all `VLOG` statements, for example in release
+/// enclaves.
+#ifndef ASYLO_MAX_VLOG_LEVEL
+#define ASYLO_MAX_VLOG_LEVEL 2147483647
+#endif
+
+/// Evaluates to true if a `VLOG` statement of the given level at this site
+/// would be logged.
+///
+/// \param level The numeric level to check.
+#define VLOG_IS_ON(level)                                    \
+  ((level) <= ASYLO_MAX_VLOG_LEVEL && [](int vlog_level) {   \
+    static ::asylo::VLogSite vlog_site;                      \
+    return vlog_site.IsEnabled(vlog_level);                  \
+  }(level))
 
 /// Terminates the program with a fatal error if the specified condition is
 /// false.
@@ -109,6 +133,45 @@ enum LogSeverity { INFO, WARNING, ERROR, FATAL, QFATAL };
 namespace asylo {
 
 /// \cond Internal
+/// The threshold of a `VLOG` statement, cached at the statement. Sites
+/// register themselves on first use, after which `set_vlog_level` updates
+/// their cached threshold.
+class VLogSite {
+ public:
+  constexpr VLogSite()
+      : level_(kUninitialized), registered_(false), next_(nullptr) {}
+
+  VLogSite(const VLogSite &) = delete;
+  VLogSite &operator=(const VLogSite &) = delete;
+
+  /// Returns true if a statement of level `level` at this site is logged.
+  bool IsEnabled(int level) {
+    int cached = level_.load(std::memory_order_relaxed);
+    if (ABSL_PREDICT_TRUE(level > cached)) {
+      return false;
+    }
+    if (ABSL_PREDICT_TRUE(cached != kUninitialized)) {
+      return true;
+    }
+    return SlowIsEnabled(level);
+  }
+
+ private:
+  friend void set_vlog_level(int level);
+
+  // Placeholder for the threshold before the site is registered. No level is
+  // above it, so IsEnabled() always takes the slow path until then.
+  static constexpr int kUninitialized = 2147483647;
+
+  // Registers this site and caches the current threshold.
+  bool SlowIsEnabled(int level);
+
+  std::atomic<int> level_;
+  // Guarded by the registry of sites in logging.cc.
+  bool registered_;
+  VLogSite *next_;
+};
+
 /// This formats a value for a failing CHECK_XX statement.  Ordinarily,
 /// it uses the definition for `operator<<`, with a few special cases below.
 template <typename T>
@@ -326,6 +389,20 @@ bool EnsureDirectory(const char *path);
 ///        a level equal to or lower than it will be logged.
 bool InitLogging(const char *directory, const char *file_name, int level);
 
+/// Writes log messages from a background thread rather than from the logging
+/// thread. Messages are then queued in a bounded buffer in memory and written
+/// in batches, and messages logged while the buffer is full are dropped.
+/// `FATAL` and `QFATAL` messages are still written, together with all queued
+/// messages, before the logging thread aborts. Queued messages are written at
+/// exit as well.
+///
+/// \return True if and only if log messages are written from a background
+///         thread.
+bool EnableAsyncLogging();
+
+/// Writes all log messages queued by asynchronous logging before returning.
+void FlushLog();
+
 /// Class representing a log message created by a log macro.
 class LogMessage {
  public:
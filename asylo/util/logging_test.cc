@@ -0,0 +1,70 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Compile out VLOG statements above level 2 in this test.
+#define ASYLO_MAX_VLOG_LEVEL 2
+
+#include "asylo/util/logging.h"
+
+#include <gtest/gtest.h>
+
+namespace asylo {
+namespace {
+
+// Returns whether a VLOG statement of |level| at a single site is logged.
+bool SiteIsOn(int level) { return VLOG_IS_ON(level); }
+
+class VLogTest : public ::testing::Test {
+ protected:
+  void SetUp() override { saved_level_ = get_vlog_level(); }
+  void TearDown() override { set_vlog_level(saved_level_); }
+
+  int saved_level_;
+};
+
+TEST_F(VLogTest, SiteFollowsThreshold) {
+  set_vlog_level(0);
+  EXPECT_TRUE(SiteIsOn(0));
+  EXPECT_FALSE(SiteIsOn(1));
+
+  // The site registered above picks up later thresholds.
+  set_vlog_level(1);
+  EXPECT_TRUE(SiteIsOn(1));
+  EXPECT_FALSE(SiteIsOn(2));
+  set_vlog_level(2);
+  EXPECT_TRUE(SiteIsOn(2));
+}
+
+TEST_F(VLogTest, DisabledStatementsDoNotEvaluateOperands) {
+  set_vlog_level(0);
+  int evaluated = 0;
+  VLOG(1) << ++evaluated;
+  EXPECT_EQ(evaluated, 0);
+}
+
+TEST_F(VLogTest, StatementsAboveMaxLevelAreCompiledOut) {
+  set_vlog_level(5);
+  EXPECT_TRUE(VLOG_IS_ON(2));
+  EXPECT_FALSE(VLOG_IS_ON(3));
+  int evaluated = 0;
+  VLOG(3) << ++evaluated;
+  EXPECT_EQ(evaluated, 0);
+}
+
+}  // namespace
+}  // namespace asylo
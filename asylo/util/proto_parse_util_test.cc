@@ -18,17 +18,25 @@
 
 #include "asylo/util/proto_parse_util.h"
 
+#include <fstream>
+#include <string>
 #include <vector>
 
+#include <google/protobuf/arena.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include "absl/flags/flag.h"
+#include "absl/strings/str_cat.h"
 #include "asylo/test/util/proto_matchers.h"
 #include "asylo/test/util/status_matchers.h"
+#include "asylo/test/util/test_flags.h"
 #include "asylo/util/proto_parse_util_test.pb.h"
 
 namespace asylo {
 namespace {
 
+using ::testing::Not;
+
 TEST(ProtoParseUtilTest, ParseEmptyMessage) {
   TestMessage expected;
   EXPECT_THAT(ParseTextProto<TestMessage>(""),
@@ -74,5 +82,67 @@ TEST(ProtoParseUtilTest, ParseInvalidInput) {
   EXPECT_DEATH_IF_SUPPORTED(TestMessage m = ParseTextProtoOrDie("junk"), "");
 }
 
+TestMessage MakeFullMessage() {
+  TestMessage message;
+  message.set_enum_field(TEST_VALUE_ONE);
+  message.set_int_field(123);
+  message.mutable_message_field()->set_string_field("Lorem ipsum");
+  return message;
+}
+
+// Writes |contents| to a file named |name| in the test temporary directory and
+// returns its path.
+std::string WriteTempFile(const std::string &name,
+                          const std::string &contents) {
+  std::string path = absl::StrCat(absl::GetFlag(FLAGS_test_tmpdir), "/", name);
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file << contents;
+  return path;
+}
+
+TEST(ProtoParseUtilTest, ParseBinaryMessage) {
+  TestMessage expected = MakeFullMessage();
+  EXPECT_THAT(ParseBinaryProto<TestMessage>(expected.SerializeAsString()),
+              IsOkAndHolds(EqualsProto(expected)));
+}
+
+TEST(ProtoParseUtilTest, ParseInvalidBinaryInput) {
+  EXPECT_THAT(ParseBinaryProto<TestMessage>("\xff\xff\xff"),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+TEST(ProtoParseUtilTest, ParseBinaryMessageOnArena) {
+  TestMessage expected = MakeFullMessage();
+  google::protobuf::Arena arena;
+  TestMessage *message;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      message, ParseBinaryProtoOnArena<TestMessage>(
+                   expected.SerializeAsString(), &arena));
+  EXPECT_THAT(*message, EqualsProto(expected));
+}
+
+TEST(ProtoParseUtilTest, ParseTextProtoFromFile) {
+  std::string path = WriteTempFile(
+      "proto_parse_util_text",
+      "enum_field: TEST_VALUE_ONE int_field: 123 "
+      "message_field: { string_field: \"Lorem ipsum\" }");
+  EXPECT_THAT(ParseTextProtoFromFile<TestMessage>(path),
+              IsOkAndHolds(EqualsProto(MakeFullMessage())));
+}
+
+TEST(ProtoParseUtilTest, ParseBinaryProtoFromFile) {
+  TestMessage expected = MakeFullMessage();
+  std::string path =
+      WriteTempFile("proto_parse_util_binary", expected.SerializeAsString());
+  EXPECT_THAT(ParseBinaryProtoFromFile<TestMessage>(path),
+              IsOkAndHolds(EqualsProto(expected)));
+}
+
+TEST(ProtoParseUtilTest, ParseFromMissingFileFails) {
+  EXPECT_THAT(ParseBinaryProtoFromFile<TestMessage>(absl::StrCat(
+                  absl::GetFlag(FLAGS_test_tmpdir), "/does_not_exist")),
+              Not(IsOk()));
+}
+
 }  // namespace
 }  // namespace asylo
@@ -0,0 +1,256 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_UTIL_READ_MOSTLY_GUARDED_H_
+#define ASYLO_UTIL_READ_MOSTLY_GUARDED_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+
+namespace asylo {
+
+template <typename T>
+class ReadMostlyLockView;
+
+template <typename T>
+class ReadMostlyReaderLockView;
+
+namespace read_mostly_internal {
+
+// Number of reader counter stripes of each ReadMostlyGuarded<T>.
+constexpr size_t kReaderStripes = 16;
+
+// A pair of reader counters, one per epoch parity, alone in its cache line.
+struct alignas(64) ReaderStripe {
+  std::atomic<int64_t> readers[2] = {{0}, {0}};
+};
+
+// Returns the stripe of the calling thread. Threads are spread over the
+// stripes round-robin, so that readers on different threads seldom share a
+// counter.
+inline size_t ThisThreadStripe() {
+  static std::atomic<size_t> next_stripe{0};
+  thread_local size_t stripe =
+      next_stripe.fetch_add(1, std::memory_order_relaxed) % kReaderStripes;
+  return stripe;
+}
+
+}  // namespace read_mostly_internal
+
+// ReadMostlyGuarded<T> protects an object of type T that is read far more
+// often than it is written, with the same locked view API as MutexGuarded<T>.
+//
+// Readers never contend with each other or with writers: ReaderLock() bumps a
+// counter in a cache line shared only with the readers on a few other
+// threads, and dereferences to the current version of the object. Lock()
+// instead serializes writers on a mutex and returns a view of a private copy
+// of the current version, which is published as the new version once the
+// view is destroyed. Readers that started before the publication keep seeing
+// the previous version, which is destroyed once they are all done, so the
+// writer blocks until then.
+//
+// Readers must therefore not hold a view for long, and must never hold a
+// reader view while writing, which would deadlock. Writes copy T, so T must be
+// copyable, and writes are considerably more expensive than with
+// MutexGuarded<T>.
+//
+// Example of use:
+//
+//     ReadMostlyGuarded<Config> config(LoadConfig());
+//
+//     // Called on every request.
+//     bool IsAllowed(const std::string &name) {
+//       return config.ReaderLock()->allowed_names.contains(name);
+//     }
+//
+//     // Called when the configuration changes.
+//     void Allow(const std::string &name) {
+//       config.Lock()->allowed_names.insert(name);
+//     }
+template <typename T>
+class ReadMostlyGuarded {
+  static_assert(std::is_copy_constructible<T>::value,
+                "T must be a copy-constructible type");
+
+ public:
+  ReadMostlyGuarded() : ReadMostlyGuarded(T()) {}
+
+  // Constructs a ReadMostlyGuarded<T> that initially holds |value|.
+  explicit ReadMostlyGuarded(T value)
+      : current_(new T(std::move(value))), epoch_(0) {}
+
+  ReadMostlyGuarded(const ReadMostlyGuarded &other) = delete;
+  ReadMostlyGuarded &operator=(const ReadMostlyGuarded &other) = delete;
+
+  // Must not be destroyed while there are locked view objects referencing it.
+  ~ReadMostlyGuarded() { delete current_.load(std::memory_order_relaxed); }
+
+  // Returns a smart pointer to a copy of the contained value, which replaces
+  // the contained value when the smart pointer is destroyed. The smart pointer
+  // is also an RAII lock excluding other writers.
+  ReadMostlyLockView<T> Lock() ABSL_LOCKS_EXCLUDED(writer_mu_) {
+    writer_mu_.Lock();
+    return ReadMostlyLockView<T>(
+        this, absl::make_unique<T>(*current_.load(std::memory_order_relaxed)));
+  }
+
+  // Returns a read-only smart pointer to the current version of the contained
+  // value. The version stays alive until the smart pointer is destroyed.
+  ReadMostlyReaderLockView<T> ReaderLock() const {
+    read_mostly_internal::ReaderStripe &stripe =
+        stripes_[read_mostly_internal::ThisThreadStripe()];
+    while (true) {
+      uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+      std::atomic<int64_t> *readers = &stripe.readers[epoch & 1];
+      readers->fetch_add(1, std::memory_order_seq_cst);
+      // A writer that flipped the epoch in between may already be waiting for
+      // the readers of this epoch to drain, and not see this one.
+      if (epoch_.load(std::memory_order_seq_cst) == epoch) {
+        return ReadMostlyReaderLockView<T>(
+            readers, current_.load(std::memory_order_seq_cst));
+      }
+      readers->fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+ private:
+  friend class ReadMostlyLockView<T>;
+
+  // Makes |value| the current version, waits for the readers of the previous
+  // version to finish, then destroys it and releases the writer lock.
+  void Publish(std::unique_ptr<T> value) ABSL_UNLOCK_FUNCTION(writer_mu_) {
+    T *previous = current_.exchange(value.release(), std::memory_order_seq_cst);
+    uint64_t epoch = epoch_.fetch_add(1, std::memory_order_seq_cst);
+    // Readers of later epochs load the new version. Those registered in the
+    // earlier epoch of the same parity were drained by the previous writer.
+    for (read_mostly_internal::ReaderStripe &stripe : stripes_) {
+      while (stripe.readers[epoch & 1].load(std::memory_order_seq_cst) != 0) {
+        std::this_thread::yield();
+      }
+    }
+    delete previous;
+    writer_mu_.Unlock();
+  }
+
+  std::atomic<T *> current_;
+  std::atomic<uint64_t> epoch_;
+  mutable read_mostly_internal::ReaderStripe
+      stripes_[read_mostly_internal::kReaderStripes];
+  absl::Mutex writer_mu_;
+};
+
+// A writeable view of a private copy of a ReadMostlyGuarded<T> object, which
+// is published when the view is destroyed. The view excludes other writers
+// during its lifetime.
+template <typename T>
+class ReadMostlyLockView {
+ public:
+  ReadMostlyLockView() = delete;
+
+  ReadMostlyLockView(const ReadMostlyLockView &other) = delete;
+  ReadMostlyLockView &operator=(const ReadMostlyLockView &other) = delete;
+
+  ReadMostlyLockView(ReadMostlyLockView &&other)
+      : guarded_(other.guarded_), value_(std::move(other.value_)) {
+    other.guarded_ = nullptr;
+  }
+
+  ReadMostlyLockView &operator=(ReadMostlyLockView &&other) = delete;
+
+  ~ReadMostlyLockView() {
+    if (guarded_ != nullptr) {
+      guarded_->Publish(std::move(value_));
+    }
+  }
+
+  T &operator*() { return *value_; }
+
+  T *operator->() { return value_.get(); }
+
+ private:
+  friend class ReadMostlyGuarded<T>;
+
+  ReadMostlyLockView(ReadMostlyGuarded<T> *guarded, std::unique_ptr<T> value)
+      : guarded_(guarded), value_(std::move(value)) {}
+
+  ReadMostlyGuarded<T> *guarded_;
+  std::unique_ptr<T> value_;
+};
+
+// A read-only view of a version of a ReadMostlyGuarded<T> object. The version
+// is not destroyed during the lifetime of the view.
+template <typename T>
+class ReadMostlyReaderLockView {
+ public:
+  ReadMostlyReaderLockView() = delete;
+
+  ReadMostlyReaderLockView(const ReadMostlyReaderLockView &other) = delete;
+  ReadMostlyReaderLockView &operator=(const ReadMostlyReaderLockView &other) =
+      delete;
+
+  ReadMostlyReaderLockView(ReadMostlyReaderLockView &&other)
+      : readers_(other.readers_), value_(other.value_) {
+    other.readers_ = nullptr;
+    other.value_ = nullptr;
+  }
+
+  ReadMostlyReaderLockView &operator=(ReadMostlyReaderLockView &&other) {
+    if (&other != this) {
+      Release();
+      readers_ = other.readers_;
+      value_ = other.value_;
+      other.readers_ = nullptr;
+      other.value_ = nullptr;
+    }
+    return *this;
+  }
+
+  ~ReadMostlyReaderLockView() { Release(); }
+
+  const T &operator*() const { return *value_; }
+
+  const T *operator->() const { return value_; }
+
+ private:
+  friend class ReadMostlyGuarded<T>;
+
+  ReadMostlyReaderLockView(std::atomic<int64_t> *readers, const T *value)
+      : readers_(readers), value_(value) {}
+
+  void Release() {
+    if (readers_ != nullptr) {
+      readers_->fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+  std::atomic<int64_t> *readers_;
+  const T *value_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_UTIL_READ_MOSTLY_GUARDED_H_
@@ -0,0 +1,141 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/util/read_mostly_guarded.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/synchronization/notification.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Eq;
+
+constexpr int kNumThreads = 8;
+
+// Counts the live instances of itself.
+struct Counted {
+  explicit Counted(int v, std::atomic<int> *live) : value(v), live(live) {
+    ++*live;
+  }
+  Counted(const Counted &other) : value(other.value), live(other.live) {
+    ++*live;
+  }
+  ~Counted() { --*live; }
+
+  int value;
+  std::atomic<int> *live;
+};
+
+TEST(ReadMostlyGuardedTest, ReadersSeeInitialValue) {
+  ReadMostlyGuarded<int> guarded(7);
+  EXPECT_THAT(*guarded.ReaderLock(), Eq(7));
+
+  ReadMostlyGuarded<std::vector<int>> empty;
+  EXPECT_TRUE(empty.ReaderLock()->empty());
+}
+
+TEST(ReadMostlyGuardedTest, WritesArePublishedWhenViewIsDestroyed) {
+  ReadMostlyGuarded<std::vector<int>> guarded;
+  {
+    auto view = guarded.Lock();
+    view->push_back(1);
+    EXPECT_TRUE(guarded.ReaderLock()->empty());
+  }
+  EXPECT_THAT(guarded.ReaderLock()->size(), Eq(1));
+
+  guarded.Lock()->push_back(2);
+  EXPECT_THAT(*guarded.ReaderLock(), testing::ElementsAre(1, 2));
+}
+
+TEST(ReadMostlyGuardedTest, ReadersKeepTheirVersionAlive) {
+  std::atomic<int> live(0);
+  ReadMostlyGuarded<Counted> guarded(Counted(1, &live));
+  EXPECT_THAT(live.load(), Eq(1));
+
+  absl::Notification writer_started;
+  absl::Notification writer_done;
+  std::unique_ptr<std::thread> writer;
+  {
+    auto reader = guarded.ReaderLock();
+    writer = absl::make_unique<std::thread>([&] {
+      writer_started.Notify();
+      guarded.Lock()->value = 2;
+      writer_done.Notify();
+    });
+    writer_started.WaitForNotification();
+    // The writer cannot destroy the version this reader holds.
+    EXPECT_FALSE(writer_done.WaitForNotificationWithTimeout(
+        absl::Milliseconds(100)));
+    EXPECT_THAT(reader->value, Eq(1));
+  }
+  writer->join();
+  EXPECT_THAT(guarded.ReaderLock()->value, Eq(2));
+  EXPECT_THAT(live.load(), Eq(1));
+}
+
+TEST(ReadMostlyGuardedTest, ConcurrentReadersAndWriters) {
+  // Each version holds a pair of equal values, so a torn or destroyed version
+  // shows up as a mismatch.
+  struct Pair {
+    int first = 0;
+    int second = 0;
+  };
+  constexpr int kWrites = 200;
+  ReadMostlyGuarded<Pair> guarded;
+  std::atomic<bool> done(false);
+  std::atomic<int> mismatches(0);
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < kNumThreads; i++) {
+    readers.emplace_back([&] {
+      int last = 0;
+      while (!done.load()) {
+        auto view = guarded.ReaderLock();
+        if (view->first != view->second || view->first < last) {
+          mismatches++;
+        }
+        last = view->first;
+      }
+    });
+  }
+  std::thread writer([&] {
+    for (int i = 1; i <= kWrites; i++) {
+      auto view = guarded.Lock();
+      view->first = i;
+      view->second = i;
+    }
+    done = true;
+  });
+  writer.join();
+  for (auto &reader : readers) {
+    reader.join();
+  }
+
+  EXPECT_THAT(mismatches.load(), Eq(0));
+  EXPECT_THAT(guarded.ReaderLock()->first, Eq(kWrites));
+}
+
+}  // namespace
+}  // namespace asylo
@@ -18,9 +18,14 @@
 
 #include "asylo/util/remote/grpc_channel_builder.h"
 
+#include <memory>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
 #include "absl/flags/flag.h"
 #include "absl/strings/string_view.h"
 #include "asylo/platform/primitives/remote/util/grpc_credential_builder.h"
+#include "asylo/util/mutex_guarded.h"
 #include "asylo/util/status.h"
 #include "asylo/util/status_macros.h"
 #include "asylo/util/statusor.h"
@@ -28,6 +33,20 @@
 #include "include/grpcpp/support/channel_arguments.h"
 
 namespace asylo {
+namespace {
+
+// Channels handed out by GetSharedChannel, keyed by server address. Entries are
+// weak so that a channel is closed once the last of its users releases it.
+using SharedChannelMap =
+    absl::flat_hash_map<std::string, std::weak_ptr<::grpc::Channel>>;
+
+MutexGuarded<SharedChannelMap> *shared_channels() {
+  static auto *const channels =
+      new MutexGuarded<SharedChannelMap>(SharedChannelMap());
+  return channels;
+}
+
+}  // namespace
 
 StatusOr<std::shared_ptr<::grpc::Channel>> GrpcChannelBuilder::BuildChannel(
     absl::string_view server_address) {
@@ -39,6 +58,31 @@ StatusOr<std::shared_ptr<::grpc::Channel>> GrpcChannelBuilder::BuildChannel(
   return CreateCustomChannelImpl(std::string(server_address), creds, args);
 }
 
+StatusOr<std::shared_ptr<::grpc::Channel>>
+GrpcChannelBuilder::GetSharedChannel(absl::string_view server_address) {
+  auto locked_channels = shared_channels()->Lock();
+  auto it = locked_channels->find(server_address);
+  if (it != locked_channels->end()) {
+    auto channel = it->second.lock();
+    if (channel) {
+      return channel;
+    }
+  }
+  // Drop entries of channels that are no longer in use.
+  for (auto entry = locked_channels->begin();
+       entry != locked_channels->end();) {
+    if (entry->second.expired()) {
+      locked_channels->erase(entry++);
+    } else {
+      ++entry;
+    }
+  }
+  std::shared_ptr<::grpc::Channel> channel;
+  ASYLO_ASSIGN_OR_RETURN(channel, BuildChannel(server_address));
+  (*locked_channels)[std::string(server_address)] = channel;
+  return channel;
+}
+
 StatusOr<::grpc::ChannelArguments> GrpcChannelBuilder::BuildChannelArguments() {
   ::grpc::ChannelArguments channel_args;
   if (absl::GetFlag(FLAGS_security_type) == "ssl") {
@@ -19,6 +19,8 @@
 #ifndef ASYLO_UTIL_REMOTE_GRPC_CHANNEL_BUILDER_H_
 #define ASYLO_UTIL_REMOTE_GRPC_CHANNEL_BUILDER_H_
 
+#include <memory>
+
 #include "absl/strings/string_view.h"
 #include "asylo/util/statusor.h"
 #include "include/grpcpp/channel.h"
@@ -32,6 +34,13 @@ class GrpcChannelBuilder {
 
   static StatusOr<std::shared_ptr<::grpc::Channel>> BuildChannel(
       absl::string_view server_address);
+
+  // Returns a channel to |server_address| shared by all callers that request
+  // the same address, building one with BuildChannel() if no such channel is
+  // in use. Remote enclaves provisioned through the same server thereby reuse
+  // a single connection instead of each establishing their own.
+  static StatusOr<std::shared_ptr<::grpc::Channel>> GetSharedChannel(
+      absl::string_view server_address);
   static StatusOr<::grpc::ChannelArguments> BuildChannelArguments();
 };
 
@@ -0,0 +1,72 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/util/remote/grpc_channel_builder.h"
+
+#include <memory>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "asylo/test/util/status_matchers.h"
+#include "include/grpcpp/channel.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Ne;
+using ::testing::NotNull;
+
+constexpr char kServerAddress[] = "[::1]:12345";
+constexpr char kOtherServerAddress[] = "[::1]:12346";
+
+TEST(GrpcChannelBuilderTest, SharedChannelIsReusedForSameAddress) {
+  std::shared_ptr<::grpc::Channel> channel;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      channel, GrpcChannelBuilder::GetSharedChannel(kServerAddress));
+  ASSERT_THAT(channel, NotNull());
+
+  std::shared_ptr<::grpc::Channel> same_channel;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      same_channel, GrpcChannelBuilder::GetSharedChannel(kServerAddress));
+  EXPECT_THAT(same_channel, Eq(channel));
+
+  std::shared_ptr<::grpc::Channel> other_channel;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      other_channel, GrpcChannelBuilder::GetSharedChannel(kOtherServerAddress));
+  EXPECT_THAT(other_channel, Ne(channel));
+}
+
+TEST(GrpcChannelBuilderTest, SharedChannelIsReleasedWhenUnused) {
+  std::weak_ptr<::grpc::Channel> released_channel;
+  {
+    std::shared_ptr<::grpc::Channel> channel;
+    ASYLO_ASSERT_OK_AND_ASSIGN(
+        channel, GrpcChannelBuilder::GetSharedChannel(kServerAddress));
+    released_channel = channel;
+  }
+  EXPECT_TRUE(released_channel.expired());
+
+  std::shared_ptr<::grpc::Channel> channel;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      channel, GrpcChannelBuilder::GetSharedChannel(kServerAddress));
+  EXPECT_THAT(channel, NotNull());
+}
+
+}  // namespace
+}  // namespace asylo
@@ -70,8 +70,8 @@ class RemoteProvisionClient : public RemoteProvision {
                     "No remote provision server specified."};
     }
     std::shared_ptr<::grpc::Channel> grpc_channel;
-    ASYLO_ASSIGN_OR_RETURN(grpc_channel,
-                           GrpcChannelBuilder::BuildChannel(provision_server));
+    ASYLO_ASSIGN_OR_RETURN(
+        grpc_channel, GrpcChannelBuilder::GetSharedChannel(provision_server));
     gpr_timespec absolute_deadline = gpr_time_add(
         gpr_now(GPR_CLOCK_REALTIME), gpr_time_from_seconds(10, GPR_TIMESPAN));
     if (!grpc_channel->WaitForConnected(absolute_deadline)) {
@@ -24,6 +24,7 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "absl/container/flat_hash_set.h"
 #include "absl/flags/flag.h"
@@ -31,8 +32,10 @@
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "asylo/platform/primitives/remote/util/proxy_launcher.h"
 #include "asylo/util/cleanup.h"
+#include "asylo/util/logging.h"
 #include "asylo/util/mutex_guarded.h"
 #include "asylo/util/path.h"
 #include "asylo/util/posix_error_space.h"
@@ -53,8 +56,105 @@
 ABSL_FLAG(std::string, remote_proxy, "",
           "Path to binary for running RemoteEnclaveProxyServer");
 
+ABSL_FLAG(int32_t, remote_proxy_pool_size, 0,
+          "Number of remote proxy processes launched ahead of provisioning "
+          "requests; 0 launches every proxy on request");
+
+ABSL_FLAG(int32_t, remote_proxy_pool_check_interval_ms, 1000,
+          "Interval between checks that pooled remote proxies are running");
+
 namespace asylo {
 
+ProxyPool::ProxyPool(absl::string_view remote_proxy, size_t size,
+                     absl::Duration check_interval)
+    : remote_proxy_(remote_proxy),
+      size_(size),
+      check_interval_(check_interval) {
+  refill_thread_ = absl::make_unique<Thread>([this] { Refill(); });
+}
+
+ProxyPool::~ProxyPool() {
+  state_.Lock()->stopping = true;
+  refill_thread_->Join();
+  auto state = state_.Lock();
+  for (const auto &proxy : state->proxies) {
+    DiscardPendingProxy(proxy);
+  }
+  state->proxies.clear();
+}
+
+StatusOr<pid_t> ProxyPool::Acquire(absl::string_view host_address) {
+  while (true) {
+    PendingProxy proxy;
+    {
+      auto state = state_.Lock();
+      if (state->proxies.empty()) {
+        break;
+      }
+      proxy = state->proxies.front();
+      state->proxies.pop_front();
+    }
+    if (IsPendingProxyAlive(proxy)) {
+      Status status = ReleasePendingProxy(proxy, host_address);
+      if (status.ok()) {
+        return proxy.pid;
+      }
+      LOG(WARNING) << "Failed to assign pooled remote proxy, pid=" << proxy.pid
+                   << ": " << status;
+    }
+    DiscardPendingProxy(proxy);
+  }
+  return LaunchProxy(host_address, remote_proxy_);
+}
+
+void ProxyPool::Refill() {
+  // Set after a failed launch, to retry at the next check instead of
+  // immediately.
+  bool backoff = false;
+  while (true) {
+    std::vector<PendingProxy> terminated;
+    size_t missing;
+    {
+      auto state =
+          state_
+              .LockWhenWithTimeout(
+                  [this, backoff](const State &state) {
+                    return state.stopping ||
+                           (!backoff && state.proxies.size() < size_);
+                  },
+                  check_interval_)
+              .second;
+      if (state->stopping) {
+        return;
+      }
+      for (auto it = state->proxies.begin(); it != state->proxies.end();) {
+        if (IsPendingProxyAlive(*it)) {
+          ++it;
+        } else {
+          terminated.push_back(*it);
+          it = state->proxies.erase(it);
+        }
+      }
+      missing = size_ - state->proxies.size();
+    }
+    for (const auto &proxy : terminated) {
+      LOG(WARNING) << "Pooled remote proxy terminated, pid=" << proxy.pid;
+      DiscardPendingProxy(proxy);
+    }
+    backoff = false;
+    for (size_t i = 0; i < missing; ++i) {
+      auto proxy_result = LaunchPendingProxy(remote_proxy_);
+      if (!proxy_result.ok()) {
+        LOG(ERROR) << "Failed to launch pooled remote proxy: "
+                   << proxy_result.status();
+        backoff = true;
+        break;
+      }
+      state_.Lock()->proxies.push_back(proxy_result.ValueOrDie());
+    }
+  }
+}
+
 grpc::Status ProvisionServiceImpl::Provision(
     grpc::ServerContext *context,
     grpc::ServerReader<ProvisionRequest> *reader,
@@ -87,9 +187,11 @@ StatusOr<std::string> ProvisionServiceImpl::PrepareEnclave(
                     "Client_address absent"};
     }
     pid_t remote_target_pid;
-    ASYLO_ASSIGN_OR_RETURN(remote_target_pid,
-                           LaunchProxy(request.client_address(),
-                                       absl::GetFlag(FLAGS_remote_proxy)));
+    ASYLO_ASSIGN_OR_RETURN(
+        remote_target_pid,
+        proxy_pool_ ? proxy_pool_->Acquire(request.client_address())
+                    : LaunchProxy(request.client_address(),
+                                  absl::GetFlag(FLAGS_remote_proxy)));
     request.clear_client_address();
     remote_targets_pids_.Lock()->emplace(remote_target_pid);
 
@@ -148,8 +250,18 @@ StatusOr<std::unique_ptr<RemoteProvisionServer>> RemoteProvisionServer::Create(
     return Status{error::GoogleError::FAILED_PRECONDITION,
                   "No --remote_proxy flag specified"};
   }
+  // Create the pool of proxies launched ahead of time, if requested.
+  std::unique_ptr<ProxyPool> proxy_pool;
+  if (absl::GetFlag(FLAGS_remote_proxy_pool_size) > 0) {
+    proxy_pool = absl::make_unique<ProxyPool>(
+        absl::GetFlag(FLAGS_remote_proxy),
+        absl::GetFlag(FLAGS_remote_proxy_pool_size),
+        absl::Milliseconds(
+            absl::GetFlag(FLAGS_remote_proxy_pool_check_interval_ms)));
+  }
   // Create provision server.
-  auto server = absl::make_unique<RemoteProvisionServer>(temporary_directory);
+  auto server = absl::make_unique<RemoteProvisionServer>(
+      temporary_directory, std::move(proxy_pool));
   // Register services.
   builder->RegisterService(&server->provision_service_);
   return std::move(server);
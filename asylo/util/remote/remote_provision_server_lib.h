@@ -19,11 +19,20 @@
 #ifndef ASYLO_UTIL_REMOTE_REMOTE_PROVISION_SERVER_LIB_H_
 #define ASYLO_UTIL_REMOTE_REMOTE_PROVISION_SERVER_LIB_H_
 
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+
 #include "absl/container/flat_hash_set.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "asylo/platform/primitives/remote/util/proxy_launcher.h"
 #include "asylo/util/mutex_guarded.h"
 #include "asylo/util/remote/remote_provision.grpc.pb.h"
 #include "asylo/util/remote/remote_provision.pb.h"
 #include "asylo/util/statusor.h"
+#include "asylo/util/thread.h"
 #include "include/grpc/support/time.h"
 #include "include/grpcpp/impl/codegen/sync_stream.h"
 #include "include/grpcpp/support/status.h"
@@ -33,10 +42,47 @@
 
 namespace asylo {
 
+// Pool of remote proxy processes launched ahead of provisioning requests, so
+// that a request does not wait for a proxy process to start. A background
+// thread discards pooled proxies that terminated and refills the pool up to
+// |size| proxies.
+class ProxyPool {
+ public:
+  ProxyPool(absl::string_view remote_proxy, size_t size,
+            absl::Duration check_interval);
+  ProxyPool(const ProxyPool &other) = delete;
+  ProxyPool &operator=(const ProxyPool &other) = delete;
+
+  // Stops refilling and discards all pooled proxies.
+  ~ProxyPool();
+
+  // Assigns |host_address| to a pooled proxy, or launches a new proxy if the
+  // pool is empty. Returns pid of the proxy process.
+  StatusOr<pid_t> Acquire(absl::string_view host_address);
+
+ private:
+  struct State {
+    std::deque<PendingProxy> proxies;
+    bool stopping = false;
+  };
+
+  // Keeps the pool filled until the pool is destroyed.
+  void Refill();
+
+  const std::string remote_proxy_;
+  const size_t size_;
+  const absl::Duration check_interval_;
+  MutexGuarded<State> state_;
+  std::unique_ptr<Thread> refill_thread_;
+};
+
 class ProvisionServiceImpl : public ProvisionService::Service {
  public:
-  explicit ProvisionServiceImpl(absl::string_view storage_dir)
+  // Launches proxies through |proxy_pool| if provided.
+  explicit ProvisionServiceImpl(absl::string_view storage_dir,
+                                std::unique_ptr<ProxyPool> proxy_pool = nullptr)
       : storage_dir_(storage_dir),
+        proxy_pool_(std::move(proxy_pool)),
         remote_targets_pids_(absl::flat_hash_set<pid_t>()) {}
   ProvisionServiceImpl(const ProvisionServiceImpl &other) = delete;
   ProvisionServiceImpl &operator=(const ProvisionServiceImpl &other) = delete;
@@ -51,6 +97,7 @@ class ProvisionServiceImpl : public ProvisionService::Service {
 
   std::atomic<uint64_t> enclave_index_{0};
   const std::string storage_dir_;
+  const std::unique_ptr<ProxyPool> proxy_pool_;
   MutexGuarded<absl::flat_hash_set<pid_t>> remote_targets_pids_;
 };
 
@@ -61,8 +108,10 @@ class RemoteProvisionServer {
 
   ~RemoteProvisionServer() = default;
 
-  explicit RemoteProvisionServer(absl::string_view temporary_directory)
-      : provision_service_(temporary_directory) {}
+  explicit RemoteProvisionServer(
+      absl::string_view temporary_directory,
+      std::unique_ptr<ProxyPool> proxy_pool = nullptr)
+      : provision_service_(temporary_directory, std::move(proxy_pool)) {}
   RemoteProvisionServer(const RemoteProvisionServer &other) = delete;
   RemoteProvisionServer &operator=(const RemoteProvisionServer &other) = delete;
 
@@ -24,6 +24,7 @@
 #include <memory>
 #include <string>
 
+#include "absl/container/flat_hash_set.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
@@ -180,6 +181,19 @@ class RemoteProxyClientConfig : public RemoteProxyConfig {
     return *open_census_config_;
   }
 
+  // EnableLocalExitCall lets the |RemoteEnclaveProxyServer| handle exit calls
+  // with |selector| on the remote machine instead of forwarding them to the
+  // host process. The server refuses to load the enclave if |selector| is not
+  // one of the exit calls it can safely handle itself, which are listed in
+  // local_exit_calls.h.
+  void EnableLocalExitCall(uint64_t selector) {
+    local_exit_calls_.insert(selector);
+  }
+
+  const absl::flat_hash_set<uint64_t> &local_exit_calls() const {
+    return local_exit_calls_;
+  }
+
  private:
   RemoteProxyClientConfig(
       std::unique_ptr<RemoteProxyConnectionConfig> connection_config,
@@ -191,6 +205,9 @@ class RemoteProxyClientConfig : public RemoteProxyConfig {
 
   // Configuration for OpenCensus.
   absl::optional<OpenCensusClientConfig> open_census_config_;
+
+  // Selectors of the exit calls handled on the remote machine.
+  absl::flat_hash_set<uint64_t> local_exit_calls_;
 };
 
 // |RemoteProxyServerConfig| provides a |RemoteEnclaveProxyServer| with the
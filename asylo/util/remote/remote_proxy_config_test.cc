@@ -34,10 +34,12 @@ namespace asylo {
 namespace {
 
 using ::testing::Eq;
+using ::testing::IsEmpty;
 using ::testing::IsNull;
 using ::testing::Not;
 using ::testing::Return;
 using ::testing::StrEq;
+using ::testing::UnorderedElementsAre;
 
 constexpr char kViewNameRoot[] = "test_root";
 constexpr char kHostAddress[] = "[1234:abcd:5678:f12::ab]:1234";
@@ -103,6 +105,19 @@ TEST(RemoteProxyClientConfigTest, OpenCensusMetricsConfigAddedCorrectly) {
   EXPECT_THAT(config_result.ValueOrDie().view_name_root, StrEq(kViewNameRoot));
 }
 
+TEST(RemoteProxyClientConfigTest, LocalExitCallsAddedCorrectly) {
+  std::unique_ptr<RemoteProxyClientConfig> config;
+  ASYLO_ASSERT_OK_AND_ASSIGN(config,
+                             RemoteProxyClientConfig::DefaultsWithProvision(
+                                 absl::make_unique<MockProvision>()));
+  EXPECT_THAT(config->local_exit_calls(), IsEmpty());
+
+  config->EnableLocalExitCall(7);
+  config->EnableLocalExitCall(3);
+  config->EnableLocalExitCall(7);
+  EXPECT_THAT(config->local_exit_calls(), UnorderedElementsAre(3, 7));
+}
+
 TEST(RemoteProxyServerConfigTest, DefaultsAreAsExpected) {
   std::unique_ptr<RemoteProxyServerConfig> config;
   ASYLO_ASSERT_OK_AND_ASSIGN(
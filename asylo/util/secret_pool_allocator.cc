@@ -0,0 +1,142 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/util/secret_pool_allocator.h"
+
+#include <pthread.h>
+
+#include <cstdint>
+#include <new>
+
+namespace asylo {
+namespace internal {
+namespace {
+
+// Size of the smallest block served by the pool, in bytes.
+constexpr size_t kMinBlockSize = 16;
+
+// Number of power-of-two size classes between kMinBlockSize and
+// kSecretPoolMaxBlockSize.
+constexpr int kNumSizeClasses = 7;
+
+static_assert(kMinBlockSize << (kNumSizeClasses - 1) ==
+                  kSecretPoolMaxBlockSize,
+              "Size classes do not cover the pool block sizes.");
+
+// Maximum number of free blocks a thread caches per size class. Blocks
+// released beyond this bound are returned to the heap.
+constexpr uint32_t kMaxCachedBlocks = 32;
+
+// A free block, linked into the free list of its size class.
+struct FreeBlock {
+  FreeBlock *next;
+};
+
+// The free lists of a thread.
+struct ThreadCache {
+  FreeBlock *blocks[kNumSizeClasses];
+  uint32_t counts[kNumSizeClasses];
+};
+
+// The calling thread's cache, or nullptr if it has none yet. Trivially
+// constructible, so the thread-local instance needs no initialization guard.
+// The cache is released by the destructor of a thread-specific data key.
+thread_local ThreadCache *thread_cache = nullptr;
+
+// Returns the index of the size class serving allocations of |size| bytes.
+int SizeClass(size_t size) {
+  if (size <= kMinBlockSize) {
+    return 0;
+  }
+  // Index of the highest bit of |size| - 1, relative to kMinBlockSize.
+  return 64 - __builtin_clzll(static_cast<uint64_t>(size - 1)) -
+         __builtin_ctzll(kMinBlockSize);
+}
+
+// Returns the size of blocks in size class |size_class|.
+size_t ClassSize(int size_class) { return kMinBlockSize << size_class; }
+
+// Returns the blocks cached by an exiting thread to the heap.
+void ReleaseThreadCache(void *value) {
+  ThreadCache *cache = static_cast<ThreadCache *>(value);
+  for (FreeBlock *block : cache->blocks) {
+    while (block) {
+      FreeBlock *next = block->next;
+      ::operator delete(block);
+      block = next;
+    }
+  }
+  if (thread_cache == cache) {
+    thread_cache = nullptr;
+  }
+  delete cache;
+}
+
+// Returns the calling thread's cache, creating it if necessary, or nullptr if
+// thread-specific data is not available, in which case blocks are not cached.
+ThreadCache *GetThreadCache() {
+  ThreadCache *cache = thread_cache;
+  if (cache) {
+    return cache;
+  }
+  static pthread_key_t key;
+  static const bool key_created =
+      pthread_key_create(&key, ReleaseThreadCache) == 0;
+  if (!key_created) {
+    return nullptr;
+  }
+  cache = new ThreadCache();
+  if (pthread_setspecific(key, cache) != 0) {
+    delete cache;
+    return nullptr;
+  }
+  thread_cache = cache;
+  return cache;
+}
+
+}  // namespace
+
+void *SecretPoolAllocate(size_t size) {
+  int size_class = SizeClass(size);
+  ThreadCache *cache = GetThreadCache();
+  if (cache && cache->blocks[size_class]) {
+    FreeBlock *block = cache->blocks[size_class];
+    cache->blocks[size_class] = block->next;
+    cache->counts[size_class]--;
+    // The rest of the block was cleansed before it was released.
+    block->next = nullptr;
+    return block;
+  }
+  return ::operator new(ClassSize(size_class));
+}
+
+void SecretPoolDeallocate(void *ptr, size_t size) {
+  int size_class = SizeClass(size);
+  ThreadCache *cache = GetThreadCache();
+  if (!cache || cache->counts[size_class] == kMaxCachedBlocks) {
+    ::operator delete(ptr);
+    return;
+  }
+  FreeBlock *block = static_cast<FreeBlock *>(ptr);
+  block->next = cache->blocks[size_class];
+  cache->blocks[size_class] = block;
+  cache->counts[size_class]++;
+}
+
+}  // namespace internal
+}  // namespace asylo
@@ -0,0 +1,120 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_UTIL_SECRET_POOL_ALLOCATOR_H_
+#define ASYLO_UTIL_SECRET_POOL_ALLOCATOR_H_
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+
+namespace asylo {
+namespace internal {
+
+// Size of the largest block served by the secret pool, in bytes.
+constexpr size_t kSecretPoolMaxBlockSize = 1024;
+
+// Returns a block of at least |size| bytes, which must not exceed
+// kSecretPoolMaxBlockSize, aligned for any fundamental type.
+void *SecretPoolAllocate(size_t size);
+
+// Returns the block |ptr| obtained from SecretPoolAllocate(|size|) to the
+// pool. The caller is responsible for cleansing the block beforehand.
+void SecretPoolDeallocate(void *ptr, size_t size);
+
+}  // namespace internal
+
+// SecretPoolAllocator is a minimal C++11
+// [allocator](http://en.cppreference.com/w/cpp/concept/Allocator) serving the
+// small, short-lived allocations that typically hold keys, MACs and other
+// secrets from a pool of recycled blocks instead of the heap.
+//
+// Allocations of up to internal::kSecretPoolMaxBlockSize bytes are rounded up
+// to a power-of-two size class. Each thread keeps a bounded free list of blocks
+// per size class, so that allocating and releasing a block touches only
+// thread-local state in the common case. Blocks released by a thread join that
+// thread's free lists, regardless of the thread that allocated them, and are
+// returned to the heap when the thread exits. Larger or over-aligned
+// allocations are forwarded to std::allocator.
+//
+// SecretPoolAllocator does not cleanse memory itself. It is the default
+// underlying allocator of CleansingAllocator, which cleanses every block before
+// it is released, so pooled blocks never retain secrets. Blocks released
+// through CleansingAllocator are handed out zeroed when reused.
+template <typename T>
+class SecretPoolAllocator {
+ public:
+  using value_type = T;
+  using pointer = T *;
+  using const_pointer = const T *;
+  using reference = T &;
+  using const_reference = const T &;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+
+  SecretPoolAllocator() = default;
+  template <typename U>
+  SecretPoolAllocator(const SecretPoolAllocator<U> &other) {}
+
+  template <typename U>
+  struct rebind {
+    using other = SecretPoolAllocator<U>;
+  };
+
+  pointer allocate(size_type n) {
+    if (!IsPooled(n)) {
+      return std::allocator<T>().allocate(n);
+    }
+    return static_cast<pointer>(internal::SecretPoolAllocate(n * sizeof(T)));
+  }
+
+  void deallocate(pointer ptr, size_type n) {
+    if (!IsPooled(n)) {
+      std::allocator<T>().deallocate(ptr, n);
+      return;
+    }
+    internal::SecretPoolDeallocate(ptr, n * sizeof(T));
+  }
+
+  size_type max_size() const {
+    return std::numeric_limits<size_type>::max() / sizeof(T);
+  }
+
+ private:
+  // Returns true if an allocation of |n| objects is served by the pool.
+  static bool IsPooled(size_type n) {
+    return alignof(T) <= alignof(std::max_align_t) &&
+           n <= internal::kSecretPoolMaxBlockSize / sizeof(T);
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const SecretPoolAllocator<T> &lhs,
+                const SecretPoolAllocator<U> &rhs) {
+  return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const SecretPoolAllocator<T> &lhs,
+                const SecretPoolAllocator<U> &rhs) {
+  return !(lhs == rhs);
+}
+
+}  // namespace asylo
+
+#endif  // ASYLO_UTIL_SECRET_POOL_ALLOCATOR_H_
@@ -0,0 +1,105 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/util/secret_pool_allocator.h"
+
+#include <cstdint>
+#include <list>
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "asylo/util/cleansing_types.h"
+
+namespace asylo {
+namespace {
+
+TEST(SecretPoolAllocatorTest, ReusesReleasedBlocks) {
+  SecretPoolAllocator<uint8_t> allocator;
+  uint8_t *first = allocator.allocate(100);
+  allocator.deallocate(first, 100);
+
+  // Any size in the same size class is served from the same free list.
+  uint8_t *second = allocator.allocate(70);
+  EXPECT_EQ(second, first);
+  allocator.deallocate(second, 70);
+}
+
+TEST(SecretPoolAllocatorTest, SizeClassesAreSeparate) {
+  SecretPoolAllocator<uint8_t> allocator;
+  uint8_t *small = allocator.allocate(16);
+  allocator.deallocate(small, 16);
+  uint8_t *large = allocator.allocate(17);
+  EXPECT_NE(large, small);
+  allocator.deallocate(large, 17);
+}
+
+TEST(SecretPoolAllocatorTest, LargeAllocationsBypassPool) {
+  SecretPoolAllocator<uint64_t> allocator;
+  constexpr size_t kCount = internal::kSecretPoolMaxBlockSize / 8 + 1;
+  uint64_t *buffer = allocator.allocate(kCount);
+  for (size_t i = 0; i < kCount; i++) {
+    buffer[i] = i;
+  }
+  allocator.deallocate(buffer, kCount);
+}
+
+TEST(SecretPoolAllocatorTest, CleansingVectorReusesCleansedMemory) {
+  const uint8_t *data;
+  {
+    CleansingVector<uint8_t> secret(64, 0xab);
+    data = secret.data();
+  }
+
+  SecretPoolAllocator<uint8_t> allocator;
+  uint8_t *buffer = allocator.allocate(64);
+  ASSERT_EQ(buffer, data);
+  for (size_t i = 0; i < 64; i++) {
+    EXPECT_EQ(buffer[i], 0) << "at byte " << i;
+  }
+  allocator.deallocate(buffer, 64);
+}
+
+TEST(SecretPoolAllocatorTest, BlocksMayBeReleasedByAnotherThread) {
+  SecretPoolAllocator<uint8_t> allocator;
+  std::vector<uint8_t *> buffers;
+  std::thread thread([&allocator, &buffers] {
+    for (int i = 0; i < 100; i++) {
+      buffers.push_back(allocator.allocate(32));
+    }
+  });
+  thread.join();
+  for (uint8_t *buffer : buffers) {
+    allocator.deallocate(buffer, 32);
+  }
+}
+
+TEST(SecretPoolAllocatorTest, WorksWithRebindingContainers) {
+  std::list<int, SecretPoolAllocator<int>> list;
+  for (int i = 0; i < 1000; i++) {
+    list.push_back(i);
+  }
+  int expected = 0;
+  for (int value : list) {
+    EXPECT_EQ(value, expected++);
+  }
+}
+
+}  // namespace
+}  // namespace asylo
@@ -18,6 +18,8 @@
 
 #include "asylo/util/status.h"
 
+#include <cstring>
+
 #include "absl/strings/str_cat.h"
 #include "asylo/util/status_error_space.h"
 
@@ -47,34 +49,61 @@ Status::Status(const error::ErrorSpace *space, int code,
                absl::string_view message)
     : error_space_(space), error_code_(code) {
   if (code != 0) {
-    message_ = std::string(message);
+    SetMessage(message);
+  }
+}
+
+Status::Status(const Status &other)
+    : error_space_(other.error_space_),
+      error_code_(other.error_code_),
+      message_(other.message_) {
+  if (other.owns_message_) {
+    SetMessage(other.message_);
   }
 }
 
 Status::Status(Status &&other)
     : error_space_(other.error_space_),
       error_code_(other.error_code_),
-      message_(std::move(other.message_)) {
-  other.Set(error::StatusError::MOVED, kMovedByConstructorErrorMsg);
+      owns_message_(other.owns_message_),
+      message_(other.message_) {
+  // Ownership of the message has been transferred, so |other| must not free it.
+  other.owns_message_ = false;
+  other.SetStatic(error::StatusError::MOVED, kMovedByConstructorErrorMsg);
 }
 
-Status &Status::operator=(Status &&other) {
+Status &Status::operator=(const Status &other) {
+  if (this == &other) {
+    return *this;
+  }
   error_space_ = other.error_space_;
   error_code_ = other.error_code_;
-  message_ = std::move(other.message_);
-  other.Set(error::StatusError::MOVED, kMovedByAssignmentErrorMsg);
+  if (other.owns_message_) {
+    SetMessage(other.message_);
+  } else {
+    ClearMessage();
+    message_ = other.message_;
+  }
   return *this;
 }
 
-Status Status::OkStatus() { return Status(); }
-
-int Status::error_code() const { return error_code_; }
-
-absl::string_view Status::error_message() const { return message_; }
-
-const error::ErrorSpace *Status::error_space() const { return error_space_; }
+Status &Status::operator=(Status &&other) {
+  const error::ErrorSpace *space = other.error_space_;
+  int code = other.error_code_;
+  bool owns_message = other.owns_message_;
+  absl::string_view message = other.message_;
+  other.owns_message_ = false;
+  other.SetStatic(error::StatusError::MOVED, kMovedByAssignmentErrorMsg);
+
+  ClearMessage();
+  error_space_ = space;
+  error_code_ = code;
+  owns_message_ = owns_message;
+  message_ = message;
+  return *this;
+}
 
-bool Status::ok() const { return error_code_ == 0; }
+Status Status::OkStatus() { return Status(); }
 
 std::string Status::ToString() const {
   return ok() ? error_space_->String(error_code_)
@@ -94,7 +123,7 @@ error::GoogleError Status::CanonicalCode() const {
 
 void Status::SaveTo(StatusProto *status_proto) const {
   status_proto->set_code(error_code_);
-  status_proto->set_error_message(message_);
+  status_proto->set_error_message(message_.data(), message_.size());
   status_proto->set_space(error_space_->SpaceName());
   status_proto->set_canonical_code(CanonicalCode());
 }
@@ -108,7 +137,7 @@ void Status::RestoreFrom(const StatusProto &status_proto) {
     if (status_proto.has_canonical_code() &&
         (error_space_->GoogleErrorCode(status_proto.code()) !=
          status_proto.canonical_code())) {
-      Set(error::StatusError::RESTORE_ERROR, kStatusProtoErrorSpaceMsg);
+      SetStatic(error::StatusError::RESTORE_ERROR, kStatusProtoErrorSpaceMsg);
       return;
     } else {
       error_code_ = status_proto.code();
@@ -121,7 +150,7 @@ void Status::RestoreFrom(const StatusProto &status_proto) {
     // Both error code and canonical code must be OK, or neither.
     if (status_proto.has_canonical_code() &&
         ((status_proto.code() == 0) != (status_proto.canonical_code() == 0))) {
-      Set(error::StatusError::RESTORE_ERROR, kStatusProtoOkMismatchMsg);
+      SetStatic(error::StatusError::RESTORE_ERROR, kStatusProtoOkMismatchMsg);
       return;
     }
     if (status_proto.has_canonical_code()) {
@@ -132,17 +161,30 @@ void Status::RestoreFrom(const StatusProto &status_proto) {
     }
   }
   if (error_code_ != 0) {
-    message_ = status_proto.error_message();
+    SetMessage(status_proto.error_message());
   } else {
-    message_.clear();
+    ClearMessage();
   }
 }
 
 Status Status::WithPrependedContext(absl::string_view context) {
-  message_ = absl::StrCat(context, ": ", message_);
+  SetMessage(absl::StrCat(context, ": ", message_));
   return *this;
 }
 
+void Status::SetMessage(absl::string_view message) {
+  if (message.empty()) {
+    ClearMessage();
+    return;
+  }
+  // Copy before releasing the current message, which |message| may alias.
+  char *copy = new char[message.size()];
+  memcpy(copy, message.data(), message.size());
+  ClearMessage();
+  message_ = absl::string_view(copy, message.size());
+  owns_message_ = true;
+}
+
 bool Status::IsCanonical() const {
   return error_space_->SpaceName() == error::kCanonicalErrorSpaceName;
 }
@@ -36,9 +36,16 @@
 
 namespace asylo {
 
+template <class T>
+class StatusOr;
+
 /// Status contains information about an error. Status contains an error code
 /// from some error space and a message string suitable for logging or
 /// debugging.
+///
+/// An OK Status holds no message and never allocates, so constructing, copying,
+/// moving, and destroying an OK Status only touches its inline fields. The
+/// message of a non-OK Status is stored out of line.
 class Status {
  public:
   /// Builds an OK Status in the canonical error space.
@@ -61,12 +68,14 @@ class Status {
     Set(code, message);
   }
 
-  Status(const Status &other) = default;
+  Status(const Status &other);
 
   // Non-default move constructor since the moved status should be set to
   // indicate an invalid state, which changes the code and error_space.
   Status(Status &&other);
 
+  ~Status() { ClearMessage(); }
+
   /// Constructs a Status object from `StatusT`. `StatusT` must be a status-type
   /// object. I.e.,
   ///
@@ -87,7 +96,7 @@ class Status {
         other.error_message());
   }
 
-  Status &operator=(const Status &other) = default;
+  Status &operator=(const Status &other);
 
   // Non-default move assignment operator since the moved status should be set
   // to indicate an invalid state, which changes the code and error_space.
@@ -118,28 +127,28 @@ class Status {
   StatusT ToOtherStatus() {
     Status status = ToCanonical();
     return StatusT(status_internal::ErrorCodeHolder(status.error_code_),
-                   status.message_);
+                   std::string(status.message_));
   }
 
   /// Gets the integer error code for this object.
   ///
   /// \return The associated integer error code.
-  int error_code() const;
+  int error_code() const { return error_code_; }
 
   /// Gets the string error message for this object.
   ///
   /// \return The associated error message.
-  absl::string_view error_message() const;
+  absl::string_view error_message() const { return message_; }
 
   /// Gets the error space for this object.
   ///
   /// \return The associated error space.
-  const error::ErrorSpace *error_space() const;
+  const error::ErrorSpace *error_space() const { return error_space_; }
 
   /// Indicates whether this object is OK (indicates no error).
   ///
   /// \return True if this object indicates no error.
-  bool ok() const;
+  bool ok() const { return error_code_ == 0; }
 
   /// Gets a string representation of this object.
   ///
@@ -215,18 +224,64 @@ class Status {
   Status WithPrependedContext(absl::string_view context);
 
  private:
-  // Sets this object to hold an error code |code| and error message |message|.
-  template <typename Enum, typename StringT>
-  void Set(Enum code, StringT &&message) {
+  template <class T>
+  friend class StatusOr;
+
+  // Returns a Status holding |code| and |static_message|, which must have
+  // static storage duration. The message is referenced rather than copied, so
+  // the returned object does not allocate.
+  template <typename Enum>
+  static Status WithStaticMessage(Enum code, absl::string_view static_message) {
+    return Status(error::error_enum_traits<Enum>::get_error_space(),
+                  static_cast<int>(code), static_message, StaticMessageTag());
+  }
+
+  // Selects the constructor that references, rather than copies, its message.
+  struct StaticMessageTag {};
+
+  Status(const error::ErrorSpace *space, int code,
+         absl::string_view static_message, StaticMessageTag)
+      : error_space_(space),
+        error_code_(code),
+        message_(code != 0 ? static_message : absl::string_view()) {}
+
+  // Sets this object to hold an error code |code| and a copy of the error
+  // message |message|.
+  template <typename Enum>
+  void Set(Enum code, absl::string_view message) {
     error_space_ = error::error_enum_traits<Enum>::get_error_space();
     error_code_ = static_cast<int>(code);
     if (error_code_ != 0) {
-      message_ = std::string(std::forward<StringT>(message));
+      SetMessage(message);
     } else {
-      message_.clear();
+      ClearMessage();
     }
   }
 
+  // Like Set(), but references |static_message| instead of copying it.
+  template <typename Enum>
+  void SetStatic(Enum code, absl::string_view static_message) {
+    error_space_ = error::error_enum_traits<Enum>::get_error_space();
+    error_code_ = static_cast<int>(code);
+    ClearMessage();
+    if (error_code_ != 0) {
+      message_ = static_message;
+    }
+  }
+
+  // Replaces the error message with a copy of |message|, which may alias the
+  // current message.
+  void SetMessage(absl::string_view message);
+
+  // Releases the error message, leaving it empty.
+  void ClearMessage() {
+    if (owns_message_) {
+      delete[] message_.data();
+      owns_message_ = false;
+    }
+    message_ = absl::string_view();
+  }
+
   // Returns true if the error code for this object is in the canonical error
   // space.
   bool IsCanonical() const;
@@ -234,9 +289,14 @@ class Status {
   const error::ErrorSpace *error_space_;
   int error_code_;
 
+  // Whether |message_| refers to a heap-allocated copy owned by this object.
+  // Otherwise |message_| is empty or refers to a string with static storage
+  // duration.
+  bool owns_message_ = false;
+
   // An optional error-message if error_code_ is non-zero. If error_code_ is
   // zero, then message_ is empty.
-  std::string message_;
+  absl::string_view message_;
 };
 
 bool operator==(const Status &lhs, const Status &rhs);
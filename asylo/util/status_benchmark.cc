@@ -0,0 +1,161 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Microbenchmarks for Status and StatusOr, covering the scenarios exercised by
+// status_test and statusor_test. The benchmarks are linked into a test target,
+// so they run natively and inside an enclave. They are only executed when
+// selected with --benchmarks, for example:
+//
+//   bazel run //asylo/util:status_benchmark -- --benchmarks=all
+//   bazel run //asylo/util:status_benchmark_enclave -- --benchmarks=all
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/base/attributes.h"
+#include "absl/memory/memory.h"
+#include "asylo/util/status.h"
+#include "asylo/util/status_macros.h"
+#include "asylo/util/statusor.h"
+#include <benchmark/benchmark.h>
+
+namespace asylo {
+namespace {
+
+constexpr char kErrorMessage[] = "Bad foo argument";
+
+// The functions below are kept out of line so that the benchmarks measure the
+// cost of returning a Status or StatusOr across a call.
+ABSL_ATTRIBUTE_NOINLINE Status ReturnOk() { return Status::OkStatus(); }
+
+ABSL_ATTRIBUTE_NOINLINE Status ReturnError() {
+  return Status(error::GoogleError::INVALID_ARGUMENT, kErrorMessage);
+}
+
+ABSL_ATTRIBUTE_NOINLINE Status PropagateOk() {
+  ASYLO_RETURN_IF_ERROR(ReturnOk());
+  ASYLO_RETURN_IF_ERROR(ReturnOk());
+  return Status::OkStatus();
+}
+
+ABSL_ATTRIBUTE_NOINLINE StatusOr<int> ReturnInt(int value) { return value; }
+
+ABSL_ATTRIBUTE_NOINLINE StatusOr<std::unique_ptr<int>> ReturnUniquePtr(
+    int value) {
+  return absl::make_unique<int>(value);
+}
+
+ABSL_ATTRIBUTE_NOINLINE StatusOr<int> AddInts(int a, int b) {
+  int sum;
+  ASYLO_ASSIGN_OR_RETURN(sum, ReturnInt(a));
+  int addend;
+  ASYLO_ASSIGN_OR_RETURN(addend, ReturnInt(b));
+  return sum + addend;
+}
+
+void BM_StatusOkConstruct(benchmark::State &state) {
+  for (auto _ : state) {
+    Status status = Status::OkStatus();
+    benchmark::DoNotOptimize(status);
+  }
+}
+BENCHMARK(BM_StatusOkConstruct);
+
+void BM_StatusOkReturn(benchmark::State &state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ReturnOk().ok());
+  }
+}
+BENCHMARK(BM_StatusOkReturn);
+
+void BM_StatusOkCopy(benchmark::State &state) {
+  Status status = Status::OkStatus();
+  for (auto _ : state) {
+    Status copy(status);
+    benchmark::DoNotOptimize(copy);
+  }
+}
+BENCHMARK(BM_StatusOkCopy);
+
+void BM_StatusOkMove(benchmark::State &state) {
+  Status status = Status::OkStatus();
+  for (auto _ : state) {
+    Status moved(std::move(status));
+    status = std::move(moved);
+    benchmark::DoNotOptimize(status);
+  }
+}
+BENCHMARK(BM_StatusOkMove);
+
+void BM_StatusOkPropagate(benchmark::State &state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(PropagateOk().ok());
+  }
+}
+BENCHMARK(BM_StatusOkPropagate);
+
+void BM_StatusErrorReturn(benchmark::State &state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ReturnError().ok());
+  }
+}
+BENCHMARK(BM_StatusErrorReturn);
+
+void BM_StatusErrorMove(benchmark::State &state) {
+  Status status = ReturnError();
+  for (auto _ : state) {
+    Status moved(std::move(status));
+    status = std::move(moved);
+    benchmark::DoNotOptimize(status);
+  }
+}
+BENCHMARK(BM_StatusErrorMove);
+
+void BM_StatusOrIntReturn(benchmark::State &state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ReturnInt(1).ValueOrDie());
+  }
+}
+BENCHMARK(BM_StatusOrIntReturn);
+
+void BM_StatusOrIntPropagate(benchmark::State &state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(AddInts(1, 2).ValueOrDie());
+  }
+}
+BENCHMARK(BM_StatusOrIntPropagate);
+
+void BM_StatusOrUniquePtrMoveValue(benchmark::State &state) {
+  for (auto _ : state) {
+    std::unique_ptr<int> value = ReturnUniquePtr(1).ValueOrDie();
+    benchmark::DoNotOptimize(value);
+  }
+}
+BENCHMARK(BM_StatusOrUniquePtrMoveValue);
+
+void BM_StatusOrStatus(benchmark::State &state) {
+  StatusOr<int> result = ReturnInt(1);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(result.status());
+  }
+}
+BENCHMARK(BM_StatusOrStatus);
+
+}  // namespace
+}  // namespace asylo
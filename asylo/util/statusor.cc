@@ -37,5 +37,6 @@ const char kValueOrDieMovedMsg[] = "Value moved by StatusOr::ValueOrDie";
 const char kStatusMoveAssignmentMsg[] =
     "Status moved by StatusOr move assignment";
 #endif
+const char kUnknownErrorMsg[] = "Unknown error";
 
 }  // namespace asylo
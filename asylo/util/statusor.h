@@ -43,6 +43,7 @@ ABSL_CONST_INIT extern const char kStatusMoveConstructorMsg[];
 ABSL_CONST_INIT extern const char kValueOrDieMovedMsg[];
 ABSL_CONST_INIT extern const char kStatusMoveAssignmentMsg[];
 #endif
+ABSL_CONST_INIT extern const char kUnknownErrorMsg[];
 
 /// A class for representing either a usable value, or an error.
 ///
@@ -120,7 +121,8 @@ class StatusOr {
   /// an empty vector, it will actually invoke the default constructor of
   /// StatusOr.
   explicit StatusOr()
-      : variant_(Status(error::GoogleError::UNKNOWN, "Unknown error")),
+      : variant_(Status::WithStaticMessage(error::GoogleError::UNKNOWN,
+                                           kUnknownErrorMsg)),
         has_value_(false) {}
 
   ~StatusOr() {
@@ -241,15 +243,16 @@ class StatusOr {
     if (has_value_) {
       new (&variant_) variant(std::move(other.variant_.value_));
       other.OverwriteValueWithStatus(
-          Status(error::StatusError::MOVED, kValueMoveConstructorMsg));
+          Status::WithStaticMessage(error::StatusError::MOVED,
+                                    kValueMoveConstructorMsg));
     } else {
       new (&variant_) variant(std::move(other.variant_.status_));
 #ifndef NDEBUG
       // The other.variant_.status_ gets moved and invalidated with a Status-
       // specific error message above. To aid debugging, set the status to a
       // StatusOr-specific error message.
-      other.variant_.status_ =
-          Status(error::StatusError::MOVED, kStatusMoveConstructorMsg);
+      other.variant_.status_ = Status::WithStaticMessage(
+          error::StatusError::MOVED, kStatusMoveConstructorMsg);
 #endif
     }
   }
@@ -271,15 +274,16 @@ class StatusOr {
     if (other.has_value_) {
       AssignValue(std::move(other.variant_.value_));
       other.OverwriteValueWithStatus(
-          Status(error::StatusError::MOVED, kValueMoveAssignmentMsg));
+          Status::WithStaticMessage(error::StatusError::MOVED,
+                                    kValueMoveAssignmentMsg));
     } else {
       AssignStatus(std::move(other.variant_.status_));
 #ifndef NDEBUG
       // The other.variant_.status_ gets moved and invalidated with a Status-
       // specific error message above. To aid debugging, set the status to a
       // StatusOr-specific error message.
-      other.variant_.status_ =
-          Status(error::StatusError::MOVED, kStatusMoveAssignmentMsg);
+      other.variant_.status_ = Status::WithStaticMessage(
+          error::StatusError::MOVED, kStatusMoveAssignmentMsg);
 #endif
     }
 
@@ -347,7 +351,8 @@ class StatusOr {
     // Invalidate this StatusOr object before returning control to caller.
     Cleanup set_moved_status([this] {
       OverwriteValueWithStatus(
-          Status(error::StatusError::MOVED, kValueOrDieMovedMsg));
+          Status::WithStaticMessage(error::StatusError::MOVED,
+                                    kValueOrDieMovedMsg));
     });
     return std::move(variant_.value_);
   }
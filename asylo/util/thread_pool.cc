@@ -0,0 +1,77 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/util/thread_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "asylo/util/logging.h"
+
+namespace asylo {
+
+ThreadPool::ThreadPool(int num_threads)
+    : num_threads_(std::max(num_threads, 1)), stopping_(false) {
+  absl::MutexLock lock(&join_mu_);
+  threads_.reserve(num_threads_);
+  for (int i = 0; i < num_threads_; i++) {
+    threads_.emplace_back(&ThreadPool::Work, this);
+  }
+}
+
+ThreadPool::~ThreadPool() { Shutdown(); }
+
+void ThreadPool::Schedule(std::function<void()> task) {
+  absl::MutexLock lock(&mu_);
+  CHECK(!stopping_) << "Cannot schedule a task after ThreadPool::Shutdown()";
+  tasks_.push_back(std::move(task));
+  cv_.Signal();
+}
+
+void ThreadPool::Shutdown() {
+  {
+    absl::MutexLock lock(&mu_);
+    stopping_ = true;
+    cv_.SignalAll();
+  }
+  absl::MutexLock lock(&join_mu_);
+  for (auto &thread : threads_) {
+    thread.Join();
+  }
+  threads_.clear();
+}
+
+void ThreadPool::Work() {
+  while (true) {
+    std::function<void()> task;
+    {
+      absl::MutexLock lock(&mu_);
+      while (tasks_.empty() && !stopping_) {
+        cv_.Wait(&mu_);
+      }
+      if (tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+}  // namespace asylo
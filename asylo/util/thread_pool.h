@@ -0,0 +1,107 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_UTIL_THREAD_POOL_H_
+#define ASYLO_UTIL_THREAD_POOL_H_
+
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "asylo/util/thread.h"
+
+namespace asylo {
+
+// A fixed set of worker threads that run submitted tasks in first-in,
+// first-out order. The workers are asylo::Threads, so a ThreadPool can be used
+// both by untrusted code and inside an enclave, where each worker occupies an
+// enclave thread slot for the lifetime of the pool.
+//
+// Example:
+//
+//     ThreadPool pool(/*num_threads=*/4);
+//     std::future<Status> result = pool.Submit([] { return DoWork(); });
+//     ...
+//     Status status = result.get();
+//
+// A task must not wait for another task of the same pool, since all workers
+// may be busy waiting.
+class ThreadPool {
+ public:
+  // Starts |num_threads| threads, or one thread if |num_threads| is not
+  // positive.
+  explicit ThreadPool(int num_threads);
+
+  ThreadPool(const ThreadPool &other) = delete;
+  ThreadPool &operator=(const ThreadPool &other) = delete;
+
+  // Calls Shutdown().
+  ~ThreadPool();
+
+  // Schedules |task| to run on one of the threads of the pool. Must not be
+  // called after Shutdown().
+  void Schedule(std::function<void()> task);
+
+  // Schedules |function| to run on one of the threads of the pool and returns
+  // a future for its result. Must not be called after Shutdown().
+  template <typename Function>
+  std::future<typename std::result_of<Function()>::type> Submit(
+      Function &&function) {
+    using Result = typename std::result_of<Function()>::type;
+    // std::function requires a copyable target, so share the move-only task.
+    auto task = std::make_shared<std::packaged_task<Result()>>(
+        std::forward<Function>(function));
+    std::future<Result> result = task->get_future();
+    Schedule([task] { (*task)(); });
+    return result;
+  }
+
+  // Stops accepting new tasks, runs all tasks that are already scheduled, and
+  // joins all threads. Later calls have no effect. Must not be called from a
+  // thread of the pool.
+  void Shutdown();
+
+  // Returns the number of threads in the pool.
+  int num_threads() const { return num_threads_; }
+
+ private:
+  // Body of each thread of the pool.
+  void Work();
+
+  const int num_threads_;
+
+  absl::Mutex mu_;
+  absl::CondVar cv_;
+  std::deque<std::function<void()>> tasks_ ABSL_GUARDED_BY(mu_);
+  bool stopping_ ABSL_GUARDED_BY(mu_);
+
+  // Guards joining |threads_| so that concurrent calls to Shutdown() do not
+  // join a thread twice.
+  absl::Mutex join_mu_;
+  std::vector<Thread> threads_ ABSL_GUARDED_BY(join_mu_);
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_UTIL_THREAD_POOL_H_
@@ -0,0 +1,124 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/util/thread_pool.h"
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/memory/memory.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "asylo/util/thread.h"
+
+namespace asylo {
+namespace {
+
+// Verify that every scheduled task runs, and that tasks run on the threads of
+// the pool rather than on the scheduling thread.
+TEST(ThreadPoolTest, RunsAllTasks) {
+  constexpr int kNumTasks = 100;
+  ThreadPool pool(/*num_threads=*/3);
+  EXPECT_EQ(pool.num_threads(), 3);
+
+  std::atomic<int> ran(0);
+  std::atomic<int> ran_on_caller(0);
+  Thread::Id caller = Thread::this_thread_id();
+  absl::BlockingCounter done(kNumTasks);
+  for (int i = 0; i < kNumTasks; i++) {
+    pool.Schedule([&] {
+      ran++;
+      if (Thread::this_thread_id() == caller) {
+        ran_on_caller++;
+      }
+      done.DecrementCount();
+    });
+  }
+  done.Wait();
+  EXPECT_EQ(ran, kNumTasks);
+  EXPECT_EQ(ran_on_caller, 0);
+}
+
+// Verify that Submit() returns futures for the results of the tasks, including
+// move-only results.
+TEST(ThreadPoolTest, SubmitReturnsResults) {
+  ThreadPool pool(/*num_threads=*/2);
+  std::vector<std::future<int>> results;
+  for (int i = 0; i < 10; i++) {
+    results.push_back(pool.Submit([i] { return i * i; }));
+  }
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(results[i].get(), i * i);
+  }
+
+  std::future<std::unique_ptr<int>> pointer =
+      pool.Submit([] { return absl::make_unique<int>(42); });
+  EXPECT_EQ(*pointer.get(), 42);
+
+  std::future<void> done = pool.Submit([] {});
+  done.get();
+}
+
+// Verify that a task blocked on one thread does not delay tasks scheduled after
+// it when the pool has other threads.
+TEST(ThreadPoolTest, BlockedTaskDoesNotStallPool) {
+  ThreadPool pool(/*num_threads=*/2);
+  absl::Notification release;
+  absl::Notification second_ran;
+  pool.Schedule([&release] { release.WaitForNotification(); });
+  pool.Schedule([&second_ran] { second_ran.Notify(); });
+  EXPECT_TRUE(second_ran.WaitForNotificationWithTimeout(absl::Seconds(10)));
+  release.Notify();
+}
+
+// Verify that shutting down the pool runs the tasks that are still queued, in
+// order, and that further calls to Shutdown() have no effect.
+TEST(ThreadPoolTest, ShutdownRunsQueuedTasks) {
+  std::vector<int> order;
+  ThreadPool pool(/*num_threads=*/1);
+  for (int i = 0; i < 10; i++) {
+    pool.Schedule([&order, i] { order.push_back(i); });
+  }
+  pool.Shutdown();
+  ASSERT_EQ(order.size(), 10);
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(order[i], i);
+  }
+  pool.Shutdown();
+}
+
+// Verify that scheduling a task after Shutdown() is a fatal error.
+TEST(ThreadPoolDeathTest, ScheduleAfterShutdownDies) {
+  ThreadPool pool(/*num_threads=*/1);
+  pool.Shutdown();
+  EXPECT_DEATH_IF_SUPPORTED(pool.Schedule([] {}), "after ThreadPool::Shutdown");
+}
+
+// Verify that a pool asked for no threads still runs tasks.
+TEST(ThreadPoolTest, StartsAtLeastOneThread) {
+  ThreadPool pool(/*num_threads=*/0);
+  EXPECT_EQ(pool.num_threads(), 1);
+  EXPECT_EQ(pool.Submit([] { return 7; }).get(), 7);
+}
+
+}  // namespace
+}  // namespace asylo
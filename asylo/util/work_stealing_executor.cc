@@ -0,0 +1,197 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/util/work_stealing_executor.h"
+
+#include <algorithm>
+
+#include "absl/synchronization/notification.h"
+
+namespace asylo {
+namespace {
+
+// Identifies the executor and deque owned by the calling worker thread.
+struct WorkerIdentity {
+  const WorkStealingExecutor *executor;
+  size_t index;
+};
+
+thread_local WorkerIdentity current_worker = {nullptr, 0};
+
+}  // namespace
+
+struct WorkStealingExecutor::Group {
+  Group(absl::FunctionRef<void(size_t)> body, size_t grain, size_t size)
+      : body(body), grain(grain), remaining(size) {}
+
+  const absl::FunctionRef<void(size_t)> body;
+  const size_t grain;
+
+  // Number of indices not yet run.
+  std::atomic<size_t> remaining;
+
+  // Notified once |remaining| drops to zero.
+  absl::Notification done;
+};
+
+WorkStealingExecutor::WorkStealingExecutor(int num_workers)
+    : queued_tasks_(0), idle_workers_(0), stopping_(false) {
+  num_workers = std::max(num_workers, 0);
+  for (int i = 0; i <= num_workers; i++) {
+    deques_.emplace_back(new Deque);
+  }
+  workers_.reserve(num_workers);
+  for (int i = 0; i < num_workers; i++) {
+    workers_.emplace_back(&WorkStealingExecutor::Work, this,
+                          static_cast<size_t>(i));
+  }
+}
+
+WorkStealingExecutor::~WorkStealingExecutor() {
+  {
+    absl::MutexLock lock(&idle_mu_);
+    stopping_ = true;
+    idle_cv_.SignalAll();
+  }
+  for (auto &worker : workers_) {
+    worker.Join();
+  }
+}
+
+void WorkStealingExecutor::ParallelFor(size_t begin, size_t end, size_t grain,
+                                       absl::FunctionRef<void(size_t)> body) {
+  if (begin >= end) {
+    return;
+  }
+  grain = std::max<size_t>(grain, 1);
+  if (workers_.empty() || end - begin <= grain) {
+    for (size_t i = begin; i < end; i++) {
+      body(i);
+    }
+    return;
+  }
+
+  Group group(body, grain, end - begin);
+  size_t index = CurrentDeque();
+  Execute({&group, begin, end}, index);
+
+  // Help with outstanding work until the whole range is done. Once there is
+  // nothing left to steal, the remaining chunks are running on other threads.
+  while (!group.done.HasBeenNotified()) {
+    if (!RunOneTask(index)) {
+      group.done.WaitForNotification();
+    }
+  }
+}
+
+void WorkStealingExecutor::Work(size_t index) {
+  current_worker = {this, index};
+  while (true) {
+    if (RunOneTask(index)) {
+      continue;
+    }
+
+    // Register as idle before the final check for tasks, so that a concurrent
+    // Push() either sees this worker as idle and wakes it, or its task is seen
+    // here.
+    absl::MutexLock lock(&idle_mu_);
+    idle_workers_.fetch_add(1, std::memory_order_seq_cst);
+    while (queued_tasks_.load(std::memory_order_seq_cst) == 0 && !stopping_) {
+      idle_cv_.Wait(&idle_mu_);
+    }
+    idle_workers_.fetch_sub(1, std::memory_order_relaxed);
+    if (stopping_ && queued_tasks_.load(std::memory_order_relaxed) == 0) {
+      return;
+    }
+  }
+}
+
+bool WorkStealingExecutor::RunOneTask(size_t index) {
+  if (queued_tasks_.load(std::memory_order_acquire) == 0) {
+    return false;
+  }
+
+  Task task;
+  bool found = false;
+  {
+    Deque *own = deques_[index].get();
+    absl::MutexLock lock(&own->mu);
+    if (!own->tasks.empty()) {
+      task = own->tasks.back();
+      own->tasks.pop_back();
+      found = true;
+    }
+  }
+
+  // Steal the oldest, and so largest, task of another deque, starting with the
+  // next deque so that thieves spread out over their victims.
+  for (size_t i = 1; !found && i < deques_.size(); i++) {
+    Deque *victim = deques_[(index + i) % deques_.size()].get();
+    absl::MutexLock lock(&victim->mu);
+    if (!victim->tasks.empty()) {
+      task = victim->tasks.front();
+      victim->tasks.pop_front();
+      found = true;
+    }
+  }
+
+  if (!found) {
+    return false;
+  }
+  queued_tasks_.fetch_sub(1, std::memory_order_relaxed);
+  Execute(task, index);
+  return true;
+}
+
+void WorkStealingExecutor::Execute(Task task, size_t index) {
+  Group *group = task.group;
+  while (task.end - task.begin > group->grain) {
+    size_t middle = task.begin + (task.end - task.begin) / 2;
+    Push({group, middle, task.end}, index);
+    task.end = middle;
+  }
+  for (size_t i = task.begin; i < task.end; i++) {
+    group->body(i);
+  }
+  size_t count = task.end - task.begin;
+  if (group->remaining.fetch_sub(count, std::memory_order_acq_rel) == count) {
+    group->done.Notify();
+  }
+}
+
+void WorkStealingExecutor::Push(Task task, size_t index) {
+  {
+    Deque *deque = deques_[index].get();
+    absl::MutexLock lock(&deque->mu);
+    deque->tasks.push_back(task);
+  }
+  queued_tasks_.fetch_add(1, std::memory_order_seq_cst);
+  if (idle_workers_.load(std::memory_order_seq_cst) > 0) {
+    absl::MutexLock lock(&idle_mu_);
+    idle_cv_.Signal();
+  }
+}
+
+size_t WorkStealingExecutor::CurrentDeque() const {
+  if (current_worker.executor == this) {
+    return current_worker.index;
+  }
+  return workers_.size();
+}
+
+}  // namespace asylo
@@ -0,0 +1,132 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_UTIL_WORK_STEALING_EXECUTOR_H_
+#define ASYLO_UTIL_WORK_STEALING_EXECUTOR_H_
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/functional/function_ref.h"
+#include "absl/synchronization/mutex.h"
+#include "asylo/util/thread.h"
+
+namespace asylo {
+
+// A fork-join executor running fine-grained parallel work on a fixed set of
+// worker threads. Each worker owns a deque of tasks: it pushes and pops work at
+// the back of its own deque, and an idle worker steals from the front of
+// another worker's deque, so that large chunks of work migrate to idle workers
+// while each worker mostly touches only its own deque.
+//
+// The workers are started once, when the executor is constructed, so running
+// parallel work does not create or join any threads. Inside an enclave each
+// worker occupies a thread slot for the lifetime of the executor; configuring
+// EnclaveConfig.thread_pool_size to at least the number of workers lets them
+// start without donating new threads to the enclave.
+//
+// Example use from TrustedApplication::Run():
+//
+//     WorkStealingExecutor executor(/*num_workers=*/4);
+//     std::vector<bool> valid(signatures.size());
+//     executor.ParallelFor(0, signatures.size(), /*grain=*/8,
+//                          [&](size_t i) { valid[i] = Verify(signatures[i]); });
+class WorkStealingExecutor {
+ public:
+  // Starts |num_workers| worker threads. With no workers, all work runs on the
+  // calling thread.
+  explicit WorkStealingExecutor(int num_workers);
+
+  WorkStealingExecutor(const WorkStealingExecutor &other) = delete;
+  WorkStealingExecutor &operator=(const WorkStealingExecutor &other) = delete;
+
+  // Stops and joins all worker threads. Must not be called while any call to
+  // ParallelFor() is in progress.
+  ~WorkStealingExecutor();
+
+  // Calls |body| once for every index in [|begin|, |end|), in parallel, and
+  // returns once all calls have completed. The range is split recursively into
+  // chunks of at most |grain| indices, which are run sequentially. The calling
+  // thread helps run chunks while it waits. |body| may itself call
+  // ParallelFor() on the same executor.
+  void ParallelFor(size_t begin, size_t end, size_t grain,
+                   absl::FunctionRef<void(size_t)> body);
+
+  // Returns the number of worker threads.
+  int num_workers() const { return static_cast<int>(workers_.size()); }
+
+ private:
+  // The shared state of one ParallelFor() call.
+  struct Group;
+
+  // A contiguous range of indices of a Group that remains to be run.
+  struct Task {
+    Group *group;
+    size_t begin;
+    size_t end;
+  };
+
+  // A task deque and the lock guarding it.
+  struct Deque {
+    absl::Mutex mu;
+    std::deque<Task> tasks ABSL_GUARDED_BY(mu);
+  };
+
+  // Body of each worker thread, which owns deque |index|.
+  void Work(size_t index);
+
+  // Runs at most one task, preferably from the back of deque |index| or else
+  // stolen from the front of another deque. Returns false if every deque was
+  // empty.
+  bool RunOneTask(size_t index);
+
+  // Runs |task|, pushing its upper halves onto deque |index| until what is left
+  // is no larger than the grain of its group.
+  void Execute(Task task, size_t index);
+
+  // Pushes |task| onto the back of deque |index| and wakes an idle worker.
+  void Push(Task task, size_t index);
+
+  // Returns the index of the deque owned by the calling thread, or the index of
+  // the shared deque for threads that are not workers of this executor.
+  size_t CurrentDeque() const;
+
+  // One deque per worker, followed by a deque shared by all other threads.
+  std::vector<std::unique_ptr<Deque>> deques_;
+
+  // Total number of tasks in all deques.
+  std::atomic<size_t> queued_tasks_;
+
+  // Number of workers waiting for tasks.
+  std::atomic<int> idle_workers_;
+
+  // Guards sleeping and waking idle workers.
+  absl::Mutex idle_mu_;
+  absl::CondVar idle_cv_;
+  bool stopping_ ABSL_GUARDED_BY(idle_mu_);
+
+  std::vector<Thread> workers_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_UTIL_WORK_STEALING_EXECUTOR_H_
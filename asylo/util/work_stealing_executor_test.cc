@@ -0,0 +1,122 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/util/work_stealing_executor.h"
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+#include "asylo/util/thread.h"
+
+namespace asylo {
+namespace {
+
+constexpr int kWorkers = 4;
+
+// Returns a vector counting how many times ParallelFor() visited each index of
+// [0, |size|).
+std::vector<int> CountVisits(WorkStealingExecutor *executor, size_t size,
+                             size_t grain) {
+  std::vector<std::atomic<int>> visits(size);
+  executor->ParallelFor(0, size, grain, [&visits](size_t i) { visits[i]++; });
+  std::vector<int> result;
+  for (const auto &count : visits) {
+    result.push_back(count.load());
+  }
+  return result;
+}
+
+TEST(WorkStealingExecutorTest, VisitsEveryIndexOnce) {
+  WorkStealingExecutor executor(kWorkers);
+  EXPECT_EQ(executor.num_workers(), kWorkers);
+  for (size_t grain : {1, 3, 64, 10000}) {
+    EXPECT_THAT(CountVisits(&executor, 1000, grain),
+                ::testing::Each(::testing::Eq(1)))
+        << "grain " << grain;
+  }
+}
+
+TEST(WorkStealingExecutorTest, EmptyRange) {
+  WorkStealingExecutor executor(kWorkers);
+  bool called = false;
+  executor.ParallelFor(5, 5, 1, [&called](size_t i) { called = true; });
+  executor.ParallelFor(5, 2, 1, [&called](size_t i) { called = true; });
+  EXPECT_FALSE(called);
+}
+
+TEST(WorkStealingExecutorTest, NoWorkersRunsInline) {
+  WorkStealingExecutor executor(0);
+  EXPECT_EQ(executor.num_workers(), 0);
+  const Thread::Id caller = Thread::this_thread_id();
+  bool other_thread = false;
+  executor.ParallelFor(0, 100, 1, [&](size_t i) {
+    other_thread |= Thread::this_thread_id() != caller;
+  });
+  EXPECT_FALSE(other_thread);
+}
+
+TEST(WorkStealingExecutorTest, RunsOnWorkers) {
+  WorkStealingExecutor executor(kWorkers);
+  absl::Mutex mu;
+  absl::flat_hash_set<Thread::Id> threads;
+  executor.ParallelFor(0, 10000, 1, [&](size_t i) {
+    absl::MutexLock lock(&mu);
+    threads.insert(Thread::this_thread_id());
+  });
+  EXPECT_GE(threads.size(), 1);
+  EXPECT_LE(threads.size(), kWorkers + 1);
+}
+
+TEST(WorkStealingExecutorTest, NestedParallelFor) {
+  WorkStealingExecutor executor(kWorkers);
+  constexpr size_t kOuter = 16;
+  constexpr size_t kInner = 256;
+  std::vector<std::atomic<int>> visits(kOuter * kInner);
+  executor.ParallelFor(0, kOuter, 1, [&](size_t i) {
+    executor.ParallelFor(0, kInner, 4,
+                         [&](size_t j) { visits[i * kInner + j]++; });
+  });
+  for (const auto &count : visits) {
+    EXPECT_EQ(count.load(), 1);
+  }
+}
+
+TEST(WorkStealingExecutorTest, ConcurrentCallers) {
+  WorkStealingExecutor executor(kWorkers);
+  std::atomic<size_t> sum(0);
+  std::vector<Thread> callers;
+  for (int i = 0; i < 3; i++) {
+    callers.emplace_back([&executor, &sum] {
+      for (int j = 0; j < 50; j++) {
+        executor.ParallelFor(0, 100, 2, [&sum](size_t k) { sum += k; });
+      }
+    });
+  }
+  for (auto &caller : callers) {
+    caller.Join();
+  }
+  EXPECT_EQ(sum.load(), 3 * 50 * (99 * 100 / 2));
+}
+
+}  // namespace
+}  // namespace asylo